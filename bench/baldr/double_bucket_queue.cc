@@ -0,0 +1,574 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/ptree.hpp>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "baldr/double_bucket_queue.h"
+#include "baldr/graphreader.h"
+#include "midgard/logging.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+// What the path algorithms use for the default costing unit size of 1 second
+constexpr uint32_t kBucketSize = 1;
+constexpr float kBucketRange = 20000.f * kBucketSize;
+// Fastest a car goes in meters per second, keeps the distance heuristic admissible
+constexpr float kMaxSpeed = 140.f / 3.6f;
+// How far the isochrone like expansions go in seconds
+constexpr float kIsochroneLimit = 20 * 60;
+// A label which is not in one of the queues below
+constexpr uint32_t kNone = kInvalidLabel;
+
+/**
+ * What a search did to its queue, in order. Labels are numbered in the order they were added.
+ */
+struct trace_t {
+  struct op_t {
+    enum kind_t : uint8_t { add, decrease, pop } kind;
+    uint32_t label;
+    float cost;
+  };
+  std::vector<op_t> ops;
+  uint32_t labels = 0;
+  float mincost = 0;
+};
+
+struct search_label_t {
+  GraphId node;
+  float cost;
+  float sortcost_;
+  float sortcost() const {
+    return sortcost_;
+  }
+};
+
+/**
+ * Records the queue operations of a node based search with auto speeds over the utrecht graph,
+ * including the transitions between the hierarchy levels. With a destination it is an A* which
+ * stops when the destination is settled, without one it is a dijkstra until the cost limit as
+ * isochrones and matrices do.
+ */
+trace_t record(GraphReader& reader, const GraphId& origin, const GraphId& destination) {
+  auto ll = [&reader](const GraphId& node) {
+    auto tile = reader.GetGraphTile(node);
+    return tile ? tile->get_node_ll(node) : midgard::PointLL{};
+  };
+  const auto destination_ll = destination.Is_Valid() ? ll(destination) : midgard::PointLL{};
+  auto heuristic = [&](const midgard::PointLL& point) {
+    return destination.Is_Valid() ? static_cast<float>(point.Distance(destination_ll)) / kMaxSpeed
+                                  : 0.f;
+  };
+
+  trace_t trace;
+  trace.mincost = heuristic(ll(origin));
+  std::vector<search_label_t> labels;
+  std::unordered_map<GraphId, uint32_t> index;
+  std::vector<bool> settled;
+  DoubleBucketQueue<search_label_t> queue(trace.mincost, kBucketRange, kBucketSize, labels);
+
+  auto relax = [&](const GraphId& node, const float cost) {
+    auto found = index.find(node);
+    if (found == index.end()) {
+      auto tile = reader.GetGraphTile(node);
+      if (!tile) {
+        return;
+      }
+      auto sortcost = cost + heuristic(tile->get_node_ll(node));
+      index.emplace(node, labels.size());
+      trace.ops.push_back({trace_t::op_t::add, static_cast<uint32_t>(labels.size()), sortcost});
+      labels.push_back({node, cost, sortcost});
+      settled.push_back(false);
+      queue.add(labels.size() - 1);
+    } else if (!settled[found->second] && cost < labels[found->second].cost) {
+      auto& label = labels[found->second];
+      auto sortcost = label.sortcost_ - label.cost + cost;
+      trace.ops.push_back({trace_t::op_t::decrease, found->second, sortcost});
+      queue.decrease(found->second, sortcost);
+      label.cost = cost;
+      label.sortcost_ = sortcost;
+    }
+  };
+
+  relax(origin, 0);
+  while (true) {
+    auto label = queue.pop();
+    trace.ops.push_back({trace_t::op_t::pop, label, 0});
+    if (label == kInvalidLabel || labels[label].node == destination ||
+        (!destination.Is_Valid() && labels[label].cost > kIsochroneLimit)) {
+      break;
+    }
+    settled[label] = true;
+    const auto node_id = labels[label].node;
+    const auto cost = labels[label].cost;
+    auto tile = reader.GetGraphTile(node_id);
+    const auto* node = tile->node(node_id);
+    for (uint32_t i = 0; i < node->transition_count(); ++i) {
+      relax(tile->transition(node->transition_index() + i)->endnode(), cost);
+    }
+    for (uint32_t i = 0; i < node->edge_count(); ++i) {
+      const auto* edge = tile->directededge(node->edge_index() + i);
+      if (edge->is_shortcut() || !(edge->forwardaccess() & kAutoAccess)) {
+        continue;
+      }
+      relax(edge->endnode(), cost + edge->length() * 3.6f / std::max<uint32_t>(edge->speed(), 1));
+    }
+  }
+  trace.labels = labels.size();
+  return trace;
+}
+
+enum class trace_kind_t { route, isochrone };
+
+// Routes between and expansions from random nodes of the local level, the same ones every run
+const std::vector<trace_t>& traces(trace_kind_t kind) {
+  static const auto all = []() {
+    midgard::logging::Configure({{"type", ""}});
+    boost::property_tree::ptree config;
+    config.put("tile_dir", VALHALLA_SOURCE_DIR "test/data/utrecht_tiles");
+    GraphReader reader(config);
+    std::vector<GraphId> nodes;
+    for (const auto& tile_id : reader.GetTileSet(2)) {
+      auto tile = reader.GetGraphTile(tile_id);
+      for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+        nodes.emplace_back(tile_id.tileid(), tile_id.level(), i);
+      }
+    }
+    if (nodes.empty()) {
+      throw std::runtime_error("No tiles found, are the utrecht tiles built?");
+    }
+    std::mt19937 generator(3);
+    std::uniform_int_distribution<size_t> pick(0, nodes.size() - 1);
+    std::vector<std::vector<trace_t>> all(2);
+    for (int i = 0; i < 20; ++i) {
+      all[0].push_back(record(reader, nodes[pick(generator)], nodes[pick(generator)]));
+    }
+    for (int i = 0; i < 5; ++i) {
+      all[1].push_back(record(reader, nodes[pick(generator)], {}));
+    }
+    return all;
+  }();
+  return all[static_cast<int>(kind)];
+}
+
+struct replay_label_t {
+  float sortcost_;
+  float sortcost() const {
+    return sortcost_;
+  }
+};
+
+/**
+ * A binary heap with four children per node and the position of every label so that decreasing
+ * its cost sifts it up in place.
+ */
+template <typename label_t> class FourAryHeap {
+public:
+  FourAryHeap(const float, const float, const uint32_t, const std::vector<label_t>& labels)
+      : labels_(labels) {
+  }
+
+  void add(const uint32_t label) {
+    push(label, labels_[label].sortcost());
+  }
+
+  void decrease(const uint32_t label, const float cost) {
+    if (label >= positions_.size() || positions_[label] == kNone) {
+      push(label, cost);
+      return;
+    }
+    heap_[positions_[label]].cost = cost;
+    sift_up(positions_[label]);
+  }
+
+  uint32_t pop() {
+    if (heap_.empty()) {
+      return kInvalidLabel;
+    }
+    auto top = heap_.front().label;
+    positions_[top] = kNone;
+    auto last = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty()) {
+      set(0, last);
+      sift_down(0);
+    }
+    return top;
+  }
+
+private:
+  struct entry_t {
+    float cost;
+    uint32_t label;
+  };
+
+  void push(const uint32_t label, const float cost) {
+    if (label >= positions_.size()) {
+      positions_.resize(label + 1, kNone);
+    }
+    heap_.push_back({cost, label});
+    positions_[label] = heap_.size() - 1;
+    sift_up(heap_.size() - 1);
+  }
+
+  void set(const size_t i, const entry_t& entry) {
+    heap_[i] = entry;
+    positions_[entry.label] = i;
+  }
+
+  void sift_up(size_t i) {
+    auto entry = heap_[i];
+    while (i > 0 && heap_[(i - 1) / 4].cost > entry.cost) {
+      set(i, heap_[(i - 1) / 4]);
+      i = (i - 1) / 4;
+    }
+    set(i, entry);
+  }
+
+  void sift_down(size_t i) {
+    auto entry = heap_[i];
+    while (4 * i + 1 < heap_.size()) {
+      size_t best = 4 * i + 1;
+      for (size_t child = best + 1; child < std::min(4 * i + 5, heap_.size()); ++child) {
+        if (heap_[child].cost < heap_[best].cost) {
+          best = child;
+        }
+      }
+      if (heap_[best].cost >= entry.cost) {
+        break;
+      }
+      set(i, heap_[best]);
+      i = best;
+    }
+    set(i, entry);
+  }
+
+  const std::vector<label_t>& labels_;
+  std::vector<entry_t> heap_;
+  std::vector<uint32_t> positions_;
+};
+
+/**
+ * A pairing heap with one node per label, decreasing a cost cuts the label's subtree off and
+ * melds it with the root. Popping merges the children of the root in two passes.
+ */
+template <typename label_t> class PairingHeap {
+public:
+  PairingHeap(const float, const float, const uint32_t, const std::vector<label_t>& labels)
+      : labels_(labels), root_(kNone) {
+  }
+
+  void add(const uint32_t label) {
+    push(label, labels_[label].sortcost());
+  }
+
+  void decrease(const uint32_t label, const float cost) {
+    if (label >= nodes_.size() || !nodes_[label].queued) {
+      push(label, cost);
+      return;
+    }
+    auto& node = nodes_[label];
+    node.cost = cost;
+    if (label == root_) {
+      return;
+    }
+    // the previous node is the parent of a leftmost child and the left sibling otherwise
+    if (nodes_[node.previous].child == label) {
+      nodes_[node.previous].child = node.sibling;
+    } else {
+      nodes_[node.previous].sibling = node.sibling;
+    }
+    if (node.sibling != kNone) {
+      nodes_[node.sibling].previous = node.previous;
+    }
+    node.sibling = node.previous = kNone;
+    root_ = meld(root_, label);
+  }
+
+  uint32_t pop() {
+    if (root_ == kNone) {
+      return kInvalidLabel;
+    }
+    auto top = root_;
+    nodes_[top].queued = false;
+    root_ = merge_pairs(nodes_[top].child);
+    return top;
+  }
+
+private:
+  struct node_t {
+    float cost;
+    uint32_t child;
+    uint32_t sibling;
+    uint32_t previous;
+    bool queued;
+  };
+
+  void push(const uint32_t label, const float cost) {
+    if (label >= nodes_.size()) {
+      nodes_.resize(label + 1);
+    }
+    nodes_[label] = {cost, kNone, kNone, kNone, true};
+    root_ = meld(root_, label);
+  }
+
+  // melds two detached trees, the one with the higher cost becomes the leftmost child
+  uint32_t meld(uint32_t a, uint32_t b) {
+    if (a == kNone || b == kNone) {
+      return a == kNone ? b : a;
+    }
+    if (nodes_[b].cost < nodes_[a].cost) {
+      std::swap(a, b);
+    }
+    nodes_[b].previous = a;
+    nodes_[b].sibling = nodes_[a].child;
+    if (nodes_[a].child != kNone) {
+      nodes_[nodes_[a].child].previous = b;
+    }
+    nodes_[a].child = b;
+    return a;
+  }
+
+  uint32_t detach(const uint32_t label) {
+    nodes_[label].sibling = nodes_[label].previous = kNone;
+    return label;
+  }
+
+  uint32_t merge_pairs(uint32_t first) {
+    pairs_.clear();
+    while (first != kNone) {
+      auto second = nodes_[first].sibling;
+      auto next = second == kNone ? kNone : nodes_[second].sibling;
+      detach(first);
+      pairs_.push_back(second == kNone ? first : meld(first, detach(second)));
+      first = next;
+    }
+    uint32_t root = kNone;
+    for (auto pair = pairs_.rbegin(); pair != pairs_.rend(); ++pair) {
+      root = meld(*pair, root);
+    }
+    return root;
+  }
+
+  const std::vector<label_t>& labels_;
+  std::vector<node_t> nodes_;
+  std::vector<uint32_t> pairs_;
+  uint32_t root_;
+};
+
+/**
+ * A radix heap on the bits of the costs, which order like unsigned integers as long as they are
+ * not negative. It needs the popped costs to only ever increase, costs below the last one popped
+ * are raised to it as the double bucket queue puts them in the current bucket. Decreasing a cost
+ * adds the label again and the stale entry is skipped when it comes out.
+ */
+template <typename label_t> class RadixHeap {
+public:
+  RadixHeap(const float, const float, const uint32_t, const std::vector<label_t>& labels)
+      : labels_(labels), buckets_(33), last_(0) {
+  }
+
+  void add(const uint32_t label) {
+    push(label, labels_[label].sortcost());
+  }
+
+  void decrease(const uint32_t label, const float cost) {
+    push(label, cost);
+  }
+
+  uint32_t pop() {
+    while (true) {
+      if (buckets_[0].empty() && !refill()) {
+        return kInvalidLabel;
+      }
+      auto entry = buckets_[0].back();
+      buckets_[0].pop_back();
+      if (keys_[entry.label] == entry.key) {
+        keys_[entry.label] = kNone;
+        return entry.label;
+      }
+    }
+  }
+
+private:
+  struct entry_t {
+    uint32_t key;
+    uint32_t label;
+  };
+
+  size_t bucket(const uint32_t key) const {
+    return key == last_ ? 0 : 32 - __builtin_clz(key ^ last_);
+  }
+
+  void push(const uint32_t label, const float cost) {
+    uint32_t key;
+    std::memcpy(&key, &cost, sizeof(key));
+    key = std::max(key, last_);
+    if (label >= keys_.size()) {
+      keys_.resize(label + 1, kNone);
+    }
+    keys_[label] = key;
+    buckets_[bucket(key)].push_back({key, label});
+  }
+
+  // spreads the lowest non empty bucket over the ones below it around its smallest key
+  bool refill() {
+    auto next = std::find_if(buckets_.begin() + 1, buckets_.end(),
+                             [](const std::vector<entry_t>& b) { return !b.empty(); });
+    if (next == buckets_.end()) {
+      return false;
+    }
+    last_ = std::min_element(next->begin(), next->end(), [](const entry_t& a, const entry_t& b) {
+              return a.key < b.key;
+            })->key;
+    for (const auto& entry : *next) {
+      buckets_[bucket(entry.key)].push_back(entry);
+    }
+    next->clear();
+    return true;
+  }
+
+  const std::vector<label_t>& labels_;
+  std::vector<std::vector<entry_t>> buckets_;
+  std::vector<uint32_t> keys_;
+  uint32_t last_;
+};
+
+/**
+ * Hardware cache misses of this thread while it is running, where perf events are available.
+ */
+class CacheMisses {
+public:
+  CacheMisses() : fd_(-1) {
+#ifdef __linux__
+    perf_event_attr attr{};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd_ != -1) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  ~CacheMisses() {
+#ifdef __linux__
+    if (fd_ != -1) {
+      close(fd_);
+    }
+#endif
+  }
+
+  bool available() const {
+    return fd_ != -1;
+  }
+
+  uint64_t count() const {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (fd_ != -1 && read(fd_, &count, sizeof(count)) != sizeof(count)) {
+      count = 0;
+    }
+#endif
+    return count;
+  }
+
+private:
+  int fd_;
+};
+
+/**
+ * Replays the traces of the kind against a queue. The traces are what the double bucket queue
+ * did, which pops labels of the same bucket in any order. The exact queues may pop a label the
+ * trace decreases later, they add it again so every queue sees the same number of operations.
+ */
+template <typename queue_t> void replay(benchmark::State& state, trace_kind_t kind) {
+  const auto& all = traces(kind);
+  size_t ops = 0;
+  for (const auto& trace : all) {
+    ops += trace.ops.size();
+  }
+
+  CacheMisses misses;
+  const auto misses_before = misses.count();
+  for (auto _ : state) {
+    for (const auto& trace : all) {
+      std::vector<replay_label_t> labels(trace.labels);
+      queue_t queue(trace.mincost, kBucketRange, kBucketSize, labels);
+      for (const auto& op : trace.ops) {
+        switch (op.kind) {
+          case trace_t::op_t::add:
+            labels[op.label].sortcost_ = op.cost;
+            queue.add(op.label);
+            break;
+          case trace_t::op_t::decrease:
+            queue.decrease(op.label, op.cost);
+            labels[op.label].sortcost_ = op.cost;
+            break;
+          case trace_t::op_t::pop:
+            benchmark::DoNotOptimize(queue.pop());
+            break;
+        }
+      }
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * ops);
+  state.counters["Ops"] = ops;
+  if (misses.available()) {
+    state.counters["CacheMissesPerOp"] =
+        static_cast<double>(misses.count() - misses_before) / (state.iterations() * ops);
+  }
+}
+
+template <typename queue_t> void BM_Route(benchmark::State& state) {
+  replay<queue_t>(state, trace_kind_t::route);
+}
+
+template <typename queue_t> void BM_Isochrone(benchmark::State& state) {
+  replay<queue_t>(state, trace_kind_t::isochrone);
+}
+
+using Indexed = DoubleBucketQueue<replay_label_t>;
+using Unindexed = DoubleBucketQueue<replay_label_t, false>;
+using FourAry = FourAryHeap<replay_label_t>;
+using Pairing = PairingHeap<replay_label_t>;
+using Radix = RadixHeap<replay_label_t>;
+
+BENCHMARK_TEMPLATE(BM_Route, Indexed)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Route, Unindexed)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Route, FourAry)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Route, Pairing)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Route, Radix)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Isochrone, Indexed)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Isochrone, Unindexed)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Isochrone, FourAry)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Isochrone, Pairing)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Isochrone, Radix)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+// How many lookups every thread makes per iteration
+constexpr size_t kLookups = 1 << 14;
+// Every how many lookups one is timed for the latency percentiles
+constexpr size_t kTimedEvery = 16;
+
+// A real tile from the utrecht tiles stands in for every tile, the caches never look inside them
+// except for the compressed one which deflates what it evicts
+graph_tile_ptr sample_tile() {
+  static const graph_tile_ptr tile = []() {
+    boost::property_tree::ptree pt;
+    pt.put("tile_dir", VALHALLA_SOURCE_DIR "test/data/utrecht_tiles");
+    GraphReader reader(pt);
+    graph_tile_ptr largest;
+    for (const auto& tile_id : reader.GetTileSet()) {
+      auto tile = reader.GetGraphTile(tile_id);
+      if (!largest || tile->header()->end_offset() > largest->header()->end_offset()) {
+        largest = tile;
+      }
+    }
+    if (!largest) {
+      throw std::runtime_error("No tiles found, are the utrecht tiles built?");
+    }
+    return largest;
+  }();
+  return tile;
+}
+
+size_t tile_size() {
+  return sample_tile()->header()->end_offset();
+}
+
+/**
+ * Local tiles around a city as requests see them. A request starts at a tile picked with a heavy
+ * skew towards the middle of the working set, where most of the traffic is, and then walks to
+ * neighbouring tiles as the expansion of a route or a matrix does.
+ */
+std::vector<GraphId> access_trace(size_t working_set, size_t length, uint32_t seed) {
+  const auto& tiles = TileHierarchy::levels()[2].tiles;
+  const int32_t columns = tiles.ncolumns();
+  const int32_t side = std::max<int32_t>(std::ceil(std::sqrt(working_set)), 1);
+  const int32_t first_row = tiles.nrows() / 2 - side / 2;
+  const int32_t first_column = columns / 2 - side / 2;
+
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::uniform_int_distribution<int> step(0, 3);
+  std::vector<GraphId> trace;
+  trace.reserve(length);
+  while (trace.size() < length) {
+    // the cube of a uniform number puts most starts near the middle
+    auto offset = [&]() {
+      auto skewed = std::pow(uniform(generator), 3) * (uniform(generator) < .5 ? -1 : 1);
+      return static_cast<int32_t>(side / 2 + skewed * side / 2);
+    };
+    int32_t row = offset(), column = offset();
+    for (int i = 0; i < 16 && trace.size() < length; ++i) {
+      switch (step(generator)) {
+        case 0:
+          row = std::min(row + 1, side - 1);
+          break;
+        case 1:
+          row = std::max(row - 1, 0);
+          break;
+        case 2:
+          column = std::min(column + 1, side - 1);
+          break;
+        default:
+          column = std::max(column - 1, 0);
+          break;
+      }
+      trace.emplace_back((first_row + row) * columns + first_column + column, 2, 0);
+    }
+  }
+  return trace;
+}
+
+enum class cache_t { simple, flat, lru, tiny_lfu, lru_compressed, synchronized_lru, sharded };
+
+std::unique_ptr<TileCache> make_cache(cache_t type, size_t max_size) {
+  static std::mutex mutex;
+  static std::unique_ptr<TileCacheLRU> shared;
+  switch (type) {
+    case cache_t::simple:
+      return std::make_unique<SimpleTileCache>(max_size);
+    case cache_t::flat:
+      return std::make_unique<FlatTileCache>(max_size);
+    case cache_t::lru:
+      return std::make_unique<TileCacheLRU>(max_size, TileCacheLRU::MemoryLimitControl::HARD);
+    case cache_t::tiny_lfu:
+      return std::make_unique<TileCacheTinyLFU>(max_size, TileCacheLRU::MemoryLimitControl::HARD);
+    case cache_t::lru_compressed:
+      return std::make_unique<TileCacheLRUCompressed>(max_size, max_size,
+                                                      TileCacheLRU::MemoryLimitControl::HARD);
+    case cache_t::synchronized_lru:
+      // the global cache of the graph readers is a static lru behind a static mutex
+      shared.reset(new TileCacheLRU(max_size, TileCacheLRU::MemoryLimitControl::HARD));
+      return std::make_unique<SynchronizedTileCache>(*shared, mutex);
+    case cache_t::sharded:
+      return std::make_unique<ShardedTileCache>(max_size, 16);
+  }
+  return nullptr;
+}
+
+struct counts_t {
+  size_t hits = 0;
+  size_t misses = 0;
+  std::vector<double> latencies;
+};
+
+// What the graph reader does for a tile, either it is cached or it gets put in and the cache is
+// trimmed should that have overcommitted it
+void lookups(TileCache& cache, const std::vector<GraphId>& trace, size_t start, counts_t& counts) {
+  const auto tile = sample_tile();
+  const auto size = tile_size();
+  for (size_t i = 0; i < kLookups; ++i) {
+    const auto& id = trace[(start + i) % trace.size()];
+    const bool timed = i % kTimedEvery == 0;
+    auto begin = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+    if (cache.Get(id)) {
+      ++counts.hits;
+    } else {
+      ++counts.misses;
+      cache.Put(id, tile, size);
+      if (cache.OverCommitted()) {
+        cache.Trim();
+      }
+    }
+    if (timed) {
+      counts.latencies.push_back(
+          std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin)
+              .count());
+    }
+  }
+}
+
+/**
+ * Lookups by a number of threads on one cache, only the thread safe caches can have more than
+ * one. The cache holds range(0) tiles, the trace goes over range(1) distinct tiles and range(2)
+ * threads work on it at once each starting at a different place in the trace.
+ */
+void BM_TileCache(benchmark::State& state, cache_t type) {
+  const size_t threads = state.range(2);
+  auto cache = make_cache(type, state.range(0) * tile_size());
+  cache->Reserve(tile_size());
+  const auto trace = access_trace(state.range(1), 1 << 16, 7);
+
+  std::vector<counts_t> counts(threads);
+  for (auto _ : state) {
+    std::vector<std::thread> workers;
+    for (size_t thread = 1; thread < threads; ++thread) {
+      workers.emplace_back(lookups, std::ref(*cache), std::cref(trace),
+                           thread * trace.size() / threads, std::ref(counts[thread]));
+    }
+    lookups(*cache, trace, 0, counts[0]);
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  counts_t total;
+  for (auto& thread_counts : counts) {
+    total.hits += thread_counts.hits;
+    total.misses += thread_counts.misses;
+    total.latencies.insert(total.latencies.end(), thread_counts.latencies.begin(),
+                           thread_counts.latencies.end());
+  }
+  std::sort(total.latencies.begin(), total.latencies.end());
+  auto percentile = [&total](double p) {
+    return total.latencies.empty()
+               ? 0.
+               : total.latencies[std::min(total.latencies.size() - 1,
+                                          static_cast<size_t>(p * total.latencies.size()))];
+  };
+  state.SetItemsProcessed(state.iterations() * kLookups * threads);
+  state.counters["HitRate"] = benchmark::Counter(
+      static_cast<double>(total.hits) / std::max<size_t>(total.hits + total.misses, 1));
+  state.counters["p50_us"] = benchmark::Counter(percentile(.5));
+  state.counters["p99_us"] = benchmark::Counter(percentile(.99));
+  state.counters["p999_us"] = benchmark::Counter(percentile(.999));
+}
+
+// Cache sizes in tiles against working sets which fit, which fit half and which only fit a tenth
+void SingleThreaded(benchmark::internal::Benchmark* b) {
+  for (int64_t cache_tiles : {64, 1024}) {
+    for (int64_t working_set : {cache_tiles / 2, cache_tiles * 2, cache_tiles * 10}) {
+      b->Args({cache_tiles, working_set, 1});
+    }
+  }
+  b->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+void Contended(benchmark::internal::Benchmark* b) {
+  for (int64_t threads : {1, 2, 4, 8, 16, 32, 64}) {
+    b->Args({1024, 2048, threads});
+  }
+  b->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+BENCHMARK_CAPTURE(BM_TileCache, Simple, cache_t::simple)->Apply(SingleThreaded);
+BENCHMARK_CAPTURE(BM_TileCache, Flat, cache_t::flat)->Apply(SingleThreaded);
+BENCHMARK_CAPTURE(BM_TileCache, LRU, cache_t::lru)->Apply(SingleThreaded);
+BENCHMARK_CAPTURE(BM_TileCache, TinyLFU, cache_t::tiny_lfu)->Apply(SingleThreaded);
+BENCHMARK_CAPTURE(BM_TileCache, LRUCompressed, cache_t::lru_compressed)->Apply(SingleThreaded);
+BENCHMARK_CAPTURE(BM_TileCache, SynchronizedLRU, cache_t::synchronized_lru)->Apply(Contended);
+BENCHMARK_CAPTURE(BM_TileCache, Sharded, cache_t::sharded)->Apply(Contended);
+
+} // namespace
+
+BENCHMARK_MAIN();
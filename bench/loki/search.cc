@@ -0,0 +1,64 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/location.h"
+#include "baldr/rapidjson_utils.h"
+#include "loki/search.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla;
+
+namespace {
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+// Random locations in the bounding box of the utrecht tiles, the same ones every run
+std::vector<baldr::Location> utrecht_locations(size_t count) {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<> lng(5.0163, 5.1622);
+  std::uniform_real_distribution<> lat(52.0469999, 52.1411);
+  std::vector<baldr::Location> locations;
+  locations.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    locations.emplace_back(midgard::PointLL{lng(gen), lat(gen)});
+  }
+  return locations;
+}
+
+// Correlating range(0) locations at once, as a route, a matrix or a trace would
+void BM_UtrechtSearch(benchmark::State& state) {
+  midgard::logging::Configure({{"type", ""}});
+  boost::property_tree::ptree config;
+  rapidjson::read_json(VALHALLA_SOURCE_DIR "bench/meili/config.json", config);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+
+  Options options;
+  const rapidjson::Document doc;
+  sif::ParseCostingOptions(doc, "/costing_options", options);
+  options.set_costing(Costing::auto_);
+  auto costing = sif::CostFactory{}.Create(options);
+
+  const auto locations = utrecht_locations(state.range(0));
+  size_t found = 0;
+  for (auto _ : state) {
+    auto results = loki::Search(locations, reader, costing);
+    found = results.size();
+    benchmark::DoNotOptimize(results);
+  }
+  state.counters["Locations"] = benchmark::Counter(static_cast<double>(locations.size()),
+                                                   benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["Found"] = benchmark::Counter(static_cast<double>(found));
+}
+
+BENCHMARK(BM_UtrechtSearch)->Arg(1)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <iterator>
 #include <sstream>
 
 #include <benchmark/benchmark.h>
@@ -7,6 +8,8 @@
 #include "baldr/rapidjson_utils.h"
 #include "meili/map_matcher_factory.h"
 #include "meili/measurement.h"
+#include "meili/topk_search.h"
+#include "meili/viterbi_search.h"
 #include "sif/costconstants.h"
 #include "sif/costfactory.h"
 #include "tyr/actor.h"
@@ -117,6 +120,70 @@ static void BM_ManyCases(benchmark::State& state) {
 
 BENCHMARK(BM_ManyCases)->DenseRange(0, kBenchmarkCases.size() - 1);
 
+// The k best paths through a synthetic trellis, by removing the best path and searching again
+// versus keeping the k best labels of every state in one search. The costs are cheap here, in
+// matching every transition is a route, so how many of them are computed is counted as well.
+
+constexpr StateId::Time kTrellisColumns = 100;
+constexpr StateId::Id kTrellisStates = 8;
+
+float TrellisCost(uint32_t a, uint32_t b, uint32_t c) {
+  // some arbitrary but repeatable cost in [1, 100]
+  uint32_t hash = a * 73856093u ^ b * 19349663u ^ c * 83492791u;
+  hash ^= hash >> 13;
+  return 1.f + (hash * 2654435761u >> 16) % 100;
+}
+
+template <typename search_t> void AddTrellis(search_t& vs, size_t& transitions) {
+  vs.set_emission_cost_model(
+      [](const StateId& stateid) { return TrellisCost(stateid.time(), stateid.id(), 0); });
+  vs.set_transition_cost_model([&transitions](const StateId& lhs, const StateId& rhs) {
+    ++transitions;
+    return TrellisCost(lhs.time(), lhs.id(), rhs.id() + 1);
+  });
+  for (StateId::Time time = 0; time < kTrellisColumns; ++time) {
+    for (StateId::Id id = 0; id < kTrellisStates; ++id) {
+      vs.AddStateId(StateId(time, id));
+    }
+  }
+}
+
+static void BM_TopKSearch(benchmark::State& state) {
+  const auto k = state.range(0);
+  size_t transitions = 0;
+  for (auto _ : state) {
+    ViterbiSearch vs;
+    TopKSearch ts(vs);
+    AddTrellis(vs, transitions);
+    std::vector<StateId> path;
+    for (int64_t i = 0; i < k; ++i) {
+      path.clear();
+      std::copy(vs.SearchPathVS(kTrellisColumns - 1), vs.PathEnd(), std::back_inserter(path));
+      benchmark::DoNotOptimize(path);
+      ts.RemovePath(path);
+      vs.ClearSearch();
+    }
+  }
+  state.counters["transitions"] =
+      benchmark::Counter(transitions, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_TopKSearch)->Arg(1)->Arg(3)->Arg(5);
+
+static void BM_ListViterbiSearch(benchmark::State& state) {
+  const auto k = state.range(0);
+  size_t transitions = 0;
+  for (auto _ : state) {
+    ListViterbiSearch vs(k);
+    AddTrellis(vs, transitions);
+    benchmark::DoNotOptimize(vs.SearchPaths(kTrellisColumns - 1));
+  }
+  state.counters["transitions"] =
+      benchmark::Counter(transitions, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_ListViterbiSearch)->Arg(1)->Arg(3)->Arg(5);
+
 } // namespace
 
 BENCHMARK_MAIN();
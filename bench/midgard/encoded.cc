@@ -0,0 +1,138 @@
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphreader.h"
+#include "midgard/encoded.h"
+#include "midgard/pointll.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+// The encoded shapes of every edge in the utrecht tiles, which is what shape decoding
+// actually sees in production: lots of short shapes made of small deltas
+const std::vector<std::string>& tile_shapes() {
+  static const std::vector<std::string> shapes = []() {
+    boost::property_tree::ptree pt;
+    pt.put("tile_dir", VALHALLA_SOURCE_DIR "test/data/utrecht_tiles");
+    GraphReader reader(pt);
+    std::vector<std::string> encoded;
+    for (const auto& tile_id : reader.GetTileSet()) {
+      auto tile = reader.GetGraphTile(tile_id);
+      for (const auto& edge : tile->GetDirectedEdges()) {
+        if (edge.forward()) {
+          encoded.emplace_back(tile->edgeinfo(edge.edgeinfo_offset()).encoded_shape());
+        }
+      }
+    }
+    if (encoded.empty()) {
+      throw std::runtime_error("No edge shapes found, are the utrecht tiles built?");
+    }
+    return encoded;
+  }();
+  return shapes;
+}
+
+size_t total_bytes(const std::vector<std::string>& shapes) {
+  size_t bytes = 0;
+  for (const auto& shape : shapes) {
+    bytes += shape.size();
+  }
+  return bytes;
+}
+
+// Decoding into a vector as EdgeInfo::shape() does
+void BM_Decode7Vector(benchmark::State& state) {
+  const auto& shapes = tile_shapes();
+  for (auto _ : state) {
+    for (const auto& shape : shapes) {
+      auto points = decode7<std::vector<PointLL>>(shape.data(), shape.size());
+      benchmark::DoNotOptimize(points.data());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * total_bytes(shapes));
+}
+
+BENCHMARK(BM_Decode7Vector);
+
+// Decoding one point at a time as EdgeInfo::lazy_shape() and VisitShape do
+void BM_Decode7Lazy(benchmark::State& state) {
+  const auto& shapes = tile_shapes();
+  for (auto _ : state) {
+    for (const auto& shape : shapes) {
+      Shape7Decoder<PointLL> decoder(shape.data(), shape.size());
+      while (!decoder.empty()) {
+        auto point = decoder.pop();
+        benchmark::DoNotOptimize(point);
+      }
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * total_bytes(shapes));
+}
+
+BENCHMARK(BM_Decode7Lazy);
+
+// The same shapes as 6 digit polylines which is what the public decode<> helper sees
+void BM_DecodePolyline(benchmark::State& state) {
+  std::vector<std::string> polylines;
+  for (const auto& shape : tile_shapes()) {
+    polylines.emplace_back(encode(decode7<std::vector<PointLL>>(shape)));
+  }
+  for (auto _ : state) {
+    for (const auto& polyline : polylines) {
+      auto points = decode<std::vector<PointLL>>(polyline);
+      benchmark::DoNotOptimize(points.data());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * total_bytes(polylines));
+}
+
+BENCHMARK(BM_DecodePolyline);
+
+// Encoding the decoded shapes again, as the serializers do for every leg they return
+void BM_EncodePolyline(benchmark::State& state) {
+  std::vector<std::vector<PointLL>> shapes;
+  size_t bytes = 0;
+  for (const auto& shape : tile_shapes()) {
+    shapes.emplace_back(decode7<std::vector<PointLL>>(shape));
+    bytes += encode(shapes.back()).size();
+  }
+  for (auto _ : state) {
+    for (const auto& shape : shapes) {
+      auto encoded = encode(shape);
+      benchmark::DoNotOptimize(encoded.data());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+BENCHMARK(BM_EncodePolyline);
+
+// And as varints which is what the tile builders do
+void BM_Encode7(benchmark::State& state) {
+  std::vector<std::vector<PointLL>> shapes;
+  for (const auto& shape : tile_shapes()) {
+    shapes.emplace_back(decode7<std::vector<PointLL>>(shape));
+  }
+  for (auto _ : state) {
+    for (const auto& shape : shapes) {
+      auto encoded = encode7(shape);
+      benchmark::DoNotOptimize(encoded.data());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * total_bytes(tile_shapes()));
+}
+
+BENCHMARK(BM_Encode7);
+
+} // namespace
+
+BENCHMARK_MAIN();
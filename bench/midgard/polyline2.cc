@@ -0,0 +1,52 @@
+#include <list>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "midgard/pointll.h"
+#include "midgard/polyline2.h"
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// A long wiggly shape like that of a cross country route or an isochrone contour
+std::vector<PointLL> wiggly_shape(size_t size) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> wiggle(-0.0005f, 0.0005f);
+  std::vector<PointLL> shape;
+  shape.reserve(size);
+  PointLL point(5.1f, 52.1f);
+  for (size_t i = 0; i < size; ++i) {
+    point.first += 0.0001f + wiggle(generator);
+    point.second += wiggle(generator);
+    shape.push_back(point);
+  }
+  return shape;
+}
+
+template <typename container_t> void BM_Generalize(benchmark::State& state) {
+  const auto shape = wiggly_shape(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    container_t points(shape.begin(), shape.end());
+    state.ResumeTiming();
+    Polyline2<PointLL>::Generalize(points, state.range(1));
+    benchmark::DoNotOptimize(points.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_Generalize, std::vector<PointLL>)
+    ->Args({1000, 10})
+    ->Args({100000, 10})
+    ->Args({100000, 100});
+BENCHMARK_TEMPLATE(BM_Generalize, std::list<PointLL>)
+    ->Args({1000, 10})
+    ->Args({100000, 10})
+    ->Args({100000, 100});
+
+} // namespace
+
+BENCHMARK_MAIN();
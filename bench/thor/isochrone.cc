@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include <string>
+
+#include "loki/worker.h"
+#include "test.h"
+#include "thor/worker.h"
+
+using namespace valhalla;
+
+namespace {
+
+const auto config = test::json_to_pt(R"({
+    "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1},
+    "loki":{
+      "actions":["isochrone"],
+      "logging":{"long_request": 100},
+      "service_defaults":{"minimum_reachability": 50,"radius": 0,"search_cutoff": 35000, "node_snap_tolerance": 5, "street_side_tolerance": 5, "street_side_max_distance": 1000, "heading_tolerance": 60}
+    },
+    "thor":{
+      "logging":{"long_request": 100}
+    },
+    "meili":{
+      "grid": {"cache_size": 100240,"size": 500},
+      "default": {"breakage_distance": 2000}
+    },
+    "service_limits": {
+      "auto": {"max_distance": 5000000.0, "max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "bicycle": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+      "pedestrian": {"max_distance": 250000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50,"max_transit_walking_distance": 10000,"min_transit_walking_distance": 1},
+      "isochrone": {"max_contours": 4,"max_distance": 25000.0,"max_locations": 2,"max_time_contour": 120, "max_distance_contour":200},
+      "max_avoid_locations": 50,"max_radius": 200,"max_reachability": 100,"max_alternates":2
+    }
+  })");
+
+// Expands from the middle of Utrecht for the given number of minutes, which is mostly the
+// Dijkstras forward expansion relaxing the edges leaving each node it settles
+static void BM_UtrechtIsochrone(benchmark::State& state) {
+  loki::loki_worker_t loki_worker(config);
+  thor::thor_worker_t thor_worker(config);
+  const std::string request =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto","contours":[{"time":)" +
+      std::to_string(state.range(0)) + R"(}],"polygons":true})";
+
+  size_t expansions = 0;
+  for (auto _ : state) {
+    Api api;
+    ParseApi(request, Options::isochrone, api);
+    loki_worker.isochrones(api);
+    benchmark::DoNotOptimize(thor_worker.isochrones(api));
+    loki_worker.cleanup();
+    thor_worker.cleanup();
+    ++expansions;
+  }
+  state.counters["Isochrones"] = benchmark::Counter(expansions, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_UtrechtIsochrone)->Unit(benchmark::kMillisecond)->Arg(5)->Arg(15)->Arg(30);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "mjolnir/util.h"
+
+using namespace valhalla;
+
+namespace {
+
+// Builds the local level of utrecht once for each node order, the tiles are kept between runs
+boost::property_tree::ptree build_tiles(const bool spatial_node_order) {
+  const std::string tile_dir =
+      std::string("test/data/utrecht_node_order_") + (spatial_node_order ? "spatial" : "osmid");
+  boost::property_tree::ptree config;
+  config.put("mjolnir.tile_dir", tile_dir);
+  config.put("mjolnir.id_table_size", 1000);
+  config.put("mjolnir.concurrency", 1);
+  config.put("mjolnir.hierarchy", false);
+  config.put("mjolnir.shortcuts", false);
+  config.put("mjolnir.logging.type", "");
+  config.put("mjolnir.data_processing.spatial_node_order", spatial_node_order);
+  if (!filesystem::exists(tile_dir + "/2")) {
+    if (!mjolnir::build_tile_set(config,
+                                 {VALHALLA_SOURCE_DIR "test/data/utrecht_netherlands.osm.pbf"},
+                                 mjolnir::BuildStage::kInitialize, mjolnir::BuildStage::kValidate,
+                                 false)) {
+      throw std::runtime_error("Could not build the utrecht tiles in " + tile_dir);
+    }
+  }
+  return config;
+}
+
+// Expands breadth first from every node of every tile of the local level without leaving the tile,
+// which is how a search touches the nodes and edges of a tile. The stride counter is how far
+// apart in memory successive nodes of the expansion are, on average
+static void BM_UtrechtTileExpansion(benchmark::State& state) {
+  const auto config = build_tiles(state.range(0));
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  const auto tile_ids = reader.GetTileSet(baldr::TileHierarchy::levels().back().level);
+  std::vector<graph_tile_ptr> tiles;
+  for (const auto& tile_id : tile_ids) {
+    tiles.push_back(reader.GetGraphTile(tile_id));
+  }
+
+  uint64_t visits = 0, stride = 0;
+  std::vector<bool> seen;
+  std::deque<uint32_t> queue;
+  for (auto _ : state) {
+    for (const auto& tile : tiles) {
+      const auto node_count = tile->header()->nodecount();
+      // only a few hundred starts per tile to keep the runs short
+      for (uint32_t start = 0; start < node_count; start += std::max(node_count / 256, 1u)) {
+        seen.assign(node_count, false);
+        queue.assign(1, start);
+        seen[start] = true;
+        uint32_t last = start;
+        // a bounded expansion, as a search would do around each of its locations
+        for (size_t expanded = 0; !queue.empty() && expanded < 512; ++expanded) {
+          const auto index = queue.front();
+          queue.pop_front();
+          stride += std::abs(static_cast<int64_t>(index) - last) * sizeof(baldr::NodeInfo);
+          last = index;
+          ++visits;
+          const auto* node = tile->node(index);
+          const auto* edge = tile->directededge(node->edge_index());
+          for (uint32_t i = 0; i < node->edge_count(); ++i, ++edge) {
+            const auto end_node = edge->endnode();
+            if (end_node.tile_value() == tile->id().tile_value() && !seen[end_node.id()]) {
+              seen[end_node.id()] = true;
+              queue.push_back(end_node.id());
+            }
+          }
+        }
+      }
+    }
+  }
+  benchmark::DoNotOptimize(stride);
+  state.counters["Nodes"] = benchmark::Counter(visits, benchmark::Counter::kIsRate);
+  state.counters["Stride"] = benchmark::Counter(visits ? double(stride) / visits : 0.);
+}
+
+} // namespace
+
+// 0 is the nodes by osm id, 1 along a Hilbert curve
+BENCHMARK(BM_UtrechtTileExpansion)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
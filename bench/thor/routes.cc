@@ -17,8 +17,8 @@ using namespace valhalla;
 
 namespace {
 
-void create_costing_options(Options& options) {
-  options.set_costing(Costing::auto_);
+void create_costing_options(Options& options, const Costing costing = Costing::auto_) {
+  options.set_costing(costing);
   rapidjson::Document doc;
   sif::ParseCostingOptions(doc, "/costing_options", options);
 }
@@ -211,6 +211,66 @@ void customize_traffic(const boost::property_tree::ptree& config,
 
 BENCHMARK(BM_UtrechtBidirectionalAstar)->Unit(benchmark::kMillisecond);
 
+/** Benchmarks bidirectional A* between every pair of a few locations with each costing */
+template <Costing costing>
+static void BM_UtrechtCostingBidirectionalAstar(benchmark::State& state) {
+  const auto config = build_config("costing-routes.tar");
+  test::build_live_traffic_data(config);
+  auto clean_reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+
+  Options options;
+  create_costing_options(options, costing);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  std::vector<valhalla::baldr::Location> locations;
+  locations.emplace_back(midgard::PointLL{5.117328, 52.099464});
+  locations.emplace_back(midgard::PointLL{5.114576, 52.101841});
+  locations.emplace_back(midgard::PointLL{5.112481, 52.074073});
+  locations.emplace_back(midgard::PointLL{5.135983, 52.110116});
+  locations.emplace_back(midgard::PointLL{5.095273, 52.108956});
+  const auto projections = loki::Search(locations, *clean_reader, cost);
+  if (projections.size() != locations.size()) {
+    throw std::runtime_error("Not all locations were found");
+  }
+
+  std::vector<valhalla::Location> pbf_locations;
+  for (const auto& location : locations) {
+    pbf_locations.emplace_back();
+    baldr::PathLocation::toPBF(projections.at(location), &pbf_locations.back(), *clean_reader);
+  }
+
+  std::size_t route_size = 0;
+  for (auto _ : state) {
+    thor::BidirectionalAStar astar;
+    for (size_t i = 0; i < pbf_locations.size(); ++i) {
+      for (size_t j = 0; j < pbf_locations.size(); ++j) {
+        if (i == j) {
+          continue;
+        }
+        auto result = astar.GetBestPath(pbf_locations[i], pbf_locations[j], *clean_reader, costs,
+                                        mode);
+        route_size += !result.empty();
+      }
+    }
+  }
+  if (route_size == 0) {
+    throw std::runtime_error("Failed all routes");
+  }
+  state.counters["Routes"] =
+      benchmark::Counter(route_size, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_TEMPLATE(BM_UtrechtCostingBidirectionalAstar, Costing::auto_)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_UtrechtCostingBidirectionalAstar, Costing::truck)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_UtrechtCostingBidirectionalAstar, Costing::pedestrian)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_UtrechtCostingBidirectionalAstar, Costing::bicycle)
+    ->Unit(benchmark::kMillisecond);
+
 /** Benchmarks the GetSpeed function */
 static void BM_GetSpeed(benchmark::State& state) {
 
@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "gurka.h"
+#include "midgard/constants.h"
+#include "test.h"
+#include "tyr/actor.h"
+
+using namespace valhalla;
+
+namespace {
+
+// One character per node, which is as many nodes as a gurka map can have
+const std::string kNodeNames = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+// Builds a grid of residential streets with the given number of nodes on a side and the given
+// distance between them, once for each grid. The further apart the nodes the more tiles a route
+// from one corner to the other goes through
+const gurka::map& build_grid(const uint32_t size, const uint32_t spacing) {
+  static std::map<std::pair<uint32_t, uint32_t>, gurka::map> maps;
+  auto found = maps.find({size, spacing});
+  if (found != maps.end()) {
+    return found->second;
+  }
+
+  gurka::nodelayout layout;
+  gurka::ways ways;
+  const double degrees = spacing / midgard::kMetersPerDegreeLat;
+  for (uint32_t row = 0; row < size; ++row) {
+    for (uint32_t col = 0; col < size; ++col) {
+      const auto node = kNodeNames.substr(row * size + col, 1);
+      layout[node] = {0.1 + col * degrees, 0.1 + row * degrees};
+      if (col > 0) {
+        ways[kNodeNames.substr(row * size + col - 1, 1) + node] = {{"highway", "residential"}};
+      }
+      if (row > 0) {
+        ways[kNodeNames.substr((row - 1) * size + col, 1) + node] = {{"highway", "residential"}};
+      }
+    }
+  }
+  const auto workdir =
+      "test/data/bench_grid_" + std::to_string(size) + "_" + std::to_string(spacing);
+  return maps[{size, spacing}] = gurka::buildtiles(layout, ways, {}, {}, workdir);
+}
+
+// Routes from one corner of a grid to the other through the whole service stack, which is what
+// a request costs once it has been parsed
+static void BM_GridRoute(benchmark::State& state) {
+  const uint32_t size = state.range(0);
+  const auto& map = build_grid(size, state.range(1));
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  tyr::actor_t actor(map.config, *reader, true);
+
+  const auto& origin = map.nodes.at(kNodeNames.substr(0, 1));
+  const auto& destination = map.nodes.at(kNodeNames.substr(size * size - 1, 1));
+  const auto request = R"({"costing":"auto","locations":[{"lon":)" +
+                       std::to_string(origin.lng()) + R"(,"lat":)" + std::to_string(origin.lat()) +
+                       R"(},{"lon":)" + std::to_string(destination.lng()) + R"(,"lat":)" +
+                       std::to_string(destination.lat()) + "}]}";
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(actor.route(request));
+  }
+  state.counters["Routes"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+
+// Grids of 4 and 7 nodes on a side with the nodes from 50m (a city block) to 5km (a rural road
+// network spanning a couple of tiles) apart
+BENCHMARK(BM_GridRoute)
+    ->Unit(benchmark::kMicrosecond)
+    ->ArgsProduct({{4, 7}, {50, 500, 5000}});
+
+} // namespace
+
+BENCHMARK_MAIN();
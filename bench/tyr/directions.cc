@@ -0,0 +1,92 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/rapidjson_utils.h"
+#include "midgard/logging.h"
+#include "odin/directionsbuilder.h"
+#include "tyr/actor.h"
+#include "tyr/serializers.h"
+
+using namespace valhalla;
+
+namespace {
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+// A few hundred meters through the center, across the city and across it with stops on the way
+const std::string kRoutes[] = {
+    R"({"locations":[{"lon":5.117328,"lat":52.099464},{"lon":5.114598,"lat":52.103607}],
+        "costing":"auto"})",
+    R"({"locations":[{"lon":5.110077,"lat":52.062043},{"lon":5.135983,"lat":52.110116}],
+        "costing":"auto"})",
+    R"({"locations":[{"lon":5.110077,"lat":52.062043},{"lon":5.112481,"lat":52.074073},
+        {"lon":5.117328,"lat":52.099464},{"lon":5.095273,"lat":52.108956},
+        {"lon":5.135983,"lat":52.110116}],"costing":"auto"})",
+};
+
+// The request after it was routed and narrated by the actor, range(0) picks the route
+const Api& routed(size_t route) {
+  static const std::vector<Api> requests = []() {
+    midgard::logging::Configure({{"type", ""}});
+    boost::property_tree::ptree config;
+    rapidjson::read_json(VALHALLA_SOURCE_DIR "bench/meili/config.json", config);
+    tyr::actor_t actor(config, true);
+    std::vector<Api> requests;
+    for (const auto& route : kRoutes) {
+      requests.emplace_back();
+      actor.route(route, nullptr, &requests.back());
+    }
+    return requests;
+  }();
+  return requests[route];
+}
+
+void set_maneuvers(benchmark::State& state, const Api& request) {
+  size_t maneuvers = 0;
+  for (const auto& leg : request.directions().routes(0).legs()) {
+    maneuvers += leg.maneuver_size();
+  }
+  state.counters["Maneuvers"] = benchmark::Counter(static_cast<double>(maneuvers),
+                                                   benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Building the maneuvers and the narrative of the trip path
+void BM_DirectionsBuilder(benchmark::State& state) {
+  const auto& request = routed(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    Api api = request;
+    api.clear_directions();
+    state.ResumeTiming();
+    odin::DirectionsBuilder::Build(api);
+    benchmark::DoNotOptimize(api.directions().routes_size());
+  }
+  set_maneuvers(state, request);
+}
+
+// Serializing the directions in the format range(1) asks for
+void BM_SerializeDirections(benchmark::State& state) {
+  Api api = routed(state.range(0));
+  api.mutable_options()->set_format(static_cast<Options::Format>(state.range(1)));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    auto json = tyr::serializeDirections(api);
+    bytes = json.size();
+    benchmark::DoNotOptimize(json);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+  set_maneuvers(state, api);
+}
+
+BENCHMARK(BM_DirectionsBuilder)->DenseRange(0, 2)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SerializeDirections)
+    ->ArgsProduct({{0, 1, 2}, {Options::json, Options::osrm}})
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
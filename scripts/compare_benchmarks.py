@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+Compares the google benchmark results of two builds and flags the benchmarks which got
+significantly slower. The results are the json files written by make run-benchmarks, which go to
+the build directory as benchmark-<name>.json. Run them with repetitions (see
+VALHALLA_BENCHMARK_REPETITIONS) so that there is a spread to test, a benchmark is only flagged if
+its median time went up by more than the threshold and a Mann-Whitney U test says the two builds
+are unlikely to be the same.
+
+Usage: compare_benchmarks.py [--threshold 0.05] [--alpha 0.01] [--json report.json] before after
+Where before and after are either result files or directories with benchmark-*.json files.
+Exits with 1 if anything got slower.
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import sys
+
+# Everything is compared in nanoseconds
+UNITS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+
+
+def load(path):
+  """Gets the times of each repetition of each benchmark in a file or a directory of them"""
+  files = [path]
+  if os.path.isdir(path):
+    files = sorted(glob.glob(os.path.join(path, 'benchmark-*.json')))
+  times = {}
+  for name in files:
+    with open(name) as f:
+      results = json.load(f)
+    program = os.path.splitext(os.path.basename(name))[0]
+    for benchmark in results.get('benchmarks', []):
+      # the mean, median and stddev of the repetitions are left out, we work them out ourselves
+      if benchmark.get('run_type', 'iteration') != 'iteration' or 'error_occurred' in benchmark:
+        continue
+      key = program + '/' + benchmark.get('run_name', benchmark['name'])
+      scale = UNITS.get(benchmark.get('time_unit', 'ns'), 1.0)
+      times.setdefault(key, []).append(benchmark['real_time'] * scale)
+  return times
+
+
+def median(values):
+  values = sorted(values)
+  middle = len(values) // 2
+  return values[middle] if len(values) % 2 else (values[middle - 1] + values[middle]) / 2.0
+
+
+def mann_whitney_u(a, b):
+  """Two sided p value of the two samples coming from the same distribution, using the normal
+  approximation with a correction for ties. None if there are too few samples to say"""
+  if len(a) < 2 or len(b) < 2:
+    return None
+  ranked = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+  ranks = [0.0] * len(ranked)
+  tie_term = 0.0
+  i = 0
+  while i < len(ranked):
+    j = i
+    while j + 1 < len(ranked) and ranked[j + 1][0] == ranked[i][0]:
+      j += 1
+    for k in range(i, j + 1):
+      ranks[k] = (i + j) / 2.0 + 1
+    tied = j - i + 1
+    tie_term += tied ** 3 - tied
+    i = j + 1
+  n1, n2 = len(a), len(b)
+  n = n1 + n2
+  r1 = sum(rank for rank, (_, sample) in zip(ranks, ranked) if sample == 0)
+  u = r1 - n1 * (n1 + 1) / 2.0
+  variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+  if variance <= 0:
+    return 1.0
+  z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(variance)
+  return math.erfc(max(z, 0) / math.sqrt(2))
+
+
+def main():
+  parser = argparse.ArgumentParser(description='Flags benchmarks that got slower between builds')
+  parser.add_argument('before', help='results of the baseline build')
+  parser.add_argument('after', help='results of the build to check')
+  parser.add_argument('--threshold', type=float, default=0.05,
+                      help='how much slower the median has to be to count, 0.05 is 5%%')
+  parser.add_argument('--alpha', type=float, default=0.01,
+                      help='the p value below which a difference is significant')
+  parser.add_argument('--json', help='also write the comparison to this file')
+  args = parser.parse_args()
+
+  before = load(args.before)
+  after = load(args.after)
+  report = []
+  for key in sorted(set(before) & set(after)):
+    old, new = median(before[key]), median(after[key])
+    change = new / old - 1 if old > 0 else 0.0
+    p = mann_whitney_u(before[key], after[key])
+    if p is None:
+      verdict = 'unknown'
+    elif p < args.alpha and change > args.threshold:
+      verdict = 'slower'
+    elif p < args.alpha and change < -args.threshold:
+      verdict = 'faster'
+    else:
+      verdict = 'same'
+    report.append({'benchmark': key, 'before_ns': old, 'after_ns': new, 'change': change,
+                   'p_value': p, 'repetitions': [len(before[key]), len(after[key])],
+                   'verdict': verdict})
+
+  for row in report:
+    p = 'n/a' if row['p_value'] is None else '%.4f' % row['p_value']
+    print('%-8s %+7.1f%%  p=%-6s %14.0fns -> %14.0fns  %s' % (row['verdict'], row['change'] * 100,
+        p, row['before_ns'], row['after_ns'], row['benchmark']))
+  for key in sorted(set(before) ^ set(after)):
+    print('missing  in %s  %s' % ('after' if key in before else 'before', key))
+  if any(row['verdict'] == 'unknown' for row in report):
+    print('Some benchmarks ran only once, run them with repetitions to test them', file=sys.stderr)
+
+  if args.json:
+    with open(args.json, 'w') as f:
+      json.dump(report, f, indent=2)
+  return 1 if any(row['verdict'] == 'slower' for row in report) else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
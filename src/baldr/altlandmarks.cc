@@ -0,0 +1,101 @@
+#include "baldr/altlandmarks.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// "VALHAALT" so that other files are not mistaken for landmarks
+constexpr uint64_t kMagic = 0x544C4141484C4156ULL;
+constexpr uint32_t kVersion = 1;
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+constexpr float AltLandmarks::kUnreachable;
+
+std::string AltLandmarks::FileName(const std::string& tile_dir, const std::string& costing) {
+  std::string file_name = tile_dir;
+  if (!file_name.empty() && file_name.back() != filesystem::path::preferred_separator) {
+    file_name.push_back(filesystem::path::preferred_separator);
+  }
+  return file_name + costing + ".alt";
+}
+
+void AltLandmarks::Write(const std::string& file_name,
+                         const std::string& costing,
+                         const std::vector<GraphId>& landmarks,
+                         const std::vector<GraphId>& tiles,
+                         const std::vector<uint64_t>& offsets,
+                         const std::vector<float>& distances) {
+  if (offsets.size() != tiles.size() + 1 ||
+      distances.size() != offsets.back() * 2 * landmarks.size()) {
+    throw std::runtime_error("Landmark distances dont match their tiles");
+  }
+
+  Header header{};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.landmark_count = static_cast<uint32_t>(landmarks.size());
+  header.tile_count = tiles.size();
+  header.node_count = offsets.back();
+  strncpy(header.costing, costing.c_str(), sizeof(header.costing) - 1);
+
+  std::vector<uint64_t> landmark_values, tile_values;
+  for (const auto& landmark : landmarks) {
+    landmark_values.push_back(landmark.value);
+  }
+  for (const auto& tile : tiles) {
+    tile_values.push_back(tile.value);
+  }
+
+  SidecarWriter file(file_name);
+  file.write(&header, 1);
+  file.write(landmark_values);
+  file.write(tile_values);
+  file.write(offsets);
+  file.write(distances);
+  file.commit();
+}
+
+AltLandmarks::AltLandmarks(const std::string& file_name)
+    : file_(file_name, "a set of landmarks", kMagic, kVersion, sizeof(Header)) {
+  // check that all the arrays fit in the file
+  header_ = reinterpret_cast<const Header*>(file_.data());
+  const auto ids = header_->landmark_count + 2 * header_->tile_count + 1;
+  const auto distances = header_->node_count * 2 * header_->landmark_count;
+  file_.check(file_.size() == sizeof(Header) + ids * sizeof(uint64_t) + distances * sizeof(float));
+
+  landmarks_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(Header));
+  tiles_ = landmarks_ + header_->landmark_count;
+  offsets_ = tiles_ + header_->tile_count;
+  distances_ = reinterpret_cast<const float*>(offsets_ + header_->tile_count + 1);
+  LOG_INFO("Loaded " + std::to_string(count()) + " " + costing() + " landmarks for " +
+           std::to_string(header_->node_count) + " nodes");
+}
+
+std::string AltLandmarks::costing() const {
+  return std::string(header_->costing, strnlen(header_->costing, sizeof(header_->costing)));
+}
+
+const float* AltLandmarks::distances(const GraphId& node) const {
+  const auto* end = tiles_ + header_->tile_count;
+  const auto* found = std::lower_bound(tiles_, end, node.Tile_Base().value);
+  if (found == end || *found != node.Tile_Base().value) {
+    return nullptr;
+  }
+  const auto tile = found - tiles_;
+  const uint64_t index = offsets_[tile] + node.id();
+  if (index >= offsets_[tile + 1]) {
+    return nullptr;
+  }
+  return distances_ + index * 2 * header_->landmark_count;
+}
+
+} // namespace baldr
+} // namespace valhalla
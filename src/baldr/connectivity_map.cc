@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
+#include <limits>
 #include <list>
+#include <numeric>
 #include <random>
 #include <sstream>
+#include <stdexcept>
 #include <unordered_set>
 
 #include "baldr/connectivity_map.h"
@@ -9,6 +14,7 @@
 #include "baldr/graphtile.h"
 #include "baldr/json.h"
 #include "baldr/tilehierarchy.h"
+#include "filesystem.h"
 #include "midgard/constants.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -18,6 +24,99 @@ using namespace valhalla::baldr;
 using namespace valhalla::midgard;
 
 namespace {
+
+// "VALHCONN" so that other files are not mistaken for connectivity maps
+constexpr uint64_t kMagic = 0x4E4E4F43484C4156ULL;
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kNoNode = std::numeric_limits<uint32_t>::max();
+
+// The weakly connected components of the edges an access mode can use, over every level but
+// transit, numbered from 1. The edges the mode cant use are left in none, 0. Two edges in
+// different components cant be reached from one another whatever the restrictions are
+void find_components(GraphReader& reader,
+                     const std::vector<GraphId>& tiles,
+                     const std::vector<uint64_t>& node_offsets,
+                     const std::vector<uint64_t>& edge_offsets,
+                     const uint32_t access_mode,
+                     uint32_t* components) {
+  std::vector<uint32_t> parents(node_offsets.back());
+  std::iota(parents.begin(), parents.end(), 0);
+  auto find = [&parents](uint32_t node) {
+    while (parents[node] != node) {
+      parents[node] = parents[parents[node]];
+      node = parents[node];
+    }
+    return node;
+  };
+  auto index = [&](const GraphId& node_id) {
+    auto found = std::lower_bound(tiles.cbegin(), tiles.cend(), node_id.Tile_Base());
+    if (found == tiles.cend() || *found != node_id.Tile_Base()) {
+      return kNoNode;
+    }
+    const auto t = found - tiles.cbegin();
+    const auto node = node_offsets[t] + node_id.id();
+    return node < node_offsets[t + 1] ? static_cast<uint32_t>(node) : kNoNode;
+  };
+  auto usable = [access_mode](const DirectedEdge& edge) {
+    return ((edge.forwardaccess() | edge.reverseaccess()) & access_mode) != 0;
+  };
+
+  // join the nodes at the ends of the edges the mode can use and those joined by transitions
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    graph_tile_ptr tile = reader.GetGraphTile(tiles[t]);
+    if (!tile) {
+      continue;
+    }
+    for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+      const auto* node = tile->node(n);
+      const auto begin = find(node_offsets[t] + n);
+      std::vector<uint32_t> ends;
+      for (const auto& transition : tile->GetNodeTransitions(node)) {
+        ends.push_back(index(transition.endnode()));
+      }
+      for (const auto& edge : tile->GetDirectedEdges(node)) {
+        if (usable(edge)) {
+          ends.push_back(index(edge.endnode()));
+        }
+      }
+      for (auto end : ends) {
+        if (end != kNoNode) {
+          end = find(end);
+          parents[std::max(begin, end)] = std::min(begin, end);
+        }
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // number the components and give every edge the one of its begin node
+  std::vector<uint32_t> numbers(parents.size(), 0);
+  uint32_t count = 0;
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    graph_tile_ptr tile = reader.GetGraphTile(tiles[t]);
+    if (!tile) {
+      continue;
+    }
+    for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+      const auto* node = tile->node(n);
+      auto& number = numbers[find(node_offsets[t] + n)];
+      for (uint32_t e = node->edge_index(); e < node->edge_index() + node->edge_count(); ++e) {
+        if (usable(*tile->directededge(e))) {
+          number = number ? number : ++count;
+          components[edge_offsets[t] + e] = number;
+        }
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  LOG_INFO("Found " + std::to_string(count) + " components of the edges of access mode " +
+           std::to_string(access_mode));
+}
+
 /*
    { "type": "FeatureCollection",
     "features": [
@@ -112,11 +211,131 @@ std::string to_feature_collection(const std::unordered_map<size_t, polygon_t>& b
 
 namespace valhalla {
 namespace baldr {
-connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt) {
+std::string connectivity_map_t::FileName(const std::string& tile_dir) {
+  std::string file_name = tile_dir;
+  if (!file_name.empty() && file_name.back() != filesystem::path::preferred_separator) {
+    file_name.push_back(filesystem::path::preferred_separator);
+  }
+  return file_name + "connectivity.map";
+}
+
+void connectivity_map_t::Write(const std::string& file_name,
+                               const boost::property_tree::ptree& pt,
+                               const std::vector<uint32_t>& access_modes) {
+  // The colors of the tiles as they are without a file
+  auto config = pt;
+  config.put("connectivity_map", false);
+  connectivity_map_t colors(config);
+
+  // The nodes and edges of every level but transit, numbered tile by tile
+  GraphReader reader(config);
+  std::vector<GraphId> tiles;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      tiles.push_back(tile_id);
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+  std::vector<uint64_t> node_offsets{0}, edge_offsets{0};
+  for (const auto& tile_id : tiles) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    node_offsets.push_back(node_offsets.back() + (tile ? tile->header()->nodecount() : 0));
+    edge_offsets.push_back(edge_offsets.back() + (tile ? tile->header()->directededgecount() : 0));
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  if (node_offsets.back() >= kNoNode) {
+    throw std::runtime_error("Too many nodes to find the components of");
+  }
+
+  // The components of every access mode one after the other
+  std::vector<uint32_t> components(access_modes.size() * edge_offsets.back(), 0);
+  for (size_t i = 0; i < access_modes.size(); ++i) {
+    find_components(reader, tiles, node_offsets, edge_offsets, access_modes[i],
+                    components.data() + i * edge_offsets.back());
+  }
+
+  Header header{};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.access_mode_count = access_modes.size();
+  header.color_count = colors.level_offsets_.back();
+  header.tile_count = tiles.size();
+  header.edge_count = edge_offsets.back();
+
+  std::vector<uint64_t> tile_values;
+  for (const auto& tile : tiles) {
+    tile_values.push_back(tile.value);
+  }
+
+  SidecarWriter file(file_name);
+  file.write(&header, 1);
+  file.write(tile_values);
+  file.write(edge_offsets);
+  file.write(colors.colors_, header.color_count);
+  file.write(access_modes);
+  file.write(components);
+  file.commit();
+}
+
+connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt)
+    : transit_level(TileHierarchy::GetTransitLevel().level), has_data_{}, colors_(nullptr),
+      header_(nullptr), tiles_(nullptr), offsets_(nullptr),
+      access_modes_(nullptr), components_(nullptr) {
+  // The colors are laid out level by level, transit is on the tiles of the local level
+  level_offsets_[0] = 0;
+  for (const auto& level : TileHierarchy::levels()) {
+    level_offsets_[level.level + 1] = level_offsets_[level.level] + level.tiles.TileCount();
+  }
+  level_offsets_[transit_level + 1] =
+      level_offsets_[transit_level] + TileHierarchy::GetTransitLevel().tiles.TileCount();
+
+  // Use the map written before if you want it, it has the components too
+  if (pt.get<bool>("connectivity_map", false)) {
+    try {
+      map(FileName(pt.get<std::string>("tile_dir", "")));
+      return;
+    } catch (const std::exception& e) {
+      LOG_WARN(std::string("Computing the connectivity map instead of using the file: ") +
+               e.what());
+    }
+  }
+  compute(pt);
+}
+
+void connectivity_map_t::map(const std::string& file_name) {
+  // check that it has the tiles of our hierarchy and that all the arrays fit in the file
+  auto file =
+      std::make_unique<Sidecar>(file_name, "a connectivity map", kMagic, kVersion, sizeof(Header));
+  const auto* header = reinterpret_cast<const Header*>(file->data());
+  const auto ids = 2 * header->tile_count + 1;
+  const auto values = header->color_count + header->access_mode_count +
+                      header->access_mode_count * header->edge_count;
+  file->check(header->color_count == level_offsets_.back() &&
+              file->size() == sizeof(Header) + ids * sizeof(uint64_t) + values * sizeof(uint32_t));
+
+  file_ = std::move(file);
+  header_ = header;
+  tiles_ = reinterpret_cast<const uint64_t*>(file_->data() + sizeof(Header));
+  offsets_ = tiles_ + header_->tile_count;
+  colors_ = reinterpret_cast<const uint32_t*>(offsets_ + header_->tile_count + 1);
+  access_modes_ = colors_ + header_->color_count;
+  components_ = access_modes_ + header_->access_mode_count;
+  for (size_t level = 0; level < has_data_.size(); ++level) {
+    has_data_[level] = std::any_of(colors_ + level_offsets_[level],
+                                   colors_ + level_offsets_[level + 1],
+                                   [](uint32_t color) { return color != 0; });
+  }
+  LOG_INFO("Loaded the connectivity map with the components of " +
+           std::to_string(header_->edge_count) + " edges for " +
+           std::to_string(header_->access_mode_count) + " access modes");
+}
+
+void connectivity_map_t::compute(const boost::property_tree::ptree& pt) {
   // See what kind of tiles we are dealing with here by getting a graphreader
   GraphReader reader(pt);
   auto tiles = reader.GetTileSet();
-  transit_level = TileHierarchy::GetTransitLevel().level;
 
   // Quick hack to remove connectivity between known unconnected regions
   // The only land connection from north to south america is through
@@ -132,6 +351,8 @@ connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt) {
   // then use this map as input to this singleton (via geojson?)
 
   // Populate a map for each level of the tiles that exist
+  // this is a map(tile_level, map(tile_id, tile_color))
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t>> colors;
   for (const auto& t : tiles) {
     auto& level_colors =
         colors.insert({t.level(), std::unordered_map<uint32_t, size_t>{}}).first->second;
@@ -150,18 +371,23 @@ connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt) {
                                                               : decltype(not_neighbors){});
     }
   }
+
+  // Lay them out by tile id so they can be looked up directly
+  computed_.assign(level_offsets_.back(), 0);
+  for (const auto& level : colors) {
+    if (level.first >= has_data_.size()) {
+      continue;
+    }
+    has_data_[level.first] = !level.second.empty();
+    for (const auto& tile : level.second) {
+      computed_[level_offsets_[level.first] + tile.first] = static_cast<uint32_t>(tile.second);
+    }
+  }
+  colors_ = computed_.data();
 }
 
 size_t connectivity_map_t::get_color(const GraphId& id) const {
-  auto level = colors.find(id.level());
-  if (level == colors.cend()) {
-    return 0;
-  }
-  auto color = level->second.find(id.tileid());
-  if (color == level->second.cend()) {
-    return 0;
-  }
-  return color->second;
+  return color(id.level(), id.tileid());
 }
 
 std::unordered_set<size_t> connectivity_map_t::get_colors(uint32_t hierarchy_level,
@@ -169,8 +395,7 @@ std::unordered_set<size_t> connectivity_map_t::get_colors(uint32_t hierarchy_lev
                                                           float radius) const {
 
   std::unordered_set<size_t> result;
-  auto level = colors.find(hierarchy_level);
-  if (level == colors.cend()) {
+  if (!has_data(hierarchy_level)) {
     return result;
   }
   const auto& tiles = TileHierarchy::levels()[hierarchy_level].tiles;
@@ -186,9 +411,9 @@ std::unordered_set<size_t> connectivity_map_t::get_colors(uint32_t hierarchy_lev
                           Point2(ll.lng() + lngdeg, ll.lat() + latdeg));
       std::vector<int32_t> tilelist = tiles.TileList(bbox);
       for (auto& id : tilelist) {
-        auto color = level->second.find(id);
-        if (color != level->second.cend()) {
-          result.emplace(color->second);
+        auto tile_color = color(hierarchy_level, id);
+        if (tile_color) {
+          result.emplace(tile_color);
         }
       }
     }
@@ -196,6 +421,41 @@ std::unordered_set<size_t> connectivity_map_t::get_colors(uint32_t hierarchy_lev
   return result;
 }
 
+bool connectivity_map_t::get_components(const baldr::PathLocation& location,
+                                        const uint32_t access_mode,
+                                        std::unordered_set<uint32_t>& components) const {
+  // only the file has them and only for some access modes
+  if (!header_) {
+    return false;
+  }
+  const auto* modes_end = access_modes_ + header_->access_mode_count;
+  const auto* mode = std::find(access_modes_, modes_end, access_mode);
+  if (mode == modes_end) {
+    return false;
+  }
+  const auto* mode_components = components_ + (mode - access_modes_) * header_->edge_count;
+
+  const auto* tiles_end = tiles_ + header_->tile_count;
+  std::vector<const decltype(location.edges)*> edge_sets{&location.edges, &location.filtered_edges};
+  for (const auto* edges : edge_sets) {
+    for (const auto& edge : *edges) {
+      const auto* tile = std::lower_bound(tiles_, tiles_end, edge.id.Tile_Base().value);
+      if (tile == tiles_end || *tile != edge.id.Tile_Base().value) {
+        return false;
+      }
+      const auto index = offsets_[tile - tiles_] + edge.id.id();
+      if (index >= offsets_[tile - tiles_ + 1]) {
+        return false;
+      }
+      // edges the access mode cant use dont connect the location to anything
+      if (mode_components[index] != 0) {
+        components.emplace(mode_components[index]);
+      }
+    }
+  }
+  return !components.empty();
+}
+
 std::string connectivity_map_t::to_geojson(const uint32_t hierarchy_level) const {
   // bail if we dont have the level
   uint32_t tile_level = (hierarchy_level == transit_level) ? transit_level - 1 : hierarchy_level;
@@ -207,15 +467,10 @@ std::string connectivity_map_t::to_geojson(const uint32_t hierarchy_level) const
   // make a region map (inverse mapping of color to lists of tiles)
   // could cache this but shouldnt need to call it much
   std::unordered_map<size_t, std::unordered_set<uint32_t>> regions;
-  auto level = colors.find(hierarchy_level);
-  if (level != colors.cend()) {
-    for (const auto& tile : level->second) {
-      auto region = regions.find(tile.second);
-      if (region == regions.end()) {
-        regions.emplace(tile.second, std::unordered_set<uint32_t>{tile.first});
-      } else {
-        region->second.emplace(tile.first);
-      }
+  for (uint32_t tile_id = 0; tile_id < tiles.TileCount(); ++tile_id) {
+    auto tile_color = color(hierarchy_level, tile_id);
+    if (tile_color) {
+      regions[tile_color].emplace(tile_id);
     }
   }
 
@@ -246,14 +501,8 @@ std::vector<size_t> connectivity_map_t::to_image(const uint32_t hierarchy_level)
 
   std::vector<size_t> tiles(level_tiles.tiles.nrows() * level_tiles.tiles.ncolumns(),
                             static_cast<uint32_t>(0));
-  auto level = colors.find(hierarchy_level);
-  if (level != colors.cend()) {
-    for (size_t i = 0; i < tiles.size(); ++i) {
-      const auto color = level->second.find(static_cast<uint32_t>(i));
-      if (color != level->second.cend()) {
-        tiles[i] = color->second;
-      }
-    }
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    tiles[i] = color(hierarchy_level, static_cast<uint32_t>(i));
   }
 
   return tiles;
@@ -0,0 +1,108 @@
+#include "baldr/contractionhierarchy.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// "VALHALCH" so that other files are not mistaken for a hierarchy
+constexpr uint64_t kMagic = 0x48434C41484C4156ULL;
+constexpr uint32_t kVersion = 1;
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t ContractionHierarchy::kInvalidNode;
+
+std::string ContractionHierarchy::FileName(const std::string& tile_dir,
+                                           const std::string& costing) {
+  std::string file_name = tile_dir;
+  if (!file_name.empty() && file_name.back() != filesystem::path::preferred_separator) {
+    file_name.push_back(filesystem::path::preferred_separator);
+  }
+  return file_name + costing + ".ch";
+}
+
+void ContractionHierarchy::Write(const std::string& file_name,
+                                 const std::string& costing,
+                                 const std::vector<GraphId>& edges,
+                                 const std::vector<std::vector<Arc>>& up,
+                                 const std::vector<std::vector<Arc>>& down) {
+  Header header{};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.node_count = static_cast<uint32_t>(edges.size());
+  strncpy(header.costing, costing.c_str(), sizeof(header.costing) - 1);
+
+  std::vector<uint64_t> edge_values, up_offsets{0}, down_offsets{0};
+  edge_values.reserve(edges.size());
+  for (uint32_t node = 0; node < edges.size(); ++node) {
+    edge_values.push_back(edges[node].value);
+    up_offsets.push_back(up_offsets.back() + up[node].size());
+    down_offsets.push_back(down_offsets.back() + down[node].size());
+  }
+  header.up_count = up_offsets.back();
+  header.down_count = down_offsets.back();
+
+  std::vector<uint32_t> by_edge(edges.size());
+  for (uint32_t node = 0; node < by_edge.size(); ++node) {
+    by_edge[node] = node;
+  }
+  std::sort(by_edge.begin(), by_edge.end(), [&edge_values](uint32_t a, uint32_t b) {
+    return edge_values[a] < edge_values[b];
+  });
+
+  SidecarWriter file(file_name);
+  file.write(&header, 1);
+  file.write(edge_values);
+  file.write(up_offsets);
+  file.write(down_offsets);
+  file.write(by_edge);
+  for (const auto& arcs : up) {
+    file.write(arcs);
+  }
+  for (const auto& arcs : down) {
+    file.write(arcs);
+  }
+  file.commit();
+}
+
+ContractionHierarchy::ContractionHierarchy(const std::string& file_name)
+    : file_(file_name, "a contraction hierarchy", kMagic, kVersion, sizeof(Header)) {
+  // check that all the arrays fit in the file
+  header_ = reinterpret_cast<const Header*>(file_.data());
+  const uint64_t n = header_->node_count;
+  file_.check(file_.size() == sizeof(Header) + n * sizeof(uint64_t) * 3 + 2 * sizeof(uint64_t) +
+                                  n * sizeof(uint32_t) +
+                                  (header_->up_count + header_->down_count) * sizeof(Arc));
+
+  edges_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(Header));
+  up_offsets_ = edges_ + n;
+  down_offsets_ = up_offsets_ + n + 1;
+  by_edge_ = reinterpret_cast<const uint32_t*>(down_offsets_ + n + 1);
+  up_arcs_ = reinterpret_cast<const Arc*>(by_edge_ + n);
+  down_arcs_ = up_arcs_ + header_->up_count;
+  LOG_INFO("Loaded the " + costing() + " contraction hierarchy with " + std::to_string(n) +
+           " nodes and " + std::to_string(header_->up_count + header_->down_count) + " arcs");
+}
+
+std::string ContractionHierarchy::costing() const {
+  return std::string(header_->costing, strnlen(header_->costing, sizeof(header_->costing)));
+}
+
+uint32_t ContractionHierarchy::node(const GraphId& edgeid) const {
+  const auto* end = by_edge_ + header_->node_count;
+  const auto* found = std::lower_bound(by_edge_, end, edgeid.value,
+                                       [this](uint32_t node, uint64_t value) {
+                                         return edges_[node] < value;
+                                       });
+  return found != end && edges_[*found] == edgeid.value ? *found : kInvalidNode;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,10 +1,15 @@
 #include "baldr/curler.h"
+#include "baldr/curl_tilegetter.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
 
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 #ifdef CURL_STATICLIB
 
@@ -30,8 +35,12 @@ struct curl_singleton_t {
   }
 };
 
-static std::shared_ptr<CURL> init_curl() {
+void init_curl_global() {
   static curl_singleton_t s;
+}
+
+static std::shared_ptr<CURL> init_curl() {
+  init_curl_global();
   return std::shared_ptr<CURL>(curl_easy_init(), [](CURL* c) { curl_easy_cleanup(c); });
 }
 
@@ -175,6 +184,210 @@ void curler_pool_t::release(curler_t&& curler) {
   curler_pool_empty_cond_.notify_one();
 }
 
+// curl_multi_tile_getter_t
+
+struct curl_multi_tile_getter_t::pimpl_t {
+  // everything curl needs to keep around while the request is in flight
+  struct request_t {
+    std::string url;
+    std::promise<response_t> promise;
+    std::vector<char> bytes;
+    char error[CURL_ERROR_SIZE]{};
+  };
+
+  pimpl_t(const size_t max_connections, const std::string& user_agent, bool gzipped)
+      : user_agent(user_agent), gzipped(gzipped), stop(false) {
+    init_curl_global();
+    multi = curl_multi_init();
+    if (multi == nullptr) {
+      LOG_ERROR("Failed to created CURL multi handle");
+      throw std::runtime_error("Failed to created CURL multi handle");
+    }
+    // share connections between requests to the same host and multiplex them over http/2
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(max_connections));
+    worker = std::thread(&pimpl_t::run, this);
+  }
+
+  ~pimpl_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    wake();
+    worker.join();
+    curl_multi_cleanup(multi);
+  }
+
+  void enqueue(std::vector<std::unique_ptr<request_t>>& requests) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto& request : requests) {
+        pending.emplace_back(std::move(request));
+      }
+    }
+    wake();
+  }
+
+  void wake() {
+    signal.notify_one();
+#if LIBCURL_VERSION_NUM >= 0x074400
+    curl_multi_wakeup(multi);
+#endif
+  }
+
+  // the options are the same as the ones each curler_t uses
+  CURL* make_handle(request_t& request) const {
+    CURL* handle = curl_easy_init();
+    if (handle == nullptr) {
+      return nullptr;
+    }
+    curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, request.error);
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &request.bytes);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "gzip");
+    if (gzipped) {
+      curl_easy_setopt(handle, CURLOPT_HTTP_CONTENT_DECODING, 0L);
+    }
+    if (!user_agent.empty()) {
+      curl_easy_setopt(handle, CURLOPT_USERAGENT, user_agent.c_str());
+    }
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    // rather wait for a connection we can multiplex on than open a new one
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(handle, CURLOPT_URL, request.url.c_str());
+    return handle;
+  }
+
+  void finish(CURL* handle, CURLcode code) {
+    auto found = active.find(handle);
+    long http_code = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &http_code);
+    response_t response;
+    // TODO: Check other codes.
+    if (code == CURLE_OK && http_code == 200) {
+      response.bytes_ = std::move(found->second->bytes);
+      response.status_ = tile_getter_t::status_code_t::SUCCESS;
+    } else if (code != CURLE_OK) {
+      LOG_WARN("Failed to get URL " + found->second->url + ": " + found->second->error);
+    }
+    found->second->promise.set_value(std::move(response));
+    curl_multi_remove_handle(multi, handle);
+    curl_easy_cleanup(handle);
+    active.erase(found);
+  }
+
+  void run() {
+    while (true) {
+      // pick up new requests or wait for some if there is nothing to do
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (active.empty()) {
+          signal.wait(lock, [this]() { return stop || !pending.empty(); });
+        }
+        if (stop) {
+          break;
+        }
+        while (!pending.empty()) {
+          auto request = std::move(pending.front());
+          pending.pop_front();
+          CURL* handle = make_handle(*request);
+          if (handle == nullptr || curl_multi_add_handle(multi, handle) != CURLM_OK) {
+            LOG_ERROR("Failed to created CURL connection");
+            if (handle) {
+              curl_easy_cleanup(handle);
+            }
+            request->promise.set_value(response_t{});
+            continue;
+          }
+          active.emplace(handle, std::move(request));
+        }
+      }
+
+      // move the transfers along and hand back whatever finished
+      int running = 0;
+      curl_multi_perform(multi, &running);
+      int queued = 0;
+      while (CURLMsg* message = curl_multi_info_read(multi, &queued)) {
+        if (message->msg == CURLMSG_DONE) {
+          finish(message->easy_handle, message->data.result);
+        }
+      }
+
+      // wait for the sockets or until someone adds more requests
+      if (!active.empty()) {
+#if LIBCURL_VERSION_NUM >= 0x074400
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+#else
+        curl_multi_wait(multi, nullptr, 0, 10, nullptr);
+#endif
+      }
+    }
+
+    // anything left over fails
+    for (auto& request : active) {
+      request.second->promise.set_value(response_t{});
+      curl_multi_remove_handle(multi, request.first);
+      curl_easy_cleanup(request.first);
+    }
+    active.clear();
+    for (auto& request : pending) {
+      request->promise.set_value(response_t{});
+    }
+    pending.clear();
+  }
+
+  CURLM* multi;
+  std::string user_agent;
+  bool gzipped;
+  std::mutex mutex;
+  std::condition_variable signal;
+  bool stop;
+  std::deque<std::unique_ptr<request_t>> pending;
+  // only touched by the worker thread
+  std::unordered_map<CURL*, std::unique_ptr<request_t>> active;
+  std::thread worker;
+};
+
+curl_multi_tile_getter_t::curl_multi_tile_getter_t(const size_t max_connections,
+                                                   const std::string& user_agent,
+                                                   bool gzipped)
+    : pimpl_(new pimpl_t(max_connections, user_agent, gzipped)), gzipped_(gzipped) {
+}
+
+curl_multi_tile_getter_t::~curl_multi_tile_getter_t() = default;
+
+tile_getter_t::response_t curl_multi_tile_getter_t::get(const std::string& url) {
+  auto response = get_async(url);
+  // an interrupt throws which is how the synchronous curler reports it too
+  while (interrupt_ &&
+         response.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready) {
+    (*interrupt_)();
+  }
+  return response.get();
+}
+
+std::future<tile_getter_t::response_t> curl_multi_tile_getter_t::get_async(const std::string& url) {
+  return std::move(get_batch({url}).front());
+}
+
+std::vector<std::future<tile_getter_t::response_t>>
+curl_multi_tile_getter_t::get_batch(const std::vector<std::string>& urls) {
+  std::vector<std::unique_ptr<pimpl_t::request_t>> requests;
+  std::vector<std::future<response_t>> responses;
+  requests.reserve(urls.size());
+  responses.reserve(urls.size());
+  for (const auto& url : urls) {
+    requests.emplace_back(new pimpl_t::request_t{url, {}, {}});
+    responses.emplace_back(requests.back()->promise.get_future());
+  }
+  pimpl_->enqueue(requests);
+  return responses;
+}
+
 } // namespace baldr
 } // namespace valhalla
 
@@ -205,6 +418,31 @@ void curler_pool_t::release(curler_t&&) {
   throw std::runtime_error("This version of libvalhalla was not built with CURL support");
 }
 
+struct curl_multi_tile_getter_t::pimpl_t {};
+
+curl_multi_tile_getter_t::curl_multi_tile_getter_t(const size_t,
+                                                   const std::string&,
+                                                   bool gzipped)
+    : gzipped_(gzipped) {
+  LOG_ERROR("This version of libvalhalla was not built with CURL support");
+  throw std::runtime_error("This version of libvalhalla was not built with CURL support");
+}
+
+curl_multi_tile_getter_t::~curl_multi_tile_getter_t() = default;
+
+tile_getter_t::response_t curl_multi_tile_getter_t::get(const std::string&) {
+  throw std::runtime_error("This version of libvalhalla was not built with CURL support");
+}
+
+std::future<tile_getter_t::response_t> curl_multi_tile_getter_t::get_async(const std::string&) {
+  throw std::runtime_error("This version of libvalhalla was not built with CURL support");
+}
+
+std::vector<std::future<tile_getter_t::response_t>>
+curl_multi_tile_getter_t::get_batch(const std::vector<std::string>&) {
+  throw std::runtime_error("This version of libvalhalla was not built with CURL support");
+}
+
 } // namespace baldr
 } // namespace valhalla
 
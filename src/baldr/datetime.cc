@@ -71,6 +71,46 @@ const date::time_zone* tz_db_t::from_index(size_t index) const {
   return &db.zones[index - 1];
 }
 
+int tz_db_t::offset(const date::time_zone* time_zone, const uint64_t seconds) const {
+  const uint64_t day = seconds / midgard::kSecondsPerDay;
+  const uint32_t second = seconds % midgard::kSecondsPerDay;
+  const uint64_t index = time_zone - db.zones.data();
+  const uint64_t key = (index << 32) | day;
+  const bool cacheable = time_zone >= db.zones.data() && index < db.zones.size();
+
+  // most of the time we have seen this day before
+  if (cacheable) {
+    std::shared_lock<std::shared_timed_mutex> lock(days_mutex);
+    auto found = days.find(key);
+    if (found != days.cend()) {
+      return second < found->second.transition ? found->second.before : found->second.after;
+    }
+  }
+
+  // otherwise go through the rules for the start of the day and any transition that day
+  const date::sys_seconds start{std::chrono::seconds(day * midgard::kSecondsPerDay)};
+  const date::sys_seconds end = start + std::chrono::seconds(midgard::kSecondsPerDay);
+  const auto info = time_zone->get_info(start);
+  day_offsets_t offsets{static_cast<int32_t>(info.offset.count()),
+                        static_cast<int32_t>(info.offset.count()),
+                        static_cast<uint32_t>(midgard::kSecondsPerDay)};
+  if (info.end < end) {
+    const auto next = time_zone->get_info(info.end);
+    // more than one transition in a day isnt worth keeping
+    if (next.end < end || !cacheable) {
+      const auto at = time_zone->get_info(start + std::chrono::seconds(second));
+      return static_cast<int>(at.offset.count());
+    }
+    offsets.after = static_cast<int32_t>(next.offset.count());
+    offsets.transition = static_cast<uint32_t>((info.end - start).count());
+  }
+  if (cacheable) {
+    std::unique_lock<std::shared_timed_mutex> lock(days_mutex);
+    days.emplace(key, offsets);
+  }
+  return second < offsets.transition ? offsets.before : offsets.after;
+}
+
 const tz_db_t& get_tz_db() {
   static const tz_db_t tz_db;
   return tz_db;
@@ -144,14 +184,12 @@ int timezone_diff(const uint64_t seconds,
   if (!origin_tz || !dest_tz || origin_tz == dest_tz) {
     return 0;
   }
-  std::chrono::seconds dur(seconds);
-  std::chrono::time_point<std::chrono::system_clock> tp(dur);
-
-  const auto origin = date::make_zoned(origin_tz, tp);
-  const auto dest = date::make_zoned(dest_tz, tp);
-
   // if we have a cache use it
   if (cache) {
+    std::chrono::seconds dur(seconds);
+    std::chrono::time_point<std::chrono::system_clock> tp(dur);
+    const auto origin = date::make_zoned(origin_tz, tp);
+    const auto dest = date::make_zoned(dest_tz, tp);
     const auto& origin_info = from_cache(origin, origin_tz, *cache);
     const auto& dest_info = from_cache(dest, dest_tz, *cache);
     return static_cast<int>(
@@ -159,11 +197,8 @@ int timezone_diff(const uint64_t seconds,
             .count());
   }
 
-  const auto& origin_info = origin.get_info();
-  const auto& dest_info = dest.get_info();
-  return static_cast<int>(
-      std::chrono::duration_cast<std::chrono::seconds>(dest_info.offset - origin_info.offset)
-          .count());
+  const auto& tz_db = get_tz_db();
+  return tz_db.offset(dest_tz, seconds) - tz_db.offset(origin_tz, seconds);
 }
 
 std::string
@@ -288,15 +323,13 @@ bool is_conditional_active(const bool type,
   std::chrono::minutes b_td = std::chrono::hours(0);
   std::chrono::minutes e_td = std::chrono::hours(23) + std::chrono::minutes(59);
 
-  std::chrono::seconds dur(current_time);
-  std::chrono::time_point<std::chrono::system_clock> tp(dur);
-
   uint32_t e_year = 0, b_year = 0;
-  const auto in_local_time = date::make_zoned(time_zone, tp);
-  auto date = date::floor<date::days>(in_local_time.get_local_time());
+  const date::local_seconds in_local_time{
+      std::chrono::seconds(current_time + get_tz_db().offset(time_zone, current_time))};
+  auto date = date::floor<date::days>(in_local_time);
   auto d = date::year_month_day(date);
-  auto t = date::make_time(in_local_time.get_local_time() - date); // Yields time_of_day type
-  std::chrono::minutes td = t.hours() + t.minutes();               // Yields time_of_day type
+  auto t = date::make_time(in_local_time - date); // Yields time_of_day type
+  std::chrono::minutes td = t.hours() + t.minutes(); // Yields time_of_day type
 
   try {
     date::year_month_day begin_date, end_date;
@@ -517,18 +550,13 @@ bool is_conditional_active(const bool type,
 
 uint32_t second_of_week(uint32_t epoch_time, const date::time_zone* time_zone) {
   // get the date time in this timezone
-  std::chrono::seconds dur(epoch_time);
-  std::chrono::time_point<std::chrono::system_clock> utp(dur);
-  const auto tp = date::make_zoned(time_zone, utp).get_local_time();
-  // floor to midnight of that day
-  auto days = date::floor<date::days>(tp);
-  // get the ordinal day of the week
-  uint32_t day = (date::year_month_weekday(days).weekday() - date::Sunday).count();
-  // subtract midnight from the time to get just the time since midnight
-  auto since_midnight =
-      std::chrono::duration_cast<std::chrono::seconds>(date::make_time(tp - days).to_duration());
+  const int64_t local =
+      static_cast<int64_t>(epoch_time) + get_tz_db().offset(time_zone, epoch_time);
+  // the epoch was on a thursday so shift that to get the ordinal day of the week from sunday
+  const int64_t days = local / midgard::kSecondsPerDay;
+  const uint32_t day = static_cast<uint32_t>((days + 4) % 7);
   // get the seconds of the week
-  return day * midgard::kSecondsPerDay + since_midnight.count();
+  return day * midgard::kSecondsPerDay + static_cast<uint32_t>(local % midgard::kSecondsPerDay);
 }
 
 } // namespace DateTime
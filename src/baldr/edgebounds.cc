@@ -0,0 +1,52 @@
+#include "baldr/edgebounds.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+constexpr int16_t kOpenMin = std::numeric_limits<int16_t>::min();
+constexpr int16_t kOpenMax = std::numeric_limits<int16_t>::max();
+
+// the units from the tile corner, one more unit outwards so rounding can never cut off the shape
+int16_t quantize_min(const double value, const double origin, const double size) {
+  const auto units = std::floor((value - origin) / size * valhalla::baldr::kEdgeBoundsUnits) - 1;
+  return units <= kOpenMin ? kOpenMin : static_cast<int16_t>(units);
+}
+
+int16_t quantize_max(const double value, const double origin, const double size) {
+  const auto units = std::ceil((value - origin) / size * valhalla::baldr::kEdgeBoundsUnits) + 1;
+  return units >= kOpenMax ? kOpenMax : static_cast<int16_t>(units);
+}
+
+double dequantize(const int16_t units, const double origin, const double size) {
+  return origin + units * size / valhalla::baldr::kEdgeBoundsUnits;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+EdgeBounds::EdgeBounds() : minx_(kOpenMin), miny_(kOpenMin), maxx_(kOpenMax), maxy_(kOpenMax) {
+}
+
+EdgeBounds::EdgeBounds(const AABB2<PointLL>& bounds, const AABB2<PointLL>& tile_bounds) {
+  minx_ = quantize_min(bounds.minx(), tile_bounds.minx(), tile_bounds.Width());
+  miny_ = quantize_min(bounds.miny(), tile_bounds.miny(), tile_bounds.Height());
+  maxx_ = quantize_max(bounds.maxx(), tile_bounds.minx(), tile_bounds.Width());
+  maxy_ = quantize_max(bounds.maxy(), tile_bounds.miny(), tile_bounds.Height());
+}
+
+AABB2<PointLL> EdgeBounds::bounds(const AABB2<PointLL>& tile_bounds) const {
+  return AABB2<PointLL>(
+      minx_ == kOpenMin ? -180. : dequantize(minx_, tile_bounds.minx(), tile_bounds.Width()),
+      miny_ == kOpenMin ? -90. : dequantize(miny_, tile_bounds.miny(), tile_bounds.Height()),
+      maxx_ == kOpenMax ? 180. : dequantize(maxx_, tile_bounds.minx(), tile_bounds.Width()),
+      maxy_ == kOpenMax ? 90. : dequantize(maxy_, tile_bounds.miny(), tile_bounds.Height()));
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -3,6 +3,8 @@
 
 #include "midgard/encoded.h"
 
+#include <cstring>
+
 using namespace valhalla::baldr;
 
 namespace {
@@ -69,22 +71,26 @@ NameInfo EdgeInfo::GetNameInfo(uint8_t index) const {
   }
 }
 
+// Get the text of a name, the strings in the text list are null terminated
+boost::string_view EdgeInfo::GetNameView(const NameInfo& ni) const {
+  if (ni.name_offset_ >= names_list_length_) {
+    throw std::runtime_error("GetNames: offset exceeds size of text list");
+  }
+  const char* name = names_list_ + ni.name_offset_;
+  const void* terminator = std::memchr(name, '\0', names_list_length_ - ni.name_offset_);
+  const size_t length =
+      terminator ? static_cast<const char*>(terminator) - name : names_list_length_ - ni.name_offset_;
+  return boost::string_view(name, length);
+}
+
 // Get a list of names
 std::vector<std::string> EdgeInfo::GetNames(bool only_tagged_names) const {
   // Get each name
   std::vector<std::string> names;
   names.reserve(name_count());
-  const NameInfo* ni = name_info_list_;
-  for (uint32_t i = 0; i < name_count(); i++, ni++) {
-    if ((only_tagged_names && !ni->tagged_) || (!only_tagged_names && ni->tagged_)) {
-      continue;
-    }
-    if (ni->name_offset_ < names_list_length_) {
-      names.push_back(names_list_ + ni->name_offset_);
-    } else {
-      throw std::runtime_error("GetNames: offset exceeds size of text list");
-    }
-  }
+  VisitNames([&names](boost::string_view name,
+                      bool) { names.emplace_back(name.data(), name.size()); },
+             only_tagged_names);
   return names;
 }
 
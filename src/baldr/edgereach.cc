@@ -0,0 +1,92 @@
+#include "baldr/edgereach.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// "VALHARCH" so that other files are not mistaken for reach
+constexpr uint64_t kMagic = 0x48435241484C4156ULL;
+constexpr uint32_t kVersion = 1;
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::string EdgeReach::FileName(const std::string& tile_dir, const std::string& costing) {
+  std::string file_name = tile_dir;
+  if (!file_name.empty() && file_name.back() != filesystem::path::preferred_separator) {
+    file_name.push_back(filesystem::path::preferred_separator);
+  }
+  return file_name + costing + ".reach";
+}
+
+void EdgeReach::Write(const std::string& file_name,
+                      const std::string& costing,
+                      const uint32_t cap,
+                      const std::vector<GraphId>& tiles,
+                      const std::vector<uint64_t>& offsets,
+                      const std::vector<uint16_t>& reach) {
+  if (offsets.size() != tiles.size() + 1 || reach.size() != offsets.back() * 2) {
+    throw std::runtime_error("Edge reach doesnt match its tiles");
+  }
+
+  Header header{};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.cap = cap;
+  header.tile_count = tiles.size();
+  header.edge_count = offsets.back();
+  strncpy(header.costing, costing.c_str(), sizeof(header.costing) - 1);
+
+  std::vector<uint64_t> tile_values;
+  for (const auto& tile : tiles) {
+    tile_values.push_back(tile.value);
+  }
+
+  SidecarWriter file(file_name);
+  file.write(&header, 1);
+  file.write(tile_values);
+  file.write(offsets);
+  file.write(reach);
+  file.commit();
+}
+
+EdgeReach::EdgeReach(const std::string& file_name)
+    : file_(file_name, "edge reach", kMagic, kVersion, sizeof(Header)) {
+  // check that all the arrays fit in the file
+  header_ = reinterpret_cast<const Header*>(file_.data());
+  file_.check(file_.size() == sizeof(Header) + (2 * header_->tile_count + 1) * sizeof(uint64_t) +
+                                  header_->edge_count * 2 * sizeof(uint16_t));
+
+  tiles_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(Header));
+  offsets_ = tiles_ + header_->tile_count;
+  reach_ = reinterpret_cast<const uint16_t*>(offsets_ + header_->tile_count + 1);
+  LOG_INFO("Loaded " + costing() + " reach up to " + std::to_string(cap()) + " for " +
+           std::to_string(header_->edge_count) + " edges");
+}
+
+std::string EdgeReach::costing() const {
+  return std::string(header_->costing, strnlen(header_->costing, sizeof(header_->costing)));
+}
+
+const uint16_t* EdgeReach::reach(const GraphId& edge) const {
+  const auto* end = tiles_ + header_->tile_count;
+  const auto* found = std::lower_bound(tiles_, end, edge.Tile_Base().value);
+  if (found == end || *found != edge.Tile_Base().value) {
+    return nullptr;
+  }
+  const auto tile = found - tiles_;
+  const uint64_t index = offsets_[tile] + edge.id();
+  if (index >= offsets_[tile + 1]) {
+    return nullptr;
+  }
+  return reach_ + index * 2;
+}
+
+} // namespace baldr
+} // namespace valhalla
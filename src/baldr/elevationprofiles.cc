@@ -0,0 +1,77 @@
+#include "baldr/elevationprofiles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+void pack(uint32_t value, std::string& data) {
+  while (value > 0x7f) {
+    data.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+    value >>= 7;
+  }
+  data.push_back(static_cast<char>(value));
+}
+
+uint32_t unpack(const char*& data, const char* end) {
+  uint32_t value = 0;
+  for (int shift = 0; data < end && shift < 32; shift += 7) {
+    const auto byte = static_cast<uint8_t>(*data++);
+    value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw std::runtime_error("Elevation profile runs past the end of its section");
+}
+
+// the sign goes to the least significant bit so that small differences stay small
+uint32_t zigzag(const int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t unzigzag(const uint32_t value) {
+  return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+void ElevationProfiles::Pack(const std::vector<double>& heights, std::string& profiles) {
+  if (profiles.empty()) {
+    pack(0, profiles);
+  }
+  pack(heights.size(), profiles);
+  int32_t last = 0;
+  for (const auto height : heights) {
+    const auto quantized = static_cast<int32_t>(std::round(height * kElevationProfilePrecision));
+    pack(zigzag(quantized - last), profiles);
+    last = quantized;
+  }
+}
+
+std::vector<float> ElevationProfiles::profile(const uint32_t idx, const bool forward) const {
+  std::vector<float> heights;
+  if (offset_ == nullptr || offset_[idx] >= size_) {
+    return heights;
+  }
+  const char* data = profiles_ + offset_[idx];
+  const char* end = profiles_ + size_;
+  const auto count = unpack(data, end);
+  heights.reserve(count);
+  int32_t last = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    last += unzigzag(unpack(data, end));
+    heights.push_back(last / kElevationProfilePrecision);
+  }
+  if (!forward) {
+    std::reverse(heights.begin(), heights.end());
+  }
+  return heights;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,9 +1,18 @@
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 #include <utility>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "baldr/compression_utils.h"
 #include "baldr/connectivity_map.h"
 #include "baldr/curl_tilegetter.h"
 #include "baldr/graphreader.h"
@@ -11,7 +20,9 @@
 #include "incident_singleton.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/tracepoint.h"
 #include "shortcut_recovery.h"
+#include "tile_prefetcher.h"
 
 using namespace valhalla::midgard;
 
@@ -20,18 +31,136 @@ namespace {
 constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
+constexpr size_t DEFAULT_PREFETCH_MAX_TILES = 64;
+
+// Frequency sketch dimensions for the TinyLFU cache
+constexpr size_t SKETCH_DEPTH = 4;
+constexpr size_t MIN_SKETCH_WIDTH = 64;
+constexpr size_t MAX_SKETCH_WIDTH = 1 << 22;
+constexpr uint8_t MAX_SKETCH_COUNT = 15;
+
+// How much of a tile file to read at once when warming up the page cache
+constexpr size_t WARM_UP_READ_SIZE = 1048576;
+
+// How often to look for speeds written into the traffic extract in place, in seconds, when
+// traffic_extract_poll_interval isnt set
+constexpr float TRAFFIC_UPDATE_POLL_INTERVAL = 1.f;
+
+// Asks the kernel to read the memory in and faults in every page of it
+void touch_memory(const char* data, size_t size) {
+#ifndef _WIN32
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  auto begin = reinterpret_cast<uintptr_t>(data) & ~(page_size - 1);
+  madvise(reinterpret_cast<void*>(begin), reinterpret_cast<uintptr_t>(data) + size - begin,
+          MADV_WILLNEED);
+#else
+  const size_t page_size = 4096;
+#endif
+  volatile char sink = 0;
+  for (size_t i = 0; i < size; i += page_size) {
+    sink ^= data[i];
+  }
+}
+
+// Rounds the shard count up to a power of 2 so we can pick a shard with a shift
+uint32_t shard_bits(size_t shard_count) {
+  uint32_t bits = 0;
+  while ((static_cast<size_t>(1) << bits) < shard_count && bits < 16) {
+    ++bits;
+  }
+  return bits;
+}
+
+// Every reader shares the one mapping of a file mjolnir wrote next to the tiles
+template <typename T>
+std::shared_ptr<const T>
+get_mapped(const std::string& file_name, const std::string& what, const uint64_t generation) {
+  static std::mutex lock;
+  static std::unordered_map<std::string, std::pair<uint64_t, std::weak_ptr<const T>>> mapped;
+  std::lock_guard<std::mutex> guard(lock);
+  // the file of an older tileset is no good to us even if someone still has it mapped
+  auto& entry = mapped[file_name];
+  auto file = entry.first == generation ? entry.second.lock() : nullptr;
+  if (!file) {
+    try {
+      file = std::make_shared<const T>(file_name);
+      entry = std::make_pair(generation, std::weak_ptr<const T>(file));
+    } catch (const std::exception& e) {
+      LOG_WARN("Not using the " + what + ": " + e.what());
+    }
+  }
+  return file;
+}
 
 } // namespace
 
 namespace valhalla {
 namespace baldr {
 
+class TarballGraphMemory final : public GraphMemory {
+public:
+  TarballGraphMemory(std::shared_ptr<midgard::tar> archive, std::pair<char*, size_t> position)
+      : archive_(std::move(archive)) {
+    data = position.first;
+    size = position.second;
+  }
+
+private:
+  const std::shared_ptr<midgard::tar> archive_;
+};
+
+constexpr char GraphReader::kTileIndexName[];
+
 GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& pt) {
+  // if the extract starts with an index of its tiles we can skip walking the tar
+  auto from_index = [this](const char* data, size_t size) {
+    using header_t = midgard::tar::header_t;
+    const auto* header = reinterpret_cast<const header_t*>(data);
+    if (size < sizeof(header_t) || !header->verify() ||
+        strncmp(header->name, kTileIndexName, sizeof(header->name)) != 0) {
+      return false;
+    }
+    auto index_size = header->get_file_size();
+    if (index_size % sizeof(tile_index_entry) != 0 || sizeof(header_t) + index_size > size) {
+      LOG_WARN("Tile extract has an index of the wrong size, reading the whole archive instead");
+      return false;
+    }
+    const auto* entry = reinterpret_cast<const tile_index_entry*>(data + sizeof(header_t));
+    const auto* end = entry + index_size / sizeof(tile_index_entry);
+    tiles.reserve(end - entry);
+    for (; entry != end; ++entry) {
+      if (entry->offset + entry->size > size) {
+        LOG_WARN("Tile extract index points past the end, reading the whole archive instead");
+        tiles.clear();
+        return false;
+      }
+      tiles[entry->tile_id] = std::make_pair(const_cast<char*>(data + entry->offset), entry->size);
+    }
+    return true;
+  };
+
   // if you really meant to load it
   if (pt.get_optional<std::string>("tile_extract")) {
     try {
-      // load the tar
-      archive.reset(new midgard::tar(pt.get<std::string>("tile_extract")));
+      // load the tar, optionally placing it in memory in a particular way
+      midgard::map_options_t options;
+      options.populate = pt.get<bool>("tile_extract_populate", false);
+      options.huge_pages = pt.get<bool>("tile_extract_huge_pages", false);
+      options.numa = pt.get<std::string>("tile_extract_numa", "");
+      try {
+        archive.reset(
+            new midgard::tar(pt.get<std::string>("tile_extract"), true, options, from_index));
+      } catch (const std::exception& e) {
+        if (!options.copy()) {
+          throw;
+        }
+        LOG_WARN(std::string("Could not place the tile extract in huge pages or on numa nodes, "
+                             "falling back to mapping it directly: ") +
+                 e.what());
+        tiles.clear();
+        archive.reset(new midgard::tar(pt.get<std::string>("tile_extract"), true,
+                                       {options.populate, false, ""}, from_index));
+      }
       // map files to graph ids
       for (auto& c : archive->contents) {
         try {
@@ -61,47 +190,246 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
     }
   }
 
-  if (pt.get_optional<std::string>("traffic_extract")) {
-    try {
-      // load the tar
-      traffic_archive.reset(new midgard::tar(pt.get<std::string>("traffic_extract")));
-      // map files to graph ids
-      for (auto& c : traffic_archive->contents) {
-        try {
-          auto id = GraphTile::GetTileId(c.first);
-          traffic_tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
-        } catch (...) {
-          // It's possible to put non-tile files inside the tarfile.  As we're only
-          // parsing the file *name* as a GraphId here, we will just silently skip
-          // any file paths that can't be parsed by GraphId::GetTileId()
-          // If we end up with *no* recognizable tile files in the tarball at all,
-          // checks lower down will warn on that.
-        }
+  current_traffic =
+      std::make_shared<const traffic_extract_t>(pt.get<std::string>("traffic_extract", ""));
+  traffic_generation = 0;
+  traffic_updates = 0;
+
+  // if you want it we make all the tiles of the extract right now so lookups dont need the cache
+  if (pt.get<bool>("tile_extract_views", false) && !tiles.empty()) {
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+    view_offsets[0] = 0;
+    view_offsets[1] = view_offsets[0] + TileHierarchy::levels()[0].tiles.TileCount();
+    view_offsets[2] = view_offsets[1] + TileHierarchy::levels()[1].tiles.TileCount();
+    view_offsets[3] = view_offsets[2] + TileHierarchy::levels()[2].tiles.TileCount();
+    view_indices.resize(view_offsets[3] + TileHierarchy::GetTransitLevel().tiles.TileCount(), -1);
+    views.reserve(tiles.size());
+    for (const auto& t : tiles) {
+      GraphId id(t.first);
+      auto offset = view_offset(id);
+      if (offset >= view_indices.size()) {
+        continue;
       }
-      // couldn't load it
-      if (traffic_tiles.empty()) {
-        LOG_WARN("Traffic tile extract contained no usuable tiles");
-      } // loaded ok but with possibly bad blocks
-      else {
-        LOG_INFO("Traffic tile extract successfully loaded with tile count: " +
-                 std::to_string(traffic_tiles.size()));
-        if (traffic_archive->corrupt_blocks) {
-          LOG_WARN("Traffic tile extract had " + std::to_string(traffic_archive->corrupt_blocks) +
-                   " corrupt blocks");
-        }
+      auto traffic = current_traffic->tiles.find(t.first);
+      auto tile =
+          GraphTile::Create(id, std::make_unique<TarballGraphMemory>(archive, t.second),
+                            traffic == current_traffic->tiles.cend()
+                                ? nullptr
+                                : std::make_unique<TarballGraphMemory>(current_traffic->archive,
+                                                                       traffic->second));
+      if (tile && tile->header()) {
+        view_indices[offset] = views.size();
+        views.emplace_back(std::move(tile));
       }
-    } catch (const std::exception& e) {
-      LOG_WARN(e.what());
-      LOG_WARN("Traffic tile extract could not be loaded");
     }
+    LOG_INFO("Tile extract views built for tile count: " + std::to_string(views.size()));
+#else
+    LOG_WARN("tile_extract_views requires thread safe tile reference counting, ignoring it");
+#endif
   }
 }
 
+GraphReader::tile_extract_t::traffic_extract_t::traffic_extract_t(
+    const std::string& traffic_extract) {
+  // if you really meant to load it
+  if (traffic_extract.empty()) {
+    return;
+  }
+  try {
+    // load the tar
+    archive.reset(new midgard::tar(traffic_extract));
+    // map files to graph ids
+    for (auto& c : archive->contents) {
+      try {
+        auto id = GraphTile::GetTileId(c.first);
+        tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
+      } catch (...) {
+        // It's possible to put non-tile files inside the tarfile.  As we're only
+        // parsing the file *name* as a GraphId here, we will just silently skip
+        // any file paths that can't be parsed by GraphId::GetTileId()
+        // If we end up with *no* recognizable tile files in the tarball at all,
+        // checks lower down will warn on that.
+      }
+    }
+    // couldn't load it
+    if (tiles.empty()) {
+      LOG_WARN("Traffic tile extract contained no usuable tiles");
+    } // loaded ok but with possibly bad blocks
+    else {
+      LOG_INFO("Traffic tile extract successfully loaded with tile count: " +
+               std::to_string(tiles.size()));
+      if (archive->corrupt_blocks) {
+        LOG_WARN("Traffic tile extract had " + std::to_string(archive->corrupt_blocks) +
+                 " corrupt blocks");
+      }
+    }
+  } catch (const std::exception& e) {
+    LOG_WARN(e.what());
+    LOG_WARN("Traffic tile extract could not be loaded");
+  }
+}
+
+uint64_t GraphReader::tile_extract_t::traffic_extract_t::updates() const {
+  uint64_t sum = 0;
+  for (const auto& tile : tiles) {
+    if (tile.second.second >= sizeof(TrafficTileHeader)) {
+      const auto* header = reinterpret_cast<const volatile TrafficTileHeader*>(tile.second.first);
+      sum += header->last_update + header->sequence;
+    }
+  }
+  return sum;
+}
+
+void GraphReader::tile_extract_t::watch_traffic(std::weak_ptr<tile_extract_t> extract,
+                                                std::string path,
+                                                std::chrono::milliseconds poll_interval,
+                                                const bool reload) {
+  // a new extract is renamed over the old one so we look for a different file rather than a
+  // newer mtime, that way speeds written into the current extract in place dont cause a reload
+  auto identify = [&path]() {
+    struct stat s;
+    return stat(path.c_str(), &s) == 0 ? std::make_pair(static_cast<uint64_t>(s.st_ino),
+                                                        static_cast<uint64_t>(s.st_size))
+                                       : std::make_pair(uint64_t(0), uint64_t(0));
+  };
+  auto last = identify();
+  uint64_t last_updates = 0;
+  if (auto self = extract.lock()) {
+    last_updates = self->traffic()->updates();
+  }
+
+  // until the extract goes away we keep checking for new speeds and a new file
+  while (true) {
+    std::this_thread::sleep_for(poll_interval);
+    auto self = extract.lock();
+    if (!self) {
+      return;
+    }
+    auto updates = self->traffic()->updates();
+    if (updates != last_updates) {
+      last_updates = updates;
+      self->traffic_updates.fetch_add(1, std::memory_order_release);
+    }
+    if (!reload) {
+      continue;
+    }
+    auto current = identify();
+    if (current == last || current.second == 0) {
+      continue;
+    }
+    last = current;
+
+    // the load happens here in the background, the readers only ever wait on the pointer swap
+    auto traffic = std::make_shared<const traffic_extract_t>(path);
+    if (traffic->tiles.empty()) {
+      LOG_WARN("Keeping the current traffic tile extract");
+      continue;
+    }
+    last_updates = traffic->updates();
+    std::atomic_store(&self->current_traffic, std::move(traffic));
+    self->traffic_generation.fetch_add(1, std::memory_order_release);
+  }
+}
+
+graph_tile_ptr GraphReader::tile_extract_t::view(const GraphId& base) const {
+  auto offset = view_offset(base);
+  if (offset >= view_indices.size() || view_indices[offset] == static_cast<uint32_t>(-1)) {
+    return nullptr;
+  }
+  return views[view_indices[offset]];
+}
+
+std::shared_ptr<GraphReader::tile_extract_t>
+GraphReader::tile_extract_t::create(const boost::property_tree::ptree& pt) {
+  auto extract = std::make_shared<GraphReader::tile_extract_t>(pt);
+  // speeds written into the traffic in place are always looked for so that nothing made from
+  // the old ones is kept, if you want it we also swap in newer traffic as it arrives
+  auto poll_interval = pt.get<float>("traffic_extract_poll_interval", 0.f);
+  auto traffic_extract = pt.get<std::string>("traffic_extract", "");
+  if (!traffic_extract.empty() && !extract->traffic()->tiles.empty()) {
+    bool reload = poll_interval > 0.f;
+    if (reload && !extract->views.empty()) {
+      LOG_WARN("traffic_extract_poll_interval can not be combined with tile_extract_views, "
+               "ignoring it");
+      reload = false;
+    }
+    if (!reload) {
+      poll_interval = TRAFFIC_UPDATE_POLL_INTERVAL;
+    }
+    std::thread(watch_traffic, std::weak_ptr<tile_extract_t>(extract), traffic_extract,
+                std::chrono::milliseconds(static_cast<int64_t>(poll_interval * 1000)), reload)
+        .detach();
+  }
+  return extract;
+}
+
+std::shared_ptr<const GraphReader::tile_extract_t> GraphReader::current_extract_;
+
 std::shared_ptr<const GraphReader::tile_extract_t>
 GraphReader::get_extract_instance(const boost::property_tree::ptree& pt) {
-  static std::shared_ptr<const GraphReader::tile_extract_t> tile_extract(
-      new GraphReader::tile_extract_t(pt));
-  return tile_extract;
+  static std::once_flag created;
+  std::call_once(created, [&pt]() {
+    std::atomic_store(&current_extract_, std::shared_ptr<const tile_extract_t>(
+                                             GraphReader::tile_extract_t::create(pt)));
+  });
+  return std::atomic_load(&current_extract_);
+}
+
+void GraphReader::ReloadTileset(const boost::property_tree::ptree& pt) {
+  static std::mutex reloading;
+  std::lock_guard<std::mutex> lock(reloading);
+  auto previous = get_extract_instance(pt);
+  auto extract = tile_extract_t::create(pt);
+  extract->tileset_generation = previous->tileset_generation + 1;
+  // the traffic generation keeps going up so that whatever was made from the old tiles is dropped
+  const auto traffic_generation = previous->traffic_generation.load(std::memory_order_acquire) +
+                                  previous->traffic_updates.load(std::memory_order_acquire);
+  extract->traffic_generation.fetch_add(traffic_generation + 1, std::memory_order_release);
+
+  // the first request on the new tiles shouldnt have to wait on the disk
+  if (pt.get<bool>("warm_up", false)) {
+    auto config = pt;
+    config.put("warm_up", false);
+    config.put("prefetch_threads", 0);
+    GraphReader warmer(config);
+    warmer.tile_extract_ = extract;
+    warmer.WarmUp(pt);
+  }
+
+  std::atomic_store(&current_extract_, std::shared_ptr<const tile_extract_t>(std::move(extract)));
+  LOG_INFO("Loaded tileset " + std::to_string(previous->tileset_generation + 1));
+}
+
+bool GraphReader::Refresh() {
+  auto current = std::atomic_load(&current_extract_);
+  if (!current || current->tileset_generation <= tile_extract_->tileset_generation) {
+    return false;
+  }
+
+  // nothing we have from the old tiles can be used with the new ones, the cache may be shared with
+  // readers that have not refreshed yet so we move on to the one of the new tileset
+  tile_extract_ = std::move(current);
+  traffic_generation_ = tile_extract_->traffic_generation.load(std::memory_order_acquire);
+  cache_.reset(TileCacheFactory::createTileCache(cache_config_, tile_extract_->tileset_generation));
+  cache_->Reserve(tile_extract_->tiles.empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
+  {
+    std::lock_guard<std::mutex> lock(_404s_lock);
+    _404s.clear();
+  }
+  if (prefetcher_) {
+    prefetcher_->clear();
+  }
+  if (opposing_edges_) {
+    opposing_edges_ =
+        get_mapped<OpposingEdges>(OpposingEdges::FileName(tile_dir_), "opposing edges",
+                                  tile_extract_->tileset_generation);
+  }
+  if (recovered_shortcuts_) {
+    recovered_shortcuts_ =
+        get_mapped<RecoveredShortcuts>(RecoveredShortcuts::FileName(tile_dir_),
+                                       "recovered shortcuts", tile_extract_->tileset_generation);
+  }
+  return true;
 }
 
 // ----------------------------------------------------------------------------
@@ -219,7 +547,7 @@ void SimpleTileCache::Trim() {
 
 // Constructor.
 TileCacheLRU::TileCacheLRU(size_t max_size, MemoryLimitControl mem_control)
-    : mem_control_(mem_control), cache_size_(0), max_cache_size_(max_size) {
+    : mem_control_(mem_control), cache_size_(0), max_cache_size_(max_size), hits_(0), misses_(0) {
 }
 
 void TileCacheLRU::Reserve(size_t tile_size) {
@@ -250,8 +578,10 @@ void TileCacheLRU::Trim() {
 graph_tile_ptr TileCacheLRU::Get(const GraphId& graphid) const {
   auto cached = cache_.find(graphid);
   if (cached == cache_.cend()) {
+    ++misses_;
     return nullptr;
   }
+  ++hits_;
 
   const KeyValueIter& entry_iter = cached->second;
   MoveToLruHead(entry_iter);
@@ -264,6 +594,7 @@ size_t TileCacheLRU::TrimToFit(const size_t required_size) {
   while ((OverCommitted() || (max_cache_size_ - cache_size_) < required_size) &&
          !key_val_lru_list_.empty()) {
     const KeyValue& entry_to_evict = key_val_lru_list_.back();
+    Evicting(entry_to_evict);
     const auto tile_size = entry_to_evict.tile->header()->end_offset();
     cache_size_ -= tile_size;
     freed_space += tile_size;
@@ -318,13 +649,222 @@ graph_tile_ptr TileCacheLRU::Put(const GraphId& graphid, graph_tile_ptr tile, si
   return key_val_lru_list_.front().tile;
 }
 
+TileCache::Stats TileCacheLRU::GetStats() const {
+  return {hits_, misses_, 0};
+}
+
+// ----------------------------------------------------------------------------
+// TileCacheLRUCompressed implementation
+// ----------------------------------------------------------------------------
+
+TileCacheLRUCompressed::TileCacheLRUCompressed(size_t max_size,
+                                               size_t max_compressed_size,
+                                               MemoryLimitControl mem_control)
+    : TileCacheLRU(max_size, mem_control), compressed_size_(0),
+      max_compressed_size_(max_compressed_size) {
+}
+
+bool TileCacheLRUCompressed::Contains(const GraphId& graphid) const {
+  return TileCacheLRU::Contains(graphid) || compressed_.find(graphid) != compressed_.cend();
+}
+
+void TileCacheLRUCompressed::Clear() {
+  TileCacheLRU::Clear();
+  compressed_.clear();
+  compressed_lru_list_.clear();
+  compressed_size_ = 0;
+}
+
+void TileCacheLRUCompressed::Evicting(const KeyValue& entry) {
+  const auto* tile_bytes = reinterpret_cast<const char*>(entry.tile->header());
+  const auto tile_size = entry.tile->header()->end_offset();
+
+  // deflate as fast as zlib can, the whole tile is there so its one pass
+  auto src_func = [tile_bytes, tile_size](z_stream& s) -> int {
+    s.next_in = const_cast<Byte*>(reinterpret_cast<const Byte*>(tile_bytes));
+    s.avail_in = static_cast<unsigned int>(tile_size);
+    return Z_FINISH;
+  };
+  std::vector<char> compressed;
+  auto dst_func = [&compressed, tile_size](z_stream& s) -> void {
+    auto size = compressed.size();
+    if (s.total_out < size) {
+      compressed.resize(s.total_out);
+    } else {
+      auto more = std::max<size_t>(tile_size / 4, 4096);
+      compressed.resize(size + more);
+      s.next_out = reinterpret_cast<Byte*>(compressed.data() + size);
+      s.avail_out = static_cast<unsigned int>(more);
+    }
+  };
+  if (!deflate(src_func, dst_func, Z_BEST_SPEED, false) ||
+      compressed.size() > max_compressed_size_) {
+    return;
+  }
+  compressed.shrink_to_fit();
+
+  // make room for it by dropping the tiles that were compressed the longest ago
+  while (compressed_size_ + compressed.size() > max_compressed_size_) {
+    const auto& oldest = compressed_lru_list_.back();
+    compressed_size_ -= oldest.bytes.size();
+    compressed_.erase(oldest.id);
+    compressed_lru_list_.pop_back();
+  }
+
+  compressed_size_ += compressed.size();
+  compressed_lru_list_.emplace_front(CompressedTile{entry.id, tile_size, std::move(compressed)});
+  compressed_[entry.id] = compressed_lru_list_.begin();
+}
+
+graph_tile_ptr TileCacheLRUCompressed::Get(const GraphId& graphid) const {
+  auto compressed = compressed_.find(graphid);
+  if (compressed == compressed_.end()) {
+    return TileCacheLRU::Get(graphid);
+  }
+
+  // we know exactly how big it will be so it inflates straight into its final buffer, the spare
+  // byte keeps zlib from ever running out of output space
+  auto entry = compressed->second;
+  std::vector<char> bytes(entry->size + 1);
+  size_t inflated_size = 0;
+  auto src_func = [&entry](z_stream& s) -> void {
+    s.next_in = reinterpret_cast<Byte*>(entry->bytes.data());
+    s.avail_in = static_cast<unsigned int>(entry->bytes.size());
+  };
+  auto dst_func = [&bytes, &inflated_size](z_stream& s) -> int {
+    if (s.total_out == 0) {
+      s.next_out = reinterpret_cast<Byte*>(bytes.data());
+      s.avail_out = static_cast<unsigned int>(bytes.size());
+    }
+    inflated_size = s.total_out;
+    return Z_NO_FLUSH;
+  };
+  const bool inflated = inflate(src_func, dst_func) && inflated_size == entry->size;
+  bytes.resize(entry->size);
+
+  // either way it leaves the compressed tier
+  compressed_size_ -= entry->bytes.size();
+  compressed_lru_list_.erase(entry);
+  compressed_.erase(compressed);
+  if (!inflated) {
+    LOG_ERROR("Failed to inflate cached tile " + std::to_string(graphid.value));
+    return TileCacheLRU::Get(graphid);
+  }
+
+  // the cache is only logically const, promoting the tile is just what a hit costs here
+  auto* self = const_cast<TileCacheLRUCompressed*>(this);
+  const auto size = bytes.size();
+  self->Put(graphid, GraphTile::Create(graphid, std::move(bytes)), size);
+  return TileCacheLRU::Get(graphid);
+}
+
+// ----------------------------------------------------------------------------
+// TileCacheTinyLFU implementation
+// ----------------------------------------------------------------------------
+
+TileCacheTinyLFU::FrequencySketch::FrequencySketch(size_t width) {
+  width = std::max(std::min(width, MAX_SKETCH_WIDTH), MIN_SKETCH_WIDTH);
+  size_t pow2 = 1;
+  while (pow2 < width) {
+    pow2 <<= 1;
+  }
+  counters_.resize(pow2 * SKETCH_DEPTH, 0);
+  mask_ = pow2 - 1;
+  additions_ = 0;
+  sample_size_ = pow2 * 10;
+}
+
+size_t TileCacheTinyLFU::FrequencySketch::Index(uint64_t key, size_t row) const {
+  static const uint64_t seeds[SKETCH_DEPTH] = {0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+                                               0x9ae16a3b2f90404full, 0xcbf29ce484222325ull};
+  uint64_t hash = (key + seeds[row]) * seeds[row];
+  hash ^= hash >> 32;
+  return row * (mask_ + 1) + (hash & mask_);
+}
+
+void TileCacheTinyLFU::FrequencySketch::Increment(const GraphId& graphid) {
+  const auto key = graphid.Tile_Base().value;
+  for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+    auto& counter = counters_[Index(key, row)];
+    if (counter < MAX_SKETCH_COUNT) {
+      ++counter;
+    }
+  }
+
+  // age the history so that tiles which used to be popular can be replaced
+  if (++additions_ == sample_size_) {
+    for (auto& counter : counters_) {
+      counter >>= 1;
+    }
+    additions_ /= 2;
+  }
+}
+
+uint8_t TileCacheTinyLFU::FrequencySketch::Estimate(const GraphId& graphid) const {
+  const auto key = graphid.Tile_Base().value;
+  uint8_t frequency = MAX_SKETCH_COUNT;
+  for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+    frequency = std::min(frequency, counters_[Index(key, row)]);
+  }
+  return frequency;
+}
+
+void TileCacheTinyLFU::FrequencySketch::Clear() {
+  std::fill(counters_.begin(), counters_.end(), 0);
+  additions_ = 0;
+}
+
+TileCacheTinyLFU::TileCacheTinyLFU(size_t max_size, MemoryLimitControl mem_control)
+    : TileCacheLRU(max_size, mem_control), sketch_(max_size / AVERAGE_TILE_SIZE), rejected_(0) {
+}
+
+void TileCacheTinyLFU::Reserve(size_t tile_size) {
+  TileCacheLRU::Reserve(tile_size);
+  sketch_ = FrequencySketch(max_cache_size_ / tile_size);
+}
+
+graph_tile_ptr TileCacheTinyLFU::Get(const GraphId& graphid) const {
+  sketch_.Increment(graphid);
+  return TileCacheLRU::Get(graphid);
+}
+
+graph_tile_ptr
+TileCacheTinyLFU::Put(const GraphId& graphid, graph_tile_ptr tile, size_t new_tile_size) {
+  // a tile only gets in when there is room or when it beats every tile it would push out
+  size_t free_space = cache_size_ < max_cache_size_ ? max_cache_size_ - cache_size_ : 0;
+  if (free_space < new_tile_size && cache_.find(graphid) == cache_.end()) {
+    const auto frequency = sketch_.Estimate(graphid);
+    for (auto victim = key_val_lru_list_.rbegin();
+         victim != key_val_lru_list_.rend() && free_space < new_tile_size; ++victim) {
+      if (sketch_.Estimate(victim->id) >= frequency) {
+        ++rejected_;
+        return tile;
+      }
+      free_space += victim->tile->header()->end_offset();
+    }
+  }
+
+  return TileCacheLRU::Put(graphid, std::move(tile), new_tile_size);
+}
+
+void TileCacheTinyLFU::Clear() {
+  TileCacheLRU::Clear();
+  sketch_.Clear();
+}
+
+TileCache::Stats TileCacheTinyLFU::GetStats() const {
+  return {hits_, misses_, rejected_};
+}
+
 // ----------------------------------------------------------------------------
 // SynchronizedTileCache implementation
 // ----------------------------------------------------------------------------
 
 // Constructor.
-SynchronizedTileCache::SynchronizedTileCache(TileCache& cache, std::mutex& mutex)
-    : cache_(cache), mutex_ref_(mutex) {
+SynchronizedTileCache::SynchronizedTileCache(std::shared_ptr<TileCache> cache,
+                                             std::shared_ptr<std::mutex> mutex)
+    : cache_ptr_(std::move(cache)), mutex_ptr_(std::move(mutex)), cache_(*cache_ptr_),
+      mutex_ref_(*mutex_ptr_) {
 }
 
 // Reserves enough cache to hold (max_cache_size / tile_size) items.
@@ -356,6 +896,11 @@ void SynchronizedTileCache::Trim() {
   cache_.Trim();
 }
 
+TileCache::Stats SynchronizedTileCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_ref_);
+  return cache_.GetStats();
+}
+
 // Get a pointer to a graph tile object given a GraphId.
 graph_tile_ptr SynchronizedTileCache::Get(const GraphId& graphid) const {
   std::lock_guard<std::mutex> lock(mutex_ref_);
@@ -368,37 +913,168 @@ graph_tile_ptr SynchronizedTileCache::Put(const GraphId& graphid, graph_tile_ptr
   return cache_.Put(graphid, std::move(tile), size);
 }
 
+// ----------------------------------------------------------------------------
+// ShardedTileCache implementation
+// ----------------------------------------------------------------------------
+
+ShardedTileCache::State::State(size_t max_size, size_t shard_count)
+    : shards(static_cast<size_t>(1) << shard_bits(shard_count)), cache_size(0),
+      max_cache_size(max_size), shard_shift(64 - shard_bits(shard_count)) {
+}
+
+// Constructor.
+ShardedTileCache::ShardedTileCache(size_t max_size, size_t shard_count)
+    : state_(std::make_shared<State>(max_size, shard_count)) {
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ShardedTileCache::Reserve(size_t tile_size) {
+  const auto per_shard = state_->max_cache_size / tile_size / state_->shards.size();
+  for (auto& shard : state_->shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.reserve(per_shard);
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ShardedTileCache::Contains(const GraphId& graphid) const {
+  auto& shard = get_shard(graphid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.cache.find(graphid) != shard.cache.end();
+}
+
+// Lets you know if the cache is too large.
+bool ShardedTileCache::OverCommitted() const {
+  return state_->cache_size.load(std::memory_order_relaxed) > state_->max_cache_size;
+}
+
+// Clears the cache.
+void ShardedTileCache::Clear() {
+  for (auto& shard : state_->shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    state_->cache_size -= shard.cache_size;
+    shard.cache_size = 0;
+    shard.cache.clear();
+  }
+}
+
+void ShardedTileCache::Trim() {
+  Clear();
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr ShardedTileCache::Get(const GraphId& graphid) const {
+  auto& shard = get_shard(graphid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto cached = shard.cache.find(graphid);
+  if (cached != shard.cache.end()) {
+    return cached->second;
+  }
+  return nullptr;
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr ShardedTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  auto& shard = get_shard(graphid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto inserted = shard.cache.emplace(graphid, std::move(tile));
+  // only account for the tile if we didnt lose a race with another thread loading it
+  if (inserted.second) {
+    shard.cache_size += size;
+    state_->cache_size += size;
+  }
+  return inserted.first->second;
+}
+
 // Constructs tile cache.
-TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
+TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt,
+                                             const uint64_t tileset_generation) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
 
   bool use_lru_cache = pt.get<bool>("use_lru_mem_cache", false);
   auto lru_mem_control = pt.get<bool>("lru_mem_cache_hard_control", false)
                              ? TileCacheLRU::MemoryLimitControl::HARD
                              : TileCacheLRU::MemoryLimitControl::SOFT;
+  bool use_tinylfu = pt.get<bool>("lru_mem_cache_tinylfu", false);
+  size_t compressed_cache_size = pt.get<size_t>("lru_compressed_cache_size", 0);
+  // traffic is attached per tile load, it would be lost when inflating a tile from memory
+  if (compressed_cache_size && !pt.get<std::string>("traffic_extract", "").empty()) {
+    LOG_WARN("lru_compressed_cache_size can not be combined with a traffic_extract, ignoring it");
+    compressed_cache_size = 0;
+  }
 
   bool use_simple_cache = pt.get<bool>("use_simple_mem_cache", false);
 
+  // tiles shared with the other processes on the host, traffic is attached per process when
+  // loading tiles so it cant go into the segment
+  auto shared_cache_path = pt.get<std::string>("shared_cache_path", "");
+  if (!shared_cache_path.empty()) {
+    if (pt.get<std::string>("traffic_extract", "").empty()) {
+      return new SharedMemoryTileCache(shared_cache_path,
+                                       pt.get<size_t>("shared_cache_size", max_cache_size),
+                                       max_cache_size, tileset_generation);
+    }
+    LOG_WARN("shared_cache_path can not be combined with a traffic_extract, ignoring it");
+  }
+
+  // a process wide cache split into independently locked shards, the copies all share one state.
+  // every tileset gets a cache of its own so that readers which have not refreshed yet cant hand
+  // their old tiles to the ones that have, a reader still on an older tileset gets a private one
+  if (pt.get<bool>("global_synchronized_cache", false) &&
+      pt.get<size_t>("synchronized_cache_shards", 0) > 1) {
+    static std::shared_ptr<ShardedTileCache> globalShardedCache_;
+    static uint64_t globalShardedGeneration_ = 0;
+    static std::mutex factoryMutex;
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    if (globalShardedCache_ && tileset_generation < globalShardedGeneration_) {
+      return new ShardedTileCache(max_cache_size, pt.get<size_t>("synchronized_cache_shards"));
+    }
+    if (!globalShardedCache_ || tileset_generation > globalShardedGeneration_) {
+      globalShardedCache_.reset(
+          new ShardedTileCache(max_cache_size, pt.get<size_t>("synchronized_cache_shards")));
+      globalShardedGeneration_ = tileset_generation;
+    }
+    return new ShardedTileCache(*globalShardedCache_);
+  }
+
   // wrap tile cache with thread-safe version
   if (pt.get<bool>("global_synchronized_cache", false)) {
-    // Handle synchronization of cache
-    static std::mutex globalCacheMutex_;
+    auto make_cache = [&]() -> TileCache* {
+      if (use_lru_cache && compressed_cache_size) {
+        return new TileCacheLRUCompressed(max_cache_size, compressed_cache_size, lru_mem_control);
+      } else if (use_lru_cache && use_tinylfu) {
+        return new TileCacheTinyLFU(max_cache_size, lru_mem_control);
+      } else if (use_lru_cache) {
+        return new TileCacheLRU(max_cache_size, lru_mem_control);
+      }
+      return new FlatTileCache(max_cache_size);
+    };
+    // Handle synchronization of cache, the readers of older tilesets keep theirs alive
+    static std::shared_ptr<std::mutex> globalCacheMutex_;
     static std::shared_ptr<TileCache> globalTileCache_;
+    static uint64_t globalCacheGeneration_ = 0;
     // We need to lock the factory method itself to prevent races
     static std::mutex factoryMutex;
     std::lock_guard<std::mutex> lock(factoryMutex);
-    if (!globalTileCache_) {
-      if (use_lru_cache) {
-        globalTileCache_.reset(new TileCacheLRU(max_cache_size, lru_mem_control));
-      } else {
-        // globalTileCache_.reset(new SimpleTileCache(max_cache_size));
-        globalTileCache_.reset(new FlatTileCache(max_cache_size));
-      }
+    if (globalTileCache_ && tileset_generation < globalCacheGeneration_) {
+      return new SynchronizedTileCache(std::shared_ptr<TileCache>(make_cache()),
+                                       std::make_shared<std::mutex>());
     }
-    return new SynchronizedTileCache(*globalTileCache_, globalCacheMutex_);
+    if (!globalTileCache_ || tileset_generation > globalCacheGeneration_) {
+      globalTileCache_.reset(make_cache());
+      globalCacheMutex_ = std::make_shared<std::mutex>();
+      globalCacheGeneration_ = tileset_generation;
+    }
+    return new SynchronizedTileCache(globalTileCache_, globalCacheMutex_);
   }
 
-  // or do you want to use an LRU cache
+  // or do you want to use an LRU cache, optionally guarded by how often tiles are used
+  if (use_lru_cache && compressed_cache_size) {
+    return new TileCacheLRUCompressed(max_cache_size, compressed_cache_size, lru_mem_control);
+  }
+  if (use_lru_cache && use_tinylfu) {
+    return new TileCacheTinyLFU(max_cache_size, lru_mem_control);
+  }
   if (use_lru_cache) {
     return new TileCacheLRU(max_cache_size, lru_mem_control);
   }
@@ -416,12 +1092,19 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                          std::unique_ptr<tile_getter_t>&& tile_getter)
     : tile_extract_(get_extract_instance(pt)), tile_dir_(pt.get<std::string>("tile_dir", "")),
+      tile_dir_mmap_(pt.get<bool>("tile_dir_mmap", false)),
+      traffic_generation_(tile_extract_->traffic_generation.load(std::memory_order_acquire)),
       tile_getter_(std::move(tile_getter)),
       max_concurrent_users_(pt.get<size_t>("max_concurrent_reader_users", 1)),
-      tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)) {
+      tile_url_(pt.get<std::string>("tile_url", "")), cache_config_(pt),
+      cache_(TileCacheFactory::createTileCache(pt, tile_extract_->tileset_generation)) {
 
   // Make a tile fetcher if we havent passed one in from somewhere else
-  if (!tile_getter_ && !tile_url_.empty()) {
+  if (!tile_getter_ && !tile_url_.empty() && pt.get<bool>("tile_url_multiplex", false)) {
+    tile_getter_ = std::make_unique<curl_multi_tile_getter_t>(max_concurrent_users_,
+                                                              pt.get<std::string>("user_agent", ""),
+                                                              pt.get<bool>("tile_url_gz", false));
+  } else if (!tile_getter_ && !tile_url_.empty()) {
     tile_getter_ = std::make_unique<curl_tile_getter_t>(max_concurrent_users_,
                                                         pt.get<std::string>("user_agent", ""),
                                                         pt.get<bool>("tile_url_gz", false));
@@ -446,10 +1129,41 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                                                            : GetTileSet());
   }
 
+  // The opposing edges written by mjolnir spare looking at the end nodes of the edges
+  if (pt.get<bool>("opposing_edges", false)) {
+    opposing_edges_ =
+        get_mapped<OpposingEdges>(OpposingEdges::FileName(tile_dir_), "opposing edges",
+                                  tile_extract_->tileset_generation);
+  }
+
+  // Warm up the tiles once per process before anything else reads them
+  if (pt.get<bool>("warm_up", false)) {
+    static std::once_flag warmed_up;
+    std::call_once(warmed_up, [this, &pt]() { WarmUp(pt); });
+  }
+
+  // So do the shortcuts recovered by mjolnir, the cache below is only needed without them
+  if (pt.get<bool>("shortcut_recovery", false)) {
+    recovered_shortcuts_ = get_mapped<RecoveredShortcuts>(RecoveredShortcuts::FileName(tile_dir_),
+                                                          "recovered shortcuts",
+                                                          tile_extract_->tileset_generation);
+  }
+
   // Fill shortcut recovery cache if requested or by default in memmap mode
-  if (pt.get<bool>("shortcut_caching", false)) {
+  if (!recovered_shortcuts_ && pt.get<bool>("shortcut_caching", false)) {
     shortcut_recovery_t::get_instance(this);
   }
+
+  // Background tile loading only makes sense if tiles arent already mmapped
+  auto prefetch_threads = pt.get<size_t>("prefetch_threads", 0);
+  if (prefetch_threads && tile_extract_->tiles.empty()) {
+    prefetcher_ = std::make_shared<tile_prefetcher_t>(prefetch_threads,
+                                                      pt.get<size_t>("prefetch_max_tiles",
+                                                                     DEFAULT_PREFETCH_MAX_TILES),
+                                                      [this](const GraphId& base) {
+                                                        return LoadGraphTile(base);
+                                                      });
+  }
 }
 
 // Method to test if tile exists
@@ -474,18 +1188,6 @@ bool GraphReader::DoesTileExist(const GraphId& graphid) const {
          stat((file_location + ".gz").c_str(), &buffer) == 0;
 }
 
-class TarballGraphMemory final : public GraphMemory {
-public:
-  TarballGraphMemory(std::shared_ptr<midgard::tar> archive, std::pair<char*, size_t> position)
-      : archive_(std::move(archive)) {
-    data = position.first;
-    size = position.second;
-  }
-
-private:
-  const std::shared_ptr<midgard::tar> archive_;
-};
-
 // Get a pointer to a graph tile object given a GraphId. Return nullptr
 // if the tile is not found/empty
 graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
@@ -496,12 +1198,27 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     return nullptr;
   }
 
-  // Check if the level/tileid combination is in the cache
+  // The extract already has every tile ready to go so we just index into it
   auto base = graphid.Tile_Base();
+  if (!tile_extract_->views.empty()) {
+    return tile_extract_->view(base);
+  }
+
+  // Tiles made with traffic that has since been replaced have to go, anyone still using them
+  // keeps the old traffic around until they are done
+  auto traffic_generation = tile_extract_->traffic_generation.load(std::memory_order_acquire);
+  if (traffic_generation != traffic_generation_) {
+    traffic_generation_ = traffic_generation;
+    cache_->Clear();
+  }
+
+  // Check if the level/tileid combination is in the cache
   if (const auto& cached = cache_->Get(base)) {
     // LOG_DEBUG("Memory cache hit " + GraphTile::FileSuffix(base));
+    VALHALLA_TRACE1(tile_hit, base.value);
     return cached;
   }
+  VALHALLA_TRACE1(tile_miss, base.value);
 
   // Try getting it from the memmapped tar extract
   if (!tile_extract_->tiles.empty()) {
@@ -513,14 +1230,17 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     }
     auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
 
-    auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
+    auto traffic = tile_extract_->traffic();
+    auto traffic_ptr = traffic->tiles.find(base);
+    auto traffic_memory = traffic_ptr != traffic->tiles.end()
+                              ? std::make_unique<TarballGraphMemory>(traffic->archive,
                                                                      traffic_ptr->second)
                               : nullptr;
 
     // This initializes the tile from mmap
+    VALHALLA_TRACE1(tile_load_start, base.value);
     auto tile = GraphTile::Create(base, std::move(memory), std::move(traffic_memory));
+    VALHALLA_TRACE2(tile_load_done, base.value, tile ? tile->header()->end_offset() : 0);
     if (!tile) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
@@ -532,48 +1252,256 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     return cache_->Put(base, std::move(tile), size);
   } // Try getting it from flat file
   else {
-    auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
-                                                                     traffic_ptr->second)
-                              : nullptr;
-
-    // Try to get it from disk and if we cant..
-    graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
-    if (!tile || !tile->header()) {
-      if (!tile_getter_) {
+    // Maybe it was (or is being) loaded in the background, otherwise we load it ourselves
+    graph_tile_ptr tile = prefetcher_ ? prefetcher_->take(base) : nullptr;
+    if (!tile) {
+      VALHALLA_TRACE1(tile_load_start, base.value);
+      tile = LoadGraphTile(base);
+      VALHALLA_TRACE2(tile_load_done, base.value, tile ? tile->header()->end_offset() : 0);
+      if (!tile) {
         return nullptr;
       }
+    }
 
-      {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        if (_404s.find(base) != _404s.end()) {
-          // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
-          return nullptr;
-        }
-      }
+    // Keep a copy in the cache and return it
+    const size_t size = tile->header()->end_offset();
+    return cache_->Put(base, std::move(tile), size);
+  }
+}
 
-      // Get it from the url and cache it to disk if you can
-      tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
-      if (!tile) {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        _404s.insert(base);
+// Load a tile from disk or the url without touching the cache. This has to stay thread safe
+// because the prefetcher calls it from its own threads
+graph_tile_ptr GraphReader::GetLinkedGraphTile(const GraphId& graphid, const graph_tile_ptr& from) {
+  auto tile = GetGraphTile(graphid);
+  // only the views are sure to outlive each other, tiles from anywhere else never get links
+  if (tile && tile_extract_->view(from->id()) == from) {
+    from->links().link(tile.get());
+  }
+  return tile;
+}
+
+graph_tile_ptr GraphReader::LoadGraphTile(const GraphId& base) {
+  auto traffic = tile_extract_->traffic();
+  auto traffic_ptr = traffic->tiles.find(base);
+  auto traffic_memory = traffic_ptr != traffic->tiles.end()
+                            ? std::make_unique<TarballGraphMemory>(traffic->archive,
+                                                                   traffic_ptr->second)
+                            : nullptr;
+
+  // Try to get it from disk and if we cant..
+  graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory), tile_dir_mmap_);
+  if (!tile || !tile->header()) {
+    if (!tile_getter_) {
+      return nullptr;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      if (_404s.find(base) != _404s.end()) {
         // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
         return nullptr;
       }
-      // LOG_DEBUG("Url cache hit " + GraphTile::FileSuffix(base));
-    } else {
-      // LOG_DEBUG("Disk cache hit " + GraphTile::FileSuffix(base));
     }
 
-    // Keep a copy in the cache and return it
-    const size_t size = tile->header()->end_offset();
-    return cache_->Put(base, std::move(tile), size);
+    // Get it from the url and cache it to disk if you can
+    tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
+    if (!tile) {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      _404s.insert(base);
+      // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
+      return nullptr;
+    }
+    // LOG_DEBUG("Url cache hit " + GraphTile::FileSuffix(base));
+  } else {
+    // LOG_DEBUG("Disk cache hit " + GraphTile::FileSuffix(base));
   }
+  return tile;
+}
+
+// Fetch a batch of tiles from the url at once
+size_t GraphReader::FetchTiles(const std::vector<GraphId>& tile_ids) {
+  if (!tile_getter_ || !tile_extract_->tiles.empty()) {
+    return 0;
+  }
+
+  // only ask for what we dont have yet
+  std::vector<GraphId> missing;
+  {
+    std::lock_guard<std::mutex> lock(_404s_lock);
+    std::unordered_set<GraphId> requested;
+    for (const auto& tile_id : tile_ids) {
+      auto base = tile_id.Tile_Base();
+      if (!base.Is_Valid() || base.level() > TileHierarchy::get_max_level()) {
+        continue;
+      }
+      // skip what is already in memory, on disk, known to be missing or asked for already
+      if (cache_->Contains(base) || DoesTileExist(base) || _404s.find(base) != _404s.end() ||
+          !requested.insert(base).second) {
+        continue;
+      }
+      missing.push_back(base);
+    }
+  }
+
+  // fetch them all at once and keep them in the cache like GetGraphTile would
+  auto tiles = GraphTile::CacheTileURLs(tile_url_, missing, tile_getter_.get(), tile_dir_);
+  size_t fetched = 0;
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    if (!tiles[i] || !tiles[i]->header()) {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      _404s.insert(missing[i]);
+      continue;
+    }
+    const size_t size = tiles[i]->header()->end_offset();
+    cache_->Put(missing[i], std::move(tiles[i]), size);
+    ++fetched;
+  }
+  return fetched;
+}
+
+// Pull tiles into memory before the first requests need them
+size_t GraphReader::WarmUp(const boost::property_tree::ptree& pt) {
+  // either the tiles in the bbox or every tile we have
+  std::vector<GraphId> tile_ids;
+  auto bbox = pt.get<std::string>("warm_up_bbox", "");
+  if (!bbox.empty()) {
+    std::vector<double> coords;
+    std::stringstream ss(bbox);
+    for (std::string coord; std::getline(ss, coord, ',');) {
+      coords.push_back(std::stod(coord));
+    }
+    if (coords.size() != 4) {
+      throw std::runtime_error("warm_up_bbox must be min_x,min_y,max_x,max_y");
+    }
+    tile_ids = TileHierarchy::GetGraphIds({coords[0], coords[1], coords[2], coords[3]});
+  } else {
+    auto tile_set = GetTileSet();
+    tile_ids.assign(tile_set.begin(), tile_set.end());
+  }
+
+  // maybe only some levels
+  if (auto levels = pt.get_child_optional("warm_up_levels")) {
+    std::unordered_set<uint32_t> wanted;
+    for (const auto& level : *levels) {
+      wanted.insert(level.second.get_value<uint32_t>());
+    }
+    tile_ids.erase(std::remove_if(tile_ids.begin(), tile_ids.end(),
+                                  [&wanted](const GraphId& id) {
+                                    return wanted.find(id.level()) == wanted.end();
+                                  }),
+                   tile_ids.end());
+  }
+  if (tile_ids.empty()) {
+    return 0;
+  }
+
+  // each thread takes the next tile until there are none left
+  auto thread_count =
+      std::max(pt.get<size_t>("warm_up_threads", std::thread::hardware_concurrency()),
+               static_cast<size_t>(1));
+  LOG_INFO("Warming up " + std::to_string(tile_ids.size()) + " tiles with " +
+           std::to_string(thread_count) + " threads");
+  std::atomic<size_t> next(0), done(0), warmed(0);
+  auto warm_up = [&]() {
+    for (size_t i; (i = next++) < tile_ids.size();) {
+      warmed += WarmUpTile(tile_ids[i]);
+      auto count = ++done;
+      if (count * 10 / tile_ids.size() != (count - 1) * 10 / tile_ids.size()) {
+        LOG_INFO("Warmed up " + std::to_string(count * 100 / tile_ids.size()) + "% of tiles");
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back(warm_up);
+  }
+  warm_up();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG_INFO("Warmed up " + std::to_string(warmed.load()) + " tiles");
+  return warmed;
+}
+
+bool GraphReader::WarmUpTile(const GraphId& base) const {
+  // the extract is already mapped, we just need the pages to be resident
+  if (!tile_extract_->tiles.empty()) {
+    auto t = tile_extract_->tiles.find(base);
+    if (t == tile_extract_->tiles.cend()) {
+      return false;
+    }
+    touch_memory(t->second.first, t->second.second);
+    auto traffic = tile_extract_->traffic();
+    auto traffic_tile = traffic->tiles.find(base);
+    if (traffic_tile != traffic->tiles.cend()) {
+      touch_memory(traffic_tile->second.first, traffic_tile->second.second);
+    }
+    return true;
+  }
+
+  // otherwise reading the file leaves it in the page cache
+  if (tile_dir_.empty()) {
+    return false;
+  }
+  auto file_location =
+      tile_dir_ + filesystem::path::preferred_separator + GraphTile::FileSuffix(base);
+  std::ifstream file(file_location, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    file.open(file_location + ".gz", std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+      return false;
+    }
+  }
+  std::vector<char> buffer(WARM_UP_READ_SIZE);
+  while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+  }
+  return true;
+}
+
+// Queue a tile for loading in the background if we dont have it yet
+void GraphReader::Prefetch(const GraphId& graphid) {
+  if (!prefetcher_ || !graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level()) {
+    return;
+  }
+  auto base = graphid.Tile_Base();
+  if (!cache_->Contains(base)) {
+    prefetcher_->enqueue(base);
+  }
+}
+
+// Queue the tile and the 8 tiles surrounding it on the same level
+void GraphReader::PrefetchNeighbors(const GraphId& graphid) {
+  if (!prefetcher_ || !graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level()) {
+    return;
+  }
+  const auto& tiles = graphid.level() == TileHierarchy::GetTransitLevel().level
+                          ? TileHierarchy::GetTransitLevel().tiles
+                          : TileHierarchy::levels()[graphid.level()].tiles;
+  const int32_t center = graphid.tileid();
+  for (auto row : {tiles.BottomNeighbor(center), center, tiles.TopNeighbor(center)}) {
+    for (auto tileid : {tiles.LeftNeighbor(row), row, tiles.RightNeighbor(row)}) {
+      Prefetch(GraphId(tileid, graphid.level(), 0));
+    }
+  }
+}
+
+// Get the counters of the background tile loading
+GraphReader::PrefetchStats GraphReader::GetPrefetchStats() const {
+  if (!prefetcher_) {
+    return {};
+  }
+  return {prefetcher_->requested.load(), prefetcher_->loaded.load(), prefetcher_->hits.load(),
+          prefetcher_->misses.load(), prefetcher_->waits.load()};
 }
 
 // Convenience method to get an opposing directed edge graph Id.
 GraphId GraphReader::GetOpposingEdgeId(const GraphId& edgeid, graph_tile_ptr& opp_tile) {
+  // When it is stored only the tile of the opposing edge is needed
+  GraphId id;
+  if (opposing_edges_ && opposing_edges_->Find(edgeid, id)) {
+    return id.Is_Valid() && GetGraphTile(id, opp_tile) ? id : GraphId{};
+  }
+
   // If you cant get the tile you get an invalid id
   auto tile = opp_tile;
   if (!GetGraphTile(edgeid, tile)) {
@@ -587,7 +1515,7 @@ GraphId GraphReader::GetOpposingEdgeId(const GraphId& edgeid, graph_tile_ptr& op
   };
 
   // If edge leaves the tile get the end node's tile
-  GraphId id = directededge->endnode();
+  id = directededge->endnode();
   if (!GetGraphTile(id, opp_tile)) {
     return {};
   };
@@ -755,6 +1683,10 @@ GraphId GraphReader::GetShortcut(const GraphId& id) {
 
 // Unpack edges for a given shortcut edge
 std::vector<GraphId> GraphReader::RecoverShortcut(const GraphId& shortcut_id) {
+  std::vector<GraphId> edges;
+  if (recovered_shortcuts_ && recovered_shortcuts_->Find(shortcut_id, edges)) {
+    return edges;
+  }
   return shortcut_recovery_t::get_instance().get(shortcut_id, *this);
 }
 
@@ -914,7 +1846,7 @@ IncidentResult GraphReader::GetIncidents(const GraphId& edge_id, graph_tile_ptr&
   // if we are not doing this for any reason then bail
   std::shared_ptr<const valhalla::IncidentsTile> itile;
   if (!enable_incidents_ || !GetGraphTile(edge_id, tile) ||
-      !tile->trafficspeed(tile->directededge(edge_id)).has_incidents ||
+      !tile->load_trafficspeed(tile->directededge(edge_id)).has_incidents ||
       !(itile = GetIncidentTile(edge_id))) {
     return {};
   }
@@ -9,6 +9,7 @@
 #include "midgard/pointll.h"
 #include "midgard/tiles.h"
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <chrono>
 #include <cmath>
@@ -24,6 +25,13 @@
 #include <utility>
 #include <vector>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace valhalla::midgard;
 
 namespace {
@@ -47,6 +55,25 @@ std::string GenerateTmpSuffix() {
   return ss.str();
 }
 
+// binary search the lane connections and access restrictions of a tile by their edge
+struct lane_connectivity_less_t {
+  bool operator()(const valhalla::baldr::LaneConnectivity& lc, const uint32_t idx) const {
+    return lc.to() < idx;
+  }
+  bool operator()(const uint32_t idx, const valhalla::baldr::LaneConnectivity& lc) const {
+    return idx < lc.to();
+  }
+};
+
+struct access_restriction_less_t {
+  bool operator()(const valhalla::baldr::AccessRestriction& res, const uint32_t idx) const {
+    return res.edgeindex() < idx;
+  }
+  bool operator()(const uint32_t idx, const valhalla::baldr::AccessRestriction& res) const {
+    return idx < res.edgeindex();
+  }
+};
+
 } // namespace
 
 namespace valhalla {
@@ -63,6 +90,43 @@ private:
   const std::vector<char> memory_;
 };
 
+#ifndef _WIN32
+// Maps a whole uncompressed tile file read only so that processes on the same host share the
+// page cache rather than each keeping their own heap copy of the tile
+class MMapGraphMemory final : public GraphMemory {
+public:
+  // returns nullptr if the file couldnt be mapped so that the caller can fall back to reading it
+  static std::unique_ptr<const MMapGraphMemory> map(const std::string& file_location) {
+    int fd = open(file_location.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return nullptr;
+    }
+    struct stat s;
+    if (fstat(fd, &s) == -1 || s.st_size == 0) {
+      close(fd);
+      return nullptr;
+    }
+    void* ptr = mmap(nullptr, s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      return nullptr;
+    }
+    return std::unique_ptr<const MMapGraphMemory>(new MMapGraphMemory(ptr, s.st_size));
+  }
+
+  ~MMapGraphMemory() {
+    munmap(data, size);
+  }
+
+private:
+  MMapGraphMemory(void* ptr, size_t length) {
+    data = static_cast<char*>(ptr);
+    size = length;
+  }
+};
+#endif
+
 graph_tile_ptr GraphTile::DecompressTile(const GraphId& graphid,
                                          const std::vector<char>& compressed) {
   // for setting where to read compressed data from
@@ -102,16 +166,27 @@ graph_tile_ptr GraphTile::DecompressTile(const GraphId& graphid,
 // Constructor given a filename. Reads the graph data into memory.
 graph_tile_ptr GraphTile::Create(const std::string& tile_dir,
                                  const GraphId& graphid,
-                                 std::unique_ptr<const GraphMemory>&& traffic_memory) {
+                                 std::unique_ptr<const GraphMemory>&& traffic_memory,
+                                 bool mmap_tile) {
 
   // Don't bother with invalid ids
   if (!graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level() || tile_dir.empty()) {
     return nullptr;
   }
 
-  // Open to the end of the file so we can immediately get size
   const std::string file_location =
       tile_dir + filesystem::path::preferred_separator + FileSuffix(graphid.Tile_Base());
+
+#ifndef _WIN32
+  // Map the file instead of copying it, if that doesnt work we just read it below
+  if (mmap_tile) {
+    if (auto memory = MMapGraphMemory::map(file_location)) {
+      return new GraphTile(graphid, std::move(memory), std::move(traffic_memory));
+    }
+  }
+#endif
+
+  // Open to the end of the file so we can immediately get size
   std::ifstream file(file_location, std::ios::in | std::ios::binary | std::ios::ate);
   if (file.is_open()) {
     // Read binary file into memory. TODO - protect against failure to allocate memory
@@ -216,21 +291,54 @@ graph_tile_ptr GraphTile::CacheTileURL(const std::string& tile_url,
   if (result.status_ != tile_getter_t::status_code_t::SUCCESS) {
     return nullptr;
   }
+  return CacheTileBytes(graphid, std::move(result.bytes_), tile_getter->gzipped(), cache_location);
+}
+
+std::vector<graph_tile_ptr> GraphTile::CacheTileURLs(const std::string& tile_url,
+                                                     const std::vector<GraphId>& graphids,
+                                                     tile_getter_t* tile_getter,
+                                                     const std::string& cache_location) {
+  // ask for all of the valid ones at once
+  std::vector<std::string> uris;
+  std::vector<size_t> requested;
+  for (size_t i = 0; i < graphids.size(); ++i) {
+    if (graphids[i].Is_Valid() && graphids[i].level() <= TileHierarchy::get_max_level()) {
+      uris.emplace_back(MakeSingleTileUrl(tile_url, graphids[i]));
+      requested.push_back(i);
+    }
+  }
+  auto results = tile_getter->get_batch(uris);
+
+  // turn them into tiles as they arrive
+  std::vector<graph_tile_ptr> tiles(graphids.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto result = results[i].get();
+    if (result.status_ == tile_getter_t::status_code_t::SUCCESS) {
+      tiles[requested[i]] = CacheTileBytes(graphids[requested[i]], std::move(result.bytes_),
+                                           tile_getter->gzipped(), cache_location);
+    }
+  }
+  return tiles;
+}
+
+graph_tile_ptr GraphTile::CacheTileBytes(const GraphId& graphid,
+                                         std::vector<char>&& bytes,
+                                         bool gzipped,
+                                         const std::string& cache_location) {
   // try to cache it on disk so we dont have to keep fetching it from url
   if (!cache_location.empty()) {
-    auto suffix = FileSuffix(graphid.Tile_Base(),
-                             (tile_getter->gzipped() ? valhalla::baldr::SUFFIX_COMPRESSED
-                                                     : valhalla::baldr::SUFFIX_NON_COMPRESSED));
+    auto suffix = FileSuffix(graphid.Tile_Base(), (gzipped ? valhalla::baldr::SUFFIX_COMPRESSED
+                                                           : valhalla::baldr::SUFFIX_NON_COMPRESSED));
     auto disk_location = cache_location + filesystem::path::preferred_separator + suffix;
-    SaveTileToFile(result.bytes_, disk_location);
+    SaveTileToFile(bytes, disk_location);
   }
 
   // turn the memory into a tile
-  if (tile_getter->gzipped()) {
-    return DecompressTile(graphid, result.bytes_);
+  if (gzipped) {
+    return DecompressTile(graphid, bytes);
   }
 
-  return new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(result.bytes_)));
+  return new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(bytes)));
 }
 
 GraphTile::~GraphTile() = default;
@@ -252,8 +360,11 @@ void GraphTile::Initialize(const GraphId& graphid) {
   header_ = reinterpret_cast<GraphTileHeader*>(ptr);
   ptr += sizeof(GraphTileHeader);
 
-  if (header_->end_offset() != tile_size)
-    throw std::runtime_error("Mismatch in end offset = " + std::to_string(header_->end_offset()) +
+  // a compact tile ends with its deflated sections rather than at the end offset
+  const auto compressed_offset = header_->compressed_sections_offset();
+  const size_t size = compressed_offset ? compressed_offset : header_->end_offset();
+  if ((compressed_offset == 0 && size != tile_size) || size > tile_size)
+    throw std::runtime_error("Mismatch in end offset = " + std::to_string(size) +
                              " vs raw tile data size = " + std::to_string(tile_size) +
                              ". Tile file might me corrupted");
 
@@ -281,10 +392,21 @@ void GraphTile::Initialize(const GraphId& graphid) {
   access_restrictions_ = reinterpret_cast<AccessRestriction*>(ptr);
   ptr += header_->access_restriction_count() * sizeof(AccessRestriction);
 
+  // Set a pointer to the truck restriction summaries, if there are any
+  if (header_->truck_restrictions_offset()) {
+    truck_restrictions_ = reinterpret_cast<const TruckRestrictions*>(ptr);
+    ptr += TruckRestrictions::SectionSize(header_->directededgecount());
+  }
+
   // Set a pointer to the transit departure list
   departures_ = reinterpret_cast<TransitDeparture*>(ptr);
   ptr += header_->departurecount() * sizeof(TransitDeparture);
 
+  // The departures are indexed the first time any are looked up
+  if (header_->departurecount()) {
+    departure_index_.reset(new departure_index_t());
+  }
+
   // Set a pointer to the transit stop list
   transit_stops_ = reinterpret_cast<TransitStop*>(ptr);
   ptr += header_->stopcount() * sizeof(TransitStop);
@@ -313,6 +435,12 @@ void GraphTile::Initialize(const GraphId& graphid) {
   admins_ = reinterpret_cast<Admin*>(ptr);
   ptr += header_->admincount() * sizeof(Admin);
 
+  // Set a pointer to the edge bounds, if there are any
+  if (header_->edge_bounds_offset()) {
+    edge_bounds_ = reinterpret_cast<const EdgeBounds*>(ptr);
+    ptr += header_->directededgecount() * sizeof(EdgeBounds);
+  }
+
   // Set a pointer to the edge bin list
   edge_bins_ = reinterpret_cast<GraphId*>(ptr);
 
@@ -326,6 +454,11 @@ void GraphTile::Initialize(const GraphId& graphid) {
   complex_restriction_reverse_size_ =
       header_->edgeinfo_offset() - header_->complex_restriction_reverse_offset();
 
+  // The restrictions are indexed the first time any are looked up
+  if (complex_restriction_forward_size_ || complex_restriction_reverse_size_) {
+    restriction_index_.reset(new restriction_index_t());
+  }
+
   // Start of edge information and its size
   edgeinfo_ = tile_ptr + header_->edgeinfo_offset();
   edgeinfo_size_ = header_->textlist_offset() - header_->edgeinfo_offset();
@@ -334,21 +467,34 @@ void GraphTile::Initialize(const GraphId& graphid) {
   textlist_ = tile_ptr + header_->textlist_offset();
   textlist_size_ = header_->lane_connectivity_offset() - header_->textlist_offset();
 
-  // Start of lane connections and their size
+  // Start of lane connections and their size, they go on to the elevation profiles if there are
+  // any and then to the predicted speeds
+  const uint32_t predictedspeeds_offset = header_->predictedspeeds_count() > 0
+                                              ? header_->predictedspeeds_offset()
+                                              : header_->end_offset();
+  const uint32_t elevation_profiles_offset = header_->elevation_profiles_offset()
+                                                 ? header_->elevation_profiles_offset()
+                                                 : predictedspeeds_offset;
   lane_connectivity_ =
       reinterpret_cast<LaneConnectivity*>(tile_ptr + header_->lane_connectivity_offset());
-  lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
+  lane_connectivity_size_ = elevation_profiles_offset - header_->lane_connectivity_offset();
+
+  // Start of the elevation profiles and their size, a compact tile has them with the lane
+  // connections so they are only pointed at once those are inflated
+  elevation_profiles_size_ = predictedspeeds_offset - elevation_profiles_offset;
+  if (!header_->compressed_sections_offset()) {
+    SetElevationProfiles(tile_ptr + elevation_profiles_offset);
+  }
 
-  // Start of predicted speed data.
+  // Start of predicted speed data, which comes right after the bins in a compact tile
+  char* predictedspeeds = header_->compressed_sections_offset()
+                              ? tile_ptr + header_->complex_restriction_forward_offset()
+                              : tile_ptr + header_->predictedspeeds_offset();
   if (header_->predictedspeeds_count() > 0) {
-    char* ptr1 = tile_ptr + header_->predictedspeeds_offset();
+    char* ptr1 = predictedspeeds;
     char* ptr2 = ptr1 + (header_->directededgecount() * sizeof(int32_t));
     predictedspeeds_.set_offset(reinterpret_cast<uint32_t*>(ptr1));
     predictedspeeds_.set_profiles(reinterpret_cast<int16_t*>(ptr2));
-
-    lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
-  } else {
-    lane_connectivity_size_ = header_->end_offset() - header_->lane_connectivity_offset();
   }
 
   // For reference - how to use the end offset to set size of an object (that
@@ -357,12 +503,167 @@ void GraphTile::Initialize(const GraphId& graphid) {
 
   // ANY NEW EXPANSION DATA GOES HERE
 
+  // The variable size sections of a compact tile are deflated after the predicted speeds. There
+  // is a table of their deflated sizes first and they are only pointed at once inflated
+  if (header_->compressed_sections_offset()) {
+    const auto table_size = kCompressedSectionCount * sizeof(uint32_t);
+    if (header_->compressed_sections_offset() + table_size > tile_size) {
+      throw std::runtime_error("Compact tile is missing its compressed sections");
+    }
+    compressed_sections_.reset(new compressed_sections_t());
+    const char* deflated = tile_ptr + header_->compressed_sections_offset();
+    std::memcpy(compressed_sections_->deflated_size, deflated, table_size);
+    deflated += table_size;
+    for (size_t i = 0; i < kCompressedSectionCount; ++i) {
+      compressed_sections_->deflated[i] = deflated;
+      deflated += compressed_sections_->deflated_size[i];
+    }
+    if (deflated != tile_ptr + tile_size) {
+      throw std::runtime_error("Mismatch in the size of the compressed sections of a compact tile");
+    }
+    complex_restriction_forward_ = complex_restriction_reverse_ = edgeinfo_ = textlist_ = nullptr;
+    lane_connectivity_ = nullptr;
+  }
+
   // Associate one stop Ids for transit tiles
   if (graphid.level() == 3) {
     AssociateOneStopIds(graphid);
   }
 }
 
+void GraphTile::inflate_sections() const {
+  for (auto section : {kRestrictionSection, kEdgeInfoSection, kTextListSection,
+                       kLaneConnectivitySection}) {
+    inflate_section(section);
+  }
+}
+
+void GraphTile::InflateSection(const CompressedSection section) const {
+  // where the section goes in the tile, the sections are in this order
+  const uint32_t begins[] = {header_->complex_restriction_forward_offset(),
+                             header_->edgeinfo_offset(), header_->textlist_offset(),
+                             header_->lane_connectivity_offset(),
+                             header_->predictedspeeds_count() > 0
+                                 ? header_->predictedspeeds_offset()
+                                 : header_->end_offset()};
+  auto& inflated = compressed_sections_->inflated[section];
+  const size_t size = begins[section + 1] - begins[section];
+  if (size > 0) {
+    const auto* deflated = compressed_sections_->deflated[section];
+    const auto deflated_size = compressed_sections_->deflated_size[section];
+    auto src_func = [deflated, deflated_size](z_stream& s) -> void {
+      s.next_in = const_cast<Byte*>(reinterpret_cast<const Byte*>(deflated));
+      s.avail_in = deflated_size;
+    };
+    // the size is known up front so there is only the one buffer, with a byte to spare so that
+    // the end of the stream comes before it is full
+    inflated.resize(size + 1);
+    bool given = false;
+    size_t total = 0;
+    auto dst_func = [&inflated, &given, &total](z_stream& s) -> int {
+      if (s.avail_out == 0) {
+        if (given) {
+          throw std::runtime_error("Inflated section is bigger than it should be");
+        }
+        s.next_out = reinterpret_cast<Byte*>(inflated.data());
+        s.avail_out = inflated.size();
+        given = true;
+      }
+      total = s.total_out;
+      return Z_NO_FLUSH;
+    };
+    if (!baldr::inflate(src_func, dst_func) || total != size) {
+      throw std::runtime_error("Failed to inflate a section of compact tile " +
+                               std::to_string(header_->graphid()));
+    }
+    inflated.resize(size);
+  }
+
+  // point at it
+  char* data = inflated.data();
+  switch (section) {
+    case kRestrictionSection:
+      complex_restriction_forward_ = data;
+      complex_restriction_reverse_ = data + complex_restriction_forward_size_;
+      break;
+    case kEdgeInfoSection:
+      edgeinfo_ = data;
+      break;
+    case kTextListSection:
+      textlist_ = data;
+      break;
+    case kLaneConnectivitySection:
+      lane_connectivity_ = reinterpret_cast<LaneConnectivity*>(data);
+      SetElevationProfiles(data + lane_connectivity_size_);
+      break;
+    default:
+      break;
+  }
+}
+
+std::vector<char> GraphTile::CompactTile(const std::vector<char>& tile, int level) {
+  GraphTileHeader header;
+  if (tile.size() < sizeof(header)) {
+    throw std::runtime_error("Too few bytes for a tile to compact");
+  }
+  std::memcpy(&header, tile.data(), sizeof(header));
+  if (header.compressed_sections_offset()) {
+    return tile;
+  }
+  if (header.end_offset() != tile.size()) {
+    throw std::runtime_error("Mismatch in end offset of the tile to compact");
+  }
+
+  // the fixed size records and the bins, then the predicted speeds
+  const uint32_t predicted_begin =
+      header.predictedspeeds_count() > 0 ? header.predictedspeeds_offset() : header.end_offset();
+  std::vector<char> compact(tile.begin(), tile.begin() + header.complex_restriction_forward_offset());
+  compact.insert(compact.end(), tile.begin() + predicted_begin, tile.end());
+  header.set_compressed_sections_offset(compact.size());
+  std::memcpy(compact.data(), &header, sizeof(header));
+
+  // then the table of deflated sizes and each of the deflated sections
+  const uint32_t begins[] = {header.complex_restriction_forward_offset(), header.edgeinfo_offset(),
+                             header.textlist_offset(), header.lane_connectivity_offset(),
+                             predicted_begin};
+  const size_t table = compact.size();
+  compact.resize(compact.size() + kCompressedSectionCount * sizeof(uint32_t));
+  for (size_t i = 0; i < kCompressedSectionCount; ++i) {
+    const size_t start = compact.size();
+    const auto* section = tile.data() + begins[i];
+    const auto section_size = begins[i + 1] - begins[i];
+    if (section_size > 0) {
+      auto src_func = [section, section_size](z_stream& s) -> int {
+        s.next_in = const_cast<Byte*>(reinterpret_cast<const Byte*>(section));
+        s.avail_in = section_size;
+        return Z_FINISH;
+      };
+      auto dst_func = [&compact, section_size](z_stream& s) -> void {
+        // where the deflated bytes end so far, grow by about half the section when out of room
+        // and drop what wasnt used once done
+        const size_t end =
+            s.next_out ? reinterpret_cast<char*>(s.next_out) - compact.data() : compact.size();
+        if (s.avail_out == 0) {
+          compact.resize(end + section_size / 2 + 64);
+          s.next_out = reinterpret_cast<Byte*>(compact.data() + end);
+          s.avail_out = compact.size() - end;
+        } else {
+          compact.resize(end);
+        }
+      };
+      if (!baldr::deflate(src_func, dst_func, level, false)) {
+        throw std::runtime_error("Failed to deflate a section of tile " +
+                                 std::to_string(header.graphid()));
+      }
+    }
+    const uint32_t deflated_size = compact.size() - start;
+    std::memcpy(compact.data() + table + i * sizeof(uint32_t), &deflated_size,
+                sizeof(deflated_size));
+  }
+  // not worth it for tiles with next to nothing in them
+  return compact.size() < tile.size() ? compact : tile;
+}
+
 // For transit tiles we need to save off the pair<tileid,lineid> lookup via
 // onestop_ids.  This will be used for including or excluding transit lines
 // for transit routes.  We save 2 maps because operators contain all of their
@@ -607,35 +908,50 @@ iterable_t<const DirectedEdge> GraphTile::GetDirectedEdges(const size_t idx) con
 
 // Get a pointer to edge info.
 EdgeInfo GraphTile::edgeinfo(const size_t offset) const {
+  inflate_section(kEdgeInfoSection);
+  inflate_section(kTextListSection);
   return EdgeInfo(edgeinfo_ + offset, textlist_, textlist_size_);
 }
 
 // Get the complex restrictions in the forward or reverse order based on
 // the id and modes.
-std::vector<ComplexRestriction*>
+ComplexRestrictionRange
 GraphTile::GetRestrictions(const bool forward, const GraphId id, const uint64_t modes) const {
-  size_t offset = 0;
-  std::vector<ComplexRestriction*> cr_vector;
-  if (forward) {
-    while (offset < complex_restriction_forward_size_) {
-      ComplexRestriction* cr =
-          reinterpret_cast<ComplexRestriction*>(complex_restriction_forward_ + offset);
-      if (cr->to_graphid() == id && (cr->modes() & modes)) {
-        cr_vector.push_back(cr);
-      }
-      offset += cr->SizeOf();
-    }
-  } else {
-    while (offset < complex_restriction_reverse_size_) {
-      ComplexRestriction* cr =
-          reinterpret_cast<ComplexRestriction*>(complex_restriction_reverse_ + offset);
-      if (cr->from_graphid() == id && (cr->modes() & modes)) {
-        cr_vector.push_back(cr);
-      }
+  if (!restriction_index_) {
+    return {};
+  }
+  std::call_once(restriction_index_->once, &GraphTile::IndexRestrictions, this);
+  const auto& index = forward ? restriction_index_->forward : restriction_index_->reverse;
+  auto range = std::equal_range(index.data(), index.data() + index.size(),
+                                ComplexRestrictionRange::entry_t{id.value, 0, 0},
+                                [](const ComplexRestrictionRange::entry_t& a,
+                                   const ComplexRestrictionRange::entry_t& b) {
+                                  return a.edge < b.edge;
+                                });
+  return {range.first, range.second,
+          forward ? complex_restriction_forward_ : complex_restriction_reverse_, modes};
+}
+
+void GraphTile::IndexRestrictions() const {
+  inflate_section(kRestrictionSection);
+  // forward restrictions are found by the edge they end on and reverse ones by where they start
+  auto index = [](const char* restrictions, const size_t size, const bool forward,
+                  std::vector<ComplexRestrictionRange::entry_t>& entries) {
+    for (size_t offset = 0; offset < size;) {
+      const auto* cr = reinterpret_cast<const ComplexRestriction*>(restrictions + offset);
+      entries.push_back({forward ? cr->to_graphid().value : cr->from_graphid().value,
+                         static_cast<uint32_t>(offset), static_cast<uint32_t>(cr->modes())});
       offset += cr->SizeOf();
     }
-  }
-  return cr_vector;
+    // the restrictions of an edge keep the order they have in the tile
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const ComplexRestrictionRange::entry_t& a,
+                        const ComplexRestrictionRange::entry_t& b) { return a.edge < b.edge; });
+  };
+  index(complex_restriction_forward_, complex_restriction_forward_size_, true,
+        restriction_index_->forward);
+  index(complex_restriction_reverse_, complex_restriction_reverse_size_, false,
+        restriction_index_->reverse);
 }
 
 // Get the directed edges outbound from the specified node index.
@@ -664,6 +980,7 @@ uint16_t GraphTile::GetTypes(const uint32_t edgeinfo_offset) const {
 AdminInfo GraphTile::admininfo(const size_t idx) const {
   if (idx < header_->admincount()) {
     const Admin& admin = admins_[idx];
+    inflate_section(kTextListSection);
     return AdminInfo(textlist_ + admin.country_offset(), textlist_ + admin.state_offset(),
                      admin.country_iso(), admin.state_iso());
   }
@@ -681,6 +998,7 @@ const Admin* GraphTile::admin(const size_t idx) const {
 // Convenience method to get the text/name for a given offset to the textlist
 std::string GraphTile::GetName(const uint32_t textlist_offset) const {
   if (textlist_offset < textlist_size_) {
+    inflate_section(kTextListSection);
     return textlist_ + textlist_offset;
   } else {
     throw std::runtime_error("GetName: offset exceeds size of text list");
@@ -719,6 +1037,7 @@ std::vector<SignInfo> GraphTile::GetSigns(const uint32_t idx, bool signs_on_node
   }
 
   // Add signs
+  inflate_section(kTextListSection);
   for (; found < count && signs_[found].index() == idx; ++found) {
     if (signs_[found].text_offset() < textlist_size_) {
       // Skip tagged text strings (Future code is needed to handle tagged strings)
@@ -744,46 +1063,115 @@ std::vector<SignInfo> GraphTile::GetSigns(const uint32_t idx, bool signs_on_node
 
 // Get lane connections ending on this edge.
 std::vector<LaneConnectivity> GraphTile::GetLaneConnectivity(const uint32_t idx) const {
+  auto range = GetLaneConnectivityRange(idx);
+  std::vector<LaneConnectivity> lcs(range.begin(), range.end());
+  if (lcs.size() == 0) {
+    LOG_ERROR("No lane connections found for idx = " + std::to_string(idx));
+  }
+  return lcs;
+}
+
+// Points at the elevation profiles, if there are any
+void GraphTile::SetElevationProfiles(const char* profiles) const {
+  const size_t offsets_size = header_->directededgecount() * sizeof(uint32_t);
+  if (elevation_profiles_size_ <= offsets_size) {
+    return;
+  }
+  elevation_profiles_.set_offset(reinterpret_cast<const uint32_t*>(profiles));
+  elevation_profiles_.set_profiles(profiles + offsets_size,
+                                   elevation_profiles_size_ - offsets_size);
+}
+
+// Get the heights along a directed edge.
+std::vector<float> GraphTile::GetElevationProfile(const DirectedEdge* de) const {
+  if (elevation_profiles_size_ == 0) {
+    return {};
+  }
+  inflate_section(kLaneConnectivitySection);
+  return elevation_profiles_.profile(de - directededges_, de->forward());
+}
+
+// Get lane connections ending on this edge, straight out of the tile.
+midgard::iterable_t<const LaneConnectivity>
+GraphTile::GetLaneConnectivityRange(const uint32_t idx) const {
   uint32_t count = lane_connectivity_size_ / sizeof(LaneConnectivity);
-  std::vector<LaneConnectivity> lcs;
   if (count == 0) {
-    LOG_ERROR("No lane connections found for idx = " + std::to_string(idx));
-    return lcs;
+    return {lane_connectivity_, lane_connectivity_};
   }
+  inflate_section(kLaneConnectivitySection);
 
-  // Lane connections are sorted by edge index.
-  // Binary search to find a sign with matching edge index.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& lc = lane_connectivity_[mid];
-    // matching edge index
-    if (idx == lc.to()) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller index
-    else if (idx < lc.to()) {
-      high = mid - 1;
-    } // need a bigger index
-    else {
-      low = mid + 1;
+  // Lane connections are sorted by edge index
+  auto range = std::equal_range(lane_connectivity_, lane_connectivity_ + count, idx,
+                                lane_connectivity_less_t{});
+  return {range.first, range.second};
+}
+
+// Get the next departure given the directed line Id and the current
+void GraphTile::IndexDepartures() const {
+  auto& index = *departure_index_;
+  for (uint32_t i = 0; i < header_->departurecount();) {
+    // the departures of a line are next to each other
+    departure_index_t::line_t line{departures_[i].lineid(),
+                                   i,
+                                   static_cast<uint32_t>(index.fixed.size()),
+                                   0,
+                                   static_cast<uint32_t>(index.frequency.size()),
+                                   0};
+    for (; i < header_->departurecount() && departures_[i].lineid() == line.lineid; ++i) {
+      if (departures_[i].type() == kFixedSchedule) {
+        index.fixed.push_back(i);
+      } else {
+        index.frequency.push_back(i);
+      }
     }
+    std::stable_sort(index.fixed.begin() + line.first_fixed, index.fixed.end(),
+                     [this](const uint32_t a, const uint32_t b) {
+                       return departures_[a].departure_time() < departures_[b].departure_time();
+                     });
+    line.fixed_count = index.fixed.size() - line.first_fixed;
+    line.frequency_count = index.frequency.size() - line.first_frequency;
+    index.lines.push_back(line);
   }
 
-  // Add Lane connections
-  for (; found < count && lane_connectivity_[found].to() == idx; ++found) {
-    lcs.emplace_back(lane_connectivity_[found]);
+  // lines are usually in order already, but the lookup cant rely on it
+  std::stable_sort(index.lines.begin(), index.lines.end(),
+                   [](const departure_index_t::line_t& a, const departure_index_t::line_t& b) {
+                     return a.lineid < b.lineid;
+                   });
+
+  const auto schedules = header_->schedulecount();
+  index.fixed_times.reserve(index.fixed.size());
+  index.fixed_days.reserve(index.fixed.size());
+  index.fixed_end_days.reserve(index.fixed.size());
+  index.fixed_days_of_week.reserve(index.fixed.size());
+  index.fixed_access.reserve(index.fixed.size());
+  for (auto i : index.fixed) {
+    const auto& departure = departures_[i];
+    index.fixed_times.push_back(departure.departure_time());
+    // a departure without a schedule never runs, as GetTransitSchedule makes it
+    const auto s = departure.schedule_index();
+    index.fixed_days.push_back(s < schedules ? transit_schedules_[s].days() : 0);
+    index.fixed_end_days.push_back(s < schedules ? transit_schedules_[s].end_day() : 0);
+    index.fixed_days_of_week.push_back(s < schedules ? transit_schedules_[s].days_of_week() : 0);
+    index.fixed_access.push_back((departure.wheelchair_accessible() ? 1 : 0) |
+                                 (departure.bicycle_accessible() ? 2 : 0));
   }
-  if (lcs.size() == 0) {
-    LOG_ERROR("No lane connections found for idx = " + std::to_string(idx));
+}
+
+const GraphTile::departure_index_t::line_t* GraphTile::DepartureLine(const uint32_t lineid) const {
+  if (!departure_index_) {
+    return nullptr;
   }
-  return lcs;
+  std::call_once(departure_index_->once, &GraphTile::IndexDepartures, this);
+  const auto& lines = departure_index_->lines;
+  auto line = std::lower_bound(lines.begin(), lines.end(), lineid,
+                               [](const departure_index_t::line_t& line, const uint32_t lineid) {
+                                 return line.lineid < lineid;
+                               });
+  return line == lines.end() || line->lineid != lineid ? nullptr : &*line;
 }
 
-// Get the next departure given the directed line Id and the current
+// Get the next departure given the directed edge Id and the current
 // time (seconds from midnight).
 const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
                                                     const uint32_t current_time,
@@ -792,134 +1180,100 @@ const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
                                                     bool date_before_tile,
                                                     bool wheelchair,
                                                     bool bicycle) const {
-  uint32_t count = header_->departurecount();
-  if (count == 0) {
+  const auto* line = DepartureLine(lineid);
+  if (!line) {
     return nullptr;
   }
-
-  // Departures are sorted by edge Id and then by departure time.
-  // Binary search to find a departure with matching line Id.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& dep = departures_[mid];
-    // matching lineid and a workable time
-    if (lineid == dep.lineid() &&
-        ((current_time <= dep.departure_time() && dep.type() == kFixedSchedule) ||
-         (current_time <= dep.end_time() && dep.type() == kFrequencySchedule))) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller lineid
-    else if (lineid < dep.lineid()) {
-      high = mid - 1;
-    } // either need a bigger lineid or a later time
-    else {
-      low = mid + 1;
+  const auto& index = *departure_index_;
+
+  // Bisect to the first fixed departure not before the current time then go on to the first one
+  // running that day, which only needs a bit of the days it runs on and of its access
+  const uint8_t access = (wheelchair ? 1 : 0) | (bicycle ? 2 : 0);
+  const uint64_t day_bit = day < 64 ? 1ULL << day : 0;
+  const auto times = index.fixed_times.begin() + line->first_fixed;
+  const auto first = std::lower_bound(times, times + line->fixed_count, current_time) - times;
+  const TransitDeparture* best = nullptr;
+  for (uint32_t i = line->first_fixed + first; i < line->first_fixed + line->fixed_count; ++i) {
+    const bool runs = (!date_before_tile && day <= index.fixed_end_days[i])
+                          ? (index.fixed_days[i] & day_bit) != 0
+                          : (index.fixed_days_of_week[i] & dow) != 0;
+    if (runs && (index.fixed_access[i] & access) == access) {
+      best = &departures_[index.fixed[i]];
+      break;
     }
   }
 
-  // Iterate through departures until one is found with valid date, dow or
-  // calendar date, and does not have a calendar exception.
-  for (; found < count && departures_[found].lineid() == lineid; ++found) {
-    // Make sure valid departure time
-    if (departures_[found].type() == kFixedSchedule) {
-      if (departures_[found].departure_time() >= current_time &&
-          GetTransitSchedule(departures_[found].schedule_index())
-              ->IsValid(day, dow, date_before_tile) &&
-          (!wheelchair || departures_[found].wheelchair_accessible()) &&
-          (!bicycle || departures_[found].bicycle_accessible())) {
-        return &departures_[found];
-      }
-    } else {
-      uint32_t departure_time = departures_[found].departure_time();
-      uint32_t end_time = departures_[found].end_time();
-      uint32_t frequency = departures_[found].frequency();
-      while (departure_time < current_time && departure_time < end_time) {
-        departure_time += frequency;
-      }
-
-      if (departure_time >= current_time && departure_time < end_time &&
-          GetTransitSchedule(departures_[found].schedule_index())
-              ->IsValid(day, dow, date_before_tile) &&
-          (!wheelchair || departures_[found].wheelchair_accessible()) &&
-          (!bicycle || departures_[found].bicycle_accessible())) {
-
-        const auto& d = departures_[found];
-        const TransitDeparture* dep =
-            new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
-                                 d.headsign_offset(), departure_time, d.end_time(), d.frequency(),
-                                 d.elapsed_time(), d.schedule_index(), d.wheelchair_accessible(),
-                                 d.bicycle_accessible());
-        return dep;
-      }
+  // A frequency based departure may leave before that
+  const TransitDeparture* frequency = nullptr;
+  uint32_t frequency_time = 0;
+  for (uint32_t i = line->first_frequency; i < line->first_frequency + line->frequency_count;
+       ++i) {
+    const auto& d = departures_[index.frequency[i]];
+    uint32_t departure_time = d.departure_time();
+    if (departure_time < current_time && d.frequency() > 0) {
+      departure_time += (current_time - departure_time + d.frequency() - 1) / d.frequency() *
+                        d.frequency();
+    }
+    if (departure_time < current_time || departure_time >= d.end_time() ||
+        (best && best->departure_time() <= departure_time) ||
+        (frequency && frequency_time <= departure_time)) {
+      continue;
+    }
+    const auto* schedule = GetTransitSchedule(d.schedule_index());
+    if (schedule && schedule->IsValid(day, dow, date_before_tile) &&
+        (!wheelchair || d.wheelchair_accessible()) && (!bicycle || d.bicycle_accessible())) {
+      frequency = &d;
+      frequency_time = departure_time;
     }
   }
+  if (frequency) {
+    const auto& d = *frequency;
+    return new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
+                                d.headsign_offset(), frequency_time, d.end_time(), d.frequency(),
+                                d.elapsed_time(), d.schedule_index(), d.wheelchair_accessible(),
+                                d.bicycle_accessible());
+  }
 
   // TODO - maybe wrap around, try next day?
-  LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
-            " current_time = " + std::to_string(current_time));
-  return nullptr;
+  if (!best) {
+    LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
+              " current_time = " + std::to_string(current_time));
+  }
+  return best;
 }
 
 // Get the departure given the line Id and tripid
 const TransitDeparture* GraphTile::GetTransitDeparture(const uint32_t lineid,
                                                        const uint32_t tripid,
                                                        const uint32_t current_time) const {
-  uint32_t count = header_->departurecount();
-  if (count == 0) {
-    return nullptr;
-  }
-
-  // Departures are sorted by edge Id and then by departure time.
-  // Binary search to find a departure with matching line Id.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& dep = departures_[mid];
-    // find the first matching lineid in the list
-    if (lineid == dep.lineid() &&
-        ((current_time <= dep.departure_time() && dep.type() == kFixedSchedule) ||
-         (current_time <= dep.end_time() && dep.type() == kFrequencySchedule))) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller lineid
-    else if (lineid < dep.lineid()) {
-      high = mid - 1;
-    } // need a bigger lineid
-    else {
-      low = mid + 1;
+  const auto* line = DepartureLine(lineid);
+  if (line) {
+    const auto& index = *departure_index_;
+    const auto times = index.fixed_times.begin() + line->first_fixed;
+    const auto first = std::lower_bound(times, times + line->fixed_count, current_time) - times;
+    for (uint32_t i = line->first_fixed + first; i < line->first_fixed + line->fixed_count; ++i) {
+      if (departures_[index.fixed[i]].tripid() == tripid) {
+        return &departures_[index.fixed[i]];
+      }
     }
-  }
 
-  // Iterate through departures until one is found with matching trip id
-  for (; found < count && departures_[found].lineid() == lineid; ++found) {
-    if (departures_[found].tripid() == tripid) {
-
-      if (departures_[found].type() == kFixedSchedule) {
-        return &departures_[found];
+    for (uint32_t i = line->first_frequency; i < line->first_frequency + line->frequency_count;
+         ++i) {
+      const auto& d = departures_[index.frequency[i]];
+      if (d.tripid() != tripid || current_time > d.end_time()) {
+        continue;
       }
-
-      uint32_t departure_time = departures_[found].departure_time();
-      uint32_t end_time = departures_[found].end_time();
-      uint32_t frequency = departures_[found].frequency();
+      uint32_t departure_time = d.departure_time();
+      uint32_t end_time = d.end_time();
+      uint32_t frequency = d.frequency();
       while (departure_time < current_time && departure_time < end_time) {
         departure_time += frequency;
       }
-
       if (departure_time >= current_time && departure_time < end_time) {
-        const auto& d = departures_[found];
-        const TransitDeparture* dep =
-            new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
-                                 d.headsign_offset(), departure_time, d.end_time(), d.frequency(),
-                                 d.elapsed_time(), d.schedule_index(), d.wheelchair_accessible(),
-                                 d.bicycle_accessible());
-        return dep;
+        return new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
+                                    d.headsign_offset(), departure_time, d.end_time(),
+                                    d.frequency(), d.elapsed_time(), d.schedule_index(),
+                                    d.wheelchair_accessible(), d.bicycle_accessible());
       }
     }
   }
@@ -999,43 +1353,22 @@ const TransitSchedule* GraphTile::GetTransitSchedule(const uint32_t idx) const {
 // Get the access restriction given its directed edge index
 std::vector<AccessRestriction> GraphTile::GetAccessRestrictions(const uint32_t idx,
                                                                 const uint32_t access) const {
+  auto range = GetAccessRestrictionRange(idx, access);
+  return std::vector<AccessRestriction>(range.begin(), range.end());
+}
 
-  std::vector<AccessRestriction> restrictions;
+// Get the access restrictions of the directed edge, straight out of the tile
+AccessRestrictionRange GraphTile::GetAccessRestrictionRange(const uint32_t idx,
+                                                            const uint32_t access) const {
   uint32_t count = header_->access_restriction_count();
   if (count == 0) {
-    return restrictions;
-  }
-
-  // Access restriction are sorted by edge Id.
-  // Binary search to find a access restriction with matching edge Id.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& res = access_restrictions_[mid];
-    // find the first matching index in the list
-    if (idx == res.edgeindex()) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller index
-    else if (idx < res.edgeindex()) {
-      high = mid - 1;
-    } // need a bigger index
-    else {
-      low = mid + 1;
-    }
+    return {};
   }
 
-  // Add restrictions for only the access that we are interested in
-  for (; found < count && access_restrictions_[found].edgeindex() == idx; ++found) {
-    if (access_restrictions_[found].modes() & access) {
-      restrictions.emplace_back(access_restrictions_[found]);
-    }
-  }
-
-  return restrictions;
+  // Access restrictions are sorted by edge Id
+  auto range = std::equal_range(access_restrictions_, access_restrictions_ + count, idx,
+                                access_restriction_less_t{});
+  return {range.first, range.second, access};
 }
 
 // Get the array of graphids for this bin
@@ -1044,6 +1377,13 @@ midgard::iterable_t<GraphId> GraphTile::GetBin(size_t column, size_t row) const
   return iterable_t<GraphId>{edge_bins_ + offsets.first, edge_bins_ + offsets.second};
 }
 
+AABB2<PointLL> GraphTile::GetEdgeBounds(const uint32_t idx) const {
+  if (edge_bounds_ == nullptr || idx >= header_->directededgecount()) {
+    return AABB2<PointLL>(-180., -90., 180., 90.);
+  }
+  return edge_bounds_[idx].bounds(BoundingBox());
+}
+
 midgard::iterable_t<GraphId> GraphTile::GetBin(size_t index) const {
   auto offsets = header_->bin_offset(index);
   return iterable_t<GraphId>{edge_bins_ + offsets.first, edge_bins_ + offsets.second};
@@ -83,5 +83,14 @@ std::pair<uint32_t, uint32_t> GraphTileHeader::bin_offset(size_t index) const {
   throw std::runtime_error("Bin out of bounds");
 }
 
+// Get which bins in the 5x5 grid have edges.
+uint32_t GraphTileHeader::occupied_bins() const {
+  uint32_t occupied = bin_offsets_[0] > 0;
+  for (size_t i = 1; i < kBinCount; ++i) {
+    occupied |= static_cast<uint32_t>(bin_offsets_[i] > bin_offsets_[i - 1]) << i;
+  }
+  return occupied;
+}
+
 } // namespace baldr
 } // namespace valhalla
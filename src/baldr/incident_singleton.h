@@ -30,12 +30,15 @@ struct incident_singleton_t {
 protected:
   // parameter pack to share state between daemon thread and singleton instance
   struct state_t {
-    std::atomic<bool> initialized;  // whether or not the watcher thread has done 1 load of incidents
-    std::atomic<bool> lock_free;    // whether or not we can skip locking around cache operations
-    std::condition_variable signal; // how the watcher tells the main thread its done its first load
-    std::mutex mutex;               // for locking on cache operations
-    // the actual cache where tiles are stored
-    std::unordered_map<uint64_t, std::shared_ptr<const valhalla::IncidentsTile>> cache;
+    using cache_t = std::unordered_map<uint64_t, std::shared_ptr<const valhalla::IncidentsTile>>;
+    std::atomic<bool> initialized;    // whether or not the watcher has done 1 load of incidents
+    std::atomic<bool> static_tileset; // whether or not tiles outside of the tileset are ignored
+    std::condition_variable signal;   // how the watcher tells the main thread its done its 1st load
+    std::mutex mutex;                 // for waiting on the first load
+    // the latest snapshot of the cache where tiles are stored. its never modified once published,
+    // the watcher builds the next one on the side and swaps it in with std::atomic_store so that
+    // readers never have to wait on it (read-copy-update). it is empty until the first load
+    std::shared_ptr<const cache_t> cache;
   };
   // we use a shared_ptr to wrap the state between the watcher thread and the main threads singleton
   // instance. this gives the responsibility to the last living thread to deallocate the state object.
@@ -57,7 +60,7 @@ protected:
   /**
    * Singleton private constructor that static function uses to instantiate the singleton
    * @param config      lets the daemon thread know where/how to look for incidents
-   * @param tileset     an mmapped graph tileset (ie static) allows incident loading to be lock-free
+   * @param tileset     an mmapped graph tileset (ie static) limits which tiles incidents are kept for
    * @param watch_func  the function the background thread will run to keep incident caches up to date
    */
   incident_singleton_t(const boost::property_tree::ptree& config,
@@ -123,43 +126,50 @@ protected:
   }
 
   /**
-   * Updates the tile in the states cache
-   * @param state     the state to update
-   * @param tile_id   the tile id we are loading
-   * @param path      the path to the tile file
-   * @param hint      a pointer to an existing iterator into the cache
-   * @return the shared_ptr that owns the tile memory
+   * Updates the tile in the watchers working copy of the cache, nobody else can see it until
+   * it is published
+   * @param cache           the working copy of the cache to update
+   * @param static_tileset  whether tiles that arent already in the cache should be skipped
+   * @param tile_id         the tile id we are loading
+   * @param tile            the tile we loaded, nullptr when there are no incidents
+   * @param hint            a pointer to an existing iterator into the cache
+   * @return whether or not the tile was updated
    */
-  static bool update_tile(const std::shared_ptr<state_t>& state,
+  static bool update_tile(state_t::cache_t& cache,
+                          bool static_tileset,
                           const valhalla::baldr::GraphId& tile_id,
                           std::shared_ptr<const valhalla::IncidentsTile>&& tile,
-                          decltype(state_t::cache)::iterator* hint = nullptr) {
+                          state_t::cache_t::iterator* hint = nullptr) {
     // see if we have a slot
-    auto found = hint ? *hint : state->cache.find(tile_id);
-    // if we dont have a slot make one, this must be synchronized
-    if (found == state->cache.cend()) {
-      // this shouldnt happen in lock free mode but can if you put unexpected tiles in the log/dir
-      if (state->lock_free.load()) {
+    auto found = hint ? *hint : cache.find(tile_id);
+    // if we dont have a slot make one
+    if (found == cache.cend()) {
+      // this shouldnt happen with a static tileset but can if you put unexpected tiles in the log
+      if (static_tileset) {
         LOG_WARN("Incident watcher skipped " + std::to_string(tile_id) +
                  " because it was not found in the configured tile extract");
         return false;
       }
-      // actually make a spot in the cache synchronously
-      try {
-        std::unique_lock<std::mutex>(state->mutex);
-        found = state->cache.insert({tile_id, {}}).first;
-      } // if anything went wrong we have to catch it so that the mutex is unlocked
-      catch (...) {
-        LOG_ERROR("Incident watcher failed to add incident tile to cache");
-      }
+      found = cache.insert({tile_id, {}}).first;
     }
-    // atomically store the tile shared_ptr, could be actually nullptr when there are no incidents
-    std::atomic_store_explicit(&found->second, tile, std::memory_order_release);
-    LOG_DEBUG("Incident watcher " + std::string(tile ? "loaded " : "unloaded ") +
+    // store the tile shared_ptr, could be actually nullptr when there are no incidents
+    found->second = std::move(tile);
+    LOG_DEBUG("Incident watcher " + std::string(found->second ? "loaded " : "unloaded ") +
               std::to_string(tile_id));
     return true;
   }
 
+  /**
+   * Makes a copy of the working cache visible to readers. Readers holding the previous snapshot
+   * keep it alive until they are done with it
+   * @param state  the state to publish to
+   * @param cache  the working copy of the cache
+   */
+  static void publish(const std::shared_ptr<state_t>& state, const state_t::cache_t& cache) {
+    std::shared_ptr<const state_t::cache_t> snapshot(new state_t::cache_t(cache));
+    std::atomic_store_explicit(&state->cache, std::move(snapshot), std::memory_order_release);
+  }
+
   /**
    * Thread work function that continually checks for updates to incident tiles. The thread begins by
    * deciding whether its just scanning the directory (works for a small number of incidents) or using
@@ -189,7 +199,7 @@ protected:
    *
    * @param config     lets the function know where to look for incidents and desired update frequency
    * @param tileset    if not empty, the static list of tiles to track (other tiles will be ignored).
-                       if the tileset is static (mem map tar file) we can use lockfree mode
+                       if the tileset is static (mem map tar file) unexpected tiles are skipped
    * @param state      inter thread communication object (mainly tile cache)
    * @param interrupt  functor that, if set and returns true, stops the main loop of this function
    */
@@ -223,13 +233,16 @@ protected:
       return;
     }
 
-    // a static tileset allows us to preallocate the cache entries which makes everything lock-free
+    // a static tileset allows us to preallocate the cache entries and ignore anything else
     // for a planet extract this should be about 200000 * 8 * 2 == 3MB of ram
-    state->lock_free.store(!tileset.empty());
-    state->cache.reserve(tileset.size());
+    const bool static_tileset = !tileset.empty();
+    state->static_tileset.store(static_tileset);
+    state_t::cache_t cache;
+    cache.reserve(tileset.size());
     for (const auto& tile_id : tileset) {
-      state->cache[tile_id] = {};
+      cache[tile_id] = {};
     }
+    publish(state, cache);
 
     // some setup for continuous operation
     size_t run_count = 0;
@@ -252,7 +265,7 @@ protected:
       if (changelog) {
         // reload the log if the tileset isnt static
         try {
-          if (!state->lock_free.load())
+          if (!static_tileset)
             changelog.reset(new decltype(changelog)::element_type(inc_log_path.string(), false, 0));
         } catch (...) {
           LOG_ERROR("Incident watcher could not map incident_log: " + inc_log_path.string());
@@ -273,7 +286,8 @@ protected:
             file_location.replace_filename(
                 valhalla::baldr::GraphTile::FileSuffix(tile_id, ".pbf", true));
             // update the tile
-            update_count += update_tile(state, tile_id, read_tile(file_location.string()));
+            update_count +=
+                update_tile(cache, static_tileset, tile_id, read_tile(file_location.string()));
           }
         }
       } // we are in directory scan mode
@@ -290,7 +304,8 @@ protected:
               struct stat s;
               if (stat(i->path().c_str(), &s) == 0 && last_scan <= MTIME(s)) {
                 // update the tile
-                update_count += update_tile(state, tile_id, read_tile(i->path().string()));
+                update_count +=
+                    update_tile(cache, static_tileset, tile_id, read_tile(i->path().string()));
               }
             }
           } // happens when there is a file in the directory that doesnt have a tile-looking name
@@ -299,14 +314,19 @@ protected:
       }
 
       // for all the ones we didnt see, they have been removed from the filesystem or changelog
-      // no locking is needed because we don't realloc here we just null out some values
-      for (auto entry = state->cache.begin(); entry != state->cache.end(); ++entry) {
+      for (auto entry = cache.begin(); entry != cache.end(); ++entry) {
         auto found = seen.find(entry->first);
         if (found == seen.cend() && entry->second) {
-          update_count += update_tile(state, valhalla::baldr::GraphId(entry->first), nullptr, &entry);
+          update_count += update_tile(cache, static_tileset, valhalla::baldr::GraphId(entry->first),
+                                      nullptr, &entry);
         }
       }
 
+      // let the readers see what changed, they never wait on us
+      if (update_count) {
+        publish(state, cache);
+      }
+
       // if this round finished but was slower than we want
       last_scan = current_scan;
       auto latency = time(nullptr) - current_scan;
@@ -349,16 +369,16 @@ public:
     // spawn a daemon to watch for incidents
     static incident_singleton_t singleton{config, tileset};
 
-    // return the tile from the cache or an empty one if its not there
-    auto scoped_lock = singleton.state->lock_free.load()
-                           ? std::unique_lock<std::mutex>()
-                           : std::unique_lock<std::mutex>(singleton.state->mutex);
-    auto found = singleton.state->cache.find(tile_id);
-    if (found == singleton.state->cache.cend()) {
+    // return the tile from the latest snapshot or an empty one if its not there
+    auto cache = std::atomic_load_explicit(&singleton.state->cache, std::memory_order_acquire);
+    if (!cache) {
+      return {};
+    }
+    auto found = cache->find(tile_id);
+    if (found == cache->cend()) {
       return {};
     }
-    auto tile = std::atomic_load_explicit(&found->second, std::memory_order_acquire);
-    return tile;
+    return found->second;
   }
 };
 } // namespace
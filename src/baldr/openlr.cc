@@ -0,0 +1,508 @@
+#include "baldr/openlr.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/distanceapproximator.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// How far from a location reference point its candidate edges may be, in meters
+constexpr float kCandidateRadius = 30.f;
+// How far the bearing of a candidate edge may be off, in degrees
+constexpr float kBearingTolerance = 45.f;
+// Along how much of the line the bearing is measured, 5.2.4
+constexpr float kBearingDistance = 20.f;
+// How many of the best candidates of a point are tried
+constexpr size_t kMaxCandidates = 5;
+// How far the length of a path may be off the distance to the next point. The distance is only
+// known in steps of 58.6m, 5.2.5, and the points arent exactly on the graph
+constexpr float kLengthTolerance = 60.f;
+constexpr float kLengthToleranceFactor = 0.2f;
+// How many edges the search for the next point looks at at most
+constexpr size_t kMaxLabels = 10000;
+// How many functional road classes below the lowest one to the next point the path may use
+constexpr int kFrcTolerance = 1;
+// How much a functional road class off the one of the point weighs against a candidate
+constexpr float kFrcWeight = 0.25f;
+// Edges at the ends of a path covering less than this many meters of it are dropped
+constexpr float kMinCoverage = 1.f;
+// How many references a thread takes at once
+constexpr size_t kMatchAllBatch = 16;
+
+constexpr uint32_t kNoLabel = std::numeric_limits<uint32_t>::max();
+
+// Whether cars can drive the edge in its direction
+bool usable(const valhalla::baldr::DirectedEdge* edge) {
+  return !edge->is_shortcut() && (edge->forwardaccess() & valhalla::baldr::kVehicularAccess);
+}
+
+// The bearing from a point on a segment of the shape to the point kBearingDistance further along
+// it or back, negative if the shape doesnt go anywhere from the point
+float bearing(const std::vector<PointLL>& shape,
+              const size_t index,
+              const PointLL& point,
+              const bool forward) {
+  float remaining = kBearingDistance;
+  PointLL u = point;
+  auto step = [&](const PointLL& v) {
+    const float d = u.Distance(v);
+    if (d >= remaining) {
+      u = u.PointAlongSegment(v, remaining / d);
+      return true;
+    }
+    remaining -= d;
+    u = v;
+    return false;
+  };
+  if (forward) {
+    for (size_t i = index + 1; i < shape.size() && !step(shape[i]); ++i) {
+    }
+  } else {
+    for (size_t i = index + 1; i-- > 0 && !step(shape[i]);) {
+    }
+  }
+  return remaining == kBearingDistance ? -1.f : point.Heading(u);
+}
+
+// Cuts the given number of meters off the start of the path
+void cut_front(valhalla::baldr::OpenLR::MatchedPath& path,
+               std::vector<float>& lengths,
+               float remaining) {
+  size_t i = 0;
+  for (; i < path.size(); ++i) {
+    const float covered = (path[i].end_pct - path[i].begin_pct) * lengths[i];
+    if (covered > remaining) {
+      path[i].begin_pct += remaining / lengths[i];
+      break;
+    }
+    remaining -= covered;
+  }
+  path.erase(path.begin(), path.begin() + i);
+  lengths.erase(lengths.begin(), lengths.begin() + i);
+}
+
+// Cuts the given number of meters off the end of the path
+void cut_back(valhalla::baldr::OpenLR::MatchedPath& path,
+              std::vector<float>& lengths,
+              float remaining) {
+  size_t i = path.size();
+  for (; i > 0; --i) {
+    const float covered = (path[i - 1].end_pct - path[i - 1].begin_pct) * lengths[i - 1];
+    if (covered > remaining) {
+      path[i - 1].end_pct -= remaining / lengths[i - 1];
+      break;
+    }
+    remaining -= covered;
+  }
+  path.resize(i);
+  lengths.resize(i);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+namespace OpenLR {
+
+Matcher::Matcher(GraphReader& reader, const size_t max_matched)
+    : reader_(reader), max_matched_(max_matched) {
+}
+
+std::vector<Matcher::Candidate> Matcher::Candidates(const LocationReferencePoint& lrp,
+                                                    const bool last) {
+  const PointLL point(lrp.longitude, lrp.latitude);
+  const double lng_delta =
+      kCandidateRadius / DistanceApproximator<PointLL>::MetersPerLngDegree(point.lat());
+  const double lat_delta = kCandidateRadius / kMetersPerDegreeLat;
+  const AABB2<PointLL> box({point.lng() - lng_delta, point.lat() - lat_delta},
+                           {point.lng() + lng_delta, point.lat() + lat_delta});
+
+  // the bins of the local level have the edges of every level
+  std::vector<Candidate> candidates;
+  std::unordered_set<GraphId> seen;
+  std::vector<PointLL> shape;
+  const auto& level = TileHierarchy::levels().back();
+  for (const auto& tile_bins : level.tiles.Intersect(box)) {
+    auto bin_tile = reader_.GetGraphTile(GraphId(tile_bins.first, level.level, 0));
+    if (!bin_tile) {
+      continue;
+    }
+    graph_tile_ptr tile = bin_tile;
+    for (const auto bin : tile_bins.second) {
+      for (auto edge_id : bin_tile->GetBin(bin)) {
+        if (!seen.insert(edge_id).second || !reader_.GetGraphTile(edge_id, tile)) {
+          continue;
+        }
+        const DirectedEdge* edge = tile->directededge(edge_id);
+        shape.clear();
+        tile->edgeinfo(edge->edgeinfo_offset()).VisitShape([&shape](const PointLL& p) {
+          shape.push_back(p);
+        });
+        if (shape.size() < 2) {
+          continue;
+        }
+        if (!edge->forward()) {
+          std::reverse(shape.begin(), shape.end());
+        }
+
+        // the bins only have one of the two directions of each edge
+        for (int direction = 0; direction < 2; ++direction) {
+          if (direction == 1) {
+            edge_id = reader_.GetOpposingEdgeId(edge_id, edge, tile);
+            if (!edge_id.Is_Valid() || !seen.insert(edge_id).second) {
+              break;
+            }
+            std::reverse(shape.begin(), shape.end());
+          }
+          if (!usable(edge)) {
+            continue;
+          }
+
+          // how close it is and where along it
+          PointLL closest;
+          double distance;
+          int index;
+          std::tie(closest, distance, index) = point.ClosestPoint(shape);
+          if (distance > kCandidateRadius) {
+            continue;
+          }
+          float along = 0.f, total = 0.f;
+          for (size_t i = 0; i + 1 < shape.size(); ++i) {
+            const float d = shape[i].Distance(shape[i + 1]);
+            along += static_cast<int>(i) < index ? d : 0.f;
+            total += d;
+          }
+          along += shape[index].Distance(closest);
+          const float pct = total > 0.f ? std::min(along / total, 1.f) : 0.f;
+
+          // the bearing of the last point looks back along the line, 5.2.4. at the very ends of
+          // the edge we look the other way instead
+          float heading = bearing(shape, index, closest, !last);
+          if (heading < 0.f && (heading = bearing(shape, index, closest, last)) >= 0.f) {
+            heading = std::fmod(heading + 180.f, 360.f);
+          }
+          float bearing_diff = heading < 0.f ? 0.f : std::fabs(heading - lrp.bearing);
+          bearing_diff = std::min(bearing_diff, 360.f - bearing_diff);
+          if (bearing_diff > kBearingTolerance) {
+            continue;
+          }
+
+          const int frc_diff = std::abs(static_cast<int>(edge->classification()) - lrp.frc);
+          candidates.push_back({edge_id, pct, static_cast<float>(edge->length()),
+                                static_cast<float>(distance) / kCandidateRadius +
+                                    bearing_diff / kBearingTolerance + frc_diff * kFrcWeight});
+        }
+      }
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.score < b.score; });
+  if (candidates.size() > kMaxCandidates) {
+    candidates.resize(kMaxCandidates);
+  }
+  return candidates;
+}
+
+bool Matcher::Route(const Candidate& start,
+                    const std::vector<Candidate>& targets,
+                    const LocationReferencePoint& lrp,
+                    MatchedPath& path,
+                    std::vector<float>& lengths,
+                    size_t& target,
+                    float& score) {
+  const float tolerance = kLengthTolerance + kLengthToleranceFactor * lrp.distance;
+  const float max_distance = lrp.distance + tolerance;
+  const int lowest_frc = std::max(lrp.lfrcnp, lrp.frc) + kFrcTolerance;
+
+  // which targets are on which edges
+  std::unordered_multimap<GraphId, size_t> target_edges;
+  for (size_t i = 0; i < targets.size(); ++i) {
+    target_edges.emplace(targets[i].edge, i);
+  }
+
+  // the target whose path is closest to the distance to it
+  uint32_t best_label = kNoLabel;
+  bool found = false;
+  score = std::numeric_limits<float>::max();
+  auto rate = [&](const size_t t, const float length, const uint32_t label) {
+    const float error = std::fabs(length - lrp.distance);
+    const float rating = error / tolerance + start.score + targets[t].score;
+    if (error <= tolerance && rating < score) {
+      score = rating;
+      target = t;
+      best_label = label;
+      found = true;
+    }
+  };
+
+  // it can be further along the start edge itself
+  auto same_edge = target_edges.equal_range(start.edge);
+  for (auto t = same_edge.first; t != same_edge.second; ++t) {
+    if (targets[t->second].pct >= start.pct) {
+      rate(t->second, (targets[t->second].pct - start.pct) * start.length, kNoLabel);
+    }
+  }
+
+  // otherwise look for it along the shortest paths leaving the start edge
+  graph_tile_ptr tile;
+  const auto* start_edge = reader_.GetGraphTile(start.edge, tile)->directededge(start.edge);
+  struct Label {
+    GraphId edge;
+    GraphId endnode;
+    uint32_t opp_index;
+    float length;
+    float distance;
+    uint32_t pred;
+  };
+  std::vector<Label> labels{{start.edge, start_edge->endnode(), start_edge->opp_index(),
+                             start.length, (1.f - start.pct) * start.length, kNoLabel}};
+  using queued_t = std::pair<float, uint32_t>;
+  std::priority_queue<queued_t, std::vector<queued_t>, std::greater<queued_t>> queue;
+  queue.emplace(labels.front().distance, 0);
+  std::unordered_set<GraphId> done;
+  std::vector<GraphId> nodes;
+  while (!queue.empty() && labels.size() < kMaxLabels) {
+    const uint32_t label_index = queue.top().second;
+    queue.pop();
+    const Label label = labels[label_index];
+    if (!done.insert(label.edge).second) {
+      continue;
+    }
+
+    // the node at the end of it on every level
+    if (!reader_.GetGraphTile(label.endnode, tile)) {
+      continue;
+    }
+    nodes.assign(1, label.endnode);
+    for (const auto& transition : tile->GetNodeTransitions(label.endnode)) {
+      nodes.push_back(transition.endnode());
+    }
+
+    for (const auto& node_id : nodes) {
+      if (!reader_.GetGraphTile(node_id, tile)) {
+        continue;
+      }
+      const NodeInfo* node = tile->node(node_id);
+      GraphId edge_id(node_id.tileid(), node_id.level(), node->edge_index());
+      for (uint32_t i = 0; i < node->edge_count(); ++i, ++edge_id) {
+        // no u-turns
+        if (node_id == label.endnode && i == label.opp_index) {
+          continue;
+        }
+        const DirectedEdge* edge = tile->directededge(edge_id);
+        if (!usable(edge) || static_cast<int>(edge->classification()) > lowest_frc ||
+            done.count(edge_id)) {
+          continue;
+        }
+        auto on_edge = target_edges.equal_range(edge_id);
+        for (auto t = on_edge.first; t != on_edge.second; ++t) {
+          rate(t->second, label.distance + targets[t->second].pct * edge->length(), label_index);
+        }
+        const float distance = label.distance + edge->length();
+        if (distance <= max_distance) {
+          labels.push_back({edge_id, edge->endnode(), edge->opp_index(),
+                            static_cast<float>(edge->length()), distance, label_index});
+          queue.emplace(distance, static_cast<uint32_t>(labels.size() - 1));
+        }
+      }
+    }
+  }
+  if (!found) {
+    return false;
+  }
+
+  // walk back from the target
+  const auto& best = targets[target];
+  path.clear();
+  lengths.clear();
+  if (best_label == kNoLabel) {
+    path.push_back({start.edge, start.pct, best.pct});
+    lengths.push_back(start.length);
+    return true;
+  }
+  path.push_back({best.edge, 0.f, best.pct});
+  lengths.push_back(best.length);
+  for (auto l = best_label; l != kNoLabel; l = labels[l].pred) {
+    path.push_back({labels[l].edge, 0.f, 1.f});
+    lengths.push_back(labels[l].length);
+  }
+  std::reverse(path.begin(), path.end());
+  std::reverse(lengths.begin(), lengths.end());
+  path.front().begin_pct = start.pct;
+  return true;
+}
+
+MatchedPath Matcher::Match(const OpenLr& reference) {
+  const auto& lrps = reference.lrps;
+  if (lrps.size() < 2) {
+    return {};
+  }
+
+  // find the path between each pair of consecutive points, each continuing where the last ended
+  MatchedPath path, leg, best_leg;
+  std::vector<float> lengths, leg_lengths, best_lengths;
+  float first_length = 0.f, last_length = 0.f;
+  auto starts = Candidates(lrps.front(), false);
+  for (size_t i = 0; i + 1 < lrps.size(); ++i) {
+    const auto targets = Candidates(lrps[i + 1], i + 2 == lrps.size());
+    float best = std::numeric_limits<float>::max();
+    size_t best_target = 0;
+    best_leg.clear();
+    for (const auto& start : starts) {
+      size_t target;
+      float score;
+      if (Route(start, targets, lrps[i], leg, leg_lengths, target, score) && score < best) {
+        best = score;
+        best_target = target;
+        best_leg.swap(leg);
+        best_lengths.swap(leg_lengths);
+      }
+    }
+    if (best_leg.empty()) {
+      return {};
+    }
+
+    float leg_length = 0.f;
+    for (size_t j = 0; j < best_leg.size(); ++j) {
+      leg_length += (best_leg[j].end_pct - best_leg[j].begin_pct) * best_lengths[j];
+    }
+    first_length = i == 0 ? leg_length : first_length;
+    last_length = leg_length;
+
+    // the edge the last leg ended on is the one this one starts on
+    size_t j = 0;
+    if (!path.empty()) {
+      path.back().end_pct = best_leg.front().end_pct;
+      j = 1;
+    }
+    path.insert(path.end(), best_leg.begin() + j, best_leg.end());
+    lengths.insert(lengths.end(), best_lengths.begin() + j, best_lengths.end());
+    starts.assign(1, targets[best_target]);
+  }
+
+  // the offsets are in 1/256ths of the length between the first or the last two points, 5.2.9
+  if (reference.poff) {
+    cut_front(path, lengths, (reference.poff + 0.5f) / 256.f * first_length);
+  }
+  if (reference.noff) {
+    cut_back(path, lengths, (reference.noff + 0.5f) / 256.f * last_length);
+  }
+
+  // points right at a node can end up on the edge on the other side of it
+  while (path.size() > 1 && (path.front().end_pct - path.front().begin_pct) * lengths.front() <
+                                kMinCoverage) {
+    path.erase(path.begin());
+    lengths.erase(lengths.begin());
+  }
+  while (path.size() > 1 &&
+         (path.back().end_pct - path.back().begin_pct) * lengths.back() < kMinCoverage) {
+    path.pop_back();
+    lengths.pop_back();
+  }
+  return path;
+}
+
+const MatchedPath& Matcher::Match(const std::string& reference) {
+  auto found = matched_.find(reference);
+  if (found != matched_.end()) {
+    return found->second;
+  }
+  MatchedPath path;
+  try {
+    path = Match(OpenLr(reference, true));
+  } catch (const std::exception& e) {
+    LOG_DEBUG("Unable to match OpenLR reference " + reference + ": " + e.what());
+  }
+  // a stream of mostly distinct references would otherwise keep every one of them
+  if (matched_.size() >= max_matched_) {
+    matched_.clear();
+  }
+  return matched_.emplace(reference, std::move(path)).first->second;
+}
+
+std::unordered_map<std::string, MatchedPath>
+Matcher::MatchAll(const boost::property_tree::ptree& pt,
+                  const std::vector<std::string>& references,
+                  size_t concurrency) {
+  // every distinct reference once
+  std::vector<std::string> distinct(references);
+  std::sort(distinct.begin(), distinct.end());
+  distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+  // those we can decode sorted by the tile they start in
+  std::unordered_map<std::string, MatchedPath> matched(distinct.size());
+  std::vector<OpenLr> decoded;
+  std::vector<std::pair<int32_t, size_t>> order;
+  const auto& tiles = TileHierarchy::levels().back().tiles;
+  for (const auto& reference : distinct) {
+    try {
+      decoded.emplace_back(reference, true);
+    } catch (const std::exception& e) {
+      LOG_DEBUG("Unable to decode OpenLR reference " + reference + ": " + e.what());
+      matched.emplace(reference, MatchedPath{});
+      continue;
+    }
+    const auto& lrp = decoded.back().lrps.front();
+    order.emplace_back(tiles.TileId(PointLL(lrp.longitude, lrp.latitude)), decoded.size() - 1);
+  }
+  std::sort(order.begin(), order.end());
+
+  // the threads share their tiles unless the config already shares them some other way
+  auto config = pt;
+  if (config.get<std::string>("shared_cache_path", "").empty() &&
+      !config.get<bool>("global_synchronized_cache", false)) {
+    config.put("global_synchronized_cache", true);
+  }
+
+  // each thread takes the next run of references as it is done with its last one
+  std::vector<MatchedPath> paths(decoded.size());
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    GraphReader reader(config);
+    Matcher matcher(reader);
+    for (size_t begin; (begin = next.fetch_add(kMatchAllBatch)) < order.size();) {
+      const size_t end = std::min(begin + kMatchAllBatch, order.size());
+      for (size_t i = begin; i < end; ++i) {
+        try {
+          paths[order[i].second] = matcher.Match(decoded[order[i].second]);
+        } catch (const std::exception& e) {
+          LOG_WARN(std::string("Unable to match OpenLR reference: ") + e.what());
+        }
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t thread = 1; thread < std::max<size_t>(concurrency, 1); ++thread) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // decoded is in the order of distinct, less the ones which couldnt be decoded
+  size_t i = 0;
+  for (const auto& reference : distinct) {
+    if (matched.find(reference) == matched.end()) {
+      matched.emplace(reference, std::move(paths[i++]));
+    }
+  }
+  return matched;
+}
+
+} // namespace OpenLR
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,110 @@
+#include "baldr/opposingedges.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// "VALHOPPO" so that other files are not mistaken for opposing edges
+constexpr uint64_t kMagic = 0x4F50504F484C4156ULL;
+constexpr uint32_t kVersion = 1;
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t OpposingEdges::kNone;
+constexpr uint32_t OpposingEdges::kBoundary;
+
+std::string OpposingEdges::FileName(const std::string& tile_dir) {
+  std::string file_name = tile_dir;
+  if (!file_name.empty() && file_name.back() != filesystem::path::preferred_separator) {
+    file_name.push_back(filesystem::path::preferred_separator);
+  }
+  return file_name + "opposing.edges";
+}
+
+void OpposingEdges::Write(const std::string& file_name,
+                          const std::vector<GraphId>& tiles,
+                          const std::vector<uint64_t>& offsets,
+                          const std::vector<uint32_t>& opposing,
+                          const std::vector<GraphId>& boundary) {
+  if (offsets.size() != tiles.size() + 1 || opposing.size() != offsets.back()) {
+    throw std::runtime_error("Opposing edges dont match their tiles");
+  }
+  if (boundary.size() >= kBoundary) {
+    throw std::runtime_error("Too many opposing edges in other tiles");
+  }
+
+  Header header{};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.tile_count = tiles.size();
+  header.edge_count = offsets.back();
+  header.boundary_count = boundary.size();
+
+  std::vector<uint64_t> tile_values;
+  for (const auto& tile : tiles) {
+    tile_values.push_back(tile.value);
+  }
+  std::vector<uint64_t> boundary_values;
+  for (const auto& edge : boundary) {
+    boundary_values.push_back(edge.value);
+  }
+
+  SidecarWriter file(file_name);
+  file.write(&header, 1);
+  file.write(tile_values);
+  file.write(offsets);
+  file.write(boundary_values);
+  file.write(opposing);
+  file.commit();
+}
+
+OpposingEdges::OpposingEdges(const std::string& file_name)
+    : file_(file_name, "opposing edges", kMagic, kVersion, sizeof(Header)) {
+  // check that all the arrays fit in the file
+  header_ = reinterpret_cast<const Header*>(file_.data());
+  const auto ids = 2 * header_->tile_count + 1 + header_->boundary_count;
+  file_.check(file_.size() ==
+              sizeof(Header) + ids * sizeof(uint64_t) + header_->edge_count * sizeof(uint32_t));
+
+  tiles_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(Header));
+  offsets_ = tiles_ + header_->tile_count;
+  boundary_ = offsets_ + header_->tile_count + 1;
+  opposing_ = reinterpret_cast<const uint32_t*>(boundary_ + header_->boundary_count);
+  LOG_INFO("Loaded the opposing edges of " + std::to_string(header_->edge_count) + " edges, " +
+           std::to_string(header_->boundary_count) + " of them in other tiles");
+}
+
+bool OpposingEdges::Find(const GraphId& edge, GraphId& opposing) const {
+  const auto* end = tiles_ + header_->tile_count;
+  const auto* found = std::lower_bound(tiles_, end, edge.Tile_Base().value);
+  if (found == end || *found != edge.Tile_Base().value) {
+    return false;
+  }
+  const auto tile = found - tiles_;
+  const uint64_t index = offsets_[tile] + edge.id();
+  if (index >= offsets_[tile + 1]) {
+    return false;
+  }
+
+  // most of them are in the same tile, the rest are looked up by their index
+  const auto value = opposing_[index];
+  if (value == kNone) {
+    opposing = {};
+  } else if (value & kBoundary) {
+    opposing = GraphId(boundary_[value & ~kBoundary]);
+  } else {
+    opposing = edge;
+    opposing.set_id(value);
+  }
+  return true;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,5 +1,7 @@
 #include "baldr/predictedspeeds.h"
 
+#include <atomic>
+
 namespace valhalla {
 namespace baldr {
 
@@ -11,6 +13,16 @@ constexpr float kSpeedNormalization = 0.031497039f; // sqrt(2.0f / 2016.0f);
 // Size of the cos table for the buckets
 constexpr uint32_t kCosBucketTableSize = kCoefficientCount * kBucketsPerWeek;
 
+// Number of independent sums the DCT-III is split into so that it can be vectorized
+constexpr uint32_t kSpeedLanes = 8;
+static_assert(kCoefficientCount % kSpeedLanes == 0, "Coefficients must fill the lanes");
+
+// Number of recovered speeds each thread remembers (a power of 2)
+constexpr uint32_t kSpeedCacheSize = 2048;
+
+// Bumped whenever speed profiles go away, which makes every remembered speed stale
+std::atomic<uint32_t> speed_cache_epoch(0);
+
 // Precompute a cos table for each bucket of the week as a singleton.
 class BucketCosTable final {
 public:
@@ -76,15 +88,41 @@ float decompress_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx)
   // Get a pointer to the precomputed cos values for this bucket
   const float* b = BucketCosTable::GetInstance().get(bucket_idx);
 
-  // DCT-III with speed normalization
-  float speed = *coefficients * k1OverSqrt2;
-  const auto* coef_end = coefficients + kCoefficientCount;
-  for (++b, ++coefficients; coefficients < coef_end; ++coefficients, ++b) {
-    speed += *coefficients * *b;
+  // DCT-III with speed normalization. The first cos value is 1 so the first coefficient is
+  // scaled by correcting its lane up front.
+  float lanes[kSpeedLanes] = {};
+  lanes[0] = *coefficients * (k1OverSqrt2 - 1.f);
+  for (uint32_t c = 0; c < kCoefficientCount; c += kSpeedLanes) {
+    for (uint32_t l = 0; l < kSpeedLanes; ++l) {
+      lanes[l] += coefficients[c + l] * b[c + l];
+    }
+  }
+  float speed = 0.f;
+  for (uint32_t l = 0; l < kSpeedLanes; ++l) {
+    speed += lanes[l];
   }
   return speed * kSpeedNormalization;
 }
 
+float cached_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx) {
+  struct entry_t {
+    const int16_t* coefficients;
+    uint32_t bucket;
+    uint32_t epoch;
+    float speed;
+  };
+  thread_local std::array<entry_t, kSpeedCacheSize> cache{};
+
+  // Profiles are kDecodedSpeedSize bytes apart, the buckets of one go to neighboring entries
+  const uint32_t epoch = speed_cache_epoch.load(std::memory_order_acquire);
+  const size_t profile = reinterpret_cast<uintptr_t>(coefficients) / kDecodedSpeedSize;
+  auto& entry = cache[(profile * 31 + bucket_idx) & (kSpeedCacheSize - 1)];
+  if (entry.coefficients != coefficients || entry.bucket != bucket_idx || entry.epoch != epoch) {
+    entry = {coefficients, bucket_idx, epoch, decompress_speed_bucket(coefficients, bucket_idx)};
+  }
+  return entry.speed;
+}
+
 std::string encode_compressed_speeds(const int16_t* coefficients) {
   std::string result;
   result.reserve(kCoefficientCount * sizeof(uint16_t) / sizeof(char));
@@ -113,5 +151,11 @@ std::array<int16_t, kCoefficientCount> decode_compressed_speeds(const std::strin
   return coefficients;
 }
 
+PredictedSpeeds::~PredictedSpeeds() {
+  if (profiles_ != nullptr) {
+    speed_cache_epoch.fetch_add(1, std::memory_order_release);
+  }
+}
+
 } // namespace baldr
 } // namespace valhalla
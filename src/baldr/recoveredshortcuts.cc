@@ -0,0 +1,157 @@
+#include "baldr/recoveredshortcuts.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// "VALHSHRT" so that other files are not mistaken for recovered shortcuts
+constexpr uint64_t kMagic = 0x545248534C4C4156ULL;
+constexpr uint32_t kVersion = 1;
+
+void write_varint(uint64_t value, std::vector<uint8_t>& data) {
+  while (value >= 0x80) {
+    data.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  data.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t read_varint(const uint8_t*& data) {
+  uint64_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    value |= static_cast<uint64_t>(*data & 0x7f) << shift;
+    if (!(*data++ & 0x80)) {
+      return value;
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::string RecoveredShortcuts::FileName(const std::string& tile_dir) {
+  std::string file_name = tile_dir;
+  if (!file_name.empty() && file_name.back() != filesystem::path::preferred_separator) {
+    file_name.push_back(filesystem::path::preferred_separator);
+  }
+  return file_name + "shortcuts.recovered";
+}
+
+void RecoveredShortcuts::Pack(const GraphId& shortcut,
+                              const std::vector<GraphId>& edges,
+                              std::vector<uint8_t>& data) {
+  // a shortcut which couldnt be recovered has no edges
+  if (edges.size() == 1 && edges.front() == shortcut) {
+    write_varint(0, data);
+    return;
+  }
+  write_varint(edges.size(), data);
+  GraphId previous = shortcut;
+  for (const auto& edge : edges) {
+    if (edge.Tile_Base() == previous.Tile_Base()) {
+      // zigzag the difference of the indices so going back is as small as going forward
+      const int64_t delta = static_cast<int64_t>(edge.id()) - static_cast<int64_t>(previous.id());
+      write_varint(((static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63)) << 1,
+                   data);
+    } else {
+      write_varint((edge.value << 1) | 1, data);
+    }
+    previous = edge;
+  }
+}
+
+void RecoveredShortcuts::Write(const std::string& file_name,
+                               const std::vector<GraphId>& tiles,
+                               const std::vector<uint64_t>& offsets,
+                               const std::vector<uint32_t>& shortcuts,
+                               const std::vector<uint64_t>& positions,
+                               const std::vector<uint8_t>& data) {
+  if (offsets.size() != tiles.size() + 1 || shortcuts.size() != offsets.back() ||
+      positions.size() != shortcuts.size()) {
+    throw std::runtime_error("Recovered shortcuts dont match their tiles");
+  }
+
+  Header header{};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.tile_count = tiles.size();
+  header.shortcut_count = shortcuts.size();
+  header.data_size = data.size();
+
+  std::vector<uint64_t> tile_values;
+  for (const auto& tile : tiles) {
+    tile_values.push_back(tile.value);
+  }
+
+  SidecarWriter file(file_name);
+  file.write(&header, 1);
+  file.write(tile_values);
+  file.write(offsets);
+  file.write(positions);
+  file.write(shortcuts);
+  file.write(data);
+  file.commit();
+}
+
+RecoveredShortcuts::RecoveredShortcuts(const std::string& file_name)
+    : file_(file_name, "recovered shortcuts", kMagic, kVersion, sizeof(Header)) {
+  // check that all the arrays fit in the file
+  header_ = reinterpret_cast<const Header*>(file_.data());
+  const auto ids = 2 * header_->tile_count + 1 + header_->shortcut_count;
+  file_.check(file_.size() == sizeof(Header) + ids * sizeof(uint64_t) +
+                                  header_->shortcut_count * sizeof(uint32_t) + header_->data_size);
+
+  tiles_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(Header));
+  offsets_ = tiles_ + header_->tile_count;
+  positions_ = offsets_ + header_->tile_count + 1;
+  shortcuts_ = reinterpret_cast<const uint32_t*>(positions_ + header_->shortcut_count);
+  packed_ = reinterpret_cast<const uint8_t*>(shortcuts_ + header_->shortcut_count);
+  LOG_INFO("Loaded the recovered edges of " + std::to_string(header_->shortcut_count) +
+           " shortcuts");
+}
+
+bool RecoveredShortcuts::Find(const GraphId& shortcut, std::vector<GraphId>& edges) const {
+  const auto* tiles_end = tiles_ + header_->tile_count;
+  const auto* tile = std::lower_bound(tiles_, tiles_end, shortcut.Tile_Base().value);
+  if (tile == tiles_end || *tile != shortcut.Tile_Base().value) {
+    return false;
+  }
+  const auto* begin = shortcuts_ + offsets_[tile - tiles_];
+  const auto* end = shortcuts_ + offsets_[tile - tiles_ + 1];
+  const auto* found = std::lower_bound(begin, end, shortcut.id());
+  if (found == end || *found != shortcut.id()) {
+    return false;
+  }
+
+  // unpack them only now that they are wanted
+  const auto* data = packed_ + positions_[found - shortcuts_];
+  const auto count = read_varint(data);
+  if (count == 0) {
+    edges = {shortcut};
+    return true;
+  }
+  edges.clear();
+  edges.reserve(count);
+  GraphId previous = shortcut;
+  for (uint64_t i = 0; i < count; ++i) {
+    const auto value = read_varint(data);
+    if (value & 1) {
+      previous = GraphId(value >> 1);
+    } else {
+      const auto zigzag = value >> 1;
+      const auto delta = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+      previous.set_id(static_cast<uint32_t>(static_cast<int64_t>(previous.id()) + delta));
+    }
+    edges.push_back(previous);
+  }
+  return true;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,396 @@
+#include "baldr/graphreader.h"
+#include "baldr/graphmemory.h"
+#include "midgard/logging.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Bump this whenever the layout of the segment changes
+constexpr uint64_t SEGMENT_MAGIC = 0x76616c68616c6c61ull;
+constexpr uint64_t SEGMENT_VERSION = 2;
+// Roughly how many bytes of tiles we expect per index slot
+constexpr size_t BYTES_PER_SLOT = 16384;
+constexpr size_t MIN_SLOTS = 4096;
+// The tile structures need 8 byte alignment
+constexpr size_t TILE_ALIGNMENT = 8;
+// The graphids only take up this many bits, the tileset generation goes above them
+constexpr uint64_t GRAPHID_BITS = 46;
+// How long to wait for another process to finish creating the segment
+constexpr std::chrono::seconds OPEN_TIMEOUT(10);
+
+// The segment starts with this header, followed by the index slots and then the tile bytes
+struct segment_header_t {
+  std::atomic<uint64_t> magic;
+  uint64_t version;
+  uint64_t size;
+  uint64_t slot_count;
+  uint64_t data_offset;
+  // bytes of the data region handed out so far and how many slots are taken
+  uint64_t used;
+  uint64_t tile_count;
+#ifndef _WIN32
+  // process shared mutex guarding the inserts, lookups dont need it
+  pthread_mutex_t lock;
+#endif
+};
+
+struct segment_slot_t {
+  // graphid + 1 so that a zeroed slot is empty, set last so readers never see a partial tile
+  std::atomic<uint64_t> key;
+  uint64_t offset;
+  uint64_t size;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "The shared tile cache needs lock free atomics to work across processes");
+
+size_t align(size_t size) {
+  return (size + TILE_ALIGNMENT - 1) & ~(TILE_ALIGNMENT - 1);
+}
+
+size_t slot_count(size_t segment_size) {
+  size_t count = MIN_SLOTS;
+  while (count < segment_size / BYTES_PER_SLOT) {
+    count <<= 1;
+  }
+  return count;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+struct shared_tile_segment_t {
+  shared_tile_segment_t(const std::string& path, size_t segment_size) : base(nullptr), length(0) {
+#ifdef _WIN32
+    throw std::runtime_error("The shared memory tile cache is not supported on windows");
+#else
+    // whoever manages to create the file is responsible for setting it up
+    bool creator = true;
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd == -1 && errno == EEXIST) {
+      creator = false;
+      fd = open(path.c_str(), O_RDWR);
+    }
+    if (fd == -1) {
+      throw std::runtime_error(path + "(open): " + strerror(errno));
+    }
+
+    if (creator) {
+      auto slots = slot_count(segment_size);
+      auto data_offset = align(sizeof(segment_header_t) + slots * sizeof(segment_slot_t));
+      if (segment_size <= data_offset || ftruncate(fd, segment_size) == -1) {
+        close(fd);
+        unlink(path.c_str());
+        throw std::runtime_error(path + "(ftruncate): cannot size the shared tile cache to " +
+                                 std::to_string(segment_size) + " bytes");
+      }
+      length = segment_size;
+    } else {
+      length = wait_for_size(fd, path);
+    }
+
+    void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      throw std::runtime_error(path + "(mmap): " + strerror(errno));
+    }
+    base = static_cast<char*>(ptr);
+    header = reinterpret_cast<segment_header_t*>(base);
+    slots = reinterpret_cast<segment_slot_t*>(base + sizeof(segment_header_t));
+
+    if (creator) {
+      // the file starts out zeroed so the slots are already empty
+      if (!init_lock(header)) {
+        munmap(base, length);
+        unlink(path.c_str());
+        throw std::runtime_error(path + "(pthread_mutex_init): cannot set up the lock");
+      }
+      header->version = SEGMENT_VERSION;
+      header->size = length;
+      header->slot_count = slot_count(length);
+      header->data_offset =
+          align(sizeof(segment_header_t) + header->slot_count * sizeof(segment_slot_t));
+      header->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+      LOG_INFO("Created shared tile cache " + path + " of " + std::to_string(length) + " bytes");
+    } else {
+      auto until = std::chrono::steady_clock::now() + OPEN_TIMEOUT;
+      while (header->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC &&
+             std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      if (header->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC ||
+          header->version != SEGMENT_VERSION || header->size != length) {
+        munmap(base, length);
+        throw std::runtime_error(path + " is not a usable shared tile cache, remove it");
+      }
+    }
+#endif
+  }
+
+  ~shared_tile_segment_t() {
+#ifndef _WIN32
+    if (base) {
+      munmap(base, length);
+    }
+#endif
+  }
+
+  // returns the shared copy of the tile or nullptr if its not in the segment
+  const char* find(const GraphId& graphid, size_t& size) const {
+    const uint64_t key = graphid.value + 1;
+    const uint64_t mask = header->slot_count - 1;
+    for (uint64_t i = hash(key) & mask, probes = 0; probes < header->slot_count;
+         i = (i + 1) & mask, ++probes) {
+      const auto slot_key = slots[i].key.load(std::memory_order_acquire);
+      if (slot_key == 0) {
+        return nullptr;
+      }
+      if (slot_key == key) {
+        size = slots[i].size;
+        return base + header->data_offset + slots[i].offset;
+      }
+    }
+    return nullptr;
+  }
+
+  // copies the tile into the segment and returns the shared copy, nullptr if it is full
+  const char* insert(const GraphId& graphid, const char* bytes, size_t size) {
+    const uint64_t key = graphid.value + 1;
+    const uint64_t mask = header->slot_count - 1;
+    if (!lock()) {
+      return nullptr;
+    }
+
+    const char* shared = nullptr;
+    for (uint64_t i = hash(key) & mask, probes = 0; probes < header->slot_count;
+         i = (i + 1) & mask, ++probes) {
+      const auto slot_key = slots[i].key.load(std::memory_order_relaxed);
+      // someone else beat us to it
+      if (slot_key == key) {
+        shared = base + header->data_offset + slots[i].offset;
+        break;
+      }
+      if (slot_key != 0) {
+        continue;
+      }
+
+      // keep the index sparse enough for short probes and make sure the bytes fit
+      if (header->tile_count >= header->slot_count / 4 * 3 ||
+          header->used + align(size) > length - header->data_offset) {
+        break;
+      }
+      // the space is taken before the slot is published so that if we die part way through, the
+      // next one to get the lock only loses those bytes rather than overwriting a visible tile
+      char* destination = base + header->data_offset + header->used;
+      slots[i].offset = header->used;
+      slots[i].size = size;
+      header->used += align(size);
+      ++header->tile_count;
+      std::memcpy(destination, bytes, size);
+      slots[i].key.store(key, std::memory_order_release);
+      shared = destination;
+      break;
+    }
+
+#ifndef _WIN32
+    pthread_mutex_unlock(&header->lock);
+#endif
+    return shared;
+  }
+
+#ifndef _WIN32
+  // the mutex lives in the segment so every process mapping it has to be able to use it, and if
+  // one of them dies holding it the next one to lock it is told so instead of waiting forever
+  static bool init_lock(segment_header_t* header) {
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr)) {
+      return false;
+    }
+    bool ok = !pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifndef __APPLE__
+    ok = ok && !pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    ok = ok && !pthread_mutex_init(&header->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+  }
+#endif
+
+  // false if the lock cant be had, in which case the tile just stays private to this process
+  bool lock() {
+#ifdef _WIN32
+    return false;
+#else
+    int result = pthread_mutex_lock(&header->lock);
+#ifndef __APPLE__
+    // the previous holder died, inserting leaves the segment consistent at every step so carry on
+    if (result == EOWNERDEAD) {
+      LOG_WARN("A process died while inserting into the shared tile cache, recovering the lock");
+      result = pthread_mutex_consistent(&header->lock);
+    }
+#endif
+    if (result) {
+      LOG_ERROR(std::string("Cannot lock the shared tile cache: ") + strerror(result));
+      return false;
+    }
+    return true;
+#endif
+  }
+
+  static uint64_t hash(uint64_t key) {
+    key *= 0x9E3779B97F4A7C15ull;
+    return key ^ (key >> 32);
+  }
+
+#ifndef _WIN32
+  // the creator might not have sized the file yet
+  static size_t wait_for_size(int fd, const std::string& path) {
+    auto until = std::chrono::steady_clock::now() + OPEN_TIMEOUT;
+    struct stat s;
+    do {
+      if (fstat(fd, &s) == -1) {
+        close(fd);
+        throw std::runtime_error(path + "(fstat): " + strerror(errno));
+      }
+      if (s.st_size > 0) {
+        return s.st_size;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (std::chrono::steady_clock::now() < until);
+    close(fd);
+    throw std::runtime_error(path + " was never sized by the process that created it, remove it");
+  }
+#endif
+
+  char* base;
+  size_t length;
+  segment_header_t* header;
+  segment_slot_t* slots;
+};
+
+namespace {
+
+// Tile memory that lives in the segment, keeps the segment mapped as long as the tile is around
+class SharedGraphMemory final : public GraphMemory {
+public:
+  SharedGraphMemory(std::shared_ptr<shared_tile_segment_t> segment, const char* ptr, size_t length)
+      : segment_(std::move(segment)) {
+    data = const_cast<char*>(ptr);
+    size = length;
+  }
+
+private:
+  std::shared_ptr<shared_tile_segment_t> segment_;
+};
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// SharedMemoryTileCache implementation
+// ----------------------------------------------------------------------------
+
+// Constructor.
+SharedMemoryTileCache::SharedMemoryTileCache(const std::string& path,
+                                             size_t segment_size,
+                                             size_t max_size,
+                                             uint64_t tileset_generation)
+    : segment_(std::make_shared<shared_tile_segment_t>(path, segment_size)),
+      generation_bits_(tileset_generation << GRAPHID_BITS), cache_size_(0),
+      max_cache_size_(max_size), hits_(0), misses_(0) {
+}
+
+// Every process counts its tilesets the same way, so those of another process which has not
+// reloaded yet are kept apart from ours by the generation in the key
+GraphId SharedMemoryTileCache::segment_key(const GraphId& graphid) const {
+  return GraphId(generation_bits_ | graphid.value);
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void SharedMemoryTileCache::Reserve(size_t tile_size) {
+  cache_.reserve(max_cache_size_ / tile_size);
+}
+
+// Checks if tile exists in the cache.
+bool SharedMemoryTileCache::Contains(const GraphId& graphid) const {
+  size_t size;
+  return cache_.find(graphid) != cache_.end() || segment_->find(segment_key(graphid), size);
+}
+
+// Lets you know if the cache is too large.
+bool SharedMemoryTileCache::OverCommitted() const {
+  return cache_size_ > max_cache_size_;
+}
+
+// Clears the cache.
+void SharedMemoryTileCache::Clear() {
+  cache_size_ = 0;
+  cache_.clear();
+}
+
+void SharedMemoryTileCache::Trim() {
+  Clear();
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr SharedMemoryTileCache::Get(const GraphId& graphid) const {
+  auto cached = cache_.find(graphid);
+  if (cached != cache_.end()) {
+    ++hits_;
+    return cached->second;
+  }
+
+  // another process may have loaded it already
+  size_t size;
+  if (const char* shared = segment_->find(segment_key(graphid), size)) {
+    ++hits_;
+    auto tile =
+        GraphTile::Create(graphid, std::make_unique<SharedGraphMemory>(segment_, shared, size));
+    return cache_.emplace(graphid, std::move(tile)).first->second;
+  }
+
+  ++misses_;
+  return nullptr;
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr SharedMemoryTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  auto cached = cache_.find(graphid);
+  if (cached != cache_.end()) {
+    return cached->second;
+  }
+
+  // swap our private copy for the shared one if there is room for it
+  const auto tile_size = tile->header()->end_offset();
+  if (const char* shared =
+          segment_->insert(segment_key(graphid), reinterpret_cast<const char*>(tile->header()),
+                           tile_size)) {
+    tile = GraphTile::Create(graphid, std::make_unique<SharedGraphMemory>(segment_, shared,
+                                                                          tile_size));
+  } else {
+    cache_size_ += size;
+  }
+  return cache_.emplace(graphid, std::move(tile)).first->second;
+}
+
+TileCache::Stats SharedMemoryTileCache::GetStats() const {
+  return {hits_, misses_, 0};
+}
+
+} // namespace baldr
+} // namespace valhalla
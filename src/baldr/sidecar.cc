@@ -0,0 +1,72 @@
+#include "baldr/sidecar.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+namespace valhalla {
+namespace baldr {
+
+SidecarWriter::SidecarWriter(const std::string& file_name)
+    : file_name_(file_name), temp_name_(file_name + ".tmp"),
+      file_(temp_name_, std::ios::out | std::ios::binary | std::ios::trunc), committed_(false) {
+  if (!file_.is_open()) {
+    throw std::runtime_error("Failed to open " + temp_name_ + " for writing");
+  }
+}
+
+SidecarWriter::~SidecarWriter() {
+  if (!committed_) {
+    file_.close();
+    std::remove(temp_name_.c_str());
+  }
+}
+
+void SidecarWriter::commit() {
+  file_.close();
+  if (!file_) {
+    throw std::runtime_error("Failed to write " + temp_name_);
+  }
+  // readers never see a partial file, they either get the old one or this one
+  if (std::rename(temp_name_.c_str(), file_name_.c_str())) {
+    throw std::runtime_error("Failed to move " + temp_name_ + " to " + file_name_);
+  }
+  committed_ = true;
+}
+
+Sidecar::Sidecar(const std::string& file_name,
+                 const std::string& what,
+                 const uint64_t magic,
+                 const uint32_t version,
+                 const size_t header)
+    : file_name_(file_name), what_(what), version_(version) {
+  struct stat s;
+  if (stat(file_name.c_str(), &s) == -1) {
+    throw std::runtime_error("Failed to open " + file_name);
+  }
+  if (s.st_size == 0) {
+    throw std::runtime_error(file_name + " is empty");
+  }
+  try {
+    memmap_.map(file_name, s.st_size, POSIX_MADV_NORMAL, false, true);
+  } catch (const std::exception& e) {
+    throw std::runtime_error("Failed to map " + file_name + ": " + e.what());
+  }
+
+  // every header starts with the magic number followed by the version
+  const auto* magic_version = data();
+  check(size() >= header && size() >= sizeof(uint64_t) + sizeof(uint32_t) &&
+        *reinterpret_cast<const uint64_t*>(magic_version) == magic &&
+        *reinterpret_cast<const uint32_t*>(magic_version + sizeof(uint64_t)) == version);
+}
+
+void Sidecar::check(const bool valid) const {
+  if (!valid) {
+    throw std::runtime_error(file_name_ + " is not " + what_ + " of version " +
+                             std::to_string(version_));
+  }
+}
+
+} // namespace baldr
+} // namespace valhalla
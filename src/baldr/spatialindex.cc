@@ -0,0 +1,278 @@
+#include "baldr/spatialindex.h"
+#include "filesystem.h"
+#include "midgard/constants.h"
+#include "midgard/logging.h"
+#include "midgard/util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// "VALHSPIX" so that other files are not mistaken for an index
+constexpr uint64_t kMagic = 0x58495053484C4156ULL;
+constexpr uint32_t kVersion = 1;
+
+// How fine the Hilbert curve the entries are sorted along is
+constexpr uint32_t kHilbertBits = 16;
+
+// Rounds outward so that the stored box always covers the real one
+valhalla::baldr::SpatialIndex::Box to_box(const AABB2<PointLL>& bbox) {
+  auto down = [](const double v) {
+    float f = static_cast<float>(v);
+    return f > v ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+  };
+  auto up = [](const double v) {
+    float f = static_cast<float>(v);
+    return f < v ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+  };
+  return {down(bbox.minx()), down(bbox.miny()), up(bbox.maxx()), up(bbox.maxy())};
+}
+
+// Sorts the entries along the curve and groups them into the levels of the tree, the entries
+// come first and every level above holds the boxes around the groups of the level below it
+void pack(std::vector<std::pair<uint64_t, valhalla::baldr::SpatialIndex::Box>>& entries,
+          const std::vector<uint64_t>& level_ends,
+          std::vector<valhalla::baldr::SpatialIndex::Box>& boxes,
+          std::vector<uint64_t>& indices) {
+  using Box = valhalla::baldr::SpatialIndex::Box;
+  if (entries.empty()) {
+    return;
+  }
+
+  // where the centers of the boxes are on a grid over all of them
+  Box extent = entries.front().second;
+  for (const auto& entry : entries) {
+    extent.minx = std::min(extent.minx, entry.second.minx);
+    extent.miny = std::min(extent.miny, entry.second.miny);
+    extent.maxx = std::max(extent.maxx, entry.second.maxx);
+    extent.maxy = std::max(extent.maxy, entry.second.maxy);
+  }
+  const double cells = (1u << kHilbertBits) - 1;
+  const double width = std::max(static_cast<double>(extent.maxx) - extent.minx, 1e-9);
+  const double height = std::max(static_cast<double>(extent.maxy) - extent.miny, 1e-9);
+  std::vector<std::pair<uint64_t, uint64_t>> order;
+  order.reserve(entries.size());
+  for (uint64_t i = 0; i < entries.size(); ++i) {
+    const auto& box = entries[i].second;
+    auto x = static_cast<uint32_t>(
+        cells * ((static_cast<double>(box.minx) + box.maxx) / 2 - extent.minx) / width);
+    auto y = static_cast<uint32_t>(
+        cells * ((static_cast<double>(box.miny) + box.maxy) / 2 - extent.miny) / height);
+    order.emplace_back(valhalla::midgard::hilbert_distance(x, y, kHilbertBits), i);
+  }
+  std::sort(order.begin(), order.end());
+
+  boxes.resize(level_ends.back());
+  indices.resize(level_ends.back());
+  for (uint64_t i = 0; i < order.size(); ++i) {
+    const auto& entry = entries[order[i].second];
+    indices[i] = entry.first;
+    boxes[i] = entry.second;
+  }
+
+  // each level above covers the groups of the one below
+  for (size_t level = 1; level < level_ends.size(); ++level) {
+    uint64_t child = level > 1 ? level_ends[level - 2] : 0;
+    for (uint64_t parent = level_ends[level - 1]; parent < level_ends[level]; ++parent) {
+      const uint64_t end =
+          std::min(child + valhalla::baldr::SpatialIndex::kNodeSize, level_ends[level - 1]);
+      Box box = boxes[child];
+      indices[parent] = child;
+      for (; child < end; ++child) {
+        box.minx = std::min(box.minx, boxes[child].minx);
+        box.miny = std::min(box.miny, boxes[child].miny);
+        box.maxx = std::max(box.maxx, boxes[child].maxx);
+        box.maxy = std::max(box.maxy, boxes[child].maxy);
+      }
+      boxes[parent] = box;
+    }
+  }
+}
+
+inline bool intersects(const valhalla::baldr::SpatialIndex::Box& box, const AABB2<PointLL>& bbox) {
+  return box.minx <= bbox.maxx() && box.maxx >= bbox.minx() && box.miny <= bbox.maxy() &&
+         box.maxy >= bbox.miny();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t SpatialIndex::kNodeSize;
+
+std::string SpatialIndex::FileName(const std::string& tile_dir) {
+  std::string file_name = tile_dir;
+  if (!file_name.empty() && file_name.back() != filesystem::path::preferred_separator) {
+    file_name.push_back(filesystem::path::preferred_separator);
+  }
+  return file_name + "spatial.index";
+}
+
+std::vector<uint64_t> SpatialIndex::LevelEnds(const uint64_t count) {
+  std::vector<uint64_t> level_ends;
+  if (count == 0) {
+    return level_ends;
+  }
+  uint64_t level_count = count;
+  level_ends.push_back(count);
+  while (level_count > 1) {
+    level_count = (level_count + kNodeSize - 1) / kNodeSize;
+    level_ends.push_back(level_ends.back() + level_count);
+  }
+  return level_ends;
+}
+
+uint64_t SpatialIndex::Size(const uint64_t count) {
+  const auto level_ends = LevelEnds(count);
+  return level_ends.empty() ? 0 : level_ends.back();
+}
+
+void SpatialIndex::Write(const std::string& file_name,
+                         std::vector<std::pair<GraphId, PointLL>> nodes,
+                         std::vector<std::pair<GraphId, AABB2<PointLL>>> edges) {
+  Header header{};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.node_size = kNodeSize;
+  header.node_count = nodes.size();
+  header.edge_count = edges.size();
+
+  // pack each tree, freeing the input as we go since it can be large
+  std::vector<std::pair<uint64_t, Box>> entries;
+  entries.reserve(nodes.size());
+  for (const auto& node : nodes) {
+    entries.emplace_back(node.first.value, to_box(AABB2<PointLL>(node.second, node.second)));
+  }
+  decltype(nodes)().swap(nodes);
+  std::vector<Box> node_boxes;
+  std::vector<uint64_t> node_indices;
+  pack(entries, LevelEnds(header.node_count), node_boxes, node_indices);
+
+  entries.clear();
+  entries.reserve(edges.size());
+  for (const auto& edge : edges) {
+    entries.emplace_back(edge.first.value, to_box(edge.second));
+  }
+  decltype(edges)().swap(edges);
+  std::vector<Box> edge_boxes;
+  std::vector<uint64_t> edge_indices;
+  pack(entries, LevelEnds(header.edge_count), edge_boxes, edge_indices);
+
+  SidecarWriter file(file_name);
+  file.write(&header, 1);
+  file.write(node_boxes);
+  file.write(node_indices);
+  file.write(edge_boxes);
+  file.write(edge_indices);
+  file.commit();
+}
+
+SpatialIndex::SpatialIndex(const std::string& file_name)
+    : file_(file_name, "a spatial index", kMagic, kVersion, sizeof(Header)) {
+  // check that all the arrays fit in the file
+  header_ = reinterpret_cast<const Header*>(file_.data());
+  file_.check(header_->node_size == kNodeSize &&
+              file_.size() == sizeof(Header) + (Size(header_->node_count) +
+                                                Size(header_->edge_count)) *
+                                                   (sizeof(Box) + sizeof(uint64_t)));
+
+  const char* tree = file_.data() + sizeof(Header);
+  nodes_.level_ends = LevelEnds(header_->node_count);
+  nodes_.boxes = reinterpret_cast<const Box*>(tree);
+  nodes_.indices = reinterpret_cast<const uint64_t*>(nodes_.boxes + Size(header_->node_count));
+  tree = reinterpret_cast<const char*>(nodes_.indices + Size(header_->node_count));
+  edges_.level_ends = LevelEnds(header_->edge_count);
+  edges_.boxes = reinterpret_cast<const Box*>(tree);
+  edges_.indices = reinterpret_cast<const uint64_t*>(edges_.boxes + Size(header_->edge_count));
+  LOG_INFO("Loaded the spatial index of " + std::to_string(header_->node_count) + " nodes and " +
+           std::to_string(header_->edge_count) + " edges");
+}
+
+std::vector<GraphId> SpatialIndex::Search(const tree_t& tree, const AABB2<PointLL>& bbox) {
+  std::vector<GraphId> found;
+  if (tree.level_ends.empty()) {
+    return found;
+  }
+
+  // descend into every node that intersects, starting at the root
+  std::vector<std::pair<uint64_t, size_t>> stack;
+  const uint64_t root = tree.level_ends.back() - 1;
+  if (intersects(tree.boxes[root], bbox)) {
+    stack.emplace_back(root, tree.level_ends.size() - 1);
+  }
+  while (!stack.empty()) {
+    uint64_t position;
+    size_t level;
+    std::tie(position, level) = stack.back();
+    stack.pop_back();
+    if (level == 0) {
+      found.emplace_back(tree.indices[position]);
+      continue;
+    }
+    const uint64_t begin = tree.indices[position];
+    const uint64_t end = std::min(begin + kNodeSize, tree.level_ends[level - 1]);
+    for (uint64_t child = begin; child < end; ++child) {
+      if (intersects(tree.boxes[child], bbox)) {
+        stack.emplace_back(child, level - 1);
+      }
+    }
+  }
+  return found;
+}
+
+std::vector<GraphId> SpatialIndex::Nodes(const AABB2<PointLL>& bbox) const {
+  return Search(nodes_, bbox);
+}
+
+std::vector<GraphId> SpatialIndex::Edges(const AABB2<PointLL>& bbox) const {
+  return Search(edges_, bbox);
+}
+
+std::vector<GraphId> SpatialIndex::NearestNodes(const PointLL& point, const size_t count) const {
+  std::vector<GraphId> found;
+  if (nodes_.level_ends.empty() || count == 0) {
+    return found;
+  }
+
+  // best first, the distance to a box is never more than to anything in it
+  const double lng_scale = std::cos(point.lat() * kRadPerDegD);
+  auto sq_distance = [&](const Box& box) {
+    const double dx = (std::max<double>(box.minx, std::min<double>(point.lng(), box.maxx)) -
+                       point.lng()) *
+                      lng_scale;
+    const double dy =
+        std::max<double>(box.miny, std::min<double>(point.lat(), box.maxy)) - point.lat();
+    return dx * dx + dy * dy;
+  };
+  using item_t = std::tuple<double, uint64_t, size_t>;
+  std::priority_queue<item_t, std::vector<item_t>, std::greater<item_t>> queue;
+  const uint64_t root = nodes_.level_ends.back() - 1;
+  queue.emplace(sq_distance(nodes_.boxes[root]), root, nodes_.level_ends.size() - 1);
+  while (!queue.empty() && found.size() < count) {
+    const auto item = queue.top();
+    queue.pop();
+    const uint64_t position = std::get<1>(item);
+    const size_t level = std::get<2>(item);
+    if (level == 0) {
+      found.emplace_back(nodes_.indices[position]);
+      continue;
+    }
+    const uint64_t begin = nodes_.indices[position];
+    const uint64_t end = std::min(begin + kNodeSize, nodes_.level_ends[level - 1]);
+    for (uint64_t child = begin; child < end; ++child) {
+      queue.emplace(sq_distance(nodes_.boxes[child]), child, level - 1);
+    }
+  }
+  return found;
+}
+
+} // namespace baldr
+} // namespace valhalla
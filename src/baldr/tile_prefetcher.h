@@ -0,0 +1,182 @@
+#pragma once
+
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+// Loads tiles on a small pool of background threads ahead of when the caller needs them. Loaded
+// tiles are parked in a staging area until the owning GraphReader takes them out and puts them
+// into its own cache. Tiles are only ever referenced from one thread at a time: the worker that
+// loaded it, the staging area (under the mutex) or the thread that took it. That way none of this
+// needs thread safe reference counting on the tiles.
+struct tile_prefetcher_t {
+  using loader_t = std::function<graph_tile_ptr(const GraphId&)>;
+
+  /**
+   * Spin up the background workers
+   * @param thread_count  how many threads to load tiles with
+   * @param max_tiles     how many tiles can be queued, and separately staged, at once. new requests
+   *                      are dropped and old staged tiles are evicted beyond that
+   * @param loader        the function which loads a tile from wherever it lives, must be thread safe
+   */
+  tile_prefetcher_t(size_t thread_count, size_t max_tiles, loader_t loader)
+      : max_tiles_(std::max(max_tiles, static_cast<size_t>(1))), loader_(std::move(loader)),
+        done_(false) {
+    for (size_t i = 0; i < thread_count; ++i) {
+      workers_.emplace_back(&tile_prefetcher_t::work, this);
+    }
+    LOG_INFO("Tile prefetching enabled with " + std::to_string(thread_count) + " threads");
+  }
+
+  ~tile_prefetcher_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    signal_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  /**
+   * Ask for a tile to be loaded in the background. Tiles already queued or staged are ignored
+   * @param base  the tile to load
+   */
+  void enqueue(const GraphId& base) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (pending_.size() >= max_tiles_ || staged_.find(base) != staged_.end() ||
+          !pending_.insert(base).second) {
+        return;
+      }
+      queue_.push_back(base);
+    }
+    ++requested;
+    signal_.notify_one();
+  }
+
+  /**
+   * Take a tile out of the staging area if it was loaded. If a worker is busy loading it we wait
+   * for that rather than loading the same tile a second time. If it is still queued it is taken off
+   * the queue, the caller is going to load it anyway
+   * @param base  the tile to take
+   * @return the tile or nullptr if it wasnt prefetched
+   */
+  graph_tile_ptr take(const GraphId& base) {
+    graph_tile_ptr tile;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (loading_.find(base) != loading_.end()) {
+        ++waits;
+        loaded_signal_.wait(lock,
+                            [this, &base]() { return loading_.find(base) == loading_.end(); });
+      }
+      auto found = staged_.find(base);
+      if (found != staged_.end()) {
+        tile = std::move(found->second);
+        staged_.erase(found);
+      } else if (pending_.erase(base)) {
+        queue_.erase(std::find(queue_.begin(), queue_.end(), base));
+      }
+    }
+    ++(tile ? hits : misses);
+    return tile;
+  }
+
+  /**
+   * Forget everything that is queued or staged, eg because the tiles were replaced. Tiles being
+   * loaded right now are thrown away once they are
+   */
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& base : queue_) {
+      pending_.erase(base);
+    }
+    queue_.clear();
+    staged_.clear();
+    stale_.insert(loading_.begin(), loading_.end());
+  }
+
+  // counters so the prefetching can be tuned
+  std::atomic<uint64_t> requested{0}; // tiles queued for loading
+  std::atomic<uint64_t> loaded{0};    // tiles the workers managed to load
+  std::atomic<uint64_t> hits{0};      // cache misses that were served by a prefetched tile
+  std::atomic<uint64_t> misses{0};    // cache misses that still had to load the tile in place
+  std::atomic<uint64_t> waits{0};     // cache misses that waited for a worker to finish the tile
+
+protected:
+  void work() {
+    while (true) {
+      GraphId base;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        signal_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+        if (done_) {
+          return;
+        }
+        base = queue_.front();
+        queue_.pop_front();
+        loading_.insert(base);
+      }
+
+      // this is the slow part (disk or network) so we do it without holding the lock
+      graph_tile_ptr tile;
+      try {
+        tile = loader_(base);
+      } catch (const std::exception& e) {
+        LOG_WARN("Failed to prefetch tile " + std::to_string(base) + ": " + e.what());
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.erase(base);
+        loading_.erase(base);
+        if (stale_.erase(base)) {
+          tile.reset();
+        }
+        if (tile) {
+          ++loaded;
+          // make room by dropping one nobody asked for, the search has probably gone elsewhere
+          if (staged_.size() >= max_tiles_) {
+            staged_.erase(staged_.begin());
+          }
+          staged_.emplace(base, std::move(tile));
+        }
+      }
+      // someone may be waiting on exactly this tile
+      loaded_signal_.notify_all();
+    }
+  }
+
+  const size_t max_tiles_;
+  const loader_t loader_;
+  std::mutex mutex_;
+  std::condition_variable signal_;
+  std::condition_variable loaded_signal_;
+  bool done_;
+  std::deque<GraphId> queue_;
+  std::unordered_set<GraphId> pending_;
+  std::unordered_set<GraphId> loading_;
+  std::unordered_set<GraphId> stale_;
+  std::unordered_map<GraphId, graph_tile_ptr> staged_;
+  std::vector<std::thread> workers_;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -46,17 +46,15 @@ midgard::AABB2<midgard::PointLL> TileHierarchy::GetGraphIdBoundingBox(const Grap
   return tileLevel.tiles.TileBounds(id.tileid());
 }
 
-// Returns the GraphId of the requested tile based on a lat,lng and a level.
-// If the level is not supported an invalid id will be returned.
-GraphId TileHierarchy::GetGraphId(const midgard::PointLL& pointll, const uint8_t level) {
-  GraphId id;
-  if (level < levels().size()) {
-    auto tile_id = levels()[level].tiles.TileId(pointll);
-    if (tile_id >= 0) {
-      id = {static_cast<uint32_t>(tile_id), level, 0};
-    }
+// Returns the GraphIds of the tiles the points are in at a level, one per point.
+std::vector<GraphId> TileHierarchy::GetGraphIds(const std::vector<midgard::PointLL>& points,
+                                                const uint8_t level) {
+  std::vector<GraphId> ids;
+  ids.reserve(points.size());
+  for (const auto& point : points) {
+    ids.push_back(GetGraphId(point, level));
   }
-  return id;
+  return ids;
 }
 
 // Gets the hierarchy level given the road class.
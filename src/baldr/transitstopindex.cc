@@ -0,0 +1,92 @@
+#include "baldr/transitstopindex.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/constants.h"
+#include "midgard/distanceapproximator.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::midgard;
+
+namespace valhalla {
+namespace baldr {
+
+TransitStopIndex::TransitStopIndex(const boost::property_tree::ptree& pt) {
+  const auto& level = TileHierarchy::GetTransitLevel();
+  const auto bins = static_cast<uint64_t>(level.tiles.nsubdivisions()) * level.tiles.nsubdivisions();
+
+  // Gather the stops with their cells
+  GraphReader reader(pt);
+  std::vector<uint64_t> cells;
+  std::vector<PointLL> stops;
+  for (const auto& tile_id : reader.GetTileSet(level.level)) {
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      const auto* node = tile->node(i);
+      if (node->type() != NodeType::kTransitStation &&
+          node->type() != NodeType::kMultiUseTransitPlatform) {
+        continue;
+      }
+      auto ll = node->latlng(tile->header()->base_ll());
+      for (const auto& cell : level.tiles.Intersect(AABB2<PointLL>(ll, ll))) {
+        cells.push_back(static_cast<uint64_t>(cell.first) * bins + *cell.second.begin());
+        stops.push_back(ll);
+        break;
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // Sort them by cell
+  std::vector<size_t> order(stops.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&cells](size_t a, size_t b) { return cells[a] < cells[b]; });
+  cells_.reserve(order.size());
+  stops_.reserve(order.size());
+  for (auto i : order) {
+    cells_.push_back(cells[i]);
+    stops_.push_back(stops[i]);
+  }
+  LOG_INFO("Indexed " + std::to_string(stops_.size()) + " transit stops");
+}
+
+bool TransitStopIndex::Within(const PointLL& ll, const float radius) const {
+  if (stops_.empty()) {
+    return false;
+  }
+
+  // Look at the stops of the cells the box around the radius touches
+  const auto& tiles = TileHierarchy::GetTransitLevel().tiles;
+  const auto bins = static_cast<uint64_t>(tiles.nsubdivisions()) * tiles.nsubdivisions();
+  DistanceApproximator<PointLL> approximator(ll);
+  double latdeg = double(radius) / kMetersPerDegreeLat;
+  double lngdeg = radius / DistanceApproximator<PointLL>::MetersPerLngDegree(ll.lat());
+  AABB2<PointLL> bbox(PointLL(ll.lng() - lngdeg, ll.lat() - latdeg),
+                      PointLL(ll.lng() + lngdeg, ll.lat() + latdeg));
+  const double sq_radius = double(radius) * radius;
+  for (const auto& tile : tiles.Intersect(bbox)) {
+    for (auto bin : tile.second) {
+      auto cell = std::equal_range(cells_.begin(), cells_.end(),
+                                   static_cast<uint64_t>(tile.first) * bins + bin);
+      for (auto stop = cell.first; stop != cell.second; ++stop) {
+        if (approximator.DistanceSquared(stops_[stop - cells_.begin()]) <= sq_radius) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,77 @@
+#include "baldr/truckrestrictions.h"
+
+#include "baldr/graphconstants.h"
+
+namespace {
+
+using valhalla::baldr::TruckRestrictions;
+
+// The smallest limit of each bucket from 1 to 7 of each type of limit, in meters and metric tons.
+// They are picked around the common signed limits and truck sizes so that most limits a truck
+// passes fall into a bucket that it passes as a whole
+constexpr float kBuckets[TruckRestrictions::kLimitCount][7] = {
+    {2.f, 2.5f, 3.f, 3.5f, 4.f, 4.2f, 4.5f},         // height
+    {1.8f, 2.f, 2.2f, 2.5f, 2.6f, 3.f, 3.5f},        // width
+    {5.f, 7.5f, 10.f, 12.f, 16.5f, 18.75f, 22.f},    // length
+    {3.5f, 5.f, 7.5f, 12.f, 18.f, 26.f, 40.f},       // weight
+    {2.f, 4.f, 6.f, 8.f, 10.f, 11.5f, 13.f},         // axle load
+};
+
+uint8_t passed_buckets(const uint32_t limit, const float value) {
+  // no limit at all is always passed, as is any bucket starting at or above the value
+  uint8_t passed = 1;
+  for (uint32_t b = 0; b < 7; ++b) {
+    if (kBuckets[limit][b] >= value) {
+      passed |= 1 << (b + 1);
+    }
+  }
+  return passed;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+void TruckRestrictions::Add(const AccessRestriction& restriction) {
+  if (!(restriction.modes() & kTruckAccess)) {
+    return;
+  }
+  const auto type = static_cast<uint32_t>(restriction.type());
+  const auto first = static_cast<uint32_t>(AccessType::kMaxHeight);
+  if (type < first || type >= first + kLimitCount) {
+    value_ |= kCheckRestrictions;
+    return;
+  }
+
+  // round the limit down to its bucket, limits below the smallest one need a look
+  const uint32_t limit = type - first;
+  const float value = static_cast<float>(restriction.value() * 0.01);
+  uint32_t b = 0;
+  while (b < 7 && kBuckets[limit][b] <= value) {
+    ++b;
+  }
+  if (b == 0) {
+    value_ |= kCheckRestrictions;
+    return;
+  }
+
+  // only the tightest limit of each type counts
+  const uint32_t current = bucket(limit);
+  if (current == 0 || b < current) {
+    const uint32_t shift = limit * kBucketBits;
+    value_ = static_cast<uint16_t>((value_ & ~(kBucketMask << shift)) | (b << shift));
+  }
+}
+
+TruckRestrictions::buckets_t TruckRestrictions::PassedBuckets(const float height,
+                                                              const float width,
+                                                              const float length,
+                                                              const float weight,
+                                                              const float axle_load) {
+  return {passed_buckets(0, height), passed_buckets(1, width), passed_buckets(2, length),
+          passed_buckets(3, weight), passed_buckets(4, axle_load)};
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,4 +1,5 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 #include "baldr/rapidjson_utils.h"
 #include <boost/make_shared.hpp>
@@ -6,13 +7,20 @@
 #include <boost/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "baldr/rapidjson_utils.h"
 #include "midgard/logging.h"
+#include "baldr/graphreader.h"
 #include "midgard/util.h"
+#include "thor/expansion_pool.h"
 #include "tyr/actor.h"
+#include "worker.h"
 
 namespace {
 
@@ -55,67 +63,155 @@ void py_configure(const std::string& config_file) {
 
 namespace py = pybind11;
 
-struct simplified_actor_t : public valhalla::tyr::actor_t {
-  simplified_actor_t(const boost::property_tree::ptree& config)
-      : valhalla::tyr::actor_t::actor_t(config, true) {
+namespace {
+
+// the members of actor_t which answer a request
+using action_t = std::string (valhalla::tyr::actor_t::*)(const std::string&,
+                                                        const std::function<void()>*,
+                                                        valhalla::Api*);
+
+// the binary formats come back as bytes, everything else is text
+py::object to_python(std::string& response, bool as_bytes) {
+  if (as_bytes) {
+    return py::bytes(response);
+  }
+  return py::str(response);
+}
+
+// the config of an actor which answers on several threads, they all share one tile cache
+boost::property_tree::ptree threaded(boost::property_tree::ptree config, size_t threads) {
+  if (threads > 1) {
+    config.put("mjolnir.global_synchronized_cache", true);
+  }
+  return config;
+}
+
+/**
+ * Answers requests without holding the GIL, so other python threads carry on meanwhile. One call
+ * is answered at a time, the batch calls spread their requests over a pool of threads which each
+ * have an actor of their own. Graph readers aren't thread safe so every thread has its own, when
+ * there is more than one thread they share the global synchronized tile cache.
+ */
+struct simplified_actor_t {
+  simplified_actor_t(const boost::property_tree::ptree& config, size_t threads)
+      : config(threaded(config, threads)), reader(this->config.get_child("mjolnir")),
+        pool(this->config.get_child("mjolnir"), std::max<size_t>(threads, 1) - 1),
+        actors(pool.size()) {
+    actors[0].reset(new valhalla::tyr::actor_t(this->config, reader, true));
   }
 
-  std::string route(const std::string& request_str) {
-    return valhalla::tyr::actor_t::route(request_str, nullptr, nullptr);
-  };
-  std::string locate(const std::string& request_str) {
-    return valhalla::tyr::actor_t::locate(request_str, nullptr, nullptr);
-  };
-  std::string optimized_route(const std::string& request_str) {
-    return valhalla::tyr::actor_t::optimized_route(request_str, nullptr, nullptr);
-  };
-  std::string matrix(const std::string& request_str) {
-    return valhalla::tyr::actor_t::matrix(request_str, nullptr, nullptr);
-  };
-  std::string isochrone(const std::string& request_str) {
-    return valhalla::tyr::actor_t::isochrone(request_str, nullptr, nullptr);
-  };
-  std::string trace_route(const std::string& request_str) {
-    return valhalla::tyr::actor_t::trace_route(request_str, nullptr, nullptr);
-  };
-  std::string trace_attributes(const std::string& request_str) {
-    return valhalla::tyr::actor_t::trace_attributes(request_str, nullptr, nullptr);
-  };
-  std::string height(const std::string& request_str) {
-    return valhalla::tyr::actor_t::height(request_str, nullptr, nullptr);
-  };
-  std::string transit_available(const std::string& request_str) {
-    return valhalla::tyr::actor_t::transit_available(request_str, nullptr, nullptr);
-  };
-  std::string expansion(const std::string& request_str) {
-    return valhalla::tyr::actor_t::expansion(request_str, nullptr, nullptr);
-  };
+  py::object act(action_t action, const std::string& request_str) {
+    std::string response;
+    valhalla::Api api;
+    {
+      py::gil_scoped_release release;
+      std::lock_guard<std::mutex> lock(mutex);
+      response = ((*actors[0]).*action)(request_str, nullptr, &api);
+    }
+    return to_python(response, api.options().format() == valhalla::Options::pbf);
+  }
+
+  py::list act_many(action_t action, const std::vector<std::string>& requests) {
+    std::vector<std::string> responses(requests.size());
+    std::vector<char> as_bytes(requests.size(), false);
+    {
+      py::gil_scoped_release release;
+      std::lock_guard<std::mutex> lock(mutex);
+      pool.Run(
+          requests.size(),
+          [&](size_t index, size_t thread, valhalla::baldr::GraphReader& thread_reader) {
+            auto& actor = actors[thread];
+            if (!actor) {
+              actor.reset(new valhalla::tyr::actor_t(config, thread_reader, true));
+            }
+            // a request that can't be answered gets its error in its place so the others still
+            // come back
+            valhalla::Api api;
+            try {
+              responses[index] = ((*actor).*action)(requests[index], nullptr, &api);
+              as_bytes[index] = api.options().format() == valhalla::Options::pbf;
+            } catch (const valhalla::valhalla_exception_t& e) {
+              actor->cleanup();
+              responses[index] = valhalla::jsonify_error(e, api);
+            } catch (const std::exception& e) {
+              actor->cleanup();
+              responses[index] = valhalla::jsonify_error({599, std::string(e.what())}, api);
+            }
+          },
+          reader);
+    }
+    py::list result;
+    for (size_t i = 0; i < responses.size(); ++i) {
+      result.append(to_python(responses[i], as_bytes[i]));
+    }
+    return result;
+  }
+
+  boost::property_tree::ptree config;
+  valhalla::baldr::GraphReader reader;
+  valhalla::thor::ExpansionPool pool;
+  // one for every thread of the pool, the first one also answers the single calls
+  std::vector<std::unique_ptr<valhalla::tyr::actor_t>> actors;
+  std::mutex mutex;
 };
 
+// binds a call answering one request and one answering a list of them
+template <typename actor_class_t>
+void def_action(actor_class_t& actor_class,
+                const char* name,
+                action_t action,
+                const std::string& doc) {
+  actor_class
+      .def(
+          name,
+          [action](simplified_actor_t& self, const std::string& request) {
+            return self.act(action, request);
+          },
+          doc.c_str())
+      .def(
+          (std::string(name) + "Many").c_str(),
+          [action](simplified_actor_t& self, const std::vector<std::string>& requests) {
+            return self.act_many(action, requests);
+          },
+          (doc + " Answers a list of requests on the threads of the actor, in the same order, a "
+                 "request which fails has its error in its place.")
+              .c_str());
+}
+
+} // namespace
+
 PYBIND11_MODULE(python_valhalla, m) {
   m.def("Configure", py_configure);
 
-  py::class_<simplified_actor_t, std::shared_ptr<simplified_actor_t>>(m, "Actor")
-      .def(py::init<>([]() { return std::make_shared<simplified_actor_t>(configure()); }))
-      .def("Route", &simplified_actor_t::route, "Calculates a route.")
-      .def("Locate", &simplified_actor_t::locate, "Provides information about nodes and edges.")
-      .def("OptimizedRoute", &simplified_actor_t::optimized_route,
-           "Optimizes the order of a set of waypoints by time.")
-      .def(
-          "Matrix", &simplified_actor_t::matrix,
-          "Computes the time and distance between a set of locations and returns them as a matrix table.")
-      .def("Isochrone", &simplified_actor_t::isochrone, "Calculates isochrones and isodistances.")
-      .def("TraceRoute", &simplified_actor_t::trace_route,
-           "Map-matching for a set of input locations, e.g. from a GPS.")
-      .def(
-          "TraceAttributes", &simplified_actor_t::trace_attributes,
-          "Returns detailed attribution along each portion of a route calculated from a set of input locations, e.g. from a GPS trace.")
-      .def("Height", &simplified_actor_t::height,
-           "Provides elevation data for a set of input geometries.")
-      .def(
-          "TransitAvailable", &simplified_actor_t::transit_available,
-          "Lookup if transit stops are available in a defined radius around a set of input locations.")
-      .def(
-          "Expansion", &simplified_actor_t::expansion,
-          "Returns all road segments which were touched by the routing algorithm during the graph traversal.");
+  using valhalla::tyr::actor_t;
+  py::class_<simplified_actor_t, std::shared_ptr<simplified_actor_t>> actor(m, "Actor");
+  actor.def(py::init<>([](size_t threads) {
+              return std::make_shared<simplified_actor_t>(configure(), threads);
+            }),
+            py::arg("threads") = 1);
+  def_action(actor, "Route", &actor_t::route, "Calculates a route.");
+  def_action(actor, "Locate", &actor_t::locate, "Provides information about nodes and edges.");
+  def_action(actor, "OptimizedRoute", &actor_t::optimized_route,
+             "Optimizes the order of a set of waypoints by time.");
+  def_action(
+      actor, "Matrix", &actor_t::matrix,
+      "Computes the time and distance between a set of locations and returns them as a matrix table.");
+  def_action(actor, "Isochrone", &actor_t::isochrone, "Calculates isochrones and isodistances.");
+  def_action(actor, "TraceRoute", &actor_t::trace_route,
+             "Map-matching for a set of input locations, e.g. from a GPS.");
+  def_action(
+      actor, "TraceAttributes", &actor_t::trace_attributes,
+      "Returns detailed attribution along each portion of a route calculated from a set of input locations, e.g. from a GPS trace.");
+  def_action(actor, "Height", &actor_t::height,
+             "Provides elevation data for a set of input geometries.");
+  def_action(
+      actor, "TransitAvailable", &actor_t::transit_available,
+      "Lookup if transit stops are available in a defined radius around a set of input locations.");
+  def_action(actor, "RouteBatch", &actor_t::route_batch,
+             "Calculates many independent routes at once.");
+  def_action(actor, "Recost", &actor_t::recost,
+             "Returns the time and cost of a known path given by its edges.");
+  def_action(
+      actor, "Expansion", &actor_t::expansion,
+      "Returns all road segments which were touched by the routing algorithm during the graph traversal.");
 }
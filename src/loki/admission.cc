@@ -0,0 +1,166 @@
+#include "loki/admission.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include "midgard/constants.h"
+#include "midgard/pointll.h"
+#include "proto_conversions.h"
+#include "worker.h"
+
+using namespace valhalla;
+
+namespace {
+
+// how much a finished request moves the estimate of the milliseconds per unit of its action
+constexpr double kEstimateWeight = 0.1;
+
+// the kilometers between consecutive locations plus a unit for each of them
+double route_units(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations) {
+  double units = locations.size();
+  for (int i = 1; i < locations.size(); ++i) {
+    midgard::PointLL a(locations.Get(i - 1).ll().lng(), locations.Get(i - 1).ll().lat());
+    midgard::PointLL b(locations.Get(i).ll().lng(), locations.Get(i).ll().lat());
+    units += a.Distance(b) * midgard::kKmPerMeter;
+  }
+  return units;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace loki {
+
+// what the requests of one action have in common across the whole process
+struct Admission::Ticket::state_t {
+  std::atomic<size_t> in_progress{0};
+  std::mutex mutex;
+  double ms_per_unit = 0;
+  bool estimated = false;
+
+  double estimate(double units) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ms_per_unit * units;
+  }
+
+  void finished(double units, double ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ms_per_unit = estimated ? ms_per_unit + kEstimateWeight * (ms / units - ms_per_unit)
+                            : ms / units;
+    estimated = true;
+  }
+
+  static std::shared_ptr<state_t> get(Options::Action action) {
+    static std::mutex mutex;
+    static std::unordered_map<int, std::shared_ptr<state_t>> states;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& state = states[action];
+    if (!state) {
+      state = std::make_shared<state_t>();
+    }
+    return state;
+  }
+};
+
+Admission::Ticket::Ticket(Ticket&& other)
+    : state_(std::move(other.state_)), units_(other.units_), start_(other.start_) {
+  other.state_.reset();
+}
+
+Admission::Ticket::~Ticket() {
+  if (!state_) {
+    return;
+  }
+  --state_->in_progress;
+  auto elapsed = std::chrono::duration<double, std::milli>(clock_t::now() - start_).count();
+  state_->finished(units_, elapsed);
+  state_.reset();
+}
+
+Admission::Admission(const boost::property_tree::ptree& config)
+    : max_concurrent_(config.get<size_t>("loki.admission.max_concurrent", 0)),
+      default_deadline_(config.get<uint64_t>("loki.admission.deadline", 0)) {
+}
+
+Admission::Ticket Admission::Admit(Api& request) const {
+  const auto& options = request.options();
+  uint64_t deadline = options.has_deadline() ? options.deadline() : default_deadline_;
+  if (deadline) {
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    request.mutable_info()->set_deadline(now + deadline);
+  }
+
+  // are there already as many of these in progress as we allow
+  auto state = Ticket::state_t::get(options.action());
+  if (state->in_progress.fetch_add(1) >= max_concurrent_ && max_concurrent_) {
+    --state->in_progress;
+    throw valhalla_exception_t{173, " " + std::to_string(max_concurrent_) + " " +
+                                        Options_Action_Enum_Name(options.action()) +
+                                        " requests are in progress"};
+  }
+
+  // would it be done in time
+  Ticket ticket;
+  ticket.state_ = state;
+  ticket.units_ = Units(request);
+  ticket.start_ = clock_t::now();
+  auto estimate = state->estimate(ticket.units_);
+  if (deadline && estimate > deadline) {
+    ticket.state_.reset();
+    --state->in_progress;
+    throw valhalla_exception_t{173, " it is estimated to take " +
+                                        std::to_string(static_cast<uint64_t>(estimate)) + "ms"};
+  }
+  return ticket;
+}
+
+double Admission::Units(const Api& request) {
+  const auto& options = request.options();
+  double units = 1;
+  switch (options.action()) {
+    case Options::route:
+    case Options::expansion:
+      units = route_units(options.locations());
+      break;
+    case Options::route_batch:
+      units = 0;
+      for (const auto& route : options.batch()) {
+        units += route_units(route.locations());
+      }
+      break;
+    case Options::sources_to_targets:
+      units = static_cast<double>(options.sources_size()) * options.targets_size();
+      break;
+    case Options::optimized_route:
+      units = static_cast<double>(options.locations_size()) * options.locations_size();
+      break;
+    case Options::isochrone: {
+      double minutes = 0;
+      for (const auto& contour : options.contours()) {
+        minutes = std::max<double>(minutes, contour.time() + contour.distance());
+      }
+      units = options.locations_size() * minutes;
+      break;
+    }
+    case Options::recost:
+      // a known path is only walked once, an edge is far less work than a point to match
+      units = options.recost_edges_size() / 10.;
+      break;
+    case Options::trace_route:
+    case Options::trace_attributes:
+    case Options::height:
+      // a point of an encoded shape takes a handful of characters
+      units = options.shape_size() + options.trace_size() + options.encoded_polyline().size() / 6;
+      break;
+    default:
+      break;
+  }
+  return std::max(units, 1.);
+}
+
+} // namespace loki
+} // namespace valhalla
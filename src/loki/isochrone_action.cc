@@ -65,6 +65,12 @@ void loki_worker_t::init_isochrones(Api& request) {
   }
 
   parse_costing(request);
+
+  // the multimodal expansion only goes away from the locations
+  if ((options.reverse() || options.both_directions()) &&
+      (options.costing() == Costing::multimodal || options.costing() == Costing::transit)) {
+    throw valhalla_exception_t{141};
+  }
 }
 void loki_worker_t::isochrones(Api& request) {
   // time this whole method and save that statistic
@@ -84,7 +90,7 @@ void loki_worker_t::isochrones(Api& request) {
   try {
     // correlate the various locations to the underlying graph
     auto locations = PathLocation::fromPBF(options.locations());
-    const auto projections = loki::Search(locations, *reader, costing);
+    const auto projections = search(request, locations);
     for (size_t i = 0; i < locations.size(); ++i) {
       const auto& projection = projections.at(locations[i]);
       PathLocation::toPBF(projection, options.mutable_locations(i), *reader);
@@ -2,6 +2,7 @@
 #include "loki/worker.h"
 
 #include <unordered_map>
+#include <unordered_set>
 
 #include "baldr/datetime.h"
 #include "baldr/rapidjson_utils.h"
@@ -115,8 +116,10 @@ void loki_worker_t::matrix(Api& request) {
 
   // correlate the various locations to the underlying graph
   std::unordered_map<size_t, size_t> color_counts;
+  std::vector<std::unordered_set<uint32_t>> components(sources_targets.size());
+  bool use_components = true;
   try {
-    const auto searched = loki::Search(sources_targets, *reader, costing);
+    const auto searched = search(request, sources_targets, search_pool.get());
     for (size_t i = 0; i < sources_targets.size(); ++i) {
       const auto& l = sources_targets[i];
       const auto& projection = searched.at(l);
@@ -140,6 +143,9 @@ void loki_worker_t::matrix(Api& request) {
           ++itr->second;
         }
       }
+      use_components = use_components &&
+                       connectivity_map->get_components(projection, costing->access_mode(),
+                                                        components[i]);
     }
   } catch (const std::exception&) { throw valhalla_exception_t{171}; }
 
@@ -157,6 +163,22 @@ void loki_worker_t::matrix(Api& request) {
   if (!connected) {
     throw valhalla_exception_t{170};
   };
+
+  // and at least one source shares a component of the edges the costing can use with a target,
+  // the pairs which dont are left to the matrix to find no path for
+  if (!use_components) {
+    return;
+  }
+  const auto targets_begin = components.cbegin() + options.sources_size();
+  for (auto source = components.cbegin(); source != targets_begin; ++source) {
+    for (auto target = targets_begin; target != components.cend(); ++target) {
+      if (std::any_of(source->cbegin(), source->cend(),
+                      [&target](uint32_t c) { return target->count(c) > 0; })) {
+        return;
+      }
+    }
+  }
+  throw valhalla_exception_t{170};
 }
 } // namespace loki
 } // namespace valhalla
@@ -365,9 +365,25 @@ namespace valhalla {
 namespace loki {
 
 std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
-                                          baldr::GraphReader& reader) {
+                                          baldr::GraphReader& reader,
+                                          const baldr::SpatialIndex* index) {
   std::vector<vb::GraphId> nodes;
 
+  // the index has every node but its coordinates are rounded, so check them in the tiles
+  if (index) {
+    tile_cache cache(reader);
+    filtered_nodes filtered(bbox, nodes);
+    auto candidates = index->Nodes(bbox);
+    std::sort(candidates.begin(), candidates.end(), sort_by_tile());
+    for (auto node_id : candidates) {
+      if (cache(node_id).exists()) {
+        filtered.push_back(node_id, cache.node_ll(node_id));
+      }
+    }
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+  }
+
   const auto& tiles = vb::TileHierarchy::levels().back().tiles;
   const uint8_t bin_level = vb::TileHierarchy::levels().back().level;
 
@@ -423,7 +439,14 @@ std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
 }
 
 std::vector<baldr::GraphId> edges_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
-                                          baldr::GraphReader& reader) {
+                                          baldr::GraphReader& reader,
+                                          const baldr::SpatialIndex* index) {
+  // the index already has each edge only once
+  if (index) {
+    auto edge_ids = index->Edges(bbox);
+    std::sort(edge_ids.begin(), edge_ids.end(), sort_by_tile());
+    return edge_ids;
+  }
 
   auto tiles = vb::TileHierarchy::levels().back().tiles;
   const uint8_t bin_level = vb::TileHierarchy::levels().back().level;
@@ -1,4 +1,5 @@
 #include "loki/reach.h"
+#include "midgard/tracepoint.h"
 
 using namespace valhalla::baldr;
 
@@ -52,6 +53,7 @@ directed_reach Reach::operator()(const DirectedEdge* edge,
   if (max_reach == 0)
     return reach;
   max_reach_ = max_reach;
+  VALHALLA_TRACE2(reach_start, edge_id.value, max_reach);
 
   // these are used below to get conservative estimates of forward and reverse reach
   constexpr uint16_t forward_disallow_mask =
@@ -147,6 +149,7 @@ directed_reach Reach::operator()(const DirectedEdge* edge,
     reach.inbound = std::max(reach.inbound, retry_reach.inbound);
   }
 
+  VALHALLA_TRACE3(reach_done, edge_id.value, reach.outbound, reach.inbound);
   return reach;
 }
 
@@ -183,14 +186,14 @@ directed_reach Reach::exact(const valhalla::baldr::DirectedEdge* edge,
   // expand in the forward direction
   if (direction | kOutbound) {
     Clear();
-    Compute(locations_, reader, costings, costing->travel_mode());
+    Compute<Reach>(locations_, reader, costings, costing->travel_mode());
     reach.outbound = std::min(static_cast<uint32_t>(done_.size() - transitions_), max_reach);
   }
 
   // expand in the reverse direction
   if (direction | kInbound) {
     Clear();
-    ComputeReverse(locations_, reader, costings, costing->travel_mode());
+    ComputeReverse<Reach>(locations_, reader, costings, costing->travel_mode());
     reach.inbound = std::min(static_cast<uint32_t>(done_.size() - transitions_), max_reach);
   }
 
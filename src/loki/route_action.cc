@@ -7,6 +7,9 @@
 #include "midgard/logging.h"
 #include "midgard/util.h"
 
+#include <algorithm>
+#include <unordered_set>
+
 using namespace valhalla;
 using namespace valhalla::baldr;
 
@@ -15,6 +18,19 @@ midgard::PointLL to_ll(const valhalla::Location& l) {
   return midgard::PointLL{l.ll().lng(), l.ll().lat()};
 }
 
+// Whether every location shares a component with the next one, the legs between any which dont
+// cant be routed
+bool share_components(const std::vector<std::unordered_set<uint32_t>>& components) {
+  for (size_t i = 1; i < components.size(); ++i) {
+    const auto& next = components[i];
+    if (std::none_of(components[i - 1].cbegin(), components[i - 1].cend(),
+                     [&next](uint32_t c) { return next.count(c) > 0; })) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void check_locations(const size_t location_count, const size_t max_locations) {
   // check that location size does not exceed max.
   if (location_count > max_locations) {
@@ -42,27 +58,9 @@ void check_distance(const google::protobuf::RepeatedPtrField<valhalla::Location>
 namespace valhalla {
 namespace loki {
 
-void loki_worker_t::init_route(Api& request) {
-  parse_locations(request.mutable_options()->mutable_locations());
-  // need to check location size here instead of in parse_locations because of locate action needing
-  // a different size
-  if (request.options().locations_size() < 2) {
-    throw valhalla_exception_t{120};
-  };
-  parse_costing(request);
-}
-
-void loki_worker_t::route(Api& request) {
-  // time this whole method and save that statistic
-  auto _ = measure_scope_time(request, "loki_worker_t::route");
-
-  init_route(request);
-  auto& options = *request.mutable_options();
-  const auto& costing_name = Costing_Enum_Name(options.costing());
-  check_locations(options.locations_size(), max_locations.find(costing_name)->second);
-  check_distance(options.locations(), max_distance.find(costing_name)->second);
-
+void loki_worker_t::check_walking_distances(Options& options) const {
   // Validate walking distances (make sure they are in the accepted range)
+  const auto& costing_name = Costing_Enum_Name(options.costing());
   if (costing_name == "multimodal" || costing_name == "transit") {
     auto* ped_opts = options.mutable_costing_options(static_cast<int>(pedestrian));
     if (!ped_opts->has_transit_start_end_max_distance())
@@ -84,12 +82,37 @@ void loki_worker_t::route(Api& request) {
                                           std::to_string(max_transit_walking_dis) + " (Meters)"};
     }
   }
+}
+
+void loki_worker_t::init_route(Api& request) {
+  parse_locations(request.mutable_options()->mutable_locations());
+  // need to check location size here instead of in parse_locations because of locate action needing
+  // a different size
+  if (request.options().locations_size() < 2) {
+    throw valhalla_exception_t{120};
+  };
+  parse_costing(request);
+}
+
+void loki_worker_t::route(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request, "loki_worker_t::route");
+
+  init_route(request);
+  auto& options = *request.mutable_options();
+  const auto& costing_name = Costing_Enum_Name(options.costing());
+  check_locations(options.locations_size(), max_locations.find(costing_name)->second);
+  check_distance(options.locations(), max_distance.find(costing_name)->second);
+
+  check_walking_distances(options);
 
   // correlate the various locations to the underlying graph
   std::unordered_map<size_t, size_t> color_counts;
+  std::vector<std::unordered_set<uint32_t>> components(options.locations_size());
+  bool use_components = options.costing() != Costing::multimodal;
   try {
     auto locations = PathLocation::fromPBF(options.locations(), true);
-    const auto projections = loki::Search(locations, *reader, costing);
+    const auto projections = search(request, locations);
     for (size_t i = 0; i < locations.size(); ++i) {
       const auto& correlated = projections.at(locations[i]);
       PathLocation::toPBF(correlated, options.mutable_locations(i), *reader);
@@ -107,6 +130,9 @@ void loki_worker_t::route(Api& request) {
           ++itr->second;
         }
       }
+      use_components = use_components &&
+                       connectivity_map->get_components(correlated, costing->access_mode(),
+                                                        components[i]);
     }
   } catch (const std::exception&) { throw valhalla_exception_t{171}; }
 
@@ -124,6 +150,92 @@ void loki_worker_t::route(Api& request) {
   if (!connected) {
     throw valhalla_exception_t{170};
   };
+
+  // and every leg has its ends in one component of the edges the costing can use
+  if (use_components && !share_components(components)) {
+    throw valhalla_exception_t{170};
+  }
 }
+void loki_worker_t::route_batch(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request, "loki_worker_t::route_batch");
+
+  // every route of the batch shares the costing and the other options
+  auto& options = *request.mutable_options();
+  if (options.batch_size() == 0) {
+    throw valhalla_exception_t{115};
+  }
+  if (static_cast<size_t>(options.batch_size()) > max_batch_routes) {
+    throw valhalla_exception_t{167, std::to_string(max_batch_routes)};
+  }
+  parse_costing(request);
+  const auto& costing_name = Costing_Enum_Name(options.costing());
+  check_walking_distances(options);
+
+  // check each of the routes and collect the distinct locations of all of them
+  std::vector<std::vector<baldr::Location>> batch_locations;
+  batch_locations.reserve(options.batch_size());
+  std::unordered_set<baldr::Location> distinct;
+  for (auto& route : *options.mutable_batch()) {
+    parse_locations(route.mutable_locations());
+    if (route.locations_size() < 2) {
+      throw valhalla_exception_t{120};
+    }
+    check_locations(route.locations_size(), max_locations.find(costing_name)->second);
+    check_distance(route.locations(), max_distance.find(costing_name)->second);
+    batch_locations.emplace_back(PathLocation::fromPBF(route.locations(), true));
+    distinct.insert(batch_locations.back().begin(), batch_locations.back().end());
+  }
+
+  // correlate them all at once, a location shared by many routes is only searched for once
+  std::unordered_map<baldr::Location, PathLocation> projections;
+  try {
+    projections = search(request, std::vector<baldr::Location>(distinct.begin(), distinct.end()),
+                         search_pool.get());
+  } catch (const std::exception&) { throw valhalla_exception_t{171}; }
+
+  // a route which can't be found doesn't fail the others, it just remembers why
+  for (int r = 0; r < options.batch_size(); ++r) {
+    auto& route = *options.mutable_batch(r);
+    const auto& locations = batch_locations[r];
+    std::unordered_map<size_t, size_t> color_counts;
+    std::vector<std::unordered_set<uint32_t>> components(locations.size());
+    bool use_components = options.costing() != Costing::multimodal;
+    for (size_t i = 0; i < locations.size() && !route.has_error_code(); ++i) {
+      auto found = projections.find(locations[i]);
+      if (found == projections.cend() || found->second.edges.empty()) {
+        route.set_error_code(171);
+        break;
+      }
+      PathLocation::toPBF(found->second, route.mutable_locations(i), *reader);
+      if (!connectivity_map) {
+        continue;
+      }
+      auto colors =
+          connectivity_map->get_colors(TileHierarchy::levels().back().level, found->second, 0);
+      for (auto color : colors) {
+        ++color_counts[color];
+      }
+      use_components = use_components &&
+                       connectivity_map->get_components(found->second, costing->access_mode(),
+                                                        components[i]);
+    }
+    if (route.has_error_code() || !connectivity_map) {
+      continue;
+    }
+    // are all the locations of this route in the same color regions
+    if (std::none_of(color_counts.cbegin(), color_counts.cend(),
+                     [&locations](const std::pair<const size_t, size_t>& c) {
+                       return c.second == locations.size();
+                     })) {
+      route.set_error_code(170);
+    }
+    // and every leg has its ends in one component of the edges the costing can use
+    if (use_components && !share_components(components)) {
+      route.set_error_code(170);
+    }
+  }
+}
+
 } // namespace loki
 } // namespace valhalla
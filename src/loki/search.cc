@@ -19,6 +19,15 @@ using namespace valhalla::loki;
 
 namespace {
 
+// The squared distance from a point to the closest point of a box, at most the distance to any
+// point within the box as the approximation only grows with the differences of the coordinates
+double sq_distance_to(const DistanceApproximator<PointLL>& approx,
+                      const PointLL& point,
+                      const AABB2<PointLL>& box) {
+  return approx.DistanceSquared(PointLL(std::min(std::max(point.lng(), box.minx()), box.maxx()),
+                                        std::min(std::max(point.lat(), box.miny()), box.maxy())));
+}
+
 template <typename T> inline T square(T v) {
   return v * v;
 }
@@ -197,9 +206,28 @@ struct projector_wrapper {
     return cur_tile != nullptr;
   }
 
+  // Whether an edge at least this far away would leave what was found so far as it is, so that
+  // its shape need not be looked at. Unreachable candidates further than the closest reachable
+  // one outside the radius are dropped in the end, those may be skipped too while the last one
+  // kept would be dropped as well
+  bool too_far(const double sq_distance) const {
+    if (sq_distance < sq_radius) {
+      return false;
+    }
+    const bool reachable_too_far = !reachable.empty() &&
+                                   sq_distance >= reachable.back().sq_distance &&
+                                   sq_distance >= closest_external_reachable;
+    const bool unreachable_too_far =
+        (!unreachable.empty() && sq_distance >= unreachable.back().sq_distance) ||
+        (sq_distance > closest_external_reachable &&
+         (unreachable.empty() || (unreachable.back().sq_distance >= sq_radius &&
+                                  unreachable.back().sq_distance > closest_external_reachable)));
+    return reachable_too_far && unreachable_too_far;
+  }
+
   // Advance to the next bin. Must not be called if has_bin() is false.
   void next_bin(GraphReader& reader) {
-    do {
+    while (true) {
       // give up if the next bin is outside the overall cut off OR
       // we have something AND cant find more in the search radius AND
       // cant find anything better in general than what we have
@@ -210,17 +238,39 @@ struct projector_wrapper {
           (reachable.size() && distance > location.radius_ &&
            distance > std::sqrt(reachable.back().sq_distance))) {
         cur_tile = nullptr;
-        break;
+        return;
+      }
+
+      // large radii go over many bins of tiles that arent there or are empty, they are only
+      // asked for once
+      if (std::find(empty_tiles.begin(), empty_tiles.end(), tile_index) != empty_tiles.end()) {
+        continue;
       }
 
-      // grab the tile the lat, lon is in
-      auto tile_id = GraphId(tile_index, TileHierarchy::levels().back().level, 0);
-      reader.GetGraphTile(tile_id, cur_tile);
-    } while (!cur_tile);
+      // grab the tile the lat, lon is in, the next bin is often in the same one
+      if (!cur_tile || cur_tile->id().tileid() != static_cast<uint32_t>(tile_index)) {
+        auto tile_id = GraphId(tile_index, TileHierarchy::levels().back().level, 0);
+        reader.GetGraphTile(tile_id, cur_tile);
+        cur_bins = cur_tile ? cur_tile->header()->occupied_bins() : 0;
+        if (!cur_bins) {
+          empty_tiles.push_back(tile_index);
+          continue;
+        }
+      }
+
+      // only bins with edges in them are worth a look
+      if ((cur_bins >> bin_index) & 1) {
+        return;
+      }
+    }
   }
 
   std::function<std::tuple<int32_t, unsigned short, double>()> binner;
   graph_tile_ptr cur_tile;
+  // the bins of the current tile that have edges
+  uint32_t cur_bins = 0;
+  // the tiles near the location that are missing or have no edges at all
+  std::vector<int32_t> empty_tiles;
   Location location;
   unsigned short bin_index = 0;
   double sq_radius;
@@ -236,19 +286,24 @@ struct bin_handler_t {
   std::vector<projector_wrapper> pps;
   valhalla::baldr::GraphReader& reader;
   std::shared_ptr<DynamicCost> costing;
+  const EdgeReach* edge_reach;
   unsigned int max_reach_limit;
   std::vector<candidate_t> bin_candidates;
   std::unordered_set<uint64_t> correlated_edges;
   Reach reach_finder;
 
+  // the shape of the edge being looked at and how far each of its segments is from a location
+  std::vector<double> shape_lngs, shape_lats, sq_distances;
+
   // keep track of edges whose reachability we've already computed
   // TODO: dont use pointers as keys, its safe for now but fancy caching one day could be bad
   std::unordered_map<const DirectedEdge*, directed_reach> directed_reaches;
 
   bin_handler_t(const std::vector<valhalla::baldr::Location>& locations,
                 valhalla::baldr::GraphReader& reader,
-                const std::shared_ptr<DynamicCost>& costing)
-      : reader(reader), costing(costing) {
+                const std::shared_ptr<DynamicCost>& costing,
+                const EdgeReach* edge_reach)
+      : reader(reader), costing(costing), edge_reach(edge_reach) {
     // get the unique set of input locations and the max reachability of them all
     std::unordered_set<Location> uniq_locations(locations.begin(), locations.end());
     pps.reserve(uniq_locations.size());
@@ -428,12 +483,23 @@ struct bin_handler_t {
     if (itr != directed_reaches.cend())
       return itr->second;
 
-    // notice we do both directions here because in the end we use this reach for all input locations
-    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    auto reach = find_reach(edge_id, edge);
     directed_reaches[edge] = reach;
     return reach;
   }
 
+  // notice we do both directions here because in the end we use this reach for all input locations
+  directed_reach find_reach(const GraphId edge_id, const DirectedEdge* edge) {
+    // the stored reach is a lower bound so it can only tell us the edge is reachable enough
+    if (edge_reach && max_reach_limit <= edge_reach->cap()) {
+      const auto* stored = edge_reach->reach(edge_id);
+      if (stored && stored[0] >= max_reach_limit && stored[1] >= max_reach_limit) {
+        return {max_reach_limit, max_reach_limit};
+      }
+    }
+    return reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+  }
+
   // do a mini network expansion or maybe not
   directed_reach check_reachability(std::vector<projector_wrapper>::iterator begin,
                                     std::vector<projector_wrapper>::iterator end,
@@ -462,8 +528,7 @@ struct bin_handler_t {
     if (!check)
       return {max_reach_limit, max_reach_limit};
 
-    // notice we do both directions here because in the end we use this reach for all input locations
-    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    auto reach = find_reach(edge_id, edge);
     directed_reaches[edge] = reach;
 
     // if the inbound reach is not 0 and the outbound reach is not 0 and the opposing edge is not
@@ -502,13 +567,16 @@ struct bin_handler_t {
       // initialize candidates vector:
       // - reset sq_distance to max so we know the best point along the edge
       // - apply prefilters based on user's SearchFilter request options
+      // - skip the edges whose bounds are too far away to change what was found
+      const auto bounds = tile->GetEdgeBounds(edge_id.id());
       auto c_itr = bin_candidates.begin();
       decltype(begin) p_itr;
       bool all_prefiltered = true;
       for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
         c_itr->sq_distance = std::numeric_limits<double>::max();
         c_itr->prefiltered =
-            is_search_filter_triggered(edge, *costing, tile, p_itr->location.search_filter_);
+            is_search_filter_triggered(edge, *costing, tile, p_itr->location.search_filter_) ||
+            p_itr->too_far(sq_distance_to(p_itr->project.approx, p_itr->location.latlng_, bounds));
         // set to false if even one candidate was not filtered
         all_prefiltered = all_prefiltered && c_itr->prefiltered;
       }
@@ -526,35 +594,35 @@ struct bin_handler_t {
       // of the shape which are on the same side of h that p is. to make this fast we would need a
       // a trivial half plane test as maybe a single dot product and comparison?
 
-      // get some shape of the edge
+      // get the shape of the edge as separate longitudes and latitudes
       auto edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge->edgeinfo_offset()));
       auto shape = edge_info->lazy_shape();
-      PointLL v;
-      if (!shape.empty()) {
-        v = shape.pop();
+      shape_lngs.clear();
+      shape_lats.clear();
+      while (!shape.empty()) {
+        auto point = shape.pop();
+        shape_lngs.push_back(point.lng());
+        shape_lats.push_back(point.lat());
       }
+      const size_t segments = shape_lngs.empty() ? 0 : shape_lngs.size() - 1;
+      sq_distances.resize(segments);
 
-      // iterate along this edges segments projecting each of the points
-      for (size_t i = 0; !shape.empty(); ++i) {
-        auto u = v;
-        v = shape.pop();
-        // for each input point
-        c_itr = bin_candidates.begin();
-        for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-          // skip updating this candidate because it was prefiltered
-          if (c_itr->prefiltered) {
-            continue;
-          }
-          // how close is the input to this segment
-          auto point = p_itr->project(u, v);
-          auto sq_distance = p_itr->project.approx.DistanceSquared(point);
-          // do we want to keep it
-          if (sq_distance < c_itr->sq_distance) {
-            c_itr->sq_distance = sq_distance;
-            c_itr->point = std::move(point);
-            c_itr->index = i;
-          }
+      // project each of the points onto all of the edges segments at once and keep the closest
+      c_itr = bin_candidates.begin();
+      for (p_itr = begin; segments && p_itr != end; ++p_itr, ++c_itr) {
+        // skip updating this candidate because it was prefiltered
+        if (c_itr->prefiltered) {
+          continue;
         }
+        p_itr->project.SquaredDistances(shape_lngs.data(), shape_lats.data(), segments,
+                                        sq_distances.data());
+        auto closest = std::min_element(sq_distances.begin(), sq_distances.end()) -
+                       sq_distances.begin();
+        PointLL u(shape_lngs[closest], shape_lats[closest]);
+        PointLL v(shape_lngs[closest + 1], shape_lats[closest + 1]);
+        c_itr->point = p_itr->project(u, v);
+        c_itr->sq_distance = p_itr->project.approx.DistanceSquared(c_itr->point);
+        c_itr->index = closest;
       }
 
       // if we already have a better reachable candidate we can just assume this one is reachable
@@ -776,6 +844,67 @@ struct bin_handler_t {
   }
 };
 
+// Below this many locations per group a parallel search isnt worth it
+constexpr size_t kMinParallelLocations = 32;
+
+// Groups per thread of the pool so that a slow group doesnt hold up the others for long
+constexpr size_t kGroupsPerThread = 4;
+
+// Searches groups of nearby locations on the threads of the pool and merges the results. Every
+// group uses the reader of the thread it runs on and its own reach cache, but the reach limit of
+// all the locations so that the reach of the edges is capped the same as in a single search.
+std::unordered_map<Location, PathLocation>
+ParallelSearch(const std::unordered_set<Location>& uniq_locations,
+               const size_t groups,
+               const std::shared_ptr<DynamicCost>& costing,
+               const EdgeReach* edge_reach,
+               valhalla::thor::ExpansionPool& pool,
+               GraphReader& reader) {
+  // nearby locations mostly look at the same bins and tiles so they go in the same group
+  std::vector<std::pair<uint64_t, const Location*>> sorted;
+  sorted.reserve(uniq_locations.size());
+  unsigned int max_reach_limit = 0;
+  const auto level = TileHierarchy::levels().back().level;
+  for (const auto& location : uniq_locations) {
+    sorted.emplace_back(TileHierarchy::GetGraphId(location.latlng_, level).value, &location);
+    max_reach_limit = std::max(max_reach_limit, location.min_outbound_reach_);
+    max_reach_limit = std::max(max_reach_limit, location.min_inbound_reach_);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<uint64_t, const Location*>& a,
+               const std::pair<uint64_t, const Location*>& b) {
+              return a.first < b.first ||
+                     (a.first == b.first && (a.second->latlng_.lng() < b.second->latlng_.lng() ||
+                                             (a.second->latlng_.lng() == b.second->latlng_.lng() &&
+                                              a.second->latlng_.lat() < b.second->latlng_.lat())));
+            });
+
+  std::vector<std::unordered_map<Location, PathLocation>> results(groups);
+  pool.Run(
+      groups,
+      [&](size_t index, size_t, GraphReader& thread_reader) {
+        std::vector<Location> group;
+        for (size_t i = index * sorted.size() / groups; i < (index + 1) * sorted.size() / groups;
+             ++i) {
+          group.push_back(*sorted[i].second);
+        }
+        bin_handler_t handler(group, thread_reader, costing, edge_reach);
+        handler.max_reach_limit = max_reach_limit;
+        handler.search();
+        results[index] = handler.finalize();
+      },
+      reader);
+
+  std::unordered_map<Location, PathLocation> searched;
+  searched.reserve(uniq_locations.size());
+  for (auto& result : results) {
+    for (auto& location : result) {
+      searched.emplace(location.first, std::move(location.second));
+    }
+  }
+  return searched;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -784,7 +913,9 @@ namespace loki {
 std::unordered_map<valhalla::baldr::Location, PathLocation>
 Search(const std::vector<valhalla::baldr::Location>& locations,
        GraphReader& reader,
-       const std::shared_ptr<DynamicCost>& costing) {
+       const std::shared_ptr<DynamicCost>& costing,
+       const EdgeReach* edge_reach,
+       thor::ExpansionPool* pool) {
   // we cannot continue without costing
   if (!costing)
     throw std::runtime_error("No costing was provided for edge candidate search");
@@ -793,8 +924,19 @@ Search(const std::vector<valhalla::baldr::Location>& locations,
   if (locations.empty())
     return std::unordered_map<valhalla::baldr::Location, PathLocation>{};
 
+  // with enough locations we search groups of nearby ones in parallel
+  if (pool && pool->size() > 1 && locations.size() >= 2 * kMinParallelLocations) {
+    std::unordered_set<valhalla::baldr::Location> uniq_locations(locations.begin(),
+                                                                 locations.end());
+    const size_t groups =
+        std::min(pool->size() * kGroupsPerThread, uniq_locations.size() / kMinParallelLocations);
+    if (groups > 1) {
+      return ParallelSearch(uniq_locations, groups, costing, edge_reach, *pool, reader);
+    }
+  }
+
   // setup the unique list of locations
-  bin_handler_t handler(locations, reader, costing);
+  bin_handler_t handler(locations, reader, costing, edge_reach);
   // search over the bins doing multiple locations per bin
   handler.search();
   // turn each locations candidate set into path locations
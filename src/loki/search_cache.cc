@@ -0,0 +1,83 @@
+#include "loki/search_cache.h"
+
+#include <cmath>
+
+namespace {
+
+// Coordinates are kept to 6 digits in the tiles, locations closer than that find the same edges
+constexpr double kCoordinatePrecision = 1e6;
+
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace loki {
+
+SearchCache::SearchCache(const size_t max_size) : max_size_(max_size), hits_(0), misses_(0) {
+  index_.reserve(max_size_);
+}
+
+std::string SearchCache::Key(const baldr::Location& location, const std::string& costing_key) {
+  // everything about the location that the search looks at
+  std::string key = costing_key;
+  append(key, std::llround(location.latlng_.lng() * kCoordinatePrecision));
+  append(key, std::llround(location.latlng_.lat() * kCoordinatePrecision));
+  append(key, location.heading_ ? *location.heading_ : -1.f);
+  append(key, location.heading_tolerance_);
+  append(key, location.node_snap_tolerance_);
+  append(key, location.search_cutoff_);
+  append(key, location.street_side_tolerance_);
+  append(key, location.street_side_max_distance_);
+  append(key, location.min_outbound_reach_);
+  append(key, location.min_inbound_reach_);
+  append(key, location.radius_);
+  append(key, location.preferred_side_);
+  append(key, location.search_filter_.min_road_class_);
+  append(key, location.search_filter_.max_road_class_);
+  append(key, location.search_filter_.exclude_tunnel_);
+  append(key, location.search_filter_.exclude_bridge_);
+  append(key, location.search_filter_.exclude_ramp_);
+  append(key, location.search_filter_.exclude_closures_);
+  if (location.display_latlng_) {
+    append(key, location.display_latlng_->lng());
+    append(key, location.display_latlng_->lat());
+  }
+  return key;
+}
+
+bool SearchCache::Find(const std::string& key, baldr::PathLocation& result) {
+  auto found = index_.find(key);
+  if (found == index_.end()) {
+    ++misses_;
+    return false;
+  }
+  // move it to the front as it was just used
+  entries_.splice(entries_.begin(), entries_, found->second);
+  result.edges = found->second->second.edges;
+  result.filtered_edges = found->second->second.filtered_edges;
+  ++hits_;
+  return true;
+}
+
+void SearchCache::Insert(const std::string& key, const baldr::PathLocation& result) {
+  if (max_size_ == 0 || index_.find(key) != index_.end()) {
+    return;
+  }
+  if (index_.size() == max_size_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(key, result);
+  index_.emplace(key, entries_.begin());
+}
+
+void SearchCache::Clear() {
+  entries_.clear();
+  index_.clear();
+}
+
+} // namespace loki
+} // namespace valhalla
@@ -170,6 +170,25 @@ void loki_worker_t::trace(Api& request) {
   };
 }
 
+void loki_worker_t::recost(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request, "loki_worker_t::recost");
+
+  // the path is already known so there is nothing to search for, only its size is limited
+  parse_costing(request);
+  const auto& options = request.options();
+  if (options.costing() == Costing::multimodal) {
+    throw valhalla_exception_t{140, Options_Action_Enum_Name(options.action())};
+  }
+  if (!options.recost_edges_size()) {
+    throw valhalla_exception_t{116};
+  }
+  if (static_cast<size_t>(options.recost_edges_size()) > max_trace_shape) {
+    throw valhalla_exception_t{153, "(" + std::to_string(options.recost_edges_size()) +
+                                        "). The limit is " + std::to_string(max_trace_shape)};
+  }
+}
+
 void loki_worker_t::locations_from_shape(Api& request) {
   auto& options = *request.mutable_options();
   std::vector<baldr::Location> locations{PathLocation::fromPBF(*options.shape().begin()),
@@ -193,7 +212,7 @@ void loki_worker_t::locations_from_shape(Api& request) {
 
     // Project first and last shape point onto nearest edge(s). Clear current locations list
     // and set the path locations
-    auto projections = loki::Search(locations, *reader, costing);
+    auto projections = search(request, locations);
     options.clear_locations();
     PathLocation::toPBF(projections.at(locations.front()), options.mutable_locations()->Add(),
                         *reader);
@@ -1,8 +1,6 @@
 #include <unordered_set>
 
-#include "baldr/connectivity_map.h"
 #include "loki/worker.h"
-#include "midgard/distanceapproximator.h"
 #include "tyr/serializers.h"
 
 using namespace valhalla;
@@ -26,22 +24,10 @@ std::string loki_worker_t::transit_available(Api& request) {
   auto locations = PathLocation::fromPBF(request.options().locations());
   std::unordered_set<baldr::Location> found;
   try {
-    const auto& tiles = TileHierarchy::levels().back().tiles;
+    // Look for a stop within the radius of each location
     for (const auto& location : locations) {
-      // Get a list of tiles required within the radius of the projected point
-      const auto& ll = location.latlng_;
-      DistanceApproximator<PointLL> approximator(ll);
-      double latdeg = double(location.radius_) / kMetersPerDegreeLat;
-      double lngdeg = location.radius_ / DistanceApproximator<PointLL>::MetersPerLngDegree(ll.lat());
-      AABB2<PointLL> bbox(Point2d(ll.lng() - lngdeg, ll.lat() - latdeg),
-                          Point2d(ll.lng() + lngdeg, ll.lat() + latdeg));
-      std::vector<int32_t> tilelist = tiles.TileList(bbox);
-      for (auto id : tilelist) {
-        // transit is level hierarchy level 3
-        auto color = connectivity_map->get_color(GraphId(id, 3, 0));
-        if (color != 0) {
-          found.emplace(location);
-        }
+      if (transit_stops && transit_stops->Within(location.latlng_, location.radius_)) {
+        found.emplace(location);
       }
     }
   } catch (const std::exception&) { throw valhalla_exception_t{170}; }
@@ -1,3 +1,5 @@
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <cstdint>
 #include <functional>
@@ -9,7 +11,9 @@
 
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
+#include "metrics.h"
 #include "midgard/logging.h"
+#include "proto_conversions.h"
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/motorcyclecost.h"
@@ -92,7 +96,7 @@ void loki_worker_t::parse_costing(Api& api, bool allow_none) {
   if (options.avoid_locations_size()) {
     try {
       auto avoid_locations = PathLocation::fromPBF(options.avoid_locations());
-      auto results = loki::Search(avoid_locations, *reader, costing);
+      auto results = loki::Search(avoid_locations, *reader, costing, get_edge_reach(options));
       std::unordered_set<uint64_t> avoids;
       auto* co = options.mutable_costing_options(static_cast<uint8_t>(costing->travel_mode()));
       for (const auto& result : results) {
@@ -135,19 +139,93 @@ void loki_worker_t::parse_costing(Api& api, bool allow_none) {
     options.set_alternates(max_alternates);
 }
 
+const baldr::EdgeReach* loki_worker_t::get_edge_reach(const Options& options) const {
+  // The reach was computed with the default options of the costing, anything else like avoids
+  // could reach less
+  auto found = edge_reach_options.find(options.costing());
+  if (found == edge_reach_options.end() || options.costing() >= options.costing_options_size() ||
+      options.costing_options(options.costing()).SerializeAsString() != found->second) {
+    return nullptr;
+  }
+  return edge_reaches.find(options.costing())->second.get();
+}
+
+std::unordered_map<baldr::Location, baldr::PathLocation>
+loki_worker_t::search(Api& request,
+                      const std::vector<baldr::Location>& locations,
+                      thor::ExpansionPool* pool) {
+  const auto& options = request.options();
+  if (!search_cache) {
+    return loki::Search(locations, *reader, costing, get_edge_reach(options), pool);
+  }
+
+  // anything found before the traffic changed may no longer be right
+  const auto traffic_generation = reader->TrafficGeneration();
+  if (traffic_generation != search_cache_generation) {
+    search_cache->Clear();
+    search_cache_generation = traffic_generation;
+  }
+
+  // the options of the costing decide which edges are allowed, avoids included, for multimodal
+  // the locations are searched with pedestrian costing
+  const int costing_index =
+      options.costing() == Costing::multimodal ? Costing::pedestrian : options.costing();
+  std::string costing_key = std::to_string(costing_index) + ":";
+  if (costing_index < options.costing_options_size()) {
+    costing_key += options.costing_options(costing_index).SerializeAsString();
+  }
+
+  // take what we can from the cache and search for the rest
+  std::unordered_map<baldr::Location, baldr::PathLocation> results;
+  std::unordered_map<baldr::Location, std::string> missed;
+  for (const auto& location : locations) {
+    if (results.find(location) != results.end() || missed.find(location) != missed.end()) {
+      continue;
+    }
+    auto key = SearchCache::Key(location, costing_key);
+    PathLocation result(location);
+    if (search_cache->Find(key, result)) {
+      results.emplace(location, std::move(result));
+    } else {
+      missed.emplace(location, std::move(key));
+    }
+  }
+  const size_t hits = results.size();
+  if (!missed.empty()) {
+    std::vector<baldr::Location> misses;
+    misses.reserve(missed.size());
+    for (const auto& miss : missed) {
+      misses.push_back(miss.first);
+    }
+    for (auto& searched : loki::Search(misses, *reader, costing, get_edge_reach(options), pool)) {
+      search_cache->Insert(missed.find(searched.first)->second, searched.second);
+      results.emplace(searched.first, std::move(searched.second));
+    }
+  }
+
+  auto* hit_stat = request.mutable_info()->mutable_statistics()->Add();
+  hit_stat->set_name("loki_worker_t::search_cache_hits");
+  hit_stat->set_value(hits);
+  hit_stat->set_type(Statistic::count);
+  auto* miss_stat = request.mutable_info()->mutable_statistics()->Add();
+  miss_stat->set_name("loki_worker_t::search_cache_misses");
+  miss_stat->set_value(missed.size());
+  miss_stat->set_type(Statistic::count);
+  return results;
+}
+
 loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
-    : config(config), reader(graph_reader),
-      connectivity_map(config.get<bool>("loki.use_connectivity", true)
-                           ? new connectivity_map_t(config.get_child("mjolnir"))
-                           : nullptr),
+    : config(config), reader(graph_reader), search_cache_generation(0),
       max_contours(config.get<size_t>("service_limits.isochrone.max_contours")),
       max_contour_min(config.get<size_t>("service_limits.isochrone.max_time_contour")),
       max_contour_km(config.get<size_t>("service_limits.isochrone.max_distance_contour")),
       max_trace_shape(config.get<size_t>("service_limits.trace.max_shape")),
-      sample(config.get<std::string>("additional_data.elevation", "")),
+      sample(config.get<std::string>("additional_data.elevation", ""),
+             config.get<size_t>("additional_data.elevation_cache_size",
+                                skadi::sample::kDefaultCacheSize)),
       max_elevation_shape(config.get<size_t>("service_limits.skadi.max_shape")),
-      min_resample(config.get<float>("service_limits.skadi.min_resample")) {
+      min_resample(config.get<float>("service_limits.skadi.min_resample")), admission(config) {
   // If we weren't provided with a graph reader make our own
   if (!reader)
     reader.reset(new baldr::GraphReader(config.get_child("mjolnir")));
@@ -171,7 +249,7 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
   for (const auto& kv : config.get_child("service_limits")) {
     if (kv.first == "max_avoid_locations" || kv.first == "max_reachability" ||
         kv.first == "max_radius" || kv.first == "max_timedep_distance" ||
-        kv.first == "max_alternates") {
+        kv.first == "max_alternates" || kv.first == "max_batch_routes") {
       continue;
     }
     if (kv.first != "skadi" && kv.first != "trace") {
@@ -212,6 +290,7 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
       config.get<size_t>("service_limits.pedestrian.max_transit_walking_distance");
 
   max_avoid_locations = config.get<size_t>("service_limits.max_avoid_locations");
+  max_batch_routes = config.get<size_t>("service_limits.max_batch_routes", 1000);
   max_reachability = config.get<unsigned int>("service_limits.max_reachability");
   default_reachability = config.get<unsigned int>("loki.service_defaults.minimum_reachability");
   max_radius = config.get<unsigned int>("service_limits.max_radius");
@@ -229,12 +308,82 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
   max_best_paths = config.get<unsigned int>("service_limits.trace.max_best_paths");
   max_best_paths_shape = config.get<size_t>("service_limits.trace.max_best_paths_shape");
   max_alternates = config.get<unsigned int>("service_limits.max_alternates");
+
+  // Build what comes from the tiles and the files next to them
+  load_tile_data();
+
+  // The calling thread helps out so the pool needs one thread less than configured
+  auto search_threads = config.get<uint32_t>("loki.search_threads", 1);
+  if (search_threads > 1) {
+    search_pool.reset(new thor::ExpansionPool(config.get_child("mjolnir"), search_threads - 1));
+  }
+
+  // Keep what was found for the most recently searched locations
+  auto search_cache_size = config.get<size_t>("loki.search_cache_size", 0);
+  if (search_cache_size) {
+    search_cache.reset(new SearchCache(search_cache_size));
+    search_cache_generation = reader->TrafficGeneration();
+  }
+}
+
+void loki_worker_t::load_tile_data() {
+  tileset_generation = reader->TilesetGeneration();
+  connectivity_map.reset(config.get<bool>("loki.use_connectivity", true)
+                             ? new connectivity_map_t(config.get_child("mjolnir"))
+                             : nullptr);
+  transit_stops.reset(actions.count(Options::transit_available)
+                          ? new baldr::TransitStopIndex(config.get_child("mjolnir"))
+                          : nullptr);
+
+  // Map the reach stored for the costings, unless live traffic could close edges it went over
+  std::vector<std::string> reach_costings;
+  boost::algorithm::split(reach_costings, config.get<std::string>("mjolnir.edge_reach", ""),
+                          boost::algorithm::is_any_of(","));
+  if (!config.get<std::string>("mjolnir.traffic_extract", "").empty()) {
+    reach_costings.clear();
+  }
+  edge_reaches.clear();
+  edge_reach_options.clear();
+  Options defaults;
+  rapidjson::Document doc;
+  doc.SetObject();
+  ParseCostingOptions(doc, "/costing_options", defaults);
+  for (const auto& name : reach_costings) {
+    Costing costing;
+    if (name.empty() || !Costing_Enum_Parse(name, &costing)) {
+      continue;
+    }
+    try {
+      edge_reaches[costing].reset(new baldr::EdgeReach(
+          baldr::EdgeReach::FileName(config.get<std::string>("mjolnir.tile_dir", ""), name)));
+      edge_reach_options[costing] = defaults.costing_options(costing).SerializeAsString();
+    } catch (const std::exception& e) {
+      edge_reaches.erase(costing);
+      LOG_WARN("Not using the " + name + " edge reach: " + e.what());
+    }
+  }
 }
 
 void loki_worker_t::cleanup() {
+  report_tile_cache("loki", *reader);
+  // between requests is when we switch to a newly loaded tileset
+  reader->Refresh();
+  if (reader->TilesetGeneration() != tileset_generation) {
+    load_tile_data();
+  }
   if (reader->OverCommitted()) {
     reader->Trim();
   }
+  if (search_pool) {
+    search_pool->Trim();
+  }
+}
+
+void loki_worker_t::check_action(const Api& request) const {
+  if (!request.options().has_action() ||
+      actions.find(request.options().action()) == actions.cend()) {
+    throw valhalla_exception_t{106, action_str};
+  }
 }
 
 void loki_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
@@ -251,22 +400,28 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
   // grab the request info
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Loki Request " + std::to_string(info.id));
-  Api request;
+  Api& request = request_arena.next();
   try {
     // request parsing
     auto http_request =
         prime_server::http_request_t::from_string(static_cast<const char*>(job.front().data()),
                                                   job.front().size());
+    // the metrics of this process are not a request to parse
+    if (http_request.path == "/metrics") {
+      return to_response(metrics_t::get().serialize(), info, request, worker::METRICS_MIME);
+    }
     ParseApi(http_request, request);
     const auto& options = request.options();
 
     // check there is a valid action
-    if (!options.has_action() || actions.find(options.action()) == actions.cend()) {
-      return jsonify_error({106, action_str}, info, request);
-    }
+    check_action(request);
+
+    // turn it away now if it can't be answered in time
+    auto ticket = admission.Admit(request);
 
     // Set the interrupt function
-    service_worker_t::set_interrupt(&interrupt_function);
+    deadline_interrupt = with_deadline(&interrupt_function, request);
+    service_worker_t::set_interrupt(&deadline_interrupt);
 
     prime_server::worker_t::result_t result{true};
     // do request specific processing
@@ -293,6 +448,10 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         trace(request);
         result.messages.emplace_back(request.SerializeAsString());
         break;
+      case Options::recost:
+        recost(request);
+        result.messages.emplace_back(request.SerializeAsString());
+        break;
       case Options::height:
         result = to_response(height(request), info, request);
         break;
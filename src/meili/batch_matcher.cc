@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "baldr/rapidjson_utils.h"
+#include "meili/batch_matcher.h"
+#include "meili/match_result.h"
+#include "meili/measurement.h"
+
+namespace {
+
+// Reads the measurements of a trace
+std::vector<valhalla::meili::Measurement> parse_trace(const rapidjson::Document& trace,
+                                                      const valhalla::meili::Config& config) {
+  auto shape = rapidjson::get_child_optional(trace, "/shape");
+  if (!shape || !shape->IsArray()) {
+    throw std::runtime_error("A trace needs a shape");
+  }
+  std::vector<valhalla::meili::Measurement> measurements;
+  measurements.reserve(shape->Size());
+  for (const auto& point : shape->GetArray()) {
+    auto lng = rapidjson::get_optional<double>(point, "/lon");
+    auto lat = rapidjson::get_optional<double>(point, "/lat");
+    if (!lng || !lat) {
+      throw std::runtime_error("Every point of a trace needs a lon and a lat");
+    }
+    measurements.emplace_back(valhalla::midgard::PointLL(*lng, *lat),
+                              rapidjson::get<float>(point, "/accuracy",
+                                                    config.emission_cost.gps_accuracy_meters),
+                              rapidjson::get<float>(point, "/radius",
+                                                    config.candidate_search.search_radius_meters),
+                              rapidjson::get<double>(point, "/time", -1.0));
+  }
+  return measurements;
+}
+
+// Writes the id of the trace, if it has one, to the result
+void write_id(const rapidjson::Document& trace,
+              rapidjson::Writer<rapidjson::StringBuffer>& writer) {
+  if (trace.IsObject()) {
+    auto id = trace.FindMember("id");
+    if (id != trace.MemberEnd()) {
+      writer.Key("id");
+      id->value.Accept(writer);
+    }
+  }
+}
+
+// Makes the matcher of the costing of a trace
+std::unique_ptr<valhalla::meili::MapMatcher>
+make_matcher(valhalla::meili::MapMatcherFactory& factory,
+             const rapidjson::Document& trace,
+             const std::string& default_costing) {
+  auto costing_name = rapidjson::get<std::string>(trace, "/costing", default_costing);
+  valhalla::Costing costing;
+  if (!valhalla::Costing_Enum_Parse(costing_name, &costing)) {
+    throw std::runtime_error("No costing method found for " + costing_name);
+  }
+  return std::unique_ptr<valhalla::meili::MapMatcher>(factory.Create(costing));
+}
+
+// Adds up how fast a run of connected segments was gone along, from where along it the points
+// with a time are
+void add_speeds(const std::vector<valhalla::meili::EdgeSegment>& segments,
+                const size_t first,
+                const std::vector<std::pair<double, double>>& spans,
+                const std::vector<std::pair<double, double>>& times,
+                valhalla::meili::BatchMatcher::edge_speeds_t& speeds) {
+  if (times.size() < 2) {
+    return;
+  }
+  // the time at a distance along the run, between the points before and after it
+  const auto time_at = [&times](const double along) {
+    auto after = std::upper_bound(times.begin(), times.end(), along,
+                                  [](const double along, const std::pair<double, double>& time) {
+                                    return along < time.first;
+                                  });
+    if (after == times.end()) {
+      return times.back().second;
+    }
+    const auto& before = *std::prev(after);
+    return before.second +
+           (after->second - before.second) * (along - before.first) / (after->first - before.first);
+  };
+  for (size_t i = 0; i < spans.size(); ++i) {
+    const auto& span = spans[i];
+    // only what is between the first and the last time was seen going along
+    if (span.second <= span.first || span.first < times.front().first ||
+        span.second > times.back().first) {
+      continue;
+    }
+    const double seconds = time_at(span.second) - time_at(span.first);
+    if (seconds <= 0) {
+      continue;
+    }
+    auto& speed = speeds[segments[first + i].edgeid];
+    ++speed.count;
+    speed.length += span.second - span.first;
+    speed.seconds += seconds;
+  }
+}
+
+// Adds up how fast a matched trace went along the edges of its path
+void add_speeds(valhalla::baldr::GraphReader& reader,
+                const valhalla::meili::MatchResults& match,
+                valhalla::meili::BatchMatcher::edge_speeds_t& speeds) {
+  // where the segments of the run start and end and where along it the points with a time are
+  std::vector<std::pair<double, double>> spans, times;
+  size_t first = 0;
+  double along = 0;
+  valhalla::baldr::graph_tile_ptr tile;
+  for (size_t i = 0; i < match.segments.size(); ++i) {
+    const auto& segment = match.segments[i];
+    const auto* edge = reader.directededge(segment.edgeid, tile);
+    const double length = edge ? edge->length() : 0;
+    const double begin = along;
+    along += length * (segment.target - segment.source);
+    spans.emplace_back(begin, along);
+    for (int j = std::max(segment.first_match_idx, 0);
+         segment.first_match_idx >= 0 && j <= segment.last_match_idx; ++j) {
+      const auto& result = match.results[j];
+      if (result.edgeid != segment.edgeid || result.epoch_time < 0) {
+        continue;
+      }
+      const double offset = length * (result.distance_along - segment.source);
+      const double at = std::min(std::max(begin + offset, begin), along);
+      // the times have to go on along the path, a point that went back is left out
+      if (times.empty() || (times.back().first < at && times.back().second < result.epoch_time)) {
+        times.emplace_back(at, result.epoch_time);
+      }
+    }
+    // a discontinuity ends the run, the next one starts over
+    if (segment.discontinuity || i + 1 == match.segments.size()) {
+      add_speeds(match.segments, first, spans, times, speeds);
+      first = i + 1;
+      along = 0;
+      spans.clear();
+      times.clear();
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+BatchMatcher::BatchMatcher(const boost::property_tree::ptree& config,
+                           const size_t threads,
+                           const size_t max_pending)
+    : config_(config),
+      threads_(std::max<size_t>(threads ? threads : std::thread::hardware_concurrency(), 1)),
+      max_pending_(max_pending ? max_pending : threads_ * 4) {
+  // the threads share the tiles and the grids unless the config already decided
+  if (!config_.get_optional<bool>("mjolnir.global_synchronized_cache")) {
+    config_.put("mjolnir.global_synchronized_cache", true);
+  }
+  if (!config_.get_optional<bool>("meili.grid.shared")) {
+    config_.put("meili.grid.shared", true);
+  }
+}
+
+std::string BatchMatcher::Match(MapMatcherFactory& factory,
+                                const std::string& trace,
+                                const std::string& default_costing) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.SetMaxDecimalPlaces(6);
+
+  rapidjson::Document doc;
+  doc.Parse(trace.c_str(), trace.size());
+  writer.StartObject();
+  if (doc.HasParseError() || !doc.IsObject()) {
+    writer.Key("error");
+    writer.String("Could not parse the trace");
+    writer.EndObject();
+    return buffer.GetString();
+  }
+  write_id(doc, writer);
+
+  try {
+    auto matcher = make_matcher(factory, doc, default_costing);
+    const auto measurements = parse_trace(doc, matcher->config());
+    const auto results = matcher->OfflineMatch(measurements).front().results;
+
+    writer.Key("points");
+    writer.StartArray();
+    for (const auto& result : results) {
+      if (!result.HasState()) {
+        writer.Null();
+        continue;
+      }
+      writer.StartObject();
+      writer.Key("lon");
+      writer.Double(result.lnglat.lng());
+      writer.Key("lat");
+      writer.Double(result.lnglat.lat());
+      writer.Key("edge_id");
+      writer.Uint64(result.edgeid.value);
+      writer.Key("distance_from");
+      writer.Double(result.distance_from);
+      writer.EndObject();
+    }
+    writer.EndArray();
+  } catch (const std::exception& e) {
+    // start over so that no half written points are left in the result
+    buffer.Clear();
+    writer.Reset(buffer);
+    writer.StartObject();
+    write_id(doc, writer);
+    writer.Key("error");
+    writer.String(e.what());
+  }
+  writer.EndObject();
+  factory.ClearFullCache();
+  return buffer.GetString();
+}
+
+size_t BatchMatcher::Match(std::istream& input, std::ostream& output) const {
+  std::mutex mutex;
+  std::condition_variable work_available, result_available;
+  // the traces to match and the results not yet written, by their line
+  std::deque<std::pair<size_t, std::string>> traces;
+  std::map<size_t, std::string> results;
+  bool done_reading = false;
+
+  // every thread matches with its own factory until there is nothing left to read
+  const auto default_costing = config_.get<std::string>("meili.mode", "auto");
+  auto match = [&]() {
+    MapMatcherFactory factory(config_);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      work_available.wait(lock, [&]() { return !traces.empty() || done_reading; });
+      if (traces.empty()) {
+        return;
+      }
+      auto trace = std::move(traces.front());
+      traces.pop_front();
+      lock.unlock();
+      auto result = Match(factory, trace.second, default_costing);
+      lock.lock();
+      results.emplace(trace.first, std::move(result));
+      result_available.notify_one();
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(threads_);
+  for (size_t i = 0; i < threads_; ++i) {
+    threads.emplace_back(match);
+  }
+
+  // writes the results that are next in line, this is the only thread writing the output
+  size_t read = 0, written = 0;
+  auto write = [&](std::unique_lock<std::mutex>& lock) {
+    while (!results.empty() && results.begin()->first == written) {
+      auto result = std::move(results.begin()->second);
+      results.erase(results.begin());
+      ++written;
+      lock.unlock();
+      output << result << '\n';
+      lock.lock();
+    }
+  };
+
+  // read no further ahead of the output than allowed
+  std::string line;
+  while (std::getline(input, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    write(lock);
+    while (read - written >= max_pending_) {
+      result_available.wait(lock);
+      write(lock);
+    }
+    traces.emplace_back(read++, std::move(line));
+    work_available.notify_one();
+  }
+
+  // wait for the rest
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    done_reading = true;
+    work_available.notify_all();
+    write(lock);
+    while (written < read) {
+      result_available.wait(lock);
+      write(lock);
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  output.flush();
+  return read;
+}
+
+bool BatchMatcher::MatchSpeeds(MapMatcherFactory& factory,
+                               const std::string& trace,
+                               edge_speeds_t& speeds,
+                               const std::string& default_costing) {
+  rapidjson::Document doc;
+  doc.Parse(trace.c_str(), trace.size());
+  if (doc.HasParseError() || !doc.IsObject()) {
+    return false;
+  }
+
+  bool matched = false;
+  try {
+    auto matcher = make_matcher(factory, doc, default_costing);
+    const auto measurements = parse_trace(doc, matcher->config());
+    add_speeds(*factory.graphreader(), matcher->OfflineMatch(measurements).front(), speeds);
+    matched = true;
+  } catch (const std::exception&) {
+    // its left out
+  }
+  factory.ClearFullCache();
+  return matched;
+}
+
+size_t BatchMatcher::MatchSpeeds(std::istream& input, edge_speeds_t& speeds) const {
+  std::mutex mutex;
+  std::condition_variable work_available, work_taken;
+  std::deque<std::string> traces;
+  bool done_reading = false;
+  size_t matched = 0;
+
+  // every thread adds up its own traces and puts them together with the rest once there is nothing
+  // left to read
+  const auto default_costing = config_.get<std::string>("meili.mode", "auto");
+  auto match = [&]() {
+    MapMatcherFactory factory(config_);
+    edge_speeds_t thread_speeds;
+    size_t thread_matched = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      work_available.wait(lock, [&]() { return !traces.empty() || done_reading; });
+      if (traces.empty()) {
+        break;
+      }
+      auto trace = std::move(traces.front());
+      traces.pop_front();
+      work_taken.notify_one();
+      lock.unlock();
+      thread_matched += MatchSpeeds(factory, trace, thread_speeds, default_costing);
+      lock.lock();
+    }
+    matched += thread_matched;
+    for (const auto& edge : thread_speeds) {
+      auto& speed = speeds[edge.first];
+      speed.count += edge.second.count;
+      speed.length += edge.second.length;
+      speed.seconds += edge.second.seconds;
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(threads_);
+  for (size_t i = 0; i < threads_; ++i) {
+    threads.emplace_back(match);
+  }
+
+  // read no further ahead of the threads than allowed
+  std::string line;
+  while (std::getline(input, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    work_taken.wait(lock, [&]() { return traces.size() < max_pending_; });
+    traces.emplace_back(std::move(line));
+    work_available.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done_reading = true;
+    work_available.notify_all();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return matched;
+}
+
+} // namespace meili
+} // namespace valhalla
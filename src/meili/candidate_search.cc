@@ -164,21 +164,25 @@ void IndexBin(const graph_tile_ptr& tile,
 
 CandidateGridQuery::CandidateGridQuery(baldr::GraphReader& reader,
                                        float cell_width,
-                                       float cell_height)
-    : reader_(reader), cell_width_(cell_width), cell_height_(cell_height), grid_cache_() {
+                                       float cell_height,
+                                       const baldr::SpatialIndex* index,
+                                       std::shared_ptr<CandidateGridCache> grid_cache)
+    : reader_(reader), cell_width_(cell_width), cell_height_(cell_height),
+      grid_cache_(grid_cache ? std::move(grid_cache) : std::make_shared<CandidateGridCache>()),
+      index_(index) {
   bin_level_ = baldr::TileHierarchy::levels().back().level;
 }
 
 CandidateGridQuery::~CandidateGridQuery() = default;
 
-inline const CandidateGridQuery::grid_t*
+inline std::shared_ptr<const CandidateGridQuery::grid_t>
 CandidateGridQuery::GetGrid(const int32_t bin_id,
                             const Tiles<PointLL>& tiles,
                             const Tiles<PointLL>& bins) const {
   // Check if the bin is in the cache
-  const auto it = grid_cache_.find(bin_id);
-  if (it != grid_cache_.end()) {
-    return &(it->second);
+  auto grid = grid_cache_->Find(bin_id);
+  if (grid) {
+    return grid;
   }
 
   // Not in the cache. Get the tile and Index the bin within the tile.
@@ -196,34 +200,41 @@ CandidateGridQuery::GetGrid(const int32_t bin_id,
   int32_t bin_col = rc.second % ndiv;
   int32_t bin_index = (bin_row * ndiv) + bin_col;
 
-  // Insert the bin into the cache and index the bin
-  const auto inserted =
-      grid_cache_.emplace(bin_id, grid_t(tile->BoundingBox(), cell_width_, cell_height_));
-  IndexBin(tile, bin_index, reader_, inserted.first->second);
-  return &(inserted.first->second);
+  // Index the bin and insert it into the cache, it is never modified once there
+  auto built = std::make_shared<grid_t>(tile->BoundingBox(), cell_width_, cell_height_);
+  IndexBin(tile, bin_index, reader_, *built);
+  return grid_cache_->Insert(bin_id, std::move(built));
 }
 
-std::unordered_set<baldr::GraphId>
-CandidateGridQuery::RangeQuery(const AABB2<midgard::PointLL>& range) const {
-  // Get the tiles object from the tile hierarchy and create the bin tiles
-  // (subdivisions within the tile)
-  const Tiles<PointLL>& tiles = baldr::TileHierarchy::levels().back().tiles;
-  Tiles<PointLL> bins(tiles.TileBounds(), tiles.SubdivisionSize());
-
-  // Get a list of bins within the range. These are "tile Ids" that must
-  // be resolved to a Graph Id (tile) / bin combination
-  auto bin_list = bins.TileList(range);
-
-  // Iterate through the bins and query grids to get results
-  std::unordered_set<baldr::GraphId> result;
-  for (auto bin_id : bin_list) {
-    auto grid = GetGrid(bin_id, tiles, bins);
-    if (grid) {
-      const auto set = grid->Query(range);
-      result.insert(set.begin(), set.end());
+void CandidateGridQuery::RangeQuery(const AABB2<midgard::PointLL>& range,
+                                    std::vector<baldr::GraphId>& edgeids) const {
+  edgeids.clear();
+
+  // The index has the edges whose shape is near the range without looking at any tiles
+  if (index_) {
+    edgeids = index_->Edges(range);
+  } else {
+    // Get the tiles object from the tile hierarchy and create the bin tiles
+    // (subdivisions within the tile)
+    const Tiles<PointLL>& tiles = baldr::TileHierarchy::levels().back().tiles;
+    Tiles<PointLL> bins(tiles.TileBounds(), tiles.SubdivisionSize());
+
+    // Get a list of bins within the range. These are "tile Ids" that must
+    // be resolved to a Graph Id (tile) / bin combination
+    auto bin_list = bins.TileList(range);
+
+    // Iterate through the bins and query grids to get results
+    for (auto bin_id : bin_list) {
+      auto grid = GetGrid(bin_id, tiles, bins);
+      if (grid) {
+        grid->AppendItems(range, edgeids);
+      }
     }
   }
-  return result;
+
+  // An edge is in every cell and bin its shape crosses
+  std::sort(edgeids.begin(), edgeids.end());
+  edgeids.erase(std::unique(edgeids.begin(), edgeids.end()), edgeids.end());
 }
 
 std::vector<baldr::PathLocation> CandidateGridQuery::Query(const midgard::PointLL& location,
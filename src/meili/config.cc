@@ -54,6 +54,7 @@ void Config::CandidateSearch::Read(const boost::property_tree::ptree& params) {
 
   ReadParamOptional(cache_size, params, "grid.cache_size");
   ReadParamOptional(grid_size, params, "grid.size");
+  ReadParamOptional(shared_grid_cache, params, "grid.shared");
 }
 
 void Config::TransitionCost::Read(const boost::property_tree::ptree& params) {
@@ -106,6 +107,13 @@ void Config::Routing::Read(const boost::property_tree::ptree& params) {
   if (const auto node = params.get_child_optional("customizable")) {
     is_interpolation_distance_customizable = FindValue(*node, "interpolation_distance");
   }
+
+  ReadParamOptional(adaptive_interpolation, params, "default.adaptive_interpolation");
+  if (const auto node = params.get_child_optional("customizable")) {
+    is_adaptive_interpolation_customizable = FindValue(*node, "adaptive_interpolation");
+  }
+
+  ReadParamOptional(transition_cache_size, params, "transition_cache_size");
 }
 
 } // namespace meili
@@ -17,6 +17,9 @@ using namespace valhalla::meili;
 
 constexpr float MAX_ACCUMULATED_COST = 99999999.f;
 
+// How many lags of final points an online trace keeps before dropping them
+constexpr uint32_t ONLINE_HISTORY_LAGS = 4;
+
 inline float GreatCircleDistanceSquared(const Measurement& left, const Measurement& right) {
   return left.lnglat().DistanceSquared(right.lnglat());
 }
@@ -30,6 +33,32 @@ inline float ClockDistance(const Measurement& left, const Measurement& right) {
                                                          : right.epoch_time() - left.epoch_time();
 }
 
+// Going straight on a trace only needs to be matched after this many seconds
+constexpr double ADAPTIVE_INTERPOLATION_SECONDS = 2.0;
+
+// Turning by up to this many degrees still counts as going straight
+constexpr float ADAPTIVE_INTERPOLATION_HEADING = 30.f;
+
+// Whether a measurement beyond the interpolation distance of the last match can be interpolated
+// anyway. It can if the trace goes on from the last match the way it came to it, for no more than
+// a couple of seconds at whatever speed it goes and no farther than the search radius of the last
+// match. Densely sampled traces match a point every so often that way instead of every few meters
+inline bool GoesStraightOn(const Measurement& previous,
+                           const Measurement& last,
+                           const Measurement& measurement) {
+  if (measurement.is_break_point() ||
+      GreatCircleDistanceSquared(last, measurement) > last.sq_search_radius()) {
+    return false;
+  }
+  const auto seconds = ClockDistance(last, measurement);
+  if (seconds > ADAPTIVE_INTERPOLATION_SECONDS) {
+    return false;
+  }
+  const float turn = std::fabs(previous.lnglat().Heading(last.lnglat()) -
+                               last.lnglat().Heading(measurement.lnglat()));
+  return std::min(turn, 360.f - turn) <= ADAPTIVE_INTERPOLATION_HEADING;
+}
+
 std::string print_result(const StateContainer& container,
                          const std::vector<StateId>& original_state_ids) {
   std::string result = R"({"type":"FeatureCollection","features":[)";
@@ -521,6 +550,7 @@ void MapMatcher::Clear() {
   vs_.set_transition_cost_model(transition_cost_model_);
   ts_.Clear();
   container_.Clear();
+  online_ = online_t{};
 }
 
 void MapMatcher::RemoveRedundancies(const std::vector<StateId>& result,
@@ -824,6 +854,115 @@ std::vector<MatchResults> MapMatcher::OfflineMatch(const std::vector<Measurement
   return best_paths;
 }
 
+MatchResults MapMatcher::OnlineMatch(const Measurement& measurement, uint32_t lag) {
+  if (!online_.active) {
+    Clear();
+    online_.active = true;
+  }
+
+  // Only the new point is searched for and added to the viterbi search
+  const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
+                                     config_.candidate_search.max_search_radius_meters;
+  const auto time = AppendMeasurement(measurement, sq_max_search_radius);
+  online_.state_ids.resize(container_.size());
+
+  // Whatever is far enough behind is final
+  auto results = FinalizeOnline(time >= lag ? time - lag + 1 : 0);
+
+  // Every few lags the final history is dropped so that it doesnt keep growing
+  if (online_.finalized > std::max<StateId::Time>(lag, 1) * ONLINE_HISTORY_LAGS) {
+    PruneOnline();
+  }
+  return results;
+}
+
+MatchResults MapMatcher::FinishOnlineMatch() {
+  auto results = FinalizeOnline(container_.size());
+  Clear();
+  return results;
+}
+
+MatchResults MapMatcher::FinalizeOnline(const StateId::Time until) {
+  std::vector<MatchResult> results;
+  if (until <= online_.finalized) {
+    return MatchResults(std::move(results), {}, 0);
+  }
+
+  // The best path back to the first point that isnt final yet. Searching the winner only expands
+  // the columns which were added since the last time
+  const auto last_time = container_.size() - 1;
+  auto time = last_time;
+  for (auto it = vs_.SearchPathVS(last_time); it != vs_.PathEnd(); ++it, --time) {
+    online_.state_ids[time] = ts_.GetOrigin(*it, *it);
+    if (time == online_.finalized) {
+      break;
+    }
+  }
+
+  // The results of the points which are now final, the ones after them give the next edges
+  results.reserve(until - online_.finalized + online_.has_last);
+  if (online_.has_last) {
+    results.push_back(online_.last);
+  }
+  for (time = online_.finalized; time < until; ++time) {
+    results.push_back(FindMatchResult(*this, online_.state_ids, time, graphreader_));
+  }
+
+  // The route from the last final point through the new ones
+  auto segments = ConstructRoute(*this, results);
+  if (online_.has_last) {
+    results.erase(results.begin());
+  }
+  online_.last = results.back();
+  online_.has_last = true;
+  online_.finalized = until;
+  const auto& winner = online_.state_ids[until - 1];
+  return MatchResults(std::move(results), std::move(segments),
+                      winner.IsValid() ? vs_.AccumulatedCost(winner) : 0);
+}
+
+void MapMatcher::PruneOnline() {
+  // The last final point is kept with the candidate it was matched to so that the rest continue
+  // from it, the points which arent final yet keep all of their candidates
+  const auto anchor = online_.finalized - 1;
+  const auto& anchor_id = online_.state_ids[anchor];
+  struct column_t {
+    Measurement measurement;
+    double leave_time;
+    std::vector<baldr::PathLocation> candidates;
+  };
+  std::vector<column_t> columns;
+  columns.reserve(container_.size() - anchor);
+  for (auto time = anchor; time < container_.size(); ++time) {
+    columns.push_back({container_.measurement(time), container_.leave_time(time), {}});
+    if (time == anchor) {
+      if (anchor_id.IsValid()) {
+        columns.back().candidates.push_back(container_.state(anchor_id).candidate());
+      }
+      continue;
+    }
+    for (const auto& state : container_.column(time)) {
+      columns.back().candidates.push_back(state.candidate());
+    }
+  }
+
+  // Start over with them
+  auto online = std::move(online_);
+  Clear();
+  online_ = std::move(online);
+  for (const auto& column : columns) {
+    const auto time = container_.AppendMeasurement(column.measurement);
+    container_.SetMeasurementLeaveTime(time, column.leave_time);
+    for (const auto& candidate : column.candidates) {
+      vs_.AddStateId(container_.AppendCandidate(candidate));
+    }
+  }
+  online_.state_ids.assign(container_.size(), StateId());
+  online_.state_ids.front() = anchor_id.IsValid() ? StateId(0, 0) : StateId();
+  online_.last.stateid = online_.state_ids.front();
+  online_.finalized = 1;
+}
+
 std::unordered_map<StateId::Time, std::vector<Measurement>>
 MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
   const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
@@ -834,12 +973,17 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
 
   // Always match the first measurement
   auto last = measurements.cbegin();
+  auto previous = measurements.cend();
   auto time = AppendMeasurement(*last, sq_max_search_radius);
   double interpolated_epoch_time = -1;
   for (auto m = std::next(last); m != measurements.end(); ++m) {
     const auto sq_distance = GreatCircleDistanceSquared(*last, *m);
+    const bool far_enough = sq_interpolation_distance < sq_distance &&
+                            !(config_.routing.adaptive_interpolation &&
+                              previous != measurements.cend() &&
+                              GoesStraightOn(*previous, *last, *m));
     // Always match the last measurement and if its far enough away
-    if (sq_interpolation_distance < sq_distance || std::next(m) == measurements.end()) {
+    if (far_enough || std::next(m) == measurements.end()) {
       // If there were interpolated points between these two points with time information
       if (interpolated_epoch_time != -1) {
         // Project the last interpolated point onto the line between the two match points
@@ -854,6 +998,7 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
       }
       // This one isnt interpolated so we make room for its state
       time = AppendMeasurement(*m, sq_max_search_radius);
+      previous = last;
       last = m;
       interpolated_epoch_time = -1;
     } // TODO: if its the last measurement and it wants to be interpolated
@@ -1,7 +1,10 @@
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/costconstants.h"
@@ -20,6 +23,19 @@ inline float local_tile_size() {
   return tiles.TileSize();
 }
 
+// The grids of every factory of the process using the same tiles and grid size
+std::shared_ptr<valhalla::meili::CandidateGridCache> shared_grid_cache(const std::string& key) {
+  static std::unordered_map<std::string, std::shared_ptr<valhalla::meili::CandidateGridCache>>
+      caches;
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& cache = caches[key];
+  if (!cache) {
+    cache = std::make_shared<valhalla::meili::CandidateGridCache>();
+  }
+  return cache;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -30,9 +46,32 @@ MapMatcherFactory::MapMatcherFactory(const boost::property_tree::ptree& root,
     : config_(root.get_child("meili")), graphreader_(graph_reader) {
   if (!graphreader_)
     graphreader_.reset(new baldr::GraphReader(root.get_child("mjolnir")));
+  // Use the spatial index to find candidates with if one was built
+  if (root.get<bool>("mjolnir.spatial_index", false)) {
+    try {
+      spatial_index_.reset(new baldr::SpatialIndex(
+          baldr::SpatialIndex::FileName(root.get<std::string>("mjolnir.tile_dir", ""))));
+    } catch (const std::exception& e) {
+      LOG_WARN(std::string("Not using the spatial index: ") + e.what());
+    }
+  }
+  // Build each grid once for all the factories of the process rather than once per factory
+  std::shared_ptr<CandidateGridCache> grid_cache;
+  if (config_.candidate_search.shared_grid_cache) {
+    grid_cache = shared_grid_cache(root.get<std::string>("mjolnir.tile_extract", "") + "|" +
+                                   root.get<std::string>("mjolnir.tile_dir", "") + "|" +
+                                   root.get<std::string>("mjolnir.tile_url", "") + "|" +
+                                   std::to_string(config_.candidate_search.grid_size));
+  }
   candidatequery_.reset(
       new CandidateGridQuery(*graphreader_, local_tile_size() / config_.candidate_search.grid_size,
-                             local_tile_size() / config_.candidate_search.grid_size));
+                             local_tile_size() / config_.candidate_search.grid_size,
+                             spatial_index_.get(), grid_cache));
+  // Keep the routes between candidates for the traces matched after them
+  if (config_.routing.transition_cache_size > 0) {
+    route_cache_.reset(new TransitionRouteCache(config_.routing.transition_cache_size));
+    route_cache_generation_ = graphreader_->TrafficGeneration();
+  }
 }
 
 MapMatcherFactory::~MapMatcherFactory() {
@@ -48,7 +87,19 @@ MapMatcher* MapMatcherFactory::Create(const Options& options) {
   mode_costing_[static_cast<uint32_t>(mode)] = cost;
 
   // TODO investigate exception safety
-  return new MapMatcher(config, *graphreader_, *candidatequery_, mode_costing_, mode);
+  auto* matcher = new MapMatcher(config, *graphreader_, *candidatequery_, mode_costing_, mode);
+  if (route_cache_) {
+    // routes found before the traffic changed may no longer be the best ones
+    const auto traffic_generation = graphreader_->TrafficGeneration();
+    if (traffic_generation != route_cache_generation_) {
+      route_cache_->Clear();
+      route_cache_generation_ = traffic_generation;
+    }
+    const float turn_penalty_factor = config.transition_cost.turn_penalty_factor;
+    matcher->set_route_cache(route_cache_.get(),
+                             TransitionRouteCache::CostingKey(options, turn_penalty_factor));
+  }
+  return matcher;
 }
 
 Config MapMatcherFactory::MergeConfig(const Options& options) const {
@@ -72,6 +123,10 @@ Config MapMatcherFactory::MergeConfig(const Options& options) const {
   if (options.has_interpolation_distance() && config.routing.is_interpolation_distance_customizable) {
     config.routing.interpolation_distance_meters = options.interpolation_distance();
   }
+  if (options.has_adaptive_interpolation() &&
+      config.routing.is_adaptive_interpolation_customizable) {
+    config.routing.adaptive_interpolation = options.adaptive_interpolation();
+  }
 
   // Give it back
   return config;
@@ -90,6 +145,9 @@ void MapMatcherFactory::ClearFullCache() {
 void MapMatcherFactory::ClearCache() {
   graphreader_->Clear();
   candidatequery_->Clear();
+  if (route_cache_) {
+    route_cache_->Clear();
+  }
 }
 
 } // namespace meili
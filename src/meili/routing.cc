@@ -219,6 +219,36 @@ void set_origin(baldr::GraphReader& reader,
   }
 }
 
+/**
+ * Set the edges and nodes of one destination.
+ */
+void set_destination(baldr::GraphReader& reader,
+                     const std::vector<baldr::PathLocation>& destinations,
+                     const uint16_t dest,
+                     std::unordered_map<baldr::GraphId, std::unordered_set<uint16_t>>& node_dests,
+                     std::unordered_map<baldr::GraphId, std::unordered_set<uint16_t>>& edge_dests) {
+  graph_tile_ptr tile;
+  for (const auto& edge : destinations[dest].edges) {
+    if (edge.begin_node()) {
+      auto edge_nodes = reader.GetDirectedEdgeNodes(edge.id, tile);
+      const auto nodeid = edge_nodes.first;
+      if (!nodeid.Is_Valid()) {
+        continue;
+      }
+      node_dests[nodeid].insert(dest);
+    } else if (edge.end_node()) {
+      auto edge_nodes = reader.GetDirectedEdgeNodes(edge.id, tile);
+      const auto nodeid = edge_nodes.second;
+      if (!nodeid.Is_Valid()) {
+        continue;
+      }
+      node_dests[nodeid].insert(dest);
+    } else {
+      edge_dests[edge.id].insert(dest);
+    }
+  }
+}
+
 /**
  * Set destinations. Note that we put the origin in the destinations as well.
  * TODO: are we doing this because to skip outliers? in other words, if we cant find a path to any of
@@ -230,26 +260,20 @@ void set_destinations(baldr::GraphReader& reader,
                       const std::vector<baldr::PathLocation>& destinations,
                       std::unordered_map<baldr::GraphId, std::unordered_set<uint16_t>>& node_dests,
                       std::unordered_map<baldr::GraphId, std::unordered_set<uint16_t>>& edge_dests) {
-  graph_tile_ptr tile;
   for (uint16_t dest = 0; dest < destinations.size(); dest++) {
-    for (const auto& edge : destinations[dest].edges) {
-      if (edge.begin_node()) {
-        auto edge_nodes = reader.GetDirectedEdgeNodes(edge.id, tile);
-        const auto nodeid = edge_nodes.first;
-        if (!nodeid.Is_Valid()) {
-          continue;
-        }
-        node_dests[nodeid].insert(dest);
-      } else if (edge.end_node()) {
-        auto edge_nodes = reader.GetDirectedEdgeNodes(edge.id, tile);
-        const auto nodeid = edge_nodes.second;
-        if (!nodeid.Is_Valid()) {
-          continue;
-        }
-        node_dests[nodeid].insert(dest);
-      } else {
-        edge_dests[edge.id].insert(dest);
-      }
+    set_destination(reader, destinations, dest, node_dests, edge_dests);
+  }
+}
+
+void index_destinations(baldr::GraphReader& reader,
+                        const std::vector<baldr::PathLocation>& destinations,
+                        const uint16_t skip_idx,
+                        destination_index_t& index) {
+  index.node_dests.clear();
+  index.edge_dests.clear();
+  for (uint16_t dest = 0; dest < destinations.size(); dest++) {
+    if (dest != skip_idx) {
+      set_destination(reader, destinations, dest, index.node_dests, index.edge_dests);
     }
   }
 }
@@ -354,7 +378,8 @@ find_shortest_path(baldr::GraphReader& reader,
                    const Label* edgelabel,
                    const float turn_cost_table[181],
                    const float max_dist,
-                   const float max_time) {
+                   const float max_time,
+                   const destination_index_t* destination_index) {
   Label label;
   const sif::TravelMode travelmode = costing->travel_mode();
 
@@ -469,8 +494,14 @@ find_shortest_path(baldr::GraphReader& reader,
   // Load origin to the queue of the labelset
   set_origin(reader, destinations, origin_idx, labelset, travelmode, costing, edgelabel);
 
-  // Load destinations
-  set_destinations(reader, destinations, node_dests, edge_dests);
+  // Load destinations, only the origin is left to be found if the rest were already
+  if (destination_index) {
+    node_dests = destination_index->node_dests;
+    edge_dests = destination_index->edge_dests;
+    set_destination(reader, destinations, origin_idx, node_dests, edge_dests);
+  } else {
+    set_destinations(reader, destinations, node_dests, edge_dests);
+  }
 
   // TODO: use faster unordered_map impl like matrix PR does
   std::unordered_map<uint16_t, uint32_t> results;
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "meili/transition_cost_model.h"
 #include "meili/routing.h"
 
@@ -109,27 +111,36 @@ void TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) co
     edgelabel = prev_state.last_label(left);
   }
 
-  // Prepare locations and stateids
+  // Prepare locations and stateids. Every candidate of the left column routes to the same right
+  // column so its candidates are copied and found in the graph just once for all of them, what
+  // changes from one search to the next is the origin at index 0
   const auto& right_column = container_.column(right.stateid().time());
-  std::vector<baldr::PathLocation> locations;
-  locations.reserve(1 + right_column.size());
-  locations.push_back(left.candidate());
+  if (column_generation_ != container_.generation() || column_time_ != right.stateid().time() ||
+      column_stateids_.size() != right_column.size()) {
+    column_generation_ = container_.generation();
+    column_time_ = right.stateid().time();
+    column_locations_.clear();
+    column_locations_.reserve(1 + right_column.size());
+    column_locations_.emplace_back(left.candidate());
+    column_stateids_.clear();
+    column_stateids_.reserve(right_column.size());
+    for (const auto& state : right_column) {
+      column_locations_.push_back(state.candidate());
+      column_stateids_.push_back(state.stateid());
+      LOG_TRACE("Routing to: " + std::to_string(state.stateid().time()) + "." +
+                std::to_string(state.stateid().id()) + "   [" +
+                std::to_string(column_locations_.back().edges.front().projected.lng()) + "," +
+                std::to_string(column_locations_.back().edges.front().projected.lat()) + "],");
+    }
+    index_destinations(graphreader_, column_locations_, 0, column_destinations_);
+  } else {
+    column_locations_.front() = left.candidate();
+  }
+  const auto& locations = column_locations_;
   LOG_TRACE("Routing from: " + std::to_string(left.stateid().time()) + "." +
             std::to_string(left.stateid().id()) + " [" +
-            std::to_string(locations.back().edges.front().projected.lng()) + "," +
-            std::to_string(locations.back().edges.front().projected.lat()) + "],");
-  std::vector<StateId> unreached_stateids;
-  unreached_stateids.reserve(right_column.size());
-  for (const auto& state : right_column) {
-    // if (!vs_.Predecessor(state.stateid()).IsValid()) {
-    locations.push_back(state.candidate());
-    unreached_stateids.push_back(state.stateid());
-    LOG_TRACE("Routing to: " + std::to_string(state.stateid().time()) + "." +
-              std::to_string(state.stateid().id()) + "   [" +
-              std::to_string(locations.back().edges.front().projected.lng()) + "," +
-              std::to_string(locations.back().edges.front().projected.lat()) + "],");
-    //}
-  }
+            std::to_string(locations.front().edges.front().projected.lng()) + "," +
+            std::to_string(locations.front().edges.front().projected.lat()) + "],");
 
   const auto& left_measurement = container_.measurement(lhs.time());
   const auto& right_measurement = container_.measurement(rhs.time());
@@ -150,12 +161,141 @@ void TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) co
   }
 
   labelset_ptr_t labelset = std::make_shared<LabelSet>(max_route_distance);
+
+  // Other traces may have been routed between the same candidates before
+  if (route_cache_) {
+    route_keys_.clear();
+    for (size_t i = 1; i < locations.size(); ++i) {
+      route_keys_.push_back(
+          TransitionRouteCache::Key(route_cache_key_, edgelabel, locations.front(), locations[i]));
+    }
+    std::unordered_map<uint16_t, uint32_t> results;
+    const bool hit =
+        FromRouteCache(locations, max_route_distance, max_route_time, *labelset, results);
+    route_cache_->Count(hit);
+    if (hit) {
+      left.SetRoute(column_stateids_, results, labelset);
+      return;
+    }
+    labelset = std::make_shared<LabelSet>(max_route_distance);
+  }
+
   const auto& results = find_shortest_path(graphreader_, locations, 0, labelset, approximator,
                                            right_measurement.search_radius(),
                                            mode_costing_[static_cast<size_t>(travelmode_)], edgelabel,
-                                           turn_cost_table_, max_route_distance, max_route_time);
+                                           turn_cost_table_, max_route_distance, max_route_time,
+                                           &column_destinations_);
+
+  if (route_cache_) {
+    ToRouteCache(results, *labelset, max_route_distance, max_route_time);
+  }
+
+  left.SetRoute(column_stateids_, results, labelset);
+}
+
+bool TransitionCostModel::FromRouteCache(const std::vector<baldr::PathLocation>& locations,
+                                         const float max_dist,
+                                         const float max_time,
+                                         LabelSet& labelset,
+                                         std::unordered_map<uint16_t, uint32_t>& results) const {
+  if (!route_cache_->Find(route_keys_, routes_)) {
+    return false;
+  }
+
+  // Where along an edge a location is, if it is on it
+  const auto percent_along = [](const baldr::PathLocation& location, const baldr::GraphId& edgeid,
+                                float& percent) {
+    for (const auto& edge : location.edges) {
+      if (edge.id == edgeid) {
+        percent = edge.percent_along;
+        return true;
+      }
+    }
+    return false;
+  };
+
+  const auto& costing = mode_costing_[static_cast<size_t>(travelmode_)];
+  for (size_t i = 0; i < routes_.size(); ++i) {
+    auto& route = routes_[i];
+    const uint16_t dest = i + 1;
+
+    // Not finding a route is only as good as the limits it was searched within
+    if (route.labels.empty()) {
+      if (route.max_dist < max_dist ||
+          (0 <= route.max_time && (max_time < 0 || route.max_time < max_time))) {
+        return false;
+      }
+      continue;
+    }
+
+    // The candidates are only in the same buckets along their edges, the first and the last
+    // segments are moved to where they are now and the costs of the rest shift with them
+    sif::Cost shift{};
+    const bool origin_along_edge = !route.labels.front().nodeid().Is_Valid();
+    for (size_t j = 1; j < route.labels.size(); ++j) {
+      auto& label = route.labels[j];
+      const bool last = j + 1 == route.labels.size();
+      float source = label.source();
+      float target = label.target();
+      if (j == 1 && origin_along_edge &&
+          !percent_along(locations.front(), label.edgeid(), source)) {
+        return false;
+      }
+      if (last && label.dest() != kInvalidDestination &&
+          !percent_along(locations[dest], label.edgeid(), target)) {
+        return false;
+      }
+      if (target < source) {
+        return false;
+      }
+      if (source != label.source() || target != label.target()) {
+        graph_tile_ptr tile;
+        const auto* edge = graphreader_.directededge(label.edgeid(), tile);
+        if (!edge) {
+          return false;
+        }
+        const float change = (target - source) - (label.target() - label.source());
+        shift += sif::Cost(edge->length() * change, costing->EdgeCost(edge, tile).secs * change);
+      }
+      label.Refit(last && label.dest() != kInvalidDestination ? dest : label.dest(), source, target,
+                  label.cost() + shift);
+    }
+
+    // And it has to be within the limits of this search
+    const auto& cost = route.labels.back().cost();
+    if (!(cost.cost < max_dist && (max_time < 0 || cost.secs < max_time))) {
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < routes_.size(); ++i) {
+    if (!routes_[i].labels.empty()) {
+      results[i + 1] = labelset.put(routes_[i].labels);
+    }
+  }
+  return true;
+}
 
-  left.SetRoute(unreached_stateids, results, labelset);
+void TransitionCostModel::ToRouteCache(const std::unordered_map<uint16_t, uint32_t>& results,
+                                       const LabelSet& labelset,
+                                       const float max_dist,
+                                       const float max_time) const {
+  routes_.clear();
+  routes_.reserve(route_keys_.size());
+  for (size_t i = 0; i < route_keys_.size(); ++i) {
+    routes_.push_back({{}, max_dist, max_time});
+    const auto found = results.find(i + 1);
+    if (found == results.end()) {
+      continue;
+    }
+    auto& labels = routes_.back().labels;
+    const RoutePathIterator end(&labelset);
+    for (RoutePathIterator label(&labelset, found->second); label != end; ++label) {
+      labels.push_back(*label);
+    }
+    std::reverse(labels.begin(), labels.end());
+  }
+  route_cache_->Put(route_keys_, std::move(routes_));
 }
 
 } // namespace meili
@@ -0,0 +1,133 @@
+#include "meili/transition_route_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void append(std::string& key, const std::string& value) {
+  append(key, value.size());
+  key += value;
+}
+
+// Rounds where along the edge a candidate is to its bucket, the nodes at either end are their own
+uint32_t bucket(const valhalla::baldr::PathLocation::PathEdge& edge) {
+  using valhalla::meili::TransitionRouteCache;
+  if (edge.begin_node()) {
+    return TransitionRouteCache::kOffsetBuckets;
+  }
+  if (edge.end_node()) {
+    return TransitionRouteCache::kOffsetBuckets + 1;
+  }
+  return std::min(static_cast<uint32_t>(edge.percent_along * TransitionRouteCache::kOffsetBuckets),
+                  TransitionRouteCache::kOffsetBuckets - 1);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+TransitionRouteCache::TransitionRouteCache(const size_t max_routes)
+    : max_routes_(max_routes), hits_(0), misses_(0) {
+}
+
+std::string TransitionRouteCache::CostingKey(const Options& options,
+                                             const float turn_penalty_factor) {
+  // the costing and all of its options, which also have the edges it avoids
+  std::string key = std::to_string(options.costing()) + ":";
+  for (const auto& costing_options : options.costing_options()) {
+    append(key, costing_options.SerializeAsString());
+  }
+  append(key, turn_penalty_factor);
+  return key;
+}
+
+std::string TransitionRouteCache::Key(const std::string& costing_key,
+                                      const Label* edgelabel,
+                                      const baldr::PathLocation& origin,
+                                      const baldr::PathLocation& destination) {
+  // how the origin was come to decides which turns and uturns are allowed out of it
+  std::string key = costing_key;
+  append(key, edgelabel ? edgelabel->edgeid() : baldr::GraphId());
+  append(key, edgelabel ? edgelabel->restriction_idx() : -1);
+  append(key, origin.stoptype_);
+  for (const auto& edge : origin.edges) {
+    append(key, edge.id);
+    append(key, bucket(edge));
+  }
+  append(key, destination.edges.size());
+  for (const auto& edge : destination.edges) {
+    append(key, edge.id);
+    append(key, bucket(edge));
+    // within the same bucket of the same edge the destination can still be behind the origin
+    for (const auto& origin_edge : origin.edges) {
+      if (origin_edge.id == edge.id) {
+        append(key, origin_edge.percent_along <= edge.percent_along);
+      }
+    }
+  }
+  return key;
+}
+
+bool TransitionRouteCache::Find(const std::vector<std::string>& keys,
+                                std::vector<route_t>& routes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::list<entry_t>::iterator> found;
+  found.reserve(keys.size());
+  for (const auto& key : keys) {
+    auto entry = index_.find(key);
+    if (entry == index_.end()) {
+      return false;
+    }
+    found.push_back(entry->second);
+  }
+  routes.clear();
+  routes.reserve(found.size());
+  for (auto entry : found) {
+    entries_.splice(entries_.begin(), entries_, entry);
+    routes.push_back(entry->route);
+  }
+  return true;
+}
+
+void TransitionRouteCache::Put(const std::vector<std::string>& keys,
+                               std::vector<route_t>&& routes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (max_routes_ == 0) {
+    return;
+  }
+  for (size_t i = 0; i < keys.size() && i < routes.size(); ++i) {
+    auto found = index_.find(keys[i]);
+    if (found != index_.end()) {
+      found->second->route = std::move(routes[i]);
+      entries_.splice(entries_.begin(), entries_, found->second);
+      continue;
+    }
+    if (index_.size() == max_routes_) {
+      index_.erase(entries_.back().key);
+      entries_.pop_back();
+    }
+    entries_.push_front({keys[i], std::move(routes[i])});
+    index_.emplace(keys[i], entries_.begin());
+  }
+}
+
+void TransitionRouteCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+}
+
+size_t TransitionRouteCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.size();
+}
+
+} // namespace meili
+} // namespace valhalla
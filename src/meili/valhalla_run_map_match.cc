@@ -1,6 +1,7 @@
 #include "baldr/rapidjson_utils.h"
 #include <boost/property_tree/ptree.hpp>
 
+#include "meili/batch_matcher.h"
 #include "meili/map_matcher_factory.h"
 #include "meili/measurement.h"
 
@@ -36,13 +37,38 @@ ReadMeasurements(istream_t& istream, float default_gps_accuracy, float default_s
 }
 
 int main(int argc, char* argv[]) {
-  if (argc < 2) {
-    std::cout << "usage: map_matching CONFIG" << std::endl;
+  const std::string batch = argc > 2 ? argv[2] : "";
+  if (argc < 2 || (argc > 2 && batch != "--batch" && batch != "--speeds")) {
+    std::cout << "usage: map_matching CONFIG [--batch|--speeds [THREADS]]" << std::endl;
+    std::cout << "  reads traces of lng lat lines separated by empty lines from stdin, or with "
+                 "--batch json traces one per line which are matched on THREADS threads (all the "
+                 "cores by default), see meili/batch_matcher.h. With --speeds the traces are "
+                 "added up into one line per edge of edge_id count meters seconds"
+              << std::endl;
     return 1;
   }
 
   boost::property_tree::ptree config;
   rapidjson::read_json(argv[1], config);
+
+  // Many traces at once, the results are written in the order of the traces
+  if (argc > 2) {
+    BatchMatcher batch_matcher(config, argc > 3 ? std::stoul(argv[3]) : 0);
+    std::ios::sync_with_stdio(false);
+    if (batch == "--speeds") {
+      BatchMatcher::edge_speeds_t speeds;
+      auto count = batch_matcher.MatchSpeeds(std::cin, speeds);
+      for (const auto& edge : speeds) {
+        std::cout << edge.first.value << " " << edge.second.count << " " << edge.second.length
+                  << " " << edge.second.seconds << '\n';
+      }
+      std::cerr << "Matched " << count << " traces onto " << speeds.size() << " edges" << std::endl;
+      return 0;
+    }
+    auto count = batch_matcher.Match(std::cin, std::cout);
+    std::cerr << "Matched " << count << " traces" << std::endl;
+    return 0;
+  }
   const std::string modename = config.get<std::string>("meili.mode");
   valhalla::Costing costing;
   if (!valhalla::Costing_Enum_Parse(modename, &costing)) {
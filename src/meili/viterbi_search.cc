@@ -1,6 +1,8 @@
 #include "meili/viterbi_search.h"
+#include "midgard/tracepoint.h"
 
 #include <algorithm>
+#include <iterator>
 #include <string>
 
 namespace valhalla {
@@ -121,18 +123,51 @@ IViterbiSearch::~IViterbiSearch() {
 
 void IViterbiSearch::Clear() {
   added_states_.clear();
+  added_sparse_states_.clear();
 }
 
 bool IViterbiSearch::AddStateId(const StateId& stateid) {
-  return added_states_.insert(stateid).second;
+  if (!stateid.IsValid() || kMaxDenseId <= stateid.id()) {
+    return added_sparse_states_.insert(stateid).second;
+  }
+  if (added_states_.size() <= stateid.time()) {
+    added_states_.resize(stateid.time() + 1);
+  }
+  auto& bits = added_states_[stateid.time()];
+  const auto word = stateid.id() / 64;
+  if (bits.size() <= word) {
+    bits.resize(word + 1, 0);
+  }
+  const auto bit = uint64_t(1) << (stateid.id() % 64);
+  if (bits[word] & bit) {
+    return false;
+  }
+  bits[word] |= bit;
+  return true;
 }
 
 bool IViterbiSearch::RemoveStateId(const StateId& stateid) {
-  return added_states_.erase(stateid) > 0;
+  if (!HasStateId(stateid)) {
+    return false;
+  }
+  if (!stateid.IsValid() || kMaxDenseId <= stateid.id()) {
+    added_sparse_states_.erase(stateid);
+  } else {
+    added_states_[stateid.time()][stateid.id() / 64] &= ~(uint64_t(1) << (stateid.id() % 64));
+  }
+  return true;
 }
 
 bool IViterbiSearch::HasStateId(const StateId& stateid) const {
-  return added_states_.find(stateid) != added_states_.end();
+  if (!stateid.IsValid() || kMaxDenseId <= stateid.id()) {
+    return added_sparse_states_.find(stateid) != added_sparse_states_.end();
+  }
+  if (added_states_.size() <= stateid.time()) {
+    return false;
+  }
+  const auto& bits = added_states_[stateid.time()];
+  const auto word = stateid.id() / 64;
+  return word < bits.size() && (bits[word] >> (stateid.id() % 64)) & 1;
 }
 
 StateIdIterator IViterbiSearch::SearchPathVS(StateId::Time time, bool allow_breaks) {
@@ -234,25 +269,25 @@ template <bool Maximize> StateId NaiveViterbiSearch<Maximize>::SearchWinner(Stat
 
   for (StateId::Time time = winner_by_time.size(); time <= target; ++time) {
     const auto& column = states_by_time[time];
-    std::vector<StateLabel> labels;
+    // Label into the column of the history, which keeps its memory from earlier searches
+    auto& labels = history_.emplace_back();
 
     // Update labels
     if (time == 0) {
-      labels = InitLabels(column, true);
+      InitLabels(column, true, labels);
     } else {
-      labels = InitLabels(column, false);
-      UpdateLabels(labels, history_.back());
+      InitLabels(column, false, labels);
+      UpdateLabels(labels, history_[time - 1]);
     }
 
     auto winner = FindWinner(labels);
     if (!winner.IsValid() && 0 < time) {
       // If it's not reachable by previous column, we find the winner
       // with the best emission cost only
-      labels = InitLabels(column, true);
+      InitLabels(column, true, labels);
       winner = FindWinner(labels);
     }
     winner_by_time.push_back(winner);
-    history_.push_back(move(labels));
   }
 
   return winner_by_time[target];
@@ -302,14 +337,13 @@ void NaiveViterbiSearch<Maximize>::UpdateLabels(std::vector<StateLabel>& labels,
 }
 
 template <bool Maximize>
-std::vector<StateLabel> NaiveViterbiSearch<Maximize>::InitLabels(const std::vector<StateId>& column,
-                                                                 bool use_emission_cost) const {
-  std::vector<StateLabel> labels;
-  labels.reserve(column.size());
+void NaiveViterbiSearch<Maximize>::InitLabels(const std::vector<StateId>& column,
+                                              bool use_emission_cost,
+                                              std::vector<StateLabel>& labels) const {
+  labels.clear();
   for (const auto& stateid : column) {
     labels.emplace_back(use_emission_cost ? EmissionCost(stateid) : kInvalidCost, stateid, StateId());
   }
-  return labels;
 }
 
 template <bool Maximize>
@@ -426,22 +460,25 @@ StateId ViterbiSearch::SearchWinner(StateId::Time time) {
   return {};
 }
 
-StateId ViterbiSearch::Predecessor(const StateId& stateid) const {
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
-    return {};
-  } else {
-    return (it->second).predecessor();
+const StateLabel* ViterbiSearch::ScannedLabel(const StateId& stateid) const {
+  if (!stateid.IsValid() || scanned_labels_.size() <= stateid.time()) {
+    return nullptr;
   }
+  const auto& labels = scanned_labels_[stateid.time()];
+  const auto it = std::find_if(labels.cbegin(), labels.cend(), [&stateid](const StateLabel& label) {
+    return label.stateid() == stateid;
+  });
+  return it == labels.cend() ? nullptr : &*it;
+}
+
+StateId ViterbiSearch::Predecessor(const StateId& stateid) const {
+  const auto* label = ScannedLabel(stateid);
+  return label ? label->predecessor() : StateId();
 }
 
 double ViterbiSearch::AccumulatedCost(const StateId& stateid) const {
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
-    return -1.f;
-  } else {
-    return it->second.costsofar();
-  }
+  const auto* label = ScannedLabel(stateid);
+  return label ? label->costsofar() : -1.f;
 }
 
 void ViterbiSearch::Clear() {
@@ -455,7 +492,7 @@ void ViterbiSearch::ClearSearch() {
   queue_.clear();
   scanned_labels_.clear();
   winner_by_time.clear();
-  unreached_states_by_time = states_by_time;
+  unreached_states_by_time.assign(states_by_time);
 }
 
 void ViterbiSearch::InitQueue(const std::vector<StateId>& column) {
@@ -475,11 +512,11 @@ void ViterbiSearch::AddSuccessorsToQueue(const StateId& stateid) {
                            " is impossible to have successors");
   }
 
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
+  const auto* label = ScannedLabel(stateid);
+  if (!label) {
     throw std::logic_error("the state must be scanned");
   }
-  const auto costsofar = it->second.costsofar();
+  const auto costsofar = label->costsofar();
   if (IsInvalidCost(costsofar)) {
     // All invalid ones should be filtered out before pushing labels
     // into the queue
@@ -554,11 +591,14 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
     }
 
     // Mark it as scanned and remember its cost and predecessor
-    const auto& inserted = scanned_labels_.emplace(stateid, label);
-    if (!inserted.second) {
+    if (ScannedLabel(stateid)) {
       throw std::logic_error("the principle of optimality is violated in the viterbi search,"
                              " probably negative costs occurred");
     }
+    if (scanned_labels_.size() <= stateid.time()) {
+      scanned_labels_.resize(stateid.time() + 1);
+    }
+    scanned_labels_[stateid.time()].push_back(label);
 
     // Remove it from its column
     auto& column = unreached_states_by_time[stateid.time()];
@@ -585,6 +625,7 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
                                std::to_string(stateid.time()));
       }
       winner_by_time.push_back(stateid);
+      VALHALLA_TRACE2(viterbi_winner, stateid.time(), scanned_labels_[stateid.time()].size());
     }
 
     // Update searched time
@@ -617,5 +658,212 @@ constexpr bool ViterbiSearch::IsInvalidCost(double cost) {
   return cost < 0.f;
 }
 
+ListViterbiSearch::ListViterbiSearch(const uint32_t k,
+                                     const IEmissionCostModel& emission_cost_model,
+                                     const ITransitionCostModel& transition_cost_model)
+    : IViterbiSearch(emission_cost_model, transition_cost_model), k_(k) {
+  if (k_ == 0) {
+    throw std::invalid_argument("expect k to be positive");
+  }
+}
+
+ListViterbiSearch::ListViterbiSearch(const uint32_t k)
+    : ListViterbiSearch(k, DefaultEmissionCostModel, DefaultTransitionCostModel) {
+}
+
+ListViterbiSearch::~ListViterbiSearch() {
+  Clear();
+}
+
+void ListViterbiSearch::Clear() {
+  IViterbiSearch::Clear();
+  states_by_time.clear();
+  ClearSearch();
+}
+
+void ListViterbiSearch::ClearSearch() {
+  labels_.clear();
+  counts_.clear();
+  winner_by_time.clear();
+}
+
+bool ListViterbiSearch::AddStateId(const StateId& stateid) {
+  if (!IViterbiSearch::AddStateId(stateid)) {
+    return false;
+  }
+
+  if (states_by_time.size() <= stateid.time()) {
+    states_by_time.resize(stateid.time() + 1);
+  }
+  states_by_time[stateid.time()].push_back(stateid);
+
+  return true;
+}
+
+bool ListViterbiSearch::RemoveStateId(const StateId& stateid) {
+  if (!IViterbiSearch::RemoveStateId(stateid)) {
+    return false;
+  }
+  // remove it from columns
+  auto& column = states_by_time[stateid.time()];
+  const auto it = std::find(column.begin(), column.end(), stateid);
+  if (it == column.end()) {
+    throw std::logic_error("the state must exist in the column");
+  }
+  column.erase(it);
+
+  return true;
+}
+
+StateId ListViterbiSearch::SearchWinner(StateId::Time time) {
+  if (states_by_time.size() <= time) {
+    return {};
+  }
+  while (labels_.size() <= time) {
+    SearchColumn(labels_.size());
+  }
+  return winner_by_time[time];
+}
+
+uint32_t ListViterbiSearch::IndexOf(const StateId& stateid) const {
+  if (!stateid.IsValid() || labels_.size() <= stateid.time()) {
+    return kInvalidIndex;
+  }
+  const auto& column = states_by_time[stateid.time()];
+  const auto it = std::find(column.cbegin(), column.cend(), stateid);
+  return it == column.cend() ? kInvalidIndex : it - column.cbegin();
+}
+
+StateId ListViterbiSearch::Predecessor(const StateId& stateid) const {
+  const auto index = IndexOf(stateid);
+  if (index == kInvalidIndex || counts_[stateid.time()][index] == 0) {
+    return {};
+  }
+  const auto predecessor = labels_[stateid.time()][index * k_].predecessor;
+  return predecessor == kInvalidIndex ? StateId() : states_by_time[stateid.time() - 1][predecessor];
+}
+
+double ListViterbiSearch::AccumulatedCost(const StateId& stateid) const {
+  const auto index = IndexOf(stateid);
+  if (index == kInvalidIndex || counts_[stateid.time()][index] == 0) {
+    return -1.f;
+  }
+  return labels_[stateid.time()][index * k_].costsofar;
+}
+
+void ListViterbiSearch::SearchColumn(StateId::Time time) {
+  const auto& column = states_by_time[time];
+  auto& labels = labels_.emplace_back();
+  labels.resize(column.size() * k_, Label{-1.f, kInvalidIndex, 0});
+  auto& counts = counts_.emplace_back();
+  counts.resize(column.size(), 0);
+
+  // Every state keeps the k best of the labels of the states before it, each of which is extended
+  // with the same transition and emission cost
+  bool reached = false;
+  if (0 < time) {
+    const auto& prev_column = states_by_time[time - 1];
+    const auto& prev_labels = labels_[time - 1];
+    const auto& prev_counts = counts_[time - 1];
+    for (uint32_t index = 0; index < column.size(); ++index) {
+      const auto emission_cost = EmissionCost(column[index]);
+      if (emission_cost < 0.f) {
+        continue;
+      }
+
+      candidates_.clear();
+      for (uint32_t prev_index = 0; prev_index < prev_column.size(); ++prev_index) {
+        if (prev_counts[prev_index] == 0) {
+          continue;
+        }
+        const auto transition_cost = TransitionCost(prev_column[prev_index], column[index]);
+        if (transition_cost < 0.f) {
+          continue;
+        }
+        for (uint32_t rank = 0; rank < prev_counts[prev_index]; ++rank) {
+          const auto costsofar = CostSofar(prev_labels[prev_index * k_ + rank].costsofar,
+                                           transition_cost, emission_cost);
+          if (0.f <= costsofar) {
+            candidates_.push_back({costsofar, prev_index, rank});
+          }
+        }
+      }
+
+      const auto count = std::min<size_t>(k_, candidates_.size());
+      std::partial_sort(candidates_.begin(), candidates_.begin() + count, candidates_.end());
+      std::copy(candidates_.cbegin(), candidates_.cbegin() + count, labels.begin() + index * k_);
+      counts[index] = count;
+      reached = reached || 0 < count;
+    }
+  }
+
+  // If it's not reachable by previous column, start over with the emission costs only
+  if (!reached) {
+    for (uint32_t index = 0; index < column.size(); ++index) {
+      const auto emission_cost = EmissionCost(column[index]);
+      if (0.f <= emission_cost) {
+        labels[index * k_] = {emission_cost, kInvalidIndex, 0};
+        counts[index] = 1;
+      }
+    }
+  }
+
+  // The winner is the state with the best of the best labels
+  StateId winner;
+  double winner_cost = 0.f;
+  for (uint32_t index = 0; index < column.size(); ++index) {
+    if (counts[index] && (!winner.IsValid() || labels[index * k_].costsofar < winner_cost)) {
+      winner = column[index];
+      winner_cost = labels[index * k_].costsofar;
+    }
+  }
+  winner_by_time.push_back(winner);
+}
+
+std::vector<ListViterbiSearch::Path> ListViterbiSearch::SearchPaths(StateId::Time time) {
+  if (!SearchWinner(time).IsValid()) {
+    return {};
+  }
+
+  // The k best of all the labels at this time
+  const auto& labels = labels_[time];
+  const auto& counts = counts_[time];
+  candidates_.clear();
+  for (uint32_t index = 0; index < counts.size(); ++index) {
+    for (uint32_t rank = 0; rank < counts[index]; ++rank) {
+      candidates_.push_back({labels[index * k_ + rank].costsofar, index, rank});
+    }
+  }
+  const auto count = std::min<size_t>(k_, candidates_.size());
+  std::partial_sort(candidates_.begin(), candidates_.begin() + count, candidates_.end());
+  candidates_.resize(count);
+
+  // Follow each of them back through the ranks of their predecessors
+  std::vector<Path> paths;
+  paths.reserve(count);
+  for (const auto& candidate : candidates_) {
+    paths.push_back({candidate.costsofar, {}});
+    auto& stateids = paths.back().stateids;
+    auto index = candidate.predecessor;
+    auto rank = candidate.rank;
+    for (auto t = time;; --t) {
+      stateids.push_back(states_by_time[t][index]);
+      const auto& label = labels_[t][index * k_ + rank];
+      if (t == 0) {
+        break;
+      }
+      // Before a break there is only the winning path
+      if (label.predecessor == kInvalidIndex) {
+        std::copy(SearchPathVS(t - 1), PathEnd(), std::back_inserter(stateids));
+        break;
+      }
+      index = label.predecessor;
+      rank = label.rank;
+    }
+    std::reverse(stateids.begin(), stateids.end());
+  }
+  return paths;
+}
+
 } // namespace meili
 } // namespace valhalla
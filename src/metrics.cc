@@ -0,0 +1,122 @@
+#include "metrics.h"
+
+#include <sstream>
+
+#include "proto_conversions.h"
+
+namespace {
+
+// the labels of a series, values are names of actions or statistics so need no escaping
+std::string labels(const std::string& action, const std::string& key, const std::string& value) {
+  return "{action=\"" + action + "\"," + key + "=\"" + value + "\"";
+}
+
+// writes the cumulative buckets, the sum and the count of each histogram of a metric
+template <typename histograms_t, typename bounds_t>
+void serialize_histograms(std::ostringstream& out,
+                          const std::string& metric,
+                          const histograms_t& histograms,
+                          const bounds_t& bounds) {
+  for (const auto& histogram : histograms) {
+    const auto series = labels(histogram.first.first, "stage", histogram.first.second);
+    uint64_t count = 0;
+    for (size_t i = 0; i < bounds.size(); ++i) {
+      count += histogram.second.buckets[i];
+      out << metric << "_bucket" << series << ",le=\"" << bounds[i] << "\"} " << count << '\n';
+    }
+    out << metric << "_bucket" << series << ",le=\"+Inf\"} " << histogram.second.count << '\n'
+        << metric << "_sum" << series << "} " << histogram.second.sum << '\n'
+        << metric << "_count" << series << "} " << histogram.second.count << '\n';
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+
+constexpr std::array<double, 16> metrics_t::kBuckets;
+constexpr std::array<uint64_t, 7> metrics_t::kMemoryBuckets;
+
+metrics_t& metrics_t::get() {
+  static metrics_t metrics;
+  return metrics;
+}
+
+void metrics_t::record(const Api& request, unsigned status_code) {
+  if (!request.options().has_action()) {
+    return;
+  }
+  const auto& action = Options_Action_Enum_Name(request.options().action());
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++responses_[{action, status_code}];
+  for (const auto& statistic : request.info().statistics()) {
+    if (statistic.type() == Statistic::count) {
+      counts_[{action, statistic.name()}] += statistic.value();
+    } else if (statistic.type() == Statistic::memory) {
+      memory_[{action, statistic.name()}].add(kMemoryBuckets, statistic.value());
+    } else {
+      timings_[{action, statistic.name()}].add(kBuckets, statistic.value());
+    }
+  }
+}
+
+void metrics_t::add_tile_cache_lookups(const std::string& stage, uint64_t hits, uint64_t misses) {
+  if (hits == 0 && misses == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& lookups = tile_cache_[stage];
+  lookups.first += hits;
+  lookups.second += misses;
+}
+
+std::string metrics_t::serialize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ostringstream out;
+
+  out << "# HELP valhalla_responses_total Requests answered per action and http status\n"
+      << "# TYPE valhalla_responses_total counter\n";
+  for (const auto& response : responses_) {
+    out << "valhalla_responses_total"
+        << labels(response.first.first, "status", std::to_string(response.first.second)) << "} "
+        << response.second << '\n';
+  }
+
+  out << "# HELP valhalla_stage_milliseconds Time taken by the stages of the requests per action\n"
+      << "# TYPE valhalla_stage_milliseconds histogram\n";
+  serialize_histograms(out, "valhalla_stage_milliseconds", timings_, kBuckets);
+
+  out << "# HELP valhalla_stage_memory_bytes Most memory used by the stages of the requests per "
+         "action\n"
+      << "# TYPE valhalla_stage_memory_bytes histogram\n";
+  serialize_histograms(out, "valhalla_stage_memory_bytes", memory_, kMemoryBuckets);
+
+  out << "# HELP valhalla_stage_count_total Things counted by the stages of the requests per action\n"
+      << "# TYPE valhalla_stage_count_total counter\n";
+  for (const auto& count : counts_) {
+    out << "valhalla_stage_count_total" << labels(count.first.first, "statistic", count.first.second)
+        << "} " << count.second << '\n';
+  }
+
+  out << "# HELP valhalla_tile_cache_lookups_total Tile cache lookups per stage\n"
+      << "# TYPE valhalla_tile_cache_lookups_total counter\n";
+  for (const auto& lookups : tile_cache_) {
+    out << "valhalla_tile_cache_lookups_total{stage=\"" << lookups.first << "\",result=\"hit\"} "
+        << lookups.second.first << '\n'
+        << "valhalla_tile_cache_lookups_total{stage=\"" << lookups.first << "\",result=\"miss\"} "
+        << lookups.second.second << '\n';
+  }
+
+  return out.str();
+}
+
+void metrics_t::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  timings_.clear();
+  memory_.clear();
+  counts_.clear();
+  responses_.clear();
+  tile_cache_.clear();
+}
+
+} // namespace valhalla
@@ -1,6 +1,9 @@
 #include "midgard/logging.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
@@ -8,6 +11,8 @@
 #include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -44,6 +49,17 @@ std::string TimeStamp() {
   return buffer;
 }
 
+// returns the line that is written for a message
+std::string Format(const std::string& message, const std::string& custom_directive) {
+  std::string output;
+  output.reserve(message.length() + 64);
+  output.append(TimeStamp());
+  output.append(custom_directive);
+  output.append(message);
+  output.push_back('\n');
+  return output;
+}
+
 // the Log levels we support
 struct EnumHasher {
   template <typename T> std::size_t operator()(T t) const {
@@ -112,6 +128,7 @@ Logger::Logger(const LoggingConfig& config){};
 Logger::~Logger(){};
 void Logger::Log(const std::string&, const LogLevel){};
 void Logger::Log(const std::string&, const std::string&){};
+void Logger::Write(const std::string&){};
 bool logger_registered = RegisterLogger("", [](const LoggingConfig& config) {
   Logger* l = new Logger(config);
   return l;
@@ -138,17 +155,18 @@ public:
 #ifdef __ANDROID__
     __android_log_print(ANDROID_LOG_INFO, "valhalla", "%s", message.c_str());
 #else
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
+    Write(Format(message, custom_directive));
+#endif
+  }
+  virtual void Write(const std::string& lines) {
+#ifdef __ANDROID__
+    __android_log_print(ANDROID_LOG_INFO, "valhalla", "%s", lines.c_str());
+#else
     // cout is thread safe, to avoid multiple threads interleaving on one line
     // though, we make sure to only call the << operator once on std::cout
     // otherwise the << operators from different threads could interleave
     // obviously we dont care if flushes interleave
-    std::cout << output;
+    std::cout << lines;
     std::cout.flush();
 #endif
   }
@@ -167,13 +185,14 @@ class StdErrLogger : public StdOutLogger {
 #ifdef __ANDROID__
     __android_log_print(ANDROID_LOG_ERROR, "valhalla", "%s", message.c_str());
 #else
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
-    std::cerr << output;
+    Write(Format(message, custom_directive));
+#endif
+  }
+  virtual void Write(const std::string& lines) {
+#ifdef __ANDROID__
+    __android_log_print(ANDROID_LOG_ERROR, "valhalla", "%s", lines.c_str());
+#else
+    std::cerr << lines;
     std::cerr.flush();
 #endif
   }
@@ -214,14 +233,11 @@ public:
     Log(message, uncolored.find(level)->second);
   }
   virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
+    Write(Format(message, custom_directive));
+  }
+  virtual void Write(const std::string& lines) {
     lock.lock();
-    file << output;
+    file << lines;
     file.flush();
     lock.unlock();
     ReOpen();
@@ -260,6 +276,181 @@ bool file_logger_registered = RegisterLogger("file", [](const LoggingConfig& con
   return l;
 });
 
+// logger that hands the lines off to a thread which writes them with another logger, so that
+// logging never waits on io. every thread logs into a ring of its own which only it pushes to
+// and only the writing thread pops from, so neither of them takes a lock. a full ring either
+// drops the line, which is counted and reported, or waits for the writing thread to catch up
+class AsyncLogger : public Logger {
+public:
+  AsyncLogger() = delete;
+  AsyncLogger(const LoggingConfig& config)
+      : Logger(config), id(next_id++), queue_size(4096), drop_on_full(true),
+        flush_interval(100), levels(uncolored), dropped(0), done(false) {
+    // the logger that does the writing gets the same config but its own type
+    auto type = config.find("async_type");
+    LoggingConfig wrapped_config(config);
+    wrapped_config["type"] = type == config.end() ? "std_out" : type->second;
+    if (wrapped_config["type"] == "async") {
+      throw std::runtime_error("An async logger cant write with another async logger");
+    }
+
+    // how the queues behave
+    auto size = config.find("queue_size");
+    auto drop = config.find("drop_on_full");
+    auto interval = config.find("flush_interval");
+    try {
+      if (size != config.end()) {
+        queue_size = std::stoul(size->second);
+      }
+      if (interval != config.end()) {
+        flush_interval = std::chrono::milliseconds(std::stoul(interval->second));
+      }
+    } catch (...) {
+      throw std::runtime_error("Invalid queue_size or flush_interval for async logger");
+    }
+    if (queue_size == 0) {
+      throw std::runtime_error("An async logger needs a queue_size of at least 1");
+    }
+    drop_on_full = drop == config.end() || drop->second != "false";
+    auto color = config.find("color");
+    if (color != config.end() && color->second == "true" && wrapped_config["type"] != "file") {
+      levels = colored;
+    }
+
+    wrapped.reset(GetFactory().Produce(wrapped_config));
+    writer = std::thread(&AsyncLogger::Drain, this);
+  }
+  virtual ~AsyncLogger() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      done = true;
+    }
+    wake.notify_one();
+    writer.join();
+  }
+  virtual void Log(const std::string& message, const LogLevel level) {
+    Log(message, levels.find(level)->second);
+  }
+  virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
+    auto line = Format(message, custom_directive);
+    auto& queue = Queue();
+    while (!queue.push(line)) {
+      if (drop_on_full) {
+        ++dropped;
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+  virtual void Write(const std::string& lines) {
+    wrapped->Write(lines);
+  }
+
+protected:
+  // a single producer single consumer ring of lines
+  struct ring_t {
+    ring_t(size_t size) : lines(size), head(0), tail(0) {
+    }
+    bool push(std::string& line) {
+      auto t = tail.load(std::memory_order_relaxed);
+      if (t - head.load(std::memory_order_acquire) == lines.size()) {
+        return false;
+      }
+      lines[t % lines.size()].swap(line);
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+    bool pop_all(std::string& batch) {
+      auto h = head.load(std::memory_order_relaxed);
+      auto t = tail.load(std::memory_order_acquire);
+      for (auto i = h; i < t; ++i) {
+        auto& line = lines[i % lines.size()];
+        batch.append(line);
+        std::string().swap(line);
+      }
+      head.store(t, std::memory_order_release);
+      return h != t;
+    }
+    std::vector<std::string> lines;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+  };
+
+  // gets the ring of the calling thread, the thread remembers it so it only registers once
+  ring_t& Queue() {
+    thread_local std::vector<std::pair<uint64_t, std::shared_ptr<ring_t>>> rings;
+    for (const auto& ring : rings) {
+      if (ring.first == id) {
+        return *ring.second;
+      }
+    }
+    std::shared_ptr<ring_t> ring(new ring_t(queue_size));
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      queues.push_back(ring);
+    }
+    rings.emplace_back(id, ring);
+    return *ring;
+  }
+
+  // writes whatever is in the rings in one go, right away while there is more coming or else
+  // every so often, until the logger goes away and everything is written
+  void Drain() {
+    std::string batch;
+    size_t reported = 0;
+    std::vector<std::shared_ptr<ring_t>> current;
+    for (bool busy = false, finished = false; busy || !finished;) {
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        if (!busy) {
+          wake.wait_for(guard, flush_interval, [this]() { return done; });
+        }
+        finished = done;
+        // forget the rings of threads which have gone away once they are empty
+        queues.erase(std::remove_if(queues.begin(), queues.end(),
+                                    [](const std::shared_ptr<ring_t>& ring) {
+                                      return ring.use_count() == 1 &&
+                                             ring->head.load() == ring->tail.load();
+                                    }),
+                     queues.end());
+        current = queues;
+      }
+      busy = false;
+      for (const auto& ring : current) {
+        busy = ring->pop_all(batch) || busy;
+      }
+      auto lost = dropped.load();
+      if (lost != reported) {
+        batch.append(Format("Dropped " + std::to_string(lost - reported) + " log messages",
+                            levels.find(LogLevel::WARN)->second));
+        reported = lost;
+      }
+      if (!batch.empty()) {
+        wrapped->Write(batch);
+        batch.clear();
+      }
+    }
+  }
+
+  static std::atomic<uint64_t> next_id;
+  const uint64_t id;
+  size_t queue_size;
+  bool drop_on_full;
+  std::chrono::milliseconds flush_interval;
+  std::unordered_map<LogLevel, std::string, EnumHasher> levels;
+  std::unique_ptr<Logger> wrapped;
+  std::vector<std::shared_ptr<ring_t>> queues;
+  std::atomic<size_t> dropped;
+  bool done;
+  std::condition_variable wake;
+  std::thread writer;
+};
+std::atomic<uint64_t> AsyncLogger::next_id(0);
+bool async_logger_registered = RegisterLogger("async", [](const LoggingConfig& config) {
+  Logger* l = new AsyncLogger(config);
+  return l;
+});
+
 } // namespace logging
 
 // statically get a logger using the factory
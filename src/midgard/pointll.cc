@@ -73,6 +73,32 @@ template <typename PrecisionT> PrecisionT GeoPoint<PrecisionT>::Distance(const G
   }
 }
 
+template <typename PrecisionT>
+void GeoPoint<PrecisionT>::Distances(const PrecisionT* lngs,
+                                     const PrecisionT* lats,
+                                     size_t count,
+                                     PrecisionT* distances) {
+  if (count == 0) {
+    return;
+  }
+  double a = lats[0] * RAD_PER_DEG;
+  double sin_a = sin(a), cos_a = cos(a);
+  for (size_t i = 0; i < count; ++i) {
+    // the same as Distance from one position to the next
+    double deltalng = (lngs[i + 1] - lngs[i]) * RAD_PER_DEG;
+    double c = lats[i + 1] * RAD_PER_DEG;
+    double sin_c = sin(c), cos_c = cos(c);
+    double cosb = (sin_a * sin_c) + (cos_a * cos_c * cos(deltalng));
+    double distance = acos(std::max(std::min(cosb, 1.0), -1.0)) * kRadEarthMeters;
+    distance = cosb >= 1 ? 0.00001 : distance;
+    distance = cosb <= -1 ? kPi * kRadEarthMeters : distance;
+    distance = lngs[i] == lngs[i + 1] && lats[i] == lats[i + 1] ? 0 : distance;
+    distances[i] = static_cast<PrecisionT>(distance);
+    sin_a = sin_c;
+    cos_a = cos_c;
+  }
+}
+
 /**
  * Calculates the curvature using this position and 2 others. Found by
  * computing the radius of the circle that circumscribes the 3 positions.
@@ -2,7 +2,11 @@
 #include "midgard/point2.h"
 #include "midgard/pointll.h"
 
+#include <functional>
+#include <limits>
 #include <list>
+#include <utility>
+#include <vector>
 
 namespace valhalla {
 namespace midgard {
@@ -41,27 +45,17 @@ typename coord_t::value_type Polyline2<coord_t>::Length(const container_t& pts)
   return length;
 }
 
-/**
- * Generalize the given list of points
- *
- * @param polyline    the list of points
- * @param epsilon     the tolerance used in removing points
- * @param  indices    list of indices of points not to generalize
- */
-template <typename coord_t>
-template <class container_t>
-void Polyline2<coord_t>::Generalize(container_t& polyline,
-                                    typename coord_t::value_type epsilon,
-                                    const std::unordered_set<size_t>& indices) {
-  // any epsilon this low will have no effect on the input nor will any super short input
-  if (epsilon <= 0 || polyline.size() < 3)
-    return;
+namespace {
 
-  // the recursive bit
-  epsilon *= epsilon;
+// Douglas-Peucker on a list which can have the simplified spans erased out of it as it goes
+template <typename coord_t>
+void peucker(std::list<coord_t>& polyline,
+             typename coord_t::value_type epsilon,
+             const std::unordered_set<size_t>& indices) {
+  using container_t = std::list<coord_t>;
   std::function<void(typename container_t::iterator, size_t, typename container_t::iterator, size_t)>
-      peucker;
-  peucker = [&peucker, &polyline, epsilon, &indices](typename container_t::iterator start, size_t s,
+      recurse;
+  recurse = [&recurse, &polyline, epsilon, &indices](typename container_t::iterator start, size_t s,
                                                      typename container_t::iterator end, size_t e) {
     // find the point furthest from the line
     typename coord_t::value_type dmax = std::numeric_limits<typename coord_t::value_type>::lowest();
@@ -90,20 +84,98 @@ void Polyline2<coord_t>::Generalize(container_t& polyline,
     // there are some high frequency details between start and end
     // so we need to look for flatter sections between them
     if (dmax >= epsilon) {
-      // we recurse from right to left for two reasons:
-      // 1. we want to preserve iterator validity in the vector version
-      // 2. its the only way to preserve the indices in the keep set
+      // we recurse from right to left to preserve the indices in the keep set
       if (e - k > 1)
-        peucker(itr, k, end, e);
+        recurse(itr, k, end, e);
       if (k - s > 1)
-        peucker(start, s, itr, k);
+        recurse(start, s, itr, k);
     } // nothing sticks out between start and end so simplify everything between away
     else
       polyline.erase(std::next(start), end);
   };
 
   // recurse!
-  peucker(polyline.begin(), 0, std::prev(polyline.end()), polyline.size() - 1);
+  recurse(polyline.begin(), 0, std::prev(polyline.end()), polyline.size() - 1);
+}
+
+// Douglas-Peucker on a vector, erasing each simplified span out of the middle would move the tail
+// of the vector every time so instead the points to keep are marked and the vector is compacted
+// once at the end. The spans are independent so a stack of them replaces the recursion
+template <typename coord_t>
+void peucker(std::vector<coord_t>& polyline,
+             typename coord_t::value_type epsilon,
+             const std::unordered_set<size_t>& indices) {
+  std::vector<bool> keep(polyline.size(), false);
+  keep.front() = keep.back() = true;
+  std::vector<std::pair<size_t, size_t>> spans{{0, polyline.size() - 1}};
+  coord_t tmp;
+  while (!spans.empty()) {
+    size_t s = spans.back().first, e = spans.back().second;
+    spans.pop_back();
+
+    // find the point furthest from the line
+    typename coord_t::value_type dmax = std::numeric_limits<typename coord_t::value_type>::lowest();
+    size_t k = s;
+    LineSegment2<coord_t> l{polyline[s], polyline[e]};
+    for (size_t j = e - 1; j > s; --j) {
+      // special points we dont want to generalize no matter what take precidence
+      if (indices.find(j) != indices.end()) {
+        dmax = epsilon;
+        k = j;
+        break;
+      }
+
+      // if this is the highest frequency detail so far
+      auto d = l.DistanceSquared(polyline[j], tmp);
+      if (d > dmax) {
+        dmax = d;
+        k = j;
+      }
+    }
+
+    // there are some high frequency details between start and end so we keep the furthest one
+    // and look for flatter sections on either side of it, otherwise everything between goes
+    if (dmax >= epsilon) {
+      keep[k] = true;
+      if (e - k > 1)
+        spans.emplace_back(k, e);
+      if (k - s > 1)
+        spans.emplace_back(s, k);
+    }
+  }
+
+  // slide the kept points down over the ones we dropped
+  size_t kept = 0;
+  for (size_t i = 0; i < polyline.size(); ++i) {
+    if (keep[i]) {
+      if (kept != i)
+        polyline[kept] = polyline[i];
+      ++kept;
+    }
+  }
+  polyline.resize(kept);
+}
+
+} // namespace
+
+/**
+ * Generalize the given list of points
+ *
+ * @param polyline    the list of points
+ * @param epsilon     the tolerance used in removing points
+ * @param  indices    list of indices of points not to generalize
+ */
+template <typename coord_t>
+template <class container_t>
+void Polyline2<coord_t>::Generalize(container_t& polyline,
+                                    typename coord_t::value_type epsilon,
+                                    const std::unordered_set<size_t>& indices) {
+  // any epsilon this low will have no effect on the input nor will any super short input
+  if (epsilon <= 0 || polyline.size() < 3)
+    return;
+
+  // the distances are compared squared
+  peucker(polyline, epsilon * epsilon, indices);
 }
 
 // Explicit instantiation
@@ -245,17 +245,20 @@ std::ostream& operator<<(std::ostream& stream, const memory_status& s) {
  *   http://www.movable-type.co.uk/scripts/latlong.html
  */
 template <class container_t>
-container_t
-resample_spherical_polyline(const container_t& polyline, double resolution, bool preserve) {
+void resample_spherical_polyline(
+    const container_t& polyline,
+    double resolution,
+    bool preserve,
+    const std::function<void(const typename container_t::value_type&)>& visit) {
   if (polyline.size() == 0) {
-    return {};
+    return;
   };
 
   // for each point
-  container_t resampled = {polyline.front()};
+  visit(polyline.front());
   resolution *= RAD_PER_METER;
   double remaining = resolution;
-  auto last = resampled.back();
+  auto last = polyline.front();
   for (auto p = std::next(polyline.cbegin()); p != polyline.cend(); ++p) {
     // radians
     auto lon2 = p->first * -RAD_PER_DEG;
@@ -289,7 +292,7 @@ resample_spherical_polyline(const container_t& polyline, double resolution, bool
       auto z = a * sin(lat1) + b * sin(lat2);
       last.first = atan2(y, x) * -DEG_PER_RAD;
       last.second = atan2(z, sqrt(x * x + y * y)) * DEG_PER_RAD;
-      resampled.push_back(last);
+      visit(last);
       // we just consumed a bit
       d -= remaining;
       // we need another bit
@@ -299,17 +302,33 @@ resample_spherical_polyline(const container_t& polyline, double resolution, bool
     remaining -= d;
     last = *p;
     if (preserve) {
-      resampled.push_back(last);
+      visit(last);
     }
   }
 
   // TODO: do we want to let them know remaining?
+}
 
-  // hand it back
+template <class container_t>
+container_t
+resample_spherical_polyline(const container_t& polyline, double resolution, bool preserve) {
+  container_t resampled;
+  resample_spherical_polyline(polyline, resolution, preserve,
+                              [&resampled](const typename container_t::value_type& point) {
+                                resampled.push_back(point);
+                              });
   return resampled;
 }
 
 // explicit instantiations
+template void resample_spherical_polyline<std::vector<PointLL>>(
+    const std::vector<PointLL>&, double, bool, const std::function<void(const PointLL&)>&);
+template void resample_spherical_polyline<std::vector<Point2>>(
+    const std::vector<Point2>&, double, bool, const std::function<void(const Point2&)>&);
+template void resample_spherical_polyline<std::list<PointLL>>(
+    const std::list<PointLL>&, double, bool, const std::function<void(const PointLL&)>&);
+template void resample_spherical_polyline<std::list<Point2>>(
+    const std::list<Point2>&, double, bool, const std::function<void(const Point2&)>&);
 template std::vector<PointLL>
 resample_spherical_polyline<std::vector<PointLL>>(const std::vector<PointLL>&, double, bool);
 template std::vector<Point2>
@@ -2,9 +2,11 @@
 #include "baldr/datetime.h"
 #include "filesystem.h"
 #include "midgard/logging.h"
+#include "mjolnir/polygonstore.h"
 #include "mjolnir/util.h"
 #include <spatialite.h>
 #include <sqlite3.h>
+#include <algorithm>
 #include <unordered_map>
 
 namespace valhalla {
@@ -69,6 +71,158 @@ uint32_t GetMultiPolyId(const std::unordered_multimap<uint32_t, multi_polygon_ty
   return index;
 }
 
+constexpr uint32_t PolygonGrid::kDefaultDivisions;
+constexpr uint32_t PolygonGrid::kOutside;
+
+PolygonGrid::PolygonGrid(const std::unordered_multimap<uint32_t, multi_polygon_type>& polys,
+                         const AABB2<PointLL>& bounds,
+                         const uint32_t divisions)
+    : bounds_(bounds), divisions_(std::max(divisions, 1u)),
+      cell_width_(bounds.Width() / divisions_), cell_height_(bounds.Height() / divisions_) {
+  const size_t cell_count = divisions_ * divisions_;
+  // segments within this much of a cell count as in it so that rounding cant hide a boundary
+  const double margin_x = cell_width_ * 1e-6, margin_y = cell_height_ * 1e-6;
+
+  // what each polygon is in each cell: 0 outside of it, 1 inside of it, 2 crossed by its boundary
+  std::vector<std::vector<uint8_t>> cover;
+  std::vector<std::vector<double>> crossings(divisions_);
+  std::vector<uint32_t> crossings_left(divisions_);
+  for (const auto& poly : polys) {
+    polys_.emplace_back(poly.first, &poly.second);
+    cover.emplace_back(cell_count, 0);
+    auto& cells = cover.back();
+    for (auto& row : crossings) {
+      row.clear();
+    }
+    std::fill(crossings_left.begin(), crossings_left.end(), 0);
+
+    auto add_segment = [&](const point_type& a, const point_type& b) {
+      const double miny = std::min(a.y(), b.y()), maxy = std::max(a.y(), b.y());
+      if (maxy < bounds_.miny() - margin_y || miny > bounds_.maxy() + margin_y) {
+        return;
+      }
+      const int last_row = static_cast<int>(divisions_) - 1;
+      const int r0 = std::max(static_cast<int>((miny - margin_y - bounds_.miny()) / cell_height_), 0);
+      const int r1 =
+          std::min(static_cast<int>((maxy + margin_y - bounds_.miny()) / cell_height_), last_row);
+      for (int r = r0; r <= r1; ++r) {
+        // the crossings of the line through the centers of the row for the even odd rule
+        const double center = bounds_.miny() + (r + 0.5) * cell_height_;
+        if ((a.y() > center) != (b.y() > center)) {
+          const double x = a.x() + (center - a.y()) * (b.x() - a.x()) / (b.y() - a.y());
+          if (x < bounds_.minx()) {
+            ++crossings_left[r];
+          } else if (x <= bounds_.maxx()) {
+            crossings[r].push_back(x);
+          }
+        }
+
+        // the part of the segment within the row marks the cells it goes through
+        double x0 = a.x(), x1 = b.x();
+        if (a.y() != b.y()) {
+          const double y0 = bounds_.miny() + r * cell_height_ - margin_y;
+          const double y1 = y0 + cell_height_ + 2 * margin_y;
+          const double t0 = std::min(std::max((y0 - a.y()) / (b.y() - a.y()), 0.), 1.);
+          const double t1 = std::min(std::max((y1 - a.y()) / (b.y() - a.y()), 0.), 1.);
+          x0 = a.x() + t0 * (b.x() - a.x());
+          x1 = a.x() + t1 * (b.x() - a.x());
+        }
+        const double minx = std::min(x0, x1) - margin_x, maxx = std::max(x0, x1) + margin_x;
+        if (maxx < bounds_.minx() || minx > bounds_.maxx()) {
+          continue;
+        }
+        const int c0 = std::max(static_cast<int>((minx - bounds_.minx()) / cell_width_), 0);
+        const int c1 = std::min(static_cast<int>((maxx - bounds_.minx()) / cell_width_), last_row);
+        for (int c = c0; c <= c1; ++c) {
+          cells[r * divisions_ + c] = 2;
+        }
+      }
+    };
+    auto add_ring = [&add_segment](const polygon_type::ring_type& ring) {
+      for (size_t i = 0; i < ring.size(); ++i) {
+        add_segment(ring[i], ring[(i + 1) % ring.size()]);
+      }
+    };
+    for (const auto& polygon : poly.second) {
+      add_ring(polygon.outer());
+      for (const auto& inner : polygon.inners()) {
+        add_ring(inner);
+      }
+    }
+
+    // the cells no boundary goes through are inside if the center of the cell is
+    for (uint32_t r = 0; r < divisions_; ++r) {
+      auto& row = crossings[r];
+      std::sort(row.begin(), row.end());
+      auto crossing = row.cbegin();
+      uint32_t count = crossings_left[r];
+      for (uint32_t c = 0; c < divisions_; ++c) {
+        const double center = bounds_.minx() + (c + 0.5) * cell_width_;
+        for (; crossing != row.cend() && *crossing < center; ++crossing) {
+          ++count;
+        }
+        auto& cell = cells[r * divisions_ + c];
+        if (cell == 0 && count % 2 == 1) {
+          cell = 1;
+        }
+      }
+    }
+  }
+
+  // keep the polygons of each cell which arent outside of it in the order of the polygons
+  offsets_.reserve(cell_count + 1);
+  for (size_t cell = 0; cell < cell_count; ++cell) {
+    offsets_.push_back(entries_.size());
+    for (uint32_t i = 0; i < cover.size(); ++i) {
+      if (cover[i][cell] != 0) {
+        entries_.push_back({i, cover[i][cell] == 2});
+      }
+    }
+  }
+  offsets_.push_back(entries_.size());
+}
+
+uint32_t PolygonGrid::cell_of(const PointLL& ll) const {
+  if (polys_.empty() || !bounds_.Contains(ll) || cell_width_ <= 0 || cell_height_ <= 0) {
+    return kOutside;
+  }
+  // the max edges of the bounds are in the last row and column
+  const auto c = std::min(static_cast<uint32_t>((ll.lng() - bounds_.minx()) / cell_width_),
+                          divisions_ - 1);
+  const auto r = std::min(static_cast<uint32_t>((ll.lat() - bounds_.miny()) / cell_height_),
+                          divisions_ - 1);
+  return r * divisions_ + c;
+}
+
+size_t PolygonGrid::partial_cells() const {
+  size_t count = 0;
+  for (size_t cell = 0; cell + 1 < offsets_.size(); ++cell) {
+    count += std::any_of(entries_.begin() + offsets_[cell], entries_.begin() + offsets_[cell + 1],
+                         [](const entry_t& entry) { return entry.partial; });
+  }
+  return count;
+}
+
+// Get the polygon index with the grid. Same as above for the polygons which cover the point.
+uint32_t GetMultiPolyId(const PolygonGrid& grid, const PointLL& ll, GraphTileBuilder& graphtile) {
+  uint32_t index = 0;
+  grid.covering(ll, [&index, &graphtile](const uint32_t poly) {
+    index = poly;
+    return !graphtile.admins_builder(poly).state_offset();
+  });
+  return index;
+}
+
+// Get the polygon index with the grid. Same as above for the polygons which cover the point.
+uint32_t GetMultiPolyId(const PolygonGrid& grid, const PointLL& ll) {
+  uint32_t index = 0;
+  grid.covering(ll, [&index](const uint32_t poly) {
+    index = poly;
+    return false;
+  });
+  return index;
+}
+
 // Get the timezone polys from the db
 std::unordered_multimap<uint32_t, multi_polygon_type> GetTimeZones(sqlite3* db_handle,
                                                                    const AABB2<PointLL>& aabb) {
@@ -246,6 +400,145 @@ GetAdminInfo(sqlite3* db_handle,
   return polys;
 }
 
+namespace {
+
+// The packed polygons whose geometry intersects the box, in the order of the store
+std::vector<uint32_t> Intersecting(const PolygonStore& store, const AABB2<PointLL>& aabb) {
+  const boost::geometry::model::box<point_type> box(point_type(aabb.minx(), aabb.miny()),
+                                                    point_type(aabb.maxx(), aabb.maxy()));
+  std::vector<uint32_t> found;
+  for (auto index : store.find(aabb)) {
+    if (boost::geometry::intersects(box, store.geometry(index))) {
+      found.push_back(index);
+    }
+  }
+  return found;
+}
+
+std::string column_text(sqlite3_stmt* stmt, const int column) {
+  return sqlite3_column_type(stmt, column) == SQLITE_TEXT
+             ? reinterpret_cast<const char*>(sqlite3_column_text(stmt, column))
+             : "";
+}
+
+} // namespace
+
+// Get the admin polys that intersect with the tile bounding box from the packed polygons. The
+// states come first and then the countries like the queries of the db
+std::unordered_multimap<uint32_t, multi_polygon_type>
+GetAdminInfo(const PolygonStore& store,
+             std::unordered_map<uint32_t, bool>& drive_on_right,
+             std::unordered_map<uint32_t, bool>& allow_intersection_names,
+             const AABB2<PointLL>& aabb,
+             GraphTileBuilder& tilebuilder) {
+  std::unordered_multimap<uint32_t, multi_polygon_type> polys;
+  const auto found = Intersecting(store, aabb);
+  for (const uint8_t level : {4, 2}) {
+    for (auto i : found) {
+      const auto& polygon = store.polygon(i);
+      if (polygon.admin_level != level || (level == 4 && polygon.parent == PolygonStore::kNone)) {
+        continue;
+      }
+      uint32_t index;
+      if (level == 4) {
+        const auto& country = store.polygon(polygon.parent);
+        index = tilebuilder.AddAdmin(store.string(country.name), store.string(polygon.name),
+                                     store.string(country.iso_code),
+                                     store.string(polygon.iso_code));
+      } else {
+        index = tilebuilder.AddAdmin(store.string(polygon.name), "",
+                                     store.string(polygon.iso_code), "");
+      }
+      polys.emplace(index, store.geometry(i));
+      drive_on_right.emplace(index, polygon.drive_on_right);
+      allow_intersection_names.emplace(index, polygon.allow_intersection_names);
+    }
+  }
+  return polys;
+}
+
+// Get the timezone polys from the packed polygons
+std::unordered_multimap<uint32_t, multi_polygon_type> GetTimeZones(const PolygonStore& store,
+                                                                   const AABB2<PointLL>& aabb) {
+  std::unordered_multimap<uint32_t, multi_polygon_type> polys;
+  for (auto i : Intersecting(store, aabb)) {
+    uint32_t idx = DateTime::get_tz_db().to_index(store.string(store.polygon(i).name));
+    if (idx != 0) {
+      polys.emplace(idx, store.geometry(i));
+    }
+  }
+  return polys;
+}
+
+// Pack the admins of the db, their parents are the rowids of their countries until they are written
+size_t PackAdmins(sqlite3* db_handle, const std::string& file_name) {
+  std::string sql = "SELECT rowid, admin_level, parent_admin, name, iso_code, drive_on_right, ";
+  sql += "allow_intersection_names, st_astext(geom) from admins order by rowid";
+  sqlite3_stmt* stmt = 0;
+  if (sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, 0) != SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    throw std::runtime_error("Could not read the admins: " + std::string(sqlite3_errmsg(db_handle)));
+  }
+  PolygonStore::Writer writer;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    PolygonStore::polygon_t attributes{};
+    attributes.admin_level = sqlite3_column_int(stmt, 1);
+    attributes.parent = sqlite3_column_type(stmt, 2) == SQLITE_INTEGER ? sqlite3_column_int(stmt, 2)
+                                                                       : PolygonStore::kNone;
+    attributes.drive_on_right =
+        sqlite3_column_type(stmt, 5) == SQLITE_INTEGER ? sqlite3_column_int(stmt, 5) != 0 : true;
+    attributes.allow_intersection_names =
+        sqlite3_column_type(stmt, 6) == SQLITE_INTEGER ? sqlite3_column_int(stmt, 6) != 0 : false;
+    multi_polygon_type multi_poly;
+    boost::geometry::read_wkt(column_text(stmt, 7), multi_poly);
+    writer.Add(multi_poly, column_text(stmt, 3), column_text(stmt, 4), attributes,
+               sqlite3_column_int64(stmt, 0));
+  }
+  sqlite3_finalize(stmt);
+  return writer.Write(file_name);
+}
+
+// Pack the time zones of the db
+size_t PackTimeZones(sqlite3* db_handle, const std::string& file_name) {
+  std::string sql = "SELECT TZID, st_astext(geom) from tz_world order by rowid";
+  sqlite3_stmt* stmt = 0;
+  if (sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, 0) != SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    throw std::runtime_error("Could not read the time zones: " +
+                             std::string(sqlite3_errmsg(db_handle)));
+  }
+  PolygonStore::Writer writer;
+  uint64_t id = 0;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    PolygonStore::polygon_t attributes{};
+    attributes.parent = PolygonStore::kNone;
+    multi_polygon_type multi_poly;
+    boost::geometry::read_wkt(column_text(stmt, 1), multi_poly);
+    writer.Add(multi_poly, column_text(stmt, 0), "", attributes, id++);
+  }
+  sqlite3_finalize(stmt);
+  return writer.Write(file_name);
+}
+
+// The packed polygons are next to the db
+std::string PackedPolygonsFile(const std::string& database) {
+  return database + ".bin";
+}
+
+// Open the packed polygons of a db, if there are any
+std::shared_ptr<const PolygonStore> GetPackedPolygons(const std::string& database) {
+  const auto file_name = PackedPolygonsFile(database);
+  if (database.empty() || !filesystem::exists(file_name)) {
+    return nullptr;
+  }
+  try {
+    return std::make_shared<const PolygonStore>(file_name);
+  } catch (const std::exception& e) {
+    LOG_WARN(std::string(e.what()) + ", using " + database + " instead");
+  }
+  return nullptr;
+}
+
 // Get all the country access records from the db and save them to a map.
 std::unordered_map<std::string, std::vector<int>> GetCountryAccess(sqlite3* db_handle) {
 
@@ -0,0 +1,304 @@
+#include "mjolnir/altlandmarkbuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/altlandmarks.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+constexpr float kUnreachable = AltLandmarks::kUnreachable;
+constexpr uint32_t kInvalidNode = std::numeric_limits<uint32_t>::max();
+
+// How many nodes are tried to start the landmark selection from
+constexpr uint32_t kStartCandidates = 4;
+
+struct arc_t {
+  uint32_t node;
+  float length;
+};
+
+// The nodes of the graph, numbered tile by tile, with the edges the access allows and the
+// transitions between the levels as arcs
+struct node_graph_t {
+  std::vector<GraphId> tiles;
+  std::vector<uint64_t> offsets;
+  std::vector<uint64_t> arc_offsets;
+  std::vector<arc_t> arcs;
+
+  uint32_t size() const {
+    return static_cast<uint32_t>(offsets.back());
+  }
+};
+
+node_graph_t make_node_graph(GraphReader& reader, const uint32_t access_mask) {
+  node_graph_t graph;
+  graph.offsets.push_back(0);
+  std::unordered_map<uint64_t, uint32_t> tile_index;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& level : TileHierarchy::levels()) {
+    if (level.level == transit_level) {
+      continue;
+    }
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      graph.tiles.push_back(tile_id);
+    }
+  }
+  std::sort(graph.tiles.begin(), graph.tiles.end());
+  for (const auto& tile_id : graph.tiles) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    tile_index.emplace(tile_id.value, static_cast<uint32_t>(graph.offsets.size() - 1));
+    graph.offsets.push_back(graph.offsets.back() + (tile ? tile->header()->nodecount() : 0));
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  if (graph.offsets.back() >= kInvalidNode) {
+    throw std::runtime_error("Too many nodes to compute landmarks for");
+  }
+
+  auto index = [&](const GraphId& node) {
+    auto found = tile_index.find(node.Tile_Base().value);
+    return found == tile_index.end() ? kInvalidNode
+                                     : static_cast<uint32_t>(graph.offsets[found->second] +
+                                                             node.id());
+  };
+
+  graph.arc_offsets.reserve(graph.size() + 1);
+  graph.arc_offsets.push_back(0);
+  for (const auto& tile_id : graph.tiles) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    const uint32_t node_count = tile ? tile->header()->nodecount() : 0;
+    for (uint32_t i = 0; i < node_count; ++i) {
+      const NodeInfo* node_info = tile->node(i);
+      for (uint32_t j = 0; j < node_info->edge_count(); ++j) {
+        const DirectedEdge* edge = tile->directededge(node_info->edge_index() + j);
+        uint32_t end = index(edge->endnode());
+        if ((edge->forwardaccess() & access_mask) && end != kInvalidNode) {
+          graph.arcs.push_back({end, static_cast<float>(edge->length())});
+        }
+      }
+      const NodeTransition* trans = tile->transition(node_info->transition_index());
+      for (uint32_t j = 0; j < node_info->transition_count(); ++j, ++trans) {
+        uint32_t end = index(trans->endnode());
+        if (end != kInvalidNode) {
+          graph.arcs.push_back({end, 0.f});
+        }
+      }
+      graph.arc_offsets.push_back(graph.arcs.size());
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  LOG_INFO("Found " + std::to_string(graph.size()) + " nodes and " +
+           std::to_string(graph.arcs.size()) + " arcs");
+  return graph;
+}
+
+// The same graph with every arc turned around
+node_graph_t reverse(const node_graph_t& graph) {
+  node_graph_t reversed;
+  reversed.offsets = graph.offsets;
+  reversed.arc_offsets.assign(graph.size() + 1, 0);
+  for (const auto& arc : graph.arcs) {
+    ++reversed.arc_offsets[arc.node + 1];
+  }
+  for (uint32_t node = 0; node < graph.size(); ++node) {
+    reversed.arc_offsets[node + 1] += reversed.arc_offsets[node];
+  }
+  auto next = reversed.arc_offsets;
+  reversed.arcs.resize(graph.arcs.size());
+  for (uint32_t node = 0; node < graph.size(); ++node) {
+    for (uint64_t a = graph.arc_offsets[node]; a < graph.arc_offsets[node + 1]; ++a) {
+      reversed.arcs[next[graph.arcs[a].node]++] = {node, graph.arcs[a].length};
+    }
+  }
+  return reversed;
+}
+
+// The distances from the source to every node
+std::vector<float> dijkstra(const node_graph_t& graph, const uint32_t source) {
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+  std::vector<float> distances(graph.size(), kUnreachable);
+  distances[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto current = queue.top();
+    queue.pop();
+    if (current.first > distances[current.second]) {
+      continue;
+    }
+    for (uint64_t a = graph.arc_offsets[current.second];
+         a < graph.arc_offsets[current.second + 1]; ++a) {
+      const auto& arc = graph.arcs[a];
+      float distance = current.first + arc.length;
+      if (distance < distances[arc.node]) {
+        distances[arc.node] = distance;
+        queue.emplace(distance, arc.node);
+      }
+    }
+  }
+  return distances;
+}
+
+GraphId node_id(const node_graph_t& graph, const uint32_t node) {
+  auto tile = std::upper_bound(graph.offsets.begin(), graph.offsets.end(), node) -
+              graph.offsets.begin() - 1;
+  return GraphId(graph.tiles[tile].tileid(), graph.tiles[tile].level(),
+                 node - graph.offsets[tile]);
+}
+
+void Build(const boost::property_tree::ptree& pt, const std::string& costing_name) {
+  valhalla::Costing costing_type;
+  if (!valhalla::Costing_Enum_Parse(costing_name, &costing_type)) {
+    throw std::runtime_error("Unknown costing for landmarks: " + costing_name);
+  }
+
+  // only the access of the costing matters, which the options cant widen short of ignoring it
+  valhalla::Options options;
+  rapidjson::Document doc;
+  doc.SetObject();
+  ParseCostingOptions(doc, "/costing_options", options);
+  auto costing = CostFactory().Create(options.costing_options(static_cast<int>(costing_type)));
+
+  LOG_INFO("Computing the " + costing_name + " landmarks");
+  GraphReader reader(pt.get_child("mjolnir"));
+  const auto graph = make_node_graph(reader, costing->access_mode());
+  const uint32_t count =
+      std::min(pt.get<uint32_t>("mjolnir.alt_landmark_count", 16), graph.size());
+  if (count == 0) {
+    LOG_WARN("No nodes to compute " + costing_name + " landmarks for");
+    return;
+  }
+
+  // Start from the far end of the biggest part of the graph a few nodes reach
+  std::vector<float> closest;
+  size_t most_reached = 0;
+  for (uint32_t i = 0; i < kStartCandidates; ++i) {
+    auto distances = dijkstra(graph, static_cast<uint32_t>(uint64_t(graph.size()) * i /
+                                                           kStartCandidates));
+    size_t reached = std::count_if(distances.begin(), distances.end(),
+                                   [](float distance) { return distance != kUnreachable; });
+    if (reached > most_reached) {
+      most_reached = reached;
+      closest = std::move(distances);
+    }
+  }
+  if (closest.empty()) {
+    closest.assign(graph.size(), kUnreachable);
+    closest[0] = 0.f;
+  }
+
+  // Then each landmark is the node farthest from the ones before, its search gives the distances
+  // from it. Nodes they all cant reach are other islands which arent worth a landmark.
+  std::vector<float> distances(uint64_t(graph.size()) * 2 * count, kUnreachable);
+  std::vector<uint32_t> landmarks;
+  for (uint32_t l = 0; l < count; ++l) {
+    uint32_t farthest = kInvalidNode;
+    for (uint32_t node = 0; node < graph.size(); ++node) {
+      if (closest[node] != kUnreachable &&
+          (farthest == kInvalidNode || closest[node] > closest[farthest])) {
+        farthest = node;
+      }
+    }
+    if (farthest == kInvalidNode || (l > 0 && closest[farthest] == 0.f)) {
+      break;
+    }
+    landmarks.push_back(farthest);
+    auto from = dijkstra(graph, farthest);
+    for (uint32_t node = 0; node < graph.size(); ++node) {
+      distances[uint64_t(node) * 2 * count + l] = from[node];
+      closest[node] = l == 0 ? from[node] : std::min(closest[node], from[node]);
+    }
+  }
+
+  // The distances to them searching the reversed graph, one landmark per thread at a time
+  const auto reversed = reverse(graph);
+  std::atomic<uint32_t> next_landmark(0);
+  auto to_landmarks = [&]() {
+    for (uint32_t l = next_landmark++; l < landmarks.size(); l = next_landmark++) {
+      auto to = dijkstra(reversed, landmarks[l]);
+      for (uint32_t node = 0; node < graph.size(); ++node) {
+        distances[uint64_t(node) * 2 * count + count + l] = to[node];
+      }
+    }
+  };
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
+  for (auto& thread : threads) {
+    thread.reset(new std::thread(to_landmarks));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  // Fewer landmarks than asked for when the graph ran out of far away nodes
+  if (landmarks.size() < count) {
+    std::vector<float> fewer(uint64_t(graph.size()) * 2 * landmarks.size());
+    for (uint64_t node = 0; node < graph.size(); ++node) {
+      for (uint32_t l = 0; l < landmarks.size(); ++l) {
+        fewer[node * 2 * landmarks.size() + l] = distances[node * 2 * count + l];
+        fewer[node * 2 * landmarks.size() + landmarks.size() + l] =
+            distances[node * 2 * count + count + l];
+      }
+    }
+    distances = std::move(fewer);
+  }
+
+  std::vector<GraphId> landmark_ids;
+  for (auto landmark : landmarks) {
+    landmark_ids.push_back(node_id(graph, landmark));
+  }
+  auto file_name = AltLandmarks::FileName(pt.get<std::string>("mjolnir.tile_dir"), costing_name);
+  AltLandmarks::Write(file_name, costing_name, landmark_ids, graph.tiles, graph.offsets, distances);
+  LOG_INFO("Wrote " + file_name + " with " + std::to_string(landmarks.size()) + " landmarks");
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void AltLandmarkBuilder::Build(const boost::property_tree::ptree& pt) {
+  auto costings = pt.get<std::string>("mjolnir.alt_landmarks", "");
+  std::vector<std::string> names;
+  boost::algorithm::split(names, costings, boost::algorithm::is_any_of(","));
+  for (const auto& name : names) {
+    if (!name.empty()) {
+      ::Build(pt, name);
+    }
+  }
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -5,6 +5,7 @@
 #include "mjolnir/graphtilebuilder.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <list>
 #include <mutex>
@@ -19,6 +20,7 @@
 #include "baldr/tilehierarchy.h"
 #include "midgard/logging.h"
 #include "midgard/sequence.h"
+#include "midgard/tiles.h"
 #include "midgard/util.h"
 #include "mjolnir/osmnode.h"
 
@@ -72,7 +74,7 @@ struct BSSConnection {
       : bss_ll(std::move(bss_ll)), way_node_id(way_node_id) {
     /*
      * In this constructor: bss_node_id, shapes are left on default value on purpose
-     * 	they are to be updated once the bss node is added into the local tile
+     * 	they are to be updated once the bss node is projected into the local tile
      * */
     wayid = edgeinfo.wayid();
     names = edgeinfo.GetNames();
@@ -158,6 +160,21 @@ void compute_and_fill_shape(const BestProjection& best,
   std::copy(best.shape.begin() + cloest_index + 1, best.shape.end(), std::back_inserter(end.shape));
 }
 
+// The size in degrees of the cells of the grid the edges of a tile are binned into, so that each
+// station is only projected onto the few edges around it instead of all of the edges of its tile
+constexpr float kCellSize = 0.005f;
+
+// An edge the stations of a tile can be projected onto. Its shape is decoded only once for all of
+// them and kept both as points and as the separate longitudes and latitudes the batch projection
+// takes
+struct Candidate {
+  const DirectedEdge* directededge;
+  uint32_t startnode;
+  std::vector<PointLL> shape;
+  std::vector<double> lngs;
+  std::vector<double> lats;
+};
+
 std::vector<BSSConnection> project(const GraphTile& local_tile, const std::vector<OSMNode>& osm_bss) {
   auto t1 = std::chrono::high_resolution_clock::now();
   auto scoped_finally = make_finally([&t1, size = osm_bss.size()]() {
@@ -170,71 +187,138 @@ std::vector<BSSConnection> project(const GraphTile& local_tile, const std::vecto
   std::vector<BSSConnection> res;
   auto local_level = TileHierarchy::levels().back().level;
 
-  std::map<GraphId, size_t> edge_count;
+  // Gather the edges the stations can be projected onto, the grid covers the tile and whatever
+  // parts of their shapes stick out of it
+  std::vector<Candidate> candidates;
+  std::vector<AABB2<PointLL>> boxes;
+  auto bounds = TileHierarchy::levels().back().tiles.TileBounds(local_tile.id().tileid());
+  for (uint32_t i = 0; i < local_tile.header()->nodecount(); ++i) {
+    const NodeInfo* node = local_tile.node(i);
+    for (uint32_t j = 0; j < node->edge_count(); ++j) {
+      const DirectedEdge* directededge = local_tile.directededge(node->edge_index() + j);
+
+      if (directededge->use() == Use::kTransitConnection ||
+          directededge->use() == Use::kEgressConnection ||
+          directededge->use() == Use::kPlatformConnection) {
+        continue;
+      }
+      if ((!(directededge->forwardaccess() & kBicycleAccess) &&
+           !(directededge->forwardaccess() & kPedestrianAccess)) ||
+          directededge->is_shortcut()) {
+        continue;
+      }
 
-  // In this loop, we try to find the way on which to project the bss node by iterating all nodes in
-  // its corresponding tile... Not a good idea in term of performance... any better idea???
-  for (const auto& bss : osm_bss) {
+      Candidate candidate{directededge, i,
+                          local_tile.edgeinfo(directededge->edgeinfo_offset()).shape(), {}, {}};
+      if (candidate.shape.size() < 2) {
+        continue;
+      }
+      if (!directededge->forward()) {
+        std::reverse(candidate.shape.begin(), candidate.shape.end());
+      }
+      candidate.lngs.reserve(candidate.shape.size());
+      candidate.lats.reserve(candidate.shape.size());
+      for (const auto& point : candidate.shape) {
+        candidate.lngs.push_back(point.lng());
+        candidate.lats.push_back(point.lat());
+      }
+      boxes.emplace_back(candidate.shape);
+      bounds.Expand(boxes.back());
+      candidates.push_back(std::move(candidate));
+    }
+  }
 
+  Tiles<PointLL> grid(bounds.minpt(), kCellSize,
+                      static_cast<int32_t>(std::ceil(bounds.Width() / kCellSize)) + 1,
+                      static_cast<int32_t>(std::ceil(bounds.Height() / kCellSize)) + 1);
+  std::vector<std::vector<uint32_t>> cells(grid.TileCount());
+  for (uint32_t c = 0; c < candidates.size(); ++c) {
+    for (const auto& cell : grid.Intersect(boxes[c])) {
+      cells[cell.first].push_back(c);
+    }
+  }
+
+  // The index of the last station projected onto each edge, edges binned into more than one cell
+  // are only projected onto once per station
+  std::vector<uint32_t> projected(candidates.size(), std::numeric_limits<uint32_t>::max());
+  std::vector<double> sq_distances;
+  uint32_t bss_count = 0;
+  for (uint32_t s = 0; s < osm_bss.size(); ++s) {
+    const auto& bss = osm_bss[s];
     auto latlng = bss.latlng();
     auto bss_ll = PointLL{latlng.first, latlng.second};
+    projector_t projector(bss_ll);
 
     float mindist_ped = std::numeric_limits<float>::max();
     float mindist_bicycle = std::numeric_limits<float>::max();
 
-    auto best_ped = BestProjection{};
-    auto best_bicycle = BestProjection{};
-
-    // Loop over all nodes in the tile to find the nearest edge
-    for (uint32_t i = 0; i < local_tile.header()->nodecount(); ++i) {
-      const NodeInfo* node = local_tile.node(i);
-      for (uint32_t j = 0; j < node->edge_count(); ++j) {
-        const DirectedEdge* directededge = local_tile.directededge(node->edge_index() + j);
-        auto edgeinfo = local_tile.edgeinfo(directededge->edgeinfo_offset());
+    const Candidate* candidate_ped = nullptr;
+    const Candidate* candidate_bicycle = nullptr;
+    std::tuple<PointLL, float, int> closest_ped, closest_bicycle;
+
+    // Visit the cells closest first until none of them can have an edge closer than the ones found
+    // for both modes
+    auto closest_first = grid.ClosestFirst(bss_ll);
+    for (size_t visited = 0; visited < cells.size(); ++visited) {
+      int32_t cell;
+      unsigned short subdivision;
+      double cell_distance;
+      std::tie(cell, subdivision, cell_distance) = closest_first();
+      if (cell_distance > std::max(mindist_ped, mindist_bicycle)) {
+        break;
+      }
+      if (cell < 0 || static_cast<size_t>(cell) >= cells.size()) {
+        continue;
+      }
 
-        if (directededge->use() == Use::kTransitConnection ||
-            directededge->use() == Use::kEgressConnection ||
-            directededge->use() == Use::kPlatformConnection) {
-          continue;
-        }
-        if ((!(directededge->forwardaccess() & kBicycleAccess) &&
-             !(directededge->forwardaccess() & kPedestrianAccess)) ||
-            directededge->is_shortcut()) {
+      for (auto c : cells[cell]) {
+        if (projected[c] == s) {
           continue;
         }
-
-        std::vector<PointLL> this_shape = edgeinfo.shape();
-        if (!directededge->forward()) {
-          std::reverse(this_shape.begin(), this_shape.end());
-        }
-        auto this_closest = bss_ll.Project(this_shape);
-
-        if (directededge->forwardaccess() & kPedestrianAccess) {
+        projected[c] = s;
+
+        // Project onto all of the segments at once and then only onto the closest one
+        const auto& candidate = candidates[c];
+        const size_t segments = candidate.lngs.size() - 1;
+        sq_distances.resize(segments);
+        projector.SquaredDistances(candidate.lngs.data(), candidate.lats.data(), segments,
+                                   sq_distances.data());
+        auto index = std::min_element(sq_distances.begin(), sq_distances.end()) -
+                     sq_distances.begin();
+        auto point = projector(candidate.shape[index], candidate.shape[index + 1]);
+        auto this_closest = std::make_tuple(point, bss_ll.Distance(point), static_cast<int>(index));
+
+        if (candidate.directededge->forwardaccess() & kPedestrianAccess) {
           if (std::get<1>(this_closest) < mindist_ped) {
             mindist_ped = std::get<1>(this_closest);
-            best_ped.directededge = directededge;
-            best_ped.shape = this_shape;
-            best_ped.closest = this_closest;
-            best_ped.startnode = i;
+            candidate_ped = &candidate;
+            closest_ped = this_closest;
           }
         }
-        if (directededge->forwardaccess() & kBicycleAccess) {
+        if (candidate.directededge->forwardaccess() & kBicycleAccess) {
           if (std::get<1>(this_closest) < mindist_bicycle) {
             mindist_bicycle = std::get<1>(this_closest);
-            best_bicycle.directededge = directededge;
-            best_bicycle.shape = this_shape;
-            best_bicycle.closest = this_closest;
-            best_bicycle.startnode = i;
+            candidate_bicycle = &candidate;
+            closest_bicycle = this_closest;
           }
         }
       }
     }
-    if (best_ped.startnode == static_cast<uint32_t>(-1) ||
-        best_bicycle.startnode == static_cast<uint32_t>(-1)) {
+    if (!candidate_ped || !candidate_bicycle) {
       LOG_ERROR("Cannot find any edge to project the BSS: " + std::to_string(bss.osmid_));
       continue;
     }
 
+    auto best_ped = BestProjection{candidate_ped->directededge, candidate_ped->startnode,
+                                   candidate_ped->shape, closest_ped};
+    auto best_bicycle =
+        BestProjection{candidate_bicycle->directededge, candidate_bicycle->startnode,
+                       candidate_bicycle->shape, closest_bicycle};
+
+    // The station is added after the existing nodes of its tile in the order they are projected
+    GraphId bss_node_id{local_tile.id().tileid(), local_level,
+                        local_tile.header()->nodecount() + bss_count++};
+
     auto edgeinfo_ped = local_tile.edgeinfo(best_ped.directededge->edgeinfo_offset());
     // Store the information of the edge start <-> bss for pedestrian
     auto start_ped = BSSConnection{bss_ll,
@@ -266,6 +350,10 @@ std::vector<BSSConnection> project(const GraphTile& local_tile, const std::vecto
     compute_and_fill_shape(best_ped, bss_ll, start_ped, end_ped);
     compute_and_fill_shape(best_bicycle, bss_ll, start_bicycle, end_bicycle);
 
+    for (auto* conn : {&start_ped, &end_ped, &start_bicycle, &end_bicycle}) {
+      conn->bss_node_id = bss_node_id;
+    }
+
     res.push_back(std::move(start_ped));
     res.push_back(std::move(end_ped));
     res.push_back(std::move(start_bicycle));
@@ -275,74 +363,26 @@ std::vector<BSSConnection> project(const GraphTile& local_tile, const std::vecto
   return res;
 }
 
-void add_bss_nodes_and_edges(GraphTileBuilder& tilebuilder_local,
-                             const GraphTile& tile,
-                             std::mutex& lock,
-                             std::vector<BSSConnection>& new_connections) {
-  auto local_level = TileHierarchy::levels().back().level;
-  auto scoped_finally = make_finally([&tilebuilder_local, &tile, &lock]() {
-    LOG_INFO("Storing local tile data with bss nodes, tile id: " +
-             std::to_string(tile.id().tileid()));
-    std::lock_guard<std::mutex> l(lock);
-    tilebuilder_local.StoreTileData();
-  });
-
-  for (auto it = new_connections.begin(); it != new_connections.end(); std::advance(it, 4)) {
-    size_t edge_index = tilebuilder_local.directededges().size();
-    NodeInfo new_bss_node{tile.header()->base_ll(), it->bss_ll, (kPedestrianAccess | kBicycleAccess),
-                          NodeType::kBikeShare, false};
-
-    new_bss_node.set_mode_change(true);
-    new_bss_node.set_edge_index(edge_index);
-
-    // there should be two outbound edge for the bss node
-    new_bss_node.set_edge_count(4);
-
-    GraphId new_bss_node_graphid{tile.header()->graphid().tileid(), local_level,
-                                 static_cast<uint32_t>(tilebuilder_local.nodes().size())};
+// The connections to add to a tile: the edges from its way nodes to the stations, sorted by way
+// node, and the new station nodes with their edges to the way nodes, four per station in the order
+// of their node ids
+struct TileConnections {
+  std::vector<BSSConnection> from_way_nodes;
+  std::vector<BSSConnection> from_bss_nodes;
+};
 
-    tilebuilder_local.nodes().emplace_back(std::move(new_bss_node));
+using connections_by_tile_t = std::unordered_map<GraphId, TileConnections>;
 
-    for (int j = 0; j < 4; j++) {
-      auto& bss_to_waynode = *(it + j);
-      bss_to_waynode.bss_node_id = new_bss_node_graphid;
-      bool added;
-      auto directededge =
-          make_directed_edge(bss_to_waynode.way_node_id, bss_to_waynode.shape, bss_to_waynode,
-                             !bss_to_waynode.is_forward_from_waynode, 0);
-
-      uint32_t edge_info_offset =
-          tilebuilder_local.AddEdgeInfo(tilebuilder_local.directededges().size(),
-                                        new_bss_node_graphid, bss_to_waynode.way_node_id,
-                                        bss_to_waynode.wayid, 0, 0, 0, bss_to_waynode.shape,
-                                        bss_to_waynode.names, bss_to_waynode.tagged_names, 0, added);
-      directededge.set_edgeinfo_offset(edge_info_offset);
-      tilebuilder_local.directededges().emplace_back(std::move(directededge));
-    }
-  }
-}
-
-void project_and_add_bss_nodes(const boost::property_tree::ptree& pt,
-                               std::mutex& lock,
-                               bss_by_tile_t::const_iterator tile_start,
-                               bss_by_tile_t::const_iterator tile_end,
-                               std::vector<BSSConnection>& all) {
+void project_bss_nodes(const boost::property_tree::ptree& pt,
+                       std::mutex& lock,
+                       bss_by_tile_t::const_iterator tile_start,
+                       bss_by_tile_t::const_iterator tile_end,
+                       std::vector<BSSConnection>& all) {
 
   GraphReader reader_local_level(pt);
   for (; tile_start != tile_end; ++tile_start) {
-
-    graph_tile_ptr local_tile = nullptr;
-    std::unique_ptr<GraphTileBuilder> tilebuilder_local = nullptr;
-    {
-      std::lock_guard<std::mutex> l(lock);
-
-      auto tile_id = tile_start->first;
-      local_tile = reader_local_level.GetGraphTile(tile_id);
-      tilebuilder_local.reset(new GraphTileBuilder{reader_local_level.tile_dir(), tile_id, true});
-    }
-
+    auto local_tile = reader_local_level.GetGraphTile(tile_start->first);
     auto new_connections = project(*local_tile, tile_start->second);
-    add_bss_nodes_and_edges(*tilebuilder_local, *local_tile, lock, new_connections);
     {
       std::lock_guard<std::mutex> l{lock};
       std::move(new_connections.begin(), new_connections.end(), std::back_inserter(all));
@@ -350,10 +390,11 @@ void project_and_add_bss_nodes(const boost::property_tree::ptree& pt,
   }
 }
 
-void create_edges(GraphTileBuilder& tilebuilder_local,
-                  const GraphTile& tile,
-                  std::mutex& lock,
-                  const std::vector<BSSConnection>& bss_connections) {
+void add_bss_nodes_and_edges(GraphTileBuilder& tilebuilder_local,
+                             const GraphTile& tile,
+                             std::mutex& lock,
+                             const TileConnections& connections) {
+  auto local_level = TileHierarchy::levels().back().level;
   auto t1 = std::chrono::high_resolution_clock::now();
 
   auto scoped_finally = make_finally([&tilebuilder_local, &tile, &lock, t1]() {
@@ -361,7 +402,7 @@ void create_edges(GraphTileBuilder& tilebuilder_local,
     uint32_t secs = std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count();
 
     LOG_INFO("Tile id: " + std::to_string(tile.id().tileid()) + " It took " + std::to_string(secs) +
-             " seconds to create edges. Now storing local tile data with new edges");
+             " seconds to create edges. Now storing local tile data with bss nodes and new edges");
     std::lock_guard<std::mutex> l(lock);
     tilebuilder_local.StoreTileData();
   });
@@ -439,6 +480,7 @@ void create_edges(GraphTileBuilder& tilebuilder_local,
     auto comp = [](const BSSConnection& lhs, const BSSConnection& rhs) {
       return lhs.way_node_id.id() < rhs.way_node_id.id();
     };
+    const auto& bss_connections = connections.from_way_nodes;
     auto lower = std::lower_bound(bss_connections.begin(), bss_connections.end(), target, comp);
     auto upper = std::upper_bound(bss_connections.begin(), bss_connections.end(), target, comp);
 
@@ -465,14 +507,53 @@ void create_edges(GraphTileBuilder& tilebuilder_local,
     tilebuilder_local.nodes().emplace_back(std::move(nb));
   }
 
-  LOG_INFO(std::string("Added: ") + std::to_string(added_edges) + " edges");
+  // Add the bss nodes after the existing ones, each with its edges to the way nodes
+  const auto& bss_connections = connections.from_bss_nodes;
+  for (auto it = bss_connections.begin(); it != bss_connections.end(); std::advance(it, 4)) {
+    size_t edge_index = tilebuilder_local.directededges().size();
+    NodeInfo new_bss_node{tile.header()->base_ll(), it->bss_ll, (kPedestrianAccess | kBicycleAccess),
+                          NodeType::kBikeShare, false};
+
+    new_bss_node.set_mode_change(true);
+    new_bss_node.set_edge_index(edge_index);
+
+    // there should be two outbound edge for the bss node
+    new_bss_node.set_edge_count(4);
+
+    GraphId new_bss_node_graphid{tile.header()->graphid().tileid(), local_level,
+                                 static_cast<uint32_t>(tilebuilder_local.nodes().size())};
+    if (new_bss_node_graphid != it->bss_node_id) {
+      LOG_ERROR("The bss node was projected with another id: " +
+                std::to_string(it->bss_node_id.id()));
+    }
+
+    tilebuilder_local.nodes().emplace_back(std::move(new_bss_node));
+
+    for (int j = 0; j < 4; j++) {
+      const auto& bss_to_waynode = *(it + j);
+      bool added;
+      auto directededge =
+          make_directed_edge(bss_to_waynode.way_node_id, bss_to_waynode.shape, bss_to_waynode,
+                             !bss_to_waynode.is_forward_from_waynode, 0);
+
+      uint32_t edge_info_offset =
+          tilebuilder_local.AddEdgeInfo(tilebuilder_local.directededges().size(),
+                                        new_bss_node_graphid, bss_to_waynode.way_node_id,
+                                        bss_to_waynode.wayid, 0, 0, 0, bss_to_waynode.shape,
+                                        bss_to_waynode.names, bss_to_waynode.tagged_names, 0, added);
+      directededge.set_edgeinfo_offset(edge_info_offset);
+      tilebuilder_local.directededges().emplace_back(std::move(directededge));
+    }
+  }
+
+  LOG_INFO(std::string("Added: ") + std::to_string(added_edges) + " edges and " +
+           std::to_string(bss_connections.size() / 4) + " bss nodes");
 }
 
-void create_edges_from_way_node(
-    const boost::property_tree::ptree& pt,
-    std::mutex& lock,
-    std::unordered_map<GraphId, std::vector<BSSConnection>>::const_iterator tile_start,
-    std::unordered_map<GraphId, std::vector<BSSConnection>>::const_iterator tile_end) {
+void add_bss_to_tiles(const boost::property_tree::ptree& pt,
+                      std::mutex& lock,
+                      connections_by_tile_t::const_iterator tile_start,
+                      connections_by_tile_t::const_iterator tile_end) {
 
   GraphReader reader_local_level(pt);
   for (; tile_start != tile_end; ++tile_start) {
@@ -486,7 +567,7 @@ void create_edges_from_way_node(
       local_tile = reader_local_level.GetGraphTile(tile_id);
       tilebuilder_local.reset(new GraphTileBuilder{reader_local_level.tile_dir(), tile_id, true});
     }
-    create_edges(*tilebuilder_local, *local_tile, lock, tile_start->second);
+    add_bss_nodes_and_edges(*tilebuilder_local, *local_tile, lock, tile_start->second);
   }
 }
 
@@ -542,16 +623,17 @@ namespace mjolnir {
  *
  * The import is done in two steps:
  *
- * 1. Find the nearest edge on which the BSS node should be projected, then add the bss nodes and
- * their outbound edge to the local tiles. In this step, we assume that every BSS node will have 2
- * outbound edges: one is towards the start and another is towards the end. Since we know to which
- * node these outbound edges point, we can easily compute their oppo_edgelocalidx which is essential.
+ * 1. Find the nearest edge on which the BSS node should be projected, tile by tile in parallel
+ * without writing anything yet. The edges of a tile are decoded once and binned into a grid so that
+ * each station is only projected onto the edges around it. In this step, we assume that every BSS
+ * node will have 2 outbound edges: one is towards the start and another is towards the end. Since
+ * the bss nodes are added after the existing nodes of their tiles we also know their ids already.
  *
- * 2. Now the Bss nodes and their outbound edges are added into the local tiles, it's time to add
- * their inbound edges(in other words, outbound edges of startnodes and endnodes). These edges are
- * just considered as the same outbound edges from a way node (outbound edges of either startnode or
- * endnode are technically the same). We group those edges whose orign are in the same tiles and work
- * on it in batch.
+ * 2. Now it's time to add the bss nodes with their outbound edges and their inbound edges(in other
+ * words, outbound edges of startnodes and endnodes). These edges are just considered as the same
+ * outbound edges from a way node (outbound edges of either startnode or endnode are technically the
+ * same). We group the bss nodes and those edges whose orign are in the same tiles and work on them
+ * in batch, so that each tile is rewritten only once.
  *
  *
  * */
@@ -618,7 +700,7 @@ void BssBuilder::Build(const boost::property_tree::ptree& pt, const std::string&
       // Where the range ends
       std::advance(tile_end, tile_count);
       // Make the thread
-      threads[i].reset(new std::thread(project_and_add_bss_nodes, std::cref(pt.get_child("mjolnir")),
+      threads[i].reset(new std::thread(project_bss_nodes, std::cref(pt.get_child("mjolnir")),
                                        std::ref(lock), tile_start, tile_end, std::ref(all)));
     }
 
@@ -627,31 +709,26 @@ void BssBuilder::Build(const boost::property_tree::ptree& pt, const std::string&
     }
   }
 
-  // the collection is sorted so that the search will be much faster later.
-  boost::sort(all);
-
-  // outboud edges from way node are grouped by tiles.
-  std::unordered_map<GraphId, std::vector<BSSConnection>> map;
-  if (!all.empty()) {
-    auto chunk_start = all.begin();
-    do {
-      auto tileid = chunk_start->way_node_id.tileid();
-      auto chunk_end = std::stable_partition(chunk_start, all.end(), [tileid](const auto& conn) {
-        return tileid == conn.way_node_id.tileid();
-      });
-
-      std::move(chunk_start, chunk_end, std::back_inserter(map[{tileid, local_level, 0}]));
-
-      chunk_start = chunk_end;
-
-    } while (chunk_start != all.end());
+  // the bss nodes and the outbound edges from way nodes are grouped by tiles, the latter sorted so
+  // that the search will be much faster later.
+  connections_by_tile_t map;
+  for (auto& conn : all) {
+    map[conn.way_node_id.Tile_Base()].from_way_nodes.push_back(conn);
+    map[conn.bss_node_id.Tile_Base()].from_bss_nodes.push_back(std::move(conn));
+  }
+  all.clear();
+  for (auto& tile : map) {
+    boost::sort(tile.second.from_way_nodes);
+    std::stable_sort(tile.second.from_bss_nodes.begin(), tile.second.from_bss_nodes.end(),
+                     [](const BSSConnection& lhs, const BSSConnection& rhs) {
+                       return lhs.bss_node_id.id() < rhs.bss_node_id.id();
+                     });
   }
 
   {
     size_t floor = map.size() / threads.size();
     size_t at_ceiling = map.size() - (threads.size() * floor);
-    std::unordered_map<GraphId, std::vector<BSSConnection>>::const_iterator tile_start,
-        tile_end = map.begin();
+    connections_by_tile_t::const_iterator tile_start, tile_end = map.begin();
 
     for (size_t i = 0; i < threads.size(); ++i) {
       // Figure out how many this thread will work on (either ceiling or floor)
@@ -661,7 +738,7 @@ void BssBuilder::Build(const boost::property_tree::ptree& pt, const std::string&
       // Where the range ends
       std::advance(tile_end, tile_count);
       // Make the thread
-      threads[i].reset(new std::thread(create_edges_from_way_node, std::cref(pt.get_child("mjolnir")),
+      threads[i].reset(new std::thread(add_bss_to_tiles, std::cref(pt.get_child("mjolnir")),
                                        std::ref(lock), tile_start, tile_end));
     }
 
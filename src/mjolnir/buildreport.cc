@@ -0,0 +1,150 @@
+#include "mjolnir/buildreport.h"
+
+#include <fstream>
+
+#include <sys/resource.h>
+
+#include "baldr/json.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+json::MapPtr serialize(const valhalla::mjolnir::BuildReport::usage_t& usage) {
+  return json::map({
+      {"wall_seconds", json::fp_t{usage.wall_seconds, 3}},
+      {"cpu_seconds", json::fp_t{usage.cpu_seconds, 3}},
+      {"peak_rss_bytes", usage.peak_rss_bytes},
+      {"read_bytes", usage.read_bytes},
+      {"written_bytes", usage.written_bytes},
+  });
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+BuildReport& BuildReport::Get() {
+  static BuildReport report;
+  return report;
+}
+
+BuildReport::usage_t BuildReport::Usage() {
+  usage_t usage;
+  usage.wall_seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+  struct rusage r;
+  if (getrusage(RUSAGE_SELF, &r) == 0) {
+    usage.cpu_seconds = r.ru_utime.tv_sec + r.ru_utime.tv_usec * 1e-6 + r.ru_stime.tv_sec +
+                        r.ru_stime.tv_usec * 1e-6;
+#ifdef __APPLE__
+    usage.peak_rss_bytes = r.ru_maxrss;
+#else
+    usage.peak_rss_bytes = static_cast<uint64_t>(r.ru_maxrss) * 1024;
+#endif
+  }
+
+  // only linux has these and only if it keeps io accounting
+  std::ifstream io("/proc/self/io");
+  std::string key;
+  uint64_t value;
+  while (io >> key >> value) {
+    if (key == "read_bytes:") {
+      usage.read_bytes = value;
+    } else if (key == "write_bytes:") {
+      usage.written_bytes = value;
+    }
+  }
+  return usage;
+}
+
+void BuildReport::Begin(const std::string& stage) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  End();
+  stages_.emplace_back();
+  stages_.back().name = stage;
+  stages_.back().begin = Usage();
+  open_ = true;
+}
+
+void BuildReport::End() {
+  if (!open_) {
+    return;
+  }
+  auto& stage = stages_.back();
+  auto end = Usage();
+  stage.usage.wall_seconds = end.wall_seconds - stage.begin.wall_seconds;
+  stage.usage.cpu_seconds = end.cpu_seconds - stage.begin.cpu_seconds;
+  stage.usage.peak_rss_bytes = end.peak_rss_bytes;
+  stage.usage.read_bytes = end.read_bytes - stage.begin.read_bytes;
+  stage.usage.written_bytes = end.written_bytes - stage.begin.written_bytes;
+  open_ = false;
+}
+
+void BuildReport::Count(const std::string& what, uint64_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (open_) {
+    stages_.back().counts[what] += count;
+  }
+}
+
+void BuildReport::AddThreads(const std::string& queue, const std::vector<thread_t>& threads) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!open_) {
+    return;
+  }
+  auto& stage = stages_.back();
+  stage.queues.emplace_back(queue, threads);
+  for (const auto& thread : threads) {
+    stage.counts["tiles"] += thread.tiles;
+  }
+}
+
+void BuildReport::Write(std::ostream& out) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  End();
+  auto end = Usage();
+  usage_t total{end.wall_seconds - start_.wall_seconds, end.cpu_seconds - start_.cpu_seconds,
+                end.peak_rss_bytes, end.read_bytes - start_.read_bytes,
+                end.written_bytes - start_.written_bytes};
+
+  auto stages = json::array({});
+  for (const auto& stage : stages_) {
+    auto report = serialize(stage.usage);
+    report->emplace("stage", stage.name);
+    // how many of everything and how many of them per second
+    auto counts = json::map({});
+    auto rates = json::map({});
+    for (const auto& count : stage.counts) {
+      counts->emplace(count.first, count.second);
+      rates->emplace(count.first,
+                     json::fp_t{stage.usage.wall_seconds > 0
+                                    ? count.second / stage.usage.wall_seconds
+                                    : 0.,
+                                1});
+    }
+    report->emplace("counts", counts);
+    report->emplace("per_second", rates);
+    // what each of the threads of each of the queues did
+    auto queues = json::array({});
+    for (const auto& queue : stage.queues) {
+      auto threads = json::array({});
+      for (const auto& thread : queue.second) {
+        threads->emplace_back(json::map({{"tiles", thread.tiles},
+                                         {"done_seconds", json::fp_t{thread.done_seconds, 3}}}));
+      }
+      queues->emplace_back(json::map({{"name", queue.first}, {"threads", threads}}));
+    }
+    report->emplace("queues", queues);
+    stages->emplace_back(report);
+  }
+
+  auto report = serialize(total);
+  report->emplace("stages", stages);
+  out << *report << std::endl;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
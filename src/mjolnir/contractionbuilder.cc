@@ -0,0 +1,405 @@
+#include "mjolnir/contractionbuilder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/contractionhierarchy.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+using Arc = ContractionHierarchy::Arc;
+constexpr uint32_t kInvalidNode = ContractionHierarchy::kInvalidNode;
+
+// How many nodes a witness search may settle before it gives up and a shortcut is added
+constexpr uint32_t kMaxWitnessSettled = 500;
+
+// Adds an arc or lowers the cost of the one already there
+void add_arc(std::vector<Arc>& arcs, const Arc& add) {
+  for (auto& arc : arcs) {
+    if (arc.node == add.node) {
+      if (add.cost < arc.cost) {
+        arc = add;
+      }
+      return;
+    }
+  }
+  arcs.push_back(add);
+}
+
+void remove_arc(std::vector<Arc>& arcs, const uint32_t node) {
+  arcs.erase(std::remove_if(arcs.begin(), arcs.end(),
+                            [node](const Arc& arc) { return arc.node == node; }),
+             arcs.end());
+}
+
+// The turns between the usable directed edges of the graph, the edge based graph that is
+// contracted. Nodes are the directed edges and arcs the allowed turns between them.
+struct edge_graph_t {
+  std::vector<GraphId> edges;
+  std::vector<std::vector<Arc>> out;
+  std::vector<std::vector<Arc>> in;
+};
+
+edge_graph_t make_edge_graph(GraphReader& reader, const cost_ptr_t& costing) {
+  edge_graph_t graph;
+
+  // every directed edge the costing can use is a node
+  std::unordered_map<uint64_t, uint32_t> nodes;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& level : TileHierarchy::levels()) {
+    if (level.level == transit_level) {
+      continue;
+    }
+    auto tile_set = reader.GetTileSet(level.level);
+    std::vector<GraphId> tile_ids(tile_set.begin(), tile_set.end());
+    std::sort(tile_ids.begin(), tile_ids.end());
+    for (const auto& tile_id : tile_ids) {
+      graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+      if (!tile) {
+        continue;
+      }
+      GraphId edgeid = tile_id;
+      for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i, ++edgeid) {
+        const DirectedEdge* edge = tile->directededge(i);
+        if (costing->Allowed(edge, tile) && edge->use() != Use::kTransitConnection) {
+          nodes.emplace(edgeid.value, static_cast<uint32_t>(graph.edges.size()));
+          graph.edges.push_back(edgeid);
+        }
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  }
+  graph.out.resize(graph.edges.size());
+  graph.in.resize(graph.edges.size());
+  LOG_INFO("Found " + std::to_string(graph.edges.size()) + " usable directed edges");
+
+  // every turn from one of them to another one is an arc, this mirrors how the path algorithms
+  // expand from the end node of an edge including u-turns only being allowed at dead ends
+  for (uint32_t u = 0; u < graph.edges.size(); ++u) {
+    const GraphId& edgeid = graph.edges[u];
+    graph_tile_ptr tile = reader.GetGraphTile(edgeid);
+    const DirectedEdge* edge = tile->directededge(edgeid);
+    const EdgeLabel pred(kInvalidLabel, edgeid, edge, {}, 0.f, 0.f, costing->travel_mode(), 0, {});
+
+    graph_tile_ptr end_tile = reader.GetGraphTile(edge->endnode());
+    if (!end_tile) {
+      continue;
+    }
+
+    // returns true if the turn onto the edge is allowed
+    auto turn = [&](const graph_tile_ptr& node_tile, const NodeInfo* node_info,
+                    const GraphId& next_id) {
+      auto found = nodes.find(next_id.value);
+      if (found == nodes.end() || found->second == u) {
+        return false;
+      }
+      const DirectedEdge* next = node_tile->directededge(next_id);
+      int restriction_idx = -1;
+      if (!costing->Allowed(next, pred, node_tile, next_id, 0, node_info->timezone(),
+                            restriction_idx)) {
+        return false;
+      }
+      auto cost =
+          costing->EdgeCost(next, node_tile) + costing->TransitionCost(next, node_info, pred);
+      add_arc(graph.out[u], {found->second, kInvalidNode, cost.cost, cost.secs, next->length()});
+      add_arc(graph.in[found->second], {u, kInvalidNode, cost.cost, cost.secs, next->length()});
+      return true;
+    };
+
+    const NodeInfo* node_info = end_tile->node(edge->endnode());
+    GraphId uturn_id;
+    bool turned = false;
+    if (costing->Allowed(node_info)) {
+      GraphId next_id(edge->endnode().tileid(), edge->endnode().level(), node_info->edge_index());
+      for (uint32_t i = 0; i < node_info->edge_count(); ++i, ++next_id) {
+        if (end_tile->directededge(next_id)->localedgeidx() == pred.opp_local_idx()) {
+          uturn_id = next_id;
+        } else {
+          turned = turn(end_tile, node_info, next_id) || turned;
+        }
+      }
+      const NodeTransition* trans = end_tile->transition(node_info->transition_index());
+      for (uint32_t i = 0; i < node_info->transition_count(); ++i, ++trans) {
+        graph_tile_ptr trans_tile = reader.GetGraphTile(trans->endnode());
+        if (!trans_tile) {
+          continue;
+        }
+        const NodeInfo* trans_node = trans_tile->node(trans->endnode());
+        GraphId trans_id(trans->endnode().tileid(), trans->endnode().level(),
+                         trans_node->edge_index());
+        for (uint32_t j = 0; j < trans_node->edge_count(); ++j, ++trans_id) {
+          turned = turn(trans_tile, trans_node, trans_id) || turned;
+        }
+      }
+    } else {
+      // when the node cant be passed the only way on is back
+      GraphId next_id(edge->endnode().tileid(), edge->endnode().level(), node_info->edge_index());
+      for (uint32_t i = 0; i < node_info->edge_count(); ++i, ++next_id) {
+        if (end_tile->directededge(next_id)->localedgeidx() == pred.opp_local_idx()) {
+          uturn_id = next_id;
+        }
+      }
+    }
+    if (!turned && uturn_id.Is_Valid()) {
+      turn(end_tile, node_info, uturn_id);
+    }
+
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  return graph;
+}
+
+// Contracts the edge graph in order of importance, adding shortcuts where needed
+class Contractor {
+public:
+  Contractor(edge_graph_t& graph)
+      : graph_(graph), deleted_neighbors_(graph.edges.size(), 0), priority_(graph.edges.size(), 0),
+        distances_(graph.edges.size(), std::numeric_limits<float>::max()) {
+  }
+
+  // contracts every node, returns the contraction order and fills in the arcs of the hierarchy
+  std::vector<uint32_t> Contract(std::vector<std::vector<Arc>>& up,
+                                 std::vector<std::vector<Arc>>& down) {
+    const uint32_t count = static_cast<uint32_t>(graph_.edges.size());
+    up.resize(count);
+    down.resize(count);
+    for (uint32_t node = 0; node < count; ++node) {
+      priority_[node] = Priority(node);
+      queue_.emplace(priority_[node], node);
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    while (!queue_.empty()) {
+      // priorities go stale as the graph changes, only contract if the node is still the best
+      uint32_t node = queue_.begin()->second;
+      queue_.erase(queue_.begin());
+      int priority = Priority(node);
+      if (!queue_.empty() && priority > queue_.begin()->first) {
+        priority_[node] = priority;
+        queue_.emplace(priority, node);
+        continue;
+      }
+
+      Shortcuts(node, true);
+      up[node] = std::move(graph_.out[node]);
+      down[node] = std::move(graph_.in[node]);
+      order.push_back(node);
+
+      // the neighbors lose the node and are worth reconsidering
+      std::vector<uint32_t> neighbors;
+      for (const auto& arc : down[node]) {
+        remove_arc(graph_.out[arc.node], node);
+        neighbors.push_back(arc.node);
+      }
+      for (const auto& arc : up[node]) {
+        remove_arc(graph_.in[arc.node], node);
+        neighbors.push_back(arc.node);
+      }
+      std::sort(neighbors.begin(), neighbors.end());
+      neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+      for (auto neighbor : neighbors) {
+        ++deleted_neighbors_[neighbor];
+        queue_.erase({priority_[neighbor], neighbor});
+        priority_[neighbor] = Priority(neighbor);
+        queue_.emplace(priority_[neighbor], neighbor);
+      }
+
+      if (order.size() % 1000000 == 0) {
+        LOG_INFO("Contracted " + std::to_string(order.size()) + " of " + std::to_string(count) +
+                 " nodes");
+      }
+    }
+    return order;
+  }
+
+protected:
+  // the edge difference plus how many neighbors were contracted already, which spreads the
+  // contraction over the graph rather than eating into one area
+  int Priority(const uint32_t node) {
+    int shortcuts = Shortcuts(node, false);
+    return 2 * (shortcuts - static_cast<int>(graph_.in[node].size() + graph_.out[node].size())) +
+           static_cast<int>(deleted_neighbors_[node]);
+  }
+
+  // counts, and adds if asked to, the shortcuts needed to contract the node
+  int Shortcuts(const uint32_t node, const bool add) {
+    int shortcuts = 0;
+    // copy since adding shortcuts can change the arcs of the neighbors
+    const std::vector<Arc> in = graph_.in[node];
+    const std::vector<Arc> out = graph_.out[node];
+    for (const auto& from : in) {
+      float limit = -1.f;
+      for (const auto& to : out) {
+        if (to.node != from.node) {
+          limit = std::max(limit, from.cost + to.cost);
+        }
+      }
+      if (limit < 0.f) {
+        continue;
+      }
+      Witness(from.node, node, limit);
+      for (const auto& to : out) {
+        if (to.node == from.node || distances_[to.node] <= from.cost + to.cost) {
+          continue;
+        }
+        ++shortcuts;
+        if (add) {
+          const float cost = from.cost + to.cost, secs = from.secs + to.secs;
+          const float length = from.length + to.length;
+          add_arc(graph_.out[from.node], {to.node, node, cost, secs, length});
+          add_arc(graph_.in[to.node], {from.node, node, cost, secs, length});
+        }
+      }
+      for (auto touched : touched_) {
+        distances_[touched] = std::numeric_limits<float>::max();
+      }
+      touched_.clear();
+    }
+    return shortcuts;
+  }
+
+  // a limited dijkstra from source around the node to see which shortcuts are needed
+  void Witness(const uint32_t source, const uint32_t skip, const float limit) {
+    using entry_t = std::pair<float, uint32_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    distances_[source] = 0.f;
+    touched_.push_back(source);
+    queue.emplace(0.f, source);
+    uint32_t settled = 0;
+    while (!queue.empty() && settled < kMaxWitnessSettled) {
+      auto current = queue.top();
+      queue.pop();
+      if (current.first > distances_[current.second]) {
+        continue;
+      }
+      if (current.first > limit) {
+        break;
+      }
+      ++settled;
+      for (const auto& arc : graph_.out[current.second]) {
+        if (arc.node == skip) {
+          continue;
+        }
+        float distance = current.first + arc.cost;
+        if (distance < distances_[arc.node]) {
+          if (distances_[arc.node] == std::numeric_limits<float>::max()) {
+            touched_.push_back(arc.node);
+          }
+          distances_[arc.node] = distance;
+          queue.emplace(distance, arc.node);
+        }
+      }
+    }
+  }
+
+  edge_graph_t& graph_;
+  std::vector<uint32_t> deleted_neighbors_;
+  std::vector<int> priority_;
+  std::set<std::pair<int, uint32_t>> queue_;
+
+  // witness search state, distances are reset through the touched nodes after every search
+  std::vector<float> distances_;
+  std::vector<uint32_t> touched_;
+};
+
+void Build(const boost::property_tree::ptree& pt, const std::string& costing_name) {
+  valhalla::Costing costing_type;
+  if (!valhalla::Costing_Enum_Parse(costing_name, &costing_type)) {
+    throw std::runtime_error("Unknown costing for a contraction hierarchy: " + costing_name);
+  }
+
+  // the default options of the costing are what requests get when they dont specify any
+  valhalla::Options options;
+  rapidjson::Document doc;
+  doc.SetObject();
+  ParseCostingOptions(doc, "/costing_options", options);
+  auto costing = CostFactory().Create(options.costing_options(static_cast<int>(costing_type)));
+
+  LOG_INFO("Building the " + costing_name + " contraction hierarchy");
+  GraphReader reader(pt.get_child("mjolnir"));
+  auto graph = make_edge_graph(reader, costing);
+
+  std::vector<std::vector<Arc>> up, down;
+  std::vector<uint32_t> order;
+  {
+    Contractor contractor(graph);
+    order = contractor.Contract(up, down);
+  }
+
+  // number the nodes by their contraction order
+  std::vector<uint32_t> rank(order.size());
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    rank[order[i]] = i;
+  }
+  std::vector<GraphId> edges(order.size());
+  std::vector<std::vector<Arc>> ranked_up(order.size()), ranked_down(order.size());
+  size_t shortcuts = 0;
+  for (uint32_t node = 0; node < order.size(); ++node) {
+    edges[rank[node]] = graph.edges[node];
+    for (auto* arcs : {&up[node], &down[node]}) {
+      for (auto& arc : *arcs) {
+        arc.node = rank[arc.node];
+        if (arc.middle != kInvalidNode) {
+          arc.middle = rank[arc.middle];
+          ++shortcuts;
+        }
+      }
+    }
+    ranked_up[rank[node]] = std::move(up[node]);
+    ranked_down[rank[node]] = std::move(down[node]);
+  }
+
+  auto file_name = ContractionHierarchy::FileName(pt.get<std::string>("mjolnir.tile_dir"),
+                                                  costing_name);
+  ContractionHierarchy::Write(file_name, costing_name, edges, ranked_up, ranked_down);
+  LOG_INFO("Wrote " + file_name + " with " + std::to_string(shortcuts) + " shortcuts");
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ContractionBuilder::Build(const boost::property_tree::ptree& pt) {
+  auto costings = pt.get<std::string>("mjolnir.contraction_hierarchies", "");
+  std::vector<std::string> names;
+  boost::algorithm::split(names, costings, boost::algorithm::is_any_of(","));
+  for (const auto& name : names) {
+    if (!name.empty()) {
+      ::Build(pt, name);
+    }
+  }
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,230 @@
+#include "mjolnir/edgereachbuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/edgereach.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// The reach is kept in 16 bits
+constexpr uint32_t kMaxCap = std::numeric_limits<uint16_t>::max();
+
+// The simple expansion of loki::Reach, which stops at every restriction and closure and so gives
+// a lower bound of the exact reach. It has to stay what loki does so that the stored reach means
+// the same as the one loki would find.
+class reach_finder_t {
+public:
+  reach_finder_t(GraphReader& reader, const cost_ptr_t& costing, const uint32_t cap)
+      : reader_(reader), costing_(costing), cap_(cap), transitions_(0) {
+    queue_.reserve(cap);
+    done_.reserve(cap);
+  }
+
+  // the outbound and inbound reach of the edge
+  void operator()(const DirectedEdge* edge, const graph_tile_ptr& edge_tile, uint16_t* reach) {
+    constexpr uint16_t forward_disallow_mask =
+        kDisallowEndRestriction | kDisallowSimpleRestriction | kDisallowClosure;
+    constexpr uint16_t reverse_disallow_mask =
+        kDisallowStartRestriction | kDisallowSimpleRestriction | kDisallowClosure;
+
+    // outbound from the end of the edge
+    clear();
+    graph_tile_ptr tile = edge_tile;
+    if (costing_->Allowed(edge, tile, kDisallowSimpleRestriction)) {
+      enqueue(edge->endnode(), tile);
+    }
+    while (count() < cap_ && !queue_.empty()) {
+      GraphId node_id(*done_.insert(*queue_.begin()).first);
+      queue_.erase(queue_.begin());
+      if (!reader_.GetGraphTile(node_id, tile)) {
+        continue;
+      }
+      for (const auto& next : tile->GetDirectedEdges(node_id)) {
+        if (costing_->Allowed(&next, tile, forward_disallow_mask)) {
+          enqueue(next.endnode(), tile);
+        }
+      }
+    }
+    reach[0] = static_cast<uint16_t>(std::min(count(), cap_));
+
+    // inbound to the start of the edge
+    clear();
+    tile = edge_tile;
+    if (costing_->Allowed(edge, tile)) {
+      enqueue(reader_.GetBeginNodeId(edge, tile), tile);
+    }
+    while (count() < cap_ && !queue_.empty()) {
+      GraphId node_id(*done_.insert(*queue_.begin()).first);
+      queue_.erase(queue_.begin());
+      if (!reader_.GetGraphTile(node_id, tile)) {
+        continue;
+      }
+      for (const auto& next : tile->GetDirectedEdges(node_id)) {
+        if (!reader_.GetGraphTile(next.endnode(), tile)) {
+          continue;
+        }
+        const auto* node = tile->node(next.endnode());
+        const auto* opp_edge = tile->directededge(node->edge_index() + next.opp_index());
+        if (costing_->Allowed(opp_edge, tile, reverse_disallow_mask)) {
+          enqueue(next.endnode(), tile);
+        }
+      }
+    }
+    reach[1] = static_cast<uint16_t>(std::min(count(), cap_));
+  }
+
+protected:
+  // settled nodes + will be settled nodes - duplicated transitions nodes
+  uint32_t count() const {
+    return static_cast<uint32_t>(queue_.size() + done_.size() - transitions_);
+  }
+
+  void clear() {
+    queue_.clear();
+    done_.clear();
+    transitions_ = 0;
+  }
+
+  void enqueue(const GraphId& node_id, graph_tile_ptr tile) {
+    if (!node_id.Is_Valid() || done_.find(node_id) != done_.cend() ||
+        !reader_.GetGraphTile(node_id, tile)) {
+      return;
+    }
+    const auto* node = tile->node(node_id);
+    if (!costing_->Allowed(node)) {
+      return;
+    }
+    queue_.insert(node_id);
+    for (const auto& transition : tile->GetNodeTransitions(node)) {
+      if (done_.find(transition.endnode()) != done_.cend()) {
+        continue;
+      }
+      queue_.insert(transition.endnode());
+      ++transitions_;
+    }
+  }
+
+  GraphReader& reader_;
+  const cost_ptr_t& costing_;
+  const uint32_t cap_;
+  std::unordered_set<uint64_t> queue_, done_;
+  size_t transitions_;
+};
+
+void Build(const boost::property_tree::ptree& pt, const std::string& costing_name) {
+  valhalla::Costing costing_type;
+  if (!valhalla::Costing_Enum_Parse(costing_name, &costing_type)) {
+    throw std::runtime_error("Unknown costing for edge reach: " + costing_name);
+  }
+
+  // the reach is only used for requests with the default options, see loki::Search
+  valhalla::Options options;
+  rapidjson::Document doc;
+  doc.SetObject();
+  ParseCostingOptions(doc, "/costing_options", options);
+  auto costing = CostFactory().Create(options.costing_options(static_cast<int>(costing_type)));
+  const uint32_t cap = std::min(pt.get<uint32_t>("mjolnir.edge_reach_cap", 50), kMaxCap);
+
+  // The edges of every level but transit, numbered tile by tile
+  LOG_INFO("Computing the " + costing_name + " reach up to " + std::to_string(cap));
+  std::vector<GraphId> tiles;
+  std::vector<uint64_t> offsets{0};
+  {
+    GraphReader reader(pt.get_child("mjolnir"));
+    const auto transit_level = TileHierarchy::GetTransitLevel().level;
+    for (const auto& level : TileHierarchy::levels()) {
+      if (level.level == transit_level) {
+        continue;
+      }
+      for (const auto& tile_id : reader.GetTileSet(level.level)) {
+        tiles.push_back(tile_id);
+      }
+    }
+    std::sort(tiles.begin(), tiles.end());
+    for (const auto& tile_id : tiles) {
+      graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+      offsets.push_back(offsets.back() + (tile ? tile->header()->directededgecount() : 0));
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  }
+
+  // Every thread takes the next tile and fills in the reach of its edges
+  std::vector<uint16_t> reach(offsets.back() * 2, 0);
+  std::atomic<size_t> next_tile(0);
+  auto find_reach = [&]() {
+    GraphReader reader(pt.get_child("mjolnir"));
+    reach_finder_t finder(reader, costing, cap);
+    for (size_t t = next_tile++; t < tiles.size(); t = next_tile++) {
+      graph_tile_ptr tile = reader.GetGraphTile(tiles[t]);
+      if (!tile) {
+        continue;
+      }
+      for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+        finder(tile->directededge(i), tile, reach.data() + (offsets[t] + i) * 2);
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  };
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
+  for (auto& thread : threads) {
+    thread.reset(new std::thread(find_reach));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  auto file_name = EdgeReach::FileName(pt.get<std::string>("mjolnir.tile_dir"), costing_name);
+  EdgeReach::Write(file_name, costing_name, cap, tiles, offsets, reach);
+  LOG_INFO("Wrote " + file_name + " with the reach of " + std::to_string(offsets.back()) +
+           " edges");
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void EdgeReachBuilder::Build(const boost::property_tree::ptree& pt) {
+  auto costings = pt.get<std::string>("mjolnir.edge_reach", "");
+  std::vector<std::string> names;
+  boost::algorithm::split(names, costings, boost::algorithm::is_any_of(","));
+  for (const auto& name : names) {
+    if (!name.empty()) {
+      ::Build(pt, name);
+    }
+  }
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -1,14 +1,17 @@
 #include "mjolnir/util.h"
 
 #include <boost/format.hpp>
+#include <cmath>
 #include <future>
 #include <set>
 #include <thread>
 #include <utility>
 
+#include "baldr/elevationprofiles.h"
 #include "baldr/graphconstants.h"
 #include "baldr/graphid.h"
 #include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -19,8 +22,7 @@
 
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphtilebuilder.h"
-
-#include <deque>
+#include "mjolnir/tilequeue.h"
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -34,37 +36,59 @@ constexpr double POSTING_INTERVAL = 60;
 // Do not compute grade for intervals less than 10 meters.
 constexpr double kMinimumInterval = 10.0f;
 
+/**
+ * Samples the heights every so often along the shape of an edge for its elevation profile.
+ * @return the heights, none if there is no elevation data for some of them
+ */
+std::vector<double>
+elevation_profile(const std::vector<PointLL>& shape,
+                  const DirectedEdge& directededge,
+                  const std::unique_ptr<const valhalla::skadi::sample>& sample) {
+  // The heights over the water or under ground are not those of the edge, bridges only get the
+  // heights of their ends as the ground under them is not where they go
+  std::vector<double> heights;
+  if (directededge.tunnel() || directededge.use() == Use::kFerry) {
+    return heights;
+  } else if (directededge.bridge()) {
+    heights = sample->get_all(std::vector<PointLL>{shape.front(), shape.back()});
+  } else {
+    auto n = static_cast<uint32_t>(
+        std::max(2.0f, std::round(directededge.length() / kElevationProfileInterval) + 1));
+    heights = sample->get_all(
+        n == 2 ? std::vector<PointLL>{shape.front(), shape.back()}
+               : uniform_resample_spherical_polyline(shape, directededge.length(), n));
+  }
+
+  // Leave out the profiles with holes in them
+  for (auto height : heights) {
+    if (height == valhalla::skadi::sample::get_no_data_value()) {
+      heights.clear();
+      break;
+    }
+  }
+  return heights;
+}
+
 /**
  * Adds elevation to a set of tiles. Each thread pulls a tile of the queue
  */
-void add_elevation(const boost::property_tree::ptree& pt,
-                   std::deque<GraphId>& tilequeue,
-                   std::mutex& lock,
+void add_elevation(const std::string& tile_dir,
+                   TileQueue& tilequeue,
                    const std::unique_ptr<const valhalla::skadi::sample>& sample,
                    std::promise<uint32_t>& /*result*/) {
-  // Local Graphreader
-  GraphReader graphreader(pt.get_child("mjolnir"));
-
   // We usually end up accessing the same shape twice (once for each direction along an edge).
   // Use a cache to record elevation attributes based on the EdgeInfo offset. This includes
   // weighted grade (forward and reverse) as well as max slopes (up/down for forward and reverse).
   std::unordered_map<uint32_t, std::tuple<uint32_t, uint32_t, float, float, float, float>>
       geo_attribute_cache;
+  // Both directions of an edge share the elevation profile stored for the first of them
+  std::unordered_map<uint32_t, uint32_t> elevation_profile_cache;
 
   // Check for more tiles
-  while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
-
+  GraphId tile_id;
+  while (tilequeue.next(tile_id)) {
     // Get the tile. Serialize the entire tile?
-    GraphTileBuilder tilebuilder(graphreader.tile_dir(), tile_id, true);
+    GraphTileBuilder tilebuilder(tile_dir, tile_id, true);
 
     // Set the has_elevation flag. TODO - do we need to know if any elevation is actually
     // retrieved/used?
@@ -75,6 +99,8 @@ void add_elevation(const boost::property_tree::ptree& pt,
     uint32_t count = tilebuilder.header()->directededgecount();
     geo_attribute_cache.clear();
     geo_attribute_cache.reserve(2 * count);
+    elevation_profile_cache.clear();
+    elevation_profile_cache.reserve(2 * count);
 
     // Iterate through the directed edges
     for (uint32_t i = 0; i < count; ++i) {
@@ -95,21 +121,19 @@ void add_elevation(const boost::property_tree::ptree& pt,
         std::tuple<double, double, double, double> forward_grades(0.0, 0.0, 0.0, 0.0);
         std::tuple<double, double, double, double> reverse_grades(0.0, 0.0, 0.0, 0.0);
         if (!directededge.tunnel() && directededge.use() != Use::kFerry) {
-          // Evenly sample the shape. If it is really short or a bridge just do both ends
+          // Evenly sample the heights along the shape. If it is really short or a bridge just do
+          // both ends. Compute "weighted"
+          // grades as well as max grades in both directions. Valid range
+          // for weighted grades is between -10 and +15 which is then
+          // mapped to a value between 0 to 15 for use in costing.
           auto interval = POSTING_INTERVAL;
-          std::vector<PointLL> resampled;
+          std::vector<double> heights;
           if (length < POSTING_INTERVAL * 3 || directededge.bridge()) {
-            resampled = {shape.front(), shape.back()};
+            heights = sample->get_all(std::vector<PointLL>{shape.front(), shape.back()});
             interval = length;
           } else {
-            resampled = valhalla::midgard::resample_spherical_polyline(shape, interval);
+            heights = sample->get_resampled(shape, interval);
           }
-
-          // Get the heights at each sampled point. Compute "weighted"
-          // grades as well as max grades in both directions. Valid range
-          // for weighted grades is between -10 and +15 which is then
-          // mapped to a value between 0 to 15 for use in costing.
-          auto heights = sample->get_all(resampled);
           auto grades = valhalla::skadi::weighted_grade(heights, interval);
           if (length < kMinimumInterval) {
             // Keep the default grades - but set the mean elevation
@@ -137,6 +161,18 @@ void add_elevation(const boost::property_tree::ptree& pt,
 
         // Set the mean elevation on EdgeInfo
         tilebuilder.set_mean_elevation(edge_info_offset, mean_elevation);
+
+        // Store the elevation profile along the shape
+        auto heights = elevation_profile(shape, directededge, sample);
+        if (!heights.empty()) {
+          elevation_profile_cache.emplace(edge_info_offset,
+                                          tilebuilder.AddElevationProfile(i, heights));
+        }
+      } else {
+        auto profile = elevation_profile_cache.find(edge_info_offset);
+        if (profile != elevation_profile_cache.cend()) {
+          tilebuilder.SetElevationProfile(i, profile->second);
+        }
       }
 
       // Edge elevation information. If the edge is forward (with respect to the shape)
@@ -152,16 +188,16 @@ void add_elevation(const boost::property_tree::ptree& pt,
 
     // Update the tile
     tilebuilder.StoreTileData();
-
-    // Check if we need to clear the tile cache
-    if (graphreader.OverCommitted()) {
-      lock.lock();
-      graphreader.Trim();
-      lock.unlock();
-    }
   }
 }
 
+// The square degree of the elevation tile under the south west corner of a tile
+uint32_t elevation_tile(const GraphId& tile_id) {
+  const auto corner = TileHierarchy::GetGraphIdBoundingBox(tile_id).minpt();
+  return static_cast<uint32_t>(std::floor(corner.lat() + 90) * 360 +
+                               std::floor(corner.lng() + 180));
+}
+
 } // namespace
 
 namespace valhalla {
@@ -172,34 +208,32 @@ void ElevationBuilder::Build(const boost::property_tree::ptree& pt) {
   auto hierarchy_properties = pt.get_child("mjolnir");
   std::string tile_dir = hierarchy_properties.get<std::string>("tile_dir");
 
-  // Crack open some elevation data if its there. Return if it is not.
+  // Setup threads
+  uint32_t nthreads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  std::vector<std::shared_ptr<std::thread>> threads(nthreads);
+
+  // Crack open some elevation data if its there. Return if it is not. The threads share the
+  // unzipped elevation tiles, enough of them that each thread can keep the one its working in
+  // and the one next to it
   boost::optional<std::string> elevation = pt.get_optional<std::string>("additional_data.elevation");
   std::unique_ptr<const skadi::sample> sample;
   if (elevation && filesystem::exists(*elevation)) {
-    sample.reset(new skadi::sample(*elevation));
+    sample.reset(new skadi::sample(*elevation,
+                                   std::max<size_t>(skadi::sample::kDefaultCacheSize,
+                                                    2 * nthreads)));
   } else {
     LOG_INFO("ElevationBuilder: no elevation data, skipping");
     return;
   }
 
-  // Create a randomized queue of tiles (at all levels) to work from
-  std::deque<GraphId> tilequeue;
+  // Create a queue of tiles (at all levels) to work from. The tiles over the same elevation tile
+  // go one after the other so the threads work through the elevation tiles a few at a time
+  // rather than each unzipping different ones, the heaviest first
   GraphReader reader(pt.get_child("mjolnir"));
-  auto tileset = reader.GetTileSet();
-  for (const auto& id : tileset) {
-    tilequeue.emplace_back(id);
-  }
-  std::random_device rd;
-  std::shuffle(tilequeue.begin(), tilequeue.end(), std::mt19937(rd()));
-
-  // An mutex we can use to do the synchronization
-  std::mutex lock;
-
-  // Setup threads
-  uint32_t nthreads =
-      std::max(static_cast<unsigned int>(1),
-               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
-  std::vector<std::shared_ptr<std::thread>> threads(nthreads);
+  TileQueue tilequeue(reader.tile_dir(), reader.GetTileSet(), TileShard::FromConfig(pt),
+                      elevation_tile);
 
   // Setup promises. Hold the results for the threads
   std::vector<std::promise<uint32_t>> results(nthreads);
@@ -210,7 +244,7 @@ void ElevationBuilder::Build(const boost::property_tree::ptree& pt) {
   // Spawn the threads
   for (auto& thread : threads) {
     results.emplace_back();
-    thread.reset(new std::thread(add_elevation, std::cref(pt), std::ref(tilequeue), std::ref(lock),
+    thread.reset(new std::thread(add_elevation, std::cref(tile_dir), std::ref(tilequeue),
                                  std::cref(sample), std::ref(results.back())));
   }
 
@@ -218,6 +252,9 @@ void ElevationBuilder::Build(const boost::property_tree::ptree& pt) {
   for (auto& thread : threads) {
     thread->join();
   }
+  tilequeue.LogUtilization("ElevationBuilder");
+  LOG_INFO("Found unzipped elevation " + std::to_string(sample->cache_hits()) +
+           " times and unzipped it " + std::to_string(sample->cache_misses()) + " times");
 
   /** // Get the promise from the future
   for (auto& result : results) {
@@ -1,6 +1,10 @@
 #include "mjolnir/ferry_connections.h"
 
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <queue>
+#include <thread>
 #include <unordered_map>
 
 #include "baldr/graphconstants.h"
@@ -35,14 +39,14 @@ public:
 
 // Form the shortest path from the start node until a node that
 // touches the specified road classification.
-uint32_t ShortestPath(const uint32_t start_node_idx,
+std::vector<uint32_t> ShortestPath(const uint32_t start_node_idx,
                       const uint32_t node_idx,
-                      sequence<OSMWay>& ways,
-                      sequence<OSMWayNode>& way_nodes,
-                      sequence<Edge>& edges,
-                      sequence<Node>& nodes,
-                      const bool inbound,
-                      const uint32_t rc) {
+                                   sequence<OSMWay>& ways,
+                                   sequence<OSMWayNode>& way_nodes,
+                                   sequence<Edge>& edges,
+                                   sequence<Node>& nodes,
+                                   const bool inbound,
+                                   const uint32_t rc) {
   // Method to get the shape for an edge - since LL is stored as a pair of
   // floats we need to change into PointLL to get length of an edge
   const auto EdgeShape = [&way_nodes](size_t idx, const size_t count) {
@@ -169,13 +173,13 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
 
   // If only one label we have immediately found an edge with proper
   // classification - or we cannot expand due to driveability
+  std::vector<uint32_t> path;
   if (node_labels.size() == 1) {
     LOG_DEBUG("Only 1 edge reclassified");
-    return 0;
+    return path;
   }
 
-  // Trace shortest path backwards and upgrade edge classifications
-  uint32_t count = 0;
+  // Trace shortest path backwards and collect the edges to upgrade
   while (true) {
     // Get the edge between this node and the predecessor
     uint32_t idx = node_labels[index].node_index;
@@ -184,14 +188,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
     auto bundle2 = collect_node_edges(expand_node_itr, nodes, edges);
     for (auto& edge : bundle2.node_edges) {
       if (edge.first.sourcenode_ == pred_node || edge.first.targetnode_ == pred_node) {
-        sequence<Edge>::iterator element = edges[edge.second];
-        auto update_edge = *element;
-        if (update_edge.attributes.importance > rc) {
-          update_edge.attributes.importance = rc;
-          update_edge.attributes.reclass_ferry = true;
-          element = update_edge;
-          count++;
-        }
+        path.push_back(edge.second);
       }
     }
 
@@ -201,7 +198,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
     }
     index = node_status[pred_node].index;
   }
-  return count;
+  return path;
 }
 
 // Check if the ferry included in this node bundle is short. Must be
@@ -256,7 +253,8 @@ void ReclassifyFerryConnections(const std::string& ways_file,
                                 const std::string& way_nodes_file,
                                 const std::string& nodes_file,
                                 const std::string& edges_file,
-                                const uint32_t rc) {
+                                const uint32_t rc,
+                                const unsigned int concurrency) {
   LOG_INFO("Reclassifying ferry connection graph edges...");
 
   sequence<OSMWay> ways(ways_file, false);
@@ -268,10 +266,23 @@ void ReclassifyFerryConnections(const std::string& ways_file,
   // specified classification. Want to do simple shortest path (time based
   // only) and obey driveability.
 
+  // A search from the end node of an edge connected to a ferry and the path it found
+  struct search_t {
+    uint32_t start_node_idx;
+    uint32_t end_node_idx;
+    bool inbound;
+    std::vector<uint32_t> path;
+  };
+  // An edge connected to a ferry and the searches from its end node
+  struct ferry_edge_t {
+    uint32_t edge_idx;
+    size_t searches_end;
+  };
+  std::vector<search_t> searches;
+  std::vector<ferry_edge_t> ferry_edges;
+
   // Iterate through nodes and find any that connect to both a ferry and a
   // regular (non-ferry) edge. Skip short ferry edges (river crossing?)
-  uint32_t ferry_endpoint_count = 0;
-  uint32_t total_count = 0;
   sequence<Node>::iterator node_itr = nodes.begin();
   while (node_itr != nodes.end()) {
     auto bundle = collect_node_edges(node_itr, nodes, edges);
@@ -280,7 +291,6 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         !ShortFerry(node_itr.position(), bundle, edges, nodes, ways, way_nodes)) {
       // Form shortest path from node along each edge connected to the ferry,
       // track until the specified RC is reached
-      bool oneway_reverse = false;
       for (const auto& edge : bundle.node_edges) {
         // Skip ferry edges and non-driveable edges
         if (edge.first.attributes.driveable_ferry ||
@@ -289,7 +299,8 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         }
 
         // Expand/reclassify from the end node of this edge.
-        uint32_t end_node_idx = (edge.first.sourcenode_ == node_itr.position())
+        uint32_t start_node_idx = node_itr.position();
+        uint32_t end_node_idx = (edge.first.sourcenode_ == start_node_idx)
                                     ? edge.first.targetnode_
                                     : edge.first.sourcenode_;
 
@@ -300,35 +311,84 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         if (edge.first.attributes.driveableforward == edge.first.attributes.driveablereverse) {
           // Driveable in both directions - get an inbound path and an
           // outbound path.
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, true, rc);
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, false, rc);
+          searches.push_back({start_node_idx, end_node_idx, true, {}});
+          searches.push_back({start_node_idx, end_node_idx, false, {}});
         } else {
           // Check if oneway inbound to the ferry
-          bool inbound = (edge.first.sourcenode_ == node_itr.position())
+          bool inbound = (edge.first.sourcenode_ == start_node_idx)
                              ? edge.first.attributes.driveablereverse
                              : edge.first.attributes.driveableforward;
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, inbound, rc);
+          searches.push_back({start_node_idx, end_node_idx, inbound, {}});
         }
-        ferry_endpoint_count++;
-
-        // Reclassify the first/start edge. Do this AFTER finding shortest path so
-        // we do not immediately determine we hit the specified classification
-        sequence<Edge>::iterator element = edges[edge.second];
-        auto update_edge = *element;
-        update_edge.attributes.importance = rc;
-        element = update_edge;
-        total_count++;
+        ferry_edges.push_back({static_cast<uint32_t>(edge.second), searches.size()});
       }
     }
 
     // Go to the next node
     node_itr += bundle.node_count;
   }
+
+  // The searches only read the graph so they run in parallel, each thread with its own view of
+  // the files, and take the next search as they are done with their last one
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_lock;
+  auto work = [&]() {
+    try {
+      sequence<OSMWay> ways(ways_file, false);
+      sequence<OSMWayNode> way_nodes(way_nodes_file, false);
+      sequence<Edge> edges(edges_file, false);
+      sequence<Node> nodes(nodes_file, false);
+      for (size_t i = next++; i < searches.size(); i = next++) {
+        auto& search = searches[i];
+        search.path = ShortestPath(search.start_node_idx, search.end_node_idx, ways, way_nodes,
+                                   edges, nodes, search.inbound, rc);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_lock);
+      error = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t thread = 1; thread < std::min<size_t>(std::max(concurrency, 1u), searches.size());
+       ++thread) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  // Upgrade the edges along the paths in the order the ferries were found
+  uint32_t total_count = 0;
+  size_t search_idx = 0;
+  for (const auto& ferry_edge : ferry_edges) {
+    for (; search_idx < ferry_edge.searches_end; ++search_idx) {
+      for (const auto edge_idx : searches[search_idx].path) {
+        sequence<Edge>::iterator element = edges[edge_idx];
+        auto update_edge = *element;
+        if (update_edge.attributes.importance > rc) {
+          update_edge.attributes.importance = rc;
+          update_edge.attributes.reclass_ferry = true;
+          element = update_edge;
+          total_count++;
+        }
+      }
+    }
+
+    // Reclassify the first/start edge. Do this AFTER finding shortest path so
+    // we do not immediately determine we hit the specified classification
+    sequence<Edge>::iterator element = edges[ferry_edge.edge_idx];
+    auto update_edge = *element;
+    update_edge.attributes.importance = rc;
+    element = update_edge;
+    total_count++;
+  }
   LOG_INFO("Finished ReclassifyFerryEdges: ferry_endpoint_count = " +
-           std::to_string(ferry_endpoint_count) + ", " + std::to_string(total_count) +
+           std::to_string(ferry_edges.size()) + ", " + std::to_string(total_count) +
            " edges reclassified.");
 }
 
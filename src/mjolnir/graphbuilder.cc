@@ -25,6 +25,8 @@
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/linkclassification.h"
 #include "mjolnir/node_expander.h"
+#include "mjolnir/polygonstore.h"
+#include "mjolnir/tilequeue.h"
 #include "mjolnir/util.h"
 
 using namespace valhalla::midgard;
@@ -34,11 +36,13 @@ using namespace valhalla::mjolnir;
 namespace {
 
 /**
- * we need the nodes to be sorted by graphid and then by osmid to make a set of tiles
- * we also need to then update the edges that pointed to them
+ * we need the nodes to be sorted by graphid and then by osmid (or along a space filling curve)
+ * to make a set of tiles we also need to then update the edges that pointed to them
  *
  */
-std::map<GraphId, size_t> SortGraph(const std::string& nodes_file, const std::string& edges_file) {
+std::map<GraphId, size_t> SortGraph(const std::string& nodes_file,
+                                    const std::string& edges_file,
+                                    const bool spatial_order) {
   LOG_INFO("Sorting graph...");
 
   // Sort nodes by graphid then by osmid, so its basically a set of tiles
@@ -49,6 +53,41 @@ std::map<GraphId, size_t> SortGraph(const std::string& nodes_file, const std::st
     }
     return a.graph_id < b.graph_id;
   });
+
+  // Optionally lay the nodes of each tile out along a Hilbert curve rather than by osmid so that
+  // nodes which are near each other are also near each other in the tile, and so are their edges
+  // since those are written node by node. The copies of an osm node stay together as they share
+  // a spot on the curve and the osmid breaks the ties
+  if (spatial_order) {
+    constexpr uint32_t kCurveBits = 24;
+    const double cells = (1u << kCurveBits) - 1;
+    std::vector<std::pair<uint64_t, Node>> run;
+    auto reorder = [&nodes, &run](const size_t end) {
+      std::sort(run.begin(), run.end(),
+                [](const std::pair<uint64_t, Node>& a, const std::pair<uint64_t, Node>& b) {
+                  if (a.first == b.first) {
+                    return a.second.node.osmid_ < b.second.node.osmid_;
+                  }
+                  return a.first < b.first;
+                });
+      for (size_t i = 0; i < run.size(); ++i) {
+        auto element = nodes[end - run.size() + i];
+        element = run[i].second;
+      }
+      run.clear();
+    };
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const Node node = *nodes[i];
+      if (!run.empty() && run.front().second.graph_id != node.graph_id) {
+        reorder(i);
+      }
+      const auto ll = node.node.latlng();
+      auto x = static_cast<uint32_t>(cells * (ll.lng() + 180.) / 360.);
+      auto y = static_cast<uint32_t>(cells * (ll.lat() + 90.) / 180.);
+      run.emplace_back(hilbert_distance(x, y, kCurveBits), node);
+    }
+    reorder(nodes.size());
+  }
   // run through the sorted nodes, going back to the edges they reference and updating each edge
   // to point to the first (out of the duplicates) nodes index. at the end of this there will be
   // tons of nodes that no edges reference, but we need them because they are the means by which
@@ -337,8 +376,8 @@ void BuildTileSet(const std::string& ways_file,
                   const std::string& complex_restriction_to_file,
                   const std::string& tile_dir,
                   const OSMData& osmdata,
-                  std::map<GraphId, size_t>::const_iterator tile_start,
-                  std::map<GraphId, size_t>::const_iterator tile_end,
+                  const std::map<GraphId, size_t>& tiles,
+                  TileQueue& tile_queue,
                   const uint32_t tile_creation_date,
                   const boost::property_tree::ptree& pt,
                   std::promise<DataQuality>& result) {
@@ -357,20 +396,23 @@ void BuildTileSet(const std::string& ways_file,
   bool use_urban_tag = pt.get<bool>("data_processing.use_urban_tag", false);
   bool use_admin_db = pt.get<bool>("data_processing.use_admin_db", true);
 
-  // Initialize the admin DB (if it exists)
-  sqlite3* admin_db_handle = (database && use_admin_db) ? GetDBHandle(*database) : nullptr;
+  // Initialize the admin DB (if it exists), the packed admins are used instead if they are there
+  auto admin_store = (database && use_admin_db) ? GetPackedPolygons(*database) : nullptr;
+  sqlite3* admin_db_handle =
+      (database && use_admin_db && !admin_store) ? GetDBHandle(*database) : nullptr;
   if (!database && use_admin_db) {
     LOG_WARN("Admin db not found.  Not saving admin information.");
-  } else if (!admin_db_handle && use_admin_db) {
+  } else if (!admin_store && !admin_db_handle && use_admin_db) {
     LOG_WARN("Admin db " + *database + " not found.  Not saving admin information.");
   }
 
   database = pt.get_optional<std::string>("timezone");
-  // Initialize the tz DB (if it exists)
-  sqlite3* tz_db_handle = database ? GetDBHandle(*database) : nullptr;
+  // Initialize the tz DB (if it exists), the packed time zones are used instead if they are there
+  auto tz_store = database ? GetPackedPolygons(*database) : nullptr;
+  sqlite3* tz_db_handle = (database && !tz_store) ? GetDBHandle(*database) : nullptr;
   if (!database) {
     LOG_WARN("Time zone db not found.  Not saving time zone information.");
-  } else if (!tz_db_handle) {
+  } else if (!tz_store && !tz_db_handle) {
     LOG_WARN("Time zone db " + *database + " not found.  Not saving time zone information.");
   }
 
@@ -397,7 +439,10 @@ void BuildTileSet(const std::string& ways_file,
 
   ////////////////////////////////////////////////////////////////////////////
   // Iterate over tiles
-  for (; tile_start != tile_end; ++tile_start) {
+  const auto tile_end = tiles.end();
+  GraphId next_tile;
+  while (tile_queue.next(next_tile)) {
+    auto tile_start = tiles.find(next_tile);
     try {
       // What actually writes the tile
       GraphId tile_id = tile_start->first.Tile_Base();
@@ -419,9 +464,13 @@ void BuildTileSet(const std::string& ways_file,
       std::unordered_map<uint32_t, bool> drive_on_right;
       std::unordered_map<uint32_t, bool> allow_intersection_names;
 
-      if (admin_db_handle) {
-        admin_polys = GetAdminInfo(admin_db_handle, drive_on_right, allow_intersection_names,
-                                   tiling.TileBounds(id), graphtile);
+      if (admin_store || admin_db_handle) {
+        admin_polys = admin_store ? GetAdminInfo(*admin_store, drive_on_right,
+                                                 allow_intersection_names, tiling.TileBounds(id),
+                                                 graphtile)
+                                  : GetAdminInfo(admin_db_handle, drive_on_right,
+                                                 allow_intersection_names, tiling.TileBounds(id),
+                                                 graphtile);
         if (admin_polys.size() == 1) {
           // TODO - check if tile bounding box is entirely inside the polygon...
           tile_within_one_admin = true;
@@ -430,13 +479,18 @@ void BuildTileSet(const std::string& ways_file,
 
       bool tile_within_one_tz = false;
       std::unordered_multimap<uint32_t, multi_polygon_type> tz_polys;
-      if (tz_db_handle) {
-        tz_polys = GetTimeZones(tz_db_handle, tiling.TileBounds(id));
+      if (tz_store || tz_db_handle) {
+        tz_polys = tz_store ? GetTimeZones(*tz_store, tiling.TileBounds(id))
+                            : GetTimeZones(tz_db_handle, tiling.TileBounds(id));
         if (tz_polys.size() == 1) {
           tile_within_one_tz = true;
         }
       }
 
+      // Rasterize the polygons so most nodes dont need an exact test against them
+      const PolygonGrid admin_grid(admin_polys, tiling.TileBounds(id));
+      const PolygonGrid tz_grid(tz_polys, tiling.TileBounds(id));
+
       // Iterate through the nodes
       uint32_t idx = 0; // Current directed edge index
 
@@ -469,7 +523,7 @@ void BuildTileSet(const std::string& ways_file,
 
         if (use_admin_db) {
           admin_index = (tile_within_one_admin) ? admin_polys.begin()->first
-                                                : GetMultiPolyId(admin_polys, node_ll, graphtile);
+                                                : GetMultiPolyId(admin_grid, node_ll, graphtile);
           dor = drive_on_right[admin_index];
         } else {
           admin_index = graphtile.AddAdmin("", "", osmdata.node_names.name(node.country_iso_index()),
@@ -945,7 +999,7 @@ void BuildTileSet(const std::string& ways_file,
 
         // Set the time zone index
         uint32_t tz_index =
-            (tile_within_one_tz) ? tz_polys.begin()->first : GetMultiPolyId(tz_polys, node_ll);
+            (tile_within_one_tz) ? tz_polys.begin()->first : GetMultiPolyId(tz_grid, node_ll);
 
         graphtile.nodes().back().set_timezone(tz_index);
 
@@ -1007,41 +1061,44 @@ void BuildLocalTiles(const unsigned int thread_count,
   uint32_t tile_creation_date =
       DateTime::days_from_pivot_date(DateTime::get_formatted_date(DateTime::iso_date_time(tz)));
 
-  LOG_INFO("Building " + std::to_string(tiles.size()) + " tiles with " +
-           std::to_string(thread_count) + " threads...");
-
   // A place to hold worker threads and their results, be they exceptions or otherwise
   std::vector<std::shared_ptr<std::thread>> threads(thread_count);
 
   // Hold the results (DataQuality/stats) for the threads
   std::vector<std::promise<DataQuality>> results(threads.size());
 
-  // Divvy up the work
-  size_t floor = tiles.size() / threads.size();
-  size_t at_ceiling = tiles.size() - (threads.size() * floor);
-  std::map<GraphId, size_t>::const_iterator tile_start, tile_end = tiles.begin();
+  // The threads take the tiles with the most nodes first, the nodes of a tile run from its index
+  // to the index of the next one
+  std::vector<std::pair<GraphId, uint64_t>> weights;
+  weights.reserve(tiles.size());
+  for (auto tile = tiles.begin(); tile != tiles.end(); ++tile) {
+    auto next = std::next(tile);
+    weights.emplace_back(tile->first, next == tiles.end() ? 0 : next->second - tile->second);
+  }
+  if (!weights.empty()) {
+    sequence<Node> nodes(nodes_file, false);
+    weights.back().second = nodes.size() - tiles.rbegin()->second;
+  }
+  TileQueue tile_queue(std::move(weights), TileShard::FromConfig(pt));
+  LOG_INFO("Building " + std::to_string(tile_queue.size()) + " tiles with " +
+           std::to_string(thread_count) + " threads...");
 
-  // Atomically pass around stats info
   for (size_t i = 0; i < threads.size(); ++i) {
-    // Figure out how many this thread will work on (either ceiling or floor)
-    size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    std::advance(tile_end, tile_count);
     // Make the thread
     threads[i].reset(new std::thread(BuildTileSet, std::cref(ways_file), std::cref(way_nodes_file),
                                      std::cref(nodes_file), std::cref(edges_file),
                                      std::cref(complex_from_restriction_file),
                                      std::cref(complex_to_restriction_file), std::cref(tile_dir),
-                                     std::cref(osmdata), tile_start, tile_end, tile_creation_date,
-                                     std::cref(pt.get_child("mjolnir")), std::ref(results[i])));
+                                     std::cref(osmdata), std::cref(tiles), std::ref(tile_queue),
+                                     tile_creation_date, std::cref(pt.get_child("mjolnir")),
+                                     std::ref(results[i])));
   }
 
   // Join all the threads to wait for them to finish up their work
   for (auto& thread : threads) {
     thread->join();
   }
+  tile_queue.LogUtilization("GraphBuilder");
 
   LOG_INFO("Finished");
 
@@ -1077,22 +1134,12 @@ std::map<GraphId, size_t> GraphBuilder::BuildEdges(const boost::property_tree::p
                    return TileHierarchy::GetGraphId(node.latlng(), level);
                  },
                  pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true));
-  return SortGraph(nodes_file, edges_file);
-}
+  auto tiles =
+      SortGraph(nodes_file, edges_file, pt.get<bool>("mjolnir.data_processing.spatial_node_order",
+                                                     false));
 
-// Build the graph from the input
-void GraphBuilder::Build(const boost::property_tree::ptree& pt,
-                         const OSMData& osmdata,
-                         const std::string& ways_file,
-                         const std::string& way_nodes_file,
-                         const std::string& nodes_file,
-                         const std::string& edges_file,
-                         const std::string& complex_from_restriction_file,
-                         const std::string& complex_to_restriction_file,
-                         const std::map<GraphId, size_t>& tiles) {
-  // Reclassify links (ramps). Cannot do this when building tiles since the
-  // edge list needs to be modified
-  DataQuality stats;
+  // Reclassify links (ramps) and ferry connections here rather than when building the tiles, which
+  // may be split over several machines that can't all rewrite the shared edges at once
   if (pt.get<bool>("mjolnir.reclassify_links", true)) {
     ReclassifyLinks(ways_file, nodes_file, edges_file, way_nodes_file,
                     pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true));
@@ -1108,7 +1155,24 @@ void GraphBuilder::Build(const boost::property_tree::ptree& pt,
     }
   }
   ReclassifyFerryConnections(ways_file, way_nodes_file, nodes_file, edges_file,
-                             static_cast<uint32_t>(rc));
+                             static_cast<uint32_t>(rc),
+                             std::max(static_cast<unsigned int>(1),
+                                      pt.get<unsigned int>("mjolnir.concurrency",
+                                                           std::thread::hardware_concurrency())));
+  return tiles;
+}
+
+// Build the graph from the input
+void GraphBuilder::Build(const boost::property_tree::ptree& pt,
+                         const OSMData& osmdata,
+                         const std::string& ways_file,
+                         const std::string& way_nodes_file,
+                         const std::string& nodes_file,
+                         const std::string& edges_file,
+                         const std::string& complex_from_restriction_file,
+                         const std::string& complex_to_restriction_file,
+                         const std::map<GraphId, size_t>& tiles) {
+  DataQuality stats;
   unsigned int threads =
       std::max(static_cast<unsigned int>(1),
                pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
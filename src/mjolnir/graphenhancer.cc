@@ -2,6 +2,7 @@
 #include "mjolnir/admin.h"
 #include "mjolnir/countryaccess.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilequeue.h"
 #include "mjolnir/util.h"
 
 #include <cinttypes>
@@ -10,7 +11,6 @@
 #include <list>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <set>
 #include <stdexcept>
 #include <thread>
@@ -64,6 +64,8 @@ constexpr uint32_t kMaxNoThruTries = 256;
 constexpr float kDensityRadius = 2.0f;
 constexpr float kDensityRadius2 = kDensityRadius * kDensityRadius;
 constexpr float kDensityLatDeg = (kDensityRadius * kMetersPerKm) / kMetersPerDegreeLat;
+// Size (degrees of latitude) of the cells road lengths are summed in for density, about 100m
+constexpr float kDensityCellDeg = kDensityLatDeg / 20.0f;
 
 // Factors used to adjust speed assignments
 constexpr float kTurnChannelFactor = 1.25f;
@@ -919,55 +921,61 @@ bool IsNextEdgeInternal(const DirectedEdge directededge,
 }
 
 /**
- * Get the road density around the specified lat,lng position. This is a
- * value from 0-15 indicating a relative road density. This can be used
- * in costing methods to help avoid dense, urban areas.
- * @param  reader        Graph reader
- * @param  lock          Mutex for locking while tiles are retrieved
- * @param  ll            Lat,lng position
- * @param  maxdensity    (OUT) max density found
- * @param  tiles         Tiling (for getting list of required tiles)
- * @param  local_level   Level of the local tiles.
- * @return  Returns the relative road density (0-15) - higher values are
- *          more dense.
+ * The lengths of the roads around a tile summed into a fine grid of cells, so that the density
+ * around each node of the tile is a sum over the rows of cells within kDensityRadius of it rather
+ * than over all of the nodes of the tiles around it. The cells of each row keep a running total
+ * so the part of a row within the radius is found with a single subtraction.
  */
-uint32_t GetDensity(GraphReader& reader,
-                    std::mutex& lock,
-                    const PointLL& ll,
-                    enhancer_stats& stats,
-                    const Tiles<PointLL>& tiles,
-                    uint8_t local_level) {
-  // Radius is in km - turn into meters
-  float rm = kDensityRadius * kMetersPerKm;
-  float mr2 = rm * rm;
-
-  // Use distance approximator for all distance checks
-  DistanceApproximator<PointLL> approximator(ll);
-
-  // Get a list of tiles required for a node search within this radius
-  float lngdeg = (rm / DistanceApproximator<PointLL>::MetersPerLngDegree(ll.lat()));
-  AABB2<PointLL> bbox(Point2(ll.lng() - lngdeg, ll.lat() - kDensityLatDeg),
-                      Point2(ll.lng() + lngdeg, ll.lat() + kDensityLatDeg));
-  std::vector<int32_t> tilelist = tiles.TileList(bbox);
-
-  // For all tiles needed to find nodes within the radius...find nodes within
-  // the radius (squared) and add lengths of directed edges
-  float roadlengths = 0.0f;
-  for (const auto t : tilelist) {
-    // Check all the nodes within the tile. Skip if tile has no nodes (can be
-    // an empty tile added for connectivity map logic).
-    lock.lock();
-    auto newtile = reader.GetGraphTile(GraphId(t, local_level, 0));
-    lock.unlock();
-    if (!newtile || newtile->header()->nodecount() == 0) {
-      continue;
-    }
-    PointLL base_ll = newtile->header()->base_ll();
-    const auto start_node = newtile->node(0);
-    const auto end_node = start_node + newtile->header()->nodecount();
-    for (auto node = start_node; node < end_node; ++node) {
-      // Check if within radius
-      if (approximator.DistanceSquared(node->latlng(base_ll)) < mr2) {
+class DensityGrid {
+public:
+  /**
+   * Sums up the road lengths around the tile.
+   * @param  reader        Graph reader
+   * @param  lock          Mutex for locking while tiles are retrieved
+   * @param  bounds        Bounds of the tile whose nodes will be asked for
+   * @param  tiles         Tiling (for getting list of required tiles)
+   * @param  local_level   Level of the local tiles.
+   */
+  DensityGrid(GraphReader& reader,
+              std::mutex& lock,
+              const AABB2<PointLL>& bounds,
+              const Tiles<PointLL>& tiles,
+              uint8_t local_level) {
+    // Extend the bounds by the radius, at the latitude of the tile where a degree of longitude is
+    // the shortest, plus a cell
+    float rm = kDensityRadius * kMetersPerKm;
+    float max_lat = std::min(std::max(std::abs(bounds.miny()), std::abs(bounds.maxy())), 89.0);
+    float lngdeg = rm / DistanceApproximator<PointLL>::MetersPerLngDegree(max_lat);
+    cell_height_ = kDensityCellDeg;
+    cell_width_ = kDensityCellDeg * kMetersPerDegreeLat /
+                  DistanceApproximator<PointLL>::MetersPerLngDegree(bounds.Center().lat());
+    minx_ = bounds.minx() - lngdeg - cell_width_;
+    miny_ = bounds.miny() - kDensityLatDeg - cell_height_;
+    columns_ = std::ceil((bounds.maxx() + lngdeg + cell_width_ - minx_) / cell_width_);
+    rows_ = std::ceil((bounds.maxy() + kDensityLatDeg + cell_height_ - miny_) / cell_height_);
+    sums_.resize(rows_ * (columns_ + 1), 0.0);
+
+    // Add the lengths of the directed edges leaving each node to the cell it is in
+    AABB2<PointLL> bbox(Point2(minx_, miny_),
+                        Point2(minx_ + columns_ * cell_width_, miny_ + rows_ * cell_height_));
+    for (const auto t : tiles.TileList(bbox)) {
+      // Skip if tile has no nodes (can be an empty tile added for connectivity map logic).
+      lock.lock();
+      auto newtile = reader.GetGraphTile(GraphId(t, local_level, 0));
+      lock.unlock();
+      if (!newtile || newtile->header()->nodecount() == 0) {
+        continue;
+      }
+      PointLL base_ll = newtile->header()->base_ll();
+      const auto start_node = newtile->node(0);
+      const auto end_node = start_node + newtile->header()->nodecount();
+      for (auto node = start_node; node < end_node; ++node) {
+        auto ll = node->latlng(base_ll);
+        int32_t column = std::floor((ll.lng() - minx_) / cell_width_);
+        int32_t row = std::floor((ll.lat() - miny_) / cell_height_);
+        if (column < 0 || column >= columns_ || row < 0 || row >= rows_) {
+          continue;
+        }
         // Get all directed edges and add length
         const DirectedEdge* directededge = newtile->directededge(node->edge_index());
         for (uint32_t i = 0; i < node->edge_count(); i++, directededge++) {
@@ -975,13 +983,81 @@ uint32_t GetDensity(GraphReader& reader,
           if (directededge->is_road() || directededge->use() == Use::kRamp ||
               directededge->use() == Use::kTurnChannel || directededge->use() == Use::kAlley ||
               directededge->use() == Use::kEmergencyAccess) {
-            roadlengths += directededge->length();
+            sums_[row * (columns_ + 1) + column + 1] += directededge->length();
           }
         }
       }
     }
+
+    // Turn each row into running totals
+    for (int32_t row = 0; row < rows_; ++row) {
+      auto* sums = &sums_[row * (columns_ + 1)];
+      for (int32_t column = 0; column < columns_; ++column) {
+        sums[column + 1] += sums[column];
+      }
+    }
+  }
+
+  /**
+   * Gets the length of the roads at the nodes within kDensityRadius of a position, where a node
+   * counts as being where the center of its cell is.
+   * @param  ll  Lat,lng position within the bounds of the tile.
+   * @return the length (meters) of the directed edges
+   */
+  float RoadLengths(const PointLL& ll) const {
+    float rm = kDensityRadius * kMetersPerKm;
+    float mr2 = rm * rm;
+    float lngm = DistanceApproximator<PointLL>::MetersPerLngDegree(ll.lat());
+    // Positions in cells, relative to the cell centers
+    double x = (ll.lng() - minx_) / cell_width_ - 0.5;
+    double y = (ll.lat() - miny_) / cell_height_ - 0.5;
+    double half_rows = kDensityLatDeg / cell_height_;
+    int32_t first_row = std::max(0.0, std::ceil(y - half_rows));
+    int32_t last_row = std::min(rows_ - 1.0, std::floor(y + half_rows));
+    double roadlengths = 0.0;
+    for (int32_t row = first_row; row <= last_row; ++row) {
+      // The part of the row whose cell centers are within the radius
+      float dy = (row - y) * cell_height_ * kMetersPerDegreeLat;
+      float dx2 = mr2 - dy * dy;
+      if (dx2 <= 0.0f) {
+        continue;
+      }
+      double half_columns = std::sqrt(dx2) / lngm / cell_width_;
+      int32_t first = std::max(0.0, std::ceil(x - half_columns));
+      int32_t last = std::min(columns_ - 1.0, std::floor(x + half_columns));
+      if (first <= last) {
+        const auto* sums = &sums_[row * (columns_ + 1)];
+        roadlengths += sums[last + 1] - sums[first];
+      }
+    }
+    return roadlengths;
   }
 
+protected:
+  double minx_;
+  double miny_;
+  double cell_width_;
+  double cell_height_;
+  int32_t columns_;
+  int32_t rows_;
+  // per row the total length of the roads in all of the cells before each one
+  std::vector<double> sums_;
+};
+
+/**
+ * Get the road density around the specified lat,lng position. This is a
+ * value from 0-15 indicating a relative road density. This can be used
+ * in costing methods to help avoid dense, urban areas.
+ * @param  grid          Road lengths around the tile of the position
+ * @param  ll            Lat,lng position
+ * @param  maxdensity    (OUT) max density found
+ * @return  Returns the relative road density (0-15) - higher values are
+ *          more dense.
+ */
+uint32_t GetDensity(const DensityGrid& grid, const PointLL& ll, enhancer_stats& stats) {
+  // For all nodes within the radius add lengths of directed edges
+  float roadlengths = grid.RoadLengths(ll);
+
   // Form density measure as km/km^2. Convert roadlengths to km and divide by 2
   // (since 2 directed edges per edge)
   float density = (roadlengths * 0.0005f) / (kPi * kDensityRadius2);
@@ -1421,7 +1497,7 @@ void enhance(const boost::property_tree::ptree& pt,
              const OSMData& osmdata,
              const std::string& access_file,
              const boost::property_tree::ptree& hierarchy_properties,
-             std::queue<GraphId>& tilequeue,
+             TileQueue& tilequeue,
              std::mutex& lock,
              std::promise<enhancer_stats>& result) {
 
@@ -1467,16 +1543,10 @@ void enhance(const boost::property_tree::ptree& pt,
   const auto& tiles = TileHierarchy::levels().back().tiles;
 
   // Iterate through the tiles in the queue and perform enhancements
-  while (true) {
-    // Get the next tile Id from the queue and get writeable and readable
-    // tile. Lock while we access the tile queue and get the tile.
+  GraphId tile_id;
+  while (tilequeue.next(tile_id)) {
+    // Get writeable and readable tile. Lock while we get the tile.
     lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop();
 
     // Get a readable tile.If the tile is empty, skip it. Empty tiles are
     // added where ways go through a tile but no end not is within the tile.
@@ -1576,6 +1646,12 @@ void enhance(const boost::property_tree::ptree& pt,
       }
     }
 
+    // Sum up the road lengths around the tile once for the density of all of its nodes
+    std::unique_ptr<DensityGrid> density_grid;
+    if (!use_urban_tag) {
+      density_grid.reset(new DensityGrid(reader, lock, tiles.TileBounds(id), tiles, local_level));
+    }
+
     // Second pass - add admin information and edge transition information.
     PointLL base_ll = tilebuilder->header()->base_ll();
     for (uint32_t i = 0; i < tilebuilder->header()->nodecount(); i++) {
@@ -1585,7 +1661,7 @@ void enhance(const boost::property_tree::ptree& pt,
       // Get relative road density and local density if the urban tag is not set
       uint32_t density = 0;
       if (!use_urban_tag) {
-        density = GetDensity(reader, lock, nodeinfo.latlng(base_ll), stats, tiles, local_level);
+        density = GetDensity(*density_grid, nodeinfo.latlng(base_ll), stats);
         nodeinfo.set_density(density);
       }
 
@@ -1858,18 +1934,12 @@ void GraphEnhancer::Enhance(const boost::property_tree::ptree& pt,
   // A place to hold the results of those threads, exceptions or otherwise
   std::list<std::promise<enhancer_stats>> results;
 
-  // Create a randomized queue of tiles to work from
-  std::deque<GraphId> tempqueue;
+  // The tiles to work from, the largest first
   boost::property_tree::ptree hierarchy_properties = pt.get_child("mjolnir");
   auto local_level = TileHierarchy::levels().back().level;
   GraphReader reader(hierarchy_properties);
-  auto local_tiles = reader.GetTileSet(local_level);
-  for (const auto& tile_id : local_tiles) {
-    tempqueue.emplace_back(tile_id);
-  }
-  std::random_device rd;
-  std::shuffle(tempqueue.begin(), tempqueue.end(), std::mt19937(rd()));
-  std::queue<GraphId> tilequeue(tempqueue);
+  TileQueue tilequeue(reader.tile_dir(), reader.GetTileSet(local_level),
+                      TileShard::FromConfig(pt));
 
   // An atomic object we can use to do the synchronization
   std::mutex lock;
@@ -1886,6 +1956,7 @@ void GraphEnhancer::Enhance(const boost::property_tree::ptree& pt,
   for (auto& thread : threads) {
     thread->join();
   }
+  tilequeue.LogUtilization("GraphEnhancer");
 
   // Check all of the outcomes, to see about maximum density (km/km2)
   enhancer_stats stats{std::numeric_limits<float>::min(), 0};
@@ -1,8 +1,12 @@
 #include "mjolnir/graphfilter.h"
+#include "mjolnir/complexrestrictionbuilder.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/graphvalidator.h"
 
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <unordered_map>
 #include <vector>
 
@@ -31,6 +35,79 @@ uint32_t can_aggregate = 0;
 // Group wheelchair and pedestrian access together
 constexpr uint32_t kAllPedestrianAccess = (kPedestrianAccess | kWheelchairAccess);
 
+/**
+ * Copies the signs, turn lanes, access restrictions, lane connections, shape and names of a
+ * directed edge over to the copy of it about to be added to a tile.
+ * @param  tile         Tile the edge is copied from.
+ * @param  edgeid       Id of the edge in that tile.
+ * @param  nodeid       Id of the node the edge starts at in that tile.
+ * @param  tilebuilder  Builder of the tile the edge is copied to.
+ * @param  newedge      The copy of the edge, gets the offset of its edge info in the new tile.
+ * @return the way Id of the edge
+ */
+uint64_t CopyEdgeData(const graph_tile_ptr& tile,
+                      const GraphId& edgeid,
+                      const GraphId& nodeid,
+                      GraphTileBuilder& tilebuilder,
+                      DirectedEdge& newedge) {
+  const DirectedEdge* directededge = tile->directededge(edgeid);
+
+  // Get signs from the base directed edge
+  if (directededge->sign()) {
+    std::vector<SignInfo> signs = tile->GetSigns(edgeid.id());
+    if (signs.size() == 0) {
+      LOG_ERROR("Base edge should have signs, but none found");
+    }
+    tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
+  }
+
+  // Get turn lanes from the base directed edge
+  if (directededge->turnlanes()) {
+    uint32_t offset = tile->turnlanes_offset(edgeid.id());
+    tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
+  }
+
+  // Get access restrictions from the base directed edge. Add these to
+  // the list of access restrictions in the new tile. Update the
+  // edge index in the restriction to be the current directed edge Id
+  if (directededge->access_restriction()) {
+    auto restrictions = tile->GetAccessRestrictions(edgeid.id(), kAllAccess);
+    for (const auto& res : restrictions) {
+      tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
+                                                         res.type(), res.modes(), res.value()));
+    }
+  }
+
+  // Copy lane connectivity
+  if (directededge->laneconnectivity()) {
+    auto laneconnectivity = tile->GetLaneConnectivity(edgeid.id());
+    if (laneconnectivity.size() == 0) {
+      LOG_ERROR("Base edge should have lane connectivity, but none found");
+    }
+    for (auto& lc : laneconnectivity) {
+      lc.set_to(tilebuilder.directededges().size());
+    }
+    tilebuilder.AddLaneConnectivity(laneconnectivity);
+  }
+
+  // Get edge info, shape, and names from the old tile and add to the
+  // new. Cannot use edge info offset since edges in arterial and
+  // highway hierarchy can cross base tiles! Use a hash based on the
+  // encoded shape plus way Id.
+  bool added;
+  uint32_t idx = directededge->edgeinfo_offset();
+  auto edgeinfo = tile->edgeinfo(idx);
+  std::string encoded_shape = edgeinfo.encoded_shape();
+  uint32_t w = std::hash<std::string>{}(encoded_shape + std::to_string(edgeinfo.wayid()));
+  uint32_t edge_info_offset =
+      tilebuilder.AddEdgeInfo(w, nodeid, directededge->endnode(), edgeinfo.wayid(),
+                              edgeinfo.mean_elevation(), edgeinfo.bike_network(),
+                              edgeinfo.speed_limit(), encoded_shape, tile->GetNames(idx),
+                              tile->GetNames(idx, true), tile->GetTypes(idx), added);
+  newedge.set_edgeinfo_offset(edge_info_offset);
+  return edgeinfo.wayid();
+}
+
 /**
  * Filter edges to optionally remove edges by access.
  * @param  reader  Graph reader.
@@ -71,7 +148,6 @@ void FilterTiles(GraphReader& reader,
     graph_tile_ptr tile = reader.GetGraphTile(tile_id);
     assert(tile);
 
-    std::hash<std::string> hasher;
     GraphId nodeid(tile_id.tileid(), tile_id.level(), 0);
     for (uint32_t i = 0; i < tile->header()->nodecount(); ++i, ++nodeid) {
       // Count of edges added for this node
@@ -99,60 +175,8 @@ void FilterTiles(GraphReader& reader,
         // Set opposing edge indexes to 0 (gets set in graph validator).
         newedge.set_opp_index(0);
 
-        // Get signs from the base directed edge
-        if (directededge->sign()) {
-          std::vector<SignInfo> signs = tile->GetSigns(edgeid.id());
-          if (signs.size() == 0) {
-            LOG_ERROR("Base edge should have signs, but none found");
-          }
-          tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
-        }
-
-        // Get turn lanes from the base directed edge
-        if (directededge->turnlanes()) {
-          uint32_t offset = tile->turnlanes_offset(edgeid.id());
-          tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
-        }
-
-        // Get access restrictions from the base directed edge. Add these to
-        // the list of access restrictions in the new tile. Update the
-        // edge index in the restriction to be the current directed edge Id
-        if (directededge->access_restriction()) {
-          auto restrictions = tile->GetAccessRestrictions(edgeid.id(), kAllAccess);
-          for (const auto& res : restrictions) {
-            tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
-                                                               res.type(), res.modes(), res.value()));
-          }
-        }
-
-        // Copy lane connectivity
-        if (directededge->laneconnectivity()) {
-          auto laneconnectivity = tile->GetLaneConnectivity(edgeid.id());
-          if (laneconnectivity.size() == 0) {
-            LOG_ERROR("Base edge should have lane connectivity, but none found");
-          }
-          for (auto& lc : laneconnectivity) {
-            lc.set_to(tilebuilder.directededges().size());
-          }
-          tilebuilder.AddLaneConnectivity(laneconnectivity);
-        }
-
-        // Get edge info, shape, and names from the old tile and add to the
-        // new. Cannot use edge info offset since edges in arterial and
-        // highway hierarchy can cross base tiles! Use a hash based on the
-        // encoded shape plus way Id.
-        bool added;
-        uint32_t idx = directededge->edgeinfo_offset();
-        auto edgeinfo = tile->edgeinfo(idx);
-        std::string encoded_shape = edgeinfo.encoded_shape();
-        uint32_t w = hasher(encoded_shape + std::to_string(edgeinfo.wayid()));
-        uint32_t edge_info_offset =
-            tilebuilder.AddEdgeInfo(w, nodeid, directededge->endnode(), edgeinfo.wayid(),
-                                    edgeinfo.mean_elevation(), edgeinfo.bike_network(),
-                                    edgeinfo.speed_limit(), encoded_shape, tile->GetNames(idx),
-                                    tile->GetNames(idx, true), tile->GetTypes(idx), added);
-        newedge.set_edgeinfo_offset(edge_info_offset);
-        wayid.push_back(edgeinfo.wayid());
+        // Copy the signs, names and everything else of the edge
+        wayid.push_back(CopyEdgeData(tile, edgeid, nodeid, tilebuilder, newedge));
         endnode.push_back(directededge->endnode());
 
         // Add directed edge
@@ -276,6 +300,272 @@ void UpdateEndNodes(GraphReader& reader, std::unordered_map<GraphId, GraphId>& o
   }
 }
 
+// The index of a node or directed edge that is not in an extract
+constexpr uint32_t kDropped = std::numeric_limits<uint32_t>::max();
+
+// Where the nodes and directed edges of the tiles of an extract end up, by their index in the
+// original tile. Tiles without any node kept are not in it
+struct renumbering_t {
+  std::unordered_map<GraphId, std::vector<uint32_t>> nodes;
+  std::unordered_map<GraphId, std::vector<uint32_t>> edges;
+
+  GraphId node(const GraphId& id) const {
+    return find(nodes, id);
+  }
+
+  GraphId edge(const GraphId& id) const {
+    return find(edges, id);
+  }
+
+  static GraphId find(const std::unordered_map<GraphId, std::vector<uint32_t>>& ids,
+                      const GraphId& id) {
+    auto tile = ids.find(id.Tile_Base());
+    if (tile == ids.end() || id.id() >= tile->second.size() || tile->second[id.id()] == kDropped) {
+      return {};
+    }
+    return {id.tileid(), id.level(), tile->second[id.id()]};
+  }
+};
+
+/**
+ * Decides which nodes and directed edges of all the tiles go into an extract and where to,
+ * before any of it is written, so that the ids pointing into other tiles can be renumbered too.
+ * @param  reader        Graph reader of the original tiles.
+ * @param  include_edge  Whether a directed edge goes into the extract.
+ * @return the renumbering of the kept nodes and edges
+ */
+template <typename include_t>
+renumbering_t PlanExtract(GraphReader& reader, const include_t& include_edge) {
+  renumbering_t ids;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() == transit_level) {
+      continue;
+    }
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    assert(tile);
+    std::vector<uint32_t> nodes(tile->header()->nodecount(), kDropped);
+    std::vector<uint32_t> edges(tile->header()->directededgecount(), kDropped);
+    uint32_t node_count = 0, edge_count = 0;
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+      const NodeInfo* nodeinfo = tile->node(i);
+      const uint32_t first_edge = edge_count;
+      for (uint32_t j = 0; j < nodeinfo->edge_count(); ++j) {
+        const uint32_t idx = nodeinfo->edge_index() + j;
+        if (include_edge(tile->directededge(idx))) {
+          edges[idx] = edge_count++;
+        }
+      }
+      // a node stays as long as any of its edges do
+      if (edge_count > first_edge) {
+        nodes[i] = node_count++;
+      }
+    }
+    n_original_nodes += nodes.size();
+    n_original_edges += edges.size();
+    n_filtered_nodes += nodes.size() - node_count;
+    n_filtered_edges += edges.size() - edge_count;
+    if (node_count > 0) {
+      ids.nodes.emplace(tile_id, std::move(nodes));
+      ids.edges.emplace(tile_id, std::move(edges));
+    }
+
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  return ids;
+}
+
+/**
+ * Copies a complex restriction with the ids of its edges in the extract.
+ * @param  restriction  The restriction in the original tiles.
+ * @param  ids          The renumbering of the extract.
+ * @param  builder      The copy.
+ * @return false if any of the edges of the restriction is not in the extract
+ */
+bool CopyComplexRestriction(const ComplexRestriction& restriction,
+                            const renumbering_t& ids,
+                            ComplexRestrictionBuilder& builder) {
+  builder.set_from_id(ids.edge(restriction.from_graphid()));
+  builder.set_to_id(ids.edge(restriction.to_graphid()));
+  bool complete = builder.from_graphid().Is_Valid() && builder.to_graphid().Is_Valid();
+  std::vector<GraphId> vias;
+  restriction.WalkVias([&](const GraphId* via) {
+    vias.push_back(ids.edge(*via));
+    complete = complete && vias.back().Is_Valid();
+    return WalkingVia::KeepWalking;
+  });
+  builder.set_via_list(vias);
+  builder.set_type(restriction.type());
+  builder.set_modes(restriction.modes());
+  builder.set_dt(restriction.has_dt());
+  builder.set_begin_day_dow(restriction.begin_day_dow());
+  builder.set_begin_hrs(restriction.begin_hrs());
+  builder.set_begin_mins(restriction.begin_mins());
+  builder.set_begin_month(restriction.begin_month());
+  builder.set_begin_week(restriction.begin_week());
+  builder.set_dow(restriction.dow());
+  builder.set_dt_type(restriction.dt_type());
+  builder.set_end_day_dow(restriction.end_day_dow());
+  builder.set_end_hrs(restriction.end_hrs());
+  builder.set_end_mins(restriction.end_mins());
+  builder.set_end_month(restriction.end_month());
+  builder.set_end_week(restriction.end_week());
+  return complete;
+}
+
+/**
+ * Writes the kept nodes and directed edges of a tile to the extract, with everything of them
+ * that is stored in the tile. Opposing edges, bins and edge bounds are left to the validator.
+ * @param  reader    Graph reader of the original tiles.
+ * @param  tile_id   The tile.
+ * @param  tile_dir  Directory of the extract.
+ * @param  ids       The renumbering of the extract.
+ */
+void ExtractTile(GraphReader& reader,
+                 const GraphId& tile_id,
+                 const std::string& tile_dir,
+                 const renumbering_t& ids) {
+  graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+  assert(tile);
+  const auto& node_ids = ids.nodes.at(tile_id);
+  const auto& edge_ids = ids.edges.at(tile_id);
+
+  // Start from the header of the original tile without what is only added after storing it
+  GraphTileBuilder tilebuilder(tile_dir, tile_id, false);
+  GraphTileHeader& header = tilebuilder.header_builder();
+  header = *tile->header();
+  header.set_compressed_sections_offset(0);
+  header.set_has_ext_directededge(false);
+  header.set_predictedspeeds_offset(0);
+  header.set_predictedspeeds_count(0);
+  const uint32_t no_bins[kBinCount] = {};
+  header.set_edge_bin_offsets(no_bins);
+
+  // The edges with predicted speeds or elevation profiles by their index in the extract
+  std::vector<std::pair<uint32_t, const DirectedEdge*>> speeds;
+  std::vector<std::pair<uint32_t, const DirectedEdge*>> profiles;
+  const bool has_profiles = tile->header()->elevation_profiles_offset();
+
+  GraphId nodeid(tile_id.tileid(), tile_id.level(), 0);
+  for (uint32_t i = 0; i < tile->header()->nodecount(); ++i, ++nodeid) {
+    if (node_ids[i] == kDropped) {
+      continue;
+    }
+    const NodeInfo* nodeinfo = tile->node(i);
+    NodeInfo node = *nodeinfo;
+    node.set_edge_index(tilebuilder.directededges().size());
+    const auto& admin = tile->admininfo(nodeinfo->admin_index());
+    node.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
+                                              admin.country_iso(), admin.state_iso()));
+
+    // Keep the transitions to the nodes on other levels that are in the extract
+    node.set_transition_index(tilebuilder.transitions().size());
+    for (uint32_t t = 0; t < nodeinfo->transition_count(); ++t) {
+      const NodeTransition* transition = tile->transition(nodeinfo->transition_index() + t);
+      const GraphId endnode = ids.node(transition->endnode());
+      if (endnode.Is_Valid()) {
+        tilebuilder.transitions().emplace_back(endnode, transition->up());
+      }
+    }
+    node.set_transition_count(tilebuilder.transitions().size() - node.transition_index());
+
+    // Get named signs from the base node
+    if (nodeinfo->named_intersection()) {
+      tilebuilder.AddSigns(tilebuilder.nodes().size(), tile->GetSigns(i, true));
+    }
+
+    // Edges superseded by a shortcut that is not kept are no longer superseded
+    uint32_t shortcuts = 0;
+    for (uint32_t j = 0; j < nodeinfo->edge_count(); ++j) {
+      if (edge_ids[nodeinfo->edge_index() + j] != kDropped) {
+        shortcuts |= tile->directededge(nodeinfo->edge_index() + j)->shortcut();
+      }
+    }
+
+    GraphId edgeid(nodeid.tileid(), nodeid.level(), nodeinfo->edge_index());
+    for (uint32_t j = 0; j < nodeinfo->edge_count(); ++j, ++edgeid) {
+      if (edge_ids[edgeid.id()] == kDropped) {
+        continue;
+      }
+      const DirectedEdge* directededge = tile->directededge(edgeid);
+      DirectedEdge newedge = *directededge;
+      newedge.set_opp_index(0);
+      const GraphId endnode = ids.node(directededge->endnode());
+      if (!endnode.Is_Valid()) {
+        LOG_ERROR("Extract - failed to find the end node of a kept edge");
+      }
+      newedge.set_endnode(endnode);
+      if (directededge->superseded() & ~shortcuts) {
+        newedge.set_superseded(0);
+      }
+      CopyEdgeData(tile, edgeid, nodeid, tilebuilder, newedge);
+
+      // Complex restrictions are found by the edge they end on going forward and start on in
+      // reverse, only those whose edges are all kept stay
+      for (const auto* restriction : tile->GetRestrictions(true, edgeid, kAllAccess)) {
+        ComplexRestrictionBuilder builder;
+        if (CopyComplexRestriction(*restriction, ids, builder)) {
+          tilebuilder.AddForwardComplexRestriction(builder);
+        }
+      }
+      for (const auto* restriction : tile->GetRestrictions(false, edgeid, kAllAccess)) {
+        ComplexRestrictionBuilder builder;
+        if (CopyComplexRestriction(*restriction, ids, builder)) {
+          tilebuilder.AddReverseComplexRestriction(builder);
+        }
+      }
+
+      if (directededge->has_predicted_speed()) {
+        speeds.emplace_back(tilebuilder.directededges().size(), directededge);
+      }
+      if (has_profiles) {
+        profiles.emplace_back(tilebuilder.directededges().size(), directededge);
+      }
+      tilebuilder.directededges().emplace_back(std::move(newedge));
+    }
+    node.set_edge_count(tilebuilder.directededges().size() - node.edge_index());
+    tilebuilder.nodes().emplace_back(std::move(node));
+  }
+
+  // The elevation profiles can only be added once all the edges are, both directions of an edge
+  // share theirs as they do the shape
+  std::unordered_map<uint32_t, uint32_t> shared_profiles;
+  for (const auto& profile : profiles) {
+    const uint32_t edgeinfo_offset = tilebuilder.directededges()[profile.first].edgeinfo_offset();
+    auto shared = shared_profiles.find(edgeinfo_offset);
+    if (shared != shared_profiles.end()) {
+      tilebuilder.SetElevationProfile(profile.first, shared->second);
+      continue;
+    }
+    auto heights = tile->GetElevationProfile(profile.second);
+    if (heights.empty()) {
+      continue;
+    }
+    if (!profile.second->forward()) {
+      std::reverse(heights.begin(), heights.end());
+    }
+    shared_profiles.emplace(edgeinfo_offset,
+                            tilebuilder.AddElevationProfile(profile.first, {heights.begin(),
+                                                                            heights.end()}));
+  }
+  tilebuilder.StoreTileData();
+
+  // The predicted speeds go after everything else in the stored tile
+  if (!speeds.empty()) {
+    GraphTileBuilder speedbuilder(tile_dir, tile_id, false);
+    for (const auto& speed : speeds) {
+      const int16_t* coefficients = tile->GetPredictedSpeedProfile(speed.second);
+      speedbuilder.AddPredictedSpeed(speed.first,
+                                     std::vector<int16_t>(coefficients,
+                                                          coefficients + kCoefficientCount),
+                                     speeds.size());
+    }
+    speedbuilder.UpdatePredictedSpeeds(tilebuilder.directededges());
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -324,5 +614,45 @@ void GraphFilter::Filter(const boost::property_tree::ptree& pt) {
   LOG_INFO("Done GraphFilter");
 }
 
+// Write a copy of the tiles with only what some access modes use.
+void GraphFilter::Extract(const boost::property_tree::ptree& pt,
+                          const std::string& tile_dir,
+                          const uint32_t access) {
+  LOG_INFO("GraphFilter: Extract the edges of access modes " + std::to_string(access) + " to " +
+           tile_dir);
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // Transit is not kept so neither are the edges connecting to it
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  auto include_edge = [access, transit_level](const DirectedEdge* edge) {
+    return ((edge->forwardaccess() | edge->reverseaccess()) & access) &&
+           edge->endnode().level() != transit_level;
+  };
+  auto ids = PlanExtract(reader, include_edge);
+  LOG_INFO("Filtered " + std::to_string(n_filtered_nodes) + " nodes out of " +
+           std::to_string(n_original_nodes));
+  LOG_INFO("Filtered " + std::to_string(n_filtered_edges) + " directededges out of " +
+           std::to_string(n_original_edges));
+
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (ids.nodes.count(tile_id)) {
+      ExtractTile(reader, tile_id, tile_dir, ids);
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // Set the opposing edges, bin the edges and so on in the extract as for any build
+  auto extract_pt = pt;
+  auto& mjolnir = extract_pt.get_child("mjolnir");
+  mjolnir.put("tile_dir", tile_dir);
+  mjolnir.erase("tile_extract");
+  mjolnir.erase("tile_url");
+  GraphValidator::Validate(extract_pt);
+
+  LOG_INFO("Done GraphFilter extract");
+}
+
 } // namespace mjolnir
 } // namespace valhalla
@@ -7,6 +7,7 @@
 #include "midgard/logging.h"
 #include <algorithm>
 #include <boost/format.hpp>
+#include <cstdio>
 #include <list>
 #include <set>
 #include <stdexcept>
@@ -16,6 +17,57 @@ using namespace valhalla::baldr;
 namespace valhalla {
 namespace mjolnir {
 
+namespace {
+
+// Appends raw bytes of a part of a tile to it
+void append(std::string& data, const void* begin, const size_t size) {
+  data.append(reinterpret_cast<const char*>(begin), size);
+}
+
+// Moves the offsets of everything after the bins by some bytes
+// NOTE: if format changes to add more things here we need to make a change here as well
+void shift_offsets(GraphTileHeader& header, const uint32_t shift) {
+  header.set_complex_restriction_forward_offset(header.complex_restriction_forward_offset() +
+                                                 shift);
+  header.set_complex_restriction_reverse_offset(header.complex_restriction_reverse_offset() +
+                                                 shift);
+  header.set_edgeinfo_offset(header.edgeinfo_offset() + shift);
+  header.set_textlist_offset(header.textlist_offset() + shift);
+  header.set_lane_connectivity_offset(header.lane_connectivity_offset() + shift);
+  if (header.elevation_profiles_offset()) {
+    header.set_elevation_profiles_offset(header.elevation_profiles_offset() + shift);
+  }
+  if (header.predictedspeeds_count()) {
+    header.set_predictedspeeds_offset(header.predictedspeeds_offset() + shift);
+  }
+  header.set_end_offset(header.end_offset() + shift);
+}
+
+// Writes the tile in one go to a file next to it and moves that over the tile once complete, so
+// that anything sharing the tile_dir or still mapping the old tile never sees a half written one.
+// Many small writes per tile are what made writing them slow on network filesystems and cloud disks
+void write_tile(const filesystem::path& filename,
+                const std::string& data,
+                const std::string& what) {
+  // Make sure the directory exists on the system
+  if (!filesystem::exists(filename.parent_path())) {
+    filesystem::create_directories(filename.parent_path());
+  }
+
+  std::string partial = filename.string() + ".partial";
+  std::ofstream file(partial.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error(what + "Failed to open file " + filename.string());
+  }
+  file.write(data.data(), data.size());
+  file.close();
+  if (!file || std::rename(partial.c_str(), filename.c_str()) != 0) {
+    throw std::runtime_error(what + "Failed to write file " + filename.string());
+  }
+}
+
+} // namespace
+
 // Constructor given an existing tile. This is used to read in the tile
 // data and then add to it (e.g. adding node connections between hierarchy
 // levels. If the deserialize flag is set then all objects are serialized
@@ -32,6 +84,8 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
     header_builder_ = *header_;
   }
   header_builder_.set_graphid(graphid);
+  // whatever is stored is stored in full
+  header_builder_.set_compressed_sections_offset(0);
 
   // Done if not deserializing and creating builders for everything
   if (!deserialize) {
@@ -45,6 +99,9 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
     return;
   }
 
+  // All of a compact tile is read
+  inflate_sections();
+
   // Street name info. Unique set of offsets into the text list
   std::set<NameInfo> name_info;
   name_info.insert({0});
@@ -187,6 +244,14 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
   lane_connectivity_builder_.reserve(n);
   std::copy(lane_connectivity_, lane_connectivity_ + n,
             std::back_inserter(lane_connectivity_builder_));
+
+  // Elevation profiles
+  if (!elevation_profiles_.empty()) {
+    elevation_profile_offset_builder_.assign(elevation_profiles_.offsets(),
+                                             elevation_profiles_.offsets() +
+                                                 header_->directededgecount());
+    elevation_profile_builder_.assign(elevation_profiles_.profiles(), elevation_profiles_.size());
+  }
 }
 
 // Output the tile to file. Stores as binary data.
@@ -195,15 +260,10 @@ void GraphTileBuilder::StoreTileData() {
   filesystem::path filename(tile_dir_ + filesystem::path::preferred_separator +
                             GraphTile::FileSuffix(header_builder_.graphid()));
 
-  // Make sure the directory exists on the system
-  if (!filesystem::exists(filename.parent_path())) {
-    filesystem::create_directories(filename.parent_path());
-  }
-
-  // Open file and truncate
+  // Serialize the whole tile into memory, the header goes in front once its offsets are known
   std::stringstream in_mem;
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (file.is_open()) {
+  in_mem.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
+  {
     // Write the nodes
     header_builder_.set_nodecount(nodes_builder_.size());
     in_mem.write(reinterpret_cast<const char*>(nodes_builder_.data()),
@@ -236,6 +296,26 @@ void GraphTileBuilder::StoreTileData() {
     in_mem.write(reinterpret_cast<const char*>(access_restriction_builder_.data()),
                  access_restriction_builder_.size() * sizeof(AccessRestriction));
 
+    // Sum up the truck restrictions of each directed edge, if there are any, so that trucks can
+    // pass most restricted edges without looking at the restrictions
+    uint32_t truck_restrictions_size = 0;
+    header_builder_.set_truck_restrictions_offset(0);
+    if (std::any_of(access_restriction_builder_.begin(), access_restriction_builder_.end(),
+                    [](const AccessRestriction& r) { return r.modes() & kTruckAccess; })) {
+      std::vector<TruckRestrictions> truck_restrictions(directededges_builder_.size());
+      for (const auto& restriction : access_restriction_builder_) {
+        if (restriction.edgeindex() < truck_restrictions.size()) {
+          truck_restrictions[restriction.edgeindex()].Add(restriction);
+        }
+      }
+      header_builder_.set_truck_restrictions_offset(static_cast<uint32_t>(in_mem.tellp()));
+      truck_restrictions_size = TruckRestrictions::SectionSize(truck_restrictions.size());
+      in_mem.write(reinterpret_cast<const char*>(truck_restrictions.data()),
+                   truck_restrictions.size() * sizeof(TruckRestrictions));
+      in_mem.write("\0\0\0\0\0\0\0\0",
+                   truck_restrictions_size - truck_restrictions.size() * sizeof(TruckRestrictions));
+    }
+
     // Sort and write the transit departures
     header_builder_.set_departurecount(departure_builder_.size());
     std::sort(departure_builder_.begin(), departure_builder_.end());
@@ -276,7 +356,8 @@ void GraphTileBuilder::StoreTileData() {
     in_mem.write(reinterpret_cast<const char*>(admins_builder_.data()),
                  admins_builder_.size() * sizeof(Admin));
 
-    // Edge bins can only be added after you've stored the tile
+    // Edge bounds and bins can only be added after you've stored the tile
+    header_builder_.set_edge_bounds_offset(0);
 
     // Write the forward complex restriction data
     header_builder_.set_complex_restriction_forward_offset(
@@ -285,6 +366,7 @@ void GraphTileBuilder::StoreTileData() {
         (directededges_builder_.size() * sizeof(DirectedEdge)) +
         (directededges_ext_builder_.size() * sizeof(DirectedEdgeExt)) +
         (access_restriction_builder_.size() * sizeof(AccessRestriction)) +
+        truck_restrictions_size +
         (departure_builder_.size() * sizeof(TransitDeparture)) +
         (stop_builder_.size() * sizeof(TransitStop)) +
         (route_builder_.size() * sizeof(TransitRoute)) +
@@ -321,7 +403,7 @@ void GraphTileBuilder::StoreTileData() {
     }
 
     // Add padding (if needed) to align to 8-byte word.
-    int tmp = in_mem.tellp() % 8;
+    int tmp = (static_cast<size_t>(in_mem.tellp()) - sizeof(GraphTileHeader)) % 8;
     int padding = (tmp > 0) ? 8 - tmp : 0;
     if (padding > 0 && padding < 8) {
       in_mem.write("\0\0\0\0\0\0\0\0", padding);
@@ -334,13 +416,37 @@ void GraphTileBuilder::StoreTileData() {
     in_mem.write(reinterpret_cast<const char*>(lane_connectivity_builder_.data()),
                  lane_connectivity_builder_.size() * sizeof(LaneConnectivity));
 
+    // Write the elevation profiles, the offset of each directed edge and then the profiles padded
+    // to align to 8-byte word. They are only good for the directed edges they were added for
+    uint32_t elevation_profiles_size = 0;
+    header_builder_.set_elevation_profiles_offset(0);
+    if (!elevation_profile_builder_.empty() &&
+        elevation_profile_offset_builder_.size() != directededges_builder_.size()) {
+      LOG_WARN("Dropping the elevation profiles of tile " +
+               std::to_string(header_builder_.graphid()) + " as its directed edges changed");
+    } else if (!elevation_profile_builder_.empty()) {
+      header_builder_.set_elevation_profiles_offset(
+          header_builder_.lane_connectivity_offset() +
+          (lane_connectivity_builder_.size() * sizeof(LaneConnectivity)));
+      in_mem.write(reinterpret_cast<const char*>(elevation_profile_offset_builder_.data()),
+                   elevation_profile_offset_builder_.size() * sizeof(uint32_t));
+      in_mem.write(elevation_profile_builder_.data(), elevation_profile_builder_.size());
+      elevation_profiles_size = elevation_profile_offset_builder_.size() * sizeof(uint32_t) +
+                                elevation_profile_builder_.size();
+      const int remainder = elevation_profiles_size % 8;
+      if (remainder > 0) {
+        in_mem.write("\0\0\0\0\0\0\0\0", 8 - remainder);
+        elevation_profiles_size += 8 - remainder;
+      }
+    }
+
     // Set the end offset
     header_builder_.set_end_offset(header_builder_.lane_connectivity_offset() +
-                                   (lane_connectivity_builder_.size() * sizeof(LaneConnectivity)));
+                                   (lane_connectivity_builder_.size() * sizeof(LaneConnectivity)) +
+                                   elevation_profiles_size);
 
     // Sanity check for the end offset
-    uint32_t curr =
-        static_cast<uint32_t>(in_mem.tellp()) + static_cast<uint32_t>(sizeof(GraphTileHeader));
+    uint32_t curr = static_cast<uint32_t>(in_mem.tellp());
     if (header_builder_.end_offset() != curr) {
       LOG_ERROR("Mismatch in end offset " + std::to_string(header_builder_.end_offset()) +
                 " vs in_mem stream " + std::to_string(curr) +
@@ -358,13 +464,11 @@ void GraphTileBuilder::StoreTileData() {
                route_builder_.size())
                   .str());
 
-    // Write the header then the rest of the tile from the in memory buffer
-    file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
-    file << in_mem.rdbuf();
-    file.close();
-  } else {
-    throw std::runtime_error("Failed to open file " + filename.string());
+    // Put the final header in front and write all of it at once
+    in_mem.seekp(0);
+    in_mem.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
   }
+  write_tile(filename, in_mem.str(), "");
 }
 
 // Update a graph tile with new nodes and directed edges. The rest of the
@@ -375,45 +479,30 @@ void GraphTileBuilder::Update(const std::vector<NodeInfo>& nodes,
   filesystem::path filename =
       tile_dir_ + filesystem::path::preferred_separator + GraphTile::FileSuffix(header_->graphid());
 
-  // Make sure the directory exists on the system
-  if (!filesystem::exists(filename.parent_path())) {
-    filesystem::create_directories(filename.parent_path());
+  // Make sure node and directed edge counts match
+  if (nodes.size() != header_->nodecount()) {
+    throw std::runtime_error("GraphTileBuilder::Update - node count has changed");
   }
-
-  // Open file. Truncate so we replace the contents.
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (file.is_open()) {
-    // Write the header
-    file.write(reinterpret_cast<const char*>(header_), sizeof(GraphTileHeader));
-
-    // Write the updated nodes. Make sure node count matches.
-    if (nodes.size() != header_->nodecount()) {
-      throw std::runtime_error("GraphTileBuilder::Update - node count has changed");
-    }
-    file.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(NodeInfo));
-
-    // Write node transitions
-    file.write(reinterpret_cast<const char*>(transitions_),
-               header_->transitioncount() * sizeof(NodeTransition));
-
-    // Write the updated directed edges. Make sure edge count matches.
-    if (directededges.size() != header_->directededgecount()) {
-      throw std::runtime_error("GraphTileBuilder::Update - directed edge count has changed");
-    }
-    file.write(reinterpret_cast<const char*>(directededges.data()),
-               directededges.size() * sizeof(DirectedEdge));
-
-    // If there are extended directed edge attributes they would need to be written out here
-    // (and likely added to the method)
-
-    // Write the rest of the tiles
-    auto begin = reinterpret_cast<const char*>(&access_restrictions_[0]);
-    auto end = reinterpret_cast<const char*>(header()) + header()->end_offset();
-    file.write(begin, end - begin);
-    file.close();
-  } else {
-    throw std::runtime_error("GraphTileBuilder::Update - Failed to open file " + filename.string());
+  if (directededges.size() != header_->directededgecount()) {
+    throw std::runtime_error("GraphTileBuilder::Update - directed edge count has changed");
   }
+
+  // The header, the updated nodes, the node transitions and the updated directed edges
+  std::string data;
+  data.reserve(memory_->size);
+  append(data, header_, sizeof(GraphTileHeader));
+  append(data, nodes.data(), nodes.size() * sizeof(NodeInfo));
+  append(data, transitions_, header_->transitioncount() * sizeof(NodeTransition));
+  append(data, directededges.data(), directededges.size() * sizeof(DirectedEdge));
+
+  // If there are extended directed edge attributes they would need to be written out here
+  // (and likely added to the method)
+
+  // Write the rest of the tiles, which for a compact tile includes its deflated sections
+  auto begin = reinterpret_cast<const char*>(&access_restrictions_[0]);
+  auto end = reinterpret_cast<const char*>(header()) + memory_->size;
+  append(data, begin, end - begin);
+  write_tile(filename, data, "GraphTileBuilder::Update - ");
 }
 
 // Gets a reference to the header builder.
@@ -888,6 +977,54 @@ void GraphTileBuilder::AddTileCreationDate(const uint32_t tile_creation_date) {
   header_builder_.set_date_created(tile_creation_date);
 }
 
+// Bound the shape of each directed edge, in place of any bounds the tile had
+void GraphTileBuilder::AddEdgeBounds(const std::string& tile_dir, const graph_tile_ptr& tile) {
+  assert(tile);
+  if (tile->header()->compressed_sections_offset()) {
+    throw std::runtime_error("Edge bounds cannot be added to a compact tile");
+  }
+
+  // both directions of an edge have the same shape
+  const auto tile_bounds = tile->BoundingBox();
+  std::vector<EdgeBounds> bounds;
+  bounds.reserve(tile->header()->directededgecount());
+  std::unordered_map<uint32_t, EdgeBounds> shape_bounds;
+  for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+    const auto* edge = tile->directededge(i);
+    auto found = shape_bounds.find(edge->edgeinfo_offset());
+    if (found == shape_bounds.end()) {
+      const auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
+      auto box = shape.empty() ? EdgeBounds()
+                               : EdgeBounds(AABB2<PointLL>(shape), tile_bounds);
+      found = shape_bounds.emplace(edge->edgeinfo_offset(), box).first;
+    }
+    bounds.push_back(found->second);
+  }
+
+  // the bounds go right before the bins so update the header offsets after them
+  const uint32_t old_size =
+      tile->header()->edge_bounds_offset() ? bounds.size() * sizeof(EdgeBounds) : 0;
+  const auto* bins = reinterpret_cast<const char*>(tile->GetBin(0, 0).begin());
+  const auto* old_bounds = bins - old_size;
+  GraphTileHeader header = *tile->header();
+  header.set_edge_bounds_offset(
+      bounds.empty() ? 0 : old_bounds - reinterpret_cast<const char*>(tile->header()));
+  shift_offsets(header, bounds.size() * sizeof(EdgeBounds) - old_size);
+
+  // rewrite the tile
+  filesystem::path filename =
+      tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(header.graphid());
+  std::string data;
+  data.reserve(header.end_offset());
+  append(data, &header, sizeof(GraphTileHeader));
+  const auto* begin = reinterpret_cast<const char*>(tile->header()) + sizeof(GraphTileHeader);
+  append(data, begin, old_bounds - begin);
+  append(data, bounds.data(), bounds.size() * sizeof(EdgeBounds));
+  const auto* end = reinterpret_cast<const char*>(tile->header()) + tile->header()->end_offset();
+  append(data, bins, end - bins);
+  write_tile(filename, data, "");
+}
+
 // return this tiles' edges' bins and its edges' tweeners' bins
 using tweeners_t = std::unordered_map<GraphId, std::array<std::vector<GraphId>, kBinCount>>;
 std::array<std::vector<GraphId>, kBinCount> GraphTileBuilder::BinEdges(const graph_tile_ptr& tile,
@@ -965,6 +1102,9 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
                                const graph_tile_ptr& tile,
                                const std::array<std::vector<GraphId>, kBinCount>& more_bins) {
   assert(tile);
+  if (tile->header()->compressed_sections_offset()) {
+    throw std::runtime_error("Bins cannot be added to a compact tile");
+  }
   // read bins and append and keep track of how much is appended
   std::vector<GraphId> bins[kBinCount];
   uint32_t shift = 0;
@@ -981,42 +1121,29 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
     offsets[i] = static_cast<uint32_t>(bins[i].size()) + offsets[i - 1];
   }
   // update header offsets
-  // NOTE: if format changes to add more things here we need to make a change here as well
   GraphTileHeader header = *tile->header();
   header.set_edge_bin_offsets(offsets);
-  header.set_complex_restriction_forward_offset(header.complex_restriction_forward_offset() + shift);
-  header.set_complex_restriction_reverse_offset(header.complex_restriction_reverse_offset() + shift);
-  header.set_edgeinfo_offset(header.edgeinfo_offset() + shift);
-  header.set_textlist_offset(header.textlist_offset() + shift);
-  header.set_lane_connectivity_offset(header.lane_connectivity_offset() + shift);
-  header.set_end_offset(header.end_offset() + shift);
+  shift_offsets(header, shift);
   // rewrite the tile
   filesystem::path filename =
       tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(header.graphid());
-  if (!filesystem::exists(filename.parent_path())) {
-    filesystem::create_directories(filename.parent_path());
-  }
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  // open it
-  if (file.is_open()) {
-    // new header
-    file.write(reinterpret_cast<const char*>(&header), sizeof(GraphTileHeader));
-    // a bunch of stuff between header and bins
-    const auto* begin = reinterpret_cast<const char*>(tile->header()) + sizeof(GraphTileHeader);
-    const auto* end = reinterpret_cast<const char*>(tile->GetBin(0, 0).begin());
-    file.write(begin, end - begin);
-    // the updated bins
-    for (const auto& bin : bins) {
-      file.write(reinterpret_cast<const char*>(bin.data()), bin.size() * sizeof(GraphId));
-    }
-    // the rest of the stuff after bins
-    begin = reinterpret_cast<const char*>(tile->GetBin(kBinsDim - 1, kBinsDim - 1).end());
-    end = reinterpret_cast<const char*>(tile->header()) + tile->header()->end_offset();
-    file.write(begin, end - begin);
-  } // failed
-  else {
-    throw std::runtime_error("Failed to open file " + filename.string());
+  std::string data;
+  data.reserve(header.end_offset());
+  // new header
+  append(data, &header, sizeof(GraphTileHeader));
+  // a bunch of stuff between header and bins
+  const auto* begin = reinterpret_cast<const char*>(tile->header()) + sizeof(GraphTileHeader);
+  const auto* end = reinterpret_cast<const char*>(tile->GetBin(0, 0).begin());
+  append(data, begin, end - begin);
+  // the updated bins
+  for (const auto& bin : bins) {
+    append(data, bin.data(), bin.size() * sizeof(GraphId));
   }
+  // the rest of the stuff after bins
+  begin = reinterpret_cast<const char*>(tile->GetBin(kBinsDim - 1, kBinsDim - 1).end());
+  end = reinterpret_cast<const char*>(tile->header()) + tile->header()->end_offset();
+  append(data, begin, end - begin);
+  write_tile(filename, data, "");
 }
 
 // Add a predicted speed profile for a directed edge.
@@ -1043,6 +1170,34 @@ void GraphTileBuilder::AddPredictedSpeed(const uint32_t idx,
   speed_profile_builder_.insert(speed_profile_builder_.end(), profile.begin(), profile.end());
 }
 
+// Add the elevation profile of a directed edge.
+uint32_t GraphTileBuilder::AddElevationProfile(const uint32_t idx,
+                                               const std::vector<double>& heights) {
+  if (idx >= directededges_builder_.size())
+    throw std::runtime_error("GraphTileBuilder AddElevationProfile index is out of bounds");
+
+  // On the first call every directed edge starts out with the empty profile
+  if (elevation_profile_offset_builder_.size() != directededges_builder_.size()) {
+    elevation_profile_offset_builder_.assign(directededges_builder_.size(), 0);
+    elevation_profile_builder_.clear();
+  }
+  if (elevation_profile_builder_.empty()) {
+    ElevationProfiles::Pack({}, elevation_profile_builder_);
+  }
+  const uint32_t offset = elevation_profile_builder_.size();
+  ElevationProfiles::Pack(heights, elevation_profile_builder_);
+  elevation_profile_offset_builder_[idx] = offset;
+  return offset;
+}
+
+// Points a directed edge at the elevation profile of another edge.
+void GraphTileBuilder::SetElevationProfile(const uint32_t idx, const uint32_t offset) {
+  if (idx >= elevation_profile_offset_builder_.size() ||
+      offset >= elevation_profile_builder_.size())
+    throw std::runtime_error("GraphTileBuilder SetElevationProfile index is out of bounds");
+  elevation_profile_offset_builder_[idx] = offset;
+}
+
 // Updates a tile with predictive speed data. Also updates directed edges with
 // free flow and constrained flow speeds and the predicted traffic flag. The
 // predicted traffic is written after turn lane data.
@@ -1055,54 +1210,43 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
   filesystem::path filename = tile_dir_ + filesystem::path::preferred_separator +
                               GraphTile::FileSuffix(header_builder_.graphid());
 
-  // Make sure the directory exists on the system
-  if (!filesystem::exists(filename.parent_path()))
-    filesystem::create_directories(filename.parent_path());
-
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (file.is_open()) {
-    // Write a new header - add the offset to predicted speed data and the profile count.
-    // Update the end offset (shift by the amount of predicted speed data added).
-    size_t offset = header_->end_offset();
-    header_builder_.set_end_offset(header_->end_offset() +
-                                   (speed_profile_offset_builder_.size() * sizeof(uint32_t)) +
-                                   (speed_profile_builder_.size() * sizeof(int16_t)));
-    header_builder_.set_predictedspeeds_offset(offset);
-    header_builder_.set_predictedspeeds_count(speed_profile_builder_.size() / kCoefficientCount);
-    file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
-
-    // Copy the nodes (they are unchanged when adding predicted speeds).
-    file.write(reinterpret_cast<const char*>(nodes_), header_->nodecount() * sizeof(NodeInfo));
-
-    // Copy the node transitions (they are unchanged when adding predicted speeds).
-    file.write(reinterpret_cast<const char*>(transitions_),
-               header_->transitioncount() * sizeof(NodeTransition));
-
-    // Write the updated directed edges. Make sure edge count matches.
-    if (directededges.size() != header_->directededgecount()) {
-      throw std::runtime_error("GraphTileBuilder::Update - directed edge count has changed");
-    }
-    file.write(reinterpret_cast<const char*>(directededges.data()),
-               directededges.size() * sizeof(DirectedEdge));
-
-    // Write out data from access restrictions to the end of lane connectivity data.
-    auto begin = reinterpret_cast<const char*>(&access_restrictions_[0]);
-    auto end = reinterpret_cast<const char*>(header()) + offset;
-    file.write(begin, end - begin);
-
-    // Append the speed profile indexes and profiles.
-    file.write(reinterpret_cast<const char*>(speed_profile_offset_builder_.data()),
-               speed_profile_offset_builder_.size() * sizeof(uint32_t));
-    file.write(reinterpret_cast<const char*>(speed_profile_builder_.data()),
-               speed_profile_builder_.size() * sizeof(int16_t));
-
-    // Write the rest of the tiles. TBD (if anything is added after the speed profiles
-    // then this will need to be updated)
-
-    // Close the file
-    file.close();
+  // Make sure edge count matches.
+  if (directededges.size() != header_->directededgecount()) {
+    throw std::runtime_error("GraphTileBuilder::Update - directed edge count has changed");
   }
+
+  // Write a new header - add the offset to predicted speed data and the profile count.
+  // Update the end offset (shift by the amount of predicted speed data added).
+  size_t offset = header_->end_offset();
+  header_builder_.set_end_offset(header_->end_offset() +
+                                 (speed_profile_offset_builder_.size() * sizeof(uint32_t)) +
+                                 (speed_profile_builder_.size() * sizeof(int16_t)));
+  header_builder_.set_predictedspeeds_offset(offset);
+  header_builder_.set_predictedspeeds_count(speed_profile_builder_.size() / kCoefficientCount);
+  std::string data;
+  data.reserve(header_builder_.end_offset());
+  append(data, &header_builder_, sizeof(GraphTileHeader));
+
+  // Copy the nodes and node transitions (they are unchanged when adding predicted speeds).
+  append(data, nodes_, header_->nodecount() * sizeof(NodeInfo));
+  append(data, transitions_, header_->transitioncount() * sizeof(NodeTransition));
+
+  // Write the updated directed edges.
+  append(data, directededges.data(), directededges.size() * sizeof(DirectedEdge));
+
+  // Write out data from access restrictions to the end of lane connectivity data.
+  auto begin = reinterpret_cast<const char*>(&access_restrictions_[0]);
+  auto end = reinterpret_cast<const char*>(header()) + offset;
+  append(data, begin, end - begin);
+
+  // Append the speed profile indexes and profiles.
+  append(data, speed_profile_offset_builder_.data(),
+         speed_profile_offset_builder_.size() * sizeof(uint32_t));
+  append(data, speed_profile_builder_.data(), speed_profile_builder_.size() * sizeof(int16_t));
+
+  // Write the rest of the tiles. TBD (if anything is added after the speed profiles
+  // then this will need to be updated)
+  write_tile(filename, data, "GraphTileBuilder::UpdatePredictedSpeeds - ");
 }
 
 } // namespace mjolnir
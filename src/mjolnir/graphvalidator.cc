@@ -1,8 +1,12 @@
 
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilequeue.h"
 #include "mjolnir/util.h"
+#include "statistics.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/format.hpp>
 #include <future>
 #include <iostream>
@@ -10,12 +14,12 @@
 #include <mutex>
 #include <numeric>
 #include <ostream>
-#include <queue>
 #include <set>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -34,15 +38,6 @@ using namespace valhalla::mjolnir;
 
 namespace {
 
-struct HGVRestrictionTypes {
-  bool hazmat;
-  bool axle_load;
-  bool height;
-  bool length;
-  bool weight;
-  bool width;
-};
-
 // Get the GraphId of the opposing edge.
 uint32_t GetOpposingEdgeIndex(const GraphId& startnode,
                               DirectedEdge& edge,
@@ -245,17 +240,56 @@ uint32_t GetOpposingEdgeIndex(const GraphId& startnode,
   return opp_index;
 }
 
+// All of the tiles mapped before any of them are validated. A mapped tile is already an index from
+// its nodes to their edges, so with all of them in one place the threads find the edges at the other
+// end of theirs without a reader, its cache or a lock. Validated tiles are moved over the originals
+// rather than written into them so the mapped originals stay as they are until the pass is done
+class mapped_tiles_t {
+public:
+  mapped_tiles_t(const std::string& tile_dir,
+                 const std::unordered_set<GraphId>& tileset,
+                 const size_t concurrency)
+      : ids_(tileset.cbegin(), tileset.cend()) {
+    std::sort(ids_.begin(), ids_.end());
+    tiles_.resize(ids_.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::shared_ptr<std::thread>> threads(concurrency);
+    for (auto& thread : threads) {
+      thread.reset(new std::thread([this, &tile_dir, &next]() {
+        for (auto i = next++; i < ids_.size(); i = next++) {
+          tiles_[i] = GraphTile::Create(tile_dir, ids_[i], nullptr, true);
+        }
+      }));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+  }
+
+  const graph_tile_ptr& get(const GraphId& id) const {
+    static const graph_tile_ptr none;
+    auto found = std::lower_bound(ids_.cbegin(), ids_.cend(), id.Tile_Base());
+    return found == ids_.cend() || *found != id.Tile_Base() ? none
+                                                            : tiles_[found - ids_.cbegin()];
+  }
+
+private:
+  std::vector<GraphId> ids_;
+  std::vector<graph_tile_ptr> tiles_;
+};
+
 using tweeners_t = GraphTileBuilder::tweeners_t;
-void validate(
-    const boost::property_tree::ptree& pt,
-    std::deque<GraphId>& tilequeue,
-    std::mutex& lock,
-    std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>&
-        result) {
+using validate_result_t =
+    std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t, statistics>;
+void validate(const std::string& tile_dir,
+              const mapped_tiles_t& mapped_tiles,
+              TileQueue& tilequeue,
+              const bool build_statistics,
+              std::promise<validate_result_t>& result) {
   // Our local copy of edges binned to tiles that they pass through (dont start or end in)
   tweeners_t tweeners;
-  // Local Graphreader
-  GraphReader graph_reader(pt.get_child("mjolnir"));
+  // The statistics of the tiles this thread validated
+  statistics stats;
   // Get some things we need throughout
   auto numLevels = TileHierarchy::levels().size() + 1; // To account for transit
   auto transit_level = TileHierarchy::GetTransitLevel().level;
@@ -270,17 +304,8 @@ void validate(
   std::set<uint32_t> problem_ways;
 
   // Check for more tiles
-  while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
-
+  GraphId tile_id;
+  while (tilequeue.next(tile_id)) {
     // Point tiles to the set we need for current level
     const auto& tiles = tile_id.level() == TileHierarchy::GetTransitLevel().level
                             ? TileHierarchy::levels().back().tiles
@@ -289,16 +314,14 @@ void validate(
     auto tileid = tile_id.tileid();
 
     // Get the tile
-    GraphTileBuilder tilebuilder(graph_reader.tile_dir(), tile_id, false);
+    GraphTileBuilder tilebuilder(tile_dir, tile_id, false);
 
     // Update nodes and directed edges as needed
     std::vector<NodeInfo> nodes;
     std::vector<DirectedEdge> directededges;
 
     // Get this tile
-    lock.lock();
-    graph_tile_ptr tile = graph_reader.GetGraphTile(tile_id);
-    lock.unlock();
+    const graph_tile_ptr& tile = mapped_tiles.get(tile_id);
 
     // Iterate through the nodes and the directed edges
     uint32_t dupcount = 0;
@@ -368,14 +391,12 @@ void validate(
         }
 
         // Check if end node is in a different tile
-        graph_tile_ptr endnode_tile = tile;
+        const graph_tile_ptr* endnode_tile = &tile;
         if (tile_id != directededge.endnode().Tile_Base()) {
           directededge.set_leaves_tile(true);
 
           // Get the end node tile
-          lock.lock();
-          endnode_tile = graph_reader.GetGraphTile(directededge.endnode());
-          lock.unlock();
+          endnode_tile = &mapped_tiles.get(directededge.endnode());
           // make sure this is set to false as access tag logic could of set this to true.
         } else {
           directededge.set_leaves_tile(false);
@@ -387,7 +408,7 @@ void validate(
         std::string end_node_iso;
         uint64_t wayid = tile->edgeinfo(directededge.edgeinfo_offset()).wayid();
         uint32_t opp_index =
-            GetOpposingEdgeIndex(node, directededge, wayid, tile, endnode_tile, problem_ways,
+            GetOpposingEdgeIndex(node, directededge, wayid, tile, *endnode_tile, problem_ways,
                                  dupcount, end_node_iso, transit_level);
         directededge.set_opp_index(opp_index);
         if (directededge.use() == Use::kTransitConnection ||
@@ -408,7 +429,7 @@ void validate(
           uint32_t modes = 0;
           for (uint32_t mode = 1; mode < kAllAccess; mode *= 2) {
             if ((de->end_restriction() & mode) &&
-                tile->GetRestrictions(true, edgeid, mode).size() > 0) {
+                !tile->GetRestrictions(true, edgeid, mode).empty()) {
               modes |= mode;
             }
           }
@@ -418,7 +439,7 @@ void validate(
           uint32_t modes = 0;
           for (uint32_t mode = 1; mode < kAllAccess; mode *= 2) {
             if ((de->start_restriction() & mode) &&
-                tile->GetRestrictions(false, edgeid, mode).size() > 0) {
+                !tile->GetRestrictions(false, edgeid, mode).empty()) {
               modes |= mode;
             }
           }
@@ -456,23 +477,25 @@ void validate(
     auto bins = GraphTileBuilder::BinEdges(tile, tweeners);
 
     // Write the new tile
-    lock.lock();
     tilebuilder.Update(nodes, directededges);
 
+    // Bound the shape of each edge so searches can skip the ones far away without decoding it
+    GraphTileBuilder::AddEdgeBounds(tile_dir, GraphTile::Create(tile_dir, tile_id));
+
     // Write the bins to it
     if (tile->header()->graphid().level() == TileHierarchy::levels().back().level) {
-      auto reloaded = GraphTile::Create(graph_reader.tile_dir(), tile_id);
-      GraphTileBuilder::AddBins(graph_reader.tile_dir(), reloaded, bins);
+      auto reloaded = GraphTile::Create(tile_dir, tile_id);
+      GraphTileBuilder::AddBins(tile_dir, reloaded, bins);
     }
 
-    // Check if we need to clear the tile cache
-    if (graph_reader.OverCommitted()) {
-      graph_reader.Trim();
-    }
-    lock.unlock();
-
     // Add possible duplicates to return class
     duplicates[level] += dupcount;
+
+    // Every tile is looked at here anyway so the statistics are gathered along the way rather than
+    // in another pass over all of them
+    if (build_statistics) {
+      stats.add_tile(*tile);
+    }
   }
 
   // TODO - output problem ways - this could be a useful list!
@@ -481,7 +504,8 @@ void validate(
       }*/
 
   // Fill promise with return data
-  result.set_value(std::make_tuple(std::move(duplicates), std::move(densities), std::move(tweeners)));
+  result.set_value(std::make_tuple(std::move(duplicates), std::move(densities), std::move(tweeners),
+                                   std::move(stats)));
 }
 
 // take tweeners from different tiles' perspectives and merge into a single tweener
@@ -543,19 +567,15 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
   auto hierarchy_properties = pt.get_child("mjolnir");
   std::string tile_dir = hierarchy_properties.get<std::string>("tile_dir");
 
-  // Create a randomized queue of tiles (at all levels) to work from
-  std::deque<GraphId> tilequeue;
+  // Create a queue of tiles (at all levels) to work from, the largest first and otherwise in the
+  // order of their ids for reproducible tile build
   GraphReader reader(pt.get_child("mjolnir"));
   auto tileset = reader.GetTileSet();
-  for (const auto& id : tileset) {
-    tilequeue.emplace_back(id);
-  }
-  // fixed seed for reproducible tile build
-  std::shuffle(tilequeue.begin(), tilequeue.end(), std::mt19937(3));
+  TileQueue tilequeue(tile_dir, tileset);
 
   // Remember what the dataset id is in case we have to make some tiles
-  graph_tile_ptr first_tile = GraphTile::Create(tile_dir, *tilequeue.begin());
-  assert(tilequeue.size() && first_tile);
+  graph_tile_ptr first_tile = GraphTile::Create(tile_dir, *tileset.begin());
+  assert(tileset.size() && first_tile);
   auto dataset_id = first_tile->header()->dataset_id();
 
   // An mutex we can use to do the synchronization
@@ -566,26 +586,31 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
       std::max(static_cast<unsigned int>(1),
                pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
 
+  // Map all of the tiles for the threads to share
+  auto mapped_tiles = std::make_unique<mapped_tiles_t>(tile_dir, tileset, threads.size());
+
   // Setup promises
-  std::list<
-      std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>>
-      results;
+  std::list<std::promise<validate_result_t>> results;
 
   // Spawn the threads
+  const bool build_statistics = hierarchy_properties.get<bool>("build_statistics", false);
   for (auto& thread : threads) {
     results.emplace_back();
-    thread.reset(new std::thread(validate, std::cref(pt), std::ref(tilequeue), std::ref(lock),
-                                 std::ref(results.back())));
+    thread.reset(new std::thread(validate, std::cref(tile_dir), std::cref(*mapped_tiles),
+                                 std::ref(tilequeue), build_statistics, std::ref(results.back())));
   }
 
   // Wait for threads to finish
   for (auto& thread : threads) {
     thread->join();
   }
+  tilequeue.LogUtilization("GraphValidator");
+  mapped_tiles.reset();
   // Get the promise from the future
   std::vector<uint32_t> duplicates(TileHierarchy::levels().size(), 0);
   std::vector<std::vector<float>> densities(3);
   tweeners_t tweeners;
+  statistics stats;
   for (auto& result : results) {
     auto data = result.get_future().get();
     // Total up duplicates for each level
@@ -597,6 +622,8 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
     }
     // keep track of tweeners
     merge(std::get<2>(data), tweeners);
+    // and the statistics, merging into what is there rather than copying it
+    stats.add(std::get<3>(data));
   }
   LOG_INFO("Finished");
 
@@ -635,6 +662,12 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
     LOG_DEBUG("Average density = " + std::to_string(average_density) +
               " max = " + std::to_string(max_density));
   }
+
+  // write out what the threads gathered, same as valhalla_build_statistics would have
+  if (build_statistics) {
+    stats.build_db(pt);
+    stats.roulette_data.GenerateTasks(pt);
+  }
 }
 } // namespace mjolnir
 } // namespace valhalla
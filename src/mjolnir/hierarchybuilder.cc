@@ -1,14 +1,22 @@
 #include "mjolnir/hierarchybuilder.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilequeue.h"
 
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <array>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -68,6 +76,29 @@ bool AddUpwardTransition(const GraphId& node, GraphTileBuilder* tilebuilder) {
   }
 }
 
+// Runs the worker on every thread and rethrows the first thing that went wrong, if anything did
+template <typename worker_t>
+void RunThreads(const unsigned int thread_count, const worker_t& worker) {
+  std::vector<std::shared_ptr<std::thread>> threads(thread_count);
+  std::vector<std::promise<void>> results(thread_count);
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].reset(new std::thread(
+        [&worker](std::promise<void>& result) {
+          try {
+            worker();
+            result.set_value();
+          } catch (...) { result.set_exception(std::current_exception()); }
+        },
+        std::ref(results[i])));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  for (auto& result : results) {
+    result.get_future().get();
+  }
+}
+
 void SortSequences(const std::string& new_to_old_file, const std::string& old_to_new_file) {
   // Sort the new nodes. Sort so highway level is first
   sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
@@ -121,16 +152,12 @@ bool OpposingEdgeInfoMatches(const graph_tile_ptr& tile, const DirectedEdge* edg
   return false;
 }
 
-// Form tiles in the new level.
-void FormTilesInNewLevel(GraphReader& reader,
-                         const std::string& new_to_old_file,
-                         const std::string& old_to_new_file) {
-  // Use the sequence that associate new nodes to old nodes
-  sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-
-  // Use the sorted sequence that associates old nodes to new nodes
-  sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
-
+// Form one tile in the new level from its range of the sorted sequence of new nodes.
+void FormTileInNewLevel(GraphReader& reader,
+                        sequence<std::pair<GraphId, GraphId>>& new_to_old,
+                        sequence<OldToNewNodes>& old_to_new,
+                        const GraphId& tile_id,
+                        const std::pair<uint64_t, uint64_t>& range) {
   // lambda to indicate whether a directed edge should be included
   auto include_edge = [&old_to_new](const DirectedEdge* directededge, const GraphId& base_node,
                                     const uint8_t current_level) {
@@ -158,39 +185,21 @@ void FormTilesInNewLevel(GraphReader& reader,
     }
   };
 
-  // Iterate through the new nodes. They have been sorted by level so that
-  // highway level is done first.
-  reader.Clear();
+  // New tilebuilder for the tile
   bool added = false;
-  uint8_t current_level;
-  GraphId tile_id;
   std::hash<std::string> hasher;
-  PointLL base_ll;
-  GraphTileBuilder* tilebuilder = nullptr;
-  for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++) {
-    // Get the node - check if a new tile
-    GraphId nodea = (*new_node).first;
-    if (nodea.Tile_Base() != tile_id) {
-      // Store the prior tile
-      if (tilebuilder != nullptr) {
-        tilebuilder->StoreTileData();
-        delete tilebuilder;
-      }
-
-      // New tilebuilder for the next tile. Update current level.
-      tile_id = nodea.Tile_Base();
-      tilebuilder = new GraphTileBuilder(reader.tile_dir(), tile_id, false);
-      current_level = nodea.level();
+  uint8_t current_level = tile_id.level();
+  std::unique_ptr<GraphTileBuilder> tilebuilder(
+      new GraphTileBuilder(reader.tile_dir(), tile_id, false));
 
-      // Set the base ll for this tile
-      base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
-      tilebuilder->header_builder().set_base_ll(base_ll);
+  // Set the base ll for this tile
+  PointLL base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
+  tilebuilder->header_builder().set_base_ll(base_ll);
 
-      // Check if we need to clear the base/local tile cache
-      if (reader.OverCommitted()) {
-        reader.Trim();
-      }
-    }
+  // Iterate through the new nodes of the tile
+  auto new_node = new_to_old[range.first];
+  for (uint64_t i = range.first; i < range.second; ++i, ++new_node) {
+    GraphId nodea = (*new_node).first;
 
     // Get the node in the base level
     GraphId base_node = (*new_node).second;
@@ -334,15 +343,15 @@ void FormTilesInNewLevel(GraphReader& reader,
     uint32_t index = tilebuilder->transitions().size();
     auto new_nodes = find_nodes(old_to_new, base_node);
     if (current_level == 0) {
-      AddDownwardTransition(new_nodes.arterial_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
+      AddDownwardTransition(new_nodes.arterial_node, tilebuilder.get());
+      AddDownwardTransition(new_nodes.local_node, tilebuilder.get());
     } else if (current_level == 1) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
+      AddUpwardTransition(new_nodes.highway_node, tilebuilder.get());
+      AddDownwardTransition(new_nodes.local_node, tilebuilder.get());
     }
     if (current_level == 2) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddUpwardTransition(new_nodes.arterial_node, tilebuilder);
+      AddUpwardTransition(new_nodes.highway_node, tilebuilder.get());
+      AddUpwardTransition(new_nodes.arterial_node, tilebuilder.get());
     }
 
     // Set the node transition count and index
@@ -366,39 +375,184 @@ void FormTilesInNewLevel(GraphReader& reader,
     }
   }
 
-  // Delete the tile builder
-  if (tilebuilder != nullptr) {
-    tilebuilder->StoreTileData();
-    delete tilebuilder;
+  // Store the tile
+  tilebuilder->StoreTileData();
+}
+
+// Form tiles in the new level. Every tile is formed on its own from its range of new nodes, the
+// tiles of the highway and arterial levels first because they read the local tiles and the
+// local tiles last because each of those only reads the local tile it replaces.
+void FormTilesInNewLevel(const boost::property_tree::ptree& hierarchy_properties,
+                         const unsigned int thread_count,
+                         const std::string& new_to_old_file,
+                         const std::string& old_to_new_file) {
+  // The range of the sequence that associates new nodes to old nodes for each new tile. They
+  // have been sorted by level, tile and id
+  std::unordered_map<GraphId, std::pair<uint64_t, uint64_t>> ranges;
+  {
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+    uint64_t i = 0;
+    auto range = ranges.end();
+    for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); ++new_node, ++i) {
+      GraphId tile_id = (*new_node).first.Tile_Base();
+      if (range == ranges.end() || range->first != tile_id) {
+        range = ranges.emplace(tile_id, std::make_pair(i, i)).first;
+      }
+      range->second.second = i + 1;
+    }
+  }
+
+  const auto local_level = TileHierarchy::levels().back().level;
+  for (bool local : {false, true}) {
+    // The tiles with the most nodes go first
+    std::vector<std::pair<GraphId, uint64_t>> weights;
+    for (const auto& range : ranges) {
+      if ((range.first.level() == local_level) == local) {
+        weights.emplace_back(range.first, range.second.second - range.second.first);
+      }
+    }
+    TileQueue tilequeue(std::move(weights));
+
+    RunThreads(thread_count, [&]() {
+      GraphReader reader(hierarchy_properties);
+      sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+      sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
+      GraphId tile_id;
+      while (tilequeue.next(tile_id)) {
+        FormTileInNewLevel(reader, new_to_old, old_to_new, tile_id, ranges.find(tile_id)->second);
+
+        // Check if we need to clear the base/local tile cache
+        if (reader.OverCommitted()) {
+          reader.Trim();
+        }
+      }
+    });
+    tilequeue.LogUtilization(local ? "HierarchyBuilder local level"
+                                   : "HierarchyBuilder highway and arterial levels");
   }
 }
 
+// The tiles of the new nodes of every node of a local tile, in the order of the nodes. There is
+// one tile for each level the node exists on, highway, arterial and local, and an invalid id for
+// each level it doesnt.
+std::vector<std::array<GraphId, 3>> NewNodeTiles(const graph_tile_ptr& tile) {
+  // Hierarchy level information
+  const auto& arterial_level = TileHierarchy::levels()[1];
+  uint32_t al = static_cast<uint32_t>(arterial_level.level);
+  const auto& highway_level = TileHierarchy::levels()[0];
+  uint32_t hl = static_cast<uint32_t>(highway_level.level);
+
+  // Iterate through the nodes. Add nodes to the new level when
+  // best road class <= the new level classification cutoff
+  bool levels[3];
+  uint32_t nodecount = tile->header()->nodecount();
+  std::vector<std::array<GraphId, 3>> new_tiles(nodecount);
+  GraphId base_tile_id = tile->id();
+  GraphId edgeid = base_tile_id;
+  PointLL base_ll = tile->header()->base_ll();
+  const NodeInfo* nodeinfo = tile->node(base_tile_id);
+  for (uint32_t i = 0; i < nodecount; i++, nodeinfo++) {
+    // Iterate through the edges to see which levels this node exists.
+    levels[0] = levels[1] = levels[2] = false;
+    for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
+      // Update the flag for the level of this edge (skip transit
+      // connection edges)
+      const DirectedEdge* directededge = tile->directededge(edgeid);
+      if (directededge->bss_connection()) {
+        // Despite the road class, Bike Share Stations' connections are always at local level
+        levels[2] = true;
+      } else if (directededge->use() != Use::kTransitConnection &&
+                 directededge->use() != Use::kEgressConnection &&
+                 directededge->use() != Use::kPlatformConnection) {
+        levels[TileHierarchy::get_level(directededge->classification())] = true;
+      }
+    }
+
+    if (levels[0]) {
+      new_tiles[i][0] = GraphId(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
+    }
+    if (levels[1]) {
+      new_tiles[i][1] = GraphId(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
+    }
+    if (levels[2]) {
+      new_tiles[i][2] = base_tile_id;
+    }
+  }
+  return new_tiles;
+}
+
 /**
  * Create node associations between "new" nodes placed into respective
  * hierarchy levels and the existing nodes on the base/local level. The
  * associations go both ways: from the "old" nodes on the base/local level
- * to new nodes (using a mapping in memory) and from new nodes to old nodes
- * using a sequence (file).
+ * to new nodes and from new nodes to old nodes using sequences (files).
+ *
+ * The new nodes of a new tile are numbered in the order of the local tiles and then of their
+ * nodes. So that the tiles can be done in parallel in any order a first pass counts the new nodes
+ * each local tile adds to each new tile, which gives every local tile the first id it may use in
+ * each new tile, and a second pass makes the associations. Both sequences are sorted afterwards so
+ * the order in which the tiles finish doesnt matter.
  */
-void CreateNodeAssociations(GraphReader& reader,
+void CreateNodeAssociations(const boost::property_tree::ptree& hierarchy_properties,
+                            const unsigned int thread_count,
                             const std::string& new_to_old_file,
                             const std::string& old_to_new_file) {
-  // Map of tiles vs. count of nodes. Used to construct new node Ids.
-  std::unordered_map<GraphId, uint32_t> new_nodes;
-
-  // lambda to get the next "new" node Id in a given tile
-  auto get_new_node = [&new_nodes](const GraphId& tile) -> GraphId {
-    auto itr = new_nodes.find(tile);
-    if (itr == new_nodes.end()) {
-      GraphId new_node(tile.tileid(), tile.level(), 0);
-      new_nodes[tile] = 1;
-      return new_node;
-    } else {
-      GraphId new_node(tile.tileid(), tile.level(), itr->second);
-      itr->second++;
-      return new_node;
+  // Iterate through all tiles in the local level
+  GraphReader reader(hierarchy_properties);
+  auto local_tiles = reader.GetTileSet();
+  std::unordered_map<GraphId, size_t> positions;
+  for (const auto& base_tile_id : local_tiles) {
+    positions.emplace(base_tile_id, positions.size());
+  }
+
+  // For each local tile, the new tiles it adds nodes to and how many
+  std::vector<std::vector<std::pair<GraphId, uint32_t>>> new_nodes(local_tiles.size());
+  TileQueue count_queue(reader.tile_dir(), local_tiles);
+  RunThreads(thread_count, [&]() {
+    GraphReader reader(hierarchy_properties);
+    GraphId base_tile_id;
+    while (count_queue.next(base_tile_id)) {
+      // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
+      graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
+      if (!tile) {
+        continue;
+      }
+      auto& counts = new_nodes[positions.at(base_tile_id)];
+      for (const auto& node_tiles : NewNodeTiles(tile)) {
+        for (const auto& new_tile : node_tiles) {
+          if (!new_tile.Is_Valid()) {
+            continue;
+          }
+          auto count = std::find_if(counts.begin(), counts.end(),
+                                    [&new_tile](const std::pair<GraphId, uint32_t>& c) {
+                                      return c.first == new_tile;
+                                    });
+          if (count == counts.end()) {
+            counts.emplace_back(new_tile, 1);
+          } else {
+            ++count->second;
+          }
+        }
+      }
+
+      // Check if we need to clear the tile cache
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
     }
-  };
+  });
+  count_queue.LogUtilization("HierarchyBuilder counting new nodes");
+
+  // Turn the counts into the first new node id of each local tile in each new tile
+  std::unordered_map<GraphId, uint32_t> next_ids;
+  for (const auto& base_tile_id : local_tiles) {
+    for (auto& count : new_nodes[positions.at(base_tile_id)]) {
+      auto& next_id = next_ids[count.first];
+      auto n = count.second;
+      count.second = next_id;
+      next_id += n;
+    }
+  }
 
   // Create a sequence to associate new nodes to old nodes
   sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, true);
@@ -406,81 +560,73 @@ void CreateNodeAssociations(GraphReader& reader,
   // Create a sequence to associate new nodes to old nodes
   sequence<OldToNewNodes> old_to_new(old_to_new_file, true);
 
-  // Hierarchy level information
-  const auto& arterial_level = TileHierarchy::levels()[1];
-  uint32_t al = static_cast<uint32_t>(arterial_level.level);
-  const auto& highway_level = TileHierarchy::levels()[0];
-  uint32_t hl = static_cast<uint32_t>(highway_level.level);
+  // Make the associations, each thread adds those of a whole tile at once
+  std::mutex lock;
+  TileQueue tilequeue(reader.tile_dir(), local_tiles);
+  RunThreads(thread_count, [&]() {
+    GraphReader reader(hierarchy_properties);
+    std::vector<std::pair<GraphId, GraphId>> tile_new_to_old;
+    std::vector<OldToNewNodes> tile_old_to_new;
+    GraphId base_tile_id;
+    while (tilequeue.next(base_tile_id)) {
+      graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
+      if (!tile) {
+        continue;
+      }
 
-  // Iterate through all tiles in the local level
-  auto local_tiles = reader.GetTileSet();
-  for (const auto& base_tile_id : local_tiles) {
-    // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
-    graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
-    if (!tile) {
-      continue;
-    }
+      // lambda to get the next "new" node Id in a given tile
+      auto next_ids = new_nodes[positions.at(base_tile_id)];
+      auto get_new_node = [&next_ids](const GraphId& new_tile) -> GraphId {
+        auto itr = std::find_if(next_ids.begin(), next_ids.end(),
+                                [&new_tile](const std::pair<GraphId, uint32_t>& n) {
+                                  return n.first == new_tile;
+                                });
+        return GraphId(new_tile.tileid(), new_tile.level(), itr->second++);
+      };
+
+      tile_new_to_old.clear();
+      tile_old_to_new.clear();
+      GraphId basenode = base_tile_id;
+      const NodeInfo* nodeinfo = tile->node(basenode);
+      for (const auto& node_tiles : NewNodeTiles(tile)) {
+        // Associate new nodes to base nodes and base node to new nodes
+        GraphId new_node[3];
+        for (size_t level = 0; level < node_tiles.size(); ++level) {
+          if (node_tiles[level].Is_Valid()) {
+            new_node[level] = get_new_node(node_tiles[level]);
+            tile_new_to_old.emplace_back(new_node[level], basenode);
+          }
+        }
 
-    // Iterate through the nodes. Add nodes to the new level when
-    // best road class <= the new level classification cutoff
-    bool levels[3];
-    uint32_t nodecount = tile->header()->nodecount();
-    GraphId basenode = base_tile_id;
-    GraphId edgeid = base_tile_id;
-    PointLL base_ll = tile->header()->base_ll();
-    const NodeInfo* nodeinfo = tile->node(basenode);
-    for (uint32_t i = 0; i < nodecount; i++, nodeinfo++, ++basenode) {
-      // Iterate through the edges to see which levels this node exists.
-      levels[0] = levels[1] = levels[2] = false;
-      for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
-        // Update the flag for the level of this edge (skip transit
-        // connection edges)
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        if (directededge->bss_connection()) {
-          // Despite the road class, Bike Share Stations' connections are always at local level
-          levels[2] = true;
-        } else if (directededge->use() != Use::kTransitConnection &&
-                   directededge->use() != Use::kEgressConnection &&
-                   directededge->use() != Use::kPlatformConnection) {
-          levels[TileHierarchy::get_level(directededge->classification())] = true;
+        if (!new_node[0].Is_Valid() && !new_node[1].Is_Valid() && !new_node[2].Is_Valid()) {
+          LOG_ERROR("No valid level for this node!");
         }
-      }
 
-      // Associate new nodes to base nodes and base node to new nodes
-      GraphId highway_node, arterial_node, local_node;
-      if (levels[0]) {
-        // New node is on the highway level. Associate back to base/local node
-        GraphId new_tile(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
-        highway_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(highway_node, basenode));
-      }
-      if (levels[1]) {
-        // New node is on the arterial level. Associate back to base/local node
-        GraphId new_tile(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
-        arterial_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(arterial_node, basenode));
-      }
-      if (levels[2]) {
-        // New node is on the local level. Associate back to base/local node
-        local_node = get_new_node(base_tile_id);
-        new_to_old.push_back(std::make_pair(local_node, basenode));
+        // Associate the old node to the new node(s). Entries in the tuple
+        // that are invalid nodes indicate no node exists in the new level.
+        tile_old_to_new.emplace_back(basenode, new_node[0], new_node[1], new_node[2],
+                                     nodeinfo->density());
+        ++basenode;
+        ++nodeinfo;
       }
 
-      if (!levels[0] && !levels[1] && !levels[2]) {
-        LOG_ERROR("No valid level for this node!");
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        for (const auto& assoc : tile_new_to_old) {
+          new_to_old.push_back(assoc);
+        }
+        for (const auto& assoc : tile_old_to_new) {
+          old_to_new.push_back(assoc);
+        }
       }
 
-      // Associate the old node to the new node(s). Entries in the tuple
-      // that are invalid nodes indicate no node exists in the new level.
-      OldToNewNodes assoc(basenode, highway_node, arterial_node, local_node, nodeinfo->density());
-      old_to_new.push_back(assoc);
-    }
-
-    // Check if we need to clear the tile cache
-    if (reader.OverCommitted()) {
-      reader.Trim();
+      // Check if we need to clear the tile cache
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
     }
-  }
+  });
+  tilequeue.LogUtilization("HierarchyBuilder associating nodes");
 }
 
 /**
@@ -579,29 +725,29 @@ void HierarchyBuilder::Build(const boost::property_tree::ptree& pt,
                              const std::string& new_to_old_file,
                              const std::string& old_to_new_file) {
 
-  // TODO: thread this. Might be more possible now that we don't create
-  // shortcuts in the HierarchyBuilder
-
   // Construct GraphReader
   LOG_INFO("HierarchyBuilder");
-  GraphReader reader(pt.get_child("mjolnir"));
+  auto hierarchy_properties = pt.get_child("mjolnir");
+  GraphReader reader(hierarchy_properties);
+  unsigned int thread_count =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
 
   // Association of old nodes to new nodes
-  CreateNodeAssociations(reader, new_to_old_file, old_to_new_file);
+  CreateNodeAssociations(hierarchy_properties, thread_count, new_to_old_file, old_to_new_file);
 
   // Sort the sequences
   SortSequences(new_to_old_file, old_to_new_file);
 
   // Iterate through the hierarchy (from highway down to local) and build
   // new tiles
-  FormTilesInNewLevel(reader, new_to_old_file, old_to_new_file);
+  FormTilesInNewLevel(hierarchy_properties, thread_count, new_to_old_file, old_to_new_file);
 
   // Remove any base tiles that no longer have any data (nodes and edges
   // only exist on arterial and highway levels)
   RemoveUnusedLocalTiles(reader.tile_dir(), old_to_new_file);
 
   // Update the end nodes to all transit connections in the transit hierarchy
-  auto hierarchy_properties = pt.get_child("mjolnir");
   auto transit_dir = hierarchy_properties.get_optional<std::string>("transit_dir");
   if (transit_dir && filesystem::exists(*transit_dir) && filesystem::is_directory(*transit_dir)) {
     UpdateTransitConnections(reader, old_to_new_file);
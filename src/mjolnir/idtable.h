@@ -2,9 +2,11 @@
 #define VALHALLA_MJOLNIR_IDTABLE_H
 
 #include <algorithm>
+#include <bitset>
 #include <cmath>
 #include <cstdint>
 #include <fstream>
+#include <string>
 #include <vector>
 
 #include <robin_hood.h>
@@ -14,14 +16,20 @@
 namespace valhalla {
 namespace mjolnir {
 
+/**
+ * A set of OSM ids kept as a compressed bitmap so that its memory is proportional to the ids set
+ * rather than to the largest of them. The ids are split into chunks of 2^16 by their high bits.
+ * Each chunk keeps the low bits of its ids in a sorted array while it has few of them, and a
+ * bitset of the whole chunk once that takes less memory, much like a roaring bitmap.
+ */
 class UnorderedIdTable final {
 public:
   /**
    * Constructor
-   * @param   size_hint   Hint about the total number of ids.
+   * @param   size_hint   Hint about the largest id, only used to size the index of the chunks.
    */
   UnorderedIdTable(const uint64_t size_hint) {
-    bitmarkers_.reserve((size_hint / 64) + 1);
+    chunks_.reserve((size_hint >> kChunkBits) + 1);
   }
 
   /**
@@ -29,8 +37,7 @@ public:
    * @param   osmid   OSM Id of the way/node/relation.
    */
   inline void set(const uint64_t id) {
-    uint64_t idx = id / 64;
-    bitmarkers_[idx] |= static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
+    chunks_[id >> kChunkBits].set(static_cast<uint16_t>(id));
   }
 
   /**
@@ -40,10 +47,19 @@ public:
    */
 
   inline bool get(const uint64_t id) const {
-    uint64_t idx = id / 64;
-    auto found = bitmarkers_.find(idx);
-    return found != bitmarkers_.cend() &&
-           found->second & (static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64)));
+    auto found = chunks_.find(id >> kChunkBits);
+    return found != chunks_.cend() && found->second.get(static_cast<uint16_t>(id));
+  }
+
+  /**
+   * @return how many ids are set
+   */
+  uint64_t size() const {
+    uint64_t count = 0;
+    for (const auto& chunk : chunks_) {
+      count += chunk.second.size();
+    }
+    return count;
   }
 
   /**
@@ -56,16 +72,22 @@ public:
     if (!file.is_open()) {
       return false;
     }
-    // TODO: do more than one entry at a time, buffer 10k of them into a vector and write that
-    // Write key/value pairs
-    for (const auto& i : bitmarkers_) {
-      // key
+    // per chunk its key, the number of ids in its array or kBitset and then the array or bitset
+    for (const auto& i : chunks_) {
+      const auto& chunk = i.second;
+      const uint32_t count = chunk.bits.empty() ? static_cast<uint32_t>(chunk.ids.size()) : kBitset;
       file.write(reinterpret_cast<const char*>(&i.first), sizeof(uint64_t));
-      // value
-      file.write(reinterpret_cast<const char*>(&i.second), sizeof(uint64_t));
+      file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      if (chunk.bits.empty()) {
+        file.write(reinterpret_cast<const char*>(chunk.ids.data()),
+                   chunk.ids.size() * sizeof(uint16_t));
+      } else {
+        file.write(reinterpret_cast<const char*>(chunk.bits.data()),
+                   chunk.bits.size() * sizeof(uint64_t));
+      }
     }
     file.close();
-    return true;
+    return static_cast<bool>(file);
   }
 
   /**
@@ -74,24 +96,28 @@ public:
    * @return true if it was succesfully deserialized
    */
   bool deserialize(const std::string& file_name) {
-    std::ifstream file(file_name, std::ios::in | std::ios::binary | std::ios::ate);
+    std::ifstream file(file_name, std::ios::in | std::ios::binary);
     if (!file.is_open()) {
       return false;
     }
-    uint64_t entries = static_cast<uint64_t>(file.tellg()) / 2;
-    file.seekg(0, std::ios::beg);
-
-    // TODO: do more than one entry at a time, buffer 10k of them into a vector and read that
-    // Read the count and then the via ids
-    bitmarkers_.reserve(entries);
-    uint64_t key, value;
-    while (file && entries--) {
-      file.read(reinterpret_cast<char*>(&key), sizeof(key));
-      file.read(reinterpret_cast<char*>(&value), sizeof(value));
-      bitmarkers_[key] = value;
+    uint64_t key;
+    uint32_t count;
+    while (file.read(reinterpret_cast<char*>(&key), sizeof(key)) &&
+           file.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+      auto& chunk = chunks_[key];
+      if (count == kBitset) {
+        chunk.ids.clear();
+        chunk.bits.resize(kBitsetWords);
+        file.read(reinterpret_cast<char*>(chunk.bits.data()), kBitsetWords * sizeof(uint64_t));
+      } else if (count <= kMaxArray) {
+        chunk.bits.clear();
+        chunk.ids.resize(count);
+        file.read(reinterpret_cast<char*>(chunk.ids.data()), count * sizeof(uint16_t));
+      } else {
+        return false;
+      }
     }
-    file.close();
-    return true;
+    return file.eof();
   }
 
   /**
@@ -100,11 +126,82 @@ public:
    * @return
    */
   bool operator==(const UnorderedIdTable& other) const {
-    return bitmarkers_ == other.bitmarkers_;
+    if (chunks_.size() != other.chunks_.size()) {
+      return false;
+    }
+    for (const auto& chunk : chunks_) {
+      auto found = other.chunks_.find(chunk.first);
+      if (found == other.chunks_.cend() || found->second.ids != chunk.second.ids ||
+          found->second.bits != chunk.second.bits) {
+        return false;
+      }
+    }
+    return true;
   }
 
 private:
-  robin_hood::unordered_map<uint64_t, uint64_t> bitmarkers_;
+  static constexpr uint32_t kChunkBits = 16;
+  // an array of more ids than this takes more memory than the bitset of the chunk
+  static constexpr size_t kMaxArray = 4096;
+  static constexpr size_t kBitsetWords = (1 << kChunkBits) / 64;
+  static constexpr uint32_t kBitset = 0xffffffff;
+
+  struct chunk_t {
+    // the low bits of the ids, sorted, while there are at most kMaxArray of them
+    std::vector<uint16_t> ids;
+    // or a bit for every id of the chunk
+    std::vector<uint64_t> bits;
+
+    void set(const uint16_t id) {
+      if (!bits.empty()) {
+        bits[id >> 6] |= static_cast<uint64_t>(1) << (id & 63);
+        return;
+      }
+      // ids mostly come in order so appending is the common case
+      if (ids.empty() || ids.back() < id) {
+        if (ids.size() < kMaxArray) {
+          ids.push_back(id);
+          return;
+        }
+      } else {
+        auto pos = std::lower_bound(ids.begin(), ids.end(), id);
+        if (*pos == id) {
+          return;
+        }
+        if (ids.size() < kMaxArray) {
+          ids.insert(pos, id);
+          return;
+        }
+      }
+      // it got too dense for the array
+      bits.resize(kBitsetWords);
+      for (const auto i : ids) {
+        bits[i >> 6] |= static_cast<uint64_t>(1) << (i & 63);
+      }
+      std::vector<uint16_t>().swap(ids);
+      set(id);
+    }
+
+    bool get(const uint16_t id) const {
+      if (!bits.empty()) {
+        return bits[id >> 6] & (static_cast<uint64_t>(1) << (id & 63));
+      }
+      return std::binary_search(ids.cbegin(), ids.cend(), id);
+    }
+
+    uint64_t size() const {
+      if (bits.empty()) {
+        return ids.size();
+      }
+      uint64_t count = 0;
+      for (const auto word : bits) {
+        count += std::bitset<64>(word).count();
+      }
+      return count;
+    }
+  };
+
+  robin_hood::unordered_map<uint64_t, chunk_t> chunks_;
 };
 
 } // namespace mjolnir
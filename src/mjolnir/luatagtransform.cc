@@ -2,8 +2,10 @@
 
 #include "midgard/logging.h"
 #include "mjolnir/osmdata.h"
+#include <algorithm>
 #include <boost/format.hpp>
 #include <stdexcept>
+#include <vector>
 
 using namespace valhalla::mjolnir;
 
@@ -61,33 +63,115 @@ std::string to_string(OSMType t) {
   }
 }
 
-} // namespace
-
-LuaTagTransform::LuaTagTransform(const std::string& lua) {
-  // create a new lua state
-  state_ = luaL_newstate();
-  luaL_openlibs(state_);
-  luaL_dostring(state_, lua.c_str());
+// Makes a new lua state with the code loaded
+lua_State* NewState(const std::string& lua) {
+  auto* state = luaL_newstate();
+  luaL_openlibs(state);
+  luaL_dostring(state, lua.c_str());
 
   // check that various functions exist
-  CheckLuaFuncExists(state_, LUA_NODE_PROC);
-  CheckLuaFuncExists(state_, LUA_WAY_PROC);
-  CheckLuaFuncExists(state_, LUA_REL_PROC);
+  try {
+    CheckLuaFuncExists(state, LUA_NODE_PROC);
+    CheckLuaFuncExists(state, LUA_WAY_PROC);
+    CheckLuaFuncExists(state, LUA_REL_PROC);
+  } catch (...) {
+    lua_close(state);
+    throw;
+  }
+  return state;
+}
+
+// The same for every ordering of the same tags, each string has its length in front of it so
+// that no two different sets of tags can end up the same
+std::string CacheKey(OSMType type, const Tags& tags) {
+  std::vector<const Tags::value_type*> sorted;
+  sorted.reserve(tags.size());
+  size_t length = 1;
+  for (const auto& tag : tags) {
+    sorted.push_back(&tag);
+    length += tag.first.size() + tag.second.size() + 2 * sizeof(uint32_t);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Tags::value_type* a, const Tags::value_type* b) { return a->first < b->first; });
+
+  std::string key;
+  key.reserve(length);
+  key.push_back(static_cast<char>(type));
+  auto append = [&key](const std::string& s) {
+    uint32_t size = s.size();
+    key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    key.append(s);
+  };
+  for (const auto* tag : sorted) {
+    append(tag->first);
+    append(tag->second);
+  }
+  return key;
+}
+
+} // namespace
+
+LuaTagTransform::LuaTagTransform(const std::string& lua, const size_t cache_size)
+    : lua_(lua), cache_size_(cache_size) {
+  // make the state of this thread right away so that bad lua code is found here
+  State();
 }
 
 LuaTagTransform::~LuaTagTransform() {
-  if (state_ != NULL) {
-    lua_close(state_);
+}
+
+LuaTagTransform::state_t::~state_t() {
+  if (lua != NULL) {
+    lua_close(lua);
   }
 }
 
+LuaTagTransform::state_t& LuaTagTransform::State() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& state = states_[std::this_thread::get_id()];
+  if (!state) {
+    std::unique_ptr<state_t> made(new state_t{NewState(lua_), {}});
+    state = std::move(made);
+  }
+  return *state;
+}
+
 Tags LuaTagTransform::Transform(OSMType type, uint64_t osmid, const Tags& maptags) {
+  auto& state = State();
+  if (cache_size_ == 0) {
+    Tags result;
+    Transform(state.lua, type, osmid, maptags, result);
+    return result;
+  }
 
-  // grab the proper function out of the lua code
+  // the lua code only sees the type and the tags so the same ones give the same result
+  auto key = CacheKey(type, maptags);
+  auto cached = state.cache.find(key);
+  if (cached != state.cache.end()) {
+    return cached->second;
+  }
+
+  // only keep results of calls that went well, so every error is still logged
   Tags result;
+  if (Transform(state.lua, type, osmid, maptags, result)) {
+    if (state.cache.size() >= cache_size_) {
+      state.cache.clear();
+    }
+    state.cache.emplace(std::move(key), result);
+  }
+  return result;
+}
+
+bool LuaTagTransform::Transform(lua_State* state_,
+                                OSMType type,
+                                uint64_t osmid,
+                                const Tags& maptags,
+                                Tags& result) {
+
+  // grab the proper function out of the lua code
+  bool ok = true;
   const std::string& lua_func =
       type == OSMType::kNode ? LUA_NODE_PROC : (type == OSMType::kWay ? LUA_WAY_PROC : LUA_REL_PROC);
-
   try {
     // grab the function
     lua_getglobal(state_, lua_func.c_str());
@@ -134,11 +218,13 @@ Tags LuaTagTransform::Transform(OSMType type, uint64_t osmid, const Tags& maptag
       const char* key = lua_tostring(state_, -2);
       if (key == nullptr) {
         LOG_ERROR((boost::format("Invalid key in Lua function: %1%.") % lua_func).str());
+        ok = false;
         break;
       }
       const char* value = lua_tostring(state_, -1);
       if (value == nullptr) {
         LOG_ERROR((boost::format("Invalid value in Lua function: %1%.") % lua_func).str());
+        ok = false;
         break;
       }
       result[key] = value;
@@ -155,9 +241,11 @@ Tags LuaTagTransform::Transform(OSMType type, uint64_t osmid, const Tags& maptag
   } catch (std::exception& e) {
     // ..gets sent back to the main thread
     LOG_ERROR((boost::format("Exception in Lua function: %1%: %2%") % lua_func % e.what()).str());
+    ok = false;
   } catch (...) {
     LOG_ERROR((boost::format("Unknown exception in Lua function: %1%.") % lua_func).str());
+    ok = false;
   }
 
-  return result;
+  return ok;
 }
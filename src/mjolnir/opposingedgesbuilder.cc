@@ -0,0 +1,80 @@
+#include "mjolnir/opposingedgesbuilder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/opposingedges.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace mjolnir {
+
+void OpposingEdgesBuilder::Build(const boost::property_tree::ptree& pt) {
+  if (!pt.get<bool>("mjolnir.opposing_edges", false)) {
+    return;
+  }
+
+  // The tiles of every level but transit, looked at without any opposing edges written before
+  LOG_INFO("Finding the opposing edges");
+  auto config = pt.get_child("mjolnir");
+  config.put("opposing_edges", false);
+  GraphReader reader(config);
+  std::vector<GraphId> tiles;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& level : TileHierarchy::levels()) {
+    if (level.level == transit_level) {
+      continue;
+    }
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      tiles.push_back(tile_id);
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+
+  // The index of the opposing edge in the tile when it is the same one, its id when it isnt
+  std::vector<uint64_t> offsets{0};
+  std::vector<uint32_t> opposing;
+  std::vector<GraphId> boundary;
+  for (const auto& tile_id : tiles) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    const uint32_t edge_count = tile ? tile->header()->directededgecount() : 0;
+    offsets.push_back(offsets.back() + edge_count);
+    for (uint32_t i = 0; i < edge_count; ++i) {
+      const auto* edge = tile->directededge(i);
+      graph_tile_ptr end_tile = tile;
+      if (edge->IsTransitLine() || !reader.GetGraphTile(edge->endnode(), end_tile)) {
+        opposing.push_back(OpposingEdges::kNone);
+        continue;
+      }
+      GraphId opp_id = edge->endnode();
+      opp_id.set_id(end_tile->node(opp_id)->edge_index() + edge->opp_index());
+      if (opp_id.Tile_Base() == tile_id) {
+        opposing.push_back(opp_id.id());
+      } else {
+        opposing.push_back(OpposingEdges::kBoundary | static_cast<uint32_t>(boundary.size()));
+        boundary.push_back(opp_id);
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  auto file_name = OpposingEdges::FileName(pt.get<std::string>("mjolnir.tile_dir"));
+  OpposingEdges::Write(file_name, tiles, offsets, opposing, boundary);
+  LOG_INFO("Wrote " + file_name + " with the opposing edges of " + std::to_string(offsets.back()) +
+           " edges, " + std::to_string(boundary.size()) + " of them in other tiles");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
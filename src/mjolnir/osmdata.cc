@@ -552,6 +552,7 @@ bool OSMData::read_from_temp_files(const std::string& tile_dir) {
       read_node_names(tile_directory + node_names_file, node_names) &&
       read_unique_names(tile_directory + unique_names_file, name_offset_map) &&
       read_lane_connectivity(tile_directory + lane_connectivity_file, lane_connectivity_map);
+  sort_multimaps();
   LOG_INFO("Done");
   initialized = status;
   return status;
@@ -567,6 +568,14 @@ bool OSMData::read_from_unique_names_file(const std::string& tile_dir) {
   return status;
 }
 
+// Sort the multimaps by way id so they can be searched
+void OSMData::sort_multimaps() {
+  restrictions.sort();
+  access_restrictions.sort();
+  bike_relations.sort();
+  lane_connectivity_map.sort();
+}
+
 // add the direction information to the forward or reverse map for relations.
 void OSMData::add_to_name_map(const uint64_t member_id,
                               const std::string& direction,
@@ -27,7 +27,15 @@
 
 // This is largely based off of: https://github.com/CanalTP/libosmpbfreader
 // there have been some minor changes for our own purposes but its largely the same
+#include <algorithm>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #ifdef _MSC_VER
 #include <winsock2.h> // ntohl
 #else
@@ -81,9 +89,7 @@ BlobHeader read_header(char* buffer, std::ifstream& file, bool& finished) {
   return result;
 }
 
-int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
-  Blob blob;
-
+int32_t read_blob_bytes(char* buffer, std::ifstream& file, const BlobHeader& header) {
   // is the size of the following blob sane
   int32_t sz = header.datasize();
   if (sz > MAX_UNCOMPRESSED_BLOB_SIZE) {
@@ -94,6 +100,11 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
   if (!file.read(buffer, sz)) {
     throw std::runtime_error("unable to read blob from file");
   }
+  return sz;
+}
+
+int32_t unpack_blob(const char* buffer, int32_t sz, char* unpack_buffer) {
+  Blob blob;
 
   // turn it into a protobuf object
   if (!blob.ParseFromArray(buffer, sz)) {
@@ -107,7 +118,7 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
     if (sz != blob.raw_size()) {
       LOG_WARN("blob reports wrong raw_size: " + std::to_string(blob.raw_size()) + " bytes");
     }
-    memcpy(unpack_buffer, buffer, sz);
+    memcpy(unpack_buffer, blob.raw().data(), sz);
     return sz;
   } // if the blob was zlib compressed
   else if (blob.has_zlib_data()) {
@@ -115,6 +126,9 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
     z_stream z;
     z.next_in = (unsigned char*)blob.zlib_data().c_str();
     z.avail_in = sz;
+    if (blob.raw_size() > MAX_UNCOMPRESSED_BLOB_SIZE) {
+      throw std::runtime_error("blob-size is bigger than allowed");
+    }
     z.next_out = (unsigned char*)unpack_buffer;
     z.avail_out = blob.raw_size();
     z.zalloc = Z_NULL;
@@ -139,6 +153,10 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
   throw std::runtime_error("Unsupported blob data format");
 }
 
+int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
+  return unpack_blob(buffer, read_blob_bytes(buffer, file, header), unpack_buffer);
+}
+
 template <class T> OSMPBF::Tags get_tags(const T& object, const OSMPBF::PrimitiveBlock& primblock) {
   OSMPBF::Tags result(object.keys_size());
   for (int i = 0; i < object.keys_size(); ++i) {
@@ -151,16 +169,9 @@ template <class T> OSMPBF::Tags get_tags(const T& object, const OSMPBF::Primitiv
   return result;
 }
 
-void parse_primitive_block(char* unpack_buffer,
-                           int32_t sz,
+void parse_primitive_block(const PrimitiveBlock& primblock,
                            const Interest interest,
                            Callback& callback) {
-  // turn the blob bytes into a protobuf object
-  PrimitiveBlock primblock;
-  if (!primblock.ParseFromArray(unpack_buffer, sz)) {
-    throw std::runtime_error("unable to parse primitive block");
-  }
-
   // for each primitive group
   for (const auto& primitive_group : primblock.primitivegroup()) {
 
@@ -262,6 +273,18 @@ void parse_primitive_block(char* unpack_buffer,
   }
 }
 
+void parse_primitive_block(char* unpack_buffer,
+                           int32_t sz,
+                           const Interest interest,
+                           Callback& callback) {
+  // turn the blob bytes into a protobuf object
+  PrimitiveBlock primblock;
+  if (!primblock.ParseFromArray(unpack_buffer, sz)) {
+    throw std::runtime_error("unable to parse primitive block");
+  }
+  parse_primitive_block(primblock, interest, callback);
+}
+
 void parse_header_block(char* unpack_buffer, int32_t sz) {
   // turn the blob bytes into a protobuf object
   HeaderBlock header_block;
@@ -272,6 +295,152 @@ void parse_header_block(char* unpack_buffer, int32_t sz) {
   // TODO: do something with replication information?
 }
 
+// reads the blobs on one thread, unpacks and decodes them on a pool of threads and calls back
+// on the calling thread, in the order of the file or in the order they are decoded. only so many
+// blobs are read ahead of the last one called back on so that memory stays bounded
+void parse_parallel(std::ifstream& file,
+                    const Interest interest,
+                    Callback& callback,
+                    const size_t threads,
+                    const bool ordered) {
+  struct work_t {
+    size_t index;
+    BlobHeader header;
+    std::vector<char> bytes;
+  };
+  struct result_t {
+    std::unique_ptr<PrimitiveBlock> block;
+    std::exception_ptr error;
+  };
+  std::mutex mutex;
+  std::condition_variable work_available, result_available, room_available;
+  std::deque<work_t> work;
+  std::map<size_t, result_t> results;
+  const size_t max_pending = threads * 2;
+  size_t read = 0, delivered = 0;
+  bool done_reading = false, stop = false;
+
+  // read the raw blobs off of the file, the errors are passed on as results so they come in order
+  auto read_blobs = [&]() {
+    std::vector<char> buffer(MAX_BLOB_HEADER_SIZE);
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        room_available.wait(lock, [&]() { return stop || read - delivered < max_pending; });
+        if (stop) {
+          break;
+        }
+      }
+      work_t next{read, {}, {}};
+      try {
+        bool finished = false;
+        next.header = read_header(buffer.data(), file, finished);
+        if (finished) {
+          break;
+        }
+        next.bytes.resize(std::max(next.header.datasize(), 1));
+        read_blob_bytes(next.bytes.data(), file, next.header);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.emplace(read++, result_t{nullptr, std::current_exception()});
+        result_available.notify_one();
+        break;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      ++read;
+      work.emplace_back(std::move(next));
+      work_available.notify_one();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    done_reading = true;
+    work_available.notify_all();
+    result_available.notify_one();
+  };
+
+  // unpack and decode the blobs, each thread with its own buffer of which only what is used of it
+  // is ever touched
+  auto decode_blobs = [&]() {
+    std::unique_ptr<char[]> unpack_buffer(new char[MAX_UNCOMPRESSED_BLOB_SIZE]);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      work_available.wait(lock, [&]() { return stop || done_reading || !work.empty(); });
+      if (stop || work.empty()) {
+        return;
+      }
+      auto next = std::move(work.front());
+      work.pop_front();
+      lock.unlock();
+      result_t result{nullptr, nullptr};
+      try {
+        auto sz = unpack_blob(next.bytes.data(), next.header.datasize(), unpack_buffer.get());
+        if (next.header.type() == "OSMData") {
+          result.block.reset(new PrimitiveBlock());
+          if (!result.block->ParseFromArray(unpack_buffer.get(), sz)) {
+            throw std::runtime_error("unable to parse primitive block");
+          }
+        } else if (next.header.type() == "OSMHeader") {
+          parse_header_block(unpack_buffer.get(), sz);
+        } else {
+          LOG_WARN("Unknown blob type: " + next.header.type());
+        }
+      } catch (...) { result.error = std::current_exception(); }
+      lock.lock();
+      results.emplace(next.index, std::move(result));
+      result_available.notify_one();
+    }
+  };
+
+  // whatever happens the threads are stopped before we leave
+  std::vector<std::thread> pool;
+  struct joiner_t {
+    ~joiner_t() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+      }
+      work_available.notify_all();
+      room_available.notify_all();
+      for (auto& thread : pool) {
+        thread.join();
+      }
+    }
+    std::mutex& mutex;
+    bool& stop;
+    std::condition_variable& work_available;
+    std::condition_variable& room_available;
+    std::vector<std::thread>& pool;
+  } joiner{mutex, stop, work_available, room_available, pool};
+  pool.emplace_back(read_blobs);
+  for (size_t i = 0; i < threads; ++i) {
+    pool.emplace_back(decode_blobs);
+  }
+
+  // call back with the results as they are ready
+  while (true) {
+    result_t result;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      result_available.wait(lock, [&]() {
+        return (done_reading && delivered == read) ||
+               (!results.empty() && (!ordered || results.begin()->first == delivered));
+      });
+      if (results.empty()) {
+        break;
+      }
+      result = std::move(results.begin()->second);
+      results.erase(results.begin());
+      ++delivered;
+      room_available.notify_one();
+    }
+    if (result.error) {
+      std::rethrow_exception(result.error);
+    }
+    if (result.block) {
+      parse_primitive_block(*result.block, interest, callback);
+    }
+  }
+}
+
 } // namespace
 
 // extend the protobuf osmpbf namespace
@@ -285,13 +454,21 @@ Member::Member(Member&& other)
     : member_type(other.member_type), member_id(other.member_id), role(std::move(other.role)) {
 }
 
-void Parser::parse(std::ifstream& file, const Interest interest, Callback& callback) {
-  char* buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-  char* unpack_buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-
+void Parser::parse(std::ifstream& file,
+                   const Interest interest,
+                   Callback& callback,
+                   const size_t threads,
+                   const bool ordered) {
   // start from the top
   file.clear();
   file.seekg(0, std::ios::beg);
+  if (threads > 1) {
+    parse_parallel(file, interest, callback, threads, ordered);
+    return;
+  }
+
+  char* buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
+  char* unpack_buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
 
   // while there is more to read
   while (!file.eof()) {
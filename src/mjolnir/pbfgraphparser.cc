@@ -49,6 +49,66 @@ int get_number(const std::string& tag, const std::string& value) { // NOLINT
   return num;
 }
 
+// The keys of the node tags the node callback looks at. Each tag of a node is looked up once
+// rather than compared against all of the keys in turn.
+enum class NodeTag : uint8_t {
+  kIso3166_1,
+  kStateIsoCode,
+  kHighway,
+  kForwardSignal,
+  kBackwardSignal,
+  kUrban,
+  kExitTo,
+  kRef,
+  kName,
+  kGate,
+  kBollard,
+  kTollBooth,
+  kBorderControl,
+  kTollGantry,
+  kSumpBuster,
+  kAccessMask,
+  kOther,
+};
+const std::unordered_map<std::string, NodeTag> kNodeTags = {
+    {"iso:3166_1", NodeTag::kIso3166_1},
+    {"state_iso_code", NodeTag::kStateIsoCode},
+    {"highway", NodeTag::kHighway},
+    {"forward_signal", NodeTag::kForwardSignal},
+    {"backward_signal", NodeTag::kBackwardSignal},
+    {"urban", NodeTag::kUrban},
+    {"exit_to", NodeTag::kExitTo},
+    {"ref", NodeTag::kRef},
+    {"name", NodeTag::kName},
+    {"gate", NodeTag::kGate},
+    {"bollard", NodeTag::kBollard},
+    {"toll_booth", NodeTag::kTollBooth},
+    {"border_control", NodeTag::kBorderControl},
+    {"toll_gantry", NodeTag::kTollGantry},
+    {"sump_buster", NodeTag::kSumpBuster},
+    {"access_mask", NodeTag::kAccessMask},
+};
+
+// The access modes of the <mode>:conditional way tags, by the part of the key before :conditional
+const std::unordered_map<std::string, uint16_t> kConditionalModes = {
+    {"motorcar", kAutoAccess | kTruckAccess | kEmergencyAccess | kTaxiAccess | kBusAccess |
+                     kHOVAccess | kMopedAccess | kMotorcycleAccess},
+    {"motor_vehicle", kAutoAccess | kTruckAccess | kEmergencyAccess | kTaxiAccess | kBusAccess |
+                          kHOVAccess | kMopedAccess | kMotorcycleAccess},
+    {"bicycle", kBicycleAccess},
+    {"foot", kPedestrianAccess | kWheelchairAccess},
+    {"pedestrian", kPedestrianAccess | kWheelchairAccess},
+    {"hgv", kTruckAccess},
+    {"moped", kMopedAccess},
+    {"mofa", kMopedAccess},
+    {"motorcycle", kMotorcycleAccess},
+    {"psv", kTaxiAccess | kBusAccess},
+    {"taxi", kTaxiAccess},
+    {"bus", kBusAccess},
+    {"hov", kHOVAccess},
+    {"emergency", kEmergencyAccess},
+};
+
 // Construct PBFGraphParser based on properties file and input PBF extract
 struct graph_callback : public OSMPBF::Callback {
 public:
@@ -882,104 +942,106 @@ public:
       n.set_type(NodeType::kMotorWayJunction);
     }
 
-    for (const auto& tag : *results) {
-      if (tag.first == "iso:3166_1" && !use_admin_db_) {
-        bool hasTag = (tag.second.length() ? true : false);
-        if (hasTag) {
-          // Add the country iso code to the unique node names list and store its index in the OSM
-          // node
-          n.set_country_iso_index(osmdata_.node_names.index(tag.second));
-          ++osmdata_.node_name_count;
+    // Nodes which are gates, bollards, tolls etc. are intersections
+    auto set_barrier = [&](const std::string& value, const NodeType type) {
+      if (value == "true") {
+        if (!intersection) {
+          intersection = true;
+          ++osmdata_.edge_count;
         }
-      } else if ((tag.first == "state_iso_code" && !use_admin_db_)) {
-        bool hasTag = (tag.second.length() ? true : false);
-        if (hasTag) {
-          // Add the state iso code to the unique node names list and store its index in the OSM
-          // node
-          n.set_state_iso_index(osmdata_.node_names.index(tag.second));
-          ++osmdata_.node_name_count;
-        }
-      } else if (tag.first == "highway") {
-        n.set_traffic_signal(tag.second == "traffic_signals" ? true : false);
-      } else if (tag.first == "forward_signal") {
-        n.set_forward_signal(tag.second == "true" ? true : false);
-      } else if (tag.first == "backward_signal") {
-        n.set_backward_signal(tag.second == "true" ? true : false);
-      } else if (use_urban_tag_ && tag.first == "urban") {
-        n.set_urban(tag.second == "true" ? true : false);
-      } else if (is_highway_junction && (tag.first == "exit_to")) {
-        bool hasTag = (tag.second.length() ? true : false);
-        if (hasTag) {
-          // Add the name to the unique node names list and store its index in the OSM node
-          n.set_exit_to_index(osmdata_.node_names.index(tag.second));
-          ++osmdata_.node_exit_to_count;
-        }
-      } else if (is_highway_junction && (tag.first == "ref")) {
-        bool hasTag = (tag.second.length() ? true : false);
-        if (hasTag) {
-          // Add the name to the unique node names list and store its index in the OSM node
-          n.set_ref_index(osmdata_.node_names.index(tag.second));
-          ++osmdata_.node_ref_count;
-        }
-      } else if ((is_highway_junction || has_junction_name) && (tag.first == "name")) {
-        bool hasTag = (tag.second.length() ? true : false);
-        if (hasTag) {
-          // Add the name to the unique node names list and store its index in the OSM node
-          n.set_name_index(osmdata_.node_names.index(tag.second));
-          ++osmdata_.node_name_count;
-        }
-      } else if (tag.first == "gate") {
-        if (tag.second == "true") {
-          if (!intersection) {
-            intersection = true;
-            ++osmdata_.edge_count;
+        n.set_type(type);
+      }
+    };
+
+    for (const auto& tag : *results) {
+      const auto key = kNodeTags.find(tag.first);
+      NodeTag node_tag = key == kNodeTags.end() ? NodeTag::kOther : key->second;
+
+      // Some of the tags only count in some cases
+      if (((node_tag == NodeTag::kIso3166_1 || node_tag == NodeTag::kStateIsoCode) &&
+           use_admin_db_) ||
+          (node_tag == NodeTag::kUrban && !use_urban_tag_) ||
+          ((node_tag == NodeTag::kExitTo || node_tag == NodeTag::kRef) && !is_highway_junction) ||
+          (node_tag == NodeTag::kName && !is_highway_junction && !has_junction_name)) {
+        node_tag = NodeTag::kOther;
+      }
+
+      switch (node_tag) {
+        case NodeTag::kIso3166_1:
+          if (tag.second.length()) {
+            // Add the country iso code to the unique node names list and store its index in the
+            // OSM node
+            n.set_country_iso_index(osmdata_.node_names.index(tag.second));
+            ++osmdata_.node_name_count;
           }
-          n.set_type(NodeType::kGate);
-        }
-      } else if (tag.first == "bollard") {
-        if (tag.second == "true") {
-          if (!intersection) {
-            intersection = true;
-            ++osmdata_.edge_count;
+          break;
+        case NodeTag::kStateIsoCode:
+          if (tag.second.length()) {
+            // Add the state iso code to the unique node names list and store its index in the OSM
+            // node
+            n.set_state_iso_index(osmdata_.node_names.index(tag.second));
+            ++osmdata_.node_name_count;
           }
-          n.set_type(NodeType::kBollard);
-        }
-      } else if (tag.first == "toll_booth") {
-        if (tag.second == "true") {
-          if (!intersection) {
-            intersection = true;
-            ++osmdata_.edge_count;
+          break;
+        case NodeTag::kHighway:
+          n.set_traffic_signal(tag.second == "traffic_signals" ? true : false);
+          break;
+        case NodeTag::kForwardSignal:
+          n.set_forward_signal(tag.second == "true" ? true : false);
+          break;
+        case NodeTag::kBackwardSignal:
+          n.set_backward_signal(tag.second == "true" ? true : false);
+          break;
+        case NodeTag::kUrban:
+          n.set_urban(tag.second == "true" ? true : false);
+          break;
+        case NodeTag::kExitTo:
+          if (tag.second.length()) {
+            // Add the name to the unique node names list and store its index in the OSM node
+            n.set_exit_to_index(osmdata_.node_names.index(tag.second));
+            ++osmdata_.node_exit_to_count;
           }
-          n.set_type(NodeType::kTollBooth);
-        }
-      } else if (tag.first == "border_control") {
-        if (tag.second == "true") {
-          if (!intersection) {
-            intersection = true;
-            ++osmdata_.edge_count;
+          break;
+        case NodeTag::kRef:
+          if (tag.second.length()) {
+            // Add the name to the unique node names list and store its index in the OSM node
+            n.set_ref_index(osmdata_.node_names.index(tag.second));
+            ++osmdata_.node_ref_count;
           }
-          n.set_type(NodeType::kBorderControl);
-        }
-      } else if (tag.first == "toll_gantry") {
-        if (tag.second == "true") {
-          if (!intersection) {
-            intersection = true;
-            ++osmdata_.edge_count;
+          break;
+        case NodeTag::kName:
+          if (tag.second.length()) {
+            // Add the name to the unique node names list and store its index in the OSM node
+            n.set_name_index(osmdata_.node_names.index(tag.second));
+            ++osmdata_.node_name_count;
           }
-          n.set_type(NodeType::kTollGantry);
-        }
-      } else if (tag.first == "sump_buster") {
-        if (tag.second == "true") {
-          if (!intersection) {
-            intersection = true;
-            ++osmdata_.edge_count;
+          break;
+        case NodeTag::kGate:
+          set_barrier(tag.second, NodeType::kGate);
+          break;
+        case NodeTag::kBollard:
+          set_barrier(tag.second, NodeType::kBollard);
+          break;
+        case NodeTag::kTollBooth:
+          set_barrier(tag.second, NodeType::kTollBooth);
+          break;
+        case NodeTag::kBorderControl:
+          set_barrier(tag.second, NodeType::kBorderControl);
+          break;
+        case NodeTag::kTollGantry:
+          set_barrier(tag.second, NodeType::kTollGantry);
+          break;
+        case NodeTag::kSumpBuster:
+          set_barrier(tag.second, NodeType::kSumpBuster);
+          break;
+        case NodeTag::kAccessMask:
+          n.set_access(std::stoi(tag.second));
+          break;
+        case NodeTag::kOther:
+          if (has_junction_name) {
+            n.set_named_intersection(true);
           }
-          n.set_type(NodeType::kSumpBuster);
-        }
-      } else if (tag.first == "access_mask") {
-        n.set_access(std::stoi(tag.second));
-      } else if (has_junction_name) {
-        n.set_named_intersection(true);
+          break;
       }
 
       /* TODO: payment type.
@@ -1143,78 +1205,44 @@ public:
       const auto it = tag_handlers_.find(tag_.first);
       if (it != tag_handlers_.end()) {
         it->second();
+        continue;
       }
+
       // motor_vehicle:conditional=no @ (16:30-07:00)
-      else if (tag_.first.substr(0, 20) == "motorcar:conditional" ||
-               tag_.first.substr(0, 25) == "motor_vehicle:conditional" ||
-               tag_.first.substr(0, 19) == "bicycle:conditional" ||
-               tag_.first.substr(0, 22) == "motorcycle:conditional" ||
-               tag_.first.substr(0, 16) == "foot:conditional" ||
-               tag_.first.substr(0, 22) == "pedestrian:conditional" ||
-               tag_.first.substr(0, 15) == "hgv:conditional" ||
-               tag_.first.substr(0, 17) == "moped:conditional" ||
-               tag_.first.substr(0, 16) == "mofa:conditional" ||
-               tag_.first.substr(0, 15) == "psv:conditional" ||
-               tag_.first.substr(0, 16) == "taxi:conditional" ||
-               tag_.first.substr(0, 15) == "bus:conditional" ||
-               tag_.first.substr(0, 15) == "hov:conditional" ||
-               tag_.first.substr(0, 21) == "emergency:conditional") {
-
-        std::vector<std::string> tokens = GetTagTokens(tag_.second, '@');
-        std::string tmp = tokens.at(0);
+      auto conditional = tag_.first.find(":conditional");
+      if (conditional == std::string::npos) {
+        continue;
+      }
+      const auto modes = kConditionalModes.find(tag_.first.substr(0, conditional));
+      if (modes == kConditionalModes.end()) {
+        continue;
+      }
+
+      std::vector<std::string> tokens = GetTagTokens(tag_.second, '@');
+      std::string tmp = tokens.at(0);
+      boost::algorithm::trim(tmp);
+
+      AccessType type = AccessType::kTimedDenied;
+      if (tmp == "no") {
+        type = AccessType::kTimedDenied;
+      } else if (tmp == "yes" || tmp == "private" || tmp == "delivery" || tmp == "designated") {
+        type = AccessType::kTimedAllowed;
+      }
+
+      if (tokens.size() == 2 && tmp.size()) {
+        std::string tmp = tokens.at(1);
         boost::algorithm::trim(tmp);
+        std::vector<std::string> conditions = GetTagTokens(tmp, ';');
 
-        AccessType type = AccessType::kTimedDenied;
-        if (tmp == "no") {
-          type = AccessType::kTimedDenied;
-        } else if (tmp == "yes" || tmp == "private" || tmp == "delivery" || tmp == "designated") {
-          type = AccessType::kTimedAllowed;
-        }
+        for (const auto& condition : conditions) {
+          std::vector<uint64_t> values = get_time_range(condition);
 
-        if (tokens.size() == 2 && tmp.size()) {
-
-          uint16_t mode = 0;
-          if (tag_.first.substr(0, 20) == "motorcar:conditional" ||
-              tag_.first.substr(0, 25) == "motor_vehicle:conditional") {
-            mode = (kAutoAccess | kTruckAccess | kEmergencyAccess | kTaxiAccess | kBusAccess |
-                    kHOVAccess | kMopedAccess | kMotorcycleAccess);
-          } else if (tag_.first.substr(0, 19) == "bicycle:conditional") {
-            mode = kBicycleAccess;
-          } else if (tag_.first.substr(0, 16) == "foot:conditional" ||
-                     tag_.first.substr(0, 22) == "pedestrian:conditional") {
-            mode = (kPedestrianAccess | kWheelchairAccess);
-          } else if (tag_.first.substr(0, 15) == "hgv:conditional") {
-            mode = kTruckAccess;
-          } else if (tag_.first.substr(0, 17) == "moped:conditional" ||
-                     tag_.first.substr(0, 16) == "mofa:conditional") {
-            mode = kMopedAccess;
-          } else if (tag_.first.substr(0, 22) == "motorcycle:conditional") {
-            mode = kMotorcycleAccess;
-          } else if (tag_.first.substr(0, 15) == "psv:conditional") {
-            mode = (kTaxiAccess | kBusAccess);
-          } else if (tag_.first.substr(0, 16) == "taxi:conditional") {
-            mode = kTaxiAccess;
-          } else if (tag_.first.substr(0, 15) == "bus:conditional") {
-            mode = kBusAccess;
-          } else if (tag_.first.substr(0, 15) == "hov:conditional") {
-            mode = kHOVAccess;
-          } else if (tag_.first.substr(0, 21) == "emergency:conditional") {
-            mode = kEmergencyAccess;
-          }
-          std::string tmp = tokens.at(1);
-          boost::algorithm::trim(tmp);
-          std::vector<std::string> conditions = GetTagTokens(tmp, ';');
-
-          for (const auto& condition : conditions) {
-            std::vector<uint64_t> values = get_time_range(condition);
-
-            for (const auto& v : values) {
-              OSMAccessRestriction restriction;
-              restriction.set_type(static_cast<AccessType>(type));
-              restriction.set_modes(mode);
-              restriction.set_value(v);
-              osmdata_.access_restrictions.insert({osmid_, restriction});
-            }
+          for (const auto& v : values) {
+            OSMAccessRestriction restriction;
+            restriction.set_type(static_cast<AccessType>(type));
+            restriction.set_modes(modes->second);
+            restriction.set_value(v);
+            osmdata_.access_restrictions.insert({osmid_, restriction});
           }
         }
       }
@@ -2086,7 +2114,7 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
 
   LOG_INFO("Finished with " + std::to_string(osmdata.osm_way_count) + " routable ways containing " +
@@ -2150,8 +2178,9 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::RELATIONS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
+  osmdata.sort_multimaps();
   LOG_INFO("Finished with " + std::to_string(osmdata.restrictions.size()) + " simple restrictions");
   LOG_INFO("Finished with " + std::to_string(osmdata.lane_connectivity_map.size()) +
            " lane connections");
@@ -2216,7 +2245,7 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
       callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr,
                      new sequence<OSMNode>(bss_nodes_file, true));
       OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES),
-                            callback);
+                            callback, threads);
     }
   }
   callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
@@ -2245,7 +2274,7 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
   uint64_t max_osm_id = callback.last_node_;
   callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
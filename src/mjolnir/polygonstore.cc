@@ -0,0 +1,214 @@
+#include "mjolnir/polygonstore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+namespace {
+
+constexpr char kMagic[8] = "VLHPOLY";
+
+template <typename T> void write(std::ofstream& out, const T* data, const size_t count) {
+  out.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+constexpr uint32_t PolygonStore::kNone;
+constexpr uint32_t PolygonStore::kVersion;
+constexpr uint64_t PolygonStore::kOuterRing;
+constexpr int PolygonStore::kIndexColumns;
+constexpr int PolygonStore::kIndexRows;
+
+void PolygonStore::Writer::Add(const multi_polygon_type& geometry,
+                               const std::string& name,
+                               const std::string& iso_code,
+                               polygon_t attributes,
+                               const uint64_t id) {
+  attributes.minx = attributes.miny = std::numeric_limits<double>::max();
+  attributes.maxx = attributes.maxy = std::numeric_limits<double>::lowest();
+  attributes.first_ring = rings_.size();
+  attributes.name = AddString(name);
+  attributes.iso_code = AddString(iso_code);
+  auto add_ring = [this, &attributes](const polygon_type::ring_type& ring, const bool outer) {
+    rings_.push_back((points_.size() / 2) | (outer ? kOuterRing : 0));
+    for (const auto& point : ring) {
+      points_.push_back(point.x());
+      points_.push_back(point.y());
+      attributes.minx = std::min(attributes.minx, point.x());
+      attributes.miny = std::min(attributes.miny, point.y());
+      attributes.maxx = std::max(attributes.maxx, point.x());
+      attributes.maxy = std::max(attributes.maxy, point.y());
+    }
+  };
+  for (const auto& polygon : geometry) {
+    add_ring(polygon.outer(), true);
+    for (const auto& inner : polygon.inners()) {
+      add_ring(inner, false);
+    }
+  }
+  attributes.ring_count = rings_.size() - attributes.first_ring;
+  polygons_.push_back(attributes);
+  ids_.push_back(id);
+}
+
+uint32_t PolygonStore::Writer::AddString(const std::string& str) {
+  uint32_t offset = strings_.size();
+  strings_.insert(strings_.end(), str.begin(), str.end());
+  strings_.push_back('\0');
+  return offset;
+}
+
+size_t PolygonStore::Writer::Write(const std::string& file_name) {
+  // the parents by their position rather than their id
+  std::unordered_map<uint64_t, uint32_t> positions;
+  for (uint32_t i = 0; i < ids_.size(); ++i) {
+    positions.emplace(ids_[i], i);
+  }
+  for (auto& polygon : polygons_) {
+    auto found = polygon.parent == kNone ? positions.cend() : positions.find(polygon.parent);
+    polygon.parent = found == positions.cend() ? kNone : found->second;
+  }
+
+  // the polygons of each square degree
+  std::vector<std::vector<uint32_t>> cells(kIndexColumns * kIndexRows);
+  uint64_t entry_count = 0;
+  for (uint32_t i = 0; i < polygons_.size(); ++i) {
+    const auto& polygon = polygons_[i];
+    if (polygon.ring_count == 0) {
+      continue;
+    }
+    for (int r = row(polygon.miny); r <= row(polygon.maxy); ++r) {
+      for (int c = column(polygon.minx); c <= column(polygon.maxx); ++c) {
+        cells[r * kIndexColumns + c].push_back(i);
+        ++entry_count;
+      }
+    }
+  }
+  std::vector<uint32_t> offsets;
+  offsets.reserve(cells.size() + 1);
+  std::vector<uint32_t> entries;
+  entries.reserve(entry_count);
+  for (const auto& cell : cells) {
+    offsets.push_back(entries.size());
+    entries.insert(entries.end(), cell.begin(), cell.end());
+  }
+  offsets.push_back(entries.size());
+  rings_.push_back(points_.size() / 2);
+
+  // write it next to where it goes
+  auto partial = file_name + ".partial";
+  std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+  header_t header{};
+  std::memcpy(header.magic, kMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.polygon_count = polygons_.size();
+  header.ring_count = rings_.size() - 1;
+  header.point_count = points_.size() / 2;
+  header.string_size = strings_.size();
+  header.index_entry_count = entries.size();
+  write(out, &header, 1);
+  write(out, polygons_.data(), polygons_.size());
+  write(out, rings_.data(), rings_.size());
+  write(out, points_.data(), points_.size());
+  write(out, offsets.data(), offsets.size());
+  write(out, entries.data(), entries.size());
+  write(out, strings_.data(), strings_.size());
+  out.close();
+  if (!out || std::rename(partial.c_str(), file_name.c_str()) != 0) {
+    throw std::runtime_error("Could not write the polygons to " + file_name);
+  }
+  return polygons_.size();
+}
+
+PolygonStore::PolygonStore(const std::string& file_name) {
+  struct stat s;
+  if (stat(file_name.c_str(), &s) != 0 || static_cast<size_t>(s.st_size) < sizeof(header_t)) {
+    throw std::runtime_error("No polygons in " + file_name);
+  }
+  memmap_.map(file_name, s.st_size, POSIX_MADV_RANDOM);
+  const char* data = static_cast<const char*>(memmap_);
+  header_ = reinterpret_cast<const header_t*>(data);
+  if (std::memcmp(header_->magic, kMagic, sizeof(header_->magic)) != 0 ||
+      header_->version != kVersion) {
+    throw std::runtime_error(file_name + " is not a store of polygons of this version");
+  }
+
+  // the sections follow one another
+  size_t offset = sizeof(header_t);
+  polygons_ = reinterpret_cast<const polygon_t*>(data + offset);
+  offset += header_->polygon_count * sizeof(polygon_t);
+  rings_ = reinterpret_cast<const uint64_t*>(data + offset);
+  offset += (header_->ring_count + 1) * sizeof(uint64_t);
+  points_ = reinterpret_cast<const double*>(data + offset);
+  offset += header_->point_count * 2 * sizeof(double);
+  index_offsets_ = reinterpret_cast<const uint32_t*>(data + offset);
+  offset += (kIndexColumns * kIndexRows + 1) * sizeof(uint32_t);
+  index_entries_ = reinterpret_cast<const uint32_t*>(data + offset);
+  offset += header_->index_entry_count * sizeof(uint32_t);
+  strings_ = data + offset;
+  offset += header_->string_size;
+  if (offset != static_cast<size_t>(s.st_size)) {
+    throw std::runtime_error(file_name + " has an incorrect size for its polygons");
+  }
+}
+
+multi_polygon_type PolygonStore::geometry(const uint32_t index) const {
+  multi_polygon_type geometry;
+  const auto& polygon = polygons_[index];
+  for (uint64_t r = polygon.first_ring; r < polygon.first_ring + polygon.ring_count; ++r) {
+    polygon_type::ring_type* ring;
+    if (rings_[r] & kOuterRing || geometry.empty()) {
+      geometry.emplace_back();
+      ring = &geometry.back().outer();
+    } else {
+      geometry.back().inners().emplace_back();
+      ring = &geometry.back().inners().back();
+    }
+    const auto begin = rings_[r] & ~kOuterRing, end = rings_[r + 1] & ~kOuterRing;
+    ring->reserve(end - begin);
+    for (auto p = begin; p < end; ++p) {
+      ring->emplace_back(points_[p * 2], points_[p * 2 + 1]);
+    }
+  }
+  return geometry;
+}
+
+std::vector<uint32_t> PolygonStore::find(const midgard::AABB2<midgard::PointLL>& aabb) const {
+  std::vector<uint32_t> found;
+  for (int r = row(aabb.miny()); r <= row(aabb.maxy()); ++r) {
+    for (int c = column(aabb.minx()); c <= column(aabb.maxx()); ++c) {
+      const auto cell = r * kIndexColumns + c;
+      for (auto i = index_offsets_[cell]; i < index_offsets_[cell + 1]; ++i) {
+        const auto& polygon = polygons_[index_entries_[i]];
+        if (polygon.minx <= aabb.maxx() && polygon.maxx >= aabb.minx() &&
+            polygon.miny <= aabb.maxy() && polygon.maxy >= aabb.miny()) {
+          found.push_back(index_entries_[i]);
+        }
+      }
+    }
+  }
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  return found;
+}
+
+int PolygonStore::column(const double lng) {
+  return std::min(std::max(static_cast<int>(std::floor(lng + 180)), 0), kIndexColumns - 1);
+}
+
+int PolygonStore::row(const double lat) {
+  return std::min(std::max(static_cast<int>(std::floor(lat + 90)), 0), kIndexRows - 1);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
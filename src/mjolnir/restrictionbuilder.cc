@@ -3,11 +3,14 @@
 #include "mjolnir/dataquality.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/osmrestriction.h"
+#include "mjolnir/tilequeue.h"
 
+#include <boost/functional/hash.hpp>
 #include <future>
-#include <queue>
+#include <mutex>
 #include <set>
 #include <thread>
+#include <unordered_map>
 
 #include "baldr/datetime.h"
 #include "baldr/graphconstants.h"
@@ -24,17 +27,14 @@ using namespace valhalla::baldr;
 using namespace valhalla::mjolnir;
 
 // Function to replace wayids with graphids.  Will transition up and down the hierarchy as needed.
+// Tiles are only ever replaced whole so they can be read without a lock while others are stored.
 std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
                                 GraphReader& reader,
                                 GraphId& tileid,
-                                std::mutex& lock,
-                                std::vector<uint64_t> res_way_ids) {
+                                const std::vector<uint64_t>& res_way_ids) {
 
   std::deque<GraphId> graphids;
-
-  lock.lock();
   graph_tile_ptr endnodetile = reader.GetGraphTile(n_graphId);
-  lock.unlock();
 
   const NodeInfo* n_info = endnodetile->node(n_graphId);
   bool bBeginFound = false;
@@ -76,9 +76,7 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
           currentNode = de->endnode();
           // get the new tile if needed.
           if (endnodetile->id() != currentNode.Tile_Base()) {
-            lock.lock();
             endnodetile = reader.GetGraphTile(currentNode);
-            lock.unlock();
           }
 
           // get new end node and start over.
@@ -93,9 +91,7 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
             currentNode = de->endnode();
             // get the new tile if needed.
             if (endnodetile->id() != currentNode.Tile_Base()) {
-              lock.lock();
               endnodetile = reader.GetGraphTile(currentNode);
-              lock.unlock();
             }
 
             // get new end node and start over.
@@ -119,9 +115,7 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
             const NodeTransition* trans = endnodetile->transition(n_info->transition_index() + k);
 
             if (temp_endnodetile->id() != trans->endnode().Tile_Base()) {
-              lock.lock();
               temp_endnodetile = reader.GetGraphTile(trans->endnode());
-              lock.unlock();
             }
 
             currentNode = trans->endnode();
@@ -158,9 +152,7 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
 
                   // get the new tile if needed.
                   if (endnodetile->id() != currentNode.Tile_Base()) {
-                    lock.lock();
                     endnodetile = reader.GetGraphTile(currentNode);
-                    lock.unlock();
                   }
 
                   // get new end node and start over.
@@ -185,9 +177,7 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
               visited_set.clear();
               i = 0; // start over avoiding the first graphid
                      //(i.e., we walked the graph in the wrong direction)
-              lock.lock();
               endnodetile = reader.GetGraphTile(n_graphId);
-              lock.unlock();
               n_info = endnodetile->node(n_graphId);
               currentNode = n_graphId;
               prev_Node = GraphId();
@@ -210,9 +200,7 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
             visited_set.clear();
             i = 0; // start over avoiding the first graphid
                    //(i.e., we walked the graph in the wrong direction)
-            lock.lock();
             endnodetile = reader.GetGraphTile(n_graphId);
-            lock.unlock();
             n_info = endnodetile->node(n_graphId);
             currentNode = n_graphId;
             prev_Node = GraphId();
@@ -241,42 +229,99 @@ std::deque<GraphId> GetGraphIds(GraphId& n_graphId,
   return graphids;
 }
 
-void build(const std::string& complex_restriction_from_file,
-           const std::string& complex_restriction_to_file,
+namespace {
+
+// The walks of the graph along the ways of restrictions, keyed by the node they start at and the
+// ways they follow. The tiles at either end of a restriction walk it in both directions, so one
+// of them can reuse what the other one found. Shared by all of the threads.
+class Walks {
+public:
+  // Same as GetGraphIds but only walks the graph the first time it is asked for a walk
+  std::deque<GraphId> Get(GraphId& n_graphId,
+                          GraphReader& reader,
+                          GraphId& tileid,
+                          const std::vector<uint64_t>& res_way_ids) {
+    walk_key_t key{n_graphId, res_way_ids};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto found = walks_.find(key);
+      if (found != walks_.end()) {
+        n_graphId = found->second.node;
+        tileid = found->second.tile;
+        return found->second.ids;
+      }
+    }
+    walk_t walk{GetGraphIds(n_graphId, reader, tileid, res_way_ids), n_graphId, tileid};
+    std::lock_guard<std::mutex> lock(mutex_);
+    walks_.emplace(std::move(key), walk);
+    return walk.ids;
+  }
+
+protected:
+  using walk_key_t = std::pair<GraphId, std::vector<uint64_t>>;
+  struct walk_t {
+    std::deque<GraphId> ids;
+    GraphId node;
+    GraphId tile;
+  };
+  struct KeyHasher {
+    std::size_t operator()(const walk_key_t& k) const {
+      std::size_t seed = std::hash<GraphId>()(k.first);
+      boost::hash_range(seed, k.second.begin(), k.second.end());
+      return seed;
+    }
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<walk_key_t, walk_t, KeyHasher> walks_;
+};
+
+// The complex restrictions starting at a way, in the order they are in the file
+std::pair<std::vector<OSMRestriction>::const_iterator, std::vector<OSMRestriction>::const_iterator>
+restrictions_from(const std::vector<OSMRestriction>& restrictions, const uint64_t way_id) {
+  OSMRestriction target{way_id};
+  return std::equal_range(restrictions.begin(), restrictions.end(), target,
+                          [](const OSMRestriction& a, const OSMRestriction& b) {
+                            return a.from() < b.from();
+                          });
+}
+
+// Reads the complex restrictions into memory once for all of the threads and levels, they are
+// sorted by the way they start at
+std::vector<OSMRestriction> read_restrictions(const std::string& file_name) {
+  sequence<OSMRestriction> restrictions(file_name, false);
+  std::vector<OSMRestriction> result;
+  result.reserve(restrictions.size());
+  for (const auto& restriction : restrictions) {
+    result.push_back(restriction);
+  }
+  return result;
+}
+
+} // namespace
+
+void build(const std::vector<OSMRestriction>& complex_restrictions_from,
+           const std::vector<OSMRestriction>& complex_restrictions_to,
            const boost::property_tree::ptree& hierarchy_properties,
-           std::queue<GraphId>& tilequeue,
-           std::mutex& lock,
+           TileQueue& tilequeue,
+           Walks& walks,
            std::promise<DataQuality>& result) {
-  sequence<OSMRestriction> complex_restrictions_from(complex_restriction_from_file, false);
-  sequence<OSMRestriction> complex_restrictions_to(complex_restriction_to_file, false);
-
   GraphReader reader(hierarchy_properties);
   DataQuality stats;
 
   // Iterate through the tiles in the queue and perform enhancements
-  while (true) {
-    // Get the next tile Id from the queue and get writeable and readable
-    // tile. Lock while we access the tile queue and get the tile.
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop();
-
+  GraphId tile_id;
+  while (tilequeue.next(tile_id)) {
     // Get a readable tile. If the tile is empty, skip it. Empty tiles are
     // added where ways go through a tile but no end not is within the tile.
     // This allows creation of connectivity maps using the tile set,
     graph_tile_ptr tile = reader.GetGraphTile(tile_id);
     if (!tile) {
-      lock.unlock();
       continue;
     }
 
     // Tile builder - serialize in existing tile
     GraphTileBuilder tilebuilder(reader.tile_dir(), tile_id, true);
-    lock.unlock();
 
     std::unordered_multimap<GraphId, ComplexRestrictionBuilder> forward_tmp_cr;
     std::unordered_multimap<GraphId, ComplexRestrictionBuilder> reverse_tmp_cr;
@@ -318,15 +363,13 @@ void build(const std::string& complex_restriction_from_file,
 
         if (directededge.start_restriction()) {
 
-          OSMRestriction target_res{e_offset.wayid()}; // this is our from way id
-          OSMRestriction restriction{};
-          sequence<OSMRestriction>::iterator res_it =
-              complex_restrictions_from.find(target_res,
-                                             [](const OSMRestriction& a, const OSMRestriction& b) {
-                                               return a.from() < b.from();
-                                             });
-          while (res_it != complex_restrictions_from.end() &&
-                 (restriction = *res_it).from() == e_offset.wayid() && restriction.vias().size()) {
+          // these are the restrictions from our way id
+          auto res_range = restrictions_from(complex_restrictions_from, e_offset.wayid());
+          for (auto res_it = res_range.first; res_it != res_range.second; ++res_it) {
+            const OSMRestriction& restriction = *res_it;
+            if (restriction.vias().empty()) {
+              continue;
+            }
 
             if (restriction.type() < RestrictionType::kOnlyRightTurn ||
                 restriction.type() > RestrictionType::kOnlyStraightOn) {
@@ -351,7 +394,7 @@ void build(const std::string& complex_restriction_from_file,
 
               // walk in the forward direction.
               std::deque<GraphId> tmp_ids =
-                  GetGraphIds(currentNode, reader, tileid, lock, res_way_ids);
+                  walks.Get(currentNode, reader, tileid, res_way_ids);
 
               // now that we have the tile and currentNode walk in the reverse direction as this is
               // really what needs to be stored in this tile.
@@ -376,7 +419,7 @@ void build(const std::string& complex_restriction_from_file,
                 }
 
                 res_way_ids.push_back(e_offset.wayid());
-                tmp_ids = GetGraphIds(currentNode, reader, tileid, lock, res_way_ids);
+                tmp_ids = walks.Get(currentNode, reader, tileid, res_way_ids);
 
                 if (tmp_ids.size()) {
 
@@ -386,7 +429,6 @@ void build(const std::string& complex_restriction_from_file,
                   if (vias.size() > kMaxViasPerRestriction) {
                     LOG_WARN("Tried to exceed max vias per restriction(forward).  Way: " +
                              std::to_string(tmp_ids.at(0)));
-                    res_it++;
                     continue;
                   }
 
@@ -438,33 +480,23 @@ void build(const std::string& complex_restriction_from_file,
                 }
               }
             }
-            res_it++;
           }
         }
 
         if (directededge.end_restriction()) {
 
-          OSMRestriction target_to_res{e_offset.wayid()}; // this is our from way id
-          OSMRestriction restriction_to{};
-          sequence<OSMRestriction>::iterator res_to_it =
-              complex_restrictions_to.find(target_to_res,
-                                           [](const OSMRestriction& a, const OSMRestriction& b) {
-                                             return a.from() < b.from();
-                                           });
           // is this edge the end of a restriction?
-          while (res_to_it != complex_restrictions_to.end() &&
-                 (restriction_to = *res_to_it).from() == e_offset.wayid()) {
-
-            OSMRestriction target_res{restriction_to.to()}; // this is our from way id
-            OSMRestriction restriction{};
-            sequence<OSMRestriction>::iterator res_it =
-                complex_restrictions_from.find(target_res,
-                                               [](const OSMRestriction& a, const OSMRestriction& b) {
-                                                 return a.from() < b.from();
-                                               });
-            while (res_it != complex_restrictions_from.end() &&
-                   (restriction = *res_it).from() == restriction_to.to() &&
-                   restriction.vias().size()) {
+          auto res_to_range = restrictions_from(complex_restrictions_to, e_offset.wayid());
+          for (auto res_to_it = res_to_range.first; res_to_it != res_to_range.second; ++res_to_it) {
+            const OSMRestriction& restriction_to = *res_to_it;
+
+            // these are the restrictions from the way id it started at
+            auto res_range = restrictions_from(complex_restrictions_from, restriction_to.to());
+            for (auto res_it = res_range.first; res_it != res_range.second; ++res_it) {
+              const OSMRestriction& restriction = *res_it;
+              if (restriction.vias().empty()) {
+                continue;
+              }
 
               if (restriction.type() < RestrictionType::kOnlyRightTurn ||
                   restriction.type() > RestrictionType::kOnlyStraightOn) {
@@ -495,7 +527,7 @@ void build(const std::string& complex_restriction_from_file,
 
                 // walk in the forward direction (reverse in relation to the restriction)
                 std::deque<GraphId> tmp_ids =
-                    GetGraphIds(currentNode, reader, tileid, lock, res_way_ids);
+                    walks.Get(currentNode, reader, tileid, res_way_ids);
 
                 // now that we have the tile and currentNode walk in the reverse
                 // direction(forward in relation to the restriction) as this is really what
@@ -519,7 +551,7 @@ void build(const std::string& complex_restriction_from_file,
                     res_way_ids.push_back(restriction.to());
                   }
 
-                  tmp_ids = GetGraphIds(currentNode, reader, tileid, lock, res_way_ids);
+                  tmp_ids = walks.Get(currentNode, reader, tileid, res_way_ids);
 
                   if (tmp_ids.size()) {
                     std::vector<GraphId> vias;
@@ -528,7 +560,6 @@ void build(const std::string& complex_restriction_from_file,
                     if (vias.size() > kMaxViasPerRestriction) {
                       LOG_WARN("Tried to exceed max vias per restriction(reverse).  Way: " +
                                std::to_string(tmp_ids.at(0)));
-                      res_it++;
                       continue;
                     }
 
@@ -577,9 +608,7 @@ void build(const std::string& complex_restriction_from_file,
                   }
                 }
               }
-              res_it++;
             }
-            res_to_it++;
           }
         }
       }
@@ -588,14 +617,12 @@ void build(const std::string& complex_restriction_from_file,
     stats.reverse_restrictions_count += reverse_count;
 
     // Write the new file
-    lock.lock();
     tilebuilder.StoreTileData();
 
     // Check if we need to clear the tile cache
     if (reader.OverCommitted()) {
       reader.Trim();
     }
-    lock.unlock();
   }
 
   // Send back the statistics
@@ -612,19 +639,17 @@ void RestrictionBuilder::Build(const boost::property_tree::ptree& pt,
 
   boost::property_tree::ptree hierarchy_properties = pt.get_child("mjolnir");
   GraphReader reader(hierarchy_properties);
+
+  // Read the restrictions once rather than every thread searching the files for every level
+  const auto complex_restrictions_from = read_restrictions(complex_from_restrictions_file);
+  const auto complex_restrictions_to = read_restrictions(complex_to_restrictions_file);
+
   for (auto tl = TileHierarchy::levels().rbegin(); tl != TileHierarchy::levels().rend(); ++tl) {
-    // Create a randomized queue of tiles to work from
-    std::deque<GraphId> tempqueue;
-    auto level_tiles = reader.GetTileSet(tl->level);
-    for (const auto& tile_id : level_tiles) {
-      tempqueue.emplace_back(tile_id);
-    }
-    std::random_device rd;
-    std::shuffle(tempqueue.begin(), tempqueue.end(), std::mt19937(rd()));
-    std::queue<GraphId> tilequeue(tempqueue);
+    // Create a queue of tiles to work from, the largest first
+    TileQueue tilequeue(reader.tile_dir(), reader.GetTileSet(tl->level));
 
-    // An atomic object we can use to do the synchronization
-    std::mutex lock;
+    // The walks along the ways of the restrictions at this level
+    Walks walks;
     // A place to hold worker threads and their results, exceptions or otherwise
 
     std::vector<std::shared_ptr<std::thread>> threads(
@@ -636,16 +661,17 @@ void RestrictionBuilder::Build(const boost::property_tree::ptree& pt,
     // Start the threads
     LOG_INFO("Adding Restrictions at level " + std::to_string(tl->level));
     for (size_t i = 0; i < threads.size(); ++i) {
-      threads[i].reset(new std::thread(build, std::cref(complex_from_restrictions_file),
-                                       std::cref(complex_to_restrictions_file),
+      threads[i].reset(new std::thread(build, std::cref(complex_restrictions_from),
+                                       std::cref(complex_restrictions_to),
                                        std::cref(hierarchy_properties), std::ref(tilequeue),
-                                       std::ref(lock), std::ref(results[i])));
+                                       std::ref(walks), std::ref(results[i])));
     }
 
     // Wait for them to finish up their work
     for (auto& thread : threads) {
       thread->join();
     }
+    tilequeue.LogUtilization("RestrictionBuilder at level " + std::to_string(tl->level));
 
     uint32_t forward_restrictions_count = 0;
     uint32_t reverse_restrictions_count = 0;
@@ -1,14 +1,21 @@
 #include "mjolnir/shortcutbuilder.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilequeue.h"
 
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <future>
 #include <iostream>
+#include <list>
 #include <map>
 #include <ostream>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -16,7 +23,9 @@
 #include "baldr/graphid.h"
 #include "baldr/graphreader.h"
 #include "baldr/graphtile.h"
+#include "baldr/recoveredshortcuts.h"
 #include "baldr/tilehierarchy.h"
+#include "filesystem.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -576,158 +585,168 @@ uint32_t AddShortcutEdges(GraphReader& reader,
   return shortcut_count;
 }
 
-// Form shortcuts for tiles in this level.
-uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
-  // Iterate through the tiles at this level (TODO - can we mark the tiles
-  // the tiles that shortcuts end within?)
-  reader.Clear();
-  bool added = false;
-  uint32_t shortcut_count = 0;
-  uint32_t ntiles = level.tiles.TileCount();
-  uint32_t tile_level = (uint32_t)level.level;
-  graph_tile_ptr tile;
-  for (uint32_t tileid = 0; tileid < ntiles; tileid++) {
-    // Get the graph tile. Skip if no tile exists (common case)
-    tile = reader.GetGraphTile(GraphId(tileid, tile_level, 0));
-    if (!tile) {
-      continue;
-    }
-
-    // Create GraphTileBuilder for the new tile
-    GraphId new_tile(tileid, tile_level, 0);
-    GraphTileBuilder tilebuilder(reader.tile_dir(), new_tile, false);
-
-    // Since the old tile is not serialized we must copy any data that is not
-    // dependent on edge Id into the new builders (e.g., node transitions)
-    if (tile->header()->transitioncount() > 0) {
-      for (uint32_t i = 0; i < tile->header()->transitioncount(); ++i) {
-        tilebuilder.transitions().emplace_back(std::move(*(tile->transition(i))));
+// Form shortcuts for the tiles of a level that this thread takes from the queue. The new tiles
+// are stored in the staging directory rather than over the old ones, so every thread reads the
+// level as it was before any shortcuts were added no matter which tiles are done first.
+void FormShortcuts(const boost::property_tree::ptree& hierarchy_properties,
+                   const std::string& staging_dir,
+                   TileQueue& tilequeue,
+                   std::promise<uint32_t>& result) {
+  try {
+    GraphReader reader(hierarchy_properties);
+    bool added = false;
+    uint32_t shortcut_count = 0;
+    graph_tile_ptr tile;
+    GraphId new_tile;
+    while (tilequeue.next(new_tile)) {
+      // Get the graph tile. Skip if no tile exists
+      tile = reader.GetGraphTile(new_tile);
+      if (!tile) {
+        continue;
+      }
+      uint32_t tileid = new_tile.tileid();
+      uint32_t tile_level = new_tile.level();
+
+      // Create GraphTileBuilder for the new tile, starting from the header of the old one
+      GraphTileBuilder tilebuilder(staging_dir, new_tile, false);
+      tilebuilder.header_builder() = *tile->header();
+      tilebuilder.header_builder().set_graphid(new_tile);
+
+      // Since the old tile is not serialized we must copy any data that is not
+      // dependent on edge Id into the new builders (e.g., node transitions)
+      if (tile->header()->transitioncount() > 0) {
+        for (uint32_t i = 0; i < tile->header()->transitioncount(); ++i) {
+          tilebuilder.transitions().emplace_back(std::move(*(tile->transition(i))));
+        }
       }
-    }
 
-    // Iterate through the nodes in the tile
-    GraphId node_id(tileid, tile_level, 0);
-    for (uint32_t n = 0; n < tile->header()->nodecount(); n++, ++node_id) {
-      // Get the node info, copy node index and count from old tile
-      NodeInfo nodeinfo = *(tile->node(node_id));
-      uint32_t old_edge_index = nodeinfo.edge_index();
-      uint32_t old_edge_count = nodeinfo.edge_count();
-
-      // Update node information
-      const auto& admin = tile->admininfo(nodeinfo.admin_index());
-      nodeinfo.set_edge_index(tilebuilder.directededges().size());
-      nodeinfo.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
-                                                    admin.country_iso(), admin.state_iso()));
-
-      // Current edge count
-      size_t edge_count = tilebuilder.directededges().size();
-
-      // Add shortcut edges first.
-      std::unordered_map<uint32_t, uint32_t> shortcuts;
-      shortcut_count += AddShortcutEdges(reader, tile, tilebuilder, node_id, old_edge_index,
-                                         old_edge_count, shortcuts);
-
-      // Copy the rest of the directed edges from this node
-      GraphId edgeid(tileid, tile_level, old_edge_index);
-      for (uint32_t i = 0; i < old_edge_count; i++, ++edgeid) {
-        // Copy the directed edge information and update end node,
-        // edge data offset, and opp_index
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        DirectedEdge newedge = *directededge;
-
-        // Get signs from the base directed edge
-        if (directededge->sign()) {
-          std::vector<SignInfo> signs = tile->GetSigns(edgeid.id());
-          if (signs.size() == 0) {
-            LOG_ERROR("Base edge should have signs, but none found");
+      // Iterate through the nodes in the tile
+      GraphId node_id(tileid, tile_level, 0);
+      for (uint32_t n = 0; n < tile->header()->nodecount(); n++, ++node_id) {
+        // Get the node info, copy node index and count from old tile
+        NodeInfo nodeinfo = *(tile->node(node_id));
+        uint32_t old_edge_index = nodeinfo.edge_index();
+        uint32_t old_edge_count = nodeinfo.edge_count();
+
+        // Update node information
+        const auto& admin = tile->admininfo(nodeinfo.admin_index());
+        nodeinfo.set_edge_index(tilebuilder.directededges().size());
+        nodeinfo.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
+                                                      admin.country_iso(), admin.state_iso()));
+
+        // Current edge count
+        size_t edge_count = tilebuilder.directededges().size();
+
+        // Add shortcut edges first.
+        std::unordered_map<uint32_t, uint32_t> shortcuts;
+        shortcut_count += AddShortcutEdges(reader, tile, tilebuilder, node_id, old_edge_index,
+                                           old_edge_count, shortcuts);
+
+        // Copy the rest of the directed edges from this node
+        GraphId edgeid(tileid, tile_level, old_edge_index);
+        for (uint32_t i = 0; i < old_edge_count; i++, ++edgeid) {
+          // Copy the directed edge information and update end node,
+          // edge data offset, and opp_index
+          const DirectedEdge* directededge = tile->directededge(edgeid);
+          DirectedEdge newedge = *directededge;
+
+          // Get signs from the base directed edge
+          if (directededge->sign()) {
+            std::vector<SignInfo> signs = tile->GetSigns(edgeid.id());
+            if (signs.size() == 0) {
+              LOG_ERROR("Base edge should have signs, but none found");
+            }
+            tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
           }
-          tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
-        }
 
-        // Get turn lanes from the base directed edge
-        if (directededge->turnlanes()) {
-          uint32_t offset = tile->turnlanes_offset(edgeid.id());
-          tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
-        }
+          // Get turn lanes from the base directed edge
+          if (directededge->turnlanes()) {
+            uint32_t offset = tile->turnlanes_offset(edgeid.id());
+            tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
+          }
 
-        // Get access restrictions from the base directed edge. Add these to
-        // the list of access restrictions in the new tile. Update the
-        // edge index in the restriction to be the current directed edge Id
-        if (directededge->access_restriction()) {
-          auto restrictions = tile->GetAccessRestrictions(edgeid.id(), kAllAccess);
-          for (const auto& res : restrictions) {
-            tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
-                                                               res.type(), res.modes(), res.value()));
+          // Get access restrictions from the base directed edge. Add these to
+          // the list of access restrictions in the new tile. Update the
+          // edge index in the restriction to be the current directed edge Id
+          if (directededge->access_restriction()) {
+            auto restrictions = tile->GetAccessRestrictions(edgeid.id(), kAllAccess);
+            for (const auto& res : restrictions) {
+              tilebuilder.AddAccessRestriction(
+                  AccessRestriction(tilebuilder.directededges().size(), res.type(), res.modes(),
+                                    res.value()));
+            }
           }
-        }
 
-        // Copy lane connectivity
-        if (directededge->laneconnectivity()) {
-          auto laneconnectivity = tile->GetLaneConnectivity(edgeid.id());
-          if (laneconnectivity.size() == 0) {
-            LOG_ERROR("Base edge should have lane connectivity, but none found");
+          // Copy lane connectivity
+          if (directededge->laneconnectivity()) {
+            auto laneconnectivity = tile->GetLaneConnectivity(edgeid.id());
+            if (laneconnectivity.size() == 0) {
+              LOG_ERROR("Base edge should have lane connectivity, but none found");
+            }
+            for (auto& lc : laneconnectivity) {
+              lc.set_to(tilebuilder.directededges().size());
+            }
+            tilebuilder.AddLaneConnectivity(laneconnectivity);
           }
-          for (auto& lc : laneconnectivity) {
-            lc.set_to(tilebuilder.directededges().size());
+
+          // Get edge info, shape, and names from the old tile and add
+          // to the new. Use prior edgeinfo offset as the key to make sure
+          // edges that have the same end nodes are differentiated (this
+          // should be a valid key since tile sizes aren't changed)
+          auto edgeinfo = tile->edgeinfo(directededge->edgeinfo_offset());
+          uint32_t edge_info_offset =
+              tilebuilder.AddEdgeInfo(directededge->edgeinfo_offset(), node_id,
+                                      directededge->endnode(), edgeinfo.wayid(),
+                                      edgeinfo.mean_elevation(), edgeinfo.bike_network(),
+                                      edgeinfo.speed_limit(), edgeinfo.encoded_shape(),
+                                      tile->GetNames(directededge->edgeinfo_offset()),
+                                      tile->GetNames(directededge->edgeinfo_offset(), true),
+                                      tile->GetTypes(directededge->edgeinfo_offset()), added);
+          newedge.set_edgeinfo_offset(edge_info_offset);
+
+          // Set the superseded mask - this is the shortcut mask that supersedes this edge
+          // (outbound from the node). Do not set (keep as 0) if maximum number of shortcuts
+          // from a node has been exceeded.
+          auto s = shortcuts.find(i);
+          uint32_t superseded_idx = (s != shortcuts.end()) ? s->second : 0;
+          if (superseded_idx <= kMaxShortcutsFromNode) {
+            newedge.set_superseded(superseded_idx);
           }
-          tilebuilder.AddLaneConnectivity(laneconnectivity);
-        }
 
-        // Get edge info, shape, and names from the old tile and add
-        // to the new. Use prior edgeinfo offset as the key to make sure
-        // edges that have the same end nodes are differentiated (this
-        // should be a valid key since tile sizes aren't changed)
-        auto edgeinfo = tile->edgeinfo(directededge->edgeinfo_offset());
-        uint32_t edge_info_offset =
-            tilebuilder.AddEdgeInfo(directededge->edgeinfo_offset(), node_id, directededge->endnode(),
-                                    edgeinfo.wayid(), edgeinfo.mean_elevation(),
-                                    edgeinfo.bike_network(), edgeinfo.speed_limit(),
-                                    edgeinfo.encoded_shape(),
-                                    tile->GetNames(directededge->edgeinfo_offset()),
-                                    tile->GetNames(directededge->edgeinfo_offset(), true),
-                                    tile->GetTypes(directededge->edgeinfo_offset()), added);
-        newedge.set_edgeinfo_offset(edge_info_offset);
-
-        // Set the superseded mask - this is the shortcut mask that supersedes this edge
-        // (outbound from the node). Do not set (keep as 0) if maximum number of shortcuts
-        // from a node has been exceeded.
-        auto s = shortcuts.find(i);
-        uint32_t superseded_idx = (s != shortcuts.end()) ? s->second : 0;
-        if (superseded_idx <= kMaxShortcutsFromNode) {
-          newedge.set_superseded(superseded_idx);
+          // Add directed edge
+          tilebuilder.directededges().emplace_back(std::move(newedge));
         }
 
-        // Add directed edge
-        tilebuilder.directededges().emplace_back(std::move(newedge));
-      }
-
-      // Set the edge count for the new node
-      nodeinfo.set_edge_count(tilebuilder.directededges().size() - edge_count);
+        // Set the edge count for the new node
+        nodeinfo.set_edge_count(tilebuilder.directededges().size() - edge_count);
 
-      // Get named signs from the base node
-      if (nodeinfo.named_intersection()) {
+        // Get named signs from the base node
+        if (nodeinfo.named_intersection()) {
 
-        std::vector<SignInfo> signs = tile->GetSigns(n, true);
-        if (signs.size() == 0) {
-          LOG_ERROR("Base node should have signs, but none found");
+          std::vector<SignInfo> signs = tile->GetSigns(n, true);
+          if (signs.size() == 0) {
+            LOG_ERROR("Base node should have signs, but none found");
+          }
+          tilebuilder.AddSigns(tilebuilder.nodes().size(), signs);
         }
-        tilebuilder.AddSigns(tilebuilder.nodes().size(), signs);
+        tilebuilder.nodes().emplace_back(std::move(nodeinfo));
       }
-      tilebuilder.nodes().emplace_back(std::move(nodeinfo));
-    }
 
-    // Store the new tile
-    tilebuilder.StoreTileData();
-    LOG_DEBUG((boost::format("ShortcutBuilder created tile %1%: %2% bytes") % tile %
-               tilebuilder.header_builder().end_offset())
-                  .str());
+      // Store the new tile
+      tilebuilder.StoreTileData();
+      LOG_DEBUG((boost::format("ShortcutBuilder created tile %1%: %2% bytes") % tile %
+                 tilebuilder.header_builder().end_offset())
+                    .str());
 
-    // Check if we need to clear the tile cache.
-    if (reader.OverCommitted()) {
-      reader.Trim();
+      // Check if we need to clear the tile cache.
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
     }
+    result.set_value(shortcut_count);
+  } catch (...) {
+    result.set_exception(std::current_exception());
   }
-  return shortcut_count;
 }
 
 } // namespace
@@ -740,22 +759,139 @@ namespace mjolnir {
 // attributes. Shortcut edges are inserted before regular edges.
 void ShortcutBuilder::Build(const boost::property_tree::ptree& pt) {
 
-  // TODO: thread this. would need to make sure we dont make shortcuts
-  // across tile boundaries so that we are only messing with one tile
-  // in one thread at a time
-
   // Get GraphReader
-  GraphReader reader(pt.get_child("mjolnir"));
+  auto hierarchy_properties = pt.get_child("mjolnir");
+  GraphReader reader(hierarchy_properties);
+  auto staging_dir = reader.tile_dir() + filesystem::path::preferred_separator + ".shortcuts";
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
 
   auto tile_level = TileHierarchy::levels().rbegin();
   tile_level++;
   for (; tile_level != TileHierarchy::levels().rend(); ++tile_level) {
-    // Create shortcuts on this level
+    // Create shortcuts on this level, every tile on its own
     LOG_INFO("Creating shortcuts on level " + std::to_string(tile_level->level));
-    uint32_t count = FormShortcuts(reader, *tile_level);
+    filesystem::remove_all(staging_dir);
+    auto tiles = reader.GetTileSet(tile_level->level);
+    TileQueue tilequeue(reader.tile_dir(), tiles);
+    std::list<std::promise<uint32_t>> results;
+    for (auto& thread : threads) {
+      results.emplace_back();
+      thread.reset(new std::thread(FormShortcuts, std::cref(hierarchy_properties),
+                                   std::cref(staging_dir), std::ref(tilequeue),
+                                   std::ref(results.back())));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    tilequeue.LogUtilization("ShortcutBuilder at level " + std::to_string(tile_level->level));
+
+    // If something bad went down this will rethrow it
+    uint32_t count = 0;
+    for (auto& result : results) {
+      count += result.get_future().get();
+    }
+
+    // Only now that the whole level is done replace the old tiles with the new ones
+    for (const auto& tile_id : tiles) {
+      auto suffix = GraphTile::FileSuffix(tile_id);
+      auto staged = staging_dir + filesystem::path::preferred_separator + suffix;
+      auto target = reader.tile_dir() + filesystem::path::preferred_separator + suffix;
+      if (filesystem::exists(staged) && std::rename(staged.c_str(), target.c_str())) {
+        throw std::runtime_error("Could not move " + staged + " to " + target);
+      }
+    }
+    filesystem::remove_all(staging_dir);
     LOG_INFO("Finished with " + std::to_string(count) + " shortcuts");
   }
 }
 
+// Recover the edges of every shortcut once and for all, after the validation so that the
+// indices of the edges are the ones the readers will see
+void ShortcutBuilder::Recover(const boost::property_tree::ptree& pt) {
+  if (!pt.get<bool>("mjolnir.shortcut_recovery", false)) {
+    return;
+  }
+
+  // The tiles of the levels which have shortcuts, looked at without any recovery written before
+  LOG_INFO("Recovering the edges of the shortcuts");
+  auto config = pt.get_child("mjolnir");
+  config.put("shortcut_recovery", false);
+  config.put("shortcut_caching", false);
+  std::vector<GraphId> tiles;
+  {
+    GraphReader reader(config);
+    for (const auto& level : TileHierarchy::levels()) {
+      if (level.level > 1) {
+        continue;
+      }
+      for (const auto& tile_id : reader.GetTileSet(level.level)) {
+        tiles.push_back(tile_id);
+      }
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+
+  // Every thread takes the next tile and packs the edges of its shortcuts
+  struct packed_t {
+    std::vector<uint32_t> shortcuts;
+    std::vector<uint64_t> positions;
+    std::vector<uint8_t> data;
+  };
+  std::vector<packed_t> packed(tiles.size());
+  std::atomic<size_t> next_tile(0);
+  auto recover = [&]() {
+    GraphReader reader(config);
+    for (size_t t = next_tile++; t < tiles.size(); t = next_tile++) {
+      graph_tile_ptr tile = reader.GetGraphTile(tiles[t]);
+      if (!tile) {
+        continue;
+      }
+      GraphId edge_id = tiles[t];
+      for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i, ++edge_id) {
+        if (!tile->directededge(i)->is_shortcut()) {
+          continue;
+        }
+        packed[t].shortcuts.push_back(i);
+        packed[t].positions.push_back(packed[t].data.size());
+        RecoveredShortcuts::Pack(edge_id, reader.RecoverShortcut(edge_id), packed[t].data);
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  };
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
+  for (auto& thread : threads) {
+    thread.reset(new std::thread(recover));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  // Put the tiles one after the other
+  std::vector<uint64_t> offsets{0};
+  std::vector<uint32_t> shortcuts;
+  std::vector<uint64_t> positions;
+  std::vector<uint8_t> data;
+  for (auto& tile : packed) {
+    for (auto position : tile.positions) {
+      positions.push_back(data.size() + position);
+    }
+    shortcuts.insert(shortcuts.end(), tile.shortcuts.begin(), tile.shortcuts.end());
+    data.insert(data.end(), tile.data.begin(), tile.data.end());
+    offsets.push_back(shortcuts.size());
+    tile = {};
+  }
+
+  auto file_name = RecoveredShortcuts::FileName(pt.get<std::string>("mjolnir.tile_dir"));
+  RecoveredShortcuts::Write(file_name, tiles, offsets, shortcuts, positions, data);
+  LOG_INFO("Wrote " + file_name + " with the edges of " + std::to_string(shortcuts.size()) +
+           " shortcuts in " + std::to_string(data.size()) + " bytes");
+}
+
 } // namespace mjolnir
 } // namespace valhalla
@@ -0,0 +1,87 @@
+#include "mjolnir/spatialindexbuilder.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/spatialindex.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/aabb2.h"
+#include "midgard/logging.h"
+#include "midgard/pointll.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace valhalla {
+namespace mjolnir {
+
+void SpatialIndexBuilder::Build(const boost::property_tree::ptree& pt) {
+  if (!pt.get<bool>("mjolnir.spatial_index", false)) {
+    return;
+  }
+
+  // The nodes and edges of every level but transit
+  LOG_INFO("Building the spatial index");
+  std::vector<std::pair<GraphId, PointLL>> nodes;
+  std::vector<std::pair<GraphId, AABB2<PointLL>>> edges;
+  GraphReader reader(pt.get_child("mjolnir"));
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& level : TileHierarchy::levels()) {
+    if (level.level == transit_level) {
+      continue;
+    }
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+      if (!tile) {
+        continue;
+      }
+      GraphId node_id = tile_id;
+      for (uint32_t i = 0; i < tile->header()->nodecount(); ++i, ++node_id) {
+        nodes.emplace_back(node_id, tile->get_node_ll(node_id));
+      }
+
+      // the same edges as the bins, only one of each pair
+      GraphId edge_id = tile_id;
+      std::unordered_set<uint32_t> shapes;
+      for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i, ++edge_id) {
+        const auto* edge = tile->directededge(i);
+        if (!edge->forward() || edge->is_shortcut() || edge->use() == Use::kTransitConnection ||
+            edge->use() == Use::kPlatformConnection || edge->use() == Use::kEgressConnection ||
+            !shapes.insert(edge->edgeinfo_offset()).second) {
+          continue;
+        }
+        auto shape = tile->edgeinfo(edge->edgeinfo_offset()).lazy_shape();
+        if (shape.empty()) {
+          continue;
+        }
+        auto point = shape.pop();
+        AABB2<PointLL> bbox(point, point);
+        while (!shape.empty()) {
+          bbox.Expand(shape.pop());
+        }
+        edges.emplace_back(edge_id, bbox);
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  }
+
+  auto file_name = SpatialIndex::FileName(pt.get<std::string>("mjolnir.tile_dir"));
+  const auto node_count = nodes.size();
+  const auto edge_count = edges.size();
+  SpatialIndex::Write(file_name, std::move(nodes), std::move(edges));
+  LOG_INFO("Wrote " + file_name + " with " + std::to_string(node_count) + " nodes and " +
+           std::to_string(edge_count) + " edges");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -20,9 +20,11 @@
 
 #include "baldr/graphconstants.h"
 #include "baldr/graphid.h"
+#include "baldr/graphtile.h"
 #include "baldr/json.h"
 #include "baldr/tilehierarchy.h"
 #include "midgard/aabb2.h"
+#include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
 
 using namespace valhalla::midgard;
@@ -30,29 +32,192 @@ using namespace valhalla::baldr;
 using namespace valhalla::mjolnir;
 
 namespace {
-// merges contents of sets and maps that do not have overlapping keys
-template <class T> T merge(T& a, T b) {
-  T tmp(a);
-  tmp.insert(b.begin(), b.end());
-  return tmp;
+// merges contents of sets and maps that do not have overlapping keys, in place so that what was
+// gathered so far isnt copied for every thread that is merged
+template <class T> void merge(T& a, const T& b) {
+  if (a.empty()) {
+    a = b;
+    return;
+  }
+  a.insert(b.begin(), b.end());
 }
 
-// accumulates counts into a new map for maps that have counts associated with its keys
-template <class T> T merge_counts(T& a, T b) {
-  T tmp(a);
+// accumulates counts into the first map for maps that have counts associated with its keys
+template <class T> void merge_counts(T& a, const T& b) {
   for (auto it = b.begin(); it != b.end(); it++) {
-    tmp[it->first] += it->second;
+    a[it->first] += it->second;
   }
-  return tmp;
 }
 
 // merge two hashes by key and merge underlying hash buckets
-template <class T> T deep_merge_counts(T& a, T const& b) {
-  T tmp(a);
+template <class T> void deep_merge_counts(T& a, const T& b) {
   for (auto it = b.begin(); it != b.end(); it++) {
-    tmp[it->first] = merge_counts(tmp[it->first], it->second);
+    merge_counts(a[it->first], it->second);
+  }
+}
+
+struct HGVRestrictionTypes {
+  bool hazmat;
+  bool axle_load;
+  bool height;
+  bool length;
+  bool weight;
+  bool width;
+};
+
+bool IsUnroutableNode(const GraphTile& tile,
+                      const NodeInfo& startnodeinfo,
+                      statistics::RouletteData& rd) {
+
+  const DirectedEdge* diredge = tile.directededge(startnodeinfo.edge_index());
+  size_t inbound = 0, outbound = 0;
+  // Check all the edges from the current node and count inbound and outbound edges
+  for (size_t i = 0; i < startnodeinfo.edge_count(); i++, diredge++) {
+    if (diredge->shortcut() || diredge->use() == Use::kTransitConnection ||
+        diredge->use() == Use::kEgressConnection || diredge->use() == Use::kPlatformConnection) {
+      continue;
+    }
+    if ((diredge->forwardaccess() & kAutoAccess)) {
+      outbound++;
+    }
+    if ((diredge->reverseaccess() & kAutoAccess)) {
+      inbound++;
+    }
+  }
+
+  // If there is a way in and no way out, or vice versa
+  // And it's not a dead end
+  // Or it is a dead end, but is a high class road
+  if (((!outbound && inbound >= 2) || (outbound >= 2 && !inbound))) {
+    rd.AddNode(startnodeinfo.latlng(tile.header()->base_ll()));
+    return true;
+  }
+
+  return false;
+}
+
+void checkExitInfo(const GraphTile& tile,
+                   const NodeInfo& startnodeinfo,
+                   const DirectedEdge& directededge,
+                   statistics& stats) {
+  // If this edge is right after a motorway junction it is an exit and should
+  // have signs
+  if (startnodeinfo.type() == NodeType::kMotorWayJunction) {
+    // Check to see if the motorway continues, if it does, this is an exit ramp,
+    // otherwise if all forward edges are links, it is a fork. The start node is
+    // always in the tile of the edge
+    const DirectedEdge* otheredge = tile.directededge(startnodeinfo.edge_index());
+    std::vector<std::pair<uint64_t, bool>> tile_fork_signs;
+    std::vector<std::pair<std::string, bool>> ctry_fork_signs;
+    // Assume it is a fork
+    bool fork = true;
+    for (size_t i = 0; i < startnodeinfo.edge_count(); ++i, ++otheredge) {
+      // If it is an outgoing edge that is not a link, it is not a fork
+      if (((otheredge->forwardaccess() & kAutoAccess) &&
+           !(otheredge->reverseaccess() & kAutoAccess)) &&
+          !otheredge->link()) {
+        fork = false;
+        // no need to keep checking if it's not a fork
+        break;
+      } else {
+        // store exit info in case this is a fork
+        std::string iso_code = tile.admin(startnodeinfo.admin_index())->country_iso();
+        tile_fork_signs.push_back({tile.id(), otheredge->sign()});
+        ctry_fork_signs.push_back({iso_code, otheredge->sign()});
+      }
+    }
+    // If it was a fork, store the data appropriately
+    if (fork) {
+      for (auto& sign : tile_fork_signs) {
+        stats.add_fork_exitinfo(sign);
+      }
+      for (auto& sign : ctry_fork_signs) {
+        stats.add_fork_exitinfo(sign);
+      }
+    } else {
+      // Otherwise store original edge info as a normal exit
+      std::string iso_code = tile.admin(startnodeinfo.admin_index())->country_iso();
+      stats.add_exitinfo({tile.id(), directededge.sign()});
+      stats.add_exitinfo({iso_code, directededge.sign()});
+    }
+  }
+}
+
+void AddStatistics(statistics& stats,
+                   const DirectedEdge& directededge,
+                   const uint32_t tileid,
+                   std::string& begin_node_iso,
+                   HGVRestrictionTypes& hgv,
+                   const GraphTile& tile,
+                   const NodeInfo& nodeinfo) {
+
+  auto rclass = directededge.classification();
+  float edge_length = (tileid == directededge.endnode().tileid()) ? directededge.length() * 0.5f
+                                                                  : directededge.length() * 0.25f;
+
+  // Add truck stats.
+  if (directededge.truck_route()) {
+    stats.add_tile_truck_route(tileid, rclass, edge_length);
+    stats.add_country_truck_route(begin_node_iso, rclass, edge_length);
+  }
+  if (hgv.hazmat) {
+    stats.add_tile_hazmat(tileid, rclass, edge_length);
+    stats.add_country_hazmat(begin_node_iso, rclass, edge_length);
+  }
+  if (hgv.axle_load) {
+    stats.add_tile_axle_load(tileid, rclass);
+    stats.add_country_axle_load(begin_node_iso, rclass);
+  }
+  if (hgv.height) {
+    stats.add_tile_height(tileid, rclass);
+    stats.add_country_height(begin_node_iso, rclass);
+  }
+  if (hgv.length) {
+    stats.add_tile_length(tileid, rclass);
+    stats.add_country_length(begin_node_iso, rclass);
+  }
+  if (hgv.weight) {
+    stats.add_tile_weight(tileid, rclass);
+    stats.add_country_weight(begin_node_iso, rclass);
+  }
+  if (hgv.width) {
+    stats.add_tile_width(tileid, rclass);
+    stats.add_country_width(begin_node_iso, rclass);
+  }
+
+  // Check for exit signage if it is a highway link
+  if (directededge.link() && (rclass == RoadClass::kMotorway || rclass == RoadClass::kTrunk)) {
+    checkExitInfo(tile, nodeinfo, directededge, stats);
+  }
+
+  // Add all other statistics
+  // Only consider edge if edge is good and it's not a link
+  if (!directededge.link()) {
+    edge_length *= 0.5f;
+    IsUnroutableNode(tile, nodeinfo, stats.roulette_data);
+    stats.add_tile_one_way(tileid, rclass, edge_length);
+    stats.add_country_one_way(begin_node_iso, rclass, edge_length);
+
+    // Check if this edge is internal
+    if (directededge.internal()) {
+      stats.add_tile_int_edge(tileid, rclass);
+      stats.add_country_int_edge(begin_node_iso, rclass);
+    }
+    // Check if edge has maxspeed tag
+    if (directededge.speed_type() == SpeedType::kTagged) {
+      stats.add_tile_speed_info(tileid, rclass, edge_length);
+      stats.add_country_speed_info(begin_node_iso, rclass, edge_length);
+    }
+    // Check if edge has any names
+    if (tile.edgeinfo(directededge.edgeinfo_offset()).name_count() > 0) {
+      stats.add_tile_named(tileid, rclass, edge_length);
+      stats.add_country_named(begin_node_iso, rclass, edge_length);
+    }
+
+    // Add road lengths to statistics for current country and tile
+    stats.add_country_road(begin_node_iso, rclass, edge_length);
+    stats.add_tile_road(tileid, rclass, edge_length);
   }
-  return tmp;
 }
 
 } // namespace
@@ -60,6 +225,72 @@ template <class T> T deep_merge_counts(T& a, T const& b) {
 namespace valhalla {
 namespace mjolnir {
 
+void statistics::add_tile(const GraphTile& tile) {
+  // Point tiles to the set we need for current level
+  const auto tile_id = tile.id();
+  const auto& tiles = tile_id.level() == TileHierarchy::GetTransitLevel().level
+                          ? TileHierarchy::levels().back().tiles
+                          : TileHierarchy::levels()[tile_id.level()].tiles;
+  auto tileid = tile_id.tileid();
+
+  // Iterate through the nodes and the directed edges
+  uint32_t nodecount = tile.header()->nodecount();
+  for (uint32_t i = 0; i < nodecount; i++) {
+    const NodeInfo* nodeinfo = tile.node(i);
+    std::string begin_node_iso = tile.admin(nodeinfo->admin_index())->country_iso();
+
+    // Go through directed edges
+    uint32_t idx = nodeinfo->edge_index();
+    for (uint32_t j = 0, n = nodeinfo->edge_count(); j < n; j++, idx++) {
+      const DirectedEdge* directededge = tile.directededge(idx);
+      if (directededge->shortcut()) {
+        continue;
+      }
+
+      // HGV restriction mask (for stats)
+      HGVRestrictionTypes hgv = {};
+      if (directededge->access_restriction()) {
+        // since only truck restrictions exist, we can still get all restrictions
+        // later we may only want to get just the truck ones for stats.
+        for (const auto& r : tile.GetAccessRestrictions(idx, kAllAccess)) {
+          switch (r.type()) {
+            case AccessType::kHazmat:
+              hgv.hazmat = true;
+              break;
+            case AccessType::kMaxAxleLoad:
+              hgv.axle_load = true;
+              break;
+            case AccessType::kMaxHeight:
+              hgv.height = true;
+              break;
+            case AccessType::kMaxLength:
+              hgv.length = true;
+              break;
+            case AccessType::kMaxWeight:
+              hgv.weight = true;
+              break;
+            case AccessType::kMaxWidth:
+              hgv.width = true;
+              break;
+            default:
+              break;
+          }
+        }
+      }
+
+      AddStatistics(*this, *directededge, tileid, begin_node_iso, hgv, tile, *nodeinfo);
+    }
+  }
+
+  // Add density to return class. Approximate the tile area square km
+  AABB2<PointLL> bb = tiles.TileBounds(tileid);
+  float area = ((bb.maxy() - bb.miny()) * kMetersPerDegreeLat * kKmPerMeter) *
+               ((bb.maxx() - bb.minx()) *
+                DistanceApproximator<PointLL>::MetersPerLngDegree(bb.Center().y()) * kKmPerMeter);
+  add_tile_area(tileid, area);
+  add_tile_geom(tileid, bb);
+}
+
 void statistics::add_tile_road(const uint64_t& tile_id, const RoadClass& rclass, const float length) {
   tile_ids.insert(tile_id);
   tile_lengths[tile_id][rclass] += length;
@@ -395,51 +626,51 @@ const std::unordered_map<std::string, size_t>& statistics::get_ctry_exit_count()
 
 void statistics::add(const statistics& stats) {
   // Combine ids and isos
-  tile_ids = merge(tile_ids, stats.get_ids());
-  iso_codes = merge(iso_codes, stats.get_isos());
+  merge(tile_ids, stats.get_ids());
+  merge(iso_codes, stats.get_isos());
 
   // Combine tile statistics
-  tile_areas = merge(tile_areas, stats.get_tile_areas());
-  tile_geometries = merge(tile_geometries, stats.get_tile_geometries());
-  tile_lengths = merge(tile_lengths, stats.get_tile_lengths());
-  tile_one_way = merge(tile_one_way, stats.get_tile_one_way());
-  tile_speed_info = merge(tile_speed_info, stats.get_tile_speed_info());
-  tile_int_edges = merge(tile_int_edges, stats.get_tile_int_edges());
-  tile_named = merge(tile_named, stats.get_tile_named());
-  tile_hazmat = merge(tile_hazmat, stats.get_tile_hazmat());
-  tile_truck_route = merge(tile_truck_route, stats.get_tile_truck_route());
-  tile_height = merge(tile_height, stats.get_tile_height());
-  tile_width = merge(tile_width, stats.get_tile_width());
-  tile_length = merge(tile_length, stats.get_tile_length());
-  tile_weight = merge(tile_weight, stats.get_tile_weight());
-  tile_axle_load = merge(tile_axle_load, stats.get_tile_axle_load());
+  merge(tile_areas, stats.get_tile_areas());
+  merge(tile_geometries, stats.get_tile_geometries());
+  merge(tile_lengths, stats.get_tile_lengths());
+  merge(tile_one_way, stats.get_tile_one_way());
+  merge(tile_speed_info, stats.get_tile_speed_info());
+  merge(tile_int_edges, stats.get_tile_int_edges());
+  merge(tile_named, stats.get_tile_named());
+  merge(tile_hazmat, stats.get_tile_hazmat());
+  merge(tile_truck_route, stats.get_tile_truck_route());
+  merge(tile_height, stats.get_tile_height());
+  merge(tile_width, stats.get_tile_width());
+  merge(tile_length, stats.get_tile_length());
+  merge(tile_weight, stats.get_tile_weight());
+  merge(tile_axle_load, stats.get_tile_axle_load());
 
   // Combine country statistics
-  country_lengths = deep_merge_counts(country_lengths, stats.get_country_lengths());
-  country_one_way = deep_merge_counts(country_one_way, stats.get_country_one_way());
-  country_speed_info = deep_merge_counts(country_speed_info, stats.get_country_speed_info());
-  country_int_edges = deep_merge_counts(country_int_edges, stats.get_country_int_edges());
-  country_named = deep_merge_counts(country_named, stats.get_country_named());
-  country_hazmat = deep_merge_counts(country_hazmat, stats.get_country_hazmat());
-  country_truck_route = deep_merge_counts(country_truck_route, stats.get_country_truck_route());
-  country_height = deep_merge_counts(country_height, stats.get_country_height());
-  country_width = deep_merge_counts(country_width, stats.get_country_width());
-  country_length = deep_merge_counts(country_length, stats.get_country_length());
-  country_weight = deep_merge_counts(country_weight, stats.get_country_weight());
-  country_axle_load = deep_merge_counts(country_axle_load, stats.get_country_axle_load());
+  deep_merge_counts(country_lengths, stats.get_country_lengths());
+  deep_merge_counts(country_one_way, stats.get_country_one_way());
+  deep_merge_counts(country_speed_info, stats.get_country_speed_info());
+  deep_merge_counts(country_int_edges, stats.get_country_int_edges());
+  deep_merge_counts(country_named, stats.get_country_named());
+  deep_merge_counts(country_hazmat, stats.get_country_hazmat());
+  deep_merge_counts(country_truck_route, stats.get_country_truck_route());
+  deep_merge_counts(country_height, stats.get_country_height());
+  deep_merge_counts(country_width, stats.get_country_width());
+  deep_merge_counts(country_length, stats.get_country_length());
+  deep_merge_counts(country_weight, stats.get_country_weight());
+  deep_merge_counts(country_axle_load, stats.get_country_axle_load());
 
   // Combine exit statistics
-  tile_exit_signs = merge_counts(tile_exit_signs, stats.get_tile_exit_info());
-  ctry_exit_signs = merge_counts(ctry_exit_signs, stats.get_ctry_exit_info());
+  merge_counts(tile_exit_signs, stats.get_tile_exit_info());
+  merge_counts(ctry_exit_signs, stats.get_ctry_exit_info());
 
-  tile_exit_count = merge_counts(tile_exit_count, stats.get_tile_exit_count());
-  ctry_exit_count = merge_counts(ctry_exit_count, stats.get_ctry_exit_count());
+  merge_counts(tile_exit_count, stats.get_tile_exit_count());
+  merge_counts(ctry_exit_count, stats.get_ctry_exit_count());
 
-  tile_fork_signs = merge_counts(tile_fork_signs, stats.get_tile_fork_info());
-  ctry_fork_signs = merge_counts(ctry_fork_signs, stats.get_ctry_fork_info());
+  merge_counts(tile_fork_signs, stats.get_tile_fork_info());
+  merge_counts(ctry_fork_signs, stats.get_ctry_fork_info());
 
-  tile_fork_count = merge_counts(tile_fork_count, stats.get_tile_fork_count());
-  ctry_fork_count = merge_counts(ctry_fork_count, stats.get_ctry_fork_count());
+  merge_counts(tile_fork_count, stats.get_tile_fork_count());
+  merge_counts(ctry_fork_count, stats.get_ctry_fork_count());
 
   // Combine roulette data
   roulette_data.Add(stats.roulette_data);
@@ -463,10 +694,10 @@ void statistics::RouletteData::AddNode(const PointLL& p) {
 }
 
 void statistics::RouletteData::Add(const RouletteData& rd) {
-  way_IDs = merge(way_IDs, rd.way_IDs);
-  way_shapes = merge(way_shapes, rd.way_shapes);
-  shape_bb = merge(shape_bb, rd.shape_bb);
-  unroutable_nodes = merge(unroutable_nodes, rd.unroutable_nodes);
+  merge(way_IDs, rd.way_IDs);
+  merge(way_shapes, rd.way_shapes);
+  merge(shape_bb, rd.shape_bb);
+  merge(unroutable_nodes, rd.unroutable_nodes);
 }
 
 void statistics::RouletteData::GenerateTasks(const boost::property_tree::ptree& /*pt*/) const {
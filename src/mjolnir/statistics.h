@@ -11,6 +11,7 @@
 #include <sqlite3.h>
 
 #include "baldr/graphconstants.h"
+#include "baldr/graphtile.h"
 #include "midgard/aabb2.h"
 #include <boost/property_tree/ptree.hpp>
 
@@ -30,6 +31,9 @@ const std::vector<RoadClass> rclasses = {RoadClass::kMotorway,     RoadClass::kP
 namespace valhalla {
 namespace mjolnir {
 
+// The protos have a RoadClass of their own, the statistics are kept by the one of the tiles
+using baldr::RoadClass;
+
 /**
  * This class gathers statistics on the road lengths within tile
  *  and country boundaries and breaks them down by road classification.
@@ -37,7 +41,7 @@ namespace mjolnir {
  *  country ISO code. The statistics are logged to debug by
  *  default and put into a sqlite3 DB file as defined in valhalla.json.
  *  This class also handles the values returned by the threads
- *  in GraphValidator.
+ *  in GraphValidator or valhalla_build_statistics.
  */
 
 class statistics {
@@ -276,6 +280,13 @@ public:
 
   const std::unordered_map<uint64_t, AABB2<PointLL>>& get_tile_geometries() const;
 
+  /**
+   * Gathers the statistics of the edges and nodes of a tile, so that a stage that goes over all of
+   * the tiles anyway can gather them along the way.
+   * @param tile  the tile
+   */
+  void add_tile(const GraphTile& tile);
+
   void add(const statistics& stats);
 
   void build_db(const boost::property_tree::ptree& pt);
@@ -42,8 +42,10 @@ void statistics::build_db(const boost::property_tree::ptree& pt) {
   }
   LOG_INFO("Writing statistics database");
 
-  // Turn on foreign keys
-  std::string sql = "PRAGMA foreign_keys = ON";
+  // Turn on foreign keys, the db is written from scratch in one go so there is no need to sync
+  // every transaction to disk or to keep a journal of it there
+  std::string sql = "PRAGMA foreign_keys = ON; PRAGMA synchronous = OFF; "
+                    "PRAGMA journal_mode = MEMORY";
   ret = sqlite3_exec(db_handle, sql.c_str(), NULL, NULL, &err_msg);
   if (ret != SQLITE_OK) {
     LOG_ERROR("Error: " + std::string(err_msg));
@@ -316,7 +318,7 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   }
   sql = "INSERT INTO tiledata (tileid, tilearea, totalroadlen, motorway, pmary, secondary, "
         "tertiary, trunk, residential, unclassified, serviceother, geom) ";
-  sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, GeomFromText(?, 4326))";
+  sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, BuildMbr(?, ?, ?, ?, 4326))";
   ret = sqlite3_prepare_v2(db_handle, sql.c_str(), strlen(sql.c_str()), &stmt, NULL);
   if (ret != SQLITE_OK) {
     LOG_ERROR("SQL error: " + sql);
@@ -350,15 +352,12 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
       ++index;
     }
     // Use tile bounding box corners to make a polygon
-    if (tile_geometries.find(tileid) != tile_geometries.end()) {
-      auto maxx = std::to_string(tile_geometries.at(tileid).maxx());
-      auto minx = std::to_string(tile_geometries.at(tileid).minx());
-      auto maxy = std::to_string(tile_geometries.at(tileid).maxy());
-      auto miny = std::to_string(tile_geometries.at(tileid).miny());
-      std::string polyWKT = "POLYGON ((" + minx + " " + miny + ", " + minx + " " + maxy + ", " +
-                            maxx + " " + maxy + ", " + maxx + " " + miny + ", " + minx + " " + miny +
-                            "))";
-      sqlite3_bind_text(stmt, index, polyWKT.c_str(), polyWKT.length(), SQLITE_STATIC);
+    auto geometry = tile_geometries.find(tileid);
+    if (geometry != tile_geometries.end()) {
+      sqlite3_bind_double(stmt, index++, geometry->second.minx());
+      sqlite3_bind_double(stmt, index++, geometry->second.miny());
+      sqlite3_bind_double(stmt, index++, geometry->second.maxx());
+      sqlite3_bind_double(stmt, index++, geometry->second.maxy());
     } else {
       LOG_ERROR("Geometry for tile " + std::to_string(tileid) + " not found.");
     }
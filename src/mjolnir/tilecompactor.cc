@@ -0,0 +1,111 @@
+#include "mjolnir/tilecompactor.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/tilequeue.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+struct compact_stats_t {
+  std::atomic<uint64_t> tiles{0};
+  std::atomic<uint64_t> before{0};
+  std::atomic<uint64_t> after{0};
+};
+
+void compact(const std::string& tile_dir,
+             const int level,
+             valhalla::mjolnir::TileQueue& tilequeue,
+             compact_stats_t& stats,
+             std::promise<void>& result) {
+  try {
+    GraphId tile_id;
+    while (tilequeue.next(tile_id)) {
+      auto file_name =
+          tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(tile_id);
+      std::ifstream in(file_name, std::ios::binary);
+      std::vector<char> tile((std::istreambuf_iterator<char>(in)),
+                             std::istreambuf_iterator<char>());
+      in.close();
+      auto compact = GraphTile::CompactTile(tile, level);
+      if (compact.size() == tile.size()) {
+        continue;
+      }
+
+      // write it next to where it goes so no one ever reads half of it
+      auto partial = file_name + ".partial";
+      std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+      out.write(compact.data(), compact.size());
+      out.close();
+      if (!out || std::rename(partial.c_str(), file_name.c_str()) != 0) {
+        throw std::runtime_error("Could not write compact tile " + file_name);
+      }
+      ++stats.tiles;
+      stats.before += tile.size();
+      stats.after += compact.size();
+    }
+    result.set_value();
+  } catch (...) { result.set_exception(std::current_exception()); }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void TileCompactor::Build(const boost::property_tree::ptree& pt) {
+  if (!pt.get<bool>("mjolnir.compact_tiles", false)) {
+    return;
+  }
+
+  // Every tile on disk, the largest first
+  GraphReader reader(pt.get_child("mjolnir"));
+  TileQueue tilequeue(reader.tile_dir(), reader.GetTileSet(), TileShard::FromConfig(pt));
+  const int level = pt.get<int>("mjolnir.compact_tiles_level", 9);
+
+  // Setup threads
+  uint32_t nthreads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  std::vector<std::shared_ptr<std::thread>> threads(nthreads);
+  LOG_INFO("Compacting " + std::to_string(tilequeue.size()) + " tiles with " +
+           std::to_string(nthreads) + " threads...");
+
+  // Spawn the threads
+  compact_stats_t stats;
+  std::vector<std::promise<void>> results(nthreads);
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].reset(new std::thread(compact, reader.tile_dir(), level, std::ref(tilequeue),
+                                     std::ref(stats), std::ref(results[i])));
+  }
+
+  // Wait for threads to finish, if something went wrong in one of them this rethrows it
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  for (auto& result : results) {
+    result.get_future().get();
+  }
+  tilequeue.LogUtilization("TileCompactor");
+  LOG_INFO("Compacted " + std::to_string(stats.tiles) + " tiles from " +
+           std::to_string(stats.before >> 20) + "MB to " + std::to_string(stats.after >> 20) +
+           "MB");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,165 @@
+#include "mjolnir/util.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+
+using namespace valhalla::baldr;
+using header_t = valhalla::midgard::tar::header_t;
+
+namespace {
+
+constexpr size_t kBlock = sizeof(header_t);
+
+size_t blocks(const size_t size) {
+  return (size + kBlock - 1) / kBlock * kBlock;
+}
+
+// A ustar header for a regular file
+header_t make_header(const std::string& name, const uint64_t size, const time_t mtime) {
+  if (name.size() >= sizeof(header_t::name)) {
+    throw std::runtime_error("Name too long for a tar header: " + name);
+  }
+  header_t header{};
+  std::memcpy(header.name, name.c_str(), name.size());
+  std::snprintf(header.mode, sizeof(header.mode), "%07o", 0644);
+  std::snprintf(header.uid, sizeof(header.uid), "%07o", 0);
+  std::snprintf(header.gid, sizeof(header.gid), "%07o", 0);
+  std::snprintf(header.size, sizeof(header.size), "%011" PRIo64, size);
+  std::snprintf(header.mtime, sizeof(header.mtime), "%011" PRIo64, static_cast<uint64_t>(mtime));
+  header.typeflag = '0';
+  std::memcpy(header.magic, "ustar", 6);
+  std::memcpy(header.version, "00", 2);
+
+  // the checksum is taken with the checksum itself as spaces
+  std::memset(header.chksum, ' ', sizeof(header.chksum));
+  uint32_t sum = 0;
+  for (size_t i = 0; i < sizeof(header); ++i) {
+    sum += reinterpret_cast<const unsigned char*>(&header)[i];
+  }
+  std::snprintf(header.chksum, sizeof(header.chksum), "%06o", sum);
+  header.chksum[7] = ' ';
+  return header;
+}
+
+struct member_t {
+  GraphId tile_id;
+  std::string name;
+  uint64_t size;
+  // where the padding before it starts, if any, and where its header is
+  uint64_t padding;
+  uint64_t header;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+size_t build_tile_extract(const boost::property_tree::ptree& config, const size_t alignment) {
+  if (alignment == 0 || alignment % kBlock != 0) {
+    throw std::runtime_error("The alignment of a tile extract must be a multiple of 512");
+  }
+  auto tile_extract = config.get<std::string>("mjolnir.tile_extract");
+  auto tile_dir = config.get<std::string>("mjolnir.tile_dir");
+
+  // the tiles on disk, in the order of their ids
+  auto pt = config.get_child("mjolnir");
+  pt.erase("tile_extract");
+  pt.erase("tile_url");
+  GraphReader reader(pt);
+  std::vector<GraphId> tile_ids;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    tile_ids.push_back(tile_id);
+  }
+  std::sort(tile_ids.begin(), tile_ids.end());
+
+  // lay out the tar: the index first and then every tile with its data on a page boundary, with
+  // a padding member in front of it where the header wouldnt fall right before the boundary
+  const uint64_t index_size = tile_ids.size() * sizeof(GraphReader::tile_index_entry);
+  uint64_t position = kBlock + blocks(index_size);
+  std::vector<member_t> members;
+  std::vector<GraphReader::tile_index_entry> index;
+  members.reserve(tile_ids.size());
+  index.reserve(tile_ids.size());
+  for (const auto& tile_id : tile_ids) {
+    auto name = GraphTile::FileSuffix(tile_id);
+    struct stat s;
+    auto file = tile_dir + filesystem::path::preferred_separator + name;
+    if (stat(file.c_str(), &s) != 0) {
+      throw std::runtime_error("Could not stat " + file);
+    }
+    uint64_t padding = position;
+    if ((position + kBlock) % alignment != 0) {
+      position += alignment - (position + kBlock) % alignment;
+    }
+    members.push_back({tile_id, name, static_cast<uint64_t>(s.st_size), padding, position});
+    index.push_back({position + kBlock, static_cast<uint32_t>(tile_id.value),
+                     static_cast<uint32_t>(s.st_size)});
+    position += kBlock + blocks(s.st_size);
+  }
+
+  // write it next to where it goes
+  auto partial = tile_extract + ".partial";
+  std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + partial + " for writing");
+  }
+  const std::vector<char> zeros(std::max(alignment, kBlock * 2), 0);
+  auto pad = [&out, &zeros](const uint64_t size) {
+    for (uint64_t left = size; left > 0;) {
+      auto count = std::min<uint64_t>(left, zeros.size());
+      out.write(zeros.data(), count);
+      left -= count;
+    }
+  };
+  const auto now = std::time(nullptr);
+  auto header = make_header(GraphReader::kTileIndexName, index_size, now);
+  out.write(reinterpret_cast<const char*>(&header), kBlock);
+  out.write(reinterpret_cast<const char*>(index.data()), index_size);
+  pad(blocks(index_size) - index_size);
+
+  std::vector<char> tile;
+  for (const auto& member : members) {
+    if (member.header != member.padding) {
+      header = make_header("padding", member.header - member.padding - kBlock, now);
+      out.write(reinterpret_cast<const char*>(&header), kBlock);
+      pad(member.header - member.padding - kBlock);
+    }
+    tile.resize(member.size);
+    std::ifstream in(tile_dir + filesystem::path::preferred_separator + member.name,
+                     std::ios::binary);
+    if (!in.read(tile.data(), tile.size())) {
+      throw std::runtime_error("Could not read tile " + member.name);
+    }
+    header = make_header(member.name, member.size, now);
+    out.write(reinterpret_cast<const char*>(&header), kBlock);
+    out.write(tile.data(), tile.size());
+    pad(blocks(member.size) - member.size);
+  }
+
+  // tars end with two empty blocks
+  pad(kBlock * 2);
+  out.close();
+  if (!out || std::rename(partial.c_str(), tile_extract.c_str()) != 0) {
+    throw std::runtime_error("Could not write " + tile_extract);
+  }
+  LOG_INFO("Packed " + std::to_string(members.size()) + " tiles into " + tile_extract);
+  return members.size();
+}
+
+} // namespace mjolnir
+} // namespace valhalla
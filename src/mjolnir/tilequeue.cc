@@ -0,0 +1,194 @@
+#include "mjolnir/tilequeue.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include "baldr/graphtile.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace mjolnir {
+
+TileShard TileShard::FromConfig(const boost::property_tree::ptree& pt) {
+  TileShard shard{pt.get<uint32_t>("mjolnir.shard.index", 0),
+                  pt.get<uint32_t>("mjolnir.shard.count", 1)};
+  if (shard.index >= shard.count) {
+    throw std::runtime_error("The shard index " + std::to_string(shard.index) +
+                             " must be less than the shard count " + std::to_string(shard.count));
+  }
+  return shard;
+}
+
+TileShard TileShard::FromString(const std::string& shard) {
+  auto slash = shard.find('/');
+  if (slash == std::string::npos) {
+    throw std::runtime_error("A shard is written as index/count, not " + shard);
+  }
+  boost::property_tree::ptree pt;
+  try {
+    pt.put("mjolnir.shard.index", std::stoul(shard.substr(0, slash)));
+    pt.put("mjolnir.shard.count", std::stoul(shard.substr(slash + 1)));
+  } catch (const std::logic_error&) {
+    throw std::runtime_error("A shard is written as index/count, not " + shard);
+  }
+  return FromConfig(pt);
+}
+
+namespace {
+// The tiles of the shard, cut from the tiles sorted by id where the weight before a tile crosses
+// the next multiple of the total weight over the count. Without any weight each tile counts one.
+void keep_shard(std::vector<std::pair<GraphId, uint64_t>>& tiles, const TileShard& shard) {
+  if (shard.count < 2) {
+    return;
+  }
+  std::sort(tiles.begin(), tiles.end(),
+            [](const std::pair<GraphId, uint64_t>& a, const std::pair<GraphId, uint64_t>& b) {
+              return a.first < b.first;
+            });
+  uint64_t total = 0;
+  for (const auto& tile : tiles) {
+    total += tile.second;
+  }
+  const bool unweighted = total == 0;
+  if (unweighted) {
+    total = tiles.size();
+  }
+
+  uint64_t before = 0;
+  auto kept = tiles.begin();
+  for (const auto& tile : tiles) {
+    if (before * shard.count / total == shard.index) {
+      *kept++ = tile;
+    }
+    before += unweighted ? 1 : tile.second;
+  }
+  tiles.erase(kept, tiles.end());
+}
+} // namespace
+
+TileQueue::TileQueue(std::vector<std::pair<GraphId, uint64_t>> tiles,
+                     const TileShard& shard,
+                     const group_t& group)
+    : shard_(shard), next_(0), start_(std::chrono::steady_clock::now()), done_(0),
+      done_sum_us_(0), done_max_us_(0), done_min_us_(std::numeric_limits<uint64_t>::max()) {
+  keep_shard(tiles, shard);
+
+  // heaviest first, the ties in the order of the ids so the order is always the same
+  std::sort(tiles.begin(), tiles.end(),
+            [](const std::pair<GraphId, uint64_t>& a, const std::pair<GraphId, uint64_t>& b) {
+              return a.second == b.second ? a.first < b.first : a.second > b.second;
+            });
+
+  // then the heaviest groups first, the tiles of a group keeping their order from above
+  if (group) {
+    std::unordered_map<uint32_t, uint64_t> group_weights;
+    std::vector<uint32_t> groups;
+    groups.reserve(tiles.size());
+    for (const auto& tile : tiles) {
+      groups.push_back(group(tile.first));
+      group_weights[groups.back()] += tile.second;
+    }
+    std::vector<uint64_t> weights;
+    weights.reserve(tiles.size());
+    for (auto g : groups) {
+      weights.push_back(group_weights[g]);
+    }
+    std::vector<size_t> order(tiles.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&groups, &weights](size_t a, size_t b) {
+      return weights[a] == weights[b] ? groups[a] < groups[b] : weights[a] > weights[b];
+    });
+    std::vector<std::pair<GraphId, uint64_t>> grouped;
+    grouped.reserve(tiles.size());
+    for (auto i : order) {
+      grouped.push_back(tiles[i]);
+    }
+    tiles.swap(grouped);
+  }
+  tiles_.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    tiles_.push_back(tile.first);
+  }
+}
+
+namespace {
+std::vector<std::pair<GraphId, uint64_t>> weigh(const std::string& tile_dir,
+                                                const std::unordered_set<GraphId>& tiles) {
+  std::vector<std::pair<GraphId, uint64_t>> weighed;
+  weighed.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    struct stat s;
+    auto file = tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(tile);
+    weighed.emplace_back(tile, stat(file.c_str(), &s) == 0 ? s.st_size : 0);
+  }
+  return weighed;
+}
+} // namespace
+
+TileQueue::TileQueue(const std::string& tile_dir,
+                     const std::unordered_set<GraphId>& tiles,
+                     const TileShard& shard,
+                     const group_t& group)
+    : TileQueue(weigh(tile_dir, tiles), shard, group) {
+}
+
+bool TileQueue::next(GraphId& tile) {
+  // how many tiles this thread took so far, a thread only works on one queue at a time
+  static thread_local uint64_t taken = 0;
+  auto index = next_++;
+  if (index < tiles_.size()) {
+    tile = tiles_[index];
+    ++taken;
+    return true;
+  }
+
+  // this thread is out of work, remember when
+  uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start_)
+                    .count();
+  ++done_;
+  done_sum_us_ += us;
+  for (auto max = done_max_us_.load(); us > max && !done_max_us_.compare_exchange_weak(max, us);) {
+  }
+  for (auto min = done_min_us_.load(); us < min && !done_min_us_.compare_exchange_weak(min, us);) {
+  }
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  threads_.push_back({taken, us * 1e-6});
+  taken = 0;
+  return false;
+}
+
+void TileQueue::LogUtilization(const std::string& stage) const {
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    BuildReport::Get().AddThreads(stage, threads_);
+  }
+  if (done_ == 0 || done_max_us_ == 0) {
+    return;
+  }
+  // the share of the time from the start to the last thread finishing that the threads were busy
+  double utilization = static_cast<double>(done_sum_us_) / (done_ * done_max_us_);
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1) << stage << " worked through " << tiles_.size()
+     << " tiles";
+  if (shard_.count > 1) {
+    ss << " of shard " << shard_.index << "/" << shard_.count;
+  }
+  ss << " on " << done_ << " threads at " << utilization * 100.0
+     << "% utilization, the first thread ran out of tiles after " << done_min_us_ * 1e-6
+     << "s and the last after " << done_max_us_ * 1e-6 << "s";
+  LOG_INFO(ss.str());
+}
+
+} // namespace mjolnir
+} // namespace valhalla
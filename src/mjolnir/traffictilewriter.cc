@@ -0,0 +1,92 @@
+#include "mjolnir/traffictilewriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace mjolnir {
+
+TrafficTileWriter::TrafficTileWriter(const std::string& traffic_extract)
+    : archive_(new midgard::tar(traffic_extract)) {
+  // the tar is mapped shared and writable so what we write is what the services see
+  for (const auto& c : archive_->contents) {
+    try {
+      auto id = GraphTile::GetTileId(c.first);
+      tiles_[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
+    } catch (...) {
+      // there can be other files in the tar
+    }
+  }
+  if (tiles_.empty()) {
+    throw std::runtime_error("Traffic tile extract contained no usable tiles: " + traffic_extract);
+  }
+  LOG_INFO("Writing speeds into " + std::to_string(tiles_.size()) + " traffic tiles");
+}
+
+size_t TrafficTileWriter::Write(std::vector<update_t> updates, const uint64_t last_update) {
+  // group by tile keeping the order of the updates of any one edge
+  std::stable_sort(updates.begin(), updates.end(), [](const update_t& a, const update_t& b) {
+    return a.first.Tile_Base() < b.first.Tile_Base();
+  });
+
+  size_t written = 0;
+  for (auto begin = updates.cbegin(); begin != updates.cend();) {
+    const auto tile_id = begin->first.Tile_Base();
+    auto end = std::find_if(begin, updates.cend(),
+                            [&tile_id](const update_t& u) { return u.first.Tile_Base() != tile_id; });
+    auto tile = tiles_.find(tile_id);
+    if (tile != tiles_.cend()) {
+      written += WriteTile(tile->second.first, tile->second.second, begin, end, last_update);
+    }
+    begin = end;
+  }
+  return written;
+}
+
+size_t TrafficTileWriter::WriteTile(char* tile,
+                                    const size_t size,
+                                    std::vector<update_t>::const_iterator begin,
+                                    std::vector<update_t>::const_iterator end,
+                                    const uint64_t last_update) {
+  if (size < sizeof(TrafficTileHeader)) {
+    return 0;
+  }
+  auto* header = reinterpret_cast<volatile TrafficTileHeader*>(tile);
+  auto* speeds = reinterpret_cast<volatile uint64_t*>(tile + sizeof(TrafficTileHeader));
+  const uint32_t edge_count =
+      std::min<uint64_t>(header->directed_edge_count,
+                         (size - sizeof(TrafficTileHeader)) / sizeof(TrafficSpeed));
+
+  // readers seeing an odd sequence know the speeds are changing
+  const uint32_t sequence = header->sequence;
+  header->sequence = sequence + 1;
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // every record goes in one store so no reader sees half of it
+  size_t written = 0;
+  for (; begin != end; ++begin) {
+    if (begin->first.id() >= edge_count) {
+      continue;
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &begin->second, sizeof(bits));
+    speeds[begin->first.id()] = bits;
+    ++written;
+  }
+
+  // and an even one that they are done
+  std::atomic_thread_fence(std::memory_order_release);
+  header->last_update = last_update;
+  header->sequence = sequence + 2;
+  return written;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -1,27 +1,42 @@
 #include "mjolnir/util.h"
 
+#include "baldr/opposingedges.h"
+#include "baldr/recoveredshortcuts.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/aabb2.h"
 #include "midgard/logging.h"
 #include "midgard/point2.h"
 #include "midgard/polyline2.h"
+#include "midgard/sequence.h"
+#include "mjolnir/altlandmarkbuilder.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/buildreport.h"
+#include "mjolnir/contractionbuilder.h"
+#include "mjolnir/edgereachbuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/graphfilter.h"
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/opposingedgesbuilder.h"
+#include "mjolnir/osmdata.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/pbfgraphparser.h"
 #include "mjolnir/restrictionbuilder.h"
 #include "mjolnir/shortcutbuilder.h"
+#include "mjolnir/spatialindexbuilder.h"
+#include "mjolnir/tilecompactor.h"
+#include "mjolnir/tilequeue.h"
 #include "mjolnir/transitbuilder.h"
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <fstream>
+#include <unordered_set>
 
 using namespace valhalla::midgard;
 
@@ -180,6 +195,21 @@ bool build_tile_set(const boost::property_tree::ptree& config,
     throw std::runtime_error("Tiles cannot be directly built into a tar extract");
   }
 
+  // only the stages which work tile by tile on the tiles of the local level can be split over
+  // several machines, the other stages need all of the tiles to themselves
+  if (TileShard::FromConfig(config).count > 1) {
+    auto shardable = [](BuildStage stage) {
+      return stage == BuildStage::kBuild || stage == BuildStage::kEnhance ||
+             stage == BuildStage::kElevation;
+    };
+    for (int stage = static_cast<int>(start_stage); stage <= static_cast<int>(end_stage); ++stage) {
+      if (!shardable(static_cast<BuildStage>(stage))) {
+        throw std::runtime_error("The " + to_string(static_cast<BuildStage>(stage)) +
+                                 " stage cannot be run on a shard of the tiles");
+      }
+    }
+  }
+
   // Get the tile directory (make sure it ends with the preferred separator
   std::string tile_dir = config.get<std::string>("mjolnir.tile_dir");
   if (tile_dir.back() != filesystem::path::preferred_separator) {
@@ -210,6 +240,15 @@ bool build_tile_set(const boost::property_tree::ptree& config,
     filesystem::create_directories(tile_dir);
   }
 
+  // The tiles the opposing edges and shortcuts were stored for are about to change, the readers
+  // of the stages in between must not use them
+  if (start_stage <= BuildStage::kOpposingEdges) {
+    remove_temp_file(baldr::OpposingEdges::FileName(tile_dir));
+  }
+  if (start_stage <= BuildStage::kShortcutRecovery) {
+    remove_temp_file(baldr::RecoveredShortcuts::FileName(tile_dir));
+  }
+
   // Set up the temporary (*.bin) files used during processing
   std::string ways_bin = tile_dir + ways_file;
   std::string way_nodes_bin = tile_dir + way_nodes_file;
@@ -228,9 +267,11 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Parse the ways
   if (start_stage <= BuildStage::kParseWays && BuildStage::kParseWays <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kParseWays));
     // Read the OSM protocol buffer file. Callbacks for ways are defined within the PBFParser class
     osm_data = PBFGraphParser::ParseWays(config.get_child("mjolnir"), input_files, ways_bin,
                                          way_nodes_bin, access_bin);
+    BuildReport::Get().Count("ways", osm_data.osm_way_count);
 
     // Free all protobuf memory - cannot use the protobuffer lib after this!
     if (release_osmpbf_memory && BuildStage::kParseWays == end_stage) {
@@ -245,7 +286,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Parse OSM data
   if (start_stage <= BuildStage::kParseRelations && BuildStage::kParseRelations <= end_stage) {
-
+    BuildReport::Get().Begin(to_string(BuildStage::kParseRelations));
     // Read the OSM protocol buffer file. Callbacks for relations are defined within the PBFParser
     // class
     PBFGraphParser::ParseRelations(config.get_child("mjolnir"), input_files, cr_from_bin, cr_to_bin,
@@ -264,10 +305,12 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Parse OSM data
   if (start_stage <= BuildStage::kParseNodes && BuildStage::kParseNodes <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kParseNodes));
     // Read the OSM protocol buffer file. Callbacks for nodes
     // are defined within the PBFParser class
     PBFGraphParser::ParseNodes(config.get_child("mjolnir"), input_files, way_nodes_bin, bss_nodes_bin,
                                osm_data);
+    BuildReport::Get().Count("nodes", osm_data.osm_node_count);
 
     // Free all protobuf memory - cannot use the protobuffer lib after this!
     if (release_osmpbf_memory) {
@@ -283,12 +326,13 @@ bool build_tile_set(const boost::property_tree::ptree& config,
   // Construct edges
   std::map<baldr::GraphId, size_t> tiles;
   if (start_stage <= BuildStage::kConstructEdges && BuildStage::kConstructEdges <= end_stage) {
-
+    BuildReport::Get().Begin(to_string(BuildStage::kConstructEdges));
     // Read OSMData from files if construct edges is the first stage
     if (start_stage == BuildStage::kConstructEdges)
       osm_data.read_from_temp_files(tile_dir);
 
     tiles = GraphBuilder::BuildEdges(config, ways_bin, way_nodes_bin, nodes_bin, edges_bin);
+    BuildReport::Get().Count("tiles", tiles.size());
     // Output manifest
     TileManifest manifest{tiles};
     manifest.LogToFile(tile_manifest);
@@ -296,11 +340,15 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Build Valhalla routing tiles
   if (start_stage <= BuildStage::kBuild && BuildStage::kBuild <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kBuild));
     if (start_stage == BuildStage::kBuild) {
       // Read OSMData from files if building tiles is the first stage
       osm_data.read_from_temp_files(tile_dir);
       if (filesystem::exists(tile_manifest)) {
         tiles = TileManifest::ReadFromFile(tile_manifest).tileset;
+      } else if (TileShard::FromConfig(config).count > 1) {
+        throw std::runtime_error("A shard can only build tiles once the constructedges stage has "
+                                 "written the tile manifest");
       } else {
         // TODO: Remove this backfill in the future, and make calling constructedges stage
         // explicitly required in the future.
@@ -318,6 +366,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
   // level that is usable across all levels (density, administrative
   // information (and country based attribution), edge transition logic, etc.
   if (start_stage <= BuildStage::kEnhance && BuildStage::kEnhance <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kEnhance));
     // Read OSMData names from file if enhancing tiles is the first stage
     if (start_stage == BuildStage::kEnhance) {
       osm_data.read_from_unique_names_file(tile_dir);
@@ -327,16 +376,19 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Perform optional edge filtering (remove edges and nodes for specific access modes)
   if (start_stage <= BuildStage::kFilter && BuildStage::kFilter <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kFilter));
     GraphFilter::Filter(config);
   }
 
   // Add transit
   if (start_stage <= BuildStage::kTransit && BuildStage::kTransit <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kTransit));
     TransitBuilder::Build(config);
   }
 
   // Build bike share stations
   if (start_stage <= BuildStage::kBss && BuildStage::kBss <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kBss));
     BssBuilder::Build(config, bss_nodes_bin);
   }
 
@@ -345,6 +397,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
   auto build_hierarchy = config.get<bool>("mjolnir.hierarchy", true);
   if (build_hierarchy) {
     if (start_stage <= BuildStage::kHierarchy && BuildStage::kHierarchy <= end_stage) {
+      BuildReport::Get().Begin(to_string(BuildStage::kHierarchy));
       HierarchyBuilder::Build(config, new_to_old_bin, old_to_new_bin);
     }
 
@@ -353,6 +406,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
     auto build_shortcuts = config.get<bool>("mjolnir.shortcuts", true);
     if (build_shortcuts) {
       if (start_stage <= BuildStage::kShortcuts && BuildStage::kShortcuts <= end_stage) {
+        BuildReport::Get().Begin(to_string(BuildStage::kShortcuts));
         ShortcutBuilder::Build(config);
       }
     } else {
@@ -364,6 +418,7 @@ bool build_tile_set(const boost::property_tree::ptree& config,
 
   // Add elevation to the tiles
   if (start_stage <= BuildStage::kElevation && BuildStage::kElevation <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kElevation));
     ElevationBuilder::Build(config);
   }
 
@@ -372,16 +427,61 @@ bool build_tile_set(const boost::property_tree::ptree& config,
   // elevation into the tiles reads each tile and serializes the data to "builders"
   // within the tile. However, there is no serialization currently available for complex restrictions.
   if (start_stage <= BuildStage::kRestrictions && BuildStage::kRestrictions <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kRestrictions));
     RestrictionBuilder::Build(config, cr_from_bin, cr_to_bin);
   }
 
   // Validate the graph and add information that cannot be added until full graph is formed.
   if (start_stage <= BuildStage::kValidate && BuildStage::kValidate <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kValidate));
     GraphValidator::Validate(config);
   }
 
+  // Build the contraction hierarchies, needs the validated graph since it relies on opposing edges
+  if (start_stage <= BuildStage::kContraction && BuildStage::kContraction <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kContraction));
+    ContractionBuilder::Build(config);
+  }
+
+  // Compute the landmark distances for the ALT heuristic, again on the validated graph
+  if (start_stage <= BuildStage::kLandmarks && BuildStage::kLandmarks <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kLandmarks));
+    AltLandmarkBuilder::Build(config);
+  }
+
+  // And the reach of every edge for loki to filter islands with
+  if (start_stage <= BuildStage::kReach && BuildStage::kReach <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kReach));
+    EdgeReachBuilder::Build(config);
+  }
+
+  // Index the nodes and edges of every level for the services to query without the tile bins
+  if (start_stage <= BuildStage::kSpatialIndex && BuildStage::kSpatialIndex <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kSpatialIndex));
+    SpatialIndexBuilder::Build(config);
+  }
+
+  // And the opposing edge of every edge so the readers dont have to look at the end nodes
+  if (start_stage <= BuildStage::kOpposingEdges && BuildStage::kOpposingEdges <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kOpposingEdges));
+    OpposingEdgesBuilder::Build(config);
+  }
+
+  // The edges of every shortcut so the readers dont have to recover them themselves
+  if (start_stage <= BuildStage::kShortcutRecovery && BuildStage::kShortcutRecovery <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kShortcutRecovery));
+    ShortcutBuilder::Recover(config);
+  }
+
+  // Deflate the variable size sections of every tile last, once nothing else rewrites the tiles
+  if (start_stage <= BuildStage::kCompact && BuildStage::kCompact <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kCompact));
+    TileCompactor::Build(config);
+  }
+
   // Cleanup bin files
   if (start_stage <= BuildStage::kCleanup && BuildStage::kCleanup <= end_stage) {
+    BuildReport::Get().Begin(to_string(BuildStage::kCleanup));
     LOG_INFO("Cleaning up temporary *.bin files within " + tile_dir);
     remove_temp_file(ways_bin);
     remove_temp_file(way_nodes_bin);
@@ -396,8 +496,113 @@ bool build_tile_set(const boost::property_tree::ptree& config,
     remove_temp_file(tile_manifest);
     OSMData::cleanup_temp_files(tile_dir);
   }
+
+  // Write what each of the stages took if asked to
+  auto build_report = config.get_optional<std::string>("mjolnir.build_report");
+  if (build_report && !build_report->empty()) {
+    std::ofstream report(*build_report, std::ios::trunc);
+    BuildReport::Get().Write(report);
+    if (!report) {
+      LOG_ERROR("Could not write the build report to " + *build_report);
+    } else {
+      LOG_INFO("Wrote the build report to " + *build_report);
+    }
+  }
   return true;
 }
 
+std::set<baldr::GraphId> affected_tiles(const ptree& config, const std::string& osc_file) {
+  // gather the ids and whatever locations the change file has itself
+  ptree osc;
+  boost::property_tree::read_xml(osc_file, osc);
+  std::unordered_set<uint64_t> node_ids, way_ids;
+  std::vector<PointLL> points;
+  for (const auto& action : osc.get_child("osmChange", ptree())) {
+    if (action.first != "create" && action.first != "modify" && action.first != "delete") {
+      continue;
+    }
+    for (const auto& element : action.second) {
+      if (element.first == "node") {
+        node_ids.insert(element.second.get<uint64_t>("<xmlattr>.id"));
+        auto lat = element.second.get_optional<double>("<xmlattr>.lat");
+        auto lon = element.second.get_optional<double>("<xmlattr>.lon");
+        if (lat && lon) {
+          points.emplace_back(*lon, *lat);
+        }
+      } else if (element.first == "way") {
+        way_ids.insert(element.second.get<uint64_t>("<xmlattr>.id"));
+        for (const auto& nd : element.second) {
+          if (nd.first == "nd") {
+            node_ids.insert(nd.second.get<uint64_t>("<xmlattr>.ref"));
+          }
+        }
+      } else if (element.first == "relation") {
+        for (const auto& member : element.second) {
+          if (member.first != "member") {
+            continue;
+          }
+          auto type = member.second.get<std::string>("<xmlattr>.type", "");
+          auto ref = member.second.get<uint64_t>("<xmlattr>.ref");
+          if (type == "way") {
+            way_ids.insert(ref);
+          } else if (type == "node") {
+            node_ids.insert(ref);
+          }
+        }
+      }
+    }
+  }
+
+  // the ways and nodes as they were at the last build, the ways are in the order of their index
+  const auto tile_dir = config.get<std::string>("mjolnir.tile_dir") +
+                        filesystem::path::preferred_separator;
+  std::unordered_set<uint32_t> way_indices;
+  if (!way_ids.empty()) {
+    sequence<OSMWay> ways(tile_dir + ways_file, false);
+    uint32_t index = 0;
+    ways.enumerate([&](const OSMWay& way) {
+      if (way_ids.count(way.way_id())) {
+        way_indices.insert(index);
+      }
+      ++index;
+    });
+  }
+  if (!way_indices.empty() || !node_ids.empty()) {
+    sequence<OSMWayNode> way_nodes(tile_dir + way_nodes_file, false);
+    way_nodes.enumerate([&](const OSMWayNode& way_node) {
+      if (way_indices.count(way_node.way_index) || node_ids.count(way_node.node.osmid_)) {
+        points.emplace_back(way_node.node.latlng());
+      }
+    });
+  }
+
+  // the tiles of the local level that changed
+  const auto& levels = baldr::TileHierarchy::levels();
+  const auto& local = levels.back();
+  std::unordered_set<baldr::GraphId> changed;
+  for (const auto& id : baldr::TileHierarchy::GetGraphIds(points, local.level)) {
+    if (id.Is_Valid()) {
+      changed.insert(id);
+    }
+  }
+
+  // plus their neighbors, plus whatever is over all of those on the other levels
+  std::set<baldr::GraphId> affected;
+  const auto half = local.tiles.TileSize() / 2;
+  for (const auto& id : changed) {
+    auto bbox = baldr::TileHierarchy::GetGraphIdBoundingBox(id);
+    AABB2<PointLL> around(std::max(bbox.minx() - half, -180.), std::max(bbox.miny() - half, -90.),
+                          std::min(bbox.maxx() + half, 180.), std::min(bbox.maxy() + half, 90.));
+    for (const auto& level : levels) {
+      for (const auto& tile_id : baldr::TileHierarchy::GetGraphIds(around, level.level)) {
+        affected.insert(tile_id);
+      }
+    }
+  }
+  LOG_INFO(std::to_string(changed.size()) + " tiles changed, " + std::to_string(affected.size()) +
+           " tiles are affected");
+  return affected;
+}
+
 } // namespace mjolnir
 } // namespace valhalla
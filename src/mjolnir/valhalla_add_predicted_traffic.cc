@@ -3,8 +3,10 @@
 #include "baldr/rapidjson_utils.h"
 #include "filesystem.h"
 #include "midgard/logging.h"
+#include "midgard/sequence.h"
 #include "midgard/util.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilequeue.h"
 #include "mjolnir/util.h"
 
 #include <cmath>
@@ -15,11 +17,12 @@
 #include <boost/archive/iterators/transform_width.hpp>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
-#include <boost/tokenizer.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <deque>
 #include <future>
+#include <map>
 #include <mutex>
 #include <queue>
 #include <string>
@@ -54,112 +57,192 @@ struct stats {
   }
 };
 
+// One row of a speed csv, fixed in size so that the rows can be sorted on disk. Where the row came
+// from breaks the ties so the first row of an edge wins no matter how the parsing was split up
 struct TrafficSpeeds {
+  uint64_t edge_id;
+  uint32_t file_index;
+  uint64_t position;
   uint8_t constrained_flow_speed;
   uint8_t free_flow_speed;
-  std::vector<int16_t> coefficients;
+  bool has_coefficients;
+  int16_t coefficients[kCoefficientCount];
+
+  // by tile and then by edge within it
+  bool operator<(const TrafficSpeeds& other) const {
+    GraphId a(edge_id), b(other.edge_id);
+    if (a.tile_value() != b.tile_value()) {
+      return a.tile_value() < b.tile_value();
+    }
+    if (a.id() != b.id()) {
+      return a.id() < b.id();
+    }
+    if (file_index != other.file_index) {
+      return file_index < other.file_index;
+    }
+    return position < other.position;
+  }
+};
+
+// How much of a file a thread parses at once and how many rows it keeps before handing them off
+constexpr uint64_t kChunkSize = 1024 * 1024 * 16;
+constexpr size_t kBatchSize = 4096;
+
+struct chunk_t {
+  uint32_t file_index;
+  uint64_t begin;
+  uint64_t end;
 };
 
 /**
- * Read speed CSV file and update the tile_speeds in unique_data
+ * Parses one row of a speed csv: the edge id, the free flow speed, the constrained flow speed and
+ * optionally the base64 encoded speed profile. A row that doesnt parse is logged and skipped.
  */
-std::unordered_map<uint32_t, TrafficSpeeds>
-ParseTrafficFile(const std::vector<std::string>& filenames, stats& stat) {
-  typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
-  boost::char_separator<char> sep{","};
-  std::unordered_map<uint32_t, TrafficSpeeds> ts;
-
-  // for each traffic tile
-  for (const auto& full_filename : filenames) {
-    // Open file
-    std::string line;
-    std::ifstream file(full_filename);
-    uint32_t line_num = 0;
-    if (file.is_open()) {
-      // for each row in the file
-      while (getline(file, line) && ++line_num) {
-        decltype(ts)::iterator traffic = ts.end();
-        tokenizer tok{line, sep};
-        uint32_t field_num = 0;
-        bool has_error = false;
-        // for each column in the row
-        for (const auto& t : tok) {
-          if (has_error)
-            break;
-          // parse each column
-          switch (field_num) {
-            case 0: {
-              try {
-                auto inserted = ts.insert(decltype(ts)::value_type(GraphId(t).id(), {}));
-                traffic = inserted.first;
-                // skip duplicates
-                if (!inserted.second) {
-                  ++stat.dup_count;
-                  has_error = true;
-                  traffic = ts.end();
-                }
-              } catch (std::exception& e) {
-                LOG_WARN("Invalid GraphId in file: " + full_filename + " line number " +
-                         std::to_string(line_num));
-                has_error = true;
-              }
-            } break;
-            case 1: {
-              try {
-                traffic->second.free_flow_speed = std::stoi(t);
-                stat.free_flow_count++;
-              } catch (std::exception& e) {
-                LOG_WARN("Invalid free flow speed in file: " + full_filename + " line number " +
-                         std::to_string(line_num));
-                has_error = true;
-              }
-            } break;
-            case 2: {
-              try {
-                traffic->second.constrained_flow_speed = std::stoi(t);
-                stat.constrained_count++;
-              } catch (std::exception& e) {
-                LOG_WARN("Invalid constrained flow speed in file: " + full_filename +
-                         " line number " + std::to_string(line_num));
-                has_error = true;
-              }
-            } break;
-            case 3: {
-              if (t.size()) {
-                try {
-                  // Decode the base64 predicted speeds
-                  // Decode the base64 string and cast the data to a raw string of signed bytes
-                  auto coefficients = decode_compressed_speeds(t);
-                  traffic->second.coefficients.assign(coefficients.begin(), coefficients.end());
-                  stat.compressed_count++;
-                } catch (std::exception& e) {
-                  LOG_WARN("Invalid compressed speeds in file: " + full_filename + " line number " +
-                           std::to_string(line_num) + "; error='" + e.what() + "'");
-                  has_error = true;
-                }
-              }
-            } break;
-            default:
-              break;
+bool ParseTrafficRow(const std::string& line,
+                     const std::string& file_name,
+                     const uint64_t position,
+                     TrafficSpeeds& speeds,
+                     stats& stat) {
+  speeds.constrained_flow_speed = speeds.free_flow_speed = 0;
+  speeds.has_coefficients = false;
+  size_t field_num = 0;
+  for (size_t begin = 0; begin <= line.size() && field_num < 4; ++field_num) {
+    auto end = std::min(line.find(',', begin), line.size());
+    const auto t = line.substr(begin, end - begin);
+    begin = end + 1;
+    // parse each column
+    switch (field_num) {
+      case 0: {
+        try {
+          speeds.edge_id = GraphId(t).value;
+        } catch (std::exception& e) {
+          LOG_WARN("Invalid GraphId in file: " + file_name + " at byte " + std::to_string(position));
+          return false;
+        }
+      } break;
+      case 1: {
+        try {
+          speeds.free_flow_speed = std::stoi(t);
+          stat.free_flow_count++;
+        } catch (std::exception& e) {
+          LOG_WARN("Invalid free flow speed in file: " + file_name + " at byte " +
+                   std::to_string(position));
+          return false;
+        }
+      } break;
+      case 2: {
+        try {
+          speeds.constrained_flow_speed = std::stoi(t);
+          stat.constrained_count++;
+        } catch (std::exception& e) {
+          LOG_WARN("Invalid constrained flow speed in file: " + file_name + " at byte " +
+                   std::to_string(position));
+          return false;
+        }
+      } break;
+      case 3: {
+        if (t.size()) {
+          try {
+            // Decode the base64 string and cast the data to a raw string of signed bytes
+            auto coefficients = decode_compressed_speeds(t);
+            std::copy(coefficients.begin(), coefficients.end(), speeds.coefficients);
+            speeds.has_coefficients = true;
+            stat.compressed_count++;
+          } catch (std::exception& e) {
+            LOG_WARN("Invalid compressed speeds in file: " + file_name + " at byte " +
+                     std::to_string(position) + "; error='" + e.what() + "'");
+            return false;
           }
-          field_num++;
         }
-        // if this one was erroneous lets not keep it
-        if (has_error && traffic != ts.end())
-          ts.erase(traffic);
+      } break;
+      default:
+        break;
+    }
+  }
+  return field_num > 0;
+}
+
+/**
+ * Parses the chunks of the speed csvs until there are none left. A chunk has the rows which start
+ * within it, the rows are appended in batches to the sequence which is shared by all the threads.
+ */
+void parse_chunks(const std::vector<std::string>& files,
+                  const std::vector<chunk_t>& chunks,
+                  std::atomic<size_t>& next_chunk,
+                  vm::sequence<TrafficSpeeds>& records,
+                  std::mutex& lock,
+                  std::promise<stats>& result) {
+  stats stat{};
+  std::vector<TrafficSpeeds> batch;
+  batch.reserve(kBatchSize);
+  auto hand_off = [&batch, &records, &lock]() {
+    std::lock_guard<std::mutex> l(lock);
+    for (const auto& speeds : batch) {
+      records.push_back(speeds);
+    }
+    batch.clear();
+  };
+
+  TrafficSpeeds speeds{};
+  std::string line;
+  for (size_t c = next_chunk++; c < chunks.size(); c = next_chunk++) {
+    const auto& chunk = chunks[c];
+    const auto& file_name = files[chunk.file_index];
+    std::ifstream file(file_name);
+    if (!file.is_open()) {
+      LOG_ERROR("Could not open file: " + file_name);
+      continue;
+    }
+
+    // the row which straddles the beginning belongs to the chunk before this one
+    uint64_t position = chunk.begin;
+    if (position > 0) {
+      file.seekg(position - 1);
+      std::getline(file, line);
+      position += line.size();
+    }
+    while (position < chunk.end && std::getline(file, line)) {
+      speeds.file_index = chunk.file_index;
+      speeds.position = position;
+      position += line.size() + 1;
+      if (ParseTrafficRow(line, file_name, speeds.position, speeds, stat)) {
+        batch.push_back(speeds);
+        if (batch.size() == kBatchSize) {
+          hand_off();
+        }
       }
-      file.close();
-    } else {
-      LOG_ERROR("Could not open file: " + full_filename);
     }
   }
+  hand_off();
+  result.set_value(stat);
+}
 
-  return ts;
+/**
+ * Overwrites the directed edges of a tile where they are in its file, for tiles which get no speed
+ * profiles the rest of the tile stays as it is.
+ */
+void patch_directed_edges(const std::string& tile_path,
+                          const GraphTileHeader& header,
+                          const std::vector<DirectedEdge>& directededges) {
+  std::fstream file(tile_path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(sizeof(GraphTileHeader) + header.nodecount() * sizeof(NodeInfo) +
+             header.transitioncount() * sizeof(NodeTransition));
+  file.write(reinterpret_cast<const char*>(directededges.data()),
+             directededges.size() * sizeof(DirectedEdge));
+  if (!file) {
+    throw std::runtime_error("Could not update the directed edges of " + tile_path);
+  }
 }
 
+/**
+ * Updates the directed edges of a tile with the speeds of the sorted rows [begin, end) of the
+ * records, which are all within the tile.
+ */
 void update_tile(const std::string& tile_dir,
                  const GraphId& tile_id,
-                 const std::unordered_map<uint32_t, TrafficSpeeds>& speeds,
+                 vm::sequence<TrafficSpeeds>& records,
+                 size_t begin,
+                 const size_t end,
                  stats& stat) {
   auto tile_path = tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(tile_id);
   if (!filesystem::exists(tile_path)) {
@@ -169,71 +252,77 @@ void update_tile(const std::string& tile_dir,
 
   // Get the tile
   vj::GraphTileBuilder tile_builder(tile_dir, tile_id, false);
+  const auto edge_count = tile_builder.header()->directededgecount();
 
-  // Get a count of how many predicted speed edges there will be this avoids reallocs
+  // Keep the first row of every edge
+  std::vector<TrafficSpeeds> speeds;
+  speeds.reserve(end - begin);
   size_t pred_count = 0;
-  for (uint32_t j = 0; j < tile_builder.header()->directededgecount(); ++j) {
-    auto found = speeds.find(j);
-    pred_count += found != speeds.cend() && found->second.coefficients.size() == kCoefficientCount;
+  for (; begin < end; ++begin) {
+    TrafficSpeeds row = records[begin];
+    if (!speeds.empty() && GraphId(speeds.back().edge_id).id() == GraphId(row.edge_id).id()) {
+      ++stat.dup_count;
+      continue;
+    }
+    if (GraphId(row.edge_id).id() >= edge_count) {
+      LOG_WARN("No edge " + std::to_string(GraphId(row.edge_id)) + " in tile " + tile_path);
+      continue;
+    }
+    pred_count += row.has_coefficients;
+    speeds.emplace_back(row);
   }
 
-  // Update directed edges as needed
+  // Update directed edges as needed, the rows are in the order of the edges
   std::vector<DirectedEdge> directededges;
-  directededges.reserve(tile_builder.header()->directededgecount());
-  for (uint32_t j = 0; j < tile_builder.header()->directededgecount(); ++j) {
+  directededges.reserve(edge_count);
+  auto speed = speeds.cbegin();
+  for (uint32_t j = 0; j < edge_count; ++j) {
     // skip edges for which we dont have speed data
     DirectedEdge& directededge = tile_builder.directededge(j);
-    auto found = speeds.find(j);
-    if (found != speeds.end()) {
-      const auto& speed = found->second;
-      if (speed.constrained_flow_speed) {
-        directededge.set_constrained_flow_speed(speed.constrained_flow_speed);
+    if (speed != speeds.cend() && GraphId(speed->edge_id).id() == j) {
+      if (speed->constrained_flow_speed) {
+        directededge.set_constrained_flow_speed(speed->constrained_flow_speed);
       }
-      if (speed.free_flow_speed) {
-        directededge.set_free_flow_speed(speed.free_flow_speed);
+      if (speed->free_flow_speed) {
+        directededge.set_free_flow_speed(speed->free_flow_speed);
       }
-      if (speed.coefficients.size() == kCoefficientCount) {
-        tile_builder.AddPredictedSpeed(j, speed.coefficients, pred_count);
+      if (speed->has_coefficients) {
+        tile_builder.AddPredictedSpeed(j,
+                                       std::vector<int16_t>(speed->coefficients,
+                                                            speed->coefficients + kCoefficientCount),
+                                       pred_count);
         directededge.set_has_predicted_speed(true);
       }
       ++stat.updated_count;
+      ++speed;
     }
 
     // Add the directed edge to the local list
     directededges.emplace_back(std::move(directededge));
   }
 
-  // Write the new tile with updated directed edges and the predicted speeds
-  tile_builder.UpdatePredictedSpeeds(directededges);
+  // Without speed profiles only the directed edges change, with them the profiles are appended
+  if (pred_count == 0) {
+    patch_directed_edges(tile_path, *tile_builder.header(), directededges);
+  } else {
+    tile_builder.UpdatePredictedSpeeds(directededges);
+  }
 }
 
 /**
- * Read both the constrained and freeflow speed CSV files
- * We expect the files to be named as <quadtreeID>.constrained.csv and
- * <quadtreeID>.freeflow.csv. (e.g., 1202021.constrained.csv and 1202021.freeflow.csv)
+ * Update the tiles with their sorted rows of speeds until the queue has no more tiles.
  */
-void update_tiles(
-    const std::string& tile_dir,
-    std::vector<std::pair<GraphId, std::vector<std::string>>>::const_iterator tile_start,
-    std::vector<std::pair<GraphId, std::vector<std::string>>>::const_iterator tile_end,
-    std::promise<stats>& result) {
-
-  std::stringstream thread_name;
-  thread_name << std::this_thread::get_id();
-
-  // Iterate through the tiles and parse them
-  size_t total = tile_end - tile_start;
-  double count = 0;
+void update_tiles(const std::string& tile_dir,
+                  vj::TileQueue& queue,
+                  const std::unordered_map<GraphId, std::pair<size_t, size_t>>& ranges,
+                  vm::sequence<TrafficSpeeds>& records,
+                  std::promise<stats>& result) {
   stats stat{};
-  for (; tile_start != tile_end; ++tile_start) {
-    LOG_INFO(thread_name.str() + " parsing traffic data for " + std::to_string(tile_start->first));
-    auto traffic = ParseTrafficFile(tile_start->second, stat);
-    LOG_INFO(thread_name.str() + " add traffic data to " + std::to_string(tile_start->first));
-    update_tile(tile_dir, tile_start->first, traffic, stat);
-    LOG_INFO(thread_name.str() + " finished " + std::to_string(tile_start->first) + "(" +
-             std::to_string(++count / total * 100.0) + ")");
+  GraphId tile_id;
+  while (queue.next(tile_id)) {
+    const auto& range = ranges.at(tile_id);
+    update_tile(tile_dir, tile_id, records, range.first, range.second, stat);
   }
-
   result.set_value(stat);
 }
 
@@ -244,13 +333,16 @@ int main(int argc, char** argv) {
   std::string inline_config;
   std::string config_file_path;
   unsigned int num_threads = std::thread::hardware_concurrency();
+  size_t memory = 1024;
   bool summary = false;
 
   bpo::options_description options("valhalla_add_predicted_traffic " VALHALLA_VERSION "\n"
                                    "\n"
                                    " Usage: valhalla_add_predicted_traffic [options]\n"
                                    "\n"
-                                   "adds predicted traffic to valhalla tiles. "
+                                   "adds predicted traffic to valhalla tiles. The rows of the csvs "
+                                   "in the traffic tile dir are parsed in parallel, grouped by "
+                                   "tile on disk and then added to the tiles they belong to."
                                    "\n"
                                    "\n");
 
@@ -261,7 +353,9 @@ int main(int argc, char** argv) {
                                    boost::program_options::value<std::string>(&config_file_path),
                                    "Path to the json configuration file.")(
       "inline-config,i", boost::program_options::value<std::string>(&inline_config),
-      "Inline json config.")("summary,s", bpo::value<bool>(&summary),
+      "Inline json config.")("memory,m", bpo::value<size_t>(&memory),
+                             "How many megabytes of speeds to sort in memory at once, defaults to "
+                             "1024.")("summary,s", bpo::value<bool>(&summary),
                              "Output summary information about traffic coverage for the tile set")
       // positional arguments
       ("traffic-tile-dir,t", bpo::value<std::string>(&traffic_tile_dir),
@@ -295,25 +389,13 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
-  // queue up all the work we'll be doing
-  std::unordered_map<GraphId, std::vector<std::string>> files_per_tile;
+  // the speed csvs, which rows go to which tile is up to their edge ids
+  std::map<std::string, uint64_t> file_sizes;
   for (filesystem::recursive_directory_iterator i(traffic_tile_dir), end; i != end; ++i) {
     if (i->is_regular_file()) {
-      // remove any extension
-      auto file_name = i->path().string();
-      auto pos = file_name.rfind(filesystem::path::preferred_separator);
-      file_name = file_name.substr(0, file_name.find('.', pos == std::string::npos ? 0 : pos));
-      try {
-        // parse it into a tile id and store the file path with it
-        auto id = GraphTile::GetTileId(file_name);
-        files_per_tile[id].push_back(i->path().string());
-      } catch (...) {}
+      file_sizes.emplace(i->path().string(), i->file_size());
     }
   }
-  std::vector<std::pair<GraphId, std::vector<std::string>>> traffic_tiles(files_per_tile.begin(),
-                                                                          files_per_tile.end());
-  std::random_device rd;
-  std::shuffle(traffic_tiles.begin(), traffic_tiles.end(), std::mt19937(rd()));
 
   // Read the config file
   boost::property_tree::ptree pt;
@@ -339,46 +421,89 @@ int main(int argc, char** argv) {
   }
 
   LOG_INFO("Adding predicted traffic with " + std::to_string(num_threads) + " threads");
-  std::vector<std::shared_ptr<std::thread>> threads(num_threads);
-
-  LOG_INFO("Parsing speeds from " + std::to_string(traffic_tiles.size()) + " tiles.");
-  size_t floor = traffic_tiles.size() / threads.size();
-  size_t at_ceiling = traffic_tiles.size() - (threads.size() * floor);
-  decltype(traffic_tiles)::const_iterator tile_start, tile_end = traffic_tiles.begin();
+  std::vector<std::shared_ptr<std::thread>> threads(std::max(num_threads, 1u));
   auto tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  const auto records_file =
+      tile_dir + filesystem::path::preferred_separator + "predicted_speeds.bin";
+  const size_t buffer_size = memory * 1024 * 1024 / sizeof(TrafficSpeeds);
   // A place to hold the results of those threads (exceptions, stats)
   std::list<std::promise<stats>> results;
-  // Atomically pass around stats info
-  for (size_t i = 0; i < threads.size(); ++i) {
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    tile_end += (i < at_ceiling ? floor + 1 : floor);
-    // Make the thread
-    results.emplace_back();
-    threads[i].reset(
-        new std::thread(update_tiles, tile_dir, tile_start, tile_end, std::ref(results.back())));
-  }
-
-  // wait for it to finish
-  for (auto& thread : threads)
-    thread->join();
-
-  // collect some stats
-  uint32_t constrained_count = 0, free_flow_count = 0, compressed_count = 0, updated_count = 0,
-           duplicate_count = 0;
-  for (auto& result : results) {
-    try {
-      auto thread_stats = result.get_future().get();
-      constrained_count += thread_stats.constrained_count;
-      free_flow_count += thread_stats.free_flow_count;
-      compressed_count += thread_stats.compressed_count;
-      updated_count += thread_stats.updated_count;
-      duplicate_count += thread_stats.dup_count;
-    } catch (std::exception& e) {
-      // TODO: throw further up the chain?
+  stats stat{};
+  auto collect = [&results, &stat]() {
+    for (auto& result : results) {
+      try {
+        stat(result.get_future().get());
+      } catch (std::exception& e) {
+        // TODO: throw further up the chain?
+      }
+    }
+    results.clear();
+  };
+
+  {
+    // cut the files into chunks which the threads parse into one sequence of rows
+    std::vector<std::string> files;
+    std::vector<chunk_t> chunks;
+    for (const auto& file : file_sizes) {
+      const uint32_t i = files.size();
+      const uint64_t size = file.second;
+      files.push_back(file.first);
+      for (uint64_t begin = 0; begin < size; begin += kChunkSize) {
+        chunks.push_back({i, begin, std::min(begin + kChunkSize, size)});
+      }
+    }
+    LOG_INFO("Parsing speeds from " + std::to_string(files.size()) + " files in " +
+             std::to_string(chunks.size()) + " chunks.");
+    vm::sequence<TrafficSpeeds> records(records_file, true,
+                                        std::min(buffer_size / 4, size_t(1024 * 1024 * 32) /
+                                                                      sizeof(TrafficSpeeds)));
+    std::atomic<size_t> next_chunk(0);
+    std::mutex lock;
+    for (auto& thread : threads) {
+      results.emplace_back();
+      thread.reset(new std::thread(parse_chunks, std::cref(files), std::cref(chunks),
+                                   std::ref(next_chunk), std::ref(records), std::ref(lock),
+                                   std::ref(results.back())));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    collect();
+
+    // group the rows by tile and edge, on disk so that no more than the budget is in memory
+    LOG_INFO("Sorting " + std::to_string(records.size()) + " speeds.");
+    records.sort(std::less<TrafficSpeeds>(), buffer_size, threads.size());
+
+    // the threads take the tiles with the most rows first
+    std::unordered_map<GraphId, std::pair<size_t, size_t>> ranges;
+    std::vector<std::pair<GraphId, uint64_t>> tiles;
+    for (size_t i = 0; i < records.size(); ++i) {
+      auto tile_id = GraphId(static_cast<TrafficSpeeds>(records[i]).edge_id).Tile_Base();
+      auto inserted = ranges.emplace(tile_id, std::make_pair(i, i));
+      if (inserted.second) {
+        tiles.emplace_back(tile_id, 0);
+      }
+      ++inserted.first->second.second;
+      ++tiles.back().second;
+    }
+    LOG_INFO("Adding speeds to " + std::to_string(tiles.size()) + " tiles.");
+    vj::TileQueue queue(std::move(tiles));
+    for (auto& thread : threads) {
+      results.emplace_back();
+      thread.reset(new std::thread(update_tiles, std::cref(tile_dir), std::ref(queue),
+                                   std::cref(ranges), std::ref(records),
+                                   std::ref(results.back())));
+    }
+    for (auto& thread : threads) {
+      thread->join();
     }
+    collect();
+    queue.LogUtilization("Adding predicted traffic");
   }
+  filesystem::remove(records_file);
+  const auto constrained_count = stat.constrained_count, free_flow_count = stat.free_flow_count,
+             compressed_count = stat.compressed_count, updated_count = stat.updated_count,
+             duplicate_count = stat.dup_count;
 
   LOG_INFO("Parsed " + std::to_string(constrained_count) + " constrained traffic speeds.");
   LOG_INFO("Parsed " + std::to_string(free_flow_count) + " free flow traffic speeds.");
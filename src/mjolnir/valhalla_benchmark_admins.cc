@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cinttypes>
 #include <cstdint>
 #include <future>
@@ -37,6 +38,7 @@
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/util.h"
+#include "mjolnir/admin.h"
 #include "mjolnir/util.h"
 
 // sqlite is included in util.h and must be before spatialite
@@ -46,19 +48,17 @@ namespace bpo = boost::program_options;
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
 
-// Geometry types for admin queries
-typedef boost::geometry::model::d2::point_xy<double> point_type;
-typedef boost::geometry::model::polygon<point_type> polygon_type;
-typedef boost::geometry::model::multi_polygon<polygon_type> multi_polygon_type;
+using valhalla::mjolnir::multi_polygon_type;
+using valhalla::mjolnir::PolygonGrid;
 
 filesystem::path config_file_path;
 
-std::unordered_map<uint32_t, multi_polygon_type>
+std::unordered_multimap<uint32_t, multi_polygon_type>
 GetAdminInfo(sqlite3* db_handle,
              std::unordered_map<uint32_t, bool>& drive_on_right,
              const AABB2<PointLL>& aabb) {
   // Polys (return)
-  std::unordered_map<uint32_t, multi_polygon_type> polys;
+  std::unordered_multimap<uint32_t, multi_polygon_type> polys;
 
   // Form query
   std::string sql = "SELECT state.rowid, country.name, state.name, country.iso_code, ";
@@ -186,9 +186,12 @@ void Benchmark(const boost::property_tree::ptree& pt) {
   auto local_level = TileHierarchy::levels().back().level;
   auto tiles = TileHierarchy::levels().back().tiles;
 
-  // Iterate through the tiles and perform enhancements
-  std::unordered_map<uint32_t, multi_polygon_type> polys;
+  // Iterate through the tiles and find the admin of every node, both by testing every polygon and
+  // with the grid of the polygons
+  std::unordered_multimap<uint32_t, multi_polygon_type> polys;
   std::unordered_map<uint32_t, bool> drive_on_right;
+  std::chrono::nanoseconds exact_time{0}, grid_time{0};
+  size_t node_count = 0, mismatches = 0, partial_cells = 0, cell_count = 0;
   for (uint32_t id = 0; id < tiles.TileCount(); id++) {
     // Get the admin polys if there is data for tiles that exist
     GraphId tile_id(id, local_level, 0);
@@ -198,6 +201,36 @@ void Benchmark(const boost::property_tree::ptree& pt) {
       if (polys.size() < 128) {
         counts[polys.size()]++;
       }
+      if (polys.empty()) {
+        continue;
+      }
+
+      auto tile = reader.GetGraphTile(tile_id);
+      std::vector<PointLL> lls;
+      for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+        lls.push_back(tile->node(i)->latlng(tile->header()->base_ll()));
+      }
+      std::vector<uint32_t> exact(lls.size()), gridded(lls.size());
+
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < lls.size(); ++i) {
+        exact[i] = valhalla::mjolnir::GetMultiPolyId(polys, lls[i]);
+      }
+      auto middle = std::chrono::steady_clock::now();
+      PolygonGrid grid(polys, tiles.TileBounds(id));
+      for (size_t i = 0; i < lls.size(); ++i) {
+        gridded[i] = valhalla::mjolnir::GetMultiPolyId(grid, lls[i]);
+      }
+      auto end = std::chrono::steady_clock::now();
+
+      exact_time += middle - start;
+      grid_time += end - middle;
+      node_count += lls.size();
+      partial_cells += grid.partial_cells();
+      cell_count += PolygonGrid::kDefaultDivisions * PolygonGrid::kDefaultDivisions;
+      for (size_t i = 0; i < lls.size(); ++i) {
+        mismatches += exact[i] != gridded[i];
+      }
     }
   }
   for (uint32_t i = 0; i < 128; i++) {
@@ -205,6 +238,17 @@ void Benchmark(const boost::property_tree::ptree& pt) {
       LOG_INFO("Tiles with " + std::to_string(i) + " admin polys: " + std::to_string(counts[i]));
     }
   }
+
+  auto msecs = [](const std::chrono::nanoseconds& time) {
+    return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(time).count());
+  };
+  LOG_INFO("Admins of " + std::to_string(node_count) + " nodes by every polygon: " +
+           msecs(exact_time) + " ms, by the grid: " + msecs(grid_time) + " ms (" +
+           std::to_string(grid_time.count() ? double(exact_time.count()) / grid_time.count() : 0.) +
+           "x)");
+  LOG_INFO("Cells with a boundary: " + std::to_string(partial_cells) + " of " +
+           std::to_string(cell_count) + ", nodes whose admin differs: " +
+           std::to_string(mismatches));
 }
 
 bool ParseArguments(int argc, char* argv[]) {
@@ -4,6 +4,7 @@
 
 #include "baldr/graphconstants.h"
 #include "filesystem.h"
+#include "mjolnir/admin.h"
 #include "mjolnir/adminconstants.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/pbfadminparser.h"
@@ -57,6 +58,7 @@ using namespace valhalla::midgard;
 
 filesystem::path config_file_path;
 std::vector<std::string> input_files;
+bool pack_timezones = false;
 
 bool ParseArguments(int argc, char* argv[]) {
 
@@ -75,7 +77,10 @@ bool ParseArguments(int argc, char* argv[]) {
   options.add_options()("help,h", "Print this help message.")("version,v",
                                                               "Print the version of this software.")(
       "config,c", boost::program_options::value<filesystem::path>(&config_file_path)->required(),
-      "Path to the json configuration file.")
+      "Path to the json configuration file.")(
+      "timezones,t", bpo::bool_switch(&pack_timezones),
+      "Also pack the time zones of the mjolnir.timezone db, like the admins are packed next to "
+      "the mjolnir.admin db, so that the graph builder doesnt need to query the db for them.")
       // positional arguments
       ("input_files",
        boost::program_options::value<std::vector<std::string>>(&input_files)->multitoken());
@@ -689,11 +694,36 @@ void BuildAdminFromPBF(const boost::property_tree::ptree& pt,
     return;
   }
 
+  // pack the admins for the graph builder which reads them from any number of threads
+  try {
+    auto count = PackAdmins(db_handle, PackedPolygonsFile(*database));
+    LOG_INFO("Packed " + std::to_string(count) + " admins into " + PackedPolygonsFile(*database));
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+  }
+
   sqlite3_close(db_handle);
 
   LOG_INFO("Finished.");
 }
 
+void PackTimeZoneDB(const boost::property_tree::ptree& pt) {
+  auto database = pt.get_optional<std::string>("timezone");
+  sqlite3* db_handle = database ? GetDBHandle(*database) : nullptr;
+  if (!db_handle) {
+    LOG_ERROR("Time zone db not found. Time zones will not be packed.");
+    return;
+  }
+  try {
+    auto count = PackTimeZones(db_handle, PackedPolygonsFile(*database));
+    LOG_INFO("Packed " + std::to_string(count) + " time zones into " +
+             PackedPolygonsFile(*database));
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+  }
+  sqlite3_close(db_handle);
+}
+
 int main(int argc, char** argv) {
 
   if (!ParseArguments(argc, argv)) {
@@ -714,7 +744,13 @@ int main(int argc, char** argv) {
     valhalla::midgard::logging::Configure(logging_config);
   }
 
-  BuildAdminFromPBF(pt.get_child("mjolnir"), input_files);
+  // only packing the time zones needs no osm data
+  if (!input_files.empty() || !pack_timezones) {
+    BuildAdminFromPBF(pt.get_child("mjolnir"), input_files);
+  }
+  if (pack_timezones) {
+    PackTimeZoneDB(pt.get_child("mjolnir"));
+  }
 
   return EXIT_SUCCESS;
 }
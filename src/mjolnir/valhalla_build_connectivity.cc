@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "baldr/connectivity_map.h"
+#include "baldr/graphconstants.h"
 #include "baldr/tilehierarchy.h"
 #include "config.h"
 #include "filesystem.h"
@@ -17,12 +18,24 @@ using namespace valhalla::baldr;
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <ostream>
+#include <unordered_map>
 
 namespace bpo = boost::program_options;
 using namespace valhalla::midgard;
 
 filesystem::path config_file_path;
 std::vector<std::string> input_files;
+bool write_map = false;
+std::vector<std::string> access_modes;
+
+// The access of the costings the components of the map can be written for
+const std::unordered_map<std::string, uint32_t> kAccessModes{
+    {"auto", kAutoAccess},           {"pedestrian", kPedestrianAccess},
+    {"bicycle", kBicycleAccess},     {"truck", kTruckAccess},
+    {"bus", kBusAccess},             {"taxi", kTaxiAccess},
+    {"hov", kHOVAccess},             {"wheelchair", kWheelchairAccess},
+    {"motor_scooter", kMopedAccess}, {"motorcycle", kMotorcycleAccess},
+};
 
 struct PPMObject {
   std::string magic_num;
@@ -45,7 +58,14 @@ bool ParseArguments(int argc, char* argv[]) {
   options.add_options()("help,h", "Print this help message.")("version,v",
                                                               "Print the version of this software.")(
       "config,c", boost::program_options::value<filesystem::path>(&config_file_path)->required(),
-      "Path to the json configuration file.")
+      "Path to the json configuration file.")(
+      "write,w", bpo::bool_switch(&write_map),
+      "Write the connectivity map into the tile_dir for loki to map rather than compute, instead "
+      "of the images.")(
+      "access-modes,a", bpo::value<std::vector<std::string>>(&access_modes)->multitoken(),
+      "The costings to write the components of the edges they can use for, any of auto, "
+      "pedestrian, bicycle, truck, bus, taxi, hov, wheelchair, motor_scooter and motorcycle. "
+      "Defaults to auto, pedestrian and bicycle.")
       // positional arguments
       ("input_files",
        boost::program_options::value<std::vector<std::string>>(&input_files)->multitoken());
@@ -113,6 +133,26 @@ int main(int argc, char** argv) {
   boost::property_tree::ptree pt;
   rapidjson::read_json(config_file_path.string(), pt);
 
+  // Write the map for the services instead
+  if (write_map) {
+    if (access_modes.empty()) {
+      access_modes = {"auto", "pedestrian", "bicycle"};
+    }
+    std::vector<uint32_t> modes;
+    for (const auto& name : access_modes) {
+      auto mode = kAccessModes.find(name);
+      if (mode == kAccessModes.cend()) {
+        std::cerr << "Unknown access mode: " << name << std::endl;
+        return EXIT_FAILURE;
+      }
+      modes.push_back(mode->second);
+    }
+    const auto& mjolnir = pt.get_child("mjolnir");
+    connectivity_map_t::Write(connectivity_map_t::FileName(mjolnir.get<std::string>("tile_dir")),
+                              mjolnir, modes);
+    return EXIT_SUCCESS;
+  }
+
   // Get something we can use to fetch tiles
   valhalla::baldr::connectivity_map_t connectivity_map(pt.get_child("mjolnir"));
 
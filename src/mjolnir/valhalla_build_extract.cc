@@ -0,0 +1,91 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "baldr/rapidjson_utils.h"
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/util.h"
+#include "mjolnir/util.h"
+
+namespace bpo = boost::program_options;
+
+int main(int argc, char** argv) {
+  // Program options
+  std::string config_file_path;
+  std::string inline_config;
+  size_t alignment = 4096;
+  bpo::options_description options(
+      "valhalla_build_extract " VALHALLA_VERSION "\n\n"
+      "Usage: valhalla_build_extract [options]\n\n"
+      "valhalla_build_extract packs the tiles of the mjolnir.tile_dir into a tar at the "
+      "mjolnir.tile_extract. Every tile starts on a page of its own and the tar begins with an "
+      "index of the tiles so that it loads without reading the whole archive.\n\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "config,c", boost::program_options::value<std::string>(&config_file_path),
+      "Path to the json configuration file.")("inline-config,i",
+                                              boost::program_options::value<std::string>(
+                                                  &inline_config),
+                                              "Inline json config.")(
+      "alignment,a", boost::program_options::value<size_t>(&alignment),
+      "The data of every tile starts at a multiple of this many bytes, a multiple of 512. Defaults "
+      "to 4096, the size of a page.");
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // Print out help or version and return
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+  if (vm.count("version")) {
+    std::cout << "valhalla_build_extract " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  // Read the config file
+  boost::property_tree::ptree pt;
+  if (vm.count("inline-config")) {
+    std::stringstream ss;
+    ss << inline_config;
+    rapidjson::read_json(ss, pt);
+  } else if (vm.count("config") && filesystem::is_regular_file(config_file_path)) {
+    rapidjson::read_json(config_file_path, pt);
+  } else {
+    std::cerr << "Configuration is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree =
+      pt.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  try {
+    valhalla::mjolnir::build_tile_extract(pt, alignment);
+  } catch (const std::exception& e) {
+    std::cerr << "Unable to build the tile extract because: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -2,6 +2,7 @@
 #include <vector>
 
 #include "config.h"
+#include "mjolnir/tilequeue.h"
 #include "mjolnir/util.h"
 
 using namespace valhalla::mjolnir;
@@ -12,6 +13,7 @@ using namespace valhalla::mjolnir;
 #include <boost/property_tree/ptree.hpp>
 #include <iostream>
 
+#include "baldr/graphtile.h"
 #include "filesystem.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
@@ -33,6 +35,8 @@ int main(int argc, char** argv) {
   std::string inline_config;
   std::string start_stage_str = "initialize";
   std::string end_stage_str = "cleanup";
+  std::string changes_file;
+  std::string shard;
   std::vector<std::string> input_files;
   bpo::options_description options(
       "valhalla_build_tiles " VALHALLA_VERSION "\n\n"
@@ -51,7 +55,14 @@ int main(int argc, char** argv) {
       "Starting stage of the build pipeline")("end,e",
                                               boost::program_options::value<std::string>(
                                                   &end_stage_str),
-                                              "End stage of the build pipeline")
+                                              "End stage of the build pipeline")(
+      "affected-tiles,a", boost::program_options::value<std::string>(&changes_file),
+      "Prints the tiles an osm change file (.osc) affects, one path per line, and exits. Needs the "
+      "ways.bin and way_nodes.bin of the last build, which must have ended before cleanup.")(
+      "shard", boost::program_options::value<std::string>(&shard),
+      "Works on one part of the tiles, written as index/count, so that the build, enhance and "
+      "elevation stages can be split over several machines sharing the tile_dir. Every shard has "
+      "to finish a stage before any of them starts the next.")
 
       // positional arguments
       ("input_files",
@@ -104,6 +115,31 @@ int main(int argc, char** argv) {
     valhalla::midgard::logging::Configure(logging_config);
   }
 
+  // Work out what would need rebuilding for some changes
+  if (vm.count("affected-tiles")) {
+    try {
+      for (const auto& tile_id : affected_tiles(pt, changes_file)) {
+        std::cout << valhalla::baldr::GraphTile::FileSuffix(tile_id) << std::endl;
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Unable to work out the affected tiles because: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  // Only work on some of the tiles
+  if (vm.count("shard")) {
+    try {
+      auto tile_shard = TileShard::FromString(shard);
+      pt.put("mjolnir.shard.index", tile_shard.index);
+      pt.put("mjolnir.shard.count", tile_shard.count);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   // Convert stage strings to BuildStage
   BuildStage start_stage = string_to_buildstage(start_stage_str);
   if (start_stage == BuildStage::kInvalid) {
@@ -137,9 +173,12 @@ int main(int argc, char** argv) {
   // must only use the tile_dir
   pt.get_child("mjolnir").erase("tile_extract");
   pt.get_child("mjolnir").erase("tile_url");
-  if (build_tile_set(pt, input_files, start_stage, end_stage)) {
-    return EXIT_SUCCESS;
-  } else {
-    return EXIT_FAILURE;
+  try {
+    if (build_tile_set(pt, input_files, start_stage, end_stage)) {
+      return EXIT_SUCCESS;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Unable to build the tiles because: " << e.what() << std::endl;
   }
+  return EXIT_FAILURE;
 }
@@ -11,6 +11,8 @@
 #include <thread>
 #include <unordered_set>
 
+#include <sys/stat.h>
+
 #include "baldr/rapidjson_utils.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
@@ -32,6 +34,7 @@
 #include "mjolnir/admin.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/servicedays.h"
+#include "mjolnir/tilequeue.h"
 #include "mjolnir/transitpbf.h"
 #include "mjolnir/validatetransit.h"
 
@@ -55,7 +58,90 @@ struct builder_stats {
   }
 };
 
-// Get scheduled departures for a stop
+// The service of a stop pair, the stop pairs of a feed share a handful of these
+struct service_t {
+  uint32_t start_date;
+  uint32_t end_date;
+  uint32_t dow_mask;
+  std::vector<uint32_t> except_dates;
+  std::vector<uint32_t> added_dates;
+
+  bool operator==(const service_t& other) const {
+    return start_date == other.start_date && end_date == other.end_date &&
+           dow_mask == other.dow_mask && except_dates == other.except_dates &&
+           added_dates == other.added_dates;
+  }
+};
+
+struct service_hash {
+  size_t operator()(const service_t& service) const {
+    size_t seed = service.start_date;
+    hash_combine(seed, service.end_date);
+    hash_combine(seed, service.dow_mask);
+    for (auto date : service.except_dates) {
+      hash_combine(seed, date);
+    }
+    hash_combine(seed, service.added_dates.size());
+    for (auto date : service.added_dates) {
+      hash_combine(seed, date);
+    }
+    return seed;
+  }
+};
+
+// The days a service runs on counted from the creation date of the tile
+struct service_days_t {
+  bool rejected;
+  uint64_t days;
+  uint32_t dow_mask;
+  uint32_t end_day;
+};
+
+// Works out the days of a service relative to the tile date
+service_days_t GetServiceDays(const service_t& service, const uint32_t tile_date) {
+  // Compute the valid days
+  // set the bits based on the dow.
+  auto d = date::floor<date::days>(DateTime::pivot_date_);
+  date::sys_days start_date =
+      date::sys_days(date::year_month_day(d + date::days(service.start_date)));
+  date::sys_days end_date = date::sys_days(date::year_month_day(d + date::days(service.end_date)));
+
+  service_days_t result{};
+  result.days = get_service_days(start_date, end_date, tile_date, service.dow_mask);
+
+  // if this is a service addition for one day, delete the dow_mask.
+  result.dow_mask = service.start_date == service.end_date ? kDOWNone : service.dow_mask;
+
+  // if dep.days == 0 then feed either starts after the end_date or tile_header_date >
+  // end_date
+  if (result.days == 0 && service.added_dates.empty()) {
+    LOG_DEBUG("Feed rejected!  Start date: " + to_iso_extended_string(start_date) +
+              " End date: " + to_iso_extended_string(end_date));
+    result.rejected = true;
+    return result;
+  }
+
+  date::sys_days t_d = date::sys_days(date::year_month_day(d + date::days(tile_date)));
+  result.end_day = std::min(static_cast<uint32_t>((end_date - t_d).count()),
+                            static_cast<uint32_t>(kScheduleEndDay));
+
+  // if subtractions are between start and end date then turn off bit.
+  for (const auto& x : service.except_dates) {
+    date::sys_days rm_date = date::sys_days(date::year_month_day(d + date::days(x)));
+    result.days = remove_service_day(result.days, end_date, tile_date, rm_date);
+  }
+
+  // if additions are between start and end date then turn on bit.
+  for (const auto& x : service.added_dates) {
+    date::sys_days add_date = date::sys_days(date::year_month_day(d + date::days(x)));
+    result.days = add_service_day(result.days, end_date, tile_date, add_date);
+  }
+  return result;
+}
+
+// Get scheduled departures for a stop. The stop pairs of a tile are in its pbf and in as many
+// more pbfs with the same name and a .0, .1, ... extension as it took to fetch them, which are
+// read one at a time
 std::unordered_multimap<GraphId, Departure>
 ProcessStopPairs(GraphTileBuilder& transit_tilebuilder,
                  const uint32_t tile_date,
@@ -71,161 +157,162 @@ ProcessStopPairs(GraphTileBuilder& transit_tilebuilder,
   uint32_t schedule_index = 0;
   std::map<TransitSchedule, uint32_t> schedules;
 
-  std::size_t slash_found = file.find_last_of("/\\");
-  std::string directory = file.substr(0, slash_found);
-
-  filesystem::recursive_directory_iterator transit_file_itr(directory);
-  filesystem::recursive_directory_iterator end_file_itr;
-
-  // for each tile.
-  for (; transit_file_itr != end_file_itr; ++transit_file_itr) {
-    if (filesystem::is_regular_file(transit_file_itr->path())) {
-      std::string fname = transit_file_itr->path().string();
-      std::string ext = transit_file_itr->path().extension().string();
-      std::string file_name = fname.substr(0, fname.size() - ext.size());
-
-      // make sure we are looking at a pbf file
-      if ((ext == ".pbf" && fname == file) ||
-          (file_name.substr(file_name.size() - 4) == ".pbf" && file_name == file)) {
-
-        Transit spp;
-        {
-          // already loaded
-          if (ext == ".pbf") {
-            spp = transit;
-          } else {
-            spp = read_pbf(fname, lock);
-          }
-        }
-
-        if (spp.stop_pairs_size() == 0) {
-          if (transit.nodes_size() > 0) {
-            LOG_ERROR("Tile " + fname + " has 0 schedule stop pairs but has " +
-                      std::to_string(transit.nodes_size()) + " stops");
-          }
-          departures.clear();
-          return departures;
-        }
-
-        // Iterate through the stop pairs in this tile and form Valhalla departure
-        // records
-        for (const auto& sp : spp.stop_pairs()) {
-          // We do not know in this step if the end node is in a valid (non-empty)
-          // Valhalla tile. So just add the stop pair and we will address this later
-
-          // Use transit PBF graph Ids internally until adding to the graph tiles
-          // TODO - wheelchair accessible, shape information
-          Departure dep;
-          dep.orig_pbf_graphid = GraphId(sp.origin_graphid());
-          dep.dest_pbf_graphid = GraphId(sp.destination_graphid());
-          dep.route = sp.route_index();
-          dep.trip = sp.trip_id();
-
-          // if we have shape data then set everything else shapeid = 0;
-          if (sp.has_shape_id() && sp.has_destination_dist_traveled() &&
-              sp.has_origin_dist_traveled()) {
-            dep.shapeid = sp.shape_id();
-            dep.orig_dist_traveled = sp.origin_dist_traveled();
-            dep.dest_dist_traveled = sp.destination_dist_traveled();
-          } else {
-            dep.shapeid = 0;
-          }
-
-          dep.blockid = sp.has_block_id() ? sp.block_id() : 0;
-          dep.dep_time = sp.origin_departure_time();
-          dep.elapsed_time = sp.destination_arrival_time() - dep.dep_time;
-
-          dep.frequency_end_time = sp.has_frequency_end_time() ? sp.frequency_end_time() : 0;
-          dep.frequency = sp.has_frequency_headway_seconds() ? sp.frequency_headway_seconds() : 0;
-
-          if (!sp.bikes_allowed()) {
-            stop_access[dep.orig_pbf_graphid] |= kBicycleAccess;
-            stop_access[dep.dest_pbf_graphid] |= kBicycleAccess;
-          }
-
-          if (!sp.wheelchair_accessible()) {
-            stop_access[dep.orig_pbf_graphid] |= kWheelchairAccess;
-            stop_access[dep.dest_pbf_graphid] |= kWheelchairAccess;
-          }
-
-          dep.bicycle_accessible = sp.bikes_allowed();
-          dep.wheelchair_accessible = sp.wheelchair_accessible();
-
-          // Compute days of week mask
-          uint32_t dow_mask = kDOWNone;
-          for (uint32_t x = 0; x < sp.service_days_of_week_size(); x++) {
-            bool dow = sp.service_days_of_week(x);
-            if (dow) {
-              switch (x) {
-                case 0:
-                  dow_mask |= kMonday;
-                  break;
-                case 1:
-                  dow_mask |= kTuesday;
-                  break;
-                case 2:
-                  dow_mask |= kWednesday;
-                  break;
-                case 3:
-                  dow_mask |= kThursday;
-                  break;
-                case 4:
-                  dow_mask |= kFriday;
-                  break;
-                case 5:
-                  dow_mask |= kSaturday;
-                  break;
-                case 6:
-                  dow_mask |= kSunday;
-                  break;
-              }
-            }
-          }
-
-          // Compute the valid days
-          // set the bits based on the dow.
+  // The days of the services seen so far in this tile
+  std::unordered_map<service_t, service_days_t, service_hash> services;
+  service_t service;
+
+  Transit extension;
+  for (int ext = -1;; ++ext) {
+    std::string fname = file;
+    const Transit* spp = &transit;
+    if (ext >= 0) {
+      fname = file + "." + std::to_string(ext);
+      if (!filesystem::exists(fname)) {
+        break;
+      }
+      extension = read_pbf(fname, lock);
+      spp = &extension;
+    }
 
-          auto d = date::floor<date::days>(DateTime::pivot_date_);
-          date::sys_days start_date =
-              date::sys_days(date::year_month_day(d + date::days(sp.service_start_date())));
-          date::sys_days end_date =
-              date::sys_days(date::year_month_day(d + date::days(sp.service_end_date())));
+    if (spp->stop_pairs_size() == 0) {
+      if (transit.nodes_size() > 0) {
+        LOG_ERROR("Tile " + fname + " has 0 schedule stop pairs but has " +
+                  std::to_string(transit.nodes_size()) + " stops");
+      }
+      departures.clear();
+      return departures;
+    }
 
-          uint64_t days = get_service_days(start_date, end_date, tile_date, dow_mask);
+    // Iterate through the stop pairs in this tile and form Valhalla departure
+    // records
+    for (const auto& sp : spp->stop_pairs()) {
+      // We do not know in this step if the end node is in a valid (non-empty)
+      // Valhalla tile. So just add the stop pair and we will address this later
+
+      // Use transit PBF graph Ids internally until adding to the graph tiles
+      // TODO - wheelchair accessible, shape information
+      Departure dep;
+      dep.orig_pbf_graphid = GraphId(sp.origin_graphid());
+      dep.dest_pbf_graphid = GraphId(sp.destination_graphid());
+      dep.route = sp.route_index();
+      dep.trip = sp.trip_id();
+
+      // if we have shape data then set everything else shapeid = 0;
+      if (sp.has_shape_id() && sp.has_destination_dist_traveled() &&
+          sp.has_origin_dist_traveled()) {
+        dep.shapeid = sp.shape_id();
+        dep.orig_dist_traveled = sp.origin_dist_traveled();
+        dep.dest_dist_traveled = sp.destination_dist_traveled();
+      } else {
+        dep.shapeid = 0;
+      }
 
-          // if this is a service addition for one day, delete the dow_mask.
-          if (sp.service_start_date() == sp.service_end_date()) {
-            dow_mask = kDOWNone;
-          }
+      dep.blockid = sp.has_block_id() ? sp.block_id() : 0;
+      dep.dep_time = sp.origin_departure_time();
+      dep.elapsed_time = sp.destination_arrival_time() - dep.dep_time;
 
-          // if dep.days == 0 then feed either starts after the end_date or tile_header_date >
-          // end_date
-          if (days == 0 && !sp.service_added_dates_size()) {
-            LOG_DEBUG("Feed rejected!  Start date: " + to_iso_extended_string(start_date) +
-                      " End date: " + to_iso_extended_string(end_date));
-            continue;
-          }
+      dep.frequency_end_time = sp.has_frequency_end_time() ? sp.frequency_end_time() : 0;
+      dep.frequency = sp.has_frequency_headway_seconds() ? sp.frequency_headway_seconds() : 0;
 
-          dep.headsign_offset = transit_tilebuilder.AddName(sp.trip_headsign());
+      if (!sp.bikes_allowed()) {
+        stop_access[dep.orig_pbf_graphid] |= kBicycleAccess;
+        stop_access[dep.dest_pbf_graphid] |= kBicycleAccess;
+      }
 
-          date::sys_days t_d = date::sys_days(date::year_month_day(d + date::days(tile_date)));
-          uint32_t end_day = static_cast<uint32_t>((end_date - t_d).count());
+      if (!sp.wheelchair_accessible()) {
+        stop_access[dep.orig_pbf_graphid] |= kWheelchairAccess;
+        stop_access[dep.dest_pbf_graphid] |= kWheelchairAccess;
+      }
 
-          if (end_day > kScheduleEndDay) {
-            end_day = kScheduleEndDay;
+      dep.bicycle_accessible = sp.bikes_allowed();
+      dep.wheelchair_accessible = sp.wheelchair_accessible();
+
+      // Compute days of week mask
+      service.dow_mask = kDOWNone;
+      for (uint32_t x = 0; x < sp.service_days_of_week_size(); x++) {
+        bool dow = sp.service_days_of_week(x);
+        if (dow) {
+          switch (x) {
+            case 0:
+              service.dow_mask |= kMonday;
+              break;
+            case 1:
+              service.dow_mask |= kTuesday;
+              break;
+            case 2:
+              service.dow_mask |= kWednesday;
+              break;
+            case 3:
+              service.dow_mask |= kThursday;
+              break;
+            case 4:
+              service.dow_mask |= kFriday;
+              break;
+            case 5:
+              service.dow_mask |= kSaturday;
+              break;
+            case 6:
+              service.dow_mask |= kSunday;
+              break;
           }
+        }
+      }
 
-          // if subtractions are between start and end date then turn off bit.
-          for (const auto& x : sp.service_except_dates()) {
-            date::sys_days rm_date = date::sys_days(date::year_month_day(d + date::days(x)));
-            days = remove_service_day(days, end_date, tile_date, rm_date);
-          }
+      // Look up the days of the service, working them out the first time it is seen
+      service.start_date = sp.service_start_date();
+      service.end_date = sp.service_end_date();
+      service.except_dates.assign(sp.service_except_dates().begin(),
+                                  sp.service_except_dates().end());
+      service.added_dates.assign(sp.service_added_dates().begin(),
+                                 sp.service_added_dates().end());
+      auto found = services.find(service);
+      if (found == services.end()) {
+        found = services.emplace(service, GetServiceDays(service, tile_date)).first;
+      }
+      if (found->second.rejected) {
+        continue;
+      }
+      uint64_t days = found->second.days;
+      uint32_t dow_mask = found->second.dow_mask;
+      const uint32_t end_day = found->second.end_day;
+
+      dep.headsign_offset = transit_tilebuilder.AddName(sp.trip_headsign());
+
+      TransitSchedule sched(days, dow_mask, end_day);
+      auto sched_itr = schedules.find(sched);
+      if (sched_itr == schedules.end()) {
+        // Not in the map - add a new transit schedule to the tile
+        transit_tilebuilder.AddTransitSchedule(sched);
+
+        // Add to the map and increment the index
+        schedules[sched] = schedule_index;
+        dep.schedule_index = schedule_index;
+        schedule_index++;
+      } else {
+        dep.schedule_index = sched_itr->second;
+      }
 
-          // if additions are between start and end date then turn on bit.
-          for (const auto& x : sp.service_added_dates()) {
-            date::sys_days add_date = date::sys_days(date::year_month_day(d + date::days(x)));
-            days = add_service_day(days, end_date, tile_date, add_date);
-          }
+      // is this passed midnight?
+      // create a departure for before midnight and one after
+      uint32_t origin_seconds = sp.origin_departure_time();
+      if (origin_seconds >= kSecondsPerDay) {
+
+        // Add the current dep to the departures list
+        // and then update it with new dep time.  This
+        // dep will be used when the start time is after
+        // midnight.
+        stats.midnight_dep_count++;
+        departures.emplace(dep.orig_pbf_graphid, dep);
+        while (origin_seconds >= kSecondsPerDay) {
+          origin_seconds -= kSecondsPerDay;
+          // Then we need to fix the dow mask and dates
+          // The departure that was initially for every Friday   26h
+          // needs to be for                      every Saturday 02h
+          // If there was an exception on the Friday 11th of January,
+          // then we need an exception on the Saturday 12th of January instead
+          days = shift_service_day(days);
+          dow_mask =
+              ((dow_mask << 1) & kAllDaysOfWeek) | (dow_mask & kSaturday ? kSunday : kDOWNone);
 
           TransitSchedule sched(days, dow_mask, end_day);
           auto sched_itr = schedules.find(sched);
@@ -240,63 +327,25 @@ ProcessStopPairs(GraphTileBuilder& transit_tilebuilder,
           } else {
             dep.schedule_index = sched_itr->second;
           }
+        }
 
-          // is this passed midnight?
-          // create a departure for before midnight and one after
-          uint32_t origin_seconds = sp.origin_departure_time();
-          if (origin_seconds >= kSecondsPerDay) {
-
-            // Add the current dep to the departures list
-            // and then update it with new dep time.  This
-            // dep will be used when the start time is after
-            // midnight.
-            stats.midnight_dep_count++;
-            departures.emplace(dep.orig_pbf_graphid, dep);
-            while (origin_seconds >= kSecondsPerDay) {
-              origin_seconds -= kSecondsPerDay;
-              // Then we need to fix the dow mask and dates
-              // The departure that was initially for every Friday   26h
-              // needs to be for                      every Saturday 02h
-              // If there was an exception on the Friday 11th of January,
-              // then we need an exception on the Saturday 12th of January instead
-              days = shift_service_day(days);
-              dow_mask =
-                  ((dow_mask << 1) & kAllDaysOfWeek) | (dow_mask & kSaturday ? kSunday : kDOWNone);
-
-              TransitSchedule sched(days, dow_mask, end_day);
-              auto sched_itr = schedules.find(sched);
-              if (sched_itr == schedules.end()) {
-                // Not in the map - add a new transit schedule to the tile
-                transit_tilebuilder.AddTransitSchedule(sched);
-
-                // Add to the map and increment the index
-                schedules[sched] = schedule_index;
-                dep.schedule_index = schedule_index;
-                schedule_index++;
-              } else {
-                dep.schedule_index = sched_itr->second;
-              }
-            }
-
-            dep.dep_time = origin_seconds;
-            dep.frequency_end_time = 0;
-            dep.frequency = 0;
-            if (sp.has_frequency_end_time() && sp.has_frequency_headway_seconds()) {
-              uint32_t frequency_end_time = sp.frequency_end_time();
-              // adjust the end time if it is after midnight.
-              while (frequency_end_time >= kSecondsPerDay) {
-                frequency_end_time -= kSecondsPerDay;
-              }
-
-              dep.frequency_end_time = frequency_end_time;
-              dep.frequency = sp.frequency_headway_seconds();
-            }
+        dep.dep_time = origin_seconds;
+        dep.frequency_end_time = 0;
+        dep.frequency = 0;
+        if (sp.has_frequency_end_time() && sp.has_frequency_headway_seconds()) {
+          uint32_t frequency_end_time = sp.frequency_end_time();
+          // adjust the end time if it is after midnight.
+          while (frequency_end_time >= kSecondsPerDay) {
+            frequency_end_time -= kSecondsPerDay;
           }
-          // Add to the departures list
-          departures.emplace(dep.orig_pbf_graphid, std::move(dep));
-          stats.dep_count++;
+
+          dep.frequency_end_time = frequency_end_time;
+          dep.frequency = sp.frequency_headway_seconds();
         }
       }
+      // Add to the departures list
+      departures.emplace(dep.orig_pbf_graphid, std::move(dep));
+      stats.dep_count++;
     }
   }
   return departures;
@@ -960,8 +1009,7 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
 void build_tiles(const boost::property_tree::ptree& pt,
                  std::mutex& lock,
                  const std::unordered_set<GraphId>& all_tiles,
-                 std::unordered_set<GraphId>::const_iterator tile_start,
-                 std::unordered_set<GraphId>::const_iterator tile_end,
+                 TileQueue& tilequeue,
                  std::promise<builder_stats>& results) {
 
   builder_stats stats;
@@ -979,12 +1027,13 @@ void build_tiles(const boost::property_tree::ptree& pt,
 
   const auto& tiles = TileHierarchy::levels().back().tiles;
   // Iterate through the tiles in the queue and find any that include stops
-  for (; tile_start != tile_end; ++tile_start) {
+  GraphId next_tile;
+  while (tilequeue.next(next_tile)) {
     // Get the next tile Id from the queue and get a tile builder
     if (reader_transit_level.OverCommitted()) {
       reader_transit_level.Trim();
     }
-    GraphId tile_id = tile_start->Tile_Base();
+    GraphId tile_id = next_tile.Tile_Base();
 
     // Get transit pbf tile
     const std::string transit_dir = pt.get<std::string>("transit_dir");
@@ -996,7 +1045,7 @@ void build_tiles(const boost::property_tree::ptree& pt,
     // Make sure it exists
     if (!filesystem::exists(file)) {
       LOG_ERROR("File not found.  " + file);
-      return;
+      continue;
     }
 
     Transit transit = read_pbf(file, lock);
@@ -1203,31 +1252,42 @@ void build(const ptree& pt,
   // A place to hold the results of those threads (exceptions, stats)
   std::list<std::promise<builder_stats>> results;
 
-  // Start the threads, divvy up the work
+  // The threads take the next tile until there are none left, the biggest tiles go first and
+  // they weigh as much as their stop pairs which are most of what is in their pbfs
+  const auto transit_dir = pt.get<std::string>("mjolnir.transit_dir");
+  std::vector<std::pair<GraphId, uint64_t>> weighted_tiles;
+  weighted_tiles.reserve(all_tiles.size());
+  for (const auto& tile_id : all_tiles) {
+    auto file_name = GraphTile::FileSuffix(tile_id.Tile_Base());
+    file_name = transit_dir + filesystem::path::preferred_separator +
+                file_name.substr(0, file_name.size() - 4) + ".pbf";
+    uint64_t weight = 0;
+    for (int ext = -1;; ++ext) {
+      auto piece = ext < 0 ? file_name : file_name + "." + std::to_string(ext);
+      struct stat s;
+      if (stat(piece.c_str(), &s) != 0) {
+        break;
+      }
+      weight += s.st_size;
+    }
+    weighted_tiles.emplace_back(tile_id, weight);
+  }
+  TileQueue tilequeue(std::move(weighted_tiles));
+
+  // Start the threads
   LOG_INFO("Adding " + std::to_string(all_tiles.size()) + " transit tiles to the transit graph...");
-  size_t floor = all_tiles.size() / threads.size();
-  size_t at_ceiling = all_tiles.size() - (threads.size() * floor);
-  std::unordered_set<GraphId>::const_iterator tile_start, tile_end = all_tiles.begin();
-
-  // Atomically pass around stats info
-  for (size_t i = 0; i < threads.size(); ++i) {
-    // Figure out how many this thread will work on (either ceiling or floor)
-    size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    std::advance(tile_end, tile_count);
-    // Make the thread
+  for (auto& thread : threads) {
     results.emplace_back();
-    threads[i].reset(new std::thread(build_tiles, std::cref(pt.get_child("mjolnir")), std::ref(lock),
-                                     std::cref(all_tiles), tile_start, tile_end,
-                                     std::ref(results.back())));
+    thread.reset(new std::thread(build_tiles, std::cref(pt.get_child("mjolnir")), std::ref(lock),
+                                 std::cref(all_tiles), std::ref(tilequeue),
+                                 std::ref(results.back())));
   }
 
   // Wait for them to finish up their work
   for (auto& thread : threads) {
     thread->join();
   }
+  tilequeue.LogUtilization("Converting transit");
 
   // Check all of the outcomes, to see about maximum density (km/km2)
   builder_stats stats{};
@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "baldr/graphconstants.h"
+#include "config.h"
+#include "mjolnir/graphfilter.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+#include "baldr/rapidjson_utils.h"
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <iostream>
+
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/util.h"
+
+namespace bpo = boost::program_options;
+
+// The access of the costings an extract can be made for
+const std::unordered_map<std::string, uint32_t> kAccessModes{
+    {"auto", kAutoAccess},           {"pedestrian", kPedestrianAccess},
+    {"bicycle", kBicycleAccess},     {"truck", kTruckAccess},
+    {"bus", kBusAccess},             {"taxi", kTaxiAccess},
+    {"hov", kHOVAccess},             {"wheelchair", kWheelchairAccess},
+    {"motor_scooter", kMopedAccess}, {"motorcycle", kMotorcycleAccess},
+};
+
+int main(int argc, char** argv) {
+  // Program options
+  std::string config_file_path;
+  std::string inline_config;
+  std::string output_dir;
+  std::vector<std::string> costings;
+  bpo::options_description options(
+      "valhalla_filter_tiles " VALHALLA_VERSION "\n\n"
+      "Usage: valhalla_filter_tiles [options]\n\n"
+      "valhalla_filter_tiles is a program that writes a copy of built tiles with only the edges "
+      "some costings can use, dropping the nodes, names and signs only the other edges had and "
+      "all of transit, for services that only route with those costings.\n\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "config,c", boost::program_options::value<std::string>(&config_file_path),
+      "Path to the json configuration file.")("inline-config,i",
+                                              boost::program_options::value<std::string>(
+                                                  &inline_config),
+                                              "Inline json config.")(
+      "output,o", boost::program_options::value<std::string>(&output_dir),
+      "Directory to write the filtered tiles to, it must not have any tiles yet.")(
+      "costings,a",
+      boost::program_options::value<std::vector<std::string>>(&costings)->multitoken(),
+      "The costings to keep the edges of, any of auto, pedestrian, bicycle, truck, bus, taxi, hov, "
+      "wheelchair, motor_scooter and motorcycle.");
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
+    bpo::notify(vm);
+
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // Print out help or version and return
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+  if (vm.count("version")) {
+    std::cout << "valhalla_filter_tiles " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  // Read the config file
+  boost::property_tree::ptree pt;
+  if (vm.count("inline-config")) {
+    std::stringstream ss;
+    ss << inline_config;
+    rapidjson::read_json(ss, pt);
+  } else if (vm.count("config") && filesystem::is_regular_file(config_file_path)) {
+    rapidjson::read_json(config_file_path, pt);
+  } else {
+    std::cerr << "Configuration is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+
+  // Work out which edges to keep
+  if (costings.empty()) {
+    std::cerr << "At least one costing is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+  uint32_t access = 0;
+  for (const auto& name : costings) {
+    auto mode = kAccessModes.find(name);
+    if (mode == kAccessModes.cend()) {
+      std::cerr << "Unknown costing, transit and multimodal extracts are not supported: " << name
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    access |= mode->second;
+  }
+
+  // Dont mix the extract with tiles that are already there
+  if (output_dir.empty()) {
+    std::cerr << "An output directory is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (filesystem::exists(output_dir) && !filesystem::is_empty(output_dir)) {
+    std::cerr << "The output directory is not empty: " << output_dir << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree =
+      pt.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  GraphFilter::Extract(pt, output_dir, access);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+#include "baldr/graphid.h"
+#include "baldr/openlr.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/traffictile.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/util.h"
+#include "mjolnir/traffictilewriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "config.h"
+
+namespace vb = valhalla::baldr;
+namespace vj = valhalla::mjolnir;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+// Edges an OpenLR reference covers less than this much of dont get its speed
+constexpr float kMinOpenLrCoverage = .5f;
+
+// Whether the first column is an OpenLR reference rather than an edge id
+bool is_openlr(const std::string& edge) {
+  return std::any_of(edge.cbegin(), edge.cend(),
+                     [](const char c) { return !std::isdigit(c) && c != '/'; });
+}
+
+// An edge id either as level/tile/id or as its value
+vb::GraphId parse_edge(const std::string& edge) {
+  if (edge.find('/') != std::string::npos) {
+    return vb::GraphId(edge);
+  }
+  return vb::GraphId(std::stoull(edge));
+}
+
+// The speed of a whole edge, a negative speed clears what is known about it
+vb::TrafficSpeed parse_speed(const int speed, const uint32_t congestion) {
+  if (speed < 0) {
+    return vb::TrafficSpeed{};
+  }
+  const uint32_t raw = std::min<uint32_t>(speed, vb::MAX_TRAFFIC_SPEED_KPH) >> 1;
+  return vb::TrafficSpeed{raw,
+                          raw,
+                          vb::UNKNOWN_TRAFFIC_SPEED_RAW,
+                          vb::UNKNOWN_TRAFFIC_SPEED_RAW,
+                          255,
+                          0,
+                          std::min<uint32_t>(congestion, vb::MAX_CONGESTION_VAL),
+                          0,
+                          0,
+                          false};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::string config_file_path, inline_config, input;
+  size_t batch_size = 10000;
+  size_t concurrency = std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                                static_cast<size_t>(1));
+
+  bpo::options_description options(
+      "valhalla_traffic_writer " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_traffic_writer [options]\n"
+      "\n"
+      "valhalla_traffic_writer writes live speeds into the traffic extract the services have "
+      "mapped, without them having to reload it. Each line of the input is an edge id, either "
+      "level/tile/id or its value, its speed in kph and optionally its congestion from 1 to 63 "
+      "separated by commas. In place of the edge id there can be a base64 OpenLR line location, "
+      "all of the edges it covers at least half of get its speed. Each reference is only matched "
+      "to the graph once. A negative speed clears the speed of the edge. The speeds are "
+      "written in batches, grouped by tile, whenever the batch is full, an empty line is read or "
+      "the input ends. Only one writer may run per traffic extract."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "config,c", bpo::value<std::string>(&config_file_path),
+      "Path to the json configuration file.")("inline-config,i",
+                                              bpo::value<std::string>(&inline_config),
+                                              "Inline json config.")(
+      "input,f", bpo::value<std::string>(&input),
+      "The file to read the speeds from, defaults to the standard input.")(
+      "batch-size,b", bpo::value<size_t>(&batch_size),
+      "How many speeds to write at once at most, defaults to 10000.")(
+      "concurrency,j", bpo::value<size_t>(&concurrency),
+      "Number of threads to match new OpenLR references with, defaults to the number of cores.");
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_traffic_writer " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  // Read the config file
+  boost::property_tree::ptree pt;
+  if (vm.count("inline-config")) {
+    std::stringstream ss;
+    ss << inline_config;
+    rapidjson::read_json(ss, pt);
+  } else if (vm.count("config") && filesystem::is_regular_file(config_file_path)) {
+    rapidjson::read_json(config_file_path, pt);
+  } else {
+    std::cerr << "Configuration is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree =
+      pt.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  // where the speeds go and where they come from
+  std::unique_ptr<vj::TrafficTileWriter> writer;
+  try {
+    writer.reset(new vj::TrafficTileWriter(pt.get<std::string>("mjolnir.traffic_extract")));
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+    return EXIT_FAILURE;
+  }
+  std::ifstream file;
+  if (!input.empty()) {
+    file.open(input);
+    if (!file) {
+      LOG_ERROR("Unable to open " + input);
+      return EXIT_FAILURE;
+    }
+  }
+  std::istream& in = input.empty() ? std::cin : file;
+
+  // write whatever we have so far
+  std::vector<vj::TrafficTileWriter::update_t> updates;
+  std::vector<std::pair<std::string, vb::TrafficSpeed>> references;
+  std::unordered_map<std::string, vb::OpenLR::MatchedPath> matched;
+  size_t written = 0, malformed = 0, unmatched = 0;
+  auto flush = [&]() {
+    // the references seen for the first time are matched all at once
+    std::vector<std::string> unknown;
+    for (const auto& reference : references) {
+      if (matched.find(reference.first) == matched.end()) {
+        unknown.push_back(reference.first);
+      }
+    }
+    if (!unknown.empty()) {
+      auto found = vb::OpenLR::Matcher::MatchAll(pt.get_child("mjolnir"), unknown, concurrency);
+      for (auto& path : found) {
+        unmatched += path.second.empty();
+        matched.emplace(path.first, std::move(path.second));
+      }
+    }
+    for (const auto& reference : references) {
+      for (const auto& edge : matched.find(reference.first)->second) {
+        if (edge.end_pct - edge.begin_pct >= kMinOpenLrCoverage) {
+          updates.emplace_back(edge.edge, reference.second);
+        }
+      }
+    }
+    references.clear();
+
+    if (updates.empty()) {
+      return;
+    }
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+    const auto count = updates.size();
+    const auto batch = writer->Write(std::move(updates), now);
+    written += batch;
+    LOG_DEBUG("Wrote " + std::to_string(batch) + " of " + std::to_string(count) + " speeds");
+    updates.clear();
+  };
+
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line == "\r") {
+      flush();
+      continue;
+    }
+    try {
+      std::istringstream row(line);
+      std::string edge, speed, congestion;
+      std::getline(row, edge, ',');
+      std::getline(row, speed, ',');
+      std::getline(row, congestion, ',');
+      auto traffic_speed =
+          parse_speed(std::stoi(speed), congestion.empty() ? 0 : std::stoul(congestion));
+      if (is_openlr(edge)) {
+        references.emplace_back(edge, traffic_speed);
+      } else {
+        updates.emplace_back(parse_edge(edge), traffic_speed);
+      }
+    } catch (...) {
+      ++malformed;
+      continue;
+    }
+    if (updates.size() + references.size() >= batch_size) {
+      flush();
+    }
+  }
+  flush();
+
+  LOG_INFO("Wrote " + std::to_string(written) + " speeds, skipped " + std::to_string(malformed) +
+           " malformed lines, " + std::to_string(unmatched) + " OpenLR references didnt match");
+  return EXIT_SUCCESS;
+}
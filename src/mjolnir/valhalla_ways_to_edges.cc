@@ -1,7 +1,9 @@
+#include <atomic>
 #include <cstdint>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -19,6 +21,9 @@
 #include "baldr/graphtile.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+#include "midgard/util.h"
 
 namespace bpo = boost::program_options;
 
@@ -28,14 +33,53 @@ using namespace valhalla::midgard;
 filesystem::path config_file_path;
 std::vector<std::string> input_files;
 
-// Structure holding an edge Id and forward flag
-struct EdgeAndDirection {
-  bool forward;
-  GraphId edgeid;
+// A directed edge of an OSM way. This is also the record of the binary output, way_edges.bin, a
+// flat array of these 16 byte records sorted by way id and then by tile and edge index so that it
+// can be memory mapped and searched by way id
+struct WayEdge {
+  uint64_t wayid;
+  uint64_t edgeid : 46; // the value of the GraphId of the edge
+  uint64_t forward : 1; // whether the edge goes in the direction of the way
+  uint64_t spare : 17;
+};
+
+// Collects the auto edges of the tiles, each thread takes the next tile that nobody took yet and
+// writes the edges it finds to a file of its own
+void collect(const boost::property_tree::ptree& pt,
+             const std::vector<GraphId>& tile_ids,
+             std::atomic<size_t>& next_tile,
+             const std::string& file_name) {
+  GraphReader reader(pt);
+  valhalla::midgard::sequence<WayEdge> way_edges(file_name, true);
+  for (size_t t = next_tile++; t < tile_ids.size(); t = next_tile++) {
+    GraphId edge_id = tile_ids[t];
+    graph_tile_ptr tile = reader.GetGraphTile(edge_id);
+    if (!tile) {
+      continue;
+    }
+    for (uint32_t n = 0; n < tile->header()->directededgecount(); n++, ++edge_id) {
+      const DirectedEdge* edge = tile->directededge(edge_id);
+      if (edge->IsTransitLine() || edge->use() == Use::kTransitConnection ||
+          edge->use() == Use::kEgressConnection || edge->use() == Use::kPlatformConnection) {
+        continue;
+      }
 
-  EdgeAndDirection(const bool f, const GraphId& id) : forward(f), edgeid(id) {
+      // Skip if the edge does not allow auto use
+      if (!(edge->forwardaccess() & kAutoAccess)) {
+        continue;
+      }
+
+      // Get the way Id
+      uint64_t wayid = tile->edgeinfo(edge->edgeinfo_offset()).wayid();
+      way_edges.push_back({wayid, edge_id.value, edge->forward(), 0});
+    }
+
+    // Dont hold on to more tiles than the cache allows
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
   }
-};
+}
 
 bool ParseArguments(int argc, char* argv[]) {
 
@@ -45,7 +89,11 @@ bool ParseArguments(int argc, char* argv[]) {
       " Usage: ways_to_edges [options]\n"
       "\n"
       "ways_to_edges is a program that creates a list of edges for each OSM way "
-      "on the local level tiles."
+      "on the local level tiles. The tiles are read on mjolnir.concurrency threads and the list "
+      "is sorted by way id on disk, it is written both as way_edges.txt with a line of way id "
+      "followed by forward flag and edge id pairs per way and as way_edges.bin, an array of 16 "
+      "byte records of a 64 bit way id followed by 64 bits of which the lowest 46 are the edge id "
+      "and the next one the forward flag, for memory mapping."
       "\n"
       "\n");
 
@@ -110,48 +158,91 @@ int main(int argc, char** argv) {
   auto local_level = TileHierarchy::levels().back().level;
   auto tiles = TileHierarchy::levels().back().tiles;
 
-  // Create an unordered map of OSM ways Ids and their associated graph edges
-  std::unordered_map<uint64_t, std::vector<EdgeAndDirection>> ways_edges;
+  // Configure logging
+  auto logging_subtree = pt.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        ToMap<const boost::property_tree::ptree&, std::unordered_map<std::string, std::string>>(
+            logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
 
-  // Iterate through tiles at the local level
-  GraphReader reader(pt.get_child("mjolnir"));
+  // Find the tiles at the local level
+  GraphReader reader(tile_properties);
+  std::vector<GraphId> tile_ids;
   for (uint32_t id = 0; id < tiles.TileCount(); id++) {
-    // If tile exists add it to the queue
-    GraphId edge_id(id, local_level, 0);
-    if (!reader.DoesTileExist(edge_id)) {
-      continue;
+    GraphId tile_id(id, local_level, 0);
+    if (reader.DoesTileExist(tile_id)) {
+      tile_ids.push_back(tile_id);
     }
+  }
 
-    graph_tile_ptr tile = reader.GetGraphTile(edge_id);
-    for (uint32_t n = 0; n < tile->header()->directededgecount(); n++, ++edge_id) {
-      const DirectedEdge* edge = tile->directededge(edge_id);
-      if (edge->IsTransitLine() || edge->use() == Use::kTransitConnection ||
-          edge->use() == Use::kEgressConnection || edge->use() == Use::kPlatformConnection) {
-        continue;
-      }
-
-      // Skip if the edge does not allow auto use
-      if (!(edge->forwardaccess() & kAutoAccess)) {
-        continue;
-      }
-
-      // Get the way Id
-      uint64_t wayid = tile->edgeinfo(edge->edgeinfo_offset()).wayid();
-      ways_edges[wayid].push_back({edge->forward(), edge_id});
+  // Collect the edges of the ways on all the threads, each into its own file
+  std::string tile_dir = tile_properties.get<std::string>("tile_dir");
+  size_t nb_threads =
+      std::max(static_cast<uint32_t>(1),
+               tile_properties.get<uint32_t>("concurrency", std::thread::hardware_concurrency()));
+  LOG_INFO("Collecting the edges of the ways of " + std::to_string(tile_ids.size()) +
+           " tiles with " + std::to_string(nb_threads) + " thread(s)");
+  std::vector<std::string> part_names;
+  {
+    std::atomic<size_t> next_tile(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nb_threads; ++i) {
+      part_names.push_back(tile_dir + "/way_edges." + std::to_string(i) + ".tmp");
+      threads.emplace_back(collect, std::cref(tile_properties), std::cref(tile_ids),
+                           std::ref(next_tile), std::cref(part_names.back()));
+    }
+    for (auto& thread : threads) {
+      thread.join();
     }
   }
 
+  // Put the parts together and sort them by way id on disk, the edges of a way stay in the order
+  // of their tiles
+  std::string bin_name = tile_dir + "/way_edges.bin";
+  valhalla::midgard::sequence<WayEdge> way_edges(bin_name, true);
+  for (const auto& part_name : part_names) {
+    {
+      valhalla::midgard::sequence<WayEdge> part(part_name, false);
+      part.enumerate([&way_edges](const WayEdge& way_edge) { way_edges.push_back(way_edge); });
+    }
+    filesystem::remove(part_name);
+  }
+  LOG_INFO("Sorting the " + std::to_string(way_edges.size()) + " edges by way id");
+  way_edges.sort(
+      [](const WayEdge& a, const WayEdge& b) {
+        if (a.wayid != b.wayid) {
+          return a.wayid < b.wayid;
+        }
+        GraphId a_id(a.edgeid), b_id(b.edgeid);
+        return a_id.tileid() == b_id.tileid() ? a_id.id() < b_id.id()
+                                              : a_id.tileid() < b_id.tileid();
+      },
+      1024 * 1024 * 512 / sizeof(WayEdge), nb_threads);
+
+  // Stream the sorted edges out a line per way
   std::ofstream ways_file;
-  std::string fname = pt.get<std::string>("mjolnir.tile_dir") + "/way_edges.txt";
+  std::string fname = tile_dir + "/way_edges.txt";
   ways_file.open(fname, std::ofstream::out | std::ofstream::trunc);
-  for (const auto& way : ways_edges) {
-    ways_file << way.first;
-    for (auto edge : way.second) {
-      ways_file << "," << (uint32_t)edge.forward << "," << (uint64_t)edge.edgeid;
+  bool first = true;
+  uint64_t wayid = 0;
+  way_edges.enumerate([&](const WayEdge& way_edge) {
+    if (first || way_edge.wayid != wayid) {
+      if (!first) {
+        ways_file << "\n";
+      }
+      ways_file << way_edge.wayid;
+      wayid = way_edge.wayid;
+      first = false;
     }
-    ways_file << std::endl;
+    ways_file << "," << (uint32_t)way_edge.forward << "," << (uint64_t)way_edge.edgeid;
+  });
+  if (!first) {
+    ways_file << "\n";
   }
   ways_file.close();
+  LOG_INFO("Wrote " + fname + " and " + bin_name);
 
   return EXIT_SUCCESS;
 }
@@ -1,5 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "midgard/logging.h"
 #include "odin/directionsbuilder.h"
@@ -67,42 +73,81 @@ const std::unordered_map<int, DirectionsLeg_TravelMode> translate_travel_mode{
 // NarrativeBuilder::Build to form the maneuver list. This method
 // calls PopulateDirectionsLeg to transform the maneuver list into the
 // trip directions.
-void DirectionsBuilder::Build(Api& api) {
+void DirectionsBuilder::Build(Api& api, const size_t threads) {
   const auto& options = api.options();
+
+  // Lay out the directions of all the legs up front so that they can be built in any order
+  std::vector<std::pair<TripLeg*, DirectionsLeg*>> legs;
   for (auto& trip_route : *api.mutable_trip()->mutable_routes()) {
     auto& directions_route = *api.mutable_directions()->mutable_routes()->Add();
     for (auto& trip_path : *trip_route.mutable_legs()) {
-      auto& trip_directions = *directions_route.mutable_legs()->Add();
-
       // Validate trip path node list
       if (trip_path.node_size() < 1) {
         throw valhalla_exception_t{210};
       }
+      legs.emplace_back(&trip_path, directions_route.mutable_legs()->Add());
+    }
+  }
 
-      // Create an enhanced trip path from the specified trip_path
-      EnhancedTripLeg etp(trip_path);
-
-      // Produce maneuvers if desired
-      std::list<Maneuver> maneuvers;
-      if (options.directions_type() != DirectionsType::none) {
-        // Update the heading of ~0 length edges
-        UpdateHeading(&etp);
+  // The legs dont depend on each other so each thread takes the next one until they are done
+  std::atomic<size_t> next_leg(0);
+  std::vector<std::exception_ptr> errors(legs.size());
+  auto build_legs = [&]() {
+    for (size_t i = next_leg++; i < legs.size(); i = next_leg++) {
+      try {
+        BuildLeg(options, *legs[i].first, *legs[i].second);
+      } catch (...) { errors[i] = std::current_exception(); }
+    }
+  };
 
-        ManeuversBuilder maneuversBuilder(options, &etp);
-        maneuvers = maneuversBuilder.Build();
+  const size_t thread_count = std::min(std::max(threads, size_t(1)), legs.size());
+  if (thread_count > 1) {
+    std::vector<std::shared_ptr<std::thread>> helpers(thread_count - 1);
+    for (auto& helper : helpers) {
+      helper.reset(new std::thread(build_legs));
+    }
+    build_legs();
+    for (auto& helper : helpers) {
+      helper->join();
+    }
+  } else {
+    build_legs();
+  }
 
-        // Create the instructions if desired
-        if (options.directions_type() == DirectionsType::instructions) {
-          std::unique_ptr<NarrativeBuilder> narrative_builder =
-              NarrativeBuilderFactory::Create(options, &etp);
-          narrative_builder->Build(maneuvers);
-        }
-      }
+  // Fail the same way as if the legs had been built in order
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
 
-      // Return trip directions
-      PopulateDirectionsLeg(options, &etp, maneuvers, trip_directions);
+// Returns the directions of one leg
+void DirectionsBuilder::BuildLeg(const Options& options,
+                                 TripLeg& trip_path,
+                                 DirectionsLeg& trip_directions) {
+  // Create an enhanced trip path from the specified trip_path
+  EnhancedTripLeg etp(trip_path);
+
+  // Produce maneuvers if desired
+  std::list<Maneuver> maneuvers;
+  if (options.directions_type() != DirectionsType::none) {
+    // Update the heading of ~0 length edges
+    UpdateHeading(&etp);
+
+    ManeuversBuilder maneuversBuilder(options, &etp);
+    maneuvers = maneuversBuilder.Build();
+
+    // Create the instructions if desired
+    if (options.directions_type() == DirectionsType::instructions) {
+      std::unique_ptr<NarrativeBuilder> narrative_builder =
+          NarrativeBuilderFactory::Create(options, &etp);
+      narrative_builder->Build(maneuvers);
     }
   }
+
+  // Return trip directions
+  PopulateDirectionsLeg(options, &etp, maneuvers, trip_directions);
 }
 
 // Update the heading of ~0 length edges.
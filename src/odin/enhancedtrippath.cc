@@ -266,12 +266,12 @@ std::unique_ptr<EnhancedTripLeg_Admin> EnhancedTripLeg::GetAdmin(size_t index) {
   return std::make_unique<EnhancedTripLeg_Admin>(mutable_admin(index));
 }
 
-std::string EnhancedTripLeg::GetCountryCode(int node_index) {
-  return GetAdmin(node(node_index).admin_index())->country_code();
+const std::string& EnhancedTripLeg::GetCountryCode(int node_index) const {
+  return trip_path_.admin(node(node_index).admin_index()).country_code();
 }
 
-std::string EnhancedTripLeg::GetStateCode(int node_index) {
-  return GetAdmin(node(node_index).admin_index())->state_code();
+const std::string& EnhancedTripLeg::GetStateCode(int node_index) const {
+  return trip_path_.admin(node(node_index).admin_index()).state_code();
 }
 
 const ::valhalla::Location& EnhancedTripLeg::GetOrigin() const {
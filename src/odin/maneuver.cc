@@ -208,6 +208,12 @@ void Maneuver::ClearStreetNames() {
   street_names_->clear();
 }
 
+std::unique_ptr<StreetNames> Maneuver::TakeStreetNames() {
+  std::unique_ptr<StreetNames> street_names = std::make_unique<StreetNames>();
+  street_names_.swap(street_names);
+  return street_names;
+}
+
 bool Maneuver::HasSameNames(const Maneuver* other_maneuver,
                             bool allow_begin_intersecting_edge_name_consistency) const {
 
@@ -485,7 +485,7 @@ void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
         // If needed, set the begin street names
         if (!curr_man->HasBeginStreetNames() && !curr_man->portions_highway() &&
             (curr_man->street_names().size() > common_base_names->size())) {
-          curr_man->set_begin_street_names(curr_man->street_names().clone());
+          curr_man->set_begin_street_names(curr_man->TakeStreetNames());
         }
 
         // Update current maneuver street names
@@ -514,9 +514,10 @@ void ManeuversBuilder::Combine(std::list<Maneuver>& maneuvers) {
       }
       // Combine obvious maneuver
       else if (IsNextManeuverObvious(maneuvers, curr_man, next_man)) {
-        // If current maneuver does not have street names then use the next maneuver street names
+        // If current maneuver does not have street names then use the next maneuver street names,
+        // the next maneuver is combined into this one so its names are moved rather than copied
         if (!curr_man->HasStreetNames() && next_man->HasStreetNames()) {
-          curr_man->set_street_names(next_man->street_names().clone());
+          curr_man->set_street_names(next_man->TakeStreetNames());
         }
 
         // Mark that the current maneuver contains an obvious maneuver
@@ -610,9 +611,9 @@ std::list<Maneuver>::iterator ManeuversBuilder::CombineUnspecifiedInternalManeuv
   // Determine turn degree based on previous maneuver and next maneuver
   next_man->set_turn_degree(GetTurnDegree(prev_man->end_heading(), next_man->begin_heading()));
 
-  // Set the cross street names
+  // Set the cross street names, the current maneuver is erased so they can be moved
   if (curr_man->HasStreetNames()) {
-    next_man->set_cross_street_names(curr_man->street_names().clone());
+    next_man->set_cross_street_names(curr_man->TakeStreetNames());
   }
 
   // Set relative direction
@@ -657,9 +658,9 @@ ManeuversBuilder::CombineInternalManeuver(std::list<Maneuver>& maneuvers,
     next_man->set_turn_degree(GetTurnDegree(prev_man->end_heading(), next_man->begin_heading()));
   }
 
-  // Set the cross street names
+  // Set the cross street names, the current maneuver is erased so they can be moved
   if (curr_man->HasUsableInternalIntersectionName()) {
-    next_man->set_cross_street_names(curr_man->street_names().clone());
+    next_man->set_cross_street_names(curr_man->TakeStreetNames());
   }
 
   // Set the right and left internal turn counts
@@ -746,9 +747,9 @@ ManeuversBuilder::CombineTurnChannelManeuver(std::list<Maneuver>& maneuvers,
   // Set begin shape index
   next_man->set_begin_shape_index(curr_man->begin_shape_index());
 
-  // Set signs, if needed
+  // Set signs, if needed. The current maneuver is erased so they can be moved
   if (curr_man->HasSigns() && !next_man->HasSigns()) {
-    *(next_man->mutable_signs()) = curr_man->signs();
+    *(next_man->mutable_signs()) = std::move(*(curr_man->mutable_signs()));
   }
 
   if (start_man) {
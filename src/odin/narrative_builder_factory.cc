@@ -1,3 +1,6 @@
+#include <string>
+#include <unordered_map>
+
 #include "midgard/util.h"
 
 #include "odin/enhancedtrippath.h"
@@ -7,34 +10,74 @@
 
 #include "proto/options.pb.h"
 
+namespace {
+
+using namespace valhalla;
+using namespace valhalla::odin;
+
+using create_t = std::unique_ptr<NarrativeBuilder> (*)(const Options& options,
+                                                        const EnhancedTripLeg* trip_path,
+                                                        const NarrativeDictionary& dictionary);
+
+template <typename builder_t>
+std::unique_ptr<NarrativeBuilder> create(const Options& options,
+                                         const EnhancedTripLeg* trip_path,
+                                         const NarrativeDictionary& dictionary) {
+  return std::make_unique<builder_t>(options, trip_path, dictionary);
+}
+
+// Everything about a locale that is the same for every request
+struct locale_builder_t {
+  LazyNarrativeDictionary dictionary;
+  create_t create;
+};
+
+// The builder of every locale and alias, decided once from the language tags of their
+// dictionaries without parsing them
+const std::unordered_map<std::string, locale_builder_t>& get_locale_builders() {
+  // thread safe static initializer for singleton
+  static const std::unordered_map<std::string, locale_builder_t> builders = []() {
+    // if a NarrativeBuilder is derived with specific code for a particular
+    // language then add it here
+    const std::unordered_map<std::string, create_t> derived = {
+        {"cs-CZ", &create<NarrativeBuilder_csCZ>},
+        {"hi-IN", &create<NarrativeBuilder_hiIN>},
+        {"it-IT", &create<NarrativeBuilder_itIT>},
+        {"ru-RU", &create<NarrativeBuilder_ruRU>},
+    };
+    std::unordered_map<std::string, locale_builder_t> builders;
+    for (const auto& locale : get_locales()) {
+      auto found = derived.find(locale.second.language_tag());
+      // otherwise its just a NarrativeBuilder
+      builders.emplace(locale.first,
+                       locale_builder_t{locale.second, found == derived.end()
+                                                           ? &create<NarrativeBuilder>
+                                                           : found->second});
+    }
+    return builders;
+  }();
+  return builders;
+}
+
+} // namespace
+
 namespace valhalla {
 namespace odin {
 
 std::unique_ptr<NarrativeBuilder> NarrativeBuilderFactory::Create(const Options& options,
                                                                   const EnhancedTripLeg* trip_path) {
 
-  // Get the locale dictionary
-  const auto phrase_dictionary = get_locales().find(options.language());
+  // Get the builder of the locale
+  const auto& builders = get_locale_builders();
+  const auto builder = builders.find(options.language());
 
   // If language tag is not found then throw error
-  if (phrase_dictionary == get_locales().end()) {
+  if (builder == builders.end()) {
     throw std::runtime_error("Invalid language tag.");
   }
 
-  // if a NarrativeBuilder is derived with specific code for a particular
-  // language then add logic here and return derived NarrativeBuilder
-  if (phrase_dictionary->second->GetLanguageTag() == "cs-CZ") {
-    return std::make_unique<NarrativeBuilder_csCZ>(options, trip_path, *phrase_dictionary->second);
-  } else if (phrase_dictionary->second->GetLanguageTag() == "hi-IN") {
-    return std::make_unique<NarrativeBuilder_hiIN>(options, trip_path, *phrase_dictionary->second);
-  } else if (phrase_dictionary->second->GetLanguageTag() == "it-IT") {
-    return std::make_unique<NarrativeBuilder_itIT>(options, trip_path, *phrase_dictionary->second);
-  } else if (phrase_dictionary->second->GetLanguageTag() == "ru-RU") {
-    return std::make_unique<NarrativeBuilder_ruRU>(options, trip_path, *phrase_dictionary->second);
-  }
-
-  // otherwise just return pointer to NarrativeBuilder
-  return std::make_unique<NarrativeBuilder>(options, trip_path, *phrase_dictionary->second);
+  // only the references to the request are made per request
+  return builder->second.create(options, trip_path, *builder->second.dictionary);
 }
 
 } // namespace odin
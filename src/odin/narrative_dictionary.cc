@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <stdexcept>
 
 #include <boost/property_tree/ptree.hpp>
@@ -35,6 +38,60 @@ std::unordered_map<K, V> as_unordered_map(boost::property_tree::ptree const& pt,
 namespace valhalla {
 namespace odin {
 
+TaggedPhrase::TaggedPhrase(const std::string& phrase) : phrase_(phrase), loaded_(true) {
+  size_t text = 0;
+  for (size_t open = phrase_.find('<'); open != std::string::npos;
+       open = phrase_.find('<', open + 1)) {
+    auto close = phrase_.find_first_of("<>", open + 1);
+    if (close == std::string::npos) {
+      break;
+    }
+    // a < that doesnt open a tag is just text
+    if (phrase_[close] == '<') {
+      continue;
+    }
+    if (open > text) {
+      pieces_.push_back({static_cast<uint32_t>(text), static_cast<uint32_t>(open - text), false});
+    }
+    pieces_.push_back(
+        {static_cast<uint32_t>(open), static_cast<uint32_t>(close + 1 - open), true});
+    text = close + 1;
+    open = close;
+  }
+  if (text < phrase_.size()) {
+    pieces_.push_back(
+        {static_cast<uint32_t>(text), static_cast<uint32_t>(phrase_.size() - text), false});
+  }
+}
+
+void TaggedPhrase::Format(std::string& out, std::initializer_list<tag_value_t> values) const {
+  out.clear();
+  for (const auto& piece : pieces_) {
+    const std::string* value = nullptr;
+    if (piece.tag) {
+      for (const auto& v : values) {
+        if (std::strlen(v.tag) == piece.length &&
+            phrase_.compare(piece.offset, piece.length, v.tag) == 0) {
+          value = &v.value;
+          break;
+        }
+      }
+    }
+    if (value) {
+      out.append(*value);
+    } else {
+      out.append(phrase_, piece.offset, piece.length);
+    }
+  }
+}
+
+const TaggedPhrase& PhraseSet::phrase(const uint8_t id) const {
+  if (id >= tagged_phrases.size() || !tagged_phrases[id].loaded()) {
+    throw std::out_of_range("No phrase with id " + std::to_string(id));
+  }
+  return tagged_phrases[id];
+}
+
 NarrativeDictionary::NarrativeDictionary(const std::string& language_tag,
                                          const boost::property_tree::ptree& narrative_pt) {
   this->language_tag = language_tag;
@@ -320,6 +377,23 @@ void NarrativeDictionary::Load(PhraseSet& phrase_handle,
                                const boost::property_tree::ptree& phrase_pt) {
 
   phrase_handle.phrases = as_unordered_map<std::string, std::string>(phrase_pt, kPhrasesKey);
+
+  // Parse the phrases once here rather than every time an instruction is formed
+  for (const auto& phrase : phrase_handle.phrases) {
+    const auto& key = phrase.first;
+    if (key.empty() || key.size() > 3 ||
+        !std::all_of(key.begin(), key.end(), [](unsigned char c) { return std::isdigit(c); })) {
+      continue;
+    }
+    auto id = std::stoul(key);
+    if (id > UINT8_MAX) {
+      continue;
+    }
+    if (id >= phrase_handle.tagged_phrases.size()) {
+      phrase_handle.tagged_phrases.resize(id + 1);
+    }
+    phrase_handle.tagged_phrases[id] = TaggedPhrase(phrase.second);
+  }
 }
 
 void NarrativeDictionary::Load(StartSubset& start_handle,
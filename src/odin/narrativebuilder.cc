@@ -48,6 +48,8 @@ NarrativeBuilder::NarrativeBuilder(const Options& options,
 }
 
 void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
+  // Most of the work is in the verbal instructions so only form them when they are wanted
+  const bool verbal = options_.verbal_instructions();
   Maneuver* prev_maneuver = nullptr;
   for (auto& maneuver : maneuvers) {
     switch (maneuver.type()) {
@@ -60,12 +62,14 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormStartInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalStartInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalStartInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kDestinationRight:
@@ -74,12 +78,15 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormDestinationInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertDestinationInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertDestinationInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalDestinationInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalDestinationInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kBecomes: {
@@ -87,14 +94,18 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
           // Set instruction
           maneuver.set_instruction(FormBecomesInstruction(maneuver, prev_maneuver));
 
-          // Set verbal pre transition instruction
-          maneuver.set_verbal_pre_transition_instruction(
-              FormVerbalBecomesInstruction(maneuver, prev_maneuver));
+          if (verbal) {
+            // Set verbal pre transition instruction
+            maneuver.set_verbal_pre_transition_instruction(
+                FormVerbalBecomesInstruction(maneuver, prev_maneuver));
+          }
         }
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        if (verbal) {
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kSlightRight:
@@ -106,15 +117,18 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormTurnInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertTurnInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertTurnInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalTurnInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalTurnInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kUturnRight:
@@ -122,35 +136,43 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormUturnInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertUturnInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertUturnInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalUturnInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalUturnInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kRampStraight: {
         // Set instruction
         maneuver.set_instruction(FormRampStraightInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertRampStraightInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertRampStraightInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalRampStraightInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalRampStraightInstruction(maneuver));
+        }
 
         // Only set verbal post if > min ramp length
         // or contains obvious maneuver
         if ((maneuver.length() > kVerbalPostMinimumRampLength) ||
             maneuver.contains_obvious_maneuver()) {
-          // Set verbal post transition instruction
-          maneuver.set_verbal_post_transition_instruction(
-              FormVerbalPostTransitionInstruction(maneuver));
+          if (verbal) {
+            // Set verbal post transition instruction
+            maneuver.set_verbal_post_transition_instruction(
+                FormVerbalPostTransitionInstruction(maneuver));
+          }
         }
         break;
       }
@@ -159,19 +181,24 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormRampInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertRampInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertRampInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalRampInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalRampInstruction(maneuver));
+        }
 
         // Only set verbal post if > min ramp length
         // or contains obvious maneuver
         if ((maneuver.length() > kVerbalPostMinimumRampLength) ||
             maneuver.contains_obvious_maneuver()) {
-          // Set verbal post transition instruction
-          maneuver.set_verbal_post_transition_instruction(
-              FormVerbalPostTransitionInstruction(maneuver));
+          if (verbal) {
+            // Set verbal post transition instruction
+            maneuver.set_verbal_post_transition_instruction(
+                FormVerbalPostTransitionInstruction(maneuver));
+          }
         }
         break;
       }
@@ -180,19 +207,24 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormExitInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertExitInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertExitInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalExitInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalExitInstruction(maneuver));
+        }
 
         // Only set verbal post if > min ramp length
         // or contains obvious maneuver
         if ((maneuver.length() > kVerbalPostMinimumRampLength) ||
             maneuver.contains_obvious_maneuver()) {
-          // Set verbal post transition instruction
-          maneuver.set_verbal_post_transition_instruction(
-              FormVerbalPostTransitionInstruction(maneuver));
+          if (verbal) {
+            // Set verbal post transition instruction
+            maneuver.set_verbal_post_transition_instruction(
+                FormVerbalPostTransitionInstruction(maneuver));
+          }
         }
         break;
       }
@@ -203,46 +235,60 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
           // Set stay on instruction
           maneuver.set_instruction(FormKeepToStayOnInstruction(maneuver));
 
-          // Set verbal transition alert instruction
-          maneuver.set_verbal_transition_alert_instruction(
-              FormVerbalAlertKeepToStayOnInstruction(maneuver));
+          if (verbal) {
+            // Set verbal transition alert instruction
+            maneuver.set_verbal_transition_alert_instruction(
+                FormVerbalAlertKeepToStayOnInstruction(maneuver));
 
-          // Set verbal pre transition instruction
-          maneuver.set_verbal_pre_transition_instruction(FormVerbalKeepToStayOnInstruction(maneuver));
+            // Set verbal pre transition instruction
+            maneuver.set_verbal_pre_transition_instruction(
+                FormVerbalKeepToStayOnInstruction(maneuver));
+          }
 
           // For a ramp - only set verbal post if > min ramp length
           if (maneuver.ramp()) {
             if (maneuver.length() > kVerbalPostMinimumRampLength) {
+              if (verbal) {
+                // Set verbal post transition instruction
+                maneuver.set_verbal_post_transition_instruction(
+                    FormVerbalPostTransitionInstruction(maneuver));
+              }
+            }
+          } else {
+            if (verbal) {
               // Set verbal post transition instruction
               maneuver.set_verbal_post_transition_instruction(
                   FormVerbalPostTransitionInstruction(maneuver));
             }
-          } else {
-            // Set verbal post transition instruction
-            maneuver.set_verbal_post_transition_instruction(
-                FormVerbalPostTransitionInstruction(maneuver));
           }
         } else {
           // Set instruction
           maneuver.set_instruction(FormKeepInstruction(maneuver));
 
-          // Set verbal transition alert instruction
-          maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertKeepInstruction(maneuver));
+          if (verbal) {
+            // Set verbal transition alert instruction
+            maneuver.set_verbal_transition_alert_instruction(
+                FormVerbalAlertKeepInstruction(maneuver));
 
-          // Set verbal pre transition instruction
-          maneuver.set_verbal_pre_transition_instruction(FormVerbalKeepInstruction(maneuver));
+            // Set verbal pre transition instruction
+            maneuver.set_verbal_pre_transition_instruction(FormVerbalKeepInstruction(maneuver));
+          }
 
           // For a ramp - only set verbal post if > min ramp length
           if (maneuver.ramp()) {
             if (maneuver.length() > kVerbalPostMinimumRampLength) {
+              if (verbal) {
+                // Set verbal post transition instruction
+                maneuver.set_verbal_post_transition_instruction(
+                    FormVerbalPostTransitionInstruction(maneuver));
+              }
+            }
+          } else {
+            if (verbal) {
               // Set verbal post transition instruction
               maneuver.set_verbal_post_transition_instruction(
                   FormVerbalPostTransitionInstruction(maneuver));
             }
-          } else {
-            // Set verbal post transition instruction
-            maneuver.set_verbal_post_transition_instruction(
-                FormVerbalPostTransitionInstruction(maneuver));
           }
         }
         break;
@@ -253,32 +299,39 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormMergeInstruction(maneuver));
 
-        // Set verbal transition alert instruction if previous maneuver
-        // is greater than 2 km
-        if (prev_maneuver && (prev_maneuver->length(Options::kilometers) >
-                              kVerbalAlertMergePriorManeuverMinimumLength)) {
-          maneuver.set_verbal_transition_alert_instruction(FormVerbalAlertMergeInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction if previous maneuver
+          // is greater than 2 km
+          if (prev_maneuver && (prev_maneuver->length(Options::kilometers) >
+                                kVerbalAlertMergePriorManeuverMinimumLength)) {
+            maneuver.set_verbal_transition_alert_instruction(
+                FormVerbalAlertMergeInstruction(maneuver));
+        }
         }
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalMergeInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalMergeInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kRoundaboutEnter: {
         // Set instruction
         maneuver.set_instruction(FormEnterRoundaboutInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertEnterRoundaboutInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertEnterRoundaboutInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalEnterRoundaboutInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalEnterRoundaboutInstruction(maneuver));
+        }
 
         // If the maneuver has a combined enter exit roundabout instruction
         // then set verbal post transition instruction
@@ -293,91 +346,108 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormExitRoundaboutInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalExitRoundaboutInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalExitRoundaboutInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver, maneuver.HasBeginStreetNames()));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kFerryEnter: {
         // Set instruction
         maneuver.set_instruction(FormEnterFerryInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertEnterFerryInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertEnterFerryInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalEnterFerryInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalEnterFerryInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransitConnectionStart: {
         // Set instruction
         maneuver.set_instruction(FormTransitConnectionStartInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitConnectionStartInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitConnectionStartInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransitConnectionTransfer: {
         // Set instruction
         maneuver.set_instruction(FormTransitConnectionTransferInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitConnectionTransferInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitConnectionTransferInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransitConnectionDestination: {
         // Set instruction
         maneuver.set_instruction(FormTransitConnectionDestinationInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitConnectionDestinationInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitConnectionDestinationInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kTransit: {
         // Set depart instruction
         maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
 
-        // Set verbal depart instruction
-        maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        if (verbal) {
+          // Set verbal depart instruction
+          maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        }
 
         // Set instruction
         maneuver.set_instruction(FormTransitInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalTransitInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalTransitInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionTransitInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionTransitInstruction(maneuver));
+        }
 
         // Set arrive instruction
         maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
 
-        // Set verbal arrive instruction
-        maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        if (verbal) {
+          // Set verbal arrive instruction
+          maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        }
 
         break;
       }
@@ -385,25 +455,31 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set depart instruction
         maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
 
-        // Set verbal depart instruction
-        maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        if (verbal) {
+          // Set verbal depart instruction
+          maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        }
 
         // Set instruction
         maneuver.set_instruction(FormTransitRemainOnInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitRemainOnInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitRemainOnInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionTransitInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionTransitInstruction(maneuver));
+        }
 
         // Set arrive instruction
         maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
 
-        // Set verbal arrive instruction
-        maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        if (verbal) {
+          // Set verbal arrive instruction
+          maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        }
 
         break;
       }
@@ -411,25 +487,31 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set depart instruction
         maneuver.set_depart_instruction(FormDepartInstruction(maneuver));
 
-        // Set verbal depart instruction
-        maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        if (verbal) {
+          // Set verbal depart instruction
+          maneuver.set_verbal_depart_instruction(FormVerbalDepartInstruction(maneuver));
+        }
 
         // Set instruction
         maneuver.set_instruction(FormTransitTransferInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(
-            FormVerbalTransitTransferInstruction(maneuver));
+        if (verbal) {
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(
+              FormVerbalTransitTransferInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionTransitInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionTransitInstruction(maneuver));
+        }
 
         // Set arrive instruction
         maneuver.set_arrive_instruction(FormArriveInstruction(maneuver));
 
-        // Set verbal arrive instruction
-        maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        if (verbal) {
+          // Set verbal arrive instruction
+          maneuver.set_verbal_arrive_instruction(FormVerbalArriveInstruction(maneuver));
+        }
         break;
       }
       case DirectionsLeg_Maneuver_Type_kContinue:
@@ -437,16 +519,18 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
         // Set instruction
         maneuver.set_instruction(FormContinueInstruction(maneuver));
 
-        // Set verbal transition alert instruction
-        maneuver.set_verbal_transition_alert_instruction(
-            FormVerbalAlertContinueInstruction(maneuver));
+        if (verbal) {
+          // Set verbal transition alert instruction
+          maneuver.set_verbal_transition_alert_instruction(
+              FormVerbalAlertContinueInstruction(maneuver));
 
-        // Set verbal pre transition instruction
-        maneuver.set_verbal_pre_transition_instruction(FormVerbalContinueInstruction(maneuver));
+          // Set verbal pre transition instruction
+          maneuver.set_verbal_pre_transition_instruction(FormVerbalContinueInstruction(maneuver));
 
-        // Set verbal post transition instruction
-        maneuver.set_verbal_post_transition_instruction(
-            FormVerbalPostTransitionInstruction(maneuver));
+          // Set verbal post transition instruction
+          maneuver.set_verbal_post_transition_instruction(
+              FormVerbalPostTransitionInstruction(maneuver));
+        }
         break;
       }
     }
@@ -458,7 +542,9 @@ void NarrativeBuilder::Build(std::list<Maneuver>& maneuvers) {
   }
 
   // Iterate over maneuvers to form verbal multi-cue instructions
-  FormVerbalMultiCue(maneuvers);
+  if (verbal) {
+    FormVerbalMultiCue(maneuvers);
+  }
 }
 
 std::string NarrativeBuilder::FormVerbalAlertApproachInstruction(float distance,
@@ -467,14 +553,16 @@ std::string NarrativeBuilder::FormVerbalAlertApproachInstruction(float distance,
   instruction.reserve(kInstructionInitialCapacity);
   uint8_t phrase_id = 0;
 
+  const auto length = FormLength(distance,
+                                 dictionary_.approach_verbal_alert_subset.metric_lengths,
+                                 dictionary_.approach_verbal_alert_subset.us_customary_lengths);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.approach_verbal_alert_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.approach_verbal_alert_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(distance, dictionary_.approach_verbal_alert_subset.metric_lengths,
-                                dictionary_.approach_verbal_alert_subset.us_customary_lengths));
-  boost::replace_all(instruction, kCurrentVerbalCueTag, verbal_cue);
+  tagged_phrase.Format(instruction, {{kLengthTag, length},
+                                     {kCurrentVerbalCueTag, verbal_cue}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -533,12 +621,12 @@ std::string NarrativeBuilder::FormStartInstruction(Maneuver& maneuver) {
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.start_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  tagged_phrase.Format(instruction, {{kCardinalDirectionTag, cardinal_direction},
+                                     {kStreetNamesTag, street_names},
+                                     {kBeginStreetNamesTag, begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -619,16 +707,18 @@ std::string NarrativeBuilder::FormVerbalStartInstruction(Maneuver& maneuver,
     phrase_id += 1;
   }
 
+  const auto length = FormLength(maneuver,
+                                 dictionary_.start_verbal_subset.metric_lengths,
+                                 dictionary_.start_verbal_subset.us_customary_lengths);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.start_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.start_verbal_subset.metric_lengths,
-                                dictionary_.start_verbal_subset.us_customary_lengths));
+  tagged_phrase.Format(instruction, {{kCardinalDirectionTag, cardinal_direction},
+                                     {kStreetNamesTag, street_names},
+                                     {kBeginStreetNamesTag, begin_street_names},
+                                     {kLengthTag, length}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -673,13 +763,11 @@ std::string NarrativeBuilder::FormDestinationInstruction(Maneuver& maneuver) {
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.destination_subset.phrase(phrase_id);
 
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Replace phrase tags with values
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kDestinationTag, destination}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -729,13 +817,11 @@ std::string NarrativeBuilder::FormVerbalAlertDestinationInstruction(Maneuver& ma
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_verbal_alert_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.destination_verbal_alert_subset.phrase(phrase_id);
 
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Replace phrase tags with values
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kDestinationTag, destination}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -785,13 +871,11 @@ std::string NarrativeBuilder::FormVerbalDestinationInstruction(Maneuver& maneuve
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.destination_verbal_subset.phrase(phrase_id);
 
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Replace phrase tags with values
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kDestinationTag, destination}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -815,11 +899,11 @@ std::string NarrativeBuilder::FormBecomesInstruction(Maneuver& maneuver, Maneuve
   uint8_t phrase_id = 0;
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.becomes_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.becomes_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kPreviousStreetNamesTag, prev_street_names);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  tagged_phrase.Format(instruction, {{kPreviousStreetNamesTag, prev_street_names},
+                                     {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -850,11 +934,11 @@ std::string NarrativeBuilder::FormVerbalBecomesInstruction(Maneuver& maneuver,
   uint8_t phrase_id = 0;
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.becomes_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.becomes_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kPreviousStreetNamesTag, prev_street_names);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  tagged_phrase.Format(instruction, {{kPreviousStreetNamesTag, prev_street_names},
+                                     {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -901,12 +985,12 @@ std::string NarrativeBuilder::FormContinueInstruction(Maneuver& maneuver,
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.continue_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kStreetNamesTag, street_names},
+                                     {kJunctionNameTag, junction_name},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -957,12 +1041,12 @@ std::string NarrativeBuilder::FormVerbalAlertContinueInstruction(Maneuver& maneu
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_verbal_alert_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.continue_verbal_alert_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kStreetNamesTag, street_names},
+                                     {kJunctionNameTag, junction_name},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1021,16 +1105,18 @@ std::string NarrativeBuilder::FormVerbalContinueInstruction(Maneuver& maneuver,
     phrase_id += 1;
   }
 
+  const auto length = FormLength(maneuver,
+                                 dictionary_.continue_verbal_subset.metric_lengths,
+                                 dictionary_.continue_verbal_subset.us_customary_lengths);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.continue_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.continue_verbal_subset.metric_lengths,
-                                dictionary_.continue_verbal_subset.us_customary_lengths));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kLengthTag, length},
+                                     {kStreetNamesTag, street_names},
+                                     {kJunctionNameTag, junction_name},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1106,16 +1192,18 @@ std::string NarrativeBuilder::FormTurnInstruction(Maneuver& maneuver,
     phrase_id = 1;
   }
 
+  const auto relative_direction = FormRelativeTwoDirection(maneuver.type(),
+                                                           subset->relative_directions);
+
   // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = subset->phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kStreetNamesTag, street_names},
+                                     {kBeginStreetNamesTag, begin_street_names},
+                                     {kJunctionNameTag, junction_name},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1214,16 +1302,18 @@ std::string NarrativeBuilder::FormVerbalTurnInstruction(Maneuver& maneuver,
     }
   }
 
+  const auto relative_direction = FormRelativeTwoDirection(maneuver.type(),
+                                                           subset->relative_directions);
+
   // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = subset->phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kStreetNamesTag, street_names},
+                                     {kBeginStreetNamesTag, begin_street_names},
+                                     {kJunctionNameTag, junction_name},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1284,17 +1374,18 @@ std::string NarrativeBuilder::FormUturnInstruction(Maneuver& maneuver,
     }
   }
 
+  const auto relative_direction =
+      FormRelativeTwoDirection(maneuver.type(), dictionary_.uturn_subset.relative_directions);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.uturn_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.uturn_subset.relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kCrossStreetNamesTag, cross_street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kStreetNamesTag, street_names},
+                                     {kCrossStreetNamesTag, cross_street_names},
+                                     {kJunctionNameTag, junction_name},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1440,14 +1531,14 @@ std::string NarrativeBuilder::FormVerbalUturnInstruction(uint8_t phrase_id,
   instruction.reserve(kInstructionInitialCapacity);
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.uturn_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kCrossStreetNamesTag, cross_street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_dir},
+                                     {kStreetNamesTag, street_names},
+                                     {kCrossStreetNamesTag, cross_street_names},
+                                     {kJunctionNameTag, junction_name},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1494,12 +1585,12 @@ std::string NarrativeBuilder::FormRampStraightInstruction(Maneuver& maneuver,
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_straight_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.ramp_straight_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  tagged_phrase.Format(instruction, {{kBranchSignTag, exit_branch_sign},
+                                     {kTowardSignTag, exit_toward_sign},
+                                     {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1597,12 +1688,12 @@ std::string NarrativeBuilder::FormVerbalRampStraightInstruction(uint8_t phrase_i
   instruction.reserve(kInstructionInitialCapacity);
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_straight_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.ramp_straight_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  tagged_phrase.Format(instruction, {{kBranchSignTag, exit_branch_sign},
+                                     {kTowardSignTag, exit_toward_sign},
+                                     {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1670,16 +1761,17 @@ std::string NarrativeBuilder::FormRampInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitNameString(element_max_count, limit_by_consecutive_count);
   }
 
+  const auto relative_direction =
+      FormRelativeTwoDirection(maneuver.type(), dictionary_.ramp_subset.relative_directions);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.ramp_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.ramp_subset.relative_directions));
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kBranchSignTag, exit_branch_sign},
+                                     {kTowardSignTag, exit_toward_sign},
+                                     {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1829,13 +1921,13 @@ std::string NarrativeBuilder::FormVerbalRampInstruction(uint8_t phrase_id,
   instruction.reserve(kInstructionInitialCapacity);
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.ramp_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_dir},
+                                     {kBranchSignTag, exit_branch_sign},
+                                     {kTowardSignTag, exit_toward_sign},
+                                     {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1913,17 +2005,18 @@ std::string NarrativeBuilder::FormExitInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitNameString(element_max_count, limit_by_consecutive_count);
   }
 
+  const auto relative_direction =
+      FormRelativeTwoDirection(maneuver.type(), dictionary_.exit_subset.relative_directions);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.exit_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.exit_subset.relative_directions));
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kNumberSignTag, exit_number_sign},
+                                     {kBranchSignTag, exit_branch_sign},
+                                     {kTowardSignTag, exit_toward_sign},
+                                     {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2081,14 +2174,14 @@ std::string NarrativeBuilder::FormVerbalExitInstruction(uint8_t phrase_id,
   instruction.reserve(kInstructionInitialCapacity);
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.exit_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_dir},
+                                     {kNumberSignTag, exit_number_sign},
+                                     {kBranchSignTag, exit_branch_sign},
+                                     {kTowardSignTag, exit_toward_sign},
+                                     {kNameSignTag, exit_name_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2169,16 +2262,17 @@ std::string NarrativeBuilder::FormKeepInstruction(Maneuver& maneuver,
     phrase_id += 4;
   }
 
+  const auto relative_direction =
+      FormRelativeThreeDirection(maneuver.type(), dictionary_.keep_subset.relative_directions);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.keep_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeThreeDirection(maneuver.type(),
-                                                dictionary_.keep_subset.relative_directions));
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, toward_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kNumberSignTag, exit_number_sign},
+                                     {kStreetNamesTag, street_names},
+                                     {kTowardSignTag, toward_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2359,13 +2453,13 @@ std::string NarrativeBuilder::FormVerbalKeepInstruction(uint8_t phrase_id,
   instruction.reserve(kInstructionInitialCapacity);
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.keep_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, toward_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_dir},
+                                     {kNumberSignTag, exit_number_sign},
+                                     {kStreetNamesTag, street_names},
+                                     {kTowardSignTag, toward_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2417,16 +2511,18 @@ std::string NarrativeBuilder::FormKeepToStayOnInstruction(Maneuver& maneuver,
     phrase_id += 2;
   }
 
+  const auto relative_direction =
+      FormRelativeThreeDirection(maneuver.type(),
+                                 dictionary_.keep_to_stay_on_subset.relative_directions);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_to_stay_on_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.keep_to_stay_on_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeThreeDirection(maneuver.type(), dictionary_.keep_to_stay_on_subset
-                                                                     .relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kTowardSignTag, toward_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kStreetNamesTag, street_names},
+                                     {kNumberSignTag, exit_number_sign},
+                                     {kTowardSignTag, toward_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2514,13 +2610,13 @@ std::string NarrativeBuilder::FormVerbalKeepToStayOnInstruction(uint8_t phrase_i
   instruction.reserve(kInstructionInitialCapacity);
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_to_stay_on_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.keep_to_stay_on_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kTowardSignTag, toward_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_dir},
+                                     {kStreetNamesTag, street_names},
+                                     {kNumberSignTag, exit_number_sign},
+                                     {kTowardSignTag, toward_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2572,12 +2668,12 @@ std::string NarrativeBuilder::FormMergeInstruction(Maneuver& maneuver,
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.merge_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kStreetNamesTag, street_names},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2647,12 +2743,12 @@ std::string NarrativeBuilder::FormVerbalMergeInstruction(Maneuver& maneuver,
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.merge_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kRelativeDirectionTag, relative_direction},
+                                     {kStreetNamesTag, street_names},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2770,15 +2866,15 @@ std::string NarrativeBuilder::FormEnterRoundaboutInstruction(Maneuver& maneuver,
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.enter_roundabout_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
-  boost::replace_all(instruction, kRoundaboutExitStreetNamesTag, roundabout_exit_street_names);
-  boost::replace_all(instruction, kRoundaboutExitBeginStreetNamesTag,
-                     roundabout_exit_begin_street_names);
+  tagged_phrase.Format(instruction, {{kOrdinalValueTag, ordinal_value},
+                                     {kStreetNamesTag, street_names},
+                                     {kTowardSignTag, guide_sign},
+                                     {kRoundaboutExitStreetNamesTag, roundabout_exit_street_names},
+                                     {kRoundaboutExitBeginStreetNamesTag,
+                                      roundabout_exit_begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2921,15 +3017,15 @@ std::string NarrativeBuilder::FormVerbalEnterRoundaboutInstruction(Maneuver& man
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.enter_roundabout_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
-  boost::replace_all(instruction, kRoundaboutExitStreetNamesTag, roundabout_exit_street_names);
-  boost::replace_all(instruction, kRoundaboutExitBeginStreetNamesTag,
-                     roundabout_exit_begin_street_names);
+  tagged_phrase.Format(instruction, {{kOrdinalValueTag, ordinal_value},
+                                     {kStreetNamesTag, street_names},
+                                     {kTowardSignTag, guide_sign},
+                                     {kRoundaboutExitStreetNamesTag, roundabout_exit_street_names},
+                                     {kRoundaboutExitBeginStreetNamesTag,
+                                      roundabout_exit_begin_street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2984,12 +3080,12 @@ std::string NarrativeBuilder::FormExitRoundaboutInstruction(Maneuver& maneuver,
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.exit_roundabout_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kStreetNamesTag, street_names},
+                                     {kBeginStreetNamesTag, begin_street_names},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3048,12 +3144,12 @@ std::string NarrativeBuilder::FormVerbalExitRoundaboutInstruction(Maneuver& mane
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.exit_roundabout_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kStreetNamesTag, street_names},
+                                     {kBeginStreetNamesTag, begin_street_names},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3098,12 +3194,12 @@ std::string NarrativeBuilder::FormEnterFerryInstruction(Maneuver& maneuver,
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_ferry_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.enter_ferry_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kFerryLabelTag, ferry_label);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kStreetNamesTag, street_names},
+                                     {kFerryLabelTag, ferry_label},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3165,12 +3261,12 @@ std::string NarrativeBuilder::FormVerbalEnterFerryInstruction(Maneuver& maneuver
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_ferry_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.enter_ferry_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kFerryLabelTag, ferry_label);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  tagged_phrase.Format(instruction, {{kStreetNamesTag, street_names},
+                                     {kFerryLabelTag, ferry_label},
+                                     {kTowardSignTag, guide_sign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3204,11 +3300,11 @@ std::string NarrativeBuilder::FormTransitConnectionStartInstruction(Maneuver& ma
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_start_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_connection_start_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop},
+                                     {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3242,12 +3338,11 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionStartInstruction(Maneuv
   }
 
   // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_start_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_connection_start_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop},
+                                     {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3281,11 +3376,11 @@ std::string NarrativeBuilder::FormTransitConnectionTransferInstruction(Maneuver&
   }
 
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_transfer_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_connection_transfer_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop},
+                                     {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3319,12 +3414,12 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionTransferInstruction(Man
   }
 
   // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_transfer_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase =
+      dictionary_.transit_connection_transfer_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop},
+                                     {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3358,12 +3453,11 @@ std::string NarrativeBuilder::FormTransitConnectionDestinationInstruction(Maneuv
   }
 
   // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_destination_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_connection_destination_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop},
+                                     {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3397,12 +3491,12 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionDestinationInstruction(
   }
 
   // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_destination_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase =
+      dictionary_.transit_connection_destination_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop},
+                                     {kStationLabelTag, station_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3425,13 +3519,14 @@ std::string NarrativeBuilder::FormDepartInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
+  const auto time = get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale());
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.depart_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.depart_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale()));
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop_name},
+                                     {kTimeTag, time}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3454,13 +3549,14 @@ std::string NarrativeBuilder::FormVerbalDepartInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
+  const auto time = get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale());
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.depart_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.depart_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale()));
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop_name},
+                                     {kTimeTag, time}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3483,13 +3579,14 @@ std::string NarrativeBuilder::FormArriveInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
+  const auto time = get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale());
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.arrive_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.arrive_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale()));
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop_name},
+                                     {kTimeTag, time}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3512,13 +3609,14 @@ std::string NarrativeBuilder::FormVerbalArriveInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
+  const auto time = get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale());
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.arrive_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.arrive_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale()));
+  tagged_phrase.Format(instruction, {{kTransitPlatformTag, transit_stop_name},
+                                     {kTimeTag, time}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3545,16 +3643,19 @@ std::string NarrativeBuilder::FormTransitInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
+  const auto transit_name = FormTransitName(maneuver,
+                                            dictionary_.transit_subset.empty_transit_name_labels);
+  // TODO: locale specific numerals
+  const auto stop_count_text = std::to_string(stop_count);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  tagged_phrase.Format(instruction, {{kTransitNameTag, transit_name},
+                                     {kTransitHeadSignTag, transit_headsign},
+                                     {kTransitPlatformCountTag, stop_count_text},
+                                     {kTransitPlatformCountLabelTag, stop_count_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3577,14 +3678,15 @@ std::string NarrativeBuilder::FormVerbalTransitInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
+  const auto transit_name =
+      FormTransitName(maneuver, dictionary_.transit_verbal_subset.empty_transit_name_labels);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_verbal_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  tagged_phrase.Format(instruction, {{kTransitNameTag, transit_name},
+                                     {kTransitHeadSignTag, transit_headsign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3612,17 +3714,19 @@ std::string NarrativeBuilder::FormTransitRemainOnInstruction(Maneuver& maneuver)
     phrase_id = 1;
   }
 
+  const auto transit_name =
+      FormTransitName(maneuver, dictionary_.transit_remain_on_subset.empty_transit_name_labels);
+  // TODO: locale specific numerals
+  const auto stop_count_text = std::to_string(stop_count);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_remain_on_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_remain_on_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_remain_on_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  tagged_phrase.Format(instruction, {{kTransitNameTag, transit_name},
+                                     {kTransitHeadSignTag, transit_headsign},
+                                     {kTransitPlatformCountTag, stop_count_text},
+                                     {kTransitPlatformCountLabelTag, stop_count_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3645,14 +3749,16 @@ std::string NarrativeBuilder::FormVerbalTransitRemainOnInstruction(Maneuver& man
     phrase_id = 1;
   }
 
+  const auto transit_name =
+      FormTransitName(maneuver,
+                      dictionary_.transit_remain_on_verbal_subset.empty_transit_name_labels);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_remain_on_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_remain_on_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_remain_on_verbal_subset
-                                                   .empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  tagged_phrase.Format(instruction, {{kTransitNameTag, transit_name},
+                                     {kTransitHeadSignTag, transit_headsign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3680,17 +3786,19 @@ std::string NarrativeBuilder::FormTransitTransferInstruction(Maneuver& maneuver)
     phrase_id = 1;
   }
 
+  const auto transit_name =
+      FormTransitName(maneuver, dictionary_.transit_transfer_subset.empty_transit_name_labels);
+  // TODO: locale specific numerals
+  const auto stop_count_text = std::to_string(stop_count);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_transfer_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_transfer_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_transfer_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  tagged_phrase.Format(instruction, {{kTransitNameTag, transit_name},
+                                     {kTransitHeadSignTag, transit_headsign},
+                                     {kTransitPlatformCountTag, stop_count_text},
+                                     {kTransitPlatformCountLabelTag, stop_count_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3713,14 +3821,16 @@ std::string NarrativeBuilder::FormVerbalTransitTransferInstruction(Maneuver& man
     phrase_id = 1;
   }
 
+  const auto transit_name =
+      FormTransitName(maneuver,
+                      dictionary_.transit_transfer_verbal_subset.empty_transit_name_labels);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_transfer_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.transit_transfer_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_transfer_verbal_subset
-                                                   .empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  tagged_phrase.Format(instruction, {{kTransitNameTag, transit_name},
+                                     {kTransitHeadSignTag, transit_headsign}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3761,14 +3871,16 @@ std::string NarrativeBuilder::FormVerbalPostTransitionInstruction(Maneuver& mane
     phrase_id = 1;
   }
 
+  const auto length = FormLength(maneuver,
+                                 dictionary_.post_transition_verbal_subset.metric_lengths,
+                                 dictionary_.post_transition_verbal_subset.us_customary_lengths);
+
   // Set instruction to the determined tagged phrase
-  instruction = dictionary_.post_transition_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.post_transition_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.post_transition_verbal_subset.metric_lengths,
-                                dictionary_.post_transition_verbal_subset.us_customary_lengths));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  tagged_phrase.Format(instruction, {{kLengthTag, length},
+                                     {kStreetNamesTag, street_names}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3789,14 +3901,15 @@ std::string NarrativeBuilder::FormVerbalPostTransitionTransitInstruction(Maneuve
       FormTransitPlatformCountLabel(stop_count, dictionary_.post_transition_transit_verbal_subset
                                                     .transit_stop_count_labels);
 
+  // TODO: locale specific numerals
+  const auto stop_count_text = std::to_string(stop_count);
+
   // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.post_transition_transit_verbal_subset.phrases.at(std::to_string(phrase_id));
+  const auto& tagged_phrase = dictionary_.post_transition_transit_verbal_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  tagged_phrase.Format(instruction, {{kTransitPlatformCountTag, stop_count_text},
+                                     {kTransitPlatformCountLabelTag, stop_count_label}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -4198,14 +4311,15 @@ std::string NarrativeBuilder::FormVerbalMultiCue(Maneuver* maneuver, Maneuver& n
   if (maneuver->distant_verbal_multi_cue()) {
     phrase_id = 1;
   }
-  instruction = dictionary_.verbal_multi_cue_subset.phrases.at(std::to_string(phrase_id));
+  const auto length = FormLength(*maneuver,
+                                 dictionary_.post_transition_verbal_subset.metric_lengths,
+                                 dictionary_.post_transition_verbal_subset.us_customary_lengths);
+  const auto& tagged_phrase = dictionary_.verbal_multi_cue_subset.phrase(phrase_id);
 
   // Replace phrase tags with values
-  boost::replace_all(instruction, kCurrentVerbalCueTag, current_verbal_cue);
-  boost::replace_all(instruction, kNextVerbalCueTag, next_verbal_cue);
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(*maneuver, dictionary_.post_transition_verbal_subset.metric_lengths,
-                                dictionary_.post_transition_verbal_subset.us_customary_lengths));
+  tagged_phrase.Format(instruction, {{kCurrentVerbalCueTag, current_verbal_cue},
+                                     {kNextVerbalCueTag, next_verbal_cue},
+                                     {kLengthTag, length}});
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
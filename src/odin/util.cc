@@ -27,26 +27,29 @@ valhalla::odin::locales_singleton_t load_narrative_locals() {
     LOG_TRACE("LOCALES");
     LOG_TRACE("-------");
     LOG_TRACE("- " + json.first);
-    // load the json
-    boost::property_tree::ptree narrative_pt;
-    std::stringstream ss;
-    ss << json.second;
-    rapidjson::read_json(ss, narrative_pt);
-    LOG_TRACE("JSON read");
-    // parse it into an object and add it to the map
-    auto narrative_dictionary =
-        std::make_shared<valhalla::odin::NarrativeDictionary>(json.first, narrative_pt);
-    LOG_TRACE("NarrativeDictionary created");
+    // only the aliases are needed now, the dictionary is parsed when it is first used
+    rapidjson::Document doc;
+    doc.Parse(json.second.c_str());
+    if (doc.HasParseError()) {
+      throw std::logic_error("Json locale '" + json.first + "' could not be parsed");
+    }
+    valhalla::odin::LazyNarrativeDictionary narrative_dictionary(json.first, json.second);
     locales.insert(std::make_pair(json.first, narrative_dictionary));
     // insert all the aliases as this same object
-    auto aliases = narrative_pt.get_child("aliases");
-    for (const auto& alias : aliases) {
-      auto name = alias.second.get_value<std::string>();
+    auto aliases = rapidjson::get_child_optional(doc, "/aliases");
+    if (!aliases || !aliases->IsArray()) {
+      continue;
+    }
+    for (const auto& alias : aliases->GetArray()) {
+      if (!alias.IsString()) {
+        continue;
+      }
+      std::string name = alias.GetString();
       auto inserted = locales.insert(std::make_pair(name, narrative_dictionary));
       if (!inserted.second) {
         throw std::logic_error("Alias '" + name + "' in json locale '" + json.first +
-                               "' has duplicate with posix_locale '" +
-                               inserted.first->second->GetLocale().name());
+                               "' has duplicate with json locale '" +
+                               inserted.first->second.language_tag() + "'");
       }
     }
   }
@@ -128,6 +131,24 @@ std::string get_localized_date(const std::string& date_time, const std::locale&
   return date::format(locale, "%x", local_tp);
 }
 
+LazyNarrativeDictionary::LazyNarrativeDictionary(const std::string& language_tag,
+                                                 const std::string& json)
+    : state_(new state_t{language_tag, json, {}, {}}) {
+}
+
+const NarrativeDictionary& LazyNarrativeDictionary::get() const {
+  std::call_once(state_->parsed, [this]() {
+    boost::property_tree::ptree narrative_pt;
+    std::stringstream ss;
+    ss << state_->json;
+    rapidjson::read_json(ss, narrative_pt);
+    LOG_TRACE("JSON read");
+    state_->dictionary.reset(new NarrativeDictionary(state_->language_tag, narrative_pt));
+    LOG_TRACE("NarrativeDictionary created");
+  });
+  return *state_->dictionary;
+}
+
 const locales_singleton_t& get_locales() {
   // thread safe static initializer for singleton
   static locales_singleton_t locales(load_narrative_locals());
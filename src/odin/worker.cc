@@ -10,6 +10,7 @@
 
 #include "baldr/json.h"
 #include "midgard/logging.h"
+#include "midgard/tracepoint.h"
 
 #include "midgard/util.h"
 #include "odin/directionsbuilder.h"
@@ -27,7 +28,8 @@ using namespace valhalla::baldr;
 namespace valhalla {
 namespace odin {
 
-odin_worker_t::odin_worker_t(const boost::property_tree::ptree&) {
+odin_worker_t::odin_worker_t(const boost::property_tree::ptree& config)
+    : directions_threads(config.get<size_t>("odin.directions_threads", 1)) {
 }
 
 odin_worker_t::~odin_worker_t() {
@@ -42,7 +44,7 @@ void odin_worker_t::narrate(Api& request) const {
 
   // get some annotated directions
   try {
-    odin::DirectionsBuilder().Build(request);
+    odin::DirectionsBuilder().Build(request, directions_threads);
   } catch (...) { throw valhalla_exception_t{202}; }
 }
 
@@ -53,11 +55,8 @@ odin_worker_t::work(const std::list<zmq::message_t>& job,
                     const std::function<void()>& interrupt_function) {
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Odin Request " + std::to_string(info.id));
-  Api request;
+  Api& request = request_arena.next();
   try {
-    // Set the interrupt function
-    service_worker_t::set_interrupt(&interrupt_function);
-
     // crack open the in progress request
     bool success = request.ParseFromArray(job.front().data(), job.front().size());
     if (!success) {
@@ -66,11 +65,19 @@ odin_worker_t::work(const std::list<zmq::message_t>& job,
                                  boost::optional<std::string>("Failed parsing pbf in Odin::Worker")};
     }
 
+    // Set the interrupt function
+    deadline_interrupt = with_deadline(&interrupt_function, request);
+    service_worker_t::set_interrupt(&deadline_interrupt);
+
     // narrate them and serialize them along
     narrate(request);
+    VALHALLA_TRACE1(serialize_start, "directions");
     auto response = tyr::serializeDirections(request);
+    VALHALLA_TRACE2(serialize_done, "directions", response.size());
     const bool as_gpx = request.options().format() == Options::gpx;
-    return to_response(response, info, request, as_gpx ? worker::GPX_MIME : worker::JSON_MIME,
+    const bool as_pbf = request.options().format() == Options::pbf;
+    return to_response(response, info, request,
+                       as_gpx ? worker::GPX_MIME : (as_pbf ? worker::PBF_MIME : worker::JSON_MIME),
                        as_gpx);
   } catch (const std::exception& e) {
     return jsonify_error({299, std::string(e.what())}, info, request);
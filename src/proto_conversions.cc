@@ -112,6 +112,8 @@ bool Options_Action_Enum_Parse(const std::string& action, Options::Action* a) {
       {"height", Options::height},
       {"transit_available", Options::transit_available},
       {"expansion", Options::expansion},
+      {"route_batch", Options::route_batch},
+      {"recost", Options::recost},
   };
   auto i = actions.find(action);
   if (i == actions.cend())
@@ -133,6 +135,8 @@ const std::string& Options_Action_Enum_Name(const Options::Action action) {
       {Options::height, "height"},
       {Options::transit_available, "transit_available"},
       {Options::expansion, "expansion"},
+      {Options::route_batch, "route_batch"},
+      {Options::recost, "recost"},
   };
   auto i = actions.find(action);
   return i == actions.cend() ? empty : i->second;
@@ -252,6 +256,7 @@ bool Options_Format_Enum_Parse(const std::string& format, Options::Format* f) {
       {"json", Options::json},
       {"gpx", Options::gpx},
       {"osrm", Options::osrm},
+      {"pbf", Options::pbf},
   };
   auto i = formats.find(format);
   if (i == formats.cend())
@@ -266,6 +271,7 @@ const std::string& Options_Format_Enum_Name(const Options::Format match) {
       {Options::json, "json"},
       {Options::gpx, "gpx"},
       {Options::osrm, "osrm"},
+      {Options::pbf, "pbf"},
   };
   auto i = formats.find(match);
   return i == formats.cend() ? empty : i->second;
@@ -9,6 +9,7 @@
 #include "sif/costconstants.h"
 #include "sif/dynamiccost.h"
 #include "sif/osrm_car_duration.h"
+#include <algorithm>
 #include <cassert>
 
 #ifdef INLINE_TEST
@@ -118,6 +119,11 @@ constexpr float kSurfaceFactor[] = {
     1.0f  // kPath
 };
 
+// Size of the combined table of highway and surface factors of every classification and surface
+constexpr uint32_t kRoadClassCount = 8;
+constexpr uint32_t kSurfaceCount = 8;
+constexpr uint32_t kRoadFactorCount = kRoadClassCount * kSurfaceCount;
+
 } // namespace
 
 /**
@@ -137,6 +143,14 @@ public:
   virtual ~AutoCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<AutoCost>(*this);
+  }
+
   /**
    * Does the costing method allow multiple passes (with relaxed hierarchy
    * limits).
@@ -221,6 +235,24 @@ public:
                         const graph_tile_ptr& tile,
                         const uint32_t seconds) const override;
 
+  /**
+   * Get the costs to traverse some of a range of contiguous directed edges.
+   * @param  edges     Pointer to the first directed edge of the range.
+   * @param  indices   Which of the edges of the range to cost.
+   * @param  count     Number of edges to cost.
+   * @param  tile      Current tile.
+   * @param  seconds   Time of week in seconds.
+   * @param  costs     Filled with the cost and time (seconds) of each of the indexed edges.
+   */
+  virtual void EdgeCosts(const baldr::DirectedEdge* edges,
+                         const uint32_t* indices,
+                         const uint32_t count,
+                         const graph_tile_ptr& tile,
+                         const uint32_t seconds,
+                         Cost* costs) const override {
+    EdgeCostsOf<AutoCost>(edges, indices, count, tile, seconds, costs);
+  }
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -295,6 +327,13 @@ public:
   float toll_factor_;        // Factor applied when road has a toll
   float surface_factor_;     // How much the surface factors are applied.
 
+  // The highway and surface factors of every classification and surface as one table
+  float road_factor_[kRoadFactorCount];
+  static uint32_t RoadFactorIndex(const baldr::DirectedEdge* edge) {
+    return (static_cast<uint32_t>(edge->classification()) << 3) |
+           static_cast<uint32_t>(edge->surface());
+  }
+
   // Density factor used in edge transition costing
   std::vector<float> trans_density_factor_;
 };
@@ -352,6 +391,16 @@ AutoCost::AutoCost(const CostingOptions& costing_options, uint32_t access_mask)
   for (uint32_t d = 0; d < 16; d++) {
     density_factor_[d] = 0.85f + (d * 0.025f);
   }
+
+  // Combine the highway and surface factors up front since the options dont change them
+  // per edge. Impassable surfaces are not allowed anyway and get the factor of a path.
+  for (uint32_t c = 0; c < kRoadClassCount; c++) {
+    for (uint32_t s = 0; s < kSurfaceCount; s++) {
+      road_factor_[(c << 3) | s] =
+          highway_factor_ * kHighwayFactor[c] +
+          surface_factor_ * kSurfaceFactor[std::min(s, static_cast<uint32_t>(Surface::kPath))];
+    }
+  }
 }
 
 // Check if access is allowed on the specified edge.
@@ -366,10 +415,12 @@ bool AutoCost::Allowed(const baldr::DirectedEdge* edge,
   // Allow U-turns at dead-end nodes in case the origin is inside
   // a not thru region and a heading selected an edge entering the
   // region.
-  if (!IsAccessible(edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((pred.restrictions() & (1 << edge->localedgeidx())) && !ignore_restrictions_) ||
       edge->surface() == Surface::kImpassable || IsUserAvoidEdge(edgeid) ||
-      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) || IsClosed(edge, tile)) {
+      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) ||
+      DynamicCost::IsClosed(edge, tile)) {
     return false;
   }
 
@@ -389,11 +440,12 @@ bool AutoCost::AllowedReverse(const baldr::DirectedEdge* edge,
                               int& restriction_idx) const {
   // Check access, U-turn, and simple turn restriction.
   // Allow U-turns at dead-end nodes.
-  if (!IsAccessible(opp_edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(opp_edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((opp_edge->restrictions() & (1 << pred.opp_local_idx())) && !ignore_restrictions_) ||
       opp_edge->surface() == Surface::kImpassable || IsUserAvoidEdge(opp_edgeid) ||
       (!allow_destination_only_ && !pred.destonly() && opp_edge->destonly()) ||
-      IsClosed(opp_edge, tile)) {
+      DynamicCost::IsClosed(opp_edge, tile)) {
     return false;
   }
 
@@ -422,8 +474,7 @@ Cost AutoCost::EdgeCost(const baldr::DirectedEdge* edge,
 
   // TODO: factor hasn't been extensively tested, might alter this in future
   float speed_penalty = (edge_speed > top_speed_) ? (edge_speed - top_speed_) * 0.05f : 0.0f;
-  factor += highway_factor_ * kHighwayFactor[static_cast<uint32_t>(edge->classification())] +
-            surface_factor_ * kSurfaceFactor[static_cast<uint32_t>(edge->surface())] + speed_penalty;
+  factor += road_factor_[RoadFactorIndex(edge)] + speed_penalty;
 
   if (edge->toll()) {
     factor += toll_factor_;
@@ -443,7 +494,7 @@ Cost AutoCost::TransitionCost(const baldr::DirectedEdge* edge,
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
   uint32_t idx = pred.opp_local_idx();
-  Cost c = base_transition_cost(node, edge, pred, idx);
+  Cost c = DynamicCost::base_transition_cost(node, edge, pred, idx);
   c.secs = OSRMCarTurnDuration(edge, node, pred.opp_local_idx());
 
   // Intersection transition time = factor * stopimpact * turncost. Factor depends
@@ -489,7 +540,7 @@ Cost AutoCost::TransitionCostReverse(const uint32_t idx,
                                      const baldr::DirectedEdge* edge) const {
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
-  Cost c = base_transition_cost(node, edge, pred, idx);
+  Cost c = DynamicCost::base_transition_cost(node, edge, pred, idx);
   c.secs = OSRMCarTurnDuration(edge, node, pred->opp_local_idx());
 
   // Transition time = densityfactor * stopimpact * turncost
@@ -665,6 +716,14 @@ public:
   virtual ~BusCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<BusCost>(*this);
+  }
+
   /**
    * Checks if access is allowed for the provided directed edge.
    * This is generally based on mode of travel and the access modes
@@ -726,10 +785,12 @@ bool BusCost::Allowed(const baldr::DirectedEdge* edge,
                       int& restriction_idx) const {
   // Check access, U-turn, and simple turn restriction.
   // Allow U-turns at dead-end nodes.
-  if (!IsAccessible(edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((pred.restrictions() & (1 << edge->localedgeidx())) && !ignore_restrictions_) ||
       edge->surface() == Surface::kImpassable || IsUserAvoidEdge(edgeid) ||
-      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) || IsClosed(edge, tile)) {
+      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) ||
+      DynamicCost::IsClosed(edge, tile)) {
     return false;
   }
 
@@ -749,11 +810,12 @@ bool BusCost::AllowedReverse(const baldr::DirectedEdge* edge,
                              int& restriction_idx) const {
   // Check access, U-turn, and simple turn restriction.
   // Allow U-turns at dead-end nodes.
-  if (!IsAccessible(opp_edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(opp_edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((opp_edge->restrictions() & (1 << pred.opp_local_idx())) && !ignore_restrictions_) ||
       opp_edge->surface() == Surface::kImpassable || IsUserAvoidEdge(opp_edgeid) ||
       (!allow_destination_only_ && !pred.destonly() && opp_edge->destonly()) ||
-      IsClosed(opp_edge, tile)) {
+      DynamicCost::IsClosed(opp_edge, tile)) {
     return false;
   }
 
@@ -790,6 +852,14 @@ public:
   virtual ~HOVCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<HOVCost>(*this);
+  }
+
   /**
    * Checks if access is allowed for the provided directed edge.
    * This is generally based on mode of travel and the access modes
@@ -868,6 +938,24 @@ public:
     }
     return Cost(sec * factor, sec);
   }
+
+  /**
+   * Get the costs to traverse some of a range of contiguous directed edges.
+   * @param  edges     Pointer to the first directed edge of the range.
+   * @param  indices   Which of the edges of the range to cost.
+   * @param  count     Number of edges to cost.
+   * @param  tile      Current tile.
+   * @param  seconds   Time of week in seconds.
+   * @param  costs     Filled with the cost and time (seconds) of each of the indexed edges.
+   */
+  virtual void EdgeCosts(const baldr::DirectedEdge* edges,
+                         const uint32_t* indices,
+                         const uint32_t count,
+                         const graph_tile_ptr& tile,
+                         const uint32_t seconds,
+                         Cost* costs) const override {
+    EdgeCostsOf<HOVCost>(edges, indices, count, tile, seconds, costs);
+  }
 };
 
 // Check if access is allowed on the specified edge.
@@ -882,10 +970,12 @@ bool HOVCost::Allowed(const baldr::DirectedEdge* edge,
   // Allow U-turns at dead-end nodes in case the origin is inside
   // a not thru region and a heading selected an edge entering the
   // region.
-  if (!IsAccessible(edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((pred.restrictions() & (1 << edge->localedgeidx())) && !ignore_restrictions_) ||
       edge->surface() == Surface::kImpassable || IsUserAvoidEdge(edgeid) ||
-      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) || IsClosed(edge, tile)) {
+      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) ||
+      DynamicCost::IsClosed(edge, tile)) {
     return false;
   }
 
@@ -905,11 +995,12 @@ bool HOVCost::AllowedReverse(const baldr::DirectedEdge* edge,
                              int& restriction_idx) const {
   // Check access, U-turn, and simple turn restriction.
   // Allow U-turns at dead-end nodes.
-  if (!IsAccessible(opp_edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(opp_edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((opp_edge->restrictions() & (1 << pred.opp_local_idx())) && !ignore_restrictions_) ||
       opp_edge->surface() == Surface::kImpassable || IsUserAvoidEdge(opp_edgeid) ||
       (!allow_destination_only_ && !pred.destonly() && opp_edge->destonly()) ||
-      IsClosed(opp_edge, tile)) {
+      DynamicCost::IsClosed(opp_edge, tile)) {
     return false;
   }
 
@@ -946,6 +1037,14 @@ public:
   virtual ~TaxiCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<TaxiCost>(*this);
+  }
+
   /**
    * Checks if access is allowed for the provided directed edge.
    * This is generally based on mode of travel and the access modes
@@ -1023,6 +1122,24 @@ public:
     }
     return Cost(sec * factor, sec);
   }
+
+  /**
+   * Get the costs to traverse some of a range of contiguous directed edges.
+   * @param  edges     Pointer to the first directed edge of the range.
+   * @param  indices   Which of the edges of the range to cost.
+   * @param  count     Number of edges to cost.
+   * @param  tile      Current tile.
+   * @param  seconds   Time of week in seconds.
+   * @param  costs     Filled with the cost and time (seconds) of each of the indexed edges.
+   */
+  virtual void EdgeCosts(const baldr::DirectedEdge* edges,
+                         const uint32_t* indices,
+                         const uint32_t count,
+                         const graph_tile_ptr& tile,
+                         const uint32_t seconds,
+                         Cost* costs) const override {
+    EdgeCostsOf<TaxiCost>(edges, indices, count, tile, seconds, costs);
+  }
 };
 
 // Check if access is allowed on the specified edge.
@@ -1037,10 +1154,12 @@ bool TaxiCost::Allowed(const baldr::DirectedEdge* edge,
   // Allow U-turns at dead-end nodes in case the origin is inside
   // a not thru region and a heading selected an edge entering the
   // region.
-  if (!IsAccessible(edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((pred.restrictions() & (1 << edge->localedgeidx())) && !ignore_restrictions_) ||
       edge->surface() == Surface::kImpassable || IsUserAvoidEdge(edgeid) ||
-      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) || IsClosed(edge, tile)) {
+      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) ||
+      DynamicCost::IsClosed(edge, tile)) {
     return false;
   }
 
@@ -1060,11 +1179,12 @@ bool TaxiCost::AllowedReverse(const baldr::DirectedEdge* edge,
                               int& restriction_idx) const {
   // Check access, U-turn, and simple turn restriction.
   // Allow U-turns at dead-end nodes.
-  if (!IsAccessible(opp_edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(opp_edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((opp_edge->restrictions() & (1 << pred.opp_local_idx())) && !ignore_restrictions_) ||
       opp_edge->surface() == Surface::kImpassable || IsUserAvoidEdge(opp_edgeid) ||
       (!allow_destination_only_ && !pred.destonly() && opp_edge->destonly()) ||
-      IsClosed(opp_edge, tile)) {
+      DynamicCost::IsClosed(opp_edge, tile)) {
     return false;
   }
   return DynamicCost::EvaluateRestrictions(access_mask_, edge, tile, opp_edgeid, current_time,
@@ -1282,6 +1402,30 @@ TEST(AutoCost, testAutoCostParams) {
     EXPECT_EQ(tester->flow_mask_, expected);
   }
 }
+
+TEST(AutoCost, testAdaptHierarchyLimits) {
+  auto tester = make_autocost_from_json("use_ferry", 0.5);
+  const auto defaults = tester->GetHierarchyLimits();
+
+  // short routes keep expanding the lower levels for longer, long ones stop sooner
+  tester->AdaptHierarchyLimits(2000.f);
+  EXPECT_EQ(tester->GetHierarchyLimits()[1].max_up_transitions,
+            defaults[1].max_up_transitions * kAdaptiveLimitsMaxFactor);
+  EXPECT_EQ(tester->GetHierarchyLimits()[2].max_up_transitions,
+            defaults[2].max_up_transitions * kAdaptiveLimitsMaxFactor);
+  tester->AdaptHierarchyLimits(2000000.f);
+  EXPECT_EQ(tester->GetHierarchyLimits()[1].max_up_transitions,
+            defaults[1].max_up_transitions * kAdaptiveLimitsMinFactor);
+
+  // the limits dont compound from one route to the next
+  tester->AdaptHierarchyLimits(kAdaptiveLimitsDistance);
+  for (size_t level = 0; level < defaults.size(); ++level) {
+    EXPECT_EQ(tester->GetHierarchyLimits()[level].max_up_transitions,
+              defaults[level].max_up_transitions);
+    EXPECT_EQ(tester->GetHierarchyLimits()[level].expansion_within_dist,
+              defaults[level].expansion_within_dist);
+  }
+}
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -231,6 +231,14 @@ public:
   virtual ~BicycleCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<BicycleCost>(*this);
+  }
+
   /**
    * Checks if access is allowed for the provided directed edge.
    * This is generally based on mode of travel and the access modes
@@ -506,7 +514,7 @@ bool BicycleCost::Allowed(const baldr::DirectedEdge* edge,
   // Check bicycle access and turn restrictions. Bicycles should obey
   // vehicular turn restrictions. Allow Uturns at dead ends only.
   // Skip impassable edges and shortcut edges.
-  if (!IsAccessible(edge) || edge->is_shortcut() ||
+  if (!DynamicCost::IsAccessible(edge) || edge->is_shortcut() ||
       (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx() &&
        pred.mode() == TravelMode::kBicycle) ||
       (!ignore_restrictions_ && (pred.restrictions() & (1 << edge->localedgeidx()))) ||
@@ -541,7 +549,7 @@ bool BicycleCost::AllowedReverse(const baldr::DirectedEdge* edge,
                                  int& restriction_idx) const {
   // Check access, U-turn (allow at dead-ends), and simple turn restriction.
   // Do not allow transit connection edges.
-  if (!IsAccessible(opp_edge) || opp_edge->is_shortcut() ||
+  if (!DynamicCost::IsAccessible(opp_edge) || opp_edge->is_shortcut() ||
       opp_edge->use() == Use::kTransitConnection || opp_edge->use() == Use::kEgressConnection ||
       opp_edge->use() == Use::kPlatformConnection ||
       (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx() &&
@@ -683,7 +691,7 @@ Cost BicycleCost::TransitionCost(const baldr::DirectedEdge* edge,
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
   uint32_t idx = pred.opp_local_idx();
-  Cost c = base_transition_cost(node, edge, pred, idx);
+  Cost c = DynamicCost::base_transition_cost(node, edge, pred, idx);
 
   // Accumulate cost and penalty
   float seconds = 0.0f;
@@ -769,7 +777,7 @@ Cost BicycleCost::TransitionCostReverse(const uint32_t idx,
                                         const baldr::DirectedEdge* edge) const {
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
-  Cost c = base_transition_cost(node, edge, pred, idx);
+  Cost c = DynamicCost::base_transition_cost(node, edge, pred, idx);
 
   // Additional costs
   float seconds = 0.0f;
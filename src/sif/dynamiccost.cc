@@ -11,6 +11,8 @@
 #include "sif/transitcost.h"
 #include "sif/truckcost.h"
 #include "worker.h"
+#include <array>
+#include <limits>
 #include <utility>
 
 using namespace valhalla::baldr;
@@ -45,6 +47,16 @@ uint8_t SpeedMask_Parse(const boost::optional<const rapidjson::Value&>& speed_ty
   return had_value ? mask : kDefaultFlowMask;
 }
 
+// A time domain which was or wasnt active in a local minute
+struct conditional_t {
+  uint64_t restriction = 0;
+  uint64_t minute = std::numeric_limits<uint64_t>::max();
+  bool active = false;
+};
+
+// How many of them each thread remembers, the slot of one is picked by hashing it
+constexpr size_t kConditionalCacheSize = 1024;
+
 } // namespace
 
 namespace valhalla {
@@ -73,6 +85,38 @@ DynamicCost::DynamicCost(const CostingOptions& options, const TravelMode mode, u
 DynamicCost::~DynamicCost() {
 }
 
+// Test if a date time restriction applies at the current time, the answer only changes from one
+// local minute to the next so it is cached per thread by the restriction and the minute
+bool DynamicCost::IsConditionalActive(const uint64_t restriction,
+                                      const uint64_t current_time,
+                                      const uint32_t tz_index) {
+  const auto* time_zone = baldr::DateTime::get_tz_db().from_index(tz_index);
+  if (!time_zone) {
+    return false;
+  }
+
+  // the domain only depends on the local date and time down to the minute
+  const uint64_t minute =
+      (current_time + baldr::DateTime::get_tz_db().offset(time_zone, current_time)) / 60;
+  thread_local std::array<conditional_t, kConditionalCacheSize> cache;
+  auto& slot = cache[((restriction ^ minute) * 0x9E3779B97F4A7C15ull >> 32) %
+                     kConditionalCacheSize];
+  if (slot.restriction == restriction && slot.minute == minute) {
+    return slot.active;
+  }
+
+  baldr::TimeDomain td(restriction);
+  slot.restriction = restriction;
+  slot.minute = minute;
+  slot.active =
+      baldr::DateTime::is_conditional_active(td.type(), td.begin_hrs(), td.begin_mins(),
+                                             td.end_hrs(), td.end_mins(), td.dow(), td.begin_week(),
+                                             td.begin_month(), td.begin_day_dow(), td.end_week(),
+                                             td.end_month(), td.end_day_dow(), current_time,
+                                             time_zone);
+  return slot.active;
+}
+
 // Does the costing method allow multiple passes (with relaxed hierarchy
 // limits). Defaults to false. Costing methods that wish to allow multiple
 // passes with relaxed hierarchy transitions must override this method.
@@ -165,6 +209,17 @@ void DynamicCost::RelaxHierarchyLimits(const float factor, const float expansion
   }
 }
 
+// Fit the hierarchy limits to the distance of the route.
+void DynamicCost::AdaptHierarchyLimits(const float distance) {
+  if (default_hierarchy_limits_.empty()) {
+    default_hierarchy_limits_ = hierarchy_limits_;
+  }
+  hierarchy_limits_ = default_hierarchy_limits_;
+  for (auto& hierarchy : hierarchy_limits_) {
+    hierarchy.Adapt(distance);
+  }
+}
+
 // Set the current travel mode.
 void DynamicCost::set_travel_mode(const TravelMode mode) {
   travel_mode_ = mode;
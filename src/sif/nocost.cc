@@ -38,6 +38,14 @@ public:
   virtual ~NoCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<NoCost>(*this);
+  }
+
   /**
    * Checks if access is allowed for the provided directed edge.
    * This is generally based on mode of travel and the access modes
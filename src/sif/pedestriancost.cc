@@ -6,6 +6,8 @@
 #include "proto/options.pb.h"
 #include "proto_conversions.h"
 #include "sif/costconstants.h"
+#include <algorithm>
+#include <iterator>
 
 #ifdef INLINE_TEST
 #include "test.h"
@@ -73,6 +75,12 @@ constexpr uint32_t kTransitTransferMaxDistance = 805; // 0.5 miles
 // Avoid roundabouts
 constexpr float kRoundaboutFactor = 2.0f;
 
+// Size of the table of factors by use, the use of an edge has 6 bits
+constexpr uint32_t kUseCount = 64;
+
+// Marks the uses whose factor depends on the sidewalks of the edge instead
+constexpr float kNoUseFactor = -1.0f;
+
 // Minimum and maximum average pedestrian speed (to validate input).
 constexpr float kMinPedestrianSpeed = 0.5f;
 constexpr float kMaxPedestrianSpeed = 25.0f;
@@ -170,6 +178,14 @@ public:
   virtual ~PedestrianCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<PedestrianCost>(*this);
+  }
+
   /**
    * Does the costing method allow multiple passes (with relaxed hierarchy
    * limits).
@@ -412,6 +428,9 @@ public:
   float driveway_factor_;          // Avoid driveways factor.
   float step_penalty_;             // Penalty applied to steps/stairs (seconds).
 
+  // The walkway, alley and driveway factors by use, kNoUseFactor for the other uses
+  float use_factor_[kUseCount];
+
   // Used in edgefilter, it tells if the location should be projected on a edge which is
   // a bike share station connection
   bool project_on_bss_connection = 0;
@@ -562,6 +581,11 @@ PedestrianCost::PedestrianCost(const CostingOptions& costing_options)
   sidewalk_factor_ = costing_options.sidewalk_factor();
   alley_factor_ = costing_options.alley_factor();
   driveway_factor_ = costing_options.driveway_factor();
+  std::fill(std::begin(use_factor_), std::end(use_factor_), kNoUseFactor);
+  use_factor_[static_cast<uint8_t>(Use::kFootway)] = walkway_factor_;
+  use_factor_[static_cast<uint8_t>(Use::kSidewalk)] = walkway_factor_;
+  use_factor_[static_cast<uint8_t>(Use::kAlley)] = alley_factor_;
+  use_factor_[static_cast<uint8_t>(Use::kDriveway)] = driveway_factor_;
   transit_start_end_max_distance_ = costing_options.transit_start_end_max_distance();
   transit_transfer_max_distance_ = costing_options.transit_transfer_max_distance();
 
@@ -580,8 +604,9 @@ bool PedestrianCost::Allowed(const baldr::DirectedEdge* edge,
                              const uint64_t current_time,
                              const uint32_t tz_index,
                              int& restriction_idx) const {
-  if (!IsAccessible(edge) || (edge->surface() > minimal_allowed_surface_) || edge->is_shortcut() ||
-      IsUserAvoidEdge(edgeid) || edge->sac_scale() > max_hiking_difficulty_ ||
+  if (!DynamicCost::IsAccessible(edge) || (edge->surface() > minimal_allowed_surface_) ||
+      edge->is_shortcut() || IsUserAvoidEdge(edgeid) ||
+      edge->sac_scale() > max_hiking_difficulty_ ||
       (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx() &&
        pred.mode() == TravelMode::kPedestrian) ||
       //      (edge->max_up_slope() > max_grade_ || edge->max_down_slope() > max_grade_) ||
@@ -609,17 +634,18 @@ bool PedestrianCost::AllowedReverse(const baldr::DirectedEdge* edge,
                                     const uint64_t current_time,
                                     const uint32_t tz_index,
                                     int& restriction_idx) const {
-  // Do not check max walking distance and assume we are not allowing
-  // transit connections. Assume this method is never used in
-  // multimodal routes).
-  if (!IsAccessible(opp_edge) || (opp_edge->surface() > minimal_allowed_surface_) ||
+  // Do not check max walking distance. Transit connections are only allowed when set, as for
+  // the walks from the last stop of a multi-modal route.
+  if (!DynamicCost::IsAccessible(opp_edge) || (opp_edge->surface() > minimal_allowed_surface_) ||
       opp_edge->is_shortcut() || IsUserAvoidEdge(opp_edgeid) ||
       edge->sac_scale() > max_hiking_difficulty_ ||
       (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx() &&
-       pred.mode() == TravelMode::kPedestrian) ||
-      //      (opp_edge->max_up_slope() > max_grade_ || opp_edge->max_down_slope() > max_grade_) ||
-      opp_edge->use() == Use::kTransitConnection || opp_edge->use() == Use::kEgressConnection ||
-      opp_edge->use() == Use::kPlatformConnection) {
+       pred.mode() == TravelMode::kPedestrian)) {
+    return false;
+  }
+  if (!allow_transit_connections_ &&
+      (opp_edge->use() == Use::kTransitConnection || opp_edge->use() == Use::kEgressConnection ||
+       opp_edge->use() == Use::kPlatformConnection)) {
     return false;
   }
 
@@ -647,14 +673,10 @@ Cost PedestrianCost::EdgeCost(const baldr::DirectedEdge* edge,
     return Cost(edge->length(), sec);
   }
 
-  // TODO - consider using an array of "use factors" to avoid this conditional
   float factor = 1.0f + kSacScaleCostFactor[static_cast<uint8_t>(edge->sac_scale())];
-  if (edge->use() == Use::kFootway || edge->use() == Use::kSidewalk) {
-    factor *= walkway_factor_;
-  } else if (edge->use() == Use::kAlley) {
-    factor *= alley_factor_;
-  } else if (edge->use() == Use::kDriveway) {
-    factor *= driveway_factor_;
+  const float use_factor = use_factor_[static_cast<uint8_t>(edge->use())];
+  if (use_factor != kNoUseFactor) {
+    factor *= use_factor;
   } else if (edge->sidewalk_left() || edge->sidewalk_right()) {
     factor *= sidewalk_factor_;
   } else if (edge->roundabout()) {
@@ -677,7 +699,7 @@ Cost PedestrianCost::TransitionCost(const baldr::DirectedEdge* edge,
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
   uint32_t idx = pred.opp_local_idx();
-  Cost c = base_transition_cost(node, edge, pred, idx);
+  Cost c = PedestrianCost::base_transition_cost(node, edge, pred, idx);
 
   // Costs for crossing an intersection.
   if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
@@ -703,7 +725,7 @@ Cost PedestrianCost::TransitionCostReverse(const uint32_t idx,
 
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
-  Cost c = base_transition_cost(node, edge, pred, idx);
+  Cost c = PedestrianCost::base_transition_cost(node, edge, pred, idx);
 
   // Costs for crossing an intersection.
   if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
@@ -4,33 +4,18 @@
 namespace valhalla {
 namespace sif {
 
-// what this function calls to get the next edge
-using EdgeCallback = std::function<baldr::GraphId(void)>;
-// what this function calls to emit the next label
-using LabelCallback = std::function<void(const EdgeLabel& label)>;
-
-/**
- * Will take a sequence of edges and create the set of edge labels that would represent it
- * Allows for the caller to essentially re-compute the costing of a given path
- *
- * @param reader            used to get access to graph data. modifyable because its got a cache
- * @param costing           single costing object to be used for costing/access computations
- * @param edge_cb           the callback used to get each edge in the path
- * @param label_cb          the callback used to emit each label in the path
- * @param source_pct        the percent along the initial edge the source location is
- * @param target_pct        the percent along the final edge the target location is
- * @param time_info         the time tracking information representing the local time before
- *                          traversing the first edge
- * @param invariant         static date_time, dont offset the time as the path lengthens
- */
-void recost_forward(baldr::GraphReader& reader,
-                    const sif::DynamicCost& costing,
-                    const EdgeCallback& edge_cb,
-                    const LabelCallback& label_cb,
-                    float source_pct,
-                    float target_pct,
-                    const baldr::TimeInfo& time_info,
-                    const bool invariant) {
+namespace {
+
+// The recosting itself, templated on the callbacks so that they can be inlined
+template <typename edge_cb_t, typename label_cb_t>
+void recost(baldr::GraphReader& reader,
+            const DynamicCost& costing,
+            const edge_cb_t& edge_cb,
+            const label_cb_t& label_cb,
+            float source_pct,
+            float target_pct,
+            const baldr::TimeInfo& time_info,
+            const bool invariant) {
   // out of bounds edge scaling
   if (source_pct < 0.f || source_pct > 1.f || target_pct < 0.f || target_pct > 1.f) {
     throw std::logic_error("Source and target percentages must be between 0 and 1 inclusive");
@@ -128,5 +113,35 @@ void recost_forward(baldr::GraphReader& reader,
   }
 }
 
+} // namespace
+
+void recost_forward(baldr::GraphReader& reader,
+                    const sif::DynamicCost& costing,
+                    const EdgeCallback& edge_cb,
+                    const LabelCallback& label_cb,
+                    float source_pct,
+                    float target_pct,
+                    const baldr::TimeInfo& time_info,
+                    const bool invariant) {
+  recost(reader, costing, edge_cb, label_cb, source_pct, target_pct, time_info, invariant);
+}
+
+EdgeLabel recost_forward(baldr::GraphReader& reader,
+                         const sif::DynamicCost& costing,
+                         const std::vector<baldr::GraphId>& path,
+                         float source_pct,
+                         float target_pct,
+                         const baldr::TimeInfo& time_info,
+                         const bool invariant) {
+  size_t next = 0;
+  EdgeLabel last;
+  recost(
+      reader, costing,
+      [&path, &next]() { return next < path.size() ? path[next++] : baldr::GraphId{}; },
+      [&last](const EdgeLabel& label) { last = label; }, source_pct, target_pct, time_info,
+      invariant);
+  return last;
+}
+
 } // namespace sif
 } // namespace valhalla
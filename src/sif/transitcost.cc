@@ -67,6 +67,14 @@ public:
 
   virtual ~TransitCost();
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<TransitCost>(*this);
+  }
+
   /**
    * Get the wheelchair required flag.
    * @return  Returns true if wheelchair is required.
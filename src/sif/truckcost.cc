@@ -3,6 +3,7 @@
 #include "baldr/directededge.h"
 #include "baldr/graphconstants.h"
 #include "baldr/nodeinfo.h"
+#include "baldr/truckrestrictions.h"
 #include "midgard/constants.h"
 #include "midgard/util.h"
 #include "proto_conversions.h"
@@ -118,6 +119,14 @@ public:
 
   virtual ~TruckCost();
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual cost_ptr_t Clone() const override {
+    return std::make_shared<TruckCost>(*this);
+  }
+
   /**
    * Does the costing allow hierarchy transitions. Truck costing will allow
    * transitions by default.
@@ -212,6 +221,24 @@ public:
                         const graph_tile_ptr& tile,
                         const uint32_t seconds) const override;
 
+  /**
+   * Get the costs to traverse some of a range of contiguous directed edges.
+   * @param  edges     Pointer to the first directed edge of the range.
+   * @param  indices   Which of the edges of the range to cost.
+   * @param  count     Number of edges to cost.
+   * @param  tile      Current tile.
+   * @param  seconds   Time of week in seconds.
+   * @param  costs     Filled with the cost and time (seconds) of each of the indexed edges.
+   */
+  virtual void EdgeCosts(const baldr::DirectedEdge* edges,
+                         const uint32_t* indices,
+                         const uint32_t count,
+                         const graph_tile_ptr& tile,
+                         const uint32_t seconds,
+                         Cost* costs) const override {
+    EdgeCostsOf<TruckCost>(edges, indices, count, tile, seconds, costs);
+  }
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -271,6 +298,19 @@ public:
            (allow_closures || !tile->IsClosed(edge));
   }
 
+protected:
+  /**
+   * Whether the summary of the truck restrictions of an edge lets the vehicle pass all of them, so
+   * that they dont have to be looked up in the tile one by one.
+   * @param  tile    the tile of the edge
+   * @param  edgeid  the edge
+   * @return true if the vehicle passes them, false if they have to be evaluated
+   */
+  bool PassesTruckRestrictions(const graph_tile_ptr& tile, const baldr::GraphId& edgeid) const {
+    const auto* summary = tile->GetTruckRestrictions(edgeid.id());
+    return summary != nullptr && summary->Passes(passed_buckets_);
+  }
+
 public:
   VehicleType type_; // Vehicle type: tractor trailer
   std::vector<float> speedfactor_;
@@ -286,6 +326,9 @@ public:
   float width_;     // Vehicle width in meters
   float length_;    // Vehicle length in meters
 
+  // The buckets of the truck restriction summaries of the tiles the vehicle passes
+  baldr::TruckRestrictions::buckets_t passed_buckets_;
+
   // Density factor used in edge transition costing
   std::vector<float> trans_density_factor_;
 };
@@ -310,6 +353,8 @@ TruckCost::TruckCost(const CostingOptions& costing_options)
   height_ = costing_options.height();
   width_ = costing_options.width();
   length_ = costing_options.length();
+  passed_buckets_ =
+      baldr::TruckRestrictions::PassedBuckets(height_, width_, length_, weight_, axle_load_);
 
   // Create speed cost table
   speedfactor_.resize(kMaxSpeedKph + 1, 0);
@@ -393,13 +438,19 @@ inline bool TruckCost::Allowed(const baldr::DirectedEdge* edge,
                                const uint32_t tz_index,
                                int& restriction_idx) const {
   // Check access, U-turn, and simple turn restriction.
-  if (!IsAccessible(edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((pred.restrictions() & (1 << edge->localedgeidx())) && !ignore_restrictions_) ||
       edge->surface() == Surface::kImpassable || IsUserAvoidEdge(edgeid) ||
-      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) || IsClosed(edge, tile)) {
+      (!allow_destination_only_ && !pred.destonly() && edge->destonly()) ||
+      DynamicCost::IsClosed(edge, tile)) {
     return false;
   }
 
+  // most restricted edges only limit the size and weight, which the tile has summed up
+  if ((edge->access_restriction() & access_mask_) && PassesTruckRestrictions(tile, edgeid)) {
+    return true;
+  }
   return DynamicCost::EvaluateRestrictions(access_mask_, edge, tile, edgeid, current_time, tz_index,
                                            restriction_idx);
 }
@@ -415,14 +466,18 @@ bool TruckCost::AllowedReverse(const baldr::DirectedEdge* edge,
                                const uint32_t tz_index,
                                int& restriction_idx) const {
   // Check access, U-turn, and simple turn restriction.
-  if (!IsAccessible(opp_edge) || (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+  if (!DynamicCost::IsAccessible(opp_edge) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
       ((opp_edge->restrictions() & (1 << pred.opp_local_idx())) && !ignore_restrictions_) ||
       opp_edge->surface() == Surface::kImpassable || IsUserAvoidEdge(opp_edgeid) ||
       (!allow_destination_only_ && !pred.destonly() && opp_edge->destonly()) ||
-      IsClosed(opp_edge, tile)) {
+      DynamicCost::IsClosed(opp_edge, tile)) {
     return false;
   }
 
+  if ((edge->access_restriction() & access_mask_) && PassesTruckRestrictions(tile, opp_edgeid)) {
+    return true;
+  }
   return DynamicCost::EvaluateRestrictions(access_mask_, edge, tile, opp_edgeid, current_time,
                                            tz_index, restriction_idx);
 }
@@ -460,7 +515,7 @@ Cost TruckCost::TransitionCost(const baldr::DirectedEdge* edge,
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
   uint32_t idx = pred.opp_local_idx();
-  Cost c = base_transition_cost(node, edge, pred, idx);
+  Cost c = DynamicCost::base_transition_cost(node, edge, pred, idx);
   c.secs = OSRMCarTurnDuration(edge, node, idx);
 
   // Penalty to transition onto low class roads.
@@ -510,7 +565,7 @@ Cost TruckCost::TransitionCostReverse(const uint32_t idx,
                                       const baldr::DirectedEdge* edge) const {
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
-  Cost c = base_transition_cost(node, edge, pred, idx);
+  Cost c = DynamicCost::base_transition_cost(node, edge, pred, idx);
   c.secs = OSRMCarTurnDuration(edge, node, pred->opp_local_idx());
 
   // Penalty to transition onto low class roads.
@@ -1,6 +1,9 @@
 #include "skadi/sample.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
 #include <cstddef>
 #include <fstream>
 #include <limits>
@@ -9,6 +12,7 @@
 #include <stdexcept>
 #include <string>
 #include <sys/stat.h>
+#include <unordered_set>
 
 #include <boost/optional.hpp>
 
@@ -16,6 +20,7 @@
 #include "filesystem.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
+#include "midgard/util.h"
 
 namespace {
 // srtmgl1 holds 1x1 degree tiles but oversamples the egde of the tile
@@ -30,6 +35,28 @@ constexpr int16_t NO_DATA_HIGH = 16384;
 constexpr int16_t NO_DATA_LOW = -16384;
 constexpr size_t TILE_COUNT = 180 * 360;
 
+// the blocked format: a header, the offsets of the blocks from the start of the file and one more
+// for the end of the last, then the blocks of BLOCK_DIM by BLOCK_DIM pixels each zlib compressed
+// on their own. the blocks are row-major and so are their pixels, the right and bottom ones are
+// smaller, and the pixels are big endian as in hgt
+constexpr uint32_t BLOCKED_MAGIC = 0x42544748; // HGTB
+constexpr uint32_t BLOCKED_VERSION = 1;
+constexpr size_t BLOCK_DIM = 256;
+constexpr size_t BLOCKS_PER_ROW = (HGT_DIM + BLOCK_DIM - 1) / BLOCK_DIM;
+constexpr size_t BLOCK_COUNT = BLOCKS_PER_ROW * BLOCKS_PER_ROW;
+constexpr uint32_t NO_BLOCK = std::numeric_limits<uint32_t>::max();
+struct blocked_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t block_dim;
+  uint32_t block_count;
+};
+constexpr size_t BLOCKED_DATA_OFFSET = sizeof(blocked_header_t) + sizeof(uint64_t) * (BLOCK_COUNT + 1);
+
+size_t block_size(size_t block, size_t dim) {
+  return std::min(BLOCK_DIM, HGT_DIM - block * BLOCK_DIM) * dim;
+}
+
 // macro is faster than inline function for this..
 #define out_of_range(v) v > NO_DATA_HIGH || v < NO_DATA_LOW
 
@@ -51,10 +78,10 @@ std::list<std::string> get_files(const std::string& root_dir) {
 
 template <typename fmt_t> uint16_t is_hgt(const std::string& name, fmt_t& fmt) {
   std::smatch m;
-  std::regex e(".*/([NS])([0-9]{2})([WE])([0-9]{3})\\.hgt(\\.gz)?$");
+  std::regex e(".*/([NS])([0-9]{2})([WE])([0-9]{3})\\.hgt(\\.gz|\\.blk)?$");
   if (std::regex_search(name, m, e)) {
-    // enum class format_t{ UNKNOWN = 0, GZIP = 1, RAW = 3 };
-    fmt = static_cast<fmt_t>(m[5].length() ? (m[5] == ".gz" ? 1 : 0) : 3);
+    // enum class format_t{ UNKNOWN = 0, GZIP = 1, BLOCKED = 2, RAW = 3 };
+    fmt = static_cast<fmt_t>(m[5].length() ? (m[5] == ".gz" ? 1 : (m[5] == ".blk" ? 2 : 0)) : 3);
     auto lon = std::stoi(m[4]) * (m[3] == "E" ? 1 : -1) + 180;
     auto lat = std::stoi(m[2]) * (m[1] == "N" ? 1 : -1) + 90;
     if (lon >= 0 && lon < 360 && lat >= 0 && lat < 180) {
@@ -75,103 +102,347 @@ uint64_t file_size(const std::string& file_name) {
   return rc == 0 ? s.st_size : -1;
 }
 
+// whether the header and the block offsets of a blocked tile make sense
+bool is_blocked(const char* data, uint64_t size) {
+  if (size < BLOCKED_DATA_OFFSET) {
+    return false;
+  }
+  const auto* header = reinterpret_cast<const blocked_header_t*>(data);
+  if (header->magic != BLOCKED_MAGIC || header->version != BLOCKED_VERSION ||
+      header->block_dim != BLOCK_DIM || header->block_count != BLOCK_COUNT) {
+    return false;
+  }
+  const auto* offsets = reinterpret_cast<const uint64_t*>(data + sizeof(blocked_header_t));
+  for (size_t i = 0; i < BLOCK_COUNT; ++i) {
+    if (offsets[i] < BLOCKED_DATA_OFFSET || offsets[i + 1] < offsets[i]) {
+      return false;
+    }
+  }
+  return offsets[BLOCK_COUNT] <= size;
+}
+
+// unzips into a buffer of known size
+bool unzip(const char* data, size_t size, int16_t* pixels, size_t count) {
+  auto src_func = [data, size](z_stream& s) -> void {
+    s.next_in = static_cast<Byte*>(static_cast<void*>(const_cast<char*>(data)));
+    s.avail_in = static_cast<unsigned int>(size);
+  };
+  auto dst_func = [pixels, count](z_stream& s) -> int {
+    s.next_out = static_cast<Byte*>(static_cast<void*>(pixels));
+    s.avail_out = static_cast<unsigned int>(count * sizeof(int16_t));
+    return Z_FINISH; // we know the output will hold all the input
+  };
+  return valhalla::baldr::inflate(src_func, dst_func);
+}
+
 } // namespace
 
 namespace valhalla {
 namespace skadi {
 
-::valhalla::skadi::sample::sample(const std::string& data_source)
-    : mapped_cache(TILE_COUNT), unzipped_cache(-1, std::vector<int16_t>()), data_source(data_source) {
+struct sample::unzipped_cache_t {
+  using tile_t = std::shared_ptr<const std::vector<int16_t>>;
+
+  // whole tiles are kept by their index, blocks after them by the index and block
+  static uint32_t key(uint16_t index, uint32_t block = NO_BLOCK) {
+    return block == NO_BLOCK ? index : TILE_COUNT + index * BLOCK_COUNT + block;
+  }
+
+  // the tile, counts as a use of it. nullptr if it isnt in the cache, the caller then unzips it
+  // and inserts it or gives up on it. while another thread unzips it this waits for that thread
+  // so that threads sampling the same area dont all unzip the same tile at once
+  tile_t find(uint32_t index) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      auto found = tiles.find(index);
+      if (found != tiles.end()) {
+        ++hits;
+        lru.splice(lru.begin(), lru, found->second.second);
+        return found->second.first;
+      }
+      if (unzipping.insert(index).second) {
+        ++misses;
+        return nullptr;
+      }
+      unzipped.wait(lock);
+    }
+  }
+
+  // the tile couldnt be unzipped, the next one to find it will try again
+  void give_up(uint32_t index) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      unzipping.erase(index);
+    }
+    unzipped.notify_all();
+  }
+
+  // keeps the tile and drops the least recently used ones
+  tile_t insert(uint32_t index, tile_t tile) {
+    std::unique_lock<std::mutex> lock(mutex);
+    unzipping.erase(index);
+    auto inserted = tiles.emplace(index, std::make_pair(std::move(tile), lru.end()));
+    if (!inserted.second) {
+      return inserted.first->second.first;
+    }
+    inserted.first->second.second = lru.insert(lru.begin(), index);
+    pixels += inserted.first->second.first->size();
+    while (pixels > capacity && tiles.size() > 1) {
+      auto evicted = tiles.find(lru.back());
+      pixels -= evicted->second.first->size();
+      tiles.erase(evicted);
+      lru.pop_back();
+    }
+    auto kept = inserted.first->second.first;
+    lock.unlock();
+    unzipped.notify_all();
+    return kept;
+  }
+
+  std::mutex mutex;
+  // the tiles being unzipped and the signal for when one of them is done
+  std::unordered_set<uint32_t> unzipping;
+  std::condition_variable unzipped;
+  // how many pixels may be kept and how many are
+  size_t capacity;
+  size_t pixels = 0;
+  // the keys of the tiles, the most recently used first
+  std::list<uint32_t> lru;
+  std::unordered_map<uint32_t, std::pair<tile_t, std::list<uint32_t>::iterator>> tiles;
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+};
+
+::valhalla::skadi::sample::sample(const std::string& data_source, size_t cache_size)
+    : mapped_cache(TILE_COUNT), mapped_mutex(new std::mutex()), data_source(data_source) {
   // messy but needed
   while (this->data_source.size() &&
          this->data_source.back() == filesystem::path::preferred_separator) {
     this->data_source.pop_back();
   }
 
+  // samples of the same data share the unzipped tiles for as long as any of them is around
+  static std::mutex caches_mutex;
+  static std::unordered_map<std::string, std::weak_ptr<unzipped_cache_t>> caches;
+  {
+    std::lock_guard<std::mutex> lock(caches_mutex);
+    auto& cache = caches[this->data_source];
+    unzipped_cache = cache.lock();
+    if (!unzipped_cache) {
+      unzipped_cache = std::make_shared<unzipped_cache_t>();
+      unzipped_cache->capacity = 0;
+      cache = unzipped_cache;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(unzipped_cache->mutex);
+    unzipped_cache->capacity =
+        std::max<size_t>({unzipped_cache->capacity, cache_size * HGT_PIXELS, HGT_PIXELS});
+  }
+
   // check the directory for files that look like what we need
   auto files = get_files(data_source);
   for (const auto& f : files) {
     // make sure its a valid index
     format_t format = format_t::UNKNOWN;
     auto index = is_hgt(f, format);
-    if (index < mapped_cache.size() && format != format_t::UNKNOWN) {
+    // the faster formats win if a tile is there in several
+    if (index < mapped_cache.size() && format != format_t::UNKNOWN &&
+        format > mapped_cache[index].first) {
       auto size = file_size(f);
       if (format == format_t::RAW && size != HGT_BYTES) {
         LOG_WARN("Corrupt elevation data: " + f);
         continue;
       }
+      if (format == format_t::BLOCKED && !is_blocked(midgard::mem_map<char>(f, size).get(), size)) {
+        LOG_WARN("Corrupt elevation data: " + f);
+        continue;
+      }
       mapped_cache[index].first = format;
-      mapped_cache[index].second.map(f, size, POSIX_MADV_SEQUENTIAL);
+      mapped_cache[index].second.map(f, size,
+                                     format == format_t::BLOCKED ? POSIX_MADV_RANDOM
+                                                                 : POSIX_MADV_SEQUENTIAL);
     }
   }
 }
 
-const int16_t* sample::source(uint16_t index) const {
+sample::tile_t sample::source(uint16_t index) const {
+  tile_t tile{index, nullptr, nullptr, NO_BLOCK, nullptr};
   // bail if its out of bounds
   if (index >= TILE_COUNT) {
-    return nullptr;
+    return tile;
   }
 
   // if we dont have anything maybe its lazy loaded
   auto& mapped = mapped_cache[index];
-  if (mapped.second.get() == nullptr) {
-    auto f = data_source + get_hgt_file_name(index);
-    auto size = file_size(f);
-    if (size != HGT_BYTES) {
-      return nullptr;
+  {
+    std::lock_guard<std::mutex> lock(*mapped_mutex);
+    if (mapped.second.get() == nullptr) {
+      auto f = data_source + get_hgt_file_name(index);
+      auto size = file_size(f);
+      if (size != HGT_BYTES) {
+        return tile;
+      }
+      mapped.first = format_t::RAW;
+      mapped.second.map(f, size, POSIX_MADV_SEQUENTIAL);
     }
-    mapped.first = format_t::RAW;
-    mapped.second.map(f, size, POSIX_MADV_SEQUENTIAL);
   }
 
-  // we have it raw or we dont
+  // we have it raw or we dont, the maps live as long as we do
   if (mapped.first == format_t::RAW) {
-    return static_cast<const int16_t*>(static_cast<const void*>(mapped.second.get()));
+    tile.data = std::shared_ptr<const int16_t>(std::shared_ptr<const int16_t>(),
+                                               static_cast<const int16_t*>(static_cast<const void*>(
+                                                   mapped.second.get())));
+    return tile;
+  }
+
+  // the blocks are unzipped as they are needed
+  if (mapped.first == format_t::BLOCKED) {
+    tile.blocked = mapped.second.get();
+    return tile;
   }
 
   // if we have it already unzipped
-  if (unzipped_cache.first == index) {
-    return unzipped_cache.second.data();
+  auto unzipped = unzipped_cache->find(unzipped_cache_t::key(index));
+  if (!unzipped) {
+    // we have to unzip it, without holding up the others that are sampling
+    std::shared_ptr<std::vector<int16_t>> pixels(new std::vector<int16_t>(HGT_PIXELS));
+    if (!unzip(mapped.second.get(), mapped.second.size(), pixels->data(), pixels->size())) {
+      LOG_WARN("Corrupt compressed elevation data");
+      unzipped_cache->give_up(unzipped_cache_t::key(index));
+      return tile;
+    }
+    unzipped = unzipped_cache->insert(unzipped_cache_t::key(index), std::move(pixels));
   }
 
-  // for setting where to read compressed data from
-  auto src_func = [&mapped](z_stream& s) -> void {
-    s.next_in = static_cast<Byte*>(static_cast<void*>(mapped.second.get()));
-    s.avail_in = static_cast<unsigned int>(mapped.second.size());
-  };
+  // the data keeps the tile alive even if the cache drops it
+  tile.data = std::shared_ptr<const int16_t>(unzipped, unzipped->data());
+  return tile;
+}
 
-  // for setting where to write the uncompressed data to
-  auto dst_func = [this](z_stream& s) -> int {
-    unzipped_cache.second.resize(HGT_PIXELS);
-    s.next_out = static_cast<Byte*>(static_cast<void*>(unzipped_cache.second.data()));
-    s.avail_out = HGT_BYTES;
-    return Z_FINISH; // we know the output will hold all the input
-  };
+int16_t sample::blocked_pixel(tile_t& tile, size_t x, size_t y) const {
+  const size_t column = x / BLOCK_DIM, row = y / BLOCK_DIM;
+  const uint32_t block = row * BLOCKS_PER_ROW + column;
+  const size_t width = block_size(column, 1);
+
+  // find or unzip the block unless its the one we used last
+  if (block != tile.block) {
+    const auto key = unzipped_cache_t::key(tile.index, block);
+    auto unzipped = unzipped_cache->find(key);
+    if (!unzipped) {
+      const auto* offsets =
+          reinterpret_cast<const uint64_t*>(tile.blocked + sizeof(blocked_header_t));
+      std::shared_ptr<std::vector<int16_t>> pixels(
+          new std::vector<int16_t>(block_size(row, width)));
+      if (!unzip(tile.blocked + offsets[block], offsets[block + 1] - offsets[block],
+                 pixels->data(), pixels->size())) {
+        LOG_WARN("Corrupt compressed elevation data");
+        unzipped_cache->give_up(key);
+        return flip(NO_DATA_VALUE);
+      }
+      unzipped = unzipped_cache->insert(key, std::move(pixels));
+    }
+    tile.block = block;
+    tile.block_data = std::shared_ptr<const int16_t>(unzipped, unzipped->data());
+  }
+  return tile.block_data.get()[(y - row * BLOCK_DIM) * width + x - column * BLOCK_DIM];
+}
+
+bool sample::pack(const std::string& hgt_file, const std::string& blocked_file) {
+  // read the whole tile
+  std::vector<int16_t> pixels(HGT_PIXELS);
+  std::ifstream hgt(hgt_file, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(hgt)), std::istreambuf_iterator<char>());
+  if (!hgt.eof() && hgt.fail()) {
+    return false;
+  }
+  if (data.size() == HGT_BYTES) {
+    std::copy(data.begin(), data.end(), static_cast<char*>(static_cast<void*>(pixels.data())));
+  } else if (data.empty() || !unzip(data.data(), data.size(), pixels.data(), pixels.size())) {
+    return false;
+  }
 
-  // we have to unzip it
-  if (!baldr::inflate(src_func, dst_func)) {
-    LOG_WARN("Corrupt compressed elevation data");
-    unzipped_cache.first = -1;
-    return nullptr;
+  // compress each of the blocks on its own
+  blocked_header_t header{BLOCKED_MAGIC, BLOCKED_VERSION, BLOCK_DIM, BLOCK_COUNT};
+  std::vector<uint64_t> offsets{BLOCKED_DATA_OFFSET};
+  std::string blocks;
+  std::vector<int16_t> block;
+  for (size_t row = 0; row < BLOCKS_PER_ROW; ++row) {
+    for (size_t column = 0; column < BLOCKS_PER_ROW; ++column) {
+      const size_t width = block_size(column, 1);
+      block.clear();
+      for (size_t y = row * BLOCK_DIM; y < row * BLOCK_DIM + block_size(row, 1); ++y) {
+        const auto first = pixels.cbegin() + y * HGT_DIM + column * BLOCK_DIM;
+        block.insert(block.end(), first, first + width);
+      }
+
+      auto src_func = [&block](z_stream& s) -> int {
+        s.next_in = static_cast<Byte*>(static_cast<void*>(block.data()));
+        s.avail_in = static_cast<unsigned int>(block.size() * sizeof(int16_t));
+        return Z_FINISH;
+      };
+      std::vector<char> buffer(BLOCK_DIM * BLOCK_DIM * sizeof(int16_t));
+      const auto start = blocks.size();
+      auto dst_func = [&buffer, &blocks, start](z_stream& s) -> void {
+        blocks.append(buffer.data(), s.total_out - (blocks.size() - start));
+        s.next_out = static_cast<Byte*>(static_cast<void*>(buffer.data()));
+        s.avail_out = static_cast<unsigned int>(buffer.size());
+      };
+      if (!baldr::deflate(src_func, dst_func, Z_BEST_COMPRESSION, false)) {
+        return false;
+      }
+      offsets.push_back(BLOCKED_DATA_OFFSET + blocks.size());
+    }
   }
 
-  // update the simple cache
-  // TODO: LRU
-  unzipped_cache.first = index;
-  return unzipped_cache.second.data();
+  std::ofstream file(blocked_file, std::ios::binary | std::ios::trunc);
+  file.write(static_cast<const char*>(static_cast<const void*>(&header)), sizeof(header));
+  file.write(static_cast<const char*>(static_cast<const void*>(offsets.data())),
+             offsets.size() * sizeof(uint64_t));
+  file.write(blocks.data(), blocks.size());
+  return file.good();
+}
+
+uint64_t sample::cache_hits() const {
+  return unzipped_cache->hits;
+}
+
+uint64_t sample::cache_misses() const {
+  return unzipped_cache->misses;
 }
 
 template <class coord_t> double sample::get(const coord_t& coord) const {
+  tiles_t tiles;
+  return get(coord, tiles);
+}
+
+template <class coord_t> double sample::get(const coord_t& coord, tiles_t& tiles) const {
   // check the cache and load
   auto lon = std::floor(coord.first);
   auto lat = std::floor(coord.second);
-  auto index = static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
-
-  // get the proper source of the data
-  const auto* t = source(index);
-  if (t == nullptr) {
+  uint32_t index = static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
+
+  // get the proper source of the data unless this batch already has it, postings are mostly in
+  // the same tile as the one before them and there are only ever a few tiles in a batch
+  if (tiles.empty() || tiles.back().index != index) {
+    auto found = std::find_if(tiles.begin(), tiles.end(),
+                              [index](const tile_t& tile) { return tile.index == index; });
+    if (found == tiles.end()) {
+      tiles.emplace_back(index < TILE_COUNT ? source(index)
+                                            : tile_t{index, nullptr, nullptr, NO_BLOCK, nullptr});
+    } else {
+      std::iter_swap(found, tiles.end() - 1);
+    }
+  }
+  auto& tile = tiles.back();
+  const auto* t = tile.data.get();
+  if (t == nullptr && tile.blocked == nullptr) {
     return NO_DATA_VALUE;
   }
+  // the pixels of a whole tile or of the blocks of a blocked one
+  auto pixel = [this, t, &tile](size_t x, size_t y) {
+    return flip(t ? t[y * HGT_DIM + x] : blocked_pixel(tile, x, y));
+  };
 
   // figure out what row and column we need from the array of data
   // NOTE: data is arranged from upper left to bottom right, so y is flipped
@@ -196,8 +467,8 @@ template <class coord_t> double sample::get(const coord_t& coord) const {
 
   // values
   double adjust = 0;
-  auto a = flip(t[y * HGT_DIM + x]);
-  auto b = flip(t[y * HGT_DIM + x + 1]);
+  auto a = pixel(x, y);
+  auto b = pixel(x + 1, y);
   if (out_of_range(a)) {
     a_coef = 0;
   }
@@ -213,8 +484,8 @@ template <class coord_t> double sample::get(const coord_t& coord) const {
   // only need the second part if you aren't right on the row
   // this also protects from a corner case where you sample past the end of the image
   if (y < HGT_DIM - 1) {
-    auto c = flip(t[(y + 1) * HGT_DIM + x]);
-    auto d = flip(t[(y + 1) * HGT_DIM + x + 1]);
+    auto c = pixel(x, y + 1);
+    auto d = pixel(x + 1, y + 1);
     if (out_of_range(c)) {
       c_coef = 0;
     }
@@ -237,12 +508,26 @@ template <class coord_t> double sample::get(const coord_t& coord) const {
 template <class coords_t> std::vector<double> sample::get_all(const coords_t& coords) const {
   std::vector<double> values;
   values.reserve(coords.size());
+  tiles_t tiles;
   for (const auto& coord : coords) {
-    values.emplace_back(get(coord));
+    values.emplace_back(get(coord, tiles));
   }
   return values;
 }
 
+template <class coords_t>
+std::vector<double>
+sample::get_resampled(const coords_t& polyline, double interval, bool preserve) const {
+  std::vector<double> values;
+  tiles_t tiles;
+  midgard::resample_spherical_polyline(polyline, interval, preserve,
+                                       [this, &values,
+                                        &tiles](const typename coords_t::value_type& coord) {
+                                         values.emplace_back(get(coord, tiles));
+                                       });
+  return values;
+}
+
 double sample::get_no_data_value() {
   return NO_DATA_VALUE;
 }
@@ -300,6 +585,22 @@ template std::vector<double>
 sample::get_all<std::list<midgard::Point2>>(const std::list<midgard::Point2>&) const;
 template std::vector<double>
 sample::get_all<std::vector<midgard::Point2>>(const std::vector<midgard::Point2>&) const;
+template std::vector<double>
+sample::get_resampled<std::vector<midgard::PointLL>>(const std::vector<midgard::PointLL>&,
+                                                     double,
+                                                     bool) const;
+template std::vector<double>
+sample::get_resampled<std::list<midgard::PointLL>>(const std::list<midgard::PointLL>&,
+                                                   double,
+                                                   bool) const;
+template std::vector<double>
+sample::get_resampled<std::vector<midgard::Point2>>(const std::vector<midgard::Point2>&,
+                                                    double,
+                                                    bool) const;
+template std::vector<double>
+sample::get_resampled<std::list<midgard::Point2>>(const std::list<midgard::Point2>&,
+                                                  double,
+                                                  bool) const;
 template uint16_t
 sample::get_tile_index<std::pair<double, double>>(const std::pair<double, double>& coord);
 template uint16_t
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
@@ -17,6 +18,7 @@ namespace {
 // Defaults thresholds
 float kAtMostLonger = 1.25f; // stretch threshold
 float kAtMostShared = 0.75f; // sharing threshold
+float kEstimatedSharingMargin = 0.05f; // how far an estimate may be over the sharing threshold
 // float kAtLeastOptimal = 0.2f; // local optimality threshold
 } // namespace
 
@@ -56,44 +58,82 @@ void filter_alternates_by_stretch(std::vector<CandidateConnection>& connections)
   connections.erase(new_end, connections.end());
 }
 
+// Caches the edge ids of the chosen paths as sorted vectors, including edges that were superseded
+// by a shortcut edge. We need to expand the shortcut edges on the chosen paths.
+//
+// Note we don't need to expand the candidate path's shortcuts because:
+// * if a candidate path took an edge that the best path shortcutted, we'll find it in the best
+// path's recovered edges
+// * if a candidate path took the same shortcut as the best path, we'll count it as shared
+// * if a candidate path took a different shortcut than the best path, then it's not shared and we
+// don't need to count it anyway
+// * the only case to watch out for is overlapping shortcuts, in which case we won't count
+// the overlap as shared (TODO verify that shortcuts never overlap)
+void update_shared_edgeids(GraphReader& graphreader,
+                           std::vector<std::vector<GraphId>>& shared_edgeids,
+                           const std::vector<std::vector<PathInfo>>& paths) {
+  if (paths.size() > shared_edgeids.size())
+    shared_edgeids.resize(paths.size());
+
+  for (size_t i = 0; i < paths.size(); ++i) {
+    auto& shared = shared_edgeids[i];
+    if (!shared.empty()) {
+      continue;
+    }
+    for (const auto& pi : paths[i]) {
+      // expand shortcut edge into its constituent edges
+      // if this edge isn't a shortcut RecoverShortcut is a noop
+      auto expanded_edges = graphreader.RecoverShortcut(pi.edgeid);
+      // even if it's a shortcut edge, add it to the set
+      shared.push_back(pi.edgeid);
+      // and add any recovered edges to the set
+      shared.insert(shared.end(), expanded_edges.begin(), expanded_edges.end());
+    }
+    std::sort(shared.begin(), shared.end());
+    shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+  }
+}
+
+// Estimated Limited Sharing. The same test on the edges of a candidate before its path is formed,
+// their durations come from the costs of the edge labels without the shifts of the transition costs
+// and the partial destination edge made when forming the path. Only the candidates which clearly
+// share too much are thrown out, the others are left to the exact test.
+bool validate_alternate_by_estimated_sharing(
+    const std::vector<std::vector<GraphId>>& shared_edgeids,
+    const std::vector<std::pair<GraphId, float>>& candidate_edges,
+    float at_most_shared) {
+  for (const auto& shared : shared_edgeids) {
+    float shared_duration = 0.f, total_duration = 0.f;
+    for (const auto& edge : candidate_edges) {
+      total_duration += edge.second;
+      if (std::binary_search(shared.begin(), shared.end(), edge.first)) {
+        shared_duration += edge.second;
+      }
+    }
+    if (total_duration > 0.f &&
+        (shared_duration / total_duration) > at_most_shared + kEstimatedSharingMargin) {
+      LOG_DEBUG("Candidate alternate rejected before forming its path");
+      return false;
+    }
+  }
+  return true;
+}
+
 // Limited Sharing. Compare duration of edge segments shared between optimal path and
 // candidate path. If they share more than kAtMostShared throw out this alternate.
 bool validate_alternate_by_sharing(GraphReader& graphreader,
-                                   std::vector<std::unordered_set<GraphId>>& shared_edgeids,
+                                   std::vector<std::vector<GraphId>>& shared_edgeids,
                                    const std::vector<std::vector<PathInfo>>& paths,
                                    const std::vector<PathInfo>& candidate_path,
                                    float at_most_shared) {
 
   // we will calculate the overlap in edge duration between the candidate_path and paths (paths is a
   // vector of the fastest path + any alternates already chosen)
-  if (paths.size() > shared_edgeids.size())
-    shared_edgeids.resize(paths.size());
+  update_shared_edgeids(graphreader, shared_edgeids, paths);
 
   // we check each accepted path against the candidate
-  for (int i = 0; i < paths.size(); ++i) {
-    // cache edge ids encountered on the current best path, including edges that were superseded by a
-    // shortcut edge. we need to expand the shortcut edges on the current best path.
-    //
-    // Note we don't need to expand the candidate path's shortcuts because:
-    // * if a candidate path took an edge that the best path shortcutted, we'll find it in the best
-    // path's recovered edges
-    // * if a candidate path took the same shortcut as the best path, we'll count it as shared
-    // * if a candidate path took a different shortcut than the best path, then it's not shared and we
-    // don't need to count it anyway
-    // * the only case to watch out for is overlapping shortcuts, in which case we won't count
-    // the overlap as shared (TODO verify that shortcuts never overlap)
-    auto& shared = shared_edgeids[i];
-    if (shared.empty()) {
-      for (const auto& pi : paths[i]) {
-        // expand shortcut edge into its constituent edges
-        // if this edge isn't a shortcut RecoverShortcut is a noop
-        auto expanded_edges = graphreader.RecoverShortcut(pi.edgeid);
-        // even if it's a shortcut edge, add it to the set
-        shared.insert(pi.edgeid);
-        // and add any recovered edges to the set
-        shared.insert(expanded_edges.begin(), expanded_edges.end());
-      }
-    }
+  for (size_t i = 0; i < paths.size(); ++i) {
+    const auto& shared = shared_edgeids[i];
 
     // if an edge on the candidate_path is encountered that is also on one of the existing paths,
     // we count it as a "shared" edge
@@ -103,7 +143,7 @@ bool validate_alternate_by_sharing(GraphReader& graphreader,
                                 ? cpi.elapsed_cost.secs
                                 : cpi.elapsed_cost.secs - (&cpi - 1)->elapsed_cost.secs;
       total_duration += duration;
-      if (shared.find(cpi.edgeid) != shared.end()) {
+      if (std::binary_search(shared.begin(), shared.end(), cpi.edgeid)) {
         shared_duration += duration;
       }
     }
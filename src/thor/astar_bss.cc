@@ -29,9 +29,10 @@ constexpr uint64_t kInitialEdgeLabelCount = 500000;
 constexpr uint32_t kMaxIterationsWithoutConvergence = 200000;
 
 // Default constructor
-AStarBSSAlgorithm::AStarBSSAlgorithm()
-    : PathAlgorithm(), mode_(TravelMode::kDrive), travel_type_(0), adjacencylist_(nullptr),
-      max_label_count_(std::numeric_limits<uint32_t>::max()) {
+AStarBSSAlgorithm::AStarBSSAlgorithm(const label_limits_t& label_limits)
+    : PathAlgorithm(label_limits), mode_(TravelMode::kDrive), travel_type_(0), adjacencylist_(nullptr),
+      max_label_count_(std::numeric_limits<uint32_t>::max()), station_walk_distance_(0),
+      access_(label_limits), egress_(label_limits) {
 }
 
 // Destructor
@@ -43,11 +44,15 @@ AStarBSSAlgorithm::~AStarBSSAlgorithm() {
 void AStarBSSAlgorithm::Clear() {
   // Clear the edge labels and destination list. Reset the adjacency list
   // and clear edge status.
-  edgelabels_.clear();
+  label_limits_.trim(edgelabels_);
   destinations_.clear();
   adjacencylist_.reset();
   pedestrian_edgestatus_.clear();
   bicycle_edgestatus_.clear();
+  access_.Clear();
+  access_.stations.clear();
+  egress_.Clear();
+  egress_.stations.clear();
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -76,7 +81,7 @@ void AStarBSSAlgorithm::Init(const midgard::PointLL& origll, const midgard::Poin
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects.
   // TODO - reserve based on estimate based on distance and route type.
-  edgelabels_.reserve(kInitialEdgeLabelCount);
+  edgelabels_.reserve(label_limits_.reservation(kInitialEdgeLabelCount));
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) { return edgelabels_[label].sortcost(); };
@@ -263,6 +268,17 @@ AStarBSSAlgorithm::GetBestPath(valhalla::Location& origin,
   Init(origin_new, destination_new);
   float mindist = pedestrian_astarheuristic_.GetDistance(origin_new);
 
+  // Far enough apart the route bikes between the stations walked to from both ends, if there are
+  // none that close it is searched for as a whole from the start
+  if (station_walk_distance_ > 0 && mindist > 2.0f * station_walk_distance_) {
+    auto path = GetStationPath(origin, destination, graphreader, mode_costing);
+    if (!path.empty()) {
+      return {std::move(path)};
+    }
+    edgelabels_.clear();
+    Init(origin_new, destination_new);
+  }
+
   // Initialize the origin and destination locations. Initialize the
   // destination first in case the origin edge includes a destination edge.
   uint32_t density = SetDestination(graphreader, destination);
@@ -281,6 +297,8 @@ AStarBSSAlgorithm::GetBestPath(valhalla::Location& origin,
       (*interrupt)();
     }
     total_labels = current_labels;
+    label_limits_.check(edgelabels_, adjacencylist_, pedestrian_edgestatus_,
+                        bicycle_edgestatus_);
 
     // Abort if max label count is exceeded
     if (total_labels > max_label_count_) {
@@ -347,6 +365,166 @@ AStarBSSAlgorithm::GetBestPath(valhalla::Location& origin,
   return {}; // Should never get here
 }
 
+void AStarBSSAlgorithm::StationWalks::Walk(const valhalla::Location& location,
+                                           const bool forward,
+                                           const uint32_t max_distance,
+                                           GraphReader& graphreader,
+                                           const mode_costing_t& mode_costing) {
+  Clear();
+  stations.clear();
+  max_distance_ = max_distance;
+  google::protobuf::RepeatedPtrField<valhalla::Location> locations;
+  locations.Add()->CopyFrom(location);
+  if (forward) {
+    Compute(locations, graphreader, mode_costing, TravelMode::kPedestrian);
+  } else {
+    ComputeReverse(locations, graphreader, mode_costing, TravelMode::kPedestrian);
+  }
+}
+
+void AStarBSSAlgorithm::StationWalks::ExpandingNode(GraphReader& /*graphreader*/,
+                                                    graph_tile_ptr /*tile*/,
+                                                    const NodeInfo* node,
+                                                    const EdgeLabel& current,
+                                                    const EdgeLabel* /*previous*/) {
+  if (node->type() != NodeType::kBikeShare) {
+    return;
+  }
+  auto index = edgestatus_.Get(current.edgeid()).index();
+  auto inserted = stations.emplace(current.endnode(), index);
+  if (!inserted.second &&
+      current.cost().cost < bdedgelabels_[inserted.first->second].cost().cost) {
+    inserted.first->second = index;
+  }
+}
+
+ExpansionRecommendation
+AStarBSSAlgorithm::StationWalks::ShouldExpand(GraphReader& /*graphreader*/,
+                                              const EdgeLabel& pred,
+                                              const InfoRoutingType /*route_type*/) {
+  return pred.path_distance() > max_distance_ ? ExpansionRecommendation::prune_expansion
+                                              : ExpansionRecommendation::continue_expansion;
+}
+
+void AStarBSSAlgorithm::StationWalks::GetExpansionHints(uint32_t& bucket_count,
+                                                        uint32_t& edge_label_reservation) const {
+  bucket_count = 20000;
+  edge_label_reservation = 100000;
+}
+
+std::vector<PathInfo> AStarBSSAlgorithm::GetStationPath(const valhalla::Location& origin,
+                                                        const valhalla::Location& destination,
+                                                        GraphReader& graphreader,
+                                                        const sif::mode_costing_t& mode_costing) {
+  access_.Walk(origin, true, station_walk_distance_, graphreader, mode_costing);
+  egress_.Walk(destination, false, station_walk_distance_, graphreader, mode_costing);
+  if (access_.stations.empty() || egress_.stations.empty()) {
+    return {};
+  }
+
+  // Only the bike is ridden from here, to any of the stations around the destination. So the
+  // heuristic is of the bicycle alone and to the circle the stations are in, it stays an
+  // underestimate that way and is a lot closer than the one shared with walking
+  float radius = 0.0f;
+  for (const auto& station : egress_.stations) {
+    graph_tile_ptr tile = graphreader.GetGraphTile(station.first);
+    if (tile != nullptr) {
+      radius = std::max(radius, pedestrian_astarheuristic_.GetDistance(
+                                    tile->get_node_ll(station.first)));
+    }
+  }
+  midgard::PointLL destination_ll(destination.path_edges(0).ll().lng(),
+                                  destination.path_edges(0).ll().lat());
+  bicycle_astarheuristic_.Init(destination_ll, bicycle_costing_->AStarCostFactor(), radius);
+
+  // The walks from the origin keep their indices so that the path goes back through them, then
+  // the bike is rented at every station they reached
+  edgelabels_.clear();
+  for (const auto& label : access_.labels()) {
+    edgelabels_.emplace_back(label);
+  }
+  std::pair<int32_t, float> best_path = std::make_pair(-1, 0.0f);
+  for (const auto& station : access_.stations) {
+    const EdgeLabel pred = edgelabels_[station.second];
+    ExpandForward(graphreader, station.first, pred, station.second, false, true,
+                  TravelMode::kBicycle, destination, best_path);
+  }
+
+  // Returning the bike at a station walked from to the destination completes a path, once the
+  // cheapest of them costs no more than whatever is left to expand it is the best one
+  uint32_t best_label = kInvalidLabel;
+  uint32_t best_walk = kInvalidLabel;
+  Cost best_cost(std::numeric_limits<float>::max(), 0.0f);
+  Cost best_return;
+  size_t total_labels = 0;
+  while (true) {
+    // Allow this process to be aborted
+    size_t current_labels = edgelabels_.size();
+    if (interrupt &&
+        total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
+      (*interrupt)();
+    }
+    total_labels = current_labels;
+    label_limits_.check(edgelabels_, adjacencylist_, pedestrian_edgestatus_,
+                        bicycle_edgestatus_);
+    if (total_labels > max_label_count_) {
+      return {};
+    }
+
+    uint32_t predindex = adjacencylist_->pop();
+    if (predindex == kInvalidLabel) {
+      break;
+    }
+    EdgeLabel pred = edgelabels_[predindex];
+    if (pred.sortcost() >= best_cost.cost) {
+      break;
+    }
+    bicycle_edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+    auto station = egress_.stations.find(pred.endnode());
+    if (station != egress_.stations.end()) {
+      const auto& walk = egress_.labels()[station->second];
+      graph_tile_ptr tile = graphreader.GetGraphTile(pred.endnode());
+      graph_tile_ptr edge_tile = tile;
+      const DirectedEdge* edge = graphreader.directededge(walk.opp_edgeid(), edge_tile);
+      if (tile != nullptr && edge != nullptr) {
+        Cost returned = pedestrian_costing_->TransitionCost(edge, tile->node(pred.endnode()), pred);
+        Cost cost = pred.cost() + returned + walk.cost();
+        if (cost.cost < best_cost.cost) {
+          best_label = predindex;
+          best_walk = station->second;
+          best_cost = cost;
+          best_return = returned;
+        }
+      }
+    }
+
+    // Stay on the bike at the stations, it is only returned at those around the destination
+    ExpandForward(graphreader, pred.endnode(), pred, predindex, false, true, TravelMode::kBicycle,
+                  destination, best_path);
+  }
+  if (best_label == kInvalidLabel) {
+    return {};
+  }
+
+  // The reverse labels of the walk to the destination hold the cost from the start of their edge,
+  // the elapsed cost at the end of an edge is what is left after the next one
+  auto path = FormPath(graphreader, best_label);
+  Cost transition_cost = best_return;
+  for (auto index = best_walk; index != kInvalidLabel;) {
+    const auto& label = egress_.labels()[index];
+    index = label.predecessor();
+    Cost elapsed = best_cost - (index == kInvalidLabel ? Cost() : egress_.labels()[index].cost());
+    path.emplace_back(TravelMode::kPedestrian, elapsed, label.opp_edgeid(), 0,
+                      label.restriction_idx(), transition_cost);
+    transition_cost = label.transition_cost();
+    if (label.use() == Use::kFerry) {
+      has_ferry_ = true;
+    }
+  }
+  return path;
+}
+
 // Add an edge at the origin to the adjacency list
 void AStarBSSAlgorithm::SetOrigin(GraphReader& graphreader,
                                   valhalla::Location& origin,
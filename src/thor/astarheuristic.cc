@@ -0,0 +1,50 @@
+#include "thor/astarheuristic.h"
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace thor {
+
+constexpr float AStarHeuristic::kUnreachable;
+
+void AStarHeuristic::InitLandmarks(const AltLandmarks* landmarks,
+                                   GraphReader& reader,
+                                   const valhalla::Location& location,
+                                   const bool toward) {
+  landmarks_ = nullptr;
+  if (!landmarks || location.path_edges_size() == 0) {
+    return;
+  }
+
+  // Searching toward the location it is reached at the start of one of its edges, searching
+  // away from it the search leaves by the end of one. The bounds have to hold for all of them
+  // so they take the closest of the nodes on one side and the farthest on the other.
+  const uint32_t count = landmarks->count();
+  from_bounds_.assign(count, toward ? kUnreachable : 0.0f);
+  to_bounds_.assign(count, toward ? 0.0f : kUnreachable);
+  for (const auto& edge : location.path_edges()) {
+    graph_tile_ptr tile;
+    GraphId node;
+    if (toward) {
+      node = reader.edge_startnode(GraphId(edge.graph_id()), tile);
+    } else {
+      const DirectedEdge* directededge = reader.directededge(GraphId(edge.graph_id()), tile);
+      node = directededge ? directededge->endnode() : GraphId();
+    }
+    const float* distances = node.Is_Valid() ? landmarks->distances(node) : nullptr;
+    if (!distances) {
+      return;
+    }
+    for (uint32_t l = 0; l < count; ++l) {
+      const float from = distances[l];
+      const float to = distances[count + l];
+      from_bounds_[l] = toward ? std::min(from_bounds_[l], from) : std::max(from_bounds_[l], from);
+      to_bounds_[l] = toward ? std::max(to_bounds_[l], to) : std::min(to_bounds_[l], to);
+    }
+  }
+  landmarks_ = landmarks;
+  sign_ = toward ? -1.0f : 1.0f;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -62,6 +62,7 @@ const std::unordered_map<std::string, bool> AttributesController::kDefaultAttrib
     {kEdgeMaxUpwardGrade, true},
     {kEdgeMaxDownwardGrade, true},
     {kEdgeMeanElevation, true},
+    {kEdgeElevation, false},
     {kEdgeLaneCount, true},
     {kEdgeLaneConnectivity, true},
     {kEdgeCycleLane, true},
@@ -75,6 +76,7 @@ const std::unordered_map<std::string, bool> AttributesController::kDefaultAttrib
     {kEdgeDestinationOnly, true},
     {kEdgeIsUrban, false},
     {kEdgeTaggedNames, true},
+    {kEdgeTurnLanes, true},
 
     // Node keys
     {kIncidents, false},
@@ -0,0 +1,57 @@
+#include "thor/batch_recost.h"
+#include "sif/recost.h"
+
+#include <limits>
+#include <stdexcept>
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace thor {
+
+BatchRecost RecostPaths(const std::vector<std::vector<GraphId>>& paths,
+                        const std::vector<sif::cost_ptr_t>& costings,
+                        GraphReader& reader,
+                        ExpansionPool* pool,
+                        const TimeInfo& time_info,
+                        const bool invariant) {
+  BatchRecost batch;
+  batch.path_count = paths.size();
+  const size_t size = paths.size() * costings.size();
+  batch.times.assign(size, std::numeric_limits<float>::quiet_NaN());
+  batch.costs.assign(size, std::numeric_limits<float>::quiet_NaN());
+  batch.distances.assign(size, std::numeric_limits<float>::quiet_NaN());
+
+  // Each path is recosted with all the costings in a row so they find its tiles in the cache
+  auto work = [&](size_t p, size_t, GraphReader& thread_reader) {
+    if (paths[p].empty()) {
+      return;
+    }
+    for (size_t c = 0; c < costings.size(); ++c) {
+      try {
+        auto label = sif::recost_forward(thread_reader, *costings[c], paths[p], 0.f, 1.f, time_info,
+                                         invariant);
+        const size_t index = c * paths.size() + p;
+        batch.times[index] = label.cost().secs;
+        batch.costs[index] = label.cost().cost;
+        batch.distances[index] = label.path_distance();
+      } catch (const std::runtime_error&) {
+        // the costing cant take this path, leave it NaN
+      }
+    }
+    if (thread_reader.OverCommitted()) {
+      thread_reader.Trim();
+    }
+  };
+  if (pool && pool->size() > 1) {
+    pool->Run(paths.size(), work, reader);
+  } else {
+    for (size_t p = 0; p < paths.size(); ++p) {
+      work(p, 0, reader);
+    }
+  }
+  return batch;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -4,10 +4,16 @@
 #include "baldr/graphid.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/tracepoint.h"
 #include "sif/edgelabel.h"
 #include "thor/alternates.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <mutex>
+#include <thread>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -23,13 +29,89 @@ constexpr uint64_t kInitialEdgeLabelCountBD = 1000000;
 // cost creates large performance drops - so perhaps some other metric can be found?
 constexpr float kThresholdDelta = 420.0f;
 
+// How long the helper thread polls for the next expansion before it goes to sleep. The search hands
+// it work every other step so sleeping right away would mostly measure the wake up latency
+constexpr uint32_t kHelperSpinCount = 4096;
+
 } // namespace
 
 namespace valhalla {
 namespace thor {
 
+// Runs one expansion at a time for the search on its own thread
+struct BidirectionalAStar::expansion_thread_t {
+  explicit expansion_thread_t(const std::shared_ptr<GraphReader>& graphreader)
+      : reader(graphreader), busy(false), done(false), thread(&expansion_thread_t::run, this) {
+  }
+
+  ~expansion_thread_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+    }
+    signal.notify_one();
+    thread.join();
+  }
+
+  // hands the thread the next expansion, the previous one must have been waited for
+  void start(std::function<void()> work) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      task = std::move(work);
+      busy.store(true, std::memory_order_release);
+    }
+    signal.notify_one();
+  }
+
+  // blocks until the current expansion is finished and rethrows whatever it threw
+  void wait(bool rethrow = true) {
+    while (busy.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+    if (error) {
+      auto e = error;
+      error = nullptr;
+      if (rethrow) {
+        std::rethrow_exception(e);
+      }
+    }
+  }
+
+  void run() {
+    while (true) {
+      for (uint32_t i = 0; i < kHelperSpinCount && !busy.load(std::memory_order_acquire); ++i) {
+      }
+      std::function<void()> work;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        signal.wait(lock, [this]() { return task || done; });
+        if (done) {
+          return;
+        }
+        work = std::move(task);
+        task = nullptr;
+      }
+      try {
+        work();
+      } catch (...) { error = std::current_exception(); }
+      busy.store(false, std::memory_order_release);
+    }
+  }
+
+  std::shared_ptr<GraphReader> reader;
+  DateTime::tz_sys_info_cache_t tz_cache;
+  std::mutex mutex;
+  std::condition_variable signal;
+  std::function<void()> task;
+  std::exception_ptr error;
+  std::atomic<bool> busy;
+  bool done;
+  std::thread thread;
+};
+
 // Default constructor
-BidirectionalAStar::BidirectionalAStar() : PathAlgorithm() {
+BidirectionalAStar::BidirectionalAStar(const label_limits_t& label_limits)
+    : PathAlgorithm(label_limits), record_forward_(false), record_reverse_(false) {
   threshold_ = 0;
   mode_ = TravelMode::kDrive;
   access_mode_ = kAutoAccess;
@@ -43,12 +125,27 @@ BidirectionalAStar::BidirectionalAStar() : PathAlgorithm() {
 BidirectionalAStar::~BidirectionalAStar() {
 }
 
+// Expand the two directions concurrently using the supplied graph reader on the helper thread
+void BidirectionalAStar::EnableParallelExpansion(const std::shared_ptr<GraphReader>& reader) {
+  expansion_thread_.reset(new expansion_thread_t(reader));
+}
+
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
-  edgelabels_forward_.clear();
-  edgelabels_reverse_.clear();
-  adjacencylist_forward_.reset();
-  adjacencylist_reverse_.reset();
+  if (expansion_thread_) {
+    expansion_thread_->wait(false);
+    expansion_thread_->reader->Refresh();
+    if (expansion_thread_->reader->OverCommitted()) {
+      expansion_thread_->reader->Trim();
+    }
+  }
+  replaced_labels_.clear();
+  record_forward_ = record_reverse_ = false;
+  VALHALLA_TRACE3(path_labels, name(), edgelabels_forward_.size(), edgelabels_reverse_.size());
+  label_limits_.trim(edgelabels_forward_);
+  label_limits_.trim(edgelabels_reverse_);
+  label_limits_.trim(adjacencylist_forward_);
+  label_limits_.trim(adjacencylist_reverse_);
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
 
@@ -66,19 +163,28 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
 
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects
-  edgelabels_forward_.reserve(kInitialEdgeLabelCountBD);
-  edgelabels_reverse_.reserve(kInitialEdgeLabelCountBD);
+  edgelabels_forward_.reserve(label_limits_.reservation(kInitialEdgeLabelCountBD));
+  edgelabels_reverse_.reserve(label_limits_.reservation(kInitialEdgeLabelCountBD));
 
   // Construct adjacency list and initialize edge status lookup.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
+  // the lists of the previous search are reused, their buckets are already allocated
   float mincostf = astarheuristic_forward_.Get(origll);
-  adjacencylist_forward_.reset(
-      new DoubleBucketQueue<BDEdgeLabel>(mincostf, range, bucketsize, edgelabels_forward_));
+  if (adjacencylist_forward_) {
+    adjacencylist_forward_->reuse(mincostf, range, bucketsize);
+  } else {
+    adjacencylist_forward_.reset(
+        new DoubleBucketQueue<BDEdgeLabel>(mincostf, range, bucketsize, edgelabels_forward_));
+  }
   float mincostr = astarheuristic_reverse_.Get(destll);
-  adjacencylist_reverse_.reset(
-      new DoubleBucketQueue<BDEdgeLabel>(mincostr, range, bucketsize, edgelabels_reverse_));
+  if (adjacencylist_reverse_) {
+    adjacencylist_reverse_->reuse(mincostr, range, bucketsize);
+  } else {
+    adjacencylist_reverse_.reset(
+        new DoubleBucketQueue<BDEdgeLabel>(mincostr, range, bucketsize, edgelabels_reverse_));
+  }
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
 
@@ -262,6 +368,9 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
   if (meta.edge_status->set() == EdgeSet::kTemporary) {
     BDEdgeLabel& lab = edgelabels_forward_[meta.edge_status->index()];
     if (newcost.cost < lab.cost().cost) {
+      if (record_forward_) {
+        replaced_labels_.emplace_back(meta.edge_status->index(), lab);
+      }
       float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
       adjacencylist_forward_->decrease(meta.edge_status->index(), newsortcost);
       lab.Update(pred_idx, newcost, newsortcost, transition_cost, restriction_idx);
@@ -270,6 +379,11 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
     return true;
   }
 
+  // The frontier is moving into another tile, start loading the ones around it
+  if (meta.edge->leaves_tile()) {
+    graphreader.PrefetchNeighbors(meta.edge->endnode());
+  }
+
   // Get end node tile (skip if tile is not found) and opposing edge Id
   graph_tile_ptr t2 =
       meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
@@ -282,7 +396,8 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
   // end node of the directed edge.
   float dist = 0.0f;
   float sortcost =
-      newcost.cost + astarheuristic_forward_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+      newcost.cost + astarheuristic_forward_.Get(meta.edge->endnode(),
+                                                 t2->get_node_ll(meta.edge->endnode()), dist);
 
   // Add edge label, add to the adjacency list and set edge status
   uint32_t idx = edgelabels_forward_.size();
@@ -450,6 +565,11 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
     return false;
   }
 
+  // The frontier is moving into another tile, start loading the ones around it
+  if (meta.edge->leaves_tile()) {
+    graphreader.PrefetchNeighbors(meta.edge->endnode());
+  }
+
   // Get end node tile, opposing edge Id, and opposing directed edge.
   graph_tile_ptr t2 =
       meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
@@ -485,6 +605,9 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   if (meta.edge_status->set() == EdgeSet::kTemporary) {
     BDEdgeLabel& lab = edgelabels_reverse_[meta.edge_status->index()];
     if (newcost.cost < lab.cost().cost) {
+      if (record_reverse_) {
+        replaced_labels_.emplace_back(meta.edge_status->index(), lab);
+      }
       float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
       adjacencylist_reverse_->decrease(meta.edge_status->index(), newsortcost);
       lab.Update(pred_idx, newcost, newsortcost, transition_cost, restriction_idx);
@@ -497,7 +620,8 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   // end node of the directed edge.
   float dist = 0.0f;
   float sortcost =
-      newcost.cost + astarheuristic_reverse_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+      newcost.cost + astarheuristic_reverse_.Get(meta.edge->endnode(),
+                                                 t2->get_node_ll(meta.edge->endnode()), dist);
 
   // Add edge label, add to the adjacency list and set edge status
   uint32_t idx = edgelabels_reverse_.size();
@@ -538,6 +662,8 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   PointLL origin_new(origin.path_edges(0).ll().lng(), origin.path_edges(0).ll().lat());
   PointLL destination_new(destination.path_edges(0).ll().lng(), destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
+  astarheuristic_forward_.InitLandmarks(landmarks_, graphreader, destination, true);
+  astarheuristic_reverse_.InitLandmarks(landmarks_, graphreader, origin, false);
 
   // Get time information for forward and backward searches
   bool invariant = options.has_date_time_type() && options.date_time_type() == Options::invariant;
@@ -574,11 +700,46 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   BDEdgeLabel fwd_pred, rev_pred;
   bool expand_forward = true;
   bool expand_reverse = true;
+
+  // When expanding in parallel the held predecessor of the other direction is expanded on the
+  // helper thread while this thread expands the current one. Each expansion only touches the state
+  // of its own direction and reads the other direction's only after the helper is done, so the
+  // steps merge into the same order the single threaded search takes
+  expansion_thread_t* helper = expansion_callback_ ? nullptr : expansion_thread_.get();
+  bool forward_ahead = false;
+  bool reverse_ahead = false;
+  auto helper_forward_time_info = forward_time_info;
+  auto helper_reverse_time_info = reverse_time_info;
+  if (helper) {
+    helper_forward_time_info.tz_cache = &helper->tz_cache;
+    helper_reverse_time_info.tz_cache = &helper->tz_cache;
+  }
+  // Don't leave the helper running on our state if an expansion throws
+  struct helper_guard_t {
+    expansion_thread_t* helper;
+    ~helper_guard_t() {
+      if (helper) {
+        helper->wait(false);
+      }
+    }
+  } helper_guard{helper};
+  // The search may end before it gets to an expansion done ahead of time
+  auto form_path = [&]() {
+    RestoreReplacedLabels();
+    return FormPath(graphreader, options, origin, destination);
+  };
+
   while (true) {
+    if (helper) {
+      helper->wait();
+    }
+
     // Allow this process to be aborted
     if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
       (*interrupt)();
     }
+    label_limits_.check(edgelabels_forward_, edgelabels_reverse_, adjacencylist_forward_,
+                        adjacencylist_reverse_, edgestatus_forward_, edgestatus_reverse_);
 
     // Get the next predecessor (based on which direction was expanded in prior step)
     if (expand_forward) {
@@ -588,13 +749,14 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
 
         // Terminate if the cost threshold has been exceeded.
         if (fwd_pred.sortcost() + cost_diff_ > threshold_) {
-          return FormPath(graphreader, options, origin, destination);
+          return form_path();
         }
 
         // Check if the edge on the forward search connects to a settled edge on the
         // reverse search tree. Do not expand further past this edge since it will just
-        // result in other connections.
-        if (edgestatus_reverse_.Get(fwd_pred.opp_edgeid()).set() == EdgeSet::kPermanent) {
+        // result in other connections. An edge settled ahead of time isn't settled yet.
+        if (edgestatus_reverse_.Get(fwd_pred.opp_edgeid()).set() == EdgeSet::kPermanent &&
+            !(reverse_ahead && fwd_pred.opp_edgeid() == rev_pred.edgeid())) {
           if (SetForwardConnection(graphreader, fwd_pred)) {
             continue;
           }
@@ -608,7 +770,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
                     std::to_string(edgelabels_reverse_.size()));
           return {};
         }
-        return FormPath(graphreader, options, origin, destination);
+        return form_path();
       }
     }
     if (expand_reverse) {
@@ -618,13 +780,14 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
 
         // Terminate if the cost threshold has been exceeded.
         if (rev_pred.sortcost() > threshold_) {
-          return FormPath(graphreader, options, origin, destination);
+          return form_path();
         }
 
         // Check if the edge on the reverse search connects to a settled edge on the
         // forward search tree. Do not expand further past this edge since it will just
-        // result in other connections.
-        if (edgestatus_forward_.Get(rev_pred.opp_edgeid()).set() == EdgeSet::kPermanent) {
+        // result in other connections. An edge settled ahead of time isn't settled yet.
+        if (edgestatus_forward_.Get(rev_pred.opp_edgeid()).set() == EdgeSet::kPermanent &&
+            !(forward_ahead && rev_pred.opp_edgeid() == fwd_pred.edgeid())) {
           if (SetReverseConnection(graphreader, rev_pred)) {
             continue;
           }
@@ -638,7 +801,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
                     std::to_string(edgelabels_forward_.size()));
           return {};
         }
-        return FormPath(graphreader, options, origin, destination);
+        return form_path();
       }
     }
 
@@ -648,56 +811,114 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       expand_forward = true;
       expand_reverse = false;
 
-      // Settle this edge.
-      edgestatus_forward_.Update(fwd_pred.edgeid(), EdgeSet::kPermanent);
-
-      // setting this edge as settled
-      if (expansion_callback_) {
-        expansion_callback_(graphreader, "bidirectional_astar", fwd_pred.edgeid(), "s", false);
+      // The helper already did this step
+      if (forward_ahead) {
+        forward_ahead = record_forward_ = false;
+        replaced_labels_.clear();
+        continue;
       }
 
-      // Prune path if predecessor is not a through edge or if the maximum
-      // number of upward transitions has been exceeded on this hierarchy level.
-      if ((fwd_pred.not_thru() && fwd_pred.not_thru_pruning()) ||
-          hierarchy_limits_forward_[fwd_pred.endnode().level()].StopExpanding()) {
-        continue;
+      // Meanwhile the helper can take the step the reverse search will do next
+      if (helper && !reverse_ahead) {
+        reverse_ahead = record_reverse_ = true;
+        helper->start([this, helper, &helper_reverse_time_info, invariant, pred = rev_pred,
+                       pred_idx = reverse_pred_idx]() {
+          SettleReverse(*helper->reader, pred, pred_idx, helper_reverse_time_info, invariant);
+        });
       }
 
-      // Expand from the end node in forward direction.
-      ExpandForward(graphreader, fwd_pred.endnode(), fwd_pred, forward_pred_idx, forward_time_info,
-                    invariant);
+      SettleForward(graphreader, fwd_pred, forward_pred_idx, forward_time_info, invariant);
     } else {
       // Expand reverse - set to get next edge from reverse adj. list on the next pass
       expand_forward = false;
       expand_reverse = true;
 
-      // Settle this edge
-      edgestatus_reverse_.Update(rev_pred.edgeid(), EdgeSet::kPermanent);
-
-      // setting this edge as settled, sending the opposing because this is the reverse tree
-      if (expansion_callback_) {
-        expansion_callback_(graphreader, "bidirectional_astar", rev_pred.opp_edgeid(), "s", false);
-      }
-
-      // Prune path if predecessor is not a through edge
-      if ((rev_pred.not_thru() && rev_pred.not_thru_pruning()) ||
-          hierarchy_limits_reverse_[rev_pred.endnode().level()].StopExpanding()) {
+      // The helper already did this step
+      if (reverse_ahead) {
+        reverse_ahead = record_reverse_ = false;
+        replaced_labels_.clear();
         continue;
       }
 
-      // Get the opposing predecessor directed edge. Need to make sure we get
-      // the correct one if a transition occurred
-      const DirectedEdge* opp_pred_edge =
-          graphreader.GetGraphTile(rev_pred.opp_edgeid())->directededge(rev_pred.opp_edgeid());
+      // Meanwhile the helper can take the step the forward search will do next
+      if (helper && !forward_ahead) {
+        forward_ahead = record_forward_ = true;
+        helper->start([this, helper, &helper_forward_time_info, invariant, pred = fwd_pred,
+                       pred_idx = forward_pred_idx]() {
+          SettleForward(*helper->reader, pred, pred_idx, helper_forward_time_info, invariant);
+        });
+      }
 
-      // Expand from the end node in reverse direction.
-      ExpandReverse(graphreader, rev_pred.endnode(), rev_pred, reverse_pred_idx, opp_pred_edge,
-                    reverse_time_info, invariant);
+      SettleReverse(graphreader, rev_pred, reverse_pred_idx, reverse_time_info, invariant);
     }
   }
   return {}; // If we are here the route failed
 }
 
+// Settle the forward predecessor and expand from it
+void BidirectionalAStar::SettleForward(GraphReader& graphreader,
+                                       BDEdgeLabel pred,
+                                       const uint32_t pred_idx,
+                                       const TimeInfo& time_info,
+                                       const bool invariant) {
+  // Settle this edge.
+  edgestatus_forward_.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+  // setting this edge as settled
+  if (expansion_callback_) {
+    expansion_callback_(graphreader, "bidirectional_astar", pred.edgeid(), "s", false);
+  }
+
+  // Prune path if predecessor is not a through edge or if the maximum
+  // number of upward transitions has been exceeded on this hierarchy level.
+  if ((pred.not_thru() && pred.not_thru_pruning()) ||
+      hierarchy_limits_forward_[pred.endnode().level()].StopExpanding()) {
+    return;
+  }
+
+  // Expand from the end node in forward direction.
+  ExpandForward(graphreader, pred.endnode(), pred, pred_idx, time_info, invariant);
+}
+
+// Settle the reverse predecessor and expand from it
+void BidirectionalAStar::SettleReverse(GraphReader& graphreader,
+                                       BDEdgeLabel pred,
+                                       const uint32_t pred_idx,
+                                       const TimeInfo& time_info,
+                                       const bool invariant) {
+  // Settle this edge
+  edgestatus_reverse_.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+  // setting this edge as settled, sending the opposing because this is the reverse tree
+  if (expansion_callback_) {
+    expansion_callback_(graphreader, "bidirectional_astar", pred.opp_edgeid(), "s", false);
+  }
+
+  // Prune path if predecessor is not a through edge
+  if ((pred.not_thru() && pred.not_thru_pruning()) ||
+      hierarchy_limits_reverse_[pred.endnode().level()].StopExpanding()) {
+    return;
+  }
+
+  // Get the opposing predecessor directed edge. Need to make sure we get
+  // the correct one if a transition occurred
+  const DirectedEdge* opp_pred_edge =
+      graphreader.GetGraphTile(pred.opp_edgeid())->directededge(pred.opp_edgeid());
+
+  // Expand from the end node in reverse direction.
+  ExpandReverse(graphreader, pred.endnode(), pred, pred_idx, opp_pred_edge, time_info, invariant);
+}
+
+// Put back the labels an expansion done ahead of time replaced, last replaced first
+void BidirectionalAStar::RestoreReplacedLabels() {
+  auto& edgelabels = record_forward_ ? edgelabels_forward_ : edgelabels_reverse_;
+  for (auto replaced = replaced_labels_.rbegin(); replaced != replaced_labels_.rend(); ++replaced) {
+    edgelabels[replaced->first] = replaced->second;
+  }
+  replaced_labels_.clear();
+  record_forward_ = record_reverse_ = false;
+}
+
 // The edge on the forward search connects to a reached edge on the reverse
 // search tree. Check if this is the best connection so far and set the
 // search threshold.
@@ -979,7 +1200,12 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
     filter_alternates_by_stretch(best_connections_);
   }
   // For looking up edge ids on previously chosen best paths
-  std::vector<std::unordered_set<GraphId>> shared_edgeids;
+  std::vector<std::vector<GraphId>> shared_edgeids;
+
+  // Which plateaus a path was formed for already and where the ones of labels walked before start
+  std::unordered_set<uint32_t> formed_plateaus;
+  std::unordered_map<uint32_t, uint32_t> plateau_starts;
+  std::vector<std::pair<GraphId, float>> connection_edges;
 
   // get maximum amount of sharing parameter based on origin->destination distance
   float max_sharing = allow_alternates ? get_max_sharing(origin, dest) : 0.f;
@@ -1011,6 +1237,22 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
     uint32_t idx1 = edgestatus_forward_.Get(best_connection->edgeid).index();
     uint32_t idx2 = edgestatus_reverse_.Get(best_connection->opp_edgeid).index();
 
+    // Before forming the path of an alternate see that it is not the same as one formed before and
+    // that it does not obviously share too much with the paths we have
+    if (allow_alternates) {
+      if (!formed_plateaus.insert(PlateauStart(idx1, idx2, plateau_starts)).second) {
+        continue;
+      }
+      if (!paths.empty()) {
+        GetConnectionEdges(idx1, idx2, connection_edges);
+        update_shared_edgeids(graphreader, shared_edgeids, paths);
+        if (!validate_alternate_by_estimated_sharing(shared_edgeids, connection_edges,
+                                                     max_sharing)) {
+          continue;
+        }
+      }
+    }
+
     // Metrics (TODO - more accurate cost)
     uint32_t pathcost = edgelabels_forward_[idx1].cost().cost + edgelabels_reverse_[idx2].cost().cost;
     LOG_DEBUG("path_cost::" + std::to_string(pathcost));
@@ -1145,6 +1387,64 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
   return paths;
 }
 
+uint32_t BidirectionalAStar::PlateauStart(uint32_t fwd_idx,
+                                          uint32_t rev_idx,
+                                          std::unordered_map<uint32_t, uint32_t>& starts) const {
+  std::vector<uint32_t> walked;
+  uint32_t start = fwd_idx;
+  while (true) {
+    auto found = starts.find(start);
+    if (found != starts.end()) {
+      start = found->second;
+      break;
+    }
+    walked.push_back(start);
+
+    // The plateau goes on if the reverse tree reached the edge before this one from this one
+    uint32_t pred_idx = edgelabels_forward_[start].predecessor();
+    if (pred_idx == kInvalidLabel) {
+      break;
+    }
+    GraphId pred_opp_edge = edgelabels_forward_[pred_idx].opp_edgeid();
+    if (!pred_opp_edge.Is_Valid()) {
+      break;
+    }
+    EdgeStatusInfo status = edgestatus_reverse_.Get(pred_opp_edge);
+    if (status.set() == EdgeSet::kUnreachedOrReset ||
+        edgelabels_reverse_[status.index()].predecessor() != rev_idx) {
+      break;
+    }
+    start = pred_idx;
+    rev_idx = status.index();
+  }
+
+  for (auto idx : walked) {
+    starts[idx] = start;
+  }
+  return start;
+}
+
+void BidirectionalAStar::GetConnectionEdges(uint32_t fwd_idx,
+                                            uint32_t rev_idx,
+                                            std::vector<std::pair<GraphId, float>>& edges) const {
+  edges.clear();
+  for (auto idx = fwd_idx; idx != kInvalidLabel; idx = edgelabels_forward_[idx].predecessor()) {
+    const BDEdgeLabel& edgelabel = edgelabels_forward_[idx];
+    const uint32_t pred_idx = edgelabel.predecessor();
+    float secs = pred_idx == kInvalidLabel ? 0.f : edgelabels_forward_[pred_idx].cost().secs;
+    edges.emplace_back(edgelabel.edgeid(), edgelabel.cost().secs - secs);
+  }
+
+  // The first edge on the reverse path is the same as the last on the forward path
+  for (auto idx = edgelabels_reverse_[rev_idx].predecessor(); idx != kInvalidLabel;
+       idx = edgelabels_reverse_[idx].predecessor()) {
+    const BDEdgeLabel& edgelabel = edgelabels_reverse_[idx];
+    const uint32_t pred_idx = edgelabel.predecessor();
+    float secs = pred_idx == kInvalidLabel ? 0.f : edgelabels_reverse_[pred_idx].cost().secs;
+    edges.emplace_back(edgelabel.opp_edgeid(), edgelabel.cost().secs - secs);
+  }
+}
+
 bool IsBridgingEdgeRestricted(GraphReader& graphreader,
                               std::vector<sif::BDEdgeLabel>& edge_labels_fwd,
                               std::vector<sif::BDEdgeLabel>& edge_labels_rev,
@@ -1215,7 +1515,7 @@ bool IsBridgingEdgeRestricted(GraphReader& graphreader,
     }
     if (edge->end_restriction() & costing->access_mode()) {
       auto restrictions = tile->GetRestrictions(true, edgeid, costing->access_mode());
-      if (restrictions.size() == 0) {
+      if (restrictions.empty()) {
         // TODO Should we actually throw here? Or assert to gracefully continue in release?
         // This implies corrupt data or logic bug
         throw std::logic_error(
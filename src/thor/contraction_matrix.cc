@@ -0,0 +1,266 @@
+#include "thor/contraction_matrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr float kInfinity = std::numeric_limits<float>::max();
+
+bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
+  return a.has_lat() == b.has_lat() && a.has_lng() == b.has_lng() &&
+         (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+constexpr uint32_t ContractionMatrix::kBatchSize;
+
+ContractionMatrix::ContractionMatrix(const ContractionHierarchy& hierarchy, ExpansionPool* pool)
+    : hierarchy_(hierarchy), pool_(pool) {
+}
+
+std::vector<ContractionMatrix::seed_t> ContractionMatrix::Seeds(GraphReader& graphreader,
+                                                                const valhalla::Location& location,
+                                                                const bool forward) const {
+  // Only skip edges which are left behind at the location if there are other options
+  bool has_other_edges = false;
+  for (const auto& edge : location.path_edges()) {
+    has_other_edges = has_other_edges || !(forward ? edge.end_node() : edge.begin_node());
+  }
+
+  // Sources start with the part of the edge after them, the arcs into targets include the whole
+  // edge so the part after the target is taken back again
+  std::vector<seed_t> seeds;
+  for (const auto& edge : location.path_edges()) {
+    if (has_other_edges && (forward ? edge.end_node() : edge.begin_node())) {
+      continue;
+    }
+    GraphId edgeid(edge.graph_id());
+    uint32_t node = hierarchy_.node(edgeid);
+    bool avoid = forward ? costing_->AvoidAsOriginEdge(edgeid, edge.percent_along())
+                         : costing_->AvoidAsDestinationEdge(edgeid, edge.percent_along());
+    graph_tile_ptr tile;
+    const DirectedEdge* directededge;
+    if (node == ContractionHierarchy::kInvalidNode || avoid ||
+        !(directededge = graphreader.directededge(edgeid, tile))) {
+      continue;
+    }
+    const float remainder = 1.0f - edge.percent_along();
+    const float sign = forward ? 1.0f : -1.0f;
+    const auto cost = costing_->EdgeCost(directededge, tile) * remainder;
+    seeds.push_back({node, sign * cost.cost + edge.distance(), sign * cost.secs,
+                     sign * directededge->length() * remainder});
+  }
+  return seeds;
+}
+
+void ContractionMatrix::Select(const std::vector<std::vector<seed_t>>& target_seeds) {
+  // Everything the targets reach going upward is what a path can come down through
+  std::vector<uint32_t> nodes;
+  std::vector<uint32_t> stack;
+  selected_.clear();
+  for (const auto& seeds : target_seeds) {
+    for (const auto& seed : seeds) {
+      if (selected_.emplace(seed.node, 0).second) {
+        stack.push_back(seed.node);
+      }
+    }
+  }
+  while (!stack.empty()) {
+    uint32_t node = stack.back();
+    stack.pop_back();
+    nodes.push_back(node);
+    auto down = hierarchy_.down(node);
+    for (const auto* arc = down.first; arc != down.second; ++arc) {
+      if (selected_.emplace(arc->node, 0).second) {
+        stack.push_back(arc->node);
+      }
+    }
+  }
+
+  // Top down so that every node comes after the nodes its arcs come from
+  std::sort(nodes.begin(), nodes.end(), std::greater<uint32_t>());
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    selected_[nodes[i]] = i;
+  }
+  arc_offsets_.assign(1, 0);
+  arcs_.clear();
+  for (auto node : nodes) {
+    auto down = hierarchy_.down(node);
+    for (const auto* arc = down.first; arc != down.second; ++arc) {
+      arcs_.push_back({selected_[arc->node], arc->cost, arc->secs, arc->length});
+    }
+    arc_offsets_.push_back(static_cast<uint32_t>(arcs_.size()));
+  }
+  LOG_DEBUG("ContractionMatrix selected " + std::to_string(nodes.size()) + " nodes and " +
+            std::to_string(arcs_.size()) + " arcs");
+}
+
+void ContractionMatrix::Sweep(const std::vector<std::vector<seed_t>>& source_seeds,
+                              const size_t batch,
+                              std::vector<values_t>& values) const {
+  values_t empty;
+  std::fill(std::begin(empty.cost), std::end(empty.cost), kInfinity);
+  std::fill(std::begin(empty.secs), std::end(empty.secs), 0.f);
+  std::fill(std::begin(empty.length), std::end(empty.length), 0.f);
+  values.assign(arc_offsets_.size() - 1, empty);
+
+  // The upward search of every source of the batch, what it reaches of the selection is where
+  // the sweep starts from
+  using entry_t = std::pair<float, uint32_t>;
+  std::unordered_map<uint32_t, seed_t> labels;
+  for (uint32_t k = 0; k < kBatchSize && batch * kBatchSize + k < source_seeds.size(); ++k) {
+    labels.clear();
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    for (const auto& seed : source_seeds[batch * kBatchSize + k]) {
+      auto inserted = labels.emplace(seed.node, seed);
+      if (inserted.second || seed.cost < inserted.first->second.cost) {
+        inserted.first->second = seed;
+        queue.emplace(seed.cost, seed.node);
+      }
+    }
+    while (!queue.empty()) {
+      auto current = queue.top();
+      queue.pop();
+      const auto label = labels[current.second];
+      if (current.first > label.cost) {
+        continue;
+      }
+      auto found = selected_.find(current.second);
+      if (found != selected_.end()) {
+        auto& value = values[found->second];
+        value.cost[k] = label.cost;
+        value.secs[k] = label.secs;
+        value.length[k] = label.length;
+      }
+      auto up = hierarchy_.up(current.second);
+      for (const auto* arc = up.first; arc != up.second; ++arc) {
+        seed_t next{arc->node, label.cost + arc->cost, label.secs + arc->secs,
+                    label.length + arc->length};
+        auto inserted = labels.emplace(arc->node, next);
+        if (inserted.second || next.cost < inserted.first->second.cost) {
+          inserted.first->second = next;
+          queue.emplace(next.cost, arc->node);
+        }
+      }
+    }
+  }
+
+  // Then down through the selection for all of them at once
+  for (uint32_t i = 0; i + 1 < arc_offsets_.size(); ++i) {
+    auto& value = values[i];
+    for (uint32_t a = arc_offsets_[i]; a < arc_offsets_[i + 1]; ++a) {
+      const auto& arc = arcs_[a];
+      const auto& from = values[arc.from];
+      for (uint32_t k = 0; k < kBatchSize; ++k) {
+        const float cost = from.cost[k] + arc.cost;
+        const bool better = cost < value.cost[k];
+        value.cost[k] = better ? cost : value.cost[k];
+        value.secs[k] = better ? from.secs[k] + arc.secs : value.secs[k];
+        value.length[k] = better ? from.length[k] + arc.length : value.length[k];
+      }
+    }
+  }
+}
+
+std::vector<TimeDistance> ContractionMatrix::SourceToTarget(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_locations,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_locations,
+    GraphReader& graphreader,
+    const mode_costing_t& mode_costing,
+    const TravelMode mode) {
+  costing_ = mode_costing[static_cast<uint32_t>(mode)];
+
+  std::vector<std::vector<seed_t>> source_seeds, target_seeds;
+  for (const auto& location : source_locations) {
+    source_seeds.push_back(Seeds(graphreader, location, true));
+  }
+  for (const auto& location : target_locations) {
+    target_seeds.push_back(Seeds(graphreader, location, false));
+  }
+  Select(target_seeds);
+
+  // Sweep every batch of sources and read off the targets
+  const size_t target_count = target_locations.size();
+  std::vector<TimeDistance> td(source_locations.size() * target_count,
+                               TimeDistance(kMaxCost, kMaxCost));
+  std::vector<std::vector<values_t>> values(pool_ ? pool_->size() : 1);
+  auto work = [&](size_t batch, size_t thread, GraphReader&) {
+    Sweep(source_seeds, batch, values[thread]);
+    for (uint32_t k = 0; k < kBatchSize && batch * kBatchSize + k < source_seeds.size(); ++k) {
+      const size_t source = batch * kBatchSize + k;
+      for (size_t target = 0; target < target_count; ++target) {
+        float best = kInfinity, secs = 0.f, length = 0.f;
+        for (const auto& seed : target_seeds[target]) {
+          const auto& value = values[thread][selected_.find(seed.node)->second];
+          if (value.cost[k] != kInfinity && value.cost[k] + seed.cost < best) {
+            best = value.cost[k] + seed.cost;
+            secs = value.secs[k] + seed.secs;
+            length = value.length[k] + seed.length;
+          }
+        }
+        if (best != kInfinity) {
+          td[source * target_count + target] =
+              TimeDistance(std::round(std::max(secs, 0.f)), std::round(std::max(length, 0.f)));
+        }
+      }
+    }
+  };
+  const size_t batches = (source_seeds.size() + kBatchSize - 1) / kBatchSize;
+  if (pool_ && batches > 1) {
+    pool_->Run(batches, work, graphreader);
+  } else {
+    for (size_t batch = 0; batch < batches; ++batch) {
+      work(batch, 0, graphreader);
+    }
+  }
+
+  // The hierarchy cant go along a part of an edge and the same location doesnt need to go anywhere
+  for (int source = 0; source < source_locations.size(); ++source) {
+    const auto& source_location = source_locations.Get(source);
+    for (size_t target = 0; target < target_count; ++target) {
+      const auto& target_location = target_locations.Get(target);
+      auto& result = td[source * target_count + target];
+      if (equals(source_location.ll(), target_location.ll())) {
+        result = TimeDistance(0, 0);
+        continue;
+      }
+      for (const auto& source_edge : source_location.path_edges()) {
+        for (const auto& target_edge : target_location.path_edges()) {
+          if (source_edge.graph_id() != target_edge.graph_id() ||
+              source_edge.percent_along() > target_edge.percent_along()) {
+            continue;
+          }
+          graph_tile_ptr tile;
+          GraphId edgeid(source_edge.graph_id());
+          const DirectedEdge* edge = graphreader.directededge(edgeid, tile);
+          if (!edge) {
+            continue;
+          }
+          const float along = target_edge.percent_along() - source_edge.percent_along();
+          const auto secs = std::round(costing_->EdgeCost(edge, tile).secs * along);
+          if (result.time == static_cast<uint32_t>(kMaxCost) || secs < result.time) {
+            result = TimeDistance(secs, std::round(edge->length() * along));
+          }
+        }
+      }
+    }
+  }
+  return td;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,333 @@
+#include "thor/contraction_search.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+#include "baldr/graphconstants.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr float kMaxCost = std::numeric_limits<float>::max();
+constexpr uint32_t kInvalidNode = ContractionHierarchy::kInvalidNode;
+
+// Finds the node at the level of the edge which is the same as the end node of the previous one
+const NodeInfo* begin_node(GraphReader& graphreader,
+                           const GraphId& node,
+                           const GraphId& edgeid,
+                           graph_tile_ptr& tile) {
+  graph_tile_ptr node_tile = graphreader.GetGraphTile(node);
+  if (!node_tile) {
+    return nullptr;
+  }
+  const NodeInfo* node_info = node_tile->node(node);
+  if (node.level() == edgeid.level()) {
+    tile = node_tile;
+    return node_info;
+  }
+  const NodeTransition* trans = node_tile->transition(node_info->transition_index());
+  for (uint32_t i = 0; i < node_info->transition_count(); ++i, ++trans) {
+    if (trans->endnode().level() == edgeid.level()) {
+      tile = graphreader.GetGraphTile(trans->endnode());
+      return tile ? tile->node(trans->endnode()) : nullptr;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ContractionSearch::ContractionSearch(PathAlgorithm& fallback)
+    : PathAlgorithm(), fallback_(fallback), mode_(TravelMode::kDrive), best_cost_(kMaxCost),
+      best_node_(kInvalidNode) {
+}
+
+void ContractionSearch::Load(const boost::property_tree::ptree& config) {
+  auto costings = config.get<std::string>("contraction_hierarchies", "");
+  std::vector<std::string> names;
+  boost::algorithm::split(names, costings, boost::algorithm::is_any_of(","));
+  if (costings.empty()) {
+    return;
+  }
+
+  // the defaults are what the hierarchies were built with, see mjolnir::ContractionBuilder
+  Options defaults;
+  rapidjson::Document doc;
+  doc.SetObject();
+  ParseCostingOptions(doc, "/costing_options", defaults);
+
+  const auto tile_dir = config.get<std::string>("tile_dir", "");
+  for (const auto& name : names) {
+    Costing costing;
+    if (name.empty() || !Costing_Enum_Parse(name, &costing)) {
+      continue;
+    }
+    try {
+      hierarchies_[costing].reset(
+          new ContractionHierarchy(ContractionHierarchy::FileName(tile_dir, name)));
+      default_options_[costing] = defaults.costing_options(costing).SerializeAsString();
+    } catch (const std::exception& e) {
+      hierarchies_.erase(costing);
+      LOG_WARN("Not using the " + name + " contraction hierarchy: " + e.what());
+    }
+  }
+}
+
+const ContractionHierarchy* ContractionSearch::Hierarchy(const Options& options) const {
+  auto found = default_options_.find(options.costing());
+  if (found == default_options_.end() || options.costing() >= options.costing_options_size() ||
+      options.costing_options(options.costing()).SerializeAsString() != found->second) {
+    return nullptr;
+  }
+  return hierarchies_.find(options.costing())->second.get();
+}
+
+void ContractionSearch::Clear() {
+  forward_labels_.clear();
+  reverse_labels_.clear();
+  forward_queue_ = queue_t();
+  reverse_queue_ = queue_t();
+  best_cost_ = kMaxCost;
+  best_node_ = kInvalidNode;
+}
+
+void ContractionSearch::SetLocation(GraphReader& graphreader,
+                                    const ContractionHierarchy& hierarchy,
+                                    const valhalla::Location& location,
+                                    const bool forward) {
+  // Only skip edges which are left behind at the location if there are other options
+  bool has_other_edges = false;
+  for (const auto& edge : location.path_edges()) {
+    has_other_edges = has_other_edges || !(forward ? edge.end_node() : edge.begin_node());
+  }
+
+  auto& labels = forward ? forward_labels_ : reverse_labels_;
+  auto& queue = forward ? forward_queue_ : reverse_queue_;
+  for (int i = 0; i < location.path_edges_size(); ++i) {
+    const auto& edge = location.path_edges(i);
+    if (has_other_edges && (forward ? edge.end_node() : edge.begin_node())) {
+      continue;
+    }
+    GraphId edgeid(edge.graph_id());
+    uint32_t node = hierarchy.node(edgeid);
+    bool avoid = forward ? costing_->AvoidAsOriginEdge(edgeid, edge.percent_along())
+                         : costing_->AvoidAsDestinationEdge(edgeid, edge.percent_along());
+    if (node == kInvalidNode || avoid) {
+      continue;
+    }
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (!tile) {
+      continue;
+    }
+
+    // The forward search starts with the part of the edge after the origin. Arcs include the
+    // whole edge they lead to so the reverse search starts by taking back whats after the
+    // destination. Both are penalized by how far the location is from the edge.
+    float remainder =
+        costing_->EdgeCost(tile->directededge(edgeid), tile).cost * (1.0f - edge.percent_along());
+    float cost = (forward ? remainder : -remainder) + edge.distance();
+    auto inserted = labels.emplace(node, label_t{cost, kInvalidNode, kInvalidNode,
+                                                 static_cast<uint32_t>(i)});
+    if (inserted.second || cost < inserted.first->second.cost) {
+      inserted.first->second = {cost, kInvalidNode, kInvalidNode, static_cast<uint32_t>(i)};
+      queue.emplace(cost, node);
+    }
+  }
+}
+
+void ContractionSearch::Settle(const ContractionHierarchy& hierarchy, const bool forward) {
+  auto& labels = forward ? forward_labels_ : reverse_labels_;
+  auto& queue = forward ? forward_queue_ : reverse_queue_;
+  const auto& other = forward ? reverse_labels_ : forward_labels_;
+
+  auto current = queue.top();
+  queue.pop();
+  if (current.first > labels[current.second].cost) {
+    return;
+  }
+
+  // Check if the other direction got here too
+  auto met = other.find(current.second);
+  if (met != other.end() && current.first + met->second.cost < best_cost_) {
+    best_cost_ = current.first + met->second.cost;
+    best_node_ = current.second;
+  }
+
+  // Forward the arcs leaving upward, in reverse the ones arriving from above
+  auto arcs = forward ? hierarchy.up(current.second) : hierarchy.down(current.second);
+  for (const auto* arc = arcs.first; arc != arcs.second; ++arc) {
+    float cost = current.first + arc->cost;
+    auto inserted = labels.emplace(arc->node, label_t{cost, current.second, arc->middle, 0});
+    if (inserted.second || cost < inserted.first->second.cost) {
+      inserted.first->second = {cost, current.second, arc->middle, 0};
+      queue.emplace(cost, arc->node);
+    }
+  }
+}
+
+void ContractionSearch::Unpack(const ContractionHierarchy& hierarchy,
+                               const uint32_t from,
+                               const uint32_t to,
+                               const uint32_t middle,
+                               std::vector<uint32_t>& nodes) const {
+  if (middle == kInvalidNode) {
+    nodes.push_back(to);
+    return;
+  }
+  // The shortcut replaced the arc into the middle, which is stored with the middle as arriving
+  // from above, and the arc out of the middle, which is stored with it as leaving upward
+  auto down = hierarchy.down(middle);
+  using Arc = ContractionHierarchy::Arc;
+  auto first = std::find_if(down.first, down.second, [from](const Arc& a) { return a.node == from; });
+  auto up = hierarchy.up(middle);
+  auto second = std::find_if(up.first, up.second, [to](const Arc& a) { return a.node == to; });
+  if (first == down.second || second == up.second) {
+    throw std::runtime_error("Contraction hierarchy shortcut without the arcs it replaces");
+  }
+  Unpack(hierarchy, from, middle, first->middle, nodes);
+  Unpack(hierarchy, middle, to, second->middle, nodes);
+}
+
+std::vector<std::vector<PathInfo>>
+ContractionSearch::GetBestPath(valhalla::Location& origin,
+                               valhalla::Location& destination,
+                               GraphReader& graphreader,
+                               const mode_costing_t& mode_costing,
+                               const TravelMode mode,
+                               const Options& options) {
+  auto fallback = [&]() {
+    fallback_.set_interrupt(interrupt);
+    auto paths =
+        fallback_.GetBestPath(origin, destination, graphreader, mode_costing, mode, options);
+    has_ferry_ = fallback_.has_ferry();
+    return paths;
+  };
+
+  // The hierarchy doesnt know about paths along a single edge and cant show its expansion
+  auto found = hierarchies_.find(options.costing());
+  if (found == hierarchies_.end() || expansion_callback_) {
+    return fallback();
+  }
+  for (const auto& origin_edge : origin.path_edges()) {
+    for (const auto& destination_edge : destination.path_edges()) {
+      if (origin_edge.graph_id() == destination_edge.graph_id()) {
+        return fallback();
+      }
+    }
+  }
+
+  const auto& hierarchy = *found->second;
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  has_ferry_ = false;
+  Clear();
+  SetLocation(graphreader, hierarchy, origin, true);
+  SetLocation(graphreader, hierarchy, destination, false);
+
+  // Alternate between the directions until neither can improve on the best connection
+  size_t n = 0;
+  while (true) {
+    float forward_cost = forward_queue_.empty() ? kMaxCost : forward_queue_.top().first;
+    float reverse_cost = reverse_queue_.empty() ? kMaxCost : reverse_queue_.top().first;
+    if (std::min(forward_cost, reverse_cost) >= best_cost_ ||
+        (forward_queue_.empty() && reverse_queue_.empty())) {
+      break;
+    }
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+    Settle(hierarchy, forward_cost <= reverse_cost);
+  }
+  if (best_node_ == kInvalidNode) {
+    return {};
+  }
+
+  // Walk back to the origin and on to the destination, unpacking the shortcuts on the way
+  std::vector<uint32_t> up_nodes{best_node_};
+  for (auto node = best_node_; forward_labels_[node].parent != kInvalidNode;
+       node = forward_labels_[node].parent) {
+    up_nodes.push_back(forward_labels_[node].parent);
+  }
+  std::reverse(up_nodes.begin(), up_nodes.end());
+  std::vector<uint32_t> nodes{up_nodes.front()};
+  for (size_t i = 1; i < up_nodes.size(); ++i) {
+    Unpack(hierarchy, up_nodes[i - 1], up_nodes[i], forward_labels_[up_nodes[i]].middle, nodes);
+  }
+  uint32_t last = best_node_;
+  for (auto label = reverse_labels_[last]; label.parent != kInvalidNode;
+       label = reverse_labels_[last]) {
+    Unpack(hierarchy, last, label.parent, label.middle, nodes);
+    last = label.parent;
+  }
+
+  // Make sure the path doesnt run into a complex restriction, the hierarchy doesnt know them
+  std::vector<GraphId> edges;
+  edges.reserve(nodes.size());
+  graph_tile_ptr tile;
+  for (auto node : nodes) {
+    edges.push_back(hierarchy.edge(node));
+    const DirectedEdge* edge = graphreader.directededge(edges.back(), tile);
+    if (!edge ||
+        ((edge->start_restriction() | edge->end_restriction()) & costing_->access_mode())) {
+      LOG_DEBUG("Contraction hierarchy path has complex restrictions, using the fallback");
+      return fallback();
+    }
+  }
+
+  const auto& origin_edge = origin.path_edges(forward_labels_[up_nodes.front()].path_edge);
+  const auto& destination_edge = destination.path_edges(reverse_labels_[last].path_edge);
+  return {FormPath(graphreader, edges, origin_edge, destination_edge)};
+}
+
+std::vector<PathInfo> ContractionSearch::FormPath(GraphReader& graphreader,
+                                                  const std::vector<GraphId>& edges,
+                                                  const valhalla::Location::PathEdge& origin,
+                                                  const valhalla::Location::PathEdge& destination) {
+  // Same accounting as the expansion of timedep_forward, see SetOrigin and ExpandForwardInner
+  std::vector<PathInfo> path;
+  path.reserve(edges.size());
+  std::unique_ptr<EdgeLabel> pred;
+  Cost cost;
+  for (size_t i = 0; i < edges.size(); ++i) {
+    graph_tile_ptr tile = graphreader.GetGraphTile(edges[i]);
+    const DirectedEdge* edge = tile->directededge(edges[i]);
+    auto edge_cost = costing_->EdgeCost(edge, tile);
+    Cost transition_cost;
+    int restriction_idx = -1;
+    if (!pred) {
+      cost = edge_cost * (1.0f - origin.percent_along());
+      cost.cost += origin.distance();
+    } else {
+      graph_tile_ptr node_tile;
+      const NodeInfo* node_info = begin_node(graphreader, pred->endnode(), edges[i], node_tile);
+      if (node_info) {
+        costing_->Allowed(edge, *pred, tile, edges[i], 0, node_info->timezone(), restriction_idx);
+        transition_cost = costing_->TransitionCost(edge, node_info, *pred);
+      }
+      cost += edge_cost + transition_cost;
+    }
+    if (i + 1 == edges.size()) {
+      cost -= edge_cost * (1.0f - destination.percent_along());
+      cost.cost += destination.distance();
+      cost.cost = std::max(0.0f, cost.cost);
+    }
+    pred.reset(new EdgeLabel(pred ? static_cast<uint32_t>(i - 1) : kInvalidLabel, edges[i], edge,
+                             cost, cost.cost, 0.f, mode_, 0, transition_cost, restriction_idx));
+    path.emplace_back(mode_, cost, edges[i], 0, restriction_idx, transition_cost);
+    has_ferry_ = has_ferry_ || edge->use() == Use::kFerry;
+  }
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
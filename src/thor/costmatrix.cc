@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "midgard/logging.h"
+#include "sif/recost.h"
 #include "thor/costmatrix.h"
 #include "worker.h"
 
@@ -15,12 +16,31 @@ namespace {
 
 constexpr uint32_t kMaxMatrixIterations = 2000000;
 
+// Below this many locations expanding in an iteration waking up the pool costs more than it saves
+constexpr uint32_t kMinParallelSearches = 8;
+
+// The edge status of all the locations together may keep this many bytes of arrays for the next
+// matrix, a matrix of many locations has a status per location so each of them must stay small
+constexpr size_t kMaxRetainedEdgeStatusBytes = 64 * 1024 * 1024;
+
 // Find a threshold to continue the search - should be based on
 // the max edge cost in the adjacency set?
 int GetThreshold(const TravelMode mode, const int n) {
   return (mode == TravelMode::kDrive) ? std::min(2700, std::max(100, n / 3)) : 500;
 }
 
+// How far along the edge a location is, if it is on it
+float percent_along(const valhalla::Location& location,
+                    const GraphId& edgeid,
+                    const float otherwise) {
+  for (const auto& edge : location.path_edges()) {
+    if (edge.graph_id() == edgeid) {
+      return edge.percent_along();
+    }
+  }
+  return otherwise;
+}
+
 bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
   return a.has_lat() == b.has_lat() && a.has_lng() == b.has_lng() &&
          (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
@@ -34,9 +54,11 @@ namespace thor {
 class CostMatrix::TargetMap : public robin_hood::unordered_map<uint64_t, std::vector<uint32_t>> {};
 
 // Constructor with cost threshold.
-CostMatrix::CostMatrix()
+CostMatrix::CostMatrix(const label_limits_t& label_limits, ExpansionPool* pool)
     : mode_(TravelMode::kDrive), access_mode_(kAutoAccess), source_count_(0), remaining_sources_(0),
-      target_count_(0), remaining_targets_(0), current_cost_threshold_(0), targets_{new TargetMap} {
+      target_count_(0), remaining_targets_(0), current_cost_threshold_(0), k_nearest_(0),
+      cost_cutoff_(0), time_dependent_(false), label_limits_(label_limits), pool_(pool),
+      targets_{new TargetMap} {
 }
 
 CostMatrix::~CostMatrix() {
@@ -62,6 +84,12 @@ float CostMatrix::GetCostThreshold(const float max_matrix_distance) {
   return cost_threshold * 2.0f;
 }
 
+// Limit the pairs that have to be found so the searches can stop early
+void CostMatrix::SetLimits(const uint32_t k_nearest, const float cost_cutoff) {
+  k_nearest_ = k_nearest;
+  cost_cutoff_ = std::max(cost_cutoff, 0.0f);
+}
+
 // Clear the temporary information generated during time + distance matrix
 // construction.
 void CostMatrix::Clear() {
@@ -79,10 +107,22 @@ void CostMatrix::Clear() {
   }
   source_edgelabel_.clear();
 
+  // keep the edge status around so its arrays can be reused by the next matrix, unless all the
+  // locations together hold on to too much
+  size_t retained = 0;
+  for (const auto& es : source_edgestatus_) {
+    retained += es.bytes();
+  }
+  for (const auto& es : target_edgestatus_) {
+    retained += es.bytes();
+  }
+  if (retained > kMaxRetainedEdgeStatusBytes) {
+    source_edgestatus_.clear();
+    target_edgestatus_.clear();
+  }
   for (auto& es : source_edgestatus_) {
     es.clear();
   }
-  source_edgestatus_.clear();
 
   // Clear all target adjacency lists, edge labels, and edge status
   for (auto& adj : target_adjacency_) {
@@ -98,12 +138,13 @@ void CostMatrix::Clear() {
   for (auto& es : target_edgestatus_) {
     es.clear();
   }
-  target_edgestatus_.clear();
 
   source_hierarchy_limits_.clear();
   target_hierarchy_limits_.clear();
   source_status_.clear();
   target_status_.clear();
+  status_updates_.clear();
+  target_reached_.clear();
 }
 
 // Form a time distance matrix from the set of source locations
@@ -124,6 +165,7 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
 
   // Set the source and target locations
   Clear();
+  SetTimes(graphreader, source_location_list);
   SetSources(graphreader, source_location_list);
   SetTargets(graphreader, target_location_list);
 
@@ -137,32 +179,27 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   // spaces is checked during the forward search.
   int n = 0;
   while (true) {
-    // Iterate all target locations in a backwards search
-    for (uint32_t i = 0; i < target_count_; i++) {
-      if (target_status_[i].threshold > 0) {
-        target_status_[i].threshold--;
-        BackwardSearch(i, graphreader);
-        if (target_status_[i].threshold == 0) {
-          target_status_[i].threshold = -1;
-          if (remaining_targets_ > 0) {
-            remaining_targets_--;
-          }
-        }
-      }
+    // Abort if all the searches together use too much memory
+    size_t bytes = 0;
+    for (size_t i = 0; i < source_edgelabel_.size(); ++i) {
+      bytes += label_limits_t::bytes(source_edgelabel_[i], source_adjacency_[i],
+                                     source_edgestatus_[i]);
     }
+    for (size_t i = 0; i < target_edgelabel_.size(); ++i) {
+      bytes += label_limits_t::bytes(target_edgelabel_[i], target_adjacency_[i],
+                                     target_edgestatus_[i]);
+    }
+    label_limits_.check_bytes(bytes);
+
+    // Iterate all target locations in a backwards search
+    Expand(false, n, graphreader);
 
     // Iterate all source locations in a forward search
-    for (uint32_t i = 0; i < source_count_; i++) {
-      if (source_status_[i].threshold > 0) {
-        source_status_[i].threshold--;
-        ForwardSearch(i, n, graphreader);
-        if (source_status_[i].threshold == 0) {
-          source_status_[i].threshold = -1;
-          if (remaining_sources_ > 0) {
-            remaining_sources_--;
-          }
-        }
-      }
+    Expand(true, n, graphreader);
+
+    // Stop the sources whose nearest targets cant change anymore
+    if (k_nearest_ > 0) {
+      StopNearestSources();
     }
 
     // Break out when remaining sources and targets to expand are both 0
@@ -179,6 +216,36 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
     n++;
   }
 
+  // Only the nearest targets of each source are kept, the searches may have found more
+  if (k_nearest_ > 0 && k_nearest_ < target_count_) {
+    std::vector<uint32_t> row;
+    for (uint32_t source = 0; source < source_count_; source++) {
+      auto* connections = &best_connection_[source * target_count_];
+      row.clear();
+      for (uint32_t target = 0; target < target_count_; target++) {
+        if (connections[target].cost.secs != kMaxCost) {
+          row.push_back(target);
+        }
+      }
+      if (row.size() <= k_nearest_) {
+        continue;
+      }
+      std::sort(row.begin(), row.end(), [connections](const uint32_t a, const uint32_t b) {
+        return connections[a].cost.cost < connections[b].cost.cost ||
+               (connections[a].cost.cost == connections[b].cost.cost && a < b);
+      });
+      for (auto target = row.begin() + k_nearest_; target != row.end(); ++target) {
+        connections[*target].cost = Cost(kMaxCost, kMaxCost);
+        connections[*target].distance = kMaxCost;
+      }
+    }
+  }
+
+  // The times of the paths from sources with a date_time depend on when they get to each edge
+  if (time_dependent_) {
+    RecostPaths(graphreader, source_location_list, target_location_list);
+  }
+
   // Form the time, distance matrix from the destinations list
   uint32_t idx = 0;
   std::vector<TimeDistance> td;
@@ -189,6 +256,58 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   return td;
 }
 
+// Step the searches of all sources or targets still expanding. Each search only touches its own
+// labels, edge status and row of connections and reads the other side, which isn't expanding at
+// the same time, so they can run in parallel. Everything shared is applied afterwards in order.
+void CostMatrix::Expand(const bool forward, const uint32_t n, GraphReader& graphreader) {
+  auto& status = forward ? source_status_ : target_status_;
+  auto& remaining = forward ? remaining_sources_ : remaining_targets_;
+  active_.clear();
+  for (uint32_t i = 0; i < status.size(); i++) {
+    if (status[i].threshold > 0) {
+      status[i].threshold--;
+      active_.push_back(i);
+    }
+  }
+
+  auto search = [this, forward, n](size_t i, size_t, GraphReader& reader) {
+    if (forward) {
+      ForwardSearch(active_[i], n, reader);
+    } else {
+      BackwardSearch(active_[i], reader);
+    }
+  };
+  if (pool_ && active_.size() >= kMinParallelSearches) {
+    pool_->Run(active_.size(), search, graphreader);
+  } else {
+    for (size_t i = 0; i < active_.size(); i++) {
+      search(i, 0, graphreader);
+    }
+  }
+
+  for (auto i : active_) {
+    // Add to the list of targets that have reached these edges
+    if (!forward) {
+      for (const auto& edgeid : target_reached_[i]) {
+        (*targets_)[edgeid].push_back(i);
+      }
+      target_reached_[i].clear();
+    }
+    for (const auto& update : status_updates_[i]) {
+      UpdateStatus(update);
+    }
+    status_updates_[i].clear();
+
+    if (status[i].threshold == 0) {
+      status[i].threshold = -1;
+      status[i].frontier = kMaxCost;
+      if (remaining > 0) {
+        remaining--;
+      }
+    }
+  }
+}
+
 // Initialize all time distance to "not found". Any locations that
 // are the same get set to 0 time, distance and do not add to the
 // remaining locations set.
@@ -203,6 +322,8 @@ void CostMatrix::Initialize(
   for (uint32_t i = 0; i < target_count_; i++) {
     target_status_.emplace_back(kMaxThreshold);
   }
+  status_updates_.resize(std::max(source_count_, target_count_));
+  target_reached_.resize(target_count_);
 
   // Initialize best connection
   bool all_the_same = true;
@@ -214,6 +335,7 @@ void CostMatrix::Initialize(
       if (equals(source_locations.Get(i).ll(), target_locations.Get(j).ll())) {
         best_connection_.emplace_back(empty, empty, trivial_cost, 0.0f);
         best_connection_.back().found = true;
+        source_status_[i].connections++;
       } else {
         best_connection_.emplace_back(empty, empty, max_cost, kMaxCost);
         source_status_[i].remaining_locations.insert(j);
@@ -223,6 +345,22 @@ void CostMatrix::Initialize(
     }
   }
 
+  // Sources which are at as many of their targets as they need dont have to search at all
+  if (k_nearest_ > 0) {
+    for (uint32_t i = 0; i < source_count_; i++) {
+      UpdateNearestCost(i);
+      if (source_status_[i].connections >= k_nearest_) {
+        StopSource(i, 0);
+        source_status_[i].threshold = -1;
+      }
+    }
+    for (auto& t : target_status_) {
+      if (t.remaining_locations.empty()) {
+        t.threshold = -1;
+      }
+    }
+  }
+
   // Set the remaining number of sources and targets
   remaining_sources_ = 0;
   for (const auto& s : source_status_) {
@@ -248,7 +386,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
     // Forward search is exhausted - mark this and update so we don't
     // extend searches more than we need to
     for (uint32_t target = 0; target < target_count_; target++) {
-      UpdateStatus(index, target);
+      QueueStatus(index, index, target, false);
     }
     source_status_[index].threshold = 0;
     return;
@@ -261,6 +399,15 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
     return;
   }
 
+  // The labels come out of the buckets in no particular order within a bucket
+  auto& frontier = source_status_[index].frontier;
+  frontier = std::max(frontier, pred.sortcost() - costing_->UnitSize());
+
+  // No pair within the cutoff goes through a label which is already further away than it
+  if (cost_cutoff_ > 0 && pred.cost().secs > cost_cutoff_) {
+    return;
+  }
+
   // Settle this edge
   auto& edgestate = source_edgestatus_[index];
   edgestate.Update(pred.edgeid(), EdgeSet::kPermanent);
@@ -282,6 +429,9 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
     return;
   }
 
+  // The time at the end node, it is not tracked for sources without a date_time
+  TimeInfo offset_time = TimeInfo::invalid();
+
   // lambda to expand search forward from the end node
   std::function<void(graph_tile_ptr, const GraphId&, const NodeInfo*, BDEdgeLabel&, const uint32_t,
                      const bool)>
@@ -316,14 +466,18 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
       // Skip this edge if no access is allowed (based on costing method)
       // or if a complex restriction prevents transition onto this edge.
       int restriction_idx = -1;
-      if (!costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, restriction_idx) ||
-          costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, true)) {
+      const uint64_t localtime = offset_time.valid ? offset_time.local_time : 0;
+      if (!costing_->Allowed(directededge, pred, tile, edgeid, localtime,
+                             offset_time.timezone_index, restriction_idx) ||
+          costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, true, nullptr,
+                               localtime, offset_time.timezone_index)) {
         continue;
       }
 
       // Get cost. Separate out transition cost.
       Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-      Cost newcost = pred.cost() + tc + costing_->EdgeCost(directededge, tile);
+      Cost newcost =
+          pred.cost() + tc + costing_->EdgeCost(directededge, tile, offset_time.second_of_week);
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -382,6 +536,8 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
   if (tile != nullptr) {
     const NodeInfo* nodeinfo = tile->node(node);
     if (costing_->Allowed(nodeinfo)) {
+      offset_time = source_time_info_[index].forward(pred.cost().secs,
+                                                     static_cast<int>(nodeinfo->timezone()));
       expand(tile, node, nodeinfo, pred, pred_idx, false);
     }
   }
@@ -424,7 +580,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
     // If this edge has been reached then a shortest path has been found
     // to the end node of this directed edge.
-    EdgeStatusInfo oppedgestatus = edgestate.Get(oppedge);
+    EdgeStatusInfo oppedgestatus = edgestate.GetShared(oppedge);
     if (oppedgestatus.set() != EdgeSet::kUnreachedOrReset) {
       const auto& edgelabels = target_edgelabel_[target];
       uint32_t predidx = edgelabels[oppedgestatus.index()].predecessor();
@@ -434,6 +590,9 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
       if (pred.predecessor() == kInvalidLabel && predidx == kInvalidLabel) {
         // TODO: shouldnt this use seconds? why is this using cost!?
         float s = std::abs(pred.cost().secs + opp_el.cost().secs - opp_el.transition_cost().cost);
+        if (cost_cutoff_ > 0 && s > cost_cutoff_) {
+          continue;
+        }
 
         // Update best connection and set found = true.
         // distance computation only works with the casts.
@@ -445,7 +604,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
         // Update status and update threshold if this is the last location
         // to find for this source or target
-        UpdateStatus(source, target);
+        QueueStatus(source, source, target);
       } else {
         float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels[predidx].cost().cost;
         float c = pred.cost().cost + oppcost + opp_el.transition_cost().cost;
@@ -456,6 +615,9 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
           uint32_t oppdist = (predidx == kInvalidLabel) ? 0 : edgelabels[predidx].path_distance();
           float s = pred.cost().secs + oppsec + opp_el.transition_cost().secs;
           uint32_t d = pred.path_distance() + oppdist;
+          if (cost_cutoff_ > 0 && s > cost_cutoff_) {
+            continue;
+          }
 
           // Update best connection and set a threshold
           best_connection_[idx].Update(pred.edgeid(), oppedge, Cost(c, s), d);
@@ -467,15 +629,34 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
           // Update status and update threshold if this is the last location
           // to find for this source or target
-          UpdateStatus(source, target);
+          QueueStatus(source, source, target);
         }
       }
     }
   }
 }
 
+// Queue the status update for a connection, remembering how far the searches had come
+void CostMatrix::QueueStatus(const uint32_t index,
+                             const uint32_t source,
+                             const uint32_t target,
+                             const bool connected) {
+  uint32_t label_count = source_edgelabel_[source].size() + target_edgelabel_[target].size();
+  status_updates_[index].push_back({source, target, label_count, connected});
+}
+
 // Update status when a connection is found.
-void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
+void CostMatrix::UpdateStatus(const StatusUpdate& update) {
+  const uint32_t source = update.source;
+  const uint32_t target = update.target;
+
+  // Finding a connection doesnt mean it is one of the nearest, the searches of both the source
+  // and the target carry on until StopNearestSources knows the nearest ones are final
+  if (k_nearest_ > 0 && update.connected) {
+    UpdateNearestCost(source);
+    return;
+  }
+
   // Remove the target from the source status
   auto& s = source_status_[source].remaining_locations;
   auto it = s.find(target);
@@ -484,8 +665,7 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
     if (s.empty() && source_status_[source].threshold > 0) {
       // At least 1 connection has been found to each target for this source.
       // Set a threshold to continue search for a limited number of times.
-      source_status_[source].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      source_status_[source].threshold = GetThreshold(mode_, update.label_count);
     }
   }
 
@@ -497,8 +677,87 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
     if (t.empty() && target_status_[target].threshold > 0) {
       // At least 1 connection has been found to each source for this target.
       // Set a threshold to continue search for a limited number of times.
-      target_status_[target].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      target_status_[target].threshold = GetThreshold(mode_, update.label_count);
+    }
+  }
+}
+
+// Stop looking for the remaining targets of a source
+void CostMatrix::StopSource(const uint32_t source, const uint32_t label_count) {
+  // The targets dont have to reach this source anymore
+  for (const auto target : source_status_[source].remaining_locations) {
+    auto& t = target_status_[target].remaining_locations;
+    auto it = t.find(source);
+    if (it != t.end()) {
+      t.erase(it);
+      if (t.empty() && target_status_[target].threshold > 0) {
+        target_status_[target].threshold = GetThreshold(mode_, label_count);
+      }
+    }
+  }
+  source_status_[source].remaining_locations.clear();
+
+  // Continue for a limited number of times to improve the connections found so far
+  source_status_[source].threshold = GetThreshold(mode_, label_count);
+}
+
+// The cost of the k-th nearest connection of a source so far
+void CostMatrix::UpdateNearestCost(const uint32_t source) {
+  const auto* connections = &best_connection_[source * target_count_];
+  nearest_costs_.clear();
+  for (uint32_t target = 0; target < target_count_; target++) {
+    if (connections[target].cost.secs != kMaxCost) {
+      nearest_costs_.push_back(connections[target].cost.cost);
+    }
+  }
+  auto& status = source_status_[source];
+  status.connections = nearest_costs_.size();
+  if (nearest_costs_.size() < k_nearest_) {
+    status.nearest_cost = kMaxCost;
+    return;
+  }
+  std::nth_element(nearest_costs_.begin(), nearest_costs_.begin() + k_nearest_ - 1,
+                   nearest_costs_.end());
+  status.nearest_cost = nearest_costs_[k_nearest_ - 1];
+}
+
+// Stop the sources whose nearest targets cant change anymore
+void CostMatrix::StopNearestSources() {
+  // any connection not found yet costs at least as much as where the search of its target is
+  float target_frontier = kMaxCost;
+  for (const auto& status : target_status_) {
+    target_frontier = std::min(target_frontier, status.frontier);
+  }
+
+  for (uint32_t source = 0; source < source_count_; source++) {
+    // sources which stopped searching on their own dont need their targets either
+    auto& status = source_status_[source];
+    const bool stopped = status.threshold < 0;
+    if (status.remaining_locations.empty() ||
+        (!stopped && (status.threshold == 0 || status.nearest_cost == kMaxCost ||
+                      status.nearest_cost > std::min(status.frontier, target_frontier)))) {
+      continue;
+    }
+
+    // the targets dont have to reach this source anymore, those that have no sources left stop
+    for (const auto target : status.remaining_locations) {
+      auto& t = target_status_[target];
+      t.remaining_locations.erase(source);
+      if (t.remaining_locations.empty() && t.threshold > 0) {
+        t.threshold = -1;
+        t.frontier = kMaxCost;
+        if (remaining_targets_ > 0) {
+          remaining_targets_--;
+        }
+      }
+    }
+    status.remaining_locations.clear();
+    if (!stopped) {
+      status.threshold = -1;
+      status.frontier = kMaxCost;
+      if (remaining_sources_ > 0) {
+        remaining_sources_--;
+      }
     }
   }
 }
@@ -513,7 +772,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
     // Backward search is exhausted - mark this and update so we don't
     // extend searches more than we need to
     for (uint32_t source = 0; source < source_count_; source++) {
-      UpdateStatus(source, index);
+      QueueStatus(index, source, index, false);
     }
     target_status_[index].threshold = 0;
     return;
@@ -526,6 +785,15 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
     return;
   }
 
+  // The labels come out of the buckets in no particular order within a bucket
+  auto& frontier = target_status_[index].frontier;
+  frontier = std::max(frontier, pred.sortcost() - costing_->UnitSize());
+
+  // No pair within the cutoff goes through a label which is already further away than it
+  if (cost_cutoff_ > 0 && pred.cost().secs > cost_cutoff_) {
+    return;
+  }
+
   // Settle this edge
   auto& edgestate = target_edgestatus_[index];
   edgestate.Update(pred.edgeid(), EdgeSet::kPermanent);
@@ -544,6 +812,11 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
     return;
   }
 
+  // There is no time at which the targets are reached, with sources departing at a time the
+  // backward searches use the free flow speeds as the edges get no faster than that
+  const uint32_t reverse_seconds =
+      time_dependent_ ? kFreeFlowSecondOfDay : kConstrainedFlowSecondOfDay;
+
   // Expand from node in reverse direction.
   std::function<void(graph_tile_ptr, const GraphId&, const NodeInfo*, const uint32_t, BDEdgeLabel&,
                      const uint32_t, const DirectedEdge*, const bool)>
@@ -599,7 +872,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       // we can properly recover elapsed time on the reverse path.
       Cost tc = costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
                                                 opp_pred_edge);
-      Cost newcost = pred.cost() + tc + costing_->EdgeCost(opp_edge, tile);
+      Cost newcost = pred.cost() + tc + costing_->EdgeCost(opp_edge, tile, reverse_seconds);
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -622,8 +895,8 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
                               restriction_idx);
       adj->add(idx);
 
-      // Add to the list of targets that have reached this edge
-      (*targets_)[edgeid].push_back(index);
+      // Remember this edge was reached, it is added to the targets once every search is done
+      target_reached_[index].push_back(edgeid);
     }
 
     // Handle transitions - expand from the end node of the transition
@@ -667,6 +940,138 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
   }
 }
 
+// Set when each source departs, if it has a date_time
+void CostMatrix::SetTimes(GraphReader& graphreader,
+                          const google::protobuf::RepeatedPtrField<valhalla::Location>& sources) {
+  source_time_info_.clear();
+  source_tz_cache_.clear();
+  source_tz_cache_.resize(sources.size());
+  time_dependent_ = false;
+  for (int i = 0; i < sources.size(); ++i) {
+    if (!sources.Get(i).has_date_time()) {
+      source_time_info_.push_back(TimeInfo::invalid());
+      continue;
+    }
+    valhalla::Location origin = sources.Get(i);
+    source_time_info_.push_back(TimeInfo::make(origin, graphreader, &source_tz_cache_[i]));
+    time_dependent_ = time_dependent_ || source_time_info_.back().valid;
+  }
+}
+
+// Recost the paths of the connections from the sources which depart at a time
+void CostMatrix::RecostPaths(
+    GraphReader& graphreader,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& sources,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& targets) {
+  // Each row only touches its own connections so they can be recosted in parallel
+  auto recost_row = [&](size_t source, size_t, GraphReader& reader) {
+    const auto& time_info = source_time_info_[source];
+    if (!time_info.valid) {
+      return;
+    }
+    std::vector<GraphId> path;
+    for (uint32_t target = 0; target < target_count_; target++) {
+      auto& connection = best_connection_[source * target_count_ + target];
+      float source_pct, target_pct;
+      if (!ConnectionPath(source, target, sources.Get(source), targets.Get(target), path,
+                          source_pct, target_pct)) {
+        continue;
+      }
+
+      // Keep what the search found if the path cant be recosted at that time
+      try {
+        auto label = recost_forward(reader, *costing_, path, source_pct, target_pct, time_info);
+        connection.cost = Cost(connection.cost.cost, label.cost().secs);
+        connection.distance = label.path_distance();
+      } catch (const std::exception& e) {
+        LOG_DEBUG(std::string("Could not recost a matrix connection: ") + e.what());
+      }
+    }
+  };
+  if (pool_ && source_count_ >= kMinParallelSearches) {
+    pool_->Run(source_count_, recost_row, graphreader);
+  } else {
+    for (uint32_t source = 0; source < source_count_; source++) {
+      recost_row(source, 0, graphreader);
+    }
+  }
+}
+
+// Walk the search trees of a connection to get its edges
+bool CostMatrix::ConnectionPath(const uint32_t source,
+                                const uint32_t target,
+                                const valhalla::Location& origin,
+                                const valhalla::Location& destination,
+                                std::vector<GraphId>& path,
+                                float& source_pct,
+                                float& target_pct) const {
+  path.clear();
+  if (source >= source_count_ || target >= target_count_) {
+    return false;
+  }
+  const auto& connection = best_connection_[source * target_count_ + target];
+  if (connection.cost.secs == kMaxCost || !connection.edgeid.Is_Valid()) {
+    return false;
+  }
+
+  // The forward path up to the connecting edge
+  const auto& source_labels = source_edgelabel_[source];
+  uint32_t label_idx = source_edgestatus_[source].Get(connection.edgeid).index();
+  while (label_idx != kInvalidLabel) {
+    path.push_back(source_labels[label_idx].edgeid());
+    label_idx = source_labels[label_idx].predecessor();
+  }
+  std::reverse(path.begin(), path.end());
+
+  // And the backward one onwards from it to the target
+  const auto& target_labels = target_edgelabel_[target];
+  label_idx = target_edgestatus_[target].Get(connection.opp_edgeid).index();
+  label_idx = target_labels[label_idx].predecessor();
+  while (label_idx != kInvalidLabel) {
+    path.push_back(target_labels[label_idx].opp_edgeid());
+    label_idx = target_labels[label_idx].predecessor();
+  }
+
+  // A location before the source on their only edge is a special case of the search
+  source_pct = percent_along(origin, path.front(), 0.f);
+  target_pct = percent_along(destination, path.back(), 1.f);
+  return path.size() > 1 || source_pct <= target_pct;
+}
+
+// Recover the path of a connection found by the last matrix
+std::vector<PathInfo> CostMatrix::RecoverShortestPath(GraphReader& graphreader,
+                                                      const uint32_t source,
+                                                      const uint32_t target,
+                                                      const valhalla::Location& origin,
+                                                      const valhalla::Location& destination) const {
+  std::vector<GraphId> edges;
+  float source_pct, target_pct;
+  if (!ConnectionPath(source, target, origin, destination, edges, source_pct, target_pct)) {
+    return {};
+  }
+
+  // Recost the edges to get the elapsed and turn costs along the way
+  std::vector<PathInfo> path;
+  path.reserve(edges.size());
+  size_t next = 0;
+  const auto time_info =
+      source < source_time_info_.size() ? source_time_info_[source] : TimeInfo::invalid();
+  try {
+    recost_forward(
+        graphreader, *costing_,
+        [&edges, &next]() { return next < edges.size() ? edges[next++] : GraphId{}; },
+        [this, &path](const EdgeLabel& label) {
+          path.emplace_back(mode_, label.cost(), label.edgeid(), 0, label.restriction_idx(),
+                            label.transition_cost());
+        },
+        source_pct, target_pct, time_info);
+  } catch (const std::exception& e) {
+    LOG_DEBUG(std::string("Could not recover a matrix connection: ") + e.what());
+    return {};
+  }
+  return path;
+}
+
 // Sets the source/origin locations. Search expands forward from these
 // locations.
 void CostMatrix::SetSources(GraphReader& graphreader,
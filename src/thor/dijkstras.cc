@@ -2,6 +2,7 @@
 #include "baldr/datetime.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
+#include "midgard/tracepoint.h"
 #include <algorithm>
 #include <map>
 
@@ -11,6 +12,9 @@ using namespace valhalla::sif;
 
 namespace {
 
+// Buckets with fewer labels than this are expanded on the calling thread
+constexpr size_t kMinParallelBucket = 64;
+
 // Method to get an operator Id from a map of operator strings vs. Id.
 uint32_t GetOperatorId(const graph_tile_ptr& tile,
                        uint32_t routeid,
@@ -40,16 +44,24 @@ namespace valhalla {
 namespace thor {
 
 // Default constructor
-Dijkstras::Dijkstras()
-    : access_mode_(kAutoAccess), mode_(TravelMode::kDrive), adjacencylist_(nullptr) {
+Dijkstras::Dijkstras(const label_limits_t& label_limits)
+    : access_mode_(kAutoAccess), mode_(TravelMode::kDrive), adjacencylist_(nullptr),
+      label_limits_(label_limits), expected_distance_(0.0f), pool_(nullptr),
+      parallel_distance_(0.0f) {
+}
+
+void Dijkstras::EnableParallelExpansion(ExpansionPool* pool, const float min_distance) {
+  pool_ = pool;
+  parallel_distance_ = min_distance;
 }
 
 // Clear the temporary information generated during path construction.
 void Dijkstras::Clear() {
   // Clear the edge labels, edge status flags, and adjacency list
   // TODO - clear only the edge label set that was used?
-  bdedgelabels_.clear();
-  mmedgelabels_.clear();
+  VALHALLA_TRACE3(path_labels, "dijkstras", bdedgelabels_.size(), mmedgelabels_.size());
+  label_limits_.trim(bdedgelabels_);
+  label_limits_.trim(mmedgelabels_);
   adjacencylist_.reset();
   edgestatus_.clear();
 }
@@ -65,7 +77,7 @@ void Dijkstras::Initialize(
   uint32_t edge_label_reservation;
   uint32_t bucket_count;
   GetExpansionHints(bucket_count, edge_label_reservation);
-  labels.reserve(edge_label_reservation);
+  labels.reserve(label_limits_.reservation(edge_label_reservation));
 
   // Set up lambda to get sort costs
   float range = bucket_count * bucket_size;
@@ -96,60 +108,53 @@ Dijkstras::SetTime(google::protobuf::RepeatedPtrField<valhalla::Location>& locat
   return infos;
 }
 
-// Expand from a node in the forward direction
-void Dijkstras::ExpandForward(GraphReader& graphreader,
-                              const GraphId& node,
-                              const EdgeLabel& pred,
-                              const uint32_t pred_idx,
-                              const bool from_transition,
-                              const TimeInfo& time_info) {
-  // Get the tile and the node info. Skip if tile is null (can happen
-  // with regional data sets) or if no access at the node.
-  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+// Compute the forward graph traversal calling the hooks virtually
+void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origin_locations,
+                        GraphReader& graphreader,
+                        const sif::mode_costing_t& mode_costing,
+                        const TravelMode mode) {
+  Compute<Dijkstras>(origin_locations, graphreader, mode_costing, mode);
+}
+
+// Find what the edges leaving a node would get, ExpandForward without touching the labels, the
+// edge status or the adjacency list
+void Dijkstras::FindRelaxations(GraphReader& reader,
+                                const GraphId& node,
+                                const EdgeLabel& pred,
+                                const uint32_t pred_idx,
+                                const uint32_t position,
+                                const bool from_transition,
+                                const TimeInfo& time_info,
+                                expansion_scratch_t& scratch) const {
+  graph_tile_ptr tile = reader.GetGraphTile(node);
   if (tile == nullptr) {
     return;
   }
-
-  // Get the nodeinfo
   const NodeInfo* nodeinfo = tile->node(node);
-
-  // We dont need to do transitions again we just need to queue the edges that leave them
-  if (!from_transition) {
-    // Let implementing class we are expanding from here
-    EdgeLabel* prev_pred =
-        pred.predecessor() == kInvalidLabel ? nullptr : &bdedgelabels_[pred.predecessor()];
-    ExpandingNode(graphreader, tile, nodeinfo, pred, prev_pred);
-  }
-
-  // Bail if we cant expand from here
   if (!costing_->Allowed(nodeinfo)) {
     return;
   }
-
-  // Update the time information
   auto offset_time =
       from_transition ? time_info
                       : time_info.forward(pred.cost().secs, static_cast<int>(nodeinfo->timezone()));
 
-  // Expand from end node in forward direction.
-  GraphId edgeid = {node.tileid(), node.level(), nodeinfo->edge_index()};
-  EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
-  const DirectedEdge* directededge = tile->directededge(edgeid);
-  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid, ++es) {
-    // Skip this edge if permanently labeled (best path already found to this
-    // directed edge). skip shortcuts or if no access is allowed to this edge
-    // (based on the costing method) or if a complex restriction exists for
-    // this path.
-    if (directededge->is_shortcut() || es->set() == EdgeSet::kPermanent ||
+  // Only the edges worth relaxing get costed
+  const GraphId first_edgeid = {node.tileid(), node.level(), nodeinfo->edge_index()};
+  const DirectedEdge* const first_edge = tile->directededge(first_edgeid);
+  scratch.edge_indices.clear();
+  scratch.restriction_idxs.clear();
+  GraphId edgeid = first_edgeid;
+  const DirectedEdge* directededge = first_edge;
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid) {
+    auto es = edgestatus_.GetShared(edgeid);
+    if (directededge->is_shortcut() || es.set() == EdgeSet::kPermanent ||
         !(directededge->forwardaccess() & access_mode_)) {
       continue;
     }
 
-    // Check if the edge is allowed or if a restriction occurs
     EdgeStatus* todo = nullptr;
     int restriction_idx = -1;
     if (offset_time.valid) {
-      // With date time we check time dependent restrictions and access
       if (!costing_->Allowed(directededge, pred, tile, edgeid, offset_time.local_time,
                              nodeinfo->timezone(), restriction_idx) ||
           costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true, todo,
@@ -162,244 +167,141 @@ void Dijkstras::ExpandForward(GraphReader& graphreader,
         continue;
       }
     }
+    scratch.edge_indices.push_back(i);
+    scratch.restriction_idxs.push_back(restriction_idx);
+  }
+  scratch.edge_costs.resize(scratch.edge_indices.size());
+  costing_->EdgeCosts(first_edge, scratch.edge_indices.data(), scratch.edge_indices.size(), tile,
+                      offset_time.second_of_week, scratch.edge_costs.data());
 
-    // Compute the cost and path distance to the end of this edge
-    Cost transition_cost = costing_->TransitionCost(directededge, nodeinfo, pred);
-    Cost newcost = pred.cost() + costing_->EdgeCost(directededge, tile, offset_time.second_of_week) +
-                   transition_cost;
-    uint32_t path_dist = pred.path_distance() + directededge->length();
+  for (uint32_t k = 0; k < scratch.edge_indices.size(); ++k) {
+    directededge = first_edge + scratch.edge_indices[k];
+    edgeid = first_edgeid + scratch.edge_indices[k];
+    const int restriction_idx = scratch.restriction_idxs[k];
 
-    // Check if edge is temporarily labeled and this path has less cost. If
-    // less cost the predecessor is updated and the sort cost is decremented
-    // by the difference in real cost (A* heuristic doesn't change)
-    if (es->set() == EdgeSet::kTemporary) {
-      BDEdgeLabel& lab = bdedgelabels_[es->index()];
-      if (newcost.cost < lab.cost().cost) {
-        float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
-        adjacencylist_->decrease(es->index(), newsortcost);
-        lab.Update(pred_idx, newcost, newsortcost, transition_cost, path_dist, restriction_idx);
-      }
+    // Whatever is already in the adjacency list for less is left alone
+    auto es = edgestatus_.GetShared(edgeid);
+    Cost transition_cost = costing_->TransitionCost(directededge, nodeinfo, pred);
+    Cost newcost = pred.cost() + scratch.edge_costs[k] + transition_cost;
+    if (es.set() == EdgeSet::kTemporary && newcost.cost >= bdedgelabels_[es.index()].cost().cost) {
       continue;
     }
-
-    // Only needed if you want to connect with a reverse path
     graph_tile_ptr t2 = tile;
-    GraphId oppedgeid = graphreader.GetOpposingEdgeId(edgeid, t2);
-
-    // Add edge label, add to the adjacency list and set edge status
-    uint32_t idx = bdedgelabels_.size();
-    *es = {EdgeSet::kTemporary, idx};
-    bdedgelabels_.emplace_back(pred_idx, edgeid, oppedgeid, directededge, newcost, mode_,
-                               transition_cost, path_dist, false, restriction_idx);
-    adjacencylist_->add(idx);
+    GraphId oppedgeid = reader.GetOpposingEdgeId(edgeid, t2);
+    scratch.relaxations.push_back({position, pred_idx, edgeid, oppedgeid, directededge, tile,
+                                   newcost, transition_cost,
+                                   pred.path_distance() + directededge->length(),
+                                   restriction_idx});
   }
 
-  // Handle transitions - expand from the end node of each transition
   if (!from_transition && nodeinfo->transition_count() > 0) {
     const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
-      ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true, offset_time);
+      FindRelaxations(reader, trans->endnode(), pred, pred_idx, position, true, offset_time,
+                      scratch);
     }
   }
 }
 
-// Compute the forward graph traversal
-void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origin_locations,
-                        GraphReader& graphreader,
-                        const sif::mode_costing_t& mode_costing,
-                        const TravelMode mode) {
-
-  // Set the mode and costing
-  mode_ = mode;
-  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
-  access_mode_ = costing_->access_mode();
-
-  // Prepare for a graph traversal
-  Initialize(bdedgelabels_, adjacencylist_, costing_->UnitSize());
-  SetOriginLocations(graphreader, origin_locations, costing_);
-
-  // Get the time information for all the origin locations
-  auto time_infos = SetTime(origin_locations, graphreader);
-
-  // Compute the isotile
-  auto cb_decision = ExpansionRecommendation::continue_expansion;
-  while (cb_decision != ExpansionRecommendation::stop_expansion) {
-    // Get next element from adjacency list. Check that it is valid. An
-    // invalid label indicates there are no edges that can be expanded.
-    uint32_t predindex = adjacencylist_->pop();
-    if (predindex == kInvalidLabel) {
-      break;
-    }
-
-    // Copy the EdgeLabel for use in costing and settle the edge.
-    EdgeLabel pred = bdedgelabels_[predindex];
-    edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
-
-    // Check if we should stop
-    cb_decision = ShouldExpand(graphreader, pred, InfoRoutingType::forward);
-    if (cb_decision != ExpansionRecommendation::prune_expansion) {
-      // Expand from the end node in forward direction.
-      ExpandForward(graphreader, pred.endnode(), pred, predindex, false, time_infos.front());
+// The forward graph traversal a bucket at a time
+void Dijkstras::ComputeParallel(GraphReader& graphreader, const TimeInfo& time_info) {
+  // every thread tracks time across timezones with a cache of its own
+  scratch_.resize(pool_->size());
+  std::vector<TimeInfo> time_infos(scratch_.size(), time_info);
+  for (size_t i = 0; i < scratch_.size(); ++i) {
+    scratch_[i].relaxations.clear();
+    if (time_info.tz_cache) {
+      time_infos[i].tz_cache = &scratch_[i].tz_cache;
     }
   }
-}
 
-// Expand from a node in reverse direction.
-void Dijkstras::ExpandReverse(GraphReader& graphreader,
-                              const GraphId& node,
-                              const BDEdgeLabel& pred,
-                              const uint32_t pred_idx,
-                              const DirectedEdge* opp_pred_edge,
-                              const bool from_transition,
-                              const TimeInfo& time_info) {
-  // Get the tile and the node info. Skip if tile is null (can happen
-  // with regional data sets) or if no access at the node.
-  graph_tile_ptr tile = graphreader.GetGraphTile(node);
-  if (tile == nullptr) {
-    return;
-  }
-
-  // Get the nodeinfo
-  const NodeInfo* nodeinfo = tile->node(node);
-
-  // We dont need to do transitions again we just need to queue the edges that leave them
-  if (!from_transition) {
-    // Let implementing class we are expanding from here
-    EdgeLabel* prev_pred =
-        pred.predecessor() == kInvalidLabel ? nullptr : &bdedgelabels_[pred.predecessor()];
-    ExpandingNode(graphreader, tile, nodeinfo, pred, prev_pred);
-  }
-
-  // Bail if we cant expand from here
-  if (!costing_->Allowed(nodeinfo)) {
-    return;
-  }
-
-  // Update the time information
-  auto offset_time =
-      from_transition ? time_info
-                      : time_info.reverse(pred.cost().secs, static_cast<int>(nodeinfo->timezone()));
-
-  // Expand from end node in reverse direction.
-  GraphId edgeid = {node.tileid(), node.level(), nodeinfo->edge_index()};
-  EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
-  const DirectedEdge* directededge = tile->directededge(edgeid);
-  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid, ++es) {
-    // Skip this edge if permanently labeled (best path already found to this
-    // directed edge), if no access for this mode, or if edge is a shortcut
-    if (!(directededge->reverseaccess() & access_mode_) || directededge->is_shortcut() ||
-        es->set() == EdgeSet::kPermanent) {
-      continue;
-    }
-
-    // Get end node tile, opposing edge Id, and opposing directed edge.
-    graph_tile_ptr t2 = tile;
-    auto opp_edge_id = graphreader.GetOpposingEdgeId(edgeid, t2);
-    if (t2 == nullptr) {
-      continue;
-    }
-    const DirectedEdge* opp_edge = t2->directededge(opp_edge_id);
-
-    // Check if the edge is allowed or if a restriction occurs
-    EdgeStatus* todo = nullptr;
-    int restriction_idx = -1;
-    if (offset_time.valid) {
-      // With date time we check time dependent restrictions and access
-      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, opp_edge_id,
-                                    offset_time.local_time, nodeinfo->timezone(), restriction_idx) ||
-          costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, false, todo,
-                               offset_time.local_time, nodeinfo->timezone())) {
+  auto cb_decision = ExpansionRecommendation::continue_expansion;
+  while (cb_decision != ExpansionRecommendation::stop_expansion &&
+         adjacencylist_->pop_bucket(bucket_)) {
+    label_limits_.check(bdedgelabels_, mmedgelabels_, adjacencylist_, mmadjacencylist_,
+                        edgestatus_);
+
+    // Settle the whole bucket, the child-class learns about the nodes in the order of the bucket
+    size_t expanding = 0;
+    for (const auto predindex : bucket_) {
+      const EdgeLabel& pred = bdedgelabels_[predindex];
+      edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      cb_decision = ShouldExpand(graphreader, pred, InfoRoutingType::forward);
+      if (cb_decision == ExpansionRecommendation::stop_expansion) {
+        break;
+      }
+      if (cb_decision == ExpansionRecommendation::prune_expansion) {
+        continue;
+      }
+      graph_tile_ptr tile = graphreader.GetGraphTile(pred.endnode());
+      if (tile == nullptr) {
         continue;
       }
+      EdgeLabel* prev_pred =
+          pred.predecessor() == kInvalidLabel ? nullptr : &bdedgelabels_[pred.predecessor()];
+      ExpandingNode(graphreader, tile, tile->node(pred.endnode()), pred, prev_pred);
+      bucket_[expanding++] = predindex;
+    }
+    bucket_.resize(expanding);
+
+    // Cost the edges leaving the bucket, nothing shared is changed until all of them are done
+    auto find = [this, &time_infos](size_t position, size_t thread, GraphReader& reader) {
+      const auto predindex = bucket_[position];
+      const auto& pred = bdedgelabels_[predindex];
+      FindRelaxations(reader, pred.endnode(), pred, predindex, position, false,
+                      time_infos[thread], scratch_[thread]);
+    };
+    if (bucket_.size() < kMinParallelBucket) {
+      for (size_t position = 0; position < bucket_.size(); ++position) {
+        find(position, 0, graphreader);
+      }
     } else {
-      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, opp_edge_id, 0, 0,
-                                    restriction_idx) ||
-          costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, false)) {
+      pool_->Run(bucket_.size(), find, graphreader);
+    }
+
+    // Apply them in the order of the bucket, which is the order ExpandForward would have
+    relaxations_.clear();
+    for (auto& scratch : scratch_) {
+      relaxations_.insert(relaxations_.end(), scratch.relaxations.begin(),
+                          scratch.relaxations.end());
+      scratch.relaxations.clear();
+    }
+    std::stable_sort(relaxations_.begin(), relaxations_.end(),
+                     [](const relaxation_t& a, const relaxation_t& b) {
+                       return a.position < b.position;
+                     });
+    for (const auto& relaxation : relaxations_) {
+      EdgeStatusInfo* es = edgestatus_.GetPtr(relaxation.edgeid, relaxation.tile);
+      if (es->set() == EdgeSet::kPermanent) {
         continue;
       }
-    }
-
-    // Compute the cost to the end of this edge with separate transition cost
-    Cost transition_cost = costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo,
-                                                           opp_edge, opp_pred_edge);
-    Cost newcost = pred.cost() + costing_->EdgeCost(opp_edge, t2, offset_time.second_of_week);
-    newcost.cost += transition_cost.cost;
-    uint32_t path_dist = pred.path_distance() + directededge->length();
-
-    // Check if edge is temporarily labeled and this path has less cost. If
-    // less cost the predecessor is updated and the sort cost is decremented
-    // by the difference in real cost (A* heuristic doesn't change)
-    if (es->set() == EdgeSet::kTemporary) {
-      BDEdgeLabel& lab = bdedgelabels_[es->index()];
-      if (newcost.cost < lab.cost().cost) {
-        float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
-        adjacencylist_->decrease(es->index(), newsortcost);
-        lab.Update(pred_idx, newcost, newsortcost, transition_cost, path_dist, restriction_idx);
+      if (es->set() == EdgeSet::kTemporary) {
+        BDEdgeLabel& lab = bdedgelabels_[es->index()];
+        if (relaxation.cost.cost < lab.cost().cost) {
+          float newsortcost = lab.sortcost() - (lab.cost().cost - relaxation.cost.cost);
+          adjacencylist_->decrease(es->index(), newsortcost);
+          lab.Update(relaxation.pred_idx, relaxation.cost, newsortcost, relaxation.transition_cost,
+                     relaxation.path_distance, relaxation.restriction_idx);
+        }
+        continue;
       }
-      continue;
-    }
-
-    // Add edge label, add to the adjacency list and set edge status
-    uint32_t idx = bdedgelabels_.size();
-    *es = {EdgeSet::kTemporary, idx};
-    bdedgelabels_.emplace_back(pred_idx, edgeid, opp_edge_id, directededge, newcost, mode_,
-                               transition_cost, path_dist, false, restriction_idx);
-    adjacencylist_->add(idx);
-  }
-
-  // Handle transitions - expand from the end node of each transition
-  if (!from_transition && nodeinfo->transition_count() > 0) {
-    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
-    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
-      ExpandReverse(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true, offset_time);
+      uint32_t idx = bdedgelabels_.size();
+      *es = {EdgeSet::kTemporary, idx};
+      bdedgelabels_.emplace_back(relaxation.pred_idx, relaxation.edgeid, relaxation.oppedgeid,
+                                 relaxation.edge, relaxation.cost, mode_,
+                                 relaxation.transition_cost, relaxation.path_distance, false,
+                                 relaxation.restriction_idx);
+      adjacencylist_->add(idx);
     }
   }
 }
 
-// Compute the reverse graph traversal
+// Compute the reverse graph traversal calling the hooks virtually
 void Dijkstras::ComputeReverse(google::protobuf::RepeatedPtrField<valhalla::Location>& dest_locations,
                                GraphReader& graphreader,
                                const sif::mode_costing_t& mode_costing,
                                const TravelMode mode) {
-  // Set the mode and costing
-  mode_ = mode;
-  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
-  access_mode_ = costing_->access_mode();
-
-  // Prepare for graph traversal
-  Initialize(bdedgelabels_, adjacencylist_, costing_->UnitSize());
-  SetDestinationLocations(graphreader, dest_locations, costing_);
-
-  // Get the time information for all the destination locations
-  auto time_infos = SetTime(dest_locations, graphreader);
-
-  // Compute the isotile
-  auto cb_decision = ExpansionRecommendation::continue_expansion;
-  while (cb_decision != ExpansionRecommendation::stop_expansion) {
-    // Get next element from adjacency list. Check that it is valid. An
-    // invalid label indicates there are no edges that can be expanded.
-    uint32_t predindex = adjacencylist_->pop();
-    if (predindex == kInvalidLabel) {
-      break;
-    }
-
-    // Copy the EdgeLabel for use in costing and settle the edge.
-    BDEdgeLabel pred = bdedgelabels_[predindex];
-    edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
-
-    // Get the opposing predecessor directed edge. Need to make sure we get
-    // the correct one if a transition occurred
-    const DirectedEdge* opp_pred_edge =
-        graphreader.GetGraphTile(pred.opp_edgeid())->directededge(pred.opp_edgeid());
-
-    // Check if we should stop
-    cb_decision = ShouldExpand(graphreader, pred, InfoRoutingType::forward);
-    if (cb_decision != ExpansionRecommendation::prune_expansion) {
-      // Expand from the end node in forward direction.
-      ExpandReverse(graphreader, pred.endnode(), pred, predindex, opp_pred_edge, false,
-                    time_infos.front());
-    }
-  }
+  ComputeReverse<Dijkstras>(dest_locations, graphreader, mode_costing, mode);
 }
 
 // Expand from a node in forward direction using multimodal.
@@ -734,6 +636,9 @@ void Dijkstras::ComputeMultiModal(
   const GraphTile* tile;
   auto cb_decision = ExpansionRecommendation::continue_expansion;
   while (cb_decision != ExpansionRecommendation::stop_expansion) {
+    label_limits_.check(bdedgelabels_, mmedgelabels_, adjacencylist_, mmadjacencylist_,
+                        edgestatus_);
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -0,0 +1,99 @@
+#include "thor/expansion_pool.h"
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace thor {
+
+ExpansionPool::ExpansionPool(const boost::property_tree::ptree& config, const uint32_t threads)
+    : work_(nullptr), count_(0), next_(0), generation_(0), busy_(0), done_(false) {
+  for (uint32_t i = 0; i < threads; ++i) {
+    readers_.emplace_back(new GraphReader(config));
+  }
+  for (uint32_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(&ExpansionPool::Loop, this, i);
+  }
+}
+
+ExpansionPool::~ExpansionPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+  }
+  start_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ExpansionPool::Run(const size_t count, const work_t& work, GraphReader& reader) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    work_ = &work;
+    count_ = count;
+    next_.store(0);
+    busy_ = threads_.size();
+    error_ = nullptr;
+    ++generation_;
+  }
+  start_.notify_all();
+
+  // help out and then wait for the stragglers
+  Work(0, reader);
+  std::unique_lock<std::mutex> lock(mutex_);
+  finish_.wait(lock, [this]() { return busy_ == 0; });
+  work_ = nullptr;
+  if (error_) {
+    auto error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void ExpansionPool::Trim() {
+  for (auto& reader : readers_) {
+    reader->Refresh();
+    if (reader->OverCommitted()) {
+      reader->Trim();
+    }
+  }
+}
+
+void ExpansionPool::Work(const size_t thread, GraphReader& reader) {
+  for (size_t index = next_.fetch_add(1); index < count_; index = next_.fetch_add(1)) {
+    try {
+      (*work_)(index, thread, reader);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+}
+
+void ExpansionPool::Loop(const size_t thread) {
+  size_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [this, generation]() { return done_ || generation_ != generation; });
+      if (done_) {
+        return;
+      }
+      generation = generation_;
+    }
+
+    Work(thread + 1, *readers_[thread]);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0) {
+        finish_.notify_one();
+      }
+    }
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
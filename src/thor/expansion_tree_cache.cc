@@ -0,0 +1,109 @@
+#include "thor/expansion_tree_cache.h"
+
+#include <iterator>
+
+namespace {
+
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void append(std::string& key, const std::string& value) {
+  append(key, value.size());
+  key += value;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ExpansionTreeCache::ExpansionTreeCache(const size_t max_bytes)
+    : max_bytes_(max_bytes), bytes_(0), hits_(0) {
+}
+
+std::string ExpansionTreeCache::CostingKey(const Options& options) {
+  // the costing and all of its options, which also have the edges it avoids
+  std::string key = std::to_string(options.costing()) + ":";
+  for (const auto& costing_options : options.costing_options()) {
+    append(key, costing_options.SerializeAsString());
+  }
+  return key;
+}
+
+std::string ExpansionTreeCache::Key(const std::string& costing_key,
+                                    const valhalla::Location& origin) {
+  // where the expansion starts from
+  std::string key = costing_key;
+  for (const auto& edge : origin.path_edges()) {
+    append(key, edge.graph_id());
+    append(key, edge.percent_along());
+    append(key, edge.distance());
+    append(key, edge.end_node());
+  }
+  return key;
+}
+
+std::unique_ptr<ExpansionTreeCache::tree_t> ExpansionTreeCache::Take(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(key);
+  if (found == index_.end()) {
+    return nullptr;
+  }
+  auto tree = std::move(found->second->tree);
+  Erase(found->second);
+  ++hits_;
+  return tree;
+}
+
+void ExpansionTreeCache::Put(const std::string& key, std::unique_ptr<tree_t> tree) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    Erase(found->second);
+  }
+  if (!tree) {
+    return;
+  }
+  const size_t bytes = tree->bytes();
+  if (bytes > max_bytes_) {
+    return;
+  }
+  while (bytes_ + bytes > max_bytes_) {
+    Erase(std::prev(entries_.end()));
+  }
+  entries_.push_front({key, std::move(tree), bytes});
+  index_.emplace(key, entries_.begin());
+  bytes_ += bytes;
+}
+
+void ExpansionTreeCache::Erase(std::list<entry_t>::iterator entry) {
+  bytes_ -= entry->bytes;
+  index_.erase(entry->key);
+  entries_.erase(entry);
+}
+
+void ExpansionTreeCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+size_t ExpansionTreeCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.size();
+}
+
+size_t ExpansionTreeCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+uint64_t ExpansionTreeCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+} // namespace thor
+} // namespace valhalla
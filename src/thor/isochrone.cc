@@ -3,7 +3,9 @@
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
 #include <algorithm>
+#include <functional>
 #include <iostream> // TODO remove if not needed
+#include <limits>
 #include <map>
 
 using namespace valhalla::midgard;
@@ -12,6 +14,9 @@ using namespace valhalla::sif;
 
 namespace {
 
+// A cell of the isotile that no location has reached yet
+constexpr uint32_t kNoLocation = std::numeric_limits<uint32_t>::max();
+
 // Method to get an operator Id from a map of operator strings vs. Id.
 uint32_t GetOperatorId(const graph_tile_ptr& tile,
                        uint32_t routeid,
@@ -43,7 +48,15 @@ namespace thor {
 constexpr uint32_t kInitialEdgeLabelCount = 500000;
 
 // Default constructor
-Isochrone::Isochrone() : Dijkstras(), shape_interval_(50.0f) {
+Isochrone::Isochrone(const label_limits_t& label_limits)
+    : Dijkstras(label_limits), shape_interval_(50.0f), location_count_(0), location_(0),
+      network_(false) {
+}
+
+void Isochrone::Clear() {
+  Dijkstras::Clear();
+  label_limits_.trim(reached_edges_);
+  edge_starts_.clear();
 }
 
 // Construct the isotile. Use a fixed grid size. Convert time in minutes to
@@ -89,6 +102,14 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
   }
   // Either the user-specified or estimated max distance
   max_distance = std::max(max_distance, max_meters_);
+  expected_distance_ = max_distance;
+
+  // The reached edges are kept instead
+  network_ = api.options().network();
+  if (network_) {
+    isotile_.reset();
+    return;
+  }
 
   // Form bounding box that's just big enough to surround all of the locations.
   // Convert to PointLL
@@ -161,6 +182,61 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
   }
 }
 
+// Tag the edges at each location with its index so the expansion from there carries it along
+void Isochrone::InitLocationTracking(const valhalla::Api& api, GraphReader& graphreader) {
+  edge_locations_.clear();
+  nearest_locations_.clear();
+  location_count_ = api.options().per_location() ? api.options().locations_size() : 0;
+  if (location_count_ == 0) {
+    return;
+  }
+
+  if (isotile_) {
+    nearest_locations_.resize(isotile_->TileCount(), {kNoLocation, kNoLocation});
+  }
+  for (uint32_t i = 0; i < location_count_; ++i) {
+    const auto& location = api.options().locations(i);
+    if (isotile_) {
+      auto tile_id = isotile_->TileId({location.ll().lng(), location.ll().lat()});
+      if (tile_id >= 0 && nearest_locations_[tile_id][0] == kNoLocation) {
+        nearest_locations_[tile_id] = {i, i};
+      }
+    }
+    // the reverse expansion starts on the opposing edges
+    for (const auto& edge : location.path_edges()) {
+      graph_tile_ptr tile;
+      edge_locations_.emplace(edge.graph_id(), i);
+      edge_locations_.emplace(graphreader.GetOpposingEdgeId(GraphId(edge.graph_id()), tile).value,
+                              i);
+    }
+  }
+}
+
+// The expansion starts part way along the edges at the locations, the reverse one on their
+// opposing edges
+void Isochrone::InitNetwork(const valhalla::Api& api,
+                            GraphReader& graphreader,
+                            const bool reverse) {
+  reached_edges_.clear();
+  edge_starts_.clear();
+  if (!network_) {
+    return;
+  }
+  for (const auto& location : api.options().locations()) {
+    for (const auto& edge : location.path_edges()) {
+      if (!reverse) {
+        edge_starts_.emplace(edge.graph_id(), edge.percent_along());
+        continue;
+      }
+      graph_tile_ptr tile;
+      auto opp = graphreader.GetOpposingEdgeId(GraphId(edge.graph_id()), tile);
+      if (opp.Is_Valid()) {
+        edge_starts_.emplace(opp.value, 1.0f - edge.percent_along());
+      }
+    }
+  }
+}
+
 // Compute iso-tile that we can use to generate isochrones.
 std::shared_ptr<const GriddedData<2>> Isochrone::Compute(Api& api,
                                                          GraphReader& graphreader,
@@ -168,8 +244,12 @@ std::shared_ptr<const GriddedData<2>> Isochrone::Compute(Api& api,
                                                          const TravelMode mode) {
   // Initialize and create the isotile
   ConstructIsoTile(false, api, mode);
+  InitLocationTracking(api, graphreader);
+  InitNetwork(api, graphreader, false);
   // Compute the expansion
-  Dijkstras::Compute(*api.mutable_options()->mutable_locations(), graphreader, mode_costing, mode);
+  Dijkstras::Compute<Isochrone>(*api.mutable_options()->mutable_locations(), graphreader,
+                                mode_costing, mode);
+  edge_locations_.clear();
   return isotile_;
 }
 
@@ -182,9 +262,12 @@ Isochrone::ComputeReverse(Api& api,
 
   // Initialize and create the isotile
   ConstructIsoTile(false, api, mode);
+  InitLocationTracking(api, graphreader);
+  InitNetwork(api, graphreader, true);
   // Compute the expansion
-  Dijkstras::ComputeReverse(*api.mutable_options()->mutable_locations(), graphreader, mode_costing,
-                            mode);
+  Dijkstras::ComputeReverse<Isochrone>(*api.mutable_options()->mutable_locations(), graphreader,
+                                       mode_costing, mode);
+  edge_locations_.clear();
   return isotile_;
 }
 
@@ -196,9 +279,12 @@ Isochrone::ComputeMultiModal(Api& api,
                              const TravelMode mode) {
   // Initialize and create the isotile
   ConstructIsoTile(true, api, mode);
+  InitLocationTracking(api, graphreader);
+  InitNetwork(api, graphreader, false);
   // Compute the expansion
   Dijkstras::ComputeMultiModal(*api.mutable_options()->mutable_locations(), graphreader, mode_costing,
                                mode);
+  edge_locations_.clear();
   return isotile_;
 }
 
@@ -240,17 +326,17 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred,
     auto tile1 = isotile_->TileId(ll0);
     auto tile2 = isotile_->TileId(ll);
     if (tile1 == tile2) {
-      isotile_->SetIfLessThan(tile1, {secs1 * kMinPerSec, dist1 * kKmPerMeter});
+      MarkIsoTile(tile1, {secs1 * kMinPerSec, dist1 * kKmPerMeter});
     } else if (isotile_->AreNeighbors(tile1, tile2)) {
       // If tile 2 is directly east, west, north, or south of tile 1 then the
       // segment will not intersect any other tiles other than tile1 and tile2.
-      isotile_->SetIfLessThan(tile1, {secs1 * kMinPerSec, dist1 * kKmPerMeter});
-      isotile_->SetIfLessThan(tile2, {secs1 * kMinPerSec, dist1 * kKmPerMeter});
+      MarkIsoTile(tile1, {secs1 * kMinPerSec, dist1 * kKmPerMeter});
+      MarkIsoTile(tile2, {secs1 * kMinPerSec, dist1 * kKmPerMeter});
     } else {
       // Find intersecting tiles (using a Bresenham method)
       auto tiles = isotile_->Intersect(std::list<PointLL>{ll0, ll});
       for (const auto& t : tiles) {
-        isotile_->SetIfLessThan(t.first, {secs1 * kMinPerSec, dist1 * kKmPerMeter});
+        MarkIsoTile(t.first, {secs1 * kMinPerSec, dist1 * kKmPerMeter});
       }
     }
     return;
@@ -284,34 +370,162 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred,
     auto tile1 = isotile_->TileId(*itr1);
     auto tile2 = isotile_->TileId(*itr2);
     if (tile1 == tile2) {
-      isotile_->SetIfLessThan(tile1, {minutes, km});
+      MarkIsoTile(tile1, {minutes, km});
     } else if (isotile_->AreNeighbors(tile1, tile2)) {
       // If tile 2 is directly east, west, north, or south of tile 1 then the
       // segment will not intersect any other tiles other than tile1 and tile2.
-      isotile_->SetIfLessThan(tile1, {minutes, km});
-      isotile_->SetIfLessThan(tile2, {minutes, km});
+      MarkIsoTile(tile1, {minutes, km});
+      MarkIsoTile(tile2, {minutes, km});
     } else {
       // Find intersecting tiles (using a Bresenham method)
       auto tiles = isotile_->Intersect(std::list<PointLL>{*itr1, *itr2});
       for (const auto& t : tiles) {
-        isotile_->SetIfLessThan(t.first, {minutes, km});
+        MarkIsoTile(t.first, {minutes, km});
+      }
+    }
+  }
+}
+
+void Isochrone::MarkIsoTile(const int tile_id, const GriddedData<2>::value_type& value) {
+  auto lowered = isotile_->SetIfLessThan(tile_id, value);
+  if (lowered && location_count_ > 0) {
+    auto& nearest = nearest_locations_[tile_id];
+    for (size_t i = 0; i < nearest.size(); ++i) {
+      if (lowered & (1 << i)) {
+        nearest[i] = location_;
       }
     }
   }
 }
 
+std::vector<std::shared_ptr<const GriddedData<2>>> Isochrone::SplitIsoTile() const {
+  std::vector<std::shared_ptr<const GriddedData<2>>> isotiles;
+  for (uint32_t i = 0; i < location_count_; ++i) {
+    auto isotile = std::make_shared<GriddedData<2>>(*isotile_);
+    for (int tile_id = 0; tile_id < static_cast<int>(nearest_locations_.size()); ++tile_id) {
+      for (size_t metric = 0; metric < nearest_locations_[tile_id].size(); ++metric) {
+        if (nearest_locations_[tile_id][metric] != i) {
+          isotile->Reset(tile_id, metric);
+        }
+      }
+    }
+    isotiles.push_back(std::move(isotile));
+  }
+  return isotiles;
+}
+
 // here we mark the cells of the isochrone along the edge we just reached up to its end node
 void Isochrone::ExpandingNode(baldr::GraphReader& graphreader,
                               graph_tile_ptr tile,
                               const baldr::NodeInfo* node,
                               const sif::EdgeLabel& current,
                               const sif::EdgeLabel* previous) {
-  // Update the isotile
+  // The edge was reached from the same location as the one before it
+  if (location_count_ > 0) {
+    auto found = edge_locations_.find(previous ? previous->edgeid() : current.edgeid());
+    location_ = found == edge_locations_.end() ? 0 : found->second;
+    edge_locations_[current.edgeid()] = location_;
+  }
+
   float secs0 = previous ? previous->cost().secs : 0.0f;
   float dist0 = previous ? static_cast<float>(previous->path_distance()) : 0.0f;
+
+  // Keep the edge to cut it to the intervals later, as with the grid you pass through transit
+  // lines and ferries rather than reach anything along them
+  if (network_) {
+    if (current.use() == Use::kFerry || current.use() == Use::kRail ||
+        current.use() == Use::kBus) {
+      return;
+    }
+    float start = 0.0f;
+    if (current.predecessor() == kInvalidLabel) {
+      auto found = edge_starts_.find(current.edgeid());
+      start = found == edge_starts_.end() ? 0.0f : found->second;
+    }
+    reached_edges_.push_back({current.edgeid(), start, secs0, current.cost().secs, dist0,
+                              static_cast<float>(current.path_distance()), location_});
+    return;
+  }
+
+  // Update the isotile
   UpdateIsoTile(current, graphreader, node->latlng(tile->header()->base_ll()), secs0, dist0);
 }
 
+GriddedData<2>::contours_t
+Isochrone::ReachableNetwork(std::vector<GriddedData<2>::contour_interval_t>& intervals,
+                            GraphReader& graphreader,
+                            std::vector<uint32_t>& location_indices) const {
+  // sort the intervals the same way the contours of the grid are
+  std::sort(intervals.begin(), intervals.end(), std::greater<>());
+  location_indices.clear();
+  const auto interval_count = intervals.size();
+  for (uint32_t i = 1; i < location_count_; ++i) {
+    intervals.insert(intervals.end(), intervals.begin(), intervals.begin() + interval_count);
+  }
+  for (uint32_t i = 0; i < location_count_; ++i) {
+    location_indices.insert(location_indices.end(), interval_count, i);
+  }
+  GriddedData<2>::contours_t contours(intervals.size(),
+                                      std::list<GriddedData<2>::feature_t>{
+                                          GriddedData<2>::feature_t{}});
+
+  // an edge reached whole in both directions only needs to be drawn once
+  std::unordered_map<uint64_t, size_t> reached;
+  for (size_t i = 0; i < reached_edges_.size(); ++i) {
+    reached.emplace(reached_edges_[i].edgeid, i);
+  }
+
+  graph_tile_ptr tile;
+  for (size_t i = 0; i < reached_edges_.size(); ++i) {
+    const auto& reached_edge = reached_edges_[i];
+    const auto* edge = graphreader.directededge(reached_edge.edgeid, tile);
+    if (!edge) {
+      continue;
+    }
+    graph_tile_ptr opp_tile = tile;
+    auto opp = graphreader.GetOpposingEdgeId(reached_edge.edgeid, opp_tile);
+    auto found = reached.find(opp);
+    const reached_edge_t* opposing =
+        found == reached.end() || found->second > i ? nullptr : &reached_edges_[found->second];
+
+    std::vector<PointLL> shape;
+    for (size_t c = 0; c < interval_count; ++c) {
+      const auto& interval = intervals[c];
+      const auto limit = std::get<1>(interval);
+      auto value = [&interval](const float secs, const float dist) {
+        return std::get<0>(interval) == 0 ? secs * kMinPerSec : dist * kKmPerMeter;
+      };
+      const auto m0 = value(reached_edge.secs0, reached_edge.dist0);
+      const auto m1 = value(reached_edge.secs1, reached_edge.dist1);
+      if (m0 > limit) {
+        continue;
+      }
+      if (m1 <= limit && opposing && opposing->start == 0.0f &&
+          value(opposing->secs1, opposing->dist1) <= limit) {
+        continue;
+      }
+
+      // how far along the edge the interval runs out, the time and distance change evenly
+      auto end = 1.0f;
+      if (m1 > limit) {
+        end = reached_edge.start + (limit - m0) / (m1 - m0) * (1.0f - reached_edge.start);
+      }
+      if (shape.empty()) {
+        shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
+        if (!edge->forward()) {
+          std::reverse(shape.begin(), shape.end());
+        }
+      }
+      auto line = trim_polyline(shape.begin(), shape.end(), reached_edge.start, end);
+      if (line.size() > 1) {
+        contours[reached_edge.location * interval_count + c].front().emplace_back(line.begin(),
+                                                                                    line.end());
+      }
+    }
+  }
+  return contours;
+}
+
 ExpansionRecommendation Isochrone::ShouldExpand(baldr::GraphReader& /*graphreader*/,
                                                 const sif::EdgeLabel& pred,
                                                 const InfoRoutingType route_type) {
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <iterator>
+
+#include "midgard/tracepoint.h"
 #include "midgard/util.h"
 #include "thor/worker.h"
 #include "tyr/serializers.h"
@@ -32,20 +36,139 @@ std::string thor_worker_t::isochrones(Api& request) {
     options.set_generalize(kOptimalGeneralization);
   }
 
-  // get the raster
-  auto grid = (costing == "multimodal" || costing == "transit")
-                  ? isochrone_gen.ComputeMultiModal(request, *reader, mode_costing, mode)
-                  : isochrone_gen.Compute(request, *reader, mode_costing, mode);
+  // the expansions away from the locations and or towards them
+  const std::vector<bool> directions = options.both_directions()
+                                           ? std::vector<bool>{false, true}
+                                           : std::vector<bool>{options.reverse()};
+  const bool multimodal = costing == "multimodal" || costing == "transit";
+
+  // a grid computed before for the same locations reaching as far can be contoured again, grids
+  // split by location or networks arent kept
+  std::vector<std::shared_ptr<const GriddedData<2>>> grids(directions.size());
+  std::vector<std::string> cache_keys(directions.size());
+  float max_minutes = -1.f, max_km = -1.f;
+  const bool cached = isochrone_cache && !options.per_location() && !options.network();
+  if (cached) {
+    const auto traffic_generation = reader->TrafficGeneration();
+    if (traffic_generation != isochrone_cache_generation) {
+      isochrone_cache->Clear();
+      isochrone_cache_generation = traffic_generation;
+    }
+    for (const auto& contour : contours) {
+      auto& max = std::get<0>(contour) == 0 ? max_minutes : max_km;
+      max = std::max(max, std::get<1>(contour));
+    }
+    size_t hits = 0;
+    for (size_t i = 0; i < directions.size(); ++i) {
+      cache_keys[i] = IsochroneCache::Key(options, directions[i]);
+      grids[i] = isochrone_cache->Find(cache_keys[i], max_minutes, max_km);
+      hits += grids[i] ? 1 : 0;
+    }
+    auto* hit_stat = request.mutable_info()->mutable_statistics()->Add();
+    hit_stat->set_name("thor_worker_t::isochrone_cache_hits");
+    hit_stat->set_value(hits);
+    hit_stat->set_type(Statistic::count);
+  }
+
+  // get the rasters, the reverse expansion next to the forward one has its own generator and its
+  // own copy of the locations as the expansions fill in their times
+  std::vector<size_t> pending;
+  for (size_t i = 0; i < directions.size(); ++i) {
+    if (!grids[i]) {
+      pending.push_back(i);
+    }
+  }
+  Api reverse_request;
+  if (pending.size() > 1) {
+    reverse_request.mutable_options()->CopyFrom(options);
+  }
+  auto compute = [&](size_t index, size_t /*thread*/, GraphReader& graphreader) {
+    const auto i = pending[index];
+    auto& generator = i == 0 ? isochrone_gen : isochrone_reverse_gen;
+    auto& api = i == 0 || pending.size() == 1 ? request : reverse_request;
+    grids[i] = multimodal ? generator.ComputeMultiModal(api, graphreader, mode_costing, mode)
+               : directions[i] ? generator.ComputeReverse(api, graphreader, mode_costing, mode)
+                               : generator.Compute(api, graphreader, mode_costing, mode);
+  };
+  if (pending.size() > 1 && expansion_pool) {
+    // both expansions take up the threads so neither of them expands on the pool by itself
+    isochrone_gen.EnableParallelExpansion(nullptr, 0.f);
+    try {
+      expansion_pool->Run(pending.size(), compute, *reader);
+    } catch (...) {
+      isochrone_gen.EnableParallelExpansion(expansion_pool.get(), parallel_isochrone_distance);
+      throw;
+    }
+    isochrone_gen.EnableParallelExpansion(expansion_pool.get(), parallel_isochrone_distance);
+  } else {
+    for (size_t index = 0; index < pending.size(); ++index) {
+      compute(index, 0, *reader);
+    }
+  }
+  if (cached) {
+    for (const auto i : pending) {
+      isochrone_cache->Insert(cache_keys[i], grids[i], max_minutes, max_km);
+    }
+  }
+
+  // the contours of every direction one after the other
+  std::vector<GriddedData<2>::contour_interval_t> intervals;
+  GriddedData<2>::contours_t isolines;
+  std::vector<uint32_t> location_indices;
+  std::vector<bool> reversed;
+  for (size_t i = 0; i < directions.size(); ++i) {
+    const auto& generator = i == 0 ? isochrone_gen : isochrone_reverse_gen;
+    std::vector<GriddedData<2>::contour_interval_t> direction_intervals;
+    GriddedData<2>::contours_t direction_isolines;
+    std::vector<uint32_t> direction_location_indices;
+
+    // the network reached along with how far along its edges each interval gets
+    if (options.network()) {
+      direction_intervals = contours;
+      direction_isolines =
+          generator.ReachableNetwork(direction_intervals, *reader, direction_location_indices);
+    } // we have parallel vectors of contour properties and the actual geojson features
+    // this method sorts the contour specifications by metric (time or distance) and then by value
+    // with the largest values coming first. eg (60min, 30min, 10min, 40km, 10km)
+    else if (!options.per_location()) {
+      direction_intervals = contours;
+      direction_isolines =
+          grids[i]->GenerateContours(direction_intervals, options.polygons(), options.denoise(),
+                                     options.generalize(), contour_threads);
+    } // or the contours of every location one after the other, each only where it is the closest
+    else {
+      uint32_t location_index = 0;
+      for (const auto& location_grid : generator.SplitIsoTile()) {
+        auto location_intervals = contours;
+        auto location_isolines =
+            location_grid->GenerateContours(location_intervals, options.polygons(),
+                                            options.denoise(), options.generalize(),
+                                            contour_threads);
+        direction_intervals.insert(direction_intervals.end(), location_intervals.begin(),
+                                   location_intervals.end());
+        std::move(location_isolines.begin(), location_isolines.end(),
+                  std::back_inserter(direction_isolines));
+        direction_location_indices.insert(direction_location_indices.end(),
+                                          location_intervals.size(), location_index++);
+      }
+    }
 
-  // we have parallel vectors of contour properties and the actual geojson features
-  // this method sorts the contour specifications by metric (time or distance) and then by value
-  // with the largest values coming first. eg (60min, 30min, 10min, 40km, 10km)
-  auto isolines =
-      grid->GenerateContours(contours, options.polygons(), options.denoise(), options.generalize());
+    intervals.insert(intervals.end(), direction_intervals.begin(), direction_intervals.end());
+    std::move(direction_isolines.begin(), direction_isolines.end(), std::back_inserter(isolines));
+    location_indices.insert(location_indices.end(), direction_location_indices.begin(),
+                            direction_location_indices.end());
+    if (options.both_directions()) {
+      reversed.insert(reversed.end(), direction_intervals.size(), directions[i]);
+    }
+  }
 
   // make the final json
-  return tyr::serializeIsochrones(request, contours, isolines, options.polygons(),
-                                  options.show_locations());
+  VALHALLA_TRACE1(serialize_start, "isochrone");
+  auto response = tyr::serializeIsochrones(request, intervals, isolines,
+                                           options.polygons() && !options.network(),
+                                           options.show_locations(), location_indices, reversed);
+  VALHALLA_TRACE2(serialize_done, "isochrone", response.size());
+  return response;
 }
 
 } // namespace thor
@@ -0,0 +1,107 @@
+#include "thor/isochrone_cache.h"
+
+#include <cctype>
+#include <iterator>
+
+namespace {
+
+// Isochrones leaving within the same quarter of an hour share their expansion
+constexpr int kTimeBucketMinutes = 15;
+
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// The date and the bucket of the time of an ISO 8601 date time (YYYY-MM-DDThh:mm), as it is in
+// anything else
+std::string time_bucket(const std::string& date_time) {
+  if (date_time.size() < 16 || date_time[10] != 'T' || !std::isdigit(date_time[11]) ||
+      !std::isdigit(date_time[12]) || !std::isdigit(date_time[14]) ||
+      !std::isdigit(date_time[15])) {
+    return date_time;
+  }
+  const int minutes = ((date_time[11] - '0') * 10 + (date_time[12] - '0')) * 60 +
+                      (date_time[14] - '0') * 10 + (date_time[15] - '0');
+  return date_time.substr(0, 10) + ":" + std::to_string(minutes / kTimeBucketMinutes);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+IsochroneCache::IsochroneCache(const size_t max_bytes) : max_bytes_(max_bytes), bytes_(0) {
+}
+
+std::string IsochroneCache::Key(const Options& options, const bool reverse) {
+  // the costings and all of their options, multimodal looks at more than one of them
+  std::string key = std::to_string(options.costing()) + ":";
+  for (const auto& costing_options : options.costing_options()) {
+    auto serialized = costing_options.SerializeAsString();
+    append(key, serialized.size());
+    key += serialized;
+  }
+  append(key, static_cast<int>(options.date_time_type()));
+  append(key, reverse);
+
+  // where the expansion starts from and when
+  for (const auto& location : options.locations()) {
+    append(key, location.path_edges_size());
+    for (const auto& edge : location.path_edges()) {
+      append(key, edge.graph_id());
+      append(key, edge.percent_along());
+    }
+    key += time_bucket(location.date_time());
+    key += '\0';
+  }
+  return key;
+}
+
+IsochroneCache::grid_t
+IsochroneCache::Find(const std::string& key, const float minutes, const float km) {
+  auto found = index_.find(key);
+  if (found == index_.end() || found->second->minutes < minutes || found->second->km < km) {
+    return nullptr;
+  }
+  // move it to the front as it was just used
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return found->second->grid;
+}
+
+void IsochroneCache::Insert(const std::string& key,
+                            const grid_t& grid,
+                            const float minutes,
+                            const float km) {
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    Erase(found->second);
+  }
+  if (!grid) {
+    return;
+  }
+  const size_t bytes = grid->TileCount() * sizeof(midgard::GriddedData<2>::value_type);
+  if (bytes > max_bytes_) {
+    return;
+  }
+  while (bytes_ + bytes > max_bytes_) {
+    Erase(std::prev(entries_.end()));
+  }
+  entries_.push_front({key, grid, minutes, km, bytes});
+  index_.emplace(key, entries_.begin());
+  bytes_ += bytes;
+}
+
+void IsochroneCache::Erase(std::list<entry_t>::iterator entry) {
+  bytes_ -= entry->bytes;
+  index_.erase(entry->key);
+  entries_.erase(entry);
+}
+
+void IsochroneCache::Clear() {
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+} // namespace thor
+} // namespace valhalla
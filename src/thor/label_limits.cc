@@ -0,0 +1,14 @@
+#include "thor/label_limits.h"
+#include "midgard/logging.h"
+#include "worker.h"
+
+namespace valhalla {
+namespace thor {
+
+void label_limits_t::exceeded(size_t bytes) const {
+  LOG_WARN("Aborting search after it grew to " + std::to_string(bytes) + " bytes");
+  throw valhalla_exception_t{431};
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,290 @@
+#include "thor/local_search_optimizer.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// Up to this many locations every order is tried instead
+constexpr uint32_t kMaxExhaustiveCount = 8;
+
+// How many perturbations in a row that dont lead to a better tour end a search early
+constexpr uint32_t kMaxStalePerturbations = 200;
+
+// How long the Or-opt segments are at most
+constexpr uint32_t kMaxSegmentLength = 3;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+LocalSearchOptimizer::LocalSearchOptimizer(ExpansionPool* pool)
+    : pool_(pool), seed_(std::random_device()()), count_(0), costs_(nullptr) {
+}
+
+std::vector<uint32_t> LocalSearchOptimizer::Solve(const uint32_t count,
+                                                  const std::vector<float>& costs,
+                                                  const std::chrono::milliseconds budget,
+                                                  GraphReader& reader) {
+  count_ = count;
+  costs_ = &costs;
+  if (count_ <= kMaxExhaustiveCount) {
+    return Exhaustive();
+  }
+
+  // Every thread searches from its own start, the first one from the nearest neighbor tour
+  const auto deadline = clock_t::now() + budget;
+  const size_t searches = pool_ ? pool_->size() : 1;
+  std::vector<std::vector<uint32_t>> tours(searches);
+  auto work = [&](size_t index, size_t, GraphReader&) {
+    tours[index] = Search(static_cast<uint32_t>(index), deadline);
+  };
+  if (searches > 1) {
+    pool_->Run(searches, work, reader);
+  } else {
+    work(0, 0, reader);
+  }
+
+  auto best = std::min_element(tours.begin(), tours.end(),
+                               [this](const std::vector<uint32_t>& a,
+                                      const std::vector<uint32_t>& b) {
+                                 return TourCost(a) < TourCost(b);
+                               });
+  LOG_DEBUG("Best tour cost = " + std::to_string(TourCost(*best)) + " of " +
+            std::to_string(searches) + " searches");
+  return *best;
+}
+
+std::vector<uint32_t> LocalSearchOptimizer::Search(const uint32_t start,
+                                                   const clock_t::time_point deadline) const {
+  search_t search;
+  search.random.seed(seed_ + start);
+  if (start == 0) {
+    search.tour = NearestNeighbor();
+  } else {
+    search.tour.resize(count_);
+    for (uint32_t i = 0; i < count_; ++i) {
+      search.tour[i] = i;
+    }
+    std::shuffle(search.tour.begin() + 1, search.tour.end() - 1, search.random);
+  }
+  Reorder(search);
+  Improve(search, deadline);
+
+  // Then perturb the best tour and improve it again for as long as that pays off
+  std::vector<uint32_t> best = search.tour;
+  double best_cost = search.forward.back();
+  uint32_t stale = 0;
+  while (stale < kMaxStalePerturbations && clock_t::now() < deadline) {
+    search.tour = best;
+    Perturb(search);
+    Reorder(search);
+    Improve(search, deadline);
+    if (search.forward.back() < best_cost) {
+      best = search.tour;
+      best_cost = search.forward.back();
+      stale = 0;
+    } else {
+      ++stale;
+    }
+  }
+  return best;
+}
+
+void LocalSearchOptimizer::Reorder(search_t& search) const {
+  const uint32_t n = count_;
+  search.by_row.resize(n * n);
+  search.by_column.resize(n * n);
+  for (uint32_t a = 0; a < n; ++a) {
+    const float* row = costs_->data() + search.tour[a] * n;
+    for (uint32_t b = 0; b < n; ++b) {
+      const float cost = row[search.tour[b]];
+      search.by_row[a * n + b] = cost;
+      search.by_column[b * n + a] = cost;
+    }
+  }
+  search.link.resize(n);
+  search.forward.assign(n, 0.0);
+  search.backward.assign(n, 0.0);
+  for (uint32_t k = 0; k + 1 < n; ++k) {
+    search.link[k] = search.by_row[k * n + k + 1];
+    search.forward[k + 1] = search.forward[k] + search.link[k];
+    search.backward[k + 1] = search.backward[k] + search.by_row[(k + 1) * n + k];
+  }
+  search.link[n - 1] = 0.f;
+}
+
+bool LocalSearchOptimizer::TwoOpt(search_t& search) const {
+  // Reversing positions i through j breaks the links into i and out of j and turns the segment
+  // around, what that costs is the difference of its prefix sums
+  const uint32_t n = count_;
+  std::vector<float> twist(n);
+  for (uint32_t k = 0; k < n; ++k) {
+    twist[k] = static_cast<float>(search.backward[k] - search.forward[k]);
+  }
+  float best = 0.f;
+  uint32_t best_i = 0, best_j = 0;
+  for (uint32_t i = 1; i + 2 < n; ++i) {
+    const float* before = search.by_row.data() + (i - 1) * n;
+    const float* first = search.by_row.data() + i * n;
+    const float base = -search.link[i - 1] - twist[i];
+    for (uint32_t j = i + 1; j + 1 < n; ++j) {
+      const float delta = base + before[j] + first[j + 1] - search.link[j] + twist[j];
+      if (delta < best) {
+        best = delta;
+        best_i = i;
+        best_j = j;
+      }
+    }
+  }
+  if (best_j == 0) {
+    return false;
+  }
+  std::reverse(search.tour.begin() + best_i, search.tour.begin() + best_j + 1);
+  Reorder(search);
+  return true;
+}
+
+bool LocalSearchOptimizer::OrOpt(search_t& search) const {
+  // Moving positions i through e between p and p + 1 closes the gap it leaves and opens one
+  // where it goes, the segment may go in either way around
+  const uint32_t n = count_;
+  float best = 0.f;
+  uint32_t best_i = 0, best_e = 0, best_p = 0;
+  bool best_reversed = false;
+  for (uint32_t length = 1; length <= kMaxSegmentLength; ++length) {
+    for (uint32_t i = 1; i + length < n; ++i) {
+      const uint32_t e = i + length - 1;
+      const float removal =
+          search.by_row[(i - 1) * n + e + 1] - search.link[i - 1] - search.link[e];
+      const float twist = static_cast<float>((search.backward[e] - search.backward[i]) -
+                                             (search.forward[e] - search.forward[i]));
+      const float* into_first = search.by_column.data() + i * n;
+      const float* into_last = search.by_column.data() + e * n;
+      const float* from_first = search.by_row.data() + i * n;
+      const float* from_last = search.by_row.data() + e * n;
+      auto consider = [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t p = begin; p < end; ++p) {
+          const float forward = into_first[p] + from_last[p + 1] - search.link[p];
+          const float reversed = into_last[p] + from_first[p + 1] - search.link[p] + twist;
+          if (removal + forward < best) {
+            best = removal + forward;
+            best_i = i, best_e = e, best_p = p, best_reversed = false;
+          }
+          if (length > 1 && removal + reversed < best) {
+            best = removal + reversed;
+            best_i = i, best_e = e, best_p = p, best_reversed = true;
+          }
+        }
+      };
+      consider(0, i - 1);
+      consider(e + 1, n - 1);
+    }
+  }
+  if (best_e == 0) {
+    return false;
+  }
+
+  std::vector<uint32_t> segment(search.tour.begin() + best_i, search.tour.begin() + best_e + 1);
+  if (best_reversed) {
+    std::reverse(segment.begin(), segment.end());
+  }
+  std::vector<uint32_t> tour;
+  tour.reserve(n);
+  for (uint32_t k = 0; k < n; ++k) {
+    if (k < best_i || k > best_e) {
+      tour.push_back(search.tour[k]);
+    }
+    if (k == best_p) {
+      tour.insert(tour.end(), segment.begin(), segment.end());
+    }
+  }
+  search.tour = std::move(tour);
+  Reorder(search);
+  return true;
+}
+
+void LocalSearchOptimizer::Improve(search_t& search, const clock_t::time_point deadline) const {
+  double cost = search.forward.back();
+  while (clock_t::now() < deadline) {
+    std::vector<uint32_t> previous = search.tour;
+    if (!TwoOpt(search) && !OrOpt(search)) {
+      break;
+    }
+    // the gains are summed in floats, make sure the move really made the tour cheaper
+    if (search.forward.back() >= cost) {
+      search.tour = std::move(previous);
+      Reorder(search);
+      break;
+    }
+    cost = search.forward.back();
+  }
+}
+
+void LocalSearchOptimizer::Perturb(search_t& search) const {
+  // Cut the tour in three places between the fixed ends and swap the middle two pieces
+  std::uniform_int_distribution<uint32_t> position(1, count_ - 1);
+  uint32_t cuts[3];
+  do {
+    cuts[0] = position(search.random);
+    cuts[1] = position(search.random);
+    cuts[2] = position(search.random);
+  } while (cuts[0] == cuts[1] || cuts[0] == cuts[2] || cuts[1] == cuts[2]);
+  std::sort(std::begin(cuts), std::end(cuts));
+  std::rotate(search.tour.begin() + cuts[0], search.tour.begin() + cuts[1],
+              search.tour.begin() + cuts[2]);
+}
+
+std::vector<uint32_t> LocalSearchOptimizer::NearestNeighbor() const {
+  std::vector<uint32_t> tour{0};
+  std::vector<bool> visited(count_, false);
+  visited[0] = visited[count_ - 1] = true;
+  for (uint32_t k = 1; k + 1 < count_; ++k) {
+    uint32_t nearest = 0;
+    float nearest_cost = std::numeric_limits<float>::max();
+    for (uint32_t loc = 1; loc + 1 < count_; ++loc) {
+      if (!visited[loc] && (nearest == 0 || Cost(tour.back(), loc) < nearest_cost)) {
+        nearest = loc;
+        nearest_cost = Cost(tour.back(), loc);
+      }
+    }
+    visited[nearest] = true;
+    tour.push_back(nearest);
+  }
+  tour.push_back(count_ - 1);
+  return tour;
+}
+
+std::vector<uint32_t> LocalSearchOptimizer::Exhaustive() const {
+  std::vector<uint32_t> tour(count_);
+  for (uint32_t i = 0; i < count_; ++i) {
+    tour[i] = i;
+  }
+  std::vector<uint32_t> best = tour;
+  double best_cost = TourCost(tour);
+  if (count_ > 3) {
+    while (std::next_permutation(tour.begin() + 1, tour.end() - 1)) {
+      double cost = TourCost(tour);
+      if (cost < best_cost) {
+        best = tour;
+        best_cost = cost;
+      }
+    }
+  }
+  return best;
+}
+
+double LocalSearchOptimizer::TourCost(const std::vector<uint32_t>& tour) const {
+  double cost = 0.0;
+  for (size_t k = 0; k + 1 < tour.size(); ++k) {
+    cost += Cost(tour[k], tour[k + 1]);
+  }
+  return cost;
+}
+
+} // namespace thor
+} // namespace valhalla
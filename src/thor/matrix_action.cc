@@ -1,6 +1,10 @@
+#include <functional>
+
+#include "midgard/tracepoint.h"
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/contraction_matrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
@@ -16,7 +20,47 @@ using namespace valhalla::thor;
 namespace {
 
 constexpr double kMilePerMeter = 0.000621371;
+
+// The distinct locations, as far as a matrix is concerned that is where they are, when they are
+// and the edges they were correlated to. Each location is given the index of its distinct one
+google::protobuf::RepeatedPtrField<valhalla::Location>
+distinct(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+         std::vector<uint32_t>& indices) {
+  google::protobuf::RepeatedPtrField<valhalla::Location> unique;
+  std::unordered_map<std::string, uint32_t> seen;
+  indices.reserve(locations.size());
+  for (const auto& location : locations) {
+    valhalla::Location key;
+    *key.mutable_ll() = location.ll();
+    if (location.has_date_time()) {
+      key.set_date_time(location.date_time());
+    }
+    *key.mutable_path_edges() = location.path_edges();
+    auto inserted = seen.emplace(key.SerializeAsString(), unique.size());
+    if (inserted.second) {
+      unique.Add()->CopyFrom(location);
+    }
+    indices.push_back(inserted.first->second);
+  }
+  return unique;
+}
+
+// Fills in the rows and columns of the duplicated locations from those of their distinct ones
+std::vector<TimeDistance> expand(const std::vector<TimeDistance>& time_distances,
+                                 const std::vector<uint32_t>& source_indices,
+                                 const std::vector<uint32_t>& target_indices,
+                                 const size_t distinct_targets) {
+  std::vector<TimeDistance> expanded;
+  expanded.reserve(source_indices.size() * target_indices.size());
+  for (const auto source : source_indices) {
+    const auto* row = time_distances.data() + source * distinct_targets;
+    for (const auto target : target_indices) {
+      expanded.push_back(row[target]);
+    }
+  }
+  return expanded;
 }
+} // namespace
 
 namespace valhalla {
 namespace thor {
@@ -37,49 +81,146 @@ std::string thor_worker_t::matrix(Api& request) {
     distance_scale = kMilePerMeter;
   }
 
-  json::MapPtr json;
+  // Repeated locations, like the same list given as sources and targets with a depot in it more
+  // than once, are only computed once
+  std::vector<uint32_t> source_indices, target_indices;
+  const auto sources = distinct(options.sources(), source_indices);
+  const auto targets = distinct(options.targets(), target_indices);
+
   // do the real work
-  std::vector<TimeDistance> time_distances;
-  auto costmatrix = [&]() {
-    thor::CostMatrix matrix;
-    return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
+  auto costmatrix = [&](const google::protobuf::RepeatedPtrField<valhalla::Location>& sources) {
+    thor::CostMatrix matrix(label_limits, expansion_pool.get());
+    matrix.SetLimits(options.k_nearest(), options.cost_cutoff());
+    return matrix.SourceToTarget(sources, targets, *reader, mode_costing, mode,
                                  max_matrix_distance.find(costing)->second);
   };
-  auto timedistancematrix = [&]() {
-    thor::TimeDistanceMatrix matrix;
-    return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
-  };
-  switch (source_to_target_algorithm) {
-    case SELECT_OPTIMAL:
-      // TODO - Do further performance testing to pick the best algorithm for the job
-      switch (mode) {
-        case TravelMode::kPedestrian:
-        case TravelMode::kBicycle:
-          // Use CostMatrix if number of sources and number of targets
-          // exceeds some threshold
-          if (options.sources().size() > kCostMatrixThreshold &&
-              options.targets().size() > kCostMatrixThreshold) {
-            time_distances = costmatrix();
-          } else {
-            time_distances = timedistancematrix();
-          }
-          break;
-        case TravelMode::kPublicTransit:
-          time_distances = timedistancematrix();
+  // rows from origins searched before carry on from their trees, unless the traffic changed
+  uint64_t tree_hits = 0;
+  if (matrix_tree_cache) {
+    const auto traffic_generation = reader->TrafficGeneration();
+    if (traffic_generation != matrix_tree_cache_generation) {
+      matrix_tree_cache->Clear();
+      matrix_tree_cache_generation = traffic_generation;
+    }
+    tree_hits = matrix_tree_cache->hits();
+  }
+  bool searched_trees = false;
+  auto timedistancematrix =
+      [&](const google::protobuf::RepeatedPtrField<valhalla::Location>& sources) {
+        thor::TimeDistanceMatrix matrix(label_limits, expansion_pool.get());
+        if (matrix_tree_cache) {
+          matrix.SetTreeCache(matrix_tree_cache.get(), ExpansionTreeCache::CostingKey(options));
+          searched_trees = true;
+        }
+        return matrix.SourceToTarget(sources, targets, *reader, mode_costing, mode,
+                                     max_matrix_distance.find(costing)->second);
+      };
+  // the contraction hierarchy of the costing, if there is one, the costing doesnt use live traffic
+  // and the request is not time dependent
+  const baldr::ContractionHierarchy* hierarchy = get_hierarchy(options);
+  bool time_dependent = false;
+  for (const auto* locations : {&sources, &targets}) {
+    for (const auto& location : *locations) {
+      hierarchy = location.has_date_time() ? nullptr : hierarchy;
+      time_dependent = time_dependent || (locations == &sources && location.has_date_time());
+    }
+  }
+  auto contractionmatrix =
+      [&](const google::protobuf::RepeatedPtrField<valhalla::Location>& sources) {
+        thor::ContractionMatrix matrix(*hierarchy, expansion_pool.get());
+        return matrix.SourceToTarget(sources, targets, *reader, mode_costing, mode);
+      };
+  // Only the cost matrix can stop once it found the nearest targets or the pairs within a cutoff
+  // and it is the one which follows the time along the way from sources departing at one
+  std::function<std::vector<TimeDistance>(
+      const google::protobuf::RepeatedPtrField<valhalla::Location>&)>
+      source_to_target;
+  if (options.k_nearest() > 0 || options.cost_cutoff() > 0 || time_dependent) {
+    source_to_target = costmatrix;
+  } else {
+    switch (source_to_target_algorithm) {
+      case SELECT_OPTIMAL:
+        // A hierarchy beats searching the graph for every location
+        if (hierarchy) {
+          source_to_target = contractionmatrix;
           break;
-        default:
-          time_distances = costmatrix();
+        }
+        // TODO - Do further performance testing to pick the best algorithm for the job
+        switch (mode) {
+          case TravelMode::kPedestrian:
+          case TravelMode::kBicycle:
+            // Use CostMatrix if number of sources and number of targets
+            // exceeds some threshold
+            if (sources.size() > kCostMatrixThreshold && targets.size() > kCostMatrixThreshold) {
+              source_to_target = costmatrix;
+            } else {
+              source_to_target = timedistancematrix;
+            }
+            break;
+          case TravelMode::kPublicTransit:
+            source_to_target = timedistancematrix;
+            break;
+          default:
+            source_to_target = costmatrix;
+        }
+        break;
+      case COST_MATRIX:
+        source_to_target = costmatrix;
+        break;
+      case TIME_DISTANCE_MATRIX:
+        source_to_target = timedistancematrix;
+        break;
+      case CONTRACTION_MATRIX:
+        if (hierarchy) {
+          source_to_target = contractionmatrix;
+        } else {
+          source_to_target = costmatrix;
+        }
+        break;
+    }
+  }
+
+  // Huge matrices are done a block of rows at a time, each block is serialized as soon as it is
+  // done so that neither the search state nor the results of more than one block are ever held
+  const size_t block_size =
+      matrix_row_block_size && source_indices.size() > matrix_row_block_size
+          ? matrix_row_block_size
+          : source_indices.size();
+  tyr::MatrixSerializer serializer(request, distance_scale);
+  if (block_size == source_indices.size()) {
+    auto time_distances = source_to_target(sources);
+    if (sources.size() < options.sources_size() || targets.size() < options.targets_size()) {
+      time_distances = expand(time_distances, source_indices, target_indices, targets.size());
+    }
+    serializer.AddRows(time_distances);
+  } else {
+    for (size_t first = 0; first < source_indices.size(); first += block_size) {
+      // the distinct sources of the block, the same source is still only done once within it
+      google::protobuf::RepeatedPtrField<valhalla::Location> block_sources;
+      std::vector<uint32_t> block_indices;
+      std::unordered_map<uint32_t, uint32_t> block_source;
+      const size_t last = std::min(first + block_size, source_indices.size());
+      for (size_t i = first; i < last; ++i) {
+        auto inserted = block_source.emplace(source_indices[i], block_sources.size());
+        if (inserted.second) {
+          block_sources.Add()->CopyFrom(sources.Get(source_indices[i]));
+        }
+        block_indices.push_back(inserted.first->second);
       }
-      break;
-    case COST_MATRIX:
-      time_distances = costmatrix();
-      break;
-    case TIME_DISTANCE_MATRIX:
-      time_distances = timedistancematrix();
-      break;
+      serializer.AddRows(
+          expand(source_to_target(block_sources), block_indices, target_indices, targets.size()));
+    }
+  }
+  if (searched_trees) {
+    auto* hit_stat = request.mutable_info()->mutable_statistics()->Add();
+    hit_stat->set_name("thor_worker_t::matrix_tree_cache_hits");
+    hit_stat->set_value(matrix_tree_cache->hits() - tree_hits);
+    hit_stat->set_type(Statistic::count);
   }
-  return tyr::serializeMatrix(request, time_distances, distance_scale);
+  VALHALLA_TRACE1(serialize_start, "matrix");
+  auto response = serializer.Finish();
+  VALHALLA_TRACE2(serialize_done, "matrix", response.size());
+  return response;
 }
 } // namespace thor
 } // namespace valhalla
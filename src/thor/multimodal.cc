@@ -41,8 +41,8 @@ namespace thor {
 constexpr uint64_t kInitialEdgeLabelCount = 200000;
 
 // Default constructor
-MultiModalPathAlgorithm::MultiModalPathAlgorithm()
-    : PathAlgorithm(), walking_distance_(0), mode_(TravelMode::kPedestrian), travel_type_(0),
+MultiModalPathAlgorithm::MultiModalPathAlgorithm(const label_limits_t& label_limits)
+    : PathAlgorithm(label_limits), walking_distance_(0), mode_(TravelMode::kPedestrian), travel_type_(0),
       adjacencylist_(nullptr), max_label_count_(std::numeric_limits<uint32_t>::max()) {
 }
 
@@ -60,7 +60,7 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& /*origll*/,
 
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects
-  edgelabels_.reserve(kInitialEdgeLabelCount);
+  edgelabels_.reserve(label_limits_.reservation(kInitialEdgeLabelCount));
 
   // Construct adjacency list and edge status.
   // Set bucket size and cost range based on DynamicCost.
@@ -77,7 +77,7 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& /*origll*/,
 // Clear the temporary information generated during path construction.
 void MultiModalPathAlgorithm::Clear() {
   // Clear the edge labels and destination list
-  edgelabels_.clear();
+  label_limits_.trim(edgelabels_);
   destinations_.clear();
 
   // Clear elements from the adjacency list
@@ -174,6 +174,7 @@ MultiModalPathAlgorithm::GetBestPath(valhalla::Location& origin,
       (*interrupt)();
     }
     total_labels = current_labels;
+    label_limits_.check(edgelabels_, adjacencylist_, edgestatus_);
 
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
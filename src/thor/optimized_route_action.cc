@@ -5,6 +5,7 @@
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
 #include "thor/costmatrix.h"
+#include "thor/local_search_optimizer.h"
 #include "thor/optimizer.h"
 #include "thor/worker.h"
 
@@ -27,7 +28,7 @@ void thor_worker_t::optimized_route(Api& request) {
   auto& options = *request.mutable_options();
 
   // Use CostMatrix to find costs from each location to every other location
-  CostMatrix costmatrix;
+  CostMatrix costmatrix(label_limits, expansion_pool.get());
   std::vector<thor::TimeDistance> td =
       costmatrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
                                 max_matrix_distance.find(costing)->second);
@@ -52,17 +53,45 @@ void thor_worker_t::optimized_route(Api& request) {
     time_costs.emplace_back(static_cast<float>(td[i].time));
   }
 
-  Optimizer optimizer;
   // returns the optimal order of the path_locations
-  auto optimal_order = optimizer.Solve(correlated.size(), time_costs);
+  std::vector<uint32_t> optimal_order;
+  if (optimizer == LOCAL_SEARCH) {
+    LocalSearchOptimizer local_search(expansion_pool.get());
+    optimal_order =
+        local_search.Solve(correlated.size(), time_costs, optimizer_time_budget, *reader);
+  } else {
+    Optimizer annealing;
+    optimal_order = annealing.Solve(correlated.size(), time_costs);
+  }
   // put the optimal order into the locations array
   options.mutable_locations()->Clear();
   for (size_t i = 0; i < optimal_order.size(); i++) {
     options.mutable_locations()->Add()->CopyFrom(correlated.Get(optimal_order[i]));
   }
 
+  // The matrix already found the path of every leg, as long as the legs dont depend on the time
+  // or on where the route got to each location from. Any leg it cant give is routed.
+  bool time_dependent = options.has_date_time();
+  for (const auto& location : options.locations()) {
+    time_dependent = time_dependent || location.has_date_time();
+  }
+  std::function<std::vector<thor::PathInfo>(size_t)> leg_path;
+  if (!time_dependent && options.alternates() == 0 &&
+      options.sources_size() == options.targets_size()) {
+    leg_path = [&](size_t leg) -> std::vector<thor::PathInfo> {
+      const auto& origin = options.locations(leg);
+      if (origin.type() != valhalla::Location::kBreak || leg + 1 >= optimal_order.size()) {
+        return {};
+      }
+      const auto source = optimal_order[leg];
+      const auto target = optimal_order[leg + 1];
+      return costmatrix.RecoverShortestPath(*reader, source, target, options.sources(source),
+                                            options.targets(target));
+    };
+  }
+
   // run the route
-  path_depart_at(request, costing);
+  path_depart_at(request, costing, leg_path);
 }
 
 } // namespace thor
@@ -0,0 +1,228 @@
+#include "thor/raptor.h"
+
+#include <algorithm>
+
+namespace valhalla {
+namespace thor {
+
+namespace {
+constexpr uint32_t kInvalid = TransitTimetable::kInvalid;
+} // namespace
+
+Raptor::Raptor(const TransitTimetable& timetable) : timetable_(timetable) {
+}
+
+bool Raptor::Improve(const uint32_t round,
+                     const uint32_t stop,
+                     const uint32_t time,
+                     const bool by_ride) {
+  // arrivals only count if they beat the destination, as walking from there cant get it sooner
+  const auto stops = timetable_.stop_count();
+  auto& arrival = arrivals_[round * stops + stop];
+  if (time >= arrival.time || time >= best_) {
+    return false;
+  }
+  arrival = {time, by_ride};
+  touched_parents_.push_back(round * stops + stop);
+  if (!is_marked_[stop]) {
+    is_marked_[stop] = true;
+    next_marked_.push_back(stop);
+  }
+  if (round > 0 && egress_secs_[stop] != kInvalid && time + egress_secs_[stop] < best_) {
+    best_ = time + egress_secs_[stop];
+    best_round_ = round;
+    best_stop_ = stop;
+  }
+  return true;
+}
+
+uint32_t Raptor::Earliest(const query_t& query,
+                          const TransitTimetable::route_t& route,
+                          const uint32_t position,
+                          const uint32_t ready,
+                          const uint32_t before) {
+  // the trips of a route leave every stop in order so the first one that can be made is found by
+  // bisection, then the search goes on to the first that runs that day
+  uint32_t low = 0, high = before;
+  while (low < high) {
+    auto mid = (low + high) / 2;
+    if (timetable_.time(route, mid, position).departure < ready) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  for (; low < before; ++low) {
+    auto& runs = runs_[route.first_trip + low];
+    if (runs == 0) {
+      const auto& trip = timetable_.trip(route.first_trip + low);
+      runs = trip.Runs(query.date, query.dow) && (!query.wheelchair || trip.wheelchair) &&
+                     (!query.bicycle || trip.bicycle)
+                 ? 1
+                 : 2;
+    }
+    if (runs == 1) {
+      return low;
+    }
+  }
+  return kInvalid;
+}
+
+void Raptor::Scan(const query_t& query,
+                  const uint32_t round,
+                  const uint32_t route_index,
+                  const uint32_t start) {
+  const auto& route = timetable_.route(route_index);
+  const auto* previous = arrivals_.data() + (round - 1) * timetable_.stop_count();
+  uint32_t trip = kInvalid;
+  uint32_t board = 0;
+  for (uint32_t i = start; i < route.stop_count; ++i) {
+    const auto stop = timetable_.route_stop(route, i);
+    if (trip != kInvalid &&
+        Improve(round, stop, timetable_.time(route, trip, i).arrival, true)) {
+      parents_[round * timetable_.stop_count() + stop] = {kind_t::ride, trip, route_index, board,
+                                                          i, nullptr};
+    }
+
+    // see if an earlier trip can be caught here with one ride less
+    const auto& arrival = previous[stop];
+    if (arrival.time == kInvalid || i + 1 == route.stop_count) {
+      continue;
+    }
+    const auto ready = arrival.time + (arrival.by_ride ? query.change_secs : 0);
+    if (trip == kInvalid || ready <= timetable_.time(route, trip, i).departure) {
+      auto earlier = Earliest(query, route, i, ready, trip == kInvalid ? route.trip_count : trip);
+      if (earlier != kInvalid) {
+        trip = earlier;
+        board = i;
+      }
+    }
+  }
+}
+
+bool Raptor::Search(const query_t& query,
+                    const std::vector<walk_t>& access,
+                    const std::vector<walk_t>& egress,
+                    journey_t& journey,
+                    const std::function<void()>* interrupt) {
+  const auto stops = timetable_.stop_count();
+  const auto rounds = query.max_rides + 1;
+
+  // reset what the last search left behind
+  arrivals_.assign(static_cast<size_t>(rounds) * stops, {kInvalid, false});
+  parents_.resize(static_cast<size_t>(rounds) * stops);
+  for (auto index : touched_parents_) {
+    parents_[index].kind = kind_t::none;
+  }
+  touched_parents_.clear();
+  marked_.clear();
+  next_marked_.clear();
+  is_marked_.assign(stops, false);
+  route_starts_.assign(timetable_.route_count(), kInvalid);
+  egress_secs_.assign(stops, kInvalid);
+  egress_walks_.assign(stops, kInvalid);
+  runs_.assign(timetable_.trip_count(), 0);
+  best_ = kInvalid;
+  best_round_ = 0;
+  best_stop_ = kInvalid;
+
+  for (uint32_t i = 0; i < egress.size(); ++i) {
+    if (egress[i].secs < egress_secs_[egress[i].stop]) {
+      egress_secs_[egress[i].stop] = egress[i].secs;
+      egress_walks_[egress[i].stop] = i;
+    }
+  }
+  for (uint32_t i = 0; i < access.size(); ++i) {
+    if (Improve(0, access[i].stop, query.departure + access[i].secs, false)) {
+      parents_[access[i].stop] = {kind_t::access, i, kInvalid, kInvalid, kInvalid, nullptr};
+    }
+  }
+
+  for (uint32_t round = 1; round < rounds; ++round) {
+    if (interrupt) {
+      (*interrupt)();
+    }
+
+    // the routes through the stops improved in the last round and where they were first improved
+    marked_.swap(next_marked_);
+    next_marked_.clear();
+    if (marked_.empty()) {
+      break;
+    }
+    routes_.clear();
+    for (auto stop : marked_) {
+      is_marked_[stop] = false;
+      auto routes = timetable_.stop_routes(stop);
+      for (auto route = routes.first; route != routes.second; ++route) {
+        auto& start = route_starts_[route->first];
+        if (start == kInvalid) {
+          routes_.push_back(route->first);
+        }
+        start = std::min(start, route->second);
+      }
+    }
+
+    // an arrival with fewer rides is still good with more
+    std::copy(arrivals_.begin() + (round - 1) * stops, arrivals_.begin() + round * stops,
+              arrivals_.begin() + round * stops);
+    for (auto route : routes_) {
+      Scan(query, round, route, route_starts_[route]);
+      route_starts_[route] = kInvalid;
+    }
+
+    // walk from the stops just ridden to to the other platforms of their stations
+    const auto ridden = next_marked_.size();
+    for (size_t i = 0; i < ridden; ++i) {
+      const auto stop = next_marked_[i];
+      const auto time = arrivals_[round * stops + stop].time + query.transfer_secs;
+      auto transfers = timetable_.transfers(stop);
+      for (auto transfer = transfers.first; transfer != transfers.second; ++transfer) {
+        if (Improve(round, transfer->stop, time, false)) {
+          parents_[round * stops + transfer->stop] = {kind_t::transfer, stop, kInvalid,
+                                                      kInvalid, kInvalid, transfer};
+        }
+      }
+    }
+  }
+
+  if (best_ == kInvalid) {
+    return false;
+  }
+
+  // follow the parents back from the last stop, a round without one at a stop kept the arrival of
+  // the round before
+  journey.arrival = best_;
+  journey.egress = egress_walks_[best_stop_];
+  journey.legs.clear();
+  auto round = best_round_;
+  auto stop = best_stop_;
+  while (true) {
+    while (parents_[round * stops + stop].kind == kind_t::none) {
+      --round;
+    }
+    const auto& parent = parents_[round * stops + stop];
+    const auto arrival = arrivals_[round * stops + stop].time;
+    if (parent.kind == kind_t::access) {
+      journey.access = parent.from;
+      break;
+    }
+    if (parent.kind == kind_t::ride) {
+      const auto& route = timetable_.route(parent.route);
+      const auto from = timetable_.route_stop(route, parent.board);
+      const auto departure = timetable_.time(route, parent.from, parent.board).departure;
+      journey.legs.push_back({from, stop, departure, arrival, route.first_trip + parent.from,
+                              parent.route, parent.board, parent.alight, nullptr});
+      stop = from;
+      --round;
+    } else {
+      journey.legs.push_back({parent.from, stop, arrival - query.transfer_secs, arrival, kInvalid,
+                              kInvalid, kInvalid, kInvalid, parent.transfer});
+      stop = parent.from;
+    }
+  }
+  std::reverse(journey.legs.begin(), journey.legs.end());
+  return true;
+}
+
+} // namespace thor
+} // namespace valhalla
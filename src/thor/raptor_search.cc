@@ -0,0 +1,239 @@
+#include "thor/raptor_search.h"
+
+#include <algorithm>
+
+#include "baldr/datetime.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Journeys with more rides than this are not looked for
+constexpr uint32_t kMaxRides = 6;
+
+// Transit lines are ridden through the timetable, not walked
+bool IsRide(const EdgeLabel& label) {
+  return label.use() == Use::kRail || label.use() == Use::kBus;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+RaptorSearch::RaptorSearch(PathAlgorithm& fallback, const label_limits_t& label_limits)
+    : PathAlgorithm(label_limits), fallback_(fallback), timetable_generation_(0),
+      access_(label_limits), egress_(label_limits) {
+}
+
+void RaptorSearch::Clear() {
+  access_.Clear();
+  access_.platforms.clear();
+  egress_.Clear();
+  egress_.platforms.clear();
+}
+
+void RaptorSearch::Walks::Walk(const valhalla::Location& location,
+                               const bool forward,
+                               const uint32_t max_distance,
+                               GraphReader& graphreader,
+                               const mode_costing_t& mode_costing) {
+  Clear();
+  platforms.clear();
+  forward_ = forward;
+  max_distance_ = max_distance;
+  google::protobuf::RepeatedPtrField<valhalla::Location> locations;
+  locations.Add()->CopyFrom(location);
+  if (forward) {
+    Compute(locations, graphreader, mode_costing, TravelMode::kPedestrian);
+  } else {
+    ComputeReverse(locations, graphreader, mode_costing, TravelMode::kPedestrian);
+  }
+}
+
+void RaptorSearch::Walks::ExpandingNode(GraphReader& /*graphreader*/,
+                                        graph_tile_ptr /*tile*/,
+                                        const NodeInfo* node,
+                                        const EdgeLabel& current,
+                                        const EdgeLabel* /*previous*/) {
+  if (node->type() != NodeType::kMultiUseTransitPlatform) {
+    return;
+  }
+  auto index = edgestatus_.Get(current.edgeid()).index();
+  auto inserted = platforms.emplace(current.endnode(), index);
+  if (!inserted.second &&
+      current.cost().secs < bdedgelabels_[inserted.first->second].cost().secs) {
+    inserted.first->second = index;
+  }
+}
+
+ExpansionRecommendation RaptorSearch::Walks::ShouldExpand(GraphReader& /*graphreader*/,
+                                                          const EdgeLabel& pred,
+                                                          const InfoRoutingType /*route_type*/) {
+  if (IsRide(pred) || pred.path_distance() > max_distance_) {
+    return ExpansionRecommendation::prune_expansion;
+  }
+  return ExpansionRecommendation::continue_expansion;
+}
+
+void RaptorSearch::Walks::GetExpansionHints(uint32_t& bucket_count,
+                                            uint32_t& edge_label_reservation) const {
+  bucket_count = 20000;
+  edge_label_reservation = 100000;
+}
+
+void RaptorSearch::Walks::Path(const GraphId& platform,
+                               std::vector<GraphId>& edges,
+                               std::vector<float>& secs) const {
+  edges.clear();
+  secs.clear();
+  for (auto index = platforms.at(platform); index != kInvalidLabel;
+       index = bdedgelabels_[index].predecessor()) {
+    const auto& label = bdedgelabels_[index];
+    edges.push_back(forward_ ? label.edgeid() : label.opp_edgeid());
+    secs.push_back(label.cost().secs);
+  }
+
+  // forward the labels hold the time at the end of their edge, in reverse the time from the start
+  // of their edge to the destination
+  if (forward_) {
+    std::reverse(edges.begin(), edges.end());
+    std::reverse(secs.begin(), secs.end());
+    return;
+  }
+  const auto total = secs.front();
+  for (size_t i = 0; i + 1 < secs.size(); ++i) {
+    secs[i] = total - secs[i + 1];
+  }
+  secs.back() = total;
+}
+
+std::vector<Raptor::walk_t> RaptorSearch::Stops(const Walks& walks,
+                                                std::vector<GraphId>& platforms) const {
+  std::vector<Raptor::walk_t> stops;
+  platforms.clear();
+  for (const auto& platform : walks.platforms) {
+    auto stop = timetable_->stop(platform.first);
+    if (stop != TransitTimetable::kInvalid) {
+      std::vector<GraphId> edges;
+      std::vector<float> secs;
+      walks.Path(platform.first, edges, secs);
+      stops.push_back({stop, static_cast<uint32_t>(secs.back() + 0.5f)});
+      platforms.push_back(platform.first);
+    }
+  }
+  return stops;
+}
+
+std::vector<std::vector<PathInfo>>
+RaptorSearch::GetBestPath(valhalla::Location& origin,
+                          valhalla::Location& destination,
+                          GraphReader& graphreader,
+                          const mode_costing_t& mode_costing,
+                          const TravelMode mode,
+                          const Options& options) {
+  // the filters are applied by the fallback only and without a time there is no timetable to go by
+  const auto& transit = options.costing_options(static_cast<int>(Costing::transit));
+  if (!origin.has_date_time() || transit.filter_stop_ids_size() > 0 ||
+      transit.filter_operator_ids_size() > 0 || transit.filter_route_ids_size() > 0) {
+    return fallback_.GetBestPath(origin, destination, graphreader, mode_costing, mode, options);
+  }
+
+  // the stops and trips of the timetable are those of the tiles it was read from
+  if (!timetable_ || timetable_generation_ != graphreader.TilesetGeneration()) {
+    raptor_.reset();
+    timetable_.reset(new TransitTimetable(graphreader));
+    raptor_.reset(new Raptor(*timetable_));
+    timetable_generation_ = graphreader.TilesetGeneration();
+  }
+  if (timetable_->route_count() == 0) {
+    return fallback_.GetBestPath(origin, destination, graphreader, mode_costing, mode, options);
+  }
+
+  // walk to the platforms around both locations
+  const auto& pc = mode_costing[static_cast<uint32_t>(TravelMode::kPedestrian)];
+  const auto& tc = mode_costing[static_cast<uint32_t>(TravelMode::kPublicTransit)];
+  pc->SetAllowTransitConnections(true);
+  pc->UseMaxMultiModalDistance();
+  const auto& walk = options.costing_options(static_cast<int>(Costing::pedestrian));
+  const auto max_walk = walk.transit_start_end_max_distance();
+  access_.Walk(origin, true, max_walk, graphreader, mode_costing);
+  if (interrupt) {
+    (*interrupt)();
+  }
+  egress_.Walk(destination, false, max_walk, graphreader, mode_costing);
+
+  std::vector<GraphId> access_platforms, egress_platforms;
+  auto access = Stops(access_, access_platforms);
+  auto egress = Stops(egress_, egress_platforms);
+
+  Raptor::query_t query{};
+  query.departure = DateTime::seconds_from_midnight(origin.date_time());
+  query.date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(origin.date_time()));
+  query.dow = DateTime::day_of_week_mask(origin.date_time());
+  query.wheelchair = tc->wheelchair();
+  query.bicycle = tc->bicycle();
+  query.change_secs = tc->DefaultTransferCost().secs;
+  query.transfer_secs = tc->TransferCost().secs;
+  query.max_rides = kMaxRides;
+
+  Raptor::journey_t journey;
+  if (access.empty() || egress.empty() ||
+      !raptor_->Search(query, access, egress, journey, interrupt)) {
+    LOG_DEBUG("Raptor found no journey, falling back");
+    return fallback_.GetBestPath(origin, destination, graphreader, mode_costing, mode, options);
+  }
+  return {FormPath(query, journey, access_platforms[journey.access],
+                   egress_platforms[journey.egress])};
+}
+
+std::vector<PathInfo> RaptorSearch::FormPath(const Raptor::query_t& query,
+                                             const Raptor::journey_t& journey,
+                                             const GraphId& first_platform,
+                                             const GraphId& last_platform) {
+  std::vector<PathInfo> path;
+  std::vector<GraphId> edges;
+  std::vector<float> secs;
+  has_ferry_ = false;
+
+  access_.Path(first_platform, edges, secs);
+  for (size_t i = 0; i < edges.size(); ++i) {
+    path.emplace_back(TravelMode::kPedestrian, Cost{secs[i], secs[i]}, edges[i], 0, -1);
+  }
+
+  for (const auto& leg : journey.legs) {
+    if (leg.transfer) {
+      const auto walk = static_cast<float>(leg.arrival - leg.departure);
+      const auto start = static_cast<float>(leg.departure - query.departure);
+      for (uint32_t i = 0; i < leg.transfer->edge_count; ++i) {
+        const auto elapsed = start + walk * (i + 1) / leg.transfer->edge_count;
+        path.emplace_back(TravelMode::kPedestrian, Cost{elapsed, elapsed},
+                          timetable_->transfer_edge(leg.transfer->first_edge + i), 0, -1);
+      }
+      continue;
+    }
+    const auto& route = timetable_->route(leg.route);
+    const auto tripid = timetable_->trip(leg.trip).tripid;
+    const auto trip = leg.trip - route.first_trip;
+    for (auto position = leg.board; position < leg.alight; ++position) {
+      const auto elapsed =
+          static_cast<float>(timetable_->time(route, trip, position + 1).arrival - query.departure);
+      path.emplace_back(TravelMode::kPublicTransit, Cost{elapsed, elapsed},
+                        timetable_->route_line(route, position), tripid, -1);
+    }
+  }
+
+  egress_.Path(last_platform, edges, secs);
+  const auto arrival = static_cast<float>(journey.arrival - query.departure) -
+                       (secs.empty() ? 0.f : secs.back());
+  for (size_t i = 0; i < edges.size(); ++i) {
+    const auto elapsed = arrival + secs[i];
+    path.emplace_back(TravelMode::kPedestrian, Cost{elapsed, elapsed}, edges[i], 0, -1);
+  }
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,60 @@
+#include "baldr/datetime.h"
+#include "sif/recost.h"
+#include "thor/worker.h"
+#include "tyr/serializers.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace valhalla {
+namespace thor {
+
+std::string thor_worker_t::recost(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request, "thor_worker_t::recost");
+
+  parse_costing(request);
+  const auto& costing = *mode_costing[static_cast<size_t>(mode)];
+  const auto& edges = request.options().recost_edges();
+
+  // like the timestamps of a trace only the first one matters, it says when the path was started
+  // in the timezone of the first node it gets to and the time on the rest of the path follows
+  TimeInfo time_info = TimeInfo::invalid();
+  if (edges.begin()->time() != -1) {
+    graph_tile_ptr tile;
+    const auto* edge = reader->directededge(GraphId(edges.begin()->id()), tile);
+    const auto* node = edge ? reader->nodeinfo(edge->endnode(), tile) : nullptr;
+    const auto* tz = node ? DateTime::get_tz_db().from_index(node->timezone()) : nullptr;
+    if (tz) {
+      auto date_time = DateTime::seconds_to_date(edges.begin()->time(), tz, false);
+      time_info = TimeInfo::make(date_time, node->timezone());
+    }
+  }
+
+  // the edges have to follow on from each other, the recosting itself does not check that
+  for (int i = 1; i < edges.size(); ++i) {
+    if (!reader->AreEdgesConnectedForward(GraphId(edges.Get(i - 1).id()),
+                                          GraphId(edges.Get(i).id()))) {
+      throw valhalla_exception_t{446, "edge " + std::to_string(i) + " does not follow on"};
+    }
+  }
+
+  // walk the path once with the costing, no search and no trip leg to build
+  std::vector<EdgeLabel> labels;
+  labels.reserve(edges.size());
+  auto edge = edges.begin();
+  try {
+    recost_forward(
+        *reader, costing,
+        [&edge, &edges]() {
+          return edge == edges.end() ? GraphId{} : GraphId((edge++)->id());
+        },
+        [&labels](const EdgeLabel& label) { labels.push_back(label); }, 0.f, 1.f, time_info,
+        request.options().date_time_type() == Options::invariant);
+  } catch (const std::runtime_error& e) { throw valhalla_exception_t{446, std::string(e.what())}; }
+
+  return tyr::serializeRecost(request, labels);
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,10 +1,12 @@
 #include "thor/worker.h"
+#include <algorithm>
 #include <cstdint>
 
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
 #include "midgard/constants.h"
 #include "midgard/logging.h"
+#include "midgard/tracepoint.h"
 #include "midgard/util.h"
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
@@ -27,6 +29,127 @@ namespace {
 // A* can take excessive time for longer paths - so exclude them to protect the service.
 constexpr float kPedestrianMultipassThreshold = 50000.0f; // 50km
 
+/**
+ * The edges a search tracked for the expansion action. They are kept as compact records and
+ * written as geojson at the end instead of growing a json document as the search goes. With a
+ * maximum, every other edge is dropped whenever there are more and only every second, fourth and
+ * so on edge is tracked from there on, so the whole search still shows at a lower level of detail.
+ */
+class expansion_t {
+public:
+  explicit expansion_t(const uint32_t max_edges)
+      : max_edges_(max_edges), interval_(1), tracked_(0), algorithm_("none") {
+  }
+
+  void track(GraphReader& reader,
+             const char* algorithm,
+             const GraphId edgeid,
+             const char* status,
+             const bool full_shape) {
+    algorithm_ = algorithm;
+    if (tracked_++ % interval_) {
+      return;
+    }
+
+    // full shape might be overkill but meh, its trace
+    auto tile = reader.GetGraphTile(edgeid);
+    const auto* edge = tile->directededge(edgeid);
+    auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
+    if (!edge->forward())
+      std::reverse(shape.begin(), shape.end());
+    if (!full_shape && shape.size() > 2)
+      shape.erase(shape.begin() + 1, shape.end() - 1);
+    shape_.insert(shape_.end(), shape.begin(), shape.end());
+    edges_.push_back({edgeid, status, static_cast<uint32_t>(shape_.size())});
+
+    if (max_edges_ && edges_.size() > max_edges_) {
+      thin();
+    }
+  }
+
+  std::string serialize() const {
+    rapidjson::writer_wrapper_t writer(64 + edges_.size() * 64);
+    writer.set_precision(5);
+    writer.start_object();
+    writer("type", "FeatureCollection");
+    writer.start_object("properties");
+    writer("algorithm", algorithm_);
+    writer("interval", static_cast<uint64_t>(interval_));
+    writer.end_object();
+    writer.start_array("features");
+    writer.start_object();
+    writer("type", "Feature");
+    writer.start_object("geometry");
+    writer("type", "MultiLineString");
+    writer.start_array("coordinates");
+    uint32_t begin = 0;
+    for (const auto& edge : edges_) {
+      writer.start_array();
+      for (uint32_t i = begin; i < edge.shape_end; ++i) {
+        writer.start_array();
+        writer(static_cast<double>(shape_[i].first));
+        writer(static_cast<double>(shape_[i].second));
+        writer.end_array();
+      }
+      writer.end_array();
+      begin = edge.shape_end;
+    }
+    writer.end_array();
+    writer.end_object();
+    writer.start_object("properties");
+    writer.start_array("edge_ids");
+    for (const auto& edge : edges_) {
+      writer(static_cast<uint64_t>(edge.id));
+    }
+    writer.end_array();
+    writer.start_array("statuses");
+    for (const auto& edge : edges_) {
+      writer(edge.status);
+    }
+    writer.end_array();
+    writer.end_object();
+    writer.end_object();
+    writer.end_array();
+    writer.end_object();
+    return writer.get_buffer();
+  }
+
+protected:
+  struct edge_t {
+    GraphId id;
+    const char* status;
+    // where its shape ends in the shape of all the edges
+    uint32_t shape_end;
+  };
+
+  // Drops every other edge and tracks half as many from here on
+  void thin() {
+    uint32_t begin = 0, kept_end = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < edges_.size(); ++i) {
+      auto edge = edges_[i];
+      const auto end = edge.shape_end;
+      if (i % 2 == 0) {
+        std::copy(shape_.begin() + begin, shape_.begin() + end, shape_.begin() + kept_end);
+        kept_end += end - begin;
+        edge.shape_end = kept_end;
+        edges_[kept++] = edge;
+      }
+      begin = end;
+    }
+    edges_.resize(kept);
+    shape_.resize(kept_end);
+    interval_ *= 2;
+  }
+
+  uint32_t max_edges_;
+  uint64_t interval_;
+  uint64_t tracked_;
+  const char* algorithm_;
+  std::vector<edge_t> edges_;
+  std::vector<PointLL> shape_;
+};
+
 /**
  * Check if the paths meet at opposing edges (but not at a node). If so, add a route discontinuity
  * so that the shape / distance along the path is adjusted at the location.
@@ -133,59 +256,29 @@ std::string thor_worker_t::expansion(Api& request) {
   // time this whole method and save that statistic
   measure_scope_time(request, "thor_worker_t::expansion");
 
-  // default the expansion geojson so its easy to add to as we go
-  rapidjson::Document dom;
-  dom.SetObject();
-  rapidjson::Pointer("/type").Set(dom, "FeatureCollection");
-  rapidjson::Pointer("/properties/algorithm").Set(dom, "none");
-  rapidjson::Pointer("/features/0/type").Set(dom, "Feature");
-  rapidjson::Pointer("/features/0/geometry/type").Set(dom, "MultiLineString");
-  rapidjson::Pointer("/features/0/geometry/coordinates").Create(dom).SetArray();
-  rapidjson::Pointer("/features/0/properties/edge_ids").Create(dom).SetArray();
-  rapidjson::Pointer("/features/0/properties/statuses").Create(dom).SetArray();
-
-  // a lambda that the path algorithm can call to add stuff to the dom
-  auto track_expansion = [&dom](baldr::GraphReader& reader, const char* algorithm,
-                                baldr::GraphId edgeid, const char* status, bool full_shape = false) {
-    // full shape might be overkill but meh, its trace
-    auto tile = reader.GetGraphTile(edgeid);
-    const auto* edge = tile->directededge(edgeid);
-    auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
-    if (!edge->forward())
-      std::reverse(shape.begin(), shape.end());
-    if (!full_shape && shape.size() > 2)
-      shape.erase(shape.begin() + 1, shape.end() - 1);
-
-    // make the geom
-    auto& a = dom.GetAllocator();
-    auto* coords = rapidjson::Pointer("/features/0/geometry/coordinates").Get(dom);
-    coords->GetArray().PushBack(rapidjson::Value(rapidjson::kArrayType), a);
-    auto& linestring = (*coords)[coords->Size() - 1];
-    for (const auto& p : shape) {
-      linestring.GetArray().PushBack(rapidjson::Value(rapidjson::kArrayType), a);
-      auto point = linestring[linestring.Size() - 1].GetArray();
-      point.PushBack(p.first, a);
-      point.PushBack(p.second, a);
-    }
+  // the request can ask for less than the service shows at most
+  uint32_t max_edges = expansion_max_edges;
+  if (request.options().expansion_max_edges() &&
+      (!max_edges || request.options().expansion_max_edges() < max_edges)) {
+    max_edges = request.options().expansion_max_edges();
+  }
+  expansion_t expansion(max_edges);
 
-    // make the properties
-    rapidjson::Pointer("/properties/algorithm").Set(dom, algorithm);
-    rapidjson::Pointer("/features/0/properties/edge_ids")
-        .Get(dom)
-        ->GetArray()
-        .PushBack(static_cast<uint64_t>(edgeid), a);
-    rapidjson::Pointer("/features/0/properties/statuses")
-        .Get(dom)
-        ->GetArray()
-        .PushBack(rapidjson::Value{}.SetString(status, a), a);
+  // a lambda that the path algorithm can call to add stuff to the expansion
+  auto track_expansion = [&expansion](baldr::GraphReader& reader, const char* algorithm,
+                                      baldr::GraphId edgeid, const char* status,
+                                      bool full_shape = false) {
+    expansion.track(reader, algorithm, edgeid, status, full_shape);
   };
 
   // tell all the algorithms how to track expansion
   for (auto* alg : std::vector<PathAlgorithm*>{
            &multi_modal_astar,
+           &raptor,
            &timedep_forward,
            &timedep_reverse,
            &bidir_astar,
+           &contraction_search,
            &bss_astar,
        }) {
     alg->set_track_expansion(track_expansion);
@@ -201,16 +294,18 @@ std::string thor_worker_t::expansion(Api& request) {
   // tell all the algorithms to stop tracking the expansion
   for (auto* alg : std::vector<PathAlgorithm*>{
            &multi_modal_astar,
+           &raptor,
            &timedep_forward,
            &timedep_reverse,
            &bidir_astar,
+           &contraction_search,
            &bss_astar,
        }) {
     alg->set_track_expansion(nullptr);
   }
 
   // serialize it
-  return rapidjson::to_string(dom, 5);
+  return expansion.serialize();
 }
 
 void thor_worker_t::route(Api& request) {
@@ -245,9 +340,11 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
   // make sure they are all cancelable
   for (auto* alg : std::vector<PathAlgorithm*>{
            &multi_modal_astar,
+           &raptor,
            &timedep_forward,
            &timedep_reverse,
            &bidir_astar,
+           &contraction_search,
            &bss_astar,
        }) {
     alg->set_interrupt(interrupt);
@@ -255,7 +352,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
 
   // Have to use multimodal for transit based routing
   if (routetype == "multimodal" || routetype == "transit") {
-    return &multi_modal_astar;
+    return use_raptor ? static_cast<PathAlgorithm*>(&raptor) : &multi_modal_astar;
   }
 
   // Have to use bike share station algorithm
@@ -263,6 +360,15 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     return &bss_astar;
   }
 
+  // Fit the hierarchy limits the searches start with to how far apart the locations are, unless
+  // the request says otherwise
+  if (options.has_adaptive_hierarchy_limits() ? options.adaptive_hierarchy_limits()
+                                              : adaptive_hierarchy_limits) {
+    PointLL ll1(origin.ll().lng(), origin.ll().lat());
+    PointLL ll2(destination.ll().lng(), destination.ll().lat());
+    mode_costing[static_cast<size_t>(mode)]->AdaptHierarchyLimits(ll1.Distance(ll2));
+  }
+
   // If the origin has date_time set use timedep_forward method if the distance
   // between location is below some maximum distance (TBD).
   if (origin.has_date_time() && options.date_time_type() != Options::invariant) {
@@ -296,10 +402,38 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     }
   }
 
+  // Without time dependence or alternates a contraction hierarchy built for the costing answers
+  // the request much faster, as long as the costing options are its defaults
+  if (!origin.has_date_time() && !destination.has_date_time() && options.alternates() == 0 &&
+      get_hierarchy(options)) {
+    return &contraction_search;
+  }
+
   // No other special cases we land on bidirectional a*
   return &bidir_astar;
 }
 
+const baldr::ContractionHierarchy* thor_worker_t::get_hierarchy(const Options& options) const {
+  // Live speeds change the costs the hierarchy was contracted with
+  if (options.costing() < options.costing_options_size() &&
+      (options.costing_options(options.costing()).flow_mask() & baldr::kCurrentFlowMask) &&
+      reader->HasLiveTraffic()) {
+    return nullptr;
+  }
+  return contraction_search.Hierarchy(options);
+}
+
+const baldr::AltLandmarks* thor_worker_t::get_landmarks(const Options& options) const {
+  // The landmarks only bound paths over the access of the costing and along oneways
+  auto found = landmarks.find(options.costing());
+  if (found == landmarks.end() || options.costing() >= options.costing_options_size() ||
+      options.costing_options(options.costing()).ignore_access() ||
+      options.costing_options(options.costing()).ignore_oneways()) {
+    return nullptr;
+  }
+  return found->second.get();
+}
+
 std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm* path_algorithm,
                                                                  valhalla::Location& origin,
                                                                  valhalla::Location& destination,
@@ -312,7 +446,16 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
     cost->set_allow_destination_only(false);
   }
   cost->set_pass(0);
+
+  // The A* heuristics can use the landmarks, bidirectional A* also when it is the fallback
+  const auto* landmarks = get_landmarks(options);
+  for (auto* algorithm : std::vector<PathAlgorithm*>{&bidir_astar, &timedep_forward,
+                                                     &timedep_reverse}) {
+    algorithm->set_landmarks(landmarks);
+  }
+  VALHALLA_TRACE2(path_start, path_algorithm->name(), 0);
   auto paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+  VALHALLA_TRACE2(path_done, path_algorithm->name(), paths.size());
 
   // Check if we should run a second pass pedestrian route with different A*
   // (to look for better routes where a ferry is taken)
@@ -343,8 +486,10 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
     cost->set_allow_destination_only(true);
 
     // Get the best path. Return if not empty (else return the original path)
+    VALHALLA_TRACE2(path_start, path_algorithm->name(), 1);
     auto relaxed_paths =
         path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+    VALHALLA_TRACE2(path_done, path_algorithm->name(), relaxed_paths.size());
     if (!relaxed_paths.empty()) {
       return relaxed_paths;
     }
@@ -463,7 +608,10 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
   std::reverse(route->mutable_legs()->begin(), route->mutable_legs()->end());
 }
 
-void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
+void thor_worker_t::path_depart_at(
+    Api& api,
+    const std::string& costing,
+    const std::function<std::vector<thor::PathInfo>(size_t)>& leg_path) {
   // Things we'll need
   GraphId last_edge;
   TripRoute* route = nullptr;
@@ -476,28 +624,41 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
 
   // For each pair of locations
   for (auto destination = ++correlated.begin(); destination != correlated.end(); ++destination) {
-    // Get the algorithm type for this location pair
     auto origin = std::prev(destination);
-    thor::PathAlgorithm* path_algorithm =
-        get_path_algorithm(costing, *origin, *destination, api.options());
-    path_algorithm->Clear();
-    algorithms.push_back(path_algorithm->name());
-    LOG_INFO(std::string("algorithm::") + path_algorithm->name());
 
-    // TODO: delete this and send all cases to the function above
-    // If we are continuing through a location we need to make sure we
-    // only allow the edge that was used previously (avoid u-turns)
-    bool through = origin->type() == valhalla::Location::kThrough ||
-                   origin->type() == valhalla::Location::kBreakThrough;
-    while (through && last_edge.Is_Valid() && origin->path_edges_size() > 1) {
-      if (origin->path_edges().rbegin()->graph_id() == last_edge) {
-        origin->mutable_path_edges()->SwapElements(0, origin->path_edges_size() - 1);
+    // The path of this leg might have been found already
+    std::vector<std::vector<thor::PathInfo>> temp_paths;
+    if (leg_path) {
+      auto known_path = leg_path(std::distance(correlated.begin(), origin));
+      if (!known_path.empty()) {
+        temp_paths.emplace_back(std::move(known_path));
+        algorithms.push_back("cost_matrix");
       }
-      origin->mutable_path_edges()->RemoveLast();
     }
 
-    // Get best path and keep it
-    auto temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+    if (temp_paths.empty()) {
+      // Get the algorithm type for this location pair
+      thor::PathAlgorithm* path_algorithm =
+          get_path_algorithm(costing, *origin, *destination, api.options());
+      path_algorithm->Clear();
+      algorithms.push_back(path_algorithm->name());
+      LOG_INFO(std::string("algorithm::") + path_algorithm->name());
+
+      // TODO: delete this and send all cases to the function above
+      // If we are continuing through a location we need to make sure we
+      // only allow the edge that was used previously (avoid u-turns)
+      bool through = origin->type() == valhalla::Location::kThrough ||
+                     origin->type() == valhalla::Location::kBreakThrough;
+      while (through && last_edge.Is_Valid() && origin->path_edges_size() > 1) {
+        if (origin->path_edges().rbegin()->graph_id() == last_edge) {
+          origin->mutable_path_edges()->SwapElements(0, origin->path_edges_size() - 1);
+        }
+        origin->mutable_path_edges()->RemoveLast();
+      }
+
+      // Get best path and keep it
+      temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+    }
     for (auto& temp_path : temp_paths) {
       // forward propagate time information
       if (origin->has_date_time() && api.options().date_time_type() != valhalla::Options::invariant) {
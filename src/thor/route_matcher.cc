@@ -54,6 +54,22 @@ float length_comparison(const float length, const bool exact_match) {
   return length + tolerance;
 }
 
+// The first shape point at or after first that is far enough along the shape from the point at
+// base to be the end of an edge of this length. The tolerance only grows with the distance so no
+// point before it can match and the walk along the edge can start there instead of at base.
+size_t first_candidate(const std::vector<std::pair<float, float>>& distances,
+                       const size_t base,
+                       const size_t first,
+                       const float edge_length) {
+  const float start = distances[base].second;
+  auto candidate = std::partition_point(distances.begin() + first, distances.end(),
+                                        [start, edge_length](const std::pair<float, float>& d) {
+                                          return edge_length >=
+                                                 length_comparison(d.second - start, true);
+                                        });
+  return candidate - distances.begin();
+}
+
 // Get a map of end edges and the start node of each edge. This is used
 // to terminate the edge walking method.
 end_node_t GetEndEdges(GraphReader& reader,
@@ -131,6 +147,8 @@ bool expand_from_node(const sif::mode_costing_t& mode_costing,
 
   // Iterate through directed edges from this node
   const NodeInfo* nodeinfo = tile->node(node);
+  const float start = distances[correlated_index].second;
+  graph_tile_ptr end_node_tile = tile;
   GraphId edge_id(node.tileid(), level, nodeinfo->edge_index());
   const DirectedEdge* de = tile->directededge(nodeinfo->edge_index());
   for (uint32_t i = start_de; i < nodeinfo->edge_count(); i++, de++, ++edge_id) {
@@ -150,28 +168,30 @@ bool expand_from_node(const sif::mode_costing_t& mode_costing,
       continue;
     }
 
+    // Skip the edge if what is left of the shape is too short for it
+    size_t index = first_candidate(distances, correlated_index, correlated_index + 1, de->length());
+    if (index == shape.size()) {
+      continue;
+    }
+
     // Get the end node LL and set up the length comparison
-    graph_tile_ptr end_node_tile = reader.GetGraphTile(de->endnode());
-    if (end_node_tile == nullptr) {
+    if (!reader.GetGraphTile(de->endnode(), end_node_tile)) {
       continue;
     }
     midgard::PointLL de_end_ll = end_node_tile->get_node_ll(de->endnode());
     float de_length = length_comparison(de->length(), true);
 
     // Process current edge until shape matches end node or shape length is longer than
-    // the current edge. Increment to the next shape point after the correlated index.
-    size_t index = correlated_index + 1;
-    float length = 0.0f;
+    // the current edge. Starts at the first shape point which is long enough to match.
     while (index < shape.size()) {
       // Exclude edge if length along shape is longer than the edge length
-      length += distances.at(index).first;
+      float length = distances[index].second - start;
       if (length > de_length) {
         break;
       }
 
       // Found a match if shape equals directed edge LL within tolerance
-      if (shape.at(index).lnglat().ApproximatelyEqual(de_end_ll) &&
-          de->length() < length_comparison(length, true)) {
+      if (shape[index].lnglat().ApproximatelyEqual(de_end_ll)) {
 
         // Get seconds from beginning of the week accounting for any changes to timezone on the path
         uint32_t second_of_week = kConstrainedFlowSecondOfDay;
@@ -329,24 +349,22 @@ bool RouteMatcher::FormPath(const sif::mode_costing_t& mode_costing,
     }
     midgard::PointLL de_end_ll = end_node_tile->get_node_ll(de->endnode());
 
-    // Initialize indexes and shape
-    size_t index = 0;
-    float length = 0.0f;
+    // Initialize indexes and shape, starting at the first shape point long enough to match
     float de_remaining_length = de->length() * (1 - edge.percent_along());
     float de_length = length_comparison(de_remaining_length, true);
+    size_t index = first_candidate(distances, 0, 0, de_remaining_length);
     EdgeLabel prev_edge_label;
     Cost elapsed;
 
     // Loop over shape to form path from matching edges
     while (index < shape.size()) {
-      length += distances.at(index).first;
+      float length = distances[index].second;
       if (length > de_length) {
         break;
       }
 
       // Check if shape is within tolerance at the end node
-      if (shape.at(index).lnglat().ApproximatelyEqual(de_end_ll) &&
-          de_remaining_length < length_comparison(length, true)) {
+      if (shape[index].lnglat().ApproximatelyEqual(de_end_ll)) {
 
         // Get seconds from beginning of the week accounting for any changes to timezone on the path
         uint32_t second_of_week = kConstrainedFlowSecondOfDay;
@@ -2,6 +2,7 @@
 #include "baldr/graphconstants.h"
 #include "midgard/constants.h"
 #include "midgard/logging.h"
+#include "midgard/tracepoint.h"
 #include "thor/timedep.h"
 #include <algorithm>
 
@@ -17,8 +18,8 @@ constexpr uint64_t kInitialEdgeLabelCount = 500000;
 constexpr uint32_t kMaxIterationsWithoutConvergence = 800000;
 
 // Default constructor
-TimeDepForward::TimeDepForward()
-    : PathAlgorithm(), mode_(TravelMode::kDrive), travel_type_(0), adjacencylist_(nullptr),
+TimeDepForward::TimeDepForward(const label_limits_t& label_limits)
+    : PathAlgorithm(label_limits), mode_(TravelMode::kDrive), travel_type_(0), adjacencylist_(nullptr),
       max_label_count_(std::numeric_limits<uint32_t>::max()) {
   mode_ = TravelMode::kDrive;
   travel_type_ = 0;
@@ -35,9 +36,10 @@ TimeDepForward::~TimeDepForward() {
 void TimeDepForward::Clear() {
   // Clear the edge labels and destination list. Reset the adjacency list
   // and clear edge status.
-  edgelabels_.clear();
+  VALHALLA_TRACE3(path_labels, name(), edgelabels_.size(), 0);
+  label_limits_.trim(edgelabels_);
   destinations_percent_along_.clear();
-  adjacencylist_.reset();
+  label_limits_.trim(adjacencylist_);
   edgestatus_.clear();
 
   // Set the ferry flag to false
@@ -223,12 +225,17 @@ inline bool TimeDepForward::ExpandForwardInner(GraphReader& graphreader,
   float dist = 0.0f;
   float sortcost = newcost.cost;
   if (dest_edge == destinations_percent_along_.end()) {
+    // The frontier is moving into another tile, start loading the ones around it
+    if (meta.edge->leaves_tile()) {
+      graphreader.PrefetchNeighbors(meta.edge->endnode());
+    }
     graph_tile_ptr t2 =
         meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
     if (t2 == nullptr) {
       return false;
     }
-    sortcost += astarheuristic_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+    sortcost +=
+        astarheuristic_.Get(meta.edge->endnode(), t2->get_node_ll(meta.edge->endnode()), dist);
   }
 
   // Add to the adjacency list and edge labels.
@@ -262,6 +269,7 @@ TimeDepForward::GetBestPath(valhalla::Location& origin,
   midgard::PointLL destination_new(destination.path_edges(0).ll().lng(),
                                    destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
+  astarheuristic_.InitLandmarks(landmarks_, graphreader, destination, true);
   float mindist = astarheuristic_.GetDistance(origin_new);
 
   // Get time information for forward
@@ -291,6 +299,7 @@ TimeDepForward::GetBestPath(valhalla::Location& origin,
       (*interrupt)();
     }
     total_labels = current_labels;
+    label_limits_.check(edgelabels_, adjacencylist_, edgestatus_);
 
     // Abort if max label count is exceeded
     if (total_labels > max_label_count_) {
@@ -370,13 +379,17 @@ void TimeDepForward::Init(const midgard::PointLL& origll, const midgard::PointLL
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects.
   // TODO - reserve based on estimate based on distance and route type.
-  edgelabels_.reserve(kInitialEdgeLabelCount);
+  edgelabels_.reserve(label_limits_.reservation(kInitialEdgeLabelCount));
 
   // Construct adjacency list, clear edge status.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
-  adjacencylist_.reset(new DoubleBucketQueue<EdgeLabel>(mincost, range, bucketsize, edgelabels_));
+  if (adjacencylist_) {
+    adjacencylist_->reuse(mincost, range, bucketsize);
+  } else {
+    adjacencylist_.reset(new DoubleBucketQueue<EdgeLabel>(mincost, range, bucketsize, edgelabels_));
+  }
   edgestatus_.clear();
 
   // Get hierarchy limits from the costing. Get a copy since we increment
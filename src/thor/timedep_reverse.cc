@@ -18,7 +18,8 @@ constexpr uint64_t kInitialEdgeLabelCount = 500000;
 constexpr uint32_t kMaxIterationsWithoutConvergence = 800000;
 
 // Default constructor
-TimeDepReverse::TimeDepReverse() : TimeDepForward() {
+TimeDepReverse::TimeDepReverse(const label_limits_t& label_limits)
+    : TimeDepForward(label_limits) {
   mode_ = TravelMode::kDrive;
   travel_type_ = 0;
   adjacencylist_rev_ = nullptr;
@@ -33,8 +34,8 @@ TimeDepReverse::~TimeDepReverse() {
 
 void TimeDepReverse::Clear() {
   TimeDepForward::Clear();
-  edgelabels_rev_.clear();
-  adjacencylist_rev_.reset();
+  label_limits_.trim(edgelabels_rev_);
+  label_limits_.trim(adjacencylist_rev_);
 }
 
 // Initialize prior to finding best path
@@ -49,14 +50,18 @@ void TimeDepReverse::Init(const midgard::PointLL& origll, const midgard::PointLL
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects.
   // TODO - reserve based on estimate based on distance and route type.
-  edgelabels_rev_.reserve(kInitialEdgeLabelCount);
+  edgelabels_rev_.reserve(label_limits_.reservation(kInitialEdgeLabelCount));
 
   // Construct adjacency list, clear edge status.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
-  adjacencylist_rev_.reset(
-      new DoubleBucketQueue<BDEdgeLabel>(mincost, range, bucketsize, edgelabels_rev_));
+  if (adjacencylist_rev_) {
+    adjacencylist_rev_->reuse(mincost, range, bucketsize);
+  } else {
+    adjacencylist_rev_.reset(
+        new DoubleBucketQueue<BDEdgeLabel>(mincost, range, bucketsize, edgelabels_rev_));
+  }
   edgestatus_.clear();
 
   // Get hierarchy limits from the costing. Get a copy since we increment
@@ -188,6 +193,11 @@ inline bool TimeDepReverse::ExpandReverseInner(GraphReader& graphreader,
     return true; // This is an edge we _could_ have expanded, so return true
   }
 
+  // The frontier is moving into another tile, start loading the ones around it
+  if (meta.edge->leaves_tile()) {
+    graphreader.PrefetchNeighbors(meta.edge->endnode());
+  }
+
   // Get end node tile, opposing edge Id, and opposing directed edge.
   graph_tile_ptr t2 =
       meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
@@ -266,7 +276,8 @@ inline bool TimeDepReverse::ExpandReverseInner(GraphReader& graphreader,
     if (t2 == nullptr) {
       return false;
     }
-    sortcost += astarheuristic_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+    sortcost +=
+        astarheuristic_.Get(meta.edge->endnode(), t2->get_node_ll(meta.edge->endnode()), dist);
   }
 
   // Add edge label, add to the adjacency list and set edge status
@@ -309,6 +320,7 @@ TimeDepReverse::GetBestPath(valhalla::Location& origin,
   midgard::PointLL destination_new(destination.path_edges(0).ll().lng(),
                                    destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
+  astarheuristic_.InitLandmarks(landmarks_, graphreader, origin, false);
   float mindist = astarheuristic_.GetDistance(origin_new);
 
   // Get time information for backward search
@@ -336,6 +348,7 @@ TimeDepReverse::GetBestPath(valhalla::Location& origin,
       (*interrupt)();
     }
     total_labels = current_labels;
+    label_limits_.check(edgelabels_rev_, adjacencylist_rev_, edgestatus_);
 
     // Abort if max label count is exceeded
     if (total_labels > max_label_count_) {
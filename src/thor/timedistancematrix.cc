@@ -27,8 +27,14 @@ namespace valhalla {
 namespace thor {
 
 // Constructor with cost threshold.
-TimeDistanceMatrix::TimeDistanceMatrix()
-    : mode_(TravelMode::kDrive), settled_count_(0), current_cost_threshold_(0) {
+TimeDistanceMatrix::TimeDistanceMatrix(const label_limits_t& label_limits, ExpansionPool* pool)
+    : mode_(TravelMode::kDrive), settled_count_(0), current_cost_threshold_(0),
+      label_limits_(label_limits), pool_(pool), tree_cache_(nullptr) {
+}
+
+void TimeDistanceMatrix::SetTreeCache(ExpansionTreeCache* cache, const std::string& costing_key) {
+  tree_cache_ = cache;
+  tree_cache_key_ = costing_key;
 }
 
 float TimeDistanceMatrix::GetCostThreshold(const float max_matrix_distance) const {
@@ -61,6 +67,7 @@ void TimeDistanceMatrix::Clear() {
 
   // Clear the edge status flags
   edgestatus_.clear();
+  settled_.clear();
 }
 
 // Expand from a node in the forward direction
@@ -159,25 +166,86 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
       new DoubleBucketQueue<sif::EdgeLabel>(0.0f, current_cost_threshold_, bucketsize, edgelabels_));
   edgestatus_.clear();
 
-  // Initialize the origin and destination locations
+  // Initialize the origin, or carry on with the tree a search from it left behind, and the
+  // destination locations
   settled_count_ = 0;
-  SetOriginOneToMany(graphreader, origin);
+  std::unique_ptr<ExpansionTreeCache::tree_t> tree;
+  std::string tree_key;
+  if (tree_cache_) {
+    tree_key = ExpansionTreeCache::Key(tree_cache_key_, origin);
+    tree = tree_cache_->Take(tree_key);
+  }
+  bool pending = false;
+  if (tree) {
+    edgelabels_ = std::move(tree->labels);
+    edgestatus_.swap(tree->status);
+    settled_ = std::move(tree->settled);
+    pending = tree->pending;
+    // every label that wasnt settled is still on the adjacency list
+    std::vector<bool> settled(edgelabels_.size(), false);
+    for (const auto index : settled_) {
+      settled[index] = true;
+    }
+    for (uint32_t index = 0; index < edgelabels_.size(); ++index) {
+      if (!settled[index]) {
+        adjacencylist_->add(index);
+      }
+    }
+  } else {
+    settled_.clear();
+    SetOriginOneToMany(graphreader, origin);
+  }
   SetDestinations(graphreader, locations);
 
-  // Find shortest path
+  // Look for the destinations along the edge of a settled label, return true if the search is done
   graph_tile_ptr tile;
-  while (true) {
+  auto settle = [&](const EdgeLabel& pred, const uint32_t predindex) {
+    // Identify any destinations on this edge
+    auto destedge = dest_edges_.find(pred.edgeid());
+    if (destedge != dest_edges_.end()) {
+      // Update any destinations along this edge. Return if all destinations
+      // have been settled.
+      tile = graphreader.GetGraphTile(pred.edgeid());
+      const DirectedEdge* edge = tile->directededge(pred.edgeid());
+      if (UpdateDestinations(origin, locations, destedge->second, edge, tile, pred, predindex)) {
+        return true;
+      }
+    }
+
+    // Terminate when we are beyond the cost threshold
+    return pred.cost().cost > current_cost_threshold_;
+  };
+
+  // The labels a search from the origin settled before are settled again in the same order, only
+  // those it didnt get to yet need expanding
+  bool done = false;
+  for (size_t i = 0; i < settled_.size() && !done; ++i) {
+    done = settle(edgelabels_[settled_[i]], settled_[i]);
+  }
+  if (!done && pending) {
+    EdgeLabel pred = edgelabels_[settled_.back()];
+    ExpandForward(graphreader, pred.endnode(), pred, settled_.back(), false);
+  }
+
+  // Find shortest path
+  while (!done) {
+    label_limits_.check(edgelabels_, adjacencylist_, edgestatus_);
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
     if (predindex == kInvalidLabel) {
       // Can not expand any further...
-      return FormTimeDistanceMatrix();
+      pending = false;
+      break;
     }
 
     // Remove label from adjacency list, mark it as permanently labeled.
     // Copy the EdgeLabel for use in costing
     EdgeLabel pred = edgelabels_[predindex];
+    if (tree_cache_) {
+      settled_.push_back(predindex);
+    }
 
     // Mark the edge as permanently labeled. Do not do this for an origin
     // edge. Otherwise loops/around the block cases will not work
@@ -185,27 +253,30 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
       edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
     }
 
-    // Identify any destinations on this edge
-    auto destedge = dest_edges_.find(pred.edgeid());
-    if (destedge != dest_edges_.end()) {
-      // Update any destinations along this edge. Return if all destinations
-      // have been settled.
-      tile = graphreader.GetGraphTile(pred.edgeid());
-      const DirectedEdge* edge = tile->directededge(pred.edgeid());
-      if (UpdateDestinations(origin, locations, destedge->second, edge, tile, pred, predindex)) {
-        return FormTimeDistanceMatrix();
-      }
-    }
-
-    // Terminate when we are beyond the cost threshold
-    if (pred.cost().cost > current_cost_threshold_) {
-      return FormTimeDistanceMatrix();
+    // Return when all destinations have been settled or the search went too far
+    if ((done = settle(pred, predindex))) {
+      pending = true;
+      break;
     }
 
     // Expand forward from the end node of the predecessor edge.
     ExpandForward(graphreader, pred.endnode(), pred, predindex, false);
   }
-  return {}; // Should never get here
+
+  // Leave the tree for the next search from the origin
+  if (tree_cache_) {
+    if (!tree) {
+      tree.reset(new ExpansionTreeCache::tree_t());
+    }
+    tree->labels = std::move(edgelabels_);
+    edgestatus_.swap(tree->status);
+    tree->settled = std::move(settled_);
+    tree->pending = pending;
+    tree_cache_->Put(tree_key, std::move(tree));
+    edgelabels_.clear();
+    settled_.clear();
+  }
+  return FormTimeDistanceMatrix();
 }
 
 // Expand from the node along the reverse search path.
@@ -327,6 +398,8 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
   // Find shortest path
   graph_tile_ptr tile;
   while (true) {
+    label_limits_.check(edgelabels_, adjacencylist_, edgestatus_);
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -386,9 +459,45 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
     const sif::mode_costing_t& mode_costing,
     const sif::TravelMode mode,
     const float max_matrix_distance) {
+  // Every row is its own search so they can run on the pool, each thread with its own matrix and
+  // therefore its own labels, edge status and adjacency list. This one is used by the calling thread
+  bool one_to_many = source_location_list.size() <= target_location_list.size();
+  size_t row_count = one_to_many ? source_location_list.size() : target_location_list.size();
+  if (pool_ && row_count > 1) {
+    std::vector<std::unique_ptr<TimeDistanceMatrix>> matrices(pool_->size());
+    std::vector<std::vector<TimeDistance>> rows(row_count);
+    pool_->Run(
+        row_count,
+        [&](size_t row, size_t thread, GraphReader& reader) {
+          auto* matrix = this;
+          if (thread > 0) {
+            if (!matrices[thread]) {
+              matrices[thread].reset(new TimeDistanceMatrix(label_limits_));
+              matrices[thread]->SetTreeCache(tree_cache_, tree_cache_key_);
+            }
+            matrix = matrices[thread].get();
+          }
+          rows[row] = one_to_many
+                          ? matrix->OneToMany(source_location_list.Get(row), target_location_list,
+                                              reader, mode_costing, mode, max_matrix_distance)
+                          : matrix->ManyToOne(target_location_list.Get(row), source_location_list,
+                                              reader, mode_costing, mode, max_matrix_distance);
+          matrix->Clear();
+        },
+        graphreader);
+
+    // Concatenate the rows in order
+    std::vector<TimeDistance> many_to_many;
+    many_to_many.reserve(source_location_list.size() * target_location_list.size());
+    for (const auto& row : rows) {
+      many_to_many.insert(many_to_many.end(), row.begin(), row.end());
+    }
+    return many_to_many;
+  }
+
   // Run a series of one to many calls and concatenate the results.
   std::vector<TimeDistance> many_to_many;
-  if (source_location_list.size() <= target_location_list.size()) {
+  if (one_to_many) {
     for (const auto& origin : source_location_list) {
       std::vector<TimeDistance> td = OneToMany(origin, target_location_list, graphreader,
                                                mode_costing, mode, max_matrix_distance);
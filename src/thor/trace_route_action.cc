@@ -188,7 +188,20 @@ thor_worker_t::map_match(Api& request) {
   // we don't allow multi path for trace route at the moment, discontinuities force multi route
   int topk =
       request.options().action() == Options::trace_attributes ? request.options().best_paths() : 1;
+  const auto* route_cache = matcher_factory.route_cache();
+  const uint64_t route_hits = route_cache ? route_cache->hits() : 0;
+  const uint64_t route_misses = route_cache ? route_cache->misses() : 0;
   auto topk_match_results = matcher->OfflineMatch(trace, topk);
+  if (route_cache) {
+    auto* hit_stat = request.mutable_info()->mutable_statistics()->Add();
+    hit_stat->set_name("thor_worker_t::transition_route_cache_hits");
+    hit_stat->set_value(route_cache->hits() - route_hits);
+    hit_stat->set_type(Statistic::count);
+    auto* miss_stat = request.mutable_info()->mutable_statistics()->Add();
+    miss_stat->set_name("thor_worker_t::transition_route_cache_misses");
+    miss_stat->set_value(route_cache->misses() - route_misses);
+    miss_stat->set_type(Statistic::count);
+  }
 
   // Process each score/match result
   std::vector<std::tuple<float, float, std::vector<meili::MatchResult>>> map_match_results;
@@ -0,0 +1,263 @@
+#include "thor/transit_timetable.h"
+
+#include <algorithm>
+#include <map>
+
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+using valhalla::thor::TransitTimetable;
+
+// A departure along one transit line edge
+struct segment_t {
+  uint32_t departure;
+  uint32_t arrival;
+  GraphId line;
+  GraphId from;
+  GraphId to;
+};
+
+struct line_t {
+  GraphId edge;
+  GraphId from;
+  GraphId to;
+};
+
+// Whether a trip never gets anywhere before another trip of the same stops which left before it
+bool follows(const TransitTimetable::trip_stops_t& later,
+             const TransitTimetable::trip_stops_t& earlier) {
+  for (size_t i = 0; i < later.times.size(); ++i) {
+    if (later.times[i].arrival < earlier.times[i].arrival ||
+        later.times[i].departure < earlier.times[i].departure) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Chains the segments of a trip by departure, a trip that doesnt continue where it stopped last is
+// split as there is no way to ride it across the gap
+void chain(const TransitTimetable::trip_t& trip,
+           std::vector<segment_t>& segments,
+           std::vector<TransitTimetable::trip_stops_t>& trips) {
+  std::sort(segments.begin(), segments.end(),
+            [](const segment_t& a, const segment_t& b) { return a.departure < b.departure; });
+  TransitTimetable::trip_stops_t current{trip, {}, {}, {}};
+  for (const auto& segment : segments) {
+    if (!current.platforms.empty() &&
+        (current.platforms.back() != segment.from ||
+         current.times.back().arrival > segment.departure)) {
+      trips.push_back(std::move(current));
+      current = {trip, {}, {}, {}};
+    }
+    if (current.platforms.empty()) {
+      current.platforms.push_back(segment.from);
+      current.times.push_back({segment.departure, segment.departure});
+    }
+    current.times.back().departure = segment.departure;
+    current.lines.push_back(segment.line);
+    current.platforms.push_back(segment.to);
+    current.times.push_back({segment.arrival, segment.arrival});
+  }
+  if (!current.lines.empty()) {
+    trips.push_back(std::move(current));
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+constexpr uint32_t TransitTimetable::kInvalid;
+
+TransitTimetable::TransitTimetable(const std::vector<trip_stops_t>& trips,
+                                   const std::vector<footpath_t>& footpaths) {
+  Build(trips, footpaths);
+}
+
+TransitTimetable::TransitTimetable(GraphReader& reader) {
+  const auto level = TileHierarchy::GetTransitLevel().level;
+
+  // the departures of every trip by the trip and, for frequency based ones, which departure it is
+  std::unordered_map<uint64_t, size_t> trip_index;
+  std::vector<std::pair<trip_t, std::vector<segment_t>>> segments;
+  std::vector<footpath_t> footpaths;
+  for (const auto& tile_id : reader.GetTileSet(level)) {
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+
+    // the transit line edges by their line and the walks to the other platforms of the station
+    std::unordered_map<uint32_t, line_t> lines;
+    for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+      const auto* node = tile->node(n);
+      if (node->type() != NodeType::kMultiUseTransitPlatform) {
+        continue;
+      }
+      const GraphId platform(tile_id.tileid(), level, n);
+      for (uint32_t e = 0; e < node->edge_count(); ++e) {
+        const GraphId edge_id(tile_id.tileid(), level, node->edge_index() + e);
+        const auto* edge = tile->directededge(edge_id);
+        if (edge->IsTransitLine()) {
+          lines.emplace(edge->lineid(), line_t{edge_id, platform, edge->endnode()});
+        } else if (edge->use() == Use::kPlatformConnection) {
+          auto station_tile = reader.GetGraphTile(edge->endnode());
+          if (!station_tile) {
+            continue;
+          }
+          const auto* station = station_tile->node(edge->endnode());
+          for (uint32_t s = 0; s < station->edge_count(); ++s) {
+            const GraphId out_id(edge->endnode().tileid(), edge->endnode().level(),
+                                 station->edge_index() + s);
+            const auto* out = station_tile->directededge(out_id);
+            if (out->use() == Use::kPlatformConnection && out->endnode() != platform) {
+              footpaths.push_back({platform, out->endnode(), {edge_id, out_id}});
+            }
+          }
+        }
+      }
+    }
+
+    for (const auto& departure : tile->GetDepartures()) {
+      auto line = lines.find(departure.lineid());
+      const auto* schedule = tile->GetTransitSchedule(departure.schedule_index());
+      if (line == lines.end() || !schedule) {
+        continue;
+      }
+      uint32_t count = 1;
+      if (departure.type() == kFrequencySchedule) {
+        count = 0;
+        if (departure.frequency() > 0 && departure.end_time() > departure.departure_time()) {
+          const auto span = departure.end_time() - departure.departure_time();
+          count = (span + departure.frequency() - 1) / departure.frequency();
+        }
+      }
+      for (uint32_t i = 0; i < count; ++i) {
+        auto time = departure.departure_time() + i * departure.frequency();
+        auto inserted = trip_index.emplace((static_cast<uint64_t>(departure.tripid()) << 20) | i,
+                                           segments.size());
+        if (inserted.second) {
+          segments.emplace_back(trip_t{departure.tripid(), departure.blockid(), *schedule,
+                                       tile->header()->date_created(),
+                                       departure.wheelchair_accessible(),
+                                       departure.bicycle_accessible()},
+                                std::vector<segment_t>{});
+        }
+        segments[inserted.first->second].second.push_back({time, time + departure.elapsed_time(),
+                                                           line->second.edge, line->second.from,
+                                                           line->second.to});
+      }
+    }
+  }
+
+  std::vector<trip_stops_t> trips;
+  trips.reserve(segments.size());
+  for (auto& trip : segments) {
+    chain(trip.first, trip.second, trips);
+  }
+  Build(trips, footpaths);
+  LOG_INFO("Transit timetable has " + std::to_string(stops_.size()) + " stops, " +
+           std::to_string(routes_.size()) + " routes and " + std::to_string(trips_.size()) +
+           " trips");
+}
+
+void TransitTimetable::Build(const std::vector<trip_stops_t>& trips,
+                             const std::vector<footpath_t>& footpaths) {
+  // trips go along the same route when they take the same lines, the map keeps the order stable
+  std::map<std::vector<GraphId>, std::vector<const trip_stops_t*>> patterns;
+  for (const auto& trip : trips) {
+    if (!trip.lines.empty()) {
+      patterns[trip.lines].push_back(&trip);
+    }
+  }
+
+  auto stop_of = [this](const GraphId& platform) {
+    auto inserted = stop_index_.emplace(platform, stops_.size());
+    if (inserted.second) {
+      stops_.push_back(platform);
+    }
+    return inserted.first->second;
+  };
+
+  for (auto& pattern : patterns) {
+    auto& pattern_trips = pattern.second;
+    std::sort(pattern_trips.begin(), pattern_trips.end(),
+              [](const trip_stops_t* a, const trip_stops_t* b) {
+                return a->times.front().departure < b->times.front().departure ||
+                       (a->times.front().departure == b->times.front().departure &&
+                        a->times.back().arrival < b->times.back().arrival);
+              });
+
+    // the trips which overtake another go on a route of their own
+    std::vector<std::vector<const trip_stops_t*>> variants;
+    for (const auto* trip : pattern_trips) {
+      auto variant = std::find_if(variants.begin(), variants.end(),
+                                  [trip](const std::vector<const trip_stops_t*>& v) {
+                                    return follows(*trip, *v.back());
+                                  });
+      if (variant == variants.end()) {
+        variants.emplace_back();
+        variant = variants.end() - 1;
+      }
+      variant->push_back(trip);
+    }
+
+    const auto& stops = pattern_trips.front()->platforms;
+    for (const auto& variant : variants) {
+      routes_.push_back({static_cast<uint32_t>(route_stops_.size()),
+                         static_cast<uint32_t>(stops.size()), static_cast<uint32_t>(trips_.size()),
+                         static_cast<uint32_t>(variant.size()),
+                         static_cast<uint32_t>(stop_times_.size())});
+      for (size_t i = 0; i < stops.size(); ++i) {
+        route_stops_.push_back(stop_of(stops[i]));
+        route_lines_.push_back(i < pattern.first.size() ? pattern.first[i] : GraphId{});
+      }
+      for (const auto* trip : variant) {
+        trips_.push_back(trip->trip);
+        stop_times_.insert(stop_times_.end(), trip->times.begin(), trip->times.end());
+      }
+    }
+  }
+
+  // which routes go through each stop and where along them
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> by_stop(stops_.size());
+  for (uint32_t r = 0; r < routes_.size(); ++r) {
+    for (uint32_t i = 0; i < routes_[r].stop_count; ++i) {
+      by_stop[route_stops_[routes_[r].first_stop + i]].emplace_back(r, i);
+    }
+  }
+  stop_route_offsets_.reserve(stops_.size() + 1);
+  for (const auto& routes : by_stop) {
+    stop_route_offsets_.push_back(stop_routes_.size());
+    stop_routes_.insert(stop_routes_.end(), routes.begin(), routes.end());
+  }
+  stop_route_offsets_.push_back(stop_routes_.size());
+
+  std::vector<std::vector<const footpath_t*>> walks(stops_.size());
+  for (const auto& footpath : footpaths) {
+    auto from = stop(footpath.from);
+    if (from != kInvalid && stop(footpath.to) != kInvalid) {
+      walks[from].push_back(&footpath);
+    }
+  }
+  transfer_offsets_.reserve(stops_.size() + 1);
+  for (const auto& from : walks) {
+    transfer_offsets_.push_back(transfers_.size());
+    for (const auto* footpath : from) {
+      transfers_.push_back({stop(footpath->to), static_cast<uint32_t>(transfer_edges_.size()),
+                            static_cast<uint32_t>(footpath->edges.size())});
+      transfer_edges_.insert(transfer_edges_.end(), footpath->edges.begin(),
+                             footpath->edges.end());
+    }
+  }
+  transfer_offsets_.push_back(transfers_.size());
+}
+
+} // namespace thor
+} // namespace valhalla
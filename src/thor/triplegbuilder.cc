@@ -33,6 +33,37 @@ using namespace valhalla::thor;
 
 namespace {
 
+/**
+ * The groups of attributes which need data from the tiles that nothing else of the leg reads, so
+ * that the data is only read when something in the group is asked for. They are worked out once
+ * per leg instead of testing the attributes of whole categories at every edge:
+ *   signs             edge.sign.*                -> the signs of the edges
+ *   junction_names    edge.sign.junction_names   -> the signs of the nodes the edges start at
+ *   turn_lanes        edge.turn_lanes            -> the turn lanes of the edges
+ *   intersecting      node.intersecting_edge.*   -> the other edges at each node, the nodes those
+ *                                                   transition to and the opposing edge of each
+ *                                                   edge of the path, which may be in another tile
+ *   shape_attributes  shape_attributes.*         -> the time, length and speed along the shape
+ *   admins            node.admin_index           -> the admins of the nodes
+ */
+struct attribute_groups_t {
+  explicit attribute_groups_t(const AttributesController& controller)
+      : signs(controller.category_attribute_enabled(kEdgeSignCategory)),
+        junction_names(controller.attributes.at(kEdgeSignJunctionName)),
+        turn_lanes(controller.attributes.at(kEdgeTurnLanes)),
+        intersecting(controller.category_attribute_enabled(kNodeIntersectingEdgeCategory)),
+        shape_attributes(controller.category_attribute_enabled(kShapeAttributesCategory)),
+        admins(controller.attributes.at(kNodeAdminIndex)) {
+  }
+
+  bool signs;
+  bool junction_names;
+  bool turn_lanes;
+  bool intersecting;
+  bool shape_attributes;
+  bool admins;
+};
+
 uint32_t
 GetAdminIndex(const AdminInfo& admin_info,
               std::unordered_map<AdminInfo, uint32_t, AdminInfo::AdminInfoHasher>& admin_info_map,
@@ -130,6 +161,8 @@ void UpdateIncident(const std::shared_ptr<const valhalla::IncidentsTile>& incide
  * and where incidents occur along the edge. Also sets the various per shape point attributes
  * such as time, distance, speed. Also updates the incidents list on the edge with their shape indices
  * @param controller
+ * @param groups
+ * @param edgeinfo
  * @param tile
  * @param edge
  * @param shape
@@ -142,6 +175,8 @@ void UpdateIncident(const std::shared_ptr<const valhalla::IncidentsTile>& incide
  * @param incidents
  */
 void SetShapeAttributes(const AttributesController& controller,
+                        const attribute_groups_t& groups,
+                        const EdgeInfo& edgeinfo,
                         const graph_tile_ptr& tile,
                         const DirectedEdge* edge,
                         std::vector<PointLL>& shape,
@@ -155,14 +190,12 @@ void SetShapeAttributes(const AttributesController& controller,
   // TODO: if this is a transit edge then the costing will throw
 
   // bail if nothing to do
-  if (!cut_for_traffic && incidents.start_index == incidents.end_index &&
-      !controller.category_attribute_enabled(kShapeAttributesCategory)) {
+  if (!cut_for_traffic && incidents.start_index == incidents.end_index && !groups.shape_attributes) {
     return;
   }
 
   // initialize shape_attributes once
-  if (!leg.has_shape_attributes() &&
-      controller.category_attribute_enabled(kShapeAttributesCategory)) {
+  if (!leg.has_shape_attributes() && groups.shape_attributes) {
     leg.mutable_shape_attributes();
   }
 
@@ -182,7 +215,7 @@ void SetShapeAttributes(const AttributesController& controller,
     // problems with those records changing between when we used them to make the path and when we
     // try to grab them again here, we instead rely on the total time from PathInfo and just do the
     // cutting for now
-    const auto& traffic_speed = tile->trafficspeed(edge);
+    const auto traffic_speed = tile->load_trafficspeed(edge);
     if (traffic_speed.breakpoint1 > 0) {
       cuts.emplace_back(cut_t{traffic_speed.breakpoint1 / 255.0, speed,
                               static_cast<std::uint8_t>(traffic_speed.congestion1)});
@@ -242,7 +275,6 @@ void SetShapeAttributes(const AttributesController& controller,
   }
 
   // Find the first cut to the right of where we start on this edge
-  auto edgeinfo = tile->edgeinfo(edge->edgeinfo_offset());
   double distance_total_pct = src_pct;
   auto cut_itr = std::find_if(cuts.cbegin(), cuts.cend(),
                               [distance_total_pct](const decltype(cuts)::value_type& s) {
@@ -416,6 +448,7 @@ void SetHeadings(TripLeg_Edge* trip_edge,
 /**
  * Add trip edge. (TODO more comments)
  * @param  controller         Controller to determine which attributes to set.
+ * @param  groups             The groups of those attributes which read extra tile data.
  * @param  edge               Identifier of an edge within the tiled, hierarchical graph.
  * @param  trip_id            Trip Id (0 if not a transit edge).
  * @param  block_id           Transit block Id (0 if not a transit edge)
@@ -424,6 +457,7 @@ void SetHeadings(TripLeg_Edge* trip_edge,
  * @param  drive_right        Right side driving for this edge.
  * @param  trip_node          Trip node to add the edge information to.
  * @param  graphtile          Graph tile for accessing data.
+ * @param  edgeinfo           Edge info of the directed edge.
  * @param  second_of_week     The time, from the beginning of the week in seconds at which
  *                            the path entered this edge (always monday at noon on timeless route)
  * @param  start_node_idx     The start node index
@@ -432,6 +466,7 @@ void SetHeadings(TripLeg_Edge* trip_edge,
  *
  */
 TripLeg_Edge* AddTripEdge(const AttributesController& controller,
+                          const attribute_groups_t& groups,
                           const GraphId& edge,
                           const uint32_t trip_id,
                           const uint32_t block_id,
@@ -442,6 +477,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
                           const bool drive_on_right,
                           TripLeg_Node* trip_node,
                           const graph_tile_ptr& graphtile,
+                          const EdgeInfo& edgeinfo,
                           const uint32_t second_of_week,
                           const uint32_t start_node_idx,
                           const bool has_junction_name,
@@ -453,18 +489,14 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
 
   TripLeg_Edge* trip_edge = trip_node->mutable_edge();
 
-  // Get the edgeinfo
-  auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
-
   // Add names to edge if requested
   if (controller.attributes.at(kEdgeNames)) {
-    auto names_and_types = edgeinfo.GetNamesAndTypes();
-    trip_edge->mutable_name()->Reserve(names_and_types.size());
-    for (const auto& name_and_type : names_and_types) {
+    trip_edge->mutable_name()->Reserve(edgeinfo.name_count());
+    edgeinfo.VisitNames([trip_edge](boost::string_view name, bool is_route_number) {
       auto* trip_edge_name = trip_edge->mutable_name()->Add();
-      trip_edge_name->set_value(name_and_type.first);
-      trip_edge_name->set_is_route_number(name_and_type.second);
-    }
+      trip_edge_name->set_value(name.data(), name.size());
+      trip_edge_name->set_is_route_number(is_route_number);
+    });
   }
 
   // Add tagged names to the edge if requested
@@ -483,7 +515,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
 #endif
 
   // Set the signs (if the directed edge has sign information) and if requested
-  if (directededge->sign()) {
+  if (directededge->sign() && groups.signs) {
     // Add the edge signs
     std::vector<SignInfo> edge_signs = graphtile->GetSigns(idx);
     if (!edge_signs.empty()) {
@@ -565,7 +597,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Process the named junctions at nodes
-  if (has_junction_name && start_tile) {
+  if (has_junction_name && start_tile && groups.junction_names) {
     // Add the node signs
     std::vector<SignInfo> node_signs = start_tile->GetSigns(start_node_idx, true);
     if (!node_signs.empty()) {
@@ -585,8 +617,8 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   }
 
-  // If turn lanes exist
-  if (directededge->turnlanes()) {
+  // If turn lanes exist and are requested
+  if (directededge->turnlanes() && groups.turn_lanes) {
     auto turnlanes = graphtile->turnlanes(idx);
     trip_edge->mutable_turn_lanes()->Reserve(turnlanes.size());
     for (auto tl : turnlanes) {
@@ -655,8 +687,8 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   if (directededge->access_restriction() && restrictions_idx >= 0) {
-    const std::vector<baldr::AccessRestriction>& restrictions =
-        graphtile->GetAccessRestrictions(edge.id(), costing->access_mode());
+    const auto restrictions =
+        graphtile->GetAccessRestrictionRange(edge.id(), costing->access_mode());
     trip_edge->mutable_restriction()->set_type(
         static_cast<uint32_t>(restrictions[restrictions_idx].type()));
   }
@@ -790,12 +822,19 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   }
 
+  // Set the elevation profile if requested and the tile has one for the edge
+  if (controller.attributes.at(kEdgeElevation)) {
+    for (auto height : graphtile->GetElevationProfile(directededge)) {
+      trip_edge->add_elevation(height);
+    }
+  }
+
   if (controller.attributes.at(kEdgeLaneCount)) {
     trip_edge->set_lane_count(directededge->lanecount());
   }
 
   if (directededge->laneconnectivity() && controller.attributes.at(kEdgeLaneConnectivity)) {
-    auto laneconnectivity = graphtile->GetLaneConnectivity(idx);
+    auto laneconnectivity = graphtile->GetLaneConnectivityRange(idx);
     trip_edge->mutable_lane_connectivity()->Reserve(laneconnectivity.size());
     for (const auto& l : laneconnectivity) {
       TripLeg_LaneConnectivity* path_lane = trip_edge->add_lane_connectivity();
@@ -1133,6 +1172,9 @@ void TripLegBuilder::Build(
     tp_dest->set_side_of_street(GetTripLegSideOfStreet(end_sos));
   }
 
+  // Which of the data the attributes need is worth reading
+  const attribute_groups_t groups(controller);
+
   // Structures to process admins
   std::unordered_map<AdminInfo, uint32_t, AdminInfo::AdminInfoHasher> admin_info_map;
   std::vector<AdminInfo> admin_info_list;
@@ -1204,7 +1246,7 @@ void TripLegBuilder::Build(
     }
 
     // Assign the admin index
-    if (controller.attributes.at(kNodeAdminIndex)) {
+    if (groups.admins) {
       trip_node->set_admin_index(
           GetAdminIndex(start_tile->admininfo(node->admin_index()), admin_info_map, admin_info_list));
     }
@@ -1226,12 +1268,13 @@ void TripLegBuilder::Build(
     multimodal_builder.Build(trip_node, edge_itr->trip_id, node, startnode, directededge, edge,
                              start_tile, graphtile, mode_costing, controller, graphreader);
 
-    // Add edge to the trip node and set its attributes
+    // Add edge to the trip node and set its attributes, the edge info is needed for the shape anyway
+    auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
     TripLeg_Edge* trip_edge =
-        AddTripEdge(controller, edge, edge_itr->trip_id, multimodal_builder.block_id, mode,
+        AddTripEdge(controller, groups, edge, edge_itr->trip_id, multimodal_builder.block_id, mode,
                     travel_type, costing, directededge, node->drive_on_right(), trip_node, graphtile,
-                    time_info.second_of_week, startnode.id(), node->named_intersection(), start_tile,
-                    edge_itr->restriction_index);
+                    edgeinfo, time_info.second_of_week, startnode.id(), node->named_intersection(),
+                    start_tile, edge_itr->restriction_index);
 
     // some information regarding shape/length trimming
     float trim_start_pct = is_first_edge ? start_pct : 0;
@@ -1239,7 +1282,6 @@ void TripLegBuilder::Build(
 
     // Process the shape for edges where a route discontinuity occurs
     uint32_t begin_index = (is_first_edge) ? 0 : trip_shape.size() - 1;
-    auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
     if (edge_trimming && !edge_trimming->empty() && edge_trimming->count(edge_index) > 0) {
       // Get edge shape and reverse it if directed edge is not forward.
       auto edge_shape = edgeinfo.shape();
@@ -1315,10 +1357,21 @@ void TripLegBuilder::Build(
       trip_shape.insert(trip_shape.end(), edge_shape.begin() + !is_first_edge, edge_shape.end());
     } // Just get the shape in there in the right direction no clipping needed
     else {
+      // Decode straight onto the end of the trip shape, the first point is the same as the last
+      // point of the previous edge
+      const auto edge_begin = trip_shape.size();
       if (directededge->forward()) {
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().begin() + 1, edgeinfo.shape().end());
+        bool first = true;
+        edgeinfo.VisitShape([&trip_shape, &first](const PointLL& point) {
+          if (!first) {
+            trip_shape.push_back(point);
+          }
+          first = false;
+        });
       } else {
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().rbegin() + 1, edgeinfo.shape().rend());
+        edgeinfo.VisitShape([&trip_shape](const PointLL& point) { trip_shape.push_back(point); });
+        trip_shape.pop_back();
+        std::reverse(trip_shape.begin() + edge_begin, trip_shape.end());
       }
     }
 
@@ -1344,8 +1397,8 @@ void TripLegBuilder::Build(
                          ? graphreader.GetIncidents(edge_itr->edgeid, graphtile)
                          : valhalla::baldr::IncidentResult{};
 
-    SetShapeAttributes(controller, graphtile, directededge, trip_shape, begin_index, trip_path,
-                       trim_start_pct, trim_end_pct, edge_seconds,
+    SetShapeAttributes(controller, groups, edgeinfo, graphtile, directededge, trip_shape,
+                       begin_index, trip_path, trim_start_pct, trim_end_pct, edge_seconds,
                        costing->flow_mask() & kCurrentFlowMask, incidents);
 
     // Set begin shape index if requested
@@ -1363,7 +1416,7 @@ void TripLegBuilder::Build(
     SetHeadings(trip_edge, controller, directededge, trip_shape, begin_index);
 
     // Add the intersecting edges at the node
-    if (startnode.Is_Valid()) {
+    if (groups.intersecting && startnode.Is_Valid()) {
       AddIntersectingEdges(controller, start_tile, node, directededge, prev_de, prior_opp_local_index,
                            graphreader, trip_node);
     }
@@ -1373,6 +1426,11 @@ void TripLegBuilder::Build(
     // Set the endnode of this directed edge as the startnode of the next edge.
     startnode = directededge->endnode();
 
+    // Only the intersecting edges need the previous edge, reading it may need another tile
+    if (!groups.intersecting) {
+      continue;
+    }
+
     // Save the opposing edge as the previous DirectedEdge (for name consistency)
     if (!directededge->IsTransitLine()) {
       graph_tile_ptr t2 =
@@ -1390,7 +1448,7 @@ void TripLegBuilder::Build(
 
   // Add the last node
   auto* node = trip_path.add_node();
-  if (controller.attributes.at(kNodeAdminIndex)) {
+  if (groups.admins) {
     auto last_tile = graphreader.GetGraphTile(startnode);
     node->set_admin_index(
         GetAdminIndex(last_tile->admininfo(last_tile->node(startnode)->admin_index()), admin_info_map,
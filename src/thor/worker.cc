@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <sstream>
@@ -13,6 +14,8 @@
 #include "thor/worker.h"
 #include "tyr/actor.h"
 
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 using namespace valhalla;
@@ -31,6 +34,9 @@ namespace {
 // route starts to become suspect (due to user breaks and other factors).
 constexpr float kDefaultMaxTimeDependentDistance = 500000.0f; // 500 km
 
+// Isochrones expected to reach further than this are expanded on the matrix threads
+constexpr float kDefaultParallelIsochroneDistance = 100000.0f; // 100 km
+
 // Maximum edge score - base this on costing type.
 // Large values can cause very bad performance. Setting this back
 // to 2 hours for bike and pedestrian and 12 hours for driving routes.
@@ -56,12 +62,28 @@ namespace thor {
 
 thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
-    : mode(valhalla::sif::TravelMode::kPedestrian), matcher_factory(config, graph_reader),
-      reader(graph_reader), controller{} {
+    : mode(valhalla::sif::TravelMode::kPedestrian),
+      label_limits(config.get_child("thor", boost::property_tree::ptree())),
+      bidir_astar(label_limits), contraction_search(bidir_astar), bss_astar(label_limits),
+      multi_modal_astar(label_limits), raptor(multi_modal_astar, label_limits),
+      timedep_forward(label_limits), timedep_reverse(label_limits), isochrone_gen(label_limits),
+      isochrone_reverse_gen(label_limits), parallel_isochrone_distance(0),
+      isochrone_cache_generation(0), matrix_tree_cache_generation(0),
+      matcher_factory(config, graph_reader),
+      mjolnir_config(config.get_child("mjolnir")), reader(graph_reader), controller{} {
   // If we weren't provided with a graph reader make our own
   if (!reader)
     reader = matcher_factory.graphreader();
 
+  // The parallel bidirectional search needs a second graph reader for its helper thread
+  if (config.get<bool>("thor.parallel_bidirectional_astar", false)) {
+    bidir_astar.EnableParallelExpansion(
+        std::make_shared<baldr::GraphReader>(config.get_child("mjolnir")));
+  }
+
+  // Map what was built next to the tiles
+  load_tile_data();
+
   // Select the matrix algorithm based on the conf file (defaults to
   // select_optimal if not present)
   auto conf_algorithm = config.get<std::string>("thor.source_to_target_algorithm", "select_optimal");
@@ -81,12 +103,63 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     source_to_target_algorithm = TIME_DISTANCE_MATRIX;
   } else if (conf_algorithm == "costmatrix") {
     source_to_target_algorithm = COST_MATRIX;
+  } else if (conf_algorithm == "contractionmatrix") {
+    source_to_target_algorithm = CONTRACTION_MATRIX;
   } else {
     source_to_target_algorithm = SELECT_OPTIMAL;
   }
 
+  // Select the optimized_route solver and how long the local search may take
+  optimizer = config.get<std::string>("thor.optimizer", "annealing") == "local_search"
+                  ? LOCAL_SEARCH
+                  : ANNEALING;
+  optimizer_time_budget =
+      std::chrono::milliseconds(config.get<uint32_t>("thor.optimizer_time_budget", 100));
+
+  contour_threads = std::max(config.get<unsigned int>("thor.contour_threads", 1), 1u);
+
+  // Isochrones from the same locations can reuse the expansion of one reaching as far
+  auto isochrone_cache_size = config.get<size_t>("thor.isochrone_cache_size", 0);
+  if (isochrone_cache_size) {
+    isochrone_cache.reset(new IsochroneCache(isochrone_cache_size));
+    isochrone_cache_generation = reader->TrafficGeneration();
+  }
+
+  // Huge matrices can be done a block of rows at a time to keep the memory they need bounded
+  matrix_row_block_size = config.get<size_t>("thor.matrix_row_block_size", 0);
+
+  // Time distance matrix rows from origins searched before can carry on from their trees
+  auto matrix_tree_cache_size = config.get<size_t>("thor.matrix_tree_cache_size", 0);
+  if (matrix_tree_cache_size) {
+    matrix_tree_cache.reset(new ExpansionTreeCache(matrix_tree_cache_size));
+    matrix_tree_cache_generation = reader->TrafficGeneration();
+  }
+
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
+
+  // Hierarchy limits can follow the distance of each route rather than being the same for all
+  adaptive_hierarchy_limits = config.get<bool>("thor.adaptive_hierarchy_limits", false);
+
+  // Transit routes can be answered from a timetable of the transit tiles
+  use_raptor = config.get<bool>("thor.raptor", false);
+
+  // Large expansions are thinned out to this many edges so they dont take all the memory
+  expansion_max_edges = config.get<uint32_t>("thor.expansion_max_edges", 0);
+
+  // Long bike share routes can bike between the stations walked to from both ends
+  bss_astar.set_station_walk_distance(config.get<uint32_t>("thor.bss_station_walk_distance", 0));
+
+  // The calling thread helps out so the pool needs one thread less than configured
+  auto matrix_threads = config.get<uint32_t>("thor.matrix_threads", 1);
+  if (matrix_threads > 1) {
+    expansion_pool.reset(new ExpansionPool(config.get_child("mjolnir"), matrix_threads - 1));
+
+    // Isochrones reaching far enough expand on the same threads
+    parallel_isochrone_distance =
+        config.get<float>("thor.parallel_isochrone_distance", kDefaultParallelIsochroneDistance);
+    isochrone_gen.EnableParallelExpansion(expansion_pool.get(), parallel_isochrone_distance);
+  }
 }
 
 thor_worker_t::~thor_worker_t() {
@@ -111,7 +184,7 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
   // get request info
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Thor Request " + std::to_string(info.id));
-  Api request;
+  Api& request = request_arena.next();
   try {
     // crack open the original request
     bool success = request.ParseFromArray(job.front().data(), job.front().size());
@@ -123,56 +196,82 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
     const auto& options = request.options();
 
     // Set the interrupt function
-    service_worker_t::set_interrupt(&interrupt_function);
+    deadline_interrupt = with_deadline(&interrupt_function, request);
+    service_worker_t::set_interrupt(&deadline_interrupt);
 
     prime_server::worker_t::result_t result{true};
     double denominator = 0;
+    // the peak memory has to be in the statistics before they are serialized
+    label_limits.reset_peak_memory();
+    std::string response;
     // do request specific processing
     switch (options.action()) {
       case Options::sources_to_targets:
-        result = to_response(matrix(request), info, request);
+        response = matrix(request);
+        report_peak_memory(request);
+        result = to_response(response, info, request,
+                             options.format() == Options::pbf ? worker::PBF_MIME
+                                                              : worker::JSON_MIME);
         denominator = options.sources_size() + options.targets_size();
         break;
       case Options::optimized_route: {
         optimized_route(request);
+        report_peak_memory(request);
         result.messages.emplace_back(serialize_to_pbf(request));
         denominator = std::max(options.sources_size(), options.targets_size());
         break;
       }
       case Options::isochrone:
-        result = to_response(isochrones(request), info, request);
+        response = isochrones(request);
+        report_peak_memory(request);
+        result = to_response(response, info, request);
         denominator = options.sources_size() * options.targets_size();
         break;
       case Options::route: {
         route(request);
+        report_peak_memory(request);
         result.messages.emplace_back(serialize_to_pbf(request));
         denominator = options.locations_size();
         break;
       }
       case Options::trace_route: {
         trace_route(request);
+        report_peak_memory(request);
         result.messages.emplace_back(serialize_to_pbf(request));
         denominator = trace.size() / 1100;
         break;
       }
       case Options::trace_attributes:
-        result = to_response(trace_attributes(request), info, request);
+        response = trace_attributes(request);
+        report_peak_memory(request);
+        result = to_response(response, info, request,
+                             options.format() == Options::pbf ? worker::PBF_MIME
+                                                              : worker::JSON_MIME);
         denominator = trace.size() / 1100;
         break;
       case Options::expansion: {
-        result = to_response(expansion(request), info, request);
+        response = expansion(request);
+        report_peak_memory(request);
+        result = to_response(response, info, request);
         denominator = options.locations_size();
         break;
       }
+      case Options::recost:
+        response = recost(request);
+        result = to_response(response, info, request);
+        denominator = options.recost_edges_size() / 100.;
+        break;
       default:
         throw valhalla_exception_t{400}; // this should never happen
     }
     return result;
   } catch (const valhalla_exception_t& e) {
     LOG_WARN("400::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+    report_peak_memory(request);
     return jsonify_error(e, info, request);
   } catch (const std::exception& e) {
     LOG_ERROR("400::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+    report_peak_memory(request);
     return jsonify_error({499, std::string(e.what())}, info, request);
   }
 }
@@ -295,6 +394,21 @@ void thor_worker_t::parse_filter_attributes(const Api& request, bool is_strict_f
   controller = AttributesController();
   const auto& options = request.options();
 
+  // Without maneuvers nothing reads the names, signs or turn lanes of the edges nor the edges
+  // intersecting the path so dont gather them, unless they are asked for below
+  if (options.directions_type() == DirectionsType::none && !is_strict_filter) {
+    controller.attributes.at(kEdgeNames) = false;
+    controller.attributes.at(kEdgeTaggedNames) = false;
+    controller.attributes.at(kEdgeTurnLanes) = false;
+    for (auto& attribute : controller.attributes) {
+      if (attribute.first.compare(0, kEdgeSignCategory.size(), kEdgeSignCategory) == 0 ||
+          attribute.first.compare(0, kNodeIntersectingEdgeCategory.size(),
+                                  kNodeIntersectingEdgeCategory) == 0) {
+        attribute.second = false;
+      }
+    }
+  }
+
   if (options.has_filter_action()) {
     switch (options.filter_action()) {
       case (FilterAction::include): {
@@ -319,18 +433,68 @@ void thor_worker_t::parse_filter_attributes(const Api& request, bool is_strict_f
   }
 }
 
+void thor_worker_t::report_peak_memory(Api& request) const {
+  auto peak = label_limits.peak_memory();
+  if (peak == 0) {
+    return;
+  }
+  auto* stat = request.mutable_info()->mutable_statistics()->Add();
+  stat->set_name("thor_worker_t::peak_search_memory");
+  stat->set_value(peak);
+  stat->set_type(Statistic::memory);
+}
+
+void thor_worker_t::load_tile_data() {
+  tileset_generation = reader->TilesetGeneration();
+
+  // Map the contraction hierarchies built for the tiles, if any
+  contraction_search.Load(mjolnir_config);
+
+  // And the landmarks for the A* heuristics
+  landmarks.clear();
+  std::vector<std::string> landmark_costings;
+  boost::algorithm::split(landmark_costings, mjolnir_config.get<std::string>("alt_landmarks", ""),
+                          boost::algorithm::is_any_of(","));
+  for (const auto& name : landmark_costings) {
+    Costing costing;
+    if (name.empty() || !Costing_Enum_Parse(name, &costing)) {
+      continue;
+    }
+    try {
+      landmarks[costing].reset(new baldr::AltLandmarks(
+          baldr::AltLandmarks::FileName(mjolnir_config.get<std::string>("tile_dir", ""), name)));
+    } catch (const std::exception& e) {
+      landmarks.erase(costing);
+      LOG_WARN("Not using the " + name + " landmarks: " + e.what());
+    }
+  }
+}
+
 void thor_worker_t::cleanup() {
+  report_tile_cache("thor", *reader);
+  // between requests is when we switch to a newly loaded tileset
+  reader->Refresh();
+  if (reader->TilesetGeneration() != tileset_generation) {
+    load_tile_data();
+    matcher_factory.ClearCache();
+  }
   bidir_astar.Clear();
+  contraction_search.Clear();
   timedep_forward.Clear();
   timedep_reverse.Clear();
   multi_modal_astar.Clear();
+  raptor.Clear();
   bss_astar.Clear();
   trace.clear();
   isochrone_gen.Clear();
+  isochrone_reverse_gen.Clear();
   matcher_factory.ClearFullCache();
   if (reader->OverCommitted()) {
     reader->Trim();
   }
+  if (expansion_pool) {
+    expansion_pool->Trim();
+  }
 }
 
 void thor_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
@@ -1,8 +1,12 @@
 #include "tyr/actor.h"
 #include "baldr/rapidjson_utils.h"
+#include "loki/admission.h"
 #include "loki/worker.h"
+#include "metrics.h"
+#include "midgard/logging.h"
 #include "odin/worker.h"
 #include "thor/worker.h"
+#include "tyr/response_cache.h"
 #include "tyr/serializers.h"
 
 using namespace valhalla;
@@ -10,23 +14,140 @@ using namespace valhalla::loki;
 using namespace valhalla::thor;
 using namespace valhalla::odin;
 
+namespace {
+
+#ifdef HAVE_HTTP
+// tells whether the response came from the response cache
+const prime_server::headers_t::value_type X_CACHE_HIT{"X-Cache", "HIT"};
+const prime_server::headers_t::value_type X_CACHE_MISS{"X-Cache", "MISS"};
+#endif
+
+tyr::ResponseCache make_response_cache(const boost::property_tree::ptree& config) {
+  return tyr::ResponseCache(config.get<size_t>("httpd.service.response_cache.max_size", 0),
+                            std::chrono::seconds(
+                                config.get<size_t>("httpd.service.response_cache.ttl", 300)),
+                            config.get<uint32_t>("httpd.service.response_cache.date_time_bucket",
+                                                 5));
+}
+
+} // namespace
+
 namespace valhalla {
 namespace tyr {
 
 struct actor_t::pimpl_t {
   pimpl_t(const boost::property_tree::ptree& config)
       : reader(new baldr::GraphReader(config.get_child("mjolnir"))), loki_worker(config, reader),
-        thor_worker(config, reader), odin_worker(config) {
+        thor_worker(config, reader), odin_worker(config), admission(config),
+        response_cache(make_response_cache(config)),
+        response_cache_generation(reader->TrafficGeneration()) {
   }
   pimpl_t(const boost::property_tree::ptree& config, baldr::GraphReader& graph_reader)
       : reader(&graph_reader, [](baldr::GraphReader*) {}), loki_worker(config, reader),
-        thor_worker(config, reader), odin_worker(config) {
+        thor_worker(config, reader), odin_worker(config), admission(config),
+        response_cache(make_response_cache(config)),
+        response_cache_generation(reader->TrafficGeneration()) {
   }
   void set_interrupts(const std::function<void()>* interrupt_function) {
     loki_worker.set_interrupt(interrupt_function);
     thor_worker.set_interrupt(interrupt_function);
     odin_worker.set_interrupt(interrupt_function);
   }
+  std::string route_batch(Api& request) {
+    // check the request and correlate the locations of all the routes at once
+    loki_worker.route_batch(request);
+    // each route is found on a copy of the options which has just its own locations
+    auto& batch = *request.mutable_options()->mutable_batch();
+    google::protobuf::RepeatedPtrField<BatchRoute> routes;
+    routes.Swap(&batch);
+    Options route_options = request.options();
+    routes.Swap(&batch);
+    route_options.set_action(Options::route);
+    route_options.clear_id();
+    route_options.clear_jsonp();
+    // a route that can't be found gets its error in its place so the others still come back
+    std::vector<std::string> responses;
+    responses.reserve(batch.size());
+    for (auto& route : batch) {
+      Api route_request;
+      *route_request.mutable_options() = route_options;
+      route_request.mutable_options()->mutable_locations()->Swap(route.mutable_locations());
+      try {
+        if (route.has_error_code()) {
+          throw valhalla_exception_t{route.error_code()};
+        }
+        thor_worker.route(route_request);
+        odin_worker.narrate(route_request);
+        responses.emplace_back(tyr::serializeDirections(route_request));
+      } catch (const valhalla_exception_t& e) {
+        responses.emplace_back(jsonify_error(e, route_request));
+      }
+      route.mutable_locations()->Swap(route_request.mutable_options()->mutable_locations());
+    }
+    return tyr::serializeRouteBatch(request, responses);
+  }
+#ifdef HAVE_HTTP
+  ResponseCache::Response answer(Api& request) {
+    // every stage works on the same request object
+    const auto& options = request.options();
+    const auto& pbf_or_json =
+        options.format() == Options::pbf ? worker::PBF_MIME.second : worker::JSON_MIME.second;
+    switch (options.action()) {
+      case Options::route:
+        loki_worker.route(request);
+        thor_worker.route(request);
+        break;
+      case Options::optimized_route:
+        loki_worker.matrix(request);
+        thor_worker.optimized_route(request);
+        break;
+      case Options::trace_route:
+        loki_worker.trace(request);
+        thor_worker.trace_route(request);
+        break;
+      case Options::locate:
+        return {loki_worker.locate(request), worker::JSON_MIME.second, false};
+      case Options::height:
+        return {loki_worker.height(request), worker::JSON_MIME.second, false};
+      case Options::transit_available:
+        return {loki_worker.transit_available(request), worker::JSON_MIME.second, false};
+      case Options::sources_to_targets:
+        loki_worker.matrix(request);
+        return {thor_worker.matrix(request), pbf_or_json, false};
+      case Options::isochrone:
+        loki_worker.isochrones(request);
+        return {thor_worker.isochrones(request), worker::JSON_MIME.second, false};
+      case Options::trace_attributes:
+        loki_worker.trace(request);
+        return {thor_worker.trace_attributes(request), pbf_or_json, false};
+      case Options::expansion:
+        loki_worker.route(request);
+        return {thor_worker.expansion(request), worker::JSON_MIME.second, false};
+      case Options::route_batch:
+        return {route_batch(request), worker::JSON_MIME.second, false};
+      case Options::recost:
+        loki_worker.recost(request);
+        return {thor_worker.recost(request), worker::JSON_MIME.second, false};
+      default:
+        throw valhalla_exception_t{107};
+    }
+
+    // the paths need narrating
+    odin_worker.narrate(request);
+    const bool as_gpx = options.format() == Options::gpx;
+    return {tyr::serializeDirections(request),
+            as_gpx ? worker::GPX_MIME.second : pbf_or_json, as_gpx};
+  }
+#endif
+  std::string cache_key(const Api& request) {
+    // anything answered before the traffic changed may no longer be right
+    const auto traffic_generation = reader->TrafficGeneration();
+    if (traffic_generation != response_cache_generation) {
+      response_cache.Clear();
+      response_cache_generation = traffic_generation;
+    }
+    return response_cache.Key(request.options());
+  }
   void cleanup() {
     loki_worker.cleanup();
     thor_worker.cleanup();
@@ -36,6 +157,12 @@ struct actor_t::pimpl_t {
   loki::loki_worker_t loki_worker;
   thor::thor_worker_t thor_worker;
   odin_worker_t odin_worker;
+  loki::Admission admission;
+  std::function<void()> deadline_interrupt;
+  ResponseCache response_cache;
+  uint64_t response_cache_generation;
+  // the request being answered
+  request_arena_t request_arena;
 };
 
 actor_t::actor_t(const boost::property_tree::ptree& config, bool auto_cleanup)
@@ -56,7 +183,7 @@ actor_t::route(const std::string& request_str, const std::function<void()>* inte
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::route, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.route(request);
@@ -82,7 +209,7 @@ actor_t::locate(const std::string& request_str, const std::function<void()>* int
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::locate, request);
   // check the request and locate the locations in the graph
   auto json = pimpl->loki_worker.locate(request);
@@ -102,7 +229,7 @@ actor_t::matrix(const std::string& request_str, const std::function<void()>* int
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::sources_to_targets, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.matrix(request);
@@ -125,7 +252,7 @@ std::string actor_t::optimized_route(const std::string& request_str,
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::optimized_route, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.matrix(request);
@@ -151,7 +278,7 @@ actor_t::isochrone(const std::string& request_str, const std::function<void()>*
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::isochrone, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.isochrones(request);
@@ -174,7 +301,7 @@ std::string actor_t::trace_route(const std::string& request_str,
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::trace_route, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.trace(request);
@@ -201,7 +328,7 @@ std::string actor_t::trace_attributes(const std::string& request_str,
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::trace_attributes, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.trace(request);
@@ -223,7 +350,7 @@ actor_t::height(const std::string& request_str, const std::function<void()>* int
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::height, request);
   // get the height at each point
   auto json = pimpl->loki_worker.height(request);
@@ -244,7 +371,7 @@ std::string actor_t::transit_available(const std::string& request_str,
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::transit_available, request);
   // check the request and locate the locations in the graph
   auto json = pimpl->loki_worker.transit_available(request);
@@ -264,7 +391,7 @@ actor_t::expansion(const std::string& request_str, const std::function<void()>*
   // set the interrupts
   pimpl->set_interrupts(interrupt);
   // parse the request
-  Api request;
+  Api& request = pimpl->request_arena.next();
   ParseApi(request_str, Options::expansion, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.route(request);
@@ -281,5 +408,126 @@ actor_t::expansion(const std::string& request_str, const std::function<void()>*
   return json;
 }
 
+std::string actor_t::route_batch(const std::string& request_str,
+                                 const std::function<void()>* interrupt,
+                                 Api* api) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // parse the request
+  Api& request = pimpl->request_arena.next();
+  ParseApi(request_str, Options::route_batch, request);
+  // find and serialize each of the routes
+  auto json = pimpl->route_batch(request);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  // give the caller a copy
+  if (api) {
+    api->Swap(&request);
+  }
+  return json;
+}
+
+std::string
+actor_t::recost(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // parse the request
+  Api& request = pimpl->request_arena.next();
+  ParseApi(request_str, Options::recost, request);
+  // check the edges of the path
+  pimpl->loki_worker.recost(request);
+  // cost the path edge by edge
+  auto json = pimpl->thor_worker.recost(request);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  // give the caller a copy
+  if (api) {
+    api->Swap(&request);
+  }
+  return json;
+}
+
+#ifdef HAVE_HTTP
+prime_server::worker_t::result_t actor_t::work(const std::list<zmq::message_t>& job,
+                                               void* request_info,
+                                               const std::function<void()>& interrupt_function) {
+  auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
+  LOG_INFO("Got Actor Request " + std::to_string(info.id));
+  Api& request = pimpl->request_arena.next();
+  try {
+    // request parsing, this is the only time the request is deserialized
+    auto http_request =
+        prime_server::http_request_t::from_string(static_cast<const char*>(job.front().data()),
+                                                  job.front().size());
+    if (http_request.path == "/metrics") {
+      return to_response(metrics_t::get().serialize(), info, request, worker::METRICS_MIME);
+    }
+    ParseApi(http_request, request);
+    pimpl->loki_worker.check_action(request);
+
+    // the same request may have been answered moments ago
+    std::string cache_key;
+    const bool caching = pimpl->response_cache.enabled();
+    if (caching) {
+      cache_key = pimpl->cache_key(request);
+      ResponseCache::Response cached;
+      const bool hit = pimpl->response_cache.Find(cache_key, cached);
+      auto* stat = request.mutable_info()->mutable_statistics()->Add();
+      stat->set_name(hit ? "actor_t::response_cache_hits" : "actor_t::response_cache_misses");
+      stat->set_value(1);
+      stat->set_type(Statistic::count);
+      if (hit) {
+        return to_response(cached.body, info, request, {"Content-type", cached.content_type},
+                           cached.as_attachment, {X_CACHE_HIT});
+      }
+    }
+
+    // turn it away now if it can't be answered in time, otherwise stop once nobody is waiting
+    auto ticket = pimpl->admission.Admit(request);
+    pimpl->deadline_interrupt = with_deadline(&interrupt_function, request);
+    pimpl->set_interrupts(&pimpl->deadline_interrupt);
+
+    auto response = pimpl->answer(request);
+    if (!caching) {
+      return to_response(response.body, info, request, {"Content-type", response.content_type},
+                         response.as_attachment);
+    }
+    auto result = to_response(response.body, info, request, {"Content-type", response.content_type},
+                              response.as_attachment, {X_CACHE_MISS});
+    pimpl->response_cache.Insert(cache_key, std::move(response));
+    return result;
+  } catch (const valhalla_exception_t& e) {
+    LOG_WARN(std::to_string(e.http_code) + "::" + std::string(e.what()) +
+             " request_id=" + std::to_string(info.id));
+    return jsonify_error(e, info, request);
+  } catch (const std::exception& e) {
+    LOG_ERROR("500::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+    return jsonify_error({599, std::string(e.what())}, info, request);
+  }
+}
+
+void run_service(const boost::property_tree::ptree& config) {
+  // gets requests from the http server on the same proxy the loki stage would use
+  auto upstream_endpoint = config.get<std::string>("loki.service.proxy") + "_out";
+  // everything goes straight back to the server
+  auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
+  auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
+
+  // listen for requests
+  zmq::context_t context;
+  actor_t actor(config);
+  prime_server::worker_t worker(context, upstream_endpoint, "ipc:///dev/null", loopback_endpoint,
+                                interrupt_endpoint,
+                                std::bind(&actor_t::work, std::ref(actor), std::placeholders::_1,
+                                          std::placeholders::_2, std::placeholders::_3),
+                                std::bind(&actor_t::cleanup, std::ref(actor)));
+  worker.work();
+}
+#endif
+
 } // namespace tyr
 } // namespace valhalla
\ No newline at end of file
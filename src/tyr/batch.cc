@@ -0,0 +1,117 @@
+#include "tyr/batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/json.h"
+#include "worker.h"
+
+namespace {
+
+// The json of a line, which may be in the -j '{...}' form of the files in test_requests
+bool to_request(std::string& line) {
+  auto begin = line.find_first_not_of(" \t\r");
+  if (begin == std::string::npos || line[begin] == '#') {
+    return false;
+  }
+  if (line.compare(begin, 2, "-j") == 0) {
+    begin = line.find_first_not_of(" \t", begin + 2);
+  }
+  auto end = line.find_last_not_of(" \t\r");
+  if (begin == std::string::npos || end < begin) {
+    return false;
+  }
+  if (end > begin && line[begin] == '\'' && line[end] == '\'') {
+    ++begin;
+    --end;
+  }
+  line = line.substr(begin, end + 1 - begin);
+  return !line.empty() && line.front() == '{';
+}
+
+} // namespace
+
+namespace valhalla {
+namespace tyr {
+
+size_t run_batch(const boost::property_tree::ptree& config,
+                 batch_action_t action,
+                 std::istream& input,
+                 std::ostream& output,
+                 size_t concurrency) {
+  // the threads share their tiles unless the config already shares them some other way
+  auto batch_config = config;
+  auto& mjolnir = batch_config.get_child("mjolnir");
+  if (mjolnir.get<std::string>("shared_cache_path", "").empty() &&
+      !mjolnir.get<bool>("global_synchronized_cache", false)) {
+    mjolnir.put("global_synchronized_cache", true);
+  }
+
+  // the threads take the next line as they are done with their last one
+  std::mutex input_mutex, output_mutex;
+  size_t next_line = 0;
+  std::atomic<size_t> failed(0);
+  auto work = [&]() {
+    baldr::GraphReader reader(batch_config.get_child("mjolnir"));
+    actor_t actor(batch_config, reader, true);
+    std::string request;
+    while (true) {
+      size_t line;
+      {
+        std::lock_guard<std::mutex> lock(input_mutex);
+        do {
+          if (!std::getline(input, request)) {
+            return;
+          }
+          line = ++next_line;
+        } while (!to_request(request));
+      }
+
+      // answer it
+      auto result = baldr::json::map({{"line", static_cast<uint64_t>(line)}});
+      const auto start = std::chrono::steady_clock::now();
+      try {
+        auto response = (actor.*action)(request, nullptr, nullptr);
+        result->emplace("response", baldr::json::RawJSON{std::move(response)});
+      } catch (const valhalla_exception_t& e) {
+        actor.cleanup();
+        result->emplace("error_code", static_cast<uint64_t>(e.code));
+        result->emplace("error", e.message);
+      } catch (const std::exception& e) {
+        actor.cleanup();
+        result->emplace("error", std::string(e.what()));
+      }
+      const auto ms =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+              .count();
+      result->emplace("time_ms", baldr::json::fp_t{ms, 3});
+      if (result->find("error") != result->cend()) {
+        ++failed;
+      }
+
+      // and hand it out right away
+      std::lock_guard<std::mutex> lock(output_mutex);
+      output << *result << '\n';
+      output.flush();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t thread = 1; thread < std::max<size_t>(concurrency, 1); ++thread) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return failed;
+}
+
+} // namespace tyr
+} // namespace valhalla
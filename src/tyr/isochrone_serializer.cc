@@ -4,6 +4,7 @@
 #include "midgard/pointll.h"
 #include "tyr/serializers.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <sstream>
@@ -22,14 +23,33 @@ std::string serializeIsochrones(const Api& request,
                                 std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals,
                                 midgard::GriddedData<2>::contours_t& contours,
                                 bool polygons,
-                                bool show_locations) {
-  // for each contour interval
+                                bool show_locations,
+                                const std::vector<uint32_t>& location_indices,
+                                const std::vector<bool>& reversed) {
+  // for each contour interval, the colors go around again for the contours of each location and
+  // of each direction
   int i = 0;
   auto features = array({});
+  const bool network = request.options().network();
   assert(intervals.size() == contours.size());
+  assert(location_indices.empty() || location_indices.size() == intervals.size());
+  assert(reversed.empty() || reversed.size() == intervals.size());
+  const size_t direction_count =
+      reversed.empty() || reversed.front() == reversed.back() ? 1 : 2;
+  const size_t interval_count =
+      (location_indices.empty()
+           ? intervals.size()
+           : intervals.size() / std::max(request.options().locations_size(), 1)) /
+      direction_count;
   for (size_t contour_index = 0; contour_index < intervals.size(); ++contour_index) {
     const auto& interval = intervals[contour_index];
     const auto& feature_collection = contours[contour_index];
+    if (contour_index > 0 &&
+        ((!location_indices.empty() &&
+          location_indices[contour_index] != location_indices[contour_index - 1]) ||
+         (!reversed.empty() && reversed[contour_index] != reversed[contour_index - 1]))) {
+      i = 0;
+    }
 
     // color was supplied
     std::stringstream hex;
@@ -37,7 +57,7 @@ std::string serializeIsochrones(const Api& request,
       hex << "#" << std::get<3>(interval);
     } // or we computed it..
     else {
-      auto h = i * (150.f / intervals.size());
+      auto h = i * (150.f / interval_count);
       auto c = .5f;
       auto x = c * (1 - std::abs(std::fmod(h / 60.f, 2.f) - 1));
       auto m = .25f;
@@ -59,8 +79,8 @@ std::string serializeIsochrones(const Api& request,
         for (const auto& coord : contour) {
           coords->push_back(array({fp_t{coord.first, 6}, fp_t{coord.second, 6}}));
         }
-        // its either a ring
-        if (polygons) {
+        // its either a ring or one of the edges of the network
+        if (polygons || network) {
           geom->emplace_back(coords);
           // or a single line, if someone has more than one contour per feature they messed up
         } else {
@@ -68,22 +88,32 @@ std::string serializeIsochrones(const Api& request,
         }
       }
       // add a feature
+      auto properties = map({
+          {"metric", std::get<2>(interval)},
+          {"contour", static_cast<uint64_t>(std::get<1>(interval))},
+          {"color", hex.str()},            // lines
+          {"fill", hex.str()},             // geojson.io polys
+          {"fillColor", hex.str()},        // leaflet polys
+          {"opacity", fp_t{.33f, 2}},      // lines
+          {"fill-opacity", fp_t{.33f, 2}}, // geojson.io polys
+          {"fillOpacity", fp_t{.33f, 2}},  // leaflet polys
+      });
+      if (!location_indices.empty()) {
+        properties->emplace("location_index",
+                            static_cast<uint64_t>(location_indices[contour_index]));
+      }
+      if (!reversed.empty()) {
+        properties->emplace("reverse", static_cast<bool>(reversed[contour_index]));
+      }
       features->emplace_back(map({
           {"type", std::string("Feature")},
           {"geometry", map({
-                           {"type", std::string(polygons ? "Polygon" : "LineString")},
+                           {"type", std::string(network    ? "MultiLineString"
+                                                : polygons ? "Polygon"
+                                                           : "LineString")},
                            {"coordinates", geom},
                        })},
-          {"properties", map({
-                             {"metric", std::get<2>(interval)},
-                             {"contour", static_cast<uint64_t>(std::get<1>(interval))},
-                             {"color", hex.str()},            // lines
-                             {"fill", hex.str()},             // geojson.io polys
-                             {"fillColor", hex.str()},        // leaflet polys
-                             {"opacity", fp_t{.33f, 2}},      // lines
-                             {"fill-opacity", fp_t{.33f, 2}}, // geojson.io polys
-                             {"fillOpacity", fp_t{.33f, 2}},  // leaflet polys
-                         })},
+          {"properties", properties},
       }));
     }
   }
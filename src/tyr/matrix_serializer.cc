@@ -1,6 +1,8 @@
 #include <cstdint>
+#include <limits>
 
 #include "baldr/json.h"
+#include "proto/matrix.pb.h"
 #include "proto_conversions.h"
 #include "thor/costmatrix.h"
 #include "tyr/serializers.h"
@@ -10,47 +12,57 @@ using namespace valhalla::midgard;
 using namespace valhalla::baldr;
 using namespace valhalla::thor;
 
-namespace osrm_serializers {
-
-json::ArrayPtr
-serialize_duration(const std::vector<TimeDistance>& tds, size_t start_td, const size_t td_count) {
-  auto time = json::array({});
-  for (size_t i = start_td; i < start_td + td_count; ++i) {
-    // check to make sure a route was found; if not, return null for time in matrix result
-    if (tds[i].time != kMaxCost) {
-      time->emplace_back(static_cast<uint64_t>(tds[i].time));
-    } else {
-      time->emplace_back(static_cast<std::nullptr_t>(nullptr));
+namespace {
+
+// Writes one array per source of the times to all of the targets straight into the json text,
+// null where no route was found. Large matrices are mostly these numbers so they skip the tree
+void append_times(std::string& times,
+                  const std::vector<TimeDistance>& tds,
+                  const size_t source_count,
+                  const size_t target_count) {
+  times.reserve(times.size() + source_count * target_count * 6 + source_count * 2);
+  for (size_t source_index = 0; source_index < source_count; ++source_index) {
+    times.append(times.size() > 1 ? ",[" : "[");
+    for (size_t i = source_index * target_count; i < (source_index + 1) * target_count; ++i) {
+      if (i > source_index * target_count) {
+        times.push_back(',');
+      }
+      times.append(tds[i].time != kMaxCost ? std::to_string(tds[i].time) : "null");
     }
+    times.push_back(']');
   }
-  return time;
 }
 
-json::ArrayPtr serialize_distance(const std::vector<TimeDistance>& tds,
-                                  size_t start_td,
-                                  const size_t td_count,
-                                  const size_t source_index,
-                                  const size_t target_index,
-                                  double distance_scale) {
-  auto distance = json::array({});
-  for (size_t i = start_td; i < start_td + td_count; ++i) {
-    // check to make sure a route was found; if not, return null for distance in matrix result
-    if (tds[i].time != kMaxCost) {
-      distance->emplace_back(json::fp_t{tds[i].dist * distance_scale, 3});
-    } else {
-      distance->emplace_back(static_cast<std::nullptr_t>(nullptr));
+// Same as the times but for the distances which are scaled to the requested units
+void append_distances(std::string& distances,
+                      const std::vector<TimeDistance>& tds,
+                      const size_t source_count,
+                      const size_t target_count,
+                      double distance_scale) {
+  distances.reserve(distances.size() + source_count * target_count * 8 + source_count * 2);
+  for (size_t source_index = 0; source_index < source_count; ++source_index) {
+    distances.append(distances.size() > 1 ? ",[" : "[");
+    for (size_t i = source_index * target_count; i < (source_index + 1) * target_count; ++i) {
+      if (i > source_index * target_count) {
+        distances.push_back(',');
+      }
+      if (tds[i].time != kMaxCost) {
+        json::append(distances, json::fp_t{tds[i].dist * distance_scale, 3});
+      } else {
+        distances.append("null");
+      }
     }
+    distances.push_back(']');
   }
-  return distance;
 }
 
-// Serialize route response in OSRM compatible format.
-json::MapPtr serialize(const Api& request,
-                       const std::vector<TimeDistance>& time_distances,
-                       double distance_scale) {
+} // namespace
+
+namespace osrm_serializers {
+
+// Serialize the parts of the matrix response in OSRM compatible format which are not the matrix
+json::MapPtr serialize(const Api& request) {
   auto json = json::map({});
-  auto time = json::array({});
-  auto distance = json::array({});
   const auto& options = request.options();
 
   // If here then the matrix succeeded. Set status code to OK and serialize
@@ -58,16 +70,6 @@ json::MapPtr serialize(const Api& request,
   json->emplace("code", std::string("Ok"));
   json->emplace("sources", osrm::waypoints(options.sources()));
   json->emplace("destinations", osrm::waypoints(options.targets()));
-
-  for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
-    time->emplace_back(serialize_duration(time_distances, source_index * options.targets_size(),
-                                          options.targets_size()));
-    distance->emplace_back(serialize_distance(time_distances, source_index * options.targets_size(),
-                                              options.targets_size(), source_index, 0,
-                                              distance_scale));
-  }
-  json->emplace("durations", time);
-  json->emplace("distances", distance);
   return json;
 }
 } // namespace osrm_serializers
@@ -88,44 +90,42 @@ json::ArrayPtr locations(const google::protobuf::RepeatedPtrField<valhalla::Loca
   return input_locs;
 }
 
-json::ArrayPtr serialize_row(const std::vector<TimeDistance>& tds,
-                             size_t start_td,
-                             const size_t td_count,
-                             const size_t source_index,
-                             const size_t target_index,
-                             double distance_scale) {
-  auto row = json::array({});
-  for (size_t i = start_td; i < start_td + td_count; ++i) {
-    // check to make sure a route was found; if not, return null for distance & time in matrix
-    // result
-    if (tds[i].time != kMaxCost) {
-      row->emplace_back(json::map({{"from_index", static_cast<uint64_t>(source_index)},
-                                   {"to_index", static_cast<uint64_t>(target_index + (i - start_td))},
-                                   {"time", static_cast<uint64_t>(tds[i].time)},
-                                   {"distance", json::fp_t{tds[i].dist * distance_scale, 3}}}));
-    } else {
-      row->emplace_back(json::map({{"from_index", static_cast<uint64_t>(source_index)},
-                                   {"to_index", static_cast<uint64_t>(target_index + (i - start_td))},
-                                   {"time", static_cast<std::nullptr_t>(nullptr)},
-                                   {"distance", static_cast<std::nullptr_t>(nullptr)}}));
+// Writes the rows of objects, one per pair, straight into the json text like the compact arrays
+void append_rows(std::string& rows,
+                 const std::vector<TimeDistance>& tds,
+                 const size_t first_source,
+                 const size_t source_count,
+                 const size_t target_count,
+                 double distance_scale) {
+  for (size_t source_index = 0; source_index < source_count; ++source_index) {
+    rows.append(rows.size() > 1 ? ",[" : "[");
+    const auto from_index = std::to_string(first_source + source_index);
+    for (size_t target_index = 0; target_index < target_count; ++target_index) {
+      const auto& td = tds[source_index * target_count + target_index];
+      rows.append(target_index > 0 ? ",{\"from_index\":" : "{\"from_index\":");
+      rows.append(from_index);
+      rows.append(",\"to_index\":");
+      rows.append(std::to_string(target_index));
+      // check to make sure a route was found; if not, return null for distance & time in matrix
+      // result
+      if (td.time != kMaxCost) {
+        rows.append(",\"time\":");
+        rows.append(std::to_string(td.time));
+        rows.append(",\"distance\":");
+        json::append(rows, json::fp_t{td.dist * distance_scale, 3});
+        rows.push_back('}');
+      } else {
+        rows.append(",\"time\":null,\"distance\":null}");
+      }
     }
+    rows.push_back(']');
   }
-  return row;
 }
 
-json::MapPtr serialize(const Api& request,
-                       const std::vector<TimeDistance>& time_distances,
-                       double distance_scale) {
-  json::ArrayPtr matrix = json::array({});
+// Serialize the parts of the matrix response which are not the matrix
+json::MapPtr serialize(const Api& request) {
   const auto& options = request.options();
-  for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
-    matrix->emplace_back(serialize_row(time_distances, source_index * options.targets_size(),
-                                       options.targets_size(), source_index, 0, distance_scale));
-  }
-  auto json = json::map({
-      {"sources_to_targets", matrix},
-      {"units", Options_Units_Enum_Name(options.units())},
-  });
+  auto json = json::map({{"units", Options_Units_Enum_Name(options.units())}});
   json->emplace("targets", json::array({locations(options.targets())}));
   json->emplace("sources", json::array({locations(options.sources())}));
 
@@ -139,17 +139,88 @@ json::MapPtr serialize(const Api& request,
 namespace valhalla {
 namespace tyr {
 
-std::string serializeMatrix(const Api& request,
-                            const std::vector<TimeDistance>& time_distances,
-                            double distance_scale) {
+MatrixSerializer::MatrixSerializer(const Api& request, double distance_scale)
+    : request_(request), distance_scale_(distance_scale), rows_(0), times_("["),
+      distances_("[") {
+  if (request.options().format() == Options::pbf) {
+    matrix_.reset(new Matrix());
+    const auto pairs = static_cast<size_t>(request.options().sources_size()) *
+                       request.options().targets_size();
+    matrix_->mutable_times()->Reserve(pairs);
+    matrix_->mutable_distances()->Reserve(pairs);
+  }
+}
 
-  auto json = request.options().format() == Options::osrm
-                  ? osrm_serializers::serialize(request, time_distances, distance_scale)
-                  : valhalla_serializers::serialize(request, time_distances, distance_scale);
+MatrixSerializer::~MatrixSerializer() {
+}
 
+void MatrixSerializer::AddRows(const std::vector<TimeDistance>& time_distances) {
+  const auto& options = request_.options();
+  const size_t target_count = options.targets_size();
+  const size_t source_count = target_count ? time_distances.size() / target_count : 0;
+
+  if (matrix_) {
+    for (const auto& td : time_distances) {
+      if (td.time != kMaxCost) {
+        matrix_->add_times(td.time);
+        matrix_->add_distances(td.dist * distance_scale_);
+      } else {
+        matrix_->add_times(std::numeric_limits<uint32_t>::max());
+        matrix_->add_distances(std::numeric_limits<float>::quiet_NaN());
+      }
+    }
+  } // just the numbers, an array per source with an entry per target
+  else if (options.format() == Options::osrm || options.compact()) {
+    append_times(times_, time_distances, source_count, target_count);
+    append_distances(distances_, time_distances, source_count, target_count, distance_scale_);
+  } else {
+    valhalla_serializers::append_rows(times_, time_distances, rows_, source_count, target_count,
+                                      distance_scale_);
+  }
+  rows_ += source_count;
+}
+
+std::string MatrixSerializer::Finish() {
+  const auto& options = request_.options();
+  if (matrix_) {
+    matrix_->set_sources(options.sources_size());
+    matrix_->set_targets(options.targets_size());
+    matrix_->set_units(Options_Units_Enum_Name(options.units()));
+    if (options.has_id()) {
+      matrix_->set_id(options.id());
+    }
+    return matrix_->SerializeAsString();
+  }
+
+  // the rest of the response is small, the text of the matrix is put around it in place
+  const bool osrm = options.format() == Options::osrm;
+  auto json =
+      osrm ? osrm_serializers::serialize(request_) : valhalla_serializers::serialize(request_);
   std::stringstream ss;
   ss << *json;
-  return ss.str();
+  auto rest = ss.str();
+  rest[0] = ',';
+
+  times_.push_back(']');
+  if (osrm || options.compact()) {
+    times_.insert(0, osrm ? "{\"durations\":" : "{\"sources_to_targets\":{\"durations\":");
+    times_.append(",\"distances\":");
+    times_.append(distances_);
+    std::string().swap(distances_);
+    times_.append(osrm ? "]" : "]}");
+  } else {
+    times_.insert(0, "{\"sources_to_targets\":");
+  }
+  times_.append(rest);
+  return std::move(times_);
+}
+
+std::string serializeMatrix(const Api& request,
+                            const std::vector<TimeDistance>& time_distances,
+                            double distance_scale) {
+  MatrixSerializer serializer(request, distance_scale);
+  serializer.AddRows(time_distances);
+  return serializer.Finish();
 }
 
 } // namespace tyr
@@ -0,0 +1,63 @@
+#include <sstream>
+
+#include "baldr/json.h"
+#include "midgard/constants.h"
+#include "proto_conversions.h"
+#include "tyr/serializers.h"
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace tyr {
+
+/* example recost response:
+{
+  "recost": {
+    "time": 61.305, "cost": 73.12, "length": 0.853,
+    "edges": [ {"id": 1231454, "time": 20.432, "cost": 24.7, "length": 0.251}, ... ]
+  },
+  "units": "kilometers"
+}
+*/
+std::string serializeRecost(const Api& request, const std::vector<sif::EdgeLabel>& labels) {
+  const auto& options = request.options();
+  const double distance_scale =
+      kKmPerMeter * (options.units() == Options::miles ? kMilePerKm : 1.f);
+
+  // the labels add up along the path so each edge gets the difference to the one before it
+  auto edges = json::array({});
+  sif::Cost previous{};
+  uint32_t previous_length = 0;
+  for (const auto& label : labels) {
+    edges->emplace_back(json::map({
+        {"id", label.edgeid().value},
+        {"time", json::fp_t{label.cost().secs - previous.secs, 3}},
+        {"cost", json::fp_t{label.cost().cost - previous.cost, 3}},
+        {"length", json::fp_t{(label.path_distance() - previous_length) * distance_scale, 3}},
+    }));
+    previous = label.cost();
+    previous_length = label.path_distance();
+  }
+
+  auto json = json::map({
+      {"recost", json::map({
+                     {"time", json::fp_t{previous.secs, 3}},
+                     {"cost", json::fp_t{previous.cost, 3}},
+                     {"length", json::fp_t{previous_length * distance_scale, 3}},
+                     {"edges", edges},
+                 })},
+      {"units", Options_Units_Enum_Name(options.units())},
+  });
+  if (options.has_id()) {
+    json->emplace("id", options.id());
+  }
+
+  std::stringstream ss;
+  ss << *json;
+  return ss.str();
+}
+
+} // namespace tyr
+} // namespace valhalla
@@ -0,0 +1,121 @@
+#include "tyr/response_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Coordinates are kept to 6 digits in the tiles, locations closer than that find the same edges
+constexpr double kCoordinatePrecision = 1e6;
+
+void round(valhalla::LatLng& ll) {
+  ll.set_lng(std::llround(ll.lng() * kCoordinatePrecision) / kCoordinatePrecision);
+  ll.set_lat(std::llround(ll.lat() * kCoordinatePrecision) / kCoordinatePrecision);
+}
+
+// rounds down the hh:mm of an ISO 8601 YYYY-MM-DDThh:mm and replaces current with now's bucket
+std::string bucket(const std::string& date_time, uint32_t minutes, int64_t now) {
+  if (date_time == "current") {
+    return date_time + std::to_string(now / minutes);
+  }
+  if (date_time.size() < 16 || date_time[10] != 'T' || date_time[13] != ':') {
+    return date_time;
+  }
+  int of_day = std::stoi(date_time.substr(11, 2)) * 60 + std::stoi(date_time.substr(14, 2));
+  of_day -= of_day % minutes;
+  auto rounded = date_time;
+  rounded[11] = '0' + of_day / 600;
+  rounded[12] = '0' + of_day / 60 % 10;
+  rounded[14] = '0' + of_day % 60 / 10;
+  rounded[15] = '0' + of_day % 10;
+  return rounded;
+}
+
+void normalize(google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+               uint32_t minutes,
+               int64_t now) {
+  for (auto& location : locations) {
+    round(*location.mutable_ll());
+    if (location.has_display_ll()) {
+      round(*location.mutable_display_ll());
+    }
+    if (location.has_date_time()) {
+      location.set_date_time(bucket(location.date_time(), minutes, now));
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace tyr {
+
+ResponseCache::ResponseCache(const size_t max_size,
+                             const clock_t::duration time_to_live,
+                             const uint32_t date_time_bucket)
+    : max_size_(max_size), time_to_live_(time_to_live),
+      date_time_bucket_(std::max<uint32_t>(date_time_bucket, 1)), hits_(0), misses_(0) {
+  index_.reserve(max_size_);
+}
+
+std::string ResponseCache::Key(const Options& options) const {
+  // minutes since the epoch, the bucket of the requests that leave now
+  auto now = std::chrono::duration_cast<std::chrono::minutes>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+
+  // the costing options come in the order of the costings and there are no maps in the options so
+  // the same normalized options always serialize to the same bytes
+  Options normalized(options);
+  normalize(*normalized.mutable_locations(), date_time_bucket_, now);
+  normalize(*normalized.mutable_sources(), date_time_bucket_, now);
+  normalize(*normalized.mutable_targets(), date_time_bucket_, now);
+  normalize(*normalized.mutable_shape(), date_time_bucket_, now);
+  normalize(*normalized.mutable_trace(), date_time_bucket_, now);
+  normalize(*normalized.mutable_avoid_locations(), date_time_bucket_, now);
+  for (auto& route : *normalized.mutable_batch()) {
+    normalize(*route.mutable_locations(), date_time_bucket_, now);
+  }
+  if (normalized.has_date_time()) {
+    normalized.set_date_time(bucket(normalized.date_time(), date_time_bucket_, now));
+  }
+  return normalized.SerializeAsString();
+}
+
+bool ResponseCache::Find(const std::string& key, Response& response) {
+  auto found = index_.find(key);
+  if (found != index_.end() && clock_t::now() - found->second->inserted > time_to_live_) {
+    entries_.erase(found->second);
+    index_.erase(found);
+    found = index_.end();
+  }
+  if (found == index_.end()) {
+    ++misses_;
+    return false;
+  }
+  // move it to the front as it was just used
+  entries_.splice(entries_.begin(), entries_, found->second);
+  response = found->second->response;
+  ++hits_;
+  return true;
+}
+
+void ResponseCache::Insert(const std::string& key, Response response) {
+  if (max_size_ == 0 || index_.find(key) != index_.end()) {
+    return;
+  }
+  if (index_.size() == max_size_) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+  entries_.push_front(entry_t{key, std::move(response), clock_t::now()});
+  index_.emplace(key, entries_.begin());
+}
+
+void ResponseCache::Clear() {
+  entries_.clear();
+  index_.clear();
+}
+
+} // namespace tyr
+} // namespace valhalla
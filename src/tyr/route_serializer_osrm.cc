@@ -138,6 +138,22 @@ inline unsigned getFittedZoom(Coordinate south_west, Coordinate north_east) {
     return MIN_ZOOM;
 }
 
+// Writes an array of numbers, each converted and fixed to the precision, as raw json
+template <typename values_t, typename convert_t>
+json::RawJSON fixed_array(const values_t& values, const size_t precision, const convert_t& convert) {
+  json::RawJSON array;
+  array.data.reserve(values.size() * (precision + 4) + 2);
+  array.data.push_back('[');
+  for (const auto& value : values) {
+    if (array.data.size() > 1) {
+      array.data.push_back(',');
+    }
+    json::append(array.data, json::fp_t{convert(value), precision});
+  }
+  array.data.push_back(']');
+  return array;
+}
+
 // For transforming ISO 3166-1 country codes from alpha2 to alpha3
 std::unordered_map<std::string, std::string> iso2_to_iso3 =
     {{"AD", "AND"}, {"AE", "ARE"}, {"AF", "AFG"}, {"AG", "ATG"}, {"AI", "AIA"}, {"AL", "ALB"},
@@ -296,12 +312,17 @@ void route_summary(json::MapPtr& route, const valhalla::Api& api, bool imperial,
 // Generate leg shape in geojson format.
 json::MapPtr geojson_shape(const std::vector<PointLL> shape) {
   auto geojson = json::map({});
-  auto coords = json::array({});
-  coords->reserve(shape.size());
+  json::RawJSON coords;
+  coords.data.reserve(shape.size() * (2 * DIGITS_PRECISION + 10) + 2);
+  coords.data.push_back('[');
   for (const auto& p : shape) {
-    coords->emplace_back(
-        json::array({json::fp_t{p.lng(), DIGITS_PRECISION}, json::fp_t{p.lat(), DIGITS_PRECISION}}));
+    coords.data.append(coords.data.size() > 1 ? ",[" : "[");
+    json::append(coords.data, json::fp_t{p.lng(), DIGITS_PRECISION});
+    coords.data.push_back(',');
+    json::append(coords.data, json::fp_t{p.lat(), DIGITS_PRECISION});
+    coords.data.push_back(']');
   }
+  coords.data.push_back(']');
   geojson->emplace("type", std::string("LineString"));
   geojson->emplace("coordinates", std::move(coords));
   return geojson;
@@ -381,33 +402,25 @@ json::MapPtr serialize_annotations(const valhalla::TripLeg& trip_leg) {
   attributes_map->reserve(4);
 
   if (trip_leg.shape_attributes().time_size() > 0) {
-    auto duration_array = json::array({});
-    duration_array->reserve(trip_leg.shape_attributes().time_size());
-    for (const auto& time : trip_leg.shape_attributes().time()) {
-      // milliseconds (ms) to seconds (sec)
-      duration_array->push_back(json::fp_t{time * kSecPerMillisecond, 3});
-    }
-    attributes_map->emplace("duration", duration_array);
+    // milliseconds (ms) to seconds (sec)
+    attributes_map->emplace("duration",
+                            fixed_array(trip_leg.shape_attributes().time(), 3,
+                                        [](uint32_t time) { return time * kSecPerMillisecond; }));
   }
 
   if (trip_leg.shape_attributes().length_size() > 0) {
-    auto distance_array = json::array({});
-    distance_array->reserve(trip_leg.shape_attributes().length_size());
-    for (const auto& length : trip_leg.shape_attributes().length()) {
-      // decimeters (dm) to meters (m)
-      distance_array->push_back(json::fp_t{length * kMeterPerDecimeter, 1});
-    }
-    attributes_map->emplace("distance", distance_array);
+    // decimeters (dm) to meters (m)
+    attributes_map->emplace("distance", fixed_array(trip_leg.shape_attributes().length(), 1,
+                                                    [](uint32_t length) {
+                                                      return length * kMeterPerDecimeter;
+                                                    }));
   }
 
   if (trip_leg.shape_attributes().speed_size() > 0) {
-    auto speeds_array = json::array({});
-    speeds_array->reserve(trip_leg.shape_attributes().speed_size());
-    for (const auto& speed : trip_leg.shape_attributes().speed()) {
-      // dm/s to m/s
-      speeds_array->push_back(json::fp_t{speed * kMeterPerDecimeter, 1});
-    }
-    attributes_map->emplace("speed", speeds_array);
+    // dm/s to m/s
+    attributes_map->emplace("speed",
+                            fixed_array(trip_leg.shape_attributes().speed(), 1,
+                                        [](uint32_t speed) { return speed * kMeterPerDecimeter; }));
   }
 
   if (trip_leg.shape_attributes().speed_limit_size() > 0) {
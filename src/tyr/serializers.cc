@@ -118,6 +118,29 @@ void openlr(const valhalla::Api& api, int route_index, rapidjson::writer_wrapper
   }
   writer.end_array();
 }
+
+std::string serializePbf(const Api& request) {
+  return request.SerializeAsString();
+}
+
+std::string serializeRouteBatch(const Api& request, const std::vector<std::string>& routes) {
+  // each of the routes is already json so they just need to be strung together
+  std::string array("[");
+  for (const auto& route : routes) {
+    if (array.size() > 1) {
+      array.push_back(',');
+    }
+    array += route;
+  }
+  array.push_back(']');
+  auto json = baldr::json::map({{"routes", baldr::json::RawJSON{std::move(array)}}});
+  if (request.options().has_id()) {
+    json->emplace("id", request.options().id());
+  }
+  std::stringstream ss;
+  ss << *json;
+  return ss.str();
+}
 } // namespace tyr
 } // namespace valhalla
 
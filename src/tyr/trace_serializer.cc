@@ -1,4 +1,6 @@
 #include <cstdint>
+#include <string>
+#include <unordered_map>
 
 #include "baldr/graphconstants.h"
 #include "baldr/json.h"
@@ -44,10 +46,63 @@ json::ArrayPtr serialize_admins(const TripLeg& trip_path) {
   return admin_array;
 }
 
-json::ArrayPtr serialize_edges(const AttributesController& controller,
-                               const Options& options,
-                               const TripLeg& trip_path) {
-  json::ArrayPtr edge_array = json::array({});
+// Gathers the attributes of the edges, an object per edge or in compact form an array per
+// attribute with an entry per edge, null for the edges without the attribute
+class edge_attributes_t {
+public:
+  explicit edge_attributes_t(const bool compact)
+      : compact_(compact), count_(0), edges_(json::array({})) {
+  }
+
+  // Starts the attributes of the next edge
+  void next() {
+    ++count_;
+    if (!compact_) {
+      edge_ = json::map({});
+      edges_->emplace_back(edge_);
+    }
+  }
+
+  // Sets an attribute of the current edge
+  void emplace(const std::string& key, json::Value&& value) {
+    if (!compact_) {
+      edge_->emplace(key, std::move(value));
+      return;
+    }
+    auto& column = columns_[key];
+    if (!column) {
+      column = json::array({});
+      column->reserve(count_);
+    }
+    column->resize(count_ - 1, static_cast<std::nullptr_t>(nullptr));
+    column->emplace_back(std::move(value));
+  }
+
+  // The objects of the edges or the arrays of the attributes
+  json::Value finish() {
+    if (!compact_) {
+      return edges_;
+    }
+    auto columns = json::map({});
+    for (auto& column : columns_) {
+      column.second->resize(count_, static_cast<std::nullptr_t>(nullptr));
+      columns->emplace(column.first, std::move(column.second));
+    }
+    return columns;
+  }
+
+protected:
+  bool compact_;
+  size_t count_;
+  json::ArrayPtr edges_;
+  json::MapPtr edge_;
+  std::unordered_map<std::string, json::ArrayPtr> columns_;
+};
+
+json::Value serialize_edges(const AttributesController& controller,
+                            const Options& options,
+                            const TripLeg& trip_path) {
+  edge_attributes_t edges(options.compact());
 
   // Length and speed default to kilometers
   double scale = 1;
@@ -62,36 +117,36 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
       const auto& edge = trip_path.node(i - 1).edge();
 
       // Process each edge
-      auto edge_map = json::map({});
+      edges.next();
       if (edge.has_truck_route()) {
-        edge_map->emplace("truck_route", static_cast<bool>(edge.truck_route()));
+        edges.emplace("truck_route", static_cast<bool>(edge.truck_route()));
       }
       if (edge.has_truck_speed() && (edge.truck_speed() > 0)) {
-        edge_map->emplace("truck_speed",
+        edges.emplace("truck_speed",
                           static_cast<uint64_t>(std::round(edge.truck_speed() * scale)));
       }
       if (edge.has_speed_limit() && (edge.speed_limit() > 0)) {
         if (edge.speed_limit() == kUnlimitedSpeedLimit) {
-          edge_map->emplace("speed_limit", std::string("unlimited"));
+          edges.emplace("speed_limit", std::string("unlimited"));
         } else {
-          edge_map->emplace("speed_limit",
+          edges.emplace("speed_limit",
                             static_cast<uint64_t>(std::round(edge.speed_limit() * scale)));
         }
       }
       if (edge.has_density()) {
-        edge_map->emplace("density", static_cast<uint64_t>(edge.density()));
+        edges.emplace("density", static_cast<uint64_t>(edge.density()));
       }
       if (edge.has_sidewalk()) {
-        edge_map->emplace("sidewalk", to_string(edge.sidewalk()));
+        edges.emplace("sidewalk", to_string(edge.sidewalk()));
       }
       if (edge.has_bicycle_network()) {
-        edge_map->emplace("bicycle_network", static_cast<uint64_t>(edge.bicycle_network()));
+        edges.emplace("bicycle_network", static_cast<uint64_t>(edge.bicycle_network()));
       }
       if (edge.has_cycle_lane()) {
-        edge_map->emplace("cycle_lane", to_string(static_cast<CycleLane>(edge.cycle_lane())));
+        edges.emplace("cycle_lane", to_string(static_cast<CycleLane>(edge.cycle_lane())));
       }
       if (edge.has_lane_count()) {
-        edge_map->emplace("lane_count", static_cast<uint64_t>(edge.lane_count()));
+        edges.emplace("lane_count", static_cast<uint64_t>(edge.lane_count()));
       }
       if (edge.lane_connectivity_size()) {
         auto lane_connectivity = json::array({});
@@ -102,16 +157,16 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
           element->emplace("from_lanes", l.from_lanes());
           lane_connectivity->push_back(element);
         }
-        edge_map->emplace("lane_connectivity", lane_connectivity);
+        edges.emplace("lane_connectivity", lane_connectivity);
       }
       if (edge.has_max_downward_grade()) {
-        edge_map->emplace("max_downward_grade", static_cast<int64_t>(edge.max_downward_grade()));
+        edges.emplace("max_downward_grade", static_cast<int64_t>(edge.max_downward_grade()));
       }
       if (edge.has_max_upward_grade()) {
-        edge_map->emplace("max_upward_grade", static_cast<int64_t>(edge.max_upward_grade()));
+        edges.emplace("max_upward_grade", static_cast<int64_t>(edge.max_upward_grade()));
       }
       if (edge.has_weighted_grade()) {
-        edge_map->emplace("weighted_grade", json::fp_t{edge.weighted_grade(), 3});
+        edges.emplace("weighted_grade", json::fp_t{edge.weighted_grade(), 3});
       }
       if (edge.has_mean_elevation()) {
         // Convert to feet if a valid elevation and units are miles
@@ -119,76 +174,85 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
         if (mean != kNoElevationData && options.has_units() && options.units() == Options::miles) {
           mean *= kFeetPerMeter;
         }
-        edge_map->emplace("mean_elevation", static_cast<int64_t>(mean));
+        edges.emplace("mean_elevation", static_cast<int64_t>(mean));
+      }
+      if (edge.elevation_size()) {
+        // Convert to feet if the units are miles
+        const bool feet = options.has_units() && options.units() == Options::miles;
+        auto elevation = json::array({});
+        for (auto height : edge.elevation()) {
+          elevation->emplace_back(json::fp_t{feet ? height * kFeetPerMeter : height, 1});
+        }
+        edges.emplace("elevation", elevation);
       }
       if (edge.has_way_id()) {
-        edge_map->emplace("way_id", static_cast<uint64_t>(edge.way_id()));
+        edges.emplace("way_id", static_cast<uint64_t>(edge.way_id()));
       }
       if (edge.has_id()) {
-        edge_map->emplace("id", static_cast<uint64_t>(edge.id()));
+        edges.emplace("id", static_cast<uint64_t>(edge.id()));
       }
       if (edge.has_travel_mode()) {
-        edge_map->emplace("travel_mode", to_string(edge.travel_mode()));
+        edges.emplace("travel_mode", to_string(edge.travel_mode()));
       }
       if (edge.has_vehicle_type()) {
-        edge_map->emplace("vehicle_type", to_string(edge.vehicle_type()));
+        edges.emplace("vehicle_type", to_string(edge.vehicle_type()));
       }
       if (edge.has_pedestrian_type()) {
-        edge_map->emplace("pedestrian_type", to_string(edge.pedestrian_type()));
+        edges.emplace("pedestrian_type", to_string(edge.pedestrian_type()));
       }
       if (edge.has_bicycle_type()) {
-        edge_map->emplace("bicycle_type", to_string(edge.bicycle_type()));
+        edges.emplace("bicycle_type", to_string(edge.bicycle_type()));
       }
       if (edge.has_surface()) {
-        edge_map->emplace("surface", to_string(static_cast<baldr::Surface>(edge.surface())));
+        edges.emplace("surface", to_string(static_cast<baldr::Surface>(edge.surface())));
       }
       if (edge.has_drive_on_right()) {
-        edge_map->emplace("drive_on_right", static_cast<bool>(edge.drive_on_right()));
+        edges.emplace("drive_on_right", static_cast<bool>(edge.drive_on_right()));
       }
       if (edge.has_internal_intersection()) {
-        edge_map->emplace("internal_intersection", static_cast<bool>(edge.internal_intersection()));
+        edges.emplace("internal_intersection", static_cast<bool>(edge.internal_intersection()));
       }
       if (edge.has_roundabout()) {
-        edge_map->emplace("roundabout", static_cast<bool>(edge.roundabout()));
+        edges.emplace("roundabout", static_cast<bool>(edge.roundabout()));
       }
       if (edge.has_bridge()) {
-        edge_map->emplace("bridge", static_cast<bool>(edge.bridge()));
+        edges.emplace("bridge", static_cast<bool>(edge.bridge()));
       }
       if (edge.has_tunnel()) {
-        edge_map->emplace("tunnel", static_cast<bool>(edge.tunnel()));
+        edges.emplace("tunnel", static_cast<bool>(edge.tunnel()));
       }
       if (edge.has_unpaved()) {
-        edge_map->emplace("unpaved", static_cast<bool>(edge.unpaved()));
+        edges.emplace("unpaved", static_cast<bool>(edge.unpaved()));
       }
       if (edge.has_toll()) {
-        edge_map->emplace("toll", static_cast<bool>(edge.toll()));
+        edges.emplace("toll", static_cast<bool>(edge.toll()));
       }
       if (edge.has_use()) {
-        edge_map->emplace("use", to_string(static_cast<baldr::Use>(edge.use())));
+        edges.emplace("use", to_string(static_cast<baldr::Use>(edge.use())));
       }
       if (edge.has_traversability()) {
-        edge_map->emplace("traversability", to_string(edge.traversability()));
+        edges.emplace("traversability", to_string(edge.traversability()));
       }
       if (edge.has_end_shape_index()) {
-        edge_map->emplace("end_shape_index", static_cast<uint64_t>(edge.end_shape_index()));
+        edges.emplace("end_shape_index", static_cast<uint64_t>(edge.end_shape_index()));
       }
       if (edge.has_begin_shape_index()) {
-        edge_map->emplace("begin_shape_index", static_cast<uint64_t>(edge.begin_shape_index()));
+        edges.emplace("begin_shape_index", static_cast<uint64_t>(edge.begin_shape_index()));
       }
       if (edge.has_end_heading()) {
-        edge_map->emplace("end_heading", static_cast<uint64_t>(edge.end_heading()));
+        edges.emplace("end_heading", static_cast<uint64_t>(edge.end_heading()));
       }
       if (edge.has_begin_heading()) {
-        edge_map->emplace("begin_heading", static_cast<uint64_t>(edge.begin_heading()));
+        edges.emplace("begin_heading", static_cast<uint64_t>(edge.begin_heading()));
       }
       if (edge.has_road_class()) {
-        edge_map->emplace("road_class", to_string(static_cast<baldr::RoadClass>(edge.road_class())));
+        edges.emplace("road_class", to_string(static_cast<baldr::RoadClass>(edge.road_class())));
       }
       if (edge.has_speed()) {
-        edge_map->emplace("speed", static_cast<uint64_t>(std::round(edge.speed() * scale)));
+        edges.emplace("speed", static_cast<uint64_t>(std::round(edge.speed() * scale)));
       }
       if (edge.has_length_km()) {
-        edge_map->emplace("length", json::fp_t{edge.length_km() * scale, 3});
+        edges.emplace("length", json::fp_t{edge.length_km() * scale, 3});
       }
       // TODO: do we want to output 'is_route_number'?
       if (edge.name_size() > 0) {
@@ -196,7 +260,7 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
         for (const auto& name : edge.name()) {
           names_array->push_back(name.value());
         }
-        edge_map->emplace("names", names_array);
+        edges.emplace("names", names_array);
       }
       if (edge.traffic_segment().size() > 0) {
         auto segments_array = json::array({});
@@ -208,7 +272,7 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
                                            {"ends_segment", segment.ends_segment()}});
           segments_array->emplace_back(segmap);
         }
-        edge_map->emplace("traffic_segments", segments_array);
+        edges.emplace("traffic_segments", segments_array);
       }
 
       // Process edge sign
@@ -252,7 +316,7 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
           sign_map->emplace("exit_name", exit_name_array);
         }
 
-        edge_map->emplace("sign", sign_map);
+        edges.emplace("sign", sign_map);
       }
 
       // Process edge end node only if any node items are enabled
@@ -325,7 +389,7 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
         // kNodeTransitStopInfoAssumedSchedule = "node.transit_stop_info.assumed_schedule";
         // kNodeTransitStopInfoLatLon = "node.transit_stop_info.lat_lon";
 
-        edge_map->emplace("end_node", end_node_map);
+        edges.emplace("end_node", end_node_map);
       }
 
       // TODO - transit info on edge
@@ -342,11 +406,9 @@ json::ArrayPtr serialize_edges(const AttributesController& controller,
       // kEdgeTransitRouteInfoOperatorOnestopId = "edge.transit_route_info.operator_onestop_id";
       // kEdgeTransitRouteInfoOperatorName = "edge.transit_route_info.operator_name";
       // kEdgeTransitRouteInfoOperatorUrl = "edge.transit_route_info.operator_url";
-
-      edge_array->emplace_back(edge_map);
     }
   }
-  return edge_array;
+  return edges.finish();
 }
 
 json::ArrayPtr serialize_matched_points(const AttributesController& controller,
@@ -502,6 +564,11 @@ std::string serializeTraceAttributes(
     const AttributesController& controller,
     std::vector<std::tuple<float, float, std::vector<meili::MatchResult>>>& map_match_results) {
 
+  // The trip legs already only have the attributes the controller asked for
+  if (request.options().format() == Options::pbf) {
+    return serializePbf(request);
+  }
+
   // Create json map to return
   auto json = json::map({});
 
@@ -10,7 +10,14 @@
 #include "midgard/logging.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 
@@ -25,31 +32,43 @@ namespace bpo = boost::program_options;
 std::string column_separator{'\0'};
 std::string row_separator = "\n";
 std::string config;
+std::string output;
+std::string format = "text";
+size_t concurrency = std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                              static_cast<size_t>(1));
 bool ferries;
 bool unnamed;
 
 namespace {
 
-// a place we can mark what edges we've seen, even for the planet we should need < 100mb
+// how much output each thread collects before it writes it out
+constexpr size_t kFlushBytes = 1 << 20;
+// the binary format keeps millionths of a degree
+constexpr double kBinaryPrecision = 1e6;
+
+// a place we can mark what edges we've seen, even for the planet we should need < 100mb. the
+// threads mark edges in it concurrently so whoever marks an edge first owns it
 struct bitset_t {
-  bitset_t(size_t size) {
-    bits.resize(std::ceil(size / 64.0));
+  bitset_t(size_t size) : bits(static_cast<size_t>(std::ceil(size / 64.0))) {
   }
-  void set(const uint64_t id) {
+  // returns true if the bit wasnt set before, ie the caller is the one who set it
+  bool set(const uint64_t id) {
     if (id >= bits.size() * 64) {
       throw std::runtime_error("id out of bounds");
     }
-    bits[id / 64] |= static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
+    const uint64_t bit = static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
+    return !(bits[id / 64].fetch_or(bit, std::memory_order_relaxed) & bit);
   }
   bool get(const uint64_t id) const {
     if (id >= bits.size() * 64) {
       throw std::runtime_error("id out of bounds");
     }
-    return bits[id / 64] & (static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64)));
+    return bits[id / 64].load(std::memory_order_relaxed) &
+           (static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64)));
   }
 
 protected:
-  std::vector<uint64_t> bits;
+  std::vector<std::atomic<uint64_t>> bits;
 };
 
 // often we need both the edge id and the directed edge, so lets have something to represent that
@@ -67,6 +86,14 @@ struct edge_t {
   }
 };
 
+// the names of an edge, pointing into the text list of its tile
+using names_t = std::vector<boost::string_view>;
+
+// the global sequential id of an edge
+uint64_t index(const std::unordered_map<GraphId, uint64_t>& tile_set, const GraphId& edge_id) {
+  return tile_set.find(edge_id.Tile_Base())->second + edge_id.id();
+}
+
 // Get the opposing edge - if the opposing index is invalid return a nullptr
 // for the directed edge. This should not occur but this can happen in
 // GraphValidator if it fails to find an opposing edge.
@@ -76,12 +103,45 @@ edge_t opposing(GraphReader& reader, graph_tile_ptr tile, const GraphId& edge_id
   return {opp_id, opp_edge};
 }
 
+// an edge and its opposing edge are always taken together. which of the two marks the pair is
+// fixed, so that two threads starting from either side of it cant both give up on it
+bool take(const std::unordered_map<GraphId, uint64_t>& tile_set,
+          bitset_t& edge_set,
+          const edge_t& edge,
+          const edge_t& opposing_edge) {
+  const auto a = index(tile_set, edge.i);
+  if (!opposing_edge) {
+    return edge_set.set(a);
+  }
+  const auto b = index(tile_set, opposing_edge.i);
+  if (!edge_set.set(std::min(a, b))) {
+    return false;
+  }
+  edge_set.set(std::max(a, b));
+  return true;
+}
+
+// whether the edge has the same names in the same order, without copying any of them
+bool same_names(const EdgeInfo& info, const names_t& names) {
+  if (info.name_count() < names.size()) {
+    return false;
+  }
+  size_t i = 0;
+  bool same = true;
+  info.VisitNames([&](boost::string_view name, bool) {
+    same = same && i < names.size() && name == names[i];
+    ++i;
+  });
+  return same && i == names.size();
+}
+
 edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
-            const bitset_t& edge_set,
+            bitset_t& edge_set,
             GraphReader& reader,
             graph_tile_ptr& tile,
             const edge_t& edge,
-            const std::vector<std::string>& names) {
+            const names_t& names,
+            edge_t& other) {
   // get the right tile
   if (tile->id() != edge.e->endnode().Tile_Base()) {
     tile = reader.GetGraphTile(edge.e->endnode());
@@ -96,7 +156,7 @@ edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
     GraphId id = tile->id();
     id.set_id(node->edge_index() + i);
     // already used
-    if (edge_set.get(tile_set.find(tile->id())->second + id.id())) {
+    if (edge_set.get(index(tile_set, id))) {
       continue;
     }
     edge_t candidate{id, tile->directededge(id)};
@@ -110,9 +170,12 @@ edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
       continue;
     }
     // names have to match
-    auto candidate_names = tile->edgeinfo(candidate.e->edgeinfo_offset()).GetNames();
-    if (names.size() == candidate_names.size() &&
-        std::equal(names.cbegin(), names.cend(), candidate_names.cbegin())) {
+    if (!same_names(tile->edgeinfo(candidate.e->edgeinfo_offset()), names)) {
+      continue;
+    }
+    // another thread may have gotten to it in the meantime
+    other = opposing(reader, tile, candidate);
+    if (take(tile_set, edge_set, candidate, other)) {
       return candidate;
     }
   }
@@ -123,23 +186,58 @@ edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
 void extend(GraphReader& reader,
             graph_tile_ptr& tile,
             const edge_t& edge,
-            std::list<PointLL>& shape) {
+            std::vector<PointLL>& scratch,
+            std::vector<PointLL>& shape) {
   // get the shape
   if (edge.i.Tile_Base() != tile->id()) {
     tile = reader.GetGraphTile(edge.i);
   }
   // get the shape
+  scratch.clear();
   auto info = tile->edgeinfo(edge.e->edgeinfo_offset());
-  auto more = valhalla::midgard::decode7<std::list<PointLL>>(info.encoded_shape());
+  info.VisitShape([&scratch](const PointLL& p) { scratch.push_back(p); });
   // this shape runs the other way
   if (!edge.e->forward()) {
-    more.reverse();
+    std::reverse(scratch.begin(), scratch.end());
   }
   // connecting another shape we dont want dups where they meet
-  if (shape.size()) {
-    more.pop_front();
+  auto begin = scratch.cbegin();
+  if (shape.size() && begin != scratch.cend()) {
+    ++begin;
+  }
+  shape.insert(shape.end(), begin, scratch.cend());
+}
+
+template <typename T> void append(std::string& buffer, const T& value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// output it as: shape,name,name,...
+void write_text(const std::vector<PointLL>& shape, const names_t& names, std::string& buffer) {
+  buffer += encode(shape);
+  buffer += column_separator;
+  for (const auto& name : names) {
+    buffer.append(name.data(), name.size());
+    if (&name != &names.back()) {
+      buffer += column_separator;
+    }
+  }
+  buffer += row_separator;
+}
+
+// output it as: point count, lat,lon * 1e6 as int32 per point, name count, length and bytes of
+// each name. all of it in the byte order of the machine
+void write_binary(const std::vector<PointLL>& shape, const names_t& names, std::string& buffer) {
+  append(buffer, static_cast<uint32_t>(shape.size()));
+  for (const auto& p : shape) {
+    append(buffer, static_cast<int32_t>(std::round(p.lat() * kBinaryPrecision)));
+    append(buffer, static_cast<int32_t>(std::round(p.lng() * kBinaryPrecision)));
+  }
+  append(buffer, static_cast<uint32_t>(names.size()));
+  for (const auto& name : names) {
+    append(buffer, static_cast<uint32_t>(name.size()));
+    buffer.append(name.data(), name.size());
   }
-  shape.splice(shape.end(), more);
 }
 
 } // namespace
@@ -159,10 +257,19 @@ int main(int argc, char* argv[]) {
                                                               "Print the version of this software.")(
       "column,c", bpo::value<std::string>(&column_separator),
       "What separator to use between columns [default=\\0].")(
-      "row,r", bpo::value<std::string>(&column_separator),
+      "row,r", bpo::value<std::string>(&row_separator),
       "What separator to use between row [default=\\n].")("ferries,f",
                                                           "Export ferries as well [default=false]")(
-      "unnamed,u", "Export unnamed edges as well [default=false]")
+      "unnamed,u", "Export unnamed edges as well [default=false]")(
+      "concurrency,j", bpo::value<size_t>(&concurrency),
+      "Number of threads to export with [default=number of cores].")(
+      "output,o", bpo::value<std::string>(&output),
+      "Write each thread's edges to its own file <output>.<thread> rather than all of them to "
+      "stdout.")("format", bpo::value<std::string>(&format),
+                 "text writes the encoded shape and names of an edge separated by the column "
+                 "separator per row. binary writes the number of points, the latitude and "
+                 "longitude of each as int32 in millionths of a degree, the number of names and "
+                 "each name prefixed by its length as uint32 [default=text].")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file [required]");
 
@@ -189,8 +296,15 @@ int main(int argc, char* argv[]) {
     return EXIT_SUCCESS;
   }
 
-  bool ferries = vm.count("ferries");
-  bool unnamed = vm.count("unnamed");
+  if (format != "text" && format != "binary") {
+    std::cerr << "Unknown format " << format << "\n";
+    return EXIT_FAILURE;
+  }
+  const auto write_row = format == "text" ? write_text : write_binary;
+
+  ferries = vm.count("ferries");
+  unnamed = vm.count("unnamed");
+  concurrency = std::max(concurrency, static_cast<size_t>(1));
 
   // parse the config
   boost::property_tree::ptree pt;
@@ -199,48 +313,107 @@ int main(int argc, char* argv[]) {
   // configure logging
   valhalla::midgard::logging::Configure({{"type", "std_err"}, {"color", "true"}});
 
-  // get something we can use to fetch tiles
-  valhalla::baldr::GraphReader reader(pt.get_child("mjolnir"));
+  // every thread has its own reader, they dont keep each others tiles
+  const auto& mjolnir = pt.get_child("mjolnir");
+  std::vector<GraphId> tiles;
+  {
+    GraphReader reader(mjolnir);
+    const auto transit_level = TileHierarchy::GetTransitLevel().level;
+    for (const auto& tile_id : reader.GetTileSet()) {
+      if (tile_id.level() != transit_level) {
+        tiles.push_back(tile_id);
+      }
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+
+  // runs the work on all the threads, each of them taking the next tile when done with its last
+  auto run = [&mjolnir, &tiles](const std::function<void(size_t, GraphReader&, size_t)>& work) {
+    std::atomic<size_t> next_tile(0);
+    auto thread_work = [&](size_t thread) {
+      GraphReader reader(mjolnir);
+      for (size_t t; (t = next_tile++) < tiles.size();) {
+        work(thread, reader, t);
+        if (reader.OverCommitted()) {
+          reader.Trim();
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for (size_t thread = 1; thread < concurrency; ++thread) {
+      threads.emplace_back(thread_work, thread);
+    }
+    thread_work(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
 
   // keep the global number of edges encountered at the point we encounter each tile
   // this allows an edge to have a sequential global id and makes storing it very small
   LOG_INFO("Enumerating edges...");
-  std::unordered_map<GraphId, uint64_t> tile_set(kMaxGraphTileId * TileHierarchy::levels().size());
+  std::vector<uint64_t> edge_counts(tiles.size());
+  run([&tiles, &edge_counts](size_t, GraphReader& reader, size_t t) {
+    // TODO: just read the header, parsing the whole thing isnt worth it at this point
+    auto tile = reader.GetGraphTile(tiles[t]);
+    assert(tile);
+    edge_counts[t] = tile->header()->directededgecount();
+  });
+  std::unordered_map<GraphId, uint64_t> tile_set(tiles.size());
   uint64_t edge_count = 0;
-  for (const auto& level : TileHierarchy::levels()) {
-    for (uint32_t i = 0; i < level.tiles.TileCount(); ++i) {
-      GraphId tile_id{i, level.level, 0};
-      if (reader.DoesTileExist(tile_id)) {
-        // TODO: just read the header, parsing the whole thing isnt worth it at this point
-        tile_set.emplace(tile_id, edge_count);
-        auto tile = reader.GetGraphTile(tile_id);
-        assert(tile);
-        edge_count += tile->header()->directededgecount();
-        reader.Clear();
-      }
-    }
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    tile_set.emplace(tiles[t], edge_count);
+    edge_count += edge_counts[t];
   }
 
   // this is how we know what i've touched and what we havent
   bitset_t edge_set(edge_count);
 
-  // TODO: we could parallelize this and it might be quite a bit faster but if we really want to
-  // maximize continuous edges we need to avoid the lady and the tramp scenario where two threads
-  // are
-  // consuming the same stretch of road at the same time
+  // where the edges go, either a file per thread or all of them to stdout
+  std::vector<std::ofstream> shards(output.empty() ? 0 : concurrency);
+  for (size_t thread = 0; thread < shards.size(); ++thread) {
+    auto file_name = output + "." + std::to_string(thread);
+    shards[thread].open(file_name, std::ios::binary);
+    if (!shards[thread]) {
+      LOG_ERROR("Could not open " + file_name);
+      return EXIT_FAILURE;
+    }
+  }
+  std::mutex stdout_lock;
+  std::vector<std::string> buffers(concurrency);
+  auto flush = [&](size_t thread) {
+    auto& buffer = buffers[thread];
+    if (shards.empty()) {
+      std::lock_guard<std::mutex> lock(stdout_lock);
+      std::cout.write(buffer.data(), buffer.size());
+      std::cout.flush();
+    } else {
+      shards[thread].write(buffer.data(), buffer.size());
+    }
+    buffer.clear();
+  };
+
+  // tiles are exported concurrently. to avoid the lady and the tramp scenario where two threads
+  // consume the same stretch of road at the same time, each edge goes to whichever thread marks it
+  // first. the other thread simply stops extending its stretch there
 
   // for each tile
-  LOG_INFO("Exporting " + std::to_string(edge_count) + " edges");
-  int progress = -1;
-  uint64_t set = 0;
-  for (const auto& tile_count_pair : tile_set) {
+  LOG_INFO("Exporting " + std::to_string(edge_count) + " edges with " +
+           std::to_string(concurrency) + " threads");
+  std::atomic<int> progress(-1);
+  std::atomic<uint64_t> set(0);
+  std::vector<std::deque<edge_t>> edges(concurrency);
+  std::vector<std::vector<PointLL>> shapes(concurrency), scratches(concurrency);
+  run([&](size_t thread, GraphReader& reader, size_t tile_index) {
     // for each edge in the tile
-    reader.Clear();
-    auto tile = reader.GetGraphTile(tile_count_pair.first);
+    const auto& tile_id = tiles[tile_index];
+    const auto tile_offset = tile_set.find(tile_id)->second;
+    auto tile = reader.GetGraphTile(tile_id);
     assert(tile);
+    uint64_t tile_set_count = 0;
     for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
       // we've seen this one already
-      if (edge_set.get(tile_count_pair.second + i)) {
+      if (edge_set.get(tile_offset + i)) {
         continue;
       }
 
@@ -248,25 +421,27 @@ int main(int argc, char* argv[]) {
       // times maybe we should mark them though once every normal edge connected there has been
       // marked
 
-      // make sure we dont ever look at this again
-      edge_t edge{tile_count_pair.first, tile->directededge(i)};
+      edge_t edge{tile_id, tile->directededge(i)};
       edge.i.set_id(i);
-      edge_set.set(tile_count_pair.second + i);
-      ++set;
 
       // these wont have opposing edges that we care about
       if (edge.e->use() == Use::kTransitConnection ||
           edge.e->IsTransitLine()) { // these 2 should never happen
+        tile_set_count += edge_set.set(tile_offset + i);
         continue;
       }
 
-      // get the opposing edge as well (ensure a valid edge is returned)
+      // make sure we dont ever look at this again, unless another thread beat us to it
       edge_t opposing_edge = opposing(reader, tile, edge);
+      if (!take(tile_set, edge_set, edge, opposing_edge)) {
+        continue;
+      }
+      tile_set_count += opposing_edge ? 2 : 1;
+
+      // get the opposing edge as well (ensure a valid edge is returned)
       if (opposing_edge.e == nullptr) {
         continue;
       }
-      edge_set.set(tile_set.find(opposing_edge.i.Tile_Base())->second + opposing_edge.i.id());
-      ++set;
 
       // shortcuts arent real and maybe we dont want ferries
       if (edge.e->is_shortcut() || (!ferries && edge.e->use() == Use::kFerry)) {
@@ -274,8 +449,9 @@ int main(int argc, char* argv[]) {
       }
 
       // no name no thanks
-      auto edge_info = tile->edgeinfo(edge.e->edgeinfo_offset());
-      auto names = edge_info.GetNames();
+      names_t names;
+      tile->edgeinfo(edge.e->edgeinfo_offset()).VisitNames(
+          [&names](boost::string_view name, bool) { names.push_back(name); });
       if (names.size() == 0 && !unnamed) {
         continue;
       }
@@ -291,59 +467,55 @@ int main(int argc, char* argv[]) {
       // so for now we'll just greedily export edges
 
       // keep some state about this section of road
-      std::list<edge_t> edges{edge};
+      auto& section = edges[thread];
+      section.assign(1, edge);
 
       // go forward
       auto t = tile;
-      while ((edge = next(tile_set, edge_set, reader, t, edge, names))) {
-        // mark them to never be used again
-        edge_set.set(tile_set.find(edge.i.Tile_Base())->second + edge.i.id());
-        edge_t other = opposing(reader, t, edge);
+      edge_t other;
+      while ((edge = next(tile_set, edge_set, reader, t, edge, names, other))) {
+        tile_set_count += other ? 2 : 1;
         if (other.e == nullptr) {
           continue;
         }
-        edge_set.set(tile_set.find(other.i.Tile_Base())->second + other.i.id());
-        set += 2;
         // keep this
-        edges.push_back(edge);
+        section.push_back(edge);
       }
 
       // go backward
       edge = opposing_edge;
-      while ((edge = next(tile_set, edge_set, reader, t, edge, names))) {
-        // mark them to never be used again
-        edge_set.set(tile_set.find(edge.i.Tile_Base())->second + edge.i.id());
-        edge_t other = opposing(reader, t, edge);
+      while ((edge = next(tile_set, edge_set, reader, t, edge, names, other))) {
+        tile_set_count += other ? 2 : 1;
         if (other.e == nullptr) {
           continue;
         }
-        edge_set.set(tile_set.find(other.i.Tile_Base())->second + other.i.id());
-        set += 2;
         // keep this
-        edges.push_front(other);
+        section.push_front(other);
       }
 
       // get the shape
-      std::list<PointLL> shape;
-      for (const auto& e : edges) {
-        extend(reader, t, e, shape);
+      auto& shape = shapes[thread];
+      shape.clear();
+      for (const auto& e : section) {
+        extend(reader, t, e, scratches[thread], shape);
       }
 
-      // output it as: shape,name,name,...
-      auto encoded = encode(shape);
-      std::cout << encoded << column_separator;
-      for (const auto& name : names) {
-        std::cout << name << (&name == &names.back() ? "" : column_separator);
+      // output it
+      write_row(shape, names, buffers[thread]);
+      if (buffers[thread].size() > kFlushBytes) {
+        flush(thread);
       }
-      std::cout << row_separator;
-      std::cout.flush();
     }
 
     // check progress
-    int procent = (100.f * set) / edge_count;
-    if (procent > progress) {
-      LOG_INFO(std::to_string(progress = procent) + "%");
+    int procent = (100.f * (set += tile_set_count)) / edge_count;
+    int seen = progress.load();
+    if (procent > seen && progress.compare_exchange_strong(seen, procent)) {
+      LOG_INFO(std::to_string(procent) + "%");
     }
+  });
+  for (size_t thread = 0; thread < concurrency; ++thread) {
+    flush(thread);
   }
   LOG_INFO("Done");
 
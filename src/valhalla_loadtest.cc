@@ -0,0 +1,382 @@
+#include "config.h"
+
+#include "baldr/curler.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "tyr/actor.h"
+#include "worker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace bpo = boost::program_options;
+using namespace valhalla;
+
+namespace {
+
+// the members of actor_t which answer a request
+using action_t = std::string (tyr::actor_t::*)(const std::string&,
+                                              const std::function<void()>*,
+                                              Api*);
+const std::unordered_map<std::string, action_t> kActions{
+    {"route", &tyr::actor_t::route},
+    {"locate", &tyr::actor_t::locate},
+    {"sources_to_targets", &tyr::actor_t::matrix},
+    {"optimized_route", &tyr::actor_t::optimized_route},
+    {"isochrone", &tyr::actor_t::isochrone},
+    {"trace_route", &tyr::actor_t::trace_route},
+    {"trace_attributes", &tyr::actor_t::trace_attributes},
+    {"height", &tyr::actor_t::height},
+    {"transit_available", &tyr::actor_t::transit_available},
+    {"expansion", &tyr::actor_t::expansion},
+    {"route_batch", &tyr::actor_t::route_batch},
+    {"recost", &tyr::actor_t::recost},
+};
+
+struct request_t {
+  std::string action;
+  std::string json;
+};
+
+struct sample_t {
+  double latency_ms;
+  double cpu_ms;
+  bool ok;
+};
+
+// the cpu time of the calling thread, 0 where there is no way to tell
+double thread_cpu_ms() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec * 1e3 + now.tv_nsec * 1e-6;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * A line is a json request, optionally after the name of its action and optionally in the form
+ * valhalla_run_route takes it, -j '{...}', as the files in test_requests are. Empty lines and lines
+ * starting with # are skipped
+ */
+bool parse_line(const std::string& line, const std::string& default_action, request_t& request) {
+  auto begin = line.find_first_not_of(" \t\r");
+  if (begin == std::string::npos || line[begin] == '#') {
+    return false;
+  }
+  auto rest = line.substr(begin);
+  request.action = default_action;
+  if (rest.front() != '{' && rest.front() != '-') {
+    auto space = rest.find_first_of(" \t");
+    request.action = rest.substr(0, space);
+    auto json = rest.find_first_not_of(" \t", space);
+    rest = json == std::string::npos ? "" : rest.substr(json);
+  }
+  if (rest.compare(0, 2, "-j") == 0) {
+    auto json = rest.find_first_not_of(" \t", 2);
+    rest = json == std::string::npos ? "" : rest.substr(json);
+  }
+  rest = rest.substr(0, rest.find_last_not_of(" \t\r") + 1);
+  if (rest.size() > 1 && rest.front() == '\'' && rest.back() == '\'') {
+    rest = rest.substr(1, rest.size() - 2);
+  }
+  if (rest.empty() || rest.front() != '{') {
+    return false;
+  }
+  request.json = std::move(rest);
+  return true;
+}
+
+std::string url_encode(const std::string& value) {
+  std::ostringstream encoded;
+  encoded << std::hex << std::uppercase;
+  for (unsigned char c : value) {
+    if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      encoded << c;
+    } else {
+      encoded << '%' << std::setw(2) << std::setfill('0') << static_cast<int>(c);
+    }
+  }
+  return encoded.str();
+}
+
+// the hits and misses of the tile caches of a service from what it serves at /metrics
+std::pair<uint64_t, uint64_t> scrape_tile_cache(const std::string& url) {
+  baldr::curler_t curler("valhalla_loadtest");
+  long http_code = 0;
+  auto bytes = curler(url + "/metrics", http_code, false, nullptr);
+  std::pair<uint64_t, uint64_t> lookups{0, 0};
+  std::istringstream metrics(std::string(bytes.begin(), bytes.end()));
+  std::string line;
+  while (std::getline(metrics, line)) {
+    if (line.compare(0, 33, "valhalla_tile_cache_lookups_total") != 0) {
+      continue;
+    }
+    auto count = std::stoull(line.substr(line.rfind(' ') + 1));
+    (line.find("result=\"hit\"") != std::string::npos ? lookups.first : lookups.second) += count;
+  }
+  return lookups;
+}
+
+// the nearest rank percentile of sorted values
+double percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto rank = static_cast<size_t>(std::ceil(p / 100. * sorted.size()));
+  return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  filesystem::path config_file_path;
+  std::string url;
+  std::string default_action = "route";
+  size_t concurrency =
+      std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+  double rate = 0;
+  size_t passes = 1;
+  std::vector<std::string> input_files;
+
+  bpo::options_description options(
+      "valhalla_loadtest " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_loadtest [options] <request_file> ...\n"
+      "\n"
+      "valhalla_loadtest replays the requests in the files, one per line, against actors in this "
+      "process or against a running service and reports the latency percentiles per action, the "
+      "cpu time per request and the hit rate of the tile caches. A line is a json request, "
+      "optionally after the name of its action and optionally in the -j '{...}' form of the files "
+      "in test_requests. Without a rate the requests are sent as fast as the threads can answer "
+      "them, with one they are sent on a fixed schedule and their latency counts from when they "
+      "were due, which includes the time they waited for a free thread."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")(
+      "version,v", "Print the version of this software.")(
+      "config,c", bpo::value<filesystem::path>(&config_file_path),
+      "Path to the json configuration file, the requests are answered in this process.")(
+      "url,u", bpo::value<std::string>(&url),
+      "Base url of a running service to send the requests to instead, e.g. http://localhost:8002")(
+      "action,a", bpo::value<std::string>(&default_action),
+      "Action of the lines which don't name one, defaults to route.")(
+      "concurrency,t", bpo::value<size_t>(&concurrency),
+      "How many requests are in flight at once, defaults to the number of cores.")(
+      "rate,r", bpo::value<double>(&rate),
+      "Requests per second to send, defaults to 0 which is as fast as they are answered.")(
+      "passes,p", bpo::value<size_t>(&passes), "How many times to replay the requests.")
+      // positional arguments
+      ("input_files", bpo::value<std::vector<std::string>>(&input_files)->multitoken());
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("input_files", -1);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(),
+               vm);
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_loadtest " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("config") == vm.count("url") || input_files.empty()) {
+    std::cerr << "Either <config> or <url> and at least one request file are mandatory\n\n";
+    std::cerr << options << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // read the requests
+  std::vector<request_t> requests;
+  for (const auto& file : input_files) {
+    std::ifstream stream(file);
+    if (!stream) {
+      std::cerr << "Unable to open " << file << "\n";
+      return EXIT_FAILURE;
+    }
+    std::string line;
+    request_t request;
+    while (std::getline(stream, line)) {
+      if (parse_line(line, default_action, request)) {
+        if (url.empty() && kActions.find(request.action) == kActions.cend()) {
+          std::cerr << "Unknown action " << request.action << " in " << file << "\n";
+          return EXIT_FAILURE;
+        }
+        requests.push_back(request);
+      }
+    }
+  }
+  if (requests.empty()) {
+    std::cerr << "There are no requests in the files\n";
+    return EXIT_FAILURE;
+  }
+
+  boost::property_tree::ptree config;
+  if (!url.empty()) {
+    while (!url.empty() && url.back() == '/') {
+      url.pop_back();
+    }
+  } else {
+    rapidjson::read_json(config_file_path.string(), config);
+    // the actors log what they do in the tyr section, that would drown out the report
+    valhalla::midgard::logging::Configure({{"type", ""}});
+  }
+
+  // every thread answers requests until there are none left
+  const size_t total = requests.size() * passes;
+  std::vector<sample_t> samples(total);
+  std::atomic<size_t> next(0);
+  std::vector<baldr::TileCache::Stats> tile_caches(concurrency, baldr::TileCache::Stats{});
+  const auto start = std::chrono::steady_clock::now();
+  auto work = [&](size_t thread) {
+    std::unique_ptr<baldr::GraphReader> reader;
+    std::unique_ptr<tyr::actor_t> actor;
+    std::unique_ptr<baldr::curler_t> curler;
+    if (url.empty()) {
+      reader.reset(new baldr::GraphReader(config.get_child("mjolnir")));
+      actor.reset(new tyr::actor_t(config, *reader, true));
+    } else {
+      curler.reset(new baldr::curler_t("valhalla_loadtest"));
+    }
+
+    size_t i;
+    while ((i = next.fetch_add(1)) < total) {
+      const auto& request = requests[i % requests.size()];
+      // on a schedule the time spent waiting for this thread counts as well
+      auto due = std::chrono::steady_clock::now();
+      if (rate > 0) {
+        due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                          std::chrono::duration<double>(i / rate));
+        std::this_thread::sleep_until(due);
+      }
+      const auto cpu = thread_cpu_ms();
+      bool ok = true;
+      if (actor) {
+        try {
+          ((*actor).*kActions.find(request.action)->second)(request.json, nullptr, nullptr);
+        } catch (...) {
+          actor->cleanup();
+          ok = false;
+        }
+      } else {
+        long http_code = 0;
+        try {
+          (*curler)(url + "/" + request.action + "?json=" + url_encode(request.json), http_code,
+                    false, nullptr);
+        } catch (...) {}
+        ok = http_code == 200;
+      }
+      samples[i] = sample_t{std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - due)
+                                .count(),
+                            thread_cpu_ms() - cpu, ok};
+    }
+    if (reader) {
+      tile_caches[thread] = reader->GetCacheStats();
+    }
+  };
+
+  const auto service_before =
+      url.empty() ? std::pair<uint64_t, uint64_t>{0, 0} : scrape_tile_cache(url);
+  std::vector<std::thread> threads;
+  for (size_t thread = 1; thread < concurrency; ++thread) {
+    threads.emplace_back(work, thread);
+  }
+  work(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // the latencies of each action and of all of them
+  std::map<std::string, std::vector<double>> latencies;
+  std::map<std::string, double> cpu;
+  std::map<std::string, size_t> failures;
+  for (size_t i = 0; i < total; ++i) {
+    const auto& action = requests[i % requests.size()].action;
+    for (const auto& key : {action, std::string("all")}) {
+      latencies[key].push_back(samples[i].latency_ms);
+      cpu[key] += samples[i].cpu_ms;
+      failures[key] += !samples[i].ok;
+    }
+  }
+
+  std::cout << std::fixed << std::setprecision(2) << total << " requests in " << seconds << "s, "
+            << total / seconds << " per second with a concurrency of " << concurrency << "\n\n";
+  std::cout << std::left << std::setw(20) << "action" << std::right << std::setw(9) << "count"
+            << std::setw(9) << "failed" << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms"
+            << std::setw(10) << "p99 ms" << std::setw(10) << "p999 ms" << std::setw(10) << "max ms";
+  if (url.empty()) {
+    std::cout << std::setw(12) << "cpu ms/req";
+  }
+  std::cout << "\n";
+  for (auto& action : latencies) {
+    auto& sorted = action.second;
+    std::sort(sorted.begin(), sorted.end());
+    std::cout << std::left << std::setw(20) << action.first << std::right << std::setw(9)
+              << sorted.size() << std::setw(9) << failures[action.first] << std::setw(10)
+              << percentile(sorted, 50) << std::setw(10) << percentile(sorted, 90) << std::setw(10)
+              << percentile(sorted, 99) << std::setw(10) << percentile(sorted, 99.9)
+              << std::setw(10) << sorted.back();
+    if (url.empty()) {
+      std::cout << std::setw(12) << cpu[action.first] / sorted.size();
+    }
+    std::cout << "\n";
+  }
+
+  // a shared cache is counted once, otherwise every thread had its own
+  std::pair<uint64_t, uint64_t> lookups{0, 0};
+  if (url.empty()) {
+    const bool shared = config.get<bool>("mjolnir.global_synchronized_cache", false);
+    for (size_t thread = 0; thread < (shared ? 1 : concurrency); ++thread) {
+      lookups.first += tile_caches[thread].hits;
+      lookups.second += tile_caches[thread].misses;
+    }
+  } else {
+    auto service_after = scrape_tile_cache(url);
+    lookups.first = service_after.first - service_before.first;
+    lookups.second = service_after.second - service_before.second;
+  }
+  const auto lookup_count = lookups.first + lookups.second;
+  std::cout << "\ntile cache: " << lookups.first << " hits, " << lookups.second << " misses";
+  if (lookup_count) {
+    std::cout << ", " << 100. * lookups.first / lookup_count << "% hit rate";
+  }
+  std::cout << "\n";
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <regex>
+#include <string>
+
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "skadi/sample.h"
+
+// Converts the raw or gzipped hgt tiles of a directory to the blocked format of skadi, whose
+// blocks are compressed one by one so that sampling unzips only the small blocks it needs
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " HGT_DIR BLOCKED_DIR" << std::endl
+              << "Writes every NxxWyyy.hgt and NxxWyyy.hgt.gz in HGT_DIR to "
+                 "BLOCKED_DIR/Nxx/NxxWyyy.hgt.blk"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string hgt_dir(argv[1]), blocked_dir(argv[2]);
+
+  std::list<std::string> files;
+  if (filesystem::exists(hgt_dir) && filesystem::is_directory(hgt_dir)) {
+    for (filesystem::recursive_directory_iterator i(hgt_dir), end; i != end; ++i) {
+      if (i->is_regular_file() || i->is_symlink()) {
+        files.push_back(i->path().string());
+      }
+    }
+  }
+
+  size_t packed = 0, failed = 0;
+  const std::regex hgt(".*/(([NS][0-9]{2})[WE][0-9]{3}\\.hgt)(\\.gz)?$");
+  for (const auto& file : files) {
+    std::smatch m;
+    if (!std::regex_search(file, m, hgt)) {
+      continue;
+    }
+    const auto dir = blocked_dir + filesystem::path::preferred_separator + m[2].str();
+    filesystem::create_directories(dir);
+    const auto blocked = dir + filesystem::path::preferred_separator + m[1].str() + ".blk";
+    if (valhalla::skadi::sample::pack(file, blocked)) {
+      ++packed;
+    } else {
+      LOG_ERROR("Could not pack " + file);
+      ++failed;
+    }
+  }
+
+  LOG_INFO("Packed " + std::to_string(packed) + " elevation tiles, " + std::to_string(failed) +
+           " failed");
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
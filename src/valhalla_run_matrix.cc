@@ -5,9 +5,12 @@
 #include <boost/property_tree/ptree.hpp>
 #include <cmath>
 #include <cstdint>
+#include <chrono>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "config.h"
@@ -22,6 +25,8 @@
 #include "thor/costmatrix.h"
 #include "thor/optimizer.h"
 #include "thor/timedistancematrix.h"
+#include "tyr/actor.h"
+#include "tyr/batch.h"
 #include "worker.h"
 
 using namespace valhalla;
@@ -83,6 +88,41 @@ void LogResults(const bool optimize,
   }
 }
 
+// Answers a file of requests with the service pipeline on a thread per core
+int RunBatch(const std::string& config,
+             const std::string& batch_file,
+             const std::string& output,
+             const size_t concurrency,
+             valhalla::tyr::batch_action_t action) {
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(config.c_str(), pt);
+  std::ifstream input(batch_file);
+  if (!input) {
+    std::cerr << "Unable to open " << batch_file << "\n";
+    return EXIT_FAILURE;
+  }
+  std::ofstream file;
+  if (!output.empty()) {
+    file.open(output);
+    if (!file) {
+      std::cerr << "Unable to open " << output << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // the results may be going to stdout so the actors log elsewhere
+  valhalla::midgard::logging::Configure({{"type", "std_err"}});
+  const auto start = std::chrono::steady_clock::now();
+  const auto failed =
+      valhalla::tyr::run_batch(pt, action, input, output.empty() ? std::cout : file, concurrency);
+  const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  LOG_INFO("Batch took " + std::to_string(ms) + " ms with " + std::to_string(failed) +
+           " failed requests");
+  return EXIT_SUCCESS;
+}
+
 // Main method for testing time and distance matrix methods
 int main(int argc, char* argv[]) {
   bpo::options_description poptions(
@@ -98,6 +138,9 @@ int main(int argc, char* argv[]) {
 
   std::string json, config;
   uint32_t iterations = 1;
+  std::string batch_file, output;
+  size_t concurrency =
+      std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
   poptions.add_options()("help,h", "Print this help message.")("version,v",
                                                                "Print the version of this software.")(
       // TODO - update example
@@ -111,7 +154,15 @@ int main(int argc, char* argv[]) {
       "York\",\"state\":\"NY\",\"postal_code\":\"10017-3507\",\"country\":\"US\"}],\"costing\":"
       "\"auto\",\"directions_options\":{\"units\":\"miles\"}}'")(
       "multi-run", bpo::value<uint32_t>(&iterations),
-      "Generate the route N additional times before exiting.")
+      "Generate the route N additional times before exiting.")(
+      "batch-file", bpo::value<std::string>(&batch_file),
+      "File of requests, one json request per line, to answer with the whole service pipeline "
+      "instead of the -j request. A line of json with the line number, time and response or error "
+      "of every request is written as soon as it is answered.")(
+      "concurrency", bpo::value<size_t>(&concurrency),
+      "How many threads answer the requests of the batch file, defaults to the number of cores.")(
+      "output", bpo::value<std::string>(&output),
+      "Where the results of the batch file go, defaults to the standard output.")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file");
 
@@ -137,6 +188,10 @@ int main(int argc, char* argv[]) {
     return EXIT_SUCCESS;
   }
 
+  if (vm.count("batch-file")) {
+    return RunBatch(config, batch_file, output, concurrency, &valhalla::tyr::actor_t::matrix);
+  }
+
   Api request;
   ParseApi(json, valhalla::Options::sources_to_targets, request);
   const auto& options = request.options();
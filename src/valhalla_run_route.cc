@@ -9,6 +9,7 @@
 #include <iostream>
 #include <queue>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -32,6 +33,8 @@
 #include "thor/route_matcher.h"
 #include "thor/timedep.h"
 #include "thor/triplegbuilder.h"
+#include "tyr/actor.h"
+#include "tyr/batch.h"
 #include "worker.h"
 
 #include "proto/api.pb.h"
@@ -512,6 +515,41 @@ valhalla::DirectionsLeg DirectionsTest(valhalla::Api& api,
   return trip_directions;
 }
 
+// Answers a file of requests with the service pipeline on a thread per core
+int RunBatch(const std::string& config,
+             const std::string& batch_file,
+             const std::string& output,
+             const size_t concurrency,
+             valhalla::tyr::batch_action_t action) {
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(config.c_str(), pt);
+  std::ifstream input(batch_file);
+  if (!input) {
+    std::cerr << "Unable to open " << batch_file << "\n";
+    return EXIT_FAILURE;
+  }
+  std::ofstream file;
+  if (!output.empty()) {
+    file.open(output);
+    if (!file) {
+      std::cerr << "Unable to open " << output << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // the results may be going to stdout so the actors log elsewhere
+  valhalla::midgard::logging::Configure({{"type", "std_err"}});
+  const auto start = std::chrono::steady_clock::now();
+  const auto failed =
+      valhalla::tyr::run_batch(pt, action, input, output.empty() ? std::cout : file, concurrency);
+  const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  LOG_INFO("Batch took " + std::to_string(ms) + " ms with " + std::to_string(failed) +
+           " failed requests");
+  return EXIT_SUCCESS;
+}
+
 // Main method for testing a single path
 int main(int argc, char* argv[]) {
   bpo::options_description poptions(
@@ -530,6 +568,9 @@ int main(int argc, char* argv[]) {
   bool match_test = false;
   bool verbose_lanes = false;
   uint32_t iterations;
+  std::string batch_file, output;
+  size_t concurrency =
+      std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
 
   poptions.add_options()("help,h", "Print this help message.")("version,v",
                                                                "Print the version of this software.")(
@@ -547,7 +588,15 @@ int main(int argc, char* argv[]) {
       "multi-run", bpo::value<uint32_t>(&iterations),
       "Generate the route N additional times before exiting.")(
       "verbose-lanes", bpo::bool_switch(&verbose_lanes),
-      "Include verbose lanes output in DirectionsTest.")
+      "Include verbose lanes output in DirectionsTest.")(
+      "batch-file", bpo::value<std::string>(&batch_file),
+      "File of requests, one json request per line, to answer with the whole service pipeline "
+      "instead of the -j request. A line of json with the line number, time and response or error "
+      "of every request is written as soon as it is answered.")(
+      "concurrency", bpo::value<size_t>(&concurrency),
+      "How many threads answer the requests of the batch file, defaults to the number of cores.")(
+      "output", bpo::value<std::string>(&output),
+      "Where the results of the batch file go, defaults to the standard output.")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file");
 
@@ -575,6 +624,10 @@ int main(int argc, char* argv[]) {
     return EXIT_SUCCESS;
   }
 
+  if (vm.count("batch-file")) {
+    return RunBatch(config, batch_file, output, concurrency, &valhalla::tyr::actor_t::route);
+  }
+
   if (vm.count("match-test")) {
     match_test = true;
   }
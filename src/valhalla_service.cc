@@ -18,8 +18,13 @@
 #include <prime_server/http_protocol.hpp>
 #include <prime_server/prime_server.hpp>
 using namespace prime_server;
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
 #endif
 
+#include "baldr/graphreader.h"
 #include "midgard/logging.h"
 
 #include "loki/worker.h"
@@ -114,6 +119,12 @@ int main(int argc, char** argv) {
         case valhalla::Options::expansion:
           std::cout << actor.expansion(request_str, nullptr, &request) << std::endl;
           break;
+        case valhalla::Options::route_batch:
+          std::cout << actor.route_batch(request_str, nullptr, &request) << std::endl;
+          break;
+        case valhalla::Options::recost:
+          std::cout << actor.recost(request_str, nullptr, &request) << std::endl;
+          break;
         default:
           std::cerr << "Unknown action" << std::endl;
           return 1;
@@ -173,12 +184,48 @@ int main(int argc, char** argv) {
     worker_concurrency = std::stoul(argv[2]);
   }
 
+#ifndef _WIN32
+  // a SIGHUP loads the tiles at the configured paths again, eg after a new build was renamed over
+  // the old one. the workers switch to them between requests, the threads started from here on
+  // leave the signal to the one waiting for it
+  sigset_t hangup;
+  sigemptyset(&hangup);
+  sigaddset(&hangup, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &hangup, nullptr);
+  std::thread([hangup, mjolnir = config.get_child("mjolnir")]() {
+    for (int signal; sigwait(&hangup, &signal) == 0;) {
+      LOG_INFO("Reloading the tileset");
+      try {
+        valhalla::baldr::GraphReader::ReloadTileset(mjolnir);
+      } catch (const std::exception& e) {
+        LOG_ERROR("Failed to reload the tileset: " + std::string(e.what()));
+      }
+    }
+  }).detach();
+#endif
+
   // setup the cluster within this process
   zmq::context_t context;
   std::thread server_thread =
       std::thread(std::bind(&http_server_t::serve, http_server_t(context, listen, loki_proxy + "_in",
                                                                  loopback, interrupt, true)));
 
+  // one stage that answers the whole request in the thread that picked it up
+  if (config.get<bool>("httpd.service.single_stage", false)) {
+    // every thread has its own reader but they all share their tiles
+    config.put("mjolnir.global_synchronized_cache", true);
+    std::thread proxy_thread(
+        std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
+    proxy_thread.detach();
+    std::list<std::thread> worker_threads;
+    for (size_t i = 0; i < worker_concurrency; ++i) {
+      worker_threads.emplace_back(valhalla::tyr::run_service, config);
+      worker_threads.back().detach();
+    }
+    server_thread.join();
+    return 0;
+  }
+
   // loki layer
   std::thread loki_proxy_thread(
       std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
@@ -0,0 +1,118 @@
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/util.h"
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <string>
+
+#include "config.h"
+
+namespace bpo = boost::program_options;
+namespace bpt = boost::property_tree;
+
+int main(int argc, char** argv) {
+  std::string bbox, levels;
+  std::string inline_config;
+  std::string config_file_path;
+  size_t threads = 0;
+
+  bpo::options_description options("valhalla_warm_tiles " VALHALLA_VERSION "\n"
+                                   "\n"
+                                   " Usage: valhalla_warm_tiles [options]\n"
+                                   "\n"
+                                   "Reads the tiles of the tile_extract or tile_dir into the page "
+                                   "cache so that services started afterwards on the same host "
+                                   "dont have to wait on the disk for their first requests."
+                                   "\n"
+                                   "\n");
+
+  auto adder = options.add_options();
+  adder("help,h", "Print this help message.");
+  adder("version,v", "Print the version of this software.");
+  adder("config,c", bpo::value<std::string>(&config_file_path),
+        "Path to the json configuration file.");
+  adder("inline-config,i", bpo::value<std::string>(&inline_config), "Inline json config.");
+  adder("bounding-box,b", bpo::value<std::string>(&bbox),
+        "Only warm up the tiles in this bounding box, min_x,min_y,max_x,max_y. Overrides "
+        "mjolnir.warm_up_bbox.");
+  adder("levels,l", bpo::value<std::string>(&levels),
+        "Only warm up these comma separated levels. Overrides mjolnir.warm_up_levels.");
+  adder("concurrency,j", bpo::value<size_t>(&threads),
+        "Number of threads to use. Overrides mjolnir.warm_up_threads.");
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_warm_tiles " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  // Read the config file
+  boost::property_tree::ptree pt;
+  if (vm.count("inline-config")) {
+    std::stringstream ss;
+    ss << inline_config;
+    rapidjson::read_json(ss, pt);
+  } else if (vm.count("config") && filesystem::exists(config_file_path)) {
+    rapidjson::read_json(config_file_path, pt);
+  } else {
+    std::cerr << "Configuration is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree =
+      pt.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  // the command line wins over the config
+  auto& mjolnir = pt.get_child("mjolnir");
+  if (vm.count("bounding-box")) {
+    mjolnir.put("warm_up_bbox", bbox);
+  }
+  if (vm.count("levels")) {
+    bpt::ptree level_list;
+    std::stringstream ss(levels);
+    for (std::string level; std::getline(ss, level, ',');) {
+      bpt::ptree entry;
+      entry.put_value(level);
+      level_list.push_back(std::make_pair("", entry));
+    }
+    mjolnir.put_child("warm_up_levels", level_list);
+  }
+  if (vm.count("concurrency")) {
+    mjolnir.put("warm_up_threads", threads);
+  }
+
+  // only the page cache outlives this process so there is no point in building anything else
+  mjolnir.put("warm_up", false);
+  mjolnir.put("shortcut_caching", false);
+  mjolnir.erase("incident_log");
+  mjolnir.erase("incident_dir");
+  valhalla::baldr::GraphReader reader(mjolnir);
+  auto warmed = reader.WarmUp(mjolnir);
+
+  std::cout << "Warmed up " << warmed << " tiles" << std::endl;
+  return EXIT_SUCCESS;
+}
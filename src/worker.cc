@@ -1,10 +1,17 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <unordered_map>
 
+#include "baldr/compression_utils.h"
 #include "baldr/datetime.h"
 #include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
 #include "baldr/location.h"
+#include "metrics.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
@@ -90,7 +97,7 @@ const std::unordered_map<unsigned, std::string> HTTP_STATUS_CODES{
 const std::unordered_map<unsigned, unsigned> ERROR_TO_STATUS{
     {100, 400}, {101, 405}, {106, 404}, {107, 501},
 
-    {110, 400}, {111, 400}, {112, 400}, {113, 400}, {114, 400},
+    {110, 400}, {111, 400}, {112, 400}, {113, 400}, {114, 400}, {115, 400}, {116, 400},
 
     {120, 400}, {121, 400}, {122, 400}, {123, 400}, {124, 400}, {125, 400}, {126, 400}, {127, 400},
 
@@ -103,7 +110,7 @@ const std::unordered_map<unsigned, unsigned> ERROR_TO_STATUS{
 
     {160, 400}, {161, 400}, {162, 400}, {163, 400}, {164, 400}, {165, 400}, {166, 400}, {167, 400},
 
-    {170, 400}, {171, 400}, {172, 400},
+    {170, 400}, {171, 400}, {172, 400}, {173, 503}, {174, 504},
 
     {199, 400},
 
@@ -127,9 +134,9 @@ const std::unordered_map<unsigned, unsigned> ERROR_TO_STATUS{
 
     {420, 400}, {421, 400}, {422, 400}, {423, 400}, {424, 400},
 
-    {430, 400},
+    {430, 400}, {431, 400},
 
-    {440, 400}, {441, 400}, {442, 400}, {443, 400}, {444, 400}, {445, 400},
+    {440, 400}, {441, 400}, {442, 400}, {443, 400}, {444, 400}, {445, 400}, {446, 400},
 
     {499, 400},
 
@@ -149,6 +156,8 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
     {112, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
     {113, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
     {114, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
+    {115, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
+    {116, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
 
     {120, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
     {121, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
@@ -267,6 +276,7 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
 
     {430, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
+    {431, R"({"code":"NoRoute","message":"Impossible route between points"})"},
 
     {440, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
     {441, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
@@ -276,6 +286,7 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
     {444,
      R"({"code":"NoSegment","message":"One of the supplied input coordinates could not snap to street segment."})"},
     {445, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
+    {446, R"({"code":"NoRoute","message":"Impossible route between points"})"},
 
     {499, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
 
@@ -288,7 +299,7 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
 
 rapidjson::Document from_string(const std::string& json, const valhalla_exception_t& e) {
   rapidjson::Document d;
-  d.Parse(json.c_str());
+  d.Parse(json.c_str(), json.size());
   if (d.HasParseError()) {
     throw e;
   }
@@ -296,7 +307,19 @@ rapidjson::Document from_string(const std::string& json, const valhalla_exceptio
 }
 
 void add_date_to_locations(Options& options,
-                           google::protobuf::RepeatedPtrField<valhalla::Location>& locations) {
+                           google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                           const std::string& node = "") {
+  // every source of a matrix departs at the time, every target arrives at it
+  if (options.has_date_time() && options.action() == Options::sources_to_targets &&
+      (node == "sources" || node == "targets")) {
+    const bool arrive_by = options.date_time_type() == Options::arrive_by;
+    if (options.date_time_type() == Options::invariant || (node == "targets") == arrive_by) {
+      for (auto& loc : locations)
+        loc.set_date_time(options.date_time());
+    }
+    return;
+  }
+
   // otherwise we do what the person was asking for
   if (options.has_date_time() && !locations.empty()) {
     switch (options.date_time_type()) {
@@ -337,6 +360,8 @@ void parse_locations(const rapidjson::Document& doc,
     locations = options.mutable_targets();
   } else if (node == "avoid_locations") {
     locations = options.mutable_avoid_locations();
+  } else if (node.compare(0, 7, "routes/") == 0) {
+    locations = options.add_batch()->mutable_locations();
   } else {
     return;
   }
@@ -546,7 +571,7 @@ void parse_locations(const rapidjson::Document& doc,
 
     // push the date time information down into the locations
     if (!had_date_time) {
-      add_date_to_locations(options, *locations);
+      add_date_to_locations(options, *locations, node);
     }
 
     // If any of the locations had search_filter.exclude_closures set to false,
@@ -613,7 +638,13 @@ void from_json(rapidjson::Document& doc, Options& options) {
 
   auto fmt = rapidjson::get_optional<std::string>(doc, "/format");
   Options::Format format;
-  if (fmt && Options_Format_Enum_Parse(*fmt, &format)) {
+  // only the matrix and the actions which make trips have a binary response, the others stick
+  // with the default. the routes of a batch are put in one json array so they must be json too
+  if (fmt && Options_Format_Enum_Parse(*fmt, &format) &&
+      (format != Options::pbf || options.action() == Options::sources_to_targets ||
+       options.action() == Options::route || options.action() == Options::optimized_route ||
+       options.action() == Options::trace_route || options.action() == Options::trace_attributes) &&
+      (options.action() != Options::route_batch || format != Options::gpx)) {
     options.set_format(format);
   }
 
@@ -622,6 +653,12 @@ void from_json(rapidjson::Document& doc, Options& options) {
     options.set_id(*id);
   }
 
+  // how long the client is willing to wait
+  auto deadline = rapidjson::get_optional<unsigned int>(doc, "/deadline");
+  if (deadline) {
+    options.set_deadline(*deadline);
+  }
+
   auto jsonp = rapidjson::get_optional<std::string>(doc, "/jsonp");
   if (jsonp) {
     options.set_jsonp(*jsonp);
@@ -893,8 +930,44 @@ void from_json(rapidjson::Document& doc, Options& options) {
   // get the avoids in there
   parse_locations(doc, options, "avoid_locations", 133, ignore_closures);
 
+  // get the locations of each of the routes of a batch in there
+  if (options.action() == Options::route_batch) {
+    auto routes = rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/routes");
+    for (rapidjson::SizeType i = 0; routes && i < routes->Size(); ++i) {
+      parse_locations(doc, options, "routes/" + std::to_string(i) + "/locations", 130,
+                      ignore_closures);
+    }
+  }
+
+  // get the edges of a path to recost in there, just their ids or with when they were entered
+  if (options.action() == Options::recost) {
+    auto edges = rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/edges");
+    for (rapidjson::SizeType i = 0; edges && i < edges->Size(); ++i) {
+      const auto& edge = (*edges)[i];
+      auto* recost_edge = options.add_recost_edges();
+      if (edge.IsUint64()) {
+        recost_edge->set_id(edge.GetUint64());
+        continue;
+      }
+      boost::optional<uint64_t> id;
+      if (edge.IsObject()) {
+        id = rapidjson::get_optional<uint64_t>(edge, "/id");
+      }
+      if (!id) {
+        throw valhalla_exception_t{116};
+      }
+      recost_edge->set_id(*id);
+      auto time = rapidjson::get_optional<double>(edge, "/time");
+      if (time) {
+        recost_edge->set_time(*time);
+      }
+    }
+  }
+
   // if not a time dependent route/mapmatch disable time dependent edge speed/flow data sources
-  if (!options.has_date_time_type() && (options.shape_size() == 0 || options.shape(0).time() == -1)) {
+  if (!options.has_date_time_type() &&
+      (options.shape_size() == 0 || options.shape(0).time() == -1) &&
+      (options.recost_edges_size() == 0 || options.recost_edges(0).time() == -1)) {
     for (auto& costing : *options.mutable_costing_options()) {
       costing.set_flow_mask(
           static_cast<uint8_t>(costing.flow_mask()) &
@@ -935,6 +1008,56 @@ void from_json(rapidjson::Document& doc, Options& options) {
     options.set_show_locations(*show_locations);
   }
 
+  // if specified, get the per_location boolean in there
+  auto per_location = rapidjson::get_optional<bool>(doc, "/per_location");
+  if (per_location) {
+    options.set_per_location(*per_location);
+  }
+
+  // if specified, get the network boolean in there
+  auto network = rapidjson::get_optional<bool>(doc, "/network");
+  if (network) {
+    options.set_network(*network);
+  }
+
+  // if specified, get the isochrone directions in there
+  auto reverse = rapidjson::get_optional<bool>(doc, "/reverse");
+  if (reverse) {
+    options.set_reverse(*reverse);
+  }
+  auto both_directions = rapidjson::get_optional<bool>(doc, "/both_directions");
+  if (both_directions) {
+    options.set_both_directions(*both_directions);
+  }
+
+  // if specified, whether the hierarchy limits follow the distance between the locations
+  auto adaptive_hierarchy_limits = rapidjson::get_optional<bool>(doc, "/adaptive_hierarchy_limits");
+  if (adaptive_hierarchy_limits) {
+    options.set_adaptive_hierarchy_limits(*adaptive_hierarchy_limits);
+  }
+
+  // if specified, get the compact boolean in there
+  auto compact = rapidjson::get_optional<bool>(doc, "/compact");
+  if (compact) {
+    options.set_compact(*compact);
+  }
+
+  // if specified, only the nearest targets of each source or the pairs within a cutoff are found
+  auto k_nearest = rapidjson::get_optional<uint32_t>(doc, "/k_nearest");
+  if (k_nearest) {
+    options.set_k_nearest(*k_nearest);
+  }
+  auto cost_cutoff = rapidjson::get_optional<float>(doc, "/cost_cutoff");
+  if (cost_cutoff) {
+    options.set_cost_cutoff(std::max(*cost_cutoff, 0.f));
+  }
+
+  // if specified, an expansion shows every so many edges to keep to at most these many
+  auto expansion_max_edges = rapidjson::get_optional<uint32_t>(doc, "/expansion_max_edges");
+  if (expansion_max_edges) {
+    options.set_expansion_max_edges(*expansion_max_edges);
+  }
+
   // if specified, get the shape_match in there
   auto shape_match_str = rapidjson::get_optional<std::string>(doc, "/shape_match");
   ShapeMatch shape_match;
@@ -984,6 +1107,13 @@ void from_json(rapidjson::Document& doc, Options& options) {
     options.set_interpolation_distance(*interpolation_distance);
   }
 
+  // if specified, get the adaptive_interpolation value in there
+  auto adaptive_interpolation =
+      rapidjson::get_optional<bool>(doc, "/trace_options/adaptive_interpolation");
+  if (adaptive_interpolation) {
+    options.set_adaptive_interpolation(*adaptive_interpolation);
+  }
+
   // if specified, get the filter_action value in there
   auto filter_action_str = rapidjson::get_optional<std::string>(doc, "/filters/action");
   FilterAction filter_action;
@@ -1018,6 +1148,13 @@ void from_json(rapidjson::Document& doc, Options& options) {
     options.set_roundabout_exits(*roundabout_exits);
   }
 
+  // whether to form the verbal instructions, by default only where they are serialized
+  auto verbal_instructions = rapidjson::get_optional<bool>(doc, "/verbal_instructions");
+  options.set_verbal_instructions(options.format() != Options::osrm);
+  if (verbal_instructions) {
+    options.set_verbal_instructions(*verbal_instructions);
+  }
+
   // force these into the output so its obvious what we did to the user
   doc.AddMember({"language", allocator}, {options.language(), allocator}, allocator);
   doc.AddMember({"format", allocator},
@@ -1046,6 +1183,23 @@ void ParseApi(const std::string& request, Options::Action action, valhalla::Api&
   from_json(document, *api.mutable_options());
 }
 
+std::function<void()> with_deadline(const std::function<void()>* interrupt, const Api& request) {
+  std::function<void()> wrapped = interrupt ? *interrupt : [] {};
+  if (!request.info().has_deadline()) {
+    return wrapped;
+  }
+  auto deadline = request.info().deadline();
+  return [wrapped, deadline]() {
+    wrapped();
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    if (static_cast<uint64_t>(now) > deadline) {
+      throw valhalla_exception_t{174};
+    }
+  };
+}
+
 std::string jsonify_error(const valhalla_exception_t& exception, const Api& request) {
   // get the http status
   std::stringstream body;
@@ -1073,6 +1227,82 @@ std::string jsonify_error(const valhalla_exception_t& exception, const Api& requ
 }
 
 #ifdef HAVE_HTTP
+namespace {
+
+// Responses smaller than this go out as they are, compressing them would save next to nothing
+constexpr size_t kMinCompressedSize = 1024;
+// How much of the response is handed to zlib at a time
+constexpr size_t kCompressionChunkSize = 64 * 1024;
+
+// Picks the encoding the response will be compressed with from the codings the client accepts,
+// gzip over deflate, skipping those with a quality of 0
+Info::ContentEncoding negotiate_encoding(const http_request_t& request) {
+  auto header = request.headers.find("Accept-Encoding");
+  if (header == request.headers.cend()) {
+    return Info::identity;
+  }
+  bool gzip = false, deflate = false;
+  std::stringstream codings(header->second);
+  std::string coding;
+  while (std::getline(codings, coding, ',')) {
+    auto parameters = coding.find(';');
+    if (parameters != std::string::npos) {
+      auto quality = coding.find("q=", parameters);
+      if (quality != std::string::npos && std::strtod(coding.c_str() + quality + 2, nullptr) <= 0) {
+        continue;
+      }
+      coding.erase(parameters);
+    }
+    coding.erase(0, coding.find_first_not_of(" \t"));
+    coding.erase(coding.find_last_not_of(" \t") + 1);
+    std::transform(coding.begin(), coding.end(), coding.begin(), ::tolower);
+    gzip = gzip || coding == "gzip" || coding == "x-gzip" || coding == "*";
+    deflate = deflate || coding == "deflate";
+  }
+  return gzip ? Info::gzip : (deflate ? Info::deflate : Info::identity);
+}
+
+// Makes the successful response, compressing the body in chunks with the encoding the request
+// negotiated when it is big enough to be worth it
+http_response_t make_response(const std::string& body, headers_t headers, const Api& request) {
+  headers.insert({"Vary", "Accept-Encoding"});
+  auto encoding = request.info().content_encoding();
+  if (encoding == Info::identity || body.size() < kMinCompressedSize) {
+    return http_response_t(200, "OK", body, headers);
+  }
+
+  std::string compressed;
+  compressed.reserve(body.size() / 4);
+  size_t offset = 0;
+  auto src_func = [&body, &offset](z_stream& s) -> int {
+    auto size = std::min(kCompressionChunkSize, body.size() - offset);
+    s.next_in = static_cast<Byte*>(static_cast<void*>(const_cast<char*>(body.data() + offset)));
+    s.avail_in = static_cast<unsigned int>(size);
+    offset += size;
+    return offset == body.size() ? Z_FINISH : Z_NO_FLUSH;
+  };
+  auto dst_func = [&compressed](z_stream& s) {
+    // if the whole buffer wasn't used we are done
+    auto size = compressed.size();
+    if (s.total_out < size) {
+      compressed.resize(s.total_out);
+    } // we need more space
+    else {
+      compressed.resize(size + kCompressionChunkSize);
+      s.next_out = static_cast<Byte*>(static_cast<void*>(&compressed[size]));
+      s.avail_out = static_cast<unsigned int>(kCompressionChunkSize);
+    }
+  };
+  if (!baldr::deflate(src_func, dst_func, Z_DEFAULT_COMPRESSION, encoding == Info::gzip)) {
+    LOG_WARN("Could not compress the response, sending it as it is");
+    return http_response_t(200, "OK", body, headers);
+  }
+  headers.insert({"Content-Encoding", encoding == Info::gzip ? "gzip" : "deflate"});
+  return http_response_t(200, "OK", compressed, headers);
+}
+
+} // namespace
+
 void ParseApi(const http_request_t& request, valhalla::Api& api) {
   api.Clear();
 
@@ -1089,7 +1319,7 @@ void ParseApi(const http_request_t& request, valhalla::Api& api) {
     document.Parse(json->second.front().c_str());
     // no json parameter, check the body
   } else if (!request.body.empty()) {
-    document.Parse(request.body.c_str());
+    document.Parse(request.body.c_str(), request.body.size());
     // no json at all
   } else {
     document.SetObject();
@@ -1120,6 +1350,9 @@ void ParseApi(const http_request_t& request, valhalla::Api& api) {
     document.AddMember({kv.first, allocator}, array, allocator);
   }
 
+  // how the client wants the response compressed
+  api.mutable_info()->set_content_encoding(negotiate_encoding(request));
+
   auto& options = *api.mutable_options();
 
   // set the action
@@ -1145,6 +1378,7 @@ worker_t::result_t jsonify_error(const valhalla_exception_t& exception,
                                                                          : worker::JSON_MIME});
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
+  metrics_t::get().record(request, exception.http_code);
 
   return result;
 }
@@ -1163,11 +1397,13 @@ worker_t::result_t to_response(const baldr::json::ArrayPtr& array,
   }
 
   worker_t::result_t result{false, std::list<std::string>(), ""};
-  http_response_t response(200, "OK", stream.str(),
-                           headers_t{CORS, request.options().has_jsonp() ? worker::JS_MIME
-                                                                         : worker::JSON_MIME});
+  auto response = make_response(stream.str(),
+                                headers_t{CORS, request.options().has_jsonp() ? worker::JS_MIME
+                                                                              : worker::JSON_MIME},
+                                request);
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
+  metrics_t::get().record(request, 200);
   return result;
 }
 
@@ -1184,11 +1420,13 @@ to_response(const baldr::json::MapPtr& map, http_request_info_t& request_info, c
   }
 
   worker_t::result_t result{false, std::list<std::string>(), ""};
-  http_response_t response(200, "OK", stream.str(),
-                           headers_t{CORS, request.options().has_jsonp() ? worker::JS_MIME
-                                                                         : worker::JSON_MIME});
+  auto response = make_response(stream.str(),
+                                headers_t{CORS, request.options().has_jsonp() ? worker::JS_MIME
+                                                                              : worker::JSON_MIME},
+                                request);
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
+  metrics_t::get().record(request, 200);
   return result;
 }
 
@@ -1196,7 +1434,8 @@ worker_t::result_t to_response(const std::string& data,
                                http_request_info_t& request_info,
                                const Api& request,
                                const worker::content_type& mime_type,
-                               const bool as_attachment) {
+                               const bool as_attachment,
+                               const headers_t& extra_headers) {
 
   worker_t::result_t result{false, std::list<std::string>(), ""};
   if (request.options().has_jsonp()) {
@@ -1208,29 +1447,59 @@ worker_t::result_t to_response(const std::string& data,
     headers_t headers{CORS, worker::JS_MIME};
     if (as_attachment)
       headers.insert(ATTACHMENT);
+    headers.insert(extra_headers.cbegin(), extra_headers.cend());
 
-    http_response_t response(200, "OK", stream.str(), headers);
+    auto response = make_response(stream.str(), headers, request);
     response.from_info(request_info);
     result.messages.emplace_back(response.to_string());
   } else {
     headers_t headers{CORS, mime_type};
     if (as_attachment)
       headers.insert(ATTACHMENT);
-    http_response_t response(200, "OK", data, headers);
+    headers.insert(extra_headers.cbegin(), extra_headers.cend());
+    auto response = make_response(data, headers, request);
     response.from_info(request_info);
     result.messages.emplace_back(response.to_string());
   }
+  metrics_t::get().record(request, 200);
   return result;
 }
 
 #endif
 
-service_worker_t::service_worker_t() : interrupt(nullptr) {
+request_arena_t::request_arena_t(const size_t block_size)
+    : block_size_(block_size), block_(new char[block_size]) {
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block_.get();
+  options.initial_block_size = block_size_;
+  arena_.reset(new google::protobuf::Arena(options));
+}
+request_arena_t::request_arena_t(const request_arena_t& other)
+    : request_arena_t(other.block_size_) {
+}
+Api& request_arena_t::next() {
+  arena_->Reset();
+  return *google::protobuf::Arena::CreateMessage<Api>(arena_.get());
+}
+
+service_worker_t::service_worker_t() : interrupt(nullptr), reported_hits(0), reported_misses(0) {
 }
 service_worker_t::~service_worker_t() {
 }
 void service_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
   interrupt = interrupt_function;
 }
+void service_worker_t::report_tile_cache(const std::string& stage,
+                                         const baldr::GraphReader& reader) {
+  // the counters only ever go up unless the cache was swapped out from under us
+  auto stats = reader.GetCacheStats();
+  if (stats.hits < reported_hits || stats.misses < reported_misses) {
+    reported_hits = reported_misses = 0;
+  }
+  metrics_t::get().add_tile_cache_lookups(stage, stats.hits - reported_hits,
+                                          stats.misses - reported_misses);
+  reported_hits = stats.hits;
+  reported_misses = stats.misses;
+}
 
 } // namespace valhalla
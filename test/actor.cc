@@ -1,9 +1,12 @@
 #include <functional>
+#include <map>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 
 #include "tyr/actor.h"
+#include "tyr/batch.h"
+#include "worker.h"
 
 #include "test.h"
 
@@ -20,7 +23,7 @@ boost::property_tree::ptree make_conf() {
   auto conf = test::json_to_pt(R"({
       "mjolnir":{"tile_dir":"test/traffic_matcher_tiles"},
       "loki":{
-        "actions":["locate","route","sources_to_targets","optimized_route","isochrone","trace_route","trace_attributes","transit_available"],
+        "actions":["locate","route","sources_to_targets","optimized_route","isochrone","trace_route","trace_attributes","transit_available","route_batch","recost"],
         "logging":{"long_request": 100},
         "service_defaults":{"minimum_reachability": 50,"radius": 0,"search_cutoff": 35000, "node_snap_tolerance": 5, "street_side_tolerance": 5, "street_side_max_distance": 1000, "heading_tolerance": 60}
       },
@@ -88,6 +91,112 @@ TEST(Actor, Basic) {
   // TODO: test the rest of them
 }
 
+TEST(Actor, RouteBatch) {
+  tyr::actor_t actor(make_conf(), true);
+  auto single = test::json_to_pt(actor.route(R"({"locations":[{"lat":40.546115,"lon":-76.385076},
+      {"lat":40.544232,"lon":-76.385752}],"costing":"auto"})"));
+
+  // the last route cant be found but that doesnt stop the others
+  auto batch = test::json_to_pt(actor.route_batch(R"({"costing":"auto","id":"dispatch","routes":[
+      {"locations":[{"lat":40.546115,"lon":-76.385076},{"lat":40.544232,"lon":-76.385752}]},
+      {"locations":[{"lat":40.544232,"lon":-76.385752},{"lat":40.546115,"lon":-76.385076}]},
+      {"locations":[{"lat":40.546115,"lon":-76.385076},{"lat":0.0,"lon":0.0}]}]})"));
+  EXPECT_EQ(batch.get<std::string>("id"), "dispatch");
+  const auto& routes = batch.get_child("routes");
+  ASSERT_EQ(routes.size(), 3);
+  auto route = routes.begin();
+  EXPECT_EQ(route->second.get<float>("trip.summary.length"),
+            single.get<float>("trip.summary.length"));
+  EXPECT_FALSE(route->second.get_optional<std::string>("id"));
+  ++route;
+  EXPECT_GT(route->second.get<float>("trip.summary.length"), 0.f);
+  ++route;
+  EXPECT_EQ(route->second.get<int>("error_code"), 171);
+
+  // without any routes there is nothing to do
+  try {
+    actor.route_batch(R"({"costing":"auto","routes":[]})");
+    FAIL() << "Expected an exception";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 115); }
+}
+
+TEST(Actor, Recost) {
+  tyr::actor_t actor(make_conf(), true);
+  Api api;
+  actor.route(R"({"locations":[{"lat":40.546115,"lon":-76.385076},
+      {"lat":40.544232,"lon":-76.385752}],"costing":"auto"})",
+              nullptr, &api);
+  std::string edges, reversed;
+  const auto& nodes = api.trip().routes(0).legs(0).node();
+  for (int i = 0; i < nodes.size() - 1; ++i) {
+    const auto id = std::to_string(nodes.Get(i).edge().id());
+    edges += (edges.empty() ? "" : ",") + id;
+    reversed = id + (reversed.empty() ? "" : ",") + reversed;
+  }
+  ASSERT_FALSE(edges.empty());
+
+  // the times of the edges add up to that of the whole path which uses them all
+  auto recost = test::json_to_pt(
+      actor.recost(R"({"costing":"auto","id":"billing","edges":[)" + edges + "]}"));
+  EXPECT_EQ(recost.get<std::string>("id"), "billing");
+  const auto& path_edges = recost.get_child("recost.edges");
+  ASSERT_EQ(path_edges.size(), static_cast<size_t>(nodes.size() - 1));
+  double time = 0;
+  for (const auto& edge : path_edges) {
+    EXPECT_GT(edge.second.get<double>("time"), 0.);
+    time += edge.second.get<double>("time");
+  }
+  EXPECT_NEAR(recost.get<double>("recost.time"), time, 0.01);
+  EXPECT_GE(recost.get<double>("recost.length"),
+            api.directions().routes(0).legs(0).summary().length() - 0.001);
+
+  // a start time gives the same path its time of day and the edges can be objects too
+  auto timed = test::json_to_pt(actor.recost(R"({"costing":"auto","edges":[{"id":)" +
+                                             edges.substr(0, edges.find(',')) +
+                                             R"(,"time":1602676800}]})"));
+  EXPECT_GT(timed.get<double>("recost.time"), 0.);
+
+  // edges that dont follow on from each other are not a path
+  if (nodes.size() > 2) {
+    try {
+      actor.recost(R"({"costing":"auto","edges":[)" + reversed + "]}");
+      FAIL() << "Expected an exception";
+    } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 446); }
+  }
+  try {
+    actor.recost(R"({"costing":"auto","edges":[]})");
+    FAIL() << "Expected an exception";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 116); }
+}
+
+TEST(Actor, RunBatch) {
+  tyr::actor_t actor(make_conf(), true);
+  const std::string route = R"({"locations":[{"lat":40.546115,"lon":-76.385076},)"
+                            R"({"lat":40.544232,"lon":-76.385752}],"costing":"auto"})";
+  auto single = test::json_to_pt(actor.route(route));
+
+  // every request gets the line it came from and the failures dont stop the rest
+  std::stringstream input, output;
+  input << route << "\n\n# a comment\n-j '" << route << "'\n"
+        << R"({"locations":[{"lat":40.546115,"lon":-76.385076},{"lat":0.0,"lon":0.0}],)"
+        << R"("costing":"auto"})" << "\n";
+  EXPECT_EQ(tyr::run_batch(make_conf(), &tyr::actor_t::route, input, output, 2), 1);
+
+  std::map<size_t, boost::property_tree::ptree> results;
+  std::string line;
+  while (std::getline(output, line)) {
+    auto result = test::json_to_pt(line);
+    EXPECT_GE(result.get<double>("time_ms"), 0.);
+    results.emplace(result.get<size_t>("line"), result);
+  }
+  ASSERT_EQ(results.size(), 3);
+  for (size_t line : {1, 4}) {
+    EXPECT_EQ(results[line].get<float>("response.trip.summary.length"),
+              single.get<float>("trip.summary.length"));
+  }
+  EXPECT_EQ(results[5].get<int>("error_code"), 171);
+}
+
 class ActorInterrupt : public ::testing::Test {
 protected:
   void SetUp() override {
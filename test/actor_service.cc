@@ -0,0 +1,186 @@
+#include "test.h"
+
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <prime_server/http_protocol.hpp>
+#include <prime_server/prime_server.hpp>
+
+#include "baldr/rapidjson_utils.h"
+#include "tyr/actor.h"
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+using namespace valhalla;
+using namespace prime_server;
+
+namespace {
+
+boost::property_tree::ptree make_config() {
+  auto config = test::json_to_pt(R"({
+      "mjolnir":{"tile_dir":"test/traffic_matcher_tiles", "global_synchronized_cache": true},
+      "loki":{
+        "actions":["locate","route","sources_to_targets","isochrone"],
+        "logging":{"long_request": 100},
+        "service":{"proxy":"ipc:///tmp/test_actor_proxy"},
+        "service_defaults":{"minimum_reachability": 50, "radius": 0, "search_cutoff": 35000,
+          "node_snap_tolerance": 5, "street_side_tolerance": 5, "street_side_max_distance": 1000,
+          "heading_tolerance": 60}
+      },
+      "thor":{"logging":{"long_request": 110}},
+      "httpd":{"service":{"loopback":"ipc:///tmp/test_actor_results",
+        "interrupt":"ipc:///tmp/test_actor_interrupt"}},
+      "meili":{"default":{"breakage_distance":2000}},
+      "service_limits": {
+        "auto": {"max_distance": 5000000.0, "max_locations": 20, "max_matrix_distance": 400000.0,
+          "max_matrix_locations": 50},
+        "pedestrian": {"max_distance": 250000.0, "max_locations": 50,
+          "max_matrix_distance": 200000.0, "max_matrix_locations": 50,
+          "max_transit_walking_distance": 10000, "min_transit_walking_distance": 1},
+        "isochrone": {"max_contours": 4, "max_distance": 25000.0, "max_locations": 1,
+          "max_time_contour": 120, "max_distance_contour":200},
+        "max_avoid_locations": 50, "max_radius": 200, "max_reachability": 100, "max_alternates":2
+      }
+    })");
+  config.get_child("mjolnir").put("tile_dir", VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+  return config;
+}
+
+zmq::context_t context;
+void start_service() {
+  // server
+  std::thread server(
+      std::bind(&http_server_t::serve,
+                http_server_t(context, "ipc:///tmp/test_actor_server",
+                              "ipc:///tmp/test_actor_proxy_in", "ipc:///tmp/test_actor_results",
+                              "ipc:///tmp/test_actor_interrupt")));
+  server.detach();
+
+  // load balancer
+  std::thread proxy(std::bind(&proxy_t::forward, proxy_t(context, "ipc:///tmp/test_actor_proxy_in",
+                                                         "ipc:///tmp/test_actor_proxy_out")));
+  proxy.detach();
+
+  // a couple of workers answering whole requests
+  for (int i = 0; i < 2; ++i) {
+    std::thread worker(valhalla::tyr::run_service, make_config());
+    worker.detach();
+  }
+}
+
+// sends the requests over http and hands back the responses in the same order
+std::vector<http_response_t> run_requests(const std::vector<http_request_t>& requests) {
+  auto request = requests.cbegin();
+  std::string request_str;
+  std::vector<http_response_t> responses;
+  http_client_t client(
+      context, "ipc:///tmp/test_actor_server",
+      [&requests, &request, &request_str]() {
+        if (request == requests.cend()) {
+          return std::make_pair<const void*, size_t>(nullptr, 0);
+        }
+        request_str = request->to_string();
+        ++request;
+        return std::make_pair<const void*, size_t>(request_str.c_str(), request_str.size());
+      },
+      [&requests, &request, &responses](const void* data, size_t size) {
+        responses.push_back(http_response_t::from_string(static_cast<const char*>(data), size));
+        return request != requests.cend();
+      },
+      1);
+  client.batch();
+  return responses;
+}
+
+const std::string kRoute = R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+    {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto"})";
+const std::string kMatrix = R"({"sources":[{"lat":40.546115,"lon":-76.385076}],
+    "targets":[{"lat":40.544232,"lon":-76.385752},{"lat":40.546115,"lon":-76.385076}],
+    "costing":"auto"})";
+// this one goes on the query string so it has no spaces
+const std::string kIsochrone = R"({"locations":[{"lat":40.546115,"lon":-76.385076}],)"
+                               R"("costing":"auto","contours":[{"time":2}]})";
+const std::string kLocate = R"({"locations":[{"lat":40.546115,"lon":-76.385076}],
+    "costing":"auto"})";
+
+TEST(ActorService, SameAnswersAsTheActor) {
+  // what the stages answer when called one after the other in process
+  tyr::actor_t actor(make_config(), true);
+  const std::vector<std::string> expected{actor.route(kRoute), actor.matrix(kMatrix),
+                                          actor.isochrone(kIsochrone), actor.locate(kLocate)};
+
+  // is what comes back over http from the single stage, whether posted or got
+  const std::vector<http_request_t> requests{
+      http_request_t(POST, "/route", kRoute),
+      http_request_t(POST, "/sources_to_targets", kMatrix),
+      http_request_t(GET, "/isochrone?json=" + kIsochrone),
+      http_request_t(POST, "/locate", kLocate),
+  };
+  const auto responses = run_requests(requests);
+  ASSERT_EQ(responses.size(), requests.size());
+  for (size_t i = 0; i < responses.size(); ++i) {
+    EXPECT_EQ(responses[i].code, 200) << responses[i].body;
+    rapidjson::Document response_json, expected_json;
+    response_json.Parse(responses[i].body);
+    expected_json.Parse(expected[i]);
+    ASSERT_FALSE(response_json.HasParseError()) << responses[i].body;
+    EXPECT_EQ(response_json, expected_json) << "\nExpected Response: " + expected[i] +
+                                                   "\n, Actual Response: " + responses[i].body;
+  }
+}
+
+TEST(ActorService, Errors) {
+  const std::vector<http_request_t> requests{
+      // not one of the configured actions
+      http_request_t(POST, "/trace_route", kRoute),
+      // not an action at all
+      http_request_t(POST, "/teleport", kRoute),
+      // not json
+      http_request_t(POST, "/route", "{"),
+      // nothing to snap to out here
+      http_request_t(POST, "/route", R"({"locations":[{"lat":40.546115,"lon":-76.385076},
+          {"lat":0,"lon":0}],"costing":"auto"})"),
+  };
+  const auto responses = run_requests(requests);
+  ASSERT_EQ(responses.size(), requests.size());
+  for (size_t i = 0; i < 2; ++i) {
+    EXPECT_EQ(responses[i].code, 404);
+    EXPECT_NE(responses[i].body.find("Try any"), std::string::npos) << responses[i].body;
+  }
+  EXPECT_EQ(responses[2].code, 400);
+  EXPECT_EQ(responses[3].code, 400);
+  for (const auto& response : responses) {
+    rapidjson::Document json;
+    json.Parse(response.body);
+    ASSERT_FALSE(json.HasParseError()) << response.body;
+    EXPECT_TRUE(json.HasMember("error_code")) << response.body;
+  }
+
+  // and the workers are still there to answer afterwards
+  const auto after = run_requests({http_request_t(POST, "/route", kRoute)});
+  ASSERT_EQ(after.size(), 1);
+  EXPECT_EQ(after.front().code, 200) << after.front().body;
+}
+
+} // namespace
+
+class ActorServiceEnv : public ::testing::Environment {
+public:
+  void SetUp() override {
+    start_service();
+  }
+};
+
+int main(int argc, char* argv[]) {
+  // make this whole thing bail if it doesnt finish fast
+  alarm(180);
+
+  testing::AddGlobalTestEnvironment(new ActorServiceEnv);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,11 +1,15 @@
+#include <random>
 #include <vector>
 
 #include "baldr/admin.h"
+#include "mjolnir/admin.h"
+#include "mjolnir/polygonstore.h"
 
 #include "test.h"
 
 using namespace std;
 using namespace valhalla::baldr;
+using namespace valhalla::midgard;
 
 // Expected size is 16 bytes. We want to alert if somehow any change grows
 // this structure size as that indicates incompatible tiles.
@@ -36,6 +40,105 @@ TEST(Admin, EmptyStrings) {
   EXPECT_EQ(aiEmptyStrings.state_iso(), "");
 }
 
+// A square with a hole, a concave one and a multipolygon of two triangles, some overlapping
+std::unordered_multimap<uint32_t, valhalla::mjolnir::multi_polygon_type> test_polys() {
+  std::unordered_multimap<uint32_t, valhalla::mjolnir::multi_polygon_type> polys;
+  const std::vector<std::string> wkts{
+      "MULTIPOLYGON(((0 0,0 0.2,0.2 0.2,0.2 0,0 0),(0.05 0.05,0.15 0.05,0.15 0.15,0.05 0.15,0.05 "
+      "0.05)))",
+      "MULTIPOLYGON(((0.1 0.1,0.1 0.24,0.24 0.24,0.24 0.1,0.17 0.1,0.17 0.2,0.13 0.2,0.13 0.1,0.1 "
+      "0.1)))",
+      "MULTIPOLYGON(((-1 -1,0.2 0.12,-1 0.12,-1 -1)),((0.21 0.01,0.249 0.01,0.249 0.09,0.21 "
+      "0.01)))",
+  };
+  for (size_t i = 0; i < wkts.size(); ++i) {
+    valhalla::mjolnir::multi_polygon_type poly;
+    boost::geometry::read_wkt(wkts[i], poly);
+    polys.emplace(i + 1, poly);
+  }
+  return polys;
+}
+
+TEST(PolygonGrid, SameAsEveryPolygon) {
+  const auto polys = test_polys();
+  const AABB2<PointLL> bounds(0, 0, 0.25, 0.25);
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> distribution(-0.01, 0.26);
+  for (uint32_t divisions : {1, 7, 64, 256}) {
+    valhalla::mjolnir::PolygonGrid grid(polys, bounds, divisions);
+    for (size_t i = 0; i < 20000; ++i) {
+      PointLL ll(distribution(generator), distribution(generator));
+      ASSERT_EQ(valhalla::mjolnir::GetMultiPolyId(grid, ll),
+                valhalla::mjolnir::GetMultiPolyId(polys, ll))
+          << "at " << ll.lng() << "," << ll.lat() << " with " << divisions << " divisions";
+    }
+    // points on the corners and along the edges of the polygons too
+    for (double x = 0; x <= 0.25; x += 0.01) {
+      for (double y = 0; y <= 0.25; y += 0.01) {
+        PointLL ll(x, y);
+        ASSERT_EQ(valhalla::mjolnir::GetMultiPolyId(grid, ll),
+                  valhalla::mjolnir::GetMultiPolyId(polys, ll))
+            << "at " << ll.lng() << "," << ll.lat() << " with " << divisions << " divisions";
+      }
+    }
+  }
+}
+
+TEST(PolygonGrid, FewExactTests) {
+  const auto polys = test_polys();
+  valhalla::mjolnir::PolygonGrid grid(polys, AABB2<PointLL>(0, 0, 0.25, 0.25), 64);
+  EXPECT_GT(grid.partial_cells(), 0);
+  EXPECT_LT(grid.partial_cells(), 64 * 64 / 2);
+}
+
+TEST(PolygonStore, RoundTrip) {
+  using valhalla::mjolnir::multi_polygon_type;
+  using valhalla::mjolnir::PolygonStore;
+  std::vector<multi_polygon_type> geometries(3);
+  boost::geometry::read_wkt("MULTIPOLYGON(((0 0,0 2,2 2,2 0,0 0),(0.5 0.5,1.5 0.5,1.5 1.5,0.5 1.5,"
+                            "0.5 0.5)),((3 3,3 4,4 4,3 3)))",
+                            geometries[0]);
+  boost::geometry::read_wkt("MULTIPOLYGON(((0 0,0 1,1 1,1 0,0 0)))", geometries[1]);
+  boost::geometry::read_wkt("MULTIPOLYGON(((-100 40,-100 41,-99 41,-100 40)))", geometries[2]);
+
+  PolygonStore::Writer writer;
+  PolygonStore::polygon_t country{}, state{}, other{};
+  country.admin_level = 2;
+  country.parent = PolygonStore::kNone;
+  state.admin_level = 4;
+  state.parent = 7;
+  state.drive_on_right = true;
+  other.admin_level = 2;
+  other.parent = 12345;
+  other.allow_intersection_names = true;
+  writer.Add(geometries[0], "Country", "CO", country, 7);
+  writer.Add(geometries[1], "State", "ST", state, 8);
+  writer.Add(geometries[2], "Other", "", other, 9);
+  ASSERT_EQ(writer.Write("test/data/polygon_store.bin"), 3);
+
+  PolygonStore store("test/data/polygon_store.bin");
+  ASSERT_EQ(store.size(), 3);
+  EXPECT_STREQ(store.string(store.polygon(0).name), "Country");
+  EXPECT_STREQ(store.string(store.polygon(0).iso_code), "CO");
+  EXPECT_STREQ(store.string(store.polygon(2).iso_code), "");
+  EXPECT_EQ(store.polygon(0).parent, PolygonStore::kNone);
+  EXPECT_EQ(store.polygon(1).parent, 0);
+  EXPECT_EQ(store.polygon(2).parent, PolygonStore::kNone);
+  EXPECT_EQ(store.polygon(1).admin_level, 4);
+  EXPECT_TRUE(store.polygon(1).drive_on_right);
+  EXPECT_TRUE(store.polygon(2).allow_intersection_names);
+  EXPECT_EQ(store.polygon(0).maxx, 4);
+  for (uint32_t i = 0; i < store.size(); ++i) {
+    EXPECT_TRUE(boost::geometry::equals(store.geometry(i), geometries[i])) << i;
+    EXPECT_EQ(store.geometry(i).size(), geometries[i].size()) << i;
+  }
+
+  EXPECT_EQ(store.find(AABB2<PointLL>(0.2, 0.2, 0.3, 0.3)), (std::vector<uint32_t>{0, 1}));
+  EXPECT_EQ(store.find(AABB2<PointLL>(1.5, 1.5, 3.5, 3.5)), (std::vector<uint32_t>{0}));
+  EXPECT_EQ(store.find(AABB2<PointLL>(-100.5, 40.5, -99.5, 41.5)), (std::vector<uint32_t>{2}));
+  EXPECT_TRUE(store.find(AABB2<PointLL>(10, 10, 11, 11)).empty());
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
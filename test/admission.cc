@@ -0,0 +1,110 @@
+#include "loki/admission.h"
+
+#include <chrono>
+#include <thread>
+
+#include "worker.h"
+
+#include "test.h"
+
+using namespace valhalla;
+
+namespace {
+
+boost::property_tree::ptree config_with(size_t max_concurrent, uint64_t deadline) {
+  boost::property_tree::ptree config;
+  config.put("loki.admission.max_concurrent", max_concurrent);
+  config.put("loki.admission.deadline", deadline);
+  return config;
+}
+
+Api request_with(Options::Action action, size_t locations) {
+  Api request;
+  request.mutable_options()->set_action(action);
+  for (size_t i = 0; i < locations; ++i) {
+    auto* ll = request.mutable_options()->add_locations()->mutable_ll();
+    ll->set_lng(0);
+    ll->set_lat(i * 0.01);
+  }
+  return request;
+}
+
+TEST(Admission, Units) {
+  // two locations a little over a kilometer apart
+  EXPECT_NEAR(loki::Admission::Units(request_with(Options::route, 2)), 3.1, 0.05);
+  EXPECT_EQ(loki::Admission::Units(request_with(Options::optimized_route, 5)), 25);
+  EXPECT_EQ(loki::Admission::Units(request_with(Options::locate, 0)), 1);
+
+  auto matrix = request_with(Options::sources_to_targets, 0);
+  for (int i = 0; i < 3; ++i) {
+    matrix.mutable_options()->add_sources();
+  }
+  for (int i = 0; i < 4; ++i) {
+    matrix.mutable_options()->add_targets();
+  }
+  EXPECT_EQ(loki::Admission::Units(matrix), 12);
+}
+
+TEST(Admission, MaxConcurrent) {
+  loki::Admission admission(config_with(2, 0));
+  auto request = request_with(Options::route, 2);
+  {
+    auto first = admission.Admit(request);
+    auto second = admission.Admit(request);
+    try {
+      admission.Admit(request);
+      FAIL() << "a third concurrent request should have been turned away";
+    } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 173); }
+    // other actions are counted on their own
+    auto other = request_with(Options::locate, 1);
+    auto third = admission.Admit(other);
+  }
+  // once they are done there is room again
+  auto first = admission.Admit(request);
+  EXPECT_FALSE(request.info().has_deadline());
+}
+
+TEST(Admission, Deadline) {
+  loki::Admission admission(config_with(0, 5));
+  auto request = request_with(Options::trace_route, 1);
+  {
+    // nothing is known about how long these take so it is let in
+    auto ticket = admission.Admit(request);
+    EXPECT_TRUE(request.info().has_deadline());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  // now it is expected to take longer than the configured deadline
+  try {
+    admission.Admit(request);
+    FAIL() << "a request expected to miss its deadline should have been turned away";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 173); }
+  // but a request willing to wait longer is let in
+  request.mutable_options()->set_deadline(1000);
+  auto ticket = admission.Admit(request);
+}
+
+TEST(Admission, DeadlineInterrupt) {
+  Api request;
+  size_t interrupted = 0;
+  std::function<void()> interrupt = [&interrupted]() { ++interrupted; };
+
+  // without a deadline it is only the interrupt
+  auto deadline_interrupt = with_deadline(&interrupt, request);
+  deadline_interrupt();
+  EXPECT_EQ(interrupted, 1);
+
+  // with one that has passed it throws
+  request.mutable_info()->set_deadline(1);
+  deadline_interrupt = with_deadline(&interrupt, request);
+  try {
+    deadline_interrupt();
+    FAIL() << "the deadline has passed";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 174); }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1618,6 +1618,53 @@ TEST(Astar, BiDirTrivial) {
   EXPECT_LT(path.front().elapsed_cost.secs, 1);
 }
 
+TEST(Astar, BiDirParallelMatchesSerial) {
+  // Expanding the two trees on separate threads has to find exactly the same paths
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", "test/data/utrecht_tiles");
+  vb::GraphReader graph_reader(conf);
+
+  Options options;
+  create_costing_options(options, Costing::auto_);
+  vs::TravelMode mode;
+  auto mode_costing = vs::CostFactory().CreateModeCosting(options, mode);
+
+  vt::BidirectionalAStar serial;
+  vt::BidirectionalAStar parallel;
+  parallel.EnableParallelExpansion(std::make_shared<vb::GraphReader>(conf));
+
+  const std::vector<std::pair<midgard::PointLL, midgard::PointLL>> routes = {
+      {{5.10315, 52.11237}, {5.13698, 52.07558}},
+      {{5.06037, 52.08946}, {5.16285, 52.10270}},
+      {{5.12696, 52.09701}, {5.09036, 52.07152}},
+  };
+  for (const auto& route : routes) {
+    for (bool flip : {false, true}) {
+      std::vector<valhalla::baldr::Location> locations{{flip ? route.second : route.first},
+                                                       {flip ? route.first : route.second}};
+      const auto projections = vk::Search(locations, graph_reader, mode_costing[int(mode)]);
+      valhalla::Location origin, dest;
+      PathLocation::toPBF(projections.at(locations[0]), &origin, graph_reader);
+      PathLocation::toPBF(projections.at(locations[1]), &dest, graph_reader);
+
+      auto expected = serial.GetBestPath(origin, dest, graph_reader, mode_costing, mode);
+      serial.Clear();
+      auto paths = parallel.GetBestPath(origin, dest, graph_reader, mode_costing, mode);
+      parallel.Clear();
+
+      ASSERT_EQ(paths.size(), expected.size());
+      ASSERT_FALSE(paths.empty());
+      for (size_t i = 0; i < paths.size(); ++i) {
+        ASSERT_EQ(paths[i].size(), expected[i].size());
+        for (size_t j = 0; j < paths[i].size(); ++j) {
+          EXPECT_EQ(paths[i][j].edgeid, expected[i][j].edgeid);
+          EXPECT_EQ(paths[i][j].elapsed_cost.cost, expected[i][j].elapsed_cost.cost);
+        }
+      }
+    }
+  }
+}
+
 class AstarTestEnv : public ::testing::Environment {
 public:
   void SetUp() override {
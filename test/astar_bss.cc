@@ -401,6 +401,35 @@ TEST(AstarBss, test_BSSConnections_on_Pedestrian_and_Bicycle) {
   test(request, expected_travel_modes, expected_route, expected_bss_maneuver, expected_shape);
 }
 
+// Biking between the stations walked to from both ends finds the same route as the search doing it
+// all at once, as long as the stations it goes by are within the walking distance
+TEST(AstarBss, test_Station_Walks) {
+  std::string request =
+      R"({"locations":[{"lat":48.864655,"lon":2.361374},{"lat":48.859608,"lon":2.36117}],"costing":"bikeshare",
+	       "costing_options":{"pedestrian":{"bss_rent_cost":0,"bss_rent_penalty":0},
+	                          "bicycle"   :{"bss_return_cost":0,"bss_return_penalty":0}}})";
+
+  auto conf = get_conf("paris_bss_tiles");
+  route_tester whole_tester(conf);
+  auto whole = whole_tester.test(request);
+  conf.put("thor.bss_station_walk_distance", 250);
+  route_tester walks_tester(conf);
+  auto walks = walks_tester.test(request);
+
+  ASSERT_EQ(walks.trip().routes(0).legs_size(), 1);
+  std::vector<TravelMode> travel_modes;
+  for (const auto& m : walks.directions().routes(0).legs(0).maneuver()) {
+    travel_modes.push_back(m.travel_mode());
+  }
+  travel_modes.erase(std::unique(travel_modes.begin(), travel_modes.end()), travel_modes.end());
+  std::vector<TravelMode> expected_travel_modes{TravelMode::DirectionsLeg_TravelMode_kPedestrian,
+                                                TravelMode::DirectionsLeg_TravelMode_kBicycle,
+                                                TravelMode::DirectionsLeg_TravelMode_kPedestrian};
+  EXPECT_EQ(travel_modes, expected_travel_modes);
+  EXPECT_NEAR(walks.directions().routes(0).legs(0).summary().time(),
+              whole.directions().routes(0).legs(0).summary().time(), 5.0);
+}
+
 } // anonymous namespace
 
 int main(int argc, char* argv[]) {
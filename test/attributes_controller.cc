@@ -67,6 +67,22 @@ TEST(AttrController, TestNodeAttributeEnabled) {
   TryCategoryAttributeEnabled(controller, kNodeCategory, true);
 }
 
+TEST(AttrController, TestIntersectingEdgeAttributeEnabled) {
+  AttributesController controller;
+
+  // Test default
+  TryCategoryAttributeEnabled(controller, kNodeIntersectingEdgeCategory, true);
+
+  // Test other node attributes dont count
+  controller.disable_all();
+  controller.attributes.at(kNodeType) = true;
+  TryCategoryAttributeEnabled(controller, kNodeIntersectingEdgeCategory, false);
+
+  // Test one intersecting edge attribute enabled
+  controller.attributes.at(kNodeIntersectingEdgeRoadClass) = true;
+  TryCategoryAttributeEnabled(controller, kNodeIntersectingEdgeCategory, true);
+}
+
 TEST(AttrController, TestAdminAttributeEnabled) {
   AttributesController controller;
 
@@ -17,3 +17,14 @@ assert('legs' in route['trip'] and len(route['trip']['legs']) > 0)
 assert('maneuvers' in route['trip']['legs'][0] and len(route['trip']['legs'][0]['maneuvers']) > 0)
 assert('instruction' in route['trip']['legs'][0]['maneuvers'][0])
 assert(route['trip']['legs'][0]['maneuvers'][0]['instruction'] == u'Двигайтесь на восток по велосипедной дорожке.')
+
+# the same route on a few threads at once, a broken request gets its error in its place
+threaded = valhalla.Actor(threads=2)
+routes = [json.loads(r) for r in threaded.RouteMany([query, query, '{"locations":[]}', query])]
+assert(len(routes) == 4)
+assert(all(r == route for r in routes[:2] + routes[3:]))
+assert('error_code' in routes[2])
+
+# binary formats come back as bytes
+directions = actor.Route(query[:-1] + ',"format":"pbf"}')
+assert(isinstance(directions, bytes) and len(directions) > 0)
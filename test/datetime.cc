@@ -6,6 +6,7 @@
 #include "baldr/graphconstants.h"
 #include "baldr/timedomain.h"
 #include "midgard/constants.h"
+#include "sif/dynamiccost.h"
 
 #include "test.h"
 
@@ -188,6 +189,15 @@ void TryIsRestricted(const TimeDomain td, const std::string& date, const bool ex
                                             DateTime::seconds_since_epoch(date, tz), tz),
             expected_value)
       << "Is Restricted " + date + " test failed.  Expected: " + std::to_string(expected_value);
+
+  // the costings ask through a cache, the second time is answered by it
+  const auto tz_index = DateTime::get_tz_db().to_index("America/New_York");
+  const auto seconds = DateTime::seconds_since_epoch(date, tz);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(valhalla::sif::DynamicCost::IsConditionalActive(td.td_value(), seconds, tz_index),
+              expected_value)
+        << "Cached is restricted " + date + " test failed";
+  }
 }
 
 void TryTestTimezoneDiff(const uint64_t date_time,
@@ -583,6 +593,22 @@ TEST(DateTime, TestSecondOfWeek) {
   EXPECT_EQ(a, e) << "Wrong second of week";
 }
 
+TEST(DateTime, CachedOffsets) {
+  // every quarter hour around the spring and fall transitions, asking twice so the second is cached
+  const auto& tzdb = DateTime::get_tz_db();
+  for (const auto* name : {"America/New_York", "Europe/Berlin", "Australia/Sydney", "UTC"}) {
+    const auto* tz = tzdb.from_index(tzdb.to_index(name));
+    for (uint64_t start : {1583557200ull, 1604206800ull, 1585400400ull, 1601683200ull}) {
+      for (int pass = 0; pass < 2; ++pass) {
+        for (uint64_t seconds = start; seconds < start + 2 * 86400; seconds += 900) {
+          const auto info = tz->get_info(date::sys_seconds{std::chrono::seconds(seconds)});
+          EXPECT_EQ(tzdb.offset(tz, seconds), info.offset.count()) << name << " at " << seconds;
+        }
+      }
+    }
+  }
+}
+
 TEST(DateTime, DiffCaching) {
   // no cache NY to LA
   const auto& tzdb = DateTime::get_tz_db();
@@ -3,6 +3,8 @@
 #include "midgard/constants.h"
 #include "midgard/pointll.h"
 
+#include <vector>
+
 #include "test.h"
 
 using namespace std;
@@ -47,6 +49,18 @@ TEST(DistanceApproximator, TestDistanceSquared) {
   TryDistanceSquared(a, b, d * d);
 }
 
+TEST(DistanceApproximator, TestDistanceSquaredBatch) {
+  PointLL testpt(-80.0, 42.0);
+  DistanceApproximator<PointLL> approx(testpt);
+  std::vector<double> lngs{-80.0, -79.99, -80.3, 12.5, -80.0};
+  std::vector<double> lats{42.0, 42.01, 41.7, -30.0, 43.0};
+  std::vector<double> sq_distances(lngs.size());
+  approx.DistanceSquared(lngs.data(), lats.data(), lngs.size(), sq_distances.data());
+  for (size_t i = 0; i < lngs.size(); ++i) {
+    EXPECT_DOUBLE_EQ(sq_distances[i], approx.DistanceSquared(PointLL(lngs[i], lats[i])));
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
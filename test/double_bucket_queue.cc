@@ -203,6 +203,147 @@ TEST(DoubleBucketQueue, TestSimulation) {
   }
 }
 
+TEST(DoubleBucketQueue, TestIndexedMatchesLinear) {
+  // the tombstones of the indexed queue should not change the order labels come out in
+  for (uint32_t seed = 0; seed < 20; ++seed) {
+    std::mt19937 gen(seed);
+    std::vector<simple_label> costs;
+    const uint32_t bucketsize = 1 + seed % 5;
+    DoubleBucketQueue<simple_label, true> indexed(0, 50 + seed * 10, bucketsize, costs);
+    DoubleBucketQueue<simple_label, false> linear(0, 50 + seed * 10, bucketsize, costs);
+
+    std::vector<uint32_t> queued{0};
+    costs.push_back({5.f});
+    indexed.add(0);
+    linear.add(0);
+    // stops adding after a while so it eventually drains
+    for (size_t i = 0;; ++i) {
+      const auto label = indexed.pop();
+      ASSERT_EQ(label, linear.pop()) << "Indexed and linear queues diverged";
+      if (label == baldr::kInvalidLabel) {
+        break;
+      }
+      queued.erase(std::find(queued.begin(), queued.end(), label));
+
+      for (size_t j = 0; j < 6; ++j) {
+        const auto cost = std::floor(costs[label].sortcost() + 1 + test::rand01(gen) * 300);
+        if (j % 2 == 0 && !queued.empty()) {
+          const auto other = queued[gen() % queued.size()];
+          if (cost < costs[other].sortcost()) {
+            indexed.decrease(other, cost);
+            linear.decrease(other, cost);
+            costs[other] = {cost};
+          }
+        } else if (i < 1000) {
+          queued.push_back(costs.size());
+          costs.push_back({cost});
+          indexed.add(queued.back());
+          linear.add(queued.back());
+        }
+      }
+    }
+    EXPECT_TRUE(queued.empty());
+  }
+}
+
+TEST(DoubleBucketQueue, TestPopBucket) {
+  // a whole bucket comes out in the order pop would give, skipping the labels moved out of it
+  std::vector<simple_label> costs{{12.f}, {3.f}, {17.f}, {14.f}, {38.f}, {11.f}, {26.f}};
+  DoubleBucketQueue<simple_label> adjlist(0, 20, 10, costs);
+  for (uint32_t i = 0; i < costs.size(); ++i) {
+    adjlist.add(i);
+  }
+  adjlist.decrease(3, 4.f);
+  costs[3] = {4.f};
+
+  std::vector<uint32_t> labels;
+  ASSERT_TRUE(adjlist.pop_bucket(labels));
+  EXPECT_EQ(labels, (std::vector<uint32_t>{3, 1}));
+
+  // whatever is added below the end of the bucket comes out of that bucket next
+  costs.push_back({9.f});
+  adjlist.add(costs.size() - 1);
+  ASSERT_TRUE(adjlist.pop_bucket(labels));
+  EXPECT_EQ(labels, (std::vector<uint32_t>{7}));
+  ASSERT_TRUE(adjlist.pop_bucket(labels));
+  EXPECT_EQ(labels, (std::vector<uint32_t>{5, 2, 0}));
+
+  // including the overflow
+  ASSERT_TRUE(adjlist.pop_bucket(labels));
+  EXPECT_EQ(labels, (std::vector<uint32_t>{6}));
+  ASSERT_TRUE(adjlist.pop_bucket(labels));
+  EXPECT_EQ(labels, (std::vector<uint32_t>{4}));
+  EXPECT_FALSE(adjlist.pop_bucket(labels));
+  EXPECT_TRUE(labels.empty());
+}
+
+TEST(DoubleBucketQueue, TestBytes) {
+  // the memory grows with each label index and tombstone and shrinks as they are popped
+  std::vector<simple_label> costs{{12.f}, {3.f}, {17.f}, {38.f}};
+  DoubleBucketQueue<simple_label, false> linear(0, 20, 10, costs);
+  const auto empty = linear.bytes();
+  for (uint32_t i = 0; i < costs.size(); ++i) {
+    linear.add(i);
+  }
+  EXPECT_EQ(linear.bytes(), empty + costs.size() * sizeof(uint32_t));
+  linear.decrease(2, 4.f);
+  EXPECT_EQ(linear.bytes(), empty + costs.size() * sizeof(uint32_t));
+  while (linear.pop() != kInvalidLabel) {
+  }
+  EXPECT_EQ(linear.bytes(), empty);
+
+  // the indexed queue also remembers where each label is and leaves tombstones behind
+  DoubleBucketQueue<simple_label> indexed(0, 20, 10, costs);
+  for (uint32_t i = 0; i < costs.size(); ++i) {
+    indexed.add(i);
+  }
+  const auto added = indexed.bytes();
+  EXPECT_GT(added, empty + costs.size() * sizeof(uint32_t));
+  indexed.decrease(0, 4.f);
+  costs[0] = {4.f};
+  EXPECT_EQ(indexed.bytes(), added + sizeof(uint32_t));
+  // the tombstone in the overflow is dropped when the overflow is emptied
+  indexed.decrease(3, 15.f);
+  costs[3] = {15.f};
+  std::vector<uint32_t> labels;
+  while (indexed.pop_bucket(labels)) {
+  }
+  EXPECT_EQ(indexed.bytes(), added - costs.size() * sizeof(uint32_t));
+  indexed.clear();
+  EXPECT_EQ(indexed.bytes(), empty);
+}
+
+TEST(DoubleBucketQueue, TestReuse) {
+  // a search stopped part way leaves labels behind in the buckets and the overflow
+  std::vector<simple_label> costs{{12.f}, {3.f}, {17.f}, {38.f}, {7.f}};
+  DoubleBucketQueue<simple_label> adjlist(0, 20, 10, costs);
+  for (uint32_t i = 0; i < costs.size(); ++i) {
+    adjlist.add(i);
+  }
+  adjlist.decrease(2, 4.f);
+  costs[2] = {4.f};
+  EXPECT_NE(adjlist.pop(), kInvalidLabel);
+  const auto capacity = adjlist.capacity();
+  EXPECT_GE(capacity, costs.size());
+
+  // the next search with another range pops just like a new queue would and keeps the memory
+  std::vector<simple_label> next{{130.f}, {101.f}, {250.f}, {115.f}};
+  costs = next;
+  adjlist.reuse(100, 100, 5);
+  EXPECT_GE(adjlist.capacity(), capacity);
+  DoubleBucketQueue<simple_label> fresh(100, 100, 5, next);
+  for (uint32_t i = 0; i < next.size(); ++i) {
+    adjlist.add(i);
+    fresh.add(i);
+  }
+  uint32_t label;
+  do {
+    label = fresh.pop();
+    EXPECT_EQ(adjlist.pop(), label);
+  } while (label != kInvalidLabel);
+  EXPECT_THROW(adjlist.reuse(0, 100, 0), runtime_error);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -100,6 +100,51 @@ TEST(EdgeInfoBuilder, TestWriteRead) {
   }
 }
 
+TEST(EdgeInfoBuilder, TestVisitors) {
+  EdgeInfoBuilder eibuilder;
+
+  // a text list with a regular name, a route number and a tagged name
+  const char names_list[] = "Main Street\0A1\0" "1Hauptstrasse";
+  std::vector<NameInfo> name_info_list(3);
+  name_info_list[0].name_offset_ = 0;
+  name_info_list[1].name_offset_ = 12;
+  name_info_list[1].is_route_num_ = 1;
+  name_info_list[2].name_offset_ = 15;
+  name_info_list[2].tagged_ = 1;
+  eibuilder.set_name_info_list(name_info_list);
+
+  std::vector<PointLL> shape{{-76.3002, 40.0433}, {-76.3036, 40.043}, {-76.3041, 40.0425}};
+  eibuilder.set_shape(shape);
+
+  boost::shared_array<char> memblock = ToFileAndBack(eibuilder);
+  EdgeInfo ei(memblock.get(), names_list, sizeof(names_list));
+
+  // the visited names match the allocating accessors and point right into the text list
+  std::vector<std::pair<std::string, bool>> visited;
+  ei.VisitNames([&visited, &names_list](boost::string_view name, bool is_route_number) {
+    EXPECT_GE(name.data(), names_list);
+    EXPECT_LT(name.data(), names_list + sizeof(names_list));
+    visited.emplace_back(name.to_string(), is_route_number);
+  });
+  EXPECT_EQ(visited, ei.GetNamesAndTypes());
+  EXPECT_EQ(ei.GetNames(), (std::vector<std::string>{"Main Street", "A1"}));
+
+  std::vector<std::string> tagged;
+  ei.VisitNames([&tagged](boost::string_view name, bool) { tagged.push_back(name.to_string()); },
+                true);
+  EXPECT_EQ(tagged, ei.GetNames(true));
+  EXPECT_EQ(tagged, (std::vector<std::string>{"1Hauptstrasse"}));
+
+  // the visited shape matches the decoded one
+  std::vector<PointLL> visited_shape;
+  ei.VisitShape([&visited_shape](const PointLL& point) { visited_shape.push_back(point); });
+  ASSERT_EQ(visited_shape.size(), shape.size());
+  for (size_t i = 0; i < shape.size(); ++i) {
+    EXPECT_EQ(visited_shape[i], ei.shape()[i]) << "index " << i;
+    EXPECT_TRUE(shape[i].ApproximatelyEqual(visited_shape[i])) << "index " << i;
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,54 @@
+#include "sif/edgelabel.h"
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::sif;
+
+namespace {
+
+EdgeLabel make_label(const int restriction_idx) {
+  baldr::DirectedEdge edge;
+  return EdgeLabel(0, baldr::GraphId(), &edge, Cost(), 0.f, 0.f, TravelMode::kDrive, 0, Cost(),
+                   restriction_idx);
+}
+
+TEST(EdgeLabel, RestrictionIdx) {
+  EXPECT_EQ(EdgeLabel().restriction_idx(), 0);
+  EXPECT_EQ(make_label(-1).restriction_idx(), -1);
+
+  // every index up to the largest one which fits survives, the upper bits included
+  for (int restriction_idx : {0, 1, 126, 127, 128, 255, 256,
+                              static_cast<int>(kNoLabelRestrictionIdx) - 1}) {
+    EXPECT_EQ(make_label(restriction_idx).restriction_idx(), restriction_idx);
+  }
+
+  // those which dont fit are dropped rather than mistaken for another one
+  EXPECT_EQ(make_label(kNoLabelRestrictionIdx).restriction_idx(), -1);
+  EXPECT_EQ(make_label(kNoLabelRestrictionIdx + 1).restriction_idx(), -1);
+  EXPECT_EQ(make_label(1 << 20).restriction_idx(), -1);
+}
+
+TEST(EdgeLabel, RestrictionIdxUpdates) {
+  baldr::DirectedEdge edge;
+  BDEdgeLabel label(0, baldr::GraphId(), baldr::GraphId(), &edge, Cost(), 0.f, 0.f,
+                    TravelMode::kDrive, Cost(), false, 300);
+  EXPECT_EQ(label.restriction_idx(), 300);
+  label.Update(0, Cost(), 0.f, Cost(), 127);
+  EXPECT_EQ(label.restriction_idx(), 127);
+  label.Update(0, Cost(), 0.f, Cost(), -1);
+  EXPECT_EQ(label.restriction_idx(), -1);
+
+  // and none of it leaks into the neighbouring fields
+  label.Update(0, Cost(), 0.f, Cost(), static_cast<int>(kNoLabelRestrictionIdx) - 1);
+  EXPECT_EQ(label.restriction_idx(), static_cast<int>(kNoLabelRestrictionIdx) - 1);
+  EXPECT_EQ(label.endnode(), edge.endnode());
+  EXPECT_EQ(label.use(), edge.use());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -66,6 +66,79 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreachedOrReset);
 }
 
+TEST(EdgeStatus, Reuse) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile = tt;
+
+  // enough tiles that the table has to grow a few times
+  for (uint32_t i = 0; i < 100; ++i) {
+    edgestatus.Set(GraphId(i, 2, 10), EdgeSet::kTemporary, i, tile);
+    edgestatus.Set(GraphId(i, 2, 999), EdgeSet::kPermanent, i, tile);
+  }
+  for (uint32_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(edgestatus.Get(GraphId(i, 2, 10)).index(), i);
+    TryGet(edgestatus, GraphId(i, 2, 10), EdgeSet::kTemporary);
+    TryGet(edgestatus, GraphId(i, 2, 999), EdgeSet::kPermanent);
+    TryGet(edgestatus, GraphId(i, 2, 500), EdgeSet::kUnreachedOrReset);
+    TryGet(edgestatus, GraphId(i, 1, 10), EdgeSet::kUnreachedOrReset);
+  }
+
+  // pointers into a tile survive the table growing
+  auto* ptr = edgestatus.GetPtr(GraphId(7, 2, 10), tile);
+  for (uint32_t i = 100; i < 200; ++i) {
+    edgestatus.Set(GraphId(i, 2, 0), EdgeSet::kTemporary, i, tile);
+  }
+  EXPECT_EQ(ptr->index(), 7);
+  edgestatus.Update(GraphId(7, 2, 10), EdgeSet::kPermanent);
+  EXPECT_EQ(ptr->set(), EdgeSet::kPermanent);
+
+  // after clearing the reused arrays dont leak the previous search
+  edgestatus.clear();
+  EXPECT_THROW(edgestatus.Update(GraphId(7, 2, 10), EdgeSet::kPermanent), std::runtime_error);
+  edgestatus.Set(GraphId(7, 2, 11), EdgeSet::kTemporary, 3, tile);
+  TryGet(edgestatus, GraphId(7, 2, 10), EdgeSet::kUnreachedOrReset);
+  TryGet(edgestatus, GraphId(7, 2, 11), EdgeSet::kTemporary);
+  TryGet(edgestatus, GraphId(8, 2, 10), EdgeSet::kUnreachedOrReset);
+  EXPECT_EQ(edgestatus.GetPtr(GraphId(8, 2, 10), tile)->set(), EdgeSet::kUnreachedOrReset);
+
+  // moving it along keeps the status
+  EdgeStatus moved(std::move(edgestatus));
+  TryGet(moved, GraphId(7, 2, 11), EdgeSet::kTemporary);
+  TryGet(edgestatus, GraphId(7, 2, 11), EdgeSet::kUnreachedOrReset);
+}
+
+TEST(EdgeStatus, ReleaseLargeSearches) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(200000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile = tt;
+
+  // a few tiles are kept for the next search
+  for (uint32_t i = 0; i < 4; ++i) {
+    edgestatus.Set(GraphId(i, 2, 0), EdgeSet::kTemporary, i, tile);
+  }
+  const auto small = edgestatus.bytes();
+  edgestatus.clear();
+  EXPECT_EQ(edgestatus.bytes(), small);
+
+  // but a search that went through a lot of them doesnt keep them
+  for (uint32_t i = 0; i < 20; ++i) {
+    edgestatus.Set(GraphId(i, 2, 0), EdgeSet::kTemporary, i, tile);
+  }
+  EXPECT_GT(edgestatus.bytes(), 20 * 200000 * sizeof(EdgeStatusInfo));
+  edgestatus.clear();
+  EXPECT_EQ(edgestatus.bytes(), 0);
+  TryGet(edgestatus, GraphId(3, 2, 0), EdgeSet::kUnreachedOrReset);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
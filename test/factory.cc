@@ -27,6 +27,39 @@ TEST(Factory, Register) {
   EXPECT_THROW(factory.Create(CostingOptions{}), std::runtime_error);
 }
 
+TEST(Factory, CopiesKeptCostings) {
+  Options options;
+  const rapidjson::Document doc;
+  sif::ParseCostingOptions(doc, "/costing_options", options);
+  CostFactory factory;
+  options.set_costing(Costing::auto_);
+
+  // the same options give distinct costings which dont share what the requests change
+  auto first = factory.Create(options);
+  first->set_pass(1);
+  auto second = factory.Create(options);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(second->pass(), 0);
+  EXPECT_EQ(second->travel_mode(), first->travel_mode());
+  EXPECT_EQ(second->access_mode(), first->access_mode());
+
+  // other options give other costings
+  const uint8_t flow_mask = second->flow_mask() ^ 1;
+  options.mutable_costing_options(static_cast<int>(Costing::auto_))->set_flow_mask(flow_mask);
+  EXPECT_EQ(factory.Create(options)->flow_mask(), flow_mask);
+  EXPECT_NE(factory.Create(Costing::auto_)->flow_mask(), flow_mask);
+
+  // costings registered from outside are built every time
+  int built = 0;
+  factory.Register(Costing::auto_, [&built](const CostingOptions& costing_options) {
+    ++built;
+    return CreateAutoCost(costing_options);
+  });
+  factory.Create(options);
+  factory.Create(options);
+  EXPECT_EQ(built, 2);
+}
+
 // TODO: add many more tests!
 
 } // namespace
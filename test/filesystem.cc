@@ -4,6 +4,7 @@
 #include <fstream>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 #include <vector>
 
 #include "test.h"
@@ -106,6 +107,25 @@ TEST(Filesystem, remove_any) {
   EXPECT_FALSE(filesystem::exists(".foobar")) << ".foobar dir should have been deleted";
 }
 
+TEST(Filesystem, concurrent_create_directories) {
+  // threads storing tiles make the same directories at the same time
+  std::vector<std::thread> threads;
+  std::vector<char> made(8, false);
+  for (size_t i = 0; i < made.size(); ++i) {
+    threads.emplace_back([&made, i]() {
+      made[i] = filesystem::create_directories(".foobar/a/b/c/" + std::to_string(i));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < made.size(); ++i) {
+    EXPECT_TRUE(made[i]) << "couldnt make the directory of thread " << i;
+    EXPECT_TRUE(filesystem::is_directory(".foobar/a/b/c/" + std::to_string(i)));
+  }
+  EXPECT_TRUE(filesystem::remove_all(".foobar"));
+}
+
 TEST(Filesystem, parent_path) {
   std::vector<filesystem::path> in{{"/"},   {"/foo/bar"}, {"/foo/../"}, {"/foo/bar/../f"},
                                    {"./f"}, {"foo/bar/f"}};
@@ -1,9 +1,14 @@
 #include <cstdint>
+#include <cstring>
+#include <thread>
 
 #include "baldr/connectivity_map.h"
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
+#include "midgard/sequence.h"
+#include "mjolnir/opposingedgesbuilder.h"
+#include "mjolnir/util.h"
 
 #include <fcntl.h>
 
@@ -126,6 +131,54 @@ TEST(ConnectivityMap, Basic) {
   filesystem::remove_all(tile_dir);
 }
 
+TEST(ConnectivityMap, WrittenMatchesComputed) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  const auto file_name = connectivity_map_t::FileName("test/data/utrecht_tiles");
+  connectivity_map_t::Write(file_name, pt, {kAutoAccess, kPedestrianAccess});
+
+  // the colors of the mapped one are those of the computed one
+  connectivity_map_t computed(pt);
+  pt.put("connectivity_map", true);
+  connectivity_map_t mapped(pt);
+  GraphReader reader(pt);
+  for (const auto& tile_id : reader.GetTileSet()) {
+    EXPECT_EQ(mapped.get_color(tile_id), computed.get_color(tile_id));
+  }
+  const PathLocation nowhere(Location(valhalla::midgard::PointLL{}));
+  std::unordered_set<uint32_t> components;
+  EXPECT_FALSE(computed.get_components(nowhere, kAutoAccess, components));
+
+  // an edge and its opposing edge are in the same component of whoever can use both
+  size_t checked = 0;
+  for (const auto& tile_id : reader.GetTileSet(2)) {
+    auto tile = reader.GetGraphTile(tile_id);
+    for (GraphId edge_id = tile_id; edge_id.id() < tile->header()->directededgecount();
+         ++edge_id) {
+      const auto* edge = tile->directededge(edge_id);
+      const auto access = edge->forwardaccess() & edge->reverseaccess();
+      if (!(access & kAutoAccess) || edge->is_shortcut()) {
+        continue;
+      }
+      PathLocation location(nowhere), opposing(nowhere);
+      location.edges.emplace_back(edge_id, 0, nowhere.latlng_, 0);
+      opposing.edges.emplace_back(reader.GetOpposingEdgeId(edge_id), 0, nowhere.latlng_, 0);
+      std::unordered_set<uint32_t> edge_components, opposing_components;
+      ASSERT_TRUE(mapped.get_components(location, kAutoAccess, edge_components));
+      ASSERT_TRUE(mapped.get_components(opposing, kAutoAccess, opposing_components));
+      EXPECT_EQ(edge_components, opposing_components);
+      ++checked;
+    }
+  }
+  EXPECT_GT(checked, 0);
+
+  // theres nothing for access modes it wasnt written for
+  PathLocation location(nowhere);
+  location.edges.emplace_back(*reader.GetTileSet(2).begin(), 0, nowhere.latlng_, 0);
+  EXPECT_FALSE(mapped.get_components(location, kBicycleAccess, components));
+  filesystem::remove(file_name);
+}
+
 class TestGraphMemory final : public GraphMemory {
 public:
   TestGraphMemory() : memory_(sizeof(GraphTileHeader)) {
@@ -876,6 +929,570 @@ TEST(CacheLruSoft, TrimOnExactlyFullCache) {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+TEST(CacheTinyLFU, ScanDoesNotEvictHotTiles) {
+  TileCacheTinyLFU cache(500, TileCacheLRU::MemoryLimitControl::HARD);
+
+  // a tile that many requests use and one that was only used once
+  GraphId hot_id(1000, 1, 0);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(cache.Get(hot_id), nullptr);
+  }
+  cache.Put(hot_id, new TestGraphTile(hot_id, 200), 200);
+  GraphId warm_id(300, 2, 0);
+  EXPECT_EQ(cache.Get(warm_id), nullptr);
+  cache.Put(warm_id, new TestGraphTile(warm_id, 250), 250);
+
+  // a long scan over tiles that are each used once cant push them out
+  for (uint32_t i = 0; i < 10; ++i) {
+    GraphId scan_id(2000 + i, 0, 0);
+    EXPECT_EQ(cache.Get(scan_id), nullptr);
+    auto tile = cache.Put(scan_id, new TestGraphTile(scan_id, 200), 200);
+    CheckGraphTile(tile, scan_id, 200);
+    EXPECT_FALSE(cache.Contains(scan_id));
+  }
+  EXPECT_TRUE(cache.Contains(hot_id));
+  EXPECT_TRUE(cache.Contains(warm_id));
+
+  // but a tile that is used more often than the least recently used one still gets in
+  GraphId hotter_id(400, 2, 0);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(cache.Get(hotter_id), nullptr);
+  }
+  cache.Put(hotter_id, new TestGraphTile(hotter_id, 200), 200);
+  EXPECT_TRUE(cache.Contains(hotter_id));
+  EXPECT_FALSE(cache.Contains(hot_id));
+  EXPECT_TRUE(cache.Contains(warm_id));
+  EXPECT_FALSE(cache.OverCommitted());
+
+  CheckGraphTile(cache.Get(hotter_id), hotter_id, 200);
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 19);
+  EXPECT_EQ(stats.rejected, 10);
+}
+
+TEST(CacheTinyLFU, ClearForgetsFrequencies) {
+  TileCacheTinyLFU cache(200, TileCacheLRU::MemoryLimitControl::HARD);
+
+  GraphId hot_id(1000, 1, 0);
+  for (int i = 0; i < 3; ++i) {
+    cache.Get(hot_id);
+  }
+  cache.Put(hot_id, new TestGraphTile(hot_id, 200), 200);
+  cache.Clear();
+  EXPECT_FALSE(cache.Contains(hot_id));
+
+  // with the history gone the next tile in only has to beat a tile that hasnt been used
+  cache.Put(hot_id, new TestGraphTile(hot_id, 200), 200);
+  GraphId other_id(300, 2, 0);
+  cache.Get(other_id);
+  cache.Put(other_id, new TestGraphTile(other_id, 200), 200);
+  EXPECT_TRUE(cache.Contains(other_id));
+  EXPECT_FALSE(cache.Contains(hot_id));
+}
+
+TEST(CacheLruHard, Stats) {
+  TileCacheLRU cache(500, TileCacheLRU::MemoryLimitControl::HARD);
+  GraphId id(1000, 1, 0);
+  EXPECT_EQ(cache.Get(id), nullptr);
+  cache.Put(id, new TestGraphTile(id, 200), 200);
+  CheckGraphTile(cache.Get(id), id, 200);
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.rejected, 0);
+}
+
+TEST(CacheLruCompressed, EvictedTilesArePromoted) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  auto tile_set = reader.GetTileSet();
+  ASSERT_GE(tile_set.size(), 2);
+  auto id1 = *tile_set.begin();
+  auto id2 = *std::next(tile_set.begin());
+  auto tile1 = reader.GetGraphTile(id1);
+  auto tile2 = reader.GetGraphTile(id2);
+  const size_t size1 = tile1->header()->end_offset();
+  const size_t size2 = tile2->header()->end_offset();
+
+  // only room for one of them decompressed
+  TileCacheLRUCompressed cache(std::max(size1, size2), size1 + size2,
+                               TileCacheLRU::MemoryLimitControl::HARD);
+  cache.Put(id1, GraphTile::Create(pt.get<std::string>("tile_dir"), id1), size1);
+  EXPECT_EQ(cache.CompressedSize(), 0);
+  cache.Put(id2, GraphTile::Create(pt.get<std::string>("tile_dir"), id2), size2);
+  EXPECT_TRUE(cache.Contains(id1));
+  EXPECT_TRUE(cache.Contains(id2));
+  EXPECT_GT(cache.CompressedSize(), 0);
+  EXPECT_LT(cache.CompressedSize(), size1);
+
+  // getting the evicted tile inflates it and pushes the other one down instead
+  auto promoted = cache.Get(id1);
+  ASSERT_TRUE(promoted);
+  ASSERT_EQ(promoted->header()->end_offset(), size1);
+  EXPECT_EQ(std::memcmp(promoted->header(), tile1->header(), size1), 0);
+  EXPECT_TRUE(cache.Contains(id2));
+  EXPECT_EQ(cache.GetStats().hits, 1);
+
+  auto demoted = cache.Get(id2);
+  ASSERT_TRUE(demoted);
+  EXPECT_EQ(std::memcmp(demoted->header(), tile2->header(), size2), 0);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Contains(id1));
+  EXPECT_FALSE(cache.Contains(id2));
+  EXPECT_EQ(cache.CompressedSize(), 0);
+}
+
+TEST(ShardedCache, ShardCount) {
+  EXPECT_EQ(ShardedTileCache(100, 0).ShardCount(), 1);
+  EXPECT_EQ(ShardedTileCache(100, 1).ShardCount(), 1);
+  EXPECT_EQ(ShardedTileCache(100, 5).ShardCount(), 8);
+  EXPECT_EQ(ShardedTileCache(100, 64).ShardCount(), 64);
+}
+
+TEST(ShardedCache, PutGetClear) {
+  ShardedTileCache cache(400, 16);
+
+  GraphId id1(100, 2, 0);
+  auto tile1 = cache.Put(id1, new TestGraphTile(id1, 123), 123);
+  EXPECT_EQ(cache.Get(id1), tile1);
+  CheckGraphTile(tile1, id1, 123);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  GraphId id2(300, 1, 0);
+  auto tile2 = cache.Put(id2, new TestGraphTile(id2, 200), 200);
+  EXPECT_EQ(cache.Get(id2), tile2);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  // putting the same tile again keeps the first one and doesnt count it twice
+  auto again = cache.Put(id2, new TestGraphTile(id2, 200), 200);
+  EXPECT_EQ(again, tile2);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  GraphId id3(1000, 0, 0);
+  auto tile3 = cache.Put(id3, new TestGraphTile(id3, 500), 500);
+  CheckGraphTile(cache.Get(id3), id3, 500);
+  EXPECT_TRUE(cache.OverCommitted());
+
+  EXPECT_TRUE(cache.Contains(id1));
+  EXPECT_TRUE(cache.Contains(id2));
+  EXPECT_TRUE(cache.Contains(id3));
+  EXPECT_FALSE(cache.Contains({1000, 1, 0}));
+
+  cache.Trim();
+
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(cache.Contains(id1));
+  EXPECT_FALSE(cache.Contains(id2));
+  EXPECT_FALSE(cache.Contains(id3));
+  EXPECT_EQ(cache.Get(id1), nullptr);
+}
+
+TEST(ShardedCache, CopiesShareState) {
+  ShardedTileCache cache(1000, 4);
+  ShardedTileCache copy(cache);
+
+  GraphId id(42, 2, 0);
+  auto tile = cache.Put(id, new TestGraphTile(id, 800), 800);
+  EXPECT_EQ(copy.Get(id), tile);
+
+  copy.Put({43, 2, 0}, new TestGraphTile({43, 2, 0}, 800), 800);
+  EXPECT_TRUE(cache.OverCommitted());
+
+  copy.Clear();
+  EXPECT_FALSE(cache.Contains(id));
+  EXPECT_FALSE(cache.OverCommitted());
+}
+
+TEST(ShardedCache, ConcurrentPutGet) {
+  const size_t thread_count = 8;
+  const uint32_t tiles_per_thread = 500;
+  ShardedTileCache cache(thread_count * tiles_per_thread * 10, 16);
+
+  // each thread works on its own set of tiles so the tile ref counts are not shared
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&cache, t, tiles_per_thread]() {
+      for (uint32_t i = 0; i < tiles_per_thread; ++i) {
+        GraphId id(t * tiles_per_thread + i, 2, 0);
+        cache.Put(id, new TestGraphTile(id, 10), 10);
+        EXPECT_TRUE(cache.Get(id));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (uint32_t i = 0; i < thread_count * tiles_per_thread; ++i) {
+    CheckGraphTile(cache.Get({i, 2, 0}), {i, 2, 0}, 10);
+  }
+  // right at the limit but not over it
+  EXPECT_FALSE(cache.OverCommitted());
+  cache.Put({0, 1, 0}, new TestGraphTile({0, 1, 0}, 1), 1);
+  EXPECT_TRUE(cache.OverCommitted());
+}
+
+TEST(Prefetch, Disabled) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+
+  reader.PrefetchNeighbors({3196, 0, 0});
+  auto stats = reader.GetPrefetchStats();
+  EXPECT_EQ(stats.requested, 0);
+  EXPECT_EQ(stats.hits, 0);
+}
+
+TEST(Prefetch, LoadsInBackground) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  pt.put("prefetch_threads", 2);
+  pt.put("prefetch_max_tiles", 1000);
+  GraphReader reader(pt);
+
+  auto tile_set = reader.GetTileSet();
+  ASSERT_FALSE(tile_set.empty());
+  for (const auto& tile_id : tile_set) {
+    reader.Prefetch(tile_id);
+  }
+
+  // wait for the workers to get through all of it
+  auto until = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (reader.GetPrefetchStats().loaded < tile_set.size() &&
+         std::chrono::steady_clock::now() < until) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto stats = reader.GetPrefetchStats();
+  EXPECT_EQ(stats.requested, tile_set.size());
+  ASSERT_EQ(stats.loaded, tile_set.size());
+
+  // every tile should now come from the prefetcher
+  for (const auto& tile_id : tile_set) {
+    auto tile = reader.GetGraphTile(tile_id);
+    ASSERT_TRUE(tile);
+    EXPECT_EQ(tile->id(), tile_id);
+  }
+  stats = reader.GetPrefetchStats();
+  EXPECT_EQ(stats.hits, tile_set.size());
+  EXPECT_EQ(stats.misses, 0);
+
+  // cached tiles are not requested again
+  reader.Prefetch(*tile_set.begin());
+  EXPECT_EQ(reader.GetPrefetchStats().requested, tile_set.size());
+}
+
+TEST(Prefetch, NoTileLoadedTwice) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  pt.put("prefetch_threads", 2);
+  pt.put("prefetch_max_tiles", 1000);
+  GraphReader reader(pt);
+
+  // ask for the tiles straight after queueing them so that the workers are still busy with them
+  auto tile_set = reader.GetTileSet();
+  ASSERT_FALSE(tile_set.empty());
+  for (const auto& tile_id : tile_set) {
+    reader.Prefetch(tile_id);
+  }
+  for (const auto& tile_id : tile_set) {
+    auto tile = reader.GetGraphTile(tile_id);
+    ASSERT_TRUE(tile);
+    EXPECT_EQ(tile->id(), tile_id);
+  }
+
+  // every tile came either from a worker or was taken off the queue and loaded in place
+  auto stats = reader.GetPrefetchStats();
+  EXPECT_EQ(stats.hits + stats.misses, tile_set.size());
+  EXPECT_EQ(stats.loaded, stats.hits);
+  EXPECT_LE(stats.waits, stats.hits);
+}
+
+TEST(GraphReader, ReloadTileset) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  auto tile_set = reader.GetTileSet();
+  ASSERT_FALSE(tile_set.empty());
+  auto old_tile = reader.GetGraphTile(*tile_set.begin());
+  ASSERT_TRUE(old_tile);
+  EXPECT_FALSE(reader.Refresh());
+
+  // the reader keeps its tiles until it is refreshed
+  const auto tileset = reader.TilesetGeneration();
+  const auto traffic = reader.TrafficGeneration();
+  GraphReader::ReloadTileset(pt);
+  EXPECT_EQ(reader.TilesetGeneration(), tileset);
+  EXPECT_EQ(reader.GetGraphTile(*tile_set.begin()), old_tile);
+
+  // after which the tiles are loaded again and anything made from the old ones is dropped
+  EXPECT_TRUE(reader.Refresh());
+  EXPECT_FALSE(reader.Refresh());
+  EXPECT_EQ(reader.TilesetGeneration(), tileset + 1);
+  EXPECT_GT(reader.TrafficGeneration(), traffic);
+  auto new_tile = reader.GetGraphTile(*tile_set.begin());
+  ASSERT_TRUE(new_tile);
+  EXPECT_NE(new_tile, old_tile);
+  EXPECT_EQ(new_tile->id(), old_tile->id());
+
+  // new readers start on the new tiles
+  GraphReader fresh(pt);
+  EXPECT_EQ(fresh.TilesetGeneration(), tileset + 1);
+  EXPECT_FALSE(fresh.Refresh());
+}
+
+TEST(GraphReader, ReloadTilesetSharedCache) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  pt.put("global_synchronized_cache", true);
+  GraphReader refreshed(pt);
+  GraphReader stale(pt);
+  auto tile_set = refreshed.GetTileSet();
+  ASSERT_FALSE(tile_set.empty());
+  const auto tile_id = *tile_set.begin();
+  auto old_tile = stale.GetGraphTile(tile_id);
+  ASSERT_TRUE(old_tile);
+  EXPECT_EQ(refreshed.GetGraphTile(tile_id), old_tile);
+
+  // once one of them moves on to the new tileset it no longer shares the old tiles
+  GraphReader::ReloadTileset(pt);
+  EXPECT_TRUE(refreshed.Refresh());
+  auto new_tile = refreshed.GetGraphTile(tile_id);
+  ASSERT_TRUE(new_tile);
+  EXPECT_NE(new_tile, old_tile);
+
+  // and the one still on the old tileset cant hand it any more of them
+  const auto other_id = *std::next(tile_set.begin());
+  auto stale_tile = stale.GetGraphTile(other_id);
+  ASSERT_TRUE(stale_tile);
+  EXPECT_EQ(stale.GetGraphTile(tile_id), old_tile);
+  EXPECT_NE(refreshed.GetGraphTile(other_id), stale_tile);
+
+  // until it moves on too and they share again
+  EXPECT_TRUE(stale.Refresh());
+  EXPECT_EQ(stale.GetGraphTile(tile_id), new_tile);
+  EXPECT_EQ(stale.GetGraphTile(other_id), refreshed.GetGraphTile(other_id));
+}
+
+TEST(GraphReader, TileDirMmap) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader copied(pt);
+  pt.put("tile_dir_mmap", true);
+  GraphReader mapped(pt);
+
+  auto tile_set = copied.GetTileSet();
+  ASSERT_FALSE(tile_set.empty());
+  for (const auto& tile_id : tile_set) {
+    auto expected = copied.GetGraphTile(tile_id);
+    auto tile = mapped.GetGraphTile(tile_id);
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(tile);
+    ASSERT_EQ(tile->header()->end_offset(), expected->header()->end_offset());
+    EXPECT_EQ(std::memcmp(tile->header(), expected->header(), tile->header()->end_offset()), 0);
+  }
+}
+
+TEST(GraphReader, WarmUp) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  pt.put("warm_up_threads", 3);
+  GraphReader reader(pt);
+
+  // everything we have
+  auto tile_set = reader.GetTileSet();
+  ASSERT_FALSE(tile_set.empty());
+  EXPECT_EQ(reader.WarmUp(pt), tile_set.size());
+
+  // just one level
+  boost::property_tree::ptree levels, level;
+  level.put_value(2);
+  levels.push_back(std::make_pair("", level));
+  pt.put_child("warm_up_levels", levels);
+  EXPECT_EQ(reader.WarmUp(pt), reader.GetTileSet(2).size());
+
+  // nothing out in the ocean
+  pt.put("warm_up_bbox", "-30.1,-30.1,-30,-30");
+  EXPECT_EQ(reader.WarmUp(pt), 0);
+  pt.put("warm_up_bbox", "-30,-30");
+  EXPECT_THROW(reader.WarmUp(pt), std::runtime_error);
+
+  // warming up doesnt fill the cache
+  EXPECT_FALSE(reader.GetCacheStats().hits + reader.GetCacheStats().misses);
+}
+
+TEST(SharedMemoryCache, SharedBetweenReaders) {
+  const std::string path = "test/data/shared_tile_cache";
+  filesystem::remove(path);
+
+  boost::property_tree::ptree pt;
+  pt.put("shared_cache_path", path);
+  pt.put("shared_cache_size", 64 * 1024 * 1024);
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader loader(pt);
+
+  auto tile_set = loader.GetTileSet();
+  ASSERT_FALSE(tile_set.empty());
+  for (const auto& tile_id : tile_set) {
+    ASSERT_TRUE(loader.GetGraphTile(tile_id));
+  }
+  EXPECT_EQ(loader.GetCacheStats().misses, tile_set.size());
+
+  // a reader without any tiles of its own finds all of them in the segment
+  pt.put("tile_dir", "");
+  GraphReader sharer(pt);
+  for (const auto& tile_id : tile_set) {
+    auto expected = loader.GetGraphTile(tile_id);
+    auto tile = sharer.GetGraphTile(tile_id);
+    ASSERT_TRUE(tile);
+    ASSERT_EQ(tile->header()->end_offset(), expected->header()->end_offset());
+    EXPECT_EQ(tile->header(), expected->header());
+  }
+  EXPECT_EQ(sharer.GetCacheStats().hits, tile_set.size());
+  EXPECT_EQ(sharer.GetCacheStats().misses, 0);
+
+  // clearing only drops the tiles of this reader
+  sharer.Clear();
+  EXPECT_TRUE(sharer.GetGraphTile(*tile_set.begin()));
+  filesystem::remove(path);
+}
+
+TEST(TileExtract, IndexedAndAligned) {
+  filesystem::remove("test/data/utrecht_tiles_indexed.tar");
+  boost::property_tree::ptree pt;
+  pt.put("mjolnir.tile_dir", "test/data/utrecht_tiles");
+  pt.put("mjolnir.tile_extract", "test/data/utrecht_tiles_indexed.tar");
+  auto loose = test::make_clean_graphreader(pt.get_child("mjolnir"));
+  const auto tile_set = loose->GetTileSet();
+  ASSERT_EQ(valhalla::mjolnir::build_tile_extract(pt), tile_set.size());
+
+  // every tile comes from the index and starts on a page of its own
+  auto packed = test::make_clean_graphreader(pt.get_child("mjolnir"));
+  EXPECT_EQ(packed->GetTileSet().size(), tile_set.size());
+  for (const auto& tile_id : tile_set) {
+    auto expected = loose->GetGraphTile(tile_id);
+    auto tile = packed->GetGraphTile(tile_id);
+    ASSERT_TRUE(tile);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(tile->header()) % 4096, 0);
+    ASSERT_EQ(tile->header()->end_offset(), expected->header()->end_offset());
+    EXPECT_EQ(std::memcmp(tile->header(), expected->header(), expected->header()->end_offset()), 0);
+  }
+
+  // and it is still a tar which has all of the tiles in it
+  valhalla::midgard::tar archive("test/data/utrecht_tiles_indexed.tar");
+  EXPECT_EQ(archive.corrupt_blocks, 0);
+  for (const auto& tile_id : tile_set) {
+    EXPECT_EQ(archive.contents.count(GraphTile::FileSuffix(tile_id)), 1);
+  }
+  filesystem::remove("test/data/utrecht_tiles_indexed.tar");
+}
+
+TEST(TileExtract, Views) {
+  filesystem::remove("test/data/utrecht_tiles_views.tar");
+  boost::property_tree::ptree pt;
+  pt.put("mjolnir.tile_dir", "test/data/utrecht_tiles");
+  pt.put("mjolnir.tile_extract", "test/data/utrecht_tiles_views.tar");
+  auto loose = test::make_clean_graphreader(pt.get_child("mjolnir"));
+  const auto tile_set = loose->GetTileSet();
+  ASSERT_EQ(valhalla::mjolnir::build_tile_extract(pt), tile_set.size());
+  pt.put("mjolnir.tile_extract_views", true);
+  auto viewer = test::make_clean_graphreader(pt.get_child("mjolnir"));
+
+  // whether or not there are views the tiles are the ones in the extract
+  for (const auto& tile_id : tile_set) {
+    auto expected = loose->GetGraphTile(tile_id);
+    auto tile = viewer->GetGraphTile(tile_id);
+    ASSERT_TRUE(tile);
+    ASSERT_EQ(tile->header()->end_offset(), expected->header()->end_offset());
+    EXPECT_EQ(std::memcmp(tile->header(), expected->header(), expected->header()->end_offset()), 0);
+
+    viewer->Clear();
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+    // the views are made up front and dont go away with the cache
+    EXPECT_EQ(viewer->GetGraphTile(tile_id), tile);
+#else
+    // without thread safe reference counts the option is ignored and tiles come from the cache
+    EXPECT_NE(viewer->GetGraphTile(tile_id), tile);
+#endif
+  }
+
+  // and there is nothing for tiles which are not in it
+  const GraphId missing(0, 2, 0);
+  ASSERT_EQ(tile_set.count(missing), 0);
+  EXPECT_FALSE(viewer->GetGraphTile(missing));
+  EXPECT_FALSE(viewer->GetGraphTile(GraphId()));
+  filesystem::remove("test/data/utrecht_tiles_views.tar");
+}
+
+TEST(OpposingEdges, StoredMatchTheTiles) {
+  boost::property_tree::ptree pt;
+  pt.put("mjolnir.tile_dir", "test/data/utrecht_tiles");
+  pt.put("mjolnir.opposing_edges", true);
+  valhalla::mjolnir::OpposingEdgesBuilder::Build(pt);
+  const auto file_name = OpposingEdges::FileName("test/data/utrecht_tiles");
+  OpposingEdges opposing_edges(file_name);
+
+  // the stored ones and those of the tiles are the same, through the reader or not
+  GraphReader stored(pt.get_child("mjolnir"));
+  pt.put("mjolnir.opposing_edges", false);
+  GraphReader reader(pt.get_child("mjolnir"));
+  uint64_t edge_count = 0, boundary_count = 0;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() == TileHierarchy::GetTransitLevel().level) {
+      continue;
+    }
+    auto tile = reader.GetGraphTile(tile_id);
+    for (GraphId edge_id = tile_id; edge_id.id() < tile->header()->directededgecount();
+         ++edge_id, ++edge_count) {
+      const auto expected = reader.GetOpposingEdgeId(edge_id);
+      GraphId found;
+      ASSERT_TRUE(opposing_edges.Find(edge_id, found));
+      ASSERT_EQ(found, expected);
+      EXPECT_EQ(stored.GetOpposingEdgeId(edge_id), expected);
+
+      graph_tile_ptr opp_tile;
+      const DirectedEdge* opp_edge = nullptr;
+      ASSERT_EQ(stored.GetOpposingEdgeId(edge_id, opp_edge, opp_tile), expected);
+      if (expected.Is_Valid()) {
+        ASSERT_EQ(opp_tile->id(), expected.Tile_Base());
+        const auto* expected_edge = reader.GetGraphTile(expected)->directededge(expected);
+        EXPECT_EQ(opp_edge->endnode(), expected_edge->endnode());
+        boundary_count += expected.Tile_Base() != tile_id;
+      }
+    }
+  }
+  EXPECT_EQ(opposing_edges.edge_count(), edge_count);
+  EXPECT_EQ(opposing_edges.boundary_count(), boundary_count);
+  EXPECT_GT(boundary_count, 0);
+
+  // edges of tiles it doesnt know are left to the tiles
+  GraphId found;
+  EXPECT_FALSE(opposing_edges.Find({0, 0, 0}, found));
+  filesystem::remove(file_name);
+}
+
+TEST(TileLinks, FindOnlyTheLinkedTile) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  const auto tile_set = reader.GetTileSet();
+  ASSERT_GE(tile_set.size(), 2);
+  auto from = reader.GetGraphTile(*tile_set.begin());
+  auto to = reader.GetGraphTile(*std::next(tile_set.begin()));
+
+  // nothing is linked until it is asked for
+  EXPECT_EQ(from->links().find(to->id()), nullptr);
+  from->links().link(to.get());
+  EXPECT_EQ(from->links().find(to->id()), to.get());
+  EXPECT_EQ(from->links().find(from->id()), nullptr);
+  EXPECT_EQ(to->links().find(to->id()), nullptr);
+
+  from->links().clear();
+  EXPECT_EQ(from->links().find(to->id()), nullptr);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
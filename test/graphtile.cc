@@ -118,6 +118,65 @@ TEST(GraphTileIntegrity, SizeLessThanPayload) {
                std::runtime_error);
 }
 
+struct departures_graphtile : public GraphTile {
+  departures_graphtile(std::vector<TransitDeparture>& departures,
+                       std::vector<TransitSchedule>& schedules) {
+    header_ = new GraphTileHeader();
+    header_->set_departurecount(departures.size());
+    header_->set_schedulecount(schedules.size());
+    departures_ = departures.data();
+    transit_schedules_ = schedules.data();
+    departure_index_.reset(new departure_index_t());
+  }
+  ~departures_graphtile() {
+    delete header_;
+  }
+};
+
+TEST(Graphtile, NextDeparture) {
+  // runs every day, runs on no day and runs on day 1 only
+  std::vector<TransitSchedule> schedules{{~0ULL, 127, 63}, {0, 0, 63}, {2, 0, 63}};
+  std::vector<TransitDeparture> departures{
+      {1, 10, 0, 0, 0, 28800, 60, 0, true, false},
+      {1, 11, 0, 0, 0, 29400, 60, 1, true, false},
+      {1, 12, 0, 0, 0, 30000, 60, 2, false, false},
+      {1, 13, 0, 0, 0, 30600, 60, 0, false, true},
+      {2, 20, 0, 0, 0, 27000, 36000, 900, 60, 0, true, true},
+      {2, 21, 0, 0, 0, 28850, 60, 0, true, true},
+  };
+  departures_graphtile tile(departures, schedules);
+
+  auto trip = [&tile](const uint32_t lineid, const uint32_t time, const uint32_t day,
+                      const bool wheelchair = false, const bool bicycle = false) {
+    const auto* departure = tile.GetNextDeparture(lineid, time, day, 1, false, wheelchair, bicycle);
+    return departure ? departure->tripid() : 0;
+  };
+
+  // the ones that dont run that day are skipped
+  EXPECT_EQ(trip(1, 28000, 0), 10);
+  EXPECT_EQ(trip(1, 28801, 0), 13);
+  EXPECT_EQ(trip(1, 28801, 1), 12);
+  EXPECT_EQ(trip(1, 30601, 0), 0);
+
+  // as are the ones lacking the access asked for
+  EXPECT_EQ(trip(1, 28801, 1, true), 0);
+  EXPECT_EQ(trip(1, 28000, 0, false, true), 13);
+
+  // the frequency based one leaves every 15 minutes but a fixed one may go first
+  EXPECT_EQ(trip(2, 28000, 0), 20);
+  const auto* departure = tile.GetNextDeparture(2, 28000, 0, 1, false, false, false);
+  EXPECT_EQ(departure->departure_time(), 27000 + 1800);
+  delete departure;
+  EXPECT_EQ(trip(2, 28801, 0), 21);
+  EXPECT_EQ(trip(2, 40000, 0), 0);
+  EXPECT_EQ(trip(3, 28000, 0), 0);
+
+  // and by trip
+  ASSERT_NE(tile.GetTransitDeparture(1, 12, 28000), nullptr);
+  EXPECT_EQ(tile.GetTransitDeparture(1, 12, 28000)->departure_time(), 30000);
+  EXPECT_EQ(tile.GetTransitDeparture(1, 12, 30001), nullptr);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1,11 +1,15 @@
 #include "test.h"
 
 #include "baldr/graphid.h"
+#include "baldr/graphtile.h"
 #include "baldr/tilehierarchy.h"
 #include "midgard/encoded.h"
 #include "midgard/pointll.h"
+#include "filesystem.h"
+#include "mjolnir/complexrestrictionbuilder.h"
 #include "mjolnir/graphtilebuilder.h"
 #include <fstream>
+#include <iterator>
 #include <streambuf>
 #include <string>
 #include <vector>
@@ -244,6 +248,219 @@ TEST(GraphTileBuilder, TestAddBins) {
   }
 }
 
+TEST(GraphTileBuilder, TestCompactTile) {
+  GraphId id(818660, 2, 0);
+  std::ifstream file("test/data/utrecht_tiles/2/000/818/660.gph", std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  ASSERT_FALSE(bytes.empty()) << "Couldn't load test tile";
+  auto compact_bytes = GraphTile::CompactTile(bytes);
+  EXPECT_LT(compact_bytes.size(), bytes.size());
+  EXPECT_EQ(GraphTile::CompactTile(compact_bytes), compact_bytes) << "Compacted it twice";
+
+  auto tile = GraphTile::Create(id, std::vector<char>(bytes));
+  auto compact = GraphTile::Create(id, std::vector<char>(compact_bytes));
+  ASSERT_TRUE(compact->header()->compressed_sections_offset());
+  ASSERT_EQ(tile->header()->nodecount(), compact->header()->nodecount());
+  ASSERT_EQ(tile->header()->directededgecount(), compact->header()->directededgecount());
+  EXPECT_EQ(memcmp(tile->directededge(0), compact->directededge(0),
+                   tile->header()->directededgecount() * sizeof(DirectedEdge)),
+            0);
+
+  // everything in the deflated sections is the same once inflated
+  for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+    const auto* edge = tile->directededge(i);
+    auto info = tile->edgeinfo(edge->edgeinfo_offset());
+    auto compact_info = compact->edgeinfo(edge->edgeinfo_offset());
+    EXPECT_EQ(info.encoded_shape(), compact_info.encoded_shape());
+    EXPECT_EQ(info.GetNames(), compact_info.GetNames());
+    if (edge->end_restriction()) {
+      EXPECT_EQ(tile->GetRestrictions(true, id + i, kAllAccess).size(),
+                compact->GetRestrictions(true, id + i, kAllAccess).size());
+    }
+    if (edge->sign()) {
+      EXPECT_EQ(tile->GetSigns(i).size(), compact->GetSigns(i).size());
+    }
+    if (edge->laneconnectivity()) {
+      EXPECT_EQ(tile->GetLaneConnectivity(i).size(), compact->GetLaneConnectivity(i).size());
+    }
+  }
+  for (uint32_t i = 0; i < tile->header()->admincount(); ++i) {
+    EXPECT_EQ(tile->admininfo(i), compact->admininfo(i));
+  }
+
+  // reading a compact tile into a builder stores all of it again
+  std::string test_dir = "test/data/compact_tiles";
+  GraphTile::SaveTileToFile(compact_bytes,
+                            test_dir + filesystem::path::preferred_separator +
+                                GraphTile::FileSuffix(id));
+  GraphTileBuilder builder(test_dir, id, true);
+  builder.StoreTileData();
+  auto rebuilt = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(rebuilt);
+  EXPECT_FALSE(rebuilt->header()->compressed_sections_offset());
+  EXPECT_EQ(rebuilt->header()->end_offset(), tile->header()->end_offset());
+}
+
+TEST(GraphTileBuilder, TestElevationProfiles) {
+  GraphId id(818660, 2, 0);
+  std::ifstream file("test/data/utrecht_tiles/2/000/818/660.gph", std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  ASSERT_FALSE(bytes.empty()) << "Couldn't load test tile";
+  std::string test_dir = "test/data/elevation_profiles";
+  GraphTile::SaveTileToFile(bytes, test_dir + filesystem::path::preferred_separator +
+                                       GraphTile::FileSuffix(id));
+
+  // the first two edges share a profile, the third has one of its own and the rest have none
+  const std::vector<double> heights{12.5, 13.25, 11.75, -2.0, 310.0};
+  {
+    GraphTileBuilder builder(test_dir, id, true);
+    auto offset = builder.AddElevationProfile(0, heights);
+    builder.SetElevationProfile(1, offset);
+    builder.AddElevationProfile(2, {1.0, 2.0});
+    builder.StoreTileData();
+  }
+  auto tile = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(tile);
+  ASSERT_TRUE(tile->header()->elevation_profiles_offset());
+  auto expect_profiles = [&heights](const graph_tile_ptr& tile) {
+    for (uint32_t i = 0; i < 2; ++i) {
+      const auto* edge = tile->directededge(i);
+      auto profile = tile->GetElevationProfile(edge);
+      std::vector<float> expected(heights.begin(), heights.end());
+      if (!edge->forward()) {
+        std::reverse(expected.begin(), expected.end());
+      }
+      EXPECT_EQ(profile, expected);
+    }
+    EXPECT_EQ(tile->GetElevationProfile(tile->directededge(2)).size(), 2);
+    for (uint32_t i = 3; i < tile->header()->directededgecount(); ++i) {
+      EXPECT_TRUE(tile->GetElevationProfile(tile->directededge(i)).empty());
+    }
+  };
+  expect_profiles(tile);
+
+  // they are still there once the tile is compacted or stored again
+  auto stored = tile->header()->end_offset();
+  std::ifstream profiled(test_dir + filesystem::path::preferred_separator +
+                             GraphTile::FileSuffix(id),
+                         std::ios::binary);
+  bytes.assign(std::istreambuf_iterator<char>(profiled), std::istreambuf_iterator<char>());
+  expect_profiles(GraphTile::Create(id, GraphTile::CompactTile(bytes)));
+  {
+    GraphTileBuilder builder(test_dir, id, true);
+    builder.StoreTileData();
+  }
+  tile = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(tile);
+  EXPECT_EQ(tile->header()->end_offset(), stored);
+  expect_profiles(tile);
+}
+
+TEST(GraphTileBuilder, TestEdgeBounds) {
+  GraphId id(818660, 2, 0);
+  std::ifstream file("test/data/utrecht_tiles/2/000/818/660.gph", std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  ASSERT_FALSE(bytes.empty()) << "Couldn't load test tile";
+  std::string test_dir = "test/data/edge_bounds";
+  GraphTile::SaveTileToFile(bytes, test_dir + filesystem::path::preferred_separator +
+                                       GraphTile::FileSuffix(id));
+  auto original = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(original);
+
+  // the bounds hold all of the shape and are at most a few units larger than it
+  GraphTileBuilder::AddEdgeBounds(test_dir, original);
+  auto tile = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(tile);
+  ASSERT_TRUE(tile->header()->edge_bounds_offset());
+  const auto tile_bounds = tile->BoundingBox();
+  const double unit = tile_bounds.Width() / kEdgeBoundsUnits;
+  for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+    const auto shape = tile->edgeinfo(tile->directededge(i)->edgeinfo_offset()).shape();
+    const auto bounds = tile->GetEdgeBounds(i);
+    AABB2<PointLL> shape_bounds(shape);
+    EXPECT_LE(bounds.minx(), shape_bounds.minx());
+    EXPECT_LE(bounds.miny(), shape_bounds.miny());
+    EXPECT_GE(bounds.maxx(), shape_bounds.maxx());
+    EXPECT_GE(bounds.maxy(), shape_bounds.maxy());
+    EXPECT_LT(bounds.Width(), shape_bounds.Width() + 5 * unit);
+    EXPECT_EQ(tile->edgeinfo(tile->directededge(i)->edgeinfo_offset()).encoded_shape(),
+              original->edgeinfo(original->directededge(i)->edgeinfo_offset()).encoded_shape());
+  }
+  for (size_t i = 0; i < kBinCount; ++i) {
+    EXPECT_EQ(tile->GetBin(i).size(), original->GetBin(i).size());
+  }
+
+  // adding them again replaces them
+  const auto size = tile->header()->end_offset();
+  GraphTileBuilder::AddEdgeBounds(test_dir, tile);
+  tile = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(tile);
+  EXPECT_EQ(tile->header()->end_offset(), size);
+  EXPECT_EQ(tile->GetEdgeBounds(0), GraphTile::Create(test_dir, id)->GetEdgeBounds(0));
+}
+
+TEST(GraphTileBuilder, TestTruckRestrictions) {
+  GraphId id(818660, 2, 0);
+  std::ifstream file("test/data/utrecht_tiles/2/000/818/660.gph", std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  ASSERT_FALSE(bytes.empty()) << "Couldn't load test tile";
+  std::string test_dir = "test/data/truck_restrictions";
+  GraphTile::SaveTileToFile(bytes, test_dir + filesystem::path::preferred_separator +
+                                       GraphTile::FileSuffix(id));
+
+  // restrict a few edges that dont have any restrictions yet
+  std::vector<uint32_t> edges;
+  {
+    auto original = GraphTile::Create(test_dir, id);
+    ASSERT_TRUE(original);
+    for (uint32_t i = 0; i < original->header()->directededgecount() && edges.size() < 4; ++i) {
+      if (original->GetAccessRestrictionRange(i, kAllAccess).empty()) {
+        edges.push_back(i);
+      }
+    }
+    ASSERT_EQ(edges.size(), 4);
+    GraphTileBuilder builder(test_dir, id, true);
+    // a 4m height limit and a tighter 3.6m one, a 7.5t weight limit for cars and a 30t one
+    for (const auto& restriction : std::vector<AccessRestriction>{
+             AccessRestriction(edges[0], AccessType::kMaxHeight, kAllAccess, 400),
+             AccessRestriction(edges[0], AccessType::kMaxHeight, kTruckAccess, 360),
+             AccessRestriction(edges[1], AccessType::kMaxWeight, kAutoAccess, 750),
+             AccessRestriction(edges[1], AccessType::kMaxWeight, kTruckAccess, 3000),
+             // hazmat and a width limit smaller than any bucket have to be looked at
+             AccessRestriction(edges[2], AccessType::kHazmat, kTruckAccess, 0),
+             AccessRestriction(edges[3], AccessType::kMaxWidth, kTruckAccess, 150),
+         }) {
+      builder.AddAccessRestriction(restriction);
+    }
+    builder.StoreTileData();
+  }
+  auto tile = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(tile);
+  ASSERT_TRUE(tile->header()->truck_restrictions_offset());
+  ASSERT_FALSE(tile->GetTruckRestrictions(tile->header()->directededgecount()));
+
+  const auto* height = tile->GetTruckRestrictions(edges[0]);
+  ASSERT_TRUE(height);
+  EXPECT_EQ(height->bucket(0), 4);
+  EXPECT_FALSE(height->check_restrictions());
+  const auto* weight = tile->GetTruckRestrictions(edges[1]);
+  ASSERT_TRUE(weight);
+  EXPECT_EQ(weight->bucket(3), 6);
+  EXPECT_EQ(weight->bucket(0), 0);
+  EXPECT_TRUE(tile->GetTruckRestrictions(edges[2])->check_restrictions());
+  EXPECT_TRUE(tile->GetTruckRestrictions(edges[3])->check_restrictions());
+
+  // a truck only passes the buckets that are entirely above its size and weight
+  auto passed = TruckRestrictions::PassedBuckets(3.5f, 2.5f, 12.f, 20.f, 9.f);
+  EXPECT_TRUE(height->Passes(passed));
+  EXPECT_TRUE(weight->Passes(passed));
+  EXPECT_FALSE(tile->GetTruckRestrictions(edges[2])->Passes(passed));
+  passed = TruckRestrictions::PassedBuckets(3.8f, 2.5f, 12.f, 26.5f, 9.f);
+  EXPECT_FALSE(height->Passes(passed));
+  EXPECT_FALSE(weight->Passes(passed));
+  EXPECT_TRUE(TruckRestrictions().Passes(passed));
+}
+
 struct fake_tile : public GraphTile {
 public:
   fake_tile(const std::string& plyenc_shape) {
@@ -280,6 +497,92 @@ public:
   }
 };
 
+TEST(GraphTileBuilder, TestRestrictionIndex) {
+  GraphId id(818660, 2, 0);
+  std::string test_dir = "test/data/restriction_index";
+  {
+    GraphTileBuilder builder(test_dir, id, false);
+    // every third restriction ends on the same edge and every other one is only for pedestrians
+    for (uint32_t i = 0; i < 30; ++i) {
+      ComplexRestrictionBuilder restriction;
+      restriction.set_from_id(id + (100 + i % 5));
+      restriction.set_to_id(id + (i % 3));
+      restriction.set_via_list({id + (200 + i)});
+      restriction.set_type(RestrictionType::kNoLeftTurn);
+      restriction.set_modes(i % 2 ? kPedestrianAccess : kAutoAccess);
+      builder.AddForwardComplexRestriction(restriction);
+      builder.AddReverseComplexRestriction(restriction);
+    }
+    builder.StoreTileData();
+  }
+  auto tile = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(tile);
+
+  // the ones which end on the edge for the modes in the order they were added
+  auto forward = tile->GetRestrictions(true, id + 1, kAutoAccess);
+  std::vector<uint64_t> vias;
+  for (const auto* restriction : forward) {
+    EXPECT_EQ(restriction->to_graphid(), id + 1);
+    restriction->WalkVias([&vias](const GraphId* via) {
+      vias.push_back(via->id());
+      return WalkingVia::KeepWalking;
+    });
+  }
+  EXPECT_EQ(vias, (std::vector<uint64_t>{204, 210, 216, 222, 228}));
+  EXPECT_EQ(tile->GetRestrictions(true, id + 1, kAllAccess).size(), 10);
+  EXPECT_TRUE(tile->GetRestrictions(true, id + 3, kAllAccess).empty());
+  EXPECT_TRUE(tile->GetRestrictions(true, id + 1, kBicycleAccess).empty());
+
+  // and the ones which start on it
+  auto reverse = tile->GetRestrictions(false, id + 102, kPedestrianAccess);
+  ASSERT_EQ(reverse.size(), 3);
+  EXPECT_EQ(reverse.front()->from_graphid(), id + 102);
+  EXPECT_EQ(reverse.front()->to_graphid(), id + 1);
+}
+
+TEST(GraphTileBuilder, TestAccessAndLaneRanges) {
+  GraphId id(818660, 2, 0);
+  std::string test_dir = "test/data/restriction_index";
+  {
+    GraphTileBuilder builder(test_dir, id, false);
+    // every edge gets a truck and a timed auto restriction, every other one a lane connection
+    for (uint32_t i = 0; i < 20; ++i) {
+      builder.AddAccessRestriction(
+          AccessRestriction(19 - i, AccessType::kMaxHeight, kTruckAccess, 400 + i));
+      builder.AddAccessRestriction(
+          AccessRestriction(19 - i, AccessType::kTimedDenied, kAutoAccess, 100 + i));
+      if (i % 2) {
+        builder.AddLaneConnectivity({LaneConnectivity(i, 1000 + i, "1|2", "1"),
+                                     LaneConnectivity(i, 2000 + i, "2", "2")});
+      }
+    }
+    builder.StoreTileData();
+  }
+  auto tile = GraphTile::Create(test_dir, id);
+  ASSERT_TRUE(tile);
+
+  for (uint32_t i = 0; i < 20; ++i) {
+    // the same restrictions as the copies, only for the modes asked for
+    auto range = tile->GetAccessRestrictionRange(i, kTruckAccess);
+    auto copies = tile->GetAccessRestrictions(i, kTruckAccess);
+    ASSERT_EQ(range.size(), copies.size());
+    ASSERT_EQ(range.size(), 1);
+    EXPECT_EQ(range[0].edgeindex(), i);
+    EXPECT_EQ(range[0].type(), AccessType::kMaxHeight);
+    EXPECT_EQ(range[0].value(), copies[0].value());
+    EXPECT_EQ(tile->GetAccessRestrictionRange(i, kAutoAccess | kTruckAccess).size(), 2);
+    EXPECT_TRUE(tile->GetAccessRestrictionRange(i, kBicycleAccess).empty());
+
+    auto lanes = tile->GetLaneConnectivityRange(i);
+    ASSERT_EQ(lanes.size(), i % 2 ? 2 : 0);
+    for (const auto& lane : lanes) {
+      EXPECT_EQ(lane.to(), i);
+    }
+  }
+  EXPECT_TRUE(tile->GetAccessRestrictionRange(20, kAllAccess).empty());
+  EXPECT_EQ(tile->GetLaneConnectivityRange(20).size(), 0);
+}
+
 TEST(GraphTileBuilder, TestBinEdges) {
   std::string encoded_shape5 =
       "gsoyLcpczmFgJOsMzAwGtDmDtEmApG|@tE|EdF~PjKlRjLbKhLrJnTdD`\\oEz`@wAlJKjVnHfMpRbQdQbRvTtNrM~"
@@ -128,6 +128,19 @@ TEST(GraphtileHeader, TestWriteRead) {
   EXPECT_THROW(hdr.bin_offset(kBinCount + 1), std::runtime_error);
 }
 
+TEST(GraphtileHeader, OccupiedBins) {
+  GraphTileHeader hdr;
+  EXPECT_EQ(hdr.occupied_bins(), 0);
+
+  // edges in the first, the third and the last bin
+  uint32_t offsets[kBinCount];
+  for (size_t i = 0; i < kBinCount; ++i) {
+    offsets[i] = i < 2 ? 3 : (i < kBinCount - 1 ? 5 : 6);
+  }
+  hdr.set_edge_bin_offsets(offsets);
+  EXPECT_EQ(hdr.occupied_bins(), (1u << 0) | (1u << 2) | (1u << (kBinCount - 1)));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
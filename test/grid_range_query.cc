@@ -1,5 +1,8 @@
 // -*- mode: c++ -*-
 
+#include <algorithm>
+#include <vector>
+
 #include "midgard/linesegment2.h"
 #include "midgard/pointll.h"
 
@@ -68,6 +71,30 @@ TEST(GridRangeQuery, TestQuery) {
   EXPECT_NE(items.find(0), items.end()) << "query should get item 0";
 }
 
+TEST(GridRangeQuery, TestQueryIntoVector) {
+  const BoundingBox bbox(0, 0, 100, 100);
+  meili::GridRangeQuery<int, midgard::PointLL> grid(bbox, 1.f, 1.f);
+
+  grid.AddLineSegment(3, LineSegment({2.5, 3.5}, {10, 3.5}));
+  grid.AddLineSegment(1, LineSegment({3.5, 2.5}, {3.5, 10}));
+
+  // the items cross many squares of the range but come out once each and in order
+  std::vector<int> items{7, 7, 7};
+  grid.Query(BoundingBox(2, 2, 5, 5), items);
+  EXPECT_EQ(items, (std::vector<int>{1, 3}));
+
+  grid.Query(BoundingBox(10.5, 10.5, 20, 20), items);
+  EXPECT_TRUE(items.empty()) << "query should get nothing";
+
+  grid.Query(BoundingBox(2, 3, 2.5, 3.5), items);
+  EXPECT_EQ(items, std::vector<int>{3});
+
+  // appending keeps what was there and repeats the items of every square
+  grid.AppendItems(BoundingBox(2, 3, 4.5, 3.5), items);
+  EXPECT_EQ(std::count(items.begin(), items.end(), 3), 4);
+  EXPECT_EQ(std::count(items.begin(), items.end(), 1), 1);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
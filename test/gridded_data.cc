@@ -1,5 +1,7 @@
 #include "midgard/gridded_data.h"
 #include "midgard/pointll.h"
+#include <algorithm>
+#include <cmath>
 #include <limits>
 //#include <iostream>
 
@@ -78,6 +80,33 @@ TEST(GriddedData, Basic) {
   */
 }
 
+TEST(GriddedData, SameContoursInParallel) {
+  // two metrics with some bumps and holes in them
+  GriddedData<2> g({-1, -1, 1, 1}, 0.01f, {120.f, 200.f});
+  for (int i = 0; i < 200; ++i) {
+    for (int j = 0; j < 200; ++j) {
+      if ((i * 7 + j * 3) % 37 == 0) {
+        continue;
+      }
+      auto c = g.Center(g.TileId(i, j));
+      float d = std::sqrt(c.first * c.first + c.second * c.second);
+      float t = d * 90 + 10 * std::sin(c.first * 13) * std::cos(c.second * 7);
+      g.SetIfLessThan(g.TileId(i, j), {std::max(t, 0.f), d * 100});
+    }
+  }
+
+  for (bool rings : {false, true}) {
+    std::vector<GriddedData<2>::contour_interval_t> intervals{
+        {0, 10, "time", ""}, {0, 30, "time", ""}, {0, 60, "time", ""}, {1, 50, "distance", ""}};
+    auto expected = g.GenerateContours(intervals, rings, 0.1f, 200.f);
+    ASSERT_EQ(expected.size(), intervals.size());
+    for (unsigned int threads : {2, 3, 8}) {
+      auto actual = g.GenerateContours(intervals, rings, 0.1f, 200.f, threads);
+      EXPECT_EQ(actual, expected) << threads << " threads should make the same contours";
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
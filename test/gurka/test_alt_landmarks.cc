@@ -0,0 +1,123 @@
+#include "baldr/altlandmarks.h"
+#include "gurka.h"
+#include "mjolnir/altlandmarkbuilder.h"
+#include "test.h"
+#include "thor/astarheuristic.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class AltLandmarksTest : public ::testing::Test {
+protected:
+  static gurka::map alt_map;
+  static gurka::map plain_map;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 100;
+
+    // the way from A to C goes all the way around through B and D
+    const std::string ascii_map = R"(
+      A--------B
+      |        |
+      E        |
+               |
+      C--------D
+    )";
+
+    const gurka::ways ways = {
+        {"AB", {{"highway", "residential"}}},
+        {"BD", {{"highway", "residential"}}},
+        {"DC", {{"highway", "residential"}}},
+        {"AE", {{"highway", "residential"}, {"oneway", "yes"}}},
+    };
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
+    alt_map = gurka::buildtiles(layout, ways, {}, {}, "test/data/alt_landmarks",
+                                {{"mjolnir.concurrency", "1"}, {"mjolnir.alt_landmarks", "auto"}});
+    mjolnir::AltLandmarkBuilder::Build(alt_map.config);
+
+    // the same tiles without the landmarks to compare against
+    plain_map = alt_map;
+    plain_map.config.get_child("mjolnir").erase("alt_landmarks");
+  }
+
+  // a location on an edge which starts at the node if toward, else one which ends there
+  valhalla::Location location(baldr::GraphReader& reader,
+                              const std::string& node,
+                              const std::string& other,
+                              const bool toward) {
+    valhalla::Location location;
+    auto edge = toward ? gurka::findEdgeByNodes(reader, alt_map.nodes, node, other)
+                       : gurka::findEdgeByNodes(reader, alt_map.nodes, other, node);
+    location.add_path_edges()->set_graph_id(std::get<0>(edge).value);
+    return location;
+  }
+};
+
+gurka::map AltLandmarksTest::alt_map = {};
+gurka::map AltLandmarksTest::plain_map = {};
+
+TEST_F(AltLandmarksTest, BoundsUnderestimate) {
+  baldr::AltLandmarks landmarks(
+      baldr::AltLandmarks::FileName(alt_map.config.get<std::string>("mjolnir.tile_dir"), "auto"));
+  ASSERT_GT(landmarks.count(), 0);
+  auto reader = test::make_clean_graphreader(alt_map.config.get_child("mjolnir"));
+
+  // a neighbor of every node, to find the node and edges at it
+  const std::map<std::string, std::string> neighbors = {
+      {"A", "B"}, {"B", "D"}, {"C", "D"}, {"D", "B"}, {"E", "A"}};
+  auto node_id = [&](const std::string& node) {
+    return std::get<1>(gurka::findEdgeByNodes(*reader, alt_map.nodes, neighbors.at(node), node))
+        ->endnode();
+  };
+
+  for (const auto& from : neighbors) {
+    for (const auto& to : neighbors) {
+      // E is a dead end behind a oneway
+      if (from.first == to.first || from.first == "E") {
+        continue;
+      }
+      auto result = gurka::route(alt_map, from.first, to.first, "auto");
+      const float length = result.directions().routes(0).legs(0).summary().length() * 1000.f;
+
+      thor::AStarHeuristic toward, away;
+      toward.Init(alt_map.nodes.at(to.first), 1.f);
+      toward.InitLandmarks(&landmarks, *reader, location(*reader, to.first, to.second, true), true);
+      away.Init(alt_map.nodes.at(from.first), 1.f);
+      away.InitLandmarks(&landmarks, *reader, location(*reader, from.first, from.second, false),
+                         false);
+      EXPECT_LE(toward.GetLandmarkDistance(node_id(from.first)), length + 1.f)
+          << from.first << to.first;
+      EXPECT_LE(away.GetLandmarkDistance(node_id(to.first)), length + 1.f)
+          << from.first << to.first;
+    }
+  }
+
+  // around the corner the landmarks know a lot better than the straight line
+  thor::AStarHeuristic heuristic;
+  heuristic.Init(alt_map.nodes.at("C"), 1.f);
+  heuristic.InitLandmarks(&landmarks, *reader, location(*reader, "C", "D", true), true);
+  EXPECT_GT(heuristic.GetLandmarkDistance(node_id("A")),
+            2.f * heuristic.GetDistance(alt_map.nodes.at("A")));
+}
+
+TEST_F(AltLandmarksTest, SamePaths) {
+  for (const auto& request : std::vector<std::unordered_map<std::string, std::string>>{
+           {},
+           {{"/date_time/type", "1"}, {"/date_time/value", "2020-10-30T09:00"}},
+           {{"/date_time/type", "2"}, {"/date_time/value", "2020-10-30T09:00"}}}) {
+    for (const auto& locations : std::vector<std::vector<std::string>>{{"A", "C"}, {"C", "E"}}) {
+      auto expected = gurka::route(plain_map, locations, "auto", request);
+      auto actual = gurka::route(alt_map, locations, "auto", request);
+      std::vector<std::string> names;
+      for (const auto& node : expected.trip().routes(0).legs(0).node()) {
+        if (node.has_edge()) {
+          names.push_back(node.edge().name(0).value());
+        }
+      }
+      gurka::assert::raw::expect_path(actual, names);
+      EXPECT_NEAR(actual.directions().routes(0).legs(0).summary().time(),
+                  expected.directions().routes(0).legs(0).summary().time(), 0.1);
+    }
+  }
+}
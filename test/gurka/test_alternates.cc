@@ -0,0 +1,61 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+std::vector<std::string> route_names(const valhalla::Api& result, const int route) {
+  std::vector<std::string> names;
+  for (const auto& leg : result.trip().routes(route).legs()) {
+    for (const auto& node : leg.node()) {
+      if (node.has_edge()) {
+        names.push_back(node.edge().name(0).value());
+      }
+    }
+  }
+  return names;
+}
+
+} // namespace
+
+class AlternatesTest : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 100;
+
+    // the way around through D and F is a bit longer than the one through B
+    const std::string ascii_map = R"(
+      A-----------B-----------C
+      |                       |
+      D-----------E-----------F
+    )";
+
+    const gurka::ways ways = {
+        {"AB", {{"highway", "residential"}}}, {"BC", {{"highway", "residential"}}},
+        {"AD", {{"highway", "residential"}}}, {"DE", {{"highway", "residential"}}},
+        {"EF", {{"highway", "residential"}}}, {"FC", {{"highway", "residential"}}},
+    };
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/alternates");
+  }
+};
+
+gurka::map AlternatesTest::map = {};
+
+TEST_F(AlternatesTest, OnePathPerPlateau) {
+  // all the connections along either way make the same path, only two different ones come out
+  auto result = gurka::route(map, "A", "C", "auto", {{"/alternates", "2"}});
+  ASSERT_EQ(result.trip().routes_size(), 2);
+  EXPECT_EQ(route_names(result, 0), (std::vector<std::string>{"AB", "BC"}));
+  EXPECT_EQ(route_names(result, 1), (std::vector<std::string>{"AD", "DE", "EF", "FC"}));
+}
+
+TEST_F(AlternatesTest, NoAlternatesWithoutAsking) {
+  auto result = gurka::route(map, "A", "C", "auto");
+  ASSERT_EQ(result.trip().routes_size(), 1);
+  EXPECT_EQ(route_names(result, 0), (std::vector<std::string>{"AB", "BC"}));
+}
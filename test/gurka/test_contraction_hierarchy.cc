@@ -0,0 +1,149 @@
+#include "baldr/rapidjson_utils.h"
+#include "gurka.h"
+#include "mjolnir/contractionbuilder.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class ContractionHierarchyTest : public ::testing::Test {
+protected:
+  static gurka::map ch_map;
+  static gurka::map plain_map;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 100;
+
+    const std::string ascii_map = R"(
+      A----B----C----D
+      |    |    |    |
+      E----F----G----H
+      |    |    |    |
+      I----J----K----L
+    )";
+
+    const gurka::ways ways = {
+        {"AB", {{"highway", "residential"}}},
+        {"BC", {{"highway", "primary"}}},
+        {"CD", {{"highway", "residential"}}},
+        {"EF", {{"highway", "secondary"}}},
+        {"FG", {{"highway", "secondary"}, {"oneway", "yes"}}},
+        {"GH", {{"highway", "tertiary"}}},
+        {"IJ", {{"highway", "residential"}}},
+        {"JK", {{"highway", "primary"}}},
+        {"KL", {{"highway", "residential"}, {"oneway", "-1"}}},
+        {"AE", {{"highway", "tertiary"}}},
+        {"EI", {{"highway", "residential"}}},
+        {"BF", {{"highway", "residential"}, {"oneway", "yes"}}},
+        {"FJ", {{"highway", "tertiary"}}},
+        {"CG", {{"highway", "primary"}}},
+        {"GK", {{"highway", "residential"}}},
+        {"DH", {{"highway", "secondary"}}},
+        {"HL", {{"highway", "residential"}}},
+    };
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
+    ch_map = gurka::buildtiles(layout, ways, {}, {}, "test/data/contraction_hierarchy",
+                               {{"mjolnir.concurrency", "1"},
+                                {"mjolnir.contraction_hierarchies", "auto"}});
+    mjolnir::ContractionBuilder::Build(ch_map.config);
+
+    // the same tiles without the hierarchy to compare against
+    plain_map = ch_map;
+    plain_map.config.get_child("mjolnir").erase("contraction_hierarchies");
+  }
+
+  void compare(const std::string& from, const std::string& to) {
+    auto expected = gurka::route(plain_map, from, to, "auto");
+    auto actual = gurka::route(ch_map, from, to, "auto");
+    EXPECT_EQ(actual.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+    EXPECT_NE(expected.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+
+    std::vector<std::string> names;
+    for (const auto& node : expected.trip().routes(0).legs(0).node()) {
+      if (node.has_edge()) {
+        names.push_back(node.edge().name(0).value());
+      }
+    }
+    gurka::assert::raw::expect_path(actual, names);
+    EXPECT_NEAR(actual.directions().routes(0).legs(0).summary().time(),
+                expected.directions().routes(0).legs(0).summary().time(), 0.1);
+  }
+
+  std::string matrix(const gurka::map& map, const std::vector<std::string>& names) {
+    std::string locations;
+    for (const auto& name : names) {
+      const auto& ll = map.nodes.at(name);
+      locations += (locations.empty() ? "" : ",") + std::string("{\"lat\":") +
+                   std::to_string(ll.lat()) + ",\"lon\":" + std::to_string(ll.lng()) + "}";
+    }
+    auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+    tyr::actor_t actor(map.config, *reader, true);
+    return actor.matrix(R"({"costing":"auto","sources":[)" + locations + R"(],"targets":[)" +
+                        locations + "]}");
+  }
+};
+
+gurka::map ContractionHierarchyTest::ch_map = {};
+gurka::map ContractionHierarchyTest::plain_map = {};
+
+TEST_F(ContractionHierarchyTest, SamePathsAsBidirectional) {
+  compare("A", "L");
+  compare("L", "A");
+  compare("D", "I");
+  compare("I", "D");
+  compare("B", "K");
+  compare("K", "B");
+}
+
+TEST_F(ContractionHierarchyTest, NonDefaultOptionsFallBack) {
+  auto result =
+      gurka::route(ch_map, "A", "L", "auto", {{"/costing_options/auto/use_highways", "0.1"}});
+  EXPECT_NE(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+}
+
+TEST_F(ContractionHierarchyTest, TimeDependentFallsBack) {
+  auto result = gurka::route(ch_map, "A", "L", "auto",
+                             {{"/date_time/type", "1"}, {"/date_time/value", "2020-10-30T09:00"}});
+  EXPECT_NE(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+}
+
+TEST_F(ContractionHierarchyTest, LiveTrafficFallsBack) {
+  auto traffic_map = ch_map;
+  traffic_map.config.put("mjolnir.traffic_extract", "test/data/contraction_hierarchy/traffic.tar");
+  test::build_live_traffic_data(traffic_map.config);
+  auto reader = test::make_clean_graphreader(traffic_map.config.get_child("mjolnir"));
+
+  // the hierarchy doesnt know the live speeds
+  auto result = gurka::route(traffic_map, "A", "L", "auto",
+                             {{"/costing_options/auto/speed_types/0", "freeflow"},
+                              {"/costing_options/auto/speed_types/1", "constrained"},
+                              {"/costing_options/auto/speed_types/2", "predicted"},
+                              {"/costing_options/auto/speed_types/3", "current"}},
+                             reader);
+  EXPECT_NE(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+
+  // unless the costing leaves them out
+  result = gurka::route(traffic_map, "A", "L", "auto", {}, reader);
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+}
+
+TEST_F(ContractionHierarchyTest, MatrixMatchesCostMatrix) {
+  const std::vector<std::string> names{"A", "D", "F", "I", "K", "L"};
+  rapidjson::Document expected, actual;
+  expected.Parse(matrix(plain_map, names));
+  actual.Parse(matrix(ch_map, names));
+
+  const auto& expected_rows = expected["sources_to_targets"];
+  const auto& actual_rows = actual["sources_to_targets"];
+  ASSERT_EQ(actual_rows.Size(), names.size());
+  for (rapidjson::SizeType i = 0; i < names.size(); ++i) {
+    for (rapidjson::SizeType j = 0; j < names.size(); ++j) {
+      const auto& e = expected_rows[i][j];
+      const auto& a = actual_rows[i][j];
+      EXPECT_NEAR(a["time"].GetDouble(), e["time"].GetDouble(), 1.0) << names[i] << names[j];
+      EXPECT_NEAR(a["distance"].GetDouble(), e["distance"].GetDouble(), 0.002)
+          << names[i] << names[j];
+    }
+  }
+}
@@ -0,0 +1,86 @@
+#include "gurka.h"
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class EdgeWalk : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A-1-2-B-3-C
+            |
+            4
+            |
+            D
+    )";
+    const gurka::ways ways = {
+        {"AB", {{"highway", "primary"}}},
+        {"BC", {{"highway", "primary"}}},
+        {"BD", {{"highway", "primary"}}},
+    };
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 50);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/edge_walk");
+  }
+
+  // walks the exact shape through the given nodes
+  static Api walk(const std::vector<std::string>& nodes) {
+    std::string shape;
+    for (const auto& node : nodes) {
+      const auto& ll = map.nodes.at(node);
+      shape += (shape.empty() ? "" : ",") + std::string(R"({"lat":)") +
+               std::to_string(ll.lat()) + R"(,"lon":)" + std::to_string(ll.lng()) + "}";
+    }
+    tyr::actor_t actor(map.config, *test::make_clean_graphreader(map.config.get_child("mjolnir")),
+                       true);
+    Api api;
+    actor.trace_route(R"({"costing":"auto","shape_match":"edge_walk","shape":[)" + shape + "]}",
+                      nullptr, &api);
+    return api;
+  }
+};
+
+gurka::map EdgeWalk::map = {};
+
+TEST_F(EdgeWalk, NodeToNode) {
+  // every shape point is the end of an edge
+  gurka::assert::raw::expect_path(walk({"A", "B", "C"}), {"AB", "BC"});
+  gurka::assert::raw::expect_path(walk({"A", "B", "D"}), {"AB", "BD"});
+  // a single edge, the first and only candidate is the last point of the shape
+  gurka::assert::raw::expect_path(walk({"A", "B"}), {"AB"});
+}
+
+TEST_F(EdgeWalk, PointsAlongTheEdges) {
+  // the points before the first one far enough along to end an edge are skipped
+  gurka::assert::raw::expect_path(walk({"A", "1", "2", "B", "3", "C"}), {"AB", "BC"});
+  gurka::assert::raw::expect_path(walk({"A", "1", "2", "B", "4", "D"}), {"AB", "BD"});
+}
+
+TEST_F(EdgeWalk, PartialEdges) {
+  // what is left of the first edge is shorter than the edge
+  gurka::assert::raw::expect_path(walk({"1", "2", "B", "C"}), {"AB", "BC"});
+  // and the shape ends before the end of the last one
+  gurka::assert::raw::expect_path(walk({"1", "2", "B", "3"}), {"AB", "BC"});
+}
+
+TEST_F(EdgeWalk, RepeatedPoints) {
+  // points which add nothing to the distance along the shape dont throw off the bisection
+  gurka::assert::raw::expect_path(walk({"A", "A", "1", "1", "B", "B", "C", "C"}), {"AB", "BC"});
+}
+
+TEST_F(EdgeWalk, NoEdgeEndsWhereTheShapeDoes) {
+  // straight across from A to D is already too long to end A to B
+  try {
+    walk({"A", "D"});
+    FAIL() << "Expected the edge walk to fail";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 443); }
+
+  // the shape goes past C where there is no edge
+  try {
+    walk({"A", "B", "C", "D"});
+    FAIL() << "Expected the edge walk to fail";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 443); }
+}
@@ -0,0 +1,83 @@
+#include "baldr/graphreader.h"
+#include "filesystem.h"
+#include "gurka.h"
+#include "mjolnir/graphfilter.h"
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+const std::string ascii_map = R"(
+    A----B----C
+         |
+         D----E
+  )";
+
+const gurka::ways ways = {
+    {"AB", {{"highway", "primary"}}},
+    {"BC", {{"highway", "primary"}}},
+    {"BD", {{"highway", "footway"}}},
+    {"DE", {{"highway", "footway"}}},
+};
+
+} // namespace
+
+class FilterExtract : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map extract;
+
+  static void SetUpTestSuite() {
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_filter_extract");
+
+    // the extract only has what auto uses
+    const std::string tile_dir = "test/data/gurka_filter_extract_auto";
+    if (filesystem::exists(tile_dir)) {
+      filesystem::remove_all(tile_dir);
+    }
+    mjolnir::GraphFilter::Extract(map.config, tile_dir, kAutoAccess);
+    extract = map;
+    extract.config.put("mjolnir.tile_dir", tile_dir);
+  }
+};
+gurka::map FilterExtract::map = {};
+gurka::map FilterExtract::extract = {};
+
+TEST_F(FilterExtract, OnlyKeepsTheEdgesOfTheCostings) {
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  auto extract_reader = test::make_clean_graphreader(extract.config.get_child("mjolnir"));
+  uint32_t edges = 0, extract_edges = 0;
+  for (const auto& tile_id : reader->GetTileSet()) {
+    edges += reader->GetGraphTile(tile_id)->header()->directededgecount();
+  }
+  for (const auto& tile_id : extract_reader->GetTileSet()) {
+    auto tile = extract_reader->GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      const auto* edge = tile->directededge(i);
+      EXPECT_TRUE((edge->forwardaccess() | edge->reverseaccess()) & kAutoAccess);
+      // the opposing edges were found again after the renumbering
+      EXPECT_TRUE(extract_reader->GetOpposingEdgeId(GraphId(tile_id.tileid(), tile_id.level(), i))
+                      .Is_Valid());
+    }
+    extract_edges += tile->header()->directededgecount();
+  }
+  EXPECT_LT(extract_edges, edges);
+  EXPECT_GT(extract_edges, 0);
+}
+
+TEST_F(FilterExtract, RoutesTheSame) {
+  auto result = gurka::route(map, {"A", "C"}, "auto");
+  auto extract_result = gurka::route(extract, {"A", "C"}, "auto");
+  gurka::assert::raw::expect_path(extract_result, {"AB", "BC"});
+  EXPECT_NEAR(extract_result.directions().routes(0).legs(0).summary().length(),
+              result.directions().routes(0).legs(0).summary().length(), 0.001);
+
+  // the footways are gone
+  gurka::route(map, {"A", "E"}, "pedestrian");
+  EXPECT_THROW(gurka::route(extract, {"A", "E"}, "pedestrian"), std::exception);
+}
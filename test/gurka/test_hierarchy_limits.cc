@@ -0,0 +1,104 @@
+#include "gurka.h"
+#include "sif/hierarchylimits.h"
+#include "thor/worker.h"
+#include "worker.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+// Gets at the hierarchy limits the route searches of a request would start with
+class limits_worker_t : public thor::thor_worker_t {
+public:
+  using thor::thor_worker_t::thor_worker_t;
+  std::vector<sif::HierarchyLimits> limits(const std::string& json) {
+    Api request;
+    ParseApi(json, Options::route, request);
+    const auto costing = parse_costing(request);
+    const auto& options = request.options();
+    get_path_algorithm(costing, options.locations(0), options.locations(1), options);
+    return mode_costing[static_cast<size_t>(mode)]->GetHierarchyLimits();
+  }
+};
+
+} // namespace
+
+class HierarchyLimits : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A----B----C
+    )";
+    const gurka::ways ways = {{"ABC", {{"highway", "primary"}}}};
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/hierarchy_limits");
+  }
+
+  // the limits of a route between locations the given number of degrees of latitude apart
+  static std::vector<sif::HierarchyLimits>
+  limits(const bool adaptive, const float degrees, const std::string& request_option = "") {
+    auto config = map.config;
+    config.put("thor.adaptive_hierarchy_limits", adaptive);
+    limits_worker_t worker(config, test::make_clean_graphreader(config.get_child("mjolnir")));
+    return worker.limits(R"({"locations":[{"lat":0,"lon":0},{"lat":)" + std::to_string(degrees) +
+                         R"(,"lon":0}],"costing":"auto")" + request_option + "}");
+  }
+};
+
+gurka::map HierarchyLimits::map = {};
+
+TEST_F(HierarchyLimits, Default) {
+  // the limits the costing was made with are used for short and long routes alike
+  for (const float degrees : {0.01f, 10.f}) {
+    const auto hierarchy_limits = limits(false, degrees);
+    for (size_t level = 0; level < hierarchy_limits.size(); ++level) {
+      EXPECT_EQ(hierarchy_limits[level].max_up_transitions, kDefaultMaxUpTransitions[level]);
+      EXPECT_EQ(hierarchy_limits[level].expansion_within_dist, kDefaultExpansionWithinDist[level]);
+    }
+  }
+}
+
+TEST_F(HierarchyLimits, Adapted) {
+  // about a kilometer apart the lower levels are expanded through more upward transitions
+  auto hierarchy_limits = limits(true, 0.01f);
+  EXPECT_EQ(hierarchy_limits[1].max_up_transitions,
+            kDefaultMaxUpTransitions[1] * kAdaptiveLimitsMaxFactor);
+  EXPECT_EQ(hierarchy_limits[2].max_up_transitions,
+            kDefaultMaxUpTransitions[2] * kAdaptiveLimitsMaxFactor);
+
+  // and about a thousand kilometers apart through fewer
+  hierarchy_limits = limits(true, 10.f);
+  EXPECT_EQ(hierarchy_limits[1].max_up_transitions,
+            kDefaultMaxUpTransitions[1] * kAdaptiveLimitsMinFactor);
+  EXPECT_EQ(hierarchy_limits[2].max_up_transitions,
+            kDefaultMaxUpTransitions[2] * kAdaptiveLimitsMinFactor);
+
+  // the highway level is never limited
+  EXPECT_EQ(hierarchy_limits[0].max_up_transitions, kDefaultMaxUpTransitions[0]);
+}
+
+TEST_F(HierarchyLimits, RequestOverrides) {
+  // a request can turn them off where the service adapts them
+  auto hierarchy_limits = limits(true, 0.01f, R"(,"adaptive_hierarchy_limits":false)");
+  EXPECT_EQ(hierarchy_limits[1].max_up_transitions, kDefaultMaxUpTransitions[1]);
+  EXPECT_EQ(hierarchy_limits[2].max_up_transitions, kDefaultMaxUpTransitions[2]);
+
+  // and on where it does not
+  hierarchy_limits = limits(false, 0.01f, R"(,"adaptive_hierarchy_limits":true)");
+  EXPECT_EQ(hierarchy_limits[1].max_up_transitions,
+            kDefaultMaxUpTransitions[1] * kAdaptiveLimitsMaxFactor);
+  EXPECT_EQ(hierarchy_limits[2].max_up_transitions,
+            kDefaultMaxUpTransitions[2] * kAdaptiveLimitsMaxFactor);
+}
+
+TEST_F(HierarchyLimits, Route) {
+  // and the route is the same whichever limits are used
+  for (const auto& adaptive : {"0", "1"}) {
+    auto result = gurka::route(map, "A", "C", "auto", {{"/adaptive_hierarchy_limits", adaptive}});
+    gurka::assert::raw::expect_path(result, {"ABC"});
+  }
+}
@@ -0,0 +1,151 @@
+#include "baldr/graphreader.h"
+#include "baldr/openlr.h"
+#include "gurka.h"
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+const std::string ascii_map = R"(
+    A----B----C
+         |
+         |
+         D
+  )";
+
+const gurka::ways ways = {
+    {"AB", {{"highway", "primary"}}},
+    {"BC", {{"highway", "primary"}}},
+    {"BD", {{"highway", "residential"}}},
+};
+
+// A line location through the nodes with a location reference point at the first and the last
+OpenLR::OpenLr reference(const gurka::nodelayout& layout,
+                         const std::vector<std::string>& nodes,
+                         const uint8_t frc,
+                         const uint8_t lfrcnp,
+                         const uint8_t poff = 0) {
+  const auto& first = layout.at(nodes.front());
+  const auto& last = layout.at(nodes.back());
+  float distance = 0.f;
+  for (size_t i = 0; i + 1 < nodes.size(); ++i) {
+    distance += layout.at(nodes[i]).Distance(layout.at(nodes[i + 1]));
+  }
+  const auto fow = OpenLR::LocationReferencePoint::SINGLE_CARRIAGEWAY;
+  std::vector<OpenLR::LocationReferencePoint> lrps;
+  lrps.reserve(2);
+  lrps.emplace_back(first.lng(), first.lat(), first.Heading(layout.at(nodes[1])), frc, fow,
+                    nullptr, distance, lfrcnp);
+  lrps.emplace_back(last.lng(), last.lat(), last.Heading(layout.at(nodes[nodes.size() - 2])), frc,
+                    fow, &lrps.back());
+  return OpenLR::OpenLr{lrps, poff, 0};
+}
+
+void expect_path(GraphReader& reader,
+                 const gurka::nodelayout& layout,
+                 const OpenLR::MatchedPath& path,
+                 const std::vector<std::string>& nodes) {
+  ASSERT_EQ(path.size(), nodes.size() - 1);
+  for (size_t i = 0; i < path.size(); ++i) {
+    auto edge_id = std::get<0>(gurka::findEdgeByNodes(reader, layout, nodes[i], nodes[i + 1]));
+    EXPECT_EQ(path[i].edge, edge_id) << nodes[i] << nodes[i + 1];
+    EXPECT_NEAR(path[i].begin_pct, 0.f, 0.01f);
+    EXPECT_NEAR(path[i].end_pct, 1.f, 0.01f);
+  }
+}
+
+} // namespace
+
+class OpenLrMatcher : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::nodelayout layout;
+
+  static void SetUpTestSuite() {
+    layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_openlr_matcher");
+  }
+};
+gurka::map OpenLrMatcher::map = {};
+gurka::nodelayout OpenLrMatcher::layout = {};
+
+TEST_F(OpenLrMatcher, SingleEdge) {
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  OpenLR::Matcher matcher(*reader);
+  expect_path(*reader, layout, matcher.Match(reference(layout, {"A", "B"}, 2, 2)), {"A", "B"});
+  expect_path(*reader, layout, matcher.Match(reference(layout, {"B", "A"}, 2, 2)), {"B", "A"});
+}
+
+TEST_F(OpenLrMatcher, AcrossNodes) {
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  OpenLR::Matcher matcher(*reader);
+  expect_path(*reader, layout, matcher.Match(reference(layout, {"A", "B", "C"}, 2, 2)),
+              {"A", "B", "C"});
+  expect_path(*reader, layout, matcher.Match(reference(layout, {"C", "B", "D"}, 2, 6)),
+              {"C", "B", "D"});
+  // the residential road is lower than the lowest frc to the next point
+  EXPECT_TRUE(matcher.Match(reference(layout, {"C", "B", "D"}, 2, 2)).empty());
+}
+
+TEST_F(OpenLrMatcher, PositiveOffset) {
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  OpenLR::Matcher matcher(*reader);
+  // a bit more than half of the way is cut off the start of it
+  auto path = matcher.Match(reference(layout, {"A", "B", "C"}, 2, 2, 140));
+  ASSERT_EQ(path.size(), 1);
+  EXPECT_EQ(path.front().edge, std::get<0>(gurka::findEdgeByNodes(*reader, layout, "B", "C")));
+  EXPECT_GT(path.front().begin_pct, 0.f);
+  EXPECT_NEAR(path.front().end_pct, 1.f, 0.01f);
+}
+
+TEST_F(OpenLrMatcher, MatchAll) {
+  const auto ab = reference(layout, {"A", "B"}, 2, 2).toBase64();
+  const auto bd = reference(layout, {"B", "D"}, 6, 6).toBase64();
+  auto matched = OpenLR::Matcher::MatchAll(map.config.get_child("mjolnir"),
+                                           {ab, bd, ab, "not a reference", bd}, 2);
+  ASSERT_EQ(matched.size(), 3);
+  EXPECT_TRUE(matched["not a reference"].empty());
+
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  expect_path(*reader, layout, matched[ab], {"A", "B"});
+  expect_path(*reader, layout, matched[bd], {"B", "D"});
+
+  // the same reference is only matched once
+  OpenLR::Matcher matcher(*reader);
+  const auto& path = matcher.Match(ab);
+  EXPECT_EQ(&path, &matcher.Match(ab));
+  expect_path(*reader, layout, path, {"A", "B"});
+}
+
+TEST_F(OpenLrMatcher, RemembersAtMost) {
+  // sees how many references the matcher remembers
+  struct matcher_t : OpenLR::Matcher {
+    using OpenLR::Matcher::Matcher;
+    size_t remembered() const {
+      return matched_.size();
+    }
+  };
+  const auto ab = reference(layout, {"A", "B"}, 2, 2).toBase64();
+  const auto bc = reference(layout, {"B", "C"}, 2, 2).toBase64();
+  const auto bd = reference(layout, {"B", "D"}, 6, 6).toBase64();
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  matcher_t matcher(*reader, 2);
+  expect_path(*reader, layout, matcher.Match(ab), {"A", "B"});
+  expect_path(*reader, layout, matcher.Match(bc), {"B", "C"});
+  EXPECT_EQ(matcher.remembered(), 2);
+
+  // once it is full it starts over rather than growing
+  expect_path(*reader, layout, matcher.Match(bd), {"B", "D"});
+  EXPECT_EQ(matcher.remembered(), 1);
+  expect_path(*reader, layout, matcher.Match(bd), {"B", "D"});
+  EXPECT_EQ(matcher.remembered(), 1);
+  expect_path(*reader, layout, matcher.Match(ab), {"A", "B"});
+  EXPECT_EQ(matcher.remembered(), 2);
+
+  matcher.Clear();
+  EXPECT_EQ(matcher.remembered(), 0);
+}
@@ -2,6 +2,9 @@
 #include "mjolnir/graphtilebuilder.h"
 #include "sif/recost.h"
 #include "test.h"
+#include "thor/batch_recost.h"
+
+#include <cmath>
 
 using namespace valhalla;
 
@@ -369,6 +372,69 @@ TEST(recosting, throwing) {
   EXPECT_EQ(called, false);
 }
 
+TEST(recosting, batch) {
+  const std::string ascii_map = R"(A--1--B-2-3-C
+                                         |     |
+                                         |     |
+                                         4     5
+                                         |     |
+                                         |     |
+                                         D--6--E--7--F)";
+  const gurka::ways ways = {
+      {"A1B23C", {{"highway", "residential"}}},
+      {"D6E7F", {{"highway", "residential"}}},
+      {"B4D", {{"highway", "pedestrian"}}},
+      {"C5E", {{"highway", "residential"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 10);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_recost_batch", build_config);
+  auto reader = std::make_shared<baldr::GraphReader>(map.config.get_child("mjolnir"));
+
+  // a path only a pedestrian can take and one a car can take as well
+  std::vector<std::vector<baldr::GraphId>> paths;
+  for (const auto& costing : {"pedestrian", "auto"}) {
+    auto api = gurka::route(map, "A", "D", costing, {}, reader);
+    paths.emplace_back();
+    for (const auto& node : api.trip().routes(0).legs(0).node()) {
+      if (node.has_edge()) {
+        paths.back().emplace_back(node.edge().id());
+      }
+    }
+  }
+  paths.emplace_back();
+
+  sif::CostFactory factory;
+  const std::vector<sif::cost_ptr_t> costings{factory.Create(Costing::auto_),
+                                               factory.Create(Costing::pedestrian)};
+  thor::ExpansionPool pool(map.config.get_child("mjolnir"), 2);
+  auto batch = thor::RecostPaths(paths, costings, *reader, &pool);
+  ASSERT_EQ(batch.path_count, paths.size());
+  ASSERT_EQ(batch.times.size(), paths.size() * costings.size());
+
+  // the same as recosting them one by one, and NaN where the costing cant take the path
+  for (size_t c = 0; c < costings.size(); ++c) {
+    for (size_t p = 0; p < paths.size(); ++p) {
+      const size_t index = c * paths.size() + p;
+      try {
+        auto label = sif::recost_forward(*reader, *costings[c], paths[p]);
+        if (paths[p].empty()) {
+          EXPECT_TRUE(std::isnan(batch.times[index]));
+          continue;
+        }
+        EXPECT_EQ(batch.times[index], label.cost().secs);
+        EXPECT_EQ(batch.costs[index], label.cost().cost);
+        EXPECT_EQ(batch.distances[index], label.path_distance());
+      } catch (const std::runtime_error&) {
+        EXPECT_TRUE(std::isnan(batch.times[index]));
+        EXPECT_TRUE(std::isnan(batch.costs[index]));
+      }
+    }
+  }
+  EXPECT_TRUE(std::isnan(batch.times[0]));
+  EXPECT_FALSE(std::isnan(batch.times[1]));
+  EXPECT_FALSE(std::isnan(batch.times[paths.size()]));
+}
+
 TEST(recosting, error_request) {
   auto config = gurka::detail::build_config("foo_bar", {});
   auto reader = std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"));
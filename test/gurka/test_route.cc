@@ -21,6 +21,74 @@ TEST(Standalone, TruckRegression) {
   gurka::assert::raw::expect_path(result, {"AB", "AB", "AB"});
 }
 
+/*************************************************************/
+TEST(Standalone, ParallelLegDirections) {
+  const std::string ascii_map = R"(
+    A---1---B---2---C---3---D
+                            |
+                            4
+                            |
+    H---7---G---6---F---5---E
+  )";
+
+  const gurka::ways ways = {
+      {"AB", {{"highway", "primary"}, {"name", "First"}}},
+      {"BC", {{"highway", "primary"}, {"name", "Second"}}},
+      {"CD", {{"highway", "primary"}, {"name", "Third"}}},
+      {"DE", {{"highway", "secondary"}, {"name", "Fourth"}}},
+      {"EF", {{"highway", "primary"}, {"name", "Fifth"}}},
+      {"FG", {{"highway", "primary"}, {"name", "Sixth"}}},
+      {"GH", {{"highway", "primary"}, {"name", "Seventh"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/parallel_leg_directions");
+  const std::vector<std::string> waypoints = {"A", "1", "2", "3", "4", "5", "6", "7", "H"};
+
+  // the legs come out in order with the same directions however many threads build them
+  auto serial = gurka::route(map, waypoints, "auto");
+  map.config.put("odin.directions_threads", 4);
+  auto parallel = gurka::route(map, waypoints, "auto");
+  ASSERT_EQ(serial.directions().routes(0).legs_size(), waypoints.size() - 1);
+  EXPECT_EQ(serial.directions().SerializeAsString(), parallel.directions().SerializeAsString());
+}
+
+TEST(Standalone, PbfRouteResponse) {
+  const std::string ascii_map = R"(
+    A---B---C
+        |
+        D
+  )";
+
+  const gurka::ways ways = {
+      {"AB", {{"highway", "primary"}, {"name", "First"}}},
+      {"BC", {{"highway", "primary"}, {"name", "Second"}}},
+      {"BD", {{"highway", "primary"}, {"name", "Third"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/pbf_route_response");
+  std::string locations = R"({"lon":)" + std::to_string(map.nodes["A"].lng()) + R"(,"lat":)" +
+                          std::to_string(map.nodes["A"].lat()) + R"(},{"lon":)" +
+                          std::to_string(map.nodes["D"].lng()) + R"(,"lat":)" +
+                          std::to_string(map.nodes["D"].lat()) + "}";
+
+  // the response is the api itself with the same trip and directions that json is made from
+  auto reader = std::make_shared<baldr::GraphReader>(map.config.get_child("mjolnir"));
+  valhalla::tyr::actor_t actor(map.config, *reader, true);
+  valhalla::Api api;
+  auto response = actor.route(R"({"costing":"auto","format":"pbf","locations":[)" + locations +
+                                  R"(]})",
+                              {}, &api);
+  valhalla::Api pbf;
+  ASSERT_TRUE(pbf.ParseFromString(response));
+  EXPECT_EQ(pbf.options().format(), Options::pbf);
+  ASSERT_EQ(pbf.directions().routes_size(), 1);
+  EXPECT_EQ(pbf.directions().SerializeAsString(), api.directions().SerializeAsString());
+  EXPECT_EQ(pbf.trip().SerializeAsString(), api.trip().SerializeAsString());
+  gurka::assert::raw::expect_path(pbf, {"First", "Third"});
+}
+
 /*************************************************************/
 class IgnoreAccessTest : public ::testing::Test {
 protected:
@@ -3,11 +3,15 @@
 
 #include "baldr/graphreader.h"
 #include "baldr/traffictile.h"
+#include "mjolnir/traffictilewriter.h"
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <sstream>
+#include <thread>
 #include <sys/mman.h>
 #include <sys/stat.h>
 
@@ -127,6 +131,97 @@ TEST(Traffic, BasicUpdates) {
   }
 }
 
+TEST(Traffic, HotSwap) {
+  const std::string ascii_map = R"(
+    A----B----C
+         |    |
+         D----E)";
+
+  const gurka::ways ways = {{"AB", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                            {"BC", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                            {"BD", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                            {"CE", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                            {"DE", {{"highway", "primary"}, {"maxspeed", "10"}}}};
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  std::string tile_dir = "test/data/traffic_hotswap";
+  auto map = gurka::buildtiles(layout, ways, {}, {}, tile_dir);
+
+  map.config.put("mjolnir.traffic_extract", tile_dir + "/traffic.tar");
+  map.config.put("mjolnir.traffic_extract_poll_interval", 0.01);
+  test::build_live_traffic_data(map.config);
+  auto clean_reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+
+  auto eta = [&]() {
+    auto result = gurka::route(map, "A", "C", "auto", {{"/date_time/type", "0"}}, clean_reader);
+    return result.directions().routes(0).legs(0).summary().time();
+  };
+  EXPECT_NEAR(eta(), 360.0177, 0.001);
+  auto edge = std::get<0>(gurka::findEdgeByNodes(*clean_reader, map.nodes, "A", "B"));
+  auto before = clean_reader->GetGraphTile(edge);
+
+  // write the next traffic extract off to the side and then move it over the current one
+  auto next_config = map.config;
+  next_config.put("mjolnir.traffic_extract", tile_dir + "/traffic.next.tar");
+  test::build_live_traffic_data(next_config);
+  test::customize_live_traffic_data(next_config, [](baldr::GraphReader&, baldr::TrafficTile&, int,
+                                                    baldr::TrafficSpeed* current) {
+    current->breakpoint1 = 255;
+    current->overall_speed = 24 >> 1;
+    current->speed1 = 24 >> 1;
+  });
+  ASSERT_EQ(std::rename((tile_dir + "/traffic.next.tar").c_str(),
+                        (tile_dir + "/traffic.tar").c_str()),
+            0);
+
+  // the same reader picks up the new speeds without a restart
+  auto until = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (std::abs(eta() - 150.0177) > 0.001 && std::chrono::steady_clock::now() < until) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_NEAR(eta(), 150.0177, 0.001);
+
+  // tiles handed out before the swap still see the old traffic
+  EXPECT_EQ(before->trafficspeed(before->directededge(edge)).get_overall_speed(), 0);
+  auto after = clean_reader->GetGraphTile(edge);
+  EXPECT_NE(before.get(), after.get());
+  EXPECT_EQ(after->trafficspeed(after->directededge(edge)).get_overall_speed(), 24);
+}
+
+TEST(Traffic, InPlaceUpdatesBumpGeneration) {
+  const std::string ascii_map = R"(
+    A----B----C)";
+
+  const gurka::ways ways = {{"AB", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                            {"BC", {{"highway", "primary"}, {"maxspeed", "10"}}}};
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  std::string tile_dir = "test/data/traffic_in_place";
+  auto map = gurka::buildtiles(layout, ways, {}, {}, tile_dir);
+
+  // no traffic_extract_poll_interval, the speeds are only ever written in place
+  map.config.put("mjolnir.traffic_extract", tile_dir + "/traffic.tar");
+  test::build_live_traffic_data(map.config);
+  auto clean_reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  const auto generation = clean_reader->TrafficGeneration();
+  auto edge = std::get<0>(gurka::findEdgeByNodes(*clean_reader, map.nodes, "A", "B"));
+
+  const baldr::TrafficSpeed speed{24 >> 1, 24 >> 1, UNKNOWN_TRAFFIC_SPEED_RAW,
+                                  UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0, 0, 0, 0, false};
+  mjolnir::TrafficTileWriter writer(tile_dir + "/traffic.tar");
+  ASSERT_EQ(writer.Write({{edge, speed}}, 1000), 1);
+
+  // whatever was cached from the old speeds is dropped once the reader sees the write
+  auto until = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (clean_reader->TrafficGeneration() == generation &&
+         std::chrono::steady_clock::now() < until) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_GT(clean_reader->TrafficGeneration(), generation);
+  auto tile = clean_reader->GetGraphTile(edge);
+  EXPECT_EQ(tile->trafficspeed(tile->directededge(edge)).get_overall_speed(), 24);
+}
+
 TEST(Traffic, CutGeoms) {
 
   const std::string ascii_map = R"(
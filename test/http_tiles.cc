@@ -1,6 +1,7 @@
 #include "test.h"
 
 #include "baldr/curl_tilegetter.h"
+#include "baldr/graphreader.h"
 #include "baldr/graphtile.h"
 #include "tyr/actor.h"
 #include "valhalla/filesystem.h"
@@ -300,6 +301,79 @@ TEST(HttpTiles, test_interrupt) {
   }
 }
 
+TEST(HttpTiles, test_multi_batch_download) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  curl_multi_tile_getter_t tile_getter(2, "", params.is_gzipped_tile);
+  EXPECT_EQ(tile_getter.gzipped(), params.is_gzipped_tile);
+
+  // ask for every tile a few times over all at once
+  std::vector<std::string> uris;
+  std::vector<GraphId> expected_ids;
+  for (size_t i = 0; i < 4 * params.test_tile_names.size(); ++i) {
+    auto test_tile_index = i % params.test_tile_names.size();
+    uris.emplace_back(params.tile_url_base + params.test_tile_names[test_tile_index] +
+                      params.request_params);
+    expected_ids.emplace_back(params.test_tile_ids[test_tile_index]);
+  }
+  auto responses = tile_getter.get_batch(uris);
+  ASSERT_EQ(responses.size(), uris.size());
+
+  for (size_t i = 0; i < responses.size(); ++i) {
+    auto result = responses[i].get();
+    if (expected_ids[i] == params.get_nonexistent_tile_id()) {
+      EXPECT_EQ(result.status_, tile_getter_t::status_code_t::FAILURE);
+      continue;
+    }
+    ASSERT_EQ(result.status_, tile_getter_t::status_code_t::SUCCESS);
+    auto tile = GraphTile::Create(GraphId(), std::move(result.bytes_));
+    ASSERT_TRUE(tile);
+    EXPECT_EQ(tile->id(), expected_ids[i]);
+  }
+
+  // the synchronous interface still works
+  auto result = tile_getter.get(uris.front());
+  EXPECT_EQ(result.status_, tile_getter_t::status_code_t::SUCCESS);
+}
+
+TEST(HttpTiles, test_graphreader_fetch_tiles) {
+  TestTileDownloadData params;
+  auto conf = make_conf("", params.is_gzipped_tile, 2);
+  conf.get_child("mjolnir").put("tile_url", params.full_tile_url_pattern);
+  conf.get_child("mjolnir").put("tile_url_multiplex", true);
+  baldr::GraphReader reader(conf.get_child("mjolnir"));
+
+  // everything but the missing tile makes it into the cache in one go
+  EXPECT_EQ(reader.FetchTiles(params.test_tile_ids), params.test_tile_ids.size() - 1);
+  for (const auto& tile_id : params.test_tile_ids) {
+    EXPECT_EQ(reader.DoesTileExist(tile_id), tile_id != params.get_nonexistent_tile_id());
+  }
+
+  // and nothing is fetched twice
+  EXPECT_EQ(reader.FetchTiles(params.test_tile_ids), 0);
+  auto tile = reader.GetGraphTile(params.test_tile_ids.front());
+  ASSERT_TRUE(tile);
+  EXPECT_EQ(tile->id(), params.test_tile_ids.front());
+}
+
+TEST(HttpTiles, test_graphreader_fetch_tiles_skips_cached) {
+  TestTileDownloadData params;
+  auto conf = make_conf("", params.is_gzipped_tile, 2);
+  conf.get_child("mjolnir").put("tile_url", params.full_tile_url_pattern);
+  conf.get_child("mjolnir").put("tile_url_multiplex", true);
+  baldr::GraphReader reader(conf.get_child("mjolnir"));
+
+  // a tile which is already in the cache is not fetched again
+  const auto& cached = params.test_tile_ids.front();
+  ASSERT_TRUE(reader.GetGraphTile(cached));
+  EXPECT_EQ(reader.FetchTiles({cached}), 0);
+
+  // nor is it fetched along with the others
+  EXPECT_EQ(reader.FetchTiles(params.test_tile_ids), params.test_tile_ids.size() - 2);
+  EXPECT_EQ(reader.FetchTiles(params.test_tile_ids), 0);
+}
+
 class HttpTilesEnv : public ::testing::Environment {
 public:
   void SetUp() override {
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <unordered_set>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -58,6 +59,39 @@ TEST(UnorderedIdTable, SerializeDeserialize) {
   EXPECT_EQ(a, b);
 }
 
+TEST(UnorderedIdTable, SparseAndDense) {
+  // ids past 10 billion, a few far apart and a run dense enough to need a bitset
+  UnorderedIdTable t(0);
+  std::vector<uint64_t> sparse = {12000000000, 12000000007, 11999999999, 40000000000};
+  for (auto id : sparse) {
+    t.set(id);
+  }
+  for (uint64_t id = 10000000000; id < 10000000000 + 20000; id += 3) {
+    t.set(id);
+  }
+  for (auto id : sparse) {
+    EXPECT_TRUE(t.get(id));
+    EXPECT_FALSE(t.get(id + 2));
+  }
+  for (uint64_t id = 10000000000; id < 10000000000 + 20000; ++id) {
+    EXPECT_EQ(t.get(id), (id - 10000000000) % 3 == 0);
+  }
+  EXPECT_FALSE(t.get(0));
+  EXPECT_EQ(t.size(), sparse.size() + 6667);
+
+  // setting them again changes nothing
+  t.set(12000000000);
+  t.set(10000000000);
+  EXPECT_EQ(t.size(), sparse.size() + 6667);
+
+  // both kinds of chunks survive the trip to disk
+  t.serialize("sparse.bar");
+  UnorderedIdTable u(0);
+  ASSERT_TRUE(u.deserialize("sparse.bar"));
+  EXPECT_EQ(t, u);
+  EXPECT_EQ(u.size(), t.size());
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
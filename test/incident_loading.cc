@@ -34,6 +34,7 @@ struct testable_singleton : public incident_singleton_t {
   }
 
   // this stuff is all static and protected here we make it public so we can test it
+  using incident_singleton_t::publish;
   using incident_singleton_t::read_tile;
   using incident_singleton_t::state_t;
   using incident_singleton_t::update_tile;
@@ -76,31 +77,51 @@ TEST_F(incident_loading, read_tile) {
 
 TEST_F(incident_loading, update_tile) {
   // no slot exists
-  std::shared_ptr<testable_singleton::state_t> state{new testable_singleton::state_t{}};
-  ASSERT_TRUE(testable_singleton::update_tile(state, baldr::GraphId(0), {}))
+  testable_singleton::state_t::cache_t cache;
+  ASSERT_TRUE(testable_singleton::update_tile(cache, false, baldr::GraphId(0), {}))
       << " unable to update nonexistant tile";
-  ASSERT_TRUE(state->cache.count(baldr::GraphId(0))) << " cannot find new tile in cache";
-  ASSERT_TRUE(state->cache.find(baldr::GraphId(0))->second == nullptr) << " tile should be null";
+  ASSERT_TRUE(cache.count(baldr::GraphId(0))) << " cannot find new tile in cache";
+  ASSERT_TRUE(cache.find(baldr::GraphId(0))->second == nullptr) << " tile should be null";
 
   // slot exists already
   std::shared_ptr<const IncidentsTile> tile{new IncidentsTile()};
-  ASSERT_TRUE(testable_singleton::update_tile(state, baldr::GraphId(0), std::move(tile)))
+  ASSERT_TRUE(testable_singleton::update_tile(cache, false, baldr::GraphId(0), std::move(tile)))
       << " unable to update existing tile";
-  ASSERT_TRUE(state->cache.count(baldr::GraphId(0))) << " cannot find updated tile in cache";
-  ASSERT_TRUE(state->cache.find(baldr::GraphId(0))->second != nullptr) << " tile should be non null";
+  ASSERT_TRUE(cache.count(baldr::GraphId(0))) << " cannot find updated tile in cache";
+  ASSERT_TRUE(cache.find(baldr::GraphId(0))->second != nullptr) << " tile should be non null";
 
   // unexpected tile
-  state->lock_free.store(true);
-  ASSERT_FALSE(testable_singleton::update_tile(state, baldr::GraphId(1), {}))
+  ASSERT_FALSE(testable_singleton::update_tile(cache, true, baldr::GraphId(1), {}))
       << " should not be able to update this tile";
-  ASSERT_FALSE(state->cache.count(baldr::GraphId(1))) << " should not be able to find this tile";
+  ASSERT_FALSE(cache.count(baldr::GraphId(1))) << " should not be able to find this tile";
 
   // tell it where to update the tile
-  auto hint = state->cache.find(baldr::GraphId(0));
-  ASSERT_TRUE(testable_singleton::update_tile(state, baldr::GraphId(0), {}, &hint))
+  auto hint = cache.find(baldr::GraphId(0));
+  ASSERT_TRUE(testable_singleton::update_tile(cache, true, baldr::GraphId(0), {}, &hint))
       << " unable to update existing tile";
-  ASSERT_TRUE(state->cache.count(baldr::GraphId(0))) << " cannot find new tile in cache";
-  ASSERT_TRUE(state->cache.find(baldr::GraphId(0))->second == nullptr) << " tile should be null";
+  ASSERT_TRUE(cache.count(baldr::GraphId(0))) << " cannot find new tile in cache";
+  ASSERT_TRUE(cache.find(baldr::GraphId(0))->second == nullptr) << " tile should be null";
+}
+
+TEST_F(incident_loading, publish) {
+  // nothing is visible until the first snapshot is published
+  std::shared_ptr<testable_singleton::state_t> state{new testable_singleton::state_t{}};
+  ASSERT_FALSE(std::atomic_load(&state->cache)) << " there should be no snapshot yet";
+
+  testable_singleton::state_t::cache_t cache;
+  std::shared_ptr<const IncidentsTile> tile{new IncidentsTile()};
+  testable_singleton::update_tile(cache, false, baldr::GraphId(0), std::move(tile));
+  testable_singleton::publish(state, cache);
+  auto snapshot = std::atomic_load(&state->cache);
+  ASSERT_TRUE(snapshot && snapshot->count(baldr::GraphId(0))) << " tile should be published";
+
+  // changing the working copy doesnt touch what readers already have
+  testable_singleton::update_tile(cache, false, baldr::GraphId(0), {});
+  ASSERT_TRUE(snapshot->at(baldr::GraphId(0)) != nullptr) << " old snapshot should be unchanged";
+  testable_singleton::publish(state, cache);
+  ASSERT_TRUE(snapshot->at(baldr::GraphId(0)) != nullptr) << " old snapshot should be unchanged";
+  ASSERT_TRUE(snapshot->at(baldr::GraphId(0)) == nullptr)
+      << " new snapshot should have the change";
 }
 
 TEST_F(incident_loading, disabled) {
@@ -155,11 +176,13 @@ TEST_F(incident_loading, watch) {
     // actually test the watch function. the lambda here both checks its down the right things at the
     // right time and controls each iteration of the watch loop
     testable_singleton::watch(config, tileset, state, [&](size_t i) -> bool {
+      // what the readers would see right now
+      auto snapshot = std::atomic_load(&state->cache);
       // what iteration is this
       switch (i) {
         case 1: {
           // nothing loaded
-          EXPECT_EQ(state->cache.size(), tileset.size())
+          EXPECT_EQ(snapshot->size(), tileset.size())
               << " in the first iteration the cache should be the same size as the tileset";
           // load one
           snake_eyes_tile.Clear();
@@ -181,10 +204,10 @@ TEST_F(incident_loading, watch) {
         }
         case 2: {
           // one is loaded
-          EXPECT_EQ(state->cache.size(), tileset.empty() ? 1 : 2) << " wrong number of cache entries";
-          EXPECT_EQ(state->cache.count(snake_eyes), 1) << " there should be one tile in here now";
-          EXPECT_TRUE(state->cache[snake_eyes]) << " the tile pointer should be non null";
-          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *state->cache[snake_eyes]))
+          EXPECT_EQ(snapshot->size(), tileset.empty() ? 1 : 2) << " wrong number of cache entries";
+          EXPECT_EQ(snapshot->count(snake_eyes), 1) << " there should be one tile in here now";
+          EXPECT_TRUE(snapshot->at(snake_eyes)) << " the tile pointer should be non null";
+          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *snapshot->at(snake_eyes)))
               << " the tile should be equal to the one written";
           // update it
           auto* loc = snake_eyes_tile.mutable_locations()->Add();
@@ -210,10 +233,10 @@ TEST_F(incident_loading, watch) {
         }
         case 3: {
           // one is updated
-          EXPECT_EQ(state->cache.size(), tileset.empty() ? 1 : 2) << " wrong number of cache entries";
-          EXPECT_EQ(state->cache.count(snake_eyes), 1) << " should still be in there";
-          EXPECT_TRUE(state->cache[snake_eyes]) << " should still be not null";
-          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *state->cache[snake_eyes]))
+          EXPECT_EQ(snapshot->size(), tileset.empty() ? 1 : 2) << " wrong number of cache entries";
+          EXPECT_EQ(snapshot->count(snake_eyes), 1) << " should still be in there";
+          EXPECT_TRUE(snapshot->at(snake_eyes)) << " should still be not null";
+          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *snapshot->at(snake_eyes)))
               << " should have all the changes that were made";
           // remove one
           EXPECT_TRUE(filesystem::remove(snake_eyes_name)) << " couldnt remove file";
@@ -223,9 +246,9 @@ TEST_F(incident_loading, watch) {
         }
         case 4: {
           // one is null
-          EXPECT_EQ(state->cache.size(), tileset.empty() ? 1 : 2) << " wrong number of cache entries";
-          EXPECT_EQ(state->cache.count(snake_eyes), 1) << " should still be in there";
-          EXPECT_FALSE(state->cache[snake_eyes]) << " should be null now";
+          EXPECT_EQ(snapshot->size(), tileset.empty() ? 1 : 2) << " wrong number of cache entries";
+          EXPECT_EQ(snapshot->count(snake_eyes), 1) << " should still be in there";
+          EXPECT_FALSE(snapshot->at(snake_eyes)) << " should be null now";
           // add two back
           {
             std::ofstream f(snake_eyes_name, std::ofstream::out | std::ofstream::binary);
@@ -257,14 +280,14 @@ TEST_F(incident_loading, watch) {
         }
         case 5: {
           // two are updated
-          EXPECT_EQ(state->cache.size(), 2) << " wrong number of cache entries";
-          EXPECT_EQ(state->cache.count(snake_eyes), 1) << " both should be there";
-          EXPECT_TRUE(state->cache[snake_eyes]) << " should be not null";
-          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *state->cache[snake_eyes]))
+          EXPECT_EQ(snapshot->size(), 2) << " wrong number of cache entries";
+          EXPECT_EQ(snapshot->count(snake_eyes), 1) << " both should be there";
+          EXPECT_TRUE(snapshot->at(snake_eyes)) << " should be not null";
+          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *snapshot->at(snake_eyes)))
               << " should be equivalent";
-          EXPECT_EQ(state->cache.count(box_cars), 1) << " both should be there";
-          EXPECT_TRUE(state->cache[box_cars]) << " should be not null";
-          EXPECT_TRUE(test::pbf_equals(box_cars_tile, *state->cache[box_cars]))
+          EXPECT_EQ(snapshot->count(box_cars), 1) << " both should be there";
+          EXPECT_TRUE(snapshot->at(box_cars)) << " should be not null";
+          EXPECT_TRUE(test::pbf_equals(box_cars_tile, *snapshot->at(box_cars)))
               << " should be equivalent";
           // remove one
           EXPECT_TRUE(filesystem::remove(snake_eyes_name)) << " couldnt remove file";
@@ -274,12 +297,12 @@ TEST_F(incident_loading, watch) {
         }
         case 6: {
           // one is null
-          EXPECT_EQ(state->cache.size(), 2) << " wrong number of cache entries";
-          EXPECT_EQ(state->cache.count(snake_eyes), 1) << " should still be in there";
-          EXPECT_FALSE(state->cache[snake_eyes]) << " should be null now";
-          EXPECT_EQ(state->cache.count(box_cars), 1) << " should also be this one";
-          EXPECT_TRUE(state->cache[box_cars]) << " should be not null";
-          EXPECT_TRUE(test::pbf_equals(box_cars_tile, *state->cache[box_cars]))
+          EXPECT_EQ(snapshot->size(), 2) << " wrong number of cache entries";
+          EXPECT_EQ(snapshot->count(snake_eyes), 1) << " should still be in there";
+          EXPECT_FALSE(snapshot->at(snake_eyes)) << " should be null now";
+          EXPECT_EQ(snapshot->count(box_cars), 1) << " should also be this one";
+          EXPECT_TRUE(snapshot->at(box_cars)) << " should be not null";
+          EXPECT_TRUE(test::pbf_equals(box_cars_tile, *snapshot->at(box_cars)))
               << " should be equivalent";
           // remove the dir and quit before next update
           EXPECT_TRUE(filesystem::remove_all(scratch_dir))
@@ -292,12 +315,13 @@ TEST_F(incident_loading, watch) {
     });
 
     // by the end of the dance above we should have 1 loaded and 1 null
-    EXPECT_EQ(state->cache.size(), 2) << " wrong number of cache entries";
-    EXPECT_EQ(state->cache.count(snake_eyes), 1) << " should still be in there";
-    EXPECT_FALSE(state->cache[snake_eyes]) << " should be null now";
-    EXPECT_EQ(state->cache.count(box_cars), 1) << " should also be this one";
-    EXPECT_TRUE(state->cache[box_cars]) << " should be not null";
-    EXPECT_TRUE(test::pbf_equals(box_cars_tile, *state->cache[box_cars])) << " should be equivalent";
+    auto snapshot = std::atomic_load(&state->cache);
+    EXPECT_EQ(snapshot->size(), 2) << " wrong number of cache entries";
+    EXPECT_EQ(snapshot->count(snake_eyes), 1) << " should still be in there";
+    EXPECT_FALSE(snapshot->at(snake_eyes)) << " should be null now";
+    EXPECT_EQ(snapshot->count(box_cars), 1) << " should also be this one";
+    EXPECT_TRUE(snapshot->at(box_cars)) << " should be not null";
+    EXPECT_TRUE(test::pbf_equals(box_cars_tile, *snapshot->at(box_cars))) << " should be equivalent";
   }
 }
 
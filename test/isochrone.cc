@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -5,6 +6,7 @@
 #include "baldr/graphreader.h"
 #include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
+#include "midgard/util.h"
 #include "thor/worker.h"
 
 #include "test.h"
@@ -42,7 +44,7 @@ const auto config = test::json_to_pt(R"({
       "bus": {"max_distance": 5000000.0,"max_locations": 50,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
       "hov": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
       "taxi": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
-      "isochrone": {"max_contours": 4,"max_distance": 25000.0,"max_locations": 1,"max_time_contour": 120, "max_distance_contour":200},
+      "isochrone": {"max_contours": 4,"max_distance": 25000.0,"max_locations": 2,"max_time_contour": 120, "max_distance_contour":200},
       "max_avoid_locations": 50,"max_radius": 200,"max_reachability": 100,"max_alternates":2,
       "multimodal": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 0.0,"max_matrix_locations": 0},
       "pedestrian": {"max_distance": 250000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50,"max_transit_walking_distance": 10000,"min_transit_walking_distance": 1},
@@ -154,6 +156,280 @@ TEST(Isochrones, Basic) {
   }
 }
 
+TEST(Isochrones, PerLocation) {
+  loki_worker_t loki_worker(config);
+  thor_worker_t thor_worker(config);
+
+  // two locations a few kilometers apart share one expansion but get their own contours
+  const std::vector<PointLL> locations{{5.115321, 52.078937}, {5.085321, 52.092937}};
+  Api request;
+  ParseApi(
+      R"({"locations":[{"lat":52.078937,"lon":5.115321},{"lat":52.092937,"lon":5.085321}],
+          "costing":"auto","contours":[{"time":5}],"polygons":true,"per_location":true})",
+      Options::isochrone, request);
+  loki_worker.isochrones(request);
+  rapidjson::Document response;
+  response.Parse(thor_worker.isochrones(request));
+
+  // every location has a contour around it which the other location is not in
+  std::vector<bool> found(locations.size(), false);
+  for (const auto& feature : rp("/features").Get(response)->GetArray()) {
+    auto index = feature["properties"]["location_index"].GetUint();
+    ASSERT_LT(index, locations.size());
+    std::vector<PointLL> ring;
+    for (const auto& coord : feature["geometry"]["coordinates"][0].GetArray()) {
+      ring.emplace_back(coord[0].GetDouble(), coord[1].GetDouble());
+    }
+    if (locations[index].WithinPolygon(ring)) {
+      found[index] = true;
+    }
+    EXPECT_FALSE(locations[1 - index].WithinPolygon(ring)) << "Contours should not overlap";
+  }
+  EXPECT_TRUE(found[0] && found[1]) << "Every location should be within its own contour";
+
+  loki_worker.cleanup();
+  thor_worker.cleanup();
+}
+
+// The lines of a network feature
+std::vector<std::vector<PointLL>> network_lines(const rapidjson::Value& feature) {
+  EXPECT_EQ(std::string(feature["geometry"]["type"].GetString()), "MultiLineString");
+  std::vector<std::vector<PointLL>> lines;
+  for (const auto& line : feature["geometry"]["coordinates"].GetArray()) {
+    lines.emplace_back();
+    for (const auto& coord : line.GetArray()) {
+      lines.back().emplace_back(coord[0].GetDouble(), coord[1].GetDouble());
+    }
+  }
+  return lines;
+}
+
+TEST(Isochrones, Network) {
+  loki_worker_t loki_worker(config);
+  thor_worker_t thor_worker(config);
+
+  const PointLL location{5.115321, 52.078937};
+  Api request;
+  ParseApi(R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto",
+               "contours":[{"distance":1},{"distance":2}],"network":true})",
+           Options::isochrone, request);
+  loki_worker.isochrones(request);
+  rapidjson::Document response;
+  response.Parse(thor_worker.isochrones(request));
+  const auto features = rp("/features").Get(response)->GetArray();
+  ASSERT_EQ(features.Size(), 2);
+
+  // the largest comes first, as with the contours of the grid
+  std::vector<double> lengths;
+  for (const auto km : {2., 1.}) {
+    const auto& feature = features[lengths.size()];
+    EXPECT_EQ(feature["properties"]["contour"].GetDouble(), km);
+    const auto lines = network_lines(feature);
+    ASSERT_FALSE(lines.empty());
+
+    // the edges are cut where the contour runs out along them so nothing is further away as the
+    // crow flies than along the roads, give or take getting onto the road at the location
+    double length = 0, furthest = 0;
+    for (const auto& line : lines) {
+      ASSERT_GT(line.size(), 1);
+      for (size_t i = 0; i < line.size(); ++i) {
+        furthest = std::max(furthest, static_cast<double>(location.Distance(line[i])));
+        if (i > 0) {
+          length += line[i - 1].Distance(line[i]);
+        }
+      }
+    }
+    EXPECT_LE(furthest, km * 1000 + 50) << "Edges should be cut off at the contour";
+    EXPECT_GT(furthest, km * 1000 * 0.7) << "Edges should reach out to the contour";
+    lengths.push_back(length);
+  }
+  EXPECT_GT(lengths[0], lengths[1]);
+
+  loki_worker.cleanup();
+  thor_worker.cleanup();
+}
+
+TEST(Isochrones, NetworkPerLocation) {
+  loki_worker_t loki_worker(config);
+  thor_worker_t thor_worker(config);
+
+  // each location gets the part of the network it reaches
+  const std::vector<PointLL> locations{{5.115321, 52.078937}, {5.085321, 52.092937}};
+  Api request;
+  ParseApi(
+      R"({"locations":[{"lat":52.078937,"lon":5.115321},{"lat":52.092937,"lon":5.085321}],
+          "costing":"auto","contours":[{"distance":1}],"network":true,"per_location":true})",
+      Options::isochrone, request);
+  loki_worker.isochrones(request);
+  rapidjson::Document response;
+  response.Parse(thor_worker.isochrones(request));
+  const auto features = rp("/features").Get(response)->GetArray();
+  ASSERT_EQ(features.Size(), locations.size());
+
+  std::vector<bool> found(locations.size(), false);
+  for (const auto& feature : features) {
+    auto index = feature["properties"]["location_index"].GetUint();
+    ASSERT_LT(index, locations.size());
+    EXPECT_FALSE(found[index]) << "Every location should have one feature per contour";
+    found[index] = true;
+    const auto lines = network_lines(feature);
+    EXPECT_FALSE(lines.empty());
+    for (const auto& line : lines) {
+      for (const auto& coord : line) {
+        EXPECT_LE(locations[index].Distance(coord), 1050) << "Edge of the other location";
+      }
+    }
+  }
+  EXPECT_TRUE(found[0] && found[1]);
+
+  loki_worker.cleanup();
+  thor_worker.cleanup();
+}
+
+TEST(Isochrones, Cache) {
+  auto cache_config = config;
+  cache_config.put("thor.isochrone_cache_size", 100 * 1024 * 1024);
+  loki_worker_t loki_worker(cache_config);
+  thor_worker_t thor_worker(cache_config);
+
+  auto hits = [&](const std::string& json) {
+    Api request;
+    ParseApi(json, Options::isochrone, request);
+    loki_worker.isochrones(request);
+    thor_worker.isochrones(request);
+    for (const auto& stat : request.info().statistics()) {
+      if (stat.name() == "thor_worker_t::isochrone_cache_hits") {
+        return static_cast<int>(stat.value());
+      }
+    }
+    return -1;
+  };
+
+  // the expansion of the first serves those reaching less far with the same costing
+  const std::string location = R"("locations":[{"lat":52.078937,"lon":5.115321}])";
+  EXPECT_EQ(hits("{" + location + R"(,"costing":"auto","contours":[{"time":10}]})"), 0);
+  EXPECT_EQ(hits("{" + location + R"(,"costing":"auto","contours":[{"time":5}]})"), 1);
+  EXPECT_EQ(hits("{" + location + R"(,"costing":"auto","contours":[{"time":10},{"time":3}]})"), 1);
+  EXPECT_EQ(hits("{" + location + R"(,"costing":"auto","contours":[{"time":15}]})"), 0);
+  EXPECT_EQ(hits("{" + location + R"(,"costing":"auto","contours":[{"time":12}]})"), 1);
+
+  // but not those of another metric, costing or location
+  EXPECT_EQ(hits("{" + location + R"(,"costing":"auto","contours":[{"distance":2}]})"), 0);
+  EXPECT_EQ(hits("{" + location + R"(,"costing":"bicycle","contours":[{"time":5}]})"), 0);
+  EXPECT_EQ(hits(R"({"locations":[{"lat":52.092937,"lon":5.085321}],"costing":"auto",)"
+                 R"("contours":[{"time":5}]})"),
+            0);
+
+  // nor those split by location
+  EXPECT_EQ(hits("{" + location + R"(,"costing":"auto","contours":[{"time":5}],)"
+                                  R"("per_location":true})"),
+            -1);
+
+  loki_worker.cleanup();
+  thor_worker.cleanup();
+}
+
+TEST(Isochrones, BothDirections) {
+  auto features = [](loki_worker_t& loki_worker, thor_worker_t& thor_worker,
+                     const std::string& json) {
+    Api request;
+    ParseApi(json, Options::isochrone, request);
+    loki_worker.isochrones(request);
+    rapidjson::Document response;
+    response.Parse(thor_worker.isochrones(request));
+    std::vector<std::string> geometries;
+    std::vector<bool> reversed;
+    for (const auto& feature : rp("/features").Get(response)->GetArray()) {
+      geometries.push_back(rapidjson::to_string(feature["geometry"]));
+      if (feature["properties"].HasMember("reverse")) {
+        reversed.push_back(feature["properties"]["reverse"].GetBool());
+      }
+    }
+    loki_worker.cleanup();
+    thor_worker.cleanup();
+    return std::make_pair(geometries, reversed);
+  };
+
+  // the contours of both directions are those of each direction on its own, one after the other
+  const std::string request = R"({"locations":[{"lat":52.078937,"lon":5.115321}],)"
+                              R"("costing":"auto","contours":[{"time":5},{"time":10}])";
+  for (const auto threads : {1, 2}) {
+    auto threads_config = config;
+    threads_config.put("thor.matrix_threads", threads);
+    loki_worker_t loki_worker(threads_config);
+    thor_worker_t thor_worker(threads_config);
+    const auto forward = features(loki_worker, thor_worker, request + "}");
+    const auto reverse = features(loki_worker, thor_worker, request + R"(,"reverse":true})");
+    const auto both = features(loki_worker, thor_worker, request + R"(,"both_directions":true})");
+    ASSERT_EQ(forward.first.size(), 2);
+    ASSERT_EQ(reverse.first.size(), 2);
+    EXPECT_NE(forward.first, reverse.first) << "Driving is not the same both ways";
+    EXPECT_TRUE(forward.second.empty());
+
+    auto expected = forward.first;
+    expected.insert(expected.end(), reverse.first.begin(), reverse.first.end());
+    EXPECT_EQ(both.first, expected);
+    EXPECT_EQ(both.second, (std::vector<bool>{false, false, true, true}));
+  }
+}
+
+TEST(Isochrones, ParallelExpansion) {
+  // the area of each contour and the length of the network of each contour
+  auto measure = [](const boost::property_tree::ptree& conf, const std::string& json) {
+    loki_worker_t loki_worker(conf);
+    thor_worker_t thor_worker(conf);
+    Api request;
+    ParseApi(json, Options::isochrone, request);
+    loki_worker.isochrones(request);
+    rapidjson::Document response;
+    response.Parse(thor_worker.isochrones(request));
+    std::vector<double> measures;
+    for (const auto& feature : rp("/features").Get(response)->GetArray()) {
+      double measure = 0;
+      if (request.options().network()) {
+        for (const auto& line : network_lines(feature)) {
+          for (size_t i = 1; i < line.size(); ++i) {
+            measure += line[i - 1].Distance(line[i]);
+          }
+        }
+      } else {
+        std::vector<PointLL> ring;
+        for (const auto& coord : feature["geometry"]["coordinates"][0].GetArray()) {
+          ring.emplace_back(coord[0].GetDouble(), coord[1].GetDouble());
+        }
+        measure = std::abs(polygon_area(ring));
+      }
+      measures.push_back(measure);
+    }
+    loki_worker.cleanup();
+    thor_worker.cleanup();
+    return measures;
+  };
+
+  // every isochrone goes a bucket at a time on the threads
+  auto parallel_config = config;
+  parallel_config.put("thor.matrix_threads", 4);
+  parallel_config.put("thor.parallel_isochrone_distance", 0);
+
+  // the labels of a bucket are no longer settled one after the other, which can only change the
+  // cost of an edge by less than the size of a bucket, so both reach the same area and network
+  const std::string location = R"({"locations":[{"lat":52.078937,"lon":5.115321}],)";
+  for (const auto& json : {location + R"("costing":"auto","contours":[{"time":5},{"time":10}],)"
+                                      R"("polygons":true})",
+                           location + R"("costing":"pedestrian","contours":[{"time":15}],)"
+                                      R"("polygons":true})",
+                           location + R"("costing":"auto","contours":[{"time":5},{"time":10}],)"
+                                      R"("network":true})"}) {
+    const auto sequential = measure(config, json);
+    const auto parallel = measure(parallel_config, json);
+    ASSERT_EQ(parallel.size(), sequential.size()) << json;
+    for (size_t i = 0; i < sequential.size(); ++i) {
+      ASSERT_GT(sequential[i], 0) << json;
+      EXPECT_NEAR(parallel[i] / sequential[i], 1, 0.01) << json;
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
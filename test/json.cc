@@ -74,6 +74,30 @@ TEST(JSON, Serialize) {
   EXPECT_EQ(res, ans) << "Wrong json";
 }
 
+TEST(JSON, Lookups) {
+  rapidjson::Document doc;
+  doc.Parse(R"({"a":1,"b":{"c":"d","e/f":2,"~":3},"g":[4,5],"":6})");
+  ASSERT_FALSE(doc.HasParseError());
+
+  // single members are found without a json pointer, the deeper ones with one
+  EXPECT_EQ(rapidjson::get<int>(doc, "/a"), 1);
+  EXPECT_EQ(rapidjson::get<std::string>(doc, "/b/c"), "d");
+  EXPECT_EQ(rapidjson::get<int>(doc, "/b/e~1f"), 2);
+  EXPECT_EQ(rapidjson::get<int>(doc, "/b/~0"), 3);
+  EXPECT_EQ(rapidjson::get<int>(doc, "/g/1"), 5);
+  EXPECT_EQ(rapidjson::get<int>(doc, "/"), 6);
+  EXPECT_FALSE(rapidjson::get_optional<int>(doc, "/h"));
+  EXPECT_FALSE(rapidjson::get_optional<int>(doc, "/b/h"));
+
+  // and on children as well as the document
+  const rapidjson::Value& b = rapidjson::get_child(doc, "/b");
+  EXPECT_EQ(rapidjson::get<std::string>(b, "/c"), "d");
+  EXPECT_TRUE(rapidjson::get_child_optional(b, "/c"));
+  EXPECT_FALSE(rapidjson::get_child_optional(b, "/h"));
+  const rapidjson::Value& g = rapidjson::get_child(doc, "/g");
+  EXPECT_EQ(rapidjson::get<int>(g, "/0"), 4);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,111 @@
+#include "thor/label_limits.h"
+#include "sif/edgelabel.h"
+#include "worker.h"
+
+#include <memory>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::thor;
+
+namespace {
+
+TEST(LabelLimits, Defaults) {
+  label_limits_t limits;
+  EXPECT_EQ(limits.max_reserved_labels_count, kDefaultMaxReservedLabelsCount);
+  EXPECT_EQ(limits.max_labels_memory, 0);
+  EXPECT_EQ(limits.reservation(10), 10);
+  EXPECT_EQ(limits.reservation(kDefaultMaxReservedLabelsCount * 2), kDefaultMaxReservedLabelsCount);
+
+  // without a memory limit nothing is too big
+  std::vector<sif::EdgeLabel> labels(1000);
+  EXPECT_NO_THROW(limits.check(labels));
+}
+
+TEST(LabelLimits, Trim) {
+  boost::property_tree::ptree config;
+  config.put("max_reserved_labels_count", 100);
+  label_limits_t limits(config);
+  EXPECT_EQ(limits.reservation(1000), 100);
+
+  // small containers keep their memory for the next request
+  std::vector<sif::BDEdgeLabel> labels(50);
+  auto capacity = labels.capacity();
+  limits.trim(labels);
+  EXPECT_TRUE(labels.empty());
+  EXPECT_EQ(labels.capacity(), capacity);
+
+  // big ones give it back
+  labels.resize(1000);
+  limits.trim(labels);
+  EXPECT_TRUE(labels.empty());
+  EXPECT_EQ(labels.capacity(), 0);
+}
+
+TEST(LabelLimits, Check) {
+  boost::property_tree::ptree config;
+  config.put("max_labels_memory", 100 * sizeof(sif::EdgeLabel));
+  label_limits_t limits(config);
+
+  std::vector<sif::EdgeLabel> forward(60), reverse(40);
+  EXPECT_NO_THROW(limits.check(forward, reverse));
+  reverse.emplace_back();
+  try {
+    limits.check(forward, reverse);
+    FAIL() << "Label memory limit was not enforced";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 431); }
+
+  EXPECT_NO_THROW(limits.check_bytes(100 * sizeof(sif::EdgeLabel)));
+  EXPECT_THROW(limits.check_bytes(100 * sizeof(sif::EdgeLabel) + 1), valhalla_exception_t);
+}
+
+TEST(LabelLimits, Parts) {
+  boost::property_tree::ptree config;
+  config.put("max_labels_memory", 1000 * sizeof(sif::EdgeLabel));
+  label_limits_t limits(config);
+
+  // the adjacency list counts as much as its label indexes weigh and the edge status nothing
+  // until it has edges, a missing adjacency list counts nothing at all
+  std::vector<sif::EdgeLabel> labels(10);
+  std::shared_ptr<baldr::DoubleBucketQueue<sif::EdgeLabel>> adjacency;
+  EdgeStatus edgestatus;
+  EXPECT_EQ(label_limits_t::bytes(labels, adjacency, edgestatus),
+            labels.size() * sizeof(sif::EdgeLabel));
+  adjacency.reset(new baldr::DoubleBucketQueue<sif::EdgeLabel>(0, 10, 1, labels));
+  EXPECT_EQ(label_limits_t::bytes(adjacency), adjacency->bytes());
+  EXPECT_EQ(label_limits_t::bytes(labels, adjacency, edgestatus),
+            labels.size() * sizeof(sif::EdgeLabel) + adjacency->bytes() + edgestatus.bytes());
+  EXPECT_NO_THROW(limits.check(labels, adjacency, edgestatus));
+}
+
+TEST(LabelLimits, PeakMemory) {
+  label_limits_t limits;
+  EXPECT_EQ(limits.peak_memory(), 0);
+
+  // the copies the algorithms keep all raise the same peak
+  label_limits_t copy(limits);
+  std::vector<sif::EdgeLabel> small(10), big(20);
+  copy.check(big);
+  limits.check(small);
+  EXPECT_EQ(limits.peak_memory(), big.size() * sizeof(sif::EdgeLabel));
+  EXPECT_EQ(copy.peak_memory(), limits.peak_memory());
+
+  // the search that was aborted still set it
+  boost::property_tree::ptree config;
+  config.put("max_labels_memory", 10);
+  label_limits_t tight(config);
+  EXPECT_THROW(tight.check(big), valhalla_exception_t);
+  EXPECT_EQ(tight.peak_memory(), big.size() * sizeof(sif::EdgeLabel));
+
+  limits.reset_peak_memory();
+  EXPECT_EQ(copy.peak_memory(), 0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
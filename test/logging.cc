@@ -6,7 +6,10 @@
 #include <functional>
 #include <future>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -94,6 +97,83 @@ TEST(Logging, FileLoggerTest) {
   EXPECT_EQ(custom, 8);
 }
 
+// keeps whatever the async logger writes
+std::mutex captured_lock;
+std::string captured;
+struct CaptureLogger : public logging::Logger {
+  using logging::Logger::Logger;
+  virtual void Write(const std::string& lines) {
+    std::lock_guard<std::mutex> guard(captured_lock);
+    captured.append(lines);
+  }
+};
+bool capture_logger_registered =
+    logging::RegisterLogger("capture", [](const logging::LoggingConfig& config) {
+      logging::Logger* l = new CaptureLogger(config);
+      return l;
+    });
+
+std::vector<std::string> capture(const logging::LoggingConfig& config,
+                                 const std::function<void(logging::Logger&)>& work) {
+  captured.clear();
+  {
+    std::unique_ptr<logging::Logger> logger(logging::GetFactory().Produce(config));
+    work(*logger);
+  }
+  std::vector<std::string> lines;
+  std::istringstream stream(captured);
+  for (std::string line; std::getline(stream, line);)
+    lines.push_back(line);
+  return lines;
+}
+
+TEST(Logging, AsyncLoggerTest) {
+  EXPECT_THROW(logging::GetFactory().Produce({{"type", "async"}, {"async_type", "async"}}),
+               std::exception);
+  EXPECT_THROW(logging::GetFactory().Produce({{"type", "async"}, {"queue_size", "0"}}),
+               std::exception);
+
+  // with tiny queues that wait when full nothing is lost and each thread stays in order
+  auto lines = capture({{"type", "async"},
+                        {"async_type", "capture"},
+                        {"queue_size", "4"},
+                        {"drop_on_full", "false"},
+                        {"flush_interval", "1"}},
+                       [](logging::Logger& logger) {
+                         std::vector<std::thread> threads;
+                         for (size_t t = 0; t < 4; ++t) {
+                           threads.emplace_back([&logger, t]() {
+                             for (size_t i = 0; i < 1000; ++i)
+                               logger.Log(std::to_string(t) + " " + std::to_string(i),
+                                          logging::LogLevel::INFO);
+                           });
+                         }
+                         for (auto& thread : threads)
+                           thread.join();
+                       });
+  ASSERT_EQ(lines.size(), 4000);
+  std::vector<size_t> next(4, 0);
+  for (const auto& line : lines) {
+    auto message = line.substr(line.find(" [INFO] ") + 8);
+    auto t = std::stoul(message.substr(0, message.find(' ')));
+    ASSERT_EQ(std::stoul(message.substr(message.find(' ') + 1)), next[t]++);
+  }
+
+  // a full queue drops what doesnt fit and says how much
+  lines = capture({{"type", "async"},
+                   {"async_type", "capture"},
+                   {"queue_size", "2"},
+                   {"flush_interval", "60000"}},
+                  [](logging::Logger& logger) {
+                    for (size_t i = 0; i < 10; ++i)
+                      logger.Log("lossy", logging::LogLevel::DEBUG);
+                  });
+  ASSERT_EQ(lines.size(), 3);
+  EXPECT_NE(lines[0].find(" [DEBUG] lossy"), std::string::npos);
+  EXPECT_NE(lines[1].find(" [DEBUG] lossy"), std::string::npos);
+  EXPECT_NE(lines[2].find(" [WARN] Dropped 8 log messages"), std::string::npos);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1,6 +1,9 @@
 #include "test.h"
 
+#include <atomic>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "mjolnir/graph_lua_proc.h"
 #include "mjolnir/luatagtransform.h"
@@ -103,6 +106,50 @@ TEST(Lua, NumberDoublePeriod) {
   // ... but that the results aren't completely empty
   ASSERT_TRUE(results.size() > 0);
 }
+
+TEST(Lua, CachedSameAsUncached) {
+  const std::string code(lua_graph_lua, lua_graph_lua + lua_graph_lua_len);
+  mjolnir::LuaTagTransform cached(code, 2);
+  mjolnir::LuaTagTransform uncached(code, 0);
+
+  // more sets of tags than the cache holds, each of them seen more than once
+  std::vector<mjolnir::Tags> tag_sets = {
+      {{"highway", "primary"}, {"maxheight", "2.0"}},
+      {{"maxheight", "2.0"}, {"highway", "primary"}, {"oneway", "yes"}},
+      {{"highway", "residential"}, {"name", "Main Street"}},
+      {{"highway", "footway"}},
+  };
+  for (int pass = 0; pass < 3; ++pass) {
+    for (const auto& tags : tag_sets) {
+      for (auto type : {mjolnir::OSMType::kNode, mjolnir::OSMType::kWay}) {
+        EXPECT_EQ(cached.Transform(type, 1, tags), uncached.Transform(type, 1, tags));
+      }
+    }
+  }
+}
+
+TEST(Lua, ManyThreads) {
+  mjolnir::LuaTagTransform lua(std::string(lua_graph_lua, lua_graph_lua + lua_graph_lua_len));
+  mjolnir::Tags tags{{"highway", "tertiary"}, {"maxheight", "1.1 m"}};
+  const auto expected = lua.Transform(mjolnir::OSMType::kWay, 1, tags);
+
+  // every thread gets its own lua state so they can all transform at once
+  std::vector<std::thread> threads;
+  std::atomic<size_t> mismatches(0);
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 100; ++j) {
+        if (lua.Transform(mjolnir::OSMType::kWay, j, tags) != expected) {
+          ++mismatches;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(mismatches, 0);
+}
 } // namespace
 
 // TODO: sweet jesus add more tests of this class!
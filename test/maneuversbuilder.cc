@@ -160,6 +160,18 @@ TEST(Maneuversbuilder, TestSetSimpleDirectionalManeuverType) {
   TrySetSimpleDirectionalManeuverType(349, DirectionsLeg_Maneuver_Type_kSlightLeft);
 }
 
+TEST(Maneuversbuilder, TestTakeStreetNames) {
+  Maneuver maneuver;
+  maneuver.set_street_names({{"Main Street", false}, {"PA 23", true}});
+  std::unique_ptr<StreetNames> street_names = maneuver.TakeStreetNames();
+  ASSERT_EQ(street_names->size(), 2);
+  EXPECT_EQ(street_names->front()->value(), "Main Street");
+  EXPECT_TRUE(street_names->back()->is_route_number());
+  // the maneuver is left unnamed but still usable
+  EXPECT_FALSE(maneuver.HasStreetNames());
+  EXPECT_EQ(maneuver.street_names().ToString(), "unnamed");
+}
+
 void TryDetermineCardinalDirection(uint32_t heading,
                                    DirectionsLeg_Maneuver_CardinalDirection expected) {
   ManeuversBuilderTest mbTest;
@@ -1,4 +1,5 @@
 // -*- mode: c++ -*-
+#include <sstream>
 #include <string>
 
 #include "baldr/rapidjson_utils.h"
@@ -7,6 +8,7 @@
 #include "sif/costconstants.h"
 #include "sif/costfactory.h"
 
+#include "meili/batch_matcher.h"
 #include "meili/map_matcher_factory.h"
 
 #include "test.h"
@@ -181,6 +183,76 @@ TEST(MapMatcherFactory, TestMapMatcher) {
   delete pedestrian_matcher;
 }
 
+TEST(MapMatcherFactory, TestSharedGridCache) {
+  meili::CandidateGridCache cache;
+  EXPECT_EQ(cache.Find(7), nullptr);
+
+  // the first grid put in for a bin is the one that is kept
+  midgard::AABB2<midgard::PointLL> bbox{{0, 0}, {1, 1}};
+  auto first = std::make_shared<meili::CandidateGridCache::grid_t>(bbox, 0.1f, 0.1f);
+  auto second = std::make_shared<meili::CandidateGridCache::grid_t>(bbox, 0.1f, 0.1f);
+  EXPECT_EQ(cache.Insert(7, first), first);
+  EXPECT_EQ(cache.Insert(7, second), first);
+  EXPECT_EQ(cache.Find(7), first);
+  EXPECT_EQ(cache.size(), 1);
+
+  // whoever still has a grid can keep using it after a clear
+  auto kept = cache.Find(7);
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.Find(7), nullptr);
+  EXPECT_EQ(kept->ncols(), 10);
+
+  // the factories share the grids only if asked to
+  ptree root;
+  rapidjson::read_json(VALHALLA_SOURCE_DIR "test/valhalla.json", root);
+  root.put("meili.grid.shared", true);
+  meili::MapMatcherFactory factory(root);
+  EXPECT_TRUE(meili::Config(root.get_child("meili")).candidate_search.shared_grid_cache);
+  EXPECT_FALSE(meili::Config().candidate_search.shared_grid_cache);
+}
+
+TEST(MapMatcherFactory, TestBatchMatcher) {
+  ptree root;
+  rapidjson::read_json(VALHALLA_SOURCE_DIR "test/valhalla.json", root);
+
+  // there are no tiles so every trace fails but they still come out in order
+  std::stringstream input, output;
+  for (int i = 0; i < 50; ++i) {
+    if (i == 7) {
+      input << "not json\n";
+    } else if (i == 9) {
+      input << "{\"id\": 9, \"costing\": \"spaceship\", \"shape\": []}\n";
+    } else {
+      input << "{\"id\": " << i
+            << ", \"shape\": [{\"lon\": 5.1, \"lat\": 52.1}, {\"lon\": 5.2, \"lat\": 52.2}]}\n";
+    }
+    if (i % 10 == 0) {
+      input << "\n";
+    }
+  }
+  meili::BatchMatcher matcher(root, 4, 3);
+  EXPECT_EQ(matcher.Match(input, output), 50);
+
+  std::string line;
+  for (int i = 0; i < 50; ++i) {
+    ASSERT_TRUE(std::getline(output, line));
+    rapidjson::Document result;
+    result.Parse(line.c_str());
+    ASSERT_FALSE(result.HasParseError()) << line;
+    ASSERT_TRUE(result.HasMember("error")) << line;
+    if (i == 7) {
+      EXPECT_FALSE(result.HasMember("id"));
+    } else {
+      EXPECT_EQ(result["id"].GetInt(), i);
+    }
+    if (i == 9) {
+      EXPECT_NE(std::string(result["error"].GetString()).find("spaceship"), std::string::npos);
+    }
+  }
+  EXPECT_FALSE(std::getline(output, line));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
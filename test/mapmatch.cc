@@ -6,6 +6,8 @@
 
 #include "baldr/json.h"
 #include "loki/worker.h"
+#include "meili/batch_matcher.h"
+#include "meili/map_matcher_factory.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
@@ -74,7 +76,7 @@ const auto conf = test::json_to_pt(R"({
     },
     "thor":{"logging":{"long_request": 110}},
     "skadi":{"actons":["height"],"logging":{"long_request": 5}},
-    "meili":{"customizable": ["turn_penalty_factor","max_route_distance_factor","max_route_time_factor","search_radius","interpolation_distance"],
+    "meili":{"customizable": ["turn_penalty_factor","max_route_distance_factor","max_route_time_factor","search_radius","interpolation_distance","adaptive_interpolation"],
              "mode":"auto","grid":{"cache_size":100240,"size":500},
              "default":{"beta":3,"breakage_distance":2000,"geometry":false,"gps_accuracy":5.0,"interpolation_distance":10,
              "max_route_distance_factor":5,"max_route_time_factor":5,"max_search_radius":200,"route":true,
@@ -569,6 +571,131 @@ TEST(Mapmatch, test_time_rejection) {
       << "Using time it should not take a small detour";
 }
 
+TEST(Mapmatch, test_online_match) {
+  // a trace along a route which is long enough for the online history to be dropped a few times
+  tyr::actor_t actor(conf, true);
+  auto route = test::json_to_pt(actor.route(
+      R"({"costing":"auto","locations":[{"lat":52.09110,"lon":5.09806},{"lat":52.07766,"lon":5.13433}]})"));
+  auto shape = midgard::decode<std::vector<midgard::PointLL>>(
+      route.get_child("trip.legs").front().second.get<std::string>("shape"));
+  shape = midgard::resample_spherical_polyline(shape, 30);
+  ASSERT_GT(shape.size(), 50);
+
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(Costing::auto_));
+  std::vector<meili::Measurement> measurements;
+  for (const auto& point : shape) {
+    measurements.emplace_back(point, 5.f, 15.f);
+  }
+  auto offline = matcher->OfflineMatch(measurements).front().results;
+
+  // every point is final exactly once and in order, mostly matched to the same edge as offline
+  std::vector<meili::MatchResult> online;
+  size_t routed = 0;
+  for (size_t i = 0; i < measurements.size(); ++i) {
+    auto final = matcher->OnlineMatch(measurements[i], 3);
+    online.insert(online.end(), final.results.begin(), final.results.end());
+    ASSERT_EQ(online.size(), i + 1 >= 3 ? i + 1 - 3 : 0);
+    routed += final.segments.size();
+  }
+  auto final = matcher->FinishOnlineMatch();
+  online.insert(online.end(), final.results.begin(), final.results.end());
+  ASSERT_EQ(online.size(), measurements.size());
+  EXPECT_GT(routed, 0);
+
+  size_t same = 0;
+  for (size_t i = 0; i < online.size(); ++i) {
+    EXPECT_TRUE(online[i].lnglat.IsValid());
+    same += online[i].edgeid == offline[i].edgeid;
+  }
+  EXPECT_GE(same, online.size() * 9 / 10);
+}
+
+TEST(Mapmatch, transition_route_cache) {
+  // the same trace matched twice, the second time the routes between its candidates are cached
+  tyr::actor_t actor(conf, true);
+  auto route = test::json_to_pt(actor.route(
+      R"({"costing":"auto","locations":[{"lat":52.09110,"lon":5.09806},{"lat":52.07766,"lon":5.13433}]})"));
+  auto shape = midgard::decode<std::vector<midgard::PointLL>>(
+      route.get_child("trip.legs").front().second.get<std::string>("shape"));
+  shape = midgard::resample_spherical_polyline(shape, 30);
+  std::vector<meili::Measurement> measurements;
+  for (const auto& point : shape) {
+    measurements.emplace_back(point, 5.f, 15.f);
+  }
+
+  auto cached_conf = conf;
+  cached_conf.put("meili.transition_cache_size", 10000);
+  meili::MapMatcherFactory factory(cached_conf);
+  ASSERT_NE(factory.route_cache(), nullptr);
+  std::vector<std::vector<meili::MatchResult>> results;
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<meili::MapMatcher> matcher(factory.Create(Costing::auto_));
+    results.push_back(matcher->OfflineMatch(measurements).front().results);
+    EXPECT_GT(factory.route_cache()->size(), 0);
+  }
+  const auto misses = factory.route_cache()->misses();
+  EXPECT_GT(factory.route_cache()->hits(), 0);
+  ASSERT_EQ(results.front().size(), results.back().size());
+  for (size_t i = 0; i < results.front().size(); ++i) {
+    EXPECT_EQ(results.front()[i].edgeid, results.back()[i].edgeid);
+    EXPECT_NEAR(results.front()[i].distance_along, results.back()[i].distance_along, 1e-3);
+  }
+
+  // another costing doesnt use the routes of the first
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(Costing::bicycle));
+  matcher->OfflineMatch(measurements);
+  EXPECT_GT(factory.route_cache()->misses(), misses);
+
+  // once the traffic changes the routes found before it are dropped
+  ASSERT_GT(factory.route_cache()->size(), 0);
+  baldr::GraphReader::ReloadTileset(cached_conf.get_child("mjolnir"));
+  ASSERT_TRUE(factory.graphreader()->Refresh());
+  matcher.reset(factory.Create(Costing::auto_));
+  EXPECT_EQ(factory.route_cache()->size(), 0);
+  matcher->OfflineMatch(measurements);
+  EXPECT_GT(factory.route_cache()->size(), 0);
+
+  factory.ClearCache();
+  EXPECT_EQ(factory.route_cache()->size(), 0);
+}
+
+TEST(Mapmatch, batch_speeds) {
+  // the same probe trace along a route going 10 meters a second over and over, one line isnt one
+  tyr::actor_t actor(conf, true);
+  auto route = test::json_to_pt(actor.route(
+      R"({"costing":"auto","locations":[{"lat":52.09110,"lon":5.09806},{"lat":52.07766,"lon":5.13433}]})"));
+  auto shape = midgard::decode<std::vector<midgard::PointLL>>(
+      route.get_child("trip.legs").front().second.get<std::string>("shape"));
+  shape = midgard::resample_spherical_polyline(shape, 30);
+  std::string trace = R"({"shape":[)";
+  for (size_t i = 0; i < shape.size(); ++i) {
+    trace += R"({"lon":)" + std::to_string(shape[i].lng()) + R"(,"lat":)" +
+             std::to_string(shape[i].lat()) + R"(,"time":)" + std::to_string(i * 3) + "},";
+  }
+  trace.back() = ']';
+  trace += "}";
+  std::stringstream input;
+  for (int i = 0; i < 8; ++i) {
+    input << (i == 5 ? "not json" : trace) << "\n";
+  }
+
+  meili::BatchMatcher matcher(conf, 3, 2);
+  meili::BatchMatcher::edge_speeds_t speeds;
+  EXPECT_EQ(matcher.MatchSpeeds(input, speeds), 7);
+  ASSERT_FALSE(speeds.empty());
+  size_t full = 0;
+  for (const auto& edge : speeds) {
+    EXPECT_TRUE(edge.first.Is_Valid());
+    EXPECT_EQ(edge.second.count % 7, 0);
+    if (edge.second.length > 50 * 7) {
+      EXPECT_NEAR(edge.second.speed(), 10, 2) << edge.first;
+      ++full;
+    }
+  }
+  EXPECT_GT(full, 0);
+}
+
 TEST(Mapmatch, test32bit) {
   tyr::actor_t actor(conf, true);
   std::string test_case =
@@ -1302,6 +1429,47 @@ TEST(Mapmatch, interpolation) {
   }
 }
 
+TEST(Mapmatch, adaptive_interpolation) {
+  // a trace up a straight road sampled every 5 meters and half a second
+  const std::vector<PointLL> points{{5.120852, 52.068882},
+                                    {5.121185, 52.069671},
+                                    {5.121523, 52.070380},
+                                    {5.121828, 52.070947}};
+  std::string shape;
+  double time = 0;
+  size_t count = 0;
+  for (size_t i = 0; i + 1 < points.size(); ++i) {
+    const auto steps = static_cast<size_t>(points[i].Distance(points[i + 1]) / 5);
+    for (size_t step = 0; step < steps; ++step, ++count, time += 0.5) {
+      const double along = static_cast<double>(step) / steps;
+      shape += R"({"lon":)" +
+               std::to_string(points[i].lng() + (points[i + 1].lng() - points[i].lng()) * along) +
+               R"(,"lat":)" +
+               std::to_string(points[i].lat() + (points[i + 1].lat() - points[i].lat()) * along) +
+               R"(,"time":)" + std::to_string(time) + "},";
+    }
+  }
+  shape += R"({"lon":)" + std::to_string(points.back().lng()) + R"(,"lat":)" +
+           std::to_string(points.back().lat()) + R"(,"time":)" + std::to_string(time) + "}";
+  ++count;
+
+  tyr::actor_t actor(conf, true);
+  std::vector<std::vector<std::string>> way_ids;
+  for (const auto* adaptive : {"false", "true"}) {
+    auto matched = test::json_to_pt(actor.trace_attributes(
+        R"({"costing":"auto","shape_match":"map_snap","trace_options":{"adaptive_interpolation":)" +
+        std::string(adaptive) + R"(},"shape":[)" + shape + "]}"));
+    // every point still gets a result, those skipped are interpolated onto the same path
+    EXPECT_EQ(matched.get_child("matched_points").size(), count);
+    way_ids.emplace_back();
+    for (const auto& edge : matched.get_child("edges")) {
+      way_ids.back().push_back(edge.second.get<std::string>("way_id"));
+    }
+  }
+  EXPECT_FALSE(way_ids.front().empty());
+  EXPECT_EQ(way_ids.front(), way_ids.back());
+}
+
 TEST(Mapmatch, duplicated_end_points) {
   std::vector<std::string> test_cases = {
       R"({"shape":[
@@ -1,11 +1,14 @@
 #include "test.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
 #include "midgard/logging.h"
+#include "proto/matrix.pb.h"
 #include "sif/dynamiccost.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
@@ -28,9 +31,11 @@ class SimpleCost final : public DynamicCost {
 public:
   /**
    * Constructor.
-   * @param  options Request options in a pbf
+   * @param  options      Request options in a pbf
+   * @param  cost_factor  Cost of each second spent on an edge
    */
-  SimpleCost(const CostingOptions& options) : DynamicCost(options, TravelMode::kDrive, kAutoAccess) {
+  SimpleCost(const CostingOptions& options, const float cost_factor = 0.1f)
+      : DynamicCost(options, TravelMode::kDrive, kAutoAccess), cost_factor_(cost_factor) {
   }
 
   ~SimpleCost() {
@@ -80,7 +85,7 @@ public:
                 const graph_tile_ptr& /*tile*/,
                 const uint32_t /*seconds*/) const override {
     float sec = static_cast<float>(edge->length());
-    return {sec / 10.0f, sec};
+    return {sec * cost_factor_, sec};
   }
 
   Cost TransitionCost(const DirectedEdge* /*edge*/,
@@ -110,10 +115,13 @@ public:
       return 1.0f;
     }
   }
+
+private:
+  float cost_factor_;
 };
 
-cost_ptr_t CreateSimpleCost(const CostingOptions& options) {
-  return std::make_shared<SimpleCost>(options);
+cost_ptr_t CreateSimpleCost(const CostingOptions& options, const float cost_factor = 0.1f) {
+  return std::make_shared<SimpleCost>(options, cost_factor);
 }
 
 // Maximum edge score - base this on costing type.
@@ -276,6 +284,373 @@ TEST(Matrix, test_matrix) {
   }
 }
 
+TEST(Matrix, test_timedist_tree_cache) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())));
+
+  // the rows only asking for the nearest target leave smaller trees behind
+  ExpansionTreeCache cache(100 * 1024 * 1024);
+  TimeDistanceMatrix matrix;
+  matrix.SetTreeCache(&cache, ExpansionTreeCache::CostingKey(request.options()));
+  google::protobuf::RepeatedPtrField<valhalla::Location> nearest;
+  nearest.Add()->CopyFrom(request.options().targets(0));
+  for (const auto& source : request.options().sources()) {
+    matrix.OneToMany(source, nearest, reader, mode_costing, TravelMode::kDrive, 400000.0);
+    matrix.Clear();
+  }
+  EXPECT_EQ(cache.size(), static_cast<size_t>(request.options().sources_size()));
+  EXPECT_EQ(cache.hits(), 0);
+  const auto bytes = cache.bytes();
+
+  // which the rows to all of them carry on from
+  auto results = matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                       reader, mode_costing, TravelMode::kDrive, 400000.0);
+  EXPECT_EQ(cache.hits(), static_cast<uint64_t>(request.options().sources_size()));
+  EXPECT_GE(cache.bytes(), bytes);
+  ASSERT_EQ(results.size(), matrix_answers.size());
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    EXPECT_NEAR(results[i].dist, matrix_answers[i].dist, kThreshold) << "result " << i;
+    EXPECT_NEAR(results[i].time, matrix_answers[i].time, kThreshold) << "result " << i;
+  }
+
+  // and a tree which already reached every target is only looked at again
+  results = matrix.SourceToTarget(request.options().sources(), request.options().targets(), reader,
+                                  mode_costing, TravelMode::kDrive, 400000.0);
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    EXPECT_NEAR(results[i].dist, matrix_answers[i].dist, kThreshold) << "result " << i;
+    EXPECT_NEAR(results[i].time, matrix_answers[i].time, kThreshold) << "result " << i;
+  }
+}
+
+TEST(Matrix, test_matrix_limits) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  // the cost is the time so that the nearest targets are the quickest ones to get to
+  GraphReader reader(config.get_child("mjolnir"));
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())), 1.f);
+  const auto& sources = request.options().sources();
+  const auto& targets = request.options().targets();
+
+  CostMatrix matrix;
+  const auto expected =
+      matrix.SourceToTarget(sources, targets, reader, mode_costing, TravelMode::kDrive, 400000.0);
+  const uint32_t target_count = targets.size();
+
+  // only the nearest targets of each source are found, the same as without the limit
+  const uint32_t k = 2;
+  matrix.SetLimits(k, 0);
+  auto results =
+      matrix.SourceToTarget(sources, targets, reader, mode_costing, TravelMode::kDrive, 400000.0);
+  ASSERT_EQ(results.size(), expected.size());
+  for (int source = 0; source < sources.size(); ++source) {
+    std::vector<uint32_t> times;
+    for (uint32_t target = 0; target < target_count; ++target) {
+      if (expected[source * target_count + target].time != kMaxCost) {
+        times.push_back(expected[source * target_count + target].time);
+      }
+    }
+    std::sort(times.begin(), times.end());
+    ASSERT_GE(times.size(), k) << "source " << source;
+
+    uint32_t found = 0;
+    for (uint32_t target = 0; target < target_count; ++target) {
+      const auto i = source * target_count + target;
+      if (results[i].time == kMaxCost) {
+        EXPECT_GE(expected[i].time, times[k - 1]) << "result " << i;
+        continue;
+      }
+      ++found;
+      EXPECT_LE(expected[i].time, times[k - 1]) << "result " << i;
+      EXPECT_NEAR(results[i].dist, expected[i].dist, kThreshold) << "result " << i;
+      EXPECT_NEAR(results[i].time, expected[i].time, kThreshold) << "result " << i;
+    }
+    EXPECT_EQ(found, k) << "source " << source;
+  }
+
+  // a cutoff in the middle of the times with no pair close to it, the times are rounded
+  std::vector<uint32_t> times;
+  for (const auto& td : expected) {
+    if (td.time != kMaxCost) {
+      times.push_back(td.time);
+    }
+  }
+  std::sort(times.begin(), times.end());
+  float cutoff = 0;
+  for (size_t i = times.size() / 2; i + 1 < times.size() && cutoff == 0; ++i) {
+    if (times[i + 1] - times[i] >= 2) {
+      cutoff = (times[i] + times[i + 1]) / 2.f;
+    }
+  }
+  ASSERT_GT(cutoff, 0);
+
+  // exactly the pairs within the cutoff are found
+  matrix.SetLimits(0, cutoff);
+  results =
+      matrix.SourceToTarget(sources, targets, reader, mode_costing, TravelMode::kDrive, 400000.0);
+  ASSERT_EQ(results.size(), expected.size());
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    if (expected[i].time <= cutoff) {
+      EXPECT_NEAR(results[i].time, expected[i].time, kThreshold) << "result " << i;
+      EXPECT_NEAR(results[i].dist, expected[i].dist, kThreshold) << "result " << i;
+    } else {
+      EXPECT_EQ(results[i].time, kMaxCost) << "result " << i;
+    }
+  }
+}
+
+TEST(Matrix, test_matrix_time_dependent) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+  for (auto& source : *request.mutable_options()->mutable_sources()) {
+    source.set_date_time("2026-10-14T08:00");
+  }
+
+  GraphReader reader(config.get_child("mjolnir"));
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())));
+
+  // the costing doesnt depend on the time so the recosted paths take as long as without it
+  CostMatrix matrix;
+  auto results = matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                       reader, mode_costing, TravelMode::kDrive, 400000.0);
+  ASSERT_EQ(results.size(), matrix_answers.size());
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    const float tolerance = std::max(5.f, matrix_answers[i].time * 0.01f);
+    EXPECT_NEAR(results[i].time, matrix_answers[i].time, tolerance) << "result " << i;
+    EXPECT_NEAR(results[i].dist, matrix_answers[i].dist, tolerance) << "result " << i;
+  }
+}
+
+TEST(Matrix, test_matrix_recover_path) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())));
+  const auto& sources = request.options().sources();
+  const auto& targets = request.options().targets();
+
+  CostMatrix matrix;
+  auto results =
+      matrix.SourceToTarget(sources, targets, reader, mode_costing, TravelMode::kDrive, 400000.0);
+  auto on = [](const valhalla::Location& location, const GraphId& edgeid) {
+    for (const auto& edge : location.path_edges()) {
+      if (edge.graph_id() == edgeid) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // the path of every pair goes from the source to the target and takes as long as the matrix said
+  for (int source = 0; source < sources.size(); ++source) {
+    for (int target = 0; target < targets.size(); ++target) {
+      const auto& result = results[source * targets.size() + target];
+      auto path = matrix.RecoverShortestPath(reader, source, target, sources.Get(source),
+                                             targets.Get(target));
+      if (result.time == 0) {
+        EXPECT_TRUE(path.empty()) << source << " to " << target;
+        continue;
+      }
+      ASSERT_FALSE(path.empty()) << source << " to " << target;
+      EXPECT_TRUE(on(sources.Get(source), path.front().edgeid)) << source << " to " << target;
+      EXPECT_TRUE(on(targets.Get(target), path.back().edgeid)) << source << " to " << target;
+      EXPECT_NEAR(path.back().elapsed_cost.secs, result.time, std::max(5.f, result.time * 0.01f))
+          << source << " to " << target;
+    }
+  }
+}
+
+TEST(Matrix, test_matrix_parallel) {
+  loki_worker_t loki_worker(config);
+
+  // enough locations for the searches to actually be spread over the pool
+  const std::string locations = R"([
+      {"lat":52.106337,"lon":5.101728},
+      {"lat":52.111276,"lon":5.089717},
+      {"lat":52.103105,"lon":5.081005},
+      {"lat":52.103948,"lon":5.06813},
+      {"lat":52.106126,"lon":5.101497},
+      {"lat":52.100469,"lon":5.087099},
+      {"lat":52.094273,"lon":5.075254},
+      {"lat":52.097235,"lon":5.091351},
+      {"lat":52.089209,"lon":5.106871}
+    ])";
+  Api request;
+  ParseApi(R"({"sources":)" + locations + R"(,"targets":)" + locations + R"(,"costing":"auto"})",
+           Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())));
+
+  CostMatrix serial;
+  auto expected = serial.SourceToTarget(request.options().sources(), request.options().targets(),
+                                        reader, mode_costing, TravelMode::kDrive, 400000.0);
+
+  // the matrix must not depend on how many threads there are
+  for (uint32_t threads : {1, 3}) {
+    ExpansionPool pool(config.get_child("mjolnir"), threads);
+    CostMatrix parallel(label_limits_t(), &pool);
+    auto results = parallel.SourceToTarget(request.options().sources(), request.options().targets(),
+                                           reader, mode_costing, TravelMode::kDrive, 400000.0);
+    ASSERT_EQ(results.size(), expected.size());
+    for (uint32_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].dist, expected[i].dist) << "result " + std::to_string(i);
+      EXPECT_EQ(results[i].time, expected[i].time) << "result " + std::to_string(i);
+    }
+  }
+
+  // the rows of the time distance matrix are independent searches
+  TimeDistanceMatrix serial_timedist;
+  expected = serial_timedist.SourceToTarget(request.options().sources(), request.options().targets(),
+                                            reader, mode_costing, TravelMode::kDrive, 400000.0);
+  ExpansionPool pool(config.get_child("mjolnir"), 3);
+  TimeDistanceMatrix parallel_timedist(label_limits_t(), &pool);
+  auto results =
+      parallel_timedist.SourceToTarget(request.options().sources(), request.options().targets(),
+                                       reader, mode_costing, TravelMode::kDrive, 400000.0);
+  ASSERT_EQ(results.size(), expected.size());
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].dist, expected[i].dist) << "result " + std::to_string(i);
+    EXPECT_EQ(results[i].time, expected[i].time) << "result " + std::to_string(i);
+  }
+}
+
+TEST(Matrix, test_matrix_duplicates) {
+  loki_worker_t loki_worker(config);
+  thor_worker_t thor_worker(config);
+  auto matrix = [&](const std::string& sources, const std::string& targets) {
+    Api request;
+    ParseApi(R"({"sources":)" + sources + R"(,"targets":)" + targets + R"(,"costing":"auto"})",
+             Options::sources_to_targets, request);
+    loki_worker.matrix(request);
+    rapidjson::Document response;
+    response.Parse(thor_worker.matrix(request));
+    return response;
+  };
+
+  // the repeated locations get the rows and columns of the first of them
+  const std::string a = R"({"lat":52.106337,"lon":5.101728})";
+  const std::string b = R"({"lat":52.111276,"lon":5.089717})";
+  const std::string c = R"({"lat":52.094273,"lon":5.075254})";
+  auto expected = matrix("[" + a + "," + b + "]", "[" + b + "," + c + "]");
+  auto actual =
+      matrix("[" + a + "," + b + "," + a + "]", "[" + b + "," + c + "," + c + "," + b + "]");
+  const std::vector<uint32_t> sources{0, 1, 0}, targets{0, 1, 1, 0};
+  const auto& expected_rows = expected["sources_to_targets"];
+  const auto& actual_rows = actual["sources_to_targets"];
+  ASSERT_EQ(actual_rows.Size(), sources.size());
+  for (uint32_t i = 0; i < sources.size(); ++i) {
+    ASSERT_EQ(actual_rows[i].Size(), targets.size());
+    for (uint32_t j = 0; j < targets.size(); ++j) {
+      const auto& cell = actual_rows[i][j];
+      const auto& expected_cell = expected_rows[sources[i]][targets[j]];
+      EXPECT_TRUE(cell["time"] == expected_cell["time"]) << i << " " << j;
+      EXPECT_TRUE(cell["distance"] == expected_cell["distance"]) << i << " " << j;
+      EXPECT_EQ(cell["from_index"].GetUint(), i);
+      EXPECT_EQ(cell["to_index"].GetUint(), j);
+    }
+  }
+}
+
+TEST(Matrix, test_matrix_layouts) {
+  loki_worker_t loki_worker(config);
+  thor_worker_t thor_worker(config);
+  auto matrix = [&](const std::string& options) {
+    Api request;
+    ParseApi(std::string(test_request).substr(0, std::string(test_request).rfind('}')) + options +
+                 "}",
+             Options::sources_to_targets, request);
+    loki_worker.matrix(request);
+    return thor_worker.matrix(request);
+  };
+
+  rapidjson::Document verbose, compact;
+  verbose.Parse(matrix(""));
+  compact.Parse(matrix(R"(,"compact":true)"));
+  valhalla::Matrix binary;
+  ASSERT_TRUE(binary.ParseFromString(matrix(R"(,"format":"pbf")")));
+
+  // all three have the same numbers, just laid out differently
+  const auto& rows = verbose["sources_to_targets"];
+  const auto& times = compact["sources_to_targets"]["durations"];
+  const auto& distances = compact["sources_to_targets"]["distances"];
+  ASSERT_EQ(times.Size(), rows.Size());
+  ASSERT_EQ(binary.sources(), rows.Size());
+  ASSERT_EQ(binary.targets(), rows[0].Size());
+  ASSERT_EQ(binary.times_size(), rows.Size() * rows[0].Size());
+  EXPECT_EQ(binary.units(), "kilometers");
+  for (uint32_t i = 0; i < rows.Size(); ++i) {
+    ASSERT_EQ(times[i].Size(), rows[i].Size());
+    for (uint32_t j = 0; j < rows[i].Size(); ++j) {
+      EXPECT_TRUE(times[i][j] == rows[i][j]["time"]) << i << " " << j;
+      EXPECT_TRUE(distances[i][j] == rows[i][j]["distance"]) << i << " " << j;
+      EXPECT_EQ(binary.times(i * binary.targets() + j), rows[i][j]["time"].GetUint());
+      EXPECT_NEAR(binary.distances(i * binary.targets() + j), rows[i][j]["distance"].GetDouble(),
+                  0.001);
+    }
+  }
+}
+
+TEST(Matrix, test_matrix_row_blocks) {
+  // the rows are independent searches of the time distance matrix whichever way they are grouped
+  auto row_config = config;
+  row_config.put("thor.source_to_target_algorithm", "timedistancematrix");
+  loki_worker_t loki_worker(row_config);
+  thor_worker_t thor_worker(row_config);
+  row_config.put("thor.matrix_row_block_size", 3);
+  thor_worker_t block_worker(row_config);
+  auto matrix = [&](thor_worker_t& worker, const std::string& options) {
+    Api request;
+    ParseApi(std::string(test_request).substr(0, std::string(test_request).rfind('}')) + options +
+                 "}",
+             Options::sources_to_targets, request);
+    loki_worker.matrix(request);
+    return worker.matrix(request);
+  };
+
+  // a block of 3 rows and one of the last row come out just like all of the rows at once
+  for (const auto* options : {"", R"(,"compact":true)", R"(,"format":"osrm")"}) {
+    EXPECT_EQ(matrix(block_worker, options), matrix(thor_worker, options)) << options;
+  }
+  valhalla::Matrix expected, actual;
+  ASSERT_TRUE(expected.ParseFromString(matrix(thor_worker, R"(,"format":"pbf")")));
+  ASSERT_TRUE(actual.ParseFromString(matrix(block_worker, R"(,"format":"pbf")")));
+  EXPECT_EQ(actual.SerializeAsString(), expected.SerializeAsString());
+  EXPECT_EQ(actual.times_size(), 16);
+}
+
 // TODO: it was commented before. Why?
 TEST(Matrix, DISABLED_test_matrix_osrm) {
   loki_worker_t loki_worker(config);
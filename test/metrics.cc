@@ -0,0 +1,95 @@
+#include "metrics.h"
+
+#include <string>
+
+#include "test.h"
+
+using namespace valhalla;
+
+namespace {
+
+Api request_with(Options::Action action, double loki, double thor, double hits) {
+  Api request;
+  request.mutable_options()->set_action(action);
+  auto* stat = request.mutable_info()->add_statistics();
+  stat->set_name("loki_worker_t::route");
+  stat->set_value(loki);
+  stat = request.mutable_info()->add_statistics();
+  stat->set_name("thor_worker_t::route");
+  stat->set_value(thor);
+  stat = request.mutable_info()->add_statistics();
+  stat->set_name("loki_worker_t::search_cache_hits");
+  stat->set_value(hits);
+  stat->set_type(Statistic::count);
+  return request;
+}
+
+TEST(Metrics, Record) {
+  auto& metrics = metrics_t::get();
+  metrics.clear();
+  metrics.record(request_with(Options::route, 0.3, 7, 2), 200);
+  metrics.record(request_with(Options::route, 1, 20000, 1), 200);
+  metrics.record(request_with(Options::route, 0.2, 4, 0), 400);
+  // no action means nothing to record it under
+  metrics.record(Api{}, 200);
+  metrics.add_tile_cache_lookups("loki", 10, 2);
+  metrics.add_tile_cache_lookups("loki", 5, 0);
+
+  auto text = metrics.serialize();
+  auto has = [&text](const std::string& line) { return text.find(line + "\n") != std::string::npos; };
+  EXPECT_TRUE(has("valhalla_responses_total{action=\"route\",status=\"200\"} 2"));
+  EXPECT_TRUE(has("valhalla_responses_total{action=\"route\",status=\"400\"} 1"));
+  // the buckets count everything at or below their bound
+  EXPECT_TRUE(has(
+      "valhalla_stage_milliseconds_bucket{action=\"route\",stage=\"loki_worker_t::route\",le=\"0.25\"} 1"));
+  EXPECT_TRUE(has(
+      "valhalla_stage_milliseconds_bucket{action=\"route\",stage=\"loki_worker_t::route\",le=\"1\"} 3"));
+  EXPECT_TRUE(has(
+      "valhalla_stage_milliseconds_bucket{action=\"route\",stage=\"thor_worker_t::route\",le=\"10000\"} 2"));
+  EXPECT_TRUE(has(
+      "valhalla_stage_milliseconds_bucket{action=\"route\",stage=\"thor_worker_t::route\",le=\"+Inf\"} 3"));
+  EXPECT_TRUE(has("valhalla_stage_milliseconds_count{action=\"route\",stage=\"thor_worker_t::route\"} 3"));
+  EXPECT_TRUE(
+      has("valhalla_stage_count_total{action=\"route\",statistic=\"loki_worker_t::search_cache_hits\"} 3"));
+  EXPECT_EQ(text.find("search_cache_hits\",le="), std::string::npos);
+  EXPECT_TRUE(has("valhalla_tile_cache_lookups_total{stage=\"loki\",result=\"hit\"} 15"));
+  EXPECT_TRUE(has("valhalla_tile_cache_lookups_total{stage=\"loki\",result=\"miss\"} 2"));
+
+  metrics.clear();
+  EXPECT_EQ(metrics.serialize().find("action="), std::string::npos);
+}
+
+TEST(Metrics, Memory) {
+  auto& metrics = metrics_t::get();
+  metrics.clear();
+  for (double bytes : {1000., 3e6, 5e9}) {
+    Api request;
+    request.mutable_options()->set_action(Options::isochrone);
+    auto* stat = request.mutable_info()->add_statistics();
+    stat->set_name("thor_worker_t::peak_search_memory");
+    stat->set_value(bytes);
+    stat->set_type(Statistic::memory);
+    metrics.record(request, 200);
+  }
+
+  auto text = metrics.serialize();
+  auto has = [&text](const std::string& line) { return text.find(line + "\n") != std::string::npos; };
+  // the bounds are whole bytes and memory isnt mixed up with the timings
+  EXPECT_TRUE(has(
+      "valhalla_stage_memory_bytes_bucket{action=\"isochrone\",stage=\"thor_worker_t::peak_search_memory\",le=\"1048576\"} 1"));
+  EXPECT_TRUE(has(
+      "valhalla_stage_memory_bytes_bucket{action=\"isochrone\",stage=\"thor_worker_t::peak_search_memory\",le=\"4194304\"} 2"));
+  EXPECT_TRUE(has(
+      "valhalla_stage_memory_bytes_bucket{action=\"isochrone\",stage=\"thor_worker_t::peak_search_memory\",le=\"4294967296\"} 2"));
+  EXPECT_TRUE(has(
+      "valhalla_stage_memory_bytes_count{action=\"isochrone\",stage=\"thor_worker_t::peak_search_memory\"} 3"));
+  EXPECT_EQ(text.find("valhalla_stage_milliseconds_bucket{action=\"isochrone\""), std::string::npos);
+  metrics.clear();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
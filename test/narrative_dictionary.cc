@@ -1337,6 +1337,34 @@ TEST(NarrativeDictionary, test_en_US_approach_verbal_alert) {
   validate(us_customary_lengths, kExpectedUsCustomaryLengths);
 }
 
+TEST(NarrativeDictionary, test_tagged_phrases) {
+  const NarrativeDictionary& dictionary = GetNarrativeDictionary("en-US");
+
+  // "2": "Head <CARDINAL_DIRECTION> on <BEGIN_STREET_NAMES>. Continue on <STREET_NAMES>."
+  std::string instruction = "whatever was there before";
+  const std::string cardinal_direction = "north", street_names = "Main Street",
+                    begin_street_names = "<STREET_NAMES> Way";
+  dictionary.start_subset.phrase(2).Format(instruction,
+                                           {{kCardinalDirectionTag, cardinal_direction},
+                                            {kStreetNamesTag, street_names},
+                                            {kBeginStreetNamesTag, begin_street_names}});
+  // tags are only replaced where the phrase has them, not within the values
+  validate(instruction, "Head north on <STREET_NAMES> Way. Continue on Main Street.");
+
+  // tags without values stay as they are
+  dictionary.start_subset.phrase(2).Format(instruction, {{kStreetNamesTag, street_names}});
+  validate(instruction,
+           "Head <CARDINAL_DIRECTION> on <BEGIN_STREET_NAMES>. Continue on Main Street.");
+
+  // as do angle brackets which arent tags
+  TaggedPhrase phrase("a < b <STREET_NAMES>> c <");
+  phrase.Format(instruction, {{kStreetNamesTag, street_names}});
+  validate(instruction, "a < b Main Street> c <");
+
+  EXPECT_THROW(dictionary.start_subset.phrase(3), std::out_of_range);
+  EXPECT_THROW(dictionary.start_subset.phrase(200), std::out_of_range);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -3229,6 +3229,28 @@ TEST(NarrativeBuilder, TestBuildStartInstructions_0_miles_en_US) {
   TryBuild(options, maneuvers, expected_maneuvers);
 }
 
+TEST(NarrativeBuilder, TestBuildStartInstructions_0_miles_en_US_without_verbal) {
+  std::string country_code = "US";
+  std::string state_code = "PA";
+
+  // Configure directions options
+  Options options;
+  options.set_units(Options::miles);
+  options.set_language("en-US");
+  options.set_verbal_instructions(false);
+
+  // Configure maneuvers
+  std::list<Maneuver> maneuvers;
+  PopulateStartManeuverList_0(maneuvers, country_code, state_code);
+
+  // Only the text instruction is formed
+  std::list<Maneuver> expected_maneuvers;
+  PopulateStartManeuverList_0(expected_maneuvers, country_code, state_code);
+  SetExpectedManeuverInstructions(expected_maneuvers, "Head east.", "", "", "");
+
+  TryBuild(options, maneuvers, expected_maneuvers);
+}
+
 TEST(NarrativeBuilder, TestBuildStartInstructions_1_miles_en_US) {
   std::string country_code = "US";
   std::string state_code = "PA";
@@ -9871,6 +9893,23 @@ TEST(NarrativeBuilder, TestFormExitLeftInstruction) {
       "Take the Gettysburg Pike exit onto US 15 toward Harrisburg/Gettysburg.");
 }
 
+TEST(NarrativeBuilder, TestFactoryLocales) {
+  Options options;
+  // the aliases of a locale get the builder of its language
+  options.set_language("it");
+  auto builder = NarrativeBuilderFactory::Create(options, nullptr);
+  EXPECT_NE(dynamic_cast<NarrativeBuilder_itIT*>(builder.get()), nullptr);
+  options.set_language("cs-CZ");
+  builder = NarrativeBuilderFactory::Create(options, nullptr);
+  EXPECT_NE(dynamic_cast<NarrativeBuilder_csCZ*>(builder.get()), nullptr);
+  options.set_language("en-US");
+  builder = NarrativeBuilderFactory::Create(options, nullptr);
+  EXPECT_EQ(typeid(*builder), typeid(NarrativeBuilder));
+
+  options.set_language("xx-XX");
+  EXPECT_THROW(NarrativeBuilderFactory::Create(options, nullptr), std::runtime_error);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -8,6 +8,7 @@
 #include "baldr/graphid.h"
 #include "baldr/graphreader.h"
 #include "baldr/location.h"
+#include "baldr/spatialindex.h"
 #include "baldr/tilehierarchy.h"
 #include "midgard/pointll.h"
 #include "midgard/vector2.h"
@@ -21,6 +22,7 @@ namespace vb = valhalla::baldr;
 #include "mjolnir/directededgebuilder.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/graphvalidator.h"
+#include "mjolnir/spatialindexbuilder.h"
 
 namespace vj = valhalla::mjolnir;
 
@@ -414,6 +416,48 @@ TEST(Search, test_opposite_in_another_tile) {
   EXPECT_EQ(nodes.size(), 1) << "Expecting to find one node";
 }
 
+TEST(Search, test_spatial_index) {
+  std::stringstream json;
+  json << "{ \"mjolnir\": { \"tile_dir\": \"" << test_tile_dir << "\", \"spatial_index\": true } }";
+  boost::property_tree::ptree conf;
+  rapidjson::read_json(json, conf);
+  vj::SpatialIndexBuilder::Build(conf);
+
+  vb::GraphReader reader(conf.get_child("mjolnir"));
+  vb::SpatialIndex index(vb::SpatialIndex::FileName(test_tile_dir));
+
+  // the same nodes are found with the index as with the bins, the grid of nodes is connected
+  for (const auto& box : {vm::AABB2<vm::PointLL>{{-0.0025, -0.0025}, {0.0025, 0.0025}},
+                          vm::AABB2<vm::PointLL>{{0.0, 0.0}, {0.0051, 0.0051}},
+                          vm::AABB2<vm::PointLL>{{0.0, 0.250}, {0.001, 0.253}},
+                          vm::AABB2<vm::PointLL>{{0.5, 0.5}, {0.51, 0.51}},
+                          vm::AABB2<vm::PointLL>{{0.1, 0.2}, {0.3, 0.35}}}) {
+    EXPECT_EQ(valhalla::loki::nodes_in_bbox(box, reader, &index),
+              valhalla::loki::nodes_in_bbox(box, reader));
+
+    // every edge is there, possibly as its opposing edge
+    auto edges = valhalla::loki::edges_in_bbox(box, reader, &index);
+    std::unordered_set<vb::GraphId> found(edges.begin(), edges.end());
+    for (const auto& edge_id : valhalla::loki::edges_in_bbox(box, reader)) {
+      EXPECT_TRUE(found.count(edge_id) || found.count(reader.GetOpposingEdgeId(edge_id)));
+    }
+  }
+
+  // the nearest nodes come closest first
+  vm::PointLL point(0.0049, 0.0051);
+  auto nearest = index.NearestNodes(point, 3);
+  ASSERT_EQ(nearest.size(), 3);
+  double last = 0;
+  for (const auto& node_id : nearest) {
+    auto distance = reader.GetGraphTile(node_id)->get_node_ll(node_id).Distance(point);
+    EXPECT_LE(last, distance + 1e-3);
+    last = distance;
+  }
+  auto closest = reader.GetGraphTile(nearest.front())->get_node_ll(nearest.front());
+  EXPECT_NEAR(closest.lng(), 0.005, 1e-6);
+  EXPECT_NEAR(closest.lat(), 0.005, 1e-6);
+}
+
 // Setup and tearown will be called only once for the entire suite
 class Env : public ::testing::Environment {
 public:
@@ -1,6 +1,11 @@
 #include "thor/optimizer.h"
 #include "config.h"
+#include "thor/local_search_optimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <random>
 #include <vector>
 
 #include "test.h"
@@ -19,6 +24,47 @@ void TryOptimizer(const uint32_t nlocs,
   EXPECT_EQ(order, expected_order);
 }
 
+float TourCost(const uint32_t nlocs,
+               const std::vector<float>& costs,
+               const std::vector<uint32_t>& order) {
+  float cost = 0.f;
+  for (size_t i = 0; i + 1 < order.size(); ++i) {
+    cost += costs[order[i] * nlocs + order[i + 1]];
+  }
+  return cost;
+}
+
+// the order has to visit every location once and keep the ends in place
+void ExpectValidOrder(const uint32_t nlocs, const std::vector<uint32_t>& order) {
+  ASSERT_EQ(order.size(), nlocs);
+  EXPECT_EQ(order.front(), 0);
+  EXPECT_EQ(order.back(), nlocs - 1);
+  auto sorted = order;
+  std::sort(sorted.begin(), sorted.end());
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    EXPECT_EQ(sorted[i], i);
+  }
+}
+
+// asymmetric costs between random points, going east costs a bit more than going west
+std::vector<float> RandomCosts(const uint32_t nlocs) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> coordinate(0.f, 10000.f);
+  std::vector<std::pair<float, float>> points;
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    points.emplace_back(coordinate(generator), coordinate(generator));
+  }
+  std::vector<float> costs(nlocs * nlocs);
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    for (uint32_t j = 0; j < nlocs; ++j) {
+      float dx = points[j].first - points[i].first;
+      float dy = points[j].second - points[i].second;
+      costs[i * nlocs + j] = std::round(std::sqrt(dx * dx + dy * dy) + std::max(dx, 0.f) * 0.1f);
+    }
+  }
+  return costs;
+}
+
 TEST(Optimizer, Basic) {
   std::vector<float> costs = {0,    3036, 707,  956,  318,  1934, 355,  1170, 1286, 3171, 2133,
                               2978, 0,    2664, 3613, 3102, 2011, 3139, 3846, 1764, 2050, 1143,
@@ -35,6 +81,61 @@ TEST(Optimizer, Basic) {
   TryOptimizer(11, costs, expected_order);
 }
 
+TEST(LocalSearchOptimizer, Basic) {
+  std::vector<float> costs = {0,    3036, 707,  956,  318,  1934, 355,  1170, 1286, 3171, 2133,
+                              2978, 0,    2664, 3613, 3102, 2011, 3139, 3846, 1764, 2050, 1143,
+                              638,  2638, 0,    1295, 763,  1536, 800,  1528, 888,  2773, 1735,
+                              940,  3457, 1281, 0,    582,  2450, 630,  655,  1796, 3681, 2643,
+                              357,  3037, 708,  637,  0,    1935, 47,   851,  1286, 3171, 2133,
+                              1839, 2004, 1525, 2480, 1963, 0,    2000, 2713, 690,  2578, 1100,
+                              387,  3066, 737,  715,  77,   1964, 0,    928,  1316, 3201, 2163,
+                              1129, 3803, 1537, 682,  769,  2707, 819,  0,    2052, 3230, 2899,
+                              1214, 1750, 900,  1849, 1338, 634,  1375, 2082, 0,    1907, 846,
+                              3128, 2036, 2814, 3763, 3252, 2549, 3290, 3228, 1914, 0,    2010,
+                              2068, 1133, 1754, 2704, 2193, 1102, 2230, 2937, 854,  2000, 0};
+  std::vector<uint32_t> annealing_order = {0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10};
+
+  valhalla::baldr::GraphReader reader(test::json_to_pt(R"({"tile_dir":"test/data/none"})"));
+  LocalSearchOptimizer optimizer;
+  optimizer.Seed(111111);
+  auto order = optimizer.Solve(11, costs, std::chrono::milliseconds(1000), reader);
+  ExpectValidOrder(11, order);
+  EXPECT_LE(TourCost(11, costs, order), TourCost(11, costs, annealing_order));
+}
+
+TEST(LocalSearchOptimizer, FewLocationsAreExhaustive) {
+  const uint32_t nlocs = 7;
+  auto costs = RandomCosts(nlocs);
+  std::vector<uint32_t> best = {0, 1, 2, 3, 4, 5, 6}, order = best;
+  while (std::next_permutation(order.begin() + 1, order.end() - 1)) {
+    if (TourCost(nlocs, costs, order) < TourCost(nlocs, costs, best)) {
+      best = order;
+    }
+  }
+
+  valhalla::baldr::GraphReader reader(test::json_to_pt(R"({"tile_dir":"test/data/none"})"));
+  LocalSearchOptimizer optimizer;
+  EXPECT_EQ(optimizer.Solve(nlocs, costs, std::chrono::milliseconds(0), reader), best);
+}
+
+TEST(LocalSearchOptimizer, ManyLocationsInParallel) {
+  const uint32_t nlocs = 60;
+  auto costs = RandomCosts(nlocs);
+  const auto config = test::json_to_pt(R"({"tile_dir":"test/data/none"})");
+  valhalla::baldr::GraphReader reader(config);
+  ExpansionPool pool(config, 3);
+  LocalSearchOptimizer optimizer(&pool);
+  optimizer.Seed(111111);
+  auto order = optimizer.Solve(nlocs, costs, std::chrono::milliseconds(2000), reader);
+  ExpectValidOrder(nlocs, order);
+
+  // it should do a lot better than annealing on this many locations
+  Optimizer annealing;
+  annealing.Seed(111111);
+  auto annealing_order = annealing.Solve(nlocs, costs);
+  EXPECT_LE(TourCost(nlocs, costs, order), TourCost(nlocs, costs, annealing_order));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -350,6 +350,25 @@ TEST(PointLL, TestDistance) {
                                        " between points should be approx 556599.5 meters";
 }
 
+TEST(PointLL, TestDistances) {
+  // some ordinary segments, a repeated point, half way around the world and a tiny hop
+  std::vector<PointLL> points{{-76.3, 40.1},  {-76.29, 40.11}, {-76.29, 40.11}, {103.71, -40.11},
+                              {103.7, 40.11}, {103.7, 40.11},   {103.7, 40.1100000001}};
+  std::vector<double> lngs, lats;
+  for (const auto& point : points) {
+    lngs.push_back(point.lng());
+    lats.push_back(point.lat());
+  }
+  std::vector<double> distances(points.size() - 1, -1);
+  PointLL::Distances(lngs.data(), lats.data(), distances.size(), distances.data());
+  for (size_t i = 0; i < distances.size(); ++i) {
+    EXPECT_NEAR(distances[i], points[i].Distance(points[i + 1]), 1e-6)
+        << "Wrong distance at " << i;
+  }
+  // nothing to do without segments
+  PointLL::Distances(lngs.data(), lats.data(), 0, nullptr);
+}
+
 } // namespace
 
 // todo: add many more tests!
@@ -2,6 +2,7 @@
 #include <cstdint>
 
 #include <algorithm>
+#include <list>
 #include <vector>
 
 #include "midgard/point2.h"
@@ -157,6 +158,26 @@ TEST(Polyline2, TestGeneralizeSimplification) {
   }
 }
 
+TEST(Polyline2, TestGeneralizeVectorMatchesList) {
+  // the vector is generalized in place rather than by erasing as the list is, same answer though
+  std::vector<Point2> wiggly;
+  for (int i = 0; i < 500; ++i) {
+    wiggly.emplace_back(i, (i * 7919) % 13 - 6 + (i % 50 == 0 ? 40 : 0));
+  }
+  for (float epsilon : {0.5f, 3.f, 10.f, 50.f}) {
+    for (const auto& indices :
+         {std::unordered_set<size_t>{}, std::unordered_set<size_t>{1, 17, 250, 251, 498}}) {
+      auto vector = wiggly;
+      std::list<Point2> list(wiggly.begin(), wiggly.end());
+      Polyline2<Point2>::Generalize(vector, epsilon, indices);
+      Polyline2<Point2>::Generalize(list, epsilon, indices);
+      EXPECT_LT(vector.size(), wiggly.size());
+      EXPECT_TRUE(std::equal(vector.begin(), vector.end(), list.begin(), list.end()))
+          << "epsilon " << epsilon;
+    }
+  }
+}
+
 void TryClosestPoint(const Polyline2<Point2>& pl, const Point2& a, const Point2& b) {
   auto result = pl.ClosestPoint(a);
   EXPECT_EQ(std::get<0>(result), b);
@@ -254,6 +254,33 @@ TEST(PredictedSpeeds, test_compress_decompress_accuracy) {
   EXPECT_LE(max_diff, 2.f) << "Low decompression accuracy"; // <= 2 KPH
 }
 
+TEST(PredictedSpeeds, test_cached_speeds) {
+  std::array<float, kBucketsPerWeek> speeds;
+  for (uint32_t i = 0; i < kBucketsPerWeek; ++i)
+    speeds[i] = roundf(50.f + 20.f * cos(i / 30.f));
+  auto first = compress_speed_buckets(speeds.data());
+  for (uint32_t i = 0; i < kBucketsPerWeek; ++i)
+    speeds[i] = roundf(40.f - 10.f * sin(i / 10.f));
+  auto second = compress_speed_buckets(speeds.data());
+
+  // remembered speeds are the same as the recovered ones, whichever profile was asked for last
+  for (int pass = 0; pass < 2; ++pass) {
+    for (uint32_t i = 0; i < kBucketsPerWeek; ++i) {
+      EXPECT_EQ(cached_speed_bucket(first.data(), i), decompress_speed_bucket(first.data(), i));
+      EXPECT_EQ(cached_speed_bucket(second.data(), i), decompress_speed_bucket(second.data(), i));
+    }
+  }
+
+  // and the profile changing under the same memory is noticed once a tile goes away
+  cached_speed_bucket(first.data(), 7);
+  first = second;
+  {
+    PredictedSpeeds gone;
+    gone.set_profiles(second.data());
+  }
+  EXPECT_EQ(cached_speed_bucket(first.data(), 7), decompress_speed_bucket(second.data(), 7));
+}
+
 struct EncoderDecoderTest : public ::testing::Test {
   EncoderDecoderTest() {
     // fill in coefficients
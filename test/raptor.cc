@@ -0,0 +1,219 @@
+#include "thor/raptor.h"
+#include "thor/transit_timetable.h"
+
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::thor;
+using valhalla::baldr::GraphId;
+using valhalla::baldr::TransitSchedule;
+
+namespace {
+
+const TransitSchedule kEveryDay(~0ULL, 127, 63);
+const TransitSchedule kNoDay(0, 0, 63);
+
+GraphId platform(const uint32_t id) {
+  return GraphId(0, 3, id);
+}
+
+GraphId line(const uint32_t from, const uint32_t to) {
+  return GraphId(0, 3, from * 100 + to);
+}
+
+// A trip along the platforms leaving the first at a time and taking 5 minutes between platforms
+TransitTimetable::trip_stops_t trip(const uint32_t tripid,
+                                    const std::vector<uint32_t>& platforms,
+                                    const uint32_t departure,
+                                    const uint32_t minutes = 5,
+                                    const TransitSchedule& schedule = kEveryDay,
+                                    const bool wheelchair = true) {
+  TransitTimetable::trip_stops_t stops{{tripid, 0, schedule, 0, wheelchair, true}, {}, {}, {}};
+  for (size_t i = 0; i < platforms.size(); ++i) {
+    stops.platforms.push_back(platform(platforms[i]));
+    if (i + 1 < platforms.size()) {
+      stops.lines.push_back(line(platforms[i], platforms[i + 1]));
+    }
+    const uint32_t time = departure + i * minutes * 60;
+    stops.times.push_back({time, time});
+  }
+  return stops;
+}
+
+Raptor::query_t query(const uint32_t departure) {
+  return {departure, 0, 1, false, false, 30, 60, 5};
+}
+
+TEST(Raptor, Layout) {
+  TransitTimetable timetable({trip(1, {0, 1, 2}, 28800), trip(2, {0, 1, 2}, 30600),
+                              trip(3, {2, 3}, 28800)},
+                             {});
+  EXPECT_EQ(timetable.stop_count(), 4);
+  EXPECT_EQ(timetable.route_count(), 2);
+  EXPECT_EQ(timetable.trip_count(), 3);
+  EXPECT_EQ(timetable.stop(platform(9)), TransitTimetable::kInvalid);
+
+  // the stop where both routes meet knows both
+  auto routes = timetable.stop_routes(timetable.stop(platform(2)));
+  EXPECT_EQ(routes.second - routes.first, 2);
+
+  // the trips of a route are in the order they leave
+  const auto first = timetable.stop_routes(timetable.stop(platform(0))).first->first;
+  const auto& route = timetable.route(first);
+  EXPECT_EQ(route.trip_count, 2);
+  EXPECT_EQ(timetable.time(route, 0, 0).departure, 28800);
+  EXPECT_EQ(timetable.time(route, 1, 2).arrival, 30600 + 600);
+  EXPECT_EQ(timetable.route_line(route, 1), line(1, 2));
+}
+
+TEST(Raptor, EarliestTrip) {
+  TransitTimetable timetable({trip(1, {0, 1, 2}, 28800), trip(2, {0, 1, 2}, 30600)}, {});
+  Raptor raptor(timetable);
+  Raptor::journey_t journey;
+
+  // the walk makes the first trip
+  ASSERT_TRUE(raptor.Search(query(28500), {{timetable.stop(platform(0)), 60}},
+                            {{timetable.stop(platform(2)), 120}}, journey));
+  EXPECT_EQ(journey.arrival, 28800 + 600 + 120);
+  ASSERT_EQ(journey.legs.size(), 1);
+  EXPECT_EQ(journey.legs[0].departure, 28800);
+  EXPECT_EQ(timetable.trip(journey.legs[0].trip).tripid, 1);
+  EXPECT_EQ(journey.legs[0].board, 0);
+  EXPECT_EQ(journey.legs[0].alight, 2);
+
+  // a longer one misses it
+  ASSERT_TRUE(raptor.Search(query(28500), {{timetable.stop(platform(0)), 400}},
+                            {{timetable.stop(platform(2)), 120}}, journey));
+  EXPECT_EQ(timetable.trip(journey.legs[0].trip).tripid, 2);
+
+  // and there is nothing after the last
+  EXPECT_FALSE(raptor.Search(query(31000), {{timetable.stop(platform(0)), 60}},
+                             {{timetable.stop(platform(2)), 120}}, journey));
+}
+
+TEST(Raptor, BestAccessAndEgress) {
+  TransitTimetable timetable({trip(1, {0, 1, 2}, 28800), trip(2, {3, 1}, 28800, 1)}, {});
+  Raptor raptor(timetable);
+  Raptor::journey_t journey;
+
+  // walking further to the other line gets there sooner
+  ASSERT_TRUE(raptor.Search(query(28000),
+                            {{timetable.stop(platform(0)), 60}, {timetable.stop(platform(3)), 300}},
+                            {{timetable.stop(platform(1)), 60}, {timetable.stop(platform(2)), 30}},
+                            journey));
+  EXPECT_EQ(journey.access, 1);
+  EXPECT_EQ(journey.egress, 0);
+  EXPECT_EQ(journey.arrival, 28800 + 60 + 60);
+}
+
+TEST(Raptor, Transfers) {
+  // the second line leaves from another platform of the station the first gets to
+  const std::vector<GraphId> edges{GraphId(0, 3, 500), GraphId(0, 3, 501)};
+  TransitTimetable timetable({trip(1, {0, 1}, 28800), trip(2, {2, 3}, 29100),
+                              trip(3, {2, 3}, 29160)},
+                             {{platform(1), platform(2), edges}});
+  Raptor raptor(timetable);
+  Raptor::journey_t journey;
+
+  // walking over takes just long enough to make the first trip
+  auto q = query(28700);
+  q.transfer_secs = 0;
+  ASSERT_TRUE(raptor.Search(q, {{timetable.stop(platform(0)), 0}},
+                            {{timetable.stop(platform(3)), 0}}, journey));
+  ASSERT_EQ(journey.legs.size(), 3);
+  EXPECT_EQ(timetable.trip(journey.legs[2].trip).tripid, 2);
+  ASSERT_NE(journey.legs[1].transfer, nullptr);
+  EXPECT_EQ(journey.legs[1].transfer->edge_count, 2);
+  EXPECT_EQ(timetable.transfer_edge(journey.legs[1].transfer->first_edge), GraphId(0, 3, 500));
+
+  q.transfer_secs = 60;
+  ASSERT_TRUE(raptor.Search(q, {{timetable.stop(platform(0)), 0}},
+                            {{timetable.stop(platform(3)), 0}}, journey));
+  EXPECT_EQ(timetable.trip(journey.legs[2].trip).tripid, 3);
+  EXPECT_EQ(journey.arrival, 29160 + 300);
+
+  q.transfer_secs = 61;
+  EXPECT_FALSE(raptor.Search(q, {{timetable.stop(platform(0)), 0}},
+                             {{timetable.stop(platform(3)), 0}}, journey));
+
+  // nor without enough rides
+  q.transfer_secs = 0;
+  q.max_rides = 1;
+  EXPECT_FALSE(raptor.Search(q, {{timetable.stop(platform(0)), 0}},
+                             {{timetable.stop(platform(3)), 0}}, journey));
+}
+
+TEST(Raptor, ChangeAtPlatform) {
+  TransitTimetable timetable({trip(1, {0, 1}, 28800), trip(2, {1, 2}, 29100),
+                              trip(3, {1, 2}, 29400)},
+                             {});
+  Raptor raptor(timetable);
+  Raptor::journey_t journey;
+
+  // getting off one trip and onto another takes time too
+  auto q = query(28800);
+  q.change_secs = 0;
+  ASSERT_TRUE(raptor.Search(q, {{timetable.stop(platform(0)), 0}},
+                            {{timetable.stop(platform(2)), 0}}, journey));
+  ASSERT_EQ(journey.legs.size(), 2);
+  EXPECT_EQ(timetable.trip(journey.legs[1].trip).tripid, 2);
+
+  q.change_secs = 1;
+  ASSERT_TRUE(raptor.Search(q, {{timetable.stop(platform(0)), 0}},
+                            {{timetable.stop(platform(2)), 0}}, journey));
+  EXPECT_EQ(timetable.trip(journey.legs[1].trip).tripid, 3);
+}
+
+TEST(Raptor, Overtaking) {
+  // the express leaves later and gets there first so it cant be on the same route
+  TransitTimetable timetable({trip(1, {0, 1, 2}, 28800, 10), trip(2, {0, 1, 2}, 29100, 2)}, {});
+  EXPECT_EQ(timetable.route_count(), 2);
+
+  Raptor raptor(timetable);
+  Raptor::journey_t journey;
+  ASSERT_TRUE(raptor.Search(query(28700), {{timetable.stop(platform(0)), 0}},
+                            {{timetable.stop(platform(2)), 0}}, journey));
+  EXPECT_EQ(timetable.trip(journey.legs[0].trip).tripid, 2);
+  EXPECT_EQ(journey.arrival, 29100 + 240);
+}
+
+TEST(Raptor, TripsNotRunning) {
+  TransitTimetable timetable({trip(1, {0, 1}, 28800, 5, kNoDay), trip(2, {0, 1}, 29400, 5,
+                                                                        kEveryDay, false),
+                              trip(3, {0, 1}, 30000)},
+                             {});
+  Raptor raptor(timetable);
+  Raptor::journey_t journey;
+
+  ASSERT_TRUE(raptor.Search(query(28000), {{timetable.stop(platform(0)), 0}},
+                            {{timetable.stop(platform(1)), 0}}, journey));
+  EXPECT_EQ(timetable.trip(journey.legs[0].trip).tripid, 2);
+
+  auto q = query(28000);
+  q.wheelchair = true;
+  ASSERT_TRUE(raptor.Search(q, {{timetable.stop(platform(0)), 0}},
+                            {{timetable.stop(platform(1)), 0}}, journey));
+  EXPECT_EQ(timetable.trip(journey.legs[0].trip).tripid, 3);
+}
+
+TEST(Raptor, FewestRides) {
+  // going around with a change gets there as early as staying on
+  TransitTimetable timetable({trip(1, {0, 1, 2}, 28800), trip(2, {0, 3}, 28800, 1),
+                              trip(3, {3, 2}, 29340, 1)},
+                             {});
+  Raptor raptor(timetable);
+  Raptor::journey_t journey;
+  ASSERT_TRUE(raptor.Search(query(28800), {{timetable.stop(platform(0)), 0}},
+                            {{timetable.stop(platform(2)), 0}}, journey));
+  EXPECT_EQ(journey.arrival, 28800 + 600);
+  EXPECT_EQ(journey.legs.size(), 1);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
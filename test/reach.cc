@@ -1,11 +1,14 @@
 #include "gurka/gurka.h"
 #include "test.h"
 
+#include "baldr/edgereach.h"
 #include "baldr/graphreader.h"
 #include "baldr/rapidjson_utils.h"
 #include "loki/reach.h"
+#include "loki/search.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "mjolnir/edgereachbuilder.h"
 #include "sif/costfactory.h"
 #include "sif/dynamiccost.h"
 
@@ -160,6 +163,74 @@ TEST(Reach, transition_misscount) {
   EXPECT_EQ(reach.outbound, 7);
 }
 
+TEST(Reach, stored_reach) {
+  // a bit of a grid and an island south of it
+  const std::string ascii_map = R"(
+      a--b--c--d
+      |  |  |  |
+      e--f--g--h
+      |  |  |  |
+      i--j--k--l
+
+      m--n
+    )";
+
+  const gurka::ways ways = {
+      {"abcd", {{"highway", "residential"}}}, {"efgh", {{"highway", "residential"}}},
+      {"ijkl", {{"highway", "residential"}}}, {"aei", {{"highway", "residential"}}},
+      {"bfj", {{"highway", "residential"}}},  {"cgk", {{"highway", "residential"}}},
+      {"dhl", {{"highway", "residential"}, {"oneway", "yes"}}},
+      {"mn", {{"highway", "residential"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/stored_reach",
+                               {{"mjolnir.edge_reach", "auto"}, {"mjolnir.edge_reach_cap", "10"}});
+  mjolnir::EdgeReachBuilder::Build(map.config);
+  EdgeReach edge_reach(EdgeReach::FileName(map.config.get<std::string>("mjolnir.tile_dir"), "auto"));
+  ASSERT_EQ(edge_reach.cap(), 10);
+
+  // the stored reach never claims more than the expansion finds
+  GraphReader reader(map.config.get_child("mjolnir"));
+  auto costing = sif::CostFactory{}.Create(valhalla::auto_);
+  Reach reach_finder;
+  for (auto tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    for (GraphId edge_id = tile->header()->graphid();
+         edge_id.id() < tile->header()->directededgecount(); ++edge_id) {
+      const auto* stored = edge_reach.reach(edge_id);
+      ASSERT_NE(stored, nullptr);
+      auto reach = reach_finder(tile->directededge(edge_id), edge_id, 10, reader, costing);
+      EXPECT_LE(stored[0], reach.outbound);
+      EXPECT_LE(stored[1], reach.inbound);
+    }
+  }
+
+  // the island is too small, the grid is not
+  auto island = gurka::findEdgeByNodes(reader, map.nodes, "m", "n");
+  EXPECT_LT(edge_reach.reach(std::get<0>(island))[0], 10);
+  auto grid = gurka::findEdgeByNodes(reader, map.nodes, "f", "g");
+  EXPECT_EQ(edge_reach.reach(std::get<0>(grid))[0], 10);
+  EXPECT_EQ(edge_reach.reach(std::get<0>(grid))[1], 10);
+
+  // and the search finds the same candidates with and without it
+  for (const auto& node : {"a", "g", "l", "m"}) {
+    baldr::Location location(map.nodes.at(node), baldr::Location::StopType::BREAK, 10, 10, 300);
+    auto expected = loki::Search({location}, reader, costing);
+    auto actual = loki::Search({location}, reader, costing, &edge_reach);
+    ASSERT_EQ(actual.size(), expected.size()) << node;
+    if (expected.empty()) {
+      continue;
+    }
+    const auto& expected_edges = expected.begin()->second.edges;
+    const auto& actual_edges = actual.begin()->second.edges;
+    ASSERT_EQ(actual_edges.size(), expected_edges.size()) << node;
+    for (size_t i = 0; i < expected_edges.size(); ++i) {
+      EXPECT_EQ(actual_edges[i].id, expected_edges[i].id) << node;
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1,5 +1,6 @@
 #include "test.h"
 
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -9,6 +10,7 @@
 #include "baldr/tilehierarchy.h"
 #include "midgard/encoded.h"
 #include "midgard/util.h"
+#include "mjolnir/shortcutbuilder.h"
 #include "src/baldr/shortcut_recovery.h"
 #include <boost/property_tree/ptree.hpp>
 
@@ -168,6 +170,41 @@ TEST(RecoverShortcut, test_recover_shortcut_edges_cache) {
   recover(true);
 }
 
+TEST(RecoverShortcut, test_recovered_by_mjolnir) {
+  auto conf = get_conf();
+  conf.put("mjolnir.shortcut_recovery", true);
+  mjolnir::ShortcutBuilder::Recover(conf);
+  const auto file_name = RecoveredShortcuts::FileName(conf.get<std::string>("mjolnir.tile_dir"));
+  RecoveredShortcuts recovered(file_name);
+
+  // they are the same as those recovered on the fly, through the reader or not
+  GraphReader stored(conf.get_child("mjolnir"));
+  conf.put("mjolnir.shortcut_recovery", false);
+  GraphReader graphreader(conf.get_child("mjolnir"));
+  testable_recovery recovery{nullptr};
+  size_t shortcuts = 0;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto tileid : graphreader.GetTileSet(level.level)) {
+      auto tile = graphreader.GetGraphTile(tileid);
+      for (GraphId edgeid = tileid; edgeid.id() < tile->header()->directededgecount(); ++edgeid) {
+        std::vector<GraphId> edgeids;
+        if (!tile->directededge(edgeid)->is_shortcut()) {
+          EXPECT_FALSE(recovered.Find(edgeid, edgeids));
+          continue;
+        }
+        ASSERT_TRUE(recovered.Find(edgeid, edgeids));
+        const auto expected = recovery.get(edgeid, graphreader);
+        EXPECT_EQ(edgeids, expected);
+        EXPECT_EQ(stored.RecoverShortcut(edgeid), expected);
+        ++shortcuts;
+      }
+    }
+  }
+  EXPECT_GT(shortcuts, 0);
+  EXPECT_EQ(recovered.shortcut_count(), shortcuts);
+  std::remove(file_name.c_str());
+}
+
 int main(int argc, char* argv[]) {
   // valhalla::midgard::logging::Configure({{"type", ""}});
   testing::InitGoogleTest(&argc, argv);
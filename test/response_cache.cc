@@ -0,0 +1,80 @@
+#include "tyr/response_cache.h"
+
+#include <thread>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::tyr;
+
+namespace {
+
+Options options_at(double lng, double lat, const std::string& date_time) {
+  Options options;
+  options.set_action(Options::isochrone);
+  auto* ll = options.add_locations()->mutable_ll();
+  ll->set_lng(lng);
+  ll->set_lat(lat);
+  options.set_date_time_type(Options::depart_at);
+  options.set_date_time(date_time);
+  return options;
+}
+
+TEST(ResponseCache, Key) {
+  ResponseCache cache(10, std::chrono::minutes(5), 15);
+  const auto key = cache.Key(options_at(5.1, 52.1, "2020-03-02T08:05"));
+  // closer than the precision of the tiles and in the same quarter of an hour
+  EXPECT_EQ(cache.Key(options_at(5.1000001, 52.1000004, "2020-03-02T08:14")), key);
+  EXPECT_NE(cache.Key(options_at(5.1, 52.1, "2020-03-02T08:15")), key);
+  EXPECT_NE(cache.Key(options_at(5.10001, 52.1, "2020-03-02T08:05")), key);
+  EXPECT_NE(cache.Key(options_at(5.1, 52.1, "2020-03-03T08:05")), key);
+  // leaving now is the same for everyone in the same bucket
+  EXPECT_EQ(cache.Key(options_at(5.1, 52.1, "current")), cache.Key(options_at(5.1, 52.1, "current")));
+  EXPECT_NE(cache.Key(options_at(5.1, 52.1, "current")), key);
+
+  auto other = options_at(5.1, 52.1, "2020-03-02T08:05");
+  other.set_action(Options::route);
+  EXPECT_NE(cache.Key(other), key);
+}
+
+TEST(ResponseCache, FindInsert) {
+  ResponseCache cache(2, std::chrono::minutes(5), 5);
+  ResponseCache::Response response;
+  EXPECT_FALSE(cache.Find("a", response));
+  cache.Insert("a", {"A", "application/json", false});
+  cache.Insert("b", {"B", "application/json", false});
+  EXPECT_TRUE(cache.Find("a", response));
+  EXPECT_EQ(response.body, "A");
+  // b was used the longest ago so it goes
+  cache.Insert("c", {"C", "application/json", false});
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_FALSE(cache.Find("b", response));
+  EXPECT_TRUE(cache.Find("c", response));
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(cache.misses(), 2);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Find("a", response));
+
+  ResponseCache none(0, std::chrono::minutes(5), 5);
+  EXPECT_FALSE(none.enabled());
+  none.Insert("a", {"A", "application/json", false});
+  EXPECT_EQ(none.size(), 0);
+}
+
+TEST(ResponseCache, TimeToLive) {
+  ResponseCache cache(2, std::chrono::milliseconds(10), 5);
+  cache.Insert("a", {"A", "application/json", false});
+  ResponseCache::Response response;
+  EXPECT_TRUE(cache.Find("a", response));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(cache.Find("a", response));
+  EXPECT_EQ(cache.size(), 0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
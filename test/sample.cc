@@ -5,9 +5,11 @@
 #include "midgard/sequence.h"
 #include "midgard/util.h"
 
+#include <atomic>
 #include <cmath>
 #include <fstream>
 #include <list>
+#include <thread>
 
 #include "test.h"
 
@@ -103,6 +105,101 @@ TEST(Sample, getgz) {
   _get("test/data/samplegz");
 };
 
+TEST(Sample, cache) {
+  skadi::sample s("test/data/samplegz", 1);
+  EXPECT_EQ(s.cache_hits(), 0);
+  EXPECT_EQ(s.cache_misses(), 0);
+
+  // the first sample unzips the tile, the second finds it
+  const auto height = s.get(std::make_pair(-76.503915, 40.678783));
+  EXPECT_NEAR(490, height, 1.0);
+  EXPECT_EQ(s.cache_misses(), 1);
+  EXPECT_NEAR(134, s.get(std::make_pair(-76.9, 40.0)), 1.0);
+  EXPECT_EQ(s.cache_hits(), 1);
+
+  // postings in the same tile look it up once
+  std::vector<std::pair<double, double>> postings(10, std::make_pair(-76.503915, 40.678783));
+  s.get_all(postings);
+  EXPECT_EQ(s.cache_hits(), 2);
+
+  // another sample of the same data shares the cache
+  skadi::sample other("test/data/samplegz");
+  EXPECT_EQ(other.get(std::make_pair(-76.503915, 40.678783)), height);
+  EXPECT_EQ(s.cache_hits(), 3);
+  EXPECT_EQ(other.cache_misses(), 1);
+
+  // and is safe to sample from many threads
+  std::vector<std::thread> threads;
+  std::atomic<size_t> wrong{0};
+  for (size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&]() {
+      for (const auto value : s.get_all(postings)) {
+        wrong += value != height;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(wrong, 0);
+  EXPECT_EQ(s.cache_misses(), 1);
+}
+
+TEST(Sample, get_resampled) {
+  skadi::sample s("test/data/samplegz");
+
+  // sampling along the line is sampling the resampled line, with some postings in another tile
+  const std::vector<PointLL> line{{-76.537011, 40.723872},
+                                  {-76.503915, 40.678783},
+                                  {-76.9, 40.0},
+                                  {-76.9, 39.98},
+                                  {-76.537011, 40.735872}};
+  for (const bool preserve : {false, true}) {
+    const auto resampled = midgard::resample_spherical_polyline(line, 30, preserve);
+    const auto heights = s.get_resampled(line, 30, preserve);
+    ASSERT_EQ(heights.size(), resampled.size());
+    const auto expected = s.get_all(resampled);
+    for (size_t i = 0; i < heights.size(); ++i) {
+      EXPECT_EQ(heights[i], expected[i]) << "Wrong height at posting " << i;
+      EXPECT_EQ(heights[i], s.get(resampled[i])) << "Wrong height at posting " << i;
+    }
+  }
+  EXPECT_TRUE(s.get_resampled(std::vector<PointLL>{}, 30).empty());
+}
+
+TEST(Sample, blocked) {
+  // pack the raw and the gzipped tile and sample the blocked ones like the originals
+  ASSERT_TRUE(skadi::sample::pack("test/data/samplegz/N40/N40W077.hgt.gz",
+                                  "test/data/sampleblk/N40/N40W077.hgt.blk"));
+  ASSERT_TRUE(skadi::sample::pack("test/data/sample/N40/N40W077.hgt",
+                                  "test/data/sampleblk/N40/N40W076.hgt.blk"));
+  EXPECT_FALSE(skadi::sample::pack("test/data/sample/N40/nothing_here.hgt",
+                                   "test/data/sampleblk/N40/N40W075.hgt.blk"));
+  _get("test/data/sampleblk");
+
+  // a sample unzips only the blocks it needs, every other sample is just like the original
+  skadi::sample blocked("test/data/sampleblk"), original("test/data/sample");
+  EXPECT_NEAR(490, blocked.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+  EXPECT_EQ(blocked.cache_misses(), 1);
+  std::vector<std::pair<double, double>> postings, moved;
+  for (double lon = -77; lon < -76; lon += 0.0137) {
+    for (double lat = 40; lat < 41; lat += 0.0291) {
+      postings.emplace_back(lon, lat);
+    }
+  }
+  // right on the edges of the blocks
+  const double edge = 256.0 / 3600;
+  postings.emplace_back(-77 + edge, 41 - edge);
+  postings.emplace_back(-77 + edge * 0.999, 41 - edge * 1.001);
+  // the tile next to it has the same data
+  for (const auto& posting : postings) {
+    moved.emplace_back(posting.first + 1, posting.second);
+  }
+  const auto expected = original.get_all(postings);
+  EXPECT_EQ(blocked.get_all(postings), expected);
+  EXPECT_EQ(blocked.get_all(moved), expected);
+}
+
 struct testable_sample_t : public skadi::sample {
   testable_sample_t(const std::string& dir) : sample(dir) {
     {
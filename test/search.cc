@@ -1,4 +1,5 @@
 #include "loki/search.h"
+#include "loki/search_cache.h"
 #include <cstdint>
 
 #include <boost/property_tree/ptree.hpp>
@@ -13,6 +14,7 @@
 #include "midgard/pointll.h"
 #include "midgard/vector2.h"
 #include "sif/nocost.h"
+#include "thor/expansion_pool.h"
 
 #include "test.h"
 
@@ -455,6 +457,76 @@ TEST(Search, test_search_cutoff) {
   search(x, 2, 0);
 }
 
+TEST(Search, test_parallel_search) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", tile_dir);
+  valhalla::baldr::GraphReader reader(conf);
+  valhalla::thor::ExpansionPool pool(conf, 2);
+  const auto costing = create_costing();
+
+  // enough locations along the diagonal of the triangle to search them in groups
+  std::vector<Location> locations;
+  for (int i = 0; i < 100; ++i) {
+    PointLL ll(a.second.first + .0019 * i, a.second.second + .001 * (i % 7));
+    locations.emplace_back(ll, Location::StopType::BREAK, 0, 0, 100);
+  }
+
+  const auto expected = Search(locations, reader, costing);
+  const auto actual = Search(locations, reader, costing, nullptr, &pool);
+  ASSERT_EQ(actual.size(), expected.size());
+  for (const auto& result : expected) {
+    const auto found = actual.find(result.first);
+    ASSERT_NE(found, actual.cend());
+    ASSERT_EQ(found->second.edges.size(), result.second.edges.size());
+    for (size_t i = 0; i < result.second.edges.size(); ++i) {
+      EXPECT_EQ(found->second.edges[i].id, result.second.edges[i].id);
+      EXPECT_EQ(found->second.edges[i].percent_along, result.second.edges[i].percent_along);
+    }
+  }
+}
+
+TEST(Search, test_search_cache) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", tile_dir);
+  valhalla::baldr::GraphReader reader(conf);
+  const auto costing = create_costing();
+  SearchCache cache(2);
+
+  // what was searched is found again, also for coordinates within the rounding
+  Location location(b.second, Location::StopType::BREAK, 0, 0, 100);
+  const auto searched = Search({location}, reader, costing).at(location);
+  const auto key = SearchCache::Key(location, "none");
+  cache.Insert(key, searched);
+  Location nearby({b.second.first + 1e-8, b.second.second}, Location::StopType::BREAK, 0, 0, 100);
+  EXPECT_EQ(SearchCache::Key(nearby, "none"), key);
+  PathLocation found(nearby);
+  ASSERT_TRUE(cache.Find(key, found));
+  EXPECT_EQ(found.latlng_, nearby.latlng_);
+  ASSERT_EQ(found.edges.size(), searched.edges.size());
+  for (size_t i = 0; i < searched.edges.size(); ++i) {
+    EXPECT_EQ(found.edges[i].id, searched.edges[i].id);
+  }
+
+  // anything that changes the search or the costing is a different location
+  Location wider(b.second, Location::StopType::BREAK, 0, 0, 200);
+  EXPECT_NE(SearchCache::Key(wider, "none"), key);
+  EXPECT_NE(SearchCache::Key(location, "auto"), key);
+
+  // the least recently used one goes first
+  cache.Insert(SearchCache::Key(wider, "none"), searched);
+  ASSERT_TRUE(cache.Find(key, found));
+  cache.Insert(SearchCache::Key(location, "auto"), searched);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_TRUE(cache.Find(key, found));
+  EXPECT_FALSE(cache.Find(SearchCache::Key(wider, "none"), found));
+  EXPECT_EQ(cache.hits(), 3);
+  EXPECT_EQ(cache.misses(), 1);
+
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_FALSE(cache.Find(key, found));
+}
+
 } // namespace
 
 // Setup and tearown will be called only once for the entire suite121
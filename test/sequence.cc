@@ -1,5 +1,7 @@
 #include "midgard/sequence.h"
 #include <cstdint>
+#include <cstring>
+#include <fstream>
 
 #include "test.h"
 
@@ -54,6 +56,25 @@ TEST(Sequence, ReadWrite) {
   read_nodes(file_name, count);
 }
 
+TEST(Sequence, ParallelSort) {
+  // small buffers so that there are many chunks to merge, some of them not full
+  const uint64_t count = 10007;
+  {
+    sequence<osm_node> nodes("shuffled.nd", true, 512);
+    for (uint64_t i = 0; i < count; ++i)
+      nodes.push_back({(i * 7919) % count, 0.f, 0.f, static_cast<uint32_t>(i)});
+    nodes.sort([](const osm_node& a, const osm_node& b) { return a.id < b.id; }, 1000, 3);
+  }
+  sequence<osm_node> nodes("shuffled.nd", false, 512);
+  ASSERT_EQ(nodes.size(), count);
+  for (uint64_t i = 0; i < count; ++i) {
+    osm_node node = *nodes[i];
+    ASSERT_EQ(node.id, i) << "Found wrong node at: " + std::to_string(i);
+    ASSERT_EQ((node.attributes * 7919) % count, i) << "Node " + std::to_string(i) + " was mangled";
+  }
+  EXPECT_FALSE(filesystem::exists("shuffled.nd.sorted")) << "Temporary file was left behind";
+}
+
 TEST(Sequence, Iterator) {
   sequence<osm_node> sequence("nodes.nd", false, 512);
   auto i = sequence.begin();
@@ -70,6 +91,84 @@ TEST(Sequence, Iterator) {
   EXPECT_EQ(i.position(), 0) << "Pre-decrement operator wasn't right";
 }
 
+// writes a tar with a few files in it and returns their contents
+std::unordered_map<std::string, std::string> write_tar(const std::string& file_name) {
+  std::unordered_map<std::string, std::string> files{
+      {"a", "some bytes"},
+      {"b/c", std::string(3000, 'c')},
+      {"d", std::string(512, 'd')},
+  };
+  std::ofstream out(file_name, std::ios::binary);
+  for (const auto& file : files) {
+    tar::header_t header{};
+    std::strncpy(header.name, file.first.c_str(), sizeof(header.name));
+    std::snprintf(header.mode, sizeof(header.mode), "%07o", 0644);
+    std::snprintf(header.size, sizeof(header.size), "%011zo", file.second.size());
+    header.typeflag = '0';
+    std::memcpy(header.magic, "ustar", 6);
+    std::memset(header.chksum, ' ', sizeof(header.chksum));
+    unsigned sum = 0;
+    for (size_t i = 0; i < sizeof(header); ++i)
+      sum += reinterpret_cast<const unsigned char*>(&header)[i];
+    std::snprintf(header.chksum, sizeof(header.chksum), "%06o", sum);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(file.second.data(), file.second.size());
+    std::string padding((sizeof(header) - file.second.size() % sizeof(header)) % sizeof(header), 0);
+    out.write(padding.data(), padding.size());
+  }
+  std::string blank(sizeof(tar::header_t) * 2, 0);
+  out.write(blank.data(), blank.size());
+  return files;
+}
+
+void check_tar(const tar& archive, const std::unordered_map<std::string, std::string>& files) {
+  ASSERT_EQ(archive.contents.size(), files.size());
+  EXPECT_EQ(archive.corrupt_blocks, 0);
+  for (const auto& file : files) {
+    auto entry = archive.contents.find(file.first);
+    ASSERT_NE(entry, archive.contents.end()) << "Missing " + file.first;
+    EXPECT_EQ(std::string(entry->second.first, entry->second.second), file.second);
+  }
+}
+
+TEST(Tar, Read) {
+  auto files = write_tar("test.tar");
+  check_tar(tar("test.tar"), files);
+
+  map_options_t options;
+  options.populate = true;
+  check_tar(tar("test.tar", true, options), files);
+}
+
+#ifdef __linux__
+TEST(Tar, AnonymousCopy) {
+  auto files = write_tar("test.tar");
+
+  // the copy should be readable even if the kernel decides not to back it with huge pages
+  map_options_t options;
+  options.huge_pages = true;
+  tar huge("test.tar", true, options);
+  check_tar(huge, files);
+  EXPECT_NE(huge.contents.begin()->second.first, nullptr);
+  EXPECT_TRUE(huge.copy);
+
+  // every machine has a node 0 but mbind can still be forbidden, e.g. in some containers
+  options.huge_pages = false;
+  for (const auto& numa : {"interleave", "0"}) {
+    options.numa = numa;
+    try {
+      check_tar(tar("test.tar", true, options), files);
+    } catch (const std::runtime_error& e) {
+      EXPECT_NE(std::string(e.what()).find("mbind"), std::string::npos) << e.what();
+    }
+  }
+
+  // nonsense nodes are refused
+  options.numa = "1000";
+  EXPECT_THROW(tar("test.tar", true, options), std::runtime_error);
+}
+#endif
+
 } // namespace
 
 int main(int argc, char* argv[]) {
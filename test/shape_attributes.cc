@@ -165,6 +165,42 @@ TEST(ShapeAttributes, test_shape_attributes_no_turncosts) {
   EXPECT_NEAR(edge_length, sum_lengths, .1);
 }
 
+TEST(ShapeAttributes, test_compact_edges) {
+  tyr::actor_t actor(conf);
+  const std::string request = R"({"shape":[
+        {"lat":52.09110,"lon":5.09806},
+        {"lat":52.09050,"lon":5.09769},
+        {"lat":52.09098,"lon":5.09679}
+      ],"costing":"auto","shape_match":"map_snap",
+      "filters":{"attributes":["edge.length","edge.speed","edge.names","edge.sign"],
+      "action":"include"})";
+
+  rapidjson::Document doc;
+  doc.Parse(actor.trace_attributes(request + "}"));
+  ASSERT_FALSE(doc.HasParseError()) << "Could not parse json response";
+  rapidjson::Document compact;
+  compact.Parse(actor.trace_attributes(request + R"(,"compact":true})"));
+  ASSERT_FALSE(compact.HasParseError()) << "Could not parse json response";
+
+  // an array per attribute with an entry per edge, null where the edge hasnt got it
+  const auto edges = rapidjson::Pointer("/edges").Get(doc)->GetArray();
+  const auto& columns = *rapidjson::Pointer("/edges").Get(compact);
+  ASSERT_TRUE(columns.IsObject());
+  ASSERT_GT(edges.Size(), 1);
+  for (const auto* key : {"length", "speed", "names"}) {
+    ASSERT_TRUE(columns.HasMember(key)) << key;
+    const auto column = columns[key].GetArray();
+    ASSERT_EQ(column.Size(), edges.Size()) << key;
+    for (rapidjson::SizeType i = 0; i < edges.Size(); ++i) {
+      if (edges[i].HasMember(key)) {
+        EXPECT_EQ(column[i], edges[i][key]) << key << " " << i;
+      } else {
+        EXPECT_TRUE(column[i].IsNull()) << key << " " << i;
+      }
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,79 @@
+#include "baldr/sidecar.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr uint64_t kMagic = 0x5453455448484C56ULL;
+constexpr uint32_t kVersion = 3;
+
+struct Header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t count;
+};
+
+bool exists(const std::string& file_name) {
+  return std::ifstream(file_name).good();
+}
+
+TEST(Sidecar, WriteAndMap) {
+  const std::string file_name = "test/data/sidecar_test.bin";
+  const std::vector<uint64_t> values{1, 2, 3, 5, 8};
+  {
+    SidecarWriter file(file_name);
+    Header header{kMagic, kVersion, static_cast<uint32_t>(values.size())};
+    file.write(&header, 1);
+    file.write(values);
+    // nothing is in place until it is committed
+    EXPECT_FALSE(exists(file_name));
+    file.commit();
+  }
+  EXPECT_TRUE(exists(file_name));
+  EXPECT_FALSE(exists(file_name + ".tmp"));
+
+  Sidecar file(file_name, "a test file", kMagic, kVersion, sizeof(Header));
+  ASSERT_EQ(file.size(), sizeof(Header) + values.size() * sizeof(uint64_t));
+  const auto* header = reinterpret_cast<const Header*>(file.data());
+  EXPECT_EQ(header->count, values.size());
+  const auto* mapped = reinterpret_cast<const uint64_t*>(file.data() + sizeof(Header));
+  EXPECT_EQ(std::vector<uint64_t>(mapped, mapped + header->count), values);
+  EXPECT_NO_THROW(file.check(true));
+  EXPECT_THROW(file.check(false), std::runtime_error);
+
+  // other files and other versions are not mapped
+  EXPECT_THROW(Sidecar(file_name, "a test file", kMagic + 1, kVersion, sizeof(Header)),
+               std::runtime_error);
+  EXPECT_THROW(Sidecar(file_name, "a test file", kMagic, kVersion + 1, sizeof(Header)),
+               std::runtime_error);
+  EXPECT_THROW(Sidecar(file_name, "a test file", kMagic, kVersion, file.size() + 1),
+               std::runtime_error);
+  EXPECT_THROW(Sidecar(file_name + ".missing", "a test file", kMagic, kVersion, sizeof(Header)),
+               std::runtime_error);
+  std::remove(file_name.c_str());
+}
+
+TEST(Sidecar, UncommittedIsDropped) {
+  const std::string file_name = "test/data/sidecar_uncommitted.bin";
+  {
+    SidecarWriter file(file_name);
+    Header header{kMagic, kVersion, 0};
+    file.write(&header, 1);
+  }
+  EXPECT_FALSE(exists(file_name));
+  EXPECT_FALSE(exists(file_name + ".tmp"));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
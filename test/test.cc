@@ -85,7 +85,8 @@ make_clean_graphreader(const boost::property_tree::ptree& mjolnir_conf) {
   struct ResettingGraphReader : valhalla::baldr::GraphReader {
     ResettingGraphReader(const boost::property_tree::ptree& pt) : GraphReader(pt) {
       // Reset the statically initialized tile_extract_ member variable
-      tile_extract_.reset(new valhalla::baldr::GraphReader::tile_extract_t(pt));
+      tile_extract_ = valhalla::baldr::GraphReader::tile_extract_t::create(pt);
+      traffic_generation_ = tile_extract_->traffic_generation.load();
     }
   };
   return std::make_shared<ResettingGraphReader>(mjolnir_conf);
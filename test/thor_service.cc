@@ -1,7 +1,9 @@
 #include "test.h"
 
+#include "baldr/compression_utils.h"
 #include "midgard/logging.h"
 #include "thor/worker.h"
+#include "worker.h"
 #include <unistd.h>
 
 #include <thread>
@@ -110,6 +112,68 @@ TEST(ThorService, test_failure_requests) {
   }
 }
 
+TEST(ThorService, CompressedResponse) {
+  // a body spanning a few of the chunks it is compressed in
+  std::string body = "[";
+  for (int i = 0; i < 20000; ++i) {
+    body += std::to_string(i * 7919 % 10007) + ",";
+  }
+  body.back() = ']';
+
+  for (auto encoding : {Info::gzip, Info::deflate}) {
+    Api request;
+    request.mutable_info()->set_content_encoding(encoding);
+    http_request_info_t request_info{};
+    auto result = to_response(body, request_info, request);
+    ASSERT_EQ(result.messages.size(), 1);
+    const auto& message = result.messages.front();
+    const auto split = message.find("\r\n\r\n");
+    ASSERT_NE(split, std::string::npos);
+    const auto headers = message.substr(0, split);
+    auto compressed = message.substr(split + 4);
+    EXPECT_NE(headers.find(encoding == Info::gzip ? "Content-Encoding: gzip\r\n"
+                                                  : "Content-Encoding: deflate\r\n"),
+              std::string::npos);
+    EXPECT_NE(headers.find("Content-Length: " + std::to_string(compressed.size()) + "\r\n"),
+              std::string::npos);
+    EXPECT_LT(compressed.size(), body.size());
+
+    // it inflates back to exactly the body, with nothing after the end of the stream
+    std::string inflated;
+    auto src_func = [&compressed](z_stream& s) {
+      s.next_in = static_cast<Byte*>(static_cast<void*>(&compressed[0]));
+      s.avail_in = static_cast<unsigned int>(compressed.size());
+    };
+    auto dst_func = [&inflated](z_stream& s) -> int {
+      if (s.total_out < inflated.size()) {
+        inflated.resize(s.total_out);
+        return Z_FINISH;
+      }
+      auto size = inflated.size();
+      inflated.resize(size + 65536);
+      s.next_out = static_cast<Byte*>(static_cast<void*>(&inflated[size]));
+      s.avail_out = 65536;
+      return Z_NO_FLUSH;
+    };
+    ASSERT_TRUE(baldr::inflate(src_func, dst_func));
+    EXPECT_EQ(inflated, body);
+
+    // inflating stops at the end of the stream, so look at its trailer to see it is the last of the
+    // bytes: gzip ends with the size of the body, zlib with its adler32 checksum big endian
+    ASSERT_GT(compressed.size(), 4);
+    const auto* trailer =
+        reinterpret_cast<const unsigned char*>(&compressed[compressed.size() - 4]);
+    if (encoding == Info::gzip) {
+      const uint32_t size = trailer[0] | trailer[1] << 8 | trailer[2] << 16 | trailer[3] << 24;
+      EXPECT_EQ(size, body.size());
+    } else {
+      const uint32_t checksum = trailer[0] << 24 | trailer[1] << 16 | trailer[2] << 8 | trailer[3];
+      EXPECT_EQ(checksum, adler32(adler32(0, nullptr, 0),
+                                  reinterpret_cast<const Bytef*>(body.data()), body.size()));
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
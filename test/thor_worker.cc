@@ -17,7 +17,7 @@ namespace {
 const auto conf = test::json_to_pt(R"({
     "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1},
     "loki":{
-      "actions":["locate","route","sources_to_targets","optimized_route","isochrone","trace_route","trace_attributes"],
+      "actions":["locate","route","sources_to_targets","optimized_route","isochrone","trace_route","trace_attributes","expansion"],
       "logging":{"long_request": 100},
       "service_defaults":{"minimum_reachability": 50,"radius": 0,"search_cutoff": 35000, "node_snap_tolerance": 5, "street_side_tolerance": 5, "street_side_max_distance": 1000, "heading_tolerance": 60}
     },
@@ -147,6 +147,37 @@ TEST(ThorWorker, test_linear_references) {
   }
 }
 
+TEST(ThorWorker, test_expansion_max_edges) {
+  const std::string request =
+      R"({"locations":[{"lat":52.111893,"lon":5.125282},{"lat":52.113731,"lon":5.091155}],
+          "costing":"auto")";
+  tyr::actor_t actor(conf, true);
+  auto count = [](const boost::property_tree::ptree& expansion) {
+    const auto& feature = expansion.get_child("features").front().second;
+    size_t edges = feature.get_child("geometry.coordinates").size();
+    EXPECT_EQ(feature.get_child("properties.edge_ids").size(), edges);
+    EXPECT_EQ(feature.get_child("properties.statuses").size(), edges);
+    return edges;
+  };
+  auto first_edge = [](const boost::property_tree::ptree& expansion) {
+    const auto& feature = expansion.get_child("features").front().second;
+    return feature.get_child("properties.edge_ids").front().second.get_value<uint64_t>();
+  };
+  auto all = test::json_to_pt(actor.expansion(request + "}"));
+  EXPECT_EQ(all.get<std::string>("properties.algorithm"), "bidirectional_astar");
+  EXPECT_EQ(all.get<uint64_t>("properties.interval"), 1);
+  const size_t edges = count(all);
+  ASSERT_GT(edges, 100);
+
+  // every so many edges of the same search are shown to keep to the maximum
+  auto thinned = test::json_to_pt(actor.expansion(request + R"(,"expansion_max_edges":50})"));
+  const auto interval = thinned.get<uint64_t>("properties.interval");
+  EXPECT_GT(interval, 1);
+  EXPECT_LE(count(thinned), 50);
+  EXPECT_EQ(count(thinned), (edges + interval - 1) / interval);
+  EXPECT_EQ(first_edge(thinned), first_edge(all));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -57,6 +57,39 @@ TEST(TileHierarchy, Tiles) {
   EXPECT_EQ(ids.size(), 4) << "Should have found 4 results.";
 }
 
+TEST(TileHierarchy, GraphIdsOfPoints) {
+  // the constant tile math agrees with the tiles of every level, on the edges of the world and
+  // just below the edges of tiles too
+  std::vector<PointLL> points{{-76.5, 40.5},
+                              {-180, -90},
+                              {180, 90},
+                              {-180, 90},
+                              {180, -90},
+                              {0, 0},
+                              {-0.25, 0.25},
+                              {179.99, -89.99},
+                              {13.4, 52.5},
+                              {-180.1, 0},
+                              {0, 90.1},
+                              {24.957432851880981, 73.999992528332157}};
+  for (const auto& level : TileHierarchy::levels()) {
+    auto ids = TileHierarchy::GetGraphIds(points, level.level);
+    ASSERT_EQ(ids.size(), points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      auto tile_id = level.tiles.TileId(points[i]);
+      if (tile_id < 0) {
+        EXPECT_FALSE(ids[i].Is_Valid());
+        continue;
+      }
+      EXPECT_EQ(ids[i], GraphId(tile_id, level.level, 0))
+          << points[i].lng() << "," << points[i].lat();
+    }
+  }
+
+  // the transit level was never supported
+  EXPECT_FALSE(TileHierarchy::GetGraphIds(points, 3).front().Is_Valid());
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "baldr/graphid.h"
+#include "mjolnir/buildreport.h"
+#include "mjolnir/tilequeue.h"
+
+#include "test.h"
+
+using valhalla::baldr::GraphId;
+using valhalla::mjolnir::TileQueue;
+using valhalla::mjolnir::TileShard;
+
+namespace {
+
+TEST(TileQueue, HeaviestFirst) {
+  TileQueue queue({{GraphId(1, 2, 0), 5}, {GraphId(2, 2, 0), 50}, {GraphId(3, 2, 0), 5},
+                   {GraphId(4, 2, 0), 500}});
+  EXPECT_EQ(queue.size(), 4);
+
+  std::vector<GraphId> tiles;
+  GraphId tile;
+  while (queue.next(tile)) {
+    tiles.push_back(tile);
+  }
+  std::vector<GraphId> expected{GraphId(4, 2, 0), GraphId(2, 2, 0), GraphId(1, 2, 0),
+                                GraphId(3, 2, 0)};
+  EXPECT_EQ(tiles, expected);
+
+  // once its empty it stays empty
+  EXPECT_FALSE(queue.next(tile));
+}
+
+TEST(TileQueue, Groups) {
+  // the tiles of a group one after the other, the heavier group first
+  TileQueue queue({{GraphId(1, 2, 0), 5}, {GraphId(2, 2, 0), 50}, {GraphId(3, 2, 0), 30},
+                   {GraphId(4, 2, 0), 40}, {GraphId(5, 2, 0), 1}},
+                  {0, 1}, [](const GraphId& tile) { return tile.tileid() % 2; });
+  std::vector<GraphId> tiles;
+  GraphId tile;
+  while (queue.next(tile)) {
+    tiles.push_back(tile);
+  }
+  std::vector<GraphId> expected{GraphId(2, 2, 0), GraphId(4, 2, 0), GraphId(3, 2, 0),
+                                GraphId(1, 2, 0), GraphId(5, 2, 0)};
+  EXPECT_EQ(tiles, expected);
+}
+
+TEST(TileQueue, EveryTileOnce) {
+  std::vector<std::pair<GraphId, uint64_t>> weights;
+  for (uint32_t i = 0; i < 10000; ++i) {
+    weights.emplace_back(GraphId(i, 2, 0), i % 7);
+  }
+  TileQueue queue(weights);
+
+  std::mutex lock;
+  std::vector<GraphId> tiles;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&]() {
+      GraphId tile;
+      while (queue.next(tile)) {
+        std::lock_guard<std::mutex> guard(lock);
+        tiles.push_back(tile);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  queue.LogUtilization("test");
+
+  ASSERT_EQ(tiles.size(), weights.size());
+  std::sort(tiles.begin(), tiles.end());
+  for (uint32_t i = 0; i < tiles.size(); ++i) {
+    EXPECT_EQ(tiles[i], GraphId(i, 2, 0));
+  }
+}
+
+TEST(TileQueue, Shards) {
+  std::vector<std::pair<GraphId, uint64_t>> weights;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    weights.emplace_back(GraphId(i, 2, 0), i % 13);
+  }
+
+  // every tile is in exactly one shard and each shard is a range of the ids
+  std::vector<GraphId> tiles;
+  for (uint32_t index = 0; index < 3; ++index) {
+    TileQueue queue(weights, {index, 3});
+    EXPECT_GT(queue.size(), 250);
+    std::vector<GraphId> shard;
+    GraphId tile;
+    while (queue.next(tile)) {
+      shard.push_back(tile);
+    }
+    std::sort(shard.begin(), shard.end());
+    EXPECT_EQ(shard.back().tileid() - shard.front().tileid() + 1, shard.size());
+    if (!tiles.empty()) {
+      EXPECT_EQ(tiles.back().tileid() + 1, shard.front().tileid());
+    }
+    tiles.insert(tiles.end(), shard.begin(), shard.end());
+  }
+  EXPECT_EQ(tiles.size(), weights.size());
+
+  // without any weight the tiles are split evenly
+  TileQueue unweighted({{GraphId(1, 2, 0), 0}, {GraphId(2, 2, 0), 0}, {GraphId(3, 2, 0), 0},
+                        {GraphId(4, 2, 0), 0}},
+                       {1, 2});
+  EXPECT_EQ(unweighted.size(), 2);
+}
+
+TEST(TileQueue, BuildReport) {
+  auto& report = valhalla::mjolnir::BuildReport::Get();
+  report.Begin("test");
+  report.Count("ways", 7);
+  TileQueue queue({{GraphId(1, 2, 0), 5}, {GraphId(2, 2, 0), 50}, {GraphId(3, 2, 0), 5}});
+  std::thread thread([&queue]() {
+    GraphId tile;
+    while (queue.next(tile)) {
+    }
+  });
+  thread.join();
+  queue.LogUtilization("queue");
+
+  // the stage with its counts and the thread of its queue
+  std::stringstream json;
+  report.Write(json);
+  EXPECT_NE(json.str().find("\"stage\":\"test\""), std::string::npos) << json.str();
+  EXPECT_NE(json.str().find("\"ways\":7"), std::string::npos) << json.str();
+  EXPECT_NE(json.str().find("\"tiles\":3"), std::string::npos) << json.str();
+  EXPECT_NE(json.str().find("\"name\":\"queue\""), std::string::npos) << json.str();
+}
+
+TEST(TileQueue, ShardFromString) {
+  auto shard = TileShard::FromString("2/8");
+  EXPECT_EQ(shard.index, 2);
+  EXPECT_EQ(shard.count, 8);
+  EXPECT_THROW(TileShard::FromString("8/8"), std::runtime_error);
+  EXPECT_THROW(TileShard::FromString("2"), std::runtime_error);
+  EXPECT_THROW(TileShard::FromString("a/b"), std::runtime_error);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "baldr/traffictile.h"
+#include "mjolnir/traffictilewriter.h"
 
 namespace {
 class UnmanagedGraphMemory : public valhalla::baldr::GraphMemory {
@@ -91,6 +96,91 @@ TEST(Traffic, SpeedValid) {
   EXPECT_EQ(speed.speed1, 0);
 }
 
+TEST(Traffic, WriteTile) {
+  using namespace valhalla::baldr;
+  using valhalla::mjolnir::TrafficTileWriter;
+
+#pragma pack(push, 1)
+  struct TestTile {
+    TrafficTileHeader header;
+    TrafficSpeed speeds[4];
+  };
+#pragma pack(pop)
+
+  TestTile testdata{};
+  testdata.header.directed_edge_count = 4;
+  testdata.header.traffic_tile_version = TRAFFIC_TILE_VERSION;
+  auto memory =
+      std::make_unique<UnmanagedGraphMemory>(reinterpret_cast<char*>(&testdata), sizeof(TestTile));
+  TrafficTile tile(std::move(memory));
+
+  // the last of an edge wins and the ones beyond the tile are left out
+  const TrafficSpeed slow{10, 10, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0,
+                          20, 0,  0,  false};
+  const TrafficSpeed fast{50, 50, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0,
+                          1,  0,  0,  false};
+  std::vector<TrafficTileWriter::update_t> updates{{{0, 0, 1}, slow},
+                                                   {{0, 0, 3}, slow},
+                                                   {{0, 0, 1}, fast},
+                                                   {{0, 0, 4}, fast}};
+  EXPECT_EQ(TrafficTileWriter::WriteTile(reinterpret_cast<char*>(&testdata), sizeof(TestTile),
+                                         updates.cbegin(), updates.cend(), 1234),
+            3);
+  EXPECT_EQ(tile.sequence(), 2);
+  EXPECT_EQ(testdata.header.last_update, 1234);
+  EXPECT_FALSE(tile.load_trafficspeed(0).valid());
+  EXPECT_EQ(tile.load_trafficspeed(1).get_overall_speed(), 100);
+  EXPECT_EQ(tile.load_trafficspeed(3).get_overall_speed(), 20);
+  EXPECT_EQ(tile.load_trafficspeed(3).congestion1, 20);
+  EXPECT_FALSE(tile.load_trafficspeed(2).valid());
+}
+
+TEST(Traffic, WritesArentTorn) {
+  using namespace valhalla::baldr;
+  using valhalla::mjolnir::TrafficTileWriter;
+
+#pragma pack(push, 1)
+  struct TestTile {
+    TrafficTileHeader header;
+    TrafficSpeed speed;
+  };
+#pragma pack(pop)
+
+  TestTile testdata{};
+  testdata.header.directed_edge_count = 1;
+  testdata.header.traffic_tile_version = TRAFFIC_TILE_VERSION;
+  auto memory =
+      std::make_unique<UnmanagedGraphMemory>(reinterpret_cast<char*>(&testdata), sizeof(TestTile));
+  TrafficTile tile(std::move(memory));
+
+  // one thread flips the record between two speeds that differ in every field
+  const std::vector<TrafficTileWriter::update_t> a{
+      {{0, 0, 0}, TrafficSpeed{1, 1, 1, 1, 1, 1, 1, 1, 1, false}}};
+  const std::vector<TrafficTileWriter::update_t> b{
+      {{0, 0, 0}, TrafficSpeed{126, 126, 126, 126, 254, 254, 62, 62, 62, true}}};
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    for (int i = 0; i < 100000; ++i) {
+      const auto& updates = i % 2 ? a : b;
+      TrafficTileWriter::WriteTile(reinterpret_cast<char*>(&testdata), sizeof(TestTile),
+                                   updates.cbegin(), updates.cend(), i);
+    }
+    done = true;
+  });
+
+  // the other only ever sees one or the other
+  while (!done) {
+    const auto speed = tile.load_trafficspeed(0);
+    if (speed.valid()) {
+      ASSERT_TRUE(speed.overall_speed == 1 || speed.overall_speed == 126);
+      EXPECT_EQ(speed.speed3, speed.overall_speed);
+      EXPECT_EQ(speed.has_incidents, speed.overall_speed == 126);
+    }
+  }
+  writer.join();
+  EXPECT_EQ(tile.sequence(), 200000);
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,56 @@
+#include "test.h"
+
+#include "baldr/tilehierarchy.h"
+#include "baldr/transitstopindex.h"
+#include "filesystem.h"
+#include "mjolnir/graphtilebuilder.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+TEST(TransitStopIndex, Within) {
+  const std::string tile_dir = "test/data/transit_stop_index";
+  if (filesystem::exists(tile_dir)) {
+    filesystem::remove_all(tile_dir);
+  }
+
+  // a transit tile with a platform and an egress next to it
+  const auto& level = TileHierarchy::GetTransitLevel();
+  PointLL platform(-76.3, 40.5), egress(-76.31, 40.5);
+  GraphId tile_id(level.tiles.TileId(platform), level.level, 0);
+  {
+    GraphTileBuilder builder(tile_dir, tile_id, false);
+    auto base_ll = level.tiles.Base(tile_id.tileid());
+    builder.header_builder().set_base_ll(base_ll);
+    builder.nodes().emplace_back(base_ll, platform, kPedestrianAccess,
+                                 NodeType::kMultiUseTransitPlatform, false);
+    builder.nodes().emplace_back(base_ll, egress, kPedestrianAccess, NodeType::kTransitEgress,
+                                 false);
+    builder.StoreTileData();
+  }
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  TransitStopIndex index(pt);
+  EXPECT_EQ(index.size(), 1);
+
+  // about 42 meters from the platform
+  EXPECT_TRUE(index.Within({-76.3005, 40.5}, 50));
+  EXPECT_FALSE(index.Within({-76.3005, 40.5}, 40));
+  // the egress is not a stop
+  EXPECT_FALSE(index.Within(egress, 10));
+  // nor is anywhere in tiles without transit
+  EXPECT_FALSE(index.Within({10.0, 10.0}, 1000));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,4 +1,6 @@
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "mjolnir/uniquenames.h"
 
@@ -45,6 +47,31 @@ TEST(UniqueNames, TestAddAndIndex) {
   EXPECT_EQ(names.name(index6), "I-95 N");
 }
 
+TEST(UniqueNames, Many) {
+  // enough names for the table to grow a few times
+  UniqueNames names;
+  std::vector<uint32_t> indexes;
+  for (size_t i = 0; i < 10000; ++i) {
+    indexes.push_back(names.index("Road " + std::to_string(i)));
+  }
+  EXPECT_EQ(names.Size(), 10000);
+  for (size_t i = 0; i < indexes.size(); ++i) {
+    EXPECT_EQ(indexes[i], i + 1);
+    EXPECT_EQ(names.index("Road " + std::to_string(i)), indexes[i]);
+    EXPECT_EQ(names.name(indexes[i]), "Road " + std::to_string(i));
+  }
+
+  // the blank name is first and anything out of range is blank too
+  EXPECT_EQ(names.index(""), 0);
+  EXPECT_EQ(names.name(0), "");
+  EXPECT_EQ(names.name(20000), "");
+
+  // embedded nulls are part of a name
+  auto with_null = names.index(std::string("a\0b", 3));
+  EXPECT_NE(with_null, names.index("a"));
+  EXPECT_EQ(names.name(with_null), std::string("a\0b", 3));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -694,6 +694,47 @@ TEST(UtilMidgard, Base64) {
   }
 }
 
+TEST(UtilMidgard, TestProjectorSquaredDistances) {
+  // random shapes, with some repeated points for zero length segments
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> offset(-0.01, 0.01);
+  for (int test = 0; test < 100; ++test) {
+    PointLL point(-76.3 + offset(generator), 40.2 + offset(generator));
+    projector_t projector(point);
+    std::vector<double> lngs, lats;
+    for (int i = 0; i < 20; ++i) {
+      lngs.push_back(i % 7 == 3 ? lngs.back() : -76.3 + offset(generator));
+      lats.push_back(i % 7 == 3 ? lats.back() : 40.2 + offset(generator));
+    }
+    std::vector<double> sq_distances(lngs.size() - 1);
+    projector.SquaredDistances(lngs.data(), lats.data(), sq_distances.size(), sq_distances.data());
+    for (size_t i = 0; i < sq_distances.size(); ++i) {
+      PointLL u(lngs[i], lats[i]), v(lngs[i + 1], lats[i + 1]);
+      double expected = projector.approx.DistanceSquared(projector(u, v));
+      EXPECT_NEAR(sq_distances[i], expected, expected * 1e-9 + 1e-9);
+    }
+  }
+}
+
+TEST(UtilMidgard, HilbertDistance) {
+  // every cell is somewhere on the curve and each step along it moves to a neighboring cell
+  constexpr uint32_t bits = 4, n = 1 << bits;
+  std::vector<std::pair<uint32_t, uint32_t>> cells(n * n, {n, n});
+  for (uint32_t x = 0; x < n; ++x) {
+    for (uint32_t y = 0; y < n; ++y) {
+      auto d = hilbert_distance(x, y, bits);
+      ASSERT_LT(d, n * n);
+      EXPECT_EQ(cells[d].first, n) << "two cells at " << d;
+      cells[d] = {x, y};
+    }
+  }
+  for (size_t d = 1; d < cells.size(); ++d) {
+    EXPECT_EQ(std::abs(int(cells[d].first) - int(cells[d - 1].first)) +
+                  std::abs(int(cells[d].second) - int(cells[d - 1].second)),
+              1);
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -6,7 +6,10 @@
 
 #include "baldr/graphid.h"
 #include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
 #include "filesystem.h"
+#include "midgard/sequence.h"
+#include "mjolnir/osmdata.h"
 #include "mjolnir/util.h"
 
 #include "test.h"
@@ -39,6 +42,51 @@ TEST(UtilMjolnir, BuildTileSet) {
   EXPECT_TRUE(filesystem::remove_all(tile_dir));
 }
 
+TEST(UtilMjolnir, AffectedTiles) {
+  // parse some osm so there are ways and way nodes from the last build
+  ptree config;
+  const std::string tile_dir("test/data/util_mjolnir_affected_tiles");
+  config.put("mjolnir.tile_dir", tile_dir);
+  config.put("mjolnir.concurrency", 1);
+  ASSERT_TRUE(build_tile_set(config, {VALHALLA_SOURCE_DIR "test/data/harrisburg.osm.pbf"},
+                             mjolnir::BuildStage::kInitialize, mjolnir::BuildStage::kParseNodes));
+  uint64_t way_id;
+  PointLL way_point;
+  {
+    sequence<mjolnir::OSMWay> ways(tile_dir + "/ways.bin", false);
+    way_id = (*ways[0]).way_id();
+    sequence<mjolnir::OSMWayNode> way_nodes(tile_dir + "/way_nodes.bin", false);
+    way_point = (*way_nodes[0]).node.latlng();
+    ASSERT_EQ((*way_nodes[0]).way_index, 0);
+  }
+
+  // change that way without saying where it is and add a node somewhere else
+  const std::string osc_file(tile_dir + "/changes.osc");
+  std::ofstream(osc_file) << "<osmChange version=\"0.6\">"
+                             "<modify><way id=\"" + std::to_string(way_id) + "\"/></modify>"
+                             "<create><node id=\"1\" lon=\"10.1\" lat=\"10.1\"/></create>"
+                             "</osmChange>";
+  auto affected = mjolnir::affected_tiles(config, osc_file);
+
+  const auto& local = baldr::TileHierarchy::levels().back();
+  for (const auto& point : {way_point, PointLL(10.1, 10.1)}) {
+    auto tile = baldr::TileHierarchy::GetGraphId(point, local.level);
+    EXPECT_EQ(affected.count(tile), 1) << "Missing the changed tile";
+    EXPECT_EQ(affected.count(GraphId(local.tiles.RightNeighbor(tile.tileid()), local.level, 0)), 1)
+        << "Missing a neighbor of the changed tile";
+    for (const auto& level : baldr::TileHierarchy::levels()) {
+      EXPECT_EQ(affected.count(baldr::TileHierarchy::GetGraphId(point, level.level)), 1)
+          << "Missing a tile of level " << static_cast<int>(level.level);
+    }
+  }
+  EXPECT_EQ(affected.count(baldr::TileHierarchy::GetGraphId(PointLL(-100, 30), local.level)), 0)
+      << "An unrelated tile is affected";
+  // two 3x3 blocks of local tiles plus what they are in on the other levels
+  EXPECT_LE(affected.size(), 2 * 9 * baldr::TileHierarchy::levels().size());
+
+  EXPECT_TRUE(filesystem::remove_all(tile_dir));
+}
+
 TEST(UtilMjolnir, TileManifestReadFromFile) {
   const std::string filename(VALHALLA_SOURCE_DIR "test/data/tile_manifest0.json");
   TileManifest read = TileManifest::ReadFromFile(filename);
@@ -17,6 +17,17 @@ TEST(UtilOdin, test_get_locales) {
   EXPECT_NE(init.find("en-US"), init.cend()) << "Should find 'en-US' locales file";
 }
 
+TEST(UtilOdin, test_lazy_locales) {
+  const auto& locales = get_locales();
+  const auto& en_us = locales.at("en-US");
+  EXPECT_EQ(en_us.language_tag(), "en-US");
+  EXPECT_EQ(en_us->GetLanguageTag(), "en-US");
+  // an alias shares the dictionary of its locale
+  const auto& en = locales.at("en");
+  EXPECT_EQ(en.language_tag(), "en-US");
+  EXPECT_EQ(&*en, &*en_us);
+}
+
 void try_get_formatted_time(const std::string& date_time,
                             const std::string& expected_date_time,
                             const std::locale& locale) {
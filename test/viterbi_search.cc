@@ -536,6 +536,57 @@ TEST(ViterbiSearch, TestTopKSearch) {
   }
 }
 
+void test_list_viterbi_search_brute_force(const std::vector<Column>& columns, const uint32_t k) {
+  ListViterbiSearch vs(k, EmissionCostModel(columns), TransitionCostModel(columns));
+  AddColumns(vs, columns);
+  if (columns.empty()) {
+    EXPECT_TRUE(vs.SearchPaths(0).empty()) << "expect no paths from empty columns";
+    return;
+  }
+
+  const auto& pcs = sort_all_paths(columns);
+  const StateId::Time time = columns.size() - 1;
+  const auto& paths = vs.SearchPaths(time);
+  ASSERT_EQ(paths.size(), std::min<size_t>(k, pcs.size())) << "expect the k best paths";
+
+  for (size_t rank = 0; rank < paths.size(); ++rank) {
+    validate_path(columns, paths[rank].stateids);
+    EXPECT_EQ(total_cost(columns, paths[rank].stateids), paths[rank].costsofar)
+        << "the cost of a path must be the cost of its states";
+    EXPECT_EQ(pcs[rank].cost(), paths[rank].costsofar) << "wrong cost of rank " << rank;
+  }
+
+  // the best of the paths is the one of the viterbi search interface
+  if (!paths.empty()) {
+    std::vector<StateId> vs_path;
+    std::copy(vs.SearchPathVS(time), vs.PathEnd(), std::back_inserter(vs_path));
+    std::reverse(vs_path.begin(), vs_path.end());
+    EXPECT_EQ(total_cost(columns, vs_path), paths.front().costsofar);
+    EXPECT_EQ(vs.AccumulatedCost(vs.SearchWinner(time)), paths.front().costsofar);
+  }
+}
+
+TEST(ViterbiSearch, TestListViterbiSearch) {
+  for (const uint32_t k : {1, 3, 10}) {
+    const auto& columns = generate_columns(
+        // transition costs
+        std::uniform_int_distribution<int>(1, 10),
+        // emission costs
+        std::uniform_int_distribution<int>(1, 10),
+        generate_column_counts(4,
+                               // column sizes
+                               std::uniform_int_distribution<size_t>(3, 5)));
+    test_list_viterbi_search_brute_force(columns, k);
+  }
+
+  // a single column and no columns at all
+  test_list_viterbi_search_brute_force(generate_columns(std::uniform_int_distribution<int>(1, 10),
+                                                        std::uniform_int_distribution<int>(1, 10),
+                                                        {7}),
+                                       3);
+  test_list_viterbi_search_brute_force({}, 3);
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,110 @@
+#ifndef VALHALLA_BALDR_ALTLANDMARKS_H_
+#define VALHALLA_BALDR_ALTLANDMARKS_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/sidecar.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The network distances between a few landmark nodes and every node of the graph, for the ALT
+ * (A*, landmarks, triangle inequality) heuristic. For a node v and any landmark L the shortest
+ * path from v to a target t is at least d(L,t) - d(L,v) and at least d(v,L) - d(t,L). Measured
+ * in meters over the edges the access of one costing allows, these bounds hold for any of its
+ * options and any time of day, as long as oneways and access are not ignored, and are much
+ * tighter than the straight line distance behind ferries, mountains or missing access.
+ *
+ * The distances of the nodes of every level are kept, a file in the tile_dir per costing, which
+ * is memory mapped read only.
+ */
+class AltLandmarks {
+public:
+  // The distance of a node which cant reach, or cant be reached from, a landmark
+  static constexpr float kUnreachable = std::numeric_limits<float>::max();
+
+  // What is at the start of the file
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t landmark_count;
+    uint64_t tile_count;
+    uint64_t node_count;
+    char costing[16];
+  };
+
+  /**
+   * Where the landmarks of a costing live.
+   * @param  tile_dir  The tile directory.
+   * @param  costing   The name of the costing.
+   * @return the path to the file
+   */
+  static std::string FileName(const std::string& tile_dir, const std::string& costing);
+
+  /**
+   * Writes the landmarks to disk.
+   * @param  file_name  Where to write it.
+   * @param  costing    The name of the costing whose access they were computed with.
+   * @param  landmarks  The landmark nodes.
+   * @param  tiles      The tiles the nodes are in, sorted by their value.
+   * @param  offsets    Where the nodes of each tile start in the distances, in nodes, with one
+   *                    more at the end for the total.
+   * @param  distances  Per node, the distances from every landmark to it followed by the
+   *                    distances from it to every landmark.
+   */
+  static void Write(const std::string& file_name,
+                    const std::string& costing,
+                    const std::vector<GraphId>& landmarks,
+                    const std::vector<GraphId>& tiles,
+                    const std::vector<uint64_t>& offsets,
+                    const std::vector<float>& distances);
+
+  /**
+   * Maps the landmarks from disk, throws if the file is missing or not landmarks.
+   * @param  file_name  The file to map.
+   */
+  explicit AltLandmarks(const std::string& file_name);
+
+  AltLandmarks(const AltLandmarks&) = delete;
+  AltLandmarks& operator=(const AltLandmarks&) = delete;
+
+  /**
+   * @return the name of the costing the landmarks were computed for
+   */
+  std::string costing() const;
+
+  /**
+   * @return how many landmarks there are
+   */
+  uint32_t count() const {
+    return header_->landmark_count;
+  }
+
+  /**
+   * Finds the distances of a node.
+   * @param  node  The node, at any level but transit.
+   * @return count() distances from the landmarks to the node followed by count() distances from
+   *         the node to the landmarks, or nullptr if the node is unknown
+   */
+  const float* distances(const GraphId& node) const;
+
+protected:
+  // the mapped file
+  Sidecar file_;
+
+  const Header* header_;
+  const uint64_t* landmarks_;
+  const uint64_t* tiles_;
+  const uint64_t* offsets_;
+  const float* distances_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_ALTLANDMARKS_H_
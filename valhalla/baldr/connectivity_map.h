@@ -2,23 +2,68 @@
 #define VALHALLA_BALDR_CONNECTIVITY_MAP_H_
 
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/sidecar.h>
 
+#include <array>
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 namespace valhalla {
 namespace baldr {
 // TODO: maintain consistent coloring of regions despite the connectivity changing
+/**
+ * The tiles of every level colored by the regions of tiles they touch, and optionally the weakly
+ * connected components of the edges each of a few access modes can use. Locations in different
+ * colors or different components cant reach one another.
+ *
+ * The colors are computed from the tiles there are, or if connectivity_map is on, memory mapped
+ * from the file valhalla_build_connectivity wrote to the tile_dir. Only the file has components.
+ */
 class connectivity_map_t {
 public:
+  // What is at the start of the file
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t access_mode_count;
+    uint64_t color_count;
+    uint64_t tile_count;
+    uint64_t edge_count;
+  };
+
+  /**
+   * Where the connectivity map lives.
+   * @param  tile_dir  The tile directory.
+   * @return the path to the file
+   */
+  static std::string FileName(const std::string& tile_dir);
+
+  /**
+   * Computes the colors of the tiles and the components of the edges of some access modes and
+   * writes them to disk.
+   * @param  file_name     Where to write it.
+   * @param  pt            The ptree sub child labeled mjolnir in the valhalla json config.
+   * @param  access_modes  The access masks to find the components of the edges for, if any.
+   */
+  static void Write(const std::string& file_name,
+                    const boost::property_tree::ptree& pt,
+                    const std::vector<uint32_t>& access_modes);
+
   /**
    * Constructs the connectivity map
    * @param pt   the ptree sub child labeled mjolnir in the valhalla json config
    */
   connectivity_map_t(const boost::property_tree::ptree& pt);
 
+  connectivity_map_t(const connectivity_map_t&) = delete;
+  connectivity_map_t& operator=(const connectivity_map_t&) = delete;
+
   /**
    * Returns the color for the given graphid
    *
@@ -38,6 +83,18 @@ public:
   std::unordered_set<size_t>
   get_colors(uint32_t hierarchy_level, const baldr::PathLocation& location, float radius) const;
 
+  /**
+   * Finds the components of the candidate edges of a location.
+   *
+   * @param location     the correlated location
+   * @param access_mode  the access mask of the costing
+   * @param components   the components of the edges of the location
+   * @return false if there are no components for the access mode or the edges are unknown
+   */
+  bool get_components(const baldr::PathLocation& location,
+                      const uint32_t access_mode,
+                      std::unordered_set<uint32_t>& components) const;
+
   /**
    * Returns the geojson representing the connectivity map
    *
@@ -60,14 +117,38 @@ public:
    * @return Returns true if the level has data, false if it does not (no tiles present)
    */
   bool has_data(const uint32_t level) const {
-    auto c = colors.find(level);
-    return (c == colors.end()) ? false : c->second.size() > 0;
+    return level < has_data_.size() && has_data_[level];
   }
 
 private:
+  // colors the tiles there are
+  void compute(const boost::property_tree::ptree& pt);
+
+  // maps the colors and components from disk, throws if the file is missing or not a map
+  void map(const std::string& file_name);
+
+  // the color of a tile, 0 if there is no such tile
+  uint32_t color(const uint32_t level, const uint32_t tile_id) const {
+    return level + 1 < level_offsets_.size() &&
+                   tile_id < level_offsets_[level + 1] - level_offsets_[level]
+               ? colors_[level_offsets_[level] + tile_id]
+               : 0;
+  }
+
   uint32_t transit_level;
-  // this is a map(tile_level, map(tile_id, tile_color))
-  std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t>> colors;
+  // the colors of the tiles of every level, one after the other and indexed by tile id
+  std::array<size_t, 5> level_offsets_;
+  std::array<bool, 4> has_data_;
+  std::vector<uint32_t> computed_;
+  const uint32_t* colors_;
+
+  // the mapped file, if the map was not computed
+  std::unique_ptr<Sidecar> file_;
+  const Header* header_;
+  const uint64_t* tiles_;
+  const uint64_t* offsets_;
+  const uint32_t* access_modes_;
+  const uint32_t* components_;
 };
 } // namespace baldr
 } // namespace valhalla
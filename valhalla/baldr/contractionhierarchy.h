@@ -0,0 +1,145 @@
+#ifndef VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
+#define VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/sidecar.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * A contraction hierarchy over the directed edges of the graph for one costing with its default
+ * options. The hierarchy is edge based, its nodes are the directed edges of the graph and its
+ * arcs are the turns between them, weighted with the transition cost of the turn plus the cost
+ * of the edge turned onto. That way turn costs and simple turn restrictions are part of the
+ * weights. Nodes are numbered by the order in which they were contracted so every arc leads
+ * upward to a higher number. For each node there are the arcs leaving it upward, which the
+ * forward search follows, and the arcs entering it from above, which the backward search
+ * follows against their direction. Arcs which replace a contracted node remember that node
+ * so paths can be unpacked into the edges they are made of.
+ *
+ * A hierarchy is a single file in the tile_dir, per costing, which is memory mapped read only.
+ */
+class ContractionHierarchy {
+public:
+  static constexpr uint32_t kInvalidNode = std::numeric_limits<uint32_t>::max();
+
+  // An arc of the hierarchy, middle is kInvalidNode unless the arc is a shortcut. Besides the
+  // cost it has the seconds and meters of the turn and edge, or edges, it stands for.
+  struct Arc {
+    uint32_t node;
+    uint32_t middle;
+    float cost;
+    float secs;
+    float length;
+  };
+
+  // What is at the start of the file
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t node_count;
+    uint64_t up_count;
+    uint64_t down_count;
+    char costing[16];
+  };
+
+  /**
+   * Where the hierarchy of a costing lives.
+   * @param  tile_dir  The tile directory.
+   * @param  costing   The name of the costing.
+   * @return the path to the file
+   */
+  static std::string FileName(const std::string& tile_dir, const std::string& costing);
+
+  /**
+   * Writes a hierarchy to disk. The arcs of each node are given in order of the node numbers.
+   * @param  file_name  Where to write it.
+   * @param  costing    The name of the costing it was built for.
+   * @param  edges      The directed edge of every node.
+   * @param  up         For every node the arcs to higher nodes leaving it.
+   * @param  down       For every node the arcs from higher nodes entering it, the node of those
+   *                    arcs being the one they leave.
+   */
+  static void Write(const std::string& file_name,
+                    const std::string& costing,
+                    const std::vector<GraphId>& edges,
+                    const std::vector<std::vector<Arc>>& up,
+                    const std::vector<std::vector<Arc>>& down);
+
+  /**
+   * Maps a hierarchy from disk, throws if the file is missing or not a hierarchy.
+   * @param  file_name  The file to map.
+   */
+  explicit ContractionHierarchy(const std::string& file_name);
+
+  ContractionHierarchy(const ContractionHierarchy&) = delete;
+  ContractionHierarchy& operator=(const ContractionHierarchy&) = delete;
+
+  /**
+   * @return the name of the costing the hierarchy was built for
+   */
+  std::string costing() const;
+
+  /**
+   * @return how many nodes (directed edges) there are in the hierarchy
+   */
+  uint32_t size() const {
+    return header_->node_count;
+  }
+
+  /**
+   * Finds the node of a directed edge.
+   * @param  edgeid  The directed edge.
+   * @return the node or kInvalidNode if the edge is not usable with the costing
+   */
+  uint32_t node(const GraphId& edgeid) const;
+
+  /**
+   * @param  node  A node of the hierarchy.
+   * @return the directed edge of the node
+   */
+  GraphId edge(const uint32_t node) const {
+    return GraphId(edges_[node]);
+  }
+
+  /**
+   * @param  node  A node of the hierarchy.
+   * @return the range of arcs leaving the node to higher nodes
+   */
+  std::pair<const Arc*, const Arc*> up(const uint32_t node) const {
+    return {up_arcs_ + up_offsets_[node], up_arcs_ + up_offsets_[node + 1]};
+  }
+
+  /**
+   * @param  node  A node of the hierarchy.
+   * @return the range of arcs entering the node from higher nodes
+   */
+  std::pair<const Arc*, const Arc*> down(const uint32_t node) const {
+    return {down_arcs_ + down_offsets_[node], down_arcs_ + down_offsets_[node + 1]};
+  }
+
+protected:
+  // the mapped file
+  Sidecar file_;
+
+  const Header* header_;
+  const uint64_t* edges_;
+  const uint64_t* up_offsets_;
+  const uint64_t* down_offsets_;
+  // node numbers sorted by the value of their edge for the lookup by edge
+  const uint32_t* by_edge_;
+  const Arc* up_arcs_;
+  const Arc* down_arcs_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
@@ -3,8 +3,11 @@
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/tilegetter.h>
 
+#include <future>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace valhalla {
 namespace baldr {
@@ -55,5 +58,53 @@ private:
   const interrupt_t* interrupt_ = nullptr;
 };
 
+/**
+ * Asynchronous implementation which drives all requests through a single curl multi handle on a
+ * background thread. Connections are kept alive and requests are multiplexed over HTTP/2 when
+ * the server supports it, so a whole batch of tiles can be in flight over a few connections.
+ */
+class curl_multi_tile_getter_t : public tile_getter_t {
+public:
+  /**
+   * @param max_connections  the most connections to open to the tile server at once
+   * @param user_agent  user agent to use for HTTP requests
+   * @param gzipped  whether to request for gzip compressed data
+   */
+  curl_multi_tile_getter_t(const size_t max_connections,
+                           const std::string& user_agent,
+                           bool gzipped);
+  ~curl_multi_tile_getter_t() override;
+
+  using response_t = tile_getter_t::response_t;
+
+  /**
+   * Waits for the request, checking the interrupt while it is in flight
+   */
+  response_t get(const std::string& url) override;
+
+  std::future<response_t> get_async(const std::string& url) override;
+
+  std::vector<std::future<response_t>> get_batch(const std::vector<std::string>& urls) override;
+
+  bool gzipped() const override {
+    return gzipped_;
+  }
+
+  using interrupt_t = tile_getter_t::interrupt_t;
+
+  /**
+   * Only applies to synchronous requests, everything already in flight finishes regardless
+   */
+  void set_interrupt(const interrupt_t* interrupt) override {
+    interrupt_ = interrupt;
+  }
+
+private:
+  struct pimpl_t;
+  std::unique_ptr<pimpl_t> pimpl_;
+  const bool gzipped_;
+  const interrupt_t* interrupt_ = nullptr;
+};
+
 } // namespace baldr
 } // namespace valhalla
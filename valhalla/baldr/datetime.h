@@ -7,6 +7,7 @@
 #include <iostream>
 #include <locale>
 #include <memory>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -31,9 +32,29 @@ struct tz_db_t {
   size_t to_index(const std::string& zone) const;
   const date::time_zone* from_index(size_t index) const;
 
+  /**
+   * Get the offset of a timezone from UTC at a time. The offsets of every timezone and day asked
+   * for, and the transition between them if there is one that day, are kept for all threads so
+   * only the first time asked about on a day goes through the rules of the timezone.
+   * @param  time_zone  timezone of this db
+   * @param  seconds    seconds since epoch
+   * @return Returns the offset in seconds.
+   */
+  int offset(const date::time_zone* time_zone, const uint64_t seconds) const;
+
 protected:
+  // the offsets of a timezone on a day, the one after applies from the transition on
+  struct day_offsets_t {
+    int32_t before;
+    int32_t after;
+    uint32_t transition; // seconds into the day, a whole day if there is none
+  };
+
   std::unordered_map<std::string, size_t> names;
   const date::tzdb& db;
+  // keyed by timezone index and day since epoch
+  mutable std::shared_timed_mutex days_mutex;
+  mutable std::unordered_map<uint64_t, day_offsets_t> days;
 };
 
 /**
@@ -5,6 +5,7 @@
 #include <cmath>
 #include <cstdint>
 #include <valhalla/baldr/graphconstants.h>
+#include <valhalla/midgard/tracepoint.h>
 #include <valhalla/midgard/util.h>
 #include <vector>
 
@@ -21,8 +22,14 @@ using buckets_t = std::vector<bucket_t>;
  * reduced memory use. Costs outside the current bucket "range" get placed
  * into the overflow bucket and are moved into the low-level buckets as
  * needed. Each bucket stores label indexes into external data.
+ *
+ * By default the queue remembers where each label sits so that decreasing its
+ * cost leaves a tombstone behind in O(1) rather than searching its old bucket,
+ * which gets slow when there are thousands of labels per bucket. Tombstones are
+ * skipped when popping so labels come out in exactly the same order either way.
+ * Set indexed to false to save the memory of the index.
  */
-template <typename label_t> class DoubleBucketQueue final {
+template <typename label_t, bool indexed = true> class DoubleBucketQueue final {
 public:
   /**
    * Constructor given a minimum cost, a range of costs held within the
@@ -39,34 +46,23 @@ public:
                     const float range,
                     const uint32_t bucketsize,
                     const std::vector<label_t>& labelcontainer)
-      : labelcontainer_(labelcontainer) {
-    // We need at least a bucketsize of 1 or more
-    if (bucketsize < 1) {
-      throw std::runtime_error("Bucketsize must be 1 or greater");
-    }
-
-    // We need at least a bucketrange of something larger than 0
-    if (range <= 0.f) {
-      throw std::runtime_error("Bucketrange must be greater than 0");
-    }
-
-    // Adjust min cost to be the start of a bucket
-    uint32_t c = static_cast<uint32_t>(mincost);
-    currentcost_ = (c - (c % bucketsize));
-    mincost_ = currentcost_;
-    bucketrange_ = range;
-    bucketsize_ = static_cast<float>(bucketsize);
-    inv_ = 1.0f / bucketsize_;
-
-    // Set the maximum cost (above this goes into the overflow bucket)
-    maxcost_ = mincost_ + bucketrange_;
-
-    // Allocate the low-level buckets
-    size_t bucketcount = (range / bucketsize_) + 1;
-    buckets_.resize(bucketcount);
+      : size_(0), labelcontainer_(labelcontainer) {
+    set_range(mincost, range, bucketsize);
+  }
 
-    // Set the current bucket to the lowest cost low level bucket
-    currentbucket_ = buckets_.begin();
+  /**
+   * Empties the queue and gives it a new range of costs for the next search, keeping the memory
+   * of its buckets. Saves small searches most of their setup as allocating the thousands of low
+   * level buckets costs more than the few labels they settle.
+   * @param mincost    Minimum cost. Used to create the initial range for
+   *                   bucket sorting.
+   * @param range      Cost range for low-level buckets.
+   * @param bucketsize Bucket size (range of costs within same bucket).
+   *                   Must be an integer value.
+   */
+  void reuse(const float mincost, const float range, const uint32_t bucketsize) {
+    clear();
+    set_range(mincost, range, bucketsize);
   }
 
   /**
@@ -75,6 +71,8 @@ public:
   void clear() {
     // Empty the overflow bucket and each bucket
     overflowbucket_.clear();
+    positions_.clear();
+    size_ = 0;
     while (currentbucket_ != buckets_.end()) {
       currentbucket_->clear();
       currentbucket_++;
@@ -93,7 +91,12 @@ public:
    * @param   label  Label index to add to the queue.
    */
   void add(const uint32_t label) {
-    get_bucket(labelcontainer_[label].sortcost()).push_back(label);
+    ++size_;
+    if (indexed) {
+      place(label, get_bucket_index(labelcontainer_[label].sortcost()));
+    } else {
+      get_bucket(labelcontainer_[label].sortcost()).push_back(label);
+    }
   }
 
   /**
@@ -104,6 +107,18 @@ public:
    * @param  newcost      New sort cost.
    */
   void decrease(const uint32_t label, const float newcost) {
+    if (indexed) {
+      // Leave a tombstone where the label was and add it to its new bucket
+      const auto bucket = get_bucket_index(newcost);
+      auto& position = positions_[label];
+      if (position.bucket != bucket) {
+        get_bucket_by_index(position.bucket)[position.offset] = kTombstone;
+        place(label, bucket);
+        ++size_;
+      }
+      return;
+    }
+
     // Get the buckets of the previous and new costs. Nothing needs to be done
     // if old cost and the new cost are in the same buckets.
     bucket_t& prevbucket = get_bucket(labelcontainer_[label].sortcost());
@@ -121,8 +136,122 @@ public:
    *          kInvalidLabel if the buckets are empty.
    */
   uint32_t pop() {
+    uint32_t label;
+    do {
+      label = pop_label();
+    } while (indexed && label == kTombstone);
+    return label;
+  }
+
+  /**
+   * Removes all of the label indexes in the lowest cost bucket at once so they can be expanded
+   * together. Labels added with a cost below the end of that bucket while they are expanded go
+   * into the same bucket again and come out with the next call.
+   * @param  labels  Gets the label indexes in the order pop would have returned them.
+   * @return Returns false if the buckets are empty.
+   */
+  bool pop_bucket(std::vector<uint32_t>& labels) {
+    labels.clear();
+    uint32_t label = pop();
+    if (label == baldr::kInvalidLabel) {
+      return false;
+    }
+    labels.push_back(label);
+    while (!currentbucket_->empty()) {
+      label = currentbucket_->back();
+      currentbucket_->pop_back();
+      --size_;
+      if (!indexed || label != kTombstone) {
+        labels.push_back(label);
+      }
+    }
+    return true;
+  }
+
+  /**
+   * How many label indexes the queue has room for without allocating, which it keeps when it is
+   * cleared or reused.
+   * @return Returns the capacity of all of the buckets and of the positions.
+   */
+  size_t capacity() const {
+    size_t capacity = overflowbucket_.capacity() + positions_.capacity();
+    for (const auto& bucket : buckets_) {
+      capacity += bucket.capacity();
+    }
+    return capacity;
+  }
+
+  /**
+   * Memory used by the queue, which grows with the labels in it.
+   * @return Returns how many bytes the label indexes, tombstones and positions take.
+   */
+  size_t bytes() const {
+    return buckets_.size() * sizeof(bucket_t) + size_ * sizeof(uint32_t) +
+           positions_.size() * sizeof(position_t);
+  }
+
+private:
+  // Marks the old spot of a label whose cost was decreased into another bucket
+  static constexpr uint32_t kTombstone = baldr::kInvalidLabel - 1;
+
+  // Where a label is in the buckets, the overflow bucket has index buckets_.size()
+  struct position_t {
+    uint32_t bucket;
+    uint32_t offset;
+  };
+
+  /**
+   * Sets the range of costs of the low level buckets and makes sure there are enough of them.
+   * @param mincost    Minimum cost of the low level buckets.
+   * @param range      Cost range for low-level buckets.
+   * @param bucketsize Bucket size (range of costs within same bucket).
+   */
+  void set_range(const float mincost, const float range, const uint32_t bucketsize) {
+    // We need at least a bucketsize of 1 or more
+    if (bucketsize < 1) {
+      throw std::runtime_error("Bucketsize must be 1 or greater");
+    }
+
+    // We need at least a bucketrange of something larger than 0
+    if (range <= 0.f) {
+      throw std::runtime_error("Bucketrange must be greater than 0");
+    }
+
+    // Adjust min cost to be the start of a bucket
+    uint32_t c = static_cast<uint32_t>(mincost);
+    currentcost_ = (c - (c % bucketsize));
+    mincost_ = currentcost_;
+    bucketrange_ = range;
+    bucketsize_ = static_cast<float>(bucketsize);
+    inv_ = 1.0f / bucketsize_;
+
+    // Set the maximum cost (above this goes into the overflow bucket)
+    maxcost_ = mincost_ + bucketrange_;
+
+    // Allocate the low-level buckets
+    size_t bucketcount = (range / bucketsize_) + 1;
+    buckets_.resize(bucketcount);
+
+    // Set the current bucket to the lowest cost low level bucket
+    currentbucket_ = buckets_.begin();
+  }
+
+  /**
+   * Removes the label index at the back of the lowest cost bucket, which may
+   * be a tombstone.
+   * @return  Returns the label index or kInvalidLabel if the buckets are empty.
+   */
+  uint32_t pop_label() {
     if (empty()) {
-      // No labels found in the low-level buckets.
+      // No labels found in the low-level buckets. Tombstones in the overflow
+      // bucket have no cost to move them by so drop them, the positions of
+      // the rest are recorded again when they are moved
+      if (indexed) {
+        auto tombstone = kTombstone;
+        auto tombstones = std::remove(overflowbucket_.begin(), overflowbucket_.end(), tombstone);
+        size_ -= overflowbucket_.end() - tombstones;
+        overflowbucket_.erase(tombstones, overflowbucket_.end());
+      }
       if (overflowbucket_.empty()) {
         // Return an invalid label if no labels are in the overflow buckets.
         // Reset currentbucket to the last bucket - in case another access of
@@ -142,10 +271,10 @@ public:
     // Return label from lowest non-empty bucket
     uint32_t label = currentbucket_->back();
     currentbucket_->pop_back();
+    --size_;
     return label;
   }
 
-private:
   float bucketrange_; // Total range of costs in lower level buckets
   float bucketsize_;  // Bucket size (range of costs in same bucket)
   float inv_;         // 1/bucketsize (so we can avoid division)
@@ -162,9 +291,45 @@ private:
   // Overflow bucket
   bucket_t overflowbucket_;
 
+  // How many label indexes and tombstones are in all of the buckets
+  size_t size_;
+
   // Access to a container of labels to get cost given the label index.
   const std::vector<label_t>& labelcontainer_;
 
+  // Position of each label in the buckets, only used when indexed
+  std::vector<position_t> positions_;
+
+  /**
+   * Returns the index of the bucket given the cost, mirrors get_bucket.
+   * @param  cost  Cost.
+   * @return Returns the index of the bucket that the cost lies within.
+   */
+  uint32_t get_bucket_index(const float cost) const {
+    return (cost < currentcost_)
+               ? static_cast<uint32_t>(currentbucket_ - buckets_.begin())
+               : (cost < maxcost_) ? static_cast<uint32_t>((cost - mincost_) * inv_)
+                                   : static_cast<uint32_t>(buckets_.size());
+  }
+
+  bucket_t& get_bucket_by_index(const uint32_t index) {
+    return index < buckets_.size() ? buckets_[index] : overflowbucket_;
+  }
+
+  /**
+   * Appends the label to a bucket and records where it went.
+   * @param  label   Label index.
+   * @param  bucket  Index of the bucket.
+   */
+  void place(const uint32_t label, const uint32_t bucket) {
+    auto& b = get_bucket_by_index(bucket);
+    if (label >= positions_.size()) {
+      positions_.resize(label + 1);
+    }
+    positions_[label] = {bucket, static_cast<uint32_t>(b.size())};
+    b.push_back(label);
+  }
+
   /**
    * Returns the bucket given the cost.
    * @param  cost  Cost.
@@ -223,13 +388,23 @@ private:
         // Get the cost (using the label cost function)
         float cost = labelcontainer_[label].sortcost();
         if (cost < maxcost_) {
-          buckets_[static_cast<uint32_t>((cost - mincost_) * inv_)].push_back(label);
+          auto bucket = static_cast<uint32_t>((cost - mincost_) * inv_);
+          if (indexed) {
+            place(label, bucket);
+          } else {
+            buckets_[bucket].push_back(label);
+          }
         } else {
+          if (indexed) {
+            positions_[label] = {static_cast<uint32_t>(buckets_.size()),
+                                 static_cast<uint32_t>(tmp.size())};
+          }
           tmp.push_back(label);
         }
       }
 
       // Add any labels that lie outside the new range back to overflow bucket
+      VALHALLA_TRACE2(queue_refill, overflowbucket_.size() - tmp.size(), tmp.size());
       overflowbucket_ = std::move(tmp);
     }
 
@@ -0,0 +1,54 @@
+#ifndef VALHALLA_BALDR_EDGEBOUNDS_H_
+#define VALHALLA_BALDR_EDGEBOUNDS_H_
+
+#include <cstdint>
+
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+// How many units the sides of a tile are divided into for the bounds of its edges
+constexpr int32_t kEdgeBoundsUnits = 4096;
+
+/**
+ * The bounding box of the shape of a directed edge, in units of a 4096th of the size of its tile
+ * from the south west corner of the tile. The box is rounded outwards so it always holds all of
+ * the shape, sides further than 8 tiles away are left open. Lets a search skip the edges too far
+ * away from its locations before decoding any shape.
+ */
+class EdgeBounds {
+public:
+  /**
+   * Constructor of bounds open on all sides.
+   */
+  EdgeBounds();
+
+  /**
+   * Constructor.
+   * @param  bounds       the bounding box of the shape of the edge
+   * @param  tile_bounds  the bounding box of the tile of the edge
+   */
+  EdgeBounds(const midgard::AABB2<midgard::PointLL>& bounds,
+             const midgard::AABB2<midgard::PointLL>& tile_bounds);
+
+  /**
+   * Gets the bounding box, which holds the whole shape of the edge.
+   * @param  tile_bounds  the bounding box of the tile of the edge
+   * @return the bounding box, reaching the edges of the world on any open side
+   */
+  midgard::AABB2<midgard::PointLL>
+  bounds(const midgard::AABB2<midgard::PointLL>& tile_bounds) const;
+
+protected:
+  int16_t minx_;
+  int16_t miny_;
+  int16_t maxx_;
+  int16_t maxy_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_EDGEBOUNDS_H_
@@ -7,6 +7,8 @@
 #include <string>
 #include <vector>
 
+#include <boost/utility/string_view.hpp>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/json.h>
 #include <valhalla/midgard/encoded.h>
@@ -145,6 +147,22 @@ public:
    */
   std::vector<std::string> GetNames(bool only_tagged_names = false) const;
 
+  /**
+   * Calls the visitor with each name of the edge, pointing straight into the text list of the
+   * tile so that no strings are copied or allocated.
+   * @param  visitor  called as visitor(boost::string_view name, bool is_route_number)
+   * @param  only_tagged_names  Bool indicating whether or not to visit only the tagged names
+   */
+  template <typename Visitor> void VisitNames(Visitor&& visitor, bool only_tagged_names = false) const {
+    const NameInfo* ni = name_info_list_;
+    for (uint32_t i = 0; i < name_count(); i++, ni++) {
+      if (static_cast<bool>(ni->tagged_) != only_tagged_names) {
+        continue;
+      }
+      visitor(GetNameView(*ni), static_cast<bool>(ni->is_route_num_));
+    }
+  }
+
   /**
    * Convenience method to get the names and route number flags for an edge.
    * @param  include_tagged_names  Bool indicating whether or not to return the tagged names too
@@ -176,6 +194,24 @@ public:
     return midgard::Shape7Decoder<midgard::PointLL>(encoded_shape_, ei_.encoded_shape_size_);
   }
 
+  /**
+   * Calls the visitor with each point of the shape of the edge in order, decoding them one at
+   * a time rather than into a vector.
+   * @param  visitor  called as visitor(const midgard::PointLL& point)
+   */
+  template <typename Visitor> void VisitShape(Visitor&& visitor) const {
+    if (encoded_shape_ == nullptr || !shape_.empty()) {
+      for (const auto& point : shape_) {
+        visitor(point);
+      }
+      return;
+    }
+    auto decoder = lazy_shape();
+    while (!decoder.empty()) {
+      visitor(decoder.pop());
+    }
+  }
+
   /**
    * Returns the encoded shape string.
    * @return  Returns the encoded shape string.
@@ -208,6 +244,13 @@ public:
   };
 
 protected:
+  /**
+   * Gets the text of a name without copying it out of the text list.
+   * @param  ni  the name info of the name
+   * @return the text of the name
+   */
+  boost::string_view GetNameView(const NameInfo& ni) const;
+
   // Fixed size information
   EdgeInfoInner ei_;
 
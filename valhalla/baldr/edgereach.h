@@ -0,0 +1,104 @@
+#ifndef VALHALLA_BALDR_EDGEREACH_H_
+#define VALHALLA_BALDR_EDGEREACH_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/sidecar.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The reach of every edge of the graph, up to a cap, as loki::Reach estimates it with the default
+ * options of one costing: how many nodes a search that stops at restrictions and closures finds
+ * leaving the end of the edge (outbound) and arriving at its start (inbound). This is a lower
+ * bound of the exact reach, so an edge whose stored reach meets the reach a request asks for is
+ * known to meet it without running a search. Edges which fall short may still meet it when the
+ * restrictions are followed exactly, those still need the search.
+ *
+ * The reach of the edges of every level is kept, a file in the tile_dir per costing, which is
+ * memory mapped read only.
+ */
+class EdgeReach {
+public:
+  // What is at the start of the file
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t cap;
+    uint64_t tile_count;
+    uint64_t edge_count;
+    char costing[16];
+  };
+
+  /**
+   * Where the reach of a costing lives.
+   * @param  tile_dir  The tile directory.
+   * @param  costing   The name of the costing.
+   * @return the path to the file
+   */
+  static std::string FileName(const std::string& tile_dir, const std::string& costing);
+
+  /**
+   * Writes the reach to disk.
+   * @param  file_name  Where to write it.
+   * @param  costing    The name of the costing whose default options they were computed with.
+   * @param  cap        The most reach that was looked for.
+   * @param  tiles      The tiles the edges are in, sorted by their value.
+   * @param  offsets    Where the edges of each tile start in the reach, in edges, with one more
+   *                    at the end for the total.
+   * @param  reach      Per edge, the outbound followed by the inbound reach.
+   */
+  static void Write(const std::string& file_name,
+                    const std::string& costing,
+                    const uint32_t cap,
+                    const std::vector<GraphId>& tiles,
+                    const std::vector<uint64_t>& offsets,
+                    const std::vector<uint16_t>& reach);
+
+  /**
+   * Maps the reach from disk, throws if the file is missing or not reach.
+   * @param  file_name  The file to map.
+   */
+  explicit EdgeReach(const std::string& file_name);
+
+  EdgeReach(const EdgeReach&) = delete;
+  EdgeReach& operator=(const EdgeReach&) = delete;
+
+  /**
+   * @return the name of the costing the reach was computed for
+   */
+  std::string costing() const;
+
+  /**
+   * @return the most reach that was looked for, no edge has more
+   */
+  uint32_t cap() const {
+    return header_->cap;
+  }
+
+  /**
+   * Finds the reach of an edge.
+   * @param  edge  The edge, at any level but transit.
+   * @return the outbound reach of the edge followed by its inbound reach, or nullptr if the edge
+   *         is unknown
+   */
+  const uint16_t* reach(const GraphId& edge) const;
+
+protected:
+  // the mapped file
+  Sidecar file_;
+
+  const Header* header_;
+  const uint64_t* tiles_;
+  const uint64_t* offsets_;
+  const uint16_t* reach_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_EDGEREACH_H_
@@ -0,0 +1,104 @@
+#ifndef VALHALLA_BALDR_ELEVATIONPROFILES_H_
+#define VALHALLA_BALDR_ELEVATIONPROFILES_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+// About how far apart the heights of an elevation profile are along the edge (meters), the
+// actual interval is the length of the edge divided evenly
+constexpr float kElevationProfileInterval = 30.0f;
+
+// How many heights a meter is quantized to (quarter meters)
+constexpr float kElevationProfilePrecision = 4.0f;
+
+/**
+ * Class to access the elevation profiles of the edges within a tile. Every directed edge has an
+ * offset into the profiles, both directions of an edge point at the same one. A profile is the
+ * number of heights followed by the first height and then the difference of each height to the
+ * one before it, all quantized and packed as zigzag varints. Offset 0 is the empty profile of the
+ * edges without one.
+ */
+class ElevationProfiles {
+public:
+  /**
+   * Constructor.
+   */
+  ElevationProfiles() : offset_(nullptr), profiles_(nullptr), size_(0) {
+  }
+
+  /**
+   * Packs the heights of a profile, the empty profile comes first in a new section.
+   * @param  heights   The heights evenly spaced along the shape of the edge, in meters.
+   * @param  profiles  Where the packed profile is appended.
+   */
+  static void Pack(const std::vector<double>& heights, std::string& profiles);
+
+  /**
+   * Set a pointer to the offset data within the GraphTile.
+   * @param  offset Pointer to the offset array in the GraphTile.
+   */
+  void set_offset(const uint32_t* offset) {
+    offset_ = offset;
+  }
+
+  /**
+   * Set a pointer to the packed profiles within the GraphTile.
+   * @param  profiles Pointer to the profiles in the GraphTile.
+   * @param  size     How many bytes of profiles there are.
+   */
+  void set_profiles(const char* profiles, const uint32_t size) {
+    profiles_ = profiles;
+    size_ = size;
+  }
+
+  /**
+   * @return whether the tile has elevation profiles
+   */
+  bool empty() const {
+    return offset_ == nullptr;
+  }
+
+  /**
+   * @return the offset into the profiles of each directed edge, nullptr if there are none
+   */
+  const uint32_t* offsets() const {
+    return offset_;
+  }
+
+  /**
+   * @return the packed profiles, as many bytes as size says
+   */
+  const char* profiles() const {
+    return profiles_;
+  }
+
+  /**
+   * @return how many bytes of profiles there are
+   */
+  uint32_t size() const {
+    return size_;
+  }
+
+  /**
+   * Get the heights along a directed edge.
+   * @param  idx      Directed edge index.
+   * @param  forward  Whether the edge goes the way of its shape, the heights are reversed if not.
+   * @return the heights evenly spaced from the start of the edge to its end in meters, none if
+   *         the edge has no profile
+   */
+  std::vector<float> profile(const uint32_t idx, const bool forward) const;
+
+protected:
+  const uint32_t* offset_; // Offset into the profiles for each directed edge
+  const char* profiles_;   // Packed profiles
+  uint32_t size_;          // How many bytes of profiles there are
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_ELEVATIONPROFILES_H_
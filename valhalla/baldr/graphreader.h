@@ -1,17 +1,22 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/opposingedges.h>
+#include <valhalla/baldr/recoveredshortcuts.h>
 #include <valhalla/baldr/tilegetter.h>
 #include <valhalla/baldr/tilehierarchy.h>
 
@@ -24,6 +29,9 @@
 namespace valhalla {
 namespace baldr {
 
+struct tile_prefetcher_t;
+struct shared_tile_segment_t;
+
 struct IncidentResult {
   std::shared_ptr<const IncidentsTile> tile;
   // Index into the Location array
@@ -86,6 +94,23 @@ public:
    *  Some implementations may simply clear the entire cache
    */
   virtual void Trim() = 0;
+
+  /**
+   * Counters of how well the cache is doing
+   */
+  struct Stats {
+    uint64_t hits;     // lookups that found the tile
+    uint64_t misses;   // lookups that did not find the tile
+    uint64_t rejected; // tiles the admission policy refused to cache
+  };
+
+  /**
+   * Returns the cache counters, all 0 for caches that dont keep them.
+   * @return the counters
+   */
+  virtual Stats GetStats() const {
+    return {};
+  }
 };
 
 /**
@@ -303,6 +328,12 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Returns the hit and miss counters of the cache.
+   * @return the counters
+   */
+  Stats GetStats() const override;
+
 protected:
   struct KeyValue {
     KeyValue(GraphId id_, graph_tile_ptr tile_) : id(id_), tile(std::move(tile_)) {
@@ -330,6 +361,14 @@ protected:
    */
   void MoveToLruHead(const KeyValueIter& entry_iter) const;
 
+  /**
+   * Called for every entry right before it is evicted by TrimToFit. Does nothing by default.
+   *
+   * @param entry   the entry about to be evicted
+   */
+  virtual void Evicting(const KeyValue& entry) {
+  }
+
   // The GraphId -> Iterator into the linked list which owns the cached objects
   std::unordered_map<uint64_t, KeyValueIter> cache_;
 
@@ -345,6 +384,175 @@ protected:
 
   // The max cache size in bytes
   size_t max_cache_size_;
+
+  // Lookup counters
+  mutable uint64_t hits_;
+  mutable uint64_t misses_;
+};
+
+/**
+ * LRU tile cache with a TinyLFU admission policy. How often each tile is asked for is kept in a
+ * compact frequency sketch and a new tile is only admitted if it was asked for more often than the
+ * tiles it would evict. This keeps one off scans over many tiles (big isochrones or matrices) from
+ * flushing the tiles that most requests need.
+ * It is NOT thread-safe!
+ */
+class TileCacheTinyLFU : public TileCacheLRU {
+public:
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache
+   * @param mem_control  strategy our cache will use to control its memory
+   */
+  TileCacheTinyLFU(size_t max_size, MemoryLimitControl mem_control);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items and sizes the
+   * frequency sketch to match.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Puts a copy of a tile of into the cache if there is room for it or if it is used more
+   * often than the tiles that would have to be evicted for it. A rejected tile is returned
+   * without being cached.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t tile_size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId. Counts towards the frequency
+   * of the tile whether or not it is cached.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Clears the cache and the frequency history.
+   */
+  void Clear() override;
+
+  /**
+   * Returns the hit, miss and rejection counters of the cache.
+   * @return the counters
+   */
+  Stats GetStats() const override;
+
+protected:
+  /**
+   * Count-min sketch of tile frequencies. The counters saturate at 15 and are all
+   * halved once enough increments have been seen so that old popularity fades out.
+   */
+  class FrequencySketch {
+  public:
+    /**
+     * Constructor.
+     * @param width  number of counters per row, rounded up to a power of 2
+     */
+    explicit FrequencySketch(size_t width);
+
+    /**
+     * Counts one more use of the tile.
+     * @param graphid  the graphid of the tile
+     */
+    void Increment(const GraphId& graphid);
+
+    /**
+     * Estimates how often the tile was used, never underestimates.
+     * @param graphid  the graphid of the tile
+     * @return the estimated frequency
+     */
+    uint8_t Estimate(const GraphId& graphid) const;
+
+    /**
+     * Forgets all of the frequencies.
+     */
+    void Clear();
+
+  protected:
+    size_t Index(uint64_t key, size_t row) const;
+
+    std::vector<uint8_t> counters_; // kDepth rows of width counters
+    size_t mask_;
+    size_t additions_;
+    size_t sample_size_;
+  };
+
+  mutable FrequencySketch sketch_;
+  uint64_t rejected_;
+};
+
+/**
+ * LRU tile cache with a second, compressed tier. Tiles evicted from the LRU are deflated with
+ * the fastest zlib level and kept in a second LRU of their own limited size. A miss that finds
+ * the tile there only has to inflate it from memory which beats reading it from disk again.
+ * It is NOT thread-safe!
+ */
+class TileCacheLRUCompressed : public TileCacheLRU {
+public:
+  /**
+   * Constructor.
+   * @param max_size             maximum size of the decompressed tiles
+   * @param max_compressed_size  maximum size of the compressed tiles
+   * @param mem_control          strategy our cache will use to control its memory
+   */
+  TileCacheLRUCompressed(size_t max_size, size_t max_compressed_size, MemoryLimitControl mem_control);
+
+  /**
+   * Checks if tile exists in either tier of the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId. Tiles found in the compressed
+   * tier are inflated and moved back to the decompressed one.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Clears both tiers of the cache.
+   */
+  void Clear() override;
+
+  /**
+   * Size of the compressed tier in bytes
+   * @return the size
+   */
+  size_t CompressedSize() const {
+    return compressed_size_;
+  }
+
+protected:
+  struct CompressedTile {
+    GraphId id;
+    size_t size; // decompressed size of the tile
+    std::vector<char> bytes;
+  };
+  using CompressedIter = std::list<CompressedTile>::iterator;
+
+  /**
+   * Deflates the tile into the compressed tier, evicting the oldest compressed tiles to make room.
+   * @param entry  the entry being evicted from the decompressed tier
+   */
+  void Evicting(const KeyValue& entry) override;
+
+  // The GraphId -> Iterator into the list which owns the compressed tiles
+  mutable std::unordered_map<uint64_t, CompressedIter> compressed_;
+
+  // Compressed tiles, the most recently evicted at the beginning
+  mutable std::list<CompressedTile> compressed_lru_list_;
+
+  // The current and max size of the compressed tier in bytes
+  mutable size_t compressed_size_;
+  size_t max_compressed_size_;
 };
 
 /**
@@ -355,10 +563,10 @@ class SynchronizedTileCache : public TileCache {
 public:
   /**
    * Constructor.
-   * @param cache reference to an external cache
-   * @param mutex reference to an external mutex
+   * @param cache the external cache, shared with the other wrappers of it
+   * @param mutex the external mutex guarding it
    */
-  SynchronizedTileCache(TileCache& cache, std::mutex& mutex);
+  SynchronizedTileCache(std::shared_ptr<TileCache> cache, std::shared_ptr<std::mutex> mutex);
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
    * @param tile_size appeoximate size of one tile
@@ -404,11 +612,218 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Returns the counters of the wrapped cache.
+   * @return the counters
+   */
+  Stats GetStats() const override;
+
 private:
+  std::shared_ptr<TileCache> cache_ptr_;
+  std::shared_ptr<std::mutex> mutex_ptr_;
   TileCache& cache_;
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Tile cache which splits its tiles into a number of shards by GraphId hash, each
+ * shard being protected by its own mutex. Memory accounting is global across the
+ * shards. Copies of the cache share the same underlying shards so that it can be
+ * handed out to many readers at once.
+ * It is thread-safe.
+ */
+class ShardedTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache
+   * @param shard_count  number of independently locked shards, rounded up to a power of 2
+   */
+  ShardedTileCache(size_t max_size, size_t shard_count);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache. If another thread already put the same
+   * tile the one already cached is kept and returned.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Does its best to reduce the cache size to remove overcommitted state.
+   *  This implementation clears the entire cache
+   */
+  void Trim() override;
+
+  /**
+   * Returns the number of shards the tiles are spread across.
+   * @return the shard count
+   */
+  size_t ShardCount() const {
+    return state_->shards.size();
+  }
+
+protected:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, graph_tile_ptr> cache;
+    // The size of the tiles in this shard in bytes
+    size_t cache_size = 0;
+  };
+
+  struct State {
+    State(size_t max_size, size_t shard_count);
+    std::vector<Shard> shards;
+    // The current cache size in bytes summed over all shards
+    std::atomic<size_t> cache_size;
+    // The max cache size in bytes
+    const size_t max_cache_size;
+    // Bits used to pick a shard from the hash
+    const uint32_t shard_shift;
+  };
+
+  inline Shard& get_shard(const GraphId& graphid) const {
+    // fibonacci hashing spreads neighbouring tile ids and levels over the shards
+    const uint64_t hash = graphid.Tile_Base().value * 0x9E3779B97F4A7C15ull;
+    return state_->shards[state_->shard_shift == 64 ? 0 : hash >> state_->shard_shift];
+  }
+
+  std::shared_ptr<State> state_;
+};
+
+/**
+ * Tile cache which keeps the tile bytes in a named shared memory segment, a file on a tmpfs
+ * such as /dev/shm, so that every worker process on a host shares one copy of each tile. Once
+ * a process has loaded (and possibly inflated) a tile the others simply map it. The segment
+ * never evicts, tiles that no longer fit are cached privately by the process instead. The
+ * segment has to be removed whenever the tiles it was filled from change, other than by reloading
+ * the tileset in which case the tiles of each tileset are kept apart.
+ * The segment is safe to share between processes and threads but the cache object itself
+ * is NOT thread-safe!
+ */
+class SharedMemoryTileCache : public TileCache {
+public:
+  /**
+   * Constructor. Creates the segment if it doesnt exist yet or opens the existing one.
+   * @param path          location of the segment
+   * @param segment_size  size of the segment in bytes when creating it
+   * @param max_size      maximum size of the tiles cached privately by this process
+   * @param tileset_generation  which of the tilesets loaded by the process it holds tiles of, the
+   *                            tiles of each are kept apart in the segment
+   */
+  SharedMemoryTileCache(const std::string& path,
+                        size_t segment_size,
+                        size_t max_size,
+                        uint64_t tileset_generation = 0);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the shared segment, or into the private cache if the
+   * segment is full.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   * @return the cached tile which may be backed by the shared segment
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the private part of the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the tiles this process holds, the shared segment is left alone.
+   */
+  void Clear() override;
+
+  /**
+   *  Does its best to reduce the cache size to remove overcommitted state.
+   *  Some implementations may simply clear the entire cache
+   */
+  void Trim() override;
+
+  /**
+   * Returns the hit and miss counters of the cache.
+   * @return the counters
+   */
+  Stats GetStats() const override;
+
+protected:
+  // The key of a tile in the segment
+  GraphId segment_key(const GraphId& graphid) const;
+
+  std::shared_ptr<shared_tile_segment_t> segment_;
+
+  // The tileset generation in the bits above those of the graphid
+  uint64_t generation_bits_;
+
+  // The tiles this process has looked up so far, either backed by the segment or private
+  mutable std::unordered_map<uint64_t, graph_tile_ptr> cache_;
+
+  // The size of the private tiles in bytes
+  size_t cache_size_;
+
+  // The max size of the private tiles in bytes
+  size_t max_cache_size_;
+
+  // Lookup counters
+  mutable uint64_t hits_;
+  mutable uint64_t misses_;
+};
+
 /**
  * Creates tile caches.
  */
@@ -417,10 +832,13 @@ class TileCacheFactory final {
 
 public:
   /**
-   * Constructs tile cache.
-   * @param pt  Property tree listing the configuration for the cahce configuration
+   * Constructs tile cache. The caches shared between readers are kept apart for every tileset so
+   * that the tiles of two tilesets never mix.
+   * @param pt                  Property tree listing the configuration for the cahce configuration
+   * @param tileset_generation  which of the tilesets loaded by the process it will hold tiles of
    */
-  static TileCache* createTileCache(const boost::property_tree::ptree& pt);
+  static TileCache* createTileCache(const boost::property_tree::ptree& pt,
+                                    const uint64_t tileset_generation = 0);
 };
 
 /**
@@ -429,6 +847,16 @@ public:
  */
 class GraphReader {
 public:
+  // The first member of a tile extract may be an index with one of these for every tile so that
+  // the extract loads without walking the headers of the whole tar. The offset is where the data
+  // of the tile starts in the tar and the tile id is the value of the graph id of the tile
+  struct tile_index_entry {
+    uint64_t offset;
+    uint32_t tile_id;
+    uint32_t size;
+  };
+  static constexpr char kTileIndexName[] = "index.bin";
+
   /**
    * Constructor using tiles as separate files.
    * @param pt  Property tree listing the configuration for the tile storage
@@ -468,7 +896,22 @@ public:
    * @return graph_tile_ptr& reference to the tile parameter
    */
   graph_tile_ptr& GetGraphTile(const GraphId& graphid, graph_tile_ptr& tile) {
-    return !tile || tile->id() != graphid.Tile_Base() ? tile = GetGraphTile(graphid) : tile;
+    if (!tile) {
+      return tile = GetGraphTile(graphid);
+    }
+    const auto base = graphid.Tile_Base();
+    if (tile->id() == base) {
+      return tile;
+    }
+    // The views of the extract live as long as it does so they can point at each other, moving
+    // to a neighbouring tile is then a pointer chase instead of a lookup
+    if (!tile_extract_->views.empty()) {
+      if (const auto* linked = tile->links().find(base)) {
+        return tile = linked;
+      }
+      return tile = GetLinkedGraphTile(graphid, tile);
+    }
+    return tile = GetGraphTile(graphid);
   }
 
   /**
@@ -524,7 +967,53 @@ public:
   }
 
   /**
-   * Convenience method to get an opposing directed edge.
+   * Lets you know when the live traffic was replaced, anything derived from the tiles may have
+   * changed since
+   * @return a number which goes up every time a new traffic extract or tileset is swapped in and
+   *         shortly after speeds are written into the current traffic extract
+   */
+  uint64_t TrafficGeneration() const {
+    return tile_extract_->traffic_generation.load(std::memory_order_acquire) +
+           tile_extract_->traffic_updates.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Lets you know if live traffic was loaded, speeds from it may change at any time
+   * @return true if the traffic extract has any tiles
+   */
+  bool HasLiveTraffic() const {
+    return !tile_extract_->traffic()->tiles.empty();
+  }
+
+  /**
+   * Lets you know when the reader switched to a new tileset, anything made from the files next to
+   * the tiles (hierarchies, landmarks, reach and so on) should then be made again
+   * @return a number which goes up with every tileset ReloadTileset loads
+   */
+  uint64_t TilesetGeneration() const {
+    return tile_extract_->tileset_generation;
+  }
+
+  /**
+   * Loads the tiles at the configured tile_extract or tile_dir again, eg once a new build was
+   * renamed over the old one. The extract is mapped, and warmed up if warm_up is on, on the
+   * calling thread. Only then is it handed to the readers, which switch to it the next time they
+   * Refresh. The old tiles stay mapped until the last reader using them has switched.
+   * @param  pt  the mjolnir config
+   */
+  static void ReloadTileset(const boost::property_tree::ptree& pt);
+
+  /**
+   * Switches to the tileset ReloadTileset loaded last if it is newer than the one the reader uses.
+   * The cache is dropped along with the opposing edges and recovered shortcuts, which are mapped
+   * again from the new files. This is for between requests, a request should not see two tilesets.
+   * @return true if the reader switched
+   */
+  bool Refresh();
+
+  /**
+   * Convenience method to get an opposing directed edge. No tile is looked at if the opposing
+   * edges were stored by mjolnir and opposing_edges is on.
    * @param  edgeid  Graph Id of the directed edge.
    * @return  Returns the graph Id of the opposing directed edge. An
    *          invalid graph Id is returned if the opposing edge does not
@@ -532,6 +1021,10 @@ public:
    *          is missing).
    */
   GraphId GetOpposingEdgeId(const GraphId& edgeid) {
+    GraphId opp_edgeid;
+    if (opposing_edges_ && opposing_edges_->Find(edgeid, opp_edgeid)) {
+      return opp_edgeid;
+    }
     graph_tile_ptr NO_TILE = nullptr;
     return GetOpposingEdgeId(edgeid, NO_TILE);
   }
@@ -676,7 +1169,8 @@ public:
   GraphId GetShortcut(const GraphId& edgeid);
 
   /**
-   * Recovers the edges comprising a shortcut edge.
+   * Recovers the edges comprising a shortcut edge. They are only unpacked from the file if
+   * mjolnir recovered the shortcuts and shortcut_recovery is on.
    * @param  shortcutid  Graph Id of the shortcut edge.
    * @return Returns the edgeids of the directed edges this shortcut represents.
    */
@@ -853,6 +1347,17 @@ public:
    */
   std::unordered_set<GraphId> GetTileSet() const;
 
+  /**
+   * Pulls the tiles into memory ahead of the first requests so they dont have to wait on the disk.
+   * The tiles of the extract are madvised and touched, otherwise the files in the tile_dir are read
+   * so that they end up in the page cache, which every process on the host shares. The tiles can
+   * be limited with warm_up_bbox (min_x,min_y,max_x,max_y) and warm_up_levels, warm_up_threads
+   * says how many threads to do it with. Progress is logged as it goes.
+   * @param  pt  the mjolnir config
+   * @return the number of tiles that were warmed up
+   */
+  size_t WarmUp(const boost::property_tree::ptree& pt);
+
   /**
    * Gets back a set of available tiles on the specified level
    * @param  level  Level to get tile set.
@@ -886,6 +1391,63 @@ public:
    */
   int GetTimezone(const baldr::GraphId& node, graph_tile_ptr& tile);
 
+  /**
+   * Asks for a tile to be loaded in the background so that a later GetGraphTile finds it ready.
+   * Does nothing unless prefetch_threads is configured or if the tile is already cached.
+   * @param graphid  the graphid of the tile
+   */
+  void Prefetch(const GraphId& graphid);
+
+  /**
+   * Asks for a tile and the 8 tiles surrounding it on its level to be loaded in the background.
+   * Useful to call as a search frontier moves into a new tile.
+   * @param graphid  the graphid of the tile
+   */
+  void PrefetchNeighbors(const GraphId& graphid);
+
+  /**
+   * Fetches all of the given tiles from the tile_url at once and puts them into the cache, which
+   * is a lot faster than letting GetGraphTile fetch them one at a time on a cold start. Tiles that
+   * are already in the cache or on disk are skipped.
+   * @param tile_ids  the tiles to fetch, eg all the tiles along a corridor
+   * @return the number of tiles that were fetched
+   */
+  size_t FetchTiles(const std::vector<GraphId>& tile_ids);
+
+  /**
+   * Fetches all of the tiles on every level which intersect the bounding box
+   * @param bbox  the area to fetch
+   * @return the number of tiles that were fetched
+   */
+  size_t FetchTiles(const midgard::AABB2<midgard::PointLL>& bbox) {
+    return FetchTiles(TileHierarchy::GetGraphIds(bbox));
+  }
+
+  /**
+   * Counters for the background tile loading
+   */
+  struct PrefetchStats {
+    uint64_t requested; // tiles queued for loading
+    uint64_t loaded;    // tiles that were loaded in the background
+    uint64_t hits;      // cache misses that were served by a prefetched tile
+    uint64_t misses;    // cache misses that still loaded the tile in place
+    uint64_t waits;     // cache misses that waited for the tile already being loaded
+  };
+
+  /**
+   * Returns the prefetch counters, all 0 if prefetching is disabled
+   * @return the counters
+   */
+  PrefetchStats GetPrefetchStats() const;
+
+  /**
+   * Returns the tile cache counters, for comparing cache policies
+   * @return the counters
+   */
+  TileCache::Stats GetCacheStats() const {
+    return cache_->GetStats();
+  }
+
   /**
    * Returns an incident tile for the given tile id
    * @param tile_id  the tile id for which incidents should be returned
@@ -907,21 +1469,88 @@ protected:
     tile_extract_t(const boost::property_tree::ptree& pt);
     // TODO: dont remove constness, and actually make graphtile read only?
     std::unordered_map<uint64_t, std::pair<char*, size_t>> tiles;
-    std::unordered_map<uint64_t, std::pair<char*, size_t>> traffic_tiles;
     std::shared_ptr<midgard::tar> archive;
-    std::shared_ptr<midgard::tar> traffic_archive;
+
+    // (Tar) extract of live traffic tiles, which can be replaced while the readers are running
+    struct traffic_extract_t {
+      traffic_extract_t(const std::string& traffic_extract);
+      /**
+       * Adds up when and how often each tile was last written, which changes whenever speeds are
+       * written into the extract in place
+       * @return the sum, 0 without traffic
+       */
+      uint64_t updates() const;
+      std::unordered_map<uint64_t, std::pair<char*, size_t>> tiles;
+      std::shared_ptr<midgard::tar> archive;
+    };
+    // The current traffic, only ever touched with std::atomic_load/store. Anything made from an
+    // older one keeps its archive mapped until the last tile using it goes away
+    std::shared_ptr<const traffic_extract_t> current_traffic;
+    // Bumped every time a new traffic extract is swapped in so readers know to drop their tiles
+    std::atomic<uint64_t> traffic_generation;
+    // Bumped when speeds were written into the current traffic in place, the tiles see them
+    // already but whatever was worked out from the old speeds has to go
+    std::atomic<uint64_t> traffic_updates;
+
+    inline std::shared_ptr<const traffic_extract_t> traffic() const {
+      return std::atomic_load(&current_traffic);
+    }
+    /**
+     * Polls the traffic extract in the background for speeds written into it in place and swaps
+     * in the new one when it is replaced on disk, eg by writing a new tar and renaming it over
+     * the old one
+     * @param extract        the extract to update, the thread stops once it goes away
+     * @param path           the traffic extract to watch
+     * @param poll_interval  how often to look for new speeds or a new file
+     * @param reload         whether to swap in a new file or only look for new speeds
+     */
+    static void watch_traffic(std::weak_ptr<tile_extract_t> extract,
+                              std::string path,
+                              std::chrono::milliseconds poll_interval,
+                              const bool reload);
+    /**
+     * Loads the extract and starts watching its traffic, for new files too if
+     * traffic_extract_poll_interval is set
+     * @param pt  the mjolnir config
+     * @return the extract
+     */
+    static std::shared_ptr<tile_extract_t> create(const boost::property_tree::ptree& pt);
+
+    // Immutable tiles over the whole extract, only filled if tile_extract_views is on. They are
+    // shared by every reader so it requires thread safe reference counting of the tiles
+    std::vector<graph_tile_ptr> views;
+    // Indices into the views, laid out by level and tile id like in FlatTileCache
+    std::vector<uint32_t> view_indices;
+    std::array<uint32_t, 8> view_offsets;
+
+    inline uint32_t view_offset(const GraphId& graphid) const {
+      return graphid.level() < 4 ? view_offsets[graphid.level()] + graphid.tileid()
+                                 : view_indices.size();
+    }
+    graph_tile_ptr view(const GraphId& base) const;
+
+    // Which of the tilesets loaded by this process it is, 0 for the first
+    uint64_t tileset_generation = 0;
   };
   std::shared_ptr<const tile_extract_t> tile_extract_;
   static std::shared_ptr<const GraphReader::tile_extract_t>
   get_extract_instance(const boost::property_tree::ptree& pt);
+  // The tileset new readers start with and old ones Refresh to, only touched with
+  // std::atomic_load/store
+  static std::shared_ptr<const tile_extract_t> current_extract_;
 
   // Information about where the tiles are kept
   const std::string tile_dir_;
+  const bool tile_dir_mmap_;
+  // The traffic extract generation the tiles in our cache were made with
+  uint64_t traffic_generation_;
 
   // Stuff for getting at remote tiles
   std::unique_ptr<tile_getter_t> tile_getter_;
   const size_t max_concurrent_users_;
   const std::string tile_url_;
+  // What to make a new cache from when moving on to a new tileset
+  const boost::property_tree::ptree cache_config_;
 
   std::mutex _404s_lock;
   std::unordered_set<GraphId> _404s;
@@ -929,6 +1558,37 @@ protected:
   std::unique_ptr<TileCache> cache_;
 
   bool enable_incidents_;
+
+  // The opposing edges stored by mjolnir, if they are to be used
+  std::shared_ptr<const OpposingEdges> opposing_edges_;
+  // The shortcuts recovered by mjolnir, if they are to be used
+  std::shared_ptr<const RecoveredShortcuts> recovered_shortcuts_;
+
+  /**
+   * Loads a tile from disk or the tile url without looking at or filling the cache.
+   * @param base  the graphid of the tile
+   * @return the tile or nullptr if it couldnt be found
+   */
+  graph_tile_ptr LoadGraphTile(const GraphId& base);
+
+  /**
+   * Gets a view of the extract and links the tile it was moved to from to it, if that one is a
+   * view of the extract too
+   * @param graphid  the graphid of the tile
+   * @param from     the tile it was moved to from
+   * @return the tile
+   */
+  graph_tile_ptr GetLinkedGraphTile(const GraphId& graphid, const graph_tile_ptr& from);
+
+  /**
+   * Pulls a single tile into memory, thread safe because it doesnt touch the cache
+   * @param base  the graphid of the tile
+   * @return whether or not the tile was found
+   */
+  bool WarmUpTile(const GraphId& base) const;
+
+  // Loads tiles in the background, declared last so its threads stop before anything they use
+  std::shared_ptr<tile_prefetcher_t> prefetcher_;
 };
 
 // Given the Location relation, return the full metadata
@@ -6,7 +6,9 @@
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/datetime.h>
 #include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/edgebounds.h>
 #include <valhalla/baldr/edgeinfo.h>
+#include <valhalla/baldr/elevationprofiles.h>
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphmemory.h>
@@ -24,6 +26,7 @@
 #include <valhalla/baldr/transitschedule.h>
 #include <valhalla/baldr/transitstop.h>
 #include <valhalla/baldr/transittransfer.h>
+#include <valhalla/baldr/truckrestrictions.h>
 #include <valhalla/baldr/turnlanes.h>
 
 #include <valhalla/midgard/aabb2.h>
@@ -32,9 +35,14 @@
 
 #include <valhalla/filesystem.h>
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace valhalla {
 namespace baldr {
@@ -48,6 +56,243 @@ using GraphTileRefCounter = boost::thread_safe_counter;
 using GraphTileRefCounter = boost::thread_unsafe_counter;
 #endif // ENABLE_THREAD_SAFE_TILE_REF_COUNT
 
+/**
+ * The complex restrictions of a tile which end (forward) or start (reverse) on an edge and apply
+ * to some of the access modes, in the order they are in the tile. It points into an index of the
+ * tile and the restrictions themselves, so finding them neither goes through all of the
+ * restrictions of the tile nor allocates. Valid as long as the tile is.
+ */
+class ComplexRestrictionRange {
+public:
+  // The index of the restrictions of one direction of a tile is sorted by the edge
+  struct entry_t {
+    uint64_t edge;
+    uint32_t offset;
+    uint32_t modes;
+  };
+
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ComplexRestriction*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = ComplexRestriction**;
+    using reference = ComplexRestriction*;
+
+    iterator(const entry_t* entry, const entry_t* end, char* restrictions, uint64_t modes)
+        : entry_(entry), end_(end), restrictions_(restrictions), modes_(modes) {
+      skip();
+    }
+    ComplexRestriction* operator*() const {
+      return reinterpret_cast<ComplexRestriction*>(restrictions_ + entry_->offset);
+    }
+    iterator& operator++() {
+      ++entry_;
+      skip();
+      return *this;
+    }
+    iterator operator++(int) {
+      auto before = *this;
+      ++*this;
+      return before;
+    }
+    bool operator==(const iterator& other) const {
+      return entry_ == other.entry_;
+    }
+    bool operator!=(const iterator& other) const {
+      return entry_ != other.entry_;
+    }
+
+  protected:
+    // past the restrictions which dont apply to any of the modes
+    void skip() {
+      while (entry_ != end_ && !(entry_->modes & modes_)) {
+        ++entry_;
+      }
+    }
+
+    const entry_t* entry_;
+    const entry_t* end_;
+    char* restrictions_;
+    uint64_t modes_;
+  };
+
+  ComplexRestrictionRange() : ComplexRestrictionRange(nullptr, nullptr, nullptr, 0) {
+  }
+  ComplexRestrictionRange(const entry_t* first,
+                          const entry_t* last,
+                          char* restrictions,
+                          uint64_t modes)
+      : first_(first), last_(last), restrictions_(restrictions), modes_(modes) {
+  }
+
+  iterator begin() const {
+    return iterator(first_, last_, restrictions_, modes_);
+  }
+  iterator end() const {
+    return iterator(last_, last_, restrictions_, modes_);
+  }
+  bool empty() const {
+    return begin() == end();
+  }
+  size_t size() const {
+    return std::distance(begin(), end());
+  }
+  ComplexRestriction* front() const {
+    return *begin();
+  }
+
+protected:
+  const entry_t* first_;
+  const entry_t* last_;
+  char* restrictions_;
+  uint64_t modes_;
+};
+
+/**
+ * The access restrictions of an edge which apply to any of the given modes, straight out of the
+ * tile rather than copied into a vector.
+ */
+class AccessRestrictionRange {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = AccessRestriction;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const AccessRestriction*;
+    using reference = const AccessRestriction&;
+
+    iterator(const AccessRestriction* restriction, const AccessRestriction* end, uint32_t modes)
+        : restriction_(restriction), end_(end), modes_(modes) {
+      skip();
+    }
+    const AccessRestriction& operator*() const {
+      return *restriction_;
+    }
+    const AccessRestriction* operator->() const {
+      return restriction_;
+    }
+    iterator& operator++() {
+      ++restriction_;
+      skip();
+      return *this;
+    }
+    iterator operator++(int) {
+      auto before = *this;
+      ++*this;
+      return before;
+    }
+    bool operator==(const iterator& other) const {
+      return restriction_ == other.restriction_;
+    }
+    bool operator!=(const iterator& other) const {
+      return restriction_ != other.restriction_;
+    }
+
+  protected:
+    // past the restrictions which dont apply to any of the modes
+    void skip() {
+      while (restriction_ != end_ && !(restriction_->modes() & modes_)) {
+        ++restriction_;
+      }
+    }
+
+    const AccessRestriction* restriction_;
+    const AccessRestriction* end_;
+    uint32_t modes_;
+  };
+
+  AccessRestrictionRange() : AccessRestrictionRange(nullptr, nullptr, 0) {
+  }
+  AccessRestrictionRange(const AccessRestriction* first,
+                         const AccessRestriction* last,
+                         uint32_t modes)
+      : first_(first), last_(last), modes_(modes) {
+  }
+
+  iterator begin() const {
+    return iterator(first_, last_, modes_);
+  }
+  iterator end() const {
+    return iterator(last_, last_, modes_);
+  }
+  bool empty() const {
+    return begin() == end();
+  }
+  size_t size() const {
+    return std::distance(begin(), end());
+  }
+  /**
+   * @param  index  which of the restrictions that apply to the modes
+   * @return the restriction, the caller makes sure there are that many
+   */
+  const AccessRestriction& operator[](size_t index) const {
+    return *std::next(begin(), index);
+  }
+
+protected:
+  const AccessRestriction* first_;
+  const AccessRestriction* last_;
+  uint32_t modes_;
+};
+
+class GraphTile;
+
+/**
+ * Lazily resolved links from a tile to the tiles it is usually left for: its neighbours on its
+ * level and the tiles its node transitions lead to. A link is a plain pointer without a reference
+ * so it may only be made to a tile that lives at least as long as the one holding it, like the
+ * views over a tile extract that all live as long as the extract does. The slots are direct mapped
+ * by tile id and a link is checked against the id of the tile it points to, so a slot taken by
+ * another tile is just a miss. Thread safe as tiles may be shared by all of the readers.
+ */
+class TileLinks {
+public:
+  static constexpr uint32_t kSlotCount = 16;
+
+  TileLinks() {
+    clear();
+  }
+
+  // The links are not carried over when a tile is moved, they start over
+  TileLinks(const TileLinks&) : TileLinks() {
+  }
+  TileLinks& operator=(const TileLinks&) {
+    clear();
+    return *this;
+  }
+
+  /**
+   * Finds the tile linked to for a tile id.
+   * @param  base  the id of the tile
+   * @return the tile or nullptr if it was not linked to (yet)
+   */
+  inline const GraphTile* find(const GraphId& base) const;
+
+  /**
+   * Links to a tile, in place of whichever tile had its slot.
+   * @param  tile  the tile, it has to outlive the tile holding the links
+   */
+  inline void link(const GraphTile* tile) const;
+
+  /**
+   * Drops all of the links.
+   */
+  void clear() const {
+    for (auto& slot : slots_) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+protected:
+  static uint32_t slot(const GraphId& base) {
+    return static_cast<uint32_t>((base.value * 0x9E3779B97F4A7C15ull) >> 60);
+  }
+
+  mutable std::array<std::atomic<const GraphTile*>, kSlotCount> slots_;
+};
+
 class tile_getter_t;
 /**
  * Graph information for a tile within the Tiled Hierarchical Graph.
@@ -61,11 +306,14 @@ public:
    * into memory.
    * @param  tile_dir   Tile directory.
    * @param  graphid    GraphId (tileid and level)
+   * @param  traffic_memory  Optional memory holding the traffic for the tile
+   * @param  mmap_tile  Map an uncompressed tile file read only instead of copying it into memory
    * @return nullptr if the tile could not be loaded. may throw
    */
   static graph_tile_ptr Create(const std::string& tile_dir,
                                const GraphId& graphid,
-                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
+                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr,
+                               bool mmap_tile = false);
 
   /**
    * Constructs with a given the graph Id, pointer to the tile data, and the
@@ -99,6 +347,31 @@ public:
                                      tile_getter_t* tile_getter,
                                      const std::string& cache_location);
 
+  /**
+   * Constructs tiles given a url for the tiles, all of the tiles are requested at once
+   * @param  tile_url URL of tile
+   * @param  graphids Tile Ids
+   * @param  tile_getter object that will handle tile downloading
+   * @param  cache_location where to cache the tiles on disk, empty to skip it
+   * @return the tiles in the same order as the ids, nullptr for the ones we couldnt get
+   */
+  static std::vector<graph_tile_ptr> CacheTileURLs(const std::string& tile_url,
+                                                   const std::vector<GraphId>& graphids,
+                                                   tile_getter_t* tile_getter,
+                                                   const std::string& cache_location);
+
+  /**
+   * Packs a tile into a compact tile. The fixed size records and the predicted speeds stay as
+   * they are so that the hot paths read them straight from the tile while the complex
+   * restrictions, edge info, text list and lane connectivity are each deflated on their own and
+   * only inflated the first time they are used.
+   * @param  tile   the bytes of a tile, it is given back as it is if its already compact or if
+   *                compacting it wouldnt make it any smaller
+   * @param  level  the zlib compression level, from 1 for the fastest to 9 for the smallest
+   * @return the bytes of the compact tile
+   */
+  static std::vector<char> CompactTile(const std::vector<char>& tile, int level = 9);
+
   /**
    * Construct a tile given a url for the tile using curl
    * @param  tile_data graph tile raw bytes
@@ -143,6 +416,14 @@ public:
     return header_->graphid();
   }
 
+  /**
+   * Gets the links to the tiles this one is usually left for.
+   * @return  Returns the links, only ever filled in by the graph reader
+   */
+  const TileLinks& links() const {
+    return links_;
+  }
+
   /**
    * Gets a pointer to the graph tile header.
    * @return  Returns the header for the graph tile.
@@ -327,14 +608,15 @@ public:
   EdgeInfo edgeinfo(const size_t offset) const;
 
   /**
-   * Get the complex restrictions in the forward or reverse order.
+   * Get the complex restrictions in the forward or reverse order. They are found through an
+   * index of the restrictions of the tile which is made the first time any are asked for.
    * @param   forward - do we want the restrictions in reverse order?
    * @param   id - edge id
    * @param   modes - access modes
-   * @return  Returns the vector of complex restrictions in the order requested
+   * @return  Returns the complex restrictions in the order requested
    *          based on the id and modes.
    */
-  std::vector<ComplexRestriction*>
+  ComplexRestrictionRange
   GetRestrictions(const bool forward, const GraphId id, const uint64_t modes) const;
 
   /**
@@ -400,7 +682,8 @@ public:
 
   /**
    * Get the next departure given the directed edge Id and the current
-   * time (seconds from midnight). TODO - what if crosses midnight?
+   * time (seconds from midnight), the one leaving the earliest of those
+   * running that day. TODO - what if crosses midnight?
    * @param   lineid            Transit Line Id
    * @param   current_time      Current time (seconds from midnight).
    * @param   day               Days since the tile creation date.
@@ -433,11 +716,21 @@ public:
                                               const uint32_t current_time) const;
 
   /**
-   * Get the departures based on the line Id
+   * Get the departures based on the line Id, rather use GetNextDeparture or GetTransitDeparture to
+   * find departures as this builds the map on every call.
    * @return  Returns a map of lineids to departures.
    */
   std::unordered_map<uint32_t, TransitDeparture*> GetTransitDepartures() const;
 
+  /**
+   * Get an iterable set of all the departures in this tile, sorted by line Id and then by
+   * departure time
+   * @return returns an iterable collection of transit departures
+   */
+  midgard::iterable_t<const TransitDeparture> GetDepartures() const {
+    return midgard::iterable_t<const TransitDeparture>{departures_, header_->departurecount()};
+  }
+
   /**
    * Get the stop onestop Ids in this tile.
    * @return  Returns a map of transit stops with onestop Ids as the key and
@@ -493,6 +786,17 @@ public:
   std::vector<AccessRestriction> GetAccessRestrictions(const uint32_t edgeid,
                                                        const uint32_t access) const;
 
+  /**
+   * Gets the access restrictions for an edge without copying them out of the tile, for the
+   * places that look at them for every edge they expand like costing.
+   * @param   edgeid  Directed edge Id.
+   * @param   access  Access.  Used to obtain the restrictions for the access
+   *                   that we are interested in (see graphconstants.h)
+   * @return  Returns a range over the AccessRestrictions, valid as long as the tile is.
+   */
+  AccessRestrictionRange GetAccessRestrictionRange(const uint32_t edgeid,
+                                                   const uint32_t access) const;
+
   /**
    * Get an iteratable list of GraphIds given a bin in the tile
    * @param  column the bin's column
@@ -508,6 +812,26 @@ public:
    */
   midgard::iterable_t<GraphId> GetBin(size_t index) const;
 
+  /**
+   * Get the bounding box of the shape of a directed edge without decoding the shape.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return the box holding the whole shape of the edge, the whole world if the tile has none
+   */
+  midgard::AABB2<midgard::PointLL> GetEdgeBounds(const uint32_t idx) const;
+
+  /**
+   * Get the summary of the truck access restrictions of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return the summary or nullptr if the tile has none, in which case the restrictions of the
+   *         edge have to be looked at one by one
+   */
+  const TruckRestrictions* GetTruckRestrictions(const uint32_t idx) const {
+    if (truck_restrictions_ == nullptr || idx >= header_->directededgecount()) {
+      return nullptr;
+    }
+    return truck_restrictions_ + idx;
+  }
+
   /**
    * Get lane connections ending on this edge.
    * @param  idx  GraphId of the directed edge.
@@ -515,6 +839,31 @@ public:
    */
   std::vector<LaneConnectivity> GetLaneConnectivity(const uint32_t idx) const;
 
+  /**
+   * Get lane connections ending on this edge without copying them out of the tile.
+   * @param  idx  GraphId of the directed edge.
+   * @return  Returns the lane connections ending on this edge, valid as long as the tile is.
+   */
+  midgard::iterable_t<const LaneConnectivity> GetLaneConnectivityRange(const uint32_t idx) const;
+
+  /**
+   * Get the heights along a directed edge, stored in the tile when the elevation was added so
+   * that no elevation data is needed to serve them.
+   * @param  de  Directed edge.
+   * @return the heights evenly spaced from the start of the edge to its end in meters, none if
+   *         the tile or the edge has no elevation profile
+   */
+  std::vector<float> GetElevationProfile(const DirectedEdge* de) const;
+
+  /**
+   * Get the compressed predicted speed profile of a directed edge.
+   * @param  de  Directed edge, which has to have a predicted speed.
+   * @return the kCoefficientCount coefficients of the profile
+   */
+  const int16_t* GetPredictedSpeedProfile(const DirectedEdge* de) const {
+    return predictedspeeds_.profile(de - directededges_);
+  }
+
   /**
    * Convenience method for use with costing to get the speed for an edge given the directed
    * edge and a time (seconds since start of the week). If the current speed of the edge
@@ -549,7 +898,7 @@ public:
     float partial_live_pct = 0;
     if ((flow_mask & kCurrentFlowMask) && traffic_tile()) {
       auto directed_edge_index = std::distance(const_cast<const DirectedEdge*>(directededges_), de);
-      auto volatile& live_speed = traffic_tile.trafficspeed(directed_edge_index);
+      const auto live_speed = traffic_tile.load_trafficspeed(directed_edge_index);
       // only use current speed if its valid and non zero, a speed of 0 makes costing values crazy
       if (live_speed.valid() && (partial_live_speed = live_speed.get_overall_speed()) > 0) {
         *flow_sources |= kCurrentFlowMask;
@@ -636,6 +985,16 @@ public:
     return traffic_tile.trafficspeed(directed_edge_index);
   }
 
+  /**
+   * The live speed of an edge read all at once, see TrafficTile::load_trafficspeed.
+   * @param de  the directed edge of this tile
+   * @return a copy of the speed record
+   */
+  inline TrafficSpeed load_trafficspeed(const DirectedEdge* de) const {
+    auto directed_edge_index = std::distance(const_cast<const DirectedEdge*>(directededges_), de);
+    return traffic_tile.load_trafficspeed(directed_edge_index);
+  }
+
   /**
    * Convenience method to get the turn lanes for an edge given the directed edge index.
    * @param  idx  Directed edge index. Used to lookup turn lanes.
@@ -643,7 +1002,11 @@ public:
    */
   std::vector<uint16_t> turnlanes(const uint32_t idx) const {
     uint32_t offset = turnlanes_offset(idx);
-    return (offset > 0) ? TurnLanes::lanemasks(textlist_ + offset) : std::vector<uint16_t>();
+    if (offset == 0) {
+      return {};
+    }
+    inflate_section(kTextListSection);
+    return TurnLanes::lanemasks(textlist_ + offset);
   }
 
   /**
@@ -665,8 +1028,8 @@ public:
    * @return      whether or not its closed
    */
   inline bool IsClosed(const DirectedEdge* edge) const {
-    auto volatile& live_speed =
-        traffic_tile.trafficspeed(static_cast<uint32_t>(edge - directededges_));
+    const auto live_speed =
+        traffic_tile.load_trafficspeed(static_cast<uint32_t>(edge - directededges_));
     return live_speed.closed();
   }
 
@@ -698,6 +1061,9 @@ protected:
   // Access restrictions, 1 or more per edge id
   AccessRestriction* access_restrictions_{};
 
+  // Summaries of the truck access restrictions, one per directed edge if there are any
+  const TruckRestrictions* truck_restrictions_{};
+
   // Transit departures, many per index (indexed by directed edge index and
   // sorted by departure time)
   TransitDeparture* departures_{};
@@ -724,28 +1090,89 @@ protected:
   // indexed directly.
   Admin* admins_{};
 
+  // The variable size sections which a compact tile deflates, each on its own
+  enum CompressedSection : uint8_t {
+    kRestrictionSection = 0,
+    kEdgeInfoSection = 1,
+    kTextListSection = 2,
+    kLaneConnectivitySection = 3,
+    kCompressedSectionCount = 4
+  };
+
+  // Where the deflated sections of a compact tile are and what they are once inflated
+  struct compressed_sections_t {
+    const char* deflated[kCompressedSectionCount];
+    uint32_t deflated_size[kCompressedSectionCount];
+    std::vector<char> inflated[kCompressedSectionCount];
+    std::once_flag once[kCompressedSectionCount];
+  };
+
+  // Only there for compact tiles
+  std::unique_ptr<compressed_sections_t> compressed_sections_;
+
+  // The restrictions of each direction sorted by the edge, made on first use
+  struct restriction_index_t {
+    std::vector<ComplexRestrictionRange::entry_t> forward;
+    std::vector<ComplexRestrictionRange::entry_t> reverse;
+    std::once_flag once;
+  };
+
+  // Only there if the tile has restrictions
+  std::unique_ptr<restriction_index_t> restriction_index_;
+
+  // The departures of each line, made on first use. The fixed departures of a line are in the
+  // order they leave with the days they run on next to their times so finding the next one that
+  // runs only walks these arrays. Frequency based ones are few and are looked at one by one.
+  struct departure_index_t {
+    struct line_t {
+      uint32_t lineid;
+      uint32_t first;
+      uint32_t first_fixed;
+      uint32_t fixed_count;
+      uint32_t first_frequency;
+      uint32_t frequency_count;
+    };
+    std::vector<line_t> lines;
+    // the fixed departures, the index of each in the tile and when and on which days it runs
+    std::vector<uint32_t> fixed;
+    std::vector<uint32_t> fixed_times;
+    std::vector<uint64_t> fixed_days;
+    std::vector<uint8_t> fixed_end_days;
+    std::vector<uint8_t> fixed_days_of_week;
+    std::vector<uint8_t> fixed_access;
+    // the index of each frequency based departure in the tile
+    std::vector<uint32_t> frequency;
+    std::once_flag once;
+  };
+
+  // Only there if the tile has departures
+  std::unique_ptr<departure_index_t> departure_index_;
+
+  // The pointers to the compressed sections of a compact tile are only set once they are
+  // inflated, which is on first use and so from const accessors
+
   // List of complex_restrictions in the forward direction.
-  char* complex_restriction_forward_{};
+  mutable char* complex_restriction_forward_{};
 
   // Size of the complex restrictions in the forward direction
   std::size_t complex_restriction_forward_size_{};
 
   // List of complex_restrictions in the reverse direction.
-  char* complex_restriction_reverse_{};
+  mutable char* complex_restriction_reverse_{};
 
   // Size of the complex restrictions in the reverse direction
   std::size_t complex_restriction_reverse_size_{};
 
   // List of edge info structures. Since edgeinfo is not fixed size we
   // use offsets in directed edges.
-  char* edgeinfo_{};
+  mutable char* edgeinfo_{};
 
   // Size of the edgeinfo data
   std::size_t edgeinfo_size_{};
 
   // Street names as sets of null-terminated char arrays. Edge info has
   // offsets into this array.
-  char* textlist_{};
+  mutable char* textlist_{};
 
   // Number of bytes in the text/name list
   std::size_t textlist_size_{};
@@ -754,8 +1181,11 @@ protected:
   // indices in the tile header.
   GraphId* edge_bins_{};
 
+  // Bounding boxes of the directed edges, one per directed edge if there are any.
+  const EdgeBounds* edge_bounds_{};
+
   // Lane connectivity data.
-  LaneConnectivity* lane_connectivity_{};
+  mutable LaneConnectivity* lane_connectivity_{};
 
   // Number of bytes in lane connectivity data.
   std::size_t lane_connectivity_size_{};
@@ -763,6 +1193,12 @@ protected:
   // Predicted speeds
   PredictedSpeeds predictedspeeds_;
 
+  // Elevation profiles of the edges
+  mutable ElevationProfiles elevation_profiles_;
+
+  // Number of bytes in the elevation profiles, the offsets included
+  std::size_t elevation_profiles_size_{};
+
   // Map of stop one stops in this tile.
   std::unordered_map<std::string, GraphId> stop_one_stops;
 
@@ -775,6 +1211,9 @@ protected:
   // Pointer to live traffic data (can be nullptr if not active)
   TrafficTile traffic_tile{nullptr};
 
+  // Links to the neighbouring tiles
+  TileLinks links_;
+
   // GraphTiles are noncopyable.
   GraphTile(const GraphTile&) = delete;
   GraphTile& operator=(const GraphTile&) = delete;
@@ -814,6 +1253,52 @@ protected:
    */
   void Initialize(const GraphId& graphid);
 
+  /**
+   * Inflates a section of a compact tile the first time it is needed, does nothing for other
+   * tiles. Safe to call from as many threads at once as there are.
+   * @param  section  the section
+   */
+  inline void inflate_section(const CompressedSection section) const {
+    if (compressed_sections_) {
+      std::call_once(compressed_sections_->once[section], &GraphTile::InflateSection, this,
+                     section);
+    }
+  }
+
+  /**
+   * Inflates every section of a compact tile, for when all of the tile is read anyway.
+   */
+  void inflate_sections() const;
+
+  /**
+   * Inflates a section of a compact tile and points at it.
+   * @param  section  the section
+   */
+  void InflateSection(const CompressedSection section) const;
+
+  /**
+   * Points at the elevation profiles, does nothing if the tile has none.
+   * @param  profiles  where the offsets of the profiles start
+   */
+  void SetElevationProfiles(const char* profiles) const;
+
+  /**
+   * Makes the index of the complex restrictions.
+   */
+  void IndexRestrictions() const;
+
+  /**
+   * Makes the index of the departures.
+   */
+  void IndexDepartures() const;
+
+  /**
+   * The departures of a line in the index.
+   * @param  lineid  Transit Line Id
+   * @return the line or nullptr if nothing departs along it
+   */
+  const departure_index_t::line_t* DepartureLine(const uint32_t lineid) const;
+
   /**
    * For transit tiles, save off the pair<tileid,lineid> lookup via
    * onestop_ids.  This will be used for including or excluding transit lines
@@ -831,7 +1316,29 @@ protected:
    *         the uncompressed data, or nullptr
    */
   static graph_tile_ptr DecompressTile(const GraphId& graphid, const std::vector<char>& compressed);
+
+  /**
+   * Turns the bytes fetched from a url into a tile and caches them to disk if wanted
+   * @param  graphid         the id of the tile that was fetched
+   * @param  bytes           the bytes that were fetched
+   * @param  gzipped         whether the bytes are compressed
+   * @param  cache_location  where to cache the tile on disk, empty to skip it
+   * @return the tile
+   */
+  static graph_tile_ptr CacheTileBytes(const GraphId& graphid,
+                                       std::vector<char>&& bytes,
+                                       bool gzipped,
+                                       const std::string& cache_location);
 };
 
+const GraphTile* TileLinks::find(const GraphId& base) const {
+  const auto* tile = slots_[slot(base)].load(std::memory_order_acquire);
+  return tile && tile->id() == base ? tile : nullptr;
+}
+
+void TileLinks::link(const GraphTile* tile) const {
+  slots_[slot(tile->id())].store(tile, std::memory_order_release);
+}
+
 } // namespace baldr
 } // namespace valhalla
@@ -17,7 +17,7 @@ namespace baldr {
 // something to the tile simply subtract one from this number and add it
 // just before the empty_slots_ array below. NOTE that it can ONLY be an
 // offset in bytes and NOT a bitfield or union or anything of that sort
-constexpr size_t kEmptySlots = 11;
+constexpr size_t kEmptySlots = 7;
 
 // Maximum size of the version string (stored as a fixed size
 // character array so the GraphTileHeader size remains fixed).
@@ -515,6 +515,13 @@ public:
    */
   std::pair<uint32_t, uint32_t> bin_offset(size_t index) const;
 
+  /**
+   * Gets which bins of the 5x5 grid have any edges in them, a coarse summary of the tile that
+   * lets a search skip the empty parts of the tile, or all of it, without looking at the bins.
+   * @return bit i is set if the bin with index i has edges
+   */
+  uint32_t occupied_bins() const;
+
   /**
    * Sets the edge bin offsets
    * @param offsets the offsets
@@ -569,6 +576,76 @@ public:
     predictedspeeds_offset_ = offset;
   }
 
+  /**
+   * Gets the offset to the table of compressed sections of a compact tile. The offsets of the
+   * sections are where they are once inflated, only the fixed size records and the predicted
+   * speeds are stored as they are. See GraphTile::CompactTile.
+   * @return the offset in bytes to the table or 0 if the tile isnt compact
+   */
+  uint32_t compressed_sections_offset() const {
+    return compact_ ? compressed_sections_offset_ : 0;
+  }
+
+  /**
+   * Sets the offset to the table of compressed sections of a compact tile.
+   * @param offset  the offset in bytes to the table or 0 if the tile isnt compact
+   */
+  void set_compressed_sections_offset(const uint32_t offset) {
+    compact_ = offset != 0;
+    compressed_sections_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the elevation profiles of the edges, which come right after the lane
+   * connectivity data.
+   * @return  Returns the offset in bytes to the elevation profiles or 0 if there are none.
+   */
+  uint32_t elevation_profiles_offset() const {
+    return elevation_profiles_offset_;
+  }
+
+  /**
+   * Sets the offset to the elevation profiles of the edges.
+   * @param offset Offset in bytes to the start of the elevation profiles, 0 if there are none.
+   */
+  void set_elevation_profiles_offset(const uint32_t offset) {
+    elevation_profiles_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the bounding boxes of the directed edges, which come right before the
+   * edge bins.
+   * @return  Returns the offset in bytes to the edge bounds or 0 if there are none.
+   */
+  uint32_t edge_bounds_offset() const {
+    return edge_bounds_offset_;
+  }
+
+  /**
+   * Sets the offset to the bounding boxes of the directed edges.
+   * @param offset Offset in bytes to the start of the edge bounds, 0 if there are none.
+   */
+  void set_edge_bounds_offset(const uint32_t offset) {
+    edge_bounds_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the truck restriction summaries of the directed edges, which come right
+   * after the access restrictions.
+   * @return  Returns the offset in bytes to the summaries or 0 if there are none.
+   */
+  uint32_t truck_restrictions_offset() const {
+    return truck_restrictions_offset_;
+  }
+
+  /**
+   * Sets the offset to the truck restriction summaries of the directed edges.
+   * @param offset Offset in bytes to the start of the summaries, 0 if there are none.
+   */
+  void set_truck_restrictions_offset(const uint32_t offset) {
+    truck_restrictions_offset_ = offset;
+  }
+
   /**
    * Get the offset to the end of the tile
    * @return the number of bytes in the tile, unless the last slot is used
@@ -659,7 +736,9 @@ protected:
   // the GraphTileHeader structure and order of data within the structure does not change
   // this should be backwards compatible. Make sure use of bits from spareword* does not
   // exceed 128 bits.
-  uint64_t spareword0_;
+  uint64_t compact_ : 1; // Whether the compressed sections offset is there, older tiles may
+                         // have something else in that slot
+  uint64_t spareword0_ : 63;
   uint64_t spareword1_;
 
   // Offsets to beginning of data (for variable size records)
@@ -680,9 +759,21 @@ protected:
   // Offset to the beginning of the predicted speed data
   uint32_t predictedspeeds_offset_;
 
-  // GraphTile data size in bytes
+  // GraphTile data size in bytes, for a compact tile once its sections are inflated
   uint32_t tile_size_;
 
+  // Offset to the table of compressed sections of a compact tile, 0 for others
+  uint32_t compressed_sections_offset_;
+
+  // Offset to the elevation profiles of the edges, 0 for tiles without them
+  uint32_t elevation_profiles_offset_;
+
+  // Offset to the bounding boxes of the directed edges, 0 for tiles without them
+  uint32_t edge_bounds_offset_;
+
+  // Offset to the truck restriction summaries of the edges, 0 for tiles without them
+  uint32_t truck_restrictions_offset_;
+
   // Marks the end of this version of the tile with the rest of the slots
   // being available for growth. If you want to use one of the empty slots,
   // simply add a uint32_t some_offset_; just above empty_slots_ and decrease
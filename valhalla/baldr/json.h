@@ -1,10 +1,12 @@
 #ifndef VALHALLA_BALDR_JSON_H_
 #define VALHALLA_BALDR_JSON_H_
 
+#include <algorithm>
 #include <boost/variant.hpp>
 #include <cinttypes>
 #include <cmath>
 #include <cstddef>
+#include <cstdio>
 #include <iomanip>
 #include <list>
 #include <memory>
@@ -155,6 +157,15 @@ inline std::ostream& operator<<(std::ostream& stream, const fp_t& fp) {
   return stream;
 }
 
+// appends the number to the text exactly the way it is streamed, for json which is written a
+// value at a time (a json::RawJSON for example) rather than built as a tree first
+inline void append(std::string& text, const fp_t& fp) {
+  char buffer[64];
+  int length = snprintf(buffer, sizeof(buffer), std::isfinite(fp.value) ? "%.*Lf" : "\"%.*Lf\"",
+                        static_cast<int>(fp.precision), fp.value);
+  text.append(buffer, std::min<size_t>(std::max(length, 0), sizeof(buffer) - 1));
+}
+
 template <typename Visitable>
 inline void applyOutputVisitor(std::ostream& stream, Visitable& visitable) {
   // Cannot use boost::apply_visitor with C++14 due to
@@ -1,6 +1,7 @@
 #ifndef VALHALLA_MIDGARD_OPENLR_H_
 #define VALHALLA_MIDGARD_OPENLR_H_
 
+#include <valhalla/baldr/graphid.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
 #include <valhalla/proto/trip.pb.h>
@@ -9,10 +10,17 @@
 #include <bitset>
 #include <numeric>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 namespace valhalla {
 namespace baldr {
+
+class GraphReader;
+
 namespace OpenLR {
 
 namespace {
@@ -448,6 +456,96 @@ struct OpenLr {
   SideOfTheRoad sideOfTheRoad;
 };
 
+// An edge of the graph a location reference covers and from where to where along it
+struct MatchedEdge {
+  GraphId edge;
+  float begin_pct;
+  float end_pct;
+};
+using MatchedPath = std::vector<MatchedEdge>;
+
+/**
+ * Finds the edges of the graph OpenLR line locations reference, following the decoder of the
+ * white paper, section 6: candidate edges near each location reference point are rated by their
+ * distance, bearing and functional road class, and the path between the points of consecutive ones
+ * is the one whose length is closest to the distance to the next point. The offsets are cut off
+ * the ends of the path. Only the line of point along line locations is matched.
+ *
+ * A matcher isnt thread safe, as the reader it is given isnt either.
+ */
+class Matcher {
+public:
+  /**
+   * Constructor.
+   * @param  reader       Graph reader to get the tiles from.
+   * @param  max_matched  How many matched references to remember at most, once there are that
+   *                      many they are all forgotten so that a long running matcher stays small.
+   */
+  explicit Matcher(GraphReader& reader, const size_t max_matched = 100000);
+
+  /**
+   * Matches a location reference to the graph.
+   * @param  reference  The decoded location reference.
+   * @return the edges it covers in order, empty if it couldnt be matched
+   */
+  MatchedPath Match(const OpenLr& reference);
+
+  /**
+   * Matches a base64 encoded location reference to the graph. The edges of up to max_matched
+   * references are remembered so identical references are only matched once.
+   * @param  reference  The base64 encoded location reference.
+   * @return the edges it covers in order, empty if it couldnt be matched or decoded. They are only
+   *         good until the next call matches a reference it doesnt remember.
+   */
+  const MatchedPath& Match(const std::string& reference);
+
+  /**
+   * Matches many base64 encoded location references at once. Every identical reference is matched
+   * once and the references are sorted by the tile of their first point, so that the threads each
+   * take runs of nearby references as they are done with their last ones.
+   * @param  pt           The ptree sub child labeled mjolnir in the valhalla json config.
+   * @param  references   The base64 encoded location references.
+   * @param  concurrency  How many threads to match them on.
+   * @return the edges of every distinct reference, empty if it couldnt be matched or decoded
+   */
+  static std::unordered_map<std::string, MatchedPath>
+  MatchAll(const boost::property_tree::ptree& pt,
+           const std::vector<std::string>& references,
+           size_t concurrency);
+
+  /**
+   * Forgets the references matched so far, as they are only good for as long as the graph is.
+   */
+  void Clear() {
+    matched_.clear();
+  }
+
+protected:
+  // An edge near a location reference point
+  struct Candidate {
+    GraphId edge;
+    float pct;
+    float length;
+    float score;
+  };
+
+  // The edges near a location reference point which fit it, best first
+  std::vector<Candidate> Candidates(const LocationReferencePoint& lrp, bool last);
+
+  // The path from the start to whichever of the targets is closest to the distance of the point
+  bool Route(const Candidate& start,
+             const std::vector<Candidate>& targets,
+             const LocationReferencePoint& lrp,
+             MatchedPath& path,
+             std::vector<float>& lengths,
+             size_t& target,
+             float& score);
+
+  GraphReader& reader_;
+  std::unordered_map<std::string, MatchedPath> matched_;
+  size_t max_matched_;
+};
+
 } // namespace OpenLR
 } // namespace baldr
 } // namespace valhalla
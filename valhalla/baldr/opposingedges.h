@@ -0,0 +1,108 @@
+#ifndef VALHALLA_BALDR_OPPOSINGEDGES_H_
+#define VALHALLA_BALDR_OPPOSINGEDGES_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/sidecar.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The opposing edge of every edge of the graph, so that it is known without reading the node at
+ * the end of the edge, or even the tile of the edge itself. Most edges end in their own tile, for
+ * those only the index of the opposing edge in the tile is kept. The few which leave their tile
+ * point into a table of the full ids of their opposing edges instead.
+ *
+ * The opposing edges of every level but transit are kept in one file in the tile_dir, which is
+ * memory mapped read only. It is only good for the tiles it was built from.
+ */
+class OpposingEdges {
+public:
+  // What is at the start of the file
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t spare;
+    uint64_t tile_count;
+    uint64_t edge_count;
+    uint64_t boundary_count;
+  };
+
+  // The edge has no opposing edge, it is a transit line or the tile it ends in is missing
+  static constexpr uint32_t kNone = 0xffffffff;
+  // The rest of the value is an index into the boundary edges rather than into the tile
+  static constexpr uint32_t kBoundary = 0x80000000;
+
+  /**
+   * Where the opposing edges live.
+   * @param  tile_dir  The tile directory.
+   * @return the path to the file
+   */
+  static std::string FileName(const std::string& tile_dir);
+
+  /**
+   * Writes the opposing edges to disk.
+   * @param  file_name  Where to write it.
+   * @param  tiles      The tiles the edges are in, sorted by their value.
+   * @param  offsets    Where the edges of each tile start in the opposing, in edges, with one more
+   *                    at the end for the total.
+   * @param  opposing   Per edge, the index of its opposing edge in the same tile, kNone or
+   *                    kBoundary with the index of it in the boundary edges.
+   * @param  boundary   The opposing edges which are in another tile than their edges.
+   */
+  static void Write(const std::string& file_name,
+                    const std::vector<GraphId>& tiles,
+                    const std::vector<uint64_t>& offsets,
+                    const std::vector<uint32_t>& opposing,
+                    const std::vector<GraphId>& boundary);
+
+  /**
+   * Maps the opposing edges from disk, throws if the file is missing or not opposing edges.
+   * @param  file_name  The file to map.
+   */
+  explicit OpposingEdges(const std::string& file_name);
+
+  OpposingEdges(const OpposingEdges&) = delete;
+  OpposingEdges& operator=(const OpposingEdges&) = delete;
+
+  /**
+   * Finds the opposing edge of an edge.
+   * @param  edge      The edge, at any level but transit.
+   * @param  opposing  The opposing edge, invalid if the edge has none.
+   * @return false if the edge is unknown, in which case the tiles have to be asked
+   */
+  bool Find(const GraphId& edge, GraphId& opposing) const;
+
+  /**
+   * @return how many edges there are opposing edges for
+   */
+  uint64_t edge_count() const {
+    return header_->edge_count;
+  }
+
+  /**
+   * @return how many of those have their opposing edge in another tile
+   */
+  uint64_t boundary_count() const {
+    return header_->boundary_count;
+  }
+
+protected:
+  // the mapped file
+  Sidecar file_;
+
+  const Header* header_;
+  const uint64_t* tiles_;
+  const uint64_t* offsets_;
+  const uint64_t* boundary_;
+  const uint32_t* opposing_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_OPPOSINGEDGES_H_
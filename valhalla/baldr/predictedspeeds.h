@@ -33,6 +33,16 @@ std::array<int16_t, kCoefficientCount> compress_speed_buckets(const float* speed
  */
 float decompress_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx);
 
+/**
+ * Recover speed value in the bucket like decompress_speed_bucket, but remember the last speeds
+ * recovered on this thread. Expansions keep costing the same edges at nearby times, which
+ * mostly fall in the same bucket.
+ * @param coefficients  Transformed speed buckets (must be 200 values).
+ * @param bucket_idx    Index of the bucket we want to recover.
+ * @return  Speed value (in KPH) in the bucket.
+ */
+float cached_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx);
+
 /**
  * Pack transformed speed values into base64-encoded string.
  * @param coefficients  Array of transformed speed buckets (must be 200 values).
@@ -58,6 +68,11 @@ public:
   PredictedSpeeds() : offset_(nullptr), profiles_(nullptr) {
   }
 
+  /**
+   * Destructor. Forgets the speeds any thread remembers, as their profiles go away.
+   */
+  ~PredictedSpeeds();
+
   /**
    * Set a pointer to the offset data within the GraphTile.
    * @param  offset Pointer to the offset array in the GraphTile.
@@ -87,7 +102,16 @@ public:
     // to DirectedEdge::has_predicted_speed being false.
     const int16_t* coefficients = profiles_ + offset_[idx];
 
-    return decompress_speed_bucket(coefficients, seconds_of_week / kSpeedBucketSizeSeconds);
+    return cached_speed_bucket(coefficients, seconds_of_week / kSpeedBucketSizeSeconds);
+  }
+
+  /**
+   * Get the compressed speed profile of an edge, kCoefficientCount coefficients.
+   * @param  idx  Directed edge index.
+   * @return the coefficients of the profile
+   */
+  const int16_t* profile(const uint32_t idx) const {
+    return profiles_ + offset_[idx];
   }
 
 protected:
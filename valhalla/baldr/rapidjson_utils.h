@@ -1,6 +1,7 @@
 #ifndef VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 #define VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 
+#include <cstring>
 #include <fstream>
 #include <istream>
 #include <locale>
@@ -48,12 +49,24 @@ inline std::string to_string(const rapidjson::Value& value, int decimal_places =
  * its not found
  */
 
+// finds the value at the path. Nearly every lookup is of a single member of an object and for
+// those we skip parsing the path into a json pointer, whose tokens are allocated on every call
+template <typename V>
+inline auto find_value(V&& v, const char* source)
+    -> decltype(rapidjson::Pointer{source}.Get(std::forward<V>(v))) {
+  if (source[0] == '/' && v.IsObject() && !std::strpbrk(source + 1, "/~")) {
+    auto member = v.FindMember(source + 1);
+    return member == v.MemberEnd() ? nullptr : &member->value;
+  }
+  return rapidjson::Pointer{source}.Get(std::forward<V>(v));
+}
+
 // if you dont want an arithmetic type dont try any lexical casting
 template <typename T, typename V>
 inline typename std::enable_if<!std::is_arithmetic<T>::value, boost::optional<T>>::type
 get_optional(V&& v, const char* source) {
   // if we dont have this key bail
-  auto* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  auto* ptr = find_value(std::forward<V>(v), source);
   if (!ptr) {
     return boost::none;
   }
@@ -70,7 +83,7 @@ template <typename T, typename V>
 inline typename std::enable_if<std::is_arithmetic<T>::value, boost::optional<T>>::type
 get_optional(V&& v, const char* source) {
   // if we dont have this key bail
-  auto* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  auto* ptr = find_value(std::forward<V>(v), source);
   if (!ptr) {
     return boost::none;
   }
@@ -125,7 +138,7 @@ template <typename T, typename V> inline T get(V&& v, const char* source) {
 }
 
 template <typename V> inline const rapidjson::Value& get_child(const V& v, const char* source) {
-  const rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(v);
+  const rapidjson::Value* ptr = find_value(v, source);
   if (!ptr) {
     throw std::runtime_error(std::string("No child: ") + source);
   }
@@ -133,7 +146,7 @@ template <typename V> inline const rapidjson::Value& get_child(const V& v, const
 }
 
 template <typename V> inline rapidjson::Value& get_child(V&& v, const char* source) {
-  rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  rapidjson::Value* ptr = find_value(std::forward<V>(v), source);
   if (!ptr) {
     throw std::runtime_error(std::string("No child: ") + source);
   }
@@ -143,7 +156,7 @@ template <typename V> inline rapidjson::Value& get_child(V&& v, const char* sour
 template <typename V>
 inline boost::optional<const rapidjson::Value&> get_child_optional(const V& v, const char* source) {
   boost::optional<const rapidjson::Value&> c;
-  const rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(v);
+  const rapidjson::Value* ptr = find_value(v, source);
   if (ptr) {
     c.reset(*ptr);
   }
@@ -153,7 +166,7 @@ inline boost::optional<const rapidjson::Value&> get_child_optional(const V& v, c
 template <typename V>
 inline boost::optional<rapidjson::Value&> get_child_optional(V&& v, const char* source) {
   boost::optional<rapidjson::Value&> c;
-  rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  rapidjson::Value* ptr = find_value(std::forward<V>(v), source);
   if (ptr) {
     c.reset(*ptr);
   }
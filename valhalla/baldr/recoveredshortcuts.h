@@ -0,0 +1,111 @@
+#ifndef VALHALLA_BALDR_RECOVEREDSHORTCUTS_H_
+#define VALHALLA_BALDR_RECOVEREDSHORTCUTS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/sidecar.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The edges every shortcut of the graph supersedes, recovered once by mjolnir rather than by every
+ * process that wants them. The shortcuts of each tile are sorted by their index, every one of them
+ * pointing at its edges packed as varints. Edges in the same tile as the one before them only
+ * keep the difference of their index to it, the rest keep their whole id. They are only unpacked
+ * when asked for.
+ *
+ * The shortcuts of every level are kept in one file in the tile_dir, which is memory mapped read
+ * only so that all the processes on a machine share it. It is only good for the tiles it was built
+ * from.
+ */
+class RecoveredShortcuts {
+public:
+  // What is at the start of the file
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t spare;
+    uint64_t tile_count;
+    uint64_t shortcut_count;
+    uint64_t data_size;
+  };
+
+  /**
+   * Where the recovered shortcuts live.
+   * @param  tile_dir  The tile directory.
+   * @return the path to the file
+   */
+  static std::string FileName(const std::string& tile_dir);
+
+  /**
+   * Packs the edges of a shortcut.
+   * @param  shortcut  The shortcut.
+   * @param  edges     The edges it supersedes in order, only the shortcut itself if it couldnt be
+   *                   recovered.
+   * @param  data      Where the packed edges are appended.
+   */
+  static void Pack(const GraphId& shortcut,
+                   const std::vector<GraphId>& edges,
+                   std::vector<uint8_t>& data);
+
+  /**
+   * Writes the recovered shortcuts to disk.
+   * @param  file_name  Where to write it.
+   * @param  tiles      The tiles the shortcuts are in, sorted by their value.
+   * @param  offsets    Where the shortcuts of each tile start, with one more at the end for the
+   *                    total.
+   * @param  shortcuts  Per tile, the indices of its shortcuts in the tile in increasing order.
+   * @param  positions  Per shortcut, where its packed edges start in the data.
+   * @param  data       The edges of all of the shortcuts as they were packed.
+   */
+  static void Write(const std::string& file_name,
+                    const std::vector<GraphId>& tiles,
+                    const std::vector<uint64_t>& offsets,
+                    const std::vector<uint32_t>& shortcuts,
+                    const std::vector<uint64_t>& positions,
+                    const std::vector<uint8_t>& data);
+
+  /**
+   * Maps the recovered shortcuts from disk, throws if the file is missing or not shortcuts.
+   * @param  file_name  The file to map.
+   */
+  explicit RecoveredShortcuts(const std::string& file_name);
+
+  RecoveredShortcuts(const RecoveredShortcuts&) = delete;
+  RecoveredShortcuts& operator=(const RecoveredShortcuts&) = delete;
+
+  /**
+   * Unpacks the edges a shortcut supersedes.
+   * @param  shortcut  The shortcut.
+   * @param  edges     Its edges in order, or only the shortcut if it couldnt be recovered.
+   * @return false if the shortcut is unknown, in which case it has to be recovered from the tiles
+   */
+  bool Find(const GraphId& shortcut, std::vector<GraphId>& edges) const;
+
+  /**
+   * @return how many shortcuts there are edges for
+   */
+  uint64_t shortcut_count() const {
+    return header_->shortcut_count;
+  }
+
+protected:
+  // the mapped file
+  Sidecar file_;
+
+  const Header* header_;
+  const uint64_t* tiles_;
+  const uint64_t* offsets_;
+  const uint64_t* positions_;
+  const uint32_t* shortcuts_;
+  const uint8_t* packed_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_RECOVEREDSHORTCUTS_H_
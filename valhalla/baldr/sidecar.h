@@ -0,0 +1,119 @@
+#ifndef VALHALLA_BALDR_SIDECAR_H_
+#define VALHALLA_BALDR_SIDECAR_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <valhalla/midgard/sequence.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The files built next to the tiles (hierarchies, landmarks, reach, spatial index and so on) are
+ * laid out the same way: a header which starts with a magic number and a version followed by flat
+ * arrays. They are written to a temporary file which is moved into place once it is complete, so
+ * the services never map half a file, and they are memory mapped read only.
+ */
+class SidecarWriter {
+public:
+  /**
+   * Opens the temporary file next to where the file goes, throws if it cant be opened.
+   * @param  file_name  Where the file goes once it is committed.
+   */
+  explicit SidecarWriter(const std::string& file_name);
+
+  /**
+   * Removes the temporary file if it was never committed.
+   */
+  ~SidecarWriter();
+
+  SidecarWriter(const SidecarWriter&) = delete;
+  SidecarWriter& operator=(const SidecarWriter&) = delete;
+
+  /**
+   * Appends an array to the file.
+   * @param  data   The first element.
+   * @param  count  How many elements there are.
+   */
+  template <typename T> void write(const T* data, const size_t count) {
+    file_.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+  }
+
+  /**
+   * Appends the elements of a vector to the file.
+   * @param  data  The elements.
+   */
+  template <typename T> void write(const std::vector<T>& data) {
+    write(data.data(), data.size());
+  }
+
+  /**
+   * Finishes the file and moves it into place, throws if anything could not be written.
+   */
+  void commit();
+
+protected:
+  std::string file_name_;
+  std::string temp_name_;
+  std::ofstream file_;
+  bool committed_;
+};
+
+/**
+ * A file built next to the tiles, memory mapped read only. The owner works out whether the arrays
+ * fit in it from the header.
+ */
+class Sidecar {
+public:
+  /**
+   * Maps the file and checks that it starts with the magic number and the version, throws if it
+   * is missing or does not.
+   * @param  file_name  The file to map.
+   * @param  what       What the file is, for the errors, eg "a spatial index".
+   * @param  magic      The magic number the header starts with.
+   * @param  version    The version the header has to have.
+   * @param  header     The size of the header.
+   */
+  Sidecar(const std::string& file_name,
+          const std::string& what,
+          const uint64_t magic,
+          const uint32_t version,
+          const size_t header);
+
+  Sidecar(const Sidecar&) = delete;
+  Sidecar& operator=(const Sidecar&) = delete;
+
+  /**
+   * Throws unless the file is valid, for the checks of the owner.
+   * @param  valid  Whether the owner found the file to be valid.
+   */
+  void check(const bool valid) const;
+
+  /**
+   * @return the start of the file
+   */
+  const char* data() const {
+    return memmap_.get();
+  }
+
+  /**
+   * @return the size of the file in bytes
+   */
+  size_t size() const {
+    return memmap_.size();
+  }
+
+protected:
+  midgard::mem_map<char> memmap_;
+  std::string file_name_;
+  std::string what_;
+  uint32_t version_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SIDECAR_H_
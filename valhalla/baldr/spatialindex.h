@@ -0,0 +1,133 @@
+#ifndef VALHALLA_BALDR_SPATIALINDEX_H_
+#define VALHALLA_BALDR_SPATIALINDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/sidecar.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * A spatial index over the nodes and edges of every level but transit, independent of the bins of
+ * the tiles. Each of the two is a packed R-tree: the entries are sorted along a Hilbert curve and
+ * grouped into fixed size nodes level by level up to a single root, so the whole tree is a few
+ * flat arrays which are memory mapped read only from a file in the tile_dir.
+ *
+ * The edges are the ones the bins have, no shortcuts or transit connections, and only the forward
+ * one of each pair of directed edges, which is kept with the bounding box of its shape.
+ */
+class SpatialIndex {
+public:
+  // How many children a node of the trees has
+  static constexpr uint32_t kNodeSize = 16;
+
+  // A bounding box in the precision that is stored
+  struct Box {
+    float minx, miny, maxx, maxy;
+  };
+
+  // What is at the start of the file
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t node_size;
+    uint64_t node_count;
+    uint64_t edge_count;
+  };
+
+  /**
+   * Where the index lives.
+   * @param  tile_dir  The tile directory.
+   * @return the path to the file
+   */
+  static std::string FileName(const std::string& tile_dir);
+
+  /**
+   * Sorts and packs the entries into the trees and writes them to disk.
+   * @param  file_name  Where to write it.
+   * @param  nodes      The nodes and where they are.
+   * @param  edges      The edges and the bounding boxes of their shapes.
+   */
+  static void Write(const std::string& file_name,
+                    std::vector<std::pair<GraphId, midgard::PointLL>> nodes,
+                    std::vector<std::pair<GraphId, midgard::AABB2<midgard::PointLL>>> edges);
+
+  /**
+   * Maps the index from disk, throws if the file is missing or not an index.
+   * @param  file_name  The file to map.
+   */
+  explicit SpatialIndex(const std::string& file_name);
+
+  SpatialIndex(const SpatialIndex&) = delete;
+  SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+  /**
+   * @return how many nodes are in the index
+   */
+  uint64_t node_count() const {
+    return header_->node_count;
+  }
+
+  /**
+   * @return how many edges are in the index
+   */
+  uint64_t edge_count() const {
+    return header_->edge_count;
+  }
+
+  /**
+   * Finds the nodes inside a bounding box.
+   * @param  bbox  The bounding box.
+   * @return the nodes, in no particular order
+   */
+  std::vector<GraphId> Nodes(const midgard::AABB2<midgard::PointLL>& bbox) const;
+
+  /**
+   * Finds the edges whose shape has a bounding box that intersects a bounding box, which is a
+   * superset of those whose shape intersects it.
+   * @param  bbox  The bounding box.
+   * @return the edges, in no particular order
+   */
+  std::vector<GraphId> Edges(const midgard::AABB2<midgard::PointLL>& bbox) const;
+
+  /**
+   * Finds the nodes closest to a point, as the crow flies.
+   * @param  point  The point.
+   * @param  count  How many nodes to find at most.
+   * @return the closest nodes, the closest first
+   */
+  std::vector<GraphId> NearestNodes(const midgard::PointLL& point, const size_t count) const;
+
+protected:
+  // One of the trees, the entries come first and the root is last
+  struct tree_t {
+    const Box* boxes;
+    // the value of the graph id of an entry, the position of the first child of anything above
+    const uint64_t* indices;
+    // where each level of the tree ends
+    std::vector<uint64_t> level_ends;
+  };
+
+  static std::vector<uint64_t> LevelEnds(const uint64_t count);
+  static uint64_t Size(const uint64_t count);
+  static std::vector<GraphId> Search(const tree_t& tree, const midgard::AABB2<midgard::PointLL>& bbox);
+
+  // the mapped file
+  Sidecar file_;
+
+  const Header* header_;
+  tree_t nodes_;
+  tree_t edges_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SPATIALINDEX_H_
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -8,7 +9,7 @@ namespace valhalla {
 namespace baldr {
 
 /**
- * Synchronous interface for getting tiles.
+ * Interface for getting tiles, synchronously or as a batch of futures.
  */
 class tile_getter_t {
 public:
@@ -36,6 +37,29 @@ public:
    * */
   virtual response_t get(const std::string& url) = 0;
 
+  /**
+   * Makes a request to the corresponding url without waiting for it. By default the request is
+   * made synchronously and the future is ready right away, implementations which are able to
+   * fetch in the background should override it.
+   */
+  virtual std::future<response_t> get_async(const std::string& url) {
+    std::promise<response_t> promise;
+    promise.set_value(get(url));
+    return promise.get_future();
+  }
+
+  /**
+   * Makes requests to all of the urls at once. The futures are in the same order as the urls.
+   */
+  virtual std::vector<std::future<response_t>> get_batch(const std::vector<std::string>& urls) {
+    std::vector<std::future<response_t>> responses;
+    responses.reserve(urls.size());
+    for (const auto& url : urls) {
+      responses.emplace_back(get_async(url));
+    }
+    return responses;
+  }
+
   /**
    * Whether tiles are with .gz extension.
    */
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/baldr/graphid.h>
@@ -51,7 +52,32 @@ public:
    * @param pointll  Lat,lng location within the tile.
    * @param level    Level of the requested tile.
    */
-  static GraphId GetGraphId(const midgard::PointLL& pointll, const uint8_t level);
+  static GraphId GetGraphId(const midgard::PointLL& pointll, const uint8_t level) {
+    // Return an invalid id if the level is not supported or totally outside the world
+    const auto lat = pointll.lat(), lng = pointll.lng();
+    if (level >= kLevelCount || lat < -90 || lat > 90 || lng < -180 || lng > 180) {
+      return {};
+    }
+
+    // The max lat or lng go in the last row or column. The point and the column are rounded to
+    // float where the Tiles of the level round them so that both always agree on the tile
+    const float y = lat, x = lng;
+    const double inverse = 1. / tile_size(level);
+    const auto columns = static_cast<int32_t>(360 * inverse);
+    const auto row = y == 90.f ? static_cast<int32_t>(180 * inverse) - 1
+                               : static_cast<int32_t>((y + 90.) * inverse);
+    const float column = x == 180.f ? columns - 1 : (x + 180.) * inverse;
+    return {static_cast<uint32_t>(row * columns + static_cast<int32_t>(column)), level, 0};
+  }
+
+  /**
+   * Returns the GraphIds of the tiles the points are in at a level, one per point. Those of
+   * points outside of the world, or all of them if the level is not supported, are invalid.
+   * @param points  Lat,lng locations.
+   * @param level   Level of the requested tiles.
+   */
+  static std::vector<GraphId> GetGraphIds(const std::vector<midgard::PointLL>& points,
+                                          const uint8_t level);
 
   /**
    * Returns bounding box for the given GraphId .
@@ -95,6 +121,22 @@ public:
    * @return Returns a const reference to the tiling system for this level.
    */
   static const midgard::Tiles<midgard::PointLL>& get_tiling(const uint8_t level);
+
+protected:
+  // The number of levels GetGraphId supports, the transit level is not one of them
+  static constexpr uint8_t kLevelCount = 3;
+
+  /**
+   * The tile size of a level in degrees. These are the tile sizes of levels(), which are fixed, so
+   * that the tile math for a point is a couple of multiplications by constants instead of going
+   * through the Tiles of the level. The sizes being powers of 2 multiplying by their inverse
+   * gives the same tiles as dividing by them.
+   * @param level Level Id.
+   * @return the tile size
+   */
+  static constexpr float tile_size(const uint8_t level) {
+    return level == 0 ? 4.f : (level == 1 ? 1.f : .25f);
+  }
 };
 
 } // namespace baldr
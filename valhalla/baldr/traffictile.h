@@ -9,6 +9,7 @@
 #ifndef C_ONLY_INTERFACE
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <exception>
 #include <memory>
 #include <string>
@@ -184,7 +185,7 @@ struct TrafficTileHeader {
   uint64_t last_update; // seconds since epoch
   uint32_t directed_edge_count;
   uint32_t traffic_tile_version;
-  uint32_t spare2;
+  uint32_t sequence; // bumped before and after the speeds change, odd while they are changing
   uint32_t spare3;
 };
 
@@ -254,6 +255,30 @@ public:
     return *(speeds + directed_edge_offset);
   }
 
+  /**
+   * Reads the speed of an edge in one 64 bit load. Writers store whole records the same way, so
+   * unlike reading the fields of the volatile record one by one, a record being rewritten is seen
+   * either as it was or as it is afterwards but never mixed.
+   * @param directed_edge_offset  the index of the edge in the tile
+   * @return a copy of the speed record
+   */
+  TrafficSpeed load_trafficspeed(const uint32_t directed_edge_offset) const {
+    const volatile TrafficSpeed& speed = trafficspeed(directed_edge_offset);
+    const uint64_t bits = *reinterpret_cast<const volatile uint64_t*>(&speed);
+    TrafficSpeed copy;
+    std::memcpy(&copy, &bits, sizeof(copy));
+    return copy;
+  }
+
+  /**
+   * The sequence of the speeds, odd while a writer is changing them. It being the same even value
+   * before and after reading several speeds means they are all of the same update.
+   * @return the sequence, 0 if there is no tile
+   */
+  uint32_t sequence() const {
+    return header == nullptr ? 0 : header->sequence;
+  }
+
   // Returns true if this tile is valid or not
   bool operator()() const {
     return header != nullptr;
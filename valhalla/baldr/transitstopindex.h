@@ -0,0 +1,54 @@
+#ifndef VALHALLA_BALDR_TRANSITSTOPINDEX_H_
+#define VALHALLA_BALDR_TRANSITSTOPINDEX_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The transit stations and platforms of the transit level, binned by the cells (bins) of the
+ * transit tiles they are in. The stops are kept in flat arrays sorted by cell, so a radius query
+ * only looks at the stops of the few cells its box touches instead of loading any tiles.
+ *
+ * Built from the transit tiles when it is constructed, it is as current as the tiles were then.
+ */
+class TransitStopIndex {
+public:
+  /**
+   * Reads the stops of all of the transit tiles.
+   * @param  pt  the ptree sub child labeled mjolnir in the valhalla json config
+   */
+  explicit TransitStopIndex(const boost::property_tree::ptree& pt);
+
+  /**
+   * Whether there is a stop within a radius of a location.
+   * @param  ll      the location
+   * @param  radius  the radius in meters
+   * @return true if there is one
+   */
+  bool Within(const midgard::PointLL& ll, const float radius) const;
+
+  /**
+   * @return how many stops are indexed
+   */
+  size_t size() const {
+    return stops_.size();
+  }
+
+protected:
+  // The cell of each stop, the id of its tile times the number of bins per tile plus its bin, in
+  // ascending order with the stops
+  std::vector<uint64_t> cells_;
+  std::vector<midgard::PointLL> stops_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TRANSITSTOPINDEX_H_
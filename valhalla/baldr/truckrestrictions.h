@@ -0,0 +1,111 @@
+#ifndef VALHALLA_BALDR_TRUCKRESTRICTIONS_H_
+#define VALHALLA_BALDR_TRUCKRESTRICTIONS_H_
+
+#include <array>
+#include <cstdint>
+
+#include <valhalla/baldr/accessrestriction.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * A summary of the truck access restrictions of a directed edge in 16 bits. The tightest height,
+ * width, length, weight and axle load limit of the edge are each rounded down to one of 7 coarse
+ * buckets, with 0 meaning the edge has no such limit, and a last bit marks edges that have
+ * restrictions which have to be looked at one by one (hazmat, time based or limits below the
+ * smallest bucket). Lets a truck pass the usual restricted edges with a couple of bit operations
+ * instead of searching the access restrictions of the tile for them.
+ */
+class TruckRestrictions {
+public:
+  // The limits summed up, in the order of their access types starting at kMaxHeight
+  static constexpr uint32_t kLimitCount = 5;
+  // How many bits the bucket of each limit takes
+  static constexpr uint32_t kBucketBits = 3;
+
+  // The buckets a truck passes for each limit, bit b set if it passes any limit in bucket b
+  using buckets_t = std::array<uint8_t, kLimitCount>;
+
+  /**
+   * Constructor of an edge without truck restrictions.
+   */
+  TruckRestrictions() : value_(0) {
+  }
+
+  /**
+   * Gets the size of the summaries of the directed edges of a tile, padded to 8 bytes so the
+   * sections after them stay aligned.
+   * @param  count  the number of directed edges
+   * @return the size in bytes
+   */
+  static uint32_t SectionSize(const uint32_t count) {
+    return (count * sizeof(TruckRestrictions) + 7) / 8 * 8;
+  }
+
+  /**
+   * Adds a restriction of the edge to the summary, restrictions of other modes are ignored.
+   * @param  restriction  the access restriction
+   */
+  void Add(const AccessRestriction& restriction);
+
+  /**
+   * Gets the buckets of each limit a truck passes.
+   * @param  height     height of the truck in meters
+   * @param  width      width of the truck in meters
+   * @param  length     length of the truck in meters
+   * @param  weight     weight of the truck in metric tons
+   * @param  axle_load  axle load of the truck in metric tons
+   * @return the buckets of each limit the truck is known to pass
+   */
+  static buckets_t PassedBuckets(const float height,
+                                 const float width,
+                                 const float length,
+                                 const float weight,
+                                 const float axle_load);
+
+  /**
+   * Whether a truck is known to pass all of the restrictions of the edge without looking at them.
+   * @param  passed  the buckets the truck passes, see PassedBuckets
+   * @return true if the truck passes them, false if the restrictions have to be looked at
+   */
+  bool Passes(const buckets_t& passed) const {
+    if (value_ & kCheckRestrictions) {
+      return false;
+    }
+    for (uint32_t i = 0; i < kLimitCount; ++i) {
+      if (!((passed[i] >> bucket(i)) & 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Gets the bucket of a limit.
+   * @param  limit  index of the limit, 0 for the height through 4 for the axle load
+   * @return the bucket of the tightest limit of the edge, 0 if it has none
+   */
+  uint32_t bucket(const uint32_t limit) const {
+    return (value_ >> (limit * kBucketBits)) & kBucketMask;
+  }
+
+  /**
+   * Whether the edge has restrictions that have to be looked at one by one.
+   * @return true if so
+   */
+  bool check_restrictions() const {
+    return value_ & kCheckRestrictions;
+  }
+
+protected:
+  static constexpr uint16_t kBucketMask = (1 << kBucketBits) - 1;
+  static constexpr uint16_t kCheckRestrictions = 1 << (kLimitCount * kBucketBits);
+
+  uint16_t value_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TRUCKRESTRICTIONS_H_
@@ -380,6 +380,9 @@ inline bool create_directories(const path& p) {
 #else
       if (mkdir(partial.c_str(), S_IRWXU | S_IRWXG | S_IRWXO) != 0) {
 #endif
+        // someone else may have just made it, threads storing tiles do that
+        if (errno == EEXIST)
+          continue;
         return false;
         // throw std::runtime_error(std::string("Failed to create path: ") + strerror(errno));
       }
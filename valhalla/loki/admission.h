@@ -0,0 +1,76 @@
+#ifndef VALHALLA_LOKI_ADMISSION_H_
+#define VALHALLA_LOKI_ADMISSION_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/proto/api.pb.h>
+
+namespace valhalla {
+namespace loki {
+
+/**
+ * Decides whether a request is worth starting at all. Every action keeps a process wide count of
+ * the requests it has in progress and a running estimate of the milliseconds one unit of work
+ * takes, a unit being a location, a kilometer between locations, a pair of a matrix and so on.
+ * A request is turned away with a 503 when its action already has as many requests in progress as
+ * it may or when the estimate of how long it takes says it won't be done before its deadline.
+ * Requests that are let in get a deadline after which the interrupt stops them, see
+ * with_deadline in worker.h.
+ */
+class Admission {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  /**
+   * The request being in progress, the count goes back down and how long it took goes into the
+   * estimate when it goes away
+   */
+  class Ticket {
+  public:
+    Ticket() = default;
+    Ticket(const Ticket&) = delete;
+    Ticket& operator=(const Ticket&) = delete;
+    Ticket(Ticket&& other);
+    ~Ticket();
+
+  protected:
+    friend class Admission;
+    struct state_t;
+    std::shared_ptr<state_t> state_;
+    double units_ = 0;
+    clock_t::time_point start_;
+  };
+
+  /**
+   * @param config  the whole config, the limits come from loki.admission
+   */
+  explicit Admission(const boost::property_tree::ptree& config);
+
+  /**
+   * Lets the request in or throws a 173. The deadline of the request, its own or the configured
+   * default, is set in its info so that the later stages can stop when it has passed
+   * @param request  the freshly parsed request
+   * @return the ticket to hold on to for as long as the request is being worked on
+   */
+  Ticket Admit(Api& request) const;
+
+  /**
+   * How many units of work a request is, before any of it is done
+   * @param request  the parsed request
+   * @return the units of work, at least 1
+   */
+  static double Units(const Api& request);
+
+protected:
+  size_t max_concurrent_;
+  uint64_t default_deadline_;
+};
+
+} // namespace loki
+} // namespace valhalla
+
+#endif // VALHALLA_LOKI_ADMISSION_H_
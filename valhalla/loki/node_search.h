@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/spatialindex.h>
 
 namespace valhalla {
 namespace loki {
@@ -12,20 +13,25 @@ namespace loki {
  *
  * @param  bbox   bounding box in which to look for nodes.
  * @param  reader graph reader object to use for loading tiles.
+ * @param  index  the spatial index to find the nodes with instead of the bins of the tiles.
  * @return nodes  a collection of nodes which are in the bounding box.
  */
 std::vector<baldr::GraphId> nodes_in_bbox(const midgard::AABB2<midgard::PointLL>& bbox,
-                                          baldr::GraphReader& reader);
+                                          baldr::GraphReader& reader,
+                                          const baldr::SpatialIndex* index = nullptr);
 
 /**
  * Find edges that intersect the given bounding box in the route network.
  *
  * @param  bbox   bounding box in which to look for nodes.
  * @param  reader graph reader object to use for loading tiles.
+ * @param  index  the spatial index to find the edges with instead of the bins of the tiles, it
+ *                only has one edge of each pair and those whose shape is near the bounding box.
  * @return edges  a collection of edges which intersect the bounding box.
  */
 std::vector<baldr::GraphId> edges_in_bbox(const midgard::AABB2<midgard::PointLL>& bbox,
-                                          baldr::GraphReader& reader);
+                                          baldr::GraphReader& reader,
+                                          const baldr::SpatialIndex* index = nullptr);
 
 } // namespace loki
 } // namespace valhalla
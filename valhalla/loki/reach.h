@@ -32,7 +32,10 @@ struct directed_reach {
   uint32_t inbound : 16;
 };
 
-class Reach : public thor::Dijkstras {
+class Reach final : public thor::Dijkstras {
+  // the traversals call the hooks below directly
+  friend class thor::Dijkstras;
+
 public:
   Reach();
   // TODO: currently this interface has no place for time, we need to both add it and handle
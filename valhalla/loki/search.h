@@ -3,10 +3,12 @@
 
 #include <cstdint>
 #include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/edgereach.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/pathlocation.h>
 #include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/expansion_pool.h>
 
 #include <functional>
 
@@ -22,13 +24,21 @@ namespace loki {
  * proper cache
  * @param edge_filter    a costing object by which we can determine which portions of the graph are
  *                       accessable and therefor potential candidates
+ * @param edge_reach     the reach stored for the costing, only if its options are the defaults the
+ *                       reach was computed with, to skip the reachability check of most edges
+ * @param pool           threads to search groups of nearby locations on when there are many,
+ *                       only the calling thread if nullptr. The reach of the edges found is the
+ *                       same either way but which candidates are checked depends on the locations
+ *                       searched together, so the candidates of the locations can differ slightly
  * @return pathLocations the correlated data with in the tile that matches the inputs. If a
  * projection is not found, it will not have any entry in the returned value.
  */
 std::unordered_map<baldr::Location, baldr::PathLocation>
 Search(const std::vector<baldr::Location>& locations,
        baldr::GraphReader& reader,
-       const std::shared_ptr<sif::DynamicCost>& costing);
+       const std::shared_ptr<sif::DynamicCost>& costing,
+       const baldr::EdgeReach* edge_reach = nullptr,
+       thor::ExpansionPool* pool = nullptr);
 
 } // namespace loki
 } // namespace valhalla
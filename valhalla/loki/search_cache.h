@@ -0,0 +1,97 @@
+#ifndef VALHALLA_LOKI_SEARCH_CACHE_H_
+#define VALHALLA_LOKI_SEARCH_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/location.h>
+#include <valhalla/baldr/pathlocation.h>
+
+namespace valhalla {
+namespace loki {
+
+/**
+ * A bounded least recently used cache of what loki::Search found for a location, so that the
+ * same location being sent over and over, like the entrance of an airport, is only correlated
+ * once. A location is found by its coordinates, rounded to the precision of the tiles, together
+ * with everything about it that changes the search and a key for the costing it was searched
+ * with. The results are only good for as long as the graph stays the same, whoever owns the
+ * cache has to clear it when the tiles or the traffic change.
+ */
+class SearchCache {
+public:
+  /**
+   * Constructor.
+   * @param  max_size  how many locations to keep at most, nothing is kept if 0
+   */
+  explicit SearchCache(const size_t max_size);
+
+  /**
+   * The key of a location for a given costing.
+   * @param  location     the location to be searched
+   * @param  costing_key  anything that tells apart costings which allow different edges
+   * @return the key
+   */
+  static std::string Key(const baldr::Location& location, const std::string& costing_key);
+
+  /**
+   * Finds what was found for a location before. The edges may have been found for coordinates up
+   * to the rounding away from those of the location.
+   * @param  key     the key of the location
+   * @param  result  the path location made from the location, gets the edges if it was found
+   * @return true if it was found
+   */
+  bool Find(const std::string& key, baldr::PathLocation& result);
+
+  /**
+   * Keeps the result of a location, dropping the least recently used one if full.
+   * @param  key     the key of the location
+   * @param  result  what was found for it
+   */
+  void Insert(const std::string& key, const baldr::PathLocation& result);
+
+  /**
+   * Drops everything.
+   */
+  void Clear();
+
+  /**
+   * @return how many locations are kept
+   */
+  size_t size() const {
+    return index_.size();
+  }
+
+  /**
+   * @return how many locations were found since construction
+   */
+  uint64_t hits() const {
+    return hits_;
+  }
+
+  /**
+   * @return how many locations were not found since construction
+   */
+  uint64_t misses() const {
+    return misses_;
+  }
+
+protected:
+  using entry_t = std::pair<std::string, baldr::PathLocation>;
+
+  size_t max_size_;
+  // most recently used at the front
+  std::list<entry_t> entries_;
+  std::unordered_map<std::string, std::list<entry_t>::iterator> index_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+} // namespace loki
+} // namespace valhalla
+
+#endif // VALHALLA_LOKI_SEARCH_CACHE_H_
@@ -2,19 +2,27 @@
 #define __VALHALLA_LOKI_SERVICE_H__
 
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
 #include <valhalla/baldr/connectivity_map.h>
+#include <valhalla/baldr/edgereach.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/pathlocation.h>
 #include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/baldr/transitstopindex.h>
+#include <valhalla/loki/admission.h>
+#include <valhalla/loki/search_cache.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/proto/options.pb.h>
 #include <valhalla/sif/costfactory.h>
 #include <valhalla/skadi/sample.h>
+#include <valhalla/thor/expansion_pool.h>
 #include <valhalla/tyr/actor.h>
 #include <valhalla/worker.h>
 
@@ -38,12 +46,29 @@ public:
 
   std::string locate(Api& request);
   void route(Api& request);
+  /**
+   * Checks and correlates the independent routes of a batch, the distinct locations of all of them
+   * are searched for together and a route whose locations can't be found gets an error code
+   * @param request  the request with its batch of routes
+   */
+  void route_batch(Api& request);
   void matrix(Api& request);
   void isochrones(Api& request);
   void trace(Api& request);
+  /**
+   * Checks the edges of a path to recost, they are already on the graph so nothing is searched for
+   * @param request  the request with the edges of its path
+   */
+  void recost(Api& request);
   std::string height(Api& request);
   std::string transit_available(Api& request);
 
+  /**
+   * Makes sure the action of the request is one of those the config allows
+   * @param request  the freshly parsed request, throws a 106 listing the allowed actions if not
+   */
+  void check_action(const Api& request) const;
+
   void set_interrupt(const std::function<void()>* interrupt) override;
 
 protected:
@@ -52,21 +77,45 @@ protected:
       boost::optional<valhalla_exception_t> required_exception = valhalla_exception_t{110});
   void parse_trace(Api& request);
   void parse_costing(Api& request, bool allow_none = false);
+  const baldr::EdgeReach* get_edge_reach(const Options& options) const;
+  std::unordered_map<baldr::Location, baldr::PathLocation>
+  search(Api& request,
+         const std::vector<baldr::Location>& locations,
+         thor::ExpansionPool* pool = nullptr);
   void locations_from_shape(Api& request);
 
   void init_locate(Api& request);
   void init_route(Api& request);
+  void check_walking_distances(Options& options) const;
   void init_matrix(Api& request);
   void init_isochrones(Api& request);
   void init_trace(Api& request);
   std::vector<midgard::PointLL> init_height(Api& request);
   void init_transit_available(Api& request);
 
+  /**
+   * Builds the connectivity map and the transit stop index and maps the edge reach of the tileset
+   * the reader is on
+   */
+  void load_tile_data();
+
   boost::property_tree::ptree config;
   sif::CostFactory factory;
   sif::cost_ptr_t costing;
   std::shared_ptr<baldr::GraphReader> reader;
   std::shared_ptr<baldr::connectivity_map_t> connectivity_map;
+  // the transit stops for transit_available, if that action is allowed
+  std::unique_ptr<const baldr::TransitStopIndex> transit_stops;
+  // the reach stored per costing and the default options it was computed with
+  std::unordered_map<int, std::unique_ptr<const baldr::EdgeReach>> edge_reaches;
+  std::unordered_map<int, std::string> edge_reach_options;
+  // the tileset the above were made from
+  uint64_t tileset_generation;
+  // threads to search large lists of locations on
+  std::unique_ptr<thor::ExpansionPool> search_pool;
+  // what was found for recently searched locations and the traffic it was found with
+  std::unique_ptr<SearchCache> search_cache;
+  uint64_t search_cache_generation;
   std::unordered_set<Options::Action> actions;
   std::string action_str;
   std::unordered_map<std::string, size_t> max_locations;
@@ -74,6 +123,7 @@ protected:
   std::unordered_map<std::string, float> max_matrix_distance;
   std::unordered_map<std::string, float> max_matrix_locations;
   size_t max_avoid_locations;
+  size_t max_batch_routes;
   unsigned int max_reachability;
   unsigned int default_reachability;
   unsigned int max_radius;
@@ -98,6 +148,7 @@ protected:
   skadi::sample sample;
   size_t max_elevation_shape;
   float min_resample;
+  Admission admission;
   unsigned int max_alternates;
 };
 } // namespace loki
@@ -0,0 +1,114 @@
+// -*- mode: c++ -*-
+#ifndef MMP_BATCH_MATCHER_H_
+#define MMP_BATCH_MATCHER_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/meili/map_matcher_factory.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Matches a stream of traces on a pool of threads, for offline processing of many traces. Every
+ * thread has its own MapMatcherFactory, and so its own GraphReader, which all share one tile cache
+ * and one cache of candidate grids unless the config says otherwise.
+ *
+ * The traces are read one per line as json, {"id": ..., "costing": "auto", "shape": [{"lon": ...,
+ * "lat": ..., "time": ..., "accuracy": ..., "radius": ...}, ...]} where everything but the lon and
+ * lat of the points is optional. The results are written one per line in the order of the traces,
+ * {"id": ..., "points": [{"lon": ..., "lat": ..., "edge_id": ..., "distance_from": ...} or null
+ * for every point that wasnt matched]} or {"id": ..., "error": "..."} if the trace couldnt be.
+ * Only so many traces are read ahead of the last one written so that memory stays bounded no
+ * matter how large the input or how slow the output.
+ *
+ * Probe traces can instead be added up into how fast they went along each edge, every thread adds
+ * up its own traces and they are only put together at the end, nothing is written per trace.
+ */
+class BatchMatcher {
+public:
+  // How fast the traces went along an edge, altogether
+  struct edge_speed_t {
+    // how many times a trace went along the edge
+    uint32_t count = 0;
+    // how far they went along it in meters and how long it took them in seconds
+    double length = 0;
+    double seconds = 0;
+
+    /**
+     * @return the average speed in meters per second
+     */
+    double speed() const {
+      return seconds > 0 ? length / seconds : 0;
+    }
+  };
+  using edge_speeds_t = std::unordered_map<baldr::GraphId, edge_speed_t>;
+
+  /**
+   * @param config       the config with the meili and mjolnir sections
+   * @param threads      how many threads match traces, all the cores if 0
+   * @param max_pending  how many traces may be read but not yet written, 0 for 4 per thread
+   */
+  BatchMatcher(const boost::property_tree::ptree& config,
+               const size_t threads = 0,
+               const size_t max_pending = 0);
+
+  /**
+   * Matches every trace of the input and writes the results to the output.
+   * @param  input   the traces, one per line
+   * @param  output  where to write the results, one line per trace
+   * @return how many traces were read
+   */
+  size_t Match(std::istream& input, std::ostream& output) const;
+
+  /**
+   * Matches one trace.
+   * @param  factory          the factory to make the matcher with
+   * @param  trace            the json of the trace
+   * @param  default_costing  the costing of traces that dont have one
+   * @return the json of the result
+   */
+  static std::string Match(MapMatcherFactory& factory,
+                           const std::string& trace,
+                           const std::string& default_costing = "auto");
+
+  /**
+   * Matches every trace of the input and adds up how fast they went along the edges they were
+   * matched to. Only the parts of the paths between two points with a time have a speed, traces
+   * that couldnt be matched are left out.
+   * @param  input   the traces, one per line
+   * @param  speeds  where to add the speeds along the edges
+   * @return how many traces were matched
+   */
+  size_t MatchSpeeds(std::istream& input, edge_speeds_t& speeds) const;
+
+  /**
+   * Matches one trace and adds up how fast it went along the edges it was matched to.
+   * @param  factory          the factory to make the matcher with
+   * @param  trace            the json of the trace
+   * @param  speeds           where to add the speeds along the edges
+   * @param  default_costing  the costing of traces that dont have one
+   * @return whether the trace was matched
+   */
+  static bool MatchSpeeds(MapMatcherFactory& factory,
+                          const std::string& trace,
+                          edge_speeds_t& speeds,
+                          const std::string& default_costing = "auto");
+
+protected:
+  boost::property_tree::ptree config_;
+  size_t threads_;
+  size_t max_pending_;
+};
+
+} // namespace meili
+} // namespace valhalla
+
+#endif // MMP_BATCH_MATCHER_H_
@@ -4,7 +4,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <mutex>
 #include <tuple>
+#include <unordered_map>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -13,6 +16,7 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/spatialindex.h>
 #include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/linesegment2.h>
 #include <valhalla/midgard/pointll.h>
@@ -34,11 +38,69 @@ public:
                                                  const sif::cost_ptr_t& costing = nullptr) const = 0;
 };
 
-class CandidateGridQuery final : public CandidateQuery {
+/**
+ * The grids built over the bins of the tiles, by bin id. A grid never changes once it is built so
+ * the cache can be shared by the candidate queries of many threads, whoever needs a grid that is
+ * not there yet builds it and the first one to be put in is kept. It is thread-safe.
+ */
+class CandidateGridCache {
 public:
   using grid_t = GridRangeQuery<baldr::GraphId, midgard::PointLL>;
 
-  CandidateGridQuery(baldr::GraphReader& reader, float cell_width, float cell_height);
+  /**
+   * @param  bin_id  the bin
+   * @return the grid of the bin or nullptr if it wasnt built yet
+   */
+  std::shared_ptr<const grid_t> Find(const int32_t bin_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = grids_.find(bin_id);
+    return it == grids_.cend() ? nullptr : it->second;
+  }
+
+  /**
+   * Keeps the grid of a bin unless another one was put in first.
+   * @param  bin_id  the bin
+   * @param  grid    the grid built for it
+   * @return the grid that is kept for the bin
+   */
+  std::shared_ptr<const grid_t> Insert(const int32_t bin_id, std::shared_ptr<const grid_t> grid) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return grids_.emplace(bin_id, std::move(grid)).first->second;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return grids_.size();
+  }
+
+  // grids still being queried stay alive until they are done with
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    grids_.clear();
+  }
+
+private:
+  mutable std::mutex mutex_;
+  std::unordered_map<int32_t, std::shared_ptr<const grid_t>> grids_;
+};
+
+class CandidateGridQuery final : public CandidateQuery {
+public:
+  using grid_t = CandidateGridCache::grid_t;
+
+  /**
+   * @param reader       the graph
+   * @param cell_width   the width of the cells of the grids built over each bin of the tiles
+   * @param cell_height  the height of those cells
+   * @param index        the spatial index to find the edges with instead of building the grids
+   * @param grid_cache   the grids to share with other queries of the same cell size and graph,
+   *                     the query keeps its own if there is none
+   */
+  CandidateGridQuery(baldr::GraphReader& reader,
+                     float cell_width,
+                     float cell_height,
+                     const baldr::SpatialIndex* index = nullptr,
+                     std::shared_ptr<CandidateGridCache> grid_cache = nullptr);
 
   ~CandidateGridQuery() override;
 
@@ -57,39 +119,45 @@ public:
       throw std::invalid_argument("Expect a valid location");
     }
 
+    // the edges go into scratch space which is reused by every query of the thread
+    thread_local std::vector<baldr::GraphId> edgeids;
     const auto range = midgard::ExpandMeters(location, std::sqrt(sq_search_radius));
-    const auto edgeids = RangeQuery(range);
+    RangeQuery(range, edgeids);
 
     return collector.WithinSquaredDistance(location, stop_type, sq_search_radius, edgeids.begin(),
                                            edgeids.end(), costing);
   }
 
-  std::unordered_map<baldr::GraphId, grid_t>::size_type size() const {
-    return grid_cache_.size();
+  size_t size() const {
+    return grid_cache_->size();
   }
 
   void Clear() {
-    grid_cache_.clear();
+    grid_cache_->Clear();
   }
 
 private:
   // Get a grid for a specified bin within a tile. Tile support for
   // graph tiles and bins is provided to go between bin Ids and tile Ids.
-  const grid_t* GetGrid(const int32_t bin_id,
+  std::shared_ptr<const grid_t> GetGrid(const int32_t bin_id,
                         const midgard::Tiles<midgard::PointLL>& tiles,
                         const midgard::Tiles<midgard::PointLL>& bins) const;
 
-  std::unordered_set<baldr::GraphId> RangeQuery(const midgard::AABB2<midgard::PointLL>& range) const;
+  // Finds the edges near the range, sorted and without duplicates, into the cleared vector
+  void RangeQuery(const midgard::AABB2<midgard::PointLL>& range,
+                  std::vector<baldr::GraphId>& edgeids) const;
 
   uint32_t bin_level_;
 
   float cell_width_;
   float cell_height_;
 
-  // Grid cache - cached per "bin" within a graph tile
-  mutable std::unordered_map<int32_t, grid_t> grid_cache_;
+  // Grid cache - cached per "bin" within a graph tile, possibly shared with other queries
+  std::shared_ptr<CandidateGridCache> grid_cache_;
 
   baldr::GraphReader& reader_;
+
+  const baldr::SpatialIndex* index_;
 };
 
 } // namespace meili
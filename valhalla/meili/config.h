@@ -23,6 +23,8 @@ struct Config {
 
     size_t cache_size = 100240;
     size_t grid_size = 500;
+    // whether the grids are shared by every matcher factory of the process on the same tiles
+    bool shared_grid_cache = false;
 
     void Read(const boost::property_tree::ptree& params);
   };
@@ -62,6 +64,13 @@ struct Config {
     float interpolation_distance_meters = 10.f;
     // define if 'interpolation_distance' option can be reassigned with user request
     bool is_interpolation_distance_customizable = false;
+    // whether points beyond the interpolation distance are interpolated too while the trace goes
+    // straight on for no more than a couple of seconds within the search radius
+    bool adaptive_interpolation = false;
+    // define if 'adaptive_interpolation' option can be reassigned with user request
+    bool is_adaptive_interpolation_customizable = false;
+    // how many routes between candidates to keep for the traces matched after them, 0 keeps none
+    size_t transition_cache_size = 0;
 
     void Read(const boost::property_tree::ptree& params);
   };
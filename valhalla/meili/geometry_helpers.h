@@ -21,7 +21,23 @@ inline std::tuple<midgard::PointLL, float, typename std::vector<midgard::PointLL
 Project(const midgard::projector_t& p,
         midgard::Shape7Decoder<midgard::PointLL>& shape,
         float snap_distance = 0.f) {
-  midgard::PointLL first_point(shape.pop());
+  // decode the shape into longitudes and latitudes to project onto all of its segments at once,
+  // the buffers are kept per thread as this is called for every candidate edge
+  thread_local std::vector<double> lngs, lats, sq_distances, lengths;
+  lngs.clear();
+  lats.clear();
+  while (!shape.empty()) {
+    const auto point = shape.pop();
+    lngs.push_back(point.lng());
+    lats.push_back(point.lat());
+  }
+  const size_t segments = lngs.size() - 1;
+  sq_distances.resize(segments);
+  p.SquaredDistances(lngs.data(), lats.data(), segments, sq_distances.data());
+  lengths.resize(segments);
+  midgard::PointLL::Distances(lngs.data(), lats.data(), segments, lengths.data());
+
+  midgard::PointLL first_point(lngs.front(), lats.front());
   auto closest_point = first_point;
   auto closest_segment_point = first_point;
   float closest_distance = p.approx.DistanceSquared(closest_point);
@@ -32,24 +48,20 @@ Project(const midgard::projector_t& p,
   // for each segment
   auto u = first_point;
   size_t i = 0;
-  for (; !shape.empty(); ++i) {
-    // project a onto b where b is the origin vector representing this segment
-    // and a is the origin vector to the point we are projecting, (a.b/b.b)*b
-    auto v = shape.pop();
-    auto point = p(u, v);
+  for (; i < segments; ++i) {
+    midgard::PointLL v(lngs[i + 1], lats[i + 1]);
 
-    // check if this point is better
-    const auto distance = p.approx.DistanceSquared(point);
-    if (distance < closest_distance) {
-      closest_point = std::move(point);
-      closest_distance = distance;
+    // check if the projection onto this segment is better
+    if (sq_distances[i] < closest_distance) {
+      closest_point = p(u, v);
+      closest_distance = sq_distances[i];
       closest_segment = i;
       closest_partial_length = total_length;
       closest_segment_point = u;
     }
 
     // total edge length
-    total_length += u.Distance(v);
+    total_length += lengths[i];
     u = v;
   }
 
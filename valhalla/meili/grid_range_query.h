@@ -2,6 +2,7 @@
 #ifndef MMP_GRID_RANGE_QUERY_H_
 #define MMP_GRID_RANGE_QUERY_H_
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <tuple>
@@ -89,6 +90,23 @@ public:
 
   // Query all items that intersects with the range
   std::unordered_set<item_t> Query(const midgard::AABB2<coord_t>& range) const {
+    std::vector<item_t> items;
+    AppendItems(range, items);
+    return std::unordered_set<item_t>(items.begin(), items.end());
+  }
+
+  // Query all items that intersects with the range into a vector, sorted and without duplicates.
+  // The vector is cleared first and keeps its memory, so reusing it saves allocating per query
+  void Query(const midgard::AABB2<coord_t>& range, std::vector<item_t>& items) const {
+    items.clear();
+    AppendItems(range, items);
+    std::sort(items.begin(), items.end());
+    items.erase(std::unique(items.begin(), items.end()), items.end());
+  }
+
+  // Append the items of all the squares that intersect with the range, an item is appended once
+  // for every one of them it is in
+  void AppendItems(const midgard::AABB2<coord_t>& range, std::vector<item_t>& items) const {
     int mincol, minrow, maxcol, maxrow;
     std::tie(mincol, minrow) = grid_.SquareAtPoint(range.minpt());
     std::tie(maxcol, maxrow) = grid_.SquareAtPoint(range.maxpt());
@@ -99,16 +117,12 @@ public:
     minrow = std::max(0, std::min(minrow, nrows_ - 1));
     maxrow = std::max(0, std::min(maxrow, nrows_ - 1));
 
-    std::unordered_set<item_t> items;
-
     for (int row = minrow; row <= maxrow; ++row) {
       for (int col = mincol; col <= maxcol; ++col) {
         const auto& squared_items = GetItemsInSquare(col, row);
-        items.insert(squared_items.begin(), squared_items.end());
+        items.insert(items.end(), squared_items.begin(), squared_items.end());
       }
     }
-
-    return items;
   }
 
 private:
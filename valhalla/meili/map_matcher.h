@@ -69,6 +69,34 @@ public:
   std::vector<MatchResults> OfflineMatch(const std::vector<Measurement>& measurements,
                                          uint32_t k = 1);
 
+  /**
+   * Matches the next point of a trace that arrives one point at a time. Only what the new point
+   * adds is searched, the candidates and the viterbi search of the earlier points are kept and
+   * once a point is lag points behind the latest one its match is final. To keep the memory
+   * bounded the history is dropped every few lags, the search then starts over from the last
+   * final point. Clear or OfflineMatch end the trace, the next point starts a new one.
+   * @param measurement  the next point of the trace
+   * @param lag          how many of the latest points may still change their match
+   * @return the results of the points which became final with this one, in order, and the route
+   *         from the last final point before them to the last of them
+   */
+  MatchResults OnlineMatch(const Measurement& measurement, uint32_t lag = 10);
+
+  /**
+   * Ends the trace matched with OnlineMatch by making the remaining points final.
+   * @return the results of the points which werent final yet and the route to them
+   */
+  MatchResults FinishOnlineMatch();
+
+  /**
+   * Shares the routes between candidates with the other traces matched with the same cache.
+   * @param cache        the cache of the routes, nullptr to not use one
+   * @param costing_key  the key of the costing the trace is matched with
+   */
+  void set_route_cache(TransitionRouteCache* cache, const std::string& costing_key) {
+    transition_cost_model_.set_route_cache(cache, costing_key);
+  }
+
   /**
    * Set a callback that will throw when the map-matching should be aborted
    * @param interrupt_callback  the function to periodically call to see if we should abort
@@ -87,6 +115,12 @@ private:
   void RemoveRedundancies(const std::vector<StateId>& result,
                           const std::vector<MatchResult>& results);
 
+  // Makes the points of the online trace up to but not including time final
+  MatchResults FinalizeOnline(const StateId::Time until);
+
+  // Drops the history of the online trace before its last final point
+  void PruneOnline();
+
   Config config_;
 
   baldr::GraphReader& graphreader_;
@@ -109,6 +143,18 @@ private:
   EmissionCostModel emission_cost_model_;
 
   TransitionCostModel transition_cost_model_;
+
+  // The trace being matched one point at a time
+  struct online_t {
+    bool active = false;
+    // the points before this time are final
+    StateId::Time finalized = 0;
+    // the best path with the final states first and the ones which may still change after them
+    std::vector<StateId> state_ids;
+    // the last final result, where the next route starts
+    MatchResult last{};
+    bool has_last = false;
+  } online_;
 };
 
 /**
@@ -8,12 +8,14 @@
 #include <boost/property_tree/ptree.hpp>
 
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/spatialindex.h>
 #include <valhalla/sif/costconstants.h>
 #include <valhalla/sif/costfactory.h>
 
 #include <valhalla/meili/candidate_search.h>
 #include <valhalla/meili/config.h>
 #include <valhalla/meili/map_matcher.h>
+#include <valhalla/meili/transition_route_cache.h>
 
 namespace valhalla {
 namespace meili {
@@ -33,6 +35,11 @@ public:
     return *candidatequery_;
   }
 
+  // the routes between candidates kept for all the traces matched, nullptr if none are kept
+  const TransitionRouteCache* route_cache() const {
+    return route_cache_.get();
+  }
+
   MapMatcher* Create(const Options& options);
 
   MapMatcher* Create(const Costing costing) {
@@ -58,7 +65,14 @@ private:
 
   sif::CostFactory cost_factory_;
 
+  std::unique_ptr<const baldr::SpatialIndex> spatial_index_;
+
   std::shared_ptr<CandidateGridQuery> candidatequery_;
+
+  std::unique_ptr<TransitionRouteCache> route_cache_;
+
+  // the traffic generation of the graph the routes in the cache were found on
+  uint64_t route_cache_generation_ = 0;
 };
 
 } // namespace meili
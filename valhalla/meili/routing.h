@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <valhalla/baldr/double_bucket_queue.h>
@@ -131,6 +132,25 @@ public:
     nodeid_ = id;
   }
 
+  /**
+   * Moves the ends of the segment and its costs since the origin, used when a route found before
+   * is laid over candidates a little along from where they were.
+   */
+  void Refit(const uint16_t dest, const float source, const float target, const sif::Cost& cost) {
+    dest_ = dest;
+    source_ = source;
+    target_ = target;
+    cost_ = cost;
+    sortcost_ = cost.cost;
+  }
+
+  /**
+   * Set the predecessor, used when a route is copied into another label set.
+   */
+  void set_predecessor(const uint32_t predecessor) {
+    predecessor_ = predecessor;
+  }
+
 private:
   // Must be mutually exclusive, i.e. nodeid.Is_Valid() XOR dest != kInvalidDestination
   baldr::GraphId nodeid_;
@@ -229,6 +249,21 @@ public:
            const sif::TravelMode mode,
            int restriction_idx);
 
+  /**
+   * Add the labels of a route found before, each the predecessor of the next. They are not
+   * queued, the route is only there to be recovered.
+   * @param route  the labels from the origin to the destination
+   * @return the index of the last label
+   */
+  uint32_t put(const std::vector<Label>& route) {
+    for (const auto& label : route) {
+      const uint32_t idx = labels_.size();
+      labels_.push_back(label);
+      labels_.back().set_predecessor(&label == &route.front() ? baldr::kInvalidLabel : idx - 1);
+    }
+    return labels_.size() - 1;
+  }
+
   /**
    * Get the next label from the priority queue. Marks the popped label
    * as permanent (best path found).
@@ -269,6 +304,27 @@ private:
 
 using labelset_ptr_t = std::shared_ptr<LabelSet>;
 
+/**
+ * Where the destinations of a search are in the graph, either at a node or along an edge, by the
+ * index of the destination. Many searches with the same destinations can share one.
+ */
+struct destination_index_t {
+  std::unordered_map<baldr::GraphId, std::unordered_set<uint16_t>> node_dests;
+  std::unordered_map<baldr::GraphId, std::unordered_set<uint16_t>> edge_dests;
+};
+
+/**
+ * Finds where the destinations are in the graph.
+ * @param reader        a graph reader for tile access
+ * @param destinations  the locations of the destinations
+ * @param skip_idx      the index of a destination to leave out, usually that of the origin
+ * @param index         where to put them
+ */
+void index_destinations(baldr::GraphReader& reader,
+                        const std::vector<baldr::PathLocation>& destinations,
+                        const uint16_t skip_idx,
+                        destination_index_t& index);
+
 /**
  * Find the shortest paths between an origin and a set of destinations.
  * @param reader            a graph reader for tile access
@@ -285,6 +341,8 @@ using labelset_ptr_t = std::shared_ptr<LabelSet>;
  * @param turn_cost_table   array of turn costs based on turn angle
  * @param max_dist          how far to allow the expansion to run
  * @param max_time          how long to allow the expansion to run
+ * @param destination_index where all the destinations but the origin are, when many searches go to
+ *                          the same destinations from different origins, found here if nullptr
  * @return a map of destination index to label index so that you can recover a path for any
  * destination
  */
@@ -299,7 +357,8 @@ find_shortest_path(baldr::GraphReader& reader,
                    const Label* edgelabel,
                    const float turn_cost_table[181],
                    const float max_dist,
-                   const float max_time);
+                   const float max_time,
+                   const destination_index_t* destination_index = nullptr);
 
 // Route path iterator. Methods to assist recovering route paths from Labels.
 class RoutePathIterator : public std::iterator<std::forward_iterator_tag, const Label> {
@@ -91,13 +91,20 @@ private:
   using Column = std::vector<State>;
 
 public:
-  StateContainer() : measurements_(), leave_times_(), columns_() {
+  StateContainer() : measurements_(), leave_times_(), columns_(), generation_(0) {
   }
 
   void Clear() {
     measurements_.clear();
     leave_times_.clear();
     columns_.clear();
+    ++generation_;
+  }
+
+  // how many times the container was cleared, the states of the same ids are only the same ones
+  // as long as this doesnt change
+  uint32_t generation() const {
+    return generation_;
   }
 
   const State& state(const StateId& stateid) const {
@@ -194,6 +201,8 @@ private:
   std::vector<double> leave_times_;
 
   std::vector<Column> columns_;
+
+  uint32_t generation_;
 };
 
 } // namespace meili
@@ -6,8 +6,10 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/meili/config.h>
 #include <valhalla/meili/measurement.h>
+#include <valhalla/meili/routing.h>
 #include <valhalla/meili/state.h>
 #include <valhalla/meili/topk_search.h>
+#include <valhalla/meili/transition_route_cache.h>
 #include <valhalla/meili/viterbi_search.h>
 #include <valhalla/sif/dynamiccost.h>
 
@@ -51,9 +53,29 @@ public:
 
   float operator()(const StateId& lhs, const StateId& rhs) const;
 
+  // the routes found are kept in the cache and the ones found before are used before searching
+  void set_route_cache(TransitionRouteCache* cache, const std::string& costing_key) {
+    route_cache_ = cache;
+    route_cache_key_ = costing_key;
+  }
+
 private:
   void UpdateRoute(const StateId& lhs, const StateId& rhs) const;
 
+  // Makes the labels of the routes of the cache from the origin to the right column if all of
+  // them still fit between the candidates as they are now and within the limits of the search
+  bool FromRouteCache(const std::vector<baldr::PathLocation>& locations,
+                      const float max_dist,
+                      const float max_time,
+                      LabelSet& labelset,
+                      std::unordered_map<uint16_t, uint32_t>& results) const;
+
+  // Keeps the routes of the search to the right column in the cache
+  void ToRouteCache(const std::unordered_map<uint16_t, uint32_t>& results,
+                    const LabelSet& labelset,
+                    const float max_dist,
+                    const float max_time) const;
+
   float ClockDistance(const StateId::Time& lhs, const StateId::Time& rhs) const {
     double clk_dist = -1.0;
 
@@ -93,6 +115,20 @@ private:
   float turn_cost_table_[181];
 
   bool match_on_restrictions_{false};
+
+  // The right column the last routes went to, its candidates after the origin at index 0 and
+  // where they are in the graph
+  mutable uint32_t column_generation_{0};
+  mutable StateId::Time column_time_{kInvalidTime};
+  mutable std::vector<baldr::PathLocation> column_locations_;
+  mutable std::vector<StateId> column_stateids_;
+  mutable destination_index_t column_destinations_;
+
+  // The routes shared with other traces, the keys are those of the routes to the right column
+  TransitionRouteCache* route_cache_{nullptr};
+  std::string route_cache_key_;
+  mutable std::vector<std::string> route_keys_;
+  mutable std::vector<TransitionRouteCache::route_t> routes_;
 };
 
 } // namespace meili
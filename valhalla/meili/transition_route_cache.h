@@ -0,0 +1,136 @@
+// -*- mode: c++ -*-
+#ifndef MMP_TRANSITION_ROUTE_CACHE_H_
+#define MMP_TRANSITION_ROUTE_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/pathlocation.h>
+#include <valhalla/meili/routing.h>
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * A least recently used cache of the routes between the candidates of successive measurements,
+ * shared by all of the traces a matcher factory matches. Fleets drive the same roads over and
+ * over so the same transitions come up again and again. A route is found by the edges of its
+ * origin and destination with how far along them they are rounded to a bucket, the edge the
+ * origin was come to by and the costing with all of its options.
+ *
+ * The routes are only good for as long as the graph stays the same, whoever owns the cache has to
+ * clear it when the tiles change. Thread safe as the factory may be used by more than one thread.
+ */
+class TransitionRouteCache {
+public:
+  // How many buckets the offsets along an edge are rounded to
+  static constexpr uint32_t kOffsetBuckets = 16;
+
+  // A route found before
+  struct route_t {
+    // the labels from the origin to the destination, none if it was not found within the limits
+    std::vector<Label> labels;
+    // the limits it was searched within
+    float max_dist;
+    float max_time;
+  };
+
+  /**
+   * Constructor.
+   * @param  max_routes  how many routes to keep at most, nothing is kept if 0
+   */
+  explicit TransitionRouteCache(const size_t max_routes);
+
+  /**
+   * The part of the key that is the same for all the transitions of a trace.
+   * @param  options              the request
+   * @param  turn_penalty_factor  the turn penalty factor the trace is matched with
+   * @return the key of the costing
+   */
+  static std::string CostingKey(const Options& options, const float turn_penalty_factor);
+
+  /**
+   * The key of the route of a transition.
+   * @param  costing_key  the key of the costing of the trace
+   * @param  edgelabel    the label the origin was come to by, if any
+   * @param  origin       the candidate routed from
+   * @param  destination  the candidate routed to
+   * @return the key
+   */
+  static std::string Key(const std::string& costing_key,
+                         const Label* edgelabel,
+                         const baldr::PathLocation& origin,
+                         const baldr::PathLocation& destination);
+
+  /**
+   * Finds the routes of all the keys, or none of them.
+   * @param  keys    the keys of the routes
+   * @param  routes  the routes in the order of the keys if all of them were found
+   * @return whether all of them were found
+   */
+  bool Find(const std::vector<std::string>& keys, std::vector<route_t>& routes);
+
+  /**
+   * Keeps routes, in place of any others of their keys. The least recently used routes are
+   * dropped to keep to the maximum.
+   * @param  keys    the keys of the routes
+   * @param  routes  the routes in the order of the keys
+   */
+  void Put(const std::vector<std::string>& keys, std::vector<route_t>&& routes);
+
+  /**
+   * Counts whether the routes found could be used in place of a search.
+   * @param  hit  whether they could
+   */
+  void Count(const bool hit) {
+    ++(hit ? hits_ : misses_);
+  }
+
+  /**
+   * Drops everything.
+   */
+  void Clear();
+
+  /**
+   * @return how many routes are kept
+   */
+  size_t size() const;
+
+  /**
+   * @return how many searches the routes kept made unnecessary so far
+   */
+  uint64_t hits() const {
+    return hits_;
+  }
+
+  /**
+   * @return how many searches had to be done so far
+   */
+  uint64_t misses() const {
+    return misses_;
+  }
+
+protected:
+  struct entry_t {
+    std::string key;
+    route_t route;
+  };
+
+  mutable std::mutex mutex_;
+  size_t max_routes_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  // most recently used at the front
+  std::list<entry_t> entries_;
+  std::unordered_map<std::string, std::list<entry_t>::iterator> index_;
+};
+
+} // namespace meili
+} // namespace valhalla
+#endif // MMP_TRANSITION_ROUTE_CACHE_H_
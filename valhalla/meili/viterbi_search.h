@@ -2,6 +2,8 @@
 #ifndef MMP_VITERBI_SEARCH_H_
 #define MMP_VITERBI_SEARCH_H_
 
+#include <cstdint>
+#include <limits>
 #include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
@@ -43,6 +45,67 @@ private:
   double costsofar_{0.0}; // Accumulated cost since time = 0
 };
 
+/**
+ * Something for every time of a trace, kept in columns which hold on to their memory when they are
+ * cleared. Matching one trace after the other with the same search then only allocates when a
+ * trace is longer or has more states at a time than the ones before it.
+ */
+template <typename T> class StateColumns {
+public:
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  void clear() {
+    resize(0);
+  }
+
+  // Columns beyond the current size start out empty
+  void resize(const size_t size) {
+    for (size_t time = size; time < size_; ++time) {
+      columns_[time].clear();
+    }
+    if (columns_.size() < size) {
+      columns_.resize(size);
+    }
+    size_ = size;
+  }
+
+  // Adds an empty column at the end
+  std::vector<T>& emplace_back() {
+    resize(size_ + 1);
+    return columns_[size_ - 1];
+  }
+
+  std::vector<T>& back() {
+    return columns_[size_ - 1];
+  }
+
+  std::vector<T>& operator[](const size_t time) {
+    return columns_[time];
+  }
+
+  const std::vector<T>& operator[](const size_t time) const {
+    return columns_[time];
+  }
+
+  // Copies the columns into the ones already there rather than new ones
+  void assign(const StateColumns& other) {
+    resize(other.size_);
+    for (size_t time = 0; time < size_; ++time) {
+      columns_[time].assign(other.columns_[time].cbegin(), other.columns_[time].cend());
+    }
+  }
+
+private:
+  std::vector<std::vector<T>> columns_;
+  size_t size_ = 0;
+};
+
 class IViterbiSearch;
 
 // TODO test it
@@ -112,11 +175,15 @@ protected:
   constexpr static double
   CostSofar(double prev_costsofar, float transition_cost, float emission_cost);
 
-  std::vector<std::vector<StateId>> states_by_time;
+  StateColumns<StateId> states_by_time;
   std::vector<StateId> winner_by_time;
 
 private:
-  std::unordered_set<StateId> added_states_;
+  // Which ids were added at each time, one bit per id. The ids claimed by the top k search count
+  // down from the largest one, they are kept in a set instead
+  static constexpr StateId::Id kMaxDenseId = 1 << 16;
+  StateColumns<uint64_t> added_states_;
+  std::unordered_set<StateId> added_sparse_states_;
   IEmissionCostModel emission_cost_model_;
   ITransitionCostModel transition_cost_model_;
   const stateid_iterator path_end_;
@@ -142,12 +209,13 @@ public:
 private:
   void UpdateLabels(std::vector<StateLabel>& labels,
                     const std::vector<StateLabel>& prev_labels) const;
-  std::vector<StateLabel> InitLabels(const std::vector<StateId>& column,
-                                     bool use_emission_cost) const;
+  void InitLabels(const std::vector<StateId>& column,
+                  bool use_emission_cost,
+                  std::vector<StateLabel>& labels) const;
   StateId FindWinner(const std::vector<StateLabel>& labels) const;
   const StateLabel& GetLabel(const StateId& stateid) const;
 
-  std::vector<std::vector<StateLabel>> history_;
+  StateColumns<StateLabel> history_;
 };
 
 class ViterbiSearch : public IViterbiSearch {
@@ -172,11 +240,82 @@ private:
   StateId::Time IterativeSearch(StateId::Time target, bool request_new_start);
   constexpr static bool IsInvalidCost(double cost);
 
-  std::vector<std::vector<StateId>> unreached_states_by_time;
-  std::unordered_map<StateId, StateLabel> scanned_labels_;
+  // Finds the label of a state which was scanned, nullptr if it wasnt
+  const StateLabel* ScannedLabel(const StateId& stateid) const;
+
+  StateColumns<StateId> unreached_states_by_time;
+  // the scanned labels by the time of their state, only a few per time so they are just looked for
+  StateColumns<StateLabel> scanned_labels_;
   SPQueue<StateLabel> queue_;
   StateId::Time earliest_time_{0};
 };
+
+/**
+ * A list viterbi search which keeps the k best labels of every state in one pass over the
+ * columns, so the k best paths cost one search rather than k of them. Every transition and
+ * emission cost is computed once and shared by all the ranks, the memory is k labels per state.
+ * The best of the k is the winner of the IViterbiSearch interface. Like in the other searches
+ * negative costs are invalid, a column that cant be reached from the one before it starts over
+ * and the paths continue with the winning path before the break.
+ */
+class ListViterbiSearch : public IViterbiSearch {
+public:
+  // A path and what it cost
+  struct Path {
+    double costsofar;
+    std::vector<StateId> stateids;
+  };
+
+  explicit ListViterbiSearch(const uint32_t k,
+                             const IEmissionCostModel& emission_cost_model,
+                             const ITransitionCostModel& transition_cost_model);
+
+  explicit ListViterbiSearch(const uint32_t k);
+
+  ~ListViterbiSearch();
+
+  void Clear() override;
+  void ClearSearch() override;
+  bool AddStateId(const StateId& stateid) override;
+  bool RemoveStateId(const StateId& stateid) override;
+  StateId SearchWinner(StateId::Time time) override;
+  StateId Predecessor(const StateId& stateid) const override;
+  double AccumulatedCost(const StateId& stateid) const override;
+
+  /**
+   * Finds up to k of the best paths that end at a time, the best first.
+   * @param  time  the time the paths end at
+   * @return the paths with the states from the first time to the given time
+   */
+  std::vector<Path> SearchPaths(StateId::Time time);
+
+  uint32_t k() const {
+    return k_;
+  }
+
+private:
+  static constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+  // One of the k labels of a state, the predecessor is its index in the column before it
+  struct Label {
+    double costsofar;
+    uint32_t predecessor;
+    uint32_t rank;
+    bool operator<(const Label& other) const {
+      return costsofar < other.costsofar;
+    }
+  };
+
+  void SearchColumn(StateId::Time time);
+  // the index of a state in its column, kInvalidIndex if it isnt there or not searched yet
+  uint32_t IndexOf(const StateId& stateid) const;
+
+  uint32_t k_;
+  // k slots per state of the columns and how many of them have a label
+  StateColumns<Label> labels_;
+  StateColumns<uint32_t> counts_;
+  std::vector<Label> candidates_;
+};
 } // namespace meili
 } // namespace valhalla
 #endif // MMP_VITERBI_SEARCH_H_
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <valhalla/proto/api.pb.h>
+
+namespace valhalla {
+
+/**
+ * Process wide totals of the statistics that requests collect while they are answered. Each
+ * finished request is recorded once, under a single lock, so keeping them costs next to nothing
+ * compared to answering the request. They are served in the prometheus text format from /metrics.
+ */
+class metrics_t {
+public:
+  /**
+   * @return the metrics of this process
+   */
+  static metrics_t& get();
+
+  /**
+   * Records a finished request, the timings and the memory of its stages into histograms and its
+   * counts into totals, all under the action of the request. Requests without an action are not recorded
+   * @param request      the request with the statistics its stages left in its info
+   * @param status_code  the http status code it was answered with
+   */
+  void record(const Api& request, unsigned status_code);
+
+  /**
+   * Adds the tile cache lookups a stage made since it last reported them
+   * @param stage   the stage which made the lookups
+   * @param hits    how many found their tile in the cache
+   * @param misses  how many had to load the tile
+   */
+  void add_tile_cache_lookups(const std::string& stage, uint64_t hits, uint64_t misses);
+
+  /**
+   * @return everything recorded so far in the prometheus text exposition format
+   */
+  std::string serialize() const;
+
+  /**
+   * Forgets everything recorded so far
+   */
+  void clear();
+
+  // upper bounds in milliseconds of the buckets of the timing histograms
+  static constexpr std::array<double, 16> kBuckets{
+      {0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000}};
+
+  // upper bounds in bytes of the buckets of the memory histograms, 1MiB to 4GiB
+  static constexpr std::array<uint64_t, 7> kMemoryBuckets{
+      {1ull << 20, 1ull << 22, 1ull << 24, 1ull << 26, 1ull << 28, 1ull << 30, 1ull << 32}};
+
+protected:
+  template <size_t bucket_count> struct histogram_t {
+    std::array<uint64_t, bucket_count + 1> buckets{};
+    double sum = 0;
+    uint64_t count = 0;
+
+    template <typename bound_t>
+    void add(const std::array<bound_t, bucket_count>& bounds, double value) {
+      ++buckets[std::lower_bound(bounds.cbegin(), bounds.cend(), value) - bounds.cbegin()];
+      sum += value;
+      ++count;
+    }
+  };
+
+  mutable std::mutex mutex_;
+  // keyed by action and statistic name
+  std::map<std::pair<std::string, std::string>, histogram_t<kBuckets.size()>> timings_;
+  std::map<std::pair<std::string, std::string>, histogram_t<kMemoryBuckets.size()>> memory_;
+  std::map<std::pair<std::string, std::string>, double> counts_;
+  // keyed by action and status code
+  std::map<std::pair<std::string, unsigned>, uint64_t> responses_;
+  // keyed by stage, hits and misses
+  std::map<std::string, std::pair<uint64_t, uint64_t>> tile_cache_;
+};
+
+} // namespace valhalla
@@ -3,6 +3,7 @@
 #define VALHALLA_MIDGARD_DISTANCEAPPROXIMATOR_H_
 
 #include <cmath>
+#include <cstddef>
 
 #include <valhalla/midgard/constants.h>
 
@@ -78,6 +79,25 @@ public:
            sqr((ll.lng() - centerlng_) * m_per_lng_degree_);
   }
 
+  /**
+   * Approximates the squared distances of many positions to the test point at once, the same as
+   * the method above does for one. The positions are given as separate arrays of longitudes and
+   * latitudes so that the loop has no branches and the compiler can vectorize it.
+   * @param   lngs          Longitudes of the points (degrees)
+   * @param   lats          Latitudes of the points (degrees)
+   * @param   count         How many points there are
+   * @param   sq_distances  Where to write the squared distances in meters, count of them
+   */
+  void DistanceSquared(const typename PointT::first_type* lngs,
+                       const typename PointT::first_type* lats,
+                       const size_t count,
+                       typename PointT::first_type* sq_distances) const {
+    for (size_t i = 0; i < count; ++i) {
+      sq_distances[i] = sqr((lats[i] - centerlat_) * kMetersPerDegreeLat) +
+                        sqr((lngs[i] - centerlng_) * m_per_lng_degree_);
+    }
+  }
+
   /**
    * Approximates arc distance between 2 lat,lng positions using meters per
    * latitude and longitude degree.  Uses the mid latitude of the 2 positions
@@ -168,25 +168,24 @@ container_t decode7(const std::string& encoded, const double precision = DECODE_
  */
 template <class container_t>
 std::string encode(const container_t& points, const int precision = ENCODE_PRECISION) {
-  // a place to keep the output
-  std::string output;
-  // unless the shape is very course you should probably only need about 3 bytes
-  // per coord, which is 6 bytes with 2 coords, so we overshoot to 8 just in case
-  output.reserve(points.size() * 8);
+  // a place to keep the output, sized for the worst case of 7 chunks of 5 bits for each of the
+  // two coordinates so that the chunks can be written without checking the capacity each time
+  std::string output(points.size() * 14, '\0');
+  char* out = &output[0];
 
   // handy lambda to turn an integer into an encoded string
-  auto serialize = [&output](int number) {
+  auto serialize = [&out](int number) {
     // move the bits left 1 position and flip all the bits if it was a negative number
     number = number < 0 ? ~(static_cast<unsigned int>(number) << 1) : (number << 1);
     // write 5 bit chunks of the number
     while (number >= 0x20) {
       int nextValue = (0x20 | (number & 0x1f)) + 63;
-      output.push_back(static_cast<char>(nextValue));
+      *out++ = static_cast<char>(nextValue);
       number >>= 5;
     }
     // write the last chunk
     number += 63;
-    output.push_back(static_cast<char>(number));
+    *out++ = static_cast<char>(number);
   };
 
   // this is an offset encoding so we remember the last point we saw
@@ -203,6 +202,7 @@ std::string encode(const container_t& points, const int precision = ENCODE_PRECI
     last_lon = lon;
     last_lat = lat;
   }
+  output.resize(out - output.data());
   return output;
 }
 
@@ -214,14 +214,13 @@ std::string encode(const container_t& points, const int precision = ENCODE_PRECI
  */
 template <class container_t>
 std::string encode7(const container_t& points, const int precision = ENCODE_PRECISION) {
-  // a place to keep the output
-  std::string output;
-  // unless the shape is very course you should probably only need about 3 bytes
-  // per coord, which is 6 bytes with 2 coords, so we overshoot to 8 just in case
-  output.reserve(points.size() * 8);
+  // a place to keep the output, sized for the worst case of 5 bytes for each of the two
+  // coordinates so that the bytes can be written without checking the capacity each time
+  std::string output(points.size() * 10, '\0');
+  char* out = &output[0];
 
   // handy lambda to turn an integer into an encoded string
-  auto serialize = [&output](int number) {
+  auto serialize = [&out](int number) {
     // get the sign bit down on the least significant end to
     // make the most significant bits mostly zeros
     number = number < 0 ? ~(static_cast<unsigned int>(number) << 1) : number << 1;
@@ -229,11 +228,11 @@ std::string encode7(const container_t& points, const int precision = ENCODE_PREC
     while (number > 0x7f) {
       // marking the most significant bit means there are more pieces to come
       int nextValue = (0x80 | (number & 0x7f));
-      output.push_back(static_cast<char>(nextValue));
+      *out++ = static_cast<char>(nextValue);
       number >>= 7;
     }
     // write the last chunk
-    output.push_back(static_cast<char>(number & 0x7f));
+    *out++ = static_cast<char>(number & 0x7f);
   };
 
   // this is an offset encoding so we remember the last point we saw
@@ -250,6 +249,7 @@ std::string encode7(const container_t& points, const int precision = ENCODE_PREC
     last_lon = lon;
     last_lat = lat;
   }
+  output.resize(out - output.data());
   return output;
 }
 
@@ -3,10 +3,13 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <functional>
 #include <limits>
 #include <list>
 #include <map>
+#include <thread>
+#include <unordered_map>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/polyline2.h>
 #include <valhalla/midgard/tiles.h>
@@ -51,14 +54,32 @@ public:
    * @param  value    Value to set at the tile/grid location.
    * @param  get_data Functor to get the desired data value
    * @param  set_data Functor to set the desired data value
+   * @return Bit mask of the dimensions whose value was lowered.
    */
-  inline void SetIfLessThan(const int tile_id, const value_type& value) {
+  inline uint32_t SetIfLessThan(const int tile_id, const value_type& value) {
+    uint32_t lowered = 0;
     if (tile_id >= 0 && tile_id < data_.size()) {
       auto& current_value = data_[tile_id];
       for (size_t i = 0; i < dimensions_t; ++i) {
-        current_value[i] = std::min(value[i], current_value[i]);
+        if (value[i] < current_value[i]) {
+          current_value[i] = value[i];
+          lowered |= 1 << i;
+        }
       }
     }
+    return lowered;
+  }
+
+  /**
+   * Set the value of one dimension at a specified tile Id back to the value the
+   * grid was initialized with, as if it had never been reached.
+   * @param  tile_id    Tile Id to reset.
+   * @param  dimension  Dimension to reset.
+   */
+  inline void Reset(const int tile_id, const size_t dimension) {
+    if (tile_id >= 0 && tile_id < data_.size()) {
+      data_[tile_id][dimension] = max_value_[dimension];
+    }
   }
 
   using contour_t = std::list<PointLL>;
@@ -83,90 +104,21 @@ public:
    * @param generalize           Generalization factor in meters. A special value
    *                             kOptimalGeneralization will let the method choose
    *                             an optimal generalization factor based on grid size.
+   * @param concurrency          How many threads to generate the contours with. The grid is split
+   *                             into bands of rows whose segments are found in parallel, then the
+   *                             segments of each contour are joined in the order of the rows so
+   *                             the result is the same for any number of threads.
    *
    * @return contour line geometries with the larger intervals first (for rendering purposes)
    */
   contours_t GenerateContours(std::vector<contour_interval_t>& intervals,
                               const bool rings_only = false,
                               const float denoise = 1.f,
-                              const float generalize = 200.f) const {
+                              const float generalize = 200.f,
+                              const unsigned int concurrency = 1) const {
     // sort the contours first on the metric index then on the values with the bigger contours first
     std::sort(intervals.begin(), intervals.end(), std::greater<>());
 
-    // Values at tile corners and center (0 element is center)
-    int sh[5];
-    typename PointLL::first_type s[5]; // Values at the tile corners and center
-    PointLL tile_corners[5];           // PointLL at tile corners and center
-    int m1, m2, m3;                    // Indices into the tile corners
-    PointLL pt1, pt2;                  // The intersection points in the tile
-    int tile_inc[4] = {0, 1, this->ncolumns_ + 1, this->ncolumns_};
-
-    // Find the intersection along a tile edge
-    auto intersect = [&tile_corners, &s](int p1, int p2) {
-      auto ds = s[p2] - s[p1];
-      return PointLL((s[p2] * tile_corners[p1].first - s[p1] * tile_corners[p2].first) / ds,
-                     (s[p2] * tile_corners[p1].second - s[p1] * tile_corners[p2].second) / ds);
-    };
-
-    // In the tight loop below, we need to decide where a contour intersects the triangles that make
-    // up the given tile. this works out to a number of discrete cases which we lookup using the table
-    // below. based on the case we perform the appropriate intersection. to avoid branching we store
-    // the intersection operation for each case in an array and perform the correct one by calling the
-    // function stored in the array
-    int case_table[3][3][3] = {
-        {{0, 0, 8}, {0, 2, 5}, {7, 6, 9}},
-        {{0, 3, 4}, {1, 3, 1}, {4, 3, 0}},
-        {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}},
-    };
-    std::array<std::function<void()>, 10> cases{
-        []() {},
-        // Line between vertices 1 and 2
-        [&]() {
-          pt1 = tile_corners[m1];
-          pt2 = tile_corners[m2];
-        },
-        // Line between vertices 2 and 3
-        [&]() {
-          pt1 = tile_corners[m2];
-          pt2 = tile_corners[m3];
-        },
-        // Line between vertices 3 and 1
-        [&]() {
-          pt1 = tile_corners[m3];
-          pt2 = tile_corners[m1];
-        },
-        // Line between vertex 1 and side 2-3
-        [&]() {
-          pt1 = tile_corners[m1];
-          pt2 = intersect(m2, m3);
-        },
-        // Line between vertex 2 and side 3-1
-        [&]() {
-          pt1 = tile_corners[m2];
-          pt2 = intersect(m3, m1);
-        },
-        // Line between vertex 3 and side 1-2
-        [&]() {
-          pt1 = tile_corners[m3];
-          pt2 = intersect(m1, m2);
-        },
-        // Line between sides 1-2 and 2-3
-        [&]() {
-          pt1 = intersect(m1, m2);
-          pt2 = intersect(m2, m3);
-        },
-        // Line between sides 2-3 and 3-1
-        [&]() {
-          pt1 = intersect(m2, m3);
-          pt2 = intersect(m3, m1);
-        },
-        // Line between sides 3-1 and 1-2
-        [&]() {
-          pt1 = intersect(m3, m1);
-          pt2 = intersect(m1, m2);
-        },
-    };
-
     // which metrics do we need contours for
     auto _ = std::make_pair(intervals.cbegin(), intervals.cend());
     std::vector<decltype(_)> metrics{std::move(_)};
@@ -177,186 +129,283 @@ public:
       }
     }
 
-    // we need something to hold each iso-line
-    contours_t contours(intervals.size(), std::list<feature_t>{feature_t{}});
-
-    // and something to find them quickly
-    using contour_lookup_t = std::unordered_map<PointLL, typename feature_t::iterator>;
-    std::vector<contour_lookup_t> lookups(intervals.size());
-    // TODO: preallocate the lookups for each interval
-
-    // For each metric we tracked
-    for (const auto& metric : metrics) {
-      size_t metric_index = std::get<0>(*metric.first);
-
-      // For each cell, skipping the outer rim since its out of bounds
-      for (int row = 1; row < this->nrows_ - 1; ++row) {
-        for (int col = 1; col < this->ncolumns_ - 1; ++col) {
-          int tileid = this->TileId(col, row);
-          auto cell1 = data_[tileid][metric_index];
-          auto cell2 = data_[tileid + this->ncolumns_][metric_index];     // TileId(col,   row+1)];
-          auto cell3 = data_[tileid + 1][metric_index];                   // TileId(col+1, row)];
-          auto cell4 = data_[tileid + this->ncolumns_ + 1][metric_index]; // TileId(col+1, row+1)];
-          auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
-          auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
-
-          // Continue if outside the range of contour values for this metric_index
-          if (dmax < std::get<1>(*std::prev(metric.second)) || dmin > std::get<1>(*metric.first)) {
-            continue;
-          }
-
-          // For each requested contour value
-          for (size_t i = 0; i < intervals.size(); ++i) {
-            // some setup to process this contour
-            auto& lookup = lookups[i];
-            auto& contour = contours[i];
-            auto contour_value = std::get<1>(intervals[i]);
-
-            // we skip this contour if its interested in a different metric_index or its value
-            // would not intersect this cell
-            if (std::get<0>(intervals[i]) != metric_index || contour_value < dmin ||
-                contour_value > dmax) {
+    // Find the segments of every contour in a band of rows, for each contour in the order of the
+    // cells and triangles of the band
+    using segments_t = std::vector<std::vector<std::pair<PointLL, PointLL>>>;
+    auto band_segments = [&](const int row_begin, const int row_end, segments_t& segments) {
+      // Values at tile corners and center (0 element is center)
+      int sh[5];
+      typename PointLL::first_type s[5]; // Values at the tile corners and center
+      PointLL tile_corners[5];           // PointLL at tile corners and center
+      int m1, m2, m3;                    // Indices into the tile corners
+      PointLL pt1, pt2;                  // The intersection points in the tile
+      int tile_inc[4] = {0, 1, this->ncolumns_ + 1, this->ncolumns_};
+
+      // Find the intersection along a tile edge
+      auto intersect = [&tile_corners, &s](int p1, int p2) {
+        auto ds = s[p2] - s[p1];
+        return PointLL((s[p2] * tile_corners[p1].first - s[p1] * tile_corners[p2].first) / ds,
+                       (s[p2] * tile_corners[p1].second - s[p1] * tile_corners[p2].second) / ds);
+      };
+
+      // In the tight loop below, we need to decide where a contour intersects the triangles that
+      // make up the given tile. this works out to a number of discrete cases which we lookup using
+      // the table below. based on the case we perform the appropriate intersection. to avoid
+      // branching we store the intersection operation for each case in an array and perform the
+      // correct one by calling the function stored in the array
+      int case_table[3][3][3] = {
+          {{0, 0, 8}, {0, 2, 5}, {7, 6, 9}},
+          {{0, 3, 4}, {1, 3, 1}, {4, 3, 0}},
+          {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}},
+      };
+      std::array<std::function<void()>, 10> cases{
+          []() {},
+          // Line between vertices 1 and 2
+          [&]() {
+            pt1 = tile_corners[m1];
+            pt2 = tile_corners[m2];
+          },
+          // Line between vertices 2 and 3
+          [&]() {
+            pt1 = tile_corners[m2];
+            pt2 = tile_corners[m3];
+          },
+          // Line between vertices 3 and 1
+          [&]() {
+            pt1 = tile_corners[m3];
+            pt2 = tile_corners[m1];
+          },
+          // Line between vertex 1 and side 2-3
+          [&]() {
+            pt1 = tile_corners[m1];
+            pt2 = intersect(m2, m3);
+          },
+          // Line between vertex 2 and side 3-1
+          [&]() {
+            pt1 = tile_corners[m2];
+            pt2 = intersect(m3, m1);
+          },
+          // Line between vertex 3 and side 1-2
+          [&]() {
+            pt1 = tile_corners[m3];
+            pt2 = intersect(m1, m2);
+          },
+          // Line between sides 1-2 and 2-3
+          [&]() {
+            pt1 = intersect(m1, m2);
+            pt2 = intersect(m2, m3);
+          },
+          // Line between sides 2-3 and 3-1
+          [&]() {
+            pt1 = intersect(m2, m3);
+            pt2 = intersect(m3, m1);
+          },
+          // Line between sides 3-1 and 1-2
+          [&]() {
+            pt1 = intersect(m3, m1);
+            pt2 = intersect(m1, m2);
+          },
+      };
+
+      // For each metric we tracked
+      for (const auto& metric : metrics) {
+        size_t metric_index = std::get<0>(*metric.first);
+
+        // For each cell of the band, the outer rim of the grid is out of bounds
+        for (int row = row_begin; row < row_end; ++row) {
+          for (int col = 1; col < this->ncolumns_ - 1; ++col) {
+            int tileid = this->TileId(col, row);
+            auto cell1 = data_[tileid][metric_index];
+            auto cell2 = data_[tileid + this->ncolumns_][metric_index];     // TileId(col, row+1)
+            auto cell3 = data_[tileid + 1][metric_index];                   // TileId(col+1, row)
+            auto cell4 = data_[tileid + this->ncolumns_ + 1][metric_index]; // TileId(col+1, row+1)
+            auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
+            auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
+
+            // Continue if outside the range of contour values for this metric_index
+            if (dmax < std::get<1>(*std::prev(metric.second)) ||
+                dmin > std::get<1>(*metric.first)) {
               continue;
             }
 
-            for (int m = 4; m > 0; m--) {
-              int newtileid = tileid + tile_inc[m - 1];
-              // Make sure the tile corner value is not set to the max_value
-              // (messes up the intersect method). Set a value slightly above
-              // the contour (e.g. 1 minute higher).
-              // TODO - the value 1 is a bit of a hack.
-              float nd = data_[newtileid][metric_index];
-              s[m] = nd < max_value_[metric_index] ? nd - contour_value : 1.0f;
-              tile_corners[m] = this->Base(newtileid);
-              sh[m] = (s[m] > 0.0f) - (s[m] < 0.0f); // pos = 1, neg = -1, 0 = 0
-            }
-            s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
-            tile_corners[0] = this->Center(tileid);
-            sh[0] = (s[0] > 0.0f) - (s[0] < 0.0f); // pos = 1, neg = -1, 0 = 0
-
-            /*
-             Note: at this stage the relative heights of the corners and the
-             centre are in the h array, and the corresponding coordinates are
-             in the xh and yh arrays. The centre of the box is indexed by 0
-             and the 4 corners by 1 to 4 as shown below.
-             Each triangle is then indexed by the parameter m, and the 3
-             vertices of each triangle are indexed by parameters m1,m2,and m3.
-             It is assumed that the centre of the box is always vertex 2
-             though this is important only when all 3 vertices lie exactly on
-             the same contour level, in which case only the side of the box
-             is drawn.
-                vertex 4 +-------------------+ vertex 3
-                         | \               / |
-                         |   \    m-3    /   |
-                         |     \       /     |
-                         |       \   /       |
-                         |  m=2    X   m=2   |       the centre is vertex 0
-                         |       /   \       |
-                         |     /       \     |
-                         |   /    m=1    \   |
-                         | /               \ |
-                vertex 1 +-------------------+ vertex 2
-            */
-
-            // Scan each triangle in the box
-            for (int m = 1; m <= 4; m++) {
-              // figure out which intersection we need to do
-              m1 = m;
-              m2 = 0;
-              m3 = (m != 4) ? m + 1 : 1;
-              int case_index = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
-
-              // there is no intersection of this triangle
-              if (case_index == 0) {
-                continue;
-              }
+            // For each requested contour value
+            for (size_t i = 0; i < intervals.size(); ++i) {
+              // some setup to process this contour
+              auto contour_value = std::get<1>(intervals[i]);
 
-              // do the intersection, assigns to pt1 and pt2 inside lambdas defined above
-              cases[case_index]();
-
-              // this isnt a segment..
-              if (pt1 == pt2) {
+              // we skip this contour if its interested in a different metric_index or its value
+              // would not intersect this cell
+              if (std::get<0>(intervals[i]) != metric_index || contour_value < dmin ||
+                  contour_value > dmax) {
                 continue;
               }
 
-              // see if we have anything to connect this segment to
-              typename contour_lookup_t::iterator rec_a = lookup.find(pt1);
-              typename contour_lookup_t::iterator rec_b = lookup.find(pt2);
-              if (rec_b != lookup.end()) {
-                std::swap(pt1, pt2);
-                std::swap(rec_a, rec_b);
+              for (int m = 4; m > 0; m--) {
+                int newtileid = tileid + tile_inc[m - 1];
+                // Make sure the tile corner value is not set to the max_value
+                // (messes up the intersect method). Set a value slightly above
+                // the contour (e.g. 1 minute higher).
+                // TODO - the value 1 is a bit of a hack.
+                float nd = data_[newtileid][metric_index];
+                s[m] = nd < max_value_[metric_index] ? nd - contour_value : 1.0f;
+                tile_corners[m] = this->Base(newtileid);
+                sh[m] = (s[m] > 0.0f) - (s[m] < 0.0f); // pos = 1, neg = -1, 0 = 0
               }
-
-              // we want to merge two records
-              if (rec_b != lookup.end()) {
-                // get the segments in question and remove their lookup info
-                auto segment_a = rec_a->second;
-                bool head_a = rec_a->first == segment_a->front();
-                auto segment_b = rec_b->second;
-                bool head_b = rec_b->first == segment_b->front();
-                lookup.erase(rec_a);
-                lookup.erase(rec_b);
-
-                // this segment is now a ring
-                if (segment_a == segment_b) {
-                  segment_a->push_back(segment_a->front());
+              s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
+              tile_corners[0] = this->Center(tileid);
+              sh[0] = (s[0] > 0.0f) - (s[0] < 0.0f); // pos = 1, neg = -1, 0 = 0
+
+              /*
+               Note: at this stage the relative heights of the corners and the
+               centre are in the h array, and the corresponding coordinates are
+               in the xh and yh arrays. The centre of the box is indexed by 0
+               and the 4 corners by 1 to 4 as shown below.
+               Each triangle is then indexed by the parameter m, and the 3
+               vertices of each triangle are indexed by parameters m1,m2,and m3.
+               It is assumed that the centre of the box is always vertex 2
+               though this is important only when all 3 vertices lie exactly on
+               the same contour level, in which case only the side of the box
+               is drawn.
+                  vertex 4 +-------------------+ vertex 3
+                           | \               / |
+                           |   \    m-3    /   |
+                           |     \       /     |
+                           |       \   /       |
+                           |  m=2    X   m=2   |       the centre is vertex 0
+                           |       /   \       |
+                           |     /       \     |
+                           |   /    m=1    \   |
+                           | /               \ |
+                  vertex 1 +-------------------+ vertex 2
+              */
+
+              // Scan each triangle in the box
+              for (int m = 1; m <= 4; m++) {
+                // figure out which intersection we need to do
+                m1 = m;
+                m2 = 0;
+                m3 = (m != 4) ? m + 1 : 1;
+                int case_index = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
+
+                // there is no intersection of this triangle
+                if (case_index == 0) {
                   continue;
                 }
 
-                // erase the other lookups
-                lookup.erase(
-                    lookup.find(pt1 == segment_a->front() ? segment_a->back() : segment_a->front()));
-                lookup.erase(
-                    lookup.find(pt2 == segment_b->front() ? segment_b->back() : segment_b->front()));
-
-                // add b to a
-                if (!head_a && head_b) {
-                  segment_a->splice(segment_a->end(), *segment_b);
-                  contour.front().erase(segment_b);
-                } // add a to b
-                else if (!head_b && head_a) {
-                  segment_b->splice(segment_b->end(), *segment_a);
-                  contour.front().erase(segment_a);
-                  segment_a = segment_b;
-                } // flip a and add b
-                else if (head_a && head_b) {
-                  segment_a->reverse();
-                  segment_a->splice(segment_a->end(), *segment_b);
-                  contour.front().erase(segment_b);
-                } // flip b and add to a
-                else if (!head_a && !head_b) {
-                  segment_b->reverse();
-                  segment_a->splice(segment_a->end(), *segment_b);
-                  contour.front().erase(segment_b);
-                }
+                // do the intersection, assigns to pt1 and pt2 inside lambdas defined above
+                cases[case_index]();
 
-                // update the look up
-                lookup.emplace(segment_a->front(), segment_a);
-                lookup.emplace(segment_a->back(), segment_a);
-              } // ap/prepend to an existing one
-              else if (rec_a != lookup.end()) {
-                // it goes on the front
-                if (rec_a->second->front() == pt1) {
-                  rec_a->second->push_front(pt2);
-                  // it goes on the back
-                } else {
-                  rec_a->second->push_back(pt2);
+                // this isnt a segment..
+                if (pt1 == pt2) {
+                  continue;
                 }
-
-                // update the lookup table
-                lookup.emplace(pt2, rec_a->second);
-                lookup.erase(rec_a);
-              } // this is an orphan segment for now
-              else {
-                contour.front().push_front(contour_t{pt1, pt2});
-                lookup.emplace(pt1, contour.front().begin());
-                lookup.emplace(pt2, contour.front().begin());
+                segments[i].emplace_back(pt1, pt2);
               }
+            } // Each contour
+          }   // Each tile col
+        }     // Each tile row
+      }       // Each dimension of the grid
+    };
+
+    // Split the rows into more bands than threads so that they share the work evenly
+    const int rows = std::max(this->nrows_ - 2, 0);
+    const int band_count = std::max(std::min(static_cast<int>(concurrency) * 4, rows), 1);
+    std::vector<segments_t> bands(band_count, segments_t(intervals.size()));
+    parallel_for(band_count, concurrency, [&](const size_t band) {
+      band_segments(1 + rows * band / band_count, 1 + rows * (band + 1) / band_count, bands[band]);
+    });
+
+    // we need something to hold each iso-line
+    contours_t contours(intervals.size(), std::list<feature_t>{feature_t{}});
+
+    // Join the segments of each contour into lines, one contour per thread
+    parallel_for(intervals.size(), concurrency, [&](const size_t i) {
+      // something to find the lines quickly
+      using contour_lookup_t = std::unordered_map<PointLL, typename feature_t::iterator>;
+      contour_lookup_t lookup;
+      auto& contour = contours[i];
+      for (auto& band : bands) {
+        for (const auto& segment : band[i]) {
+          PointLL pt1 = segment.first;
+          PointLL pt2 = segment.second;
+          // see if we have anything to connect this segment to
+          typename contour_lookup_t::iterator rec_a = lookup.find(pt1);
+          typename contour_lookup_t::iterator rec_b = lookup.find(pt2);
+          if (rec_b != lookup.end()) {
+            std::swap(pt1, pt2);
+            std::swap(rec_a, rec_b);
+          }
+
+          // we want to merge two records
+          if (rec_b != lookup.end()) {
+            // get the segments in question and remove their lookup info
+            auto segment_a = rec_a->second;
+            bool head_a = rec_a->first == segment_a->front();
+            auto segment_b = rec_b->second;
+            bool head_b = rec_b->first == segment_b->front();
+            lookup.erase(rec_a);
+            lookup.erase(rec_b);
+
+            // this segment is now a ring
+            if (segment_a == segment_b) {
+              segment_a->push_back(segment_a->front());
+              continue;
+            }
+
+            // erase the other lookups
+            lookup.erase(
+                lookup.find(pt1 == segment_a->front() ? segment_a->back() : segment_a->front()));
+            lookup.erase(
+                lookup.find(pt2 == segment_b->front() ? segment_b->back() : segment_b->front()));
+
+            // add b to a
+            if (!head_a && head_b) {
+              segment_a->splice(segment_a->end(), *segment_b);
+              contour.front().erase(segment_b);
+            } // add a to b
+            else if (!head_b && head_a) {
+              segment_b->splice(segment_b->end(), *segment_a);
+              contour.front().erase(segment_a);
+              segment_a = segment_b;
+            } // flip a and add b
+            else if (head_a && head_b) {
+              segment_a->reverse();
+              segment_a->splice(segment_a->end(), *segment_b);
+              contour.front().erase(segment_b);
+            } // flip b and add to a
+            else if (!head_a && !head_b) {
+              segment_b->reverse();
+              segment_a->splice(segment_a->end(), *segment_b);
+              contour.front().erase(segment_b);
             }
-          } // Each contour
-        }   // Each tile col
-      }     // Each tile row
-    }       // Each dimension of the grid
+
+            // update the look up
+            lookup.emplace(segment_a->front(), segment_a);
+            lookup.emplace(segment_a->back(), segment_a);
+          } // ap/prepend to an existing one
+          else if (rec_a != lookup.end()) {
+            // it goes on the front
+            if (rec_a->second->front() == pt1) {
+              rec_a->second->push_front(pt2);
+              // it goes on the back
+            } else {
+              rec_a->second->push_back(pt2);
+            }
+
+            // update the lookup table
+            lookup.emplace(pt2, rec_a->second);
+            lookup.erase(rec_a);
+          } // this is an orphan segment for now
+          else {
+            contour.front().push_front(contour_t{pt1, pt2});
+            lookup.emplace(pt1, contour.front().begin());
+            lookup.emplace(pt2, contour.front().begin());
+          }
+        }
+        // the segments of this band are no longer needed
+        std::vector<std::pair<PointLL, PointLL>>().swap(band[i]);
+      }
+    });
 
     // If the generalization value equals kOptimalGeneralization then set
     // the generalization factor to 1/4 of the grid size
@@ -368,8 +417,9 @@ public:
     // some info about the area the image covers
     auto c = this->TileBounds().Center();
     auto h = this->tilesize_ / 2;
-    // for each contour
-    for (auto& collection : contours) {
+    // clean up each contour on its own thread
+    parallel_for(contours.size(), concurrency, [&](const size_t i) {
+      auto& collection = contours[i];
       auto& contour = collection.front();
       // they only wanted rings
       if (rings_only) {
@@ -411,12 +461,38 @@ public:
         }
         collection.pop_front();
       }
-    }
+    });
 
     return contours;
   }
 
 protected:
+  // Calls work for every index below count, spread over up to concurrency threads
+  template <typename work_t>
+  static void parallel_for(const size_t count, const unsigned int concurrency, const work_t& work) {
+    const size_t thread_count = std::min(static_cast<size_t>(concurrency), count);
+    if (thread_count <= 1) {
+      for (size_t i = 0; i < count; ++i) {
+        work(i);
+      }
+      return;
+    }
+    std::atomic<size_t> next(0);
+    auto run = [&]() {
+      for (size_t i = next++; i < count; i = next++) {
+        work(i);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; ++t) {
+      threads.emplace_back(run);
+    }
+    run();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
   value_type max_value_;         // Maximum value stored in the tile
   std::vector<value_type> data_; // Data value within each tile
 };
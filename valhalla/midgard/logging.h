@@ -28,6 +28,9 @@ public:
   Logger* Produce(const LoggingConfig& config) const;
 };
 
+// statically get the factory, to produce loggers other than the one used by the macros
+LoggerFactory& GetFactory();
+
 // register your custom loggers here
 bool RegisterLogger(const std::string& name, LoggerCreator function_ptr);
 
@@ -42,6 +45,8 @@ public:
   virtual ~Logger();
   virtual void Log(const std::string&, const LogLevel);
   virtual void Log(const std::string&, const std::string& custom_directive = " [TRACE] ");
+  // write lines which are already formatted, used by loggers that batch them up
+  virtual void Write(const std::string& lines);
 
 protected:
   std::mutex lock;
@@ -58,6 +63,8 @@ void Log(const std::string&, const std::string& custom_directive = " [TRACE] ");
 // try something like:
 // logging::Configure({ {"type", "std_out"}, {"color", ""} })
 // logging::Configure({ {"type", "file"}, {"file_name", "test.log"}, {"reopen_interval", "1"} })
+// logging::Configure({ {"type", "async"}, {"async_type", "file"}, {"file_name", "test.log"},
+//                      {"queue_size", "4096"}, {"drop_on_full", "true"}, {"flush_interval", "100"} })
 void Configure(const LoggingConfig& config);
 
 // guarding against redefinitions
@@ -100,6 +100,21 @@ public:
    */
   PrecisionT Distance(const GeoPoint& ll2) const;
 
+  /**
+   * Calculates the distances in meters between consecutive positions of a polyline, each the
+   * same as Distance would give, from separate arrays of longitudes and latitudes. The sines and
+   * cosines of each latitude are computed once for both segments that share the position and the
+   * loop has no branches so that the compiler can vectorize it.
+   * @param   lngs       Longitudes of the count + 1 positions
+   * @param   lats       Latitudes of the count + 1 positions
+   * @param   count      How many segments there are
+   * @param   distances  Where to write the length of each segment, count of them
+   */
+  static void Distances(const PrecisionT* lngs,
+                        const PrecisionT* lats,
+                        size_t count,
+                        PrecisionT* distances);
+
   /**
    * Approximates the distance squared between two lng,lat points - uses
    * the DistanceApproximator.
@@ -2,6 +2,7 @@
 #define VALHALLA_MJOLNIR_SEQUENCE_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cmath>
 #include <cstdint>
@@ -14,8 +15,10 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -30,6 +33,9 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #endif // _WIN32
 #include <fcntl.h>
 
@@ -126,6 +132,114 @@ inline int munmap(void* addr, size_t length) {
 namespace valhalla {
 namespace midgard {
 
+// Extra ways to map a read only file, the ones the platform doesnt support are ignored or throw
+struct map_options_t {
+  // fault the whole file in up front rather than page by page on first access
+  bool populate = false;
+  // copy the file into anonymous memory backed by transparent huge pages which cuts down on tlb
+  // misses. the copy is private to the process so its no longer shared through the page cache
+  bool huge_pages = false;
+  // place a copy of the file on numa nodes, "interleave" spreads it over all of them and a comma
+  // separated list of node numbers binds it to just those. the page cache ignores numa policies
+  // so this implies a private copy
+  std::string numa;
+
+  bool copy() const {
+    return huge_pages || !numa.empty();
+  }
+};
+
+// A private read only copy of some memory placed according to the options
+class anonymous_copy {
+public:
+  anonymous_copy(const char* source, size_t size, const map_options_t& options)
+      : ptr(nullptr), length(0) {
+#ifdef __linux__
+    // huge pages need a huge page aligned range so we over allocate and trim the ends
+    constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    const size_t aligned_size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    void* raw = mmap(nullptr, aligned_size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      throw std::runtime_error(std::string("(mmap): ") + strerror(errno));
+    }
+    auto start = (reinterpret_cast<uintptr_t>(raw) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    auto head = start - reinterpret_cast<uintptr_t>(raw);
+    if (head) {
+      munmap(raw, head);
+    }
+    if (HUGE_PAGE_SIZE - head) {
+      munmap(reinterpret_cast<char*>(start) + aligned_size, HUGE_PAGE_SIZE - head);
+    }
+    ptr = reinterpret_cast<char*>(start);
+    length = aligned_size;
+
+    // the policies have to be in place before the copy touches the pages
+    if (options.huge_pages && madvise(ptr, length, MADV_HUGEPAGE)) {
+      auto error = std::string("(madvise): ") + strerror(errno);
+      munmap(ptr, length);
+      throw std::runtime_error(error);
+    }
+    if (!options.numa.empty() && !bind(options.numa)) {
+      auto error = std::string("(mbind): ") + strerror(errno);
+      munmap(ptr, length);
+      throw std::runtime_error(error);
+    }
+    std::memcpy(ptr, source, size);
+    mprotect(ptr, length, PROT_READ);
+#else
+    throw std::runtime_error("Copying a mapped file into huge pages or onto numa nodes is only "
+                             "supported on linux");
+#endif
+  }
+
+  ~anonymous_copy() {
+#ifdef __linux__
+    if (ptr) {
+      munmap(ptr, length);
+    }
+#endif
+  }
+
+  anonymous_copy(const anonymous_copy&) = delete;
+  anonymous_copy& operator=(const anonymous_copy&) = delete;
+
+  const char* get() const {
+    return ptr;
+  }
+
+protected:
+#ifdef __linux__
+  // sets the memory policy of the copy, we go straight to the syscall to avoid needing libnuma
+  bool bind(const std::string& numa) {
+    constexpr int MPOL_BIND_MODE = 2;
+    constexpr int MPOL_INTERLEAVE_MODE = 3;
+    constexpr size_t MAX_NODES = 64;
+    uint64_t nodes = 0;
+    int mode = MPOL_BIND_MODE;
+    if (numa == "interleave") {
+      // the kernel only uses the nodes that are actually there
+      nodes = ~uint64_t(0);
+      mode = MPOL_INTERLEAVE_MODE;
+    } else {
+      std::stringstream ss(numa);
+      for (std::string node; std::getline(ss, node, ',');) {
+        auto n = std::stoul(node);
+        if (n >= MAX_NODES) {
+          errno = EINVAL;
+          return false;
+        }
+        nodes |= uint64_t(1) << n;
+      }
+    }
+    return syscall(SYS_mbind, ptr, length, mode, &nodes, MAX_NODES + 1, 0) == 0;
+  }
+#endif
+
+  char* ptr;
+  size_t length;
+};
+
 template <class T> class mem_map {
 public:
   // non-copyable
@@ -139,9 +253,13 @@ public:
   }
 
   // construct with file
-  mem_map(const std::string& file_name, size_t size, int advice = POSIX_MADV_NORMAL)
+  mem_map(const std::string& file_name,
+          size_t size,
+          int advice = POSIX_MADV_NORMAL,
+          bool populate = false,
+          bool read_only = false)
       : ptr(nullptr), count(0), file_name("") {
-    map(file_name, size, advice);
+    map(file_name, size, advice, populate, read_only);
   }
 
   // unmap when done
@@ -164,8 +282,12 @@ public:
     map(new_file_name, new_count, advice);
   }
 
-  // reset to another file or another size
-  void map(const std::string& new_file_name, size_t new_count, int advice = POSIX_MADV_NORMAL) {
+  // reset to another file or another size, a read only map can be of a file we cant write to
+  void map(const std::string& new_file_name,
+           size_t new_count,
+           int advice = POSIX_MADV_NORMAL,
+           bool populate = false,
+           bool read_only = false) {
     // just in case there was already something
     unmap();
 
@@ -173,14 +295,20 @@ public:
     if (new_count > 0) {
       auto fd =
 #if defined(_WIN32)
-          _open(new_file_name.c_str(), O_RDWR, 0);
+          _open(new_file_name.c_str(), read_only ? O_RDONLY : O_RDWR, 0);
 #else
-          open(new_file_name.c_str(), O_RDWR, 0);
+          open(new_file_name.c_str(), read_only ? O_RDONLY : O_RDWR, 0);
 #endif
       if (fd == -1) {
         throw std::runtime_error(new_file_name + "(open): " + strerror(errno));
       }
-      ptr = mmap(nullptr, new_count * sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+      // fault it all in now rather than on first access
+      flags |= populate ? MAP_POPULATE : 0;
+#endif
+      ptr = mmap(nullptr, new_count * sizeof(T), read_only ? PROT_READ : PROT_READ | PROT_WRITE,
+                 flags, fd, 0);
       if (ptr == MAP_FAILED) {
         throw std::runtime_error(new_file_name + "(mmap): " + strerror(errno));
       }
@@ -310,16 +438,88 @@ public:
     return npos;
   }
 
-  // sort the file based on the predicate
+  // sort the file based on the predicate. the file is cut into chunks which are sorted in place
+  // on a number of threads (all the cores if 0) and then merged into a temporary file which is
+  // copied back. buffer_size bounds how many elements are being sorted at once
   void sort(const std::function<bool(const T&, const T&)>& predicate,
-            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T)) {
+            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T),
+            size_t threads = 0) {
     flush();
     // if no elements we are done
     if (memmap.size() == 0) {
       return;
     }
-    std::sort(static_cast<T*>(memmap), static_cast<T*>(memmap) + memmap.size(), predicate);
-    return;
+
+    // each thread gets its share of the budget but no more than its share of the file
+    threads = std::max<size_t>(threads ? threads : std::thread::hardware_concurrency(), 1);
+    size_t chunk_size = std::max<size_t>(buffer_size / threads, 1);
+    chunk_size = std::min(chunk_size, (memmap.size() + threads - 1) / threads);
+    T* data = static_cast<T*>(memmap);
+    if (chunk_size >= memmap.size()) {
+      std::sort(data, data + memmap.size(), predicate);
+      return;
+    }
+
+    // sort the chunks, the threads take the next unsorted one until there are none left
+    std::vector<std::pair<T*, T*>> chunks;
+    for (size_t i = 0; i < memmap.size(); i += chunk_size) {
+      chunks.emplace_back(data + i, data + std::min(i + chunk_size, memmap.size()));
+    }
+    std::atomic<size_t> next_chunk(0);
+    auto sort_chunks = [&]() {
+      for (size_t c = next_chunk++; c < chunks.size(); c = next_chunk++) {
+        std::sort(chunks[c].first, chunks[c].second, predicate);
+      }
+    };
+    std::vector<std::thread> sorters;
+    for (size_t i = 1; i < std::min(threads, chunks.size()); ++i) {
+      sorters.emplace_back(sort_chunks);
+    }
+    sort_chunks();
+    for (auto& sorter : sorters) {
+      sorter.join();
+    }
+
+    // merge them into a temporary file, the heap has the next element of each chunk on top
+    auto merged_name = file_name + ".sorted";
+    {
+      std::ofstream merged(merged_name, std::ios_base::binary | std::ios_base::trunc);
+      if (!merged) {
+        throw std::runtime_error("sequence: " + merged_name + ": " + strerror(errno));
+      }
+      auto later = [&predicate](const std::pair<T*, T*>& a, const std::pair<T*, T*>& b) {
+        return predicate(*b.first, *a.first);
+      };
+      std::make_heap(chunks.begin(), chunks.end(), later);
+      std::vector<T> buffer;
+      buffer.reserve(std::min(write_buffer.capacity(), memmap.size()));
+      while (!chunks.empty()) {
+        std::pop_heap(chunks.begin(), chunks.end(), later);
+        auto& chunk = chunks.back();
+        buffer.push_back(*chunk.first);
+        if (++chunk.first == chunk.second) {
+          chunks.pop_back();
+        } else {
+          std::push_heap(chunks.begin(), chunks.end(), later);
+        }
+        if (buffer.size() == buffer.capacity() || chunks.empty()) {
+          merged.write(static_cast<const char*>(static_cast<const void*>(buffer.data())),
+                       buffer.size() * sizeof(T));
+          buffer.clear();
+        }
+      }
+      if (!merged) {
+        throw std::runtime_error("sequence: " + merged_name + ": " + strerror(errno));
+      }
+    }
+
+    // copy it back so the file and its handles stay the same
+    {
+      mem_map<T> merged(merged_name, memmap.size(), POSIX_MADV_SEQUENTIAL);
+      std::copy(static_cast<const T*>(merged), static_cast<const T*>(merged) + memmap.size(),
+                data);
+    }
+    filesystem::remove(merged_name);
   }
 
   // perform an volatile operation on all the items of this sequence
@@ -580,7 +780,14 @@ struct tar {
     }
   };
 
-  tar(const std::string& tar_file, bool regular_files_only = true)
+  // Reads what is in the archive some faster way than walking every header of it, given the mapped
+  // archive and its size. The contents are left empty if it returns true
+  using index_reader_t = std::function<bool(const char*, size_t)>;
+
+  tar(const std::string& tar_file,
+      bool regular_files_only = true,
+      const map_options_t& options = {},
+      const index_reader_t& from_index = nullptr)
       : tar_file(tar_file), corrupt_blocks(0) {
     // get the file size
     struct stat s;
@@ -593,8 +800,18 @@ struct tar {
       return;
     }
 
-    // map the file
-    mm.map(tar_file, s.st_size);
+    // map the file, copying it somewhere else if the options require it
+    mm.map(tar_file, s.st_size, POSIX_MADV_NORMAL, options.populate && !options.copy());
+    const char* data = mm.get();
+    if (options.copy()) {
+      copy.reset(new anonymous_copy(mm.get(), mm.size(), options));
+      data = copy->get();
+    }
+
+    // maybe we dont have to look at every header
+    if (from_index && from_index(data, mm.size())) {
+      return;
+    }
 
     // determine opposite of preferred path separator (needed to update OS-specific path separator)
     const char opp_sep = filesystem::path::preferred_separator == '/' ? '\\' : '/';
@@ -602,8 +819,8 @@ struct tar {
     // rip through the tar to see whats in it noting that most tars end with 2 empty blocks
     // but we can concatenate tars and get empty blocks in between so we'll just be pretty
     // lax about it and we'll count the ones we cant make sense of
-    const char* position = mm.get();
-    while (position < mm.get() + mm.size()) {
+    const char* position = data;
+    while (position < data + mm.size()) {
       // get the header for this file
       const header_t* h = static_cast<const header_t*>(static_cast<const void*>(position));
       position += sizeof(header_t);
@@ -629,6 +846,8 @@ struct tar {
 
   std::string tar_file;
   mem_map<char> mm;
+  // the contents point in here instead of at the mapped file when its been copied
+  std::unique_ptr<anonymous_copy> copy;
   using entry_name_t = std::string;
   using entry_location_t = std::pair<const char*, size_t>;
   std::unordered_map<entry_name_t, entry_location_t> contents;
@@ -0,0 +1,38 @@
+#ifndef VALHALLA_MIDGARD_TRACEPOINT_H_
+#define VALHALLA_MIDGARD_TRACEPOINT_H_
+
+/**
+ * Static tracepoints (USDT probes of the provider valhalla) for bpftrace, perf or systemtap to
+ * attach to in production. They are compiled in with -DENABLE_USDT=ON and then cost a nop each until
+ * something attaches, without it they are compiled out along with their arguments, so arguments
+ * must not have side effects. Arguments are integers or C strings, durations are the time between
+ * the start and done probes of the same thing. For example:
+ *
+ *   bpftrace -e 'usdt:./valhalla_service:valhalla:tile_load_start { @s[tid] = nsecs; }
+ *     usdt:./valhalla_service:valhalla:tile_load_done /@s[tid]/ {
+ *       @load_us = hist((nsecs - @s[tid]) / 1000); delete(@s[tid]); }'
+ *
+ * The probes are:
+ *   tile_hit(tile), tile_miss(tile)            GraphReader::GetGraphTile found it cached or not
+ *   tile_load_start(tile), tile_load_done(tile, bytes)  around reading it, 0 bytes if it failed
+ *   queue_refill(moved, left)                  DoubleBucketQueue moved labels out of its overflow
+ *   path_start(algorithm, pass), path_done(algorithm, paths)  around each route search in thor
+ *   path_labels(algorithm, labels, reverse_labels)  the labels a search made, when it is cleared
+ *   reach_start(edge, max_reach), reach_done(edge, outbound, inbound)  loki's reach checks
+ *   viterbi_winner(time, labels)               meili found the winner of a measurement
+ *   serialize_start(format), serialize_done(format, bytes)  around serializing a response
+ */
+
+#ifdef ENABLE_USDT
+#include <sys/sdt.h>
+
+#define VALHALLA_TRACE1(name, a) DTRACE_PROBE1(valhalla, name, a)
+#define VALHALLA_TRACE2(name, a, b) DTRACE_PROBE2(valhalla, name, a, b)
+#define VALHALLA_TRACE3(name, a, b, c) DTRACE_PROBE3(valhalla, name, a, b, c)
+#else
+#define VALHALLA_TRACE1(name, a) static_cast<void>(0)
+#define VALHALLA_TRACE2(name, a, b) static_cast<void>(0)
+#define VALHALLA_TRACE3(name, a, b, c) static_cast<void>(0)
+#endif
+
+#endif // VALHALLA_MIDGARD_TRACEPOINT_H_
@@ -380,6 +380,21 @@ template <class container_t>
 container_t
 resample_spherical_polyline(const container_t& polyline, double resolution, bool preserve = false);
 
+/**
+ * Resample a polyline in spherical coordinates to specified resolution optionally keeping all
+ * original points in the line, handing the points out one at a time instead of collecting them
+ * @param polyline     the list/vector of points in the line
+ * @param resolution   maximum distance between any two points in the resampled line
+ * @param preserve     keep input points in resampled line or not
+ * @param visit        called with each point of the resampled line in order
+ */
+template <class container_t>
+void resample_spherical_polyline(
+    const container_t& polyline,
+    double resolution,
+    bool preserve,
+    const std::function<void(const typename container_t::value_type&)>& visit);
+
 /**
  * Resample a polyline to the specified resolution. This is less precise than the spherical
  * resampling.
@@ -577,7 +592,8 @@ polygon_t to_boundary(const std::unordered_set<uint32_t>& region, const Tiles<Po
  * */
 struct projector_t {
   projector_t(const PointLL& ll)
-      : lon_scale(cos(ll.lat() * kRadPerDegD)), lat(ll.lat()), lng(ll.lng()), approx(ll) {
+      : lon_scale(cos(ll.lat() * kRadPerDegD)), lat(ll.lat()), lng(ll.lng()), approx(ll),
+        m_per_lng_degree(approx.GetLngScale() * kMetersPerDegreeLat) {
   }
 
   // non default constructible and move only type
@@ -619,11 +635,36 @@ struct projector_t {
     return {u.first + bx * scale, u.second + by * scale};
   }
 
+  // The squared distances of the projections onto many segments at once, the segments between
+  // consecutive points of a shape given as count + 1 longitudes and latitudes. The projections
+  // are the ones of the method above and the distances the ones of approx, but the loop has no
+  // branches so the compiler can vectorize it over several segments at a time.
+  inline void
+  SquaredDistances(const double* lngs, const double* lats, size_t count, double* sq_distances) const {
+    for (size_t i = 0; i < count; ++i) {
+      const double bx = lngs[i + 1] - lngs[i];
+      const double by = lats[i + 1] - lats[i];
+      const double bx2 = bx * lon_scale;
+      const double sq = bx2 * bx2 + by * by;
+      const double scale = (lng - lngs[i]) * lon_scale * bx2 + (lat - lats[i]) * by;
+      const double ratio = scale / sq;
+      // before u it is u (as it also is for a zero length segment), after v it is v
+      double x = scale >= sq ? lngs[i + 1] : lngs[i] + bx * ratio;
+      double y = scale >= sq ? lats[i + 1] : lats[i] + by * ratio;
+      x = scale <= 0.0 ? lngs[i] : x;
+      y = scale <= 0.0 ? lats[i] : y;
+      const double lat_m = (y - lat) * kMetersPerDegreeLat;
+      const double lng_m = (x - lng) * m_per_lng_degree;
+      sq_distances[i] = lat_m * lat_m + lng_m * lng_m;
+    }
+  }
+
   // critical data
   double lon_scale;
   double lat;
   double lng;
   DistanceApproximator<PointLL> approx;
+  double m_per_lng_degree;
 };
 
 /**
@@ -658,6 +699,32 @@ inline uint16_t to_big_endian(uint16_t val) {
   return (val << 8) | (val >> 8);
 }
 
+/**
+ * The distance along a Hilbert curve through a square grid, so that cells which are close on the
+ * grid tend to be close along the curve.
+ * @param x     the column of the cell, less than 2^bits
+ * @param y     the row of the cell, less than 2^bits
+ * @param bits  the grid is 2^bits cells on a side, at most 32
+ * @return the distance along the curve, less than 4^bits
+ */
+inline uint64_t hilbert_distance(uint32_t x, uint32_t y, const uint32_t bits) {
+  const uint64_t n = 1ull << bits;
+  uint64_t d = 0;
+  for (uint64_t s = n / 2; s > 0; s /= 2) {
+    const uint32_t rx = (x & s) > 0;
+    const uint32_t ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = static_cast<uint32_t>(n - 1 - x);
+        y = static_cast<uint32_t>(n - 1 - y);
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
 template <class T> inline void hash_combine(std::size_t& seed, const T& v) {
   std::hash<T> hasher;
   seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
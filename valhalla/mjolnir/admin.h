@@ -7,8 +7,12 @@
 #include <boost/geometry/io/wkt/wkt.hpp>
 #include <boost/geometry/multi/geometries/multi_polygon.hpp>
 #include <cstdint>
+#include <limits>
+#include <memory>
 #include <sqlite3.h>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/pointll.h>
@@ -25,6 +29,79 @@ typedef boost::geometry::model::d2::point_xy<double> point_type;
 typedef boost::geometry::model::polygon<point_type> polygon_type;
 typedef boost::geometry::model::multi_polygon<polygon_type> multi_polygon_type;
 
+class PolygonStore;
+
+/**
+ * A grid over the bounds of a tile which knows for each of its cells which polygons cover all of
+ * the cell and which only cover some of it. A point then only needs the exact test against the
+ * polygons whose boundary crosses its cell. The polygons must be valid, with parts which dont
+ * overlap, and must outlive the grid.
+ */
+class PolygonGrid {
+public:
+  static constexpr uint32_t kDefaultDivisions = 64;
+
+  /**
+   * Rasterizes the polygons into the grid.
+   * @param  polys      unordered map of polys, the grid keeps the order they are iterated in
+   * @param  bounds     the area the grid covers, points outside of it test every polygon
+   * @param  divisions  how many rows and columns of cells the grid has
+   */
+  PolygonGrid(const std::unordered_multimap<uint32_t, multi_polygon_type>& polys,
+              const AABB2<PointLL>& bounds,
+              const uint32_t divisions = kDefaultDivisions);
+
+  /**
+   * Calls back with the index of every polygon which covers the point, in the order of the polys,
+   * for as long as the callback returns true.
+   * @param  ll        point that needs to be checked.
+   * @param  callback  takes the index of the poly and returns whether to keep going
+   */
+  template <typename callback_t> void covering(const PointLL& ll, const callback_t& callback) const {
+    point_type p(ll.lng(), ll.lat());
+    const auto cell = cell_of(ll);
+    if (cell == kOutside) {
+      for (const auto& poly : polys_) {
+        if (boost::geometry::covered_by(p, *poly.second) && !callback(poly.first)) {
+          return;
+        }
+      }
+      return;
+    }
+    for (uint32_t i = offsets_[cell]; i < offsets_[cell + 1]; ++i) {
+      const auto& poly = polys_[entries_[i].poly];
+      if ((!entries_[i].partial || boost::geometry::covered_by(p, *poly.second)) &&
+          !callback(poly.first)) {
+        return;
+      }
+    }
+  }
+
+  /**
+   * @return how many of the cells have a boundary of some polygon in them
+   */
+  size_t partial_cells() const;
+
+protected:
+  static constexpr uint32_t kOutside = std::numeric_limits<uint32_t>::max();
+
+  uint32_t cell_of(const PointLL& ll) const;
+
+  struct entry_t {
+    uint32_t poly : 31;
+    uint32_t partial : 1;
+  };
+
+  AABB2<PointLL> bounds_;
+  uint32_t divisions_;
+  double cell_width_;
+  double cell_height_;
+  std::vector<std::pair<uint32_t, const multi_polygon_type*>> polys_;
+  // the polygons which cover some of each cell, those of a cell start at its offset
+  std::vector<uint32_t> offsets_;
+  std::vector<entry_t> entries_;
+};
+
 /**
  * Get the dbhandle of a sqlite db.  Used for timezones and admins DBs.
  * @param  database   db file location.
@@ -51,6 +128,21 @@ uint32_t GetMultiPolyId(const std::unordered_multimap<uint32_t, multi_polygon_ty
 uint32_t GetMultiPolyId(const std::unordered_multimap<uint32_t, multi_polygon_type>& polys,
                         const PointLL& ll);
 
+/**
+ * Get the polygon index like above but only run the exact test where the grid cant tell.
+ * @param  grid       grid of the polys.
+ * @param  ll         point that needs to be checked.
+ * @param  graphtile  graphtilebuilder that is used to determine if we are a country poly or not.
+ */
+uint32_t GetMultiPolyId(const PolygonGrid& grid, const PointLL& ll, GraphTileBuilder& graphtile);
+
+/**
+ * Get the polygon index like above but only run the exact test where the grid cant tell.
+ * @param  grid       grid of the polys.
+ * @param  ll         point that needs to be checked.
+ */
+uint32_t GetMultiPolyId(const PolygonGrid& grid, const PointLL& ll);
+
 /**
  * Get the timezone polys from the db
  * @param  db_handle    sqlite3 db handle
@@ -92,6 +184,61 @@ GetAdminInfo(sqlite3* db_handle,
              const AABB2<PointLL>& aabb,
              GraphTileBuilder& tilebuilder);
 
+/**
+ * Get the admin polys that intersect with the tile bounding box from the packed polygons, the same
+ * as from the db they were packed from.
+ * @param  store            the packed admin polygons
+ * @param  drive_on_right   unordered map that indicates if a country drives on right side of the
+ * road
+ * @param  allow_intersection_names   unordered map that indicates if we call out intersections
+ * names for this country
+ * @param  aabb             bb of the tile
+ * @param  tilebuilder      Graph tile builder
+ */
+std::unordered_multimap<uint32_t, multi_polygon_type>
+GetAdminInfo(const PolygonStore& store,
+             std::unordered_map<uint32_t, bool>& drive_on_right,
+             std::unordered_map<uint32_t, bool>& allow_intersection_names,
+             const AABB2<PointLL>& aabb,
+             GraphTileBuilder& tilebuilder);
+
+/**
+ * Get the timezone polys from the packed polygons, the same as from the db they were packed from.
+ * @param  store        the packed time zone polygons
+ * @param  aabb         bb of the tile
+ */
+std::unordered_multimap<uint32_t, multi_polygon_type> GetTimeZones(const PolygonStore& store,
+                                                                   const AABB2<PointLL>& aabb);
+
+/**
+ * Packs the admins of the db into a file which can be used instead of the db.
+ * @param  db_handle    sqlite3 db handle of the admin db
+ * @param  file_name    where to write the packed admins
+ * @return how many admins were packed
+ */
+size_t PackAdmins(sqlite3* db_handle, const std::string& file_name);
+
+/**
+ * Packs the time zones of the db into a file which can be used instead of the db.
+ * @param  db_handle    sqlite3 db handle of the time zone db
+ * @param  file_name    where to write the packed time zones
+ * @return how many time zones were packed
+ */
+size_t PackTimeZones(sqlite3* db_handle, const std::string& file_name);
+
+/**
+ * Where the packed polygons of a db are expected.
+ * @param  database   db file location.
+ */
+std::string PackedPolygonsFile(const std::string& database);
+
+/**
+ * Opens the packed polygons of a db if valhalla_build_admins wrote them.
+ * @param  database   db file location.
+ * @return the packed polygons or nothing if there are none
+ */
+std::shared_ptr<const PolygonStore> GetPackedPolygons(const std::string& database);
+
 /**
  * Get all the country access records from the db and save them to a map.
  * @param  db_handle    sqlite3 db handle
@@ -0,0 +1,25 @@
+#ifndef VALHALLA_MJOLNIR_ALTLANDMARKBUILDER_H
+#define VALHALLA_MJOLNIR_ALTLANDMARKBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to select landmarks and compute the network distances between them and every node
+ * for the costings listed in mjolnir.alt_landmarks. See baldr::AltLandmarks for what is built.
+ */
+class AltLandmarkBuilder {
+public:
+  /**
+   * Compute the landmarks of every configured costing and write them to the tile_dir.
+   * @param pt  The configuration, nothing is built unless it lists some costings.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_ALTLANDMARKBUILDER_H
@@ -0,0 +1,101 @@
+#ifndef VALHALLA_MJOLNIR_BUILDREPORT_H
+#define VALHALLA_MJOLNIR_BUILDREPORT_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * What the stages of a tile build took, written as json once the build is done so that builds
+ * can be compared with each other. It is one per process since the tile queues of the stages
+ * report into it from wherever they are. A stage is measured from when it begins until the next
+ * one begins or the report is written.
+ */
+class BuildReport {
+public:
+  /**
+   * How much of the process a stage or the whole build used.
+   */
+  struct usage_t {
+    double wall_seconds = 0;
+    double cpu_seconds = 0;
+    // the peak resident memory of the process so far, it never goes down
+    uint64_t peak_rss_bytes = 0;
+    // what the process had storage read and write, 0 where the kernel doesnt tell
+    uint64_t read_bytes = 0;
+    uint64_t written_bytes = 0;
+  };
+
+  /**
+   * How one of the threads working through a tile queue of a stage did.
+   */
+  struct thread_t {
+    uint64_t tiles;
+    double done_seconds;
+  };
+
+  /**
+   * @return the report of this process
+   */
+  static BuildReport& Get();
+
+  /**
+   * Ends the stage before, if there is one, and begins measuring the next one.
+   * @param stage  the name of the stage
+   */
+  void Begin(const std::string& stage);
+
+  /**
+   * Adds to how many of something the current stage worked through, eg ways, nodes or tiles.
+   * The report gives them per second of the stage as well.
+   * @param what   what it was
+   * @param count  how many more of them there were
+   */
+  void Count(const std::string& what, uint64_t count);
+
+  /**
+   * Adds the threads of a tile queue to the current stage, the queue counts its tiles as well.
+   * @param queue    the name the queue logged its utilization under
+   * @param threads  how many tiles each thread took and when it was out of them
+   */
+  void AddThreads(const std::string& queue, const std::vector<thread_t>& threads);
+
+  /**
+   * Ends the current stage and writes all of the stages as json.
+   * @param out  where to write the report
+   */
+  void Write(std::ostream& out);
+
+  /**
+   * @return what the process used from when it started until now
+   */
+  static usage_t Usage();
+
+protected:
+  struct stage_t {
+    std::string name;
+    usage_t begin;
+    usage_t usage;
+    std::map<std::string, uint64_t> counts;
+    std::vector<std::pair<std::string, std::vector<thread_t>>> queues;
+  };
+
+  void End();
+
+  std::mutex mutex_;
+  std::vector<stage_t> stages_;
+  bool open_ = false;
+  usage_t start_ = Usage();
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_BUILDREPORT_H
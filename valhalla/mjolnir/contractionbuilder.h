@@ -0,0 +1,26 @@
+#ifndef VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+#define VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the contraction hierarchies thor can route on for the costings listed in
+ * mjolnir.contraction_hierarchies, each with the default options of the costing. See
+ * baldr::ContractionHierarchy for what is built.
+ */
+class ContractionBuilder {
+public:
+  /**
+   * Build a contraction hierarchy for every configured costing and write it to the tile_dir.
+   * @param pt  The configuration, nothing is built unless it lists some costings.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
@@ -0,0 +1,25 @@
+#ifndef VALHALLA_MJOLNIR_EDGEREACHBUILDER_H
+#define VALHALLA_MJOLNIR_EDGEREACHBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to compute the reach of every edge, up to mjolnir.edge_reach_cap, for the costings
+ * listed in mjolnir.edge_reach. See baldr::EdgeReach for what is built.
+ */
+class EdgeReachBuilder {
+public:
+  /**
+   * Compute the reach of every configured costing and write it to the tile_dir.
+   * @param pt  The configuration, nothing is built unless it lists some costings.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_EDGEREACHBUILDER_H
@@ -64,15 +64,17 @@ uint32_t GetBestNonFerryClass(const std::map<Edge, size_t>& edges);
 /**
  * Form the shortest path from the start node until a node that
  * touches the specified road classification.
+ * @return  Returns the indices of the edges along the path which need to be
+ *          upgraded, none if the node already touches the classification.
  */
-uint32_t ShortestPath(const uint32_t start_node_idx,
-                      const uint32_t node_idx,
-                      sequence<OSMWay>& ways,
-                      sequence<OSMWayNode>& way_nodes,
-                      sequence<Edge>& edges,
-                      sequence<Node>& nodes,
-                      const bool inbound,
-                      const uint32_t rc);
+std::vector<uint32_t> ShortestPath(const uint32_t start_node_idx,
+                                   const uint32_t node_idx,
+                                   sequence<OSMWay>& ways,
+                                   sequence<OSMWayNode>& way_nodes,
+                                   sequence<Edge>& edges,
+                                   sequence<Node>& nodes,
+                                   const bool inbound,
+                                   const uint32_t rc);
 
 /**
  * Check if the ferry included in this node bundle is short. Must be
@@ -88,13 +90,15 @@ bool ShortFerry(const uint32_t node_index,
 
 /**
  * Reclassify edges from a ferry along the shortest path to the
- * specified road classification.
+ * specified road classification. The paths are searched for in parallel
+ * and upgraded in the order the ferries were found.
  */
 void ReclassifyFerryConnections(const std::string& ways_file,
                                 const std::string& way_nodes_file,
                                 const std::string& nodes_file,
                                 const std::string& edges_file,
-                                const uint32_t rc);
+                                const uint32_t rc,
+                                const unsigned int concurrency = 1);
 
 } // namespace mjolnir
 } // namespace valhalla
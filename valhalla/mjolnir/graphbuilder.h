@@ -35,6 +35,8 @@ public:
    * not in memory
    * @param  complex_to_restriction_file    where to store the to complex restrictions so they are not
    * in memory
+   * @param  tiles                          the tiles from BuildEdges, only those of the shard in
+   * mjolnir.shard are built
    */
   static void Build(const boost::property_tree::ptree& pt,
                     const OSMData& osmdata,
@@ -46,6 +48,11 @@ public:
                     const std::string& complex_to_restriction_file,
                     const std::map<baldr::GraphId, size_t>& tiles);
 
+  /**
+   * Makes the edges from the ways, sorts the nodes and edges by tile and reclassifies the links and
+   * ferry connections, all in the bin files.
+   * @return the local tiles and the index of the first node of each in the nodes_file
+   */
   static std::map<baldr::GraphId, size_t> BuildEdges(const ptree& conf,
                                                      const std::string& ways_file,
                                                      const std::string& way_nodes_file,
@@ -3,6 +3,7 @@
 
 #include <boost/property_tree/ptree.hpp>
 #include <cstdint>
+#include <string>
 
 #include <valhalla/baldr/graphreader.h>
 
@@ -19,6 +20,18 @@ public:
    * @param pt Configuration file
    */
   static void Filter(const boost::property_tree::ptree& pt);
+
+  /**
+   * Write a copy of built tiles with only the edges some access modes can use, so that services
+   * only routing with those costings map less. Nodes left without edges, the names and signs of
+   * the edges left out and all of transit are dropped and the nodes and edges are renumbered.
+   * @param pt        Configuration file, the tiles are read as configured in mjolnir.
+   * @param tile_dir  Directory to write the copy to, which should not have any tiles yet.
+   * @param access    The access modes whose edges are kept, a mask of baldr::kAutoAccess etc.
+   */
+  static void Extract(const boost::property_tree::ptree& pt,
+                      const std::string& tile_dir,
+                      const uint32_t access);
 };
 
 } // namespace mjolnir
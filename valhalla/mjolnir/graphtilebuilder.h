@@ -402,6 +402,14 @@ public:
                       const graph_tile_ptr& tile,
                       const std::array<std::vector<GraphId>, kBinCount>& more_bins);
 
+  /**
+   * Adds the bounding box of the shape of each directed edge right before the bins, in place of
+   * any the tile already has. Everything else is copied directly without ever looking at it
+   * @param tile_dir   Base tile directory
+   * @param tile       the tile that needs the bounds added
+   */
+  static void AddEdgeBounds(const std::string& tile_dir, const graph_tile_ptr& tile);
+
   /**
    * Get the turn lane builder at the specified index.
    * @param  idx  Index of the turn lane builder.
@@ -439,6 +447,21 @@ public:
                          const std::vector<int16_t>& profile,
                          const size_t predicted_count_hint = 256);
 
+  /**
+   * Add the elevation profile of a directed edge, stored with the tile the next time it is.
+   * @param  idx      Edge Id within the tile.
+   * @param  heights  The heights evenly spaced along the shape of the edge, in meters.
+   * @return where the profile is within the profiles, for the opposing edge to share it
+   */
+  uint32_t AddElevationProfile(const uint32_t idx, const std::vector<double>& heights);
+
+  /**
+   * Points a directed edge at the elevation profile of another edge with the same shape.
+   * @param  idx     Edge Id within the tile.
+   * @param  offset  Where the profile is, as given by AddElevationProfile.
+   */
+  void SetElevationProfile(const uint32_t idx, const uint32_t offset);
+
   /**
    * Updates a tile with predictive speed data. Also updates directed edges with
    * free flow and constrained flow speeds and the predicted traffic flag. The
@@ -557,6 +580,12 @@ protected:
   // Predicted speed profiles. 200 short int for each directed edge which has predicted speed.
   std::vector<int16_t> speed_profile_builder_;
 
+  // Offsets into the elevation profiles for each directed edge.
+  std::vector<uint32_t> elevation_profile_offset_builder_;
+
+  // Packed elevation profiles.
+  std::string elevation_profile_builder_;
+
   // lane connectivity list offset
   uint32_t lane_connectivity_offset_ = 0;
 };
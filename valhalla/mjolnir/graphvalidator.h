@@ -10,7 +10,7 @@ namespace mjolnir {
 /**
  * Class used to validate the graph. Creates opposing edge indexes -
  * this is an excellent way to validate proper connectivity.
- * TODO - generate statistics, quality measures.
+ * Gathers the statistics of the tiles along the way when mjolnir.build_statistics is on.
  */
 class GraphValidator {
 public:
@@ -9,7 +9,10 @@ extern "C" {
 
 #include <valhalla/mjolnir/osmdata.h>
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 namespace valhalla {
@@ -18,21 +21,50 @@ namespace mjolnir {
 using Tags = std::unordered_map<std::string, std::string>;
 
 /**
+ * Transforms the tags of osm elements with the lua code. The result only depends on the type of
+ * the element and its tags, and a lot of elements share the same tags, so the results are kept by
+ * a canonical form of the tags and returned again without calling into lua. Every thread that
+ * transforms tags gets its own lua state and its own cache, so it can be used from several threads
+ * at once.
  */
 class LuaTagTransform {
 public:
+  // How many results each thread keeps by default before it starts over
+  static constexpr size_t kDefaultCacheSize = 1 << 16;
+
   /**
    * Constructor
-   * @param lua   the string containing the lua code
+   * @param lua         the string containing the lua code
+   * @param cache_size  how many results each thread keeps, 0 to always call into lua
    */
-  LuaTagTransform(const std::string& lua);
+  LuaTagTransform(const std::string& lua, const size_t cache_size = kDefaultCacheSize);
 
   ~LuaTagTransform();
 
+  LuaTagTransform(const LuaTagTransform&) = delete;
+  LuaTagTransform& operator=(const LuaTagTransform&) = delete;
+
   Tags Transform(OSMType type, uint64_t osmid, const Tags& tags);
 
 protected:
-  lua_State* state_;
+  // The lua state of a thread and the results it already has
+  struct state_t {
+    lua_State* lua;
+    std::unordered_map<std::string, Tags> cache;
+    ~state_t();
+  };
+
+  // The state of the calling thread, made on its first call
+  state_t& State();
+
+  // Calls into lua, true if nothing went wrong
+  static bool
+  Transform(lua_State* state, OSMType type, uint64_t osmid, const Tags& tags, Tags& result);
+
+  std::string lua_;
+  size_t cache_size_;
+  std::mutex mutex_;
+  std::unordered_map<std::thread::id, std::unique_ptr<state_t>> states_;
 };
 
 } // namespace mjolnir
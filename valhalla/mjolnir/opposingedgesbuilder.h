@@ -0,0 +1,25 @@
+#ifndef VALHALLA_MJOLNIR_OPPOSINGEDGESBUILDER_H
+#define VALHALLA_MJOLNIR_OPPOSINGEDGESBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to store the opposing edge of every edge of the graph when mjolnir.opposing_edges
+ * is on. See baldr::OpposingEdges for what is built.
+ */
+class OpposingEdgesBuilder {
+public:
+  /**
+   * Find the opposing edges and write them to the tile_dir.
+   * @param pt  The configuration, nothing is built unless the opposing edges are turned on.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_OPPOSINGEDGESBUILDER_H
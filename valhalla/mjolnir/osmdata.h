@@ -1,11 +1,15 @@
 #ifndef VALHALLA_MJOLNIR_OSMDATA_H
 #define VALHALLA_MJOLNIR_OSMDATA_H
 
+#include <algorithm>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <valhalla/mjolnir/osmaccessrestriction.h>
@@ -42,12 +46,81 @@ struct OSMLaneConnectivity {
   uint32_t from_lanes_index; // Index to string in UniqueNames
 };
 
+/**
+ * A multimap from OSM ids to values that is nothing but a vector of the pairs, so that it takes
+ * no more memory than the pairs themselves. They are appended while parsing and sorted by id
+ * once they are all in, with the pairs of an id kept in the order they were added. Looking up
+ * an id is a binary search which throws if the pairs havent been sorted since the last insert.
+ */
+template <class T> class OSMIdMultiMap {
+public:
+  using value_type = std::pair<uint64_t, T>;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  void insert(const value_type& value) {
+    sorted_ = sorted_ && (entries_.empty() || entries_.back().first <= value.first);
+    entries_.push_back(value);
+  }
+
+  /**
+   * Sorts the pairs by id so they can be looked up and gives back the memory left over from
+   * appending them.
+   */
+  void sort() {
+    if (!sorted_) {
+      std::stable_sort(entries_.begin(), entries_.end(),
+                       [](const value_type& a, const value_type& b) { return a.first < b.first; });
+      sorted_ = true;
+    }
+    entries_.shrink_to_fit();
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const uint64_t id) const {
+    if (!sorted_) {
+      throw std::logic_error("OSMIdMultiMap has to be sorted before it is searched");
+    }
+    return std::equal_range(entries_.cbegin(), entries_.cend(), id, compare_t{});
+  }
+
+  const_iterator begin() const {
+    return entries_.cbegin();
+  }
+  const_iterator end() const {
+    return entries_.cend();
+  }
+  const_iterator cbegin() const {
+    return entries_.cbegin();
+  }
+  const_iterator cend() const {
+    return entries_.cend();
+  }
+  size_t size() const {
+    return entries_.size();
+  }
+  bool empty() const {
+    return entries_.empty();
+  }
+
+protected:
+  struct compare_t {
+    bool operator()(const value_type& a, const uint64_t id) const {
+      return a.first < id;
+    }
+    bool operator()(const uint64_t id, const value_type& a) const {
+      return id < a.first;
+    }
+  };
+
+  std::vector<value_type> entries_;
+  bool sorted_ = true;
+};
+
 // Data types used within OSMData
-using RestrictionsMultiMap = std::unordered_multimap<uint64_t, OSMRestriction>;
+using RestrictionsMultiMap = OSMIdMultiMap<OSMRestriction>;
 using ViaSet = std::unordered_set<uint64_t>;
-using AccessRestrictionsMultiMap = std::unordered_multimap<uint64_t, OSMAccessRestriction>;
-using BikeMultiMap = std::unordered_multimap<uint64_t, OSMBike>;
-using OSMLaneConnectivityMultiMap = std::unordered_multimap<uint64_t, OSMLaneConnectivity>;
+using AccessRestrictionsMultiMap = OSMIdMultiMap<OSMAccessRestriction>;
+using BikeMultiMap = OSMIdMultiMap<OSMBike>;
+using OSMLaneConnectivityMultiMap = OSMIdMultiMap<OSMLaneConnectivity>;
 
 // OSMString map uses the way Id as the key and the name index into UniqueNames as the value
 using OSMStringMap = std::unordered_map<uint64_t, uint32_t>;
@@ -75,6 +148,11 @@ struct OSMData {
    */
   bool read_from_unique_names_file(const std::string& tile_dir);
 
+  /**
+   * Sort the multimaps by way id so they can be searched, done once all of them are parsed.
+   */
+  void sort_multimaps();
+
   /**
    * add the direction information to the forward or reverse map for relations.
    */
@@ -81,8 +81,15 @@ struct Callback {
 class Parser {
 public:
   Parser() = delete;
-  // parse the pbf file for the things you are interested in
-  static void parse(std::ifstream& file, const Interest interest, Callback& callback);
+  // parse the pbf file for the things you are interested in. with more than one thread the blobs
+  // are unpacked and decoded on that many threads while the callbacks are still made one at a
+  // time on the calling thread, either in the order of the file or in whatever order the blobs
+  // finish decoding
+  static void parse(std::ifstream& file,
+                    const Interest interest,
+                    Callback& callback,
+                    const size_t threads = 1,
+                    const bool ordered = true);
   // clean up protobuf library level memory, this will make protobuf unusable after its called
   static void free();
 };
@@ -0,0 +1,161 @@
+#ifndef VALHALLA_MJOLNIR_POLYGONSTORE_H_
+#define VALHALLA_MJOLNIR_POLYGONSTORE_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/midgard/sequence.h>
+#include <valhalla/mjolnir/admin.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * The admin or time zone polygons packed into one file with a grid of which polygons are in which
+ * square degree. It is memory mapped and only ever read, so any number of threads can find the
+ * polygons of their tiles at once without sqlite and without parsing any wkt.
+ */
+class PolygonStore {
+public:
+  static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t kVersion = 1;
+
+  /**
+   * The attributes of a polygon. For admins the name and iso code and for time zones the tz id as
+   * the name. The parent is the country of a state.
+   */
+  struct polygon_t {
+    double minx;
+    double miny;
+    double maxx;
+    double maxy;
+    uint64_t first_ring;
+    uint32_t ring_count;
+    uint32_t parent;
+    uint32_t name;
+    uint32_t iso_code;
+    uint8_t admin_level;
+    uint8_t drive_on_right;
+    uint8_t allow_intersection_names;
+    uint8_t spare[5];
+  };
+
+  /**
+   * Collects polygons and writes them to a file once they are all there.
+   */
+  class Writer {
+  public:
+    /**
+     * Adds a polygon, the polygons keep the order they are added in.
+     * @param  geometry   the polygon
+     * @param  name       name of the admin or tz id of the time zone
+     * @param  iso_code   iso code of the admin
+     * @param  attributes the admin level, drive on right and so on. Its parent is the id it was
+     *                    added with, see Write
+     * @param  id         id of the polygon, for instance the rowid in the db
+     */
+    void Add(const multi_polygon_type& geometry,
+             const std::string& name,
+             const std::string& iso_code,
+             polygon_t attributes,
+             const uint64_t id);
+
+    /**
+     * Writes the polygons to the file. The parents are turned from the ids they were added with
+     * into the position of the parent in the file, kNone if there was no polygon with that id.
+     * @param  file_name  where to write the store
+     * @return how many polygons were written
+     */
+    size_t Write(const std::string& file_name);
+
+  protected:
+    uint32_t AddString(const std::string& str);
+
+    std::vector<polygon_t> polygons_;
+    std::vector<uint64_t> ids_;
+    std::vector<uint64_t> rings_;
+    std::vector<double> points_;
+    std::vector<char> strings_;
+  };
+
+  /**
+   * Memory maps the store.
+   * @param  file_name  the store
+   */
+  explicit PolygonStore(const std::string& file_name);
+
+  /**
+   * @return how many polygons there are
+   */
+  uint32_t size() const {
+    return header_->polygon_count;
+  }
+
+  /**
+   * @param  index  the polygon
+   * @return the attributes of the polygon
+   */
+  const polygon_t& polygon(const uint32_t index) const {
+    return polygons_[index];
+  }
+
+  /**
+   * @param  offset  a name or iso code of a polygon
+   * @return the string
+   */
+  const char* string(const uint32_t offset) const {
+    return strings_ + offset;
+  }
+
+  /**
+   * @param  index  the polygon
+   * @return the geometry of the polygon
+   */
+  multi_polygon_type geometry(const uint32_t index) const;
+
+  /**
+   * Finds the polygons whose bounding box overlaps the box.
+   * @param  aabb  the box, for instance the bounds of a tile
+   * @return the polygons in the order of the store
+   */
+  std::vector<uint32_t> find(const midgard::AABB2<midgard::PointLL>& aabb) const;
+
+protected:
+  struct header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t polygon_count;
+    uint64_t ring_count;
+    uint64_t point_count;
+    uint64_t string_size;
+    uint64_t index_entry_count;
+  };
+
+  // the ring is in the low bits of a ring and whether it is an outer ring in the top bit
+  static constexpr uint64_t kOuterRing = uint64_t(1) << 63;
+
+  // the index is a square degree grid over the world, by rows from the south west
+  static constexpr int kIndexColumns = 360;
+  static constexpr int kIndexRows = 180;
+
+  static int column(const double lng);
+  static int row(const double lat);
+
+  midgard::mem_map<char> memmap_;
+  const header_t* header_;
+  const polygon_t* polygons_;
+  const uint64_t* rings_;
+  const double* points_;
+  const char* strings_;
+  const uint32_t* index_offsets_;
+  const uint32_t* index_entries_;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_POLYGONSTORE_H_
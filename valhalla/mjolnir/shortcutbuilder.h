@@ -16,6 +16,13 @@ public:
    * Build the shortcut edges.
    */
   static void Build(const boost::property_tree::ptree& pt);
+
+  /**
+   * Recover the edges every shortcut supersedes and write them to the tile_dir when
+   * mjolnir.shortcut_recovery is on. See baldr::RecoveredShortcuts for what is written.
+   * @param pt  The configuration, nothing is written unless the recovery is turned on.
+   */
+  static void Recover(const boost::property_tree::ptree& pt);
 };
 
 } // namespace mjolnir
@@ -0,0 +1,25 @@
+#ifndef VALHALLA_MJOLNIR_SPATIALINDEXBUILDER_H
+#define VALHALLA_MJOLNIR_SPATIALINDEXBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the spatial index over the nodes and edges of the graph when
+ * mjolnir.spatial_index is on. See baldr::SpatialIndex for what is built.
+ */
+class SpatialIndexBuilder {
+public:
+  /**
+   * Build the index and write it to the tile_dir.
+   * @param pt  The configuration, nothing is built unless the index is turned on.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_SPATIALINDEXBUILDER_H
@@ -0,0 +1,25 @@
+#ifndef VALHALLA_MJOLNIR_TILECOMPACTOR_H
+#define VALHALLA_MJOLNIR_TILECOMPACTOR_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to rewrite the tiles of the tile_dir as compact tiles when mjolnir.compact_tiles is
+ * on. See baldr::GraphTile::CompactTile for what a compact tile is.
+ */
+class TileCompactor {
+public:
+  /**
+   * Compact every tile in the tile_dir, tiles which already are compact are left alone.
+   * @param pt  The configuration, nothing is compacted unless compact tiles are turned on.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_TILECOMPACTOR_H
@@ -0,0 +1,125 @@
+#ifndef VALHALLA_MJOLNIR_TILEQUEUE_H
+#define VALHALLA_MJOLNIR_TILEQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/mjolnir/buildreport.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Which part of the tiles this process works on when a stage is split over several machines that
+ * share the tile_dir. The tiles are sorted by id and cut into count contiguous ranges of about the
+ * same weight, so every machine works out the same ranges from the same tiles and neighboring
+ * tiles tend to end up on the same machine.
+ */
+struct TileShard {
+  uint32_t index;
+  uint32_t count;
+
+  /**
+   * Reads mjolnir.shard.index and mjolnir.shard.count, a single shard with every tile if neither
+   * is there. Throws if the index isnt less than the count.
+   * @param pt  the config with the mjolnir section
+   */
+  static TileShard FromConfig(const boost::property_tree::ptree& pt);
+
+  /**
+   * Parses the "index/count" form of the command line.
+   * @param shard  the index and the count separated by a slash, eg "2/8"
+   */
+  static TileShard FromString(const std::string& shard);
+};
+
+/**
+ * The tiles a build stage works through, shared by the threads of the stage which each take the
+ * next one until there are none left. The heaviest tiles go first so that the stage doesnt end
+ * up waiting on a few dense tiles which happened to be started last. Taking a tile is a single
+ * atomic increment. The queue also keeps track of when each thread ran out of work so the
+ * stage can log how well its threads were used.
+ */
+class TileQueue {
+public:
+  /**
+   * Tiles with the same group are handed out one after the other, for instance the tiles which
+   * read the same piece of some other data. The groups go heaviest first and so do the tiles
+   * within a group.
+   */
+  using group_t = std::function<uint32_t(const baldr::GraphId&)>;
+
+  /**
+   * @param tiles  the tiles and an estimate of the work for each, in any unit
+   * @param shard  only keep the tiles of this shard
+   * @param group  the group of each tile, without it every tile is on its own
+   */
+  explicit TileQueue(std::vector<std::pair<baldr::GraphId, uint64_t>> tiles,
+                     const TileShard& shard = {0, 1},
+                     const group_t& group = nullptr);
+
+  /**
+   * Weighs tiles by the size of their files in the tile_dir, those without a file weigh nothing.
+   * @param tile_dir  where the tiles are
+   * @param tiles     the tiles to work through
+   * @param shard     only keep the tiles of this shard
+   * @param group     the group of each tile, without it every tile is on its own
+   */
+  TileQueue(const std::string& tile_dir,
+            const std::unordered_set<baldr::GraphId>& tiles,
+            const TileShard& shard = {0, 1},
+            const group_t& group = nullptr);
+
+  TileQueue(const TileQueue&) = delete;
+  TileQueue& operator=(const TileQueue&) = delete;
+
+  /**
+   * Takes the next tile. Once this returns false the calling thread is counted as done.
+   * @param tile  set to the next tile to work on, if there is one
+   * @return false when there are no more tiles
+   */
+  bool next(baldr::GraphId& tile);
+
+  /**
+   * @return how many tiles there are in total
+   */
+  size_t size() const {
+    return tiles_.size();
+  }
+
+  /**
+   * Logs how many tiles the threads did and how busy they were, meant to be called once all of
+   * the threads are done. The threads of the queue are added to the build report as well.
+   * @param stage  the name of the stage for the log
+   */
+  void LogUtilization(const std::string& stage) const;
+
+protected:
+  TileShard shard_;
+  std::vector<baldr::GraphId> tiles_;
+  std::atomic<size_t> next_;
+  std::chrono::steady_clock::time_point start_;
+  // how many threads ran out of work, the sum of when they did and when the last of them did
+  std::atomic<uint32_t> done_;
+  std::atomic<uint64_t> done_sum_us_;
+  std::atomic<uint64_t> done_max_us_;
+  std::atomic<uint64_t> done_min_us_;
+  // how many tiles each thread took by when it ran out of them
+  mutable std::mutex threads_mutex_;
+  std::vector<BuildReport::thread_t> threads_;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_TILEQUEUE_H
@@ -0,0 +1,75 @@
+#ifndef VALHALLA_MJOLNIR_TRAFFICTILEWRITER_H
+#define VALHALLA_MJOLNIR_TRAFFICTILEWRITER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/traffictile.h>
+#include <valhalla/midgard/sequence.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Writes live speeds into a traffic extract in place, while the services have it mapped. The
+ * speeds are written a tile at a time under its sequence: it is made odd before the first speed
+ * changes and even again, along with the time of the update, after the last. Every speed is stored
+ * in one 64 bit write so readers loading whole records never see one half written, and readers
+ * wanting a tile of speeds from the same update compare the sequence before and after. There may
+ * only ever be one writer per extract.
+ */
+class TrafficTileWriter {
+public:
+  using update_t = std::pair<baldr::GraphId, baldr::TrafficSpeed>;
+
+  /**
+   * Maps the traffic extract for writing, throws if it cant be mapped or has no traffic tiles.
+   * @param  traffic_extract  The tar of traffic tiles.
+   */
+  explicit TrafficTileWriter(const std::string& traffic_extract);
+
+  /**
+   * Writes speeds, grouped by tile so that every tile is updated once.
+   * @param  updates      The edges and their new speeds, the last wins if an edge is repeated.
+   * @param  last_update  When the speeds were measured, in seconds since epoch.
+   * @return how many were written, the ones of tiles not in the extract or beyond the edges of
+   *         their tile are left out
+   */
+  size_t Write(std::vector<update_t> updates, const uint64_t last_update);
+
+  /**
+   * Writes speeds into the memory of one traffic tile.
+   * @param  tile         The traffic tile, header and speeds.
+   * @param  size         How large it is.
+   * @param  begin        The first of the edges of the tile and their new speeds.
+   * @param  end          The end of them.
+   * @param  last_update  When the speeds were measured, in seconds since epoch.
+   * @return how many were written
+   */
+  static size_t WriteTile(char* tile,
+                          const size_t size,
+                          std::vector<update_t>::const_iterator begin,
+                          std::vector<update_t>::const_iterator end,
+                          const uint64_t last_update);
+
+  /**
+   * @return how many traffic tiles the extract has
+   */
+  size_t tile_count() const {
+    return tiles_.size();
+  }
+
+protected:
+  std::unique_ptr<midgard::tar> archive_;
+  std::unordered_map<baldr::GraphId, std::pair<char*, size_t>> tiles_;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_TRAFFICTILEWRITER_H
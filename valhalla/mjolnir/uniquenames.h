@@ -3,24 +3,25 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace valhalla {
 namespace mjolnir {
 
-using NamesMap = std::unordered_map<std::string, uint32_t>;
-
 /**
- * Class to hold a list of unique names and indexes to them.
+ * Class to hold a list of unique names and indexes to them. The names are kept back to back in
+ * one arena of characters and found again through an open addressing table of their indexes, so
+ * a name costs little more than its characters no matter how many millions there are.
  */
 class UniqueNames {
 public:
   /**
    * Constructor.
    */
-  UniqueNames() {
+  UniqueNames() : offsets_(1, 0) {
     // Insert dummy so index 0 is never used
     index("");
   }
@@ -32,18 +33,22 @@ public:
    * @return  Returns an index into the unique list of names.
    */
   uint32_t index(const std::string& name) {
-    // Find the name in the map. If it is there return the index.
-    auto it = names_.find(name);
-    if (it != names_.end()) {
-      return it->second;
-    } else {
-      // Not in the map, add index and update
-      it = names_.insert(it, NamesMap::value_type(name, 0));
-      indexes_.push_back(it);
-      uint32_t index = indexes_.size() - 1;
-      it->second = index;
-      return index;
+    // Keep the table at most half full
+    if (count() * 2 >= slots_.size()) {
+      grow();
+    }
+
+    // Find the name in the table. If it is there return the index.
+    auto& slot = slots_[find(name.data(), name.size())];
+    if (slot != kEmpty) {
+      return slot;
     }
+
+    // Not in the table, add it to the arena
+    slot = count();
+    chars_.insert(chars_.end(), name.begin(), name.end());
+    offsets_.push_back(chars_.size());
+    return slot;
   }
 
   /**
@@ -51,16 +56,23 @@ public:
    * @param  index  Index into the unique name list.
    * @return  Returns the name
    */
-  const std::string& name(const uint32_t index) const {
-    return (index < (uint32_t)indexes_.size()) ? indexes_[index]->first : indexes_[0]->first;
+  std::string name(const uint32_t index) const {
+    if (index >= count()) {
+      return count() ? name(0) : std::string();
+    }
+    return std::string(chars_.data() + offsets_[index], offsets_[index + 1] - offsets_[index]);
   }
 
   /**
    * Clear the names and indexes.
    */
   void Clear() {
-    names_.clear();
-    indexes_.clear();
+    chars_.clear();
+    chars_.shrink_to_fit();
+    offsets_.assign(1, 0);
+    offsets_.shrink_to_fit();
+    slots_.clear();
+    slots_.shrink_to_fit();
   }
 
   /**
@@ -69,16 +81,52 @@ public:
    * @return  Returns the number of unique names.
    */
   size_t Size() const {
-    return names_.size() - 1;
+    return count() - 1;
   }
 
 protected:
-  // Map of names to indexes
-  NamesMap names_;
+  static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+  uint32_t count() const {
+    return offsets_.size() - 1;
+  }
+
+  // FNV-1a, the names are short so anything fancier doesnt pay off
+  static uint64_t hash(const char* name, const size_t length) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i) {
+      h = (h ^ static_cast<unsigned char>(name[i])) * 1099511628211ull;
+    }
+    return h;
+  }
+
+  // The slot which has the name or the empty one where it would go
+  size_t find(const char* name, const size_t length) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = hash(name, length) & mask;; slot = (slot + 1) & mask) {
+      auto i = slots_[slot];
+      if (i == kEmpty ||
+          (offsets_[i + 1] - offsets_[i] == length &&
+           (length == 0 || std::memcmp(chars_.data() + offsets_[i], name, length) == 0))) {
+        return slot;
+      }
+    }
+  }
+
+  // Doubles the table and puts every name back in
+  void grow() {
+    slots_.assign(std::max<size_t>(slots_.size() * 2, 64), uint32_t(kEmpty));
+    for (uint32_t i = 0; i < count(); ++i) {
+      slots_[find(chars_.data() + offsets_[i], offsets_[i + 1] - offsets_[i])] = i;
+    }
+  }
+
+  // The names back to back and where each of them starts, with the end of the last one at the end
+  std::vector<char> chars_;
+  std::vector<uint64_t> offsets_;
 
-  // List of entries into the map
-  using nameiter = NamesMap::iterator;
-  std::vector<nameiter> indexes_;
+  // The indexes of the names by their hash, a power of 2 in size
+  std::vector<uint32_t> slots_;
 };
 
 } // namespace mjolnir
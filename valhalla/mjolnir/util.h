@@ -4,6 +4,7 @@
 #include <boost/property_tree/ptree.hpp>
 #include <list>
 #include <map>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -38,7 +39,14 @@ enum class BuildStage : int8_t {
   kRestrictions = 12,
   kElevation = 13,
   kValidate = 14,
-  kCleanup = 15
+  kContraction = 15,
+  kLandmarks = 16,
+  kReach = 17,
+  kSpatialIndex = 18,
+  kOpposingEdges = 19,
+  kShortcutRecovery = 20,
+  kCompact = 21,
+  kCleanup = 22
 };
 
 // Convert string to BuildStage
@@ -59,6 +67,13 @@ inline BuildStage string_to_buildstage(const std::string& s) {
        {"restrictions", BuildStage::kRestrictions},
        {"elevation", BuildStage::kElevation},
        {"validate", BuildStage::kValidate},
+       {"contraction", BuildStage::kContraction},
+       {"landmarks", BuildStage::kLandmarks},
+       {"reach", BuildStage::kReach},
+       {"spatialindex", BuildStage::kSpatialIndex},
+       {"opposingedges", BuildStage::kOpposingEdges},
+       {"shortcutrecovery", BuildStage::kShortcutRecovery},
+       {"compact", BuildStage::kCompact},
        {"cleanup", BuildStage::kCleanup}};
 
   auto i = stringToBuildStage.find(s);
@@ -83,6 +98,13 @@ inline std::string to_string(BuildStage stg) {
        {static_cast<int8_t>(BuildStage::kRestrictions), "restrictions"},
        {static_cast<int8_t>(BuildStage::kElevation), "elevation"},
        {static_cast<int8_t>(BuildStage::kValidate), "validate"},
+       {static_cast<int8_t>(BuildStage::kContraction), "contraction"},
+       {static_cast<int8_t>(BuildStage::kLandmarks), "landmarks"},
+       {static_cast<int8_t>(BuildStage::kReach), "reach"},
+       {static_cast<int8_t>(BuildStage::kSpatialIndex), "spatialindex"},
+       {static_cast<int8_t>(BuildStage::kOpposingEdges), "opposingedges"},
+       {static_cast<int8_t>(BuildStage::kShortcutRecovery), "shortcutrecovery"},
+       {static_cast<int8_t>(BuildStage::kCompact), "compact"},
        {static_cast<int8_t>(BuildStage::kCleanup), "cleanup"}};
 
   auto i = BuildStageStrings.find(static_cast<int8_t>(stg));
@@ -146,6 +168,32 @@ bool build_tile_set(const ptree& config,
                     const BuildStage end_stage = BuildStage::kValidate,
                     const bool release_osmpbf_memory = true);
 
+/**
+ * Packs the tiles of the tile_dir into a tar at the tile_extract for the services to map. The data
+ * of every tile starts on a page of its own so that no page is shared by two tiles, and the first
+ * member of the tar is an index of the tiles which the GraphReader loads in place of walking
+ * every header of the tar. Other tar tools still see a regular archive, with some padding members.
+ * The tar is written next to the tile_extract and moved over it once complete.
+ * @param config     Used to find the tile_dir and the tile_extract
+ * @param alignment  The data of each tile starts at a multiple of this, a multiple of 512
+ * @return how many tiles were packed
+ */
+size_t build_tile_extract(const ptree& config, const size_t alignment = 4096);
+
+/**
+ * Works out which tiles an osm change file (.osc) touches, as a first step towards rebuilding
+ * only those. Every node, way and relation that is created, modified or deleted marks the tiles
+ * of the local level its geometry is in, both the new geometry from the change file and the old
+ * one from the ways.bin and way_nodes.bin left in the tile_dir by the last build, which needs to
+ * have stopped before the cleanup stage. Then the neighbors of those tiles are added, as their
+ * edges may end at nodes of the changed tiles, and the tiles of the other levels over all of
+ * them, as the hierarchy and shortcuts are made from them.
+ * @param config    Used to find the tile_dir
+ * @param osc_file  The osmChange xml
+ * @return the ids of the affected tiles of every level
+ */
+std::set<baldr::GraphId> affected_tiles(const ptree& config, const std::string& osc_file);
+
 // The tile manifest is a JSON-serializable index of tiles to be processed during the build stage of
 // valhalla_build_tiles'. It can be used to distribute shard keys when building tiles with
 // parallelized, distributed batch processing. For example, a workflow orchestrator can partition
@@ -1,6 +1,7 @@
 #ifndef VALHALLA_ODIN_DIRECTIONSBUILDER_H_
 #define VALHALLA_ODIN_DIRECTIONSBUILDER_H_
 
+#include <cstddef>
 #include <list>
 
 #include <valhalla/odin/enhancedtrippath.h>
@@ -23,12 +24,24 @@ public:
    * calls PopulateDirectionsLeg to transform the maneuver list into the
    * trip directions.
    *
-   * @param api   the protobuf object containing the request, the path and a place
-   *              to store the resulting directions
+   * @param api      the protobuf object containing the request, the path and a place
+   *                 to store the resulting directions
+   * @param threads  how many threads may build the legs of a multi leg route at once,
+   *                 the directions are the same however many there are
    */
-  static void Build(Api& api);
+  static void Build(Api& api, const size_t threads = 1);
 
 protected:
+  /**
+   * Builds the maneuvers, narrative and directions of one leg of the route.
+   *
+   * @param options          the request options
+   * @param trip_path        the leg
+   * @param trip_directions  where to put the directions of the leg
+   */
+  static void
+  BuildLeg(const Options& options, TripLeg& trip_path, DirectionsLeg& trip_directions);
+
   /**
    * Update the heading of ~0 length edges.
    *
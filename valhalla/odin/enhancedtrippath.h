@@ -104,9 +104,9 @@ public:
 
   std::unique_ptr<EnhancedTripLeg_Admin> GetAdmin(size_t index);
 
-  std::string GetCountryCode(int node_index);
+  const std::string& GetCountryCode(int node_index) const;
 
-  std::string GetStateCode(int node_index);
+  const std::string& GetStateCode(int node_index) const;
 
   const ::valhalla::Location& GetOrigin() const;
 
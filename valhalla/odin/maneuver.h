@@ -64,6 +64,8 @@ public:
   void set_street_names(std::unique_ptr<StreetNames>&& street_names);
   bool HasStreetNames() const;
   void ClearStreetNames();
+  // Moves the street names out of this maneuver, leaving it unnamed
+  std::unique_ptr<StreetNames> TakeStreetNames();
 
   bool HasSameNames(const Maneuver* other_maneuver,
                     bool allow_begin_intersecting_edge_name_consistency = false) const;
@@ -13,7 +13,8 @@ namespace odin {
 
 /**
  * A factory class that creates a specific NarrativeBuilder pointer
- * based on the specified language tag.
+ * based on the specified language tag. Which builder and dictionary a locale
+ * gets is decided once, a request only makes the builder of its own.
  */
 class NarrativeBuilderFactory {
 public:
@@ -1,6 +1,8 @@
 #ifndef VALHALLA_ODIN_NARRATIVE_DICTIONARY_H_
 #define VALHALLA_ODIN_NARRATIVE_DICTIONARY_H_
 
+#include <cstdint>
+#include <initializer_list>
 #include <locale>
 #include <string>
 #include <unordered_map>
@@ -156,8 +158,55 @@ constexpr auto kTransitPlatformCountLabelTag = "<TRANSIT_STOP_COUNT_LABEL>";
 namespace valhalla {
 namespace odin {
 
+/**
+ * A phrase split at load into the text between its tags and the tags themselves, so that forming
+ * an instruction is one pass over the pieces rather than a search and replace of every tag.
+ */
+class TaggedPhrase {
+public:
+  struct tag_value_t {
+    const char* tag;
+    const std::string& value;
+  };
+
+  TaggedPhrase() = default;
+  explicit TaggedPhrase(const std::string& phrase);
+
+  /**
+   * Forms the phrase with the tags replaced by their values. Tags without a value are kept as
+   * they are in the phrase.
+   * @param  out     cleared and then given the formed phrase, keeping its capacity
+   * @param  values  the tags and what to replace them with
+   */
+  void Format(std::string& out, std::initializer_list<tag_value_t> values) const;
+
+  bool loaded() const {
+    return loaded_;
+  }
+
+protected:
+  // a piece of the phrase, either text or a tag like <STREET_NAMES>
+  struct piece_t {
+    uint32_t offset;
+    uint32_t length;
+    bool tag;
+  };
+
+  std::string phrase_;
+  std::vector<piece_t> pieces_;
+  bool loaded_ = false;
+};
+
 struct PhraseSet {
   std::unordered_map<std::string, std::string> phrases;
+  // the phrases parsed by their id
+  std::vector<TaggedPhrase> tagged_phrases;
+
+  /**
+   * @param  id  the phrase id
+   * @return the parsed phrase, throws std::out_of_range if there isnt one with that id
+   */
+  const TaggedPhrase& phrase(const uint8_t id) const;
 };
 
 struct StartSubset : PhraseSet {
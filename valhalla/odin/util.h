@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <locale>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -46,9 +48,45 @@ std::string get_localized_time(const std::string& date_time, const std::locale&
  */
 std::string get_localized_date(const std::string& date_time, const std::locale& locale);
 
-using locales_singleton_t = std::unordered_map<std::string, std::shared_ptr<NarrativeDictionary>>;
 /**
- * Returns locale strings mapped to NarrativeDictionaries containing parsed narrative information
+ * The dictionary of a locale which is only parsed from its json the first time it is used, so
+ * that a process only spends the time and memory on the locales it is asked for. Copies, like
+ * those of the aliases of a locale, share the one dictionary.
+ */
+class LazyNarrativeDictionary {
+public:
+  LazyNarrativeDictionary(const std::string& language_tag, const std::string& json);
+
+  const NarrativeDictionary& operator*() const {
+    return get();
+  }
+  const NarrativeDictionary* operator->() const {
+    return &get();
+  }
+
+  /**
+   * @return the language tag of the json the dictionary comes from, without parsing it
+   */
+  const std::string& language_tag() const {
+    return state_->language_tag;
+  }
+
+protected:
+  const NarrativeDictionary& get() const;
+
+  struct state_t {
+    std::string language_tag;
+    const std::string& json;
+    std::once_flag parsed;
+    std::unique_ptr<NarrativeDictionary> dictionary;
+  };
+  std::shared_ptr<state_t> state_;
+};
+
+using locales_singleton_t = std::unordered_map<std::string, LazyNarrativeDictionary>;
+/**
+ * Returns locale strings mapped to NarrativeDictionaries containing parsed narrative information.
+ * Finding a locale is cheap, its dictionary is parsed when it is first dereferenced.
  *
  * @return the map of locales to NarrativeDictionaries
  */
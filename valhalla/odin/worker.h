@@ -23,6 +23,10 @@ public:
   virtual void cleanup() override;
 
   void narrate(Api& request) const;
+
+protected:
+  // how many threads build the legs of a multi leg route
+  size_t directions_threads;
 };
 } // namespace odin
 } // namespace valhalla
@@ -2,8 +2,13 @@
 #define VALHALLA_SIF_COSTFACTORY_H_
 
 #include <functional>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
 
 #include <valhalla/baldr/rapidjson_utils.h>
 #include <valhalla/proto/options.pb.h>
@@ -21,8 +26,14 @@
 namespace valhalla {
 namespace sif {
 
+// How many costings the cost factory keeps to copy from
+constexpr size_t kMaxCachedCostings = 16;
+
 /**
- * Generic factory class for creating objects based on type name.
+ * Generic factory class for creating objects based on type name. The built in costings are
+ * kept in a small cache keyed by their options, and a request with the same options as an
+ * earlier one gets a copy of the kept costing instead of building it again. The kept ones are
+ * never handed out, so whatever a request changes on its costing stays with that request.
  */
 class CostFactory {
 public:
@@ -31,7 +42,7 @@ public:
   /**
    * Constructor
    */
-  CostFactory() {
+  CostFactory() : cache_(std::make_shared<cache_t>()) {
     Register(Costing::auto_, CreateAutoCost);
     // auto_data_fix was deprecated
     // auto_shorter was deprecated
@@ -46,6 +57,11 @@ public:
     Register(Costing::transit, CreateTransitCost);
     Register(Costing::none_, CreateNoCost);
     Register(Costing::bikeshare, CreateBikeShareCost);
+
+    // only the built in costings are known to copy themselves completely
+    for (const auto& func : factory_funcs_) {
+      cached_costings_.insert(func.first);
+    }
   }
 
   /**
@@ -57,6 +73,7 @@ public:
   void Register(const Costing costing, factory_function_t function) {
     factory_funcs_.erase(costing);
     factory_funcs_.emplace(costing, function);
+    cached_costings_.erase(costing);
   }
 
   /**
@@ -103,8 +120,31 @@ public:
       auto costing_str = Costing_Enum_Name(options.costing());
       throw std::runtime_error("No costing method found for '" + costing_str + "'");
     }
+    if (cached_costings_.find(options.costing()) == cached_costings_.end()) {
+      return itr->second(options);
+    }
+
+    // copy the costing if the same options were seen lately, else build it and keep it
+    std::string key = options.SerializeAsString();
+    std::lock_guard<std::mutex> lock(cache_->mutex);
+    auto& costings = cache_->costings;
+    for (auto cached = costings.begin(); cached != costings.end(); ++cached) {
+      if (cached->first == key) {
+        costings.splice(costings.begin(), costings, cached);
+        return cached->second->Clone();
+      }
+    }
     // create the cost using the function pointer
-    return itr->second(options);
+    auto cost = itr->second(options);
+    auto copy = cost->Clone();
+    if (!copy) {
+      return cost;
+    }
+    costings.emplace_front(std::move(key), std::move(cost));
+    if (costings.size() > kMaxCachedCostings) {
+      costings.pop_back();
+    }
+    return copy;
   }
 
   mode_costing_t CreateModeCosting(const Options& options, TravelMode& mode) {
@@ -128,7 +168,15 @@ public:
   }
 
 private:
+  // Costings kept to copy from by their serialized options, the most recently used first
+  struct cache_t {
+    std::mutex mutex;
+    std::list<std::pair<std::string, cost_ptr_t>> costings;
+  };
+
   std::map<const Costing, factory_function_t> factory_funcs_;
+  std::set<Costing> cached_costings_;
+  std::shared_ptr<cache_t> cache_;
 };
 
 } // namespace sif
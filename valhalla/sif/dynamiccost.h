@@ -79,9 +79,14 @@ public:
 
   virtual ~DynamicCost();
 
-  DynamicCost(const DynamicCost&) = delete;
   DynamicCost& operator=(const DynamicCost&) = delete;
 
+protected:
+  // Only the costings copy themselves, see Clone
+  DynamicCost(const DynamicCost&) = default;
+
+public:
+
   /**
    * Does the costing method allow multiple passes (with relaxed
    * hierarchy limits).
@@ -89,6 +94,15 @@ public:
    */
   virtual bool AllowMultiPass() const;
 
+  /**
+   * Copy this costing. The cost factory hands out copies instead of building a costing from
+   * the same options again. Costings which cannot be copied return nullptr.
+   * @return  Returns a copy of this costing or nullptr.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const {
+    return nullptr;
+  }
+
   /**
    * Get the pass number.
    * @return  Returns the pass through the algorithm.
@@ -225,7 +239,8 @@ public:
 
   /**
    * Checks if access is allowed for the provided edge. The access check based on mode
-   * of travel and the access modes allowed on the edge.
+   * of travel and the access modes allowed on the edge. Costings which do not override it
+   * call it qualified from their Allowed methods so that it is inlined there.
    * @param   edge  Pointer to edge information.
    * @return  Returns true if access is allowed, false if not.
    */
@@ -276,6 +291,28 @@ public:
    */
   virtual Cost EdgeCost(const baldr::DirectedEdge* edge, const graph_tile_ptr& tile) const;
 
+  /**
+   * Get the costs to traverse some of a range of directed edges which are contiguous in the tile,
+   * such as those of the edges leaving a node which are worth relaxing. The default costs them one
+   * by one through EdgeCost.
+   * @param   edges   Pointer to the first directed edge of the range.
+   * @param   indices Which of the edges of the range to cost.
+   * @param   count   Number of edges to cost.
+   * @param   tile    Pointer to the tile which contains the directed edges for speed lookup
+   * @param   seconds Seconds of week for historical speed lookup
+   * @param   costs   Filled with the cost and time (seconds) of each of the indexed edges.
+   */
+  virtual void EdgeCosts(const baldr::DirectedEdge* edges,
+                         const uint32_t* indices,
+                         const uint32_t count,
+                         const graph_tile_ptr& tile,
+                         const uint32_t seconds,
+                         Cost* costs) const {
+    for (uint32_t i = 0; i < count; ++i) {
+      costs[i] = EdgeCost(edges + indices[i], tile, seconds);
+    }
+  }
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -385,7 +422,7 @@ public:
         (!forward && (edge->start_restriction() & access_mode()))) {
       // Get complex restrictions. Return false if no restrictions are found
       auto restrictions = tile->GetRestrictions(forward, edgeid, access_mode());
-      if (restrictions.size() == 0) {
+      if (restrictions.empty()) {
         return false;
       }
 
@@ -455,7 +492,9 @@ public:
   }
 
   /**
-   * Test if an edge should be restricted due to a date time access restriction.
+   * Test if an edge should be restricted due to a date time access restriction. A time domain is
+   * either active or not for the whole of a local minute, so the answers are kept per thread by
+   * the domain and the minute and only the first edge asking in a minute does the calendar math.
    * @param  restriction  date and time info for the restriction
    * @param  current_time Current time (seconds since epoch). A value of 0
    *                      indicates the route is not time dependent.
@@ -463,16 +502,7 @@ public:
    */
   static bool IsConditionalActive(const uint64_t restriction,
                                   const uint64_t current_time,
-                                  const uint32_t tz_index) {
-
-    baldr::TimeDomain td(restriction);
-    return baldr::DateTime::is_conditional_active(td.type(), td.begin_hrs(), td.begin_mins(),
-                                                  td.end_hrs(), td.end_mins(), td.dow(),
-                                                  td.begin_week(), td.begin_month(),
-                                                  td.begin_day_dow(), td.end_week(), td.end_month(),
-                                                  td.end_day_dow(), current_time,
-                                                  baldr::DateTime::get_tz_db().from_index(tz_index));
-  }
+                                  const uint32_t tz_index);
 
   inline bool EvaluateRestrictions(uint32_t access_mode,
                                    const baldr::DirectedEdge* edge,
@@ -484,13 +514,14 @@ public:
     if (ignore_restrictions_ || !(edge->access_restriction() & access_mode))
       return true;
 
-    const std::vector<baldr::AccessRestriction>& restrictions =
-        tile->GetAccessRestrictions(edgeid.id(), access_mode);
+    // this runs for every restricted edge expanded so dont copy the restrictions out of the tile
+    const auto restrictions = tile->GetAccessRestrictionRange(edgeid.id(), access_mode);
 
     bool time_allowed = false;
 
-    for (int i = 0, n = static_cast<int>(restrictions.size()); i < n; ++i) {
-      const auto& restriction = restrictions[i];
+    int i = -1;
+    for (const auto& restriction : restrictions) {
+      ++i;
       // Compare the time to the time-based restrictions
       baldr::AccessType access_type = restriction.type();
       if (access_type == baldr::AccessType::kTimedAllowed ||
@@ -619,6 +650,13 @@ public:
    */
   void RelaxHierarchyLimits(const float factor, const float expansion_within_factor);
 
+  /**
+   * Fit the hierarchy limits to how far apart the locations of a route are. The limits are
+   * scaled from the ones the costing started with so it can be done for every leg.
+   * @param  distance  Distance (meters) between the locations.
+   */
+  void AdaptHierarchyLimits(const float distance);
+
   /**
    * Checks if we should exclude or not.
    */
@@ -695,6 +733,24 @@ public:
   virtual Cost BSSCost() const;
 
 protected:
+  /**
+   * Costs some of a range of directed edges with the EdgeCost of the given costing class, which
+   * is called directly so that it can be inlined into the loop. Costings override EdgeCosts with
+   * this for their own class.
+   */
+  template <class costing_t>
+  void EdgeCostsOf(const baldr::DirectedEdge* edges,
+                   const uint32_t* indices,
+                   const uint32_t count,
+                   const graph_tile_ptr& tile,
+                   const uint32_t seconds,
+                   Cost* costs) const {
+    const costing_t* costing = static_cast<const costing_t*>(this);
+    for (uint32_t i = 0; i < count; ++i) {
+      costs[i] = costing->costing_t::EdgeCost(edges + indices[i], tile, seconds);
+    }
+  }
+
   // Algorithm pass
   uint32_t pass_;
 
@@ -715,6 +771,9 @@ protected:
   // Hierarchy limits.
   std::vector<HierarchyLimits> hierarchy_limits_;
 
+  // The hierarchy limits the costing started with, kept once they are adapted to a route
+  std::vector<HierarchyLimits> default_hierarchy_limits_;
+
   // User specified edges to avoid with percent along (for avoiding PathEdges of locations)
   std::unordered_map<baldr::GraphId, float> user_avoid_edges_;
 
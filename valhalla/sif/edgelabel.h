@@ -4,14 +4,20 @@
 #include <cstdint>
 #include <limits>
 #include <string.h>
+#include <string>
 #include <valhalla/baldr/directededge.h>
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/logging.h>
 #include <valhalla/sif/costconstants.h>
 
 namespace valhalla {
 namespace sif {
 
+// Largest distance to the destination and restriction index an edge label can hold
+constexpr uint32_t kMaxLabelDistance = (1 << 25) - 1;
+constexpr uint32_t kNoLabelRestrictionIdx = (1 << 9) - 1;
+
 /**
  * Labeling information for shortest path algorithm. Contains cost,
  * predecessor, current time, and assorted information required during
@@ -29,9 +35,10 @@ public:
   EdgeLabel()
       : predecessor_(baldr::kInvalidLabel), path_distance_(0), restrictions_(0),
         edgeid_(baldr::kInvalidGraphId), opp_index_(0), opp_local_idx_(0), mode_(0),
-        endnode_(baldr::kInvalidGraphId), use_(0), classification_(0), shortcut_(0), dest_only_(0),
-        origin_(0), toll_(0), not_thru_(0), deadend_(0), on_complex_rest_(0), restriction_idx_(0),
-        cost_(0, 0), sortcost_(0), distance_(0), transition_cost_(0, 0) {
+        endnode_(baldr::kInvalidGraphId), restriction_idx_high_(0), use_(0), classification_(0),
+        shortcut_(0), dest_only_(0), origin_(0), toll_(0), not_thru_(0), deadend_(0),
+        on_complex_rest_(0), cost_(0, 0), sortcost_(0), distance_(0), restriction_idx_low_(0),
+        transition_cost_(0, 0) {
   }
 
   /**
@@ -67,8 +74,9 @@ public:
         deadend_(edge->deadend()),
         on_complex_rest_(edge->part_of_complex_restriction() || edge->start_restriction() ||
                          edge->end_restriction()),
-        restriction_idx_(restriction_idx), cost_(cost), sortcost_(sortcost), distance_(dist),
+        cost_(cost), sortcost_(sortcost), distance_(PackDistance(dist)),
         transition_cost_(transition_cost) {
+    SetRestrictionIdx(restriction_idx);
   }
 
   /**
@@ -89,7 +97,7 @@ public:
     cost_ = cost;
     sortcost_ = sortcost;
     transition_cost_ = transition_cost;
-    restriction_idx_ = restriction_idx;
+    SetRestrictionIdx(restriction_idx);
   }
 
   /**
@@ -115,7 +123,7 @@ public:
     sortcost_ = sortcost;
     path_distance_ = path_distance;
     transition_cost_ = transition_cost;
-    restriction_idx_ = restriction_idx;
+    SetRestrictionIdx(restriction_idx);
   }
 
   /**
@@ -176,7 +184,7 @@ public:
    * @return  Returns the distance in meters.
    */
   float distance() const {
-    return distance_;
+    return static_cast<float>(distance_);
   }
 
   /**
@@ -257,7 +265,9 @@ public:
    * Get the restriction idx
    */
   int restriction_idx() const {
-    return restriction_idx_;
+    const uint32_t restriction_idx =
+        static_cast<uint32_t>(restriction_idx_high_) << 7 | restriction_idx_low_;
+    return restriction_idx == kNoLabelRestrictionIdx ? -1 : static_cast<int>(restriction_idx);
   }
   /**
    * Does this edge have a toll?
@@ -336,6 +346,22 @@ public:
   }
 
 protected:
+  static uint32_t PackDistance(const float dist) {
+    return dist < kMaxLabelDistance ? static_cast<uint32_t>(dist + 0.5f) : kMaxLabelDistance;
+  }
+
+  void SetRestrictionIdx(const int restriction_idx) {
+    uint32_t packed = restriction_idx < 0 ? kNoLabelRestrictionIdx : restriction_idx;
+    // no edge has anywhere near this many restrictions, if one does it goes without its details
+    if (restriction_idx >= static_cast<int>(kNoLabelRestrictionIdx)) {
+      LOG_WARN("Restriction index " + std::to_string(restriction_idx) +
+               " does not fit in the edge label, dropping it");
+      packed = kNoLabelRestrictionIdx;
+    }
+    restriction_idx_low_ = packed & 0x7f;
+    restriction_idx_high_ = packed >> 7;
+  }
+
   // predecessor_: Index to the predecessor edge label information.
   // Note: invalid predecessor value uses all 32 bits (so if this needs to
   // be part of a bit field make sure kInvalidLabel is changed.
@@ -373,9 +399,10 @@ protected:
    * not_thru_:       Flag indicating edge is not_thru.
    * deadend_:        Flag indicating edge is a dead-end.
    * on_complex_rest: Part of a complex restriction.
+   * restriction_idx_high_: The upper bits of the restriction index, see below.
    */
   uint64_t endnode_ : 46;
-  uint64_t spare_ : 2; // Unused  bit
+  uint64_t restriction_idx_high_ : 2;
   uint64_t use_ : 6;
   uint64_t classification_ : 3;
   uint64_t shortcut_ : 1;
@@ -386,10 +413,15 @@ protected:
   uint64_t deadend_ : 1;
   uint64_t on_complex_rest_ : 1;
 
-  int restriction_idx_;
   Cost cost_;      // Cost and elapsed time along the path.
   float sortcost_; // Sort cost - includes A* heuristic.
-  float distance_; // Distance to the destination.
+
+  // distance_:        Distance to the destination in meters, only used to compare against the
+  //                   hierarchy limits so whole meters are plenty.
+  // restriction_idx_low_: The lower bits of the index of the conditional access restriction on
+  //                       the edge, all bits of both parts are set when there is none.
+  uint32_t distance_ : 25;
+  uint32_t restriction_idx_low_ : 7;
 
   // Was originally used for reverse search path to remove extra time where paths intersected
   // but its now used everywhere to measure the difference in time along the edge vs at the node
@@ -527,7 +559,7 @@ public:
     cost_ = cost;
     sortcost_ = sortcost;
     transition_cost_ = tc;
-    restriction_idx_ = restriction_idx;
+    SetRestrictionIdx(restriction_idx);
   }
 
   /**
@@ -551,7 +583,7 @@ public:
     sortcost_ = sortcost;
     transition_cost_ = tc;
     path_distance_ = path_distance;
-    restriction_idx_ = restriction_idx;
+    SetRestrictionIdx(restriction_idx);
   }
 
   /**
@@ -659,7 +691,7 @@ public:
     tripid_ = tripid;
     blockid_ = blockid;
     transition_cost_ = transition_cost;
-    restriction_idx_ = restriction_idx;
+    SetRestrictionIdx(restriction_idx);
   }
 
   /**
@@ -717,6 +749,11 @@ protected:
   uint32_t has_transit_ : 1;
 };
 
+// Every pop of the edge label queues reads a label, keep them from growing by accident
+static_assert(sizeof(EdgeLabel) == 48, "EdgeLabel should be 48 bytes");
+static_assert(sizeof(BDEdgeLabel) == 56, "BDEdgeLabel should be 56 bytes");
+static_assert(sizeof(MMEdgeLabel) == 64, "MMEdgeLabel should be 64 bytes");
+
 } // namespace sif
 } // namespace valhalla
 
@@ -2,6 +2,8 @@
 #define VALHALLA_SIF_HIERARCHYLIMITS_H_
 
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
 // Default hierarchy transitions. Note that this corresponds to a 3 level
@@ -22,6 +24,14 @@ constexpr uint32_t kDefaultMaxUpTransitions[] = {0, 400, 100, 0, 0, 0, 0, 0};
 // (per level). Used only for A*.
 constexpr float kDefaultExpansionWithinDist[] = {kMaxDistance, 100000.0f, 5000.0f, 0.0f,
                                                  0.0f,         0.0f,      0.0f,    0.0f};
+
+// Distance (m) between the locations the default maximum upward transitions are made for. Routes
+// between locations closer together keep expanding the lower levels through more upward
+// transitions, those further apart stop expanding them sooner, within these factors of the
+// defaults.
+constexpr float kAdaptiveLimitsDistance = 100000.0f;
+constexpr float kAdaptiveLimitsMinFactor = 0.5f;
+constexpr float kAdaptiveLimitsMaxFactor = 4.0f;
 } // namespace
 
 namespace valhalla {
@@ -78,6 +88,21 @@ struct HierarchyLimits {
     return up_transition_count > max_up_transitions;
   }
 
+  /**
+   * Scale the maximum number of upward transitions by how far apart the locations are, so that
+   * short routes stay on the lower levels longer rather than transitioning up needlessly and long
+   * routes stop expanding the lower levels sooner. Unlimited transitions stay unlimited.
+   * @param  distance  Distance (meters) between the locations.
+   */
+  void Adapt(const float distance) {
+    if (max_up_transitions != kUnlimitedTransitions) {
+      float factor =
+          distance > 0.0f ? kAdaptiveLimitsDistance / distance : kAdaptiveLimitsMaxFactor;
+      factor = std::min(std::max(factor, kAdaptiveLimitsMinFactor), kAdaptiveLimitsMaxFactor);
+      max_up_transitions = std::round(max_up_transitions * factor);
+    }
+  }
+
   /**
    * Relax hierarchy limits to try to find a route when initial attempt fails.
    * Do not relax limits if they are unlimited (bicycle and pedestrian for
@@ -5,6 +5,7 @@
 #include <valhalla/sif/edgelabel.h>
 
 #include <functional>
+#include <vector>
 
 namespace valhalla {
 namespace sif {
@@ -36,5 +37,28 @@ void recost_forward(baldr::GraphReader& reader,
                     float target_pct = 1.f,
                     const baldr::TimeInfo& time_info = baldr::TimeInfo::invalid(),
                     const bool invariant = false);
+
+/**
+ * Recosts a path given as a sequence of edges like recost_forward above, without calling back
+ * for every edge, and returns the label of the last edge. Its cost and path distance are those of
+ * the whole path.
+ *
+ * @param reader            used to get access to graph data. modifyable because its got a cache
+ * @param costing           single costing object to be used for costing/access computations
+ * @param path              the edges of the path
+ * @param source_pct        the percent along the initial edge the source location is
+ * @param target_pct        the percent along the final edge the target location is
+ * @param time_info         the time tracking information representing the local time before
+ *                          traversing the first edge
+ * @param invariant         static date_time, dont offset the time as the path lengthens
+ * @return the label of the last edge, a default constructed label if the path was empty
+ */
+EdgeLabel recost_forward(baldr::GraphReader& reader,
+                         const sif::DynamicCost& costing,
+                         const std::vector<baldr::GraphId>& path,
+                         float source_pct = 0.f,
+                         float target_pct = 1.f,
+                         const baldr::TimeInfo& time_info = baldr::TimeInfo::invalid(),
+                         const bool invariant = false);
 } // namespace sif
 } // namespace valhalla
\ No newline at end of file
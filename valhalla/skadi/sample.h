@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -22,11 +23,16 @@ public:
   sample(const sample&) = delete;
   sample& operator=(const sample&) = delete;
 
+  // How many unzipped tiles are kept unless told otherwise, each of them is about 26MB
+  static constexpr size_t kDefaultCacheSize = 4;
+
   /**
    * Constructor
    * @param data_source  directory name of the datasource from which to sample
+   * @param cache_size   how many unzipped tiles to keep, the samples of the same datasource in
+   *                     a process share them and keep as many as the largest asks for
    */
-  sample(const std::string& data_source);
+  sample(const std::string& data_source, size_t cache_size = kDefaultCacheSize);
 
   /**
    * Get a single sample from the datasource
@@ -40,11 +46,42 @@ public:
    */
   template <class coords_t> std::vector<double> get_all(const coords_t& coords) const;
 
+  /**
+   * Get samples every so often along a polyline, at the points resample_spherical_polyline
+   * would give but without making the resampled polyline first
+   * @param polyline  the list of points of the line
+   * @param interval  the meters between two samples
+   * @param preserve  also sample at the points of the line
+   */
+  template <class coords_t>
+  std::vector<double>
+  get_resampled(const coords_t& polyline, double interval, bool preserve = false) const;
+
   /**
    * @return the no data value for this data source
    */
   static double get_no_data_value();
 
+  /**
+   * @return how many times a gzipped tile or a block was found already unzipped in the cache
+   */
+  uint64_t cache_hits() const;
+
+  /**
+   * @return how many times a gzipped tile or a block had to be unzipped
+   */
+  uint64_t cache_misses() const;
+
+  /**
+   * Converts a raw or gzipped hgt tile to the blocked format, whose blocks of samples are
+   * compressed one by one so that a sample unzips only the block its in. A blocked tile is
+   * named like the hgt one with a .hgt.blk extension and is preferred over a gzipped one.
+   * @param  hgt_file      the raw or gzipped hgt tile
+   * @param  blocked_file  where to write the blocked tile
+   * @return false if the hgt tile couldnt be read or the blocked one written
+   */
+  static bool pack(const std::string& hgt_file, const std::string& blocked_file);
+
 protected:
   /**
    * @return A tile index value from a coordinate
@@ -56,13 +93,42 @@ protected:
    */
   static std::string get_hgt_file_name(uint16_t index);
 
+  // A tile a batch of samples looked up, either all of its data or the blocks of a blocked tile.
+  // The data stays valid while its held even if the cache drops it in the meantime
+  struct tile_t {
+    uint32_t index;
+    std::shared_ptr<const int16_t> data;
+    // the mapped blocked tile and the block that was used last
+    const char* blocked;
+    uint32_t block;
+    std::shared_ptr<const int16_t> block_data;
+  };
+
   /**
    * @param  index  the index of the data tile being requested
-   * @return the array of data or nullptr if there was none
+   * @return the tile, without data if there was none
+   */
+  tile_t source(uint16_t index) const;
+
+  /**
+   * @param  tile  a blocked tile
+   * @param  x     the column of the pixel
+   * @param  y     the row of the pixel
+   * @return the pixel as it is stored, the block it is in becomes the one used last
+   */
+  int16_t blocked_pixel(tile_t& tile, size_t x, size_t y) const;
+
+  // the tiles a batch of samples already looked up, the last one used at the back
+  using tiles_t = std::vector<tile_t>;
+
+  /**
+   * Get a single sample, looking up its tile only if it wasnt already for this batch
+   * @param coord  the single posting at which to sample the datasource
+   * @param tiles  the tiles looked up so far
    */
-  const int16_t* source(uint16_t index) const;
+  template <class coord_t> double get(const coord_t& coord, tiles_t& tiles) const;
 
-  enum class format_t { UNKNOWN = 0, GZIP = 1, RAW = 3 };
+  enum class format_t { UNKNOWN = 0, GZIP = 1, BLOCKED = 2, RAW = 3 };
   /**
    * maps a new source, used at start up and called periodically
    * for lazily loaded sources
@@ -75,10 +141,12 @@ protected:
 
   // using memory maps
   mutable std::vector<std::pair<format_t, midgard::mem_map<char>>> mapped_cache;
+  // guards the lazy loading of the memory maps
+  std::unique_ptr<std::mutex> mapped_mutex;
 
-  // TODO: make an LRU
-  using unzipped_t = std::pair<int16_t, std::vector<int16_t>>;
-  mutable unzipped_t unzipped_cache;
+  // the least recently used unzipped tiles and blocks, thread-safe and shared by datasource
+  struct unzipped_cache_t;
+  std::shared_ptr<unzipped_cache_t> unzipped_cache;
 
   std::string data_source;
 };
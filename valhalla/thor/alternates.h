@@ -1,5 +1,6 @@
 #pragma once
 
+#include <utility>
 #include <vector>
 
 #include "thor/bidirectional_astar.h"
@@ -10,8 +11,17 @@ float get_max_sharing(const valhalla::Location& origin, const valhalla::Location
 
 void filter_alternates_by_stretch(std::vector<CandidateConnection>& connections);
 
+void update_shared_edgeids(baldr::GraphReader& graphreader,
+                           std::vector<std::vector<baldr::GraphId>>& shared_edgeids,
+                           const std::vector<std::vector<PathInfo>>& paths);
+
+bool validate_alternate_by_estimated_sharing(
+    const std::vector<std::vector<baldr::GraphId>>& shared_edgeids,
+    const std::vector<std::pair<baldr::GraphId, float>>& candidate_edges,
+    float at_most_shared);
+
 bool validate_alternate_by_sharing(baldr::GraphReader& graphreader,
-                                   std::vector<std::unordered_set<baldr::GraphId>>& shared_edgeids,
+                                   std::vector<std::vector<baldr::GraphId>>& shared_edgeids,
                                    const std::vector<std::vector<PathInfo>>& paths,
                                    const std::vector<PathInfo>& candidate_path,
                                    float at_most_shared);
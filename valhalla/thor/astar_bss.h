@@ -15,6 +15,7 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/sif/hierarchylimits.h>
 #include <valhalla/thor/astarheuristic.h>
+#include <valhalla/thor/dijkstras.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
 #include <valhalla/thor/pathinfo.h>
@@ -30,8 +31,9 @@ class AStarBSSAlgorithm : public PathAlgorithm {
 public:
   /**
    * Constructor.
+   * @param  label_limits  Limits on the memory used for labels.
    */
-  AStarBSSAlgorithm();
+  explicit AStarBSSAlgorithm(const label_limits_t& label_limits = label_limits_t());
 
   /**
    * Destructor
@@ -79,7 +81,65 @@ public:
     max_label_count_ = max_count;
   }
 
+  /**
+   * Set how far in meters the bike share stations may be walked to from the origin and from to the
+   * destination. Routes farther than twice that bike between the stations walked to from both ends,
+   * which is a lot less to expand than bringing the walks at both ends along the whole way. Routes
+   * which find no stations that close and shorter ones are searched for as before.
+   * @param  distance  Walking distance to the stations, 0 to always search as before.
+   */
+  void set_station_walk_distance(const uint32_t distance) {
+    station_walk_distance_ = distance;
+  }
+
 protected:
+  /**
+   * Walks from a location to every bike share station within the distance allowed, forward from an
+   * origin or in reverse to a destination.
+   */
+  class StationWalks : public Dijkstras {
+  public:
+    explicit StationWalks(const label_limits_t& label_limits) : Dijkstras(label_limits) {
+    }
+
+    /**
+     * Expands from a location.
+     * @param  location      the origin or destination
+     * @param  forward       whether it is walked from or to
+     * @param  max_distance  how far to walk in meters
+     */
+    void Walk(const valhalla::Location& location,
+              const bool forward,
+              const uint32_t max_distance,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing);
+
+    /**
+     * @return the labels of the walk
+     */
+    const std::vector<sif::BDEdgeLabel>& labels() const {
+      return bdedgelabels_;
+    }
+
+    // the stations reached and the label of the cheapest way there
+    std::unordered_map<baldr::GraphId, uint32_t> stations;
+
+  protected:
+    void ExpandingNode(baldr::GraphReader& graphreader,
+                       graph_tile_ptr tile,
+                       const baldr::NodeInfo* node,
+                       const sif::EdgeLabel& current,
+                       const sif::EdgeLabel* previous) override;
+
+    ExpansionRecommendation ShouldExpand(baldr::GraphReader& graphreader,
+                                         const sif::EdgeLabel& pred,
+                                         const InfoRoutingType route_type) override;
+
+    void GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const override;
+
+    uint32_t max_distance_;
+  };
+
   uint32_t max_label_count_; // Max label count to allow
   sif::TravelMode mode_;     // Current travel mode
   uint8_t travel_type_;      // Current travel type
@@ -105,6 +165,11 @@ protected:
   // Destinations, id and cost
   std::map<uint64_t, sif::Cost> destinations_;
 
+  // How far the stations may be walked to from both ends, and the walks from and to them
+  uint32_t station_walk_distance_;
+  StationWalks access_;
+  StationWalks egress_;
+
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
    * @param  origll  Lat,lng of the origin.
@@ -153,6 +218,20 @@ protected:
    */
   uint32_t SetDestination(baldr::GraphReader& graphreader, const valhalla::Location& dest);
 
+  /**
+   * Bikes from the stations walked to from the origin to those walked from to the destination.
+   * The walks from the origin are the first labels so that the path goes back through them.
+   * @param   origin        Location information of the origin.
+   * @param   dest          Location information of the destination.
+   * @param   graphreader   Graph tile reader.
+   * @param   mode_costing  Costing methods for each mode.
+   * @return  Returns the path or nothing if no stations were close enough to both ends.
+   */
+  std::vector<PathInfo> GetStationPath(const valhalla::Location& origin,
+                                       const valhalla::Location& dest,
+                                       baldr::GraphReader& graphreader,
+                                       const sif::mode_costing_t& mode_costing);
+
   /**
    * Form the path from the adjacency list. Recovers the path from the
    * destination backwards towards the origin (using predecessor information)
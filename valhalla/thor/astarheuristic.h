@@ -1,23 +1,33 @@
 #ifndef VALHALLA_THOR_ASTARHEURISTIC_H_
 #define VALHALLA_THOR_ASTARHEURISTIC_H_
 
+#include <algorithm>
+#include <vector>
+
+#include <valhalla/baldr/altlandmarks.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
 #include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
+#include <valhalla/proto/api.pb.h>
 
 namespace valhalla {
 namespace thor {
 
 /**
  * Class to calculate A* cost heuristics based on distances of nodes from
- * a destination within the shortest path computation.
+ * a destination within the shortest path computation. With landmarks the
+ * straight line distance is raised to the network distance the landmarks
+ * bound it by, where they know the node.
  */
 class AStarHeuristic {
 public:
   /**
    * Constructor.
    */
-  AStarHeuristic() : distapprox_({}), costfactor_(1.0f) {
+  AStarHeuristic()
+      : distapprox_({}), costfactor_(1.0f), radius_(0.0f), landmarks_(nullptr), sign_(1.0f) {
   }
 
   /**
@@ -29,12 +39,33 @@ public:
    *                 distance that will underestimate the cost to the
    *                 destination, but keep close to a reasonable true
    *                 cost so that performance is kept high.
+   * @param  radius  How far from the destination in meters the search may
+   *                 end anywhere, the estimate is then of the distance to
+   *                 the circle around it.
    */
-  void Init(const midgard::PointLL& ll, const float factor) {
+  void Init(const midgard::PointLL& ll, const float factor, const float radius = 0.0f) {
     distapprox_.SetTestPoint(ll);
     costfactor_ = factor;
+    radius_ = radius;
+    landmarks_ = nullptr;
   }
 
+  /**
+   * Tightens the heuristic with landmark distances, call after Init. Stays
+   * with the straight line distance if the landmarks dont know the nodes of
+   * the location.
+   * @param  landmarks  The landmarks of the costing or nullptr for none.
+   * @param  reader     Graph reader to find the nodes of the location.
+   * @param  location   The location Init was given the lat,lng of.
+   * @param  toward     True when searching toward the location, as forward
+   *                    searches do toward the destination. False when
+   *                    searching away from it, as reverse searches do.
+   */
+  void InitLandmarks(const baldr::AltLandmarks* landmarks,
+                     baldr::GraphReader& reader,
+                     const valhalla::Location& location,
+                     const bool toward);
+
   /**
    * Get the distance to the destination given the lat,lng.
    * @param   ll  Current latitude, longitude.
@@ -51,7 +82,7 @@ public:
    *          For A* shortest path this MUST UNDERESTIMATE the true cost.
    */
   float Get(const float distance) const {
-    return distance * costfactor_;
+    return std::max(distance - radius_, 0.0f) * costfactor_;
   }
 
   /**
@@ -61,7 +92,7 @@ public:
    *          For A* shortest path this MUST UNDERESTIMATE the true cost.
    */
   float Get(const midgard::PointLL& ll) const {
-    return sqrtf(distapprox_.DistanceSquared(ll)) * costfactor_;
+    return Get(sqrtf(distapprox_.DistanceSquared(ll)));
   }
 
   /**
@@ -74,13 +105,64 @@ public:
    */
   float Get(const midgard::PointLL& ll, float& dist) const {
     dist = sqrtf(distapprox_.DistanceSquared(ll));
-    return dist * costfactor_;
+    return Get(dist);
+  }
+
+  /**
+   * Get the A* heuristic given a node and its lat,lng, using the landmarks
+   * if there are any. The distance returned via the argument stays the
+   * straight line distance.
+   * @param   node  Graph Id of the node.
+   * @param   ll    Lat,lng of the node.
+   * @param   dist  Distance (meters) to the destination.
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const baldr::GraphId& node, const midgard::PointLL& ll, float& dist) const {
+    dist = sqrtf(distapprox_.DistanceSquared(ll));
+    return Get(landmarks_ ? std::max(dist, GetLandmarkDistance(node)) : dist);
+  }
+
+  /**
+   * Get the largest distance the landmarks bound the network distance
+   * between the node and the location by.
+   * @param   node  Graph Id of the node.
+   * @return  Returns the bound in meters, 0 if there is none.
+   */
+  float GetLandmarkDistance(const baldr::GraphId& node) const {
+    const float* distances = landmarks_->distances(node);
+    if (!distances) {
+      return 0.0f;
+    }
+    const uint32_t count = landmarks_->count();
+    float bound = 0.0f;
+    for (uint32_t l = 0; l < count; ++l) {
+      const float from = distances[l];
+      const float to = distances[count + l];
+      if (from != kUnreachable && from_bounds_[l] != kUnreachable) {
+        bound = std::max(bound, sign_ * (from - from_bounds_[l]));
+      }
+      if (to != kUnreachable && to_bounds_[l] != kUnreachable) {
+        bound = std::max(bound, sign_ * (to_bounds_[l] - to));
+      }
+    }
+    return bound;
   }
 
 private:
+  static constexpr float kUnreachable = baldr::AltLandmarks::kUnreachable;
+
   midgard::DistanceApproximator<midgard::PointLL> distapprox_; // Distance approximation
   float costfactor_; // Cost factor - ensures the cost estimate
                      // underestimates the true cost.
+  float radius_;     // Distance from the destination the estimate is to
+
+  // The landmarks and, per landmark, the distances from and to it of the
+  // location which are the tightest valid bound for all its nodes
+  const baldr::AltLandmarks* landmarks_;
+  std::vector<float> from_bounds_;
+  std::vector<float> to_bounds_;
+  float sign_; // -1 when searching toward the location, 1 away from it
 };
 
 } // namespace thor
@@ -0,0 +1,50 @@
+#ifndef VALHALLA_THOR_BATCH_RECOST_H_
+#define VALHALLA_THOR_BATCH_RECOST_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/time_info.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/expansion_pool.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * The results of recosting many paths with several costings, one column per costing with a row
+ * per path. The value at costing c and path p is at index c * path_count + p. Paths a costing
+ * cannot take, or with edges missing from the graph, are NaN.
+ */
+struct BatchRecost {
+  size_t path_count = 0;
+  std::vector<float> times;     // seconds
+  std::vector<float> costs;     // cost units
+  std::vector<float> distances; // meters
+};
+
+/**
+ * Recosts every path with every costing, spreading the paths over the threads of the pool. The
+ * paths are taken whole, from the start of their first edge to the end of their last one. The
+ * costings are only read so the threads share them.
+ * @param  paths      The edges of each path.
+ * @param  costings   The costings to recost every path with.
+ * @param  reader     Graph reader of the calling thread.
+ * @param  pool       Threads to recost on in parallel, only the calling thread if nullptr.
+ * @param  time_info  The local time before traversing the first edge of each path.
+ * @param  invariant  Keep the time as the paths lengthen.
+ * @return The times, costs and distances of each path with each costing.
+ */
+BatchRecost RecostPaths(const std::vector<std::vector<baldr::GraphId>>& paths,
+                        const std::vector<sif::cost_ptr_t>& costings,
+                        baldr::GraphReader& reader,
+                        ExpansionPool* pool = nullptr,
+                        const baldr::TimeInfo& time_info = baldr::TimeInfo::invalid(),
+                        const bool invariant = false);
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_BATCH_RECOST_H_
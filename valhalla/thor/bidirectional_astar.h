@@ -43,8 +43,9 @@ class BidirectionalAStar : public PathAlgorithm {
 public:
   /**
    * Constructor.
+   * @param  label_limits  Limits on the memory used for labels.
    */
-  BidirectionalAStar();
+  explicit BidirectionalAStar(const label_limits_t& label_limits = label_limits_t());
 
   /**
    * Destructor
@@ -83,6 +84,18 @@ public:
    */
   void Clear() override;
 
+  /**
+   * Lets the search expand the forward and reverse trees at the same time. While one direction
+   * expands its next edge on the calling thread, the edge the other direction is holding is
+   * expanded on a helper thread. Only expansions which the single threaded search would do anyway
+   * are run ahead of time so the resulting paths are identical. Has no effect while an expansion
+   * callback is set.
+   * @param  reader  Graph reader used by the helper thread, it must not be the one passed to
+   *                 GetBestPath since graph readers are not thread safe. It is refreshed to a
+   *                 newly loaded tileset when the search is cleared.
+   */
+  void EnableParallelExpansion(const std::shared_ptr<baldr::GraphReader>& reader);
+
 protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
@@ -121,6 +134,16 @@ protected:
   float threshold_;
   std::vector<CandidateConnection> best_connections_;
 
+  // Helper thread for expanding the other direction, only set when parallel expansion is enabled
+  struct expansion_thread_t;
+  std::unique_ptr<expansion_thread_t> expansion_thread_;
+
+  // Labels replaced while a direction was expanded ahead of time, which have to be put back if the
+  // search ends before the single threaded search would have done that expansion
+  std::vector<std::pair<uint32_t, sif::BDEdgeLabel>> replaced_labels_;
+  bool record_forward_;
+  bool record_reverse_;
+
   /**
    * Initialize the A* heuristic and adjacency lists for both the forward
    * and reverse search.
@@ -184,6 +207,39 @@ protected:
                           uint32_t& shortcuts,
                           const graph_tile_ptr& tile,
                           const baldr::TimeInfo& time_info);
+
+  /**
+   * Settle the predecessor of the forward search and expand from it unless it is pruned.
+   * @param graphreader        to access graph data
+   * @param pred               the edge label popped from the forward adjacency list
+   * @param pred_idx           the index of the label in the label set
+   * @param time_info          time tracking information about the start of the route
+   * @param invariant          static date_time, dont offset the time as the path lengthens
+   */
+  void SettleForward(baldr::GraphReader& graphreader,
+                     sif::BDEdgeLabel pred,
+                     const uint32_t pred_idx,
+                     const baldr::TimeInfo& time_info,
+                     const bool invariant);
+
+  /**
+   * Settle the predecessor of the reverse search and expand from it unless it is pruned.
+   * @param graphreader        to access graph data
+   * @param pred               the edge label popped from the reverse adjacency list
+   * @param pred_idx           the index of the label in the label set
+   * @param time_info          time tracking information about the end of the route
+   * @param invariant          static date_time, dont offset the time as the path lengthens
+   */
+  void SettleReverse(baldr::GraphReader& graphreader,
+                     sif::BDEdgeLabel pred,
+                     const uint32_t pred_idx,
+                     const baldr::TimeInfo& time_info,
+                     const bool invariant);
+
+  /**
+   * Puts back the labels replaced by an expansion that was done ahead of time.
+   */
+  void RestoreReplacedLabels();
   /**
    * Add edges at the origin to the forward adjacency list.
    * @param graphreader  Graph tile reader.
@@ -239,6 +295,31 @@ protected:
                                               const Options& options,
                                               const valhalla::Location& origin,
                                               const valhalla::Location& dest);
+
+  /**
+   * Find where the plateau a connection is on starts. A plateau is a stretch of edges that both
+   * search trees took the same way, every connection on it makes the same path so only one of
+   * them needs to be formed. The plateau is walked back along the forward tree for as long as the
+   * reverse tree goes from the edge before to the edge after.
+   * @param   fwd_idx  Index of the forward edge label of the connection.
+   * @param   rev_idx  Index of the reverse edge label of the connection.
+   * @param   starts   Where the plateaus of forward edge labels walked before start.
+   * @return  Returns the index of the forward edge label the plateau starts at.
+   */
+  uint32_t PlateauStart(uint32_t fwd_idx,
+                        uint32_t rev_idx,
+                        std::unordered_map<uint32_t, uint32_t>& starts) const;
+
+  /**
+   * Gets the edges of the path a connection makes from the edge labels, with how long each one
+   * takes, without forming the path.
+   * @param   fwd_idx  Index of the forward edge label of the connection.
+   * @param   rev_idx  Index of the reverse edge label of the connection.
+   * @param   edges    Edges and their durations, in no particular order.
+   */
+  void GetConnectionEdges(uint32_t fwd_idx,
+                          uint32_t rev_idx,
+                          std::vector<std::pair<baldr::GraphId, float>>& edges) const;
 };
 
 // This function checks if the path formed by the two expanding trees
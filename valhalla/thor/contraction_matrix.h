@@ -0,0 +1,107 @@
+#ifndef VALHALLA_THOR_CONTRACTION_MATRIX_H_
+#define VALHALLA_THOR_CONTRACTION_MATRIX_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/contractionhierarchy.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+#include <valhalla/thor/expansion_pool.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Many to many time and distance matrix on a contraction hierarchy in the style of RPHAST. First
+ * the part of the hierarchy above the targets is selected once, ordered from the top down and
+ * copied into a compact array. Then every source gets an upward search followed by a single
+ * linear sweep over that array, each node taking the best of its arcs from above. The sweep is
+ * done for a batch of sources at once with the values of a node for all of them next to each
+ * other, so the inner loop is over contiguous floats and vectorizes.
+ *
+ * The hierarchy doesnt know about complex restrictions so the matrix doesnt either.
+ */
+class ContractionMatrix {
+public:
+  /**
+   * Constructor.
+   * @param  hierarchy  The hierarchy of the costing of the request.
+   * @param  pool       Threads to sweep batches of sources on in parallel.
+   */
+  explicit ContractionMatrix(const baldr::ContractionHierarchy& hierarchy,
+                             ExpansionPool* pool = nullptr);
+
+  /**
+   * Many to many time and distance matrix.
+   * @param  source_locations  List of source locations.
+   * @param  target_locations  List of target locations.
+   * @param  graphreader       Graph reader for accessing routing graph.
+   * @param  mode_costing      Costing methods.
+   * @param  mode              Travel mode to use.
+   * @return time/distance from all sources to all targets
+   */
+  std::vector<TimeDistance>
+  SourceToTarget(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_locations,
+                 const google::protobuf::RepeatedPtrField<valhalla::Location>& target_locations,
+                 baldr::GraphReader& graphreader,
+                 const sif::mode_costing_t& mode_costing,
+                 const sif::TravelMode mode);
+
+protected:
+  // How many sources are swept together
+  static constexpr uint32_t kBatchSize = 8;
+
+  // Where a search starts or ends on the hierarchy and what the part of the edge costs
+  struct seed_t {
+    uint32_t node;
+    float cost;
+    float secs;
+    float length;
+  };
+
+  // The values of a node of the selection for every source of a batch
+  struct values_t {
+    float cost[kBatchSize];
+    float secs[kBatchSize];
+    float length[kBatchSize];
+  };
+
+  // An arc of the selection, from a node earlier in the sweep
+  struct sweep_arc_t {
+    uint32_t from;
+    float cost;
+    float secs;
+    float length;
+  };
+
+  // Finds the seeds of a location, forward is for sources
+  std::vector<seed_t> Seeds(baldr::GraphReader& graphreader,
+                            const valhalla::Location& location,
+                            const bool forward) const;
+
+  // Selects the nodes above the targets and orders them for the sweep
+  void Select(const std::vector<std::vector<seed_t>>& target_seeds);
+
+  // Computes the values of every selected node for a batch of sources
+  void Sweep(const std::vector<std::vector<seed_t>>& source_seeds,
+             const size_t batch,
+             std::vector<values_t>& values) const;
+
+  const baldr::ContractionHierarchy& hierarchy_;
+  ExpansionPool* pool_;
+  sif::cost_ptr_t costing_;
+
+  // The selection, in sweep order, with the arcs into each node as a compact array
+  std::unordered_map<uint32_t, uint32_t> selected_;
+  std::vector<uint32_t> arc_offsets_;
+  std::vector<sweep_arc_t> arcs_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CONTRACTION_MATRIX_H_
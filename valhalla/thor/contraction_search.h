@@ -0,0 +1,157 @@
+#ifndef VALHALLA_THOR_CONTRACTION_SEARCH_H_
+#define VALHALLA_THOR_CONTRACTION_SEARCH_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/contractionhierarchy.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Bidirectional search on the contraction hierarchies built by mjolnir::ContractionBuilder. Both
+ * directions only go upward in the hierarchy so they settle a few hundred nodes no matter how far
+ * apart the locations are. The hierarchies are built with the default options of a costing and
+ * without time dependence so they can only answer requests which use exactly those.
+ *
+ * Complex restrictions cant be expressed as turns between two edges so they are not part of the
+ * hierarchy. When the best path runs over an edge of one, the request is handed to the fallback
+ * algorithm instead, as are requests the hierarchy cant represent for other reasons.
+ */
+class ContractionSearch : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param fallback  What answers the requests the hierarchy cant.
+   */
+  explicit ContractionSearch(PathAlgorithm& fallback);
+
+  /**
+   * Maps the hierarchies listed in mjolnir.contraction_hierarchies from the tile_dir. Costings
+   * whose hierarchy is missing are logged and left out.
+   * @param config  The mjolnir config.
+   */
+  void Load(const boost::property_tree::ptree& config);
+
+  /**
+   * Whether the request can be answered from a hierarchy, meaning one was loaded for its costing
+   * and the costing options are the defaults it was built with. Time dependence and alternates
+   * are up to the caller to rule out.
+   * @param options  The request options.
+   * @return true if the hierarchy applies
+   */
+  bool Supports(const Options& options) const {
+    return Hierarchy(options) != nullptr;
+  }
+
+  /**
+   * The hierarchy to answer the request from, see Supports.
+   * @param options  The request options.
+   * @return the hierarchy or nullptr if none applies
+   */
+  const baldr::ContractionHierarchy* Hierarchy(const Options& options) const;
+
+  /**
+   * Form the shortest path between origin and destination, uses the fallback if the hierarchy
+   * doesnt apply.
+   * @param  origin       Origin location
+   * @param  dest         Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing Costing methods for each mode.
+   * @param  mode         Travel mode to use.
+   * @param  options      The request options.
+   * @return the path found, a single one
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  const char* name() const override {
+    return "contraction_hierarchy";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+protected:
+  // What the search knows about a node of the hierarchy. The parent is the node the arc came
+  // from in the forward search and the node it leads to in the reverse search. Nodes the search
+  // started from have the index of their path edge instead.
+  struct label_t {
+    float cost;
+    uint32_t parent;
+    uint32_t middle;
+    uint32_t path_edge;
+  };
+  using labels_t = std::unordered_map<uint32_t, label_t>;
+  using entry_t = std::pair<float, uint32_t>;
+  using queue_t = std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>>;
+
+  // Seeds a direction with the path edges of its location
+  void SetLocation(baldr::GraphReader& graphreader,
+                   const baldr::ContractionHierarchy& hierarchy,
+                   const valhalla::Location& location,
+                   const bool forward);
+
+  // Settles the next node of a direction and relaxes its arcs
+  void Settle(const baldr::ContractionHierarchy& hierarchy, const bool forward);
+
+  // Appends the nodes an arc stands for, excluding where it starts
+  void Unpack(const baldr::ContractionHierarchy& hierarchy,
+              const uint32_t from,
+              const uint32_t to,
+              const uint32_t middle,
+              std::vector<uint32_t>& nodes) const;
+
+  // Turns the edges of the path back into path infos with the costs the costing gives them
+  std::vector<PathInfo> FormPath(baldr::GraphReader& graphreader,
+                                 const std::vector<baldr::GraphId>& edges,
+                                 const valhalla::Location::PathEdge& origin,
+                                 const valhalla::Location::PathEdge& destination);
+
+  PathAlgorithm& fallback_;
+  std::unordered_map<int, std::unique_ptr<const baldr::ContractionHierarchy>> hierarchies_;
+  // the serialized default options of every costing with a hierarchy
+  std::unordered_map<int, std::string> default_options_;
+
+  sif::TravelMode mode_;
+  std::shared_ptr<sif::DynamicCost> costing_;
+
+  labels_t forward_labels_;
+  labels_t reverse_labels_;
+  queue_t forward_queue_;
+  queue_t reverse_queue_;
+
+  // the cheapest connection so far and the node it meets at
+  float best_cost_;
+  uint32_t best_node_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CONTRACTION_SEARCH_H_
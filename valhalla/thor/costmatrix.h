@@ -11,10 +11,14 @@
 #include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/time_info.h>
 #include <valhalla/proto/tripcommon.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/expansion_pool.h>
+#include <valhalla/thor/label_limits.h>
+#include <valhalla/thor/pathinfo.h>
 
 namespace valhalla {
 namespace thor {
@@ -49,8 +53,14 @@ struct TimeDistance {
 struct LocationStatus {
   int threshold;
   std::set<uint32_t> remaining_locations;
-
-  LocationStatus(const int t) : threshold(t) {
+  // how many of the other locations a connection was found to
+  uint32_t connections;
+  // no label the search has yet to expand costs less than this
+  float frontier;
+  // the cost of the k-th nearest connection of a source found so far
+  float nearest_cost;
+
+  LocationStatus(const int t) : threshold(t), connections(0), frontier(0), nearest_cost(kMaxCost) {
   }
 };
 
@@ -90,13 +100,18 @@ public:
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   * @param  label_limits  Limits on the memory used for labels.
+   * @param  pool          Threads to run the searches of the locations on in parallel, the
+   *                       matrix is the same with or without them.
    */
-  CostMatrix();
+  explicit CostMatrix(const label_limits_t& label_limits = label_limits_t(),
+                      ExpansionPool* pool = nullptr);
   ~CostMatrix();
 
   /**
    * Forms a time distance matrix from the set of source locations
-   * to the set of target locations.
+   * to the set of target locations. The sources which have a date_time depart at it, the times
+   * to their targets then follow the traffic along the way.
    * @param  source_location_list  List of source/origin locations.
    * @param  target_location_list  List of target/destination locations.
    * @param  graphreader           Graph reader for accessing routing graph.
@@ -113,6 +128,34 @@ public:
                  const sif::TravelMode mode,
                  const float max_matrix_distance);
 
+  /**
+   * Recovers the path of a connection the last matrix found from the search trees it left behind,
+   * which are kept until the next matrix or Clear.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  source       Index of the source of the pair.
+   * @param  target       Index of the target of the pair.
+   * @param  origin       The source location.
+   * @param  destination  The target location.
+   * @return the path, empty if there was no connection or it is trivial
+   */
+  std::vector<PathInfo> RecoverShortestPath(baldr::GraphReader& graphreader,
+                                            const uint32_t source,
+                                            const uint32_t target,
+                                            const valhalla::Location& origin,
+                                            const valhalla::Location& destination) const;
+
+  /**
+   * Limits the matrix to the pairs which are asked for, so that the searches can stop as soon as
+   * they have found them rather than once every pair was found. The limits are kept until they
+   * are set again.
+   * @param  k_nearest    How many of the nearest targets to find for each source, all if 0. The
+   *                      other targets of a source are not found. A source stops once none of
+   *                      the connections not found yet can be cheaper than its k-th nearest.
+   * @param  cost_cutoff  Seconds a pair may be apart at most to be found, no limit if 0. Labels
+   *                      further than that from their location are not expanded.
+   */
+  void SetLimits(const uint32_t k_nearest, const float cost_cutoff);
+
   /**
    * Clear the temporary information generated during time+distance
    * matrix construction.
@@ -138,6 +181,18 @@ protected:
   // The cost threshold being used for the currently executing query
   float current_cost_threshold_;
 
+  // How many targets each source needs and how far apart a pair may be, 0 if no limit
+  uint32_t k_nearest_;
+  float cost_cutoff_;
+  // Scratch space for the costs of the connections of a source
+  std::vector<float> nearest_costs_;
+
+  // When each source departs, invalid for the sources without a date_time. Every source has its
+  // own timezone cache as the searches may run on different threads.
+  std::vector<baldr::TimeInfo> source_time_info_;
+  std::vector<baldr::DateTime::tz_sys_info_cache_t> source_tz_cache_;
+  bool time_dependent_;
+
   // Status
   std::vector<LocationStatus> source_status_;
   std::vector<LocationStatus> target_status_;
@@ -159,6 +214,28 @@ protected:
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
 
+  // How much label memory the searches may use
+  label_limits_t label_limits_;
+
+  // Optional threads to run the searches on
+  ExpansionPool* pool_;
+
+  // A connection a search found which changes the status of its source and target. The searches
+  // only queue these and they get applied in location order once all of them are done so that
+  // the result does not depend on which search ran first.
+  struct StatusUpdate {
+    uint32_t source;
+    uint32_t target;
+    uint32_t label_count;
+    // false if the update is only because a search was exhausted
+    bool connected;
+  };
+
+  // Per location status updates and edges reached by the backward searches in this iteration
+  std::vector<std::vector<StatusUpdate>> status_updates_;
+  std::vector<std::vector<baldr::GraphId>> target_reached_;
+  std::vector<uint32_t> active_;
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -193,11 +270,52 @@ protected:
   void CheckForwardConnections(const uint32_t source, const sif::BDEdgeLabel& pred, const uint32_t n);
 
   /**
-   * Update status when a connection is found.
+   * Queue a status update for when a connection is found.
+   * @param  index   Index of the location whose search found the connection
    * @param  source  Source index
    * @param  target  Target index
+   * @param  connected  Whether a connection was found or a search was exhausted
+   */
+  void QueueStatus(const uint32_t index,
+                   const uint32_t source,
+                   const uint32_t target,
+                   const bool connected = true);
+
+  /**
+   * Update status when a connection is found.
+   * @param  update  The source, target and how many labels both searches had at the time
+   */
+  void UpdateStatus(const StatusUpdate& update);
+
+  /**
+   * Stops looking for more targets of a source once it has found as many as it needs. It still
+   * searches a limited number of times to improve the connections found so far.
+   * @param  source       Source index
+   * @param  label_count  How many labels the searches had when the last one was found
+   */
+  void StopSource(const uint32_t source, const uint32_t label_count);
+
+  /**
+   * Works out the cost of the k-th nearest connection a source has found so far.
+   * @param  source  Source index
+   */
+  void UpdateNearestCost(const uint32_t source);
+
+  /**
+   * Stops the sources whose k nearest targets are final, which is once every connection that has
+   * not been found yet has to cost more than the k-th nearest: such a connection costs at least as
+   * much as the frontier of the search of its source or of the search of its target.
    */
-  void UpdateStatus(const uint32_t source, const uint32_t target);
+  void StopNearestSources();
+
+  /**
+   * Runs one step of the search of every source or target location which is still expanding
+   * and then applies what the searches found in location order.
+   * @param  forward      Whether to expand the sources or the targets
+   * @param  n            Iteration counter.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   */
+  void Expand(const bool forward, const uint32_t n, baldr::GraphReader& graphreader);
 
   /**
    * Iterate the backward search from the target/destination location.
@@ -206,6 +324,14 @@ protected:
    */
   void BackwardSearch(const uint32_t index, baldr::GraphReader& graphreader);
 
+  /**
+   * Sets when each source departs, if it has a date_time, and whether any of them does.
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  sources       List of source/origin locations.
+   */
+  void SetTimes(baldr::GraphReader& graphreader,
+                const google::protobuf::RepeatedPtrField<valhalla::Location>& sources);
+
   /**
    * Sets the source/origin locations. Search expands forward from these
    * locations.
@@ -242,6 +368,37 @@ protected:
                           const sif::BDEdgeLabel& pred,
                           const uint32_t predindex);
 
+  /**
+   * Gets the edges of the path of a connection by walking the search trees from it.
+   * @param  source       Index of the source of the pair.
+   * @param  target       Index of the target of the pair.
+   * @param  origin       The source location.
+   * @param  destination  The target location.
+   * @param  path         Gets the edges from the source to the target.
+   * @param  source_pct   Gets how far along the first edge the source is.
+   * @param  target_pct   Gets how far along the last edge the target is.
+   * @return whether a path was found, not if the pair was trivial or there was no connection
+   */
+  bool ConnectionPath(const uint32_t source,
+                      const uint32_t target,
+                      const valhalla::Location& origin,
+                      const valhalla::Location& destination,
+                      std::vector<baldr::GraphId>& path,
+                      float& source_pct,
+                      float& target_pct) const;
+
+  /**
+   * Recosts the paths of the connections found from the sources which have a date_time, at the
+   * time they get to each edge. The searches only pick the paths, the backward ones cant know when
+   * the targets are reached.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  sources      List of source/origin locations.
+   * @param  targets      List of target locations.
+   */
+  void RecostPaths(baldr::GraphReader& graphreader,
+                   const google::protobuf::RepeatedPtrField<valhalla::Location>& sources,
+                   const google::protobuf::RepeatedPtrField<valhalla::Location>& targets);
+
   /**
    * Form a time/distance matrix from the results.
    * @return  Returns a time distance matrix among locations.
@@ -17,6 +17,7 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/expansion_pool.h>
 #include <valhalla/thor/pathalgorithm.h>
 
 namespace valhalla {
@@ -39,7 +40,7 @@ enum class ExpansionRecommendation {
  */
 class Dijkstras {
 public:
-  Dijkstras();
+  explicit Dijkstras(const label_limits_t& label_limits = label_limits_t());
   virtual ~Dijkstras() {
   }
 
@@ -85,7 +86,47 @@ public:
                     const sif::mode_costing_t& mode_costing,
                     const sif::TravelMode mode);
 
+  /**
+   * Expands the forward traversals expected to reach far a bucket of the adjacency list at a
+   * time. The edges leaving the labels of the bucket are costed on the threads of the pool, then
+   * added to the adjacency list in the order of the bucket so the result doesnt depend on how the
+   * threads were scheduled. The labels within a bucket come out in no particular order anyway so
+   * settling all of them before expanding any of them is not less exact than one at a time.
+   * @param  pool          The threads to expand on, nothing is expanded in parallel if null
+   * @param  min_distance  How far in meters the traversal has to be expected to go
+   */
+  void EnableParallelExpansion(ExpansionPool* pool, const float min_distance);
+
 protected:
+  /**
+   * The forward best first graph traversal with the hooks of hooks_t. The virtual Compute passes
+   * Dijkstras so the hooks go through the vtable, a final subclass passes itself so that its hooks
+   * are called directly and can be inlined into the loop. The subclass has to befriend Dijkstras
+   * for its protected hooks to be reachable.
+   * @param  origin_locs  List of origin locations.
+   * @param  graphreader  Graphreader
+   * @param  mode_costing List of costing objects
+   * @param  mode         Travel mode
+   */
+  template <typename hooks_t>
+  void Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origin_locs,
+               baldr::GraphReader& graphreader,
+               const sif::mode_costing_t& mode_costing,
+               const sif::TravelMode mode);
+
+  /**
+   * The reverse best first graph traversal with the hooks of hooks_t, see Compute.
+   * @param  dest_locations  List of destination locations.
+   * @param  graphreader     Graphreader
+   * @param  mode_costing    List of costing objects
+   * @param  mode            Travel mode
+   */
+  template <typename hooks_t>
+  void ComputeReverse(google::protobuf::RepeatedPtrField<valhalla::Location>& dest_locations,
+                      baldr::GraphReader& graphreader,
+                      const sif::mode_costing_t& mode_costing,
+                      const sif::TravelMode mode);
+
   // A child-class must implement this to learn about what nodes were expanded
   virtual void ExpandingNode(baldr::GraphReader&,
                              graph_tile_ptr,
@@ -123,6 +164,12 @@ protected:
   std::vector<sif::BDEdgeLabel> bdedgelabels_;
   std::vector<sif::MMEdgeLabel> mmedgelabels_;
 
+  // The edges leaving the node being expanded which are worth relaxing, their restriction
+  // indices and their costs
+  std::vector<uint32_t> edge_indices_;
+  std::vector<int> restriction_idxs_;
+  std::vector<sif::Cost> edge_costs_;
+
   // Adjacency list - approximate double bucket sort
   std::shared_ptr<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> adjacencylist_;
   std::shared_ptr<baldr::DoubleBucketQueue<sif::MMEdgeLabel>> mmadjacencylist_;
@@ -133,6 +180,43 @@ protected:
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
+  // how much label memory to keep between requests and to allow per request
+  label_limits_t label_limits_;
+
+  // How far the next traversal is expected to reach in meters, up to the child-class to set
+  float expected_distance_;
+
+  // The threads to expand far reaching traversals on and how far that has to be
+  ExpansionPool* pool_;
+  float parallel_distance_;
+
+  // An edge reached from the end node of one of the labels of the bucket being expanded and the
+  // position of that label in the bucket
+  struct relaxation_t {
+    uint32_t position;
+    uint32_t pred_idx;
+    baldr::GraphId edgeid;
+    baldr::GraphId oppedgeid;
+    const baldr::DirectedEdge* edge;
+    graph_tile_ptr tile;
+    sif::Cost cost;
+    sif::Cost transition_cost;
+    uint32_t path_distance;
+    int restriction_idx;
+  };
+
+  // What each thread keeps while it finds the relaxations of its share of the bucket
+  struct expansion_scratch_t {
+    std::vector<relaxation_t> relaxations;
+    std::vector<uint32_t> edge_indices;
+    std::vector<int> restriction_idxs;
+    std::vector<sif::Cost> edge_costs;
+    baldr::DateTime::tz_sys_info_cache_t tz_cache;
+  };
+  std::vector<expansion_scratch_t> scratch_;
+  std::vector<uint32_t> bucket_;
+  std::vector<relaxation_t> relaxations_;
+
   /**
    * Initialization prior to computing the graph expansion
    *
@@ -166,6 +250,7 @@ protected:
    * @param from_transition Boolean indicating if this expansion is from a transition edge.
    * @param time_info Tracks time offset as the expansion progresses
    */
+  template <typename hooks_t>
   void ExpandForward(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      const sif::EdgeLabel& pred,
@@ -173,6 +258,35 @@ protected:
                      const bool from_transition,
                      const baldr::TimeInfo& time_info);
 
+  /**
+   * The forward traversal a bucket at a time on the pool, once the origins are in the adjacency
+   * list.
+   * @param graphreader  Graph reader of the calling thread.
+   * @param time_info    Time at the origin.
+   */
+  void ComputeParallel(baldr::GraphReader& graphreader, const baldr::TimeInfo& time_info);
+
+  /**
+   * Finds the edges a label of the bucket can improve, ExpandForward without changing anything
+   * so that it can run on several threads at once.
+   * @param reader          Graph reader of the thread.
+   * @param node            Graph Id of the node to expand.
+   * @param pred            Edge label of the predecessor edge leading to the node.
+   * @param pred_idx        Index in the edge label list of the predecessor edge.
+   * @param position        Position of the predecessor in the bucket.
+   * @param from_transition Boolean indicating if this expansion is from a transition edge.
+   * @param time_info       Tracks time offset as the expansion progresses
+   * @param scratch         Gets the relaxations.
+   */
+  void FindRelaxations(baldr::GraphReader& reader,
+                       const baldr::GraphId& node,
+                       const sif::EdgeLabel& pred,
+                       const uint32_t pred_idx,
+                       const uint32_t position,
+                       const bool from_transition,
+                       const baldr::TimeInfo& time_info,
+                       expansion_scratch_t& scratch) const;
+
   /**
    * Expand from the node along the reverse search path.
    * @param graphreader  Graph reader.
@@ -182,6 +296,7 @@ protected:
    * @param from_transition Boolean indicating if this expansion is from a transition edge.
    * @param time_info Tracks time offset as the expansion progresses
    */
+  template <typename hooks_t>
   void ExpandReverse(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      const sif::BDEdgeLabel& pred,
@@ -255,6 +370,357 @@ protected:
   }
 };
 
+// The traversals are defined here so that the subclasses passing themselves as the hooks get
+// them instantiated next to their hooks
+
+// Expand from a node in the forward direction
+template <typename hooks_t>
+void Dijkstras::ExpandForward(baldr::GraphReader& graphreader,
+                              const baldr::GraphId& node,
+                              const sif::EdgeLabel& pred,
+                              const uint32_t pred_idx,
+                              const bool from_transition,
+                              const baldr::TimeInfo& time_info) {
+  // Get the tile and the node info. Skip if tile is null (can happen
+  // with regional data sets) or if no access at the node.
+  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  if (tile == nullptr) {
+    return;
+  }
+
+  // Get the nodeinfo
+  const baldr::NodeInfo* nodeinfo = tile->node(node);
+
+  // We dont need to do transitions again we just need to queue the edges that leave them
+  if (!from_transition) {
+    // Let implementing class we are expanding from here
+    sif::EdgeLabel* prev_pred =
+        pred.predecessor() == baldr::kInvalidLabel ? nullptr : &bdedgelabels_[pred.predecessor()];
+    static_cast<hooks_t*>(this)->ExpandingNode(graphreader, tile, nodeinfo, pred, prev_pred);
+  }
+
+  // Bail if we cant expand from here
+  if (!costing_->Allowed(nodeinfo)) {
+    return;
+  }
+
+  // Update the time information
+  auto offset_time =
+      from_transition ? time_info
+                      : time_info.forward(pred.cost().secs, static_cast<int>(nodeinfo->timezone()));
+
+  // Expand from end node in forward direction.
+  const baldr::GraphId first_edgeid = {node.tileid(), node.level(), nodeinfo->edge_index()};
+  EdgeStatusInfo* const first_es = edgestatus_.GetPtr(first_edgeid, tile);
+  const baldr::DirectedEdge* const first_edge = tile->directededge(first_edgeid);
+
+  // Find the edges worth relaxing first so that only those get costed, all at once since the
+  // edges of the node are next to each other in the tile
+  edge_indices_.clear();
+  restriction_idxs_.clear();
+  baldr::GraphId edgeid = first_edgeid;
+  EdgeStatusInfo* es = first_es;
+  const baldr::DirectedEdge* directededge = first_edge;
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid, ++es) {
+    // Skip this edge if permanently labeled (best path already found to this
+    // directed edge). skip shortcuts or if no access is allowed to this edge
+    // (based on the costing method) or if a complex restriction exists for
+    // this path.
+    if (directededge->is_shortcut() || es->set() == EdgeSet::kPermanent ||
+        !(directededge->forwardaccess() & access_mode_)) {
+      continue;
+    }
+
+    // Check if the edge is allowed or if a restriction occurs
+    EdgeStatus* todo = nullptr;
+    int restriction_idx = -1;
+    if (offset_time.valid) {
+      // With date time we check time dependent restrictions and access
+      if (!costing_->Allowed(directededge, pred, tile, edgeid, offset_time.local_time,
+                             nodeinfo->timezone(), restriction_idx) ||
+          costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true, todo,
+                               offset_time.local_time, nodeinfo->timezone())) {
+        continue;
+      }
+    } else {
+      if (!costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, restriction_idx) ||
+          costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true)) {
+        continue;
+      }
+    }
+    edge_indices_.push_back(i);
+    restriction_idxs_.push_back(restriction_idx);
+  }
+  edge_costs_.resize(edge_indices_.size());
+  costing_->EdgeCosts(first_edge, edge_indices_.data(), edge_indices_.size(), tile,
+                      offset_time.second_of_week, edge_costs_.data());
+
+  for (uint32_t k = 0; k < edge_indices_.size(); ++k) {
+    directededge = first_edge + edge_indices_[k];
+    edgeid = first_edgeid + edge_indices_[k];
+    es = first_es + edge_indices_[k];
+    const int restriction_idx = restriction_idxs_[k];
+
+    // Compute the cost and path distance to the end of this edge
+    sif::Cost transition_cost = costing_->TransitionCost(directededge, nodeinfo, pred);
+    sif::Cost newcost = pred.cost() + edge_costs_[k] + transition_cost;
+    uint32_t path_dist = pred.path_distance() + directededge->length();
+
+    // Check if edge is temporarily labeled and this path has less cost. If
+    // less cost the predecessor is updated and the sort cost is decremented
+    // by the difference in real cost (A* heuristic doesn't change)
+    if (es->set() == EdgeSet::kTemporary) {
+      sif::BDEdgeLabel& lab = bdedgelabels_[es->index()];
+      if (newcost.cost < lab.cost().cost) {
+        float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
+        adjacencylist_->decrease(es->index(), newsortcost);
+        lab.Update(pred_idx, newcost, newsortcost, transition_cost, path_dist, restriction_idx);
+      }
+      continue;
+    }
+
+    // Only needed if you want to connect with a reverse path
+    graph_tile_ptr t2 = tile;
+    baldr::GraphId oppedgeid = graphreader.GetOpposingEdgeId(edgeid, t2);
+
+    // Add edge label, add to the adjacency list and set edge status
+    uint32_t idx = bdedgelabels_.size();
+    *es = {EdgeSet::kTemporary, idx};
+    bdedgelabels_.emplace_back(pred_idx, edgeid, oppedgeid, directededge, newcost, mode_,
+                               transition_cost, path_dist, false, restriction_idx);
+    adjacencylist_->add(idx);
+  }
+
+  // Handle transitions - expand from the end node of each transition
+  if (!from_transition && nodeinfo->transition_count() > 0) {
+    const baldr::NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
+      ExpandForward<hooks_t>(graphreader, trans->endnode(), pred, pred_idx, true, offset_time);
+    }
+  }
+}
+
+// Compute the forward graph traversal
+template <typename hooks_t>
+void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origin_locations,
+                        baldr::GraphReader& graphreader,
+                        const sif::mode_costing_t& mode_costing,
+                        const sif::TravelMode mode) {
+
+  // Set the mode and costing
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  access_mode_ = costing_->access_mode();
+
+  // Prepare for a graph traversal
+  Initialize(bdedgelabels_, adjacencylist_, costing_->UnitSize());
+  SetOriginLocations(graphreader, origin_locations, costing_);
+
+  // Get the time information for all the origin locations
+  auto time_infos = SetTime(origin_locations, graphreader);
+
+  // Far reaching traversals go a bucket at a time on the pool
+  if (pool_ && expected_distance_ >= parallel_distance_) {
+    ComputeParallel(graphreader, time_infos.front());
+    return;
+  }
+
+  // Compute the isotile
+  auto cb_decision = ExpansionRecommendation::continue_expansion;
+  while (cb_decision != ExpansionRecommendation::stop_expansion) {
+    label_limits_.check(bdedgelabels_, mmedgelabels_, adjacencylist_, mmadjacencylist_,
+                        edgestatus_);
+
+    // Get next element from adjacency list. Check that it is valid. An
+    // invalid label indicates there are no edges that can be expanded.
+    uint32_t predindex = adjacencylist_->pop();
+    if (predindex == baldr::kInvalidLabel) {
+      break;
+    }
+
+    // Copy the EdgeLabel for use in costing and settle the edge.
+    sif::EdgeLabel pred = bdedgelabels_[predindex];
+    edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+    // Check if we should stop
+    cb_decision =
+        static_cast<hooks_t*>(this)->ShouldExpand(graphreader, pred, InfoRoutingType::forward);
+    if (cb_decision != ExpansionRecommendation::prune_expansion) {
+      // Expand from the end node in forward direction.
+      ExpandForward<hooks_t>(graphreader, pred.endnode(), pred, predindex, false,
+                             time_infos.front());
+    }
+  }
+}
+
+// Expand from a node in reverse direction.
+template <typename hooks_t>
+void Dijkstras::ExpandReverse(baldr::GraphReader& graphreader,
+                              const baldr::GraphId& node,
+                              const sif::BDEdgeLabel& pred,
+                              const uint32_t pred_idx,
+                              const baldr::DirectedEdge* opp_pred_edge,
+                              const bool from_transition,
+                              const baldr::TimeInfo& time_info) {
+  // Get the tile and the node info. Skip if tile is null (can happen
+  // with regional data sets) or if no access at the node.
+  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  if (tile == nullptr) {
+    return;
+  }
+
+  // Get the nodeinfo
+  const baldr::NodeInfo* nodeinfo = tile->node(node);
+
+  // We dont need to do transitions again we just need to queue the edges that leave them
+  if (!from_transition) {
+    // Let implementing class we are expanding from here
+    sif::EdgeLabel* prev_pred =
+        pred.predecessor() == baldr::kInvalidLabel ? nullptr : &bdedgelabels_[pred.predecessor()];
+    static_cast<hooks_t*>(this)->ExpandingNode(graphreader, tile, nodeinfo, pred, prev_pred);
+  }
+
+  // Bail if we cant expand from here
+  if (!costing_->Allowed(nodeinfo)) {
+    return;
+  }
+
+  // Update the time information
+  auto offset_time =
+      from_transition ? time_info
+                      : time_info.reverse(pred.cost().secs, static_cast<int>(nodeinfo->timezone()));
+
+  // Expand from end node in reverse direction.
+  baldr::GraphId edgeid = {node.tileid(), node.level(), nodeinfo->edge_index()};
+  EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
+  const baldr::DirectedEdge* directededge = tile->directededge(edgeid);
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid, ++es) {
+    // Skip this edge if permanently labeled (best path already found to this
+    // directed edge), if no access for this mode, or if edge is a shortcut
+    if (!(directededge->reverseaccess() & access_mode_) || directededge->is_shortcut() ||
+        es->set() == EdgeSet::kPermanent) {
+      continue;
+    }
+
+    // Get end node tile, opposing edge Id, and opposing directed edge.
+    graph_tile_ptr t2 = tile;
+    auto opp_edge_id = graphreader.GetOpposingEdgeId(edgeid, t2);
+    if (t2 == nullptr) {
+      continue;
+    }
+    const baldr::DirectedEdge* opp_edge = t2->directededge(opp_edge_id);
+
+    // Check if the edge is allowed or if a restriction occurs
+    EdgeStatus* todo = nullptr;
+    int restriction_idx = -1;
+    if (offset_time.valid) {
+      // With date time we check time dependent restrictions and access
+      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, opp_edge_id,
+                                    offset_time.local_time, nodeinfo->timezone(),
+                                    restriction_idx) ||
+          costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, false, todo,
+                               offset_time.local_time, nodeinfo->timezone())) {
+        continue;
+      }
+    } else {
+      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, opp_edge_id, 0, 0,
+                                    restriction_idx) ||
+          costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, false)) {
+        continue;
+      }
+    }
+
+    // Compute the cost to the end of this edge with separate transition cost
+    sif::Cost transition_cost =
+        costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
+                                        opp_pred_edge);
+    sif::Cost newcost = pred.cost() + costing_->EdgeCost(opp_edge, t2, offset_time.second_of_week);
+    newcost.cost += transition_cost.cost;
+    uint32_t path_dist = pred.path_distance() + directededge->length();
+
+    // Check if edge is temporarily labeled and this path has less cost. If
+    // less cost the predecessor is updated and the sort cost is decremented
+    // by the difference in real cost (A* heuristic doesn't change)
+    if (es->set() == EdgeSet::kTemporary) {
+      sif::BDEdgeLabel& lab = bdedgelabels_[es->index()];
+      if (newcost.cost < lab.cost().cost) {
+        float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
+        adjacencylist_->decrease(es->index(), newsortcost);
+        lab.Update(pred_idx, newcost, newsortcost, transition_cost, path_dist, restriction_idx);
+      }
+      continue;
+    }
+
+    // Add edge label, add to the adjacency list and set edge status
+    uint32_t idx = bdedgelabels_.size();
+    *es = {EdgeSet::kTemporary, idx};
+    bdedgelabels_.emplace_back(pred_idx, edgeid, opp_edge_id, directededge, newcost, mode_,
+                               transition_cost, path_dist, false, restriction_idx);
+    adjacencylist_->add(idx);
+  }
+
+  // Handle transitions - expand from the end node of each transition
+  if (!from_transition && nodeinfo->transition_count() > 0) {
+    const baldr::NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
+      ExpandReverse<hooks_t>(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true,
+                             offset_time);
+    }
+  }
+}
+
+// Compute the reverse graph traversal
+template <typename hooks_t>
+void Dijkstras::ComputeReverse(
+    google::protobuf::RepeatedPtrField<valhalla::Location>& dest_locations,
+    baldr::GraphReader& graphreader,
+    const sif::mode_costing_t& mode_costing,
+    const sif::TravelMode mode) {
+  // Set the mode and costing
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  access_mode_ = costing_->access_mode();
+
+  // Prepare for graph traversal
+  Initialize(bdedgelabels_, adjacencylist_, costing_->UnitSize());
+  SetDestinationLocations(graphreader, dest_locations, costing_);
+
+  // Get the time information for all the destination locations
+  auto time_infos = SetTime(dest_locations, graphreader);
+
+  // Compute the isotile
+  auto cb_decision = ExpansionRecommendation::continue_expansion;
+  while (cb_decision != ExpansionRecommendation::stop_expansion) {
+    label_limits_.check(bdedgelabels_, mmedgelabels_, adjacencylist_, mmadjacencylist_,
+                        edgestatus_);
+
+    // Get next element from adjacency list. Check that it is valid. An
+    // invalid label indicates there are no edges that can be expanded.
+    uint32_t predindex = adjacencylist_->pop();
+    if (predindex == baldr::kInvalidLabel) {
+      break;
+    }
+
+    // Copy the EdgeLabel for use in costing and settle the edge.
+    sif::BDEdgeLabel pred = bdedgelabels_[predindex];
+    edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+    // Get the opposing predecessor directed edge. Need to make sure we get
+    // the correct one if a transition occurred
+    const baldr::DirectedEdge* opp_pred_edge =
+        graphreader.GetGraphTile(pred.opp_edgeid())->directededge(pred.opp_edgeid());
+
+    // Check if we should stop
+    cb_decision =
+        static_cast<hooks_t*>(this)->ShouldExpand(graphreader, pred, InfoRoutingType::forward);
+    if (cb_decision != ExpansionRecommendation::prune_expansion) {
+      // Expand from the end node in forward direction.
+      ExpandReverse<hooks_t>(graphreader, pred.endnode(), pred, predindex, opp_pred_edge, false,
+                             time_infos.front());
+    }
+  }
+}
+
 } // namespace thor
 } // namespace valhalla
 
@@ -1,7 +1,12 @@
 #ifndef VALHALLA_THOR_EDGESTATUS_H_
 #define VALHALLA_THOR_EDGESTATUS_H_
 
-#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 
@@ -47,25 +52,61 @@ struct EdgeStatusInfo {
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
  * edges. This reduces the number of map lookups.
+ *
+ * The arrays are found through a small open addressing table keyed by tile and
+ * the last tile looked up is remembered since expansions tend to stay within a
+ * tile. Clearing keeps the arrays around so the next search over the same tiles
+ * doesn't have to allocate them again, unless too many have piled up.
  */
 class EdgeStatus {
 public:
+  EdgeStatus() : generation_(1), used_(0), retained_(0), last_tile_(kEmpty), last_(nullptr) {
+  }
+
+  EdgeStatus(const EdgeStatus&) = delete;
+  EdgeStatus& operator=(const EdgeStatus&) = delete;
+
+  EdgeStatus(EdgeStatus&& other) noexcept
+      : slots_(std::move(other.slots_)), generation_(other.generation_), used_(other.used_),
+        retained_(other.retained_), last_tile_(other.last_tile_), last_(other.last_) {
+    other.slots_.clear();
+    other.used_ = other.retained_ = 0;
+    other.last_tile_ = kEmpty;
+    other.last_ = nullptr;
+  }
+
+  /**
+   * Exchanges the status of two searches, eg to put a search aside and carry on with it later.
+   * @param  other  the status to exchange with
+   */
+  void swap(EdgeStatus& other) noexcept {
+    std::swap(slots_, other.slots_);
+    std::swap(generation_, other.generation_);
+    std::swap(used_, other.used_);
+    std::swap(retained_, other.retained_);
+    std::swap(last_tile_, other.last_tile_);
+    std::swap(last_, other.last_);
+  }
+
   /**
    * Destructor. Delete any allocated EdgeStatusInfo arrays.
    */
   ~EdgeStatus() {
-    clear();
+    release();
   }
 
   /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
+   * Clear the edge status of every edge. The arrays are only freed if a lot
+   * of them have accumulated, otherwise they are reused by the next search.
    */
   void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+    last_tile_ = kEmpty;
+    last_ = nullptr;
+    // a wrapped generation would make stale arrays look current
+    if (retained_ > kMaxRetainedEdges || ++generation_ == 0) {
+      release();
+      generation_ = 1;
     }
-    edgestatus_.clear();
   }
 
   /**
@@ -77,16 +118,7 @@ public:
    */
   void
   Set(const baldr::GraphId& edgeid, const EdgeSet set, const uint32_t index, graph_tile_ptr tile) {
-    auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value(),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
-    }
+    lookup(edgeid.tile_value(), tile)[edgeid.id()] = {set, index};
   }
 
   /**
@@ -96,9 +128,9 @@ public:
    * @param  set      Label set for this directed edge.
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set) {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+    auto* edges = find(edgeid.tile_value());
+    if (edges) {
+      edges[edgeid.id()].set_ = static_cast<uint32_t>(set);
     } else {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
@@ -110,8 +142,25 @@ public:
    * @return  Returns edge status info.
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid) const {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    const auto* edges = find(edgeid.tile_value());
+    return edges ? edges[edgeid.id()] : EdgeStatusInfo();
+  }
+
+  /**
+   * Get the status info of a directed edge given its GraphId without remembering
+   * the tile for the next lookup. Unlike Get this is safe to call from several
+   * threads at once as long as none of them modifies the edge status.
+   * @param   edgeid  GraphId of the directed edge.
+   * @return  Returns edge status info.
+   */
+  EdgeStatusInfo GetShared(const baldr::GraphId& edgeid) const {
+    if (slots_.empty()) {
+      return EdgeStatusInfo();
+    }
+    const auto* slot = probe(edgeid.tile_value());
+    return slot->tile == edgeid.tile_value() && slot->generation == generation_
+               ? slot->edges[edgeid.id()]
+               : EdgeStatusInfo();
   }
 
   /**
@@ -123,23 +172,131 @@ public:
    * @return  Returns a pointer to edge status info for this edge.
    */
   EdgeStatusInfo* GetPtr(const baldr::GraphId& edgeid, const graph_tile_ptr& tile) {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value(),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
-    }
+    return &lookup(edgeid.tile_value(), tile)[edgeid.id()];
+  }
+
+  /**
+   * Memory held for the status of the edges, including the arrays kept from
+   * previous searches which this one may reuse.
+   * @return  Returns how many bytes the table and the arrays take.
+   */
+  size_t bytes() const {
+    return slots_.size() * sizeof(slot_t) + retained_ * sizeof(EdgeStatusInfo);
   }
 
 private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  // Keys are tile values which only use the lower 25 bits
+  static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t kMinSlots = 16;
+  // Above this many retained edges (4 bytes each) we free the arrays on clear, there are searches
+  // keeping one status per location so it has to stay small
+  static constexpr size_t kMaxRetainedEdges = 2 * 1024 * 1024;
+
+  struct slot_t {
+    uint32_t tile = kEmpty;
+    // the search that last used the array, older ones mean the edges are unreached
+    uint32_t generation = 0;
+    uint32_t count = 0;
+    EdgeStatusInfo* edges = nullptr;
+  };
+
+  static size_t hash(uint32_t tile) {
+    return (tile * 0x9E3779B1u) >> 7;
+  }
+
+  // returns the slot of the tile or the empty slot where it belongs
+  slot_t* probe(uint32_t tile) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = hash(tile) & mask;; i = (i + 1) & mask) {
+      const auto& slot = slots_[i];
+      if (slot.tile == tile || slot.tile == kEmpty) {
+        return const_cast<slot_t*>(&slot);
+      }
+    }
+  }
+
+  // returns the edges of this tile for the current search or nullptr if there are none
+  EdgeStatusInfo* find(uint32_t tile) const {
+    if (tile == last_tile_) {
+      return last_;
+    }
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    const auto* slot = probe(tile);
+    if (slot->tile != tile || slot->generation != generation_) {
+      return nullptr;
+    }
+    last_tile_ = tile;
+    last_ = slot->edges;
+    return last_;
+  }
+
+  // returns the edges of this tile for the current search, making or resetting them as needed
+  EdgeStatusInfo* lookup(uint32_t tile, const graph_tile_ptr& graph_tile) {
+    if (tile == last_tile_) {
+      return last_;
+    }
+
+    // keep the table at most half full so probes stay short
+    if ((used_ + 1) * 2 > slots_.size()) {
+      grow();
+    }
+    auto* slot = probe(tile);
+    if (slot->tile == kEmpty) {
+      slot->tile = tile;
+      ++used_;
+    }
+    if (slot->generation != generation_) {
+      // reuse the array from a previous search unless the tile has changed size since then
+      const uint32_t count = graph_tile->header()->directededgecount();
+      if (slot->edges && slot->count == count) {
+        std::fill(slot->edges, slot->edges + count, EdgeStatusInfo());
+      } else {
+        delete[] slot->edges;
+        slot->edges = new EdgeStatusInfo[count];
+        retained_ = retained_ - slot->count + count;
+        slot->count = count;
+      }
+    }
+    slot->generation = generation_;
+
+    last_tile_ = tile;
+    last_ = slot->edges;
+    return last_;
+  }
+
+  void grow() {
+    std::vector<slot_t> old(slots_.empty() ? size_t(kMinSlots) : slots_.size() * 2);
+    old.swap(slots_);
+    for (const auto& slot : old) {
+      if (slot.tile != kEmpty) {
+        *probe(slot.tile) = slot;
+      }
+    }
+  }
+
+  void release() {
+    for (auto& slot : slots_) {
+      delete[] slot.edges;
+    }
+    slots_.clear();
+    used_ = retained_ = 0;
+    last_tile_ = kEmpty;
+    last_ = nullptr;
+  }
+
+  // Edge status - open addressing table of tiles (level and tile Id) to
+  // dynamically allocated arrays of EdgeStatusInfo (sized based on the
+  // directed edge count within the tile).
+  std::vector<slot_t> slots_;
+  uint32_t generation_;
+  size_t used_;
+  size_t retained_;
+
+  // the last tile looked up in the current search and its edges
+  mutable uint32_t last_tile_;
+  mutable EdgeStatusInfo* last_;
 };
 
 } // namespace thor
@@ -0,0 +1,98 @@
+#ifndef VALHALLA_THOR_EXPANSION_POOL_H_
+#define VALHALLA_THOR_EXPANSION_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * A small pool of threads a worker keeps around to run independent searches in parallel, for
+ * example the per location expansions of a matrix. Graph readers are not thread safe so every
+ * thread has its own, which means each thread also has its own tile cache unless the config
+ * enables the global synchronized cache, in which case they all share that one.
+ */
+class ExpansionPool {
+public:
+  using work_t = std::function<void(size_t index, size_t thread, baldr::GraphReader& reader)>;
+
+  /**
+   * Starts the threads.
+   * @param  config   The mjolnir config used to build a graph reader for every thread.
+   * @param  threads  How many threads to start, the thread calling Run helps out as well.
+   */
+  ExpansionPool(const boost::property_tree::ptree& config, const uint32_t threads);
+
+  /**
+   * Stops the threads.
+   */
+  ~ExpansionPool();
+
+  ExpansionPool(const ExpansionPool&) = delete;
+  ExpansionPool& operator=(const ExpansionPool&) = delete;
+
+  /**
+   * Calls work once for every index in [0, count) spread over the threads of the pool and the
+   * calling thread and returns when all of them are done. Which thread runs which index is up to
+   * the scheduling so the work for different indices must not depend on each other. If any of
+   * them throw, the first exception is rethrown once everything has finished.
+   * @param  count   How many pieces of work there are.
+   * @param  work    Does the work for an index, gets the number of the thread it runs on in
+   *                 [0, size()), 0 being the calling thread, and the graph reader of that thread.
+   * @param  reader  The graph reader of the calling thread.
+   */
+  void Run(const size_t count, const work_t& work, baldr::GraphReader& reader);
+
+  /**
+   * Trims the tile caches of the threads which are overcommitted, and switches their readers to
+   * a newly loaded tileset if there is one. Only to be called between calls to Run.
+   */
+  void Trim();
+
+  /**
+   * @return  how many threads work on a call to Run including the calling thread
+   */
+  size_t size() const {
+    return threads_.size() + 1;
+  }
+
+protected:
+  // Runs work for indices until there are none left
+  void Work(const size_t thread, baldr::GraphReader& reader);
+
+  // What each thread of the pool runs until the pool is destroyed
+  void Loop(const size_t thread);
+
+  std::vector<std::unique_ptr<baldr::GraphReader>> readers_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable finish_;
+
+  // The current call to Run, the next index to hand out and how many threads are still on it
+  const work_t* work_;
+  size_t count_;
+  std::atomic<size_t> next_;
+  size_t generation_;
+  size_t busy_;
+  std::exception_ptr error_;
+  bool done_;
+
+  std::vector<std::thread> threads_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_EXPANSION_POOL_H_
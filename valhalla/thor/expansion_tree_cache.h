@@ -0,0 +1,129 @@
+#ifndef VALHALLA_THOR_EXPANSION_TREE_CACHE_H_
+#define VALHALLA_THOR_EXPANSION_TREE_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/edgestatus.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * A least recently used cache of the forward search trees of time distance matrix rows bounded by
+ * their memory, so that rows asked for over and over from the same origins (depots say) carry on
+ * expanding where the last one stopped instead of starting over. A tree is found by the edges its
+ * origin was correlated to and the costing with all of its options, avoided edges included.
+ * The trees are only good for as long as the graph stays the same, whoever owns the cache has to
+ * clear it when the tiles or the traffic change.
+ *
+ * A tree is taken out of the cache while a search uses it and put back, grown, once it is done,
+ * so that the labels dont have to be copied. That part is thread safe as the rows of a matrix can
+ * be searched on more than one thread.
+ */
+class ExpansionTreeCache {
+public:
+  // Everything a search needs to carry on from where it stopped
+  struct tree_t {
+    std::vector<sif::EdgeLabel> labels;
+    EdgeStatus status;
+    // the labels in the order they were taken off the adjacency list, any other label is still on
+    // it when the search carries on
+    std::vector<uint32_t> settled;
+    // whether the last settled label was not expanded yet
+    bool pending = false;
+
+    /**
+     * @return how much memory the tree takes
+     */
+    size_t bytes() const {
+      return labels.capacity() * sizeof(sif::EdgeLabel) + status.bytes() +
+             settled.capacity() * sizeof(uint32_t);
+    }
+  };
+
+  /**
+   * Constructor.
+   * @param  max_bytes  how much memory the trees may take at most, nothing is kept if 0
+   */
+  explicit ExpansionTreeCache(const size_t max_bytes);
+
+  /**
+   * The part of the key that is the same for all of the rows of a matrix request.
+   * @param  options  the request
+   * @return the key of the costing
+   */
+  static std::string CostingKey(const Options& options);
+
+  /**
+   * The key of the tree of a row.
+   * @param  costing_key  the key of the costing of the request
+   * @param  origin       the origin of the row, after it was correlated
+   * @return the key
+   */
+  static std::string Key(const std::string& costing_key, const valhalla::Location& origin);
+
+  /**
+   * Takes a tree out of the cache.
+   * @param  key  the key of the row
+   * @return the tree or nothing if there is none for the key
+   */
+  std::unique_ptr<tree_t> Take(const std::string& key);
+
+  /**
+   * Keeps a tree, in place of any other of the key. The least recently used trees are dropped
+   * until it fits, a tree larger than the cache isnt kept.
+   * @param  key   the key of the row
+   * @param  tree  the tree the search left behind
+   */
+  void Put(const std::string& key, std::unique_ptr<tree_t> tree);
+
+  /**
+   * Drops everything.
+   */
+  void Clear();
+
+  /**
+   * @return how many trees are kept
+   */
+  size_t size() const;
+
+  /**
+   * @return how much memory the trees kept take
+   */
+  size_t bytes() const;
+
+  /**
+   * @return how many rows carried on from a tree so far
+   */
+  uint64_t hits() const;
+
+protected:
+  struct entry_t {
+    std::string key;
+    std::unique_ptr<tree_t> tree;
+    size_t bytes;
+  };
+
+  void Erase(std::list<entry_t>::iterator entry);
+
+  mutable std::mutex mutex_;
+  size_t max_bytes_;
+  size_t bytes_;
+  uint64_t hits_;
+  // most recently used at the front
+  std::list<entry_t> entries_;
+  std::unordered_map<std::string, std::list<entry_t>::iterator> index_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_EXPANSION_TREE_CACHE_H_
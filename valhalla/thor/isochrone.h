@@ -1,6 +1,7 @@
 #ifndef VALHALLA_THOR_ISOCHRONE_H_
 #define VALHALLA_THOR_ISOCHRONE_H_
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -27,12 +28,16 @@ namespace thor {
  * each each grid point. This gridded data can then be contoured to create
  * isolines or contours.
  */
-class Isochrone : public Dijkstras {
+class Isochrone final : public Dijkstras {
+  // the traversals call the hooks below directly
+  friend class Dijkstras;
+
 public:
   /**
    * Constructor.
+   * @param  label_limits  Limits on the memory used for labels.
    */
-  Isochrone();
+  explicit Isochrone(const label_limits_t& label_limits = label_limits_t());
 
   /**
    * Destructor
@@ -40,6 +45,11 @@ public:
   virtual ~Isochrone() {
   }
 
+  /**
+   * Clear the temporary memory, the reached network as well.
+   */
+  void Clear() override;
+
   /**
    * Compute an isochrone grid. This creates and populates a lat,lon grid with
    * time taken to reach each grid point. This gridded data is then contoured
@@ -83,6 +93,32 @@ public:
                     const sif::mode_costing_t& mode_costing,
                     const sif::TravelMode mode);
 
+  /**
+   * Split the last computed iso-tile into one per location. The expansion from all of the
+   * locations is shared, every cell of the grid is kept only in the iso-tile of the location
+   * that reaches it first (for each metric) so that the contours of the locations dont overlap.
+   * The locations are only tracked when the request asked for contours per location.
+   * @return One iso-tile per location, in the order of the locations.
+   */
+  std::vector<std::shared_ptr<const midgard::GriddedData<2>>> SplitIsoTile() const;
+
+  /**
+   * The network the last expansion reached, when the request asked for it instead of contours.
+   * No grid is made then, the edges are kept with the time and distance at both of their ends
+   * and are cut where each interval runs out along them. The grid based methods return nothing.
+   * @param  intervals         The intervals, sorted by metric and then with the largest first.
+   *                           If the request wants them per location they are repeated for
+   *                           each location one after the other.
+   * @param  graphreader       Graph reader for the shape of the edges
+   * @param  location_indices  Gets the location of each interval if the request wants them per
+   *                           location
+   * @return For each interval a feature with the part of every edge reached within it as a line
+   */
+  midgard::GriddedData<2>::contours_t
+  ReachableNetwork(std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals,
+                   baldr::GraphReader& graphreader,
+                   std::vector<uint32_t>& location_indices) const;
+
 protected:
   // when we expand up to a node we color the cells of the grid that the edge that ends at the
   // node touches
@@ -106,6 +142,28 @@ protected:
   float max_meters_;
   std::shared_ptr<midgard::GriddedData<2>> isotile_;
 
+  // When contours per location are wanted, the location each settled edge was reached from and
+  // the location that reached each cell of the isotile first, for each metric
+  uint32_t location_count_;
+  uint32_t location_;
+
+  // The edges reached when the request wants the network rather than contours, along with where
+  // the expansion got onto those it started on
+  struct reached_edge_t {
+    baldr::GraphId edgeid;
+    float start;
+    float secs0;
+    float secs1;
+    float dist0;
+    float dist1;
+    uint32_t location;
+  };
+  bool network_;
+  std::vector<reached_edge_t> reached_edges_;
+  std::unordered_map<uint64_t, float> edge_starts_;
+  std::unordered_map<uint64_t, uint32_t> edge_locations_;
+  std::vector<std::array<uint32_t, 2>> nearest_locations_;
+
   /**
    * Constructs the isotile - 2-D gridded data containing the time
    * to get to each lat,lng tile.
@@ -116,6 +174,26 @@ protected:
    */
   void ConstructIsoTile(const bool multimodal, const valhalla::Api& api, const sif::TravelMode mode);
 
+  /**
+   * Prepares tracking which location reaches each cell first if the request wants contours per
+   * location. The edges the expansion starts on are tagged with the index of their location.
+   * @param  api          Request information
+   * @param  graphreader  Graph reader
+   */
+  void InitLocationTracking(const valhalla::Api& api, baldr::GraphReader& graphreader);
+
+  /**
+   * Prepares keeping the reached edges instead of marking the grid if the request wants the
+   * network. The edges the expansion starts on are tagged with where along them it starts.
+   * @param  api          Request information
+   * @param  graphreader  Graph reader
+   * @param  reverse      Whether the expansion runs towards the locations
+   */
+  void InitNetwork(const valhalla::Api& api, baldr::GraphReader& graphreader, const bool reverse);
+
+  // Marks a cell of the isotile and which location reached it if that is tracked
+  void MarkIsoTile(const int tile_id, const midgard::GriddedData<2>::value_type& value);
+
   /**
    * Updates the isotile using the edge information from the predecessor edge
    * label. This is the edge being settled (lowest cost found to the edge).
@@ -0,0 +1,101 @@
+#ifndef VALHALLA_THOR_ISOCHRONE_CACHE_H_
+#define VALHALLA_THOR_ISOCHRONE_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <valhalla/midgard/gridded_data.h>
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * A least recently used cache of the grids of isochrones bounded by the memory of the grids, so
+ * that isochrones asked for over and over from the same locations are only expanded once. A grid
+ * is found by the edges its locations were correlated to, the costing with all of its options
+ * and the time of day rounded down to a bucket. It is good for any contours up to those it was
+ * computed for. The grids are only good for as long as the graph stays the same, whoever owns
+ * the cache has to clear it when the tiles or the traffic change.
+ */
+class IsochroneCache {
+public:
+  using grid_t = std::shared_ptr<const midgard::GriddedData<2>>;
+
+  /**
+   * Constructor.
+   * @param  max_bytes  how much memory the grids may take at most, nothing is kept if 0
+   */
+  explicit IsochroneCache(const size_t max_bytes);
+
+  /**
+   * The key of the expansion an isochrone request needs.
+   * @param  options  the request, after its locations were correlated
+   * @param  reverse  whether the expansion goes towards the locations
+   * @return the key
+   */
+  static std::string Key(const Options& options, const bool reverse);
+
+  /**
+   * Finds a grid computed before that reaches at least as far as is needed.
+   * @param  key      the key of the request
+   * @param  minutes  the largest time contour, negative if there is none
+   * @param  km       the largest distance contour, negative if there is none
+   * @return the grid or nothing if there is none for the key or it doesnt reach far enough
+   */
+  grid_t Find(const std::string& key, const float minutes, const float km);
+
+  /**
+   * Keeps a grid, in place of any other of the key. The least recently used grids are dropped
+   * until it fits, a grid larger than the cache isnt kept.
+   * @param  key      the key of the request
+   * @param  grid     the grid of the expansion
+   * @param  minutes  the largest time contour it was computed for, negative if there was none
+   * @param  km       the largest distance contour it was computed for, negative if there was none
+   */
+  void Insert(const std::string& key, const grid_t& grid, const float minutes, const float km);
+
+  /**
+   * Drops everything.
+   */
+  void Clear();
+
+  /**
+   * @return how many grids are kept
+   */
+  size_t size() const {
+    return index_.size();
+  }
+
+  /**
+   * @return how much memory the grids kept take
+   */
+  size_t bytes() const {
+    return bytes_;
+  }
+
+protected:
+  struct entry_t {
+    std::string key;
+    grid_t grid;
+    float minutes;
+    float km;
+    size_t bytes;
+  };
+
+  void Erase(std::list<entry_t>::iterator entry);
+
+  size_t max_bytes_;
+  size_t bytes_;
+  // most recently used at the front
+  std::list<entry_t> entries_;
+  std::unordered_map<std::string, std::list<entry_t>::iterator> index_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_ISOCHRONE_CACHE_H_
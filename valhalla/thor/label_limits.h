@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/thor/edgestatus.h>
+
+namespace valhalla {
+namespace thor {
+
+// How many labels a path algorithm keeps reserved between requests by default
+constexpr uint32_t kDefaultMaxReservedLabelsCount = 1000000;
+
+/**
+ * Limits on the memory the path algorithms use for their labels. The algorithms
+ * belonging to a worker are reused request after request so their label containers
+ * act as a per worker pool, these limits keep one huge request from making that
+ * pool huge forever and stop a search before it can take the whole process down.
+ *
+ * The memory of a search counts its labels, its adjacency lists and its edge status.
+ * Copies of the limits share the largest amount any of them has seen checked, so the
+ * owner of the original can report the peak of all of the searches of a request.
+ */
+struct label_limits_t {
+  /**
+   * Reads the limits from the thor section of the config
+   * @param config  max_reserved_labels_count is how many labels each container keeps
+   *                between requests, anything more is freed. max_labels_memory is how
+   *                many bytes of labels, adjacency lists and edge status a single search
+   *                may use before it is aborted, 0 means no limit
+   */
+  explicit label_limits_t(const boost::property_tree::ptree& config = {})
+      : max_reserved_labels_count(
+            config.get<uint32_t>("max_reserved_labels_count", kDefaultMaxReservedLabelsCount)),
+        max_labels_memory(config.get<size_t>("max_labels_memory", 0)),
+        peak_(std::make_shared<std::atomic<size_t>>(0)) {
+  }
+
+  /**
+   * How many labels to reserve up front for a search
+   * @param wanted  what the algorithm would like to start out with
+   */
+  size_t reservation(size_t wanted) const {
+    return wanted < max_reserved_labels_count ? wanted : max_reserved_labels_count;
+  }
+
+  /**
+   * Empties the container and frees its memory if it grew past the high water mark
+   * @param labels  the container to clear
+   */
+  template <typename container_t> void trim(container_t& labels) const {
+    if (labels.capacity() > max_reserved_labels_count) {
+      // swapping with an empty one is the only way to be sure the memory goes back
+      container_t().swap(labels);
+    } else {
+      labels.clear();
+    }
+  }
+
+  /**
+   * Empties the adjacency list so the next search can reuse its buckets, or drops it if it grew
+   * past the high water mark
+   * @param adjacency  the adjacency list to clear
+   */
+  template <typename label_t, bool indexed>
+  void trim(std::shared_ptr<baldr::DoubleBucketQueue<label_t, indexed>>& adjacency) const {
+    if (adjacency && adjacency->capacity() > max_reserved_labels_count) {
+      adjacency.reset();
+    } else if (adjacency) {
+      adjacency->clear();
+    }
+  }
+
+  /**
+   * Aborts the search if it uses too much memory
+   * @param parts  the label containers, adjacency lists and edge status of the search
+   */
+  template <typename... parts_t> void check(const parts_t&... parts) const {
+    check_bytes(bytes(parts...));
+  }
+
+  /**
+   * Aborts the search if it uses too much memory
+   * @param bytes  how many bytes the search is currently using
+   */
+  void check_bytes(size_t bytes) const {
+    // only the thread raising the peak has to write it
+    auto peak = peak_->load(std::memory_order_relaxed);
+    while (bytes > peak && !peak_->compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {
+    }
+    if (max_labels_memory && bytes > max_labels_memory) {
+      exceeded(bytes);
+    }
+  }
+
+  /**
+   * @return the most bytes any search checked against these limits or a copy of them used
+   */
+  size_t peak_memory() const {
+    return peak_->load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Starts over measuring the peak, for these limits and all of their copies
+   */
+  void reset_peak_memory() const {
+    peak_->store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @return how many bytes the parts of a search are using
+   */
+  static size_t bytes() {
+    return 0;
+  }
+
+  template <typename part_t, typename... parts_t>
+  static size_t bytes(const part_t& part, const parts_t&... rest) {
+    return bytes_of(part) + bytes(rest...);
+  }
+
+  uint32_t max_reserved_labels_count;
+  size_t max_labels_memory;
+
+protected:
+  template <typename container_t> static size_t bytes_of(const container_t& labels) {
+    return labels.size() * sizeof(typename container_t::value_type);
+  }
+
+  template <typename label_t, bool indexed>
+  static size_t bytes_of(const baldr::DoubleBucketQueue<label_t, indexed>& adjacency) {
+    return adjacency.bytes();
+  }
+
+  static size_t bytes_of(const EdgeStatus& edgestatus) {
+    return edgestatus.bytes();
+  }
+
+  // the adjacency lists are only made once the search knows how to bucket its costs
+  template <typename part_t> static size_t bytes_of(const std::shared_ptr<part_t>& part) {
+    return part ? bytes_of(*part) : 0;
+  }
+
+  // shared by all the copies
+  std::shared_ptr<std::atomic<size_t>> peak_;
+
+  // throws the exception telling the user their request was too big
+  void exceeded(size_t bytes) const;
+};
+
+} // namespace thor
+} // namespace valhalla
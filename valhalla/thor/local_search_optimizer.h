@@ -0,0 +1,115 @@
+#ifndef VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
+#define VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/thor/expansion_pool.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Optimization method using iterated local search. Like Optimizer it optimizes the order of
+ * locations keeping the first location (origin) and last location (destination) fixed, but it
+ * improves the tour with 2-opt and Or-opt moves until neither finds anything, then perturbs the
+ * best tour and searches again until the time is up or the perturbations stop paying off. Every
+ * thread of the pool runs such a search from its own start and the best tour of all of them is
+ * returned.
+ *
+ * While searching, the cost matrix is kept reordered into the order of the current tour, once
+ * by rows and once by columns, so that the loops over the positions a move can go to read
+ * contiguous costs. The matrices are reordered after every move that is made, which costs about
+ * as much as a pass over the neighborhood.
+ */
+class LocalSearchOptimizer {
+public:
+  /**
+   * Constructor.
+   * @param  pool  Threads to run searches on in parallel, only the calling thread if nullptr.
+   */
+  explicit LocalSearchOptimizer(ExpansionPool* pool = nullptr);
+
+  /**
+   * Optimize the tour through a set of locations given the cost matrix among all locations.
+   * The first location (origin) and last location (destination) remain fixed in the tour.
+   * @param  count   Number of locations.
+   * @param  costs   2-D cost matrix.
+   * @param  budget  How long to search for at most.
+   * @param  reader  Graph reader of the calling thread, which the pool wants.
+   * @return Returns the tour as an updated order of locations visited to complete the tour.
+   */
+  std::vector<uint32_t> Solve(const uint32_t count,
+                              const std::vector<float>& costs,
+                              const std::chrono::milliseconds budget,
+                              baldr::GraphReader& reader);
+
+  /**
+   * Seed the random number generators of the searches. This is used by tests to create a
+   * repeatable sequence, given that the budget is not what ends the search.
+   * @param  seed  Seed to use for the random number generators.
+   */
+  void Seed(const uint32_t seed) {
+    seed_ = seed;
+  }
+
+protected:
+  using clock_t = std::chrono::steady_clock;
+
+  // What one search works on
+  struct search_t {
+    std::vector<uint32_t> tour;
+    // the costs between positions of the tour, by rows and by columns
+    std::vector<float> by_row;
+    std::vector<float> by_column;
+    // the cost of going from each position to the next one, and back
+    std::vector<float> link;
+    // prefix sums of those along the tour to get the cost of segments both ways
+    std::vector<double> forward;
+    std::vector<double> backward;
+    std::mt19937 random;
+  };
+
+  // Runs one search from the given start until the deadline, returns its best tour
+  std::vector<uint32_t> Search(const uint32_t start, const clock_t::time_point deadline) const;
+
+  // Reorders the costs into the order of the tour
+  void Reorder(search_t& search) const;
+
+  // Makes the best 2-opt move of a position, returns false if none improves the tour
+  bool TwoOpt(search_t& search) const;
+
+  // Makes the best Or-opt move of a segment, returns false if none improves the tour
+  bool OrOpt(search_t& search) const;
+
+  // Improves the tour until it is a local optimum or the deadline has passed
+  void Improve(search_t& search, const clock_t::time_point deadline) const;
+
+  // Swaps two random segments of the tour, a double bridge for a path
+  void Perturb(search_t& search) const;
+
+  // The tour visiting the cheapest next location first
+  std::vector<uint32_t> NearestNeighbor() const;
+
+  // Tries every order, for few locations
+  std::vector<uint32_t> Exhaustive() const;
+
+  double TourCost(const std::vector<uint32_t>& tour) const;
+
+  float Cost(const uint32_t loc1, const uint32_t loc2) const {
+    return (*costs_)[loc1 * count_ + loc2];
+  }
+
+  ExpansionPool* pool_;
+  uint32_t seed_;
+  uint32_t count_;
+  const std::vector<float>* costs_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
@@ -32,8 +32,9 @@ class MultiModalPathAlgorithm : public PathAlgorithm {
 public:
   /**
    * Constructor.
+   * @param  label_limits  Limits on the memory used for labels.
    */
-  MultiModalPathAlgorithm();
+  explicit MultiModalPathAlgorithm(const label_limits_t& label_limits = label_limits_t());
 
   /**
    * Destructor
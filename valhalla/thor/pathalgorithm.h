@@ -7,12 +7,14 @@
 #include <utility>
 #include <vector>
 
+#include <valhalla/baldr/altlandmarks.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/label_limits.h>
 #include <valhalla/thor/pathinfo.h>
 
 namespace valhalla {
@@ -29,8 +31,11 @@ class PathAlgorithm {
 public:
   /**
    * Constructor
+   * @param  label_limits  Limits on the memory used for labels.
    */
-  PathAlgorithm() : interrupt(nullptr), has_ferry_(false), expansion_callback_() {
+  explicit PathAlgorithm(const label_limits_t& label_limits = label_limits_t())
+      : interrupt(nullptr), has_ferry_(false), expansion_callback_(), label_limits_(label_limits),
+        landmarks_(nullptr) {
   }
 
   /**
@@ -98,6 +103,15 @@ public:
     expansion_callback_ = expansion_callback;
   }
 
+  /**
+   * Sets the landmarks the A* heuristic of the algorithm can use, if it has one.
+   *
+   * @param  landmarks  the landmarks of the costing of the request or nullptr for none
+   */
+  void set_landmarks(const baldr::AltLandmarks* landmarks) {
+    landmarks_ = landmarks;
+  }
+
 protected:
   const std::function<void()>* interrupt;
 
@@ -109,6 +123,12 @@ protected:
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
+  // how much label memory to keep between requests and to allow per request
+  label_limits_t label_limits_;
+
+  // for tightening the A* heuristic, not owned
+  const baldr::AltLandmarks* landmarks_;
+
   /**
    * Check for path completion along the same edge. Edge ID in question
    * is along both an origin and destination and origin shows up at the
@@ -0,0 +1,145 @@
+#ifndef VALHALLA_THOR_RAPTOR_H_
+#define VALHALLA_THOR_RAPTOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <valhalla/thor/transit_timetable.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Round based public transit search over a timetable. Round k finds the earliest arrivals at every
+ * stop with k rides by scanning the routes through the stops improved in the round before, then
+ * walks to the other platforms of their stations. The walks to the first and from the last stop
+ * are given, the search picks the earliest arrival at the destination over all of them and the
+ * fewest rides among the earliest.
+ */
+class Raptor {
+public:
+  /**
+   * A walk between a location and a stop, to it from the origin or from it to the destination.
+   */
+  struct walk_t {
+    uint32_t stop;
+    uint32_t secs;
+  };
+
+  struct query_t {
+    // seconds from midnight of the date
+    uint32_t departure;
+    // days from the pivot date and its day of the week mask
+    uint32_t date;
+    uint32_t dow;
+    bool wheelchair;
+    bool bicycle;
+    // to get off a trip and onto another one at the same platform
+    uint32_t change_secs;
+    // to walk to another platform of the station
+    uint32_t transfer_secs;
+    uint32_t max_rides;
+  };
+
+  /**
+   * A ride along a route between two positions of it or, when there is no trip, a footpath
+   * between two platforms of a station.
+   */
+  struct leg_t {
+    uint32_t from_stop;
+    uint32_t to_stop;
+    uint32_t departure;
+    uint32_t arrival;
+    uint32_t trip;
+    uint32_t route;
+    uint32_t board;
+    uint32_t alight;
+    const TransitTimetable::transfer_t* transfer;
+  };
+
+  struct journey_t {
+    // which of the access and egress walks it starts and ends with
+    uint32_t access;
+    uint32_t egress;
+    // when it gets to the destination
+    uint32_t arrival;
+    std::vector<leg_t> legs;
+  };
+
+  explicit Raptor(const TransitTimetable& timetable);
+
+  /**
+   * Finds the journey arriving the earliest with at least one ride.
+   * @param  query      when and how to go
+   * @param  access     the walks from the origin
+   * @param  egress     the walks to the destination
+   * @param  journey    gets the journey found
+   * @param  interrupt  called between rounds to allow aborting the search
+   * @return true if a journey was found
+   */
+  bool Search(const query_t& query,
+              const std::vector<walk_t>& access,
+              const std::vector<walk_t>& egress,
+              journey_t& journey,
+              const std::function<void()>* interrupt = nullptr);
+
+protected:
+  enum class kind_t : uint8_t { none, access, ride, transfer };
+
+  struct arrival_t {
+    uint32_t time;
+    bool by_ride;
+  };
+
+  struct parent_t {
+    kind_t kind;
+    // the access walk, the trip along the route or the stop the transfer is from
+    uint32_t from;
+    uint32_t route;
+    uint32_t board;
+    uint32_t alight;
+    const TransitTimetable::transfer_t* transfer;
+  };
+
+  // Sets the arrival at a stop in a round if it is better than what is known so far
+  bool Improve(const uint32_t round, const uint32_t stop, const uint32_t time, const bool by_ride);
+
+  // Scans a route from a position on in a round
+  void Scan(const query_t& query, const uint32_t round, const uint32_t route, const uint32_t start);
+
+  // The first trip of a route running on the day that can be taken at a position when ready at a
+  // time, kInvalid if there is none before the given trip
+  uint32_t Earliest(const query_t& query,
+                    const TransitTimetable::route_t& route,
+                    const uint32_t position,
+                    const uint32_t ready,
+                    const uint32_t before);
+
+  const TransitTimetable& timetable_;
+  // the arrivals at every stop after every round, one row of stops per round
+  std::vector<arrival_t> arrivals_;
+  std::vector<parent_t> parents_;
+  std::vector<uint32_t> touched_parents_;
+  // the stops improved in the current and the previous round
+  std::vector<uint32_t> marked_;
+  std::vector<uint32_t> next_marked_;
+  std::vector<bool> is_marked_;
+  // the earliest position each route is to be scanned from in this round
+  std::vector<uint32_t> route_starts_;
+  std::vector<uint32_t> routes_;
+  // the walk to the destination from every stop
+  std::vector<uint32_t> egress_secs_;
+  std::vector<uint32_t> egress_walks_;
+  // whether each trip runs on the day of the query, 0 until it was asked
+  std::vector<uint8_t> runs_;
+  // the earliest arrival at the destination so far and its round and last stop
+  uint32_t best_;
+  uint32_t best_round_;
+  uint32_t best_stop_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_RAPTOR_H_
@@ -0,0 +1,145 @@
+#ifndef VALHALLA_THOR_RAPTOR_SEARCH_H_
+#define VALHALLA_THOR_RAPTOR_SEARCH_H_
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/dijkstras.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/raptor.h>
+#include <valhalla/thor/transit_timetable.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Public transit routing with Raptor over a timetable of the transit tiles. The walks to the
+ * platforms near the origin and from those near the destination come from a pedestrian expansion
+ * of each location, the rides and the transfers between them from the timetable. The timetable is
+ * read from the tiles the first time it is needed and kept until the tileset is reloaded.
+ *
+ * Requests the timetable cant answer go to the fallback algorithm: those without a date_time on
+ * the origin, those filtering stops, operators or routes and those for which no journey is found.
+ */
+class RaptorSearch : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param  fallback      What answers the requests the timetable cant.
+   * @param  label_limits  Limits on the memory used for the labels of the walks.
+   */
+  RaptorSearch(PathAlgorithm& fallback, const label_limits_t& label_limits = label_limits_t());
+
+  /**
+   * Form the transit path between origin and destination, uses the fallback if the timetable
+   * doesnt apply.
+   * @param  origin       Origin location
+   * @param  dest         Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing Costing methods for each mode.
+   * @param  mode         Travel mode from the origin.
+   * @param  options      The request options.
+   * @return the path found, a single one
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  const char* name() const override {
+    return "raptor";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction. The timetable stays.
+   */
+  void Clear() override;
+
+protected:
+  /**
+   * Walks from a location to every platform within the distance allowed, forward from an origin
+   * or in reverse towards a destination. The labels stay until the next walk so the path to a
+   * platform can be read back.
+   */
+  class Walks : public Dijkstras {
+  public:
+    explicit Walks(const label_limits_t& label_limits) : Dijkstras(label_limits) {
+    }
+
+    /**
+     * Expands from a location.
+     * @param  location      the origin or destination
+     * @param  forward       whether it is walked from or to
+     * @param  max_distance  how far to walk in meters
+     */
+    void Walk(const valhalla::Location& location,
+              const bool forward,
+              const uint32_t max_distance,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing);
+
+    /**
+     * The edges of the walk to or from a platform in the order they are walked and the seconds
+     * at the end of each counting from the start of the walk.
+     */
+    void Path(const baldr::GraphId& platform,
+              std::vector<baldr::GraphId>& edges,
+              std::vector<float>& secs) const;
+
+    // the platforms reached and the label of the cheapest way there
+    std::unordered_map<baldr::GraphId, uint32_t> platforms;
+
+  protected:
+    void ExpandingNode(baldr::GraphReader& graphreader,
+                       graph_tile_ptr tile,
+                       const baldr::NodeInfo* node,
+                       const sif::EdgeLabel& current,
+                       const sif::EdgeLabel* previous) override;
+
+    ExpansionRecommendation ShouldExpand(baldr::GraphReader& graphreader,
+                                         const sif::EdgeLabel& pred,
+                                         const InfoRoutingType route_type) override;
+
+    void GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const override;
+
+    bool forward_;
+    uint32_t max_distance_;
+  };
+
+  // The walks to or from the stops of the timetable
+  std::vector<Raptor::walk_t> Stops(const Walks& walks,
+                                    std::vector<baldr::GraphId>& platforms) const;
+
+  // Turns the journey back into path infos
+  std::vector<PathInfo> FormPath(const Raptor::query_t& query,
+                                 const Raptor::journey_t& journey,
+                                 const baldr::GraphId& first_platform,
+                                 const baldr::GraphId& last_platform);
+
+  PathAlgorithm& fallback_;
+  std::unique_ptr<TransitTimetable> timetable_;
+  // The tileset generation of the reader the timetable was read with
+  uint64_t timetable_generation_;
+  std::unique_ptr<Raptor> raptor_;
+  Walks access_;
+  Walks egress_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_RAPTOR_SEARCH_H_
@@ -31,8 +31,9 @@ class TimeDepForward : public PathAlgorithm {
 public:
   /**
    * Constructor.
+   * @param  label_limits  Limits on the memory used for labels.
    */
-  TimeDepForward();
+  explicit TimeDepForward(const label_limits_t& label_limits = label_limits_t());
 
   /**
    * Destructor
@@ -198,8 +199,9 @@ class TimeDepReverse : public TimeDepForward {
 public:
   /**
    * Constructor.
+   * @param  label_limits  Limits on the memory used for labels.
    */
-  TimeDepReverse();
+  explicit TimeDepReverse(const label_limits_t& label_limits = label_limits_t());
 
   /**
    * Destructor
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -16,6 +17,8 @@
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/expansion_pool.h>
+#include <valhalla/thor/expansion_tree_cache.h>
 #include <valhalla/thor/pathalgorithm.h>
 
 namespace valhalla {
@@ -54,8 +57,11 @@ public:
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   * @param  label_limits  Limits on the memory used for labels.
+   * @param  pool          Threads to compute the rows of SourceToTarget on in parallel.
    */
-  TimeDistanceMatrix();
+  explicit TimeDistanceMatrix(const label_limits_t& label_limits = label_limits_t(),
+                              ExpansionPool* pool = nullptr);
 
   /**
    * One to many time and distance cost matrix. Computes time and distance
@@ -131,6 +137,14 @@ public:
                  const sif::TravelMode mode,
                  const float max_matrix_distance);
 
+  /**
+   * Lets the rows of OneToMany carry on from the trees that earlier rows from the same origins
+   * left in the cache and leave their own there in turn. The cache has to outlive the matrix.
+   * @param  cache        The trees, nothing is cached if null.
+   * @param  costing_key  ExpansionTreeCache::CostingKey of the request.
+   */
+  void SetTreeCache(ExpansionTreeCache* cache, const std::string& costing_key);
+
   /**
    * Clear the temporary information generated during time+distance
    * matrix construction.
@@ -164,10 +178,23 @@ protected:
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
 
+  // How much label memory the search may use
+  label_limits_t label_limits_;
+
+  // Optional threads to compute the rows on
+  ExpansionPool* pool_;
+
   AStarHeuristic astarheuristic_;
 
   sif::TravelMode mode_;
 
+  // Optional trees of earlier searches to carry on from, and the key of the costing they need
+  ExpansionTreeCache* tree_cache_;
+  std::string tree_cache_key_;
+
+  // The labels taken off the adjacency list in order, only kept when there is a tree cache
+  std::vector<uint32_t> settled_;
+
   /**
    * Expand from the node along the forward search path. Immediately expands
    * from the end node of any transition edge (so no transition edges are added
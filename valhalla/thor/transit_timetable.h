@@ -0,0 +1,216 @@
+#ifndef VALHALLA_THOR_TRANSIT_TIMETABLE_H_
+#define VALHALLA_THOR_TRANSIT_TIMETABLE_H_
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/transitschedule.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * The schedules of the transit tiles laid out for round based searches. Trips which stop at the
+ * same platforms along the same lines and never overtake each other make up a route. The stop
+ * times of a route are one block, trip after trip in the order they leave, so scanning a route
+ * never leaves it. The timetable holds every service day of the tiles, which trips run on the day
+ * of a request is up to the search.
+ */
+class TransitTimetable {
+public:
+  // Marks a missing stop, trip or time
+  static constexpr uint32_t kInvalid = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * When a trip gets to and leaves a stop, in seconds from midnight of its service day.
+   */
+  struct stop_time_t {
+    uint32_t arrival;
+    uint32_t departure;
+  };
+
+  /**
+   * What is known about a trip besides its times.
+   */
+  struct trip_t {
+    uint32_t tripid;
+    uint32_t blockid;
+    baldr::TransitSchedule schedule;
+    // the creation date of the tile, the days of the schedule count from it
+    uint32_t date_created;
+    bool wheelchair;
+    bool bicycle;
+
+    /**
+     * Whether the trip runs on a day.
+     * @param  date  days from the pivot date
+     * @param  dow   day of the week mask of the date
+     */
+    bool Runs(const uint32_t date, const uint32_t dow) const {
+      return date < date_created ? schedule.IsValid(0, dow, true)
+                                 : schedule.IsValid(date - date_created, dow, false);
+    }
+  };
+
+  /**
+   * A trip as it is read from the departures: the platforms it stops at, the transit line edges
+   * it takes between them and its times at every platform.
+   */
+  struct trip_stops_t {
+    trip_t trip;
+    std::vector<baldr::GraphId> platforms;
+    std::vector<baldr::GraphId> lines;
+    std::vector<stop_time_t> times;
+  };
+
+  /**
+   * A way to walk from one platform to another of the same station along the given edges.
+   */
+  struct footpath_t {
+    baldr::GraphId from;
+    baldr::GraphId to;
+    std::vector<baldr::GraphId> edges;
+  };
+
+  struct route_t {
+    uint32_t first_stop;
+    uint32_t stop_count;
+    uint32_t first_trip;
+    uint32_t trip_count;
+    uint32_t first_time;
+  };
+
+  struct transfer_t {
+    uint32_t stop;
+    uint32_t first_edge;
+    uint32_t edge_count;
+  };
+
+  /**
+   * Lays out the given trips and footpaths.
+   * @param  trips      every trip, in any order
+   * @param  footpaths  the walks between platforms, those to platforms no trip stops at are left
+   *                    out
+   */
+  TransitTimetable(const std::vector<trip_stops_t>& trips,
+                   const std::vector<footpath_t>& footpaths);
+
+  /**
+   * Reads the departures and the platforms of all transit tiles. Frequency based departures are
+   * made into one trip per departure.
+   * @param  reader  the graph reader
+   */
+  explicit TransitTimetable(baldr::GraphReader& reader);
+
+  /**
+   * @return how many stops, meaning platforms, the timetable has
+   */
+  uint32_t stop_count() const {
+    return stops_.size();
+  }
+
+  /**
+   * @return how many routes the timetable has
+   */
+  uint32_t route_count() const {
+    return routes_.size();
+  }
+
+  /**
+   * @return how many trips the timetable has
+   */
+  uint32_t trip_count() const {
+    return trips_.size();
+  }
+
+  /**
+   * The stop of a platform.
+   * @param  platform  the node of the platform
+   * @return the index of the stop or kInvalid if no trip stops there
+   */
+  uint32_t stop(const baldr::GraphId& platform) const {
+    auto found = stop_index_.find(platform);
+    return found == stop_index_.end() ? kInvalid : found->second;
+  }
+
+  const baldr::GraphId& platform(const uint32_t stop) const {
+    return stops_[stop];
+  }
+
+  const route_t& route(const uint32_t route) const {
+    return routes_[route];
+  }
+
+  const trip_t& trip(const uint32_t trip) const {
+    return trips_[trip];
+  }
+
+  /**
+   * The stop at a position along a route.
+   */
+  uint32_t route_stop(const route_t& route, const uint32_t position) const {
+    return route_stops_[route.first_stop + position];
+  }
+
+  /**
+   * The transit line edge leaving a position along a route, there is none at the last position.
+   */
+  const baldr::GraphId& route_line(const route_t& route, const uint32_t position) const {
+    return route_lines_[route.first_stop + position];
+  }
+
+  /**
+   * The times of the nth trip of a route at a position along it.
+   */
+  const stop_time_t&
+  time(const route_t& route, const uint32_t trip, const uint32_t position) const {
+    return stop_times_[route.first_time + trip * route.stop_count + position];
+  }
+
+  /**
+   * The routes through a stop as pairs of the route and the position of the stop along it.
+   */
+  std::pair<const std::pair<uint32_t, uint32_t>*, const std::pair<uint32_t, uint32_t>*>
+  stop_routes(const uint32_t stop) const {
+    return {stop_routes_.data() + stop_route_offsets_[stop],
+            stop_routes_.data() + stop_route_offsets_[stop + 1]};
+  }
+
+  /**
+   * The footpaths from a stop to the other platforms of its station.
+   */
+  std::pair<const transfer_t*, const transfer_t*> transfers(const uint32_t stop) const {
+    return {transfers_.data() + transfer_offsets_[stop],
+            transfers_.data() + transfer_offsets_[stop + 1]};
+  }
+
+  const baldr::GraphId& transfer_edge(const uint32_t index) const {
+    return transfer_edges_[index];
+  }
+
+protected:
+  void Build(const std::vector<trip_stops_t>& trips, const std::vector<footpath_t>& footpaths);
+
+  std::vector<baldr::GraphId> stops_;
+  std::unordered_map<baldr::GraphId, uint32_t> stop_index_;
+  std::vector<route_t> routes_;
+  std::vector<uint32_t> route_stops_;
+  std::vector<baldr::GraphId> route_lines_;
+  std::vector<trip_t> trips_;
+  std::vector<stop_time_t> stop_times_;
+  std::vector<uint32_t> stop_route_offsets_;
+  std::vector<std::pair<uint32_t, uint32_t>> stop_routes_;
+  std::vector<uint32_t> transfer_offsets_;
+  std::vector<transfer_t> transfers_;
+  std::vector<baldr::GraphId> transfer_edges_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_TRANSIT_TIMETABLE_H_
@@ -1,7 +1,9 @@
 #ifndef __VALHALLA_THOR_SERVICE_H__
 #define __VALHALLA_THOR_SERVICE_H__
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <tuple>
 #include <vector>
 
@@ -21,8 +23,13 @@
 #include <valhalla/thor/astar_bss.h>
 #include <valhalla/thor/attributes_controller.h>
 #include <valhalla/thor/bidirectional_astar.h>
+#include <valhalla/thor/contraction_search.h>
+#include <valhalla/thor/expansion_pool.h>
+#include <valhalla/thor/expansion_tree_cache.h>
 #include <valhalla/thor/isochrone.h>
+#include <valhalla/thor/isochrone_cache.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/raptor_search.h>
 #include <valhalla/thor/timedep.h>
 #include <valhalla/thor/triplegbuilder.h>
 #include <valhalla/tyr/actor.h>
@@ -37,7 +44,13 @@ void run_service(const boost::property_tree::ptree& config);
 
 class thor_worker_t : public service_worker_t {
 public:
-  enum SOURCE_TO_TARGET_ALGORITHM { SELECT_OPTIMAL = 0, COST_MATRIX = 1, TIME_DISTANCE_MATRIX = 2 };
+  enum SOURCE_TO_TARGET_ALGORITHM {
+    SELECT_OPTIMAL = 0,
+    COST_MATRIX = 1,
+    TIME_DISTANCE_MATRIX = 2,
+    CONTRACTION_MATRIX = 3
+  };
+  enum OPTIMIZER { ANNEALING = 0, LOCAL_SEARCH = 1 };
   thor_worker_t(const boost::property_tree::ptree& config,
                 const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
   virtual ~thor_worker_t();
@@ -61,6 +74,12 @@ public:
   void trace_route(Api& request);
   std::string trace_attributes(Api& request);
   std::string expansion(Api& request);
+  /**
+   * Costs a path that is already known edge by edge, without searching or matching anything
+   * @param request  the request with the edges of the path and when it was started
+   * @return the time, cost and length of the path and of each of its edges
+   */
+  std::string recost(Api& request);
 
   void set_interrupt(const std::function<void()>* interrupt) override;
 
@@ -71,10 +90,16 @@ protected:
                                                     const std::string& costing,
                                                     const Options& options);
   void log_admin(const TripLeg&);
+  // adds the most memory any search of the request used to its statistics
+  void report_peak_memory(Api& request) const;
   thor::PathAlgorithm* get_path_algorithm(const std::string& routetype,
                                           const Location& origin,
                                           const Location& destination,
                                           const Options& options);
+  const baldr::AltLandmarks* get_landmarks(const Options& options) const;
+  // the contraction hierarchy of the costing, unless the costing uses the live traffic which the
+  // hierarchy was not built with
+  const baldr::ContractionHierarchy* get_hierarchy(const Options& options) const;
   void route_match(Api& request);
   /**
    * Returns the results of the map match where the first float is the normalized
@@ -86,7 +111,22 @@ protected:
   std::vector<std::tuple<float, float, std::vector<meili::MatchResult>>> map_match(Api& request);
 
   void path_arrive_by(Api& api, const std::string& costing);
-  void path_depart_at(Api& api, const std::string& costing);
+  /**
+   * Routes the locations in order.
+   * @param api       The request with the locations
+   * @param costing   The costing to route with
+   * @param leg_path  Gives the path of the leg starting at a location if it is known already,
+   *                  the legs it gives none for are routed
+   */
+  void path_depart_at(
+      Api& api,
+      const std::string& costing,
+      const std::function<std::vector<thor::PathInfo>(size_t)>& leg_path = nullptr);
+
+  /**
+   * Maps the contraction hierarchies and landmarks of the tileset the reader is on
+   */
+  void load_tile_data();
 
   void parse_locations(Api& request);
   void parse_measurements(const Api& request);
@@ -112,21 +152,56 @@ protected:
   sif::CostFactory factory;
   sif::mode_costing_t mode_costing;
 
+  // Limits on the label memory of the path algorithms, declared first since they use it
+  label_limits_t label_limits;
+
   // Path algorithms (TODO - perhaps use a map?))
   BidirectionalAStar bidir_astar;
+  ContractionSearch contraction_search;
   AStarBSSAlgorithm bss_astar;
   MultiModalPathAlgorithm multi_modal_astar;
+  RaptorSearch raptor;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
 
+  // Landmark distances for the A* heuristics by costing, for the costings which have them
+  std::unordered_map<int, std::unique_ptr<const baldr::AltLandmarks>> landmarks;
+  // the tileset the hierarchies and landmarks were made for
+  uint64_t tileset_generation;
+
   Isochrone isochrone_gen;
+  // the reverse expansion of isochrones wanted in both directions, next to the forward one
+  Isochrone isochrone_reverse_gen;
+  // how far isochrones have to reach to expand on the pool, 0 when there is none
+  float parallel_isochrone_distance;
+  // Grids of isochrones computed before, only there when thor.isochrone_cache_size is set
+  std::unique_ptr<IsochroneCache> isochrone_cache;
+  uint64_t isochrone_cache_generation;
+  // Search trees of time distance matrix rows, only there when thor.matrix_tree_cache_size is set
+  std::unique_ptr<ExpansionTreeCache> matrix_tree_cache;
+  uint64_t matrix_tree_cache_generation;
   std::shared_ptr<meili::MapMatcher> matcher;
   float max_timedep_distance;
+  // whether the hierarchy limits of routes are fit to how far apart their locations are
+  bool adaptive_hierarchy_limits;
+  // whether transit routes go through raptor before the multimodal algorithm
+  bool use_raptor;
+  // the most edges an expansion shows, 0 for all of them
+  uint32_t expansion_max_edges;
   std::unordered_map<std::string, float> max_matrix_distance;
+  // how many rows of a matrix are searched and serialized at a time, 0 for all of them at once
+  size_t matrix_row_block_size;
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
+  OPTIMIZER optimizer;
+  std::chrono::milliseconds optimizer_time_budget;
+  unsigned int contour_threads;
   meili::MapMatcherFactory matcher_factory;
+  const boost::property_tree::ptree mjolnir_config;
   std::shared_ptr<baldr::GraphReader> reader;
   AttributesController controller;
+
+  // Threads the matrix searches run on, only there when thor.matrix_threads is above 1
+  std::unique_ptr<ExpansionPool> expansion_pool;
 };
 
 } // namespace thor
@@ -8,9 +8,22 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/proto/api.pb.h>
 
+#ifdef HAVE_HTTP
+#include <prime_server/prime_server.hpp>
+#endif
+
 namespace valhalla {
 namespace tyr {
 
+#ifdef HAVE_HTTP
+/**
+ * Answers whole requests in one stage, taking them from the loki proxy and running loki, thor and
+ * odin on the same Api in this thread rather than serializing it between per stage services
+ * @param config  the config, each call gets its own graph reader from the mjolnir section
+ */
+void run_service(const boost::property_tree::ptree& config);
+#endif
+
 class actor_t {
 public:
   actor_t(const boost::property_tree::ptree& config, bool auto_cleanup = false);
@@ -48,6 +61,29 @@ public:
   std::string expansion(const std::string& request_str,
                         const std::function<void()>* interrupt = nullptr,
                         Api* api = nullptr);
+  /**
+   * Answers many independent routes at once, the locations of all of them are correlated together
+   * and a route which fails puts its error in its place in the response rather than failing them all
+   */
+  std::string route_batch(const std::string& request_str,
+                          const std::function<void()>* interrupt = nullptr,
+                          Api* api = nullptr);
+  /**
+   * Costs a known path given by its edges, for when only its time and cost are wanted and there
+   * is no trace to match
+   */
+  std::string recost(const std::string& request_str,
+                     const std::function<void()>* interrupt = nullptr,
+                     Api* api = nullptr);
+#ifdef HAVE_HTTP
+  /**
+   * The work function of the single stage service, parses the http request once and answers it
+   * with every stage it needs before handing back the serialized response
+   */
+  prime_server::worker_t::result_t work(const std::list<zmq::message_t>& job,
+                                        void* request_info,
+                                        const std::function<void()>& interrupt_function);
+#endif
 
 protected:
   struct pimpl_t;
@@ -0,0 +1,47 @@
+#ifndef VALHALLA_TYR_BATCH_H_
+#define VALHALLA_TYR_BATCH_H_
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/tyr/actor.h>
+
+namespace valhalla {
+namespace tyr {
+
+// The member of actor_t which answers the requests of a batch
+using batch_action_t = std::string (actor_t::*)(const std::string&,
+                                                const std::function<void()>*,
+                                                Api*);
+
+/**
+ * Answers a file of requests, one json request per line, optionally in the -j '{...}' form of the
+ * files in test_requests, with a thread of actors each and writes a line of json per request as
+ * soon as it is answered. Every line has the number of the
+ * line of its request, how long it took in milliseconds and either the response or the error, so
+ * they can be put back in order or compared against those of another run. The graph readers of
+ * the threads share one synchronized tile cache unless the config already says how to share tiles,
+ * so the tiles are only loaded once for the whole batch.
+ *
+ * @param  config       the config, the actors are made from it
+ * @param  action       what answers each request
+ * @param  input        the requests, empty and # lines are skipped
+ * @param  output       where the results go
+ * @param  concurrency  how many threads answer requests
+ * @return how many requests failed
+ */
+size_t run_batch(const boost::property_tree::ptree& config,
+                 batch_action_t action,
+                 std::istream& input,
+                 std::ostream& output,
+                 size_t concurrency);
+
+} // namespace tyr
+} // namespace valhalla
+
+#endif // VALHALLA_TYR_BATCH_H_
@@ -0,0 +1,123 @@
+#ifndef VALHALLA_TYR_RESPONSE_CACHE_H_
+#define VALHALLA_TYR_RESPONSE_CACHE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace tyr {
+
+/**
+ * A bounded least recently used cache of whole responses, so that the same request coming in
+ * over and over, like the isochrone around a popular venue, is only answered once. A request is
+ * found by its options after they are normalized: coordinates are rounded to the precision of the
+ * tiles and times are rounded down to a bucket of minutes, leaving now as the bucket it falls in.
+ * Responses are dropped once they are older than the time to live. They are only good for as long
+ * as the graph stays the same, whoever owns the cache has to clear it when the tiles or the
+ * traffic change.
+ */
+class ResponseCache {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  /**
+   * What was sent back for a request, before any jsonp wrapping
+   */
+  struct Response {
+    std::string body;
+    std::string content_type;
+    bool as_attachment;
+  };
+
+  /**
+   * Constructor.
+   * @param  max_size          how many responses to keep at most, nothing is kept if 0
+   * @param  time_to_live      how long a response may be handed out again
+   * @param  date_time_bucket  how many minutes of departure or arrival times share a response
+   */
+  ResponseCache(const size_t max_size,
+                const clock_t::duration time_to_live,
+                const uint32_t date_time_bucket);
+
+  /**
+   * The key of a request.
+   * @param  options  the options of the freshly parsed request
+   * @return the key
+   */
+  std::string Key(const Options& options) const;
+
+  /**
+   * Finds the response to a request sent before.
+   * @param  key       the key of the request
+   * @param  response  gets the response if it was found
+   * @return true if it was found and is still fresh
+   */
+  bool Find(const std::string& key, Response& response);
+
+  /**
+   * Keeps the response to a request, dropping the least recently used one if full.
+   * @param  key       the key of the request
+   * @param  response  what was sent back for it
+   */
+  void Insert(const std::string& key, Response response);
+
+  /**
+   * Drops everything.
+   */
+  void Clear();
+
+  /**
+   * @return how many responses are kept
+   */
+  size_t size() const {
+    return index_.size();
+  }
+
+  /**
+   * @return whether anything is kept at all
+   */
+  bool enabled() const {
+    return max_size_ != 0;
+  }
+
+  /**
+   * @return how many requests were found since construction
+   */
+  uint64_t hits() const {
+    return hits_;
+  }
+
+  /**
+   * @return how many requests were not found since construction
+   */
+  uint64_t misses() const {
+    return misses_;
+  }
+
+protected:
+  struct entry_t {
+    std::string key;
+    Response response;
+    clock_t::time_point inserted;
+  };
+
+  size_t max_size_;
+  clock_t::duration time_to_live_;
+  uint32_t date_time_bucket_;
+  // most recently used at the front
+  std::list<entry_t> entries_;
+  std::unordered_map<std::string, std::list<entry_t>::iterator> index_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+} // namespace tyr
+} // namespace valhalla
+
+#endif // VALHALLA_TYR_RESPONSE_CACHE_H_
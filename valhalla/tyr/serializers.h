@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <list>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -15,11 +16,13 @@
 #include <valhalla/meili/match_result.h>
 #include <valhalla/midgard/gridded_data.h>
 #include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/attributes_controller.h>
 #include <valhalla/thor/costmatrix.h>
 #include <valhalla/tyr/actor.h>
 
 namespace valhalla {
+class Matrix;
 namespace tyr {
 
 /**
@@ -27,6 +30,15 @@ namespace tyr {
  */
 std::string serializeDirections(Api& request);
 
+/**
+ * Put the answers to the independent routes of a batch into one response, in the order the routes
+ * were requested
+ *
+ * @param request  The original request
+ * @param routes   The serialized route or error for each of the routes of the batch
+ */
+std::string serializeRouteBatch(const Api& request, const std::vector<std::string>& routes);
+
 /**
  * Turn a time distance matrix into json that one can look up location pair results from
  */
@@ -34,6 +46,42 @@ std::string serializeMatrix(const Api& request,
                             const std::vector<thor::TimeDistance>& time_distances,
                             double distance_scale);
 
+/**
+ * Serializes a matrix a block of rows at a time, in any of the formats serializeMatrix has, so the
+ * times and distances of a block can be dropped as soon as it is added. Only the text of the rows
+ * added so far is kept rather than the whole matrix and the tree of json it would make
+ */
+class MatrixSerializer {
+public:
+  /**
+   * @param request         The request with the sources and targets of the whole matrix
+   * @param distance_scale  What the distances in meters are multiplied by to get to the units
+   */
+  MatrixSerializer(const Api& request, double distance_scale);
+  ~MatrixSerializer();
+
+  /**
+   * Adds the next rows of the matrix
+   * @param time_distances  The rows in the order of their sources, an entry per target each
+   */
+  void AddRows(const std::vector<thor::TimeDistance>& time_distances);
+
+  /**
+   * @return the whole response once all of the rows are added, only to be called once
+   */
+  std::string Finish();
+
+protected:
+  const Api& request_;
+  double distance_scale_;
+  size_t rows_;
+  // the text of the rows, of only their times when the distances are an array of their own
+  std::string times_;
+  std::string distances_;
+  // the flat arrays of a pbf response
+  std::unique_ptr<Matrix> matrix_;
+};
+
 /**
  * Turn grid data contours into geojson
  *
@@ -44,7 +92,9 @@ std::string serializeIsochrones(const Api& request,
                                 std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals,
                                 midgard::GriddedData<2>::contours_t& contours,
                                 bool polygons = true,
-                                bool show_locations = false);
+                                bool show_locations = false,
+                                const std::vector<uint32_t>& location_indices = {},
+                                const std::vector<bool>& reversed = {});
 
 /**
  * Turn heights and ranges into a height response
@@ -83,6 +133,14 @@ std::string serializeTransitAvailable(const Api& request,
                                       const std::vector<baldr::Location>& locations,
                                       const std::unordered_set<baldr::Location>& found);
 
+/**
+ * Turn the labels of a recosted path into its totals and what each of its edges took
+ *
+ * @param request  The original request
+ * @param labels   The label of each edge of the path, their costs and lengths add up along it
+ */
+std::string serializeRecost(const Api& request, const std::vector<sif::EdgeLabel>& labels);
+
 /**
  * Turn trip paths and the match results of each into attributes based on the filter specified
  *
@@ -95,6 +153,14 @@ std::string serializeTraceAttributes(
     const thor::AttributesController& controller,
     std::vector<std::tuple<float, float, std::vector<meili::MatchResult>>>& results);
 
+/**
+ * Turn the whole request, with its trip and directions, into protobuf bytes. Clients that speak
+ * protobuf can read the TripLegs and DirectionsLegs straight from it without a json round trip
+ *
+ * @param request  The request with its results filled out
+ */
+std::string serializePbf(const Api& request);
+
 // Return a JSON array of OpenLR 1.5 line location references for each edge of a map matching
 // result. For the time being, result is only non-empty for auto costing requests.
 void route_references(baldr::json::MapPtr& route_json,
@@ -1,7 +1,11 @@
 #ifndef __VALHALLA_SERVICE_H__
 #define __VALHALLA_SERVICE_H__
+#include <functional>
+#include <memory>
 #include <string>
 
+#include <google/protobuf/arena.h>
+
 #include <valhalla/baldr/json.h>
 #include <valhalla/baldr/rapidjson_utils.h>
 #include <valhalla/midgard/util.h>
@@ -14,6 +18,9 @@
 #endif
 
 namespace valhalla {
+namespace baldr {
+class GraphReader;
+}
 
 const std::unordered_map<unsigned, std::string> error_codes{
     // loki project 1xx
@@ -27,6 +34,8 @@ const std::unordered_map<unsigned, std::string> error_codes{
     {112, "Insufficiently specified required parameter 'locations' or 'sources & targets'"},
     {113, "Insufficiently specified required parameter 'contours'"},
     {114, "Insufficiently specified required parameter 'shape' or 'encoded_polyline'"},
+    {115, "Insufficiently specified required parameter 'routes'"},
+    {116, "Insufficiently specified required parameter 'edges'"},
 
     {120, "Insufficient number of locations provided"},
     {121, "Insufficient number of sources provided"},
@@ -69,10 +78,13 @@ const std::unordered_map<unsigned, std::string> error_codes{
     {164, "Invalid shape format"},
     {165, "Date and time required for destination for date_type of invariant"},
     {166, "Exceeded max distance"},
+    {167, "Exceeded max routes"},
 
     {170, "Locations are in unconnected regions. Go check/edit the map at osm.org"},
     {171, "No suitable edges near location"},
     {172, "Exceeded breakage distance for all pairs"},
+    {173, "Too busy to answer the request in time"},
+    {174, "The deadline of the request passed"},
 
     {199, "Unknown"},
 
@@ -117,6 +129,7 @@ const std::unordered_map<unsigned, std::string> error_codes{
     {424, "Failed to parse shape"},
 
     {430, "Exceeded max iterations in CostMatrix::SourceToTarget"},
+    {431, "Exceeded the memory limit for path finding"},
 
     {440, "Cannot reach destination - too far from a transit stop"},
     {441, "Location is unreachable"},
@@ -125,6 +138,7 @@ const std::unordered_map<unsigned, std::string> error_codes{
     {444, "Map Match algorithm failed to find path"},
     {445, "Shape match algorithm specification in api request is incorrect. Please see "
           "documentation for valid shape_match input."},
+    {446, "The edges are not a path that this costing can take"},
 
     {499, "Unknown"},
 
@@ -164,6 +178,15 @@ inline midgard::scoped_timer<> measure_scope_time(Api& api, const std::string& s
   });
 }
 
+/**
+ * Wraps an interrupt so that it also throws a 174 once the deadline in the info of the request has
+ * passed, so that nobody keeps working on a request the client has stopped waiting for
+ * @param interrupt  the interrupt to wrap, may be null
+ * @param request    the request with its deadline
+ * @return the wrapped interrupt, which does nothing when there is neither
+ */
+std::function<void()> with_deadline(const std::function<void()>* interrupt, const Api& request);
+
 // TODO: this will go away and Options will be the request object
 void ParseApi(const std::string& json_request, Options::Action action, Api& api);
 #ifdef HAVE_HTTP
@@ -187,6 +210,8 @@ const content_type JSON_MIME{"Content-type", "application/json;charset=utf-8"};
 const content_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
 const content_type XML_MIME{"Content-type", "text/xml;charset=utf-8"};
 const content_type GPX_MIME{"Content-type", "application/gpx+xml;charset=utf-8"};
+const content_type PBF_MIME{"Content-type", "application/x-protobuf"};
+const content_type METRICS_MIME{"Content-type", "text/plain; version=0.0.4;charset=utf-8"};
 } // namespace worker
 
 prime_server::worker_t::result_t
@@ -194,9 +219,36 @@ to_response(const std::string& data,
             prime_server::http_request_info_t& request_info,
             const Api& options,
             const worker::content_type& content_type = worker::JSON_MIME,
-            const bool as_attachment = false);
+            const bool as_attachment = false,
+            const prime_server::headers_t& extra_headers = {});
 #endif
 
+/**
+ * Where the requests a worker answers live. A long route has an edge and a node for every edge of
+ * its path, all of them small messages, which on the arena are allocated by bumping a pointer and
+ * freed all at once when the next request starts. The first block of the arena is kept over the
+ * requests so that most of them don't allocate at all.
+ */
+class request_arena_t {
+public:
+  explicit request_arena_t(const size_t block_size = 1 << 20);
+
+  // a copy gets an arena of its own
+  request_arena_t(const request_arena_t& other);
+  request_arena_t& operator=(const request_arena_t&) = delete;
+
+  /**
+   * Frees the last request and starts a new empty one
+   * @return the request, good until the next one is started
+   */
+  Api& next();
+
+protected:
+  size_t block_size_;
+  std::unique_ptr<char[]> block_;
+  std::unique_ptr<google::protobuf::Arena> arena_;
+};
+
 class service_worker_t {
 public:
   service_worker_t();
@@ -235,7 +287,21 @@ public:
   virtual void set_interrupt(const std::function<void()>* interrupt);
 
 protected:
+  /**
+   * Adds the tile cache lookups the reader made since the last call to the metrics of the stage
+   * @param  stage   the name the lookups are reported under
+   * @param  reader  the reader of the stage
+   */
+  void report_tile_cache(const std::string& stage, const baldr::GraphReader& reader);
+
   const std::function<void()>* interrupt;
+  // the interrupt of the current request which also stops it once its deadline has passed
+  std::function<void()> deadline_interrupt;
+  // the tile cache counters of the reader the last time they were reported
+  uint64_t reported_hits;
+  uint64_t reported_misses;
+  // the request being worked on
+  request_arena_t request_arena;
 };
 } // namespace valhalla
 